@@ -308,6 +308,9 @@ enum {
 
 	/* if apart further than 16M, consider randio for linear model */
 	LCOEF_RANDIO_PAGES	= 4096,
+
+	/* throttle wait histogram, <2us, <8us, <32us ... <8ms and the rest */
+	WAIT_HIST_BUCKETS	= 8,
 };
 
 enum ioc_running {
@@ -445,6 +448,7 @@ struct ioc {
 
 struct iocg_pcpu_stat {
 	local64_t			abs_vusage;
+	local64_t			wait_hist[WAIT_HIST_BUCKETS];
 };
 
 struct iocg_stat {
@@ -729,6 +733,16 @@ static void iocg_commit_bio(struct ioc_gq *iocg, struct bio *bio,
 	put_cpu_ptr(gcs);
 }
 
+static void iocg_record_wait(struct ioc_gq *iocg, u64 wait_us)
+{
+	struct iocg_pcpu_stat *gcs;
+	int bucket = min(fls64(wait_us) / 2, WAIT_HIST_BUCKETS - 1);
+
+	gcs = get_cpu_ptr(iocg->pcpu_stat);
+	local64_inc(&gcs->wait_hist[bucket]);
+	put_cpu_ptr(gcs);
+}
+
 static void iocg_lock(struct ioc_gq *iocg, bool lock_ioc, unsigned long *flags)
 {
 	if (lock_ioc) {
@@ -2687,6 +2701,9 @@ static void ioc_rqos_throttle(struct rq_qos *rqos, struct bio *bio)
 
 	/* waker already committed us, proceed */
 	finish_wait(&iocg->waitq, &wait.wait);
+
+	if (blkcg_debug_stats)
+		iocg_record_wait(iocg, ktime_to_us(ktime_get()) - now.now);
 }
 
 static void ioc_rqos_merge(struct rq_qos *rqos, struct request *rq,
@@ -3012,11 +3029,36 @@ static bool ioc_pd_stat(struct blkg_policy_data *pd, struct seq_file *s)
 
 	seq_printf(s, " cost.usage=%llu", iocg->last_stat.usage_us);
 
-	if (blkcg_debug_stats)
+	if (blkcg_debug_stats) {
+		struct ioc_now now;
+		int cpu, i;
+
 		seq_printf(s, " cost.wait=%llu cost.indebt=%llu cost.indelay=%llu",
 			iocg->last_stat.wait_us,
 			iocg->last_stat.indebt_us,
 			iocg->last_stat.indelay_us);
+
+		/*
+		 * Current state, racy snapshots are fine. vlag is the budget
+		 * left in usecs of device time, negative if running ahead.
+		 */
+		ioc_now(ioc, &now);
+		seq_printf(s, " cost.vlag=%lld cost.debt=%llu cost.delay=%llu",
+			   div64_s64(now.vnow - atomic64_read(&iocg->vtime),
+				     VTIME_PER_USEC),
+			   div64_u64(READ_ONCE(iocg->abs_vdebt), VTIME_PER_USEC),
+			   READ_ONCE(iocg->delay));
+
+		seq_puts(s, " cost.wait_hist=");
+		for (i = 0; i < WAIT_HIST_BUCKETS; i++) {
+			u64 nr = 0;
+
+			for_each_possible_cpu(cpu)
+				nr += local64_read(per_cpu_ptr(
+					&iocg->pcpu_stat->wait_hist[i], cpu));
+			seq_printf(s, "%s%llu", i ? "," : "", nr);
+		}
+	}
 	return true;
 }
 
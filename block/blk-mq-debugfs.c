@@ -462,6 +462,8 @@ static void blk_mq_debugfs_tags_show(struct seq_file *m,
 		seq_puts(m, "\nbreserved_tags:\n");
 		sbitmap_queue_show(&tags->breserved_tags, m);
 	}
+
+	blk_mq_tag_cache_show(tags, m);
 }
 
 static int hctx_tags_show(void *data, struct seq_file *m)
@@ -16,6 +16,157 @@
 #include "blk-mq-sched.h"
 #include "blk-mq-tag.h"
 
+/*
+ * Per-CPU cache of free tags. Completions park up to BLK_MQ_TAG_CACHE_SIZE
+ * freed tags on the local CPU instead of clearing the bit in the sbitmap and
+ * the next allocation on that CPU reuses them, which keeps the sbitmap words
+ * and wait queues out of the fast path. The cache is bypassed while anybody
+ * waits for a tag and is flushed back to the sbitmap before an allocation
+ * fails or the depth changes, so caching never makes a tag unavailable.
+ */
+#define BLK_MQ_TAG_CACHE_SIZE		8
+#define BLK_MQ_TAG_CACHE_MIN_DEPTH	64
+
+struct blk_mq_tag_cache {
+	spinlock_t lock;
+	unsigned int nr;
+	unsigned int tags[BLK_MQ_TAG_CACHE_SIZE];
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long flushes;
+};
+
+static void blk_mq_tag_cache_init(struct blk_mq_tags *tags)
+{
+	int cpu;
+
+	if (tags->nr_tags - tags->nr_reserved_tags < BLK_MQ_TAG_CACHE_MIN_DEPTH)
+		return;
+
+	/* running without the cache is fine if this fails */
+	tags->cache = alloc_percpu(struct blk_mq_tag_cache);
+	if (!tags->cache)
+		return;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(tags->cache, cpu)->lock);
+}
+
+/*
+ * Take a non-reserved tag from the cache of the local CPU. Returns the bit
+ * number in @tags->bitmap_tags or BLK_MQ_NO_TAG.
+ */
+unsigned int blk_mq_tag_cache_pop(struct blk_mq_tags *tags)
+{
+	unsigned int tag = BLK_MQ_NO_TAG;
+	struct blk_mq_tag_cache *cache;
+	unsigned long flags;
+
+	if (!tags->cache)
+		return BLK_MQ_NO_TAG;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(tags->cache);
+	spin_lock(&cache->lock);
+	if (cache->nr) {
+		tag = cache->tags[--cache->nr];
+		cache->hits++;
+	} else {
+		cache->misses++;
+	}
+	spin_unlock(&cache->lock);
+	local_irq_restore(flags);
+
+	return tag;
+}
+
+static bool blk_mq_tag_cache_push(struct blk_mq_tags *tags, unsigned int tag)
+{
+	struct blk_mq_tag_cache *cache;
+	unsigned long flags;
+	bool cached = false;
+
+	/* shared tags are handed out fairly by hctx_may_queue() */
+	if (!tags->cache || atomic_read(&tags->active_queues))
+		return false;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(tags->cache);
+	spin_lock(&cache->lock);
+	/*
+	 * Checked under the lock, a waiter bumps ws_active before it flushes
+	 * the caches and retries, so either that flush finds this tag or the
+	 * tag goes straight to the sbitmap and wakes the waiter up.
+	 */
+	if (cache->nr < BLK_MQ_TAG_CACHE_SIZE &&
+	    !atomic_read(&tags->bitmap_tags.ws_active)) {
+		cache->tags[cache->nr++] = tag;
+		cached = true;
+	}
+	spin_unlock(&cache->lock);
+	local_irq_restore(flags);
+
+	return cached;
+}
+
+/*
+ * Return the cached tags of all CPUs to the sbitmap. Returns true if any tag
+ * was returned, such that a failed allocation is worth retrying.
+ */
+bool blk_mq_tag_cache_flush(struct blk_mq_tags *tags)
+{
+	unsigned int flushed[BLK_MQ_TAG_CACHE_SIZE];
+	bool ret = false;
+	int cpu;
+
+	if (!tags->cache)
+		return false;
+
+	for_each_possible_cpu(cpu) {
+		struct blk_mq_tag_cache *cache = per_cpu_ptr(tags->cache, cpu);
+		unsigned long flags;
+		unsigned int i, nr;
+
+		spin_lock_irqsave(&cache->lock, flags);
+		nr = cache->nr;
+		memcpy(flushed, cache->tags, nr * sizeof(*flushed));
+		cache->nr = 0;
+		if (nr)
+			cache->flushes++;
+		spin_unlock_irqrestore(&cache->lock, flags);
+
+		for (i = 0; i < nr; i++)
+			sbitmap_queue_clear(&tags->bitmap_tags, flushed[i], cpu);
+		ret |= nr;
+	}
+
+	return ret;
+}
+
+void blk_mq_tag_cache_show(struct blk_mq_tags *tags, struct seq_file *m)
+{
+	unsigned long hits = 0, misses = 0, flushes = 0;
+	unsigned int nr = 0;
+	int cpu;
+
+	if (!tags->cache)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct blk_mq_tag_cache *cache = per_cpu_ptr(tags->cache, cpu);
+
+		nr += READ_ONCE(cache->nr);
+		hits += READ_ONCE(cache->hits);
+		misses += READ_ONCE(cache->misses);
+		flushes += READ_ONCE(cache->flushes);
+	}
+
+	seq_printf(m, "cache_tags=%u\n", nr);
+	seq_printf(m, "cache_hits=%lu\n", hits);
+	seq_printf(m, "cache_misses=%lu\n", misses);
+	seq_printf(m, "cache_flushes=%lu\n", flushes);
+}
+
 /*
  * Recalculate wakeup batch when tag is shared by hctx.
  */
@@ -58,6 +209,7 @@ bool __blk_mq_tag_busy(struct blk_mq_hw_ctx *hctx)
 	users = atomic_inc_return(&hctx->tags->active_queues);
 
 	blk_mq_update_wake_batch(hctx->tags, users);
+	blk_mq_tag_cache_flush(hctx->tags);
 
 	return true;
 }
@@ -112,6 +264,29 @@ static int __blk_mq_get_tag(struct blk_mq_alloc_data *data,
 		return __sbitmap_queue_get(bt);
 }
 
+static int blk_mq_get_tag_cached(struct blk_mq_alloc_data *data,
+				 struct blk_mq_tags *tags,
+				 struct sbitmap_queue *bt)
+{
+	int tag;
+
+	if (bt != &tags->bitmap_tags)
+		return __blk_mq_get_tag(data, bt);
+
+	/* shallow allocations must stay below their depth */
+	if (!data->shallow_depth &&
+	    !(data->hctx->flags & BLK_MQ_F_TAG_QUEUE_SHARED)) {
+		tag = blk_mq_tag_cache_pop(tags);
+		if (tag != BLK_MQ_NO_TAG)
+			return tag;
+	}
+
+	tag = __blk_mq_get_tag(data, bt);
+	if (tag == BLK_MQ_NO_TAG && blk_mq_tag_cache_flush(tags))
+		tag = __blk_mq_get_tag(data, bt);
+	return tag;
+}
+
 unsigned long blk_mq_get_tags(struct blk_mq_alloc_data *data, int nr_tags,
 			      unsigned int *offset)
 {
@@ -148,7 +323,7 @@ unsigned int blk_mq_get_tag(struct blk_mq_alloc_data *data)
 		tag_offset = tags->nr_reserved_tags;
 	}
 
-	tag = __blk_mq_get_tag(data, bt);
+	tag = blk_mq_get_tag_cached(data, tags, bt);
 	if (tag != BLK_MQ_NO_TAG)
 		goto found_tag;
 
@@ -170,13 +345,13 @@ unsigned int blk_mq_get_tag(struct blk_mq_alloc_data *data)
 		 * Retry tag allocation after running the hardware queue,
 		 * as running the queue may also have found completions.
 		 */
-		tag = __blk_mq_get_tag(data, bt);
+		tag = blk_mq_get_tag_cached(data, tags, bt);
 		if (tag != BLK_MQ_NO_TAG)
 			break;
 
 		sbitmap_prepare_to_wait(bt, ws, &wait, TASK_UNINTERRUPTIBLE);
 
-		tag = __blk_mq_get_tag(data, bt);
+		tag = blk_mq_get_tag_cached(data, tags, bt);
 		if (tag != BLK_MQ_NO_TAG)
 			break;
 
@@ -226,7 +401,9 @@ void blk_mq_put_tag(struct blk_mq_tags *tags, struct blk_mq_ctx *ctx,
 		const int real_tag = tag - tags->nr_reserved_tags;
 
 		BUG_ON(real_tag >= tags->nr_tags);
-		sbitmap_queue_clear(&tags->bitmap_tags, real_tag, ctx->cpu);
+		if (!blk_mq_tag_cache_push(tags, real_tag))
+			sbitmap_queue_clear(&tags->bitmap_tags, real_tag,
+					    ctx->cpu);
 	} else {
 		BUG_ON(tag >= tags->nr_reserved_tags);
 		sbitmap_queue_clear(&tags->breserved_tags, tag, ctx->cpu);
@@ -235,8 +412,16 @@ void blk_mq_put_tag(struct blk_mq_tags *tags, struct blk_mq_ctx *ctx,
 
 void blk_mq_put_tags(struct blk_mq_tags *tags, int *tag_array, int nr_tags)
 {
-	sbitmap_queue_clear_batch(&tags->bitmap_tags, tags->nr_reserved_tags,
-					tag_array, nr_tags);
+	int i, nr = 0;
+
+	for (i = 0; i < nr_tags; i++)
+		if (!blk_mq_tag_cache_push(tags,
+				tag_array[i] - tags->nr_reserved_tags))
+			tag_array[nr++] = tag_array[i];
+
+	if (nr)
+		sbitmap_queue_clear_batch(&tags->bitmap_tags,
+					  tags->nr_reserved_tags, tag_array, nr);
 }
 
 struct bt_iter_data {
@@ -589,11 +774,13 @@ struct blk_mq_tags *blk_mq_init_tags(unsigned int total_tags,
 		kfree(tags);
 		return NULL;
 	}
+	blk_mq_tag_cache_init(tags);
 	return tags;
 }
 
 void blk_mq_free_tags(struct blk_mq_tags *tags)
 {
+	free_percpu(tags->cache);
 	sbitmap_queue_free(&tags->bitmap_tags);
 	sbitmap_queue_free(&tags->breserved_tags);
 	kfree(tags);
@@ -644,6 +831,7 @@ int blk_mq_tag_update_depth(struct blk_mq_hw_ctx *hctx,
 		 * Don't need (or can't) update reserved tags here, they
 		 * remain static and should never need resizing.
 		 */
+		blk_mq_tag_cache_flush(tags);
 		sbitmap_queue_resize(&tags->bitmap_tags,
 				tdepth - tags->nr_reserved_tags);
 	}
@@ -655,11 +843,13 @@ void blk_mq_tag_resize_shared_tags(struct blk_mq_tag_set *set, unsigned int size
 {
 	struct blk_mq_tags *tags = set->shared_tags;
 
+	blk_mq_tag_cache_flush(tags);
 	sbitmap_queue_resize(&tags->bitmap_tags, size - set->reserved_tags);
 }
 
 void blk_mq_tag_update_sched_shared_tags(struct request_queue *q)
 {
+	blk_mq_tag_cache_flush(q->sched_shared_tags);
 	sbitmap_queue_resize(&q->sched_shared_tags->bitmap_tags,
 			     q->nr_requests - q->tag_set->reserved_tags);
 }
@@ -3,6 +3,7 @@
 #define INT_BLK_MQ_TAG_H
 
 struct blk_mq_alloc_data;
+struct seq_file;
 
 extern struct blk_mq_tags *blk_mq_init_tags(unsigned int nr_tags,
 					unsigned int reserved_tags,
@@ -20,6 +21,9 @@ unsigned long blk_mq_get_tags(struct blk_mq_alloc_data *data, int nr_tags,
 extern void blk_mq_put_tag(struct blk_mq_tags *tags, struct blk_mq_ctx *ctx,
 			   unsigned int tag);
 void blk_mq_put_tags(struct blk_mq_tags *tags, int *tag_array, int nr_tags);
+unsigned int blk_mq_tag_cache_pop(struct blk_mq_tags *tags);
+bool blk_mq_tag_cache_flush(struct blk_mq_tags *tags);
+void blk_mq_tag_cache_show(struct blk_mq_tags *tags, struct seq_file *m);
 extern int blk_mq_tag_update_depth(struct blk_mq_hw_ctx *hctx,
 					struct blk_mq_tags **tags,
 					unsigned int depth, bool can_grow);
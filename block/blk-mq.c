@@ -1566,12 +1566,21 @@ static bool __blk_mq_alloc_driver_tag(struct request *rq)
 	} else {
 		if (!hctx_may_queue(rq->mq_hctx, bt))
 			return false;
+
+		if (!(rq->mq_hctx->flags & BLK_MQ_F_TAG_QUEUE_SHARED)) {
+			tag = blk_mq_tag_cache_pop(rq->mq_hctx->tags);
+			if (tag != BLK_MQ_NO_TAG)
+				goto found;
+		}
 	}
 
 	tag = __sbitmap_queue_get(bt);
+	if (tag == BLK_MQ_NO_TAG && bt == &rq->mq_hctx->tags->bitmap_tags &&
+	    blk_mq_tag_cache_flush(rq->mq_hctx->tags))
+		tag = __sbitmap_queue_get(bt);
 	if (tag == BLK_MQ_NO_TAG)
 		return false;
-
+found:
 	rq->tag = tag + tag_offset;
 	return true;
 }
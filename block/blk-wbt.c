@@ -21,6 +21,7 @@
  */
 #include <linux/kernel.h>
 #include <linux/blk_types.h>
+#include <linux/moduleparam.h>
 #include <linux/slab.h>
 #include <linux/backing-dev.h>
 #include <linux/swap.h>
@@ -73,8 +74,20 @@ enum {
 	 * information to scale up or down, scale up.
 	 */
 	RWB_UNKNOWN_BUMP	= 5,
+
+	/*
+	 * With latency learning, target this multiple of the mean read
+	 * latency of windows without writes, but stay within this factor
+	 * of the default target.
+	 */
+	RWB_LEARN_LAT_MULT	= 4,
+	RWB_LEARN_LAT_RANGE	= 8,
 };
 
+static bool wbt_learn_lat;
+module_param_named(learn_lat, wbt_learn_lat, bool, 0644);
+MODULE_PARM_DESC(learn_lat, "Derive the default latency target from observed read latencies");
+
 static inline bool rwb_enabled(struct rq_wb *rwb)
 {
 	return rwb && rwb->enable_state != WBT_STATE_OFF_DEFAULT &&
@@ -285,6 +298,36 @@ static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 	return LAT_OK;
 }
 
+/*
+ * Reads completing while no writes are around tell us what the device can
+ * do unloaded. Feed their mean latency into a running average and derive
+ * the target from it, unless the target was set explicitly.
+ */
+static void wbt_update_learned_lat(struct rq_wb *rwb, struct blk_rq_stat *stat)
+{
+	u64 def_lat;
+
+	if (!wbt_learn_lat || rwb->enable_state != WBT_STATE_ON_DEFAULT ||
+	    !rwb->min_lat_nsec)
+		return;
+
+	if (!stat[READ].nr_samples || stat[WRITE].nr_samples ||
+	    wbt_inflight(rwb))
+		return;
+
+	if (rwb->read_lat_nsec)
+		rwb->read_lat_nsec = (rwb->read_lat_nsec * 7 +
+				      stat[READ].mean) >> 3;
+	else
+		rwb->read_lat_nsec = stat[READ].mean;
+
+	def_lat = wbt_default_latency_nsec(rwb->rqos.q);
+	rwb->min_lat_nsec = clamp_t(u64,
+				    rwb->read_lat_nsec * RWB_LEARN_LAT_MULT,
+				    def_lat / RWB_LEARN_LAT_RANGE,
+				    def_lat * RWB_LEARN_LAT_RANGE);
+}
+
 static void rwb_trace_step(struct rq_wb *rwb, const char *msg)
 {
 	struct backing_dev_info *bdi = rwb->rqos.q->disk->bdi;
@@ -360,6 +403,7 @@ static void wb_timer_fn(struct blk_stat_callback *cb)
 	if (!rwb->rqos.q->disk)
 		return;
 
+	wbt_update_learned_lat(rwb, cb->stat);
 	status = latency_exceeded(rwb, cb->stat);
 
 	trace_wbt_timer(rwb->rqos.q->disk->bdi, status, rqd->scale_step,
@@ -762,6 +806,15 @@ static int wbt_min_lat_nsec_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+static int wbt_read_lat_nsec_show(void *data, struct seq_file *m)
+{
+	struct rq_qos *rqos = data;
+	struct rq_wb *rwb = RQWB(rqos);
+
+	seq_printf(m, "%llu\n", rwb->read_lat_nsec);
+	return 0;
+}
+
 static int wbt_unknown_cnt_show(void *data, struct seq_file *m)
 {
 	struct rq_qos *rqos = data;
@@ -795,6 +848,7 @@ static const struct blk_mq_debugfs_attr wbt_debugfs_attrs[] = {
 	{"id", 0400, wbt_id_show},
 	{"inflight", 0400, wbt_inflight_show},
 	{"min_lat_nsec", 0400, wbt_min_lat_nsec_show},
+	{"read_lat_nsec", 0400, wbt_read_lat_nsec_show},
 	{"unknown_cnt", 0400, wbt_unknown_cnt_show},
 	{"wb_normal", 0400, wbt_normal_show},
 	{"wb_background", 0400, wbt_background_show},
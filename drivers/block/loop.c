@@ -132,6 +132,9 @@ static void loop_global_unlock(struct loop_device *lo, bool global)
 
 static int max_part;
 static int part_shift;
+static unsigned int nr_hw_queues = 1;
+static unsigned int hw_queue_depth = 128;
+static bool default_dio = true;
 
 static loff_t get_size(loff_t offset, loff_t sizelimit, struct file *file)
 {
@@ -338,8 +341,13 @@ static int lo_req_flush(struct loop_device *lo, struct request *rq)
 static void lo_complete_rq(struct request *rq)
 {
 	struct loop_cmd *cmd = blk_mq_rq_to_pdu(rq);
+	struct loop_hctx *lh = cmd->lh;
 	blk_status_t ret = BLK_STS_OK;
 
+	atomic_dec(&lh->inflight);
+	atomic64_inc(&lh->nr_completed);
+	atomic64_add(ktime_get_ns() - cmd->start_ns, &lh->latency_ns);
+
 	if (!cmd->use_aio || cmd->ret < 0 || cmd->ret == blk_rq_bytes(rq) ||
 	    req_op(rq) != REQ_OP_READ) {
 		if (cmd->ret < 0)
@@ -506,7 +514,7 @@ static int do_req_filebacked(struct loop_device *lo, struct request *rq)
 static inline void loop_update_dio(struct loop_device *lo)
 {
 	__loop_update_dio(lo, (lo->lo_backing_file->f_flags & O_DIRECT) |
-				lo->use_dio);
+				lo->use_dio | default_dio);
 }
 
 static void loop_reread_partitions(struct loop_device *lo)
@@ -716,6 +724,28 @@ LOOP_ATTR_RO(autoclear);
 LOOP_ATTR_RO(partscan);
 LOOP_ATTR_RO(dio);
 
+/* One line per hardware queue: index, inflight, completed, average latency */
+static ssize_t loop_attr_hw_queue_stats_show(struct loop_device *lo, char *buf)
+{
+	struct blk_mq_hw_ctx *hctx;
+	ssize_t len = 0;
+	unsigned int i;
+
+	queue_for_each_hw_ctx(lo->lo_queue, hctx, i) {
+		struct loop_hctx *lh = hctx->driver_data;
+		u64 nr = atomic64_read(&lh->nr_completed);
+
+		len += sysfs_emit_at(buf, len, "%u %d %llu %llu\n", i,
+				     atomic_read(&lh->inflight), nr,
+				     nr ? div64_u64(atomic64_read(&lh->latency_ns),
+						    nr * NSEC_PER_USEC) : 0ULL);
+	}
+
+	return len;
+}
+
+LOOP_ATTR_RO(hw_queue_stats);
+
 static struct attribute *loop_attrs[] = {
 	&loop_attr_backing_file.attr,
 	&loop_attr_offset.attr,
@@ -723,6 +753,7 @@ static struct attribute *loop_attrs[] = {
 	&loop_attr_autoclear.attr,
 	&loop_attr_partscan.attr,
 	&loop_attr_dio.attr,
+	&loop_attr_hw_queue_stats.attr,
 	NULL,
 };
 
@@ -818,7 +849,8 @@ static inline int queue_on_root_worker(struct cgroup_subsys_state *css)
 }
 #endif
 
-static void loop_queue_work(struct loop_device *lo, struct loop_cmd *cmd)
+static void loop_queue_work(struct loop_device *lo, struct loop_hctx *lh,
+			    struct loop_cmd *cmd)
 {
 	struct rb_node **node, *parent = NULL;
 	struct loop_worker *cur_worker, *worker = NULL;
@@ -880,8 +912,8 @@ static void loop_queue_work(struct loop_device *lo, struct loop_cmd *cmd)
 		work = &worker->work;
 		cmd_list = &worker->cmd_list;
 	} else {
-		work = &lo->rootcg_work;
-		cmd_list = &lo->rootcg_cmd_list;
+		work = &lh->rootcg_work;
+		cmd_list = &lh->rootcg_cmd_list;
 	}
 	list_add_tail(&cmd->list_entry, cmd_list);
 	queue_work(lo->workqueue, work);
@@ -1018,8 +1050,6 @@ static int loop_configure(struct loop_device *lo, fmode_t mode,
 	disk_force_media_change(lo->lo_disk, DISK_EVENT_MEDIA_CHANGE);
 	set_disk_ro(lo->lo_disk, (lo->lo_flags & LO_FLAGS_READ_ONLY) != 0);
 
-	INIT_WORK(&lo->rootcg_work, loop_rootcg_workfn);
-	INIT_LIST_HEAD(&lo->rootcg_cmd_list);
 	INIT_LIST_HEAD(&lo->idle_worker_list);
 	lo->worker_tree = RB_ROOT;
 	timer_setup(&lo->timer, loop_free_idle_workers,
@@ -1787,6 +1817,12 @@ module_param(max_loop, int, 0444);
 MODULE_PARM_DESC(max_loop, "Maximum number of loop devices");
 module_param(max_part, int, 0444);
 MODULE_PARM_DESC(max_part, "Maximum number of partitions per loop device");
+module_param(nr_hw_queues, uint, 0444);
+MODULE_PARM_DESC(nr_hw_queues, "Number of hardware queues per loop device, 0 for one per CPU");
+module_param(hw_queue_depth, uint, 0444);
+MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each hardware queue (default: 128)");
+module_param(default_dio, bool, 0444);
+MODULE_PARM_DESC(default_dio, "Use direct I/O on the backing file whenever its alignment allows (default: true)");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
@@ -1799,6 +1835,10 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 
 	blk_mq_start_request(rq);
 
+	cmd->lh = hctx->driver_data;
+	cmd->start_ns = ktime_get_ns();
+	atomic_inc(&cmd->lh->inflight);
+
 	if (lo->lo_state != Lo_bound)
 		return BLK_STS_IOERR;
 
@@ -1826,7 +1866,7 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 #endif
 	}
 #endif
-	loop_queue_work(lo, cmd);
+	loop_queue_work(lo, cmd->lh, cmd);
 
 	return BLK_STS_OK;
 }
@@ -1919,9 +1959,9 @@ static void loop_workfn(struct work_struct *work)
 
 static void loop_rootcg_workfn(struct work_struct *work)
 {
-	struct loop_device *lo =
-		container_of(work, struct loop_device, rootcg_work);
-	loop_process_work(NULL, &lo->rootcg_cmd_list, lo);
+	struct loop_hctx *lh =
+		container_of(work, struct loop_hctx, rootcg_work);
+	loop_process_work(NULL, &lh->rootcg_cmd_list, lh->lo);
 }
 
 static void loop_free_idle_workers(struct timer_list *timer)
@@ -1945,9 +1985,33 @@ static void loop_free_idle_workers(struct timer_list *timer)
 	spin_unlock_irq(&lo->lo_work_lock);
 }
 
+static int loop_init_hctx(struct blk_mq_hw_ctx *hctx, void *data,
+			  unsigned int hctx_idx)
+{
+	struct loop_hctx *lh;
+
+	lh = kzalloc_node(sizeof(*lh), GFP_KERNEL, hctx->numa_node);
+	if (!lh)
+		return -ENOMEM;
+
+	lh->lo = data;
+	INIT_WORK(&lh->rootcg_work, loop_rootcg_workfn);
+	INIT_LIST_HEAD(&lh->rootcg_cmd_list);
+	hctx->driver_data = lh;
+	return 0;
+}
+
+static void loop_exit_hctx(struct blk_mq_hw_ctx *hctx, unsigned int hctx_idx)
+{
+	kfree(hctx->driver_data);
+	hctx->driver_data = NULL;
+}
+
 static const struct blk_mq_ops loop_mq_ops = {
 	.queue_rq       = loop_queue_rq,
 	.complete	= lo_complete_rq,
+	.init_hctx	= loop_init_hctx,
+	.exit_hctx	= loop_exit_hctx,
 };
 
 static int loop_add(int i)
@@ -1980,8 +2044,8 @@ static int loop_add(int i)
 	i = err;
 
 	lo->tag_set.ops = &loop_mq_ops;
-	lo->tag_set.nr_hw_queues = 1;
-	lo->tag_set.queue_depth = 128;
+	lo->tag_set.nr_hw_queues = nr_hw_queues ?: num_possible_cpus();
+	lo->tag_set.queue_depth = hw_queue_depth;
 	lo->tag_set.numa_node = NUMA_NO_NODE;
 	lo->tag_set.cmd_size = sizeof(struct loop_cmd);
 	lo->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_STACKING |
@@ -2212,6 +2276,9 @@ static int __init loop_init(void)
 		max_part = (1UL << part_shift) - 1;
 	}
 
+	nr_hw_queues = min(nr_hw_queues, nr_cpu_ids);
+	hw_queue_depth = clamp(hw_queue_depth, 1U, (unsigned int)BLK_MQ_MAX_DEPTH);
+
 	if ((1UL << part_shift) > DISK_MAX_PARTS) {
 		err = -EINVAL;
 		goto err_out;
@@ -43,8 +43,6 @@ struct loop_device {
 	int			lo_state;
 	spinlock_t              lo_work_lock;
 	struct workqueue_struct *workqueue;
-	struct work_struct      rootcg_work;
-	struct list_head        rootcg_cmd_list;
 	struct list_head        idle_worker_list;
 	struct rb_root          worker_tree;
 	struct timer_list       timer;
@@ -59,8 +57,24 @@ struct loop_device {
 	struct work_struct      rundown_work;
 };
 
+/*
+ * Per hardware queue state: commands from the root cgroup are issued by one
+ * work item per queue, so that queues submit to the backing file in
+ * parallel.
+ */
+struct loop_hctx {
+	struct loop_device	*lo;
+	struct work_struct	rootcg_work;
+	struct list_head	rootcg_cmd_list;
+	atomic_t		inflight;
+	atomic64_t		nr_completed;
+	atomic64_t		latency_ns;	/* summed over nr_completed */
+};
+
 struct loop_cmd {
 	struct list_head list_entry;
+	struct loop_hctx *lh;
+	u64 start_ns;
 	bool use_aio; /* use AIO interface to handle I/O */
 	atomic_t ref; /* only for aio */
 	long ret;
@@ -60,6 +60,9 @@ struct nbd_sock {
 	bool dead;
 	int fallback_index;
 	int cookie;
+	atomic_t inflight;
+	atomic64_t completed;
+	atomic64_t latency_ns;
 };
 
 struct recv_thread_args {
@@ -147,6 +150,7 @@ struct nbd_cmd {
 	blk_status_t status;
 	unsigned long flags;
 	u32 cmd_cookie;
+	u64 start_ns;
 };
 
 #if IS_ENABLED(CONFIG_DEBUG_FS)
@@ -162,6 +166,14 @@ static struct dentry *nbd_dbg_dir;
 static unsigned int nbds_max = 16;
 static int max_part = 16;
 static int part_shift;
+static bool zerocopy_send = true;
+static bool steer_requests = true;
+
+/*
+ * How many more requests a connection has to have in flight than the least
+ * loaded one before a request queued on it is steered elsewhere.
+ */
+#define NBD_STEER_SLACK 8
 
 static int nbd_dev_dbg_init(struct nbd_device *nbd);
 static void nbd_dev_dbg_close(struct nbd_device *nbd);
@@ -356,6 +368,26 @@ static void nbd_complete_rq(struct request *req)
 	blk_mq_end_request(req, cmd->status);
 }
 
+/*
+ * Drop a command from the in flight count of the connection it was sent on,
+ * call with cmd->lock held right after clearing NBD_CMD_INFLIGHT.
+ */
+static void nbd_sock_account(struct nbd_config *config, struct nbd_cmd *cmd,
+			     bool replied)
+{
+	struct nbd_sock *nsock;
+
+	if (cmd->index >= config->num_connections)
+		return;
+
+	nsock = config->socks[cmd->index];
+	atomic_dec(&nsock->inflight);
+	if (replied) {
+		atomic64_inc(&nsock->completed);
+		atomic64_add(ktime_get_ns() - cmd->start_ns, &nsock->latency_ns);
+	}
+}
+
 /*
  * Forcibly shutdown the socket causing all listeners to error
  */
@@ -415,6 +447,7 @@ static enum blk_eh_timer_return nbd_xmit_timeout(struct request *req,
 		goto done;
 	}
 	config = nbd->config;
+	nbd_sock_account(config, cmd, false);
 
 	if (config->num_connections > 1 ||
 	    (config->num_connections == 1 && nbd->tag_set.timeout)) {
@@ -537,6 +570,51 @@ static int sock_xmit(struct nbd_device *nbd, int index, int send,
 	return result;
 }
 
+/*
+ * Hand a payload page to the socket by reference instead of copying it into
+ * the skb.  The page stays pinned by the network stack until it is acked, and
+ * the request it belongs to is only completed once the server has replied, so
+ * the page can't be reused under us.  Same return convention as sock_xmit().
+ */
+static int sock_send_page(struct nbd_device *nbd, int index,
+			  struct bio_vec *bvec, unsigned int skip,
+			  int msg_flags, int *sent)
+{
+	struct socket *sock = nbd->config->socks[index]->sock;
+	unsigned int offset = bvec->bv_offset + skip;
+	unsigned int len = bvec->bv_len - skip;
+	unsigned int noreclaim_flag;
+	int result;
+
+	if (unlikely(!sock)) {
+		dev_err_ratelimited(disk_to_dev(nbd->disk),
+			"Attempted send on closed socket in sock_send_page\n");
+		return -EINVAL;
+	}
+
+	if (msg_flags & MSG_MORE)
+		msg_flags |= MSG_SENDPAGE_NOTLAST;
+
+	noreclaim_flag = memalloc_noreclaim_save();
+	do {
+		sock->sk->sk_allocation = GFP_NOIO | __GFP_MEMALLOC;
+		result = kernel_sendpage(sock, bvec->bv_page, offset, len,
+					 msg_flags | MSG_NOSIGNAL);
+		if (result <= 0) {
+			if (result == 0)
+				result = -EPIPE;
+			break;
+		}
+		offset += result;
+		len -= result;
+		*sent += result;
+	} while (len);
+
+	memalloc_noreclaim_restore(noreclaim_flag);
+
+	return result;
+}
+
 /*
  * Different settings for sk->sk_sndtimeo can result in different return values
  * if there is a signal pending when we enter sendmsg, because reasons?
@@ -646,19 +724,27 @@ static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 		bio_for_each_segment(bvec, bio, iter) {
 			bool is_last = !next && bio_iter_last(bvec, iter);
 			int flags = is_last ? 0 : MSG_MORE;
+			unsigned int offset = 0;
 
 			dev_dbg(nbd_to_dev(nbd), "request %p: sending %d bytes data\n",
 				req, bvec.bv_len);
-			iov_iter_bvec(&from, WRITE, &bvec, 1, bvec.bv_len);
 			if (skip) {
-				if (skip >= iov_iter_count(&from)) {
-					skip -= iov_iter_count(&from);
+				if (skip >= bvec.bv_len) {
+					skip -= bvec.bv_len;
 					continue;
 				}
-				iov_iter_advance(&from, skip);
+				offset = skip;
 				skip = 0;
 			}
-			result = sock_xmit(nbd, index, 1, &from, flags, &sent);
+			if (zerocopy_send && sendpage_ok(bvec.bv_page)) {
+				result = sock_send_page(nbd, index, &bvec, offset,
+							flags, &sent);
+			} else {
+				iov_iter_bvec(&from, WRITE, &bvec, 1, bvec.bv_len);
+				iov_iter_advance(&from, offset);
+				result = sock_xmit(nbd, index, 1, &from, flags,
+						   &sent);
+			}
 			if (result < 0) {
 				if (was_interrupted(result)) {
 					/* We've already sent the header, we
@@ -752,6 +838,7 @@ static struct nbd_cmd *nbd_handle_reply(struct nbd_device *nbd, int index,
 		ret = -ENOENT;
 		goto out;
 	}
+	nbd_sock_account(nbd->config, cmd, true);
 	if (cmd->index != index) {
 		dev_err(disk_to_dev(nbd->disk), "Unexpected reply %d from different sock %d (expected %d)",
 			tag, index, cmd->index);
@@ -884,6 +971,7 @@ static bool nbd_clear_req(struct request *req, void *data, bool reserved)
 		mutex_unlock(&cmd->lock);
 		return true;
 	}
+	nbd_sock_account(cmd->nbd->config, cmd, false);
 	cmd->status = BLK_STS_IOERR;
 	mutex_unlock(&cmd->lock);
 
@@ -942,6 +1030,48 @@ static int find_fallback(struct nbd_device *nbd, int index)
 	return new_index;
 }
 
+/*
+ * The hardware queues map 1:1 onto the connections, which leaves one busy
+ * submitter stuck behind its own socket while the others sit idle.  Move the
+ * request to the least loaded live connection once the one it was queued for
+ * is clearly busier.  A request that was partially sent has to be finished on
+ * the socket it started on.
+ */
+static int nbd_steer_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd,
+			 int index)
+{
+	struct request *req = blk_mq_rq_from_pdu(cmd);
+	struct nbd_config *config = nbd->config;
+	int i, best = index, min;
+
+	if (cmd->index >= 0 && cmd->index < config->num_connections &&
+	    READ_ONCE(config->socks[cmd->index]->pending) == req)
+		return cmd->index;
+
+	if (!steer_requests || config->num_connections <= 1)
+		return index;
+
+	min = atomic_read(&config->socks[index]->inflight) - NBD_STEER_SLACK;
+	if (min <= 0)
+		return index;
+
+	for (i = 0; i < config->num_connections; i++) {
+		struct nbd_sock *nsock = config->socks[i];
+		int inflight;
+
+		if (i == index || READ_ONCE(nsock->dead) ||
+		    READ_ONCE(nsock->pending))
+			continue;
+		inflight = atomic_read(&nsock->inflight);
+		if (inflight < min) {
+			min = inflight;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
 static int wait_for_reconnect(struct nbd_device *nbd)
 {
 	struct nbd_config *config = nbd->config;
@@ -975,6 +1105,7 @@ static int nbd_handle_cmd(struct nbd_cmd *cmd, int index)
 		nbd_config_put(nbd);
 		return -EINVAL;
 	}
+	index = nbd_steer_cmd(nbd, cmd, index);
 	cmd->status = BLK_STS_OK;
 again:
 	nsock = config->socks[index];
@@ -1021,9 +1152,11 @@ static int nbd_handle_cmd(struct nbd_cmd *cmd, int index)
 	 * Access to this flag is protected by cmd->lock, thus it's safe to set
 	 * the flag after nbd_send_cmd() succeed to send request to server.
 	 */
-	if (!ret)
+	if (!ret) {
 		__set_bit(NBD_CMD_INFLIGHT, &cmd->flags);
-	else if (ret == -EAGAIN) {
+		cmd->start_ns = ktime_get_ns();
+		atomic_inc(&nsock->inflight);
+	} else if (ret == -EAGAIN) {
 		dev_err_ratelimited(disk_to_dev(nbd->disk),
 				    "Request send failed, requeueing\n");
 		nbd_mark_nsock_dead(nbd, nsock, 1);
@@ -1634,6 +1767,28 @@ static int nbd_dbg_flags_show(struct seq_file *s, void *unused)
 
 DEFINE_SHOW_ATTRIBUTE(nbd_dbg_flags);
 
+static int nbd_dbg_connections_show(struct seq_file *s, void *unused)
+{
+	struct nbd_device *nbd = s->private;
+	struct nbd_config *config = nbd->config;
+	int i;
+
+	for (i = 0; i < config->num_connections; i++) {
+		struct nbd_sock *nsock = config->socks[i];
+		u64 completed = atomic64_read(&nsock->completed);
+		u64 latency = atomic64_read(&nsock->latency_ns);
+
+		seq_printf(s, "%d: %s inflight %d completed %llu avg_latency_us %llu\n",
+			   i, READ_ONCE(nsock->dead) ? "dead" : "live",
+			   atomic_read(&nsock->inflight), completed,
+			   completed ? div64_u64(latency, completed * NSEC_PER_USEC) : 0);
+	}
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(nbd_dbg_connections);
+
 static int nbd_dev_dbg_init(struct nbd_device *nbd)
 {
 	struct dentry *dir;
@@ -1655,6 +1810,8 @@ static int nbd_dev_dbg_init(struct nbd_device *nbd)
 	debugfs_create_u32("timeout", 0444, dir, &nbd->tag_set.timeout);
 	debugfs_create_u32("blocksize_bits", 0444, dir, &config->blksize_bits);
 	debugfs_create_file("flags", 0444, dir, nbd, &nbd_dbg_flags_fops);
+	debugfs_create_file("connections", 0444, dir, nbd,
+			    &nbd_dbg_connections_fops);
 
 	return 0;
 }
@@ -2561,3 +2718,7 @@ module_param(nbds_max, int, 0444);
 MODULE_PARM_DESC(nbds_max, "number of network block devices to initialize (default: 16)");
 module_param(max_part, int, 0444);
 MODULE_PARM_DESC(max_part, "number of partitions per device (default: 16)");
+module_param(zerocopy_send, bool, 0644);
+MODULE_PARM_DESC(zerocopy_send, "send write payload pages by reference instead of copying them (default: true)");
+module_param(steer_requests, bool, 0644);
+MODULE_PARM_DESC(steer_requests, "move requests off busy connections onto the least loaded one (default: true)");
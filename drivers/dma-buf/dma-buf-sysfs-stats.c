@@ -40,6 +40,12 @@
  *
  * * ``/sys/kernel/dmabuf/buffers/<inode_number>/exporter_name``
  * * ``/sys/kernel/dmabuf/buffers/<inode_number>/size``
+ * * ``/sys/kernel/dmabuf/buffers/<inode_number>/map_cache_hits``
+ * * ``/sys/kernel/dmabuf/buffers/<inode_number>/map_cache_misses``
+ *
+ * Exporters can add their own statistics below ``/sys/kernel/dmabuf``, e.g.
+ * the page pool of the system heap exposes its hit rate in
+ * ``/sys/kernel/dmabuf/system_heap/``.
  *
  * The information in the interface can also be used to derive per-exporter
  * statistics. The data from the interface can be gathered on error conditions
@@ -93,13 +99,35 @@ static ssize_t size_show(struct dma_buf *dmabuf,
 	return sysfs_emit(buf, "%zu\n", dmabuf->size);
 }
 
+static ssize_t map_cache_hits_show(struct dma_buf *dmabuf,
+				   struct dma_buf_stats_attribute *attr,
+				   char *buf)
+{
+	return sysfs_emit(buf, "%ld\n",
+			  atomic_long_read(&dmabuf->map_cache_hits));
+}
+
+static ssize_t map_cache_misses_show(struct dma_buf *dmabuf,
+				     struct dma_buf_stats_attribute *attr,
+				     char *buf)
+{
+	return sysfs_emit(buf, "%ld\n",
+			  atomic_long_read(&dmabuf->map_cache_misses));
+}
+
 static struct dma_buf_stats_attribute exporter_name_attribute =
 	__ATTR_RO(exporter_name);
 static struct dma_buf_stats_attribute size_attribute = __ATTR_RO(size);
+static struct dma_buf_stats_attribute map_cache_hits_attribute =
+	__ATTR_RO(map_cache_hits);
+static struct dma_buf_stats_attribute map_cache_misses_attribute =
+	__ATTR_RO(map_cache_misses);
 
 static struct attribute *dma_buf_stats_default_attrs[] = {
 	&exporter_name_attribute.attr,
 	&size_attribute.attr,
+	&map_cache_hits_attribute.attr,
+	&map_cache_misses_attribute.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(dma_buf_stats_default);
@@ -162,6 +190,21 @@ int dma_buf_init_sysfs_statistics(void)
 	return 0;
 }
 
+/**
+ * dma_buf_stats_add_group - add exporter statistics to the sysfs interface
+ * @group: the attribute group to add, using &struct kobj_attribute
+ *
+ * Creates @group below ``/sys/kernel/dmabuf``. Returns 0 on success or a
+ * negative error code.
+ */
+int dma_buf_stats_add_group(const struct attribute_group *group)
+{
+	if (!dma_buf_stats_kset)
+		return -ENODEV;
+
+	return sysfs_create_group(&dma_buf_stats_kset->kobj, group);
+}
+
 void dma_buf_uninit_sysfs_statistics(void)
 {
 	kset_unregister(dma_buf_per_buffer_stats_kset);
@@ -8,6 +8,9 @@
 #ifndef _DMA_BUF_SYSFS_STATS_H
 #define _DMA_BUF_SYSFS_STATS_H
 
+struct attribute_group;
+struct dma_buf;
+
 #ifdef CONFIG_DMABUF_SYSFS_STATS
 
 int dma_buf_init_sysfs_statistics(void);
@@ -16,6 +19,8 @@ void dma_buf_uninit_sysfs_statistics(void);
 int dma_buf_stats_setup(struct dma_buf *dmabuf);
 
 void dma_buf_stats_teardown(struct dma_buf *dmabuf);
+
+int dma_buf_stats_add_group(const struct attribute_group *group);
 #else
 
 static inline int dma_buf_init_sysfs_statistics(void)
@@ -31,5 +36,10 @@ static inline int dma_buf_stats_setup(struct dma_buf *dmabuf)
 }
 
 static inline void dma_buf_stats_teardown(struct dma_buf *dmabuf) {}
+
+static inline int dma_buf_stats_add_group(const struct attribute_group *group)
+{
+	return 0;
+}
 #endif
 #endif // _DMA_BUF_SYSFS_STATS_H
@@ -15,6 +15,7 @@
 #include <linux/slab.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-fence.h>
+#include <linux/dma-fence-chain.h>
 #include <linux/anon_inodes.h>
 #include <linux/export.h>
 #include <linux/debugfs.h>
@@ -30,6 +31,7 @@
 #include <uapi/linux/magic.h>
 
 #include "dma-buf-sysfs-stats.h"
+#include "dma-fence-stats.h"
 
 static inline int is_dma_buf_file(struct file *);
 
@@ -669,6 +671,153 @@ static struct sg_table * __map_dma_buf(struct dma_buf_attachment *attach,
 	return sg_table;
 }
 
+static void __unmap_dma_buf(struct dma_buf_attachment *attach,
+			    struct sg_table *sg_table,
+			    enum dma_data_direction direction)
+{
+	/* uses XOR, hence this unmangles */
+	mangle_sg_table(sg_table);
+
+	attach->dmabuf->ops->unmap_dma_buf(attach, sg_table, direction);
+}
+
+/*
+ * With CONFIG_DMABUF_MAP_CACHE the mappings of an attachment are kept around
+ * per direction after the importer unmapped them. A mapping is only handed
+ * back to the exporter when the attachment is detached or, for dynamic
+ * exporters, when the buffer moves and nobody uses the mapping any more.
+ */
+struct dma_buf_map_entry {
+	struct list_head node;
+	struct sg_table *sgt;
+	enum dma_data_direction dir;
+	unsigned int users;
+	bool stale;
+};
+
+static bool dma_buf_map_cache_enabled(struct dma_buf_attachment *attach)
+{
+	struct dma_buf *dmabuf = attach->dmabuf;
+
+	if (!IS_ENABLED(CONFIG_DMABUF_MAP_CACHE))
+		return false;
+
+	/* the exporter or the attachment already caches its mapping */
+	if (dmabuf->ops->cache_sgt_mapping || attach->sgt)
+		return false;
+
+	/* without move notify dynamic exporters are pinned while mapped */
+	return !dma_buf_is_dynamic(dmabuf) ||
+		IS_ENABLED(CONFIG_DMABUF_MOVE_NOTIFY);
+}
+
+static struct sg_table *dma_buf_map_cached(struct dma_buf_attachment *attach,
+					   enum dma_data_direction direction)
+{
+	struct dma_buf *dmabuf = attach->dmabuf;
+	struct dma_buf_map_entry *entry;
+	struct sg_table *sg_table;
+
+	mutex_lock(&attach->map_lock);
+	list_for_each_entry(entry, &attach->map_cache, node) {
+		if (entry->stale || entry->dir != direction)
+			continue;
+
+		entry->users++;
+		atomic_long_inc(&dmabuf->map_cache_hits);
+		sg_table = entry->sgt;
+		goto out_unlock;
+	}
+
+	atomic_long_inc(&dmabuf->map_cache_misses);
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry) {
+		sg_table = ERR_PTR(-ENOMEM);
+		goto out_unlock;
+	}
+
+	sg_table = __map_dma_buf(attach, direction);
+	if (!sg_table)
+		sg_table = ERR_PTR(-ENOMEM);
+	if (IS_ERR(sg_table)) {
+		kfree(entry);
+		goto out_unlock;
+	}
+
+	entry->sgt = sg_table;
+	entry->dir = direction;
+	entry->users = 1;
+	list_add(&entry->node, &attach->map_cache);
+
+out_unlock:
+	mutex_unlock(&attach->map_lock);
+	return sg_table;
+}
+
+static void dma_buf_map_entry_free(struct dma_buf_attachment *attach,
+				   struct dma_buf_map_entry *entry)
+{
+	__unmap_dma_buf(attach, entry->sgt, entry->dir);
+	list_del(&entry->node);
+	kfree(entry);
+}
+
+/* Returns false if @sg_table isn't a mapping from the cache */
+static bool dma_buf_unmap_cached(struct dma_buf_attachment *attach,
+				 struct sg_table *sg_table)
+{
+	struct dma_buf_map_entry *entry;
+	bool found = false;
+
+	mutex_lock(&attach->map_lock);
+	list_for_each_entry(entry, &attach->map_cache, node) {
+		if (entry->sgt != sg_table)
+			continue;
+
+		if (!--entry->users && entry->stale)
+			dma_buf_map_entry_free(attach, entry);
+		found = true;
+		break;
+	}
+	mutex_unlock(&attach->map_lock);
+
+	return found;
+}
+
+/* Drop all mappings which are unused, the others once they are unmapped */
+static void dma_buf_map_cache_invalidate(struct dma_buf_attachment *attach)
+{
+	struct dma_buf_map_entry *entry, *tmp;
+
+	mutex_lock(&attach->map_lock);
+	list_for_each_entry_safe(entry, tmp, &attach->map_cache, node) {
+		if (entry->users)
+			entry->stale = true;
+		else
+			dma_buf_map_entry_free(attach, entry);
+	}
+	mutex_unlock(&attach->map_lock);
+}
+
+static void dma_buf_map_cache_fini(struct dma_buf_attachment *attach)
+{
+	struct dma_buf_map_entry *entry, *tmp;
+
+	if (list_empty(&attach->map_cache))
+		return;
+
+	if (dma_buf_is_dynamic(attach->dmabuf))
+		dma_resv_lock(attach->dmabuf->resv, NULL);
+
+	list_for_each_entry_safe(entry, tmp, &attach->map_cache, node) {
+		WARN_ON(entry->users);
+		dma_buf_map_entry_free(attach, entry);
+	}
+
+	if (dma_buf_is_dynamic(attach->dmabuf))
+		dma_resv_unlock(attach->dmabuf->resv);
+}
+
 /**
  * dma_buf_dynamic_attach - Add the device to dma_buf's attachments list
  * @dmabuf:		[in]	buffer to attach device to.
@@ -715,6 +864,8 @@ dma_buf_dynamic_attach(struct dma_buf *dmabuf, struct device *dev,
 		attach->peer2peer = importer_ops->allow_peer2peer;
 	attach->importer_ops = importer_ops;
 	attach->importer_priv = importer_priv;
+	mutex_init(&attach->map_lock);
+	INIT_LIST_HEAD(&attach->map_cache);
 
 	if (dmabuf->ops->attach) {
 		ret = dmabuf->ops->attach(dmabuf, attach);
@@ -787,16 +938,6 @@ struct dma_buf_attachment *dma_buf_attach(struct dma_buf *dmabuf,
 }
 EXPORT_SYMBOL_NS_GPL(dma_buf_attach, DMA_BUF);
 
-static void __unmap_dma_buf(struct dma_buf_attachment *attach,
-			    struct sg_table *sg_table,
-			    enum dma_data_direction direction)
-{
-	/* uses XOR, hence this unmangles */
-	mangle_sg_table(sg_table);
-
-	attach->dmabuf->ops->unmap_dma_buf(attach, sg_table, direction);
-}
-
 /**
  * dma_buf_detach - Remove the given attachment from dmabuf's attachments list
  * @dmabuf:	[in]	buffer to detach from.
@@ -811,6 +952,8 @@ void dma_buf_detach(struct dma_buf *dmabuf, struct dma_buf_attachment *attach)
 	if (WARN_ON(!dmabuf || !attach))
 		return;
 
+	dma_buf_map_cache_fini(attach);
+
 	if (attach->sgt) {
 		if (dma_buf_is_dynamic(attach->dmabuf))
 			dma_resv_lock(attach->dmabuf->resv, NULL);
@@ -829,6 +972,7 @@ void dma_buf_detach(struct dma_buf *dmabuf, struct dma_buf_attachment *attach)
 	if (dmabuf->ops->detach)
 		dmabuf->ops->detach(dmabuf, attach);
 
+	mutex_destroy(&attach->map_lock);
 	kfree(attach);
 }
 EXPORT_SYMBOL_NS_GPL(dma_buf_detach, DMA_BUF);
@@ -902,6 +1046,9 @@ EXPORT_SYMBOL_NS_GPL(dma_buf_unpin, DMA_BUF);
  * therefore users/importers should not hold onto a mapping for undue amounts of
  * time.
  *
+ * With CONFIG_DMABUF_MAP_CACHE the same mapping is returned again for the same
+ * attachment and direction until it is invalidated by dma_buf_move_notify().
+ *
  * Important: Dynamic importers must wait for the exclusive fence of the struct
  * dma_resv attached to the DMA-BUF first.
  */
@@ -931,6 +1078,9 @@ struct sg_table *dma_buf_map_attachment(struct dma_buf_attachment *attach,
 		return attach->sgt;
 	}
 
+	if (dma_buf_map_cache_enabled(attach))
+		return dma_buf_map_cached(attach, direction);
+
 	if (dma_buf_is_dynamic(attach->dmabuf)) {
 		dma_resv_assert_held(attach->dmabuf->resv);
 		if (!IS_ENABLED(CONFIG_DMABUF_MOVE_NOTIFY)) {
@@ -999,6 +1149,10 @@ void dma_buf_unmap_attachment(struct dma_buf_attachment *attach,
 	if (attach->sgt == sg_table)
 		return;
 
+	if (dma_buf_map_cache_enabled(attach) &&
+	    dma_buf_unmap_cached(attach, sg_table))
+		return;
+
 	if (dma_buf_is_dynamic(attach->dmabuf))
 		dma_resv_assert_held(attach->dmabuf->resv);
 
@@ -1016,7 +1170,7 @@ EXPORT_SYMBOL_NS_GPL(dma_buf_unmap_attachment, DMA_BUF);
  * @dmabuf:	[in]	buffer which is moving
  *
  * Informs all attachmenst that they need to destroy and recreated all their
- * mappings.
+ * mappings. Mappings kept by the core are invalidated as well.
  */
 void dma_buf_move_notify(struct dma_buf *dmabuf)
 {
@@ -1024,9 +1178,11 @@ void dma_buf_move_notify(struct dma_buf *dmabuf)
 
 	dma_resv_assert_held(dmabuf->resv);
 
-	list_for_each_entry(attach, &dmabuf->attachments, node)
+	list_for_each_entry(attach, &dmabuf->attachments, node) {
+		dma_buf_map_cache_invalidate(attach);
 		if (attach->importer_ops)
 			attach->importer_ops->move_notify(attach);
+	}
 }
 EXPORT_SYMBOL_NS_GPL(dma_buf_move_notify, DMA_BUF);
 
@@ -1387,12 +1543,19 @@ static int dma_buf_debug_show(struct seq_file *s, void *unused)
 
 DEFINE_SHOW_ATTRIBUTE(dma_buf_debug);
 
+static int dma_buf_fence_chain_show(struct seq_file *s, void *unused)
+{
+	dma_fence_chain_describe_stats(s);
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(dma_buf_fence_chain);
+
 static struct dentry *dma_buf_debugfs_dir;
 
 static int dma_buf_init_debugfs(void)
 {
 	struct dentry *d;
-	int err = 0;
 
 	d = debugfs_create_dir("dma_buf", NULL);
 	if (IS_ERR(d))
@@ -1406,10 +1569,21 @@ static int dma_buf_init_debugfs(void)
 		pr_debug("dma_buf: debugfs: failed to create node bufinfo\n");
 		debugfs_remove_recursive(dma_buf_debugfs_dir);
 		dma_buf_debugfs_dir = NULL;
-		err = PTR_ERR(d);
+		return PTR_ERR(d);
+	}
+
+	d = debugfs_create_file("fence_chain", S_IRUGO, dma_buf_debugfs_dir,
+				NULL, &dma_buf_fence_chain_fops);
+	if (IS_ERR(d)) {
+		pr_debug("dma_buf: debugfs: failed to create node fence_chain\n");
+		debugfs_remove_recursive(dma_buf_debugfs_dir);
+		dma_buf_debugfs_dir = NULL;
+		return PTR_ERR(d);
 	}
 
-	return err;
+	dma_fence_stats_init_debugfs(dma_buf_debugfs_dir);
+
+	return 0;
 }
 
 static void dma_buf_uninit_debugfs(void)
@@ -42,7 +42,7 @@ static void dma_fence_array_clear_pending_error(struct dma_fence_array *array)
 	cmpxchg(&array->base.error, PENDING_ERROR, 0);
 }
 
-static void irq_dma_fence_array_work(struct irq_work *wrk)
+static void irq_dma_fence_array_work(struct dma_fence_deferred *wrk)
 {
 	struct dma_fence_array *array = container_of(wrk, typeof(*array), work);
 
@@ -62,7 +62,7 @@ static void dma_fence_array_cb_func(struct dma_fence *f,
 	dma_fence_array_set_pending_error(array, f->error);
 
 	if (atomic_dec_and_test(&array->num_pending))
-		irq_work_queue(&array->work);
+		dma_fence_defer(&array->work);
 	else
 		dma_fence_put(&array->base);
 }
@@ -168,7 +168,7 @@ struct dma_fence_array *dma_fence_array_create(int num_fences,
 	spin_lock_init(&array->lock);
 	dma_fence_init(&array->base, &dma_fence_array_ops, &array->lock,
 		       context, seqno);
-	init_irq_work(&array->work, irq_dma_fence_array_work);
+	array->work.func = irq_dma_fence_array_work;
 
 	array->num_fences = num_fences;
 	atomic_set(&array->num_pending, signal_on_any ? 1 : num_fences);
@@ -7,10 +7,18 @@
  *	Christian König <christian.koenig@amd.com>
  */
 
+#include <linux/atomic.h>
 #include <linux/dma-fence-chain.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
 
 static bool dma_fence_chain_enable_signaling(struct dma_fence *fence);
 
+static atomic64_t dma_fence_chain_lookups = ATOMIC64_INIT(0);
+static atomic64_t dma_fence_chain_steps = ATOMIC64_INIT(0);
+static atomic64_t dma_fence_chain_skips = ATOMIC64_INIT(0);
+static atomic64_t dma_fence_chain_max_steps = ATOMIC64_INIT(0);
+
 /**
  * dma_fence_chain_get_prev - use RCU to get a reference to the previous fence
  * @chain: chain node to get the previous node from
@@ -76,6 +84,50 @@ struct dma_fence *dma_fence_chain_walk(struct dma_fence *fence)
 }
 EXPORT_SYMBOL(dma_fence_chain_walk);
 
+/**
+ * dma_fence_chain_get_skip - get a reference to the skip node
+ * @chain: chain node to get the skip node from
+ *
+ * Returns the skip node of @chain or NULL if there is none. Skip nodes with an
+ * already signaled fence are dropped instead, so that the skip pointers don't
+ * keep garbage collected parts of the chain alive.
+ */
+static struct dma_fence *dma_fence_chain_get_skip(struct dma_fence_chain *chain)
+{
+	struct dma_fence *skip, *tmp;
+
+	rcu_read_lock();
+	skip = dma_fence_get_rcu_safe(&chain->skip);
+	rcu_read_unlock();
+
+	if (skip && dma_fence_is_signaled(to_dma_fence_chain(skip)->fence)) {
+		tmp = cmpxchg((struct dma_fence __force **)&chain->skip,
+			      skip, NULL);
+		if (tmp == skip)
+			dma_fence_put(tmp);
+		dma_fence_put(skip);
+		skip = NULL;
+	}
+	return skip;
+}
+
+static void dma_fence_chain_account(unsigned long steps, unsigned long skips)
+{
+	s64 max = atomic64_read(&dma_fence_chain_max_steps);
+
+	atomic64_inc(&dma_fence_chain_lookups);
+	atomic64_add(steps, &dma_fence_chain_steps);
+	atomic64_add(skips, &dma_fence_chain_skips);
+	while ((s64)steps > max) {
+		s64 old = atomic64_cmpxchg(&dma_fence_chain_max_steps,
+					   max, steps);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
 /**
  * dma_fence_chain_find_seqno - find fence chain node by seqno
  * @pfence: pointer to the chain node where to start
@@ -89,7 +141,9 @@ EXPORT_SYMBOL(dma_fence_chain_walk);
  */
 int dma_fence_chain_find_seqno(struct dma_fence **pfence, uint64_t seqno)
 {
-	struct dma_fence_chain *chain;
+	struct dma_fence_chain *chain, *iter;
+	unsigned long steps = 0, skips = 0;
+	struct dma_fence *fence, *skip;
 
 	if (!seqno)
 		return 0;
@@ -98,17 +152,63 @@ int dma_fence_chain_find_seqno(struct dma_fence **pfence, uint64_t seqno)
 	if (!chain || chain->base.seqno < seqno)
 		return -EINVAL;
 
-	dma_fence_chain_for_each(*pfence, &chain->base) {
-		if ((*pfence)->context != chain->base.context ||
-		    to_dma_fence_chain(*pfence)->prev_seqno < seqno)
+	fence = dma_fence_get(&chain->base);
+	while (fence) {
+		if (fence->context != chain->base.context)
 			break;
+
+		iter = to_dma_fence_chain(fence);
+		if (iter->prev_seqno < seqno)
+			break;
+
+		++steps;
+
+		/* All nodes between iter and an older node which still covers
+		 * seqno can't be the one we are searching for, so jump over
+		 * them when possible.
+		 */
+		skip = dma_fence_chain_get_skip(iter);
+		if (skip && skip->seqno >= seqno) {
+			dma_fence_put(fence);
+			fence = skip;
+			++skips;
+			continue;
+		}
+		dma_fence_put(skip);
+
+		fence = dma_fence_chain_walk(fence);
 	}
+	*pfence = fence;
 	dma_fence_put(&chain->base);
 
+	dma_fence_chain_account(steps, skips);
 	return 0;
 }
 EXPORT_SYMBOL(dma_fence_chain_find_seqno);
 
+/**
+ * dma_fence_chain_describe_stats - dump the seqno lookup statistics
+ * @seq: the seq_file to put the textual description into
+ *
+ * Dump how many chain nodes dma_fence_chain_find_seqno() had to visit into
+ * the seq_file.
+ */
+void dma_fence_chain_describe_stats(struct seq_file *seq)
+{
+	s64 lookups = atomic64_read(&dma_fence_chain_lookups);
+	s64 steps = atomic64_read(&dma_fence_chain_steps);
+
+	seq_printf(seq, "lookups: %lld\n", lookups);
+	seq_printf(seq, "nodes visited: %lld\n", steps);
+	seq_printf(seq, "nodes skipped: %lld\n",
+		   (s64)atomic64_read(&dma_fence_chain_skips));
+	seq_printf(seq, "average walk: %lld\n",
+		   lookups ? div64_s64(steps, lookups) : 0);
+	seq_printf(seq, "longest walk: %lld\n",
+		   (s64)atomic64_read(&dma_fence_chain_max_steps));
+}
+EXPORT_SYMBOL(dma_fence_chain_describe_stats);
+
 static const char *dma_fence_chain_get_driver_name(struct dma_fence *fence)
 {
         return "dma_fence_chain";
@@ -119,7 +219,7 @@ static const char *dma_fence_chain_get_timeline_name(struct dma_fence *fence)
         return "unbound";
 }
 
-static void dma_fence_chain_irq_work(struct irq_work *work)
+static void dma_fence_chain_irq_work(struct dma_fence_deferred *work)
 {
 	struct dma_fence_chain *chain;
 
@@ -137,8 +237,8 @@ static void dma_fence_chain_cb(struct dma_fence *f, struct dma_fence_cb *cb)
 	struct dma_fence_chain *chain;
 
 	chain = container_of(cb, typeof(*chain), cb);
-	init_irq_work(&chain->work, dma_fence_chain_irq_work);
-	irq_work_queue(&chain->work);
+	chain->work.func = dma_fence_chain_irq_work;
+	dma_fence_defer(&chain->work);
 	dma_fence_put(f);
 }
 
@@ -182,6 +282,8 @@ static void dma_fence_chain_release(struct dma_fence *fence)
 	struct dma_fence_chain *chain = to_dma_fence_chain(fence);
 	struct dma_fence *prev;
 
+	dma_fence_put(rcu_dereference_protected(chain->skip, true));
+
 	/* Manually unlink the chain as much as possible to avoid recursion
 	 * and potential stack overflow.
 	 */
@@ -218,6 +320,40 @@ const struct dma_fence_ops dma_fence_chain_ops = {
 };
 EXPORT_SYMBOL(dma_fence_chain_ops);
 
+/*
+ * Set up the skip pointer of a new chain node like the jump pointers of a skew
+ * binary random access list: either jump to the skip node of the skip node of
+ * the previous node when both cover the same distance, or to the previous node
+ * itself. This keeps dma_fence_chain_find_seqno() logarithmic in the length of
+ * the chain.
+ */
+static void dma_fence_chain_init_skip(struct dma_fence_chain *chain,
+				      struct dma_fence_chain *prev_chain)
+{
+	struct dma_fence_chain *skip_chain, *skip2_chain;
+	struct dma_fence *skip, *skip2 = NULL;
+
+	skip = dma_fence_chain_get_skip(prev_chain);
+	if (skip) {
+		skip_chain = to_dma_fence_chain(skip);
+		skip2 = dma_fence_chain_get_skip(skip_chain);
+	}
+
+	if (skip2) {
+		skip2_chain = to_dma_fence_chain(skip2);
+		if (prev_chain->depth - skip_chain->depth ==
+		    skip_chain->depth - skip2_chain->depth) {
+			RCU_INIT_POINTER(chain->skip, skip2);
+			dma_fence_put(skip);
+			return;
+		}
+		dma_fence_put(skip2);
+	}
+	dma_fence_put(skip);
+
+	RCU_INIT_POINTER(chain->skip, dma_fence_get(&prev_chain->base));
+}
+
 /**
  * dma_fence_chain_init - initialize a fence chain
  * @chain: the chain node to initialize
@@ -238,13 +374,17 @@ void dma_fence_chain_init(struct dma_fence_chain *chain,
 
 	spin_lock_init(&chain->lock);
 	rcu_assign_pointer(chain->prev, prev);
+	RCU_INIT_POINTER(chain->skip, NULL);
 	chain->fence = fence;
 	chain->prev_seqno = 0;
+	chain->depth = 0;
 
 	/* Try to reuse the context of the previous chain node. */
 	if (prev_chain && __dma_fence_is_later(seqno, prev->seqno, prev->ops)) {
 		context = prev->context;
 		chain->prev_seqno = prev->seqno;
+		chain->depth = prev_chain->depth + 1;
+		dma_fence_chain_init_skip(chain, prev_chain);
 	} else {
 		context = dma_fence_context_alloc(1);
 		/* Make sure that we always have a valid sequence number. */
@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Fence signalling statistics.
+ *
+ * Collects per timeline how long fences take from creation to signalling and
+ * from signalling until a waiter returns from dma_fence_wait(). Collection is
+ * off by default and enabled by writing 1 to
+ * ``/sys/kernel/debug/dma_buf/fence_stats``, writing 0 disables it again.
+ * Reading the file dumps the counters and log2 histograms in microseconds.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/jhash.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+
+#include "dma-fence-stats.h"
+
+#define DMA_FENCE_STATS_TIMELINES	32
+#define DMA_FENCE_STATS_BUCKETS		16
+#define DMA_FENCE_STATS_NAME_LEN	32
+
+DEFINE_STATIC_KEY_FALSE(dma_fence_stats_enabled);
+
+struct dma_fence_stats_timeline {
+	char driver_name[DMA_FENCE_STATS_NAME_LEN];
+	char timeline_name[DMA_FENCE_STATS_NAME_LEN];
+	u32 hash;
+	bool used;
+};
+
+struct dma_fence_stats_cpu {
+	u64 signaled;
+	u64 signal_ns;
+	u64 signal_hist[DMA_FENCE_STATS_BUCKETS];
+	u64 waited;
+	u64 wait_ns;
+	u64 wait_hist[DMA_FENCE_STATS_BUCKETS];
+};
+
+/* the last timeline collects everything which doesn't fit any more */
+static struct dma_fence_stats_timeline timelines[DMA_FENCE_STATS_TIMELINES];
+static struct dma_fence_stats_cpu (__percpu *counters)[DMA_FENCE_STATS_TIMELINES];
+static DEFINE_RAW_SPINLOCK(timelines_lock);
+static DEFINE_MUTEX(enable_lock);
+
+static unsigned int dma_fence_stats_bucket(u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+
+	return min_t(unsigned int, us ? ilog2(us) + 1 : 0,
+		     DMA_FENCE_STATS_BUCKETS - 1);
+}
+
+static unsigned int dma_fence_stats_lookup(struct dma_fence *fence)
+{
+	const char *driver = fence->ops->get_driver_name(fence);
+	const char *timeline = fence->ops->get_timeline_name(fence);
+	struct dma_fence_stats_timeline *t;
+	unsigned long flags;
+	unsigned int i, n;
+	u32 hash;
+
+	hash = jhash(driver, strlen(driver), 0);
+	hash = jhash(timeline, strlen(timeline), hash);
+
+	for (n = 0, i = hash % (DMA_FENCE_STATS_TIMELINES - 1);
+	     n < DMA_FENCE_STATS_TIMELINES - 1;
+	     n++, i = (i + 1) % (DMA_FENCE_STATS_TIMELINES - 1)) {
+		t = &timelines[i];
+
+		if (!smp_load_acquire(&t->used)) {
+			raw_spin_lock_irqsave(&timelines_lock, flags);
+			if (!t->used) {
+				strscpy(t->driver_name, driver,
+					sizeof(t->driver_name));
+				strscpy(t->timeline_name, timeline,
+					sizeof(t->timeline_name));
+				t->hash = hash;
+				smp_store_release(&t->used, true);
+			}
+			raw_spin_unlock_irqrestore(&timelines_lock, flags);
+		}
+
+		if (t->hash == hash &&
+		    !strncmp(t->driver_name, driver, sizeof(t->driver_name)) &&
+		    !strncmp(t->timeline_name, timeline,
+			     sizeof(t->timeline_name)))
+			return i;
+	}
+
+	return DMA_FENCE_STATS_TIMELINES - 1;
+}
+
+void __dma_fence_stats_signaled(struct dma_fence *fence)
+{
+	unsigned int i = dma_fence_stats_lookup(fence);
+	u64 ns;
+
+	ns = ktime_to_ns(ktime_sub(fence->timestamp, fence->created));
+	this_cpu_inc((*counters)[i].signaled);
+	this_cpu_add((*counters)[i].signal_ns, ns);
+	this_cpu_inc((*counters)[i].signal_hist[dma_fence_stats_bucket(ns)]);
+}
+
+void __dma_fence_stats_waited(struct dma_fence *fence)
+{
+	unsigned int i;
+	u64 ns;
+
+	if (!test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &fence->flags))
+		return;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), fence->timestamp));
+	i = dma_fence_stats_lookup(fence);
+	this_cpu_inc((*counters)[i].waited);
+	this_cpu_add((*counters)[i].wait_ns, ns);
+	this_cpu_inc((*counters)[i].wait_hist[dma_fence_stats_bucket(ns)]);
+}
+
+static void dma_fence_stats_print_hist(struct seq_file *seq, const char *name,
+				       const u64 *hist)
+{
+	unsigned int i;
+
+	seq_printf(seq, "\t%s:", name);
+	for (i = 0; i < DMA_FENCE_STATS_BUCKETS; i++)
+		seq_printf(seq, " %llu", hist[i]);
+	seq_puts(seq, "\n");
+}
+
+static int dma_fence_stats_show(struct seq_file *seq, void *unused)
+{
+	struct dma_fence_stats_cpu sum;
+	unsigned int i, j;
+	int cpu;
+
+	mutex_lock(&enable_lock);
+	seq_printf(seq, "enabled: %d\n",
+		   static_key_enabled(&dma_fence_stats_enabled));
+	seq_puts(seq, "histogram buckets: <1us, <2us, <4us, ...\n");
+	if (!counters)
+		goto out_unlock;
+
+	for (i = 0; i < DMA_FENCE_STATS_TIMELINES; i++) {
+		if (!smp_load_acquire(&timelines[i].used))
+			continue;
+
+		memset(&sum, 0, sizeof(sum));
+		for_each_possible_cpu(cpu) {
+			struct dma_fence_stats_cpu *stats;
+
+			stats = &(*per_cpu_ptr(counters, cpu))[i];
+			sum.signaled += stats->signaled;
+			sum.signal_ns += stats->signal_ns;
+			sum.waited += stats->waited;
+			sum.wait_ns += stats->wait_ns;
+			for (j = 0; j < DMA_FENCE_STATS_BUCKETS; j++) {
+				sum.signal_hist[j] += stats->signal_hist[j];
+				sum.wait_hist[j] += stats->wait_hist[j];
+			}
+		}
+
+		seq_printf(seq, "%s %s: signaled %llu avg %lluus, waited %llu avg %lluus\n",
+			   timelines[i].driver_name,
+			   timelines[i].timeline_name,
+			   sum.signaled,
+			   sum.signaled ? div64_u64(sum.signal_ns, sum.signaled *
+						    NSEC_PER_USEC) : 0,
+			   sum.waited,
+			   sum.waited ? div64_u64(sum.wait_ns, sum.waited *
+						  NSEC_PER_USEC) : 0);
+		dma_fence_stats_print_hist(seq, "signal", sum.signal_hist);
+		dma_fence_stats_print_hist(seq, "wakeup", sum.wait_hist);
+	}
+
+out_unlock:
+	mutex_unlock(&enable_lock);
+	return 0;
+}
+
+static int dma_fence_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dma_fence_stats_show, NULL);
+}
+
+static ssize_t dma_fence_stats_write(struct file *file, const char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(buf, count, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&enable_lock);
+	if (enable && !static_key_enabled(&dma_fence_stats_enabled)) {
+		if (!counters)
+			counters = alloc_percpu(typeof(*counters));
+		if (!counters) {
+			ret = -ENOMEM;
+			goto out_unlock;
+		}
+		static_branch_enable(&dma_fence_stats_enabled);
+	} else if (!enable && static_key_enabled(&dma_fence_stats_enabled)) {
+		/* the counters stay around, signalling may still use them */
+		static_branch_disable(&dma_fence_stats_enabled);
+	}
+
+out_unlock:
+	mutex_unlock(&enable_lock);
+	return ret ? ret : count;
+}
+
+static const struct file_operations dma_fence_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = dma_fence_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+	.write = dma_fence_stats_write,
+};
+
+void dma_fence_stats_init_debugfs(struct dentry *dir)
+{
+	strscpy(timelines[DMA_FENCE_STATS_TIMELINES - 1].driver_name, "other",
+		DMA_FENCE_STATS_NAME_LEN);
+	strscpy(timelines[DMA_FENCE_STATS_TIMELINES - 1].timeline_name, "other",
+		DMA_FENCE_STATS_NAME_LEN);
+	smp_store_release(&timelines[DMA_FENCE_STATS_TIMELINES - 1].used, true);
+
+	debugfs_create_file("fence_stats", 0644, dir, NULL,
+			    &dma_fence_stats_fops);
+}
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Fence signalling statistics.
+ */
+
+#ifndef _DMA_FENCE_STATS_H
+#define _DMA_FENCE_STATS_H
+
+#include <linux/dma-fence.h>
+#include <linux/jump_label.h>
+
+struct dentry;
+
+#ifdef CONFIG_DMA_FENCE_STATS
+
+DECLARE_STATIC_KEY_FALSE(dma_fence_stats_enabled);
+
+void __dma_fence_stats_signaled(struct dma_fence *fence);
+void __dma_fence_stats_waited(struct dma_fence *fence);
+void dma_fence_stats_init_debugfs(struct dentry *dir);
+
+static inline void dma_fence_stats_init(struct dma_fence *fence)
+{
+	fence->created = 0;
+	if (static_branch_unlikely(&dma_fence_stats_enabled))
+		fence->created = ktime_get();
+}
+
+static inline void dma_fence_stats_signaled(struct dma_fence *fence)
+{
+	if (static_branch_unlikely(&dma_fence_stats_enabled) && fence->created)
+		__dma_fence_stats_signaled(fence);
+}
+
+static inline void dma_fence_stats_waited(struct dma_fence *fence)
+{
+	if (static_branch_unlikely(&dma_fence_stats_enabled))
+		__dma_fence_stats_waited(fence);
+}
+#else
+
+static inline void dma_fence_stats_init(struct dma_fence *fence) {}
+static inline void dma_fence_stats_signaled(struct dma_fence *fence) {}
+static inline void dma_fence_stats_waited(struct dma_fence *fence) {}
+static inline void dma_fence_stats_init_debugfs(struct dentry *dir) {}
+#endif
+#endif /* _DMA_FENCE_STATS_H */
@@ -14,9 +14,14 @@
 #include <linux/export.h>
 #include <linux/atomic.h>
 #include <linux/dma-fence.h>
+#include <linux/irq_work.h>
+#include <linux/moduleparam.h>
+#include <linux/percpu.h>
 #include <linux/sched/signal.h>
 #include <linux/seq_file.h>
 
+#include "dma-fence-stats.h"
+
 #define CREATE_TRACE_POINTS
 #include <trace/events/dma_fence.h>
 
@@ -27,6 +32,21 @@ EXPORT_TRACEPOINT_SYMBOL(dma_fence_signaled);
 static DEFINE_SPINLOCK(dma_fence_stub_lock);
 static struct dma_fence dma_fence_stub;
 
+/*
+ * GPU bound clients sleep in dma_fence_wait() between frames, and the cpu
+ * frequency has usually dropped by the time the fence signals. Give those
+ * wakeups the same frequency boost as a wakeup from iowait.
+ */
+static bool wait_boost;
+module_param(wait_boost, bool, 0644);
+MODULE_PARM_DESC(wait_boost, "Boost the cpu frequency for tasks woken up by a signalled fence (default: false)");
+
+static void dma_fence_deferred_run(struct irq_work *irq_work);
+
+static DEFINE_PER_CPU(struct llist_head, dma_fence_deferred_list);
+static DEFINE_PER_CPU(struct irq_work, dma_fence_deferred_irq_work) =
+	IRQ_WORK_INIT(dma_fence_deferred_run);
+
 /*
  * fence context counter: each execution context should have its own
  * fence context, this allows checking if fences belong to the same
@@ -337,6 +357,36 @@ void __dma_fence_might_wait(void)
 #endif
 
 
+static void dma_fence_deferred_run(struct irq_work *irq_work)
+{
+	struct llist_node *list;
+	struct dma_fence_deferred *work, *tmp;
+
+	list = llist_del_all(this_cpu_ptr(&dma_fence_deferred_list));
+	list = llist_reverse_order(list);
+	llist_for_each_entry_safe(work, tmp, list, node)
+		work->func(work);
+}
+
+/**
+ * dma_fence_defer - run container fence processing after signalling
+ * @work: the work to run, with &dma_fence_deferred.func set
+ *
+ * Queue @work to the list of the current CPU. All work queued while a driver
+ * signals its fences is run by a single irq_work, instead of raising one
+ * irq_work for each container fence. May be called from any context,
+ * including fence callbacks and the work itself.
+ */
+void dma_fence_defer(struct dma_fence_deferred *work)
+{
+	struct llist_head *list = get_cpu_ptr(&dma_fence_deferred_list);
+
+	if (llist_add(&work->node, list))
+		irq_work_queue(this_cpu_ptr(&dma_fence_deferred_irq_work));
+	put_cpu_ptr(&dma_fence_deferred_list);
+}
+EXPORT_SYMBOL(dma_fence_defer);
+
 /**
  * dma_fence_signal_timestamp_locked - signal completion of a fence
  * @fence: the fence to signal
@@ -373,6 +423,7 @@ int dma_fence_signal_timestamp_locked(struct dma_fence *fence,
 	fence->timestamp = timestamp;
 	set_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &fence->flags);
 	trace_dma_fence_signaled(fence);
+	dma_fence_stats_signaled(fence);
 
 	list_for_each_entry_safe(cur, tmp, &cb_list, node) {
 		INIT_LIST_HEAD(&cur->node);
@@ -491,6 +542,7 @@ EXPORT_SYMBOL(dma_fence_signal);
 signed long
 dma_fence_wait_timeout(struct dma_fence *fence, bool intr, signed long timeout)
 {
+	bool was_signaled;
 	signed long ret;
 
 	if (WARN_ON(timeout < 0))
@@ -500,12 +552,18 @@ dma_fence_wait_timeout(struct dma_fence *fence, bool intr, signed long timeout)
 
 	__dma_fence_might_wait();
 
+	was_signaled = test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags);
+
 	trace_dma_fence_wait_start(fence);
 	if (fence->ops->wait)
 		ret = fence->ops->wait(fence, intr, timeout);
 	else
 		ret = dma_fence_default_wait(fence, intr, timeout);
 	trace_dma_fence_wait_end(fence);
+
+	/* only waits which really had to wait for the signal count */
+	if (ret > 0 && !was_signaled)
+		dma_fence_stats_waited(fence);
 	return ret;
 }
 EXPORT_SYMBOL(dma_fence_wait_timeout);
@@ -785,7 +843,9 @@ dma_fence_default_wait(struct dma_fence *fence, bool intr, signed long timeout)
 			__set_current_state(TASK_UNINTERRUPTIBLE);
 		spin_unlock_irqrestore(fence->lock, flags);
 
+		current->in_iowait_boost = READ_ONCE(wait_boost);
 		ret = schedule_timeout(ret);
+		current->in_iowait_boost = 0;
 
 		spin_lock_irqsave(fence->lock, flags);
 		if (ret > 0 && intr && signal_pending(current))
@@ -889,7 +949,9 @@ dma_fence_wait_any_timeout(struct dma_fence **fences, uint32_t count,
 		if (dma_fence_test_signaled_any(fences, count, idx))
 			break;
 
+		current->in_iowait_boost = READ_ONCE(wait_boost);
 		ret = schedule_timeout(ret);
+		current->in_iowait_boost = 0;
 
 		if (ret > 0 && intr && signal_pending(current))
 			ret = -ERESTARTSYS;
@@ -954,6 +1016,7 @@ dma_fence_init(struct dma_fence *fence, const struct dma_fence_ops *ops,
 	fence->seqno = seqno;
 	fence->flags = 0UL;
 	fence->error = 0;
+	dma_fence_stats_init(fence);
 
 	trace_dma_fence_init(fence);
 }
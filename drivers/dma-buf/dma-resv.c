@@ -96,6 +96,64 @@ static void dma_resv_list_free(struct dma_resv_list *list)
 	kfree_rcu(list, rcu);
 }
 
+/**
+ * dma_resv_list_compact - drop superseded fences from a shared fence list
+ * @obj: the reservation object
+ * @list: shared fence list of @obj
+ * @fence: fence about to be added, or NULL
+ *
+ * Move all signaled fences and the fences from the same context as @fence to
+ * the end of @list, keeping the order of the remaining fences. Must be called
+ * inside a write seqcount section of @obj. The caller is responsible for
+ * updating &dma_resv_list.shared_count and for dropping the references of
+ * the fences moved past the returned count.
+ *
+ * Returns the number of fences kept.
+ */
+static unsigned int dma_resv_list_compact(struct dma_resv *obj,
+					  struct dma_resv_list *list,
+					  struct dma_fence *fence)
+{
+	unsigned int i, j;
+
+	for (i = 0, j = 0; i < list->shared_count; ++i) {
+		struct dma_fence *f;
+
+		f = rcu_dereference_protected(list->shared[i],
+					      dma_resv_held(obj));
+		if ((fence && f->context == fence->context) ||
+		    dma_fence_is_signaled(f))
+			continue;
+
+		if (i != j) {
+			struct dma_fence *tmp;
+
+			tmp = rcu_dereference_protected(list->shared[j],
+							dma_resv_held(obj));
+			RCU_INIT_POINTER(list->shared[i], tmp);
+			RCU_INIT_POINTER(list->shared[j], f);
+		}
+		++j;
+	}
+
+	return j;
+}
+
+/**
+ * dma_resv_list_put - drop the references of fences removed from a list
+ * @obj: the reservation object
+ * @list: shared fence list of @obj
+ * @start: first removed fence
+ * @end: end of the removed fences
+ */
+static void dma_resv_list_put(struct dma_resv *obj, struct dma_resv_list *list,
+			      unsigned int start, unsigned int end)
+{
+	while (start < end)
+		dma_fence_put(rcu_dereference_protected(list->shared[start++],
+							dma_resv_held(obj)));
+}
+
 /**
  * dma_resv_init - initialize a reservation object
  * @obj: the reservation object
@@ -152,12 +210,23 @@ EXPORT_SYMBOL(dma_resv_fini);
 int dma_resv_reserve_shared(struct dma_resv *obj, unsigned int num_fences)
 {
 	struct dma_resv_list *old, *new;
-	unsigned int i, j, k, max;
+	unsigned int i, j, k, max, count, kept;
 
 	dma_resv_assert_held(obj);
 
 	old = dma_resv_shared_list(obj);
 	if (old && old->shared_max) {
+		if ((old->shared_count + num_fences) <= old->shared_max)
+			return 0;
+
+		/* Try to make room by dropping signaled fences before growing */
+		count = old->shared_count;
+		write_seqcount_begin(&obj->seq);
+		kept = dma_resv_list_compact(obj, old, NULL);
+		old->shared_count = kept;
+		write_seqcount_end(&obj->seq);
+		dma_resv_list_put(obj, old, kept, count);
+
 		if ((old->shared_count + num_fences) <= old->shared_max)
 			return 0;
 		max = max(old->shared_count + num_fences, old->shared_max * 2);
@@ -244,13 +313,17 @@ EXPORT_SYMBOL(dma_resv_reset_shared_max);
  * Add a fence to a shared slot, @obj must be locked with dma_resv_lock(), and
  * dma_resv_reserve_shared() has been called.
  *
+ * All signaled fences and the previous fences of the same context are removed
+ * from the shared slots while adding @fence, so that the list only contains
+ * the latest fence of each timeline which is still pending.
+ *
  * See also &dma_resv.fence for a discussion of the semantics.
  */
 void dma_resv_add_shared_fence(struct dma_resv *obj, struct dma_fence *fence)
 {
 	struct dma_resv_list *fobj;
-	struct dma_fence *old;
-	unsigned int i, count;
+	struct dma_fence *old = NULL;
+	unsigned int count, kept;
 
 	dma_fence_get(fence);
 
@@ -261,26 +334,20 @@ void dma_resv_add_shared_fence(struct dma_resv *obj, struct dma_fence *fence)
 
 	write_seqcount_begin(&obj->seq);
 
-	for (i = 0; i < count; ++i) {
-
-		old = rcu_dereference_protected(fobj->shared[i],
+	kept = dma_resv_list_compact(obj, fobj, fence);
+	if (kept < count)
+		old = rcu_dereference_protected(fobj->shared[kept],
 						dma_resv_held(obj));
-		if (old->context == fence->context ||
-		    dma_fence_is_signaled(old))
-			goto replace;
-	}
-
-	BUG_ON(fobj->shared_count >= fobj->shared_max);
-	old = NULL;
-	count++;
+	else
+		BUG_ON(kept >= fobj->shared_max);
 
-replace:
-	RCU_INIT_POINTER(fobj->shared[i], fence);
+	RCU_INIT_POINTER(fobj->shared[kept], fence);
 	/* pointer update must be visible before we extend the shared_count */
-	smp_store_mb(fobj->shared_count, count);
+	smp_store_mb(fobj->shared_count, kept + 1);
 
 	write_seqcount_end(&obj->seq);
 	dma_fence_put(old);
+	dma_resv_list_put(obj, fobj, kept + 1, count);
 }
 EXPORT_SYMBOL(dma_resv_add_shared_fence);
 
@@ -664,9 +731,14 @@ EXPORT_SYMBOL_GPL(dma_resv_test_signaled);
  */
 void dma_resv_describe(struct dma_resv *obj, struct seq_file *seq)
 {
+	struct dma_resv_list *fences = dma_resv_shared_list(obj);
 	struct dma_resv_iter cursor;
 	struct dma_fence *fence;
 
+	if (fences)
+		seq_printf(seq, "\tShared slots: %u used, %u allocated\n",
+			   fences->shared_count, fences->shared_max);
+
 	dma_resv_for_each_fence(&cursor, obj, true, fence) {
 		seq_printf(seq, "\t%s fence:",
 			   dma_resv_iter_is_exclusive(&cursor) ?
@@ -18,19 +18,32 @@
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
+#include <linux/sysfs.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#include "../dma-buf-sysfs-stats.h"
 
 static struct dma_heap *sys_heap;
+static struct dma_heap *sys_uncached_heap;
+
+static unsigned int pool_limit_mb = 64;
+module_param(pool_limit_mb, uint, 0644);
+MODULE_PARM_DESC(pool_limit_mb, "Maximum size of the page pool in MiB");
 
 struct system_heap_buffer {
 	struct dma_heap *heap;
+	struct list_head free_list;
 	struct list_head attachments;
 	struct mutex lock;
 	unsigned long len;
 	struct sg_table sg_table;
 	int vmap_cnt;
 	void *vaddr;
+
+	bool uncached;
 };
 
 struct dma_heap_attachment {
@@ -38,6 +51,11 @@ struct dma_heap_attachment {
 	struct sg_table *table;
 	struct list_head list;
 	bool mapped;
+
+	/* CPU caches were already invalidated since the last device access */
+	bool cpu_synced;
+
+	bool uncached;
 };
 
 #define LOW_ORDER_GFP (GFP_HIGHUSER | __GFP_ZERO | __GFP_COMP)
@@ -55,6 +73,178 @@ static gfp_t order_flags[] = {HIGH_ORDER_GFP, MID_ORDER_GFP, LOW_ORDER_GFP};
 static const unsigned int orders[] = {8, 4, 0};
 #define NUM_ORDERS ARRAY_SIZE(orders)
 
+/*
+ * Freed buffers are handed to a worker which zeroes their pages and keeps them
+ * in a pool per order, so that allocations can skip the buddy allocator. The
+ * pools are limited by pool_limit_mb and drained by a shrinker.
+ */
+struct system_heap_pool {
+	spinlock_t lock;
+	struct list_head pages;
+	atomic_long_t hits;
+	atomic_long_t misses;
+};
+
+static struct system_heap_pool pools[NUM_ORDERS];
+static atomic_long_t pool_pages;
+static struct shrinker pool_shrinker;
+
+static DEFINE_SPINLOCK(free_lock);
+static LIST_HEAD(free_buffers);
+static void system_heap_free_work(struct work_struct *work);
+static DECLARE_WORK(free_work, system_heap_free_work);
+
+static struct page *pool_get(unsigned int i)
+{
+	struct system_heap_pool *pool = &pools[i];
+	struct page *page;
+
+	spin_lock(&pool->lock);
+	page = list_first_entry_or_null(&pool->pages, struct page, lru);
+	if (page) {
+		list_del(&page->lru);
+		atomic_long_sub(1 << orders[i], &pool_pages);
+	}
+	spin_unlock(&pool->lock);
+
+	if (page)
+		atomic_long_inc(&pool->hits);
+	else
+		atomic_long_inc(&pool->misses);
+	return page;
+}
+
+static void pool_put(struct page *page)
+{
+	unsigned int order = compound_order(page);
+	unsigned long limit = (unsigned long)pool_limit_mb << (20 - PAGE_SHIFT);
+	struct system_heap_pool *pool;
+	unsigned int i, j;
+
+	for (i = 0; i < NUM_ORDERS; i++)
+		if (orders[i] == order)
+			break;
+
+	if (i == NUM_ORDERS ||
+	    atomic_long_read(&pool_pages) + (1 << order) > limit) {
+		__free_pages(page, order);
+		return;
+	}
+
+	for (j = 0; j < (1 << order); j++)
+		clear_highpage(page + j);
+
+	pool = &pools[i];
+	spin_lock(&pool->lock);
+	list_add(&page->lru, &pool->pages);
+	atomic_long_add(1 << order, &pool_pages);
+	spin_unlock(&pool->lock);
+}
+
+static void system_heap_free_work(struct work_struct *work)
+{
+	struct system_heap_buffer *buffer, *tmp;
+	struct scatterlist *sg;
+	LIST_HEAD(list);
+	int i;
+
+	spin_lock(&free_lock);
+	list_splice_init(&free_buffers, &list);
+	spin_unlock(&free_lock);
+
+	list_for_each_entry_safe(buffer, tmp, &list, free_list) {
+		for_each_sgtable_sg(&buffer->sg_table, sg, i)
+			pool_put(sg_page(sg));
+		sg_free_table(&buffer->sg_table);
+		kfree(buffer);
+		cond_resched();
+	}
+}
+
+static unsigned long pool_shrinker_scan(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	unsigned long num_freed = 0;
+	struct system_heap_pool *pool;
+	struct page *page;
+	unsigned int i;
+
+	/* free the smallest pages first, high orders are the hardest to get */
+	for (i = NUM_ORDERS; i-- && num_freed < sc->nr_to_scan; ) {
+		pool = &pools[i];
+		while (num_freed < sc->nr_to_scan) {
+			spin_lock(&pool->lock);
+			page = list_first_entry_or_null(&pool->pages,
+							struct page, lru);
+			if (page) {
+				list_del(&page->lru);
+				atomic_long_sub(1 << orders[i], &pool_pages);
+			}
+			spin_unlock(&pool->lock);
+			if (!page)
+				break;
+
+			__free_pages(page, orders[i]);
+			num_freed += 1 << orders[i];
+		}
+	}
+
+	return num_freed ? num_freed : SHRINK_STOP;
+}
+
+/* Return the number of pages in the pools or SHRINK_EMPTY if we have none */
+static unsigned long pool_shrinker_count(struct shrinker *shrink,
+					 struct shrink_control *sc)
+{
+	unsigned long num_pages = atomic_long_read(&pool_pages);
+
+	return num_pages ? num_pages : SHRINK_EMPTY;
+}
+
+static ssize_t pool_pages_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%ld\n", atomic_long_read(&pool_pages));
+}
+
+static ssize_t pool_hits_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	long hits = 0;
+	unsigned int i;
+
+	for (i = 0; i < NUM_ORDERS; i++)
+		hits += atomic_long_read(&pools[i].hits);
+	return sysfs_emit(buf, "%ld\n", hits);
+}
+
+static ssize_t pool_misses_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	long misses = 0;
+	unsigned int i;
+
+	for (i = 0; i < NUM_ORDERS; i++)
+		misses += atomic_long_read(&pools[i].misses);
+	return sysfs_emit(buf, "%ld\n", misses);
+}
+
+static struct kobj_attribute pool_pages_attribute = __ATTR_RO(pool_pages);
+static struct kobj_attribute pool_hits_attribute = __ATTR_RO(pool_hits);
+static struct kobj_attribute pool_misses_attribute = __ATTR_RO(pool_misses);
+
+static struct attribute *pool_attrs[] = {
+	&pool_pages_attribute.attr,
+	&pool_hits_attribute.attr,
+	&pool_misses_attribute.attr,
+	NULL,
+};
+
+static const struct attribute_group pool_attr_group = {
+	.name = "system_heap",
+	.attrs = pool_attrs,
+};
+
 static struct sg_table *dup_sg_table(struct sg_table *table)
 {
 	struct sg_table *new_table;
@@ -101,6 +291,8 @@ static int system_heap_attach(struct dma_buf *dmabuf,
 	a->dev = attachment->dev;
 	INIT_LIST_HEAD(&a->list);
 	a->mapped = false;
+	a->cpu_synced = false;
+	a->uncached = buffer->uncached;
 
 	attachment->priv = a;
 
@@ -131,13 +323,18 @@ static struct sg_table *system_heap_map_dma_buf(struct dma_buf_attachment *attac
 {
 	struct dma_heap_attachment *a = attachment->priv;
 	struct sg_table *table = a->table;
+	unsigned long attrs = 0;
 	int ret;
 
-	ret = dma_map_sgtable(attachment->dev, table, direction, 0);
+	if (a->uncached)
+		attrs = DMA_ATTR_SKIP_CPU_SYNC;
+
+	ret = dma_map_sgtable(attachment->dev, table, direction, attrs);
 	if (ret)
 		return ERR_PTR(ret);
 
 	a->mapped = true;
+	a->cpu_synced = false;
 	return table;
 }
 
@@ -146,9 +343,13 @@ static void system_heap_unmap_dma_buf(struct dma_buf_attachment *attachment,
 				      enum dma_data_direction direction)
 {
 	struct dma_heap_attachment *a = attachment->priv;
+	unsigned long attrs = 0;
+
+	if (a->uncached)
+		attrs = DMA_ATTR_SKIP_CPU_SYNC;
 
 	a->mapped = false;
-	dma_unmap_sgtable(attachment->dev, table, direction, 0);
+	dma_unmap_sgtable(attachment->dev, table, direction, attrs);
 }
 
 static int system_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
@@ -157,15 +358,22 @@ static int system_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct dma_heap_attachment *a;
 
+	/* uncached buffers never need any cache maintenance */
+	if (buffer->uncached)
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
 		invalidate_kernel_vmap_range(buffer->vaddr, buffer->len);
 
 	list_for_each_entry(a, &buffer->attachments, list) {
-		if (!a->mapped)
+		if (!a->mapped || a->cpu_synced)
 			continue;
 		dma_sync_sgtable_for_cpu(a->dev, a->table, direction);
+		/* only an invalidate makes following CPU reads safe */
+		if (direction != DMA_TO_DEVICE)
+			a->cpu_synced = true;
 	}
 	mutex_unlock(&buffer->lock);
 
@@ -178,6 +386,9 @@ static int system_heap_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct dma_heap_attachment *a;
 
+	if (buffer->uncached)
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -187,6 +398,7 @@ static int system_heap_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 		if (!a->mapped)
 			continue;
 		dma_sync_sgtable_for_device(a->dev, a->table, direction);
+		a->cpu_synced = false;
 	}
 	mutex_unlock(&buffer->lock);
 
@@ -201,6 +413,9 @@ static int system_heap_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
 	struct sg_page_iter piter;
 	int ret;
 
+	if (buffer->uncached)
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
 	for_each_sgtable_page(table, &piter, vma->vm_pgoff) {
 		struct page *page = sg_page_iter_page(&piter);
 
@@ -222,6 +437,7 @@ static void *system_heap_do_vmap(struct system_heap_buffer *buffer)
 	struct page **pages = vmalloc(sizeof(struct page *) * npages);
 	struct page **tmp = pages;
 	struct sg_page_iter piter;
+	pgprot_t pgprot = PAGE_KERNEL;
 	void *vaddr;
 
 	if (!pages)
@@ -232,7 +448,10 @@ static void *system_heap_do_vmap(struct system_heap_buffer *buffer)
 		*tmp++ = sg_page_iter_page(&piter);
 	}
 
-	vaddr = vmap(pages, npages, VM_MAP, PAGE_KERNEL);
+	if (buffer->uncached)
+		pgprot = pgprot_writecombine(PAGE_KERNEL);
+
+	vaddr = vmap(pages, npages, VM_MAP, pgprot);
 	vfree(pages);
 
 	if (!vaddr)
@@ -285,18 +504,12 @@ static void system_heap_vunmap(struct dma_buf *dmabuf, struct dma_buf_map *map)
 static void system_heap_dma_buf_release(struct dma_buf *dmabuf)
 {
 	struct system_heap_buffer *buffer = dmabuf->priv;
-	struct sg_table *table;
-	struct scatterlist *sg;
-	int i;
-
-	table = &buffer->sg_table;
-	for_each_sgtable_sg(table, sg, i) {
-		struct page *page = sg_page(sg);
 
-		__free_pages(page, compound_order(page));
-	}
-	sg_free_table(table);
-	kfree(buffer);
+	/* zeroing the pages for the pool is left to the worker */
+	spin_lock(&free_lock);
+	list_add_tail(&buffer->free_list, &free_buffers);
+	spin_unlock(&free_lock);
+	schedule_work(&free_work);
 }
 
 static const struct dma_buf_ops system_heap_buf_ops = {
@@ -324,6 +537,10 @@ static struct page *alloc_largest_available(unsigned long size,
 		if (max_order < orders[i])
 			continue;
 
+		page = pool_get(i);
+		if (page)
+			return page;
+
 		page = alloc_pages(order_flags[i], orders[i]);
 		if (!page)
 			continue;
@@ -332,10 +549,11 @@ static struct page *alloc_largest_available(unsigned long size,
 	return NULL;
 }
 
-static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
-					    unsigned long len,
-					    unsigned long fd_flags,
-					    unsigned long heap_flags)
+static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
+					       unsigned long len,
+					       unsigned long fd_flags,
+					       unsigned long heap_flags,
+					       bool uncached)
 {
 	struct system_heap_buffer *buffer;
 	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
@@ -356,6 +574,7 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	mutex_init(&buffer->lock);
 	buffer->heap = heap;
 	buffer->len = len;
+	buffer->uncached = uncached;
 
 	INIT_LIST_HEAD(&pages);
 	i = 0;
@@ -390,6 +609,19 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 		list_del(&page->lru);
 	}
 
+	/*
+	 * For uncached buffers, write back the zeroed pages once so that the
+	 * CPU caches can be skipped from now on.
+	 */
+	if (uncached) {
+		struct device *dev = dma_heap_get_dev(heap);
+
+		ret = dma_map_sgtable(dev, table, DMA_BIDIRECTIONAL, 0);
+		if (ret)
+			goto free_pages;
+		dma_unmap_sgtable(dev, table, DMA_BIDIRECTIONAL, 0);
+	}
+
 	/* create the dmabuf */
 	exp_info.exp_name = dma_heap_get_name(heap);
 	exp_info.ops = &system_heap_buf_ops;
@@ -418,21 +650,73 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	return ERR_PTR(ret);
 }
 
+static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
+					    unsigned long len,
+					    unsigned long fd_flags,
+					    unsigned long heap_flags)
+{
+	return system_heap_do_allocate(heap, len, fd_flags, heap_flags, false);
+}
+
 static const struct dma_heap_ops system_heap_ops = {
 	.allocate = system_heap_allocate,
 };
 
+static struct dma_buf *system_uncached_heap_allocate(struct dma_heap *heap,
+						     unsigned long len,
+						     unsigned long fd_flags,
+						     unsigned long heap_flags)
+{
+	return system_heap_do_allocate(heap, len, fd_flags, heap_flags, true);
+}
+
+static const struct dma_heap_ops system_uncached_heap_ops = {
+	.allocate = system_uncached_heap_allocate,
+};
+
 static int system_heap_create(void)
 {
 	struct dma_heap_export_info exp_info;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		spin_lock_init(&pools[i].lock);
+		INIT_LIST_HEAD(&pools[i].pages);
+	}
+
+	pool_shrinker.count_objects = pool_shrinker_count;
+	pool_shrinker.scan_objects = pool_shrinker_scan;
+	pool_shrinker.seeks = 1;
+	ret = register_shrinker(&pool_shrinker);
+	if (ret)
+		return ret;
+
+	ret = dma_buf_stats_add_group(&pool_attr_group);
+	if (ret)
+		pr_warn("system_heap: failed to add pool statistics (%d)\n",
+			ret);
 
 	exp_info.name = "system";
 	exp_info.ops = &system_heap_ops;
 	exp_info.priv = NULL;
 
 	sys_heap = dma_heap_add(&exp_info);
-	if (IS_ERR(sys_heap))
+	if (IS_ERR(sys_heap)) {
+		unregister_shrinker(&pool_shrinker);
 		return PTR_ERR(sys_heap);
+	}
+
+	exp_info.name = "system-uncached";
+	exp_info.ops = &system_uncached_heap_ops;
+	exp_info.priv = NULL;
+
+	sys_uncached_heap = dma_heap_add(&exp_info);
+	if (IS_ERR(sys_uncached_heap))
+		return PTR_ERR(sys_uncached_heap);
+
+	dma_coerce_mask_and_coherent(dma_heap_get_dev(sys_uncached_heap),
+				     DMA_BIT_MASK(64));
 
 	return 0;
 }
@@ -13,3 +13,4 @@ selftest(sanitycheck, __sanitycheck__) /* keep first (igt selfcheck) */
 selftest(dma_fence, dma_fence)
 selftest(dma_fence_chain, dma_fence_chain)
 selftest(dma_resv, dma_resv)
+selftest(dma_perf, dma_perf)
@@ -0,0 +1,458 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Micro-benchmarks for the dma-fence and dma-resv core.
+ *
+ * Skipped unless the perf_ms module parameter is set, each benchmark then runs
+ * for that many milliseconds, single threaded and with one thread per CPU, and
+ * reports its throughput and latency percentiles.
+ */
+
+#include <linux/dma-fence.h>
+#include <linux/dma-fence-chain.h>
+#include <linux/dma-resv.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+
+#include "selftest.h"
+
+static unsigned int perf_ms;
+module_param(perf_ms, uint, 0400);
+MODULE_PARM_DESC(perf_ms, "Run each dma-buf benchmark for this many milliseconds, 0 skips them");
+
+#define PERF_SAMPLES 1024
+#define PERF_CHAIN_SZ (4 << 10)
+
+struct perf_result {
+	u64 ops;
+	u64 elapsed_ns;
+	u32 samples[PERF_SAMPLES];
+};
+
+struct perf_thread {
+	int (*func)(void *data, struct perf_result *res, ktime_t end);
+	void *data;
+	struct perf_result *res;
+	ktime_t end;
+};
+
+struct perf_fence {
+	struct dma_fence base;
+	spinlock_t lock;
+};
+
+static const char *perf_name(struct dma_fence *f)
+{
+	return "perf";
+}
+
+static const struct dma_fence_ops perf_ops = {
+	.get_driver_name = perf_name,
+	.get_timeline_name = perf_name,
+};
+
+static struct dma_fence *perf_fence(u64 context, u64 seqno)
+{
+	struct perf_fence *f;
+
+	f = kmalloc(sizeof(*f), GFP_KERNEL);
+	if (!f)
+		return NULL;
+
+	spin_lock_init(&f->lock);
+	dma_fence_init(&f->base, &perf_ops, &f->lock, context, seqno);
+
+	return &f->base;
+}
+
+static void perf_sample(struct perf_result *res, ktime_t start)
+{
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	res->samples[res->ops++ % PERF_SAMPLES] = min_t(s64, ns, U32_MAX);
+}
+
+static int perf_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int perf_report(const char *name, struct perf_result **res,
+		       unsigned int count)
+{
+	u64 ops = 0, elapsed = 1;
+	unsigned int i, n = 0;
+	u32 *samples;
+
+	samples = kvmalloc_array(count, sizeof(res[0]->samples), GFP_KERNEL);
+	if (!samples)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		unsigned int c = min_t(u64, res[i]->ops, PERF_SAMPLES);
+
+		memcpy(samples + n, res[i]->samples, c * sizeof(*samples));
+		n += c;
+		ops += res[i]->ops;
+		elapsed = max(elapsed, res[i]->elapsed_ns);
+	}
+
+	if (n) {
+		sort(samples, n, sizeof(*samples), perf_cmp, NULL);
+		pr_info("dma-buf perf: %s x%u: %llu ops/s, p50 %uns, p90 %uns, p99 %uns, max %uns\n",
+			name, count, div64_u64(ops * NSEC_PER_SEC, elapsed),
+			samples[n / 2], samples[n * 9 / 10],
+			samples[n * 99 / 100], samples[n - 1]);
+	}
+
+	kvfree(samples);
+	return 0;
+}
+
+static int perf_thread(void *arg)
+{
+	struct perf_thread *t = arg;
+	ktime_t start = ktime_get();
+	int err;
+
+	err = t->func(t->data, t->res, t->end);
+	t->res->elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	return err;
+}
+
+static int perf_run(const char *name,
+		    int (*func)(void *data, struct perf_result *res,
+				ktime_t end),
+		    void *data, unsigned int count)
+{
+	struct task_struct **threads;
+	struct perf_result **res;
+	struct perf_thread *t;
+	unsigned int i;
+	int err = 0;
+
+	t = kcalloc(count, sizeof(*t), GFP_KERNEL);
+	threads = kcalloc(count, sizeof(*threads), GFP_KERNEL);
+	res = kcalloc(count, sizeof(*res), GFP_KERNEL);
+	if (!t || !threads || !res) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < count; i++) {
+		res[i] = kzalloc(sizeof(*res[i]), GFP_KERNEL);
+		if (!res[i]) {
+			err = -ENOMEM;
+			goto out;
+		}
+
+		t[i].func = func;
+		t[i].data = data;
+		t[i].res = res[i];
+		t[i].end = ktime_add_ms(ktime_get(), perf_ms);
+	}
+
+	if (count == 1) {
+		err = perf_thread(&t[0]);
+		goto report;
+	}
+
+	for (i = 0; i < count; i++) {
+		threads[i] = kthread_run(perf_thread, &t[i], "dmabuf/perf:%u", i);
+		if (IS_ERR(threads[i])) {
+			err = PTR_ERR(threads[i]);
+			count = i;
+			break;
+		}
+		get_task_struct(threads[i]);
+	}
+
+	for (i = 0; i < count; i++) {
+		int ret = kthread_stop(threads[i]);
+
+		if (ret && !err)
+			err = ret;
+		put_task_struct(threads[i]);
+	}
+
+report:
+	if (!err)
+		err = perf_report(name, res, count);
+out:
+	if (res)
+		for (i = 0; i < count; i++)
+			kfree(res[i]);
+	kfree(res);
+	kfree(threads);
+	kfree(t);
+	return err;
+}
+
+static int perf_run_all(const char *name,
+			int (*func)(void *data, struct perf_result *res,
+				    ktime_t end),
+			void *data)
+{
+	int err;
+
+	err = perf_run(name, func, data, 1);
+	if (err)
+		return err;
+
+	return perf_run(name, func, data, num_online_cpus());
+}
+
+static int __fence_signal(void *arg, struct perf_result *res, ktime_t end)
+{
+	u64 context = dma_fence_context_alloc(1);
+
+	while (ktime_before(ktime_get(), end)) {
+		ktime_t start = ktime_get();
+		struct dma_fence *f;
+
+		f = perf_fence(context, res->ops);
+		if (!f)
+			return -ENOMEM;
+
+		dma_fence_signal(f);
+		dma_fence_put(f);
+		perf_sample(res, start);
+
+		cond_resched();
+		if (signal_pending(current))
+			return -EINTR;
+	}
+
+	return 0;
+}
+
+static int fence_signal(void *arg)
+{
+	return perf_run_all("fence create+signal", __fence_signal, NULL);
+}
+
+struct fence_wait {
+	struct dma_fence *slot;
+};
+
+static int __fence_wait_signaler(void *arg)
+{
+	struct fence_wait *data = arg;
+	struct dma_fence *f;
+
+	while (!kthread_should_stop()) {
+		f = xchg(&data->slot, NULL);
+		if (f) {
+			dma_fence_signal(f);
+			dma_fence_put(f);
+		}
+		cond_resched();
+	}
+
+	return 0;
+}
+
+static int fence_wait(void *arg)
+{
+	struct fence_wait data = {};
+	struct perf_result *res;
+	struct task_struct *tsk;
+	u64 context = dma_fence_context_alloc(1);
+	ktime_t start, end;
+	int err = 0;
+
+	res = kzalloc(sizeof(*res), GFP_KERNEL);
+	if (!res)
+		return -ENOMEM;
+
+	tsk = kthread_run(__fence_wait_signaler, &data, "dmabuf/perf:signal");
+	if (IS_ERR(tsk)) {
+		kfree(res);
+		return PTR_ERR(tsk);
+	}
+	get_task_struct(tsk);
+
+	start = ktime_get();
+	end = ktime_add_ms(start, perf_ms);
+	while (ktime_before(ktime_get(), end)) {
+		struct dma_fence *f;
+		long ret;
+
+		f = perf_fence(context, res->ops);
+		if (!f) {
+			err = -ENOMEM;
+			break;
+		}
+
+		xchg(&data.slot, dma_fence_get(f));
+		ret = dma_fence_wait_timeout(f, false, HZ);
+		if (ret <= 0) {
+			pr_err("Timed out waiting for the signaler\n");
+			dma_fence_put(f);
+			err = -ETIME;
+			break;
+		}
+
+		/* the wakeup latency, from signalling until we run again */
+		perf_sample(res, f->timestamp);
+		dma_fence_put(f);
+	}
+	res->elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	kthread_stop(tsk);
+	put_task_struct(tsk);
+	dma_fence_put(xchg(&data.slot, NULL));
+
+	if (!err)
+		err = perf_report("fence signal->wakeup", &res, 1);
+	kfree(res);
+	return err;
+}
+
+static int __resv_add_iterate(void *arg, struct perf_result *res, ktime_t end)
+{
+	u64 context = dma_fence_context_alloc(1);
+	struct dma_resv *resv = arg;
+
+	while (ktime_before(ktime_get(), end)) {
+		ktime_t start = ktime_get();
+		struct dma_resv_iter cursor;
+		struct dma_fence *f, *fence;
+		int r;
+
+		f = perf_fence(context, res->ops);
+		if (!f)
+			return -ENOMEM;
+
+		r = dma_resv_lock(resv, NULL);
+		if (!r)
+			r = dma_resv_reserve_shared(resv, 1);
+		if (r) {
+			dma_resv_unlock(resv);
+			dma_fence_put(f);
+			return r;
+		}
+		dma_resv_add_shared_fence(resv, f);
+		dma_resv_unlock(resv);
+
+		dma_resv_iter_begin(&cursor, resv, true);
+		dma_resv_for_each_fence_unlocked(&cursor, fence)
+			;
+		dma_resv_iter_end(&cursor);
+
+		dma_fence_signal(f);
+		dma_fence_put(f);
+		perf_sample(res, start);
+
+		cond_resched();
+		if (signal_pending(current))
+			return -EINTR;
+	}
+
+	return 0;
+}
+
+static int resv_add_iterate(void *arg)
+{
+	struct dma_resv resv;
+	int err;
+
+	dma_resv_init(&resv);
+	err = perf_run_all("resv add+iterate", __resv_add_iterate, &resv);
+	dma_resv_fini(&resv);
+
+	return err;
+}
+
+struct chain_find {
+	struct dma_fence *tail;
+	unsigned int length;
+};
+
+static int __chain_find(void *arg, struct perf_result *res, ktime_t end)
+{
+	struct chain_find *data = arg;
+
+	while (ktime_before(ktime_get(), end)) {
+		ktime_t start = ktime_get();
+		struct dma_fence *fence = dma_fence_get(data->tail);
+		int err;
+
+		err = dma_fence_chain_find_seqno(&fence,
+						 prandom_u32_max(data->length) + 1);
+		dma_fence_put(fence);
+		if (err)
+			return err;
+		perf_sample(res, start);
+
+		cond_resched();
+		if (signal_pending(current))
+			return -EINTR;
+	}
+
+	return 0;
+}
+
+static int chain_find(void *arg)
+{
+	struct chain_find data = { .length = PERF_CHAIN_SZ };
+	u64 context = dma_fence_context_alloc(1);
+	struct dma_fence **fences;
+	unsigned int i;
+	int err = 0;
+
+	fences = kvcalloc(PERF_CHAIN_SZ, sizeof(*fences), GFP_KERNEL);
+	if (!fences)
+		return -ENOMEM;
+
+	for (i = 0; i < PERF_CHAIN_SZ; i++) {
+		struct dma_fence_chain *chain;
+
+		fences[i] = perf_fence(context, i);
+		chain = dma_fence_chain_alloc();
+		if (!fences[i] || !chain) {
+			dma_fence_chain_free(chain);
+			err = -ENOMEM;
+			goto out;
+		}
+
+		dma_fence_chain_init(chain, data.tail, dma_fence_get(fences[i]),
+				     i + 1);
+		data.tail = &chain->base;
+	}
+
+	err = perf_run_all("chain find_seqno", __chain_find, &data);
+
+out:
+	dma_fence_put(data.tail);
+	for (i = 0; i < PERF_CHAIN_SZ && fences[i]; i++) {
+		dma_fence_signal(fences[i]);
+		dma_fence_put(fences[i]);
+	}
+	kvfree(fences);
+	return err;
+}
+
+int dma_perf(void)
+{
+	static const struct subtest tests[] = {
+		SUBTEST(fence_signal),
+		SUBTEST(fence_wait),
+		SUBTEST(resv_add_iterate),
+		SUBTEST(chain_find),
+	};
+
+	if (!perf_ms)
+		return 0;
+
+	return subtests(tests, NULL);
+}
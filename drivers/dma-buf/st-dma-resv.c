@@ -336,6 +336,71 @@ static int test_shared_get_fences(void *arg)
 	return test_get_fences(arg, true);
 }
 
+static int test_shared_compaction(void *arg)
+{
+	struct dma_fence *signaled, *old, *new;
+	struct dma_resv_list *list;
+	struct dma_resv resv;
+	u64 context;
+	int r;
+
+	context = dma_fence_context_alloc(2);
+
+	signaled = alloc_fence();
+	old = alloc_fence();
+	new = alloc_fence();
+	if (!signaled || !old || !new) {
+		r = -ENOMEM;
+		goto err_put;
+	}
+	signaled->context = context;
+	old->context = context + 1;
+	new->context = context + 1;
+	new->seqno = 1;
+
+	dma_resv_init(&resv);
+	r = dma_resv_lock(&resv, NULL);
+	if (r) {
+		pr_err("Resv locking failed\n");
+		goto err_fini;
+	}
+
+	r = dma_resv_reserve_shared(&resv, 3);
+	if (r) {
+		pr_err("Resv shared slot allocation failed\n");
+		goto err_unlock;
+	}
+
+	dma_resv_add_shared_fence(&resv, signaled);
+	dma_resv_add_shared_fence(&resv, old);
+	dma_fence_signal(signaled);
+
+	/* Must drop both the signaled fence and the one it replaces */
+	dma_resv_add_shared_fence(&resv, new);
+
+	list = dma_resv_shared_list(&resv);
+	if (list->shared_count != 1 ||
+	    rcu_dereference_protected(list->shared[0], true) != new) {
+		pr_err("Shared fences not compacted, %u left\n",
+		       list->shared_count);
+		r = -EINVAL;
+	}
+
+err_unlock:
+	dma_resv_unlock(&resv);
+err_fini:
+	dma_resv_fini(&resv);
+err_put:
+	if (old)
+		dma_fence_signal(old);
+	if (new)
+		dma_fence_signal(new);
+	dma_fence_put(signaled);
+	dma_fence_put(old);
+	dma_fence_put(new);
+	return r;
+}
+
 int dma_resv(void)
 {
 	static const struct subtest tests[] = {
@@ -348,6 +413,7 @@ int dma_resv(void)
 		SUBTEST(test_shared_for_each_unlocked),
 		SUBTEST(test_excl_get_fences),
 		SUBTEST(test_shared_get_fences),
+		SUBTEST(test_shared_compaction),
 	};
 
 	spin_lock_init(&fence_lock);
@@ -12,8 +12,10 @@
 #include <linux/poll.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/uaccess.h>
 #include <linux/anon_inodes.h>
+#include <linux/dma-fence-chain.h>
 #include <linux/sync_file.h>
 #include <uapi/linux/sync_file.h>
 
@@ -115,6 +117,25 @@ struct dma_fence *sync_file_get_fence(int fd)
 }
 EXPORT_SYMBOL(sync_file_get_fence);
 
+/**
+ * sync_file_file_get_fence - get the fence related to a sync_file file
+ * @file:	file to get the fence from
+ *
+ * Like sync_file_get_fence(), but for callers which already hold a reference
+ * to the file. Returns NULL if @file isn't a sync_file.
+ */
+struct dma_fence *sync_file_file_get_fence(struct file *file)
+{
+	struct sync_file *sync_file;
+
+	if (file->f_op != &sync_file_fops)
+		return NULL;
+
+	sync_file = file->private_data;
+	return dma_fence_get(sync_file->fence);
+}
+EXPORT_SYMBOL(sync_file_file_get_fence);
+
 /**
  * sync_file_get_name - get the name of the sync_file
  * @sync_file:		sync_file to get the fence from
@@ -151,24 +172,17 @@ static int sync_file_set_fence(struct sync_file *sync_file,
 	struct dma_fence_array *array;
 
 	/*
-	 * The reference for the fences in the new sync_file and held
-	 * in add_fence() during the merge procedure, so for num_fences == 1
-	 * we already own a new reference to the fence. For num_fence > 1
-	 * we own the reference of the dma_fence_array creation.
+	 * The reference for the fences in the new sync_file are held
+	 * in add_fence() during the merge procedure, we own the reference
+	 * of the dma_fence_array creation.
 	 */
-	if (num_fences == 1) {
-		sync_file->fence = fences[0];
-		kfree(fences);
-	} else {
-		array = dma_fence_array_create(num_fences, fences,
-					       dma_fence_context_alloc(1),
-					       1, false);
-		if (!array)
-			return -ENOMEM;
-
-		sync_file->fence = &array->base;
-	}
+	array = dma_fence_array_create(num_fences, fences,
+				       dma_fence_context_alloc(1),
+				       1, false);
+	if (!array)
+		return -ENOMEM;
 
+	sync_file->fence = &array->base;
 	return 0;
 }
 
@@ -186,15 +200,73 @@ static struct dma_fence **get_fences(struct sync_file *sync_file,
 	return &sync_file->fence;
 }
 
-static void add_fence(struct dma_fence **fences,
-		      int *i, struct dma_fence *fence)
+/* merges of up to this many fences are collected on the stack */
+#define SYNC_FILE_MERGE_INLINE	4
+
+static void add_fence(struct dma_fence **fences, int *i, int max,
+		      struct dma_fence *fence)
+{
+	if (dma_fence_is_signaled(fence))
+		return;
+
+	if (*i < max)
+		fences[*i] = dma_fence_get(fence);
+	(*i)++;
+}
+
+static void add_fence_array(struct dma_fence **fences, int *i, int max,
+			    struct dma_fence *fence)
+{
+	struct dma_fence_array *array = to_dma_fence_array(fence);
+	unsigned int j;
+
+	if (!array) {
+		add_fence(fences, i, max, fence);
+		return;
+	}
+
+	for (j = 0; j < array->num_fences; ++j)
+		add_fence(fences, i, max, array->fences[j]);
+}
+
+/*
+ * Add the unsignaled fences contained in @fence to @fences, looking through
+ * fence chains and fence arrays so that merging never nests containers. Only
+ * counts the fences once @max is reached.
+ */
+static void add_fences(struct dma_fence **fences, int *i, int max,
+		       struct dma_fence *fence)
 {
-	fences[*i] = fence;
+	struct dma_fence *iter;
 
-	if (!dma_fence_is_signaled(fence)) {
-		dma_fence_get(fence);
-		(*i)++;
+	if (!to_dma_fence_chain(fence)) {
+		add_fence_array(fences, i, max, fence);
+		return;
 	}
+
+	dma_fence_chain_for_each(iter, fence) {
+		struct dma_fence_chain *chain = to_dma_fence_chain(iter);
+
+		add_fence_array(fences, i, max, chain ? chain->fence : iter);
+	}
+}
+
+static int fence_cmp(const void *a, const void *b)
+{
+	const struct dma_fence *fa = *(const struct dma_fence **)a;
+	const struct dma_fence *fb = *(const struct dma_fence **)b;
+
+	if (fa->context < fb->context)
+		return -1;
+	if (fa->context > fb->context)
+		return 1;
+
+	/* put the latest fence of a context first */
+	if (__dma_fence_is_later(fa->seqno, fb->seqno, fa->ops))
+		return -1;
+	if (__dma_fence_is_later(fb->seqno, fa->seqno, fa->ops))
+		return 1;
+	return 0;
 }
 
 /**
@@ -206,90 +278,84 @@ static void add_fence(struct dma_fence **fences,
  * Creates a new sync_file which contains copies of all the fences in both
  * @a and @b.  @a and @b remain valid, independent sync_file. Returns the
  * new merged sync_file or NULL in case of error.
+ *
+ * Fence arrays and chains are flattened, only the latest fence of each
+ * context is kept and already signaled fences are dropped.
  */
 static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
 					 struct sync_file *b)
 {
+	struct dma_fence *inline_fences[SYNC_FILE_MERGE_INLINE];
+	struct dma_fence **fences = inline_fences, **nfences;
+	int i, j, num_fences, max = SYNC_FILE_MERGE_INLINE;
 	struct sync_file *sync_file;
-	struct dma_fence **fences = NULL, **nfences, **a_fences, **b_fences;
-	int i = 0, i_a, i_b, num_fences, a_num_fences, b_num_fences;
 
 	sync_file = sync_file_alloc();
 	if (!sync_file)
 		return NULL;
 
-	a_fences = get_fences(a, &a_num_fences);
-	b_fences = get_fences(b, &b_num_fences);
-	if (a_num_fences > INT_MAX - b_num_fences)
-		goto err;
-
-	num_fences = a_num_fences + b_num_fences;
-
-	fences = kcalloc(num_fences, sizeof(*fences), GFP_KERNEL);
-	if (!fences)
-		goto err;
-
 	/*
-	 * Assume sync_file a and b are both ordered and have no
-	 * duplicates with the same context.
-	 *
-	 * If a sync_file can only be created with sync_file_merge
-	 * and sync_file_create, this is a reasonable assumption.
+	 * Chains can only shrink while we collect the fences, so restart with
+	 * a large enough array if the inline one turned out to be too small.
 	 */
-	for (i_a = i_b = 0; i_a < a_num_fences && i_b < b_num_fences; ) {
-		struct dma_fence *pt_a = a_fences[i_a];
-		struct dma_fence *pt_b = b_fences[i_b];
-
-		if (pt_a->context < pt_b->context) {
-			add_fence(fences, &i, pt_a);
-
-			i_a++;
-		} else if (pt_a->context > pt_b->context) {
-			add_fence(fences, &i, pt_b);
-
-			i_b++;
-		} else {
-			if (__dma_fence_is_later(pt_a->seqno, pt_b->seqno,
-						 pt_a->ops))
-				add_fence(fences, &i, pt_a);
-			else
-				add_fence(fences, &i, pt_b);
-
-			i_a++;
-			i_b++;
-		}
+	for (;;) {
+		num_fences = 0;
+		add_fences(fences, &num_fences, max, a->fence);
+		add_fences(fences, &num_fences, max, b->fence);
+		if (num_fences <= max)
+			break;
+
+		while (max)
+			dma_fence_put(fences[--max]);
+		if (fences != inline_fences)
+			kfree(fences);
+
+		max = num_fences;
+		fences = kmalloc_array(max, sizeof(*fences), GFP_KERNEL);
+		if (!fences)
+			goto err_free_file;
 	}
 
-	for (; i_a < a_num_fences; i_a++)
-		add_fence(fences, &i, a_fences[i_a]);
+	sort(fences, num_fences, sizeof(*fences), fence_cmp, NULL);
 
-	for (; i_b < b_num_fences; i_b++)
-		add_fence(fences, &i, b_fences[i_b]);
+	for (i = 0, j = 0; j < num_fences; ++j) {
+		if (i && fences[i - 1]->context == fences[j]->context)
+			dma_fence_put(fences[j]);
+		else
+			fences[i++] = fences[j];
+	}
 
 	if (i == 0)
-		fences[i++] = dma_fence_get(a_fences[0]);
+		fences[i++] = dma_fence_get(a->fence);
 
-	if (num_fences > i) {
-		nfences = krealloc_array(fences, i, sizeof(*fences), GFP_KERNEL);
-		if (!nfences)
-			goto err;
+	if (i == 1) {
+		sync_file->fence = fences[0];
+		if (fences != inline_fences)
+			kfree(fences);
+	} else {
+		if (fences == inline_fences) {
+			nfences = kmemdup(fences, i * sizeof(*fences),
+					  GFP_KERNEL);
+			if (!nfences)
+				goto err;
+			fences = nfences;
+		}
 
-		fences = nfences;
+		if (sync_file_set_fence(sync_file, fences, i) < 0)
+			goto err;
 	}
 
-	if (sync_file_set_fence(sync_file, fences, i) < 0)
-		goto err;
-
 	strlcpy(sync_file->user_name, name, sizeof(sync_file->user_name));
 	return sync_file;
 
 err:
 	while (i)
 		dma_fence_put(fences[--i]);
-	kfree(fences);
+	if (fences != inline_fences)
+		kfree(fences);
+err_free_file:
 	fput(sync_file->file);
 	return NULL;
-
 }
 
 static int sync_file_release(struct inode *inode, struct file *file)
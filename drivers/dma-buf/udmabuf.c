@@ -8,6 +8,7 @@
 #include <linux/memfd.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/shmem_fs.h>
 #include <linux/slab.h>
 #include <linux/udmabuf.h>
@@ -28,6 +29,15 @@ struct udmabuf {
 	struct miscdevice *device;
 };
 
+/*
+ * Mappings are kept per attachment and direction until the attachment goes
+ * away, so repeated imports don't redo the IOMMU mappings.
+ */
+struct udmabuf_attachment {
+	struct mutex lock;
+	struct sg_table *sg[DMA_FROM_DEVICE + 1];
+};
+
 static vm_fault_t udmabuf_vm_fault(struct vm_fault *vmf)
 {
 	struct vm_area_struct *vma = vmf->vma;
@@ -64,9 +74,15 @@ static struct sg_table *get_sg_table(struct device *dev, struct dma_buf *buf,
 	sg = kzalloc(sizeof(*sg), GFP_KERNEL);
 	if (!sg)
 		return ERR_PTR(-ENOMEM);
-	ret = sg_alloc_table_from_pages(sg, ubuf->pages, ubuf->pagecount,
-					0, ubuf->pagecount << PAGE_SHIFT,
-					GFP_KERNEL);
+	/*
+	 * Physically contiguous pages, e.g. the subpages of a hugetlb page,
+	 * are merged into segments as large as the device can take.
+	 */
+	ret = sg_alloc_table_from_pages_segment(sg, ubuf->pages,
+						ubuf->pagecount, 0,
+						ubuf->pagecount << PAGE_SHIFT,
+						dma_get_max_seg_size(dev),
+						GFP_KERNEL);
 	if (ret < 0)
 		goto err;
 	ret = dma_map_sgtable(dev, sg, direction, 0);
@@ -88,17 +104,57 @@ static void put_sg_table(struct device *dev, struct sg_table *sg,
 	kfree(sg);
 }
 
+static int attach_udmabuf(struct dma_buf *buf, struct dma_buf_attachment *at)
+{
+	struct udmabuf_attachment *a;
+
+	a = kzalloc(sizeof(*a), GFP_KERNEL);
+	if (!a)
+		return -ENOMEM;
+
+	mutex_init(&a->lock);
+	at->priv = a;
+	return 0;
+}
+
+static void detach_udmabuf(struct dma_buf *buf, struct dma_buf_attachment *at)
+{
+	struct udmabuf_attachment *a = at->priv;
+	int dir;
+
+	for (dir = 0; dir < ARRAY_SIZE(a->sg); dir++)
+		if (a->sg[dir])
+			put_sg_table(at->dev, a->sg[dir], dir);
+	mutex_destroy(&a->lock);
+	kfree(a);
+}
+
 static struct sg_table *map_udmabuf(struct dma_buf_attachment *at,
 				    enum dma_data_direction direction)
 {
-	return get_sg_table(at->dev, at->dmabuf, direction);
+	struct udmabuf_attachment *a = at->priv;
+	struct sg_table *sg;
+
+	if (WARN_ON(direction >= ARRAY_SIZE(a->sg)))
+		return ERR_PTR(-EINVAL);
+
+	mutex_lock(&a->lock);
+	sg = a->sg[direction];
+	if (!sg) {
+		sg = get_sg_table(at->dev, at->dmabuf, direction);
+		if (!IS_ERR(sg))
+			a->sg[direction] = sg;
+	}
+	mutex_unlock(&a->lock);
+
+	return sg;
 }
 
 static void unmap_udmabuf(struct dma_buf_attachment *at,
 			  struct sg_table *sg,
 			  enum dma_data_direction direction)
 {
-	return put_sg_table(at->dev, sg, direction);
+	/* the mapping is kept until detach_udmabuf() */
 }
 
 static void release_udmabuf(struct dma_buf *buf)
@@ -148,7 +204,8 @@ static int end_cpu_udmabuf(struct dma_buf *buf,
 }
 
 static const struct dma_buf_ops udmabuf_ops = {
-	.cache_sgt_mapping = true,
+	.attach		   = attach_udmabuf,
+	.detach		   = detach_udmabuf,
 	.map_dma_buf	   = map_udmabuf,
 	.unmap_dma_buf	   = unmap_udmabuf,
 	.release	   = release_udmabuf,
@@ -155,6 +155,11 @@ extern int amdgpu_vis_vram_limit;
 extern int amdgpu_gart_size;
 extern int amdgpu_gtt_size;
 extern int amdgpu_moverate;
+extern int amdgpu_vram_compact;
+extern int amdgpu_vram_scrub;
+extern int amdgpu_fence_poll_cpu;
+extern uint amdgpu_fence_poll_idle;
+extern uint amdgpu_xgmi_bw_interval;
 extern int amdgpu_benchmarking;
 extern int amdgpu_testing;
 extern int amdgpu_audio;
@@ -180,6 +185,8 @@ extern int amdgpu_exp_hw_support;
 extern int amdgpu_dc;
 extern int amdgpu_sched_jobs;
 extern int amdgpu_sched_hw_submission;
+extern uint amdgpu_sched_rebalance_ms;
+extern uint amdgpu_vcn_idle_max_ms;
 extern uint amdgpu_pcie_gen_cap;
 extern uint amdgpu_pcie_lane_cap;
 extern uint amdgpu_cg_mask;
@@ -352,9 +359,38 @@ struct amdgpu_ip_block_version {
 #define HW_REV(_Major, _Minor, _Rev) \
 	((((uint32_t) (_Major)) << 16) | ((uint32_t) (_Minor) << 8) | ((uint32_t) (_Rev)))
 
+/* duration of the stages of the last GPU recovery in us */
+struct amdgpu_reset_timing {
+	u32 asic_reset_us;
+	u32 resume_us;
+	u32 late_init_us;
+	u32 ib_test_us;
+	u32 recover_vram_us;
+};
+
+/* counters of the DMA-buf mappings handed out to other devices */
+struct amdgpu_dma_buf_stats {
+	atomic64_t p2p_maps;
+	atomic64_t p2p_bytes;
+	atomic64_t sysmem_maps;
+	atomic64_t sysmem_bytes;
+	atomic64_t cache_hits;
+};
+
+enum amdgpu_ip_phase {
+	AMDGPU_IP_PHASE_SW_INIT,
+	AMDGPU_IP_PHASE_HW_INIT,
+	AMDGPU_IP_PHASE_LATE_INIT,
+	AMDGPU_IP_PHASE_SUSPEND,
+	AMDGPU_IP_PHASE_RESUME,
+	AMDGPU_IP_PHASE_COUNT
+};
+
 struct amdgpu_ip_block {
 	struct amdgpu_ip_block_status status;
 	const struct amdgpu_ip_block_version *version;
+	/* duration of the last run of each phase in us */
+	u32 phase_us[AMDGPU_IP_PHASE_COUNT];
 };
 
 int amdgpu_device_ip_block_version_cmp(struct amdgpu_device *adev,
@@ -430,6 +466,12 @@ struct amdgpu_sa_manager {
 	void			*cpu_ptr;
 	uint32_t		domain;
 	uint32_t		align;
+
+	/* statistics, protected by wq.lock */
+	uint64_t		num_allocs;
+	uint64_t		num_contended;
+	uint64_t		num_waits;
+	uint64_t		wait_ns;
 };
 
 /* sub-allocation buffer */
@@ -479,12 +521,25 @@ struct amdgpu_ib {
 
 extern const struct drm_sched_backend_ops amdgpu_sched_ops;
 
+/*
+ * Buffer migration budget of a client, protected by amdgpu_device::mm_stats
+ */
+struct amdgpu_mm_budget {
+	s64			last_update_us;
+	s64			accum_us; /* accumulated microseconds */
+	s64			accum_us_vis; /* for visible VRAM */
+	u64			window; /* last activity window seen */
+	u64			bytes_moved;
+	u64			bytes_moved_vis;
+};
+
 /*
  * file private structure
  */
 
 struct amdgpu_fpriv {
 	struct amdgpu_vm	vm;
+	struct amdgpu_mm_budget	mm_budget;
 	struct amdgpu_bo_va	*prt_va;
 	struct amdgpu_bo_va	*csa_va;
 	struct mutex		bo_list_lock;
@@ -586,7 +641,10 @@ void amdgpu_device_wb_free(struct amdgpu_device *adev, u32 wb);
 /*
  * Benchmarking
  */
+struct amdgpu_benchmark;
+
 void amdgpu_benchmark(struct amdgpu_device *adev, int test_number);
+void amdgpu_debugfs_benchmark_init(struct amdgpu_device *adev);
 
 
 /*
@@ -838,6 +896,7 @@ struct amdgpu_device {
 	struct amdgpu_i2c_chan		*i2c_bus[AMDGPU_MAX_I2C_BUS];
 	struct debugfs_blob_wrapper     debugfs_vbios_blob;
 	struct debugfs_blob_wrapper     debugfs_discovery_blob;
+	struct amdgpu_benchmark		*benchmark;
 	struct mutex			srbm_mutex;
 	/* GRBM index mutex. Protects concurrent access to GRBM index */
 	struct mutex                    grbm_idx_mutex;
@@ -911,16 +970,26 @@ struct amdgpu_device {
 	atomic64_t			num_bytes_moved;
 	atomic64_t			num_evictions;
 	atomic64_t			num_vram_cpu_page_faults;
+	atomic64_t			num_submissions;
+	atomic64_t			num_fence_waits;
+	atomic64_t			num_vm_faults;
+	atomic64_t			num_ih_overflows;
+	struct amdgpu_dma_buf_stats	dma_buf_stats;
 	atomic_t			gpu_reset_counter;
 	atomic_t			vram_lost_counter;
 
 	/* data for buffer migration throttling */
 	struct {
 		spinlock_t		lock;
-		s64			last_update_us;
-		s64			accum_us; /* accumulated microseconds */
-		s64			accum_us_vis; /* for visible VRAM */
 		u32			log2_max_MBps;
+		u32			copy_MBps; /* measured, 0 if unknown */
+		/* budget for moves not done on behalf of a client */
+		struct amdgpu_mm_budget	kernel;
+		/* clients doing moves in the last and current window */
+		s64			window_start_us;
+		u64			window;
+		u32			window_clients;
+		u32			active_clients;
 	} mm_stats;
 
 	/* display */
@@ -942,9 +1011,14 @@ struct amdgpu_device {
 	unsigned			num_rings;
 	struct amdgpu_ring		*rings[AMDGPU_MAX_RINGS];
 	bool				ib_pool_ready;
-	struct amdgpu_sa_manager	ib_pools[AMDGPU_IB_POOL_MAX];
+	struct amdgpu_sa_manager	ib_pools[AMDGPU_IB_POOL_MAX][AMDGPU_IB_POOL_CLASS_MAX];
 	struct amdgpu_sched		gpu_sched[AMDGPU_HW_IP_NUM][AMDGPU_RING_PRIO_MAX];
 
+	/* busy polling of rings in AMDGPU_FENCE_MODE_POLL */
+	struct mutex			fence_poll_lock;
+	struct task_struct		*fence_poll_thread;
+	wait_queue_head_t		fence_poll_wq;
+
 	/* interrupts */
 	struct amdgpu_irq		irq;
 
@@ -1063,6 +1137,9 @@ struct amdgpu_device {
 
 	int asic_reset_res;
 	struct work_struct		xgmi_reset_work;
+	int				reset_resume_res;
+	struct work_struct		reset_resume_work;
+	struct amdgpu_reset_timing	reset_timing;
 	struct list_head		reset_list;
 
 	long				gfx_timeout;
@@ -1297,8 +1374,11 @@ void amdgpu_device_pci_config_reset(struct amdgpu_device *adev);
 int amdgpu_device_pci_reset(struct amdgpu_device *adev);
 bool amdgpu_device_need_post(struct amdgpu_device *adev);
 
-void amdgpu_cs_report_moved_bytes(struct amdgpu_device *adev, u64 num_bytes,
+void amdgpu_cs_report_moved_bytes(struct amdgpu_device *adev,
+				  struct amdgpu_fpriv *fpriv, u64 num_bytes,
 				  u64 num_vis_bytes);
+void amdgpu_cs_report_move_rate(struct amdgpu_device *adev, u64 num_bytes,
+				u64 time_ns);
 int amdgpu_device_resize_fb_bar(struct amdgpu_device *adev);
 void amdgpu_device_program_register_sequence(struct amdgpu_device *adev,
 					     const u32 *registers,
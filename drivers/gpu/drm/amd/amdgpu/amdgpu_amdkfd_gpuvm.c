@@ -1101,6 +1101,19 @@ static int update_gpuvm_pte(struct kgd_mem *mem,
 	return amdgpu_sync_fence(sync, bo_va->last_pt_update);
 }
 
+/* Check if the page table entries of a mapped attachment are still valid,
+ * i.e. the BO didn't move since the last update and no mapping is pending.
+ * Only attachments sharing a BO can be checked, other types are DMA-unmapped
+ * and remapped on every restore.
+ */
+static bool kfd_mem_attachment_is_valid(struct kfd_mem_attachment *entry)
+{
+	struct amdgpu_bo_va *bo_va = entry->bo_va;
+
+	return entry->type == KFD_MEM_ATT_SHARED && !bo_va->base.moved &&
+	       list_empty(&bo_va->invalids);
+}
+
 static int map_bo_to_gpuvm(struct kgd_mem *mem,
 			   struct kfd_mem_attachment *entry,
 			   struct amdgpu_sync *sync,
@@ -2386,6 +2399,8 @@ int amdgpu_amdkfd_gpuvm_restore_process_bos(void *info, struct dma_fence **ef)
 	struct amdgpu_sync sync_obj;
 	unsigned long failed_size = 0;
 	unsigned long total_size = 0;
+	unsigned int n_updated = 0;
+	unsigned int n_mapped = 0;
 
 	INIT_LIST_HEAD(&duplicate_save);
 	INIT_LIST_HEAD(&ctx.list);
@@ -2434,7 +2449,9 @@ int amdgpu_amdkfd_gpuvm_restore_process_bos(void *info, struct dma_fence **ef)
 		goto validate_map_fail;
 	}
 
-	/* Validate BOs and map them to GPUVM (update VM page tables). */
+	/* Validate BOs and map them to GPUVM (update VM page tables). BOs that
+	 * were not moved while the process was evicted keep their PTEs.
+	 */
 	list_for_each_entry(mem, &process_info->kfd_bo_list,
 			    validate_list.head) {
 
@@ -2464,6 +2481,11 @@ int amdgpu_amdkfd_gpuvm_restore_process_bos(void *info, struct dma_fence **ef)
 			if (!attachment->is_mapped)
 				continue;
 
+			n_mapped++;
+			if (kfd_mem_attachment_is_valid(attachment))
+				continue;
+
+			n_updated++;
 			kfd_mem_dmaunmap_attachment(mem, attachment);
 			ret = update_gpuvm_pte(mem, attachment, &sync_obj, NULL);
 			if (ret) {
@@ -2475,6 +2497,7 @@ int amdgpu_amdkfd_gpuvm_restore_process_bos(void *info, struct dma_fence **ef)
 
 	if (failed_size)
 		pr_debug("0x%lx/0x%lx in system\n", failed_size, total_size);
+	pr_debug("Updated %u/%u mappings\n", n_updated, n_mapped);
 
 	/* Update page directories */
 	ret = process_update_pds(process_info, &sync_obj);
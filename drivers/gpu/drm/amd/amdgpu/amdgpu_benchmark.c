@@ -22,141 +22,455 @@
  * Authors: Jerome Glisse
  */
 
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/pm_runtime.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+
 #include <drm/amdgpu_drm.h>
+#include <drm/drm_managed.h>
 #include "amdgpu.h"
 
 #define AMDGPU_BENCHMARK_ITERATIONS 1024
 #define AMDGPU_BENCHMARK_COMMON_MODES_N 17
 
-static int amdgpu_benchmark_do_move(struct amdgpu_device *adev, unsigned size,
-				    uint64_t saddr, uint64_t daddr, int n)
-{
-	unsigned long start_jiffies;
-	unsigned long end_jiffies;
-	struct dma_fence *fence;
-	int i, r;
+/* Defaults and limits of tests started through debugfs */
+#define AMDGPU_BENCHMARK_DEFAULT_ITERATIONS	64
+#define AMDGPU_BENCHMARK_MAX_ITERATIONS		4096
+#define AMDGPU_BENCHMARK_MAX_SIZE		SZ_256M
+#define AMDGPU_BENCHMARK_MAX_RESULTS		64
 
-	start_jiffies = jiffies;
-	for (i = 0; i < n; i++) {
-		struct amdgpu_ring *ring = adev->mman.buffer_funcs_ring;
-		r = amdgpu_copy_buffer(ring, saddr, daddr, size, NULL, &fence,
-				       false, false, false);
-		if (r)
-			goto exit_do_move;
-		r = dma_fence_wait(fence, false);
-		dma_fence_put(fence);
-		if (r)
-			goto exit_do_move;
-	}
-	end_jiffies = jiffies;
-	r = jiffies_to_msecs(end_jiffies - start_jiffies);
+enum amdgpu_benchmark_op {
+	AMDGPU_BENCHMARK_COPY,
+	AMDGPU_BENCHMARK_FILL,
+	AMDGPU_BENCHMARK_CPU_READ,
+	AMDGPU_BENCHMARK_CPU_WRITE,
+	AMDGPU_BENCHMARK_OP_MAX
+};
 
-exit_do_move:
-	return r;
-}
+static const char * const amdgpu_benchmark_op_names[AMDGPU_BENCHMARK_OP_MAX] = {
+	[AMDGPU_BENCHMARK_COPY] = "copy",
+	[AMDGPU_BENCHMARK_FILL] = "fill",
+	[AMDGPU_BENCHMARK_CPU_READ] = "cpu_read",
+	[AMDGPU_BENCHMARK_CPU_WRITE] = "cpu_write",
+};
 
+/**
+ * struct amdgpu_benchmark_test - description of a single benchmark
+ *
+ * @op: operation to measure
+ * @sdomain: source domain, used by copy and cpu_read
+ * @ddomain: destination domain, used by copy, fill and cpu_write
+ * @size: number of bytes transferred by each engine in each iteration
+ * @align: byte offset of the transfer inside the buffers
+ * @iterations: number of measured iterations
+ * @engines: number of SDMA engines used concurrently
+ */
+struct amdgpu_benchmark_test {
+	enum amdgpu_benchmark_op	op;
+	u32				sdomain;
+	u32				ddomain;
+	u64				size;
+	u32				align;
+	unsigned int			iterations;
+	unsigned int			engines;
+};
 
-static void amdgpu_benchmark_log_results(int n, unsigned size,
-					 unsigned int time,
-					 unsigned sdomain, unsigned ddomain,
-					 char *kind)
-{
-	unsigned int throughput = (n * (size >> 10)) / time;
-	DRM_INFO("amdgpu: %s %u bo moves of %u kB from"
-		 " %d to %d in %u ms, throughput: %u Mb/s or %u MB/s\n",
-		 kind, n, size >> 10, sdomain, ddomain, time,
-		 throughput * 8, throughput);
-}
+struct amdgpu_benchmark_result {
+	struct amdgpu_benchmark_test	test;
+	int				error;
+	u64				min_ns;
+	u64				p50_ns;
+	u64				p90_ns;
+	u64				p99_ns;
+	u64				max_ns;
+	u64				total_ns;
+	u64				bytes;
+};
 
-static void amdgpu_benchmark_move(struct amdgpu_device *adev, unsigned size,
-				  unsigned sdomain, unsigned ddomain)
+struct amdgpu_benchmark {
+	/* serializes test runs and protects the results */
+	struct mutex			lock;
+	unsigned int			num_results;
+	struct amdgpu_benchmark_result	results[AMDGPU_BENCHMARK_MAX_RESULTS];
+};
+
+static int amdgpu_benchmark_bo_create(struct amdgpu_device *adev, u64 size,
+				      u32 domain, u64 flags,
+				      struct amdgpu_bo **bo, u64 *gpu_addr)
 {
-	struct amdgpu_bo *dobj = NULL;
-	struct amdgpu_bo *sobj = NULL;
 	struct amdgpu_bo_param bp;
-	uint64_t saddr, daddr;
-	int r, n;
-	int time;
+	int r;
 
 	memset(&bp, 0, sizeof(bp));
 	bp.size = size;
 	bp.byte_align = PAGE_SIZE;
-	bp.domain = sdomain;
-	bp.flags = 0;
+	bp.domain = domain;
+	bp.flags = flags;
 	bp.type = ttm_bo_type_kernel;
 	bp.resv = NULL;
 	bp.bo_ptr_size = sizeof(struct amdgpu_bo);
 
-	n = AMDGPU_BENCHMARK_ITERATIONS;
-	r = amdgpu_bo_create(adev, &bp, &sobj);
-	if (r) {
-		goto out_cleanup;
-	}
-	r = amdgpu_bo_reserve(sobj, false);
+	r = amdgpu_bo_create(adev, &bp, bo);
+	if (r)
+		return r;
+
+	r = amdgpu_bo_reserve(*bo, false);
 	if (unlikely(r != 0))
-		goto out_cleanup;
-	r = amdgpu_bo_pin(sobj, sdomain);
-	if (r) {
-		amdgpu_bo_unreserve(sobj);
-		goto out_cleanup;
-	}
-	r = amdgpu_ttm_alloc_gart(&sobj->tbo);
-	amdgpu_bo_unreserve(sobj);
-	if (r) {
-		goto out_cleanup;
+		goto error_unref;
+
+	r = amdgpu_bo_pin(*bo, domain);
+	if (r)
+		goto error_unreserve;
+
+	r = amdgpu_ttm_alloc_gart(&(*bo)->tbo);
+	if (r)
+		goto error_unpin;
+
+	if (gpu_addr)
+		*gpu_addr = amdgpu_bo_gpu_offset(*bo);
+	amdgpu_bo_unreserve(*bo);
+	return 0;
+
+error_unpin:
+	amdgpu_bo_unpin(*bo);
+error_unreserve:
+	amdgpu_bo_unreserve(*bo);
+error_unref:
+	amdgpu_bo_unref(bo);
+	return r;
+}
+
+static void amdgpu_benchmark_bo_free(struct amdgpu_bo **bo)
+{
+	if (!*bo)
+		return;
+
+	if (likely(amdgpu_bo_reserve(*bo, true) == 0)) {
+		amdgpu_bo_kunmap(*bo);
+		amdgpu_bo_unpin(*bo);
+		amdgpu_bo_unreserve(*bo);
 	}
-	saddr = amdgpu_bo_gpu_offset(sobj);
-	bp.domain = ddomain;
-	r = amdgpu_bo_create(adev, &bp, &dobj);
-	if (r) {
-		goto out_cleanup;
+	amdgpu_bo_unref(bo);
+}
+
+/*
+ * Submit a single copy or fill job to @entity. This open codes
+ * amdgpu_copy_buffer() and amdgpu_fill_buffer() because those always use the
+ * buffer funcs entity, while the benchmark needs one entity per engine.
+ */
+static int amdgpu_benchmark_submit(struct amdgpu_device *adev,
+				   struct drm_sched_entity *entity,
+				   struct amdgpu_ring *ring,
+				   const struct amdgpu_benchmark_test *test,
+				   u64 saddr, u64 daddr,
+				   struct dma_fence **fence)
+{
+	const struct amdgpu_buffer_funcs *funcs = adev->mman.buffer_funcs;
+	bool fill = test->op == AMDGPU_BENCHMARK_FILL;
+	u32 max_bytes = fill ? funcs->fill_max_bytes : funcs->copy_max_bytes;
+	u32 loop_dw = fill ? funcs->fill_num_dw : funcs->copy_num_dw;
+	u64 bytes = test->size;
+	struct amdgpu_job *job;
+	unsigned int num_dw;
+	int r;
+
+	num_dw = ALIGN(DIV_ROUND_UP_ULL(bytes, max_bytes) * loop_dw, 8);
+	/* for IB padding */
+	num_dw += 64;
+
+	r = amdgpu_job_alloc_with_ib(adev, num_dw * 4, AMDGPU_IB_POOL_DELAYED,
+				     &job);
+	if (r)
+		return r;
+
+	while (bytes) {
+		u32 cur_size = min_t(u64, bytes, max_bytes);
+
+		if (fill)
+			amdgpu_emit_fill_buffer(adev, &job->ibs[0], 0, daddr,
+						cur_size);
+		else
+			amdgpu_emit_copy_buffer(adev, &job->ibs[0], saddr,
+						daddr, cur_size, false);
+
+		saddr += cur_size;
+		daddr += cur_size;
+		bytes -= cur_size;
 	}
-	r = amdgpu_bo_reserve(dobj, false);
-	if (unlikely(r != 0))
-		goto out_cleanup;
-	r = amdgpu_bo_pin(dobj, ddomain);
-	if (r) {
-		amdgpu_bo_unreserve(sobj);
-		goto out_cleanup;
+
+	amdgpu_ring_pad_ib(ring, &job->ibs[0]);
+	WARN_ON(job->ibs[0].length_dw > num_dw);
+	r = amdgpu_job_submit(job, entity, AMDGPU_FENCE_OWNER_UNDEFINED, fence);
+	if (r)
+		amdgpu_job_free(job);
+	return r;
+}
+
+/*
+ * Measure copies or fills running concurrently on @test->engines SDMA
+ * engines. Each sample is the time from submission until the jobs of all
+ * engines completed.
+ */
+static int amdgpu_benchmark_run_gpu(struct amdgpu_device *adev,
+				    const struct amdgpu_benchmark_test *test,
+				    u64 *samples)
+{
+	struct drm_sched_entity entities[AMDGPU_MAX_SDMA_INSTANCES];
+	struct amdgpu_ring *rings[AMDGPU_MAX_SDMA_INSTANCES];
+	struct amdgpu_bo *sobj[AMDGPU_MAX_SDMA_INSTANCES] = {};
+	struct amdgpu_bo *dobj[AMDGPU_MAX_SDMA_INSTANCES] = {};
+	struct dma_fence *fences[AMDGPU_MAX_SDMA_INSTANCES] = {};
+	u64 saddr[AMDGPU_MAX_SDMA_INSTANCES] = {};
+	u64 daddr[AMDGPU_MAX_SDMA_INSTANCES];
+	u64 bo_size = PAGE_ALIGN(test->size + test->align);
+	unsigned int i, e, num_entities = 0;
+	int r = 0;
+
+	if (!adev->mman.buffer_funcs_enabled)
+		return -ENODEV;
+
+	if (test->engines == 1) {
+		rings[0] = adev->mman.buffer_funcs_ring;
+	} else {
+		/* all instances of the SDMA block understand the same packets */
+		if (adev->mman.buffer_funcs_ring->funcs->type !=
+		    AMDGPU_RING_TYPE_SDMA ||
+		    test->engines > adev->sdma.num_instances)
+			return -EINVAL;
+
+		for (e = 0; e < test->engines; ++e) {
+			rings[e] = &adev->sdma.instance[e].ring;
+			if (!rings[e]->sched.ready)
+				return -ENODEV;
+		}
 	}
-	r = amdgpu_ttm_alloc_gart(&dobj->tbo);
-	amdgpu_bo_unreserve(dobj);
-	if (r) {
-		goto out_cleanup;
+
+	for (e = 0; e < test->engines; ++e) {
+		struct drm_gpu_scheduler *sched = &rings[e]->sched;
+
+		r = drm_sched_entity_init(&entities[e],
+					  DRM_SCHED_PRIORITY_NORMAL,
+					  &sched, 1, NULL);
+		if (r)
+			goto out_cleanup;
+		++num_entities;
+
+		if (test->op == AMDGPU_BENCHMARK_COPY) {
+			r = amdgpu_benchmark_bo_create(adev, bo_size,
+						       test->sdomain, 0,
+						       &sobj[e], &saddr[e]);
+			if (r)
+				goto out_cleanup;
+			saddr[e] += test->align;
+		}
+
+		r = amdgpu_benchmark_bo_create(adev, bo_size, test->ddomain, 0,
+					       &dobj[e], &daddr[e]);
+		if (r)
+			goto out_cleanup;
+		daddr[e] += test->align;
 	}
-	daddr = amdgpu_bo_gpu_offset(dobj);
 
-	if (adev->mman.buffer_funcs) {
-		time = amdgpu_benchmark_do_move(adev, size, saddr, daddr, n);
-		if (time < 0)
+	/* the first iteration warms up caches and TLBs and isn't measured */
+	for (i = 0; i <= test->iterations; ++i) {
+		ktime_t start = ktime_get();
+
+		for (e = 0; e < test->engines; ++e) {
+			r = amdgpu_benchmark_submit(adev, &entities[e],
+						    rings[e], test, saddr[e],
+						    daddr[e], &fences[e]);
+			if (r)
+				goto out_cleanup;
+		}
+
+		for (e = 0; e < test->engines; ++e) {
+			long t = dma_fence_wait(fences[e], false);
+
+			dma_fence_put(fences[e]);
+			fences[e] = NULL;
+			if (t)
+				r = t;
+		}
+		if (r)
 			goto out_cleanup;
-		if (time > 0)
-			amdgpu_benchmark_log_results(n, size, time,
-						     sdomain, ddomain, "dma");
+
+		if (i)
+			samples[i - 1] = ktime_to_ns(ktime_sub(ktime_get(),
+							       start));
 	}
 
 out_cleanup:
-	/* Check error value now. The value can be overwritten when clean up.*/
-	if (r) {
-		DRM_ERROR("Error while benchmarking BO move.\n");
+	for (e = 0; e < test->engines; ++e) {
+		if (fences[e]) {
+			dma_fence_wait(fences[e], false);
+			dma_fence_put(fences[e]);
+		}
 	}
+	for (e = 0; e < num_entities; ++e)
+		drm_sched_entity_destroy(&entities[e]);
+	for (e = 0; e < test->engines; ++e) {
+		amdgpu_benchmark_bo_free(&sobj[e]);
+		amdgpu_benchmark_bo_free(&dobj[e]);
+	}
+	return r;
+}
 
-	if (sobj) {
-		r = amdgpu_bo_reserve(sobj, true);
-		if (likely(r == 0)) {
-			amdgpu_bo_unpin(sobj);
-			amdgpu_bo_unreserve(sobj);
-		}
-		amdgpu_bo_unref(&sobj);
+/*
+ * Measure CPU reads or writes of a kernel mapping of VRAM, which goes
+ * through the visible BAR, or of GTT.
+ */
+static int amdgpu_benchmark_run_cpu(struct amdgpu_device *adev,
+				    const struct amdgpu_benchmark_test *test,
+				    u64 *samples)
+{
+	bool read = test->op == AMDGPU_BENCHMARK_CPU_READ;
+	u32 domain = read ? test->sdomain : test->ddomain;
+	struct amdgpu_bo *bo = NULL;
+	void *sys, *ptr;
+	unsigned int i;
+	int r;
+
+	sys = kvmalloc(test->size, GFP_KERNEL);
+	if (!sys)
+		return -ENOMEM;
+	memset(sys, 0, test->size);
+
+	r = amdgpu_benchmark_bo_create(adev, PAGE_ALIGN(test->size + test->align),
+				       domain,
+				       AMDGPU_GEM_CREATE_CPU_ACCESS_REQUIRED,
+				       &bo, NULL);
+	if (r)
+		goto out_free;
+
+	r = amdgpu_bo_reserve(bo, false);
+	if (unlikely(r != 0))
+		goto out_cleanup;
+	r = amdgpu_bo_kmap(bo, &ptr);
+	amdgpu_bo_unreserve(bo);
+	if (r)
+		goto out_cleanup;
+	ptr += test->align;
+
+	for (i = 0; i <= test->iterations; ++i) {
+		ktime_t start = ktime_get();
+
+		if (read)
+			memcpy(sys, ptr, test->size);
+		else
+			memcpy(ptr, sys, test->size);
+		/* make sure write combined stores actually reached the BO */
+		mb();
+
+		if (i)
+			samples[i - 1] = ktime_to_ns(ktime_sub(ktime_get(),
+							       start));
+		cond_resched();
 	}
-	if (dobj) {
-		r = amdgpu_bo_reserve(dobj, true);
-		if (likely(r == 0)) {
-			amdgpu_bo_unpin(dobj);
-			amdgpu_bo_unreserve(dobj);
-		}
-		amdgpu_bo_unref(&dobj);
+
+out_cleanup:
+	amdgpu_benchmark_bo_free(&bo);
+out_free:
+	kvfree(sys);
+	return r;
+}
+
+static int amdgpu_benchmark_cmp(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * amdgpu_benchmark_run - run a single benchmark
+ *
+ * @adev: amdgpu_device pointer
+ * @test: the benchmark to run
+ * @res: resulting latency percentiles and throughput
+ *
+ * Returns 0 for success, error for failure. The error is also recorded in
+ * @res.
+ */
+static int amdgpu_benchmark_run(struct amdgpu_device *adev,
+				const struct amdgpu_benchmark_test *test,
+				struct amdgpu_benchmark_result *res)
+{
+	unsigned int i, n = test->iterations;
+	u64 *samples;
+	int r;
+
+	memset(res, 0, sizeof(*res));
+	res->test = *test;
+
+	samples = kvmalloc_array(n, sizeof(*samples), GFP_KERNEL);
+	if (!samples) {
+		r = -ENOMEM;
+		goto out;
 	}
+
+	if (test->op == AMDGPU_BENCHMARK_COPY ||
+	    test->op == AMDGPU_BENCHMARK_FILL)
+		r = amdgpu_benchmark_run_gpu(adev, test, samples);
+	else
+		r = amdgpu_benchmark_run_cpu(adev, test, samples);
+	if (r)
+		goto out_free;
+
+	for (i = 0; i < n; ++i)
+		res->total_ns += samples[i];
+	res->bytes = test->size * test->engines * n;
+
+	sort(samples, n, sizeof(*samples), amdgpu_benchmark_cmp, NULL);
+	res->min_ns = samples[0];
+	res->p50_ns = samples[(n - 1) * 50 / 100];
+	res->p90_ns = samples[(n - 1) * 90 / 100];
+	res->p99_ns = samples[(n - 1) * 99 / 100];
+	res->max_ns = samples[n - 1];
+
+out_free:
+	kvfree(samples);
+out:
+	res->error = r;
+	return r;
+}
+
+static void amdgpu_benchmark_log_results(int n, unsigned size,
+					 unsigned int time,
+					 unsigned sdomain, unsigned ddomain,
+					 char *kind)
+{
+	unsigned int throughput = (n * (size >> 10)) / time;
+	DRM_INFO("amdgpu: %s %u bo moves of %u kB from"
+		 " %d to %d in %u ms, throughput: %u Mb/s or %u MB/s\n",
+		 kind, n, size >> 10, sdomain, ddomain, time,
+		 throughput * 8, throughput);
+}
+
+static void amdgpu_benchmark_move(struct amdgpu_device *adev, unsigned size,
+				  unsigned sdomain, unsigned ddomain)
+{
+	struct amdgpu_benchmark_test test = {
+		.op = AMDGPU_BENCHMARK_COPY,
+		.sdomain = sdomain,
+		.ddomain = ddomain,
+		.size = size,
+		.iterations = AMDGPU_BENCHMARK_ITERATIONS,
+		.engines = 1,
+	};
+	struct amdgpu_benchmark_result res;
+	unsigned int time;
+
+	if (amdgpu_benchmark_run(adev, &test, &res)) {
+		DRM_ERROR("Error while benchmarking BO move.\n");
+		return;
+	}
+
+	time = div_u64(res.total_ns, NSEC_PER_MSEC);
+	if (time > 0)
+		amdgpu_benchmark_log_results(test.iterations, size, time,
+					     sdomain, ddomain, "dma");
 }
 
 void amdgpu_benchmark(struct amdgpu_device *adev, int test_number)
@@ -242,3 +556,322 @@ void amdgpu_benchmark(struct amdgpu_device *adev, int test_number)
 		DRM_ERROR("Unknown benchmark\n");
 	}
 }
+
+#if defined(CONFIG_DEBUG_FS)
+
+static const struct amdgpu_benchmark_test amdgpu_benchmark_defaults = {
+	.op = AMDGPU_BENCHMARK_COPY,
+	.sdomain = AMDGPU_GEM_DOMAIN_VRAM,
+	.ddomain = AMDGPU_GEM_DOMAIN_VRAM,
+	.size = SZ_1M,
+	.align = 0,
+	.iterations = AMDGPU_BENCHMARK_DEFAULT_ITERATIONS,
+	.engines = 1,
+};
+
+static u64 amdgpu_benchmark_mbps(const struct amdgpu_benchmark_result *res)
+{
+	if (!res->total_ns)
+		return 0;
+
+	/* bytes per ns times 1000 gives MB/s */
+	return div64_u64(res->bytes * 1000, res->total_ns);
+}
+
+static const char *amdgpu_benchmark_domain_name(u32 domain)
+{
+	return domain == AMDGPU_GEM_DOMAIN_VRAM ? "vram" : "gtt";
+}
+
+static int amdgpu_benchmark_parse_domain(const char *str, u32 *domain)
+{
+	if (!strcmp(str, "vram"))
+		*domain = AMDGPU_GEM_DOMAIN_VRAM;
+	else if (!strcmp(str, "gtt"))
+		*domain = AMDGPU_GEM_DOMAIN_GTT;
+	else
+		return -EINVAL;
+	return 0;
+}
+
+/*
+ * Parse a line of "key=value" pairs, keys not given keep their default from
+ * amdgpu_benchmark_defaults.
+ */
+static int amdgpu_benchmark_parse(struct amdgpu_device *adev, char *line,
+				  struct amdgpu_benchmark_test *test)
+{
+	char *tok;
+	int r = 0;
+
+	*test = amdgpu_benchmark_defaults;
+	while ((tok = strsep(&line, " \t")) != NULL) {
+		char *key = strsep(&tok, "=");
+
+		if (!*key)
+			continue;
+		if (!tok)
+			return -EINVAL;
+
+		if (!strcmp(key, "op")) {
+			r = match_string(amdgpu_benchmark_op_names,
+					 AMDGPU_BENCHMARK_OP_MAX, tok);
+			if (r < 0)
+				return r;
+			test->op = r;
+			r = 0;
+		} else if (!strcmp(key, "src")) {
+			r = amdgpu_benchmark_parse_domain(tok, &test->sdomain);
+		} else if (!strcmp(key, "dst")) {
+			r = amdgpu_benchmark_parse_domain(tok, &test->ddomain);
+		} else if (!strcmp(key, "size")) {
+			test->size = memparse(tok, NULL);
+		} else if (!strcmp(key, "align")) {
+			r = kstrtou32(tok, 0, &test->align);
+		} else if (!strcmp(key, "iters")) {
+			r = kstrtouint(tok, 0, &test->iterations);
+		} else if (!strcmp(key, "engines")) {
+			if (!strcmp(tok, "all"))
+				test->engines = max_t(unsigned int,
+						     adev->sdma.num_instances, 1);
+			else
+				r = kstrtouint(tok, 0, &test->engines);
+		} else {
+			return -EINVAL;
+		}
+		if (r)
+			return r;
+	}
+
+	if (!test->size || test->size > AMDGPU_BENCHMARK_MAX_SIZE ||
+	    test->align >= PAGE_SIZE ||
+	    !test->iterations ||
+	    test->iterations > AMDGPU_BENCHMARK_MAX_ITERATIONS ||
+	    !test->engines || test->engines > AMDGPU_MAX_SDMA_INSTANCES)
+		return -EINVAL;
+
+	/* the engines only fill whole dwords */
+	if (test->op == AMDGPU_BENCHMARK_FILL &&
+	    (!IS_ALIGNED(test->size, 4) || !IS_ALIGNED(test->align, 4)))
+		return -EINVAL;
+
+	/* CPU access is always single threaded */
+	if (test->op >= AMDGPU_BENCHMARK_CPU_READ && test->engines != 1)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void amdgpu_benchmark_record(struct amdgpu_benchmark *bench,
+				    const struct amdgpu_benchmark_result *res)
+{
+	if (bench->num_results < AMDGPU_BENCHMARK_MAX_RESULTS)
+		bench->results[bench->num_results++] = *res;
+}
+
+/* Default qualification run, started by writing "suite" */
+static void amdgpu_benchmark_suite(struct amdgpu_device *adev)
+{
+	static const u32 domains[][2] = {
+		{ AMDGPU_GEM_DOMAIN_GTT, AMDGPU_GEM_DOMAIN_VRAM },
+		{ AMDGPU_GEM_DOMAIN_VRAM, AMDGPU_GEM_DOMAIN_GTT },
+		{ AMDGPU_GEM_DOMAIN_VRAM, AMDGPU_GEM_DOMAIN_VRAM },
+	};
+	static const u64 sizes[] = { SZ_4K, SZ_64K, SZ_1M, SZ_16M };
+	static const u32 aligns[] = { 1, 4, 256 };
+	struct amdgpu_benchmark *bench = adev->benchmark;
+	struct amdgpu_benchmark_test test = amdgpu_benchmark_defaults;
+	struct amdgpu_benchmark_result res;
+	unsigned int i, j;
+
+	/* copy bandwidth and latency between the domains */
+	for (i = 0; i < ARRAY_SIZE(domains); ++i) {
+		for (j = 0; j < ARRAY_SIZE(sizes); ++j) {
+			test.sdomain = domains[i][0];
+			test.ddomain = domains[i][1];
+			test.size = sizes[j];
+			amdgpu_benchmark_run(adev, &test, &res);
+			amdgpu_benchmark_record(bench, &res);
+		}
+	}
+
+	/* unaligned copies */
+	test = amdgpu_benchmark_defaults;
+	for (i = 0; i < ARRAY_SIZE(aligns); ++i) {
+		test.align = aligns[i];
+		amdgpu_benchmark_run(adev, &test, &res);
+		amdgpu_benchmark_record(bench, &res);
+	}
+
+	/* fills */
+	test = amdgpu_benchmark_defaults;
+	test.op = AMDGPU_BENCHMARK_FILL;
+	test.size = SZ_16M;
+	for (i = 0; i < 2; ++i) {
+		test.ddomain = i ? AMDGPU_GEM_DOMAIN_GTT : AMDGPU_GEM_DOMAIN_VRAM;
+		amdgpu_benchmark_run(adev, &test, &res);
+		amdgpu_benchmark_record(bench, &res);
+	}
+
+	/* all SDMA engines at once */
+	if (adev->sdma.num_instances > 1) {
+		test = amdgpu_benchmark_defaults;
+		test.size = SZ_16M;
+		test.engines = adev->sdma.num_instances;
+		amdgpu_benchmark_run(adev, &test, &res);
+		amdgpu_benchmark_record(bench, &res);
+
+		test.sdomain = AMDGPU_GEM_DOMAIN_GTT;
+		amdgpu_benchmark_run(adev, &test, &res);
+		amdgpu_benchmark_record(bench, &res);
+	}
+
+	/* CPU access to VRAM through the BAR and to GTT */
+	test = amdgpu_benchmark_defaults;
+	for (i = 0; i < 2; ++i) {
+		u32 domain = i ? AMDGPU_GEM_DOMAIN_GTT : AMDGPU_GEM_DOMAIN_VRAM;
+
+		test.sdomain = domain;
+		test.ddomain = domain;
+		for (j = 2; j < ARRAY_SIZE(sizes); ++j) {
+			test.size = sizes[j];
+			test.op = AMDGPU_BENCHMARK_CPU_READ;
+			amdgpu_benchmark_run(adev, &test, &res);
+			amdgpu_benchmark_record(bench, &res);
+
+			test.op = AMDGPU_BENCHMARK_CPU_WRITE;
+			amdgpu_benchmark_run(adev, &test, &res);
+			amdgpu_benchmark_record(bench, &res);
+		}
+	}
+}
+
+static int amdgpu_debugfs_benchmark_show(struct seq_file *m, void *unused)
+{
+	struct amdgpu_device *adev = m->private;
+	struct amdgpu_benchmark *bench = adev->benchmark;
+	unsigned int i;
+
+	mutex_lock(&bench->lock);
+	seq_printf(m, "%-9s %-4s %-4s %10s %5s %7s %5s %10s %10s %10s %10s %10s %8s %5s\n",
+		   "op", "src", "dst", "size", "align", "engines", "iters",
+		   "min_ns", "p50_ns", "p90_ns", "p99_ns", "max_ns", "MB/s",
+		   "error");
+	for (i = 0; i < bench->num_results; ++i) {
+		const struct amdgpu_benchmark_result *res = &bench->results[i];
+		const struct amdgpu_benchmark_test *test = &res->test;
+
+		seq_printf(m, "%-9s %-4s %-4s %10llu %5u %7u %5u %10llu %10llu %10llu %10llu %10llu %8llu %5d\n",
+			   amdgpu_benchmark_op_names[test->op],
+			   test->op == AMDGPU_BENCHMARK_COPY ||
+			   test->op == AMDGPU_BENCHMARK_CPU_READ ?
+			   amdgpu_benchmark_domain_name(test->sdomain) : "-",
+			   test->op != AMDGPU_BENCHMARK_CPU_READ ?
+			   amdgpu_benchmark_domain_name(test->ddomain) : "-",
+			   test->size, test->align, test->engines,
+			   test->iterations, res->min_ns, res->p50_ns,
+			   res->p90_ns, res->p99_ns, res->max_ns,
+			   amdgpu_benchmark_mbps(res), res->error);
+	}
+	mutex_unlock(&bench->lock);
+	return 0;
+}
+
+/*
+ * Each write replaces the results. Every line is either "suite" or a list
+ * of "key=value" pairs describing a single test, e.g.
+ *
+ *   op=copy src=gtt dst=vram size=4M align=0 iters=64 engines=1
+ *
+ * op is one of copy, fill, cpu_read or cpu_write, src and dst are vram or
+ * gtt and engines is the number of SDMA engines used concurrently or "all".
+ */
+static ssize_t amdgpu_debugfs_benchmark_write(struct file *f,
+					      const char __user *buf,
+					      size_t size, loff_t *pos)
+{
+	struct amdgpu_device *adev = file_inode(f)->i_private;
+	struct amdgpu_benchmark *bench = adev->benchmark;
+	struct amdgpu_benchmark_test test;
+	struct amdgpu_benchmark_result res;
+	char *cmds, *cur, *line;
+	int r;
+
+	if (size > PAGE_SIZE)
+		return -EINVAL;
+
+	cmds = memdup_user_nul(buf, size);
+	if (IS_ERR(cmds))
+		return PTR_ERR(cmds);
+
+	r = pm_runtime_get_sync(adev_to_drm(adev)->dev);
+	if (r < 0)
+		goto out_put;
+
+	r = mutex_lock_interruptible(&bench->lock);
+	if (r)
+		goto out_put;
+
+	bench->num_results = 0;
+	cur = cmds;
+	while ((line = strsep(&cur, "\n")) != NULL) {
+		line = strim(line);
+		if (!*line)
+			continue;
+
+		if (!strcmp(line, "suite")) {
+			amdgpu_benchmark_suite(adev);
+			continue;
+		}
+
+		r = amdgpu_benchmark_parse(adev, line, &test);
+		if (r)
+			break;
+
+		amdgpu_benchmark_run(adev, &test, &res);
+		amdgpu_benchmark_record(bench, &res);
+	}
+	mutex_unlock(&bench->lock);
+
+out_put:
+	pm_runtime_mark_last_busy(adev_to_drm(adev)->dev);
+	pm_runtime_put_autosuspend(adev_to_drm(adev)->dev);
+	kfree(cmds);
+	return r ? r : size;
+}
+
+static int amdgpu_debugfs_benchmark_open(struct inode *inode, struct file *f)
+{
+	return single_open(f, amdgpu_debugfs_benchmark_show, inode->i_private);
+}
+
+static const struct file_operations amdgpu_debugfs_benchmark_fops = {
+	.owner = THIS_MODULE,
+	.open = amdgpu_debugfs_benchmark_open,
+	.read = seq_read,
+	.write = amdgpu_debugfs_benchmark_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+#endif
+
+void amdgpu_debugfs_benchmark_init(struct amdgpu_device *adev)
+{
+#if defined(CONFIG_DEBUG_FS)
+	struct drm_minor *minor = adev_to_drm(adev)->primary;
+	struct dentry *root = minor->debugfs_root;
+
+	if (!adev->mman.buffer_funcs)
+		return;
+
+	adev->benchmark = drmm_kzalloc(adev_to_drm(adev),
+				       sizeof(*adev->benchmark), GFP_KERNEL);
+	if (!adev->benchmark)
+		return;
+	mutex_init(&adev->benchmark->lock);
+
+	debugfs_create_file("amdgpu_benchmark", 0600, root, adev,
+			    &amdgpu_debugfs_benchmark_fops);
+#endif
+}
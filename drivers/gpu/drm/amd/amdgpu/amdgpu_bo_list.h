@@ -38,6 +38,14 @@ struct amdgpu_bo_list_entry {
 	uint32_t			priority;
 	struct page			**user_pages;
 	bool				user_invalidated;
+
+	/*
+	 * Set when the BO was validated to its preferred domains by a previous
+	 * submission, it can be skipped as long as it didn't move since.
+	 */
+	bool				resident;
+	u32				resident_domains;
+	u64				resident_gen;
 };
 
 struct amdgpu_bo_list {
@@ -259,29 +259,80 @@ static int amdgpu_cs_parser_init(struct amdgpu_cs_parser *p, union drm_amdgpu_cs
 	return ret;
 }
 
+/*
+ * The measured copy bandwidth is only used as a ceiling, at most 1/16th of
+ * it is handed out to buffer migrations.
+ */
+#define AMDGPU_MM_COPY_SHARE_SHIFT	4
+
+/* Returns the current buffer migration rate in MB/s, 0 if disabled. */
+static u64 amdgpu_cs_move_MBps(struct amdgpu_device *adev)
+{
+	u64 MBps;
+
+	if (!adev->mm_stats.log2_max_MBps)
+		return 0;
+
+	MBps = 1ULL << adev->mm_stats.log2_max_MBps;
+	return max_t(u64, MBps,
+		     READ_ONCE(adev->mm_stats.copy_MBps) >>
+		     AMDGPU_MM_COPY_SHARE_SHIFT);
+}
+
 /* Convert microseconds to bytes. */
 static u64 us_to_bytes(struct amdgpu_device *adev, s64 us)
 {
-	if (us <= 0 || !adev->mm_stats.log2_max_MBps)
+	if (us <= 0)
 		return 0;
 
 	/* Since accum_us is incremented by a million per second, just
 	 * multiply it by the number of MB/s to get the number of bytes.
 	 */
-	return us << adev->mm_stats.log2_max_MBps;
+	return us * amdgpu_cs_move_MBps(adev);
 }
 
 static s64 bytes_to_us(struct amdgpu_device *adev, u64 bytes)
 {
-	if (!adev->mm_stats.log2_max_MBps)
+	u64 MBps = amdgpu_cs_move_MBps(adev);
+
+	if (!MBps)
 		return 0;
 
-	return bytes >> adev->mm_stats.log2_max_MBps;
+	return div64_u64(bytes, MBps);
+}
+
+static struct amdgpu_mm_budget *
+amdgpu_cs_mm_budget(struct amdgpu_device *adev, struct amdgpu_fpriv *fpriv)
+{
+	return fpriv ? &fpriv->mm_budget : &adev->mm_stats.kernel;
+}
+
+/* Returns the number of clients currently sharing the migration budget. */
+static u32 amdgpu_cs_mm_active_clients(struct amdgpu_device *adev,
+				       struct amdgpu_mm_budget *budget,
+				       s64 time_us)
+{
+	lockdep_assert_held(&adev->mm_stats.lock);
+
+	if (time_us - adev->mm_stats.window_start_us >= USEC_PER_SEC) {
+		adev->mm_stats.active_clients = adev->mm_stats.window_clients;
+		adev->mm_stats.window_clients = 0;
+		adev->mm_stats.window_start_us = time_us;
+		adev->mm_stats.window++;
+	}
+
+	if (budget->window != adev->mm_stats.window) {
+		budget->window = adev->mm_stats.window;
+		adev->mm_stats.window_clients++;
+	}
+
+	return max3(adev->mm_stats.active_clients,
+		    adev->mm_stats.window_clients, 1u);
 }
 
 /* Returns how many bytes TTM can move right now. If no bytes can be moved,
  * it returns 0. If it returns non-zero, it's OK to move at least one buffer,
- * which means it can go over the threshold once. If that happens, the driver
+ * which means it can go over the threshold once. If that happens, the client
  * will be in debt and no other buffer migrations can be done until that debt
  * is repaid.
  *
@@ -291,13 +342,20 @@ static s64 bytes_to_us(struct amdgpu_device *adev, u64 bytes)
  * The currency is simply time in microseconds and it increases as the clock
  * ticks. The accumulated microseconds (us) are converted to bytes and
  * returned.
+ *
+ * Every client has its own budget. The clients which did moves during the
+ * last second share the device rate evenly, so a client thrashing VRAM only
+ * runs up its own debt and leaves the budget of everybody else alone.
  */
 static void amdgpu_cs_get_threshold_for_moves(struct amdgpu_device *adev,
+					      struct amdgpu_fpriv *fpriv,
 					      u64 *max_bytes,
 					      u64 *max_vis_bytes)
 {
-	s64 time_us, increment_us;
+	struct amdgpu_mm_budget *budget = amdgpu_cs_mm_budget(adev, fpriv);
+	s64 time_us, increment_us, upper_bound_us;
 	u64 free_vram, total_vram, used_vram;
+	u32 clients;
 	/* Allow a maximum of 200 accumulated ms. This is basically per-IB
 	 * throttling.
 	 *
@@ -319,15 +377,17 @@ static void amdgpu_cs_get_threshold_for_moves(struct amdgpu_device *adev,
 
 	spin_lock(&adev->mm_stats.lock);
 
-	/* Increase the amount of accumulated us. */
+	/* Increase the amount of accumulated us by this client's share. */
 	time_us = ktime_to_us(ktime_get());
-	increment_us = time_us - adev->mm_stats.last_update_us;
-	adev->mm_stats.last_update_us = time_us;
-	adev->mm_stats.accum_us = min(adev->mm_stats.accum_us + increment_us,
-				      us_upper_bound);
+	clients = amdgpu_cs_mm_active_clients(adev, budget, time_us);
+	increment_us = div_s64(time_us - budget->last_update_us, clients);
+	upper_bound_us = div_s64(us_upper_bound, clients);
+	budget->last_update_us = time_us;
+	budget->accum_us = min(budget->accum_us + increment_us,
+			       upper_bound_us);
 
 	/* This prevents the short period of low performance when the VRAM
-	 * usage is low and the driver is in debt or doesn't have enough
+	 * usage is low and the client is in debt or doesn't have enough
 	 * accumulated us to fill VRAM quickly.
 	 *
 	 * The situation can occur in these cases:
@@ -345,17 +405,18 @@ static void amdgpu_cs_get_threshold_for_moves(struct amdgpu_device *adev,
 		 * VRAM now.
 		 */
 		if (!(adev->flags & AMD_IS_APU))
-			min_us = bytes_to_us(adev, free_vram / 4);
+			min_us = div_s64(bytes_to_us(adev, free_vram / 4),
+					 clients);
 		else
 			min_us = 0; /* Reset accum_us on APUs. */
 
-		adev->mm_stats.accum_us = max(min_us, adev->mm_stats.accum_us);
+		budget->accum_us = max(min_us, budget->accum_us);
 	}
 
-	/* This is set to 0 if the driver is in debt to disallow (optional)
+	/* This is set to 0 if the client is in debt to disallow (optional)
 	 * buffer moves.
 	 */
-	*max_bytes = us_to_bytes(adev, adev->mm_stats.accum_us);
+	*max_bytes = us_to_bytes(adev, budget->accum_us);
 
 	/* Do the same for visible VRAM if half of it is free */
 	if (!amdgpu_gmc_vram_full_visible(&adev->gmc)) {
@@ -365,16 +426,17 @@ static void amdgpu_cs_get_threshold_for_moves(struct amdgpu_device *adev,
 
 		if (used_vis_vram < total_vis_vram) {
 			u64 free_vis_vram = total_vis_vram - used_vis_vram;
-			adev->mm_stats.accum_us_vis = min(adev->mm_stats.accum_us_vis +
-							  increment_us, us_upper_bound);
+			budget->accum_us_vis = min(budget->accum_us_vis +
+						   increment_us, upper_bound_us);
 
 			if (free_vis_vram >= total_vis_vram / 2)
-				adev->mm_stats.accum_us_vis =
-					max(bytes_to_us(adev, free_vis_vram / 2),
-					    adev->mm_stats.accum_us_vis);
+				budget->accum_us_vis =
+					max(div_s64(bytes_to_us(adev, free_vis_vram / 2),
+						    clients),
+					    budget->accum_us_vis);
 		}
 
-		*max_vis_bytes = us_to_bytes(adev, adev->mm_stats.accum_us_vis);
+		*max_vis_bytes = us_to_bytes(adev, budget->accum_us_vis);
 	} else {
 		*max_vis_bytes = 0;
 	}
@@ -384,17 +446,45 @@ static void amdgpu_cs_get_threshold_for_moves(struct amdgpu_device *adev,
 
 /* Report how many bytes have really been moved for the last command
  * submission. This can result in a debt that can stop buffer migrations
- * temporarily.
+ * of that client temporarily. Moves not done on behalf of a client are
+ * charged to the kernel budget, @fpriv is NULL for those.
  */
-void amdgpu_cs_report_moved_bytes(struct amdgpu_device *adev, u64 num_bytes,
+void amdgpu_cs_report_moved_bytes(struct amdgpu_device *adev,
+				  struct amdgpu_fpriv *fpriv, u64 num_bytes,
 				  u64 num_vis_bytes)
 {
+	struct amdgpu_mm_budget *budget = amdgpu_cs_mm_budget(adev, fpriv);
+
 	spin_lock(&adev->mm_stats.lock);
-	adev->mm_stats.accum_us -= bytes_to_us(adev, num_bytes);
-	adev->mm_stats.accum_us_vis -= bytes_to_us(adev, num_vis_bytes);
+	budget->accum_us -= bytes_to_us(adev, num_bytes);
+	budget->accum_us_vis -= bytes_to_us(adev, num_vis_bytes);
+	budget->bytes_moved += num_bytes;
+	budget->bytes_moved_vis += num_vis_bytes;
 	spin_unlock(&adev->mm_stats.lock);
 }
 
+/* Report how long the copy engine took for a buffer move. Used to keep a
+ * running average of the copy bandwidth which bounds the migration rate.
+ */
+void amdgpu_cs_report_move_rate(struct amdgpu_device *adev, u64 num_bytes,
+				u64 time_ns)
+{
+	u64 MBps, avg;
+
+	/* Ignore small moves, the setup overhead dominates them */
+	if (num_bytes < SZ_1M || !time_ns)
+		return;
+
+	/* bytes per us is roughly MB/s */
+	MBps = div64_u64(num_bytes * NSEC_PER_USEC, time_ns);
+	MBps = min_t(u64, MBps, U32_MAX);
+
+	/* Called from fence callbacks, races just lose a sample */
+	avg = READ_ONCE(adev->mm_stats.copy_MBps);
+	avg = avg ? (avg * 7 + MBps) / 8 : MBps;
+	WRITE_ONCE(adev->mm_stats.copy_MBps, avg);
+}
+
 static int amdgpu_cs_bo_validate(void *param, struct amdgpu_bo *bo)
 {
 	struct amdgpu_device *adev = amdgpu_ttm_adev(bo->tbo.bdev);
@@ -450,6 +540,29 @@ static int amdgpu_cs_bo_validate(void *param, struct amdgpu_bo *bo)
 	return r;
 }
 
+/*
+ * Check if a BO is still where a previous submission using the same BO list
+ * validated it to. Only BOs which ended up in their preferred domains are
+ * remembered, everything else gets another chance to be moved.
+ */
+static bool amdgpu_cs_entry_resident(struct amdgpu_bo_list_entry *e,
+				     struct amdgpu_bo *bo)
+{
+	return e->resident && e->resident_gen == bo->move_gen &&
+		e->resident_domains == bo->preferred_domains &&
+		!amdgpu_ttm_tt_is_userptr(bo->tbo.ttm);
+}
+
+static void amdgpu_cs_entry_set_resident(struct amdgpu_bo_list_entry *e,
+					 struct amdgpu_bo *bo)
+{
+	u32 domain = amdgpu_mem_type_to_domain(bo->tbo.resource->mem_type);
+
+	e->resident = !!(domain & bo->preferred_domains);
+	e->resident_domains = bo->preferred_domains;
+	e->resident_gen = bo->move_gen;
+}
+
 static int amdgpu_cs_list_validate(struct amdgpu_cs_parser *p,
 			    struct list_head *validated)
 {
@@ -461,6 +574,9 @@ static int amdgpu_cs_list_validate(struct amdgpu_cs_parser *p,
 		struct amdgpu_bo *bo = ttm_to_amdgpu_bo(lobj->tv.bo);
 		struct mm_struct *usermm;
 
+		if (amdgpu_cs_entry_resident(lobj, bo))
+			continue;
+
 		usermm = amdgpu_ttm_tt_get_usermm(bo->tbo.ttm);
 		if (usermm && usermm != current->mm)
 			return -EPERM;
@@ -478,9 +594,12 @@ static int amdgpu_cs_list_validate(struct amdgpu_cs_parser *p,
 		}
 
 		r = amdgpu_cs_bo_validate(p, bo);
-		if (r)
+		if (r) {
+			lobj->resident = false;
 			return r;
+		}
 
+		amdgpu_cs_entry_set_resident(lobj, bo);
 		kvfree(lobj->user_pages);
 		lobj->user_pages = NULL;
 	}
@@ -585,7 +704,8 @@ static int amdgpu_cs_parser_bos(struct amdgpu_cs_parser *p,
 		}
 	}
 
-	amdgpu_cs_get_threshold_for_moves(p->adev, &p->bytes_moved_threshold,
+	amdgpu_cs_get_threshold_for_moves(p->adev, fpriv,
+					  &p->bytes_moved_threshold,
 					  &p->bytes_moved_vis_threshold);
 	p->bytes_moved = 0;
 	p->bytes_moved_vis = 0;
@@ -605,7 +725,7 @@ static int amdgpu_cs_parser_bos(struct amdgpu_cs_parser *p,
 	if (r)
 		goto error_validate;
 
-	amdgpu_cs_report_moved_bytes(p->adev, p->bytes_moved,
+	amdgpu_cs_report_moved_bytes(p->adev, fpriv, p->bytes_moved,
 				     p->bytes_moved_vis);
 
 	gds = p->bo_list->gds_obj;
@@ -944,6 +1064,7 @@ static int amdgpu_cs_ib_fill(struct amdgpu_device *adev,
 	if (parser->job->uf_addr && ring->funcs->no_user_fence)
 		return -EINVAL;
 
+	amdgpu_ctx_rebalance_entity(parser->ctx, parser->entity);
 	return amdgpu_ctx_wait_prev_fence(parser->ctx, parser->entity);
 }
 
@@ -1209,7 +1330,9 @@ static int amdgpu_cs_submit(struct amdgpu_cs_parser *p,
 {
 	struct amdgpu_fpriv *fpriv = p->filp->driver_priv;
 	struct drm_sched_entity *entity = p->entity;
+	enum drm_sched_priority priority;
 	struct amdgpu_bo_list_entry *e;
+	struct amdgpu_ring *ring;
 	struct amdgpu_job *job;
 	uint64_t seq;
 	int r;
@@ -1260,7 +1383,12 @@ static int amdgpu_cs_submit(struct amdgpu_cs_parser *p,
 
 	trace_amdgpu_cs_ioctl(job);
 	amdgpu_vm_bo_trace_cs(&fpriv->vm, &p->ticket);
+	ring = to_amdgpu_ring(job->base.sched);
+	priority = job->base.s_priority;
 	drm_sched_entity_push_job(&job->base);
+	amdgpu_ring_preempt_schedule(ring, priority);
+	atomic64_inc(&p->adev->num_submissions);
+	atomic64_inc(&fpriv->vm.submissions);
 
 	amdgpu_vm_move_to_lru_tail(p->adev, &fpriv->vm);
 
@@ -1386,6 +1514,7 @@ int amdgpu_cs_wait_ioctl(struct drm_device *dev, void *data,
 	struct dma_fence *fence;
 	long r;
 
+	atomic64_inc(&drm_to_adev(dev)->num_fence_waits);
 	ctx = amdgpu_ctx_get(filp->driver_priv, wait->in.ctx_id);
 	if (ctx == NULL)
 		return -EINVAL;
@@ -1637,6 +1766,8 @@ int amdgpu_cs_wait_fences_ioctl(struct drm_device *dev, void *data,
 	struct drm_amdgpu_fence *fences;
 	int r;
 
+	atomic64_inc(&adev->num_fence_waits);
+
 	/* Get the fences from userspace */
 	fences = kmalloc_array(fence_count, sizeof(struct drm_amdgpu_fence),
 			GFP_KERNEL);
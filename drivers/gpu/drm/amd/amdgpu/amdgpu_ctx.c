@@ -161,6 +161,91 @@ static unsigned int amdgpu_ctx_get_hw_prio(struct amdgpu_ctx *ctx, u32 hw_ip)
 	return hw_prio;
 }
 
+/* Load of the engine instance behind @sched, rings sharing a score share it */
+static u64 amdgpu_ctx_sched_load(struct amdgpu_device *adev,
+				 struct drm_gpu_scheduler *sched)
+{
+	u64 load = 0;
+	int i;
+
+	for (i = 0; i < adev->num_rings; i++) {
+		struct amdgpu_ring *ring = adev->rings[i];
+
+		if (ring && ring->sched.score == sched->score)
+			load += atomic64_read(&ring->sched_load);
+	}
+
+	return load;
+}
+
+/*
+ * Like drm_sched_pick_best(), but weighs the entities bound to each instance
+ * by the measured engine time of their jobs instead of counting them.
+ */
+static struct drm_gpu_scheduler *
+amdgpu_ctx_pick_sched(struct amdgpu_device *adev,
+		      struct drm_gpu_scheduler **scheds,
+		      unsigned int num_scheds)
+{
+	struct drm_gpu_scheduler *best = NULL;
+	u64 load, best_load = U64_MAX;
+	int score, best_score = INT_MAX;
+	unsigned int i;
+
+	for (i = 0; i < num_scheds; i++) {
+		struct drm_gpu_scheduler *sched = scheds[i];
+
+		if (!sched->ready)
+			continue;
+
+		load = amdgpu_ctx_sched_load(adev, sched);
+		score = atomic_read(sched->score);
+		if (load < best_load ||
+		    (load == best_load && score < best_score)) {
+			best = sched;
+			best_load = load;
+			best_score = score;
+		}
+	}
+
+	return best;
+}
+
+static void amdgpu_ctx_bind_sched(struct amdgpu_ctx_entity *centity,
+				  struct drm_gpu_scheduler *sched)
+{
+	struct amdgpu_ring *ring = to_amdgpu_ring(sched);
+
+	centity->sched = sched;
+	atomic64_add(centity->job_cost, &ring->sched_load);
+	atomic_inc(&ring->sched_entities);
+}
+
+static void amdgpu_ctx_unbind_sched(struct amdgpu_ctx_entity *centity)
+{
+	struct amdgpu_ring *ring;
+
+	if (!centity->sched)
+		return;
+
+	ring = to_amdgpu_ring(centity->sched);
+	atomic64_sub(centity->job_cost, &ring->sched_load);
+	atomic_dec(&ring->sched_entities);
+	centity->sched = NULL;
+}
+
+/* New entities start out with the average cost of the ones already there */
+static u64 amdgpu_ctx_initial_job_cost(struct drm_gpu_scheduler *sched)
+{
+	struct amdgpu_ring *ring = to_amdgpu_ring(sched);
+	int n = atomic_read(&ring->sched_entities);
+
+	if (n <= 0)
+		return AMDGPU_CTX_DEFAULT_JOB_COST;
+
+	return div_u64(atomic64_read(&ring->sched_load), n) ?:
+		AMDGPU_CTX_DEFAULT_JOB_COST;
+}
 
 static int amdgpu_ctx_init_entity(struct amdgpu_ctx *ctx, u32 hw_ip,
 				  const u32 ring)
@@ -181,6 +266,8 @@ static int amdgpu_ctx_init_entity(struct amdgpu_ctx *ctx, u32 hw_ip,
 
 	ctx_prio = (ctx->override_priority == AMDGPU_CTX_PRIORITY_UNSET) ?
 			ctx->init_priority : ctx->override_priority;
+	entity->hw_ip = hw_ip;
+	entity->ring = ring;
 	entity->sequence = 1;
 	hw_prio = amdgpu_ctx_get_hw_prio(ctx, hw_ip);
 	drm_prio = amdgpu_ctx_to_drm_sched_prio(ctx_prio);
@@ -194,7 +281,7 @@ static int amdgpu_ctx_init_entity(struct amdgpu_ctx *ctx, u32 hw_ip,
 	    hw_ip == AMDGPU_HW_IP_VCN_DEC ||
 	    hw_ip == AMDGPU_HW_IP_UVD_ENC ||
 	    hw_ip == AMDGPU_HW_IP_UVD) {
-		sched = drm_sched_pick_best(scheds, num_scheds);
+		sched = amdgpu_ctx_pick_sched(adev, scheds, num_scheds);
 		scheds = &sched;
 		num_scheds = 1;
 	}
@@ -204,6 +291,11 @@ static int amdgpu_ctx_init_entity(struct amdgpu_ctx *ctx, u32 hw_ip,
 	if (r)
 		goto error_free_entity;
 
+	if (sched) {
+		entity->job_cost = amdgpu_ctx_initial_job_cost(sched);
+		amdgpu_ctx_bind_sched(entity, sched);
+	}
+
 	ctx->entities[hw_ip][ring] = entity;
 	return 0;
 
@@ -214,6 +306,7 @@ static int amdgpu_ctx_init_entity(struct amdgpu_ctx *ctx, u32 hw_ip,
 }
 
 static int amdgpu_ctx_init(struct amdgpu_device *adev,
+			   struct amdgpu_ctx_mgr *mgr,
 			   int32_t priority,
 			   struct drm_file *filp,
 			   struct amdgpu_ctx *ctx)
@@ -226,6 +319,7 @@ static int amdgpu_ctx_init(struct amdgpu_device *adev,
 
 	memset(ctx, 0, sizeof(*ctx));
 
+	ctx->mgr = mgr;
 	ctx->adev = adev;
 
 	kref_init(&ctx->refcount);
@@ -241,16 +335,70 @@ static int amdgpu_ctx_init(struct amdgpu_device *adev,
 	return 0;
 }
 
-static void amdgpu_ctx_fini_entity(struct amdgpu_ctx_entity *entity)
+/* Engine time used by a job so far, from the scheduler fence timestamps */
+static ktime_t amdgpu_ctx_fence_runtime(struct dma_fence *fence)
+{
+	struct drm_sched_fence *s_fence;
+
+	if (!fence)
+		return ns_to_ktime(0);
+
+	s_fence = to_drm_sched_fence(fence);
+	if (!test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &s_fence->scheduled.flags))
+		return ns_to_ktime(0);
+
+	if (!test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &s_fence->finished.flags))
+		return ktime_sub(ktime_get(), s_fence->scheduled.timestamp);
+
+	return ktime_sub(s_fence->finished.timestamp,
+			 s_fence->scheduled.timestamp);
+}
+
+/*
+ * Account the engine time of a job to the ring it ran on, and fold it into the
+ * per job cost of entities bound to one instance.
+ */
+static void amdgpu_ctx_update_job_cost(struct amdgpu_ctx_entity *centity,
+				       struct dma_fence *fence,
+				       ktime_t runtime)
 {
+	u64 ns = ktime_to_ns(runtime), cost;
+	struct amdgpu_ring *ring;
+
+	if (!fence || !ns)
+		return;
+
+	ring = to_amdgpu_ring(to_drm_sched_fence(fence)->sched);
+	atomic64_add(ns, &ring->busy_ns);
+
+	if (!centity->sched)
+		return;
+
+	cost = centity->job_cost - (centity->job_cost >> 3) + (ns >> 3);
+	atomic64_add(cost - centity->job_cost,
+		     &to_amdgpu_ring(centity->sched)->sched_load);
+	centity->job_cost = cost;
+}
 
+static void amdgpu_ctx_fini_entity(struct amdgpu_ctx *ctx,
+				   struct amdgpu_ctx_entity *entity)
+{
+	ktime_t spend = ns_to_ktime(0), runtime;
 	int i;
 
 	if (!entity)
 		return;
 
-	for (i = 0; i < amdgpu_sched_jobs; ++i)
+	for (i = 0; i < amdgpu_sched_jobs; ++i) {
+		runtime = amdgpu_ctx_fence_runtime(entity->fences[i]);
+		amdgpu_ctx_update_job_cost(entity, entity->fences[i], runtime);
+		spend = ktime_add(spend, runtime);
 		dma_fence_put(entity->fences[i]);
+	}
+	amdgpu_ctx_unbind_sched(entity);
+
+	atomic64_add(ktime_to_ns(spend),
+		     &ctx->mgr->time_spend[entity->hw_ip][entity->ring]);
 
 	kfree(entity);
 }
@@ -266,7 +414,7 @@ static void amdgpu_ctx_fini(struct kref *ref)
 
 	for (i = 0; i < AMDGPU_HW_IP_NUM; ++i) {
 		for (j = 0; j < AMDGPU_MAX_ENTITY_NUM; ++j) {
-			amdgpu_ctx_fini_entity(ctx->entities[i][j]);
+			amdgpu_ctx_fini_entity(ctx, ctx->entities[i][j]);
 			ctx->entities[i][j] = NULL;
 		}
 	}
@@ -329,7 +477,7 @@ static int amdgpu_ctx_alloc(struct amdgpu_device *adev,
 	}
 
 	*id = (uint32_t)r;
-	r = amdgpu_ctx_init(adev, priority, filp, ctx);
+	r = amdgpu_ctx_init(adev, mgr, priority, filp, ctx);
 	if (r) {
 		idr_remove(&mgr->ctx_handles, *id);
 		*id = 0;
@@ -542,6 +690,7 @@ void amdgpu_ctx_add_fence(struct amdgpu_ctx *ctx,
 	uint64_t seq = centity->sequence;
 	struct dma_fence *other = NULL;
 	unsigned idx = 0;
+	ktime_t runtime;
 
 	idx = seq & (amdgpu_sched_jobs - 1);
 	other = centity->fences[idx];
@@ -555,6 +704,12 @@ void amdgpu_ctx_add_fence(struct amdgpu_ctx *ctx,
 	centity->sequence++;
 	spin_unlock(&ctx->ring_lock);
 
+	runtime = amdgpu_ctx_fence_runtime(other);
+	amdgpu_ctx_update_job_cost(centity, other, runtime);
+	atomic64_add(ktime_to_ns(runtime),
+		     &ctx->mgr->time_spend[centity->hw_ip][centity->ring]);
+	atomic64_inc(&ctx->mgr->submissions[centity->hw_ip][centity->ring]);
+
 	dma_fence_put(other);
 	if (handle)
 		*handle = seq;
@@ -659,10 +814,95 @@ int amdgpu_ctx_wait_prev_fence(struct amdgpu_ctx *ctx,
 	return r;
 }
 
+/**
+ * amdgpu_ctx_rebalance_entity - move an idle video entity to another instance
+ * @ctx: the context, locked by the caller
+ * @entity: the entity about to get a new job
+ *
+ * Video entities stay on the instance picked when they were created. Once one
+ * was idle for amdgpu_sched_rebalance_ms and another instance would still carry
+ * less load after taking it over, the next job of the entity goes there.
+ */
+void amdgpu_ctx_rebalance_entity(struct amdgpu_ctx *ctx,
+				 struct drm_sched_entity *entity)
+{
+	struct amdgpu_ctx_entity *centity = to_amdgpu_ctx_entity(entity);
+	struct amdgpu_device *adev = ctx->adev;
+	struct drm_gpu_scheduler *sched;
+	struct dma_fence *fence;
+	unsigned int hw_prio;
+	bool idle;
+
+	if (!amdgpu_sched_rebalance_ms || !centity->sched || centity->pinned)
+		return;
+
+	if (spsc_queue_count(&entity->job_queue))
+		return;
+
+	fence = amdgpu_ctx_get_fence(ctx, entity, ~0ull);
+	if (IS_ERR_OR_NULL(fence))
+		return;
+
+	idle = test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &fence->flags) &&
+	       ktime_ms_delta(ktime_get(), fence->timestamp) >=
+	       amdgpu_sched_rebalance_ms;
+	dma_fence_put(fence);
+	if (!idle)
+		return;
+
+	hw_prio = amdgpu_ctx_get_hw_prio(ctx, centity->hw_ip);
+	sched = amdgpu_ctx_pick_sched(adev,
+			adev->gpu_sched[centity->hw_ip][hw_prio].sched,
+			adev->gpu_sched[centity->hw_ip][hw_prio].num_scheds);
+	if (!sched || sched->score == centity->sched->score)
+		return;
+
+	if (amdgpu_ctx_sched_load(adev, sched) + centity->job_cost >=
+	    amdgpu_ctx_sched_load(adev, centity->sched))
+		return;
+
+	amdgpu_ctx_unbind_sched(centity);
+	amdgpu_ctx_bind_sched(centity, sched);
+	drm_sched_entity_modify_sched(entity, &centity->sched, 1);
+}
+
+/**
+ * amdgpu_ctx_pin_entity - bind an entity to the first scheduler of @scheds
+ * @entity: the entity
+ * @scheds: list of schedulers, only the first one is used
+ *
+ * For jobs only one instance can handle, e.g. codecs not supported by all VCN
+ * instances. The entity then stays there regardless of the load.
+ */
+void amdgpu_ctx_pin_entity(struct drm_sched_entity *entity,
+			   struct drm_gpu_scheduler **scheds)
+{
+	struct amdgpu_ctx_entity *centity = to_amdgpu_ctx_entity(entity);
+
+	centity->pinned = true;
+	if (!centity->sched) {
+		drm_sched_entity_modify_sched(entity, scheds, 1);
+		return;
+	}
+
+	amdgpu_ctx_unbind_sched(centity);
+	amdgpu_ctx_bind_sched(centity, scheds[0]);
+	drm_sched_entity_modify_sched(entity, &centity->sched, 1);
+}
+
 void amdgpu_ctx_mgr_init(struct amdgpu_ctx_mgr *mgr)
 {
+	unsigned int i, j;
+
 	mutex_init(&mgr->lock);
 	idr_init(&mgr->ctx_handles);
+
+	for (i = 0; i < AMDGPU_HW_IP_NUM; ++i) {
+		for (j = 0; j < AMDGPU_MAX_ENTITY_NUM; ++j) {
+			atomic64_set(&mgr->time_spend[i][j], 0);
+			atomic64_set(&mgr->submissions[i][j], 0);
+		}
+	}
 }
 
 long amdgpu_ctx_mgr_entity_flush(struct amdgpu_ctx_mgr *mgr, long timeout)
@@ -815,3 +1055,51 @@ ktime_t amdgpu_ctx_mgr_fence_usage(struct amdgpu_ctx_mgr *mgr, uint32_t hwip,
 
 	return total;
 }
+
+/**
+ * amdgpu_ctx_mgr_usage - cumulative engine time of a client
+ *
+ * @mgr: the client's context manager
+ * @usage: resulting engine time per HW IP and ring
+ *
+ * Sums up the engine time of all jobs ever submitted through @mgr, including
+ * the jobs still running. The time accumulates from the scheduler fence
+ * timestamps when fences are retired from a ctx, so the submission path
+ * doesn't need any extra locking.
+ */
+void amdgpu_ctx_mgr_usage(struct amdgpu_ctx_mgr *mgr,
+			  ktime_t usage[AMDGPU_HW_IP_NUM][AMDGPU_MAX_ENTITY_NUM])
+{
+	struct amdgpu_ctx *ctx;
+	unsigned int hw_ip, i;
+	uint32_t id;
+
+	for (hw_ip = 0; hw_ip < AMDGPU_HW_IP_NUM; ++hw_ip)
+		for (i = 0; i < AMDGPU_MAX_ENTITY_NUM; ++i)
+			usage[hw_ip][i] =
+				ns_to_ktime(atomic64_read(&mgr->time_spend[hw_ip][i]));
+
+	mutex_lock(&mgr->lock);
+	idr_for_each_entry(&mgr->ctx_handles, ctx, id) {
+		for (hw_ip = 0; hw_ip < AMDGPU_HW_IP_NUM; ++hw_ip) {
+			for (i = 0; i < amdgpu_ctx_num_entities[hw_ip]; ++i) {
+				struct amdgpu_ctx_entity *centity;
+				ktime_t spend;
+				unsigned int j;
+
+				centity = ctx->entities[hw_ip][i];
+				if (!centity)
+					continue;
+
+				spend = ns_to_ktime(0);
+				spin_lock(&ctx->ring_lock);
+				for (j = 0; j < amdgpu_sched_jobs; ++j)
+					spend = ktime_add(spend,
+						amdgpu_ctx_fence_runtime(centity->fences[j]));
+				spin_unlock(&ctx->ring_lock);
+				usage[hw_ip][i] = ktime_add(usage[hw_ip][i], spend);
+			}
+		}
+	}
+	mutex_unlock(&mgr->lock);
+}
@@ -31,15 +31,26 @@ struct amdgpu_fpriv;
 
 #define AMDGPU_MAX_ENTITY_NUM 4
 #define AMDGPU_CTX_FENCE_USAGE_MIN_RATIO(max, total) ((max) > 16384ULL*(total))
+/* initial per job cost of an entity, until its own jobs were measured */
+#define AMDGPU_CTX_DEFAULT_JOB_COST	NSEC_PER_MSEC
 
 struct amdgpu_ctx_entity {
+	uint32_t		hw_ip;
+	uint32_t		ring;
 	uint64_t		sequence;
+	/* scheduler of HW IPs without load balance across instances */
+	struct drm_gpu_scheduler *sched;
+	/* moving average of the engine time per job, in ns */
+	uint64_t		job_cost;
+	/* never moved to another instance by the load balancing */
+	bool			pinned;
 	struct drm_sched_entity	entity;
 	struct dma_fence	*fences[];
 };
 
 struct amdgpu_ctx {
 	struct kref			refcount;
+	struct amdgpu_ctx_mgr		*mgr;
 	struct amdgpu_device		*adev;
 	unsigned			reset_counter;
 	unsigned			reset_counter_query;
@@ -60,6 +71,9 @@ struct amdgpu_ctx_mgr {
 	struct mutex		lock;
 	/* protected by lock */
 	struct idr		ctx_handles;
+	/* engine time of fences no longer tracked by a ctx, in ns */
+	atomic64_t		time_spend[AMDGPU_HW_IP_NUM][AMDGPU_MAX_ENTITY_NUM];
+	atomic64_t		submissions[AMDGPU_HW_IP_NUM][AMDGPU_MAX_ENTITY_NUM];
 };
 
 extern const unsigned int amdgpu_ctx_num_entities[AMDGPU_HW_IP_NUM];
@@ -83,6 +97,10 @@ int amdgpu_ctx_ioctl(struct drm_device *dev, void *data,
 
 int amdgpu_ctx_wait_prev_fence(struct amdgpu_ctx *ctx,
 			       struct drm_sched_entity *entity);
+void amdgpu_ctx_rebalance_entity(struct amdgpu_ctx *ctx,
+				 struct drm_sched_entity *entity);
+void amdgpu_ctx_pin_entity(struct drm_sched_entity *entity,
+			   struct drm_gpu_scheduler **scheds);
 
 void amdgpu_ctx_mgr_init(struct amdgpu_ctx_mgr *mgr);
 void amdgpu_ctx_mgr_entity_fini(struct amdgpu_ctx_mgr *mgr);
@@ -90,4 +108,6 @@ long amdgpu_ctx_mgr_entity_flush(struct amdgpu_ctx_mgr *mgr, long timeout);
 void amdgpu_ctx_mgr_fini(struct amdgpu_ctx_mgr *mgr);
 ktime_t amdgpu_ctx_mgr_fence_usage(struct amdgpu_ctx_mgr *mgr, uint32_t hwip,
 		uint32_t idx, uint64_t *elapsed);
+void amdgpu_ctx_mgr_usage(struct amdgpu_ctx_mgr *mgr,
+			  ktime_t usage[AMDGPU_HW_IP_NUM][AMDGPU_MAX_ENTITY_NUM]);
 #endif
@@ -1287,9 +1287,9 @@ static int amdgpu_debugfs_test_ib_show(struct seq_file *m, void *unused)
 	for (i = 0; i < AMDGPU_MAX_RINGS; i++) {
 		struct amdgpu_ring *ring = adev->rings[i];
 
-		if (!ring || !ring->sched.thread)
+		if (!ring || !drm_sched_wqueue_ready(&ring->sched))
 			continue;
-		kthread_park(ring->sched.thread);
+		drm_sched_wqueue_stop(&ring->sched);
 	}
 
 	seq_printf(m, "run ib test:\n");
@@ -1303,9 +1303,9 @@ static int amdgpu_debugfs_test_ib_show(struct seq_file *m, void *unused)
 	for (i = 0; i < AMDGPU_MAX_RINGS; i++) {
 		struct amdgpu_ring *ring = adev->rings[i];
 
-		if (!ring || !ring->sched.thread)
+		if (!ring || !drm_sched_wqueue_ready(&ring->sched))
 			continue;
-		kthread_unpark(ring->sched.thread);
+		drm_sched_wqueue_start(&ring->sched);
 	}
 
 	up_write(&adev->reset_sem);
@@ -1336,6 +1336,25 @@ static int amdgpu_debugfs_evict_vram(void *data, u64 *val)
 	return 0;
 }
 
+static int amdgpu_debugfs_compact_vram(void *data, u64 *val)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)data;
+	struct drm_device *dev = adev_to_drm(adev);
+	int r;
+
+	r = pm_runtime_get_sync(dev->dev);
+	if (r < 0) {
+		pm_runtime_put_autosuspend(dev->dev);
+		return r;
+	}
+
+	*val = amdgpu_vram_mgr_compact(&adev->mman.vram_mgr, U64_MAX);
+
+	pm_runtime_mark_last_busy(dev->dev);
+	pm_runtime_put_autosuspend(dev->dev);
+
+	return 0;
+}
 
 static int amdgpu_debugfs_evict_gtt(void *data, u64 *val)
 {
@@ -1387,187 +1406,131 @@ static int amdgpu_debugfs_vm_info_show(struct seq_file *m, void *unused)
 	return r;
 }
 
-DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_test_ib);
-DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_vm_info);
-DEFINE_DEBUGFS_ATTRIBUTE(amdgpu_evict_vram_fops, amdgpu_debugfs_evict_vram,
-			 NULL, "%lld\n");
-DEFINE_DEBUGFS_ATTRIBUTE(amdgpu_evict_gtt_fops, amdgpu_debugfs_evict_gtt,
-			 NULL, "%lld\n");
-
-static void amdgpu_ib_preempt_fences_swap(struct amdgpu_ring *ring,
-					  struct dma_fence **fences)
+/*
+ * Duration of the last run of each phase of the IP blocks in us, to see
+ * where device init, suspend and resume spend their time.
+ */
+static int amdgpu_debugfs_ip_timing_show(struct seq_file *m, void *unused)
 {
-	struct amdgpu_fence_driver *drv = &ring->fence_drv;
-	uint32_t sync_seq, last_seq;
+	struct amdgpu_device *adev = (struct amdgpu_device *)m->private;
+	int i;
 
-	last_seq = atomic_read(&ring->fence_drv.last_seq);
-	sync_seq = ring->fence_drv.sync_seq;
+	seq_printf(m, "%-16s %10s %10s %10s %10s %10s\n", "ip", "sw_init",
+		   "hw_init", "late_init", "suspend", "resume");
+	for (i = 0; i < adev->num_ip_blocks; i++) {
+		struct amdgpu_ip_block *ip_block = &adev->ip_blocks[i];
 
-	last_seq &= drv->num_fences_mask;
-	sync_seq &= drv->num_fences_mask;
+		if (!ip_block->status.valid)
+			continue;
 
-	do {
-		struct dma_fence *fence, **ptr;
+		seq_printf(m, "%-16s %10u %10u %10u %10u %10u\n",
+			   ip_block->version->funcs->name,
+			   ip_block->phase_us[AMDGPU_IP_PHASE_SW_INIT],
+			   ip_block->phase_us[AMDGPU_IP_PHASE_HW_INIT],
+			   ip_block->phase_us[AMDGPU_IP_PHASE_LATE_INIT],
+			   ip_block->phase_us[AMDGPU_IP_PHASE_SUSPEND],
+			   ip_block->phase_us[AMDGPU_IP_PHASE_RESUME]);
+	}
 
-		++last_seq;
-		last_seq &= drv->num_fences_mask;
-		ptr = &drv->fences[last_seq];
+	return 0;
+}
 
-		fence = rcu_dereference_protected(*ptr, 1);
-		RCU_INIT_POINTER(*ptr, NULL);
+DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_test_ib);
+DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_vm_info);
+DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_ip_timing);
 
-		if (!fence)
-			continue;
+/* Duration of the stages of the last GPU recovery in us */
+static int amdgpu_debugfs_reset_timing_show(struct seq_file *m, void *unused)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)m->private;
+	struct amdgpu_reset_timing *t = &adev->reset_timing;
 
-		fences[last_seq] = fence;
+	seq_printf(m, "asic_reset:   %u\n", t->asic_reset_us);
+	seq_printf(m, "resume:       %u\n", t->resume_us);
+	seq_printf(m, "late_init:    %u\n", t->late_init_us);
+	seq_printf(m, "ib_test:      %u\n", t->ib_test_us);
+	seq_printf(m, "recover_vram: %u\n", t->recover_vram_us);
 
-	} while (last_seq != sync_seq);
+	return 0;
 }
 
-static void amdgpu_ib_preempt_signal_fences(struct dma_fence **fences,
-					    int length)
+DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_reset_timing);
+
+/* Load and engine time of the multimedia rings, for the instance selection */
+static int amdgpu_debugfs_sched_load_show(struct seq_file *m, void *unused)
 {
+	struct amdgpu_device *adev = (struct amdgpu_device *)m->private;
 	int i;
-	struct dma_fence *fence;
 
-	for (i = 0; i < length; i++) {
-		fence = fences[i];
-		if (!fence)
+	seq_printf(m, "%-16s %8s %12s %8s %16s\n", "ring", "entities",
+		   "load_us", "score", "busy_us");
+	for (i = 0; i < adev->num_rings; i++) {
+		struct amdgpu_ring *ring = adev->rings[i];
+
+		if (!ring || !ring->sched.ready)
 			continue;
-		dma_fence_signal(fence);
-		dma_fence_put(fence);
-	}
-}
 
-static void amdgpu_ib_preempt_job_recovery(struct drm_gpu_scheduler *sched)
-{
-	struct drm_sched_job *s_job;
-	struct dma_fence *fence;
+		switch (ring->funcs->type) {
+		case AMDGPU_RING_TYPE_UVD:
+		case AMDGPU_RING_TYPE_UVD_ENC:
+		case AMDGPU_RING_TYPE_VCN_DEC:
+		case AMDGPU_RING_TYPE_VCN_ENC:
+		case AMDGPU_RING_TYPE_VCN_JPEG:
+			break;
+		default:
+			continue;
+		}
 
-	spin_lock(&sched->job_list_lock);
-	list_for_each_entry(s_job, &sched->pending_list, list) {
-		fence = sched->ops->run_job(s_job);
-		dma_fence_put(fence);
+		seq_printf(m, "%-16s %8d %12llu %8d %16llu\n", ring->name,
+			   atomic_read(&ring->sched_entities),
+			   div_u64(atomic64_read(&ring->sched_load),
+				   NSEC_PER_USEC),
+			   atomic_read(ring->sched.score),
+			   div_u64(atomic64_read(&ring->busy_ns),
+				   NSEC_PER_USEC));
 	}
-	spin_unlock(&sched->job_list_lock);
+
+	return 0;
 }
 
-static void amdgpu_ib_preempt_mark_partial_job(struct amdgpu_ring *ring)
+DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_sched_load);
+
+/* DMA-buf mappings handed out to other devices, P2P or through system memory */
+static int amdgpu_debugfs_dma_buf_stats_show(struct seq_file *m, void *unused)
 {
-	struct amdgpu_job *job;
-	struct drm_sched_job *s_job, *tmp;
-	uint32_t preempt_seq;
-	struct dma_fence *fence, **ptr;
-	struct amdgpu_fence_driver *drv = &ring->fence_drv;
-	struct drm_gpu_scheduler *sched = &ring->sched;
-	bool preempted = true;
-
-	if (ring->funcs->type != AMDGPU_RING_TYPE_GFX)
-		return;
-
-	preempt_seq = le32_to_cpu(*(drv->cpu_addr + 2));
-	if (preempt_seq <= atomic_read(&drv->last_seq)) {
-		preempted = false;
-		goto no_preempt;
-	}
+	struct amdgpu_device *adev = (struct amdgpu_device *)m->private;
+	struct amdgpu_dma_buf_stats *s = &adev->dma_buf_stats;
 
-	preempt_seq &= drv->num_fences_mask;
-	ptr = &drv->fences[preempt_seq];
-	fence = rcu_dereference_protected(*ptr, 1);
-
-no_preempt:
-	spin_lock(&sched->job_list_lock);
-	list_for_each_entry_safe(s_job, tmp, &sched->pending_list, list) {
-		if (dma_fence_is_signaled(&s_job->s_fence->finished)) {
-			/* remove job from ring_mirror_list */
-			list_del_init(&s_job->list);
-			sched->ops->free_job(s_job);
-			continue;
-		}
-		job = to_amdgpu_job(s_job);
-		if (preempted && (&job->hw_fence) == fence)
-			/* mark the job as preempted */
-			job->preemption_status |= AMDGPU_IB_PREEMPTED;
-	}
-	spin_unlock(&sched->job_list_lock);
+	seq_printf(m, "p2p maps:      %lld\n", atomic64_read(&s->p2p_maps));
+	seq_printf(m, "p2p bytes:     %lld\n", atomic64_read(&s->p2p_bytes));
+	seq_printf(m, "sysmem maps:   %lld\n", atomic64_read(&s->sysmem_maps));
+	seq_printf(m, "sysmem bytes:  %lld\n", atomic64_read(&s->sysmem_bytes));
+	seq_printf(m, "cached maps:   %lld\n", atomic64_read(&s->cache_hits));
+
+	return 0;
 }
 
+DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_dma_buf_stats);
+DEFINE_DEBUGFS_ATTRIBUTE(amdgpu_evict_vram_fops, amdgpu_debugfs_evict_vram,
+			 NULL, "%lld\n");
+DEFINE_DEBUGFS_ATTRIBUTE(amdgpu_evict_gtt_fops, amdgpu_debugfs_evict_gtt,
+			 NULL, "%lld\n");
+DEFINE_DEBUGFS_ATTRIBUTE(amdgpu_compact_vram_fops, amdgpu_debugfs_compact_vram,
+			 NULL, "%lld\n");
+
 static int amdgpu_debugfs_ib_preempt(void *data, u64 val)
 {
-	int r, resched, length;
-	struct amdgpu_ring *ring;
-	struct dma_fence **fences = NULL;
 	struct amdgpu_device *adev = (struct amdgpu_device *)data;
+	struct amdgpu_ring *ring;
 
 	if (val >= AMDGPU_MAX_RINGS)
 		return -EINVAL;
 
 	ring = adev->rings[val];
-
-	if (!ring || !ring->funcs->preempt_ib || !ring->sched.thread)
+	if (!ring)
 		return -EINVAL;
 
-	/* the last preemption failed */
-	if (ring->trail_seq != le32_to_cpu(*ring->trail_fence_cpu_addr))
-		return -EBUSY;
-
-	length = ring->fence_drv.num_fences_mask + 1;
-	fences = kcalloc(length, sizeof(void *), GFP_KERNEL);
-	if (!fences)
-		return -ENOMEM;
-
-	/* Avoid accidently unparking the sched thread during GPU reset */
-	r = down_read_killable(&adev->reset_sem);
-	if (r)
-		goto pro_end;
-
-	/* stop the scheduler */
-	kthread_park(ring->sched.thread);
-
-	resched = ttm_bo_lock_delayed_workqueue(&adev->mman.bdev);
-
-	/* preempt the IB */
-	r = amdgpu_ring_preempt_ib(ring);
-	if (r) {
-		DRM_WARN("failed to preempt ring %d\n", ring->idx);
-		goto failure;
-	}
-
-	amdgpu_fence_process(ring);
-
-	if (atomic_read(&ring->fence_drv.last_seq) !=
-	    ring->fence_drv.sync_seq) {
-		DRM_INFO("ring %d was preempted\n", ring->idx);
-
-		amdgpu_ib_preempt_mark_partial_job(ring);
-
-		/* swap out the old fences */
-		amdgpu_ib_preempt_fences_swap(ring, fences);
-
-		amdgpu_fence_driver_force_completion(ring);
-
-		/* resubmit unfinished jobs */
-		amdgpu_ib_preempt_job_recovery(&ring->sched);
-
-		/* wait for jobs finished */
-		amdgpu_fence_wait_empty(ring);
-
-		/* signal the old fences */
-		amdgpu_ib_preempt_signal_fences(fences, length);
-	}
-
-failure:
-	/* restart the scheduler */
-	kthread_unpark(ring->sched.thread);
-
-	up_read(&adev->reset_sem);
-
-	ttm_bo_unlock_delayed_workqueue(&adev->mman.bdev, resched);
-
-pro_end:
-	kfree(fences);
-
-	return r;
+	return amdgpu_ring_preempt(ring, false);
 }
 
 static int amdgpu_debugfs_sclk_set(void *data, u64 val)
@@ -1639,7 +1602,9 @@ int amdgpu_debugfs_init(struct amdgpu_device *adev)
 	amdgpu_ttm_debugfs_init(adev);
 	amdgpu_debugfs_pm_init(adev);
 	amdgpu_debugfs_sa_init(adev);
+	amdgpu_debugfs_irq_init(adev);
 	amdgpu_debugfs_fence_init(adev);
+	amdgpu_debugfs_benchmark_init(adev);
 	amdgpu_debugfs_gem_init(adev);
 
 	r = amdgpu_debugfs_regs_init(adev);
@@ -1664,17 +1629,28 @@ int amdgpu_debugfs_init(struct amdgpu_device *adev)
 
 	amdgpu_ras_debugfs_create_all(adev);
 	amdgpu_rap_debugfs_init(adev);
+	amdgpu_vcn_debugfs_init(adev);
 	amdgpu_securedisplay_debugfs_init(adev);
 	amdgpu_fw_attestation_debugfs_init(adev);
 
 	debugfs_create_file("amdgpu_evict_vram", 0444, root, adev,
 			    &amdgpu_evict_vram_fops);
+	debugfs_create_file("amdgpu_compact_vram", 0444, root, adev,
+			    &amdgpu_compact_vram_fops);
 	debugfs_create_file("amdgpu_evict_gtt", 0444, root, adev,
 			    &amdgpu_evict_gtt_fops);
 	debugfs_create_file("amdgpu_test_ib", 0444, root, adev,
 			    &amdgpu_debugfs_test_ib_fops);
 	debugfs_create_file("amdgpu_vm_info", 0444, root, adev,
 			    &amdgpu_debugfs_vm_info_fops);
+	debugfs_create_file("amdgpu_ip_timing", 0444, root, adev,
+			    &amdgpu_debugfs_ip_timing_fops);
+	debugfs_create_file("amdgpu_reset_timing", 0444, root, adev,
+			    &amdgpu_debugfs_reset_timing_fops);
+	debugfs_create_file("amdgpu_sched_load", 0444, root, adev,
+			    &amdgpu_debugfs_sched_load_fops);
+	debugfs_create_file("amdgpu_dma_buf_stats", 0444, root, adev,
+			    &amdgpu_debugfs_dma_buf_stats_fops);
 
 	adev->debugfs_vbios_blob.data = adev->bios;
 	adev->debugfs_vbios_blob.size = adev->bios_size;
@@ -2196,9 +2196,17 @@ static int amdgpu_device_ip_early_init(struct amdgpu_device *adev)
 	return 0;
 }
 
+static void amdgpu_device_ip_phase_done(struct amdgpu_ip_block *ip_block,
+					enum amdgpu_ip_phase phase,
+					ktime_t start)
+{
+	ip_block->phase_us[phase] = ktime_us_delta(ktime_get(), start);
+}
+
 static int amdgpu_device_ip_hw_init_phase1(struct amdgpu_device *adev)
 {
 	int i, r;
+	ktime_t start;
 
 	for (i = 0; i < adev->num_ip_blocks; i++) {
 		if (!adev->ip_blocks[i].status.sw)
@@ -2208,7 +2216,10 @@ static int amdgpu_device_ip_hw_init_phase1(struct amdgpu_device *adev)
 		if (adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_COMMON ||
 		    (amdgpu_sriov_vf(adev) && (adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_PSP)) ||
 		    adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_IH) {
+			start = ktime_get();
 			r = adev->ip_blocks[i].version->funcs->hw_init(adev);
+			amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+						    AMDGPU_IP_PHASE_HW_INIT, start);
 			if (r) {
 				DRM_ERROR("hw_init of IP block <%s> failed %d\n",
 					  adev->ip_blocks[i].version->funcs->name, r);
@@ -2224,13 +2235,17 @@ static int amdgpu_device_ip_hw_init_phase1(struct amdgpu_device *adev)
 static int amdgpu_device_ip_hw_init_phase2(struct amdgpu_device *adev)
 {
 	int i, r;
+	ktime_t start;
 
 	for (i = 0; i < adev->num_ip_blocks; i++) {
 		if (!adev->ip_blocks[i].status.sw)
 			continue;
 		if (adev->ip_blocks[i].status.hw)
 			continue;
+		start = ktime_get();
 		r = adev->ip_blocks[i].version->funcs->hw_init(adev);
+		amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+					    AMDGPU_IP_PHASE_HW_INIT, start);
 		if (r) {
 			DRM_ERROR("hw_init of IP block <%s> failed %d\n",
 				  adev->ip_blocks[i].version->funcs->name, r);
@@ -2247,6 +2262,7 @@ static int amdgpu_device_fw_loading(struct amdgpu_device *adev)
 	int r = 0;
 	int i;
 	uint32_t smu_version;
+	ktime_t start;
 
 	if (adev->asic_type >= CHIP_VEGA10) {
 		for (i = 0; i < adev->num_ip_blocks; i++) {
@@ -2261,14 +2277,20 @@ static int amdgpu_device_fw_loading(struct amdgpu_device *adev)
 				break;
 
 			if (amdgpu_in_reset(adev) || adev->in_suspend) {
+				start = ktime_get();
 				r = adev->ip_blocks[i].version->funcs->resume(adev);
+				amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+							    AMDGPU_IP_PHASE_RESUME, start);
 				if (r) {
 					DRM_ERROR("resume of IP block <%s> failed %d\n",
 							  adev->ip_blocks[i].version->funcs->name, r);
 					return r;
 				}
 			} else {
+				start = ktime_get();
 				r = adev->ip_blocks[i].version->funcs->hw_init(adev);
+				amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+							    AMDGPU_IP_PHASE_HW_INIT, start);
 				if (r) {
 					DRM_ERROR("hw_init of IP block <%s> failed %d\n",
 							  adev->ip_blocks[i].version->funcs->name, r);
@@ -2301,6 +2323,7 @@ static int amdgpu_device_fw_loading(struct amdgpu_device *adev)
 static int amdgpu_device_ip_init(struct amdgpu_device *adev)
 {
 	int i, r;
+	ktime_t start;
 
 	r = amdgpu_ras_init(adev);
 	if (r)
@@ -2309,7 +2332,10 @@ static int amdgpu_device_ip_init(struct amdgpu_device *adev)
 	for (i = 0; i < adev->num_ip_blocks; i++) {
 		if (!adev->ip_blocks[i].status.valid)
 			continue;
+		start = ktime_get();
 		r = adev->ip_blocks[i].version->funcs->sw_init((void *)adev);
+		amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+					    AMDGPU_IP_PHASE_SW_INIT, start);
 		if (r) {
 			DRM_ERROR("sw_init of IP block <%s> failed %d\n",
 				  adev->ip_blocks[i].version->funcs->name, r);
@@ -2328,7 +2354,10 @@ static int amdgpu_device_ip_init(struct amdgpu_device *adev)
 				DRM_ERROR("amdgpu_vram_scratch_init failed %d\n", r);
 				goto init_failed;
 			}
+			start = ktime_get();
 			r = adev->ip_blocks[i].version->funcs->hw_init((void *)adev);
+			amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+						    AMDGPU_IP_PHASE_HW_INIT, start);
 			if (r) {
 				DRM_ERROR("hw_init %d failed %d\n", i, r);
 				goto init_failed;
@@ -2595,12 +2624,16 @@ static int amdgpu_device_ip_late_init(struct amdgpu_device *adev)
 {
 	struct amdgpu_gpu_instance *gpu_instance;
 	int i = 0, r;
+	ktime_t start;
 
 	for (i = 0; i < adev->num_ip_blocks; i++) {
 		if (!adev->ip_blocks[i].status.hw)
 			continue;
 		if (adev->ip_blocks[i].version->funcs->late_init) {
+			start = ktime_get();
 			r = adev->ip_blocks[i].version->funcs->late_init((void *)adev);
+			amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+						    AMDGPU_IP_PHASE_LATE_INIT, start);
 			if (r) {
 				DRM_ERROR("late_init of IP block <%s> failed %d\n",
 					  adev->ip_blocks[i].version->funcs->name, r);
@@ -2838,6 +2871,7 @@ static void amdgpu_device_delay_enable_gfx_off(struct work_struct *work)
 static int amdgpu_device_ip_suspend_phase1(struct amdgpu_device *adev)
 {
 	int i, r;
+	ktime_t start;
 
 	amdgpu_device_set_pg_state(adev, AMD_PG_STATE_UNGATE);
 	amdgpu_device_set_cg_state(adev, AMD_CG_STATE_UNGATE);
@@ -2851,7 +2885,10 @@ static int amdgpu_device_ip_suspend_phase1(struct amdgpu_device *adev)
 			continue;
 
 		/* XXX handle errors */
+		start = ktime_get();
 		r = adev->ip_blocks[i].version->funcs->suspend(adev);
+		amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+					    AMDGPU_IP_PHASE_SUSPEND, start);
 		/* XXX handle errors */
 		if (r) {
 			DRM_ERROR("suspend of IP block <%s> failed %d\n",
@@ -2879,6 +2916,7 @@ static int amdgpu_device_ip_suspend_phase1(struct amdgpu_device *adev)
 static int amdgpu_device_ip_suspend_phase2(struct amdgpu_device *adev)
 {
 	int i, r;
+	ktime_t start;
 
 	if (adev->in_s0ix)
 		amdgpu_gfx_state_change_set(adev, sGpuChangeState_D3Entry);
@@ -2917,7 +2955,10 @@ static int amdgpu_device_ip_suspend_phase2(struct amdgpu_device *adev)
 			continue;
 
 		/* XXX handle errors */
+		start = ktime_get();
 		r = adev->ip_blocks[i].version->funcs->suspend(adev);
+		amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+					    AMDGPU_IP_PHASE_SUSPEND, start);
 		/* XXX handle errors */
 		if (r) {
 			DRM_ERROR("suspend of IP block <%s> failed %d\n",
@@ -3062,6 +3103,7 @@ static int amdgpu_device_ip_reinit_late_sriov(struct amdgpu_device *adev)
 static int amdgpu_device_ip_resume_phase1(struct amdgpu_device *adev)
 {
 	int i, r;
+	ktime_t start;
 
 	for (i = 0; i < adev->num_ip_blocks; i++) {
 		if (!adev->ip_blocks[i].status.valid || adev->ip_blocks[i].status.hw)
@@ -3070,7 +3112,10 @@ static int amdgpu_device_ip_resume_phase1(struct amdgpu_device *adev)
 		    adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_GMC ||
 		    adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_IH) {
 
+			start = ktime_get();
 			r = adev->ip_blocks[i].version->funcs->resume(adev);
+			amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+						    AMDGPU_IP_PHASE_RESUME, start);
 			if (r) {
 				DRM_ERROR("resume of IP block <%s> failed %d\n",
 					  adev->ip_blocks[i].version->funcs->name, r);
@@ -3099,6 +3144,7 @@ static int amdgpu_device_ip_resume_phase1(struct amdgpu_device *adev)
 static int amdgpu_device_ip_resume_phase2(struct amdgpu_device *adev)
 {
 	int i, r;
+	ktime_t start;
 
 	for (i = 0; i < adev->num_ip_blocks; i++) {
 		if (!adev->ip_blocks[i].status.valid || adev->ip_blocks[i].status.hw)
@@ -3108,7 +3154,10 @@ static int amdgpu_device_ip_resume_phase2(struct amdgpu_device *adev)
 		    adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_IH ||
 		    adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_PSP)
 			continue;
+		start = ktime_get();
 		r = adev->ip_blocks[i].version->funcs->resume(adev);
+		amdgpu_device_ip_phase_done(&adev->ip_blocks[i],
+					    AMDGPU_IP_PHASE_RESUME, start);
 		if (r) {
 			DRM_ERROR("resume of IP block <%s> failed %d\n",
 				  adev->ip_blocks[i].version->funcs->name, r);
@@ -3282,6 +3331,7 @@ static void amdgpu_device_xgmi_reset_func(struct work_struct *__work)
 	struct amdgpu_device *adev =
 		container_of(__work, struct amdgpu_device, xgmi_reset_work);
 	struct amdgpu_hive_info *hive = amdgpu_get_xgmi_hive(adev);
+	ktime_t start = ktime_get();
 
 	/* It's a bug to not have a hive within this function */
 	if (WARN_ON(!hive))
@@ -3320,9 +3370,67 @@ static void amdgpu_device_xgmi_reset_func(struct work_struct *__work)
 	if (adev->asic_reset_res)
 		DRM_WARN("ASIC reset failed with error, %d for drm dev, %s",
 			 adev->asic_reset_res, adev_to_drm(adev)->unique);
+	adev->reset_timing.asic_reset_us = ktime_us_delta(ktime_get(), start);
 	amdgpu_put_xgmi_hive(hive);
 }
 
+/*
+ * Post the card and resume the IP blocks after a full ASIC reset. This only
+ * touches the device itself, so the devices of a hive can do this in
+ * parallel.
+ */
+static int amdgpu_device_reset_resume(struct amdgpu_device *adev)
+{
+	bool vram_lost;
+	int r;
+
+	/* post card */
+	r = amdgpu_device_asic_init(adev);
+	if (r) {
+		dev_warn(adev->dev, "asic atom init failed!");
+		return r;
+	}
+
+	dev_info(adev->dev, "GPU reset succeeded, trying to resume\n");
+	r = amdgpu_amdkfd_resume_iommu(adev);
+	if (r)
+		return r;
+
+	r = amdgpu_device_ip_resume_phase1(adev);
+	if (r)
+		return r;
+
+	vram_lost = amdgpu_device_check_vram_lost(adev);
+	if (vram_lost) {
+		DRM_INFO("VRAM is lost due to GPU reset!\n");
+		amdgpu_inc_vram_lost(adev);
+		amdgpu_vram_mgr_invalidate_cleared(&adev->mman.vram_mgr);
+	}
+
+	r = amdgpu_device_fw_loading(adev);
+	if (r)
+		return r;
+
+	r = amdgpu_device_ip_resume_phase2(adev);
+	if (r)
+		return r;
+
+	if (vram_lost)
+		amdgpu_device_fill_reset_magic(adev);
+
+	return 0;
+}
+
+static void amdgpu_device_reset_resume_func(struct work_struct *__work)
+{
+	struct amdgpu_device *adev =
+		container_of(__work, struct amdgpu_device, reset_resume_work);
+	ktime_t start = ktime_get();
+
+	adev->reset_resume_res = amdgpu_device_reset_resume(adev);
+	adev->reset_timing.resume_us = ktime_us_delta(ktime_get(), start);
+}
+
 static int amdgpu_device_get_job_timeout_settings(struct amdgpu_device *adev)
 {
 	char *input = amdgpu_lockup_timeout;
@@ -3525,6 +3633,7 @@ int amdgpu_device_init(struct amdgpu_device *adev,
 			  amdgpu_device_delay_enable_gfx_off);
 
 	INIT_WORK(&adev->xgmi_reset_work, amdgpu_device_xgmi_reset_func);
+	INIT_WORK(&adev->reset_resume_work, amdgpu_device_reset_resume_func);
 
 	adev->gfx.gfx_off_req_count = 1;
 	adev->pm.ac_power = power_supply_is_system_supplied() > 0;
@@ -4053,6 +4162,9 @@ int amdgpu_device_resume(struct drm_device *dev, bool fbcon)
 			dev_err(adev->dev, "amdgpu asic init failed\n");
 	}
 
+	/* Free VRAM doesn't necessarily survive suspend */
+	amdgpu_vram_mgr_invalidate_cleared(&adev->mman.vram_mgr);
+
 	r = amdgpu_device_ip_resume(adev);
 	if (r) {
 		dev_err(adev->dev, "amdgpu_device_ip_resume failed (%d).\n", r);
@@ -4392,6 +4504,7 @@ static int amdgpu_device_reset_sriov(struct amdgpu_device *adev,
 error:
 	if (!r && adev->virt.gim_feature & AMDGIM_FEATURE_GIM_FLR_VRAMLOST) {
 		amdgpu_inc_vram_lost(adev);
+		amdgpu_vram_mgr_invalidate_cleared(&adev->mman.vram_mgr);
 		r = amdgpu_device_recover_vram(adev);
 	}
 	amdgpu_virt_release_full_gpu(adev, true);
@@ -4414,7 +4527,7 @@ bool amdgpu_device_has_job_running(struct amdgpu_device *adev)
 	for (i = 0; i < AMDGPU_MAX_RINGS; ++i) {
 		struct amdgpu_ring *ring = adev->rings[i];
 
-		if (!ring || !ring->sched.thread)
+		if (!ring || !drm_sched_wqueue_ready(&ring->sched))
 			continue;
 
 		spin_lock(&ring->sched.job_list_lock);
@@ -4538,7 +4651,7 @@ int amdgpu_device_pre_asic_reset(struct amdgpu_device *adev,
 	for (i = 0; i < AMDGPU_MAX_RINGS; ++i) {
 		struct amdgpu_ring *ring = adev->rings[i];
 
-		if (!ring || !ring->sched.thread)
+		if (!ring || !drm_sched_wqueue_ready(&ring->sched))
 			continue;
 
 		/*clear job fence from fence drv to avoid force_completion
@@ -4591,7 +4704,8 @@ int amdgpu_do_asic_reset(struct list_head *device_list_handle,
 			 struct amdgpu_reset_context *reset_context)
 {
 	struct amdgpu_device *tmp_adev = NULL;
-	bool need_full_reset, skip_hw_reset, vram_lost = false;
+	bool need_full_reset, skip_hw_reset;
+	ktime_t start;
 	int r = 0;
 
 	/* Try reset handler method first */
@@ -4620,8 +4734,12 @@ int amdgpu_do_asic_reset(struct list_head *device_list_handle,
 				tmp_adev->gmc.xgmi.pending_reset = false;
 				if (!queue_work(system_unbound_wq, &tmp_adev->xgmi_reset_work))
 					r = -EALREADY;
-			} else
+			} else {
+				start = ktime_get();
 				r = amdgpu_asic_reset(tmp_adev);
+				tmp_adev->reset_timing.asic_reset_us =
+					ktime_us_delta(ktime_get(), start);
+			}
 
 			if (r) {
 				dev_err(tmp_adev->dev, "ASIC reset failed with error, %d for drm dev, %s",
@@ -4653,38 +4771,32 @@ int amdgpu_do_asic_reset(struct list_head *device_list_handle,
 		amdgpu_ras_intr_cleared();
 	}
 
+	/*
+	 * Resuming the IP blocks only depends on the device itself, so run it
+	 * in parallel for all devices of a hive. Everything from registering
+	 * the GPU instance on is done in order, late init and the XGMI
+	 * topology update depend on the state of the other hive members.
+	 */
+	if (need_full_reset) {
+		if (list_is_singular(device_list_handle)) {
+			tmp_adev = list_first_entry(device_list_handle,
+						    struct amdgpu_device,
+						    reset_list);
+			amdgpu_device_reset_resume_func(&tmp_adev->reset_resume_work);
+		} else {
+			list_for_each_entry(tmp_adev, device_list_handle, reset_list)
+				queue_work(system_unbound_wq,
+					   &tmp_adev->reset_resume_work);
+			list_for_each_entry(tmp_adev, device_list_handle, reset_list)
+				flush_work(&tmp_adev->reset_resume_work);
+		}
+	}
+
 	list_for_each_entry(tmp_adev, device_list_handle, reset_list) {
 		if (need_full_reset) {
-			/* post card */
-			r = amdgpu_device_asic_init(tmp_adev);
-			if (r) {
-				dev_warn(tmp_adev->dev, "asic atom init failed!");
-			} else {
-				dev_info(tmp_adev->dev, "GPU reset succeeded, trying to resume\n");
-				r = amdgpu_amdkfd_resume_iommu(tmp_adev);
-				if (r)
-					goto out;
-
-				r = amdgpu_device_ip_resume_phase1(tmp_adev);
-				if (r)
-					goto out;
-
-				vram_lost = amdgpu_device_check_vram_lost(tmp_adev);
-				if (vram_lost) {
-					DRM_INFO("VRAM is lost due to GPU reset!\n");
-					amdgpu_inc_vram_lost(tmp_adev);
-				}
-
-				r = amdgpu_device_fw_loading(tmp_adev);
-				if (r)
-					return r;
-
-				r = amdgpu_device_ip_resume_phase2(tmp_adev);
-				if (r)
-					goto out;
-
-				if (vram_lost)
-					amdgpu_device_fill_reset_magic(tmp_adev);
+			r = tmp_adev->reset_resume_res;
+			if (!r) {
+				start = ktime_get();
 
 				/*
 				 * Add this ASIC as tracked as reset was already
@@ -4725,13 +4837,18 @@ int amdgpu_do_asic_reset(struct list_head *device_list_handle,
 				    tmp_adev->gmc.xgmi.num_physical_nodes > 1)
 					r = amdgpu_xgmi_update_topology(
 						reset_context->hive, tmp_adev);
+out:
+				tmp_adev->reset_timing.late_init_us =
+					ktime_us_delta(ktime_get(), start);
 			}
 		}
 
-out:
 		if (!r) {
+			start = ktime_get();
 			amdgpu_irq_gpu_reset_resume_helper(tmp_adev);
 			r = amdgpu_ib_ring_tests(tmp_adev);
+			tmp_adev->reset_timing.ib_test_us =
+				ktime_us_delta(ktime_get(), start);
 			if (r) {
 				dev_err(tmp_adev->dev, "ib ring test failed (%d).\n", r);
 				need_full_reset = true;
@@ -4740,10 +4857,14 @@ int amdgpu_do_asic_reset(struct list_head *device_list_handle,
 			}
 		}
 
-		if (!r)
+		if (!r) {
+			start = ktime_get();
 			r = amdgpu_device_recover_vram(tmp_adev);
-		else
+			tmp_adev->reset_timing.recover_vram_us =
+				ktime_us_delta(ktime_get(), start);
+		} else {
 			tmp_adev->asic_reset_res = r;
+		}
 	}
 
 end:
@@ -4898,7 +5019,7 @@ static void amdgpu_device_recheck_guilty_jobs(
 		int ret = 0;
 		struct drm_sched_job *s_job;
 
-		if (!ring || !ring->sched.thread)
+		if (!ring || !drm_sched_wqueue_ready(&ring->sched))
 			continue;
 
 		s_job = list_first_entry_or_null(&ring->sched.pending_list,
@@ -5102,10 +5223,11 @@ int amdgpu_device_gpu_recover(struct amdgpu_device *adev,
 		for (i = 0; i < AMDGPU_MAX_RINGS; ++i) {
 			struct amdgpu_ring *ring = tmp_adev->rings[i];
 
-			if (!ring || !ring->sched.thread)
+			if (!ring || !drm_sched_wqueue_ready(&ring->sched))
 				continue;
 
 			drm_sched_stop(&ring->sched, job ? &job->base : NULL);
+			amdgpu_ring_preempt_reset(ring);
 
 			if (need_emergency_restart)
 				amdgpu_job_stop_all_jobs_on_sched(&ring->sched);
@@ -5173,7 +5295,7 @@ int amdgpu_device_gpu_recover(struct amdgpu_device *adev,
 		for (i = 0; i < AMDGPU_MAX_RINGS; ++i) {
 			struct amdgpu_ring *ring = tmp_adev->rings[i];
 
-			if (!ring || !ring->sched.thread)
+			if (!ring || !drm_sched_wqueue_ready(&ring->sched))
 				continue;
 
 			/* No point to resubmit jobs if we didn't HW reset*/
@@ -5423,7 +5545,7 @@ static void amdgpu_cancel_all_tdr(struct amdgpu_device *adev)
 	for (i = 0; i < AMDGPU_MAX_RINGS; ++i) {
 		struct amdgpu_ring *ring = adev->rings[i];
 
-		if (!ring || !ring->sched.thread)
+		if (!ring || !drm_sched_wqueue_ready(&ring->sched))
 			continue;
 
 		cancel_delayed_work_sync(&ring->sched.work_tdr);
@@ -5476,10 +5598,11 @@ pci_ers_result_t amdgpu_pci_error_detected(struct pci_dev *pdev, pci_channel_sta
 		for (i = 0; i < AMDGPU_MAX_RINGS; ++i) {
 			struct amdgpu_ring *ring = adev->rings[i];
 
-			if (!ring || !ring->sched.thread)
+			if (!ring || !drm_sched_wqueue_ready(&ring->sched))
 				continue;
 
 			drm_sched_stop(&ring->sched, NULL);
+			amdgpu_ring_preempt_reset(ring);
 		}
 		atomic_inc(&adev->gpu_reset_counter);
 		return PCI_ERS_RESULT_NEED_RESET;
@@ -5603,7 +5726,7 @@ void amdgpu_pci_resume(struct pci_dev *pdev)
 	for (i = 0; i < AMDGPU_MAX_RINGS; ++i) {
 		struct amdgpu_ring *ring = adev->rings[i];
 
-		if (!ring || !ring->sched.thread)
+		if (!ring || !drm_sched_wqueue_ready(&ring->sched))
 			continue;
 
 
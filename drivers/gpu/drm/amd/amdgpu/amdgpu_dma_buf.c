@@ -42,6 +42,20 @@
 #include <linux/pci-p2pdma.h>
 #include <linux/pm_runtime.h>
 
+/*
+ * Exporter side state of an attachment. The last mapping is kept after it is
+ * unmapped and handed out again until the BO moves, so importers mapping and
+ * unmapping for each use don't need to rebuild the sg table every time.
+ */
+struct amdgpu_dma_buf_attach {
+	struct sg_table		*sgt;
+	enum dma_data_direction	dir;
+	/* the cached mapping is currently used by the importer */
+	bool			mapped;
+	/* the BO moved, drop the mapping when the importer unmaps it */
+	bool			stale;
+};
+
 /**
  * amdgpu_dma_buf_attach - &dma_buf_ops.attach implementation
  *
@@ -61,6 +75,11 @@ static int amdgpu_dma_buf_attach(struct dma_buf *dmabuf,
 	if (pci_p2pdma_distance_many(adev->pdev, &attach->dev, 1, true) < 0)
 		attach->peer2peer = false;
 
+	attach->priv = kzalloc(sizeof(struct amdgpu_dma_buf_attach),
+			       GFP_KERNEL);
+	if (!attach->priv)
+		return -ENOMEM;
+
 	r = pm_runtime_get_sync(adev_to_drm(adev)->dev);
 	if (r < 0)
 		goto out;
@@ -69,9 +88,59 @@ static int amdgpu_dma_buf_attach(struct dma_buf *dmabuf,
 
 out:
 	pm_runtime_put_autosuspend(adev_to_drm(adev)->dev);
+	kfree(attach->priv);
+	attach->priv = NULL;
 	return r;
 }
 
+/* Unmap and free a sg table created by amdgpu_dma_buf_map() */
+static void amdgpu_dma_buf_free_sgt(struct dma_buf_attachment *attach,
+				    struct sg_table *sgt,
+				    enum dma_data_direction dir)
+{
+	if (sgt->sgl->page_link) {
+		dma_unmap_sgtable(attach->dev, sgt, dir, 0);
+		sg_free_table(sgt);
+		kfree(sgt);
+	} else {
+		amdgpu_vram_mgr_free_sgt(attach->dev, dir, sgt);
+	}
+}
+
+/**
+ * amdgpu_dma_buf_invalidate_mappings - drop cached mappings of a BO
+ *
+ * @bo: the exported BO which is about to move
+ *
+ * Frees the cached mappings of all attachments and marks the ones still in
+ * use as stale. Must be called with the BO reserved.
+ */
+void amdgpu_dma_buf_invalidate_mappings(struct amdgpu_bo *bo)
+{
+	struct dma_buf *dmabuf = bo->tbo.base.dma_buf;
+	struct dma_buf_attachment *attach;
+
+	if (!dmabuf || dmabuf->ops != &amdgpu_dmabuf_ops)
+		return;
+
+	dma_resv_assert_held(dmabuf->resv);
+
+	list_for_each_entry(attach, &dmabuf->attachments, node) {
+		struct amdgpu_dma_buf_attach *priv = attach->priv;
+
+		if (!priv || !priv->sgt)
+			continue;
+
+		if (priv->mapped) {
+			priv->stale = true;
+			continue;
+		}
+
+		amdgpu_dma_buf_free_sgt(attach, priv->sgt, priv->dir);
+		priv->sgt = NULL;
+	}
+}
+
 /**
  * amdgpu_dma_buf_detach - &dma_buf_ops.detach implementation
  *
@@ -86,6 +155,12 @@ static void amdgpu_dma_buf_detach(struct dma_buf *dmabuf,
 	struct drm_gem_object *obj = dmabuf->priv;
 	struct amdgpu_bo *bo = gem_to_amdgpu_bo(obj);
 	struct amdgpu_device *adev = amdgpu_ttm_adev(bo->tbo.bdev);
+	struct amdgpu_dma_buf_attach *priv = attach->priv;
+
+	if (priv && priv->sgt)
+		amdgpu_dma_buf_free_sgt(attach, priv->sgt, priv->dir);
+	kfree(priv);
+	attach->priv = NULL;
 
 	pm_runtime_mark_last_busy(adev_to_drm(adev)->dev);
 	pm_runtime_put_autosuspend(adev_to_drm(adev)->dev);
@@ -141,7 +216,9 @@ static void amdgpu_dma_buf_unpin(struct dma_buf_attachment *attach)
  *
  * Makes sure that the shared DMA buffer can be accessed by the target device.
  * For now, simply pins it to the GTT domain, where it should be accessible by
- * all DMA devices.
+ * all DMA devices. VRAM is accessed directly over PCIe P2P when the importer
+ * allows it. The sg table of the last mapping is reused while the BO stays
+ * in place.
  *
  * Returns:
  * sg_table filled with the DMA addresses to use or ERR_PRT with negative error
@@ -154,6 +231,7 @@ static struct sg_table *amdgpu_dma_buf_map(struct dma_buf_attachment *attach,
 	struct drm_gem_object *obj = dma_buf->priv;
 	struct amdgpu_bo *bo = gem_to_amdgpu_bo(obj);
 	struct amdgpu_device *adev = amdgpu_ttm_adev(bo->tbo.bdev);
+	struct amdgpu_dma_buf_attach *priv = attach->priv;
 	struct sg_table *sgt;
 	long r;
 
@@ -177,6 +255,18 @@ static struct sg_table *amdgpu_dma_buf_map(struct dma_buf_attachment *attach,
 		return ERR_PTR(-EBUSY);
 	}
 
+	/* Moving the BO above dropped the cached mapping if it was outdated */
+	if (priv && priv->sgt && !priv->mapped) {
+		if (!priv->stale && priv->dir == dir) {
+			priv->mapped = true;
+			atomic64_inc(&adev->dma_buf_stats.cache_hits);
+			return priv->sgt;
+		}
+
+		amdgpu_dma_buf_free_sgt(attach, priv->sgt, priv->dir);
+		priv->sgt = NULL;
+	}
+
 	switch (bo->tbo.resource->mem_type) {
 	case TTM_PL_TT:
 		sgt = drm_prime_pages_to_sg(obj->dev,
@@ -188,6 +278,10 @@ static struct sg_table *amdgpu_dma_buf_map(struct dma_buf_attachment *attach,
 		if (dma_map_sgtable(attach->dev, sgt, dir,
 				    DMA_ATTR_SKIP_CPU_SYNC))
 			goto error_free;
+
+		atomic64_inc(&adev->dma_buf_stats.sysmem_maps);
+		atomic64_add(bo->tbo.base.size,
+			     &adev->dma_buf_stats.sysmem_bytes);
 		break;
 
 	case TTM_PL_VRAM:
@@ -196,11 +290,21 @@ static struct sg_table *amdgpu_dma_buf_map(struct dma_buf_attachment *attach,
 					      dir, &sgt);
 		if (r)
 			return ERR_PTR(r);
+
+		atomic64_inc(&adev->dma_buf_stats.p2p_maps);
+		atomic64_add(bo->tbo.base.size, &adev->dma_buf_stats.p2p_bytes);
 		break;
 	default:
 		return ERR_PTR(-EINVAL);
 	}
 
+	if (priv && !priv->sgt) {
+		priv->sgt = sgt;
+		priv->dir = dir;
+		priv->mapped = true;
+		priv->stale = false;
+	}
+
 	return sgt;
 
 error_free:
@@ -222,13 +326,17 @@ static void amdgpu_dma_buf_unmap(struct dma_buf_attachment *attach,
 				 struct sg_table *sgt,
 				 enum dma_data_direction dir)
 {
-	if (sgt->sgl->page_link) {
-		dma_unmap_sgtable(attach->dev, sgt, dir, 0);
-		sg_free_table(sgt);
-		kfree(sgt);
-	} else {
-		amdgpu_vram_mgr_free_sgt(attach->dev, dir, sgt);
+	struct amdgpu_dma_buf_attach *priv = attach->priv;
+
+	/* Keep the cached mapping around until the BO moves */
+	if (priv && priv->sgt == sgt) {
+		priv->mapped = false;
+		if (!priv->stale)
+			return;
+		priv->sgt = NULL;
 	}
+
+	amdgpu_dma_buf_free_sgt(attach, sgt, dir);
 }
 
 /**
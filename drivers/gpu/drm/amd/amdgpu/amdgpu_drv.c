@@ -109,6 +109,11 @@ int amdgpu_vis_vram_limit;
 int amdgpu_gart_size = -1; /* auto */
 int amdgpu_gtt_size = -1; /* auto */
 int amdgpu_moverate = -1; /* auto */
+int amdgpu_vram_compact = 64;
+int amdgpu_vram_scrub = 64;
+int amdgpu_fence_poll_cpu = -1;
+uint amdgpu_fence_poll_idle = 100;
+uint amdgpu_xgmi_bw_interval;
 int amdgpu_benchmarking;
 int amdgpu_testing;
 int amdgpu_audio = -1;
@@ -134,6 +139,8 @@ int amdgpu_exp_hw_support;
 int amdgpu_dc = -1;
 int amdgpu_sched_jobs = 32;
 int amdgpu_sched_hw_submission = 2;
+uint amdgpu_sched_rebalance_ms;
+uint amdgpu_vcn_idle_max_ms = 4000;
 uint amdgpu_pcie_gen_cap;
 uint amdgpu_pcie_lane_cap;
 uint amdgpu_cg_mask = 0xffffffff;
@@ -231,6 +238,57 @@ module_param_named(gttsize, amdgpu_gtt_size, int, 0600);
 MODULE_PARM_DESC(moverate, "Maximum buffer migration rate in MB/s. (32, 64, etc., -1=auto, 0=1=disabled)");
 module_param_named(moverate, amdgpu_moverate, int, 0600);
 
+/**
+ * DOC: vram_compact (int)
+ * Maximum amount of VRAM in MB moved by a single background VRAM compaction
+ * pass. A pass is started when an allocation fails because of fragmentation
+ * and at most once per second. The default is 64, 0 disables background
+ * compaction.
+ */
+MODULE_PARM_DESC(vram_compact, "Maximum MB moved per VRAM compaction pass (default 64, 0 = disabled)");
+module_param_named(vram_compact, amdgpu_vram_compact, int, 0600);
+
+/**
+ * DOC: vram_scrub (int)
+ * Maximum amount of free VRAM in MB cleared by a single background scrub
+ * pass. Free VRAM is cleared in 2MB blocks while the SDMA engine used for
+ * buffer moves is idle, allocations requesting cleared VRAM then skip the
+ * clear of those blocks. The default is 64, 0 disables background scrubbing.
+ */
+MODULE_PARM_DESC(vram_scrub, "Maximum MB of free VRAM cleared per scrub pass (default 64, 0 = disabled)");
+module_param_named(vram_scrub, amdgpu_vram_scrub, int, 0600);
+
+/**
+ * DOC: fence_poll_cpu (int)
+ * CPU the fence poll thread is bound to. The thread busy polls the fence
+ * seqno of rings switched to polled completion through their
+ * amdgpu_fence_mode_<ring> debugfs file. The default is -1 (not bound).
+ */
+MODULE_PARM_DESC(fence_poll_cpu, "CPU to bind the fence poll thread to (default -1 = not bound)");
+module_param_named(fence_poll_cpu, amdgpu_fence_poll_cpu, int, 0444);
+
+/**
+ * DOC: fence_poll_idle (uint)
+ * Time in microseconds the fence poll thread keeps polling after the last
+ * outstanding fence of the polled rings signaled. After that it sleeps until
+ * a new fence is emitted and the rings fall back to interrupts. The default
+ * is 100.
+ */
+MODULE_PARM_DESC(fence_poll_idle, "Fence poll thread idle timeout in us (default 100)");
+module_param_named(fence_poll_idle, amdgpu_fence_poll_idle, uint, 0600);
+
+/**
+ * DOC: xgmi_bw_interval (uint)
+ * Interval in ms at which the XGMI link bandwidth is sampled from the data
+ * fabric performance counters. The measured bandwidth is reported in the
+ * xgmi_bandwidth sysfs file and drives the XGMI link pstate instead of the
+ * existence of peer mappings. Links share the DF counters with the amdgpu
+ * perf events and are sampled in turns if there are more links than free
+ * counters. The default is 0 (disabled).
+ */
+MODULE_PARM_DESC(xgmi_bw_interval, "XGMI link bandwidth sampling interval in ms (default 0 = disabled)");
+module_param_named(xgmi_bw_interval, amdgpu_xgmi_bw_interval, uint, 0444);
+
 /**
  * DOC: benchmark (int)
  * Run benchmarks. The default is 0 (Skip benchmarks).
@@ -434,6 +492,28 @@ module_param_named(sched_jobs, amdgpu_sched_jobs, int, 0444);
 MODULE_PARM_DESC(sched_hw_submission, "the max number of HW submissions (default 2)");
 module_param_named(sched_hw_submission, amdgpu_sched_hw_submission, int, 0444);
 
+/**
+ * DOC: sched_rebalance_ms (uint)
+ * Video decode and encode contexts stay on the VCN/UVD instance picked when
+ * they were created. With this set, a context which was idle for at least this
+ * many milliseconds moves to the least loaded instance on its next submission.
+ * Only safe with userspace that doesn't keep firmware session state across
+ * submissions. The default is 0 (never move).
+ */
+MODULE_PARM_DESC(sched_rebalance_ms, "move idle video contexts to a less loaded instance after this many ms (0 = never (default))");
+module_param_named(sched_rebalance_ms, amdgpu_sched_rebalance_ms, uint, 0644);
+
+/**
+ * DOC: vcn_idle_max_ms (uint)
+ * VCN is power gated one second after the last submission by default. When
+ * most of the recent idle gaps longer than that ended within this many
+ * milliseconds, gating is delayed until they typically end, so the next frame
+ * doesn't pay for ungating and firmware resume. 0 keeps the fixed one second
+ * delay. The default is 4000.
+ */
+MODULE_PARM_DESC(vcn_idle_max_ms, "longest delay in ms before power gating an idle VCN (default 4000, 0 = fixed 1000)");
+module_param_named(vcn_idle_max_ms, amdgpu_vcn_idle_max_ms, uint, 0644);
+
 /**
  * DOC: ppfeaturemask (hexint)
  * Override power features enabled. See enum PP_FEATURE_MASK in drivers/gpu/drm/amd/include/amd_shared.h.
@@ -626,6 +706,7 @@ module_param_named(async_gfx_ring, amdgpu_async_gfx_ring, int, 0444);
 /**
  * DOC: mcbp (int)
  * It is used to enable mid command buffer preemption. (0 = disabled (default), 1 = enabled)
+ * When enabled, high priority gfx submissions preempt lower priority work executing on the gfx ring.
  */
 MODULE_PARM_DESC(mcbp,
 	"Enable Mid-command buffer preemption (0 = disabled (default), 1 = enabled)");
@@ -781,6 +862,36 @@ bool debug_evictions;
 module_param(debug_evictions, bool, 0644);
 MODULE_PARM_DESC(debug_evictions, "enable eviction debug messages (false = default)");
 
+/**
+ * DOC: svm_xgmi_max_hops (int)
+ * Maximum number of XGMI hops over which SVM maps the VRAM of a peer GPU
+ * instead of migrating the range to the accessing GPU. The default value: 0
+ * (no limit).
+ */
+int svm_xgmi_max_hops;
+module_param(svm_xgmi_max_hops, int, 0644);
+MODULE_PARM_DESC(svm_xgmi_max_hops, "max XGMI hops to map SVM ranges from peer VRAM (0 = no limit (default))");
+
+/**
+ * DOC: svm_xgmi_min_links (int)
+ * Minimum number of XGMI links to a peer GPU for SVM to map its VRAM
+ * instead of migrating the range to the accessing GPU. The default value: 1.
+ */
+int svm_xgmi_min_links = 1;
+module_param(svm_xgmi_min_links, int, 0644);
+MODULE_PARM_DESC(svm_xgmi_min_links, "min XGMI links to map SVM ranges from peer VRAM (1 = default)");
+
+/**
+ * DOC: hws_runlist_batch_us (int)
+ * Time window in microseconds in which the HWS runlist updates caused by
+ * queue creation and process queue restore are coalesced into a single
+ * preemption and runlist resubmission. Queue destruction and eviction are
+ * always executed immediately. The default value: 0 (disabled).
+ */
+int hws_runlist_batch_us;
+module_param(hws_runlist_batch_us, int, 0644);
+MODULE_PARM_DESC(hws_runlist_batch_us, "window to coalesce HWS runlist updates in us (0 = disabled (default))");
+
 /**
  * DOC: no_system_mem_limit(bool)
  * Disable system memory limit, to support multiple process shared memory
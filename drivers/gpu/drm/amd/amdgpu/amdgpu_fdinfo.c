@@ -54,11 +54,13 @@ static const char *amdgpu_ip_name[AMDGPU_HW_IP_NUM] = {
 
 void amdgpu_show_fdinfo(struct seq_file *m, struct file *f)
 {
+	ktime_t usage[AMDGPU_HW_IP_NUM][AMDGPU_MAX_ENTITY_NUM];
 	struct amdgpu_fpriv *fpriv;
-	uint32_t bus, dev, fn, i, domain;
+	uint32_t bus, dev, fn, i, j, domain;
 	uint64_t vram_mem = 0, gtt_mem = 0, cpu_mem = 0;
 	struct drm_file *file = f->private_data;
 	struct amdgpu_device *adev = drm_to_adev(file->minor->dev);
+	struct amdgpu_mm_budget budget;
 	struct amdgpu_bo *root;
 	int ret;
 
@@ -88,6 +90,16 @@ void amdgpu_show_fdinfo(struct seq_file *m, struct file *f)
 	seq_printf(m, "vram mem:\t%llu kB\n", vram_mem/1024UL);
 	seq_printf(m, "gtt mem:\t%llu kB\n", gtt_mem/1024UL);
 	seq_printf(m, "cpu mem:\t%llu kB\n", cpu_mem/1024UL);
+
+	spin_lock(&adev->mm_stats.lock);
+	budget = fpriv->mm_budget;
+	spin_unlock(&adev->mm_stats.lock);
+
+	seq_printf(m, "moved mem:\t%llu kB\n", budget.bytes_moved/1024UL);
+	seq_printf(m, "moved vis mem:\t%llu kB\n",
+		   budget.bytes_moved_vis/1024UL);
+	seq_printf(m, "move budget:\t%lld us\n", max(budget.accum_us, 0LL));
+	seq_printf(m, "move debt:\t%lld us\n", max(-budget.accum_us, 0LL));
 	for (i = 0; i < AMDGPU_HW_IP_NUM; i++) {
 		uint32_t count = amdgpu_ctx_num_entities[i];
 		int idx = 0;
@@ -108,4 +120,40 @@ void amdgpu_show_fdinfo(struct seq_file *m, struct file *f)
 					idx, perc/100, frac);
 		}
 	}
+
+	/* Cumulative counters following the DRM usage stats format */
+	seq_printf(m, "drm-driver:\t%s\n", file->minor->dev->driver->name);
+	seq_printf(m, "drm-pdev:\t%04x:%02x:%02x.%d\n", domain, bus, dev, fn);
+	seq_printf(m, "drm-memory-vram:\t%llu KiB\n", vram_mem/1024UL);
+	seq_printf(m, "drm-memory-gtt:\t%llu KiB\n", gtt_mem/1024UL);
+	seq_printf(m, "drm-memory-cpu:\t%llu KiB\n", cpu_mem/1024UL);
+	seq_printf(m, "amd-evictions:\t%llu\n",
+		   (u64)atomic64_read(&fpriv->vm.evictions));
+	seq_printf(m, "amd-moved-bytes:\t%llu\n", budget.bytes_moved);
+
+	amdgpu_ctx_mgr_usage(&fpriv->ctx_mgr, usage);
+	for (i = 0; i < AMDGPU_HW_IP_NUM; i++) {
+		ktime_t total = ns_to_ktime(0);
+
+		for (j = 0; j < amdgpu_ctx_num_entities[i]; j++)
+			total = ktime_add(total, usage[i][j]);
+		if (!total)
+			continue;
+
+		seq_printf(m, "drm-engine-%s:\t%lld ns\n", amdgpu_ip_name[i],
+			   ktime_to_ns(total));
+
+		for (j = 0; j < amdgpu_ctx_num_entities[i]; j++) {
+			u64 count = atomic64_read(&fpriv->ctx_mgr.submissions[i][j]);
+
+			if (!count)
+				continue;
+
+			seq_printf(m, "amd-engine-%s%u:\t%lld ns\n",
+				   amdgpu_ip_name[i], j,
+				   ktime_to_ns(usage[i][j]));
+			seq_printf(m, "amd-submissions-%s%u:\t%llu\n",
+				   amdgpu_ip_name[i], j, count);
+		}
+	}
 }
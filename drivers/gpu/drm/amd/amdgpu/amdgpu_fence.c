@@ -35,6 +35,7 @@
 #include <linux/slab.h>
 #include <linux/firmware.h>
 #include <linux/pm_runtime.h>
+#include <linux/kthread.h>
 
 #include <drm/drm_drv.h>
 #include "amdgpu.h"
@@ -198,6 +199,9 @@ int amdgpu_fence_emit(struct amdgpu_ring *ring, struct dma_fence **f, struct amd
 	 */
 	rcu_assign_pointer(*ptr, dma_fence_get(fence));
 
+	if (READ_ONCE(ring->fence_drv.mode) == AMDGPU_FENCE_MODE_POLL)
+		wake_up(&adev->fence_poll_wq);
+
 	*f = fence;
 
 	return 0;
@@ -251,38 +255,77 @@ static void amdgpu_fence_schedule_fallback(struct amdgpu_ring *ring)
 		  jiffies + AMDGPU_FENCE_JIFFIES_TIMEOUT);
 }
 
+/* Number of fences signaled under a single acquisition of the fence lock */
+#define AMDGPU_FENCE_SIGNAL_BATCH	16
+
 /**
- * amdgpu_fence_process - check for fence activity
+ * amdgpu_fence_signal_batched - signal a range of fences in batches
  *
  * @ring: pointer to struct amdgpu_ring
+ * @last_seq: last sequence number signaled before
+ * @seq: sequence number to signal up to
  *
- * Checks the current fence value and calculates the last
- * signalled fence value. Wakes the fence queue if the
- * sequence number has increased.
+ * All fences of a ring share the fence driver lock, so instead of taking it
+ * once for each fence take it once for up to AMDGPU_FENCE_SIGNAL_BATCH fences
+ * and drop the references outside of it.
  *
- * Returns true if fence was processed
+ * Returns the number of fences signaled.
  */
-bool amdgpu_fence_process(struct amdgpu_ring *ring)
+static unsigned int amdgpu_fence_signal_batched(struct amdgpu_ring *ring,
+						uint32_t last_seq, uint32_t seq)
 {
 	struct amdgpu_fence_driver *drv = &ring->fence_drv;
+	struct dma_fence *batch[AMDGPU_FENCE_SIGNAL_BATCH];
 	struct amdgpu_device *adev = ring->adev;
-	uint32_t seq, last_seq;
+	unsigned int i, num, count = 0;
+	unsigned long flags;
 
 	do {
-		last_seq = atomic_read(&ring->fence_drv.last_seq);
-		seq = amdgpu_fence_read(ring);
+		num = 0;
+		spin_lock_irqsave(&drv->lock, flags);
+		do {
+			struct dma_fence *fence, **ptr;
 
-	} while (atomic_cmpxchg(&drv->last_seq, last_seq, seq) != last_seq);
+			++last_seq;
+			last_seq &= drv->num_fences_mask;
+			ptr = &drv->fences[last_seq];
 
-	if (del_timer(&ring->fence_drv.fallback_timer) &&
-	    seq != ring->fence_drv.sync_seq)
-		amdgpu_fence_schedule_fallback(ring);
+			fence = rcu_dereference_protected(*ptr, 1);
+			RCU_INIT_POINTER(*ptr, NULL);
+			if (!fence)
+				continue;
+
+			dma_fence_signal_locked(fence);
+			batch[num++] = fence;
+		} while (last_seq != seq && num < AMDGPU_FENCE_SIGNAL_BATCH);
+		spin_unlock_irqrestore(&drv->lock, flags);
+
+		for (i = 0; i < num; ++i) {
+			dma_fence_put(batch[i]);
+			pm_runtime_mark_last_busy(adev_to_drm(adev)->dev);
+			pm_runtime_put_autosuspend(adev_to_drm(adev)->dev);
+		}
+		count += num;
+	} while (last_seq != seq);
 
-	if (unlikely(seq == last_seq))
-		return false;
+	return count;
+}
 
-	last_seq &= drv->num_fences_mask;
-	seq &= drv->num_fences_mask;
+/**
+ * amdgpu_fence_signal - signal a range of fences one by one
+ *
+ * @ring: pointer to struct amdgpu_ring
+ * @last_seq: last sequence number signaled before
+ * @seq: sequence number to signal up to
+ *
+ * Returns the number of fences signaled.
+ */
+static unsigned int amdgpu_fence_signal(struct amdgpu_ring *ring,
+					uint32_t last_seq, uint32_t seq)
+{
+	struct amdgpu_fence_driver *drv = &ring->fence_drv;
+	struct amdgpu_device *adev = ring->adev;
+	unsigned int count = 0;
 
 	do {
 		struct dma_fence *fence, **ptr;
@@ -302,11 +345,207 @@ bool amdgpu_fence_process(struct amdgpu_ring *ring)
 		dma_fence_put(fence);
 		pm_runtime_mark_last_busy(adev_to_drm(adev)->dev);
 		pm_runtime_put_autosuspend(adev_to_drm(adev)->dev);
+		++count;
 	} while (last_seq != seq);
 
+	return count;
+}
+
+/**
+ * __amdgpu_fence_process - check for fence activity
+ *
+ * @ring: pointer to struct amdgpu_ring
+ * @polled: true when called from the fence poll thread
+ *
+ * Implementation of amdgpu_fence_process(). Outside of
+ * AMDGPU_FENCE_MODE_IRQ the seqno is read again after signaling and
+ * processing continues while it moves, so that a burst of completions is
+ * handled in a single pass instead of an interrupt each.
+ *
+ * Returns true if fence was processed
+ */
+static bool __amdgpu_fence_process(struct amdgpu_ring *ring, bool polled)
+{
+	struct amdgpu_fence_driver *drv = &ring->fence_drv;
+	bool coalesce = READ_ONCE(drv->mode) != AMDGPU_FENCE_MODE_IRQ;
+	unsigned int passes = coalesce ? AMDGPU_FENCE_COALESCE_PASSES : 1;
+	unsigned int count = 0;
+	uint32_t seq, last_seq;
+	bool first = true;
+
+	do {
+		do {
+			last_seq = atomic_read(&ring->fence_drv.last_seq);
+			seq = amdgpu_fence_read(ring);
+
+		} while (atomic_cmpxchg(&drv->last_seq, last_seq, seq) != last_seq);
+
+		if (first && del_timer(&ring->fence_drv.fallback_timer) &&
+		    seq != ring->fence_drv.sync_seq)
+			amdgpu_fence_schedule_fallback(ring);
+		first = false;
+
+		if (seq == last_seq)
+			break;
+
+		last_seq &= drv->num_fences_mask;
+		seq &= drv->num_fences_mask;
+
+		if (coalesce)
+			count += amdgpu_fence_signal_batched(ring, last_seq, seq);
+		else
+			count += amdgpu_fence_signal(ring, last_seq, seq);
+	} while (--passes);
+
+	atomic64_inc(&drv->stats.passes);
+	if (unlikely(!count)) {
+		atomic64_inc(&drv->stats.empty_passes);
+		return false;
+	}
+
+	atomic64_add(count, &drv->stats.signaled);
+	if (polled)
+		atomic64_add(count, &drv->stats.polled);
 	return true;
 }
 
+/**
+ * amdgpu_fence_process - check for fence activity
+ *
+ * @ring: pointer to struct amdgpu_ring
+ *
+ * Checks the current fence value and calculates the last
+ * signalled fence value. Wakes the fence queue if the
+ * sequence number has increased.
+ *
+ * Returns true if fence was processed
+ */
+bool amdgpu_fence_process(struct amdgpu_ring *ring)
+{
+	return __amdgpu_fence_process(ring, false);
+}
+
+/**
+ * amdgpu_fence_poll_pending - check if polled rings have work
+ *
+ * @adev: amdgpu device pointer
+ *
+ * Returns true if any ring in AMDGPU_FENCE_MODE_POLL has unsignaled fences.
+ */
+static bool amdgpu_fence_poll_pending(struct amdgpu_device *adev)
+{
+	unsigned int i;
+
+	for (i = 0; i < AMDGPU_MAX_RINGS; ++i) {
+		struct amdgpu_ring *ring = adev->rings[i];
+
+		if (!ring || !ring->fence_drv.initialized ||
+		    READ_ONCE(ring->fence_drv.mode) != AMDGPU_FENCE_MODE_POLL)
+			continue;
+
+		if (atomic_read(&ring->fence_drv.last_seq) !=
+		    READ_ONCE(ring->fence_drv.sync_seq))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * amdgpu_fence_poll_thread - busy poll the fences of selected rings
+ *
+ * @data: amdgpu device pointer
+ *
+ * Polls the seqno of all rings in AMDGPU_FENCE_MODE_POLL as long as they
+ * have outstanding fences and for amdgpu_fence_poll_idle microseconds after
+ * that. Then it sleeps until amdgpu_fence_emit() wakes it up again, in the
+ * meantime the fence interrupt keeps signaling as usual.
+ */
+static int amdgpu_fence_poll_thread(void *data)
+{
+	struct amdgpu_device *adev = data;
+	ktime_t last_busy = ktime_get();
+
+	while (!kthread_should_stop()) {
+		unsigned int i;
+
+		for (i = 0; i < AMDGPU_MAX_RINGS; ++i) {
+			struct amdgpu_ring *ring = adev->rings[i];
+
+			if (!ring || !ring->fence_drv.initialized ||
+			    READ_ONCE(ring->fence_drv.mode) !=
+			    AMDGPU_FENCE_MODE_POLL)
+				continue;
+
+			if (__amdgpu_fence_process(ring, true))
+				last_busy = ktime_get();
+		}
+
+		if (amdgpu_fence_poll_pending(adev)) {
+			last_busy = ktime_get();
+		} else if (ktime_us_delta(ktime_get(), last_busy) >=
+			   READ_ONCE(amdgpu_fence_poll_idle)) {
+			wait_event_interruptible(adev->fence_poll_wq,
+						 kthread_should_stop() ||
+						 amdgpu_fence_poll_pending(adev));
+			last_busy = ktime_get();
+			continue;
+		}
+
+		cpu_relax();
+		cond_resched();
+	}
+	return 0;
+}
+
+/**
+ * amdgpu_fence_poll_start - start the fence poll thread if necessary
+ *
+ * @adev: amdgpu device pointer
+ *
+ * Returns 0 for success, error for failure.
+ */
+static int amdgpu_fence_poll_start(struct amdgpu_device *adev)
+{
+	struct task_struct *thread;
+	int r = 0;
+
+	mutex_lock(&adev->fence_poll_lock);
+	if (adev->fence_poll_thread)
+		goto out_unlock;
+
+	thread = kthread_create(amdgpu_fence_poll_thread, adev,
+				"amdgpu_fpoll:%s", dev_name(adev->dev));
+	if (IS_ERR(thread)) {
+		r = PTR_ERR(thread);
+		goto out_unlock;
+	}
+
+	if (amdgpu_fence_poll_cpu >= 0 && amdgpu_fence_poll_cpu < nr_cpu_ids &&
+	    cpu_online(amdgpu_fence_poll_cpu))
+		kthread_bind(thread, amdgpu_fence_poll_cpu);
+	wake_up_process(thread);
+	adev->fence_poll_thread = thread;
+
+out_unlock:
+	mutex_unlock(&adev->fence_poll_lock);
+	return r;
+}
+
+/**
+ * amdgpu_fence_poll_stop - stop the fence poll thread
+ *
+ * @adev: amdgpu device pointer
+ */
+static void amdgpu_fence_poll_stop(struct amdgpu_device *adev)
+{
+	mutex_lock(&adev->fence_poll_lock);
+	if (adev->fence_poll_thread) {
+		kthread_stop(adev->fence_poll_thread);
+		adev->fence_poll_thread = NULL;
+	}
+	mutex_unlock(&adev->fence_poll_lock);
+}
+
 /**
  * amdgpu_fence_fallback - fallback for hardware interrupts
  *
@@ -471,6 +710,11 @@ int amdgpu_fence_driver_init_ring(struct amdgpu_ring *ring,
 	ring->fence_drv.sync_seq = 0;
 	atomic_set(&ring->fence_drv.last_seq, 0);
 	ring->fence_drv.initialized = false;
+	ring->fence_drv.mode = AMDGPU_FENCE_MODE_COALESCE;
+	atomic64_set(&ring->fence_drv.stats.passes, 0);
+	atomic64_set(&ring->fence_drv.stats.empty_passes, 0);
+	atomic64_set(&ring->fence_drv.stats.signaled, 0);
+	atomic64_set(&ring->fence_drv.stats.polled, 0);
 
 	timer_setup(&ring->fence_drv.fallback_timer, amdgpu_fence_fallback, 0);
 
@@ -500,9 +744,10 @@ int amdgpu_fence_driver_init_ring(struct amdgpu_ring *ring,
 		break;
 	}
 
-	r = drm_sched_init(&ring->sched, &amdgpu_sched_ops,
+	r = drm_sched_init(&ring->sched, &amdgpu_sched_ops, NULL,
 			   num_hw_submission, amdgpu_job_hang_limit,
-			   timeout, NULL, sched_score, ring->name);
+			   timeout, NULL, sched_score, ring->name,
+			   DRM_SCHED_POLICY_DEFAULT);
 	if (r) {
 		DRM_ERROR("Failed to create scheduler on ring %s.\n",
 			  ring->name);
@@ -526,6 +771,9 @@ int amdgpu_fence_driver_init_ring(struct amdgpu_ring *ring,
  */
 int amdgpu_fence_driver_sw_init(struct amdgpu_device *adev)
 {
+	mutex_init(&adev->fence_poll_lock);
+	init_waitqueue_head(&adev->fence_poll_wq);
+	adev->fence_poll_thread = NULL;
 	return 0;
 }
 
@@ -541,6 +789,8 @@ void amdgpu_fence_driver_hw_fini(struct amdgpu_device *adev)
 {
 	int i, r;
 
+	amdgpu_fence_poll_stop(adev);
+
 	for (i = 0; i < AMDGPU_MAX_RINGS; i++) {
 		struct amdgpu_ring *ring = adev->rings[i];
 
@@ -599,6 +849,7 @@ void amdgpu_fence_driver_sw_fini(struct amdgpu_device *adev)
  */
 void amdgpu_fence_driver_hw_init(struct amdgpu_device *adev)
 {
+	bool poll = false;
 	int i;
 
 	for (i = 0; i < AMDGPU_MAX_RINGS; i++) {
@@ -610,7 +861,14 @@ void amdgpu_fence_driver_hw_init(struct amdgpu_device *adev)
 		if (ring->fence_drv.irq_src)
 			amdgpu_irq_get(adev, ring->fence_drv.irq_src,
 				       ring->fence_drv.irq_type);
+
+		if (ring->fence_drv.mode == AMDGPU_FENCE_MODE_POLL)
+			poll = true;
 	}
+
+	/* restart polling for rings which were in polled mode before suspend */
+	if (poll && amdgpu_fence_poll_start(adev))
+		DRM_WARN("Failed to restart the fence poll thread\n");
 }
 
 /**
@@ -772,6 +1030,12 @@ static const struct dma_fence_ops amdgpu_job_fence_ops = {
  * Fence debugfs
  */
 #if defined(CONFIG_DEBUG_FS)
+static const char * const amdgpu_fence_mode_names[AMDGPU_FENCE_MODE_MAX] = {
+	[AMDGPU_FENCE_MODE_IRQ] = "irq",
+	[AMDGPU_FENCE_MODE_COALESCE] = "coalesce",
+	[AMDGPU_FENCE_MODE_POLL] = "poll",
+};
+
 static int amdgpu_debugfs_fence_info_show(struct seq_file *m, void *unused)
 {
 	struct amdgpu_device *adev = (struct amdgpu_device *)m->private;
@@ -789,6 +1053,14 @@ static int amdgpu_debugfs_fence_info_show(struct seq_file *m, void *unused)
 			   atomic_read(&ring->fence_drv.last_seq));
 		seq_printf(m, "Last emitted                 0x%08x\n",
 			   ring->fence_drv.sync_seq);
+		seq_printf(m, "Signal mode                  %s\n",
+			   amdgpu_fence_mode_names[ring->fence_drv.mode]);
+		seq_printf(m, "Process passes               %lld (%lld empty)\n",
+			   (long long)atomic64_read(&ring->fence_drv.stats.passes),
+			   (long long)atomic64_read(&ring->fence_drv.stats.empty_passes));
+		seq_printf(m, "Fences signaled              %lld (%lld polled)\n",
+			   (long long)atomic64_read(&ring->fence_drv.stats.signaled),
+			   (long long)atomic64_read(&ring->fence_drv.stats.polled));
 
 		if (ring->funcs->type == AMDGPU_RING_TYPE_GFX ||
 		    ring->funcs->type == AMDGPU_RING_TYPE_SDMA) {
@@ -843,8 +1115,58 @@ DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_fence_info);
 DEFINE_DEBUGFS_ATTRIBUTE(amdgpu_debugfs_gpu_recover_fops, gpu_recover_get, NULL,
 			 "%lld\n");
 
+/*
+ * amdgpu_debugfs_fence_mode - select how the fences of a ring are signaled
+ *
+ * Write 0 (irq), 1 (coalesce, the default) or 2 (poll), see
+ * enum amdgpu_fence_mode.
+ */
+static int amdgpu_debugfs_fence_mode_get(void *data, u64 *val)
+{
+	struct amdgpu_ring *ring = data;
+
+	*val = READ_ONCE(ring->fence_drv.mode);
+	return 0;
+}
+
+static int amdgpu_debugfs_fence_mode_set(void *data, u64 val)
+{
+	struct amdgpu_ring *ring = data;
+	struct amdgpu_device *adev = ring->adev;
+	int r;
+
+	if (val >= AMDGPU_FENCE_MODE_MAX)
+		return -EINVAL;
+
+	if (val == AMDGPU_FENCE_MODE_POLL) {
+		r = amdgpu_fence_poll_start(adev);
+		if (r)
+			return r;
+	}
+
+	WRITE_ONCE(ring->fence_drv.mode, val);
+	wake_up(&adev->fence_poll_wq);
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(amdgpu_debugfs_fence_mode_fops,
+			 amdgpu_debugfs_fence_mode_get,
+			 amdgpu_debugfs_fence_mode_set, "%llu\n");
+
 #endif
 
+void amdgpu_debugfs_fence_ring_init(struct amdgpu_ring *ring,
+				    struct dentry *root)
+{
+#if defined(CONFIG_DEBUG_FS)
+	char name[32];
+
+	sprintf(name, "amdgpu_fence_mode_%s", ring->name);
+	debugfs_create_file(name, 0644, root, ring,
+			    &amdgpu_debugfs_fence_mode_fops);
+#endif
+}
+
 void amdgpu_debugfs_fence_init(struct amdgpu_device *adev)
 {
 #if defined(CONFIG_DEBUG_FS)
@@ -182,10 +182,7 @@ int amdgpu_gart_unbind(struct amdgpu_device *adev, uint64_t offset,
 			page_base += AMDGPU_GPU_PAGE_SIZE;
 		}
 	}
-	mb();
-	amdgpu_device_flush_hdp(adev, NULL);
-	for (i = 0; i < adev->num_vmhubs; i++)
-		amdgpu_gmc_flush_gpu_tlb(adev, 0, i, 0);
+	amdgpu_gart_invalidate_tlb(adev);
 
 	drm_dev_exit(idx);
 	return 0;
@@ -269,15 +266,27 @@ int amdgpu_gart_bind(struct amdgpu_device *adev, uint64_t offset,
  *
  * Invalidate gart TLB which can be use as a way to flush gart changes
  *
+ * Callers updating the table at the same time share one HDP flush and TLB
+ * invalidation: when we get the lock after another flush which started after
+ * our PTE writes, there is nothing left to do.
  */
 void amdgpu_gart_invalidate_tlb(struct amdgpu_device *adev)
 {
+	uint64_t seq;
 	int i;
 
 	mb();
-	amdgpu_device_flush_hdp(adev, NULL);
-	for (i = 0; i < adev->num_vmhubs; i++)
-		amdgpu_gmc_flush_gpu_tlb(adev, 0, i, 0);
+	seq = atomic64_inc_return(&adev->gart.update_seq);
+
+	mutex_lock(&adev->gart.flush_lock);
+	if (adev->gart.flushed_seq < seq) {
+		seq = atomic64_read(&adev->gart.update_seq);
+		amdgpu_device_flush_hdp(adev, NULL);
+		for (i = 0; i < adev->num_vmhubs; i++)
+			amdgpu_gmc_flush_gpu_tlb(adev, 0, i, 0);
+		adev->gart.flushed_seq = seq;
+	}
+	mutex_unlock(&adev->gart.flush_lock);
 }
 
 /**
@@ -303,6 +312,9 @@ int amdgpu_gart_init(struct amdgpu_device *adev)
 	r = amdgpu_gart_dummy_page_init(adev);
 	if (r)
 		return r;
+	mutex_init(&adev->gart.flush_lock);
+	atomic64_set(&adev->gart.update_seq, 0);
+	adev->gart.flushed_seq = 0;
 	/* Compute table size */
 	adev->gart.num_cpu_pages = adev->gmc.gart_size / PAGE_SIZE;
 	adev->gart.num_gpu_pages = adev->gmc.gart_size / AMDGPU_GPU_PAGE_SIZE;
@@ -50,6 +50,11 @@ struct amdgpu_gart {
 
 	/* Asic default pte flags */
 	uint64_t			gart_pte_flags;
+
+	/* TLB invalidations of concurrent updates are merged */
+	struct mutex			flush_lock;
+	atomic64_t			update_seq;
+	uint64_t			flushed_seq;
 };
 
 int amdgpu_gart_table_vram_alloc(struct amdgpu_device *adev);
@@ -601,24 +601,32 @@ static void amdgpu_gem_va_update_vm(struct amdgpu_device *adev,
 				    struct amdgpu_bo_va *bo_va,
 				    uint32_t operation)
 {
+	struct amdgpu_vm_update_params params;
 	int r;
 
 	if (!amdgpu_vm_ready(vm))
 		return;
 
-	r = amdgpu_vm_clear_freed(adev, vm, NULL);
+	/* Submit the unmap, map and PDE updates as a single job */
+	r = amdgpu_vm_update_begin(adev, vm, &params);
 	if (r)
 		goto error;
 
+	r = amdgpu_vm_clear_freed(adev, vm, NULL);
+	if (r)
+		goto end;
+
 	if (operation == AMDGPU_VA_OP_MAP ||
 	    operation == AMDGPU_VA_OP_REPLACE) {
 		r = amdgpu_vm_bo_update(adev, bo_va, false, NULL);
 		if (r)
-			goto error;
+			goto end;
 	}
 
 	r = amdgpu_vm_update_pdes(adev, vm, false);
 
+end:
+	r = amdgpu_vm_update_end(adev, vm, NULL) ?: r;
 error:
 	if (r && r != -ERESTARTSYS)
 		DRM_ERROR("Couldn't update BO_VA (%d)\n", r);
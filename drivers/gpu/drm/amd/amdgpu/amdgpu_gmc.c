@@ -25,6 +25,7 @@
  */
 
 #include <linux/io-64-nonatomic-lo-hi.h>
+#include <linux/sort.h>
 
 #include "amdgpu.h"
 #include "amdgpu_gmc.h"
@@ -436,6 +437,96 @@ void amdgpu_gmc_filter_faults_remove(struct amdgpu_device *adev, uint64_t addr,
 	} while (fault->timestamp < tmp);
 }
 
+/**
+ * amdgpu_gmc_queue_fault - collect a retry fault for batched handling
+ *
+ * @adev: amdgpu device structure
+ * @ih: IH ring the fault was received on
+ * @pasid: PASID of the faulting VM
+ * @addr: address of the fault
+ * @write_fault: true for write faults
+ *
+ * Retry faults of compute VMs are collected while a chunk of IVs is
+ * dispatched and handled together by amdgpu_gmc_flush_faults() afterwards.
+ * Returns true if the fault was queued, false if the caller has to handle it.
+ */
+bool amdgpu_gmc_queue_fault(struct amdgpu_device *adev,
+			    struct amdgpu_ih_ring *ih, uint16_t pasid,
+			    uint64_t addr, bool write_fault)
+{
+	struct amdgpu_gmc_fault_batch *batch = ih->faults;
+	unsigned int i;
+
+	if (!batch || !amdgpu_vm_is_compute_pasid(adev, pasid))
+		return false;
+
+	if (batch->count == AMDGPU_GMC_FAULT_BATCH_SIZE)
+		amdgpu_gmc_flush_faults(adev, ih);
+
+	i = batch->count++;
+	batch->faults[i].addr = addr;
+	batch->faults[i].pasid = pasid;
+	batch->faults[i].write_fault = write_fault;
+	return true;
+}
+
+static int amdgpu_gmc_fault_cmp(const void *a, const void *b)
+{
+	const struct amdgpu_gmc_batched_fault *fa = a, *fb = b;
+
+	if (fa->pasid != fb->pasid)
+		return fa->pasid < fb->pasid ? -1 : 1;
+	if (fa->write_fault != fb->write_fault)
+		return fa->write_fault ? 1 : -1;
+	if (fa->addr != fb->addr)
+		return fa->addr < fb->addr ? -1 : 1;
+	return 0;
+}
+
+/**
+ * amdgpu_gmc_flush_faults - handle the collected retry faults
+ *
+ * @adev: amdgpu device structure
+ * @ih: IH ring the faults were received on
+ *
+ * Sorts the faults by VM and address and hands all faults of a VM over at
+ * once, so each range is only validated and mapped once no matter how many
+ * of its pages faulted.
+ */
+void amdgpu_gmc_flush_faults(struct amdgpu_device *adev,
+			     struct amdgpu_ih_ring *ih)
+{
+	struct amdgpu_gmc_fault_batch *batch = ih->faults;
+	uint64_t addrs[AMDGPU_GMC_FAULT_BATCH_SIZE];
+	unsigned int i, j, count;
+
+	if (!batch || !batch->count)
+		return;
+
+	sort(batch->faults, batch->count, sizeof(batch->faults[0]),
+	     amdgpu_gmc_fault_cmp, NULL);
+
+	for (i = 0; i < batch->count; i = j) {
+		count = 0;
+		for (j = i; j < batch->count; ++j) {
+			uint64_t addr = batch->faults[j].addr /
+				AMDGPU_GPU_PAGE_SIZE;
+
+			if (batch->faults[j].pasid != batch->faults[i].pasid ||
+			    batch->faults[j].write_fault !=
+			    batch->faults[i].write_fault)
+				break;
+
+			if (!count || addrs[count - 1] != addr)
+				addrs[count++] = addr;
+		}
+
+		amdgpu_vm_handle_faults(adev, batch->faults[i].pasid, addrs,
+					count, batch->faults[i].write_fault);
+	}
+	batch->count = 0;
+}
+
 int amdgpu_gmc_ras_late_init(struct amdgpu_device *adev)
 {
 	int r;
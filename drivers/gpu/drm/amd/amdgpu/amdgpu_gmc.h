@@ -60,6 +60,11 @@
  */
 #define AMDGPU_GMC_FAULT_TIMEOUT	5000ULL
 
+/*
+ * Maximum number of retry faults collected before they are handled
+ */
+#define AMDGPU_GMC_FAULT_BATCH_SIZE	32
+
 struct firmware;
 
 /*
@@ -71,6 +76,21 @@ struct amdgpu_gmc_fault {
 	atomic64_t	key;
 };
 
+/*
+ * Retry faults of compute VMs collected by an IH ring, only accessed by the
+ * context processing the ring
+ */
+struct amdgpu_gmc_batched_fault {
+	uint64_t	addr;
+	uint16_t	pasid;
+	bool		write_fault;
+};
+
+struct amdgpu_gmc_fault_batch {
+	unsigned int			count;
+	struct amdgpu_gmc_batched_fault	faults[AMDGPU_GMC_FAULT_BATCH_SIZE];
+};
+
 /*
  * VMHUB structures, functions & helpers
  */
@@ -160,6 +180,8 @@ struct amdgpu_xgmi {
 	bool connected_to_cpu;
 	bool pending_reset;
 	const struct amdgpu_xgmi_ras_funcs *ras_funcs;
+	/* link bandwidth sampling, NULL if disabled */
+	struct amdgpu_xgmi_bw *bw;
 };
 
 struct amdgpu_gmc {
@@ -321,6 +343,11 @@ bool amdgpu_gmc_filter_faults(struct amdgpu_device *adev,
 			      uint16_t pasid, uint64_t timestamp);
 void amdgpu_gmc_filter_faults_remove(struct amdgpu_device *adev, uint64_t addr,
 				     uint16_t pasid);
+bool amdgpu_gmc_queue_fault(struct amdgpu_device *adev,
+			    struct amdgpu_ih_ring *ih, uint16_t pasid,
+			    uint64_t addr, bool write_fault);
+void amdgpu_gmc_flush_faults(struct amdgpu_device *adev,
+			     struct amdgpu_ih_ring *ih);
 int amdgpu_gmc_ras_late_init(struct amdgpu_device *adev);
 void amdgpu_gmc_ras_fini(struct amdgpu_device *adev);
 int amdgpu_gmc_allocate_vm_inv_eng(struct amdgpu_device *adev);
@@ -22,12 +22,47 @@
  * Authors: Christian König
  */
 
+#include <linux/bitmap.h>
 #include <drm/ttm/ttm_range_manager.h>
 
 #include "amdgpu.h"
 
+/* Size of the GART chunks carved out of the drm_mm for small allocations */
+#define AMDGPU_GTT_CHUNK_PAGES		512
+
+/* Largest allocation which is sub-allocated from a chunk */
+#define AMDGPU_GTT_CHUNK_MAX_PAGES	16
+
+/* Color of chunk nodes in the drm_mm, BO nodes use 0 */
+#define AMDGPU_GTT_CHUNK_COLOR		1
+
+/* Maximum number of workers used by amdgpu_gtt_mgr_recover() */
+#define AMDGPU_GTT_RECOVER_MAX_JOBS	8
+
+/**
+ * struct amdgpu_gtt_chunk - range of GART space for small allocations
+ *
+ * @node: the range in the GART drm_mm
+ * @lock: protects the members below
+ * @used: bitmap of the used pages
+ * @num_used: number of used pages
+ * @retired: the chunk is no longer the current chunk of a CPU and is freed
+ *	as soon as it becomes empty
+ * @nodes: list of allocations inside the chunk
+ */
+struct amdgpu_gtt_chunk {
+	struct drm_mm_node node;
+	spinlock_t lock;
+	DECLARE_BITMAP(used, AMDGPU_GTT_CHUNK_PAGES);
+	unsigned int num_used;
+	bool retired;
+	struct list_head nodes;
+};
+
 struct amdgpu_gtt_node {
 	struct ttm_buffer_object *tbo;
+	struct amdgpu_gtt_chunk *chunk;
+	struct list_head chunk_link;
 	struct ttm_range_mgr_node base;
 };
 
@@ -107,7 +142,176 @@ bool amdgpu_gtt_mgr_has_gart_addr(struct ttm_resource *res)
 {
 	struct amdgpu_gtt_node *node = to_amdgpu_gtt_node(res);
 
-	return drm_mm_node_allocated(&node->base.mm_nodes[0]);
+	return node->chunk || drm_mm_node_allocated(&node->base.mm_nodes[0]);
+}
+
+/**
+ * amdgpu_gtt_mgr_chunk_free - return a chunk to the drm_mm
+ *
+ * @mgr: amdgpu_gtt_mgr pointer
+ * @chunk: the empty chunk to free
+ */
+static void amdgpu_gtt_mgr_chunk_free(struct amdgpu_gtt_mgr *mgr,
+				      struct amdgpu_gtt_chunk *chunk)
+{
+	write_lock(&mgr->lock);
+	drm_mm_remove_node(&chunk->node);
+	write_unlock(&mgr->lock);
+
+	atomic_dec(&mgr->num_chunks);
+	kfree(chunk);
+}
+
+/**
+ * amdgpu_gtt_mgr_chunk_retire - stop allocating from a chunk
+ *
+ * @mgr: amdgpu_gtt_mgr pointer
+ * @chunk: the chunk to retire
+ *
+ * The chunk is freed right away when it is empty, otherwise by the last
+ * amdgpu_gtt_mgr_chunk_del().
+ */
+static void amdgpu_gtt_mgr_chunk_retire(struct amdgpu_gtt_mgr *mgr,
+					struct amdgpu_gtt_chunk *chunk)
+{
+	bool empty;
+
+	spin_lock(&chunk->lock);
+	chunk->retired = true;
+	empty = !chunk->num_used;
+	spin_unlock(&chunk->lock);
+
+	if (empty)
+		amdgpu_gtt_mgr_chunk_free(mgr, chunk);
+}
+
+/**
+ * amdgpu_gtt_mgr_chunk_try - sub-allocate from a chunk
+ *
+ * @chunk: the chunk to allocate from
+ * @node: the node to allocate for
+ * @num_pages: size of the allocation
+ * @alignment: alignment of the allocation in pages
+ *
+ * Returns:
+ * 0 for success, -ENOSPC if the chunk is full.
+ */
+static int amdgpu_gtt_mgr_chunk_try(struct amdgpu_gtt_chunk *chunk,
+				    struct amdgpu_gtt_node *node,
+				    unsigned int num_pages,
+				    unsigned int alignment)
+{
+	unsigned long idx;
+
+	spin_lock(&chunk->lock);
+	idx = bitmap_find_next_zero_area(chunk->used, AMDGPU_GTT_CHUNK_PAGES,
+					 0, num_pages,
+					 alignment ? alignment - 1 : 0);
+	if (idx >= AMDGPU_GTT_CHUNK_PAGES) {
+		spin_unlock(&chunk->lock);
+		return -ENOSPC;
+	}
+
+	bitmap_set(chunk->used, idx, num_pages);
+	chunk->num_used += num_pages;
+	list_add(&node->chunk_link, &chunk->nodes);
+	spin_unlock(&chunk->lock);
+
+	node->chunk = chunk;
+	node->base.mm_nodes[0].start = chunk->node.start + idx;
+	node->base.mm_nodes[0].size = num_pages;
+	return 0;
+}
+
+/**
+ * amdgpu_gtt_mgr_chunk_new - sub-allocate a small node from a chunk
+ *
+ * @mgr: amdgpu_gtt_mgr pointer
+ * @node: the node to allocate for
+ * @num_pages: size of the allocation
+ * @alignment: alignment of the allocation in pages
+ *
+ * Small allocations are served from the current chunk of the CPU without
+ * touching the drm_mm or the manager lock. Only when the chunk is full a new
+ * one is carved out of the drm_mm.
+ *
+ * Returns:
+ * 0 for success, negative error code if no chunk could be allocated.
+ */
+static int amdgpu_gtt_mgr_chunk_new(struct amdgpu_gtt_mgr *mgr,
+				    struct amdgpu_gtt_node *node,
+				    unsigned int num_pages,
+				    unsigned int alignment)
+{
+	struct amdgpu_gtt_mgr_pcpu *pcpu;
+	struct amdgpu_gtt_chunk *chunk, *old;
+	int r;
+
+	pcpu = get_cpu_ptr(mgr->pcpu);
+	chunk = pcpu->chunk;
+	r = chunk ? amdgpu_gtt_mgr_chunk_try(chunk, node, num_pages,
+					     alignment) : -ENOSPC;
+	put_cpu_ptr(mgr->pcpu);
+	if (!r)
+		return 0;
+
+	chunk = kzalloc(sizeof(*chunk), GFP_KERNEL);
+	if (!chunk)
+		return -ENOMEM;
+
+	spin_lock_init(&chunk->lock);
+	INIT_LIST_HEAD(&chunk->nodes);
+	chunk->node.color = AMDGPU_GTT_CHUNK_COLOR;
+
+	write_lock(&mgr->lock);
+	r = drm_mm_insert_node_in_range(&mgr->mm, &chunk->node,
+					AMDGPU_GTT_CHUNK_PAGES,
+					AMDGPU_GTT_CHUNK_PAGES,
+					AMDGPU_GTT_CHUNK_COLOR, 0, U64_MAX,
+					DRM_MM_INSERT_BEST);
+	write_unlock(&mgr->lock);
+	if (unlikely(r)) {
+		kfree(chunk);
+		return r;
+	}
+	atomic_inc(&mgr->num_chunks);
+
+	/* The new chunk is empty, so this can't fail */
+	amdgpu_gtt_mgr_chunk_try(chunk, node, num_pages, alignment);
+
+	pcpu = get_cpu_ptr(mgr->pcpu);
+	old = pcpu->chunk;
+	pcpu->chunk = chunk;
+	put_cpu_ptr(mgr->pcpu);
+
+	if (old)
+		amdgpu_gtt_mgr_chunk_retire(mgr, old);
+	return 0;
+}
+
+/**
+ * amdgpu_gtt_mgr_chunk_del - free a node sub-allocated from a chunk
+ *
+ * @mgr: amdgpu_gtt_mgr pointer
+ * @node: the node to free
+ */
+static void amdgpu_gtt_mgr_chunk_del(struct amdgpu_gtt_mgr *mgr,
+				     struct amdgpu_gtt_node *node)
+{
+	struct amdgpu_gtt_chunk *chunk = node->chunk;
+	struct drm_mm_node *mm_node = &node->base.mm_nodes[0];
+	bool empty;
+
+	spin_lock(&chunk->lock);
+	bitmap_clear(chunk->used, mm_node->start - chunk->node.start,
+		     mm_node->size);
+	chunk->num_used -= mm_node->size;
+	list_del(&node->chunk_link);
+	empty = chunk->retired && !chunk->num_used;
+	spin_unlock(&chunk->lock);
+
+	if (empty)
+		amdgpu_gtt_mgr_chunk_free(mgr, chunk);
 }
 
 /**
@@ -126,6 +330,8 @@ static int amdgpu_gtt_mgr_new(struct ttm_resource_manager *man,
 			      struct ttm_resource **res)
 {
 	struct amdgpu_gtt_mgr *mgr = to_gtt_mgr(man);
+	struct amdgpu_device *adev = container_of(mgr, typeof(*adev),
+						  mman.gtt_mgr);
 	uint32_t num_pages = PFN_UP(tbo->base.size);
 	struct amdgpu_gtt_node *node;
 	int r;
@@ -145,14 +351,24 @@ static int amdgpu_gtt_mgr_new(struct ttm_resource_manager *man,
 	node->tbo = tbo;
 	ttm_resource_init(tbo, place, &node->base.base);
 
-	if (place->lpfn) {
-		spin_lock(&mgr->lock);
+	/* Small allocations which can be anywhere in the GART */
+	if (place->lpfn && !place->fpfn &&
+	    place->lpfn >= adev->gmc.gart_size >> PAGE_SHIFT &&
+	    num_pages <= AMDGPU_GTT_CHUNK_MAX_PAGES &&
+	    (!tbo->page_alignment || is_power_of_2(tbo->page_alignment)) &&
+	    tbo->page_alignment <= AMDGPU_GTT_CHUNK_PAGES &&
+	    !amdgpu_gtt_mgr_chunk_new(mgr, node, num_pages,
+				      tbo->page_alignment)) {
+		atomic64_inc(&mgr->chunk_allocs);
+		node->base.base.start = node->base.mm_nodes[0].start;
+	} else if (place->lpfn) {
+		write_lock(&mgr->lock);
 		r = drm_mm_insert_node_in_range(&mgr->mm,
 						&node->base.mm_nodes[0],
 						num_pages, tbo->page_alignment,
 						0, place->fpfn, place->lpfn,
 						DRM_MM_INSERT_BEST);
-		spin_unlock(&mgr->lock);
+		write_unlock(&mgr->lock);
 		if (unlikely(r))
 			goto err_free;
 
@@ -191,10 +407,13 @@ static void amdgpu_gtt_mgr_del(struct ttm_resource_manager *man,
 	struct amdgpu_gtt_node *node = to_amdgpu_gtt_node(res);
 	struct amdgpu_gtt_mgr *mgr = to_gtt_mgr(man);
 
-	spin_lock(&mgr->lock);
-	if (drm_mm_node_allocated(&node->base.mm_nodes[0]))
+	if (node->chunk) {
+		amdgpu_gtt_mgr_chunk_del(mgr, node);
+	} else if (drm_mm_node_allocated(&node->base.mm_nodes[0])) {
+		write_lock(&mgr->lock);
 		drm_mm_remove_node(&node->base.mm_nodes[0]);
-	spin_unlock(&mgr->lock);
+		write_unlock(&mgr->lock);
+	}
 
 	if (!(res->placement & TTM_PL_FLAG_TEMPORARY))
 		atomic64_sub(res->num_pages, &mgr->used);
@@ -215,29 +434,111 @@ uint64_t amdgpu_gtt_mgr_usage(struct amdgpu_gtt_mgr *mgr)
 	return atomic64_read(&mgr->used) * PAGE_SIZE;
 }
 
+struct amdgpu_gtt_recover_job {
+	struct work_struct work;
+	struct amdgpu_gtt_mgr *mgr;
+	u64 start, end;
+	int r;
+};
+
 /**
- * amdgpu_gtt_mgr_recover - re-init gart
+ * amdgpu_gtt_mgr_recover_range - re-init gart for a range
  *
  * @mgr: amdgpu_gtt_mgr pointer
+ * @start: first GART page
+ * @end: last GART page + 1
  *
- * Re-init the gart for each known BO in the GTT.
+ * Re-init the gart for each known BO starting inside the range. Only takes
+ * the manager lock for reading, so multiple ranges can be recovered in
+ * parallel.
  */
-int amdgpu_gtt_mgr_recover(struct amdgpu_gtt_mgr *mgr)
+static int amdgpu_gtt_mgr_recover_range(struct amdgpu_gtt_mgr *mgr,
+					u64 start, u64 end)
 {
 	struct amdgpu_gtt_node *node;
 	struct drm_mm_node *mm_node;
-	struct amdgpu_device *adev;
 	int r = 0;
 
-	adev = container_of(mgr, typeof(*adev), mman.gtt_mgr);
-	spin_lock(&mgr->lock);
-	drm_mm_for_each_node(mm_node, &mgr->mm) {
-		node = container_of(mm_node, typeof(*node), base.mm_nodes[0]);
-		r = amdgpu_ttm_recover_gart(node->tbo);
+	read_lock(&mgr->lock);
+	drm_mm_for_each_node_in_range(mm_node, &mgr->mm, start, end) {
+		if (mm_node->start < start)
+			continue;
+
+		if (mm_node->color == AMDGPU_GTT_CHUNK_COLOR) {
+			struct amdgpu_gtt_chunk *chunk =
+				container_of(mm_node, typeof(*chunk), node);
+
+			spin_lock(&chunk->lock);
+			list_for_each_entry(node, &chunk->nodes, chunk_link) {
+				r = amdgpu_ttm_recover_gart(node->tbo);
+				if (r)
+					break;
+			}
+			spin_unlock(&chunk->lock);
+		} else {
+			node = container_of(mm_node, typeof(*node),
+					    base.mm_nodes[0]);
+			r = amdgpu_ttm_recover_gart(node->tbo);
+		}
 		if (r)
 			break;
 	}
-	spin_unlock(&mgr->lock);
+	read_unlock(&mgr->lock);
+
+	return r;
+}
+
+static void amdgpu_gtt_mgr_recover_work(struct work_struct *work)
+{
+	struct amdgpu_gtt_recover_job *job =
+		container_of(work, typeof(*job), work);
+
+	job->r = amdgpu_gtt_mgr_recover_range(job->mgr, job->start, job->end);
+}
+
+/**
+ * amdgpu_gtt_mgr_recover - re-init gart
+ *
+ * @mgr: amdgpu_gtt_mgr pointer
+ *
+ * Re-init the gart for each known BO in the GTT. The GART is split into
+ * ranges which are recovered in parallel on multiple CPUs.
+ */
+int amdgpu_gtt_mgr_recover(struct amdgpu_gtt_mgr *mgr)
+{
+	struct amdgpu_gtt_recover_job jobs[AMDGPU_GTT_RECOVER_MAX_JOBS];
+	struct amdgpu_device *adev;
+	unsigned int i, num_jobs;
+	u64 start, size;
+	int r = 0;
+
+	adev = container_of(mgr, typeof(*adev), mman.gtt_mgr);
+	start = AMDGPU_GTT_MAX_TRANSFER_SIZE * AMDGPU_GTT_NUM_RESERVED_WINDOWS;
+	size = (adev->gmc.gart_size >> PAGE_SHIFT) - start;
+
+	num_jobs = clamp(num_online_cpus(), 1U,
+			 (unsigned int)AMDGPU_GTT_RECOVER_MAX_JOBS);
+	for (i = 0; i < num_jobs; ++i) {
+		struct amdgpu_gtt_recover_job *job = &jobs[i];
+
+		job->mgr = mgr;
+		job->start = start + div_u64(size * i, num_jobs);
+		job->end = start + div_u64(size * (i + 1), num_jobs);
+		job->r = 0;
+		INIT_WORK_ONSTACK(&job->work, amdgpu_gtt_mgr_recover_work);
+		if (i)
+			queue_work(system_unbound_wq, &job->work);
+	}
+
+	/* Do the first range ourself */
+	amdgpu_gtt_mgr_recover_work(&jobs[0].work);
+	for (i = 0; i < num_jobs; ++i) {
+		if (i)
+			flush_work(&jobs[i].work);
+		destroy_work_on_stack(&jobs[i].work);
+		if (!r)
+			r = jobs[i].r;
+	}
 
 	amdgpu_gart_invalidate_tlb(adev);
 
@@ -257,12 +558,15 @@ static void amdgpu_gtt_mgr_debug(struct ttm_resource_manager *man,
 {
 	struct amdgpu_gtt_mgr *mgr = to_gtt_mgr(man);
 
-	spin_lock(&mgr->lock);
+	read_lock(&mgr->lock);
 	drm_mm_print(&mgr->mm, printer);
-	spin_unlock(&mgr->lock);
+	read_unlock(&mgr->lock);
 
 	drm_printf(printer, "man size:%llu pages,  gtt used:%llu pages\n",
 		   man->size, atomic64_read(&mgr->used));
+	drm_printf(printer, "chunks:%d, chunk allocations:%llu\n",
+		   atomic_read(&mgr->num_chunks),
+		   atomic64_read(&mgr->chunk_allocs));
 }
 
 static const struct ttm_resource_manager_func amdgpu_gtt_mgr_func = {
@@ -291,11 +595,17 @@ int amdgpu_gtt_mgr_init(struct amdgpu_device *adev, uint64_t gtt_size)
 	ttm_resource_manager_init(man, &adev->mman.bdev,
 				  gtt_size >> PAGE_SHIFT);
 
-	start = AMDGPU_GTT_MAX_TRANSFER_SIZE * AMDGPU_GTT_NUM_TRANSFER_WINDOWS;
+	start = AMDGPU_GTT_MAX_TRANSFER_SIZE * AMDGPU_GTT_NUM_RESERVED_WINDOWS;
 	size = (adev->gmc.gart_size >> PAGE_SHIFT) - start;
+	mgr->pcpu = alloc_percpu(struct amdgpu_gtt_mgr_pcpu);
+	if (!mgr->pcpu)
+		return -ENOMEM;
+
 	drm_mm_init(&mgr->mm, start, size);
-	spin_lock_init(&mgr->lock);
+	rwlock_init(&mgr->lock);
 	atomic64_set(&mgr->used, 0);
+	atomic_set(&mgr->num_chunks, 0);
+	atomic64_set(&mgr->chunk_allocs, 0);
 
 	ttm_set_driver_manager(&adev->mman.bdev, TTM_PL_TT, &mgr->manager);
 	ttm_resource_manager_set_used(man, true);
@@ -314,6 +624,7 @@ void amdgpu_gtt_mgr_fini(struct amdgpu_device *adev)
 {
 	struct amdgpu_gtt_mgr *mgr = &adev->mman.gtt_mgr;
 	struct ttm_resource_manager *man = &mgr->manager;
+	unsigned int cpu;
 	int ret;
 
 	ttm_resource_manager_set_used(man, false);
@@ -322,9 +633,18 @@ void amdgpu_gtt_mgr_fini(struct amdgpu_device *adev)
 	if (ret)
 		return;
 
-	spin_lock(&mgr->lock);
+	for_each_possible_cpu(cpu) {
+		struct amdgpu_gtt_mgr_pcpu *pcpu = per_cpu_ptr(mgr->pcpu, cpu);
+
+		if (pcpu->chunk)
+			amdgpu_gtt_mgr_chunk_retire(mgr, pcpu->chunk);
+		pcpu->chunk = NULL;
+	}
+	free_percpu(mgr->pcpu);
+
+	write_lock(&mgr->lock);
 	drm_mm_takedown(&mgr->mm);
-	spin_unlock(&mgr->lock);
+	write_unlock(&mgr->lock);
 
 	ttm_resource_manager_cleanup(man);
 	ttm_set_driver_manager(&adev->mman.bdev, TTM_PL_TT, NULL);
@@ -65,10 +65,14 @@ int amdgpu_ib_get(struct amdgpu_device *adev, struct amdgpu_vm *vm,
 		  unsigned size, enum amdgpu_ib_pool_type pool_type,
 		  struct amdgpu_ib *ib)
 {
+	enum amdgpu_ib_pool_class class;
 	int r;
 
 	if (size) {
-		r = amdgpu_sa_bo_new(&adev->ib_pools[pool_type],
+		/* Small IBs shouldn't wait behind large ones to be freed */
+		class = size <= AMDGPU_IB_POOL_SMALL_MAX ?
+			AMDGPU_IB_POOL_CLASS_SMALL : AMDGPU_IB_POOL_CLASS_LARGE;
+		r = amdgpu_sa_bo_new(&adev->ib_pools[pool_type][class],
 				      &ib->sa_bo, size, 256);
 		if (r) {
 			dev_err(adev->dev, "failed to get a new IB (%d)\n", r);
@@ -300,13 +304,17 @@ int amdgpu_ib_schedule(struct amdgpu_ring *ring, unsigned num_ibs,
  */
 int amdgpu_ib_pool_init(struct amdgpu_device *adev)
 {
+	struct amdgpu_sa_manager *pools = &adev->ib_pools[0][0];
 	int r, i;
 
 	if (adev->ib_pool_ready)
 		return 0;
 
-	for (i = 0; i < AMDGPU_IB_POOL_MAX; i++) {
-		r = amdgpu_sa_bo_manager_init(adev, &adev->ib_pools[i],
+	for (i = 0; i < AMDGPU_IB_POOL_MAX * AMDGPU_IB_POOL_CLASS_MAX; i++) {
+		r = amdgpu_sa_bo_manager_init(adev, &pools[i],
+					      i % AMDGPU_IB_POOL_CLASS_MAX ==
+					      AMDGPU_IB_POOL_CLASS_SMALL ?
+					      AMDGPU_IB_POOL_SMALL_SIZE :
 					      AMDGPU_IB_POOL_SIZE,
 					      AMDGPU_GPU_PAGE_SIZE,
 					      AMDGPU_GEM_DOMAIN_GTT);
@@ -319,7 +327,7 @@ int amdgpu_ib_pool_init(struct amdgpu_device *adev)
 
 error:
 	while (i--)
-		amdgpu_sa_bo_manager_fini(adev, &adev->ib_pools[i]);
+		amdgpu_sa_bo_manager_fini(adev, &pools[i]);
 	return r;
 }
 
@@ -333,13 +341,14 @@ int amdgpu_ib_pool_init(struct amdgpu_device *adev)
  */
 void amdgpu_ib_pool_fini(struct amdgpu_device *adev)
 {
-	int i;
+	int i, j;
 
 	if (!adev->ib_pool_ready)
 		return;
 
 	for (i = 0; i < AMDGPU_IB_POOL_MAX; i++)
-		amdgpu_sa_bo_manager_fini(adev, &adev->ib_pools[i]);
+		for (j = 0; j < AMDGPU_IB_POOL_CLASS_MAX; j++)
+			amdgpu_sa_bo_manager_fini(adev, &adev->ib_pools[i][j]);
 	adev->ib_pool_ready = false;
 }
 
@@ -431,16 +440,24 @@ int amdgpu_ib_ring_tests(struct amdgpu_device *adev)
 
 static int amdgpu_debugfs_sa_info_show(struct seq_file *m, void *unused)
 {
+	static const char * const names[AMDGPU_IB_POOL_MAX] = {
+		[AMDGPU_IB_POOL_DELAYED] = "DELAYED",
+		[AMDGPU_IB_POOL_IMMEDIATE] = "IMMEDIATE",
+		[AMDGPU_IB_POOL_DIRECT] = "DIRECT",
+	};
 	struct amdgpu_device *adev = (struct amdgpu_device *)m->private;
+	int i;
 
-	seq_printf(m, "--------------------- DELAYED --------------------- \n");
-	amdgpu_sa_bo_dump_debug_info(&adev->ib_pools[AMDGPU_IB_POOL_DELAYED],
-				     m);
-	seq_printf(m, "-------------------- IMMEDIATE -------------------- \n");
-	amdgpu_sa_bo_dump_debug_info(&adev->ib_pools[AMDGPU_IB_POOL_IMMEDIATE],
-				     m);
-	seq_printf(m, "--------------------- DIRECT ---------------------- \n");
-	amdgpu_sa_bo_dump_debug_info(&adev->ib_pools[AMDGPU_IB_POOL_DIRECT], m);
+	for (i = 0; i < AMDGPU_IB_POOL_MAX; i++) {
+		seq_printf(m, "------------------- %s SMALL ------------------- \n",
+			   names[i]);
+		amdgpu_sa_bo_dump_debug_info(
+			&adev->ib_pools[i][AMDGPU_IB_POOL_CLASS_SMALL], m);
+		seq_printf(m, "------------------- %s LARGE ------------------- \n",
+			   names[i]);
+		amdgpu_sa_bo_dump_debug_info(
+			&adev->ib_pools[i][AMDGPU_IB_POOL_CLASS_LARGE], m);
+	}
 
 	return 0;
 }
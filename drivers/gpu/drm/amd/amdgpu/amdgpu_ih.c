@@ -44,6 +44,19 @@ int amdgpu_ih_ring_init(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih,
 	u32 rb_bufsz;
 	int r;
 
+	if (!ih->batch) {
+		ih->batch = kcalloc(AMDGPU_IH_MAX_NUM_IVS, sizeof(*ih->batch),
+				    GFP_KERNEL);
+		if (!ih->batch)
+			return -ENOMEM;
+	}
+
+	if (!ih->faults) {
+		ih->faults = kzalloc(sizeof(*ih->faults), GFP_KERNEL);
+		if (!ih->faults)
+			return -ENOMEM;
+	}
+
 	/* Align ring size */
 	rb_bufsz = order_base_2(ring_size / 4);
 	ring_size = (1 << rb_bufsz) * 4;
@@ -115,6 +128,10 @@ int amdgpu_ih_ring_init(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih,
  */
 void amdgpu_ih_ring_fini(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih)
 {
+	kfree(ih->batch);
+	ih->batch = NULL;
+	kfree(ih->faults);
+	ih->faults = NULL;
 
 	if (!ih->ring)
 		return;
@@ -199,6 +216,11 @@ int amdgpu_ih_wait_on_checkpoint_process_ts(struct amdgpu_device *adev,
  * @ih: ih ring to process
  *
  * Interrupt hander (VI), walk the IH ring.
+ *
+ * IVs are first decoded in batches of up to AMDGPU_IH_MAX_NUM_IVS entries
+ * and then dispatched together. The ring entries stay valid until the rptr
+ * is written back after the batch.
+ *
  * Returns irq process return code.
  */
 int amdgpu_ih_process(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih)
@@ -212,16 +234,18 @@ int amdgpu_ih_process(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih)
 	wptr = amdgpu_ih_get_wptr(adev, ih);
 
 restart_ih:
-	count  = AMDGPU_IH_MAX_NUM_IVS;
 	DRM_DEBUG("%s: rptr %d, wptr %d\n", __func__, ih->rptr, wptr);
 
 	/* Order reading of wptr vs. reading of IH ring data */
 	rmb();
 
-	while (ih->rptr != wptr && --count) {
-		amdgpu_irq_dispatch(adev, ih);
+	for (count = 0; ih->rptr != wptr && count < AMDGPU_IH_MAX_NUM_IVS;
+	     ++count) {
+		amdgpu_irq_decode(adev, ih, &ih->batch[count]);
 		ih->rptr &= ih->ptr_mask;
 	}
+	amdgpu_irq_dispatch(adev, ih, count);
+	amdgpu_gmc_flush_faults(adev, ih);
 
 	amdgpu_ih_set_rptr(adev, ih);
 	wake_up_all(&ih->wait_process);
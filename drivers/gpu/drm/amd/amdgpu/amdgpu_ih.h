@@ -24,11 +24,14 @@
 #ifndef __AMDGPU_IH_H__
 #define __AMDGPU_IH_H__
 
+#include "soc15_ih_clientid.h"
+
 /* Maximum number of IVs processed at once */
 #define AMDGPU_IH_MAX_NUM_IVS	32
 
 struct amdgpu_device;
 struct amdgpu_iv_entry;
+struct amdgpu_gmc_fault_batch;
 
 struct amdgpu_ih_regs {
 	uint32_t ih_rb_base;
@@ -42,6 +45,21 @@ struct amdgpu_ih_regs {
 	uint32_t psp_reg_id;
 };
 
+/*
+ * IV statistics of an IH ring, only updated by the context processing the
+ * ring. The snapshot is used by debugfs to calculate rates.
+ */
+struct amdgpu_ih_stats {
+	u64		ivs[SOC15_IH_CLIENTID_MAX];
+	u64		unhandled[SOC15_IH_CLIENTID_MAX];
+	u64		coalesced[SOC15_IH_CLIENTID_MAX];
+	u64		invalid;
+	u64		batches;
+
+	u64		snapshot[SOC15_IH_CLIENTID_MAX];
+	unsigned long	snapshot_jiffies;
+};
+
 /*
  * R6xx+ IH ring
  */
@@ -69,6 +87,12 @@ struct amdgpu_ih_ring {
 	/* For waiting on IH processing at checkpoint. */
 	wait_queue_head_t wait_process;
 	uint64_t		processed_timestamp;
+
+	/* IVs pre-decoded by amdgpu_ih_process() */
+	struct amdgpu_iv_entry	*batch;
+	/* retry faults collected while dispatching the IVs */
+	struct amdgpu_gmc_fault_batch	*faults;
+	struct amdgpu_ih_stats	stats;
 };
 
 /* return true if time stamp t2 is after t1 with 48bit wrap around */
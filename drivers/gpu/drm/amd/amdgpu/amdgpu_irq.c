@@ -474,31 +474,87 @@ int amdgpu_irq_add_id(struct amdgpu_device *adev,
 }
 
 /**
- * amdgpu_irq_dispatch - dispatch IRQ to IP blocks
+ * amdgpu_irq_decode - decode the IV at the rptr
  *
  * @adev: amdgpu device pointer
  * @ih: interrupt ring instance
+ * @entry: resulting IV entry
  *
- * Dispatches IRQ to IP blocks.
+ * Decodes the IV at the current rptr of @ih and advances the rptr.
  */
-void amdgpu_irq_dispatch(struct amdgpu_device *adev,
-			 struct amdgpu_ih_ring *ih)
+void amdgpu_irq_decode(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih,
+		       struct amdgpu_iv_entry *entry)
 {
 	u32 ring_index = ih->rptr >> 2;
-	struct amdgpu_iv_entry entry;
+
+	entry->ih = ih;
+	entry->iv_entry = (const uint32_t *)&ih->ring[ring_index];
+	amdgpu_ih_decode_iv(adev, entry);
+
+	trace_amdgpu_iv(ih - &adev->irq.ih, entry);
+}
+
+/**
+ * amdgpu_irq_coalesce - check if an IV can be skipped
+ *
+ * @adev: amdgpu device pointer
+ * @entries: the decoded batch
+ * @idx: index of the IV in @entries
+ *
+ * Returns true if the source of the IV allows coalescing and an identical IV
+ * was already processed in this batch.
+ */
+static bool amdgpu_irq_coalesce(struct amdgpu_device *adev,
+				const struct amdgpu_iv_entry *entries,
+				unsigned int idx)
+{
+	const struct amdgpu_iv_entry *entry = &entries[idx];
+	struct amdgpu_irq_src *src;
+	unsigned int i;
+
+	if (entry->client_id >= AMDGPU_IRQ_CLIENTID_MAX ||
+	    entry->src_id >= AMDGPU_MAX_IRQ_SRC_ID ||
+	    !adev->irq.client[entry->client_id].sources)
+		return false;
+
+	src = adev->irq.client[entry->client_id].sources[entry->src_id];
+	if (!src || !src->coalesce)
+		return false;
+
+	for (i = 0; i < idx; ++i) {
+		const struct amdgpu_iv_entry *prev = &entries[i];
+
+		if (prev->client_id == entry->client_id &&
+		    prev->src_id == entry->src_id &&
+		    prev->ring_id == entry->ring_id &&
+		    prev->vmid == entry->vmid &&
+		    prev->pasid == entry->pasid &&
+		    !memcmp(prev->src_data, entry->src_data,
+			    sizeof(entry->src_data)))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * amdgpu_irq_dispatch_one - dispatch a single IV to IP blocks
+ *
+ * @adev: amdgpu device pointer
+ * @entry: the decoded IV
+ *
+ * Returns true if the IV was handled by an IP block.
+ */
+static bool amdgpu_irq_dispatch_one(struct amdgpu_device *adev,
+				    struct amdgpu_iv_entry *entry)
+{
 	unsigned client_id, src_id;
 	struct amdgpu_irq_src *src;
 	bool handled = false;
 	int r;
 
-	entry.ih = ih;
-	entry.iv_entry = (const uint32_t *)&ih->ring[ring_index];
-	amdgpu_ih_decode_iv(adev, &entry);
-
-	trace_amdgpu_iv(ih - &adev->irq.ih, &entry);
-
-	client_id = entry.client_id;
-	src_id = entry.src_id;
+	client_id = entry->client_id;
+	src_id = entry->src_id;
 
 	if (client_id >= AMDGPU_IRQ_CLIENTID_MAX) {
 		DRM_DEBUG("Invalid client_id in IV: %d\n", client_id);
@@ -515,7 +571,7 @@ void amdgpu_irq_dispatch(struct amdgpu_device *adev,
 			  client_id, src_id);
 
 	} else if ((src = adev->irq.client[client_id].sources[src_id])) {
-		r = src->funcs->process(adev, src, &entry);
+		r = src->funcs->process(adev, src, entry);
 		if (r < 0)
 			DRM_ERROR("error processing interrupt (%d)\n", r);
 		else if (r)
@@ -525,12 +581,50 @@ void amdgpu_irq_dispatch(struct amdgpu_device *adev,
 		DRM_DEBUG("Unhandled interrupt src_id: %d\n", src_id);
 	}
 
-	/* Send it to amdkfd as well if it isn't already handled */
-	if (!handled)
-		amdgpu_amdkfd_interrupt(adev, entry.iv_entry);
+	return handled;
+}
+
+/**
+ * amdgpu_irq_dispatch - dispatch IRQs to IP blocks
+ *
+ * @adev: amdgpu device pointer
+ * @ih: interrupt ring instance
+ * @num: number of IVs decoded into the batch of @ih
+ *
+ * Dispatches a batch of decoded IVs to IP blocks and accounts them in the
+ * statistics of the ring.
+ */
+void amdgpu_irq_dispatch(struct amdgpu_device *adev,
+			 struct amdgpu_ih_ring *ih, unsigned int num)
+{
+	struct amdgpu_ih_stats *stats = &ih->stats;
+	unsigned int i;
+
+	for (i = 0; i < num; ++i) {
+		struct amdgpu_iv_entry *entry = &ih->batch[i];
+		unsigned int client_id = entry->client_id;
+		bool valid = client_id < AMDGPU_IRQ_CLIENTID_MAX;
+
+		if (valid)
+			++stats->ivs[client_id];
+		else
+			++stats->invalid;
+
+		if (amdgpu_irq_coalesce(adev, ih->batch, i)) {
+			++stats->coalesced[client_id];
+		} else if (!amdgpu_irq_dispatch_one(adev, entry)) {
+			if (valid)
+				++stats->unhandled[client_id];
+
+			/* Send it to amdkfd as well if it isn't already handled */
+			amdgpu_amdkfd_interrupt(adev, entry->iv_entry);
+		}
 
-	if (amdgpu_ih_ts_after(ih->processed_timestamp, entry.timestamp))
-		ih->processed_timestamp = entry.timestamp;
+		if (amdgpu_ih_ts_after(ih->processed_timestamp,
+				       entry->timestamp))
+			ih->processed_timestamp = entry->timestamp;
+	}
+	++stats->batches;
 }
 
 /**
@@ -804,3 +898,69 @@ unsigned amdgpu_irq_create_mapping(struct amdgpu_device *adev, unsigned src_id)
 
 	return adev->irq.virq[src_id];
 }
+
+#if defined(CONFIG_DEBUG_FS)
+
+static void amdgpu_debugfs_ih_stats(struct seq_file *m, const char *name,
+				    struct amdgpu_ih_ring *ih)
+{
+	struct amdgpu_ih_stats *stats = &ih->stats;
+	unsigned long elapsed = jiffies - stats->snapshot_jiffies;
+	unsigned int i;
+
+	if (!ih->ring_size)
+		return;
+
+	seq_printf(m, "%s: batches %llu, invalid %llu\n", name,
+		   stats->batches, stats->invalid);
+	for (i = 0; i < AMDGPU_IRQ_CLIENTID_MAX; ++i) {
+		u64 ivs = stats->ivs[i];
+		u64 rate = 0;
+
+		if (stats->snapshot_jiffies && elapsed)
+			rate = div_u64((ivs - stats->snapshot[i]) * HZ, elapsed);
+		stats->snapshot[i] = ivs;
+		if (!ivs)
+			continue;
+
+		seq_printf(m, "  %-16s ivs %12llu (%llu/s), unhandled %llu, coalesced %llu\n",
+			   i < ARRAY_SIZE(soc15_ih_clientid_name) ?
+			   soc15_ih_clientid_name[i] : "?", ivs, rate,
+			   stats->unhandled[i], stats->coalesced[i]);
+	}
+	stats->snapshot_jiffies = jiffies;
+}
+
+static int amdgpu_debugfs_ih_info_show(struct seq_file *m, void *unused)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)m->private;
+
+	amdgpu_debugfs_ih_stats(m, "IH", &adev->irq.ih);
+	amdgpu_debugfs_ih_stats(m, "IH1", &adev->irq.ih1);
+	amdgpu_debugfs_ih_stats(m, "IH2", &adev->irq.ih2);
+	amdgpu_debugfs_ih_stats(m, "IH soft", &adev->irq.ih_soft);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_ih_info);
+
+#endif
+
+/**
+ * amdgpu_debugfs_irq_init - register the IH statistics debugfs file
+ *
+ * @adev: amdgpu device pointer
+ *
+ * The rates are calculated since the previous read of the file.
+ */
+void amdgpu_debugfs_irq_init(struct amdgpu_device *adev)
+{
+#if defined(CONFIG_DEBUG_FS)
+	struct drm_minor *minor = adev_to_drm(adev)->primary;
+	struct dentry *root = minor->debugfs_root;
+
+	debugfs_create_file("amdgpu_ih_info", 0444, root, adev,
+			    &amdgpu_debugfs_ih_info_fops);
+#endif
+}
@@ -62,6 +62,8 @@ struct amdgpu_irq_src {
 	unsigned				num_types;
 	atomic_t				*enabled_types;
 	const struct amdgpu_irq_src_funcs	*funcs;
+	/* identical IVs in the same batch are only processed once */
+	bool					coalesce;
 };
 
 struct amdgpu_irq_client {
@@ -101,6 +103,7 @@ struct amdgpu_irq {
 };
 
 void amdgpu_irq_disable_all(struct amdgpu_device *adev);
+void amdgpu_debugfs_irq_init(struct amdgpu_device *adev);
 
 int amdgpu_irq_init(struct amdgpu_device *adev);
 void amdgpu_irq_fini_sw(struct amdgpu_device *adev);
@@ -108,8 +111,10 @@ void amdgpu_irq_fini_hw(struct amdgpu_device *adev);
 int amdgpu_irq_add_id(struct amdgpu_device *adev,
 		      unsigned client_id, unsigned src_id,
 		      struct amdgpu_irq_src *source);
+void amdgpu_irq_decode(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih,
+		       struct amdgpu_iv_entry *entry);
 void amdgpu_irq_dispatch(struct amdgpu_device *adev,
-			 struct amdgpu_ih_ring *ih);
+			 struct amdgpu_ih_ring *ih, unsigned int num);
 void amdgpu_irq_delegate(struct amdgpu_device *adev,
 			 struct amdgpu_iv_entry *entry,
 			 unsigned int num_dw);
@@ -255,6 +255,9 @@ static struct dma_fence *amdgpu_job_run(struct drm_sched_job *sched_job)
 	if (job->vram_lost_counter != atomic_read(&ring->adev->vram_lost_counter))
 		dma_fence_set_error(finished, -ECANCELED);/* skip IB as well if VRAM lost */
 
+	if (!job->job_run_counter)
+		amdgpu_ring_preempt_job_run(ring, sched_job, false);
+
 	if (finished->error < 0) {
 		DRM_INFO("Skip scheduling IBs!\n");
 	} else {
@@ -264,8 +267,11 @@ static struct dma_fence *amdgpu_job_run(struct drm_sched_job *sched_job)
 			DRM_ERROR("Error scheduling IBs (%d)\n", r);
 	}
 
-	if (!job->job_run_counter)
+	if (!job->job_run_counter) {
+		/* resubmit preempted jobs this one overtook */
+		amdgpu_ring_preempt_job_run(ring, sched_job, true);
 		dma_fence_get(fence);
+	}
 	else if (finished->error < 0)
 		dma_fence_put(&job->hw_fence);
 	job->job_run_counter++;
@@ -50,6 +50,78 @@
 #include "amdgpu.h"
 #include "amdgpu_amdkfd.h"
 
+/**
+ * amdgpu_mn_mark_dirty - remember the invalidated part of a userptr BO
+ *
+ * @bo: the userptr BO
+ * @range: details on the invalidation
+ *
+ * Merges the pages of @bo covered by @range into the dirty range, so that only
+ * those need to be faulted in again. A burst of invalidations is coalesced
+ * into a single range.
+ */
+static void amdgpu_mn_mark_dirty(struct amdgpu_bo *bo,
+				 const struct mmu_notifier_range *range)
+{
+	unsigned long start = bo->notifier.interval_tree.start;
+	unsigned long last = bo->notifier.interval_tree.last;
+	unsigned long first_page, end_page;
+
+	first_page = (max(range->start, start) - start) >> PAGE_SHIFT;
+	end_page = (min(range->end - 1, last) - start) / PAGE_SIZE + 1;
+
+	spin_lock(&bo->notifier_dirty_lock);
+	if (bo->notifier_dirty_start < bo->notifier_dirty_end) {
+		first_page = min(first_page, bo->notifier_dirty_start);
+		end_page = max(end_page, bo->notifier_dirty_end);
+	}
+	bo->notifier_dirty_start = first_page;
+	bo->notifier_dirty_end = end_page;
+	bo->notifier_dirty_seq++;
+	spin_unlock(&bo->notifier_dirty_lock);
+}
+
+/**
+ * amdgpu_mn_dirty_range - get the invalidated part of a userptr BO
+ *
+ * @bo: the userptr BO
+ * @first: first invalidated page
+ * @end: page after the last invalidated one, equal to @first if none
+ *
+ * Returns:
+ * A sequence number to pass to amdgpu_mn_clear_dirty() once the range was
+ * faulted in successfully.
+ */
+unsigned int amdgpu_mn_dirty_range(struct amdgpu_bo *bo, unsigned long *first,
+				   unsigned long *end)
+{
+	unsigned int seq;
+
+	spin_lock(&bo->notifier_dirty_lock);
+	*first = bo->notifier_dirty_start;
+	*end = bo->notifier_dirty_end;
+	seq = bo->notifier_dirty_seq;
+	spin_unlock(&bo->notifier_dirty_lock);
+
+	return seq;
+}
+
+/**
+ * amdgpu_mn_clear_dirty - mark all pages of a userptr BO as valid
+ *
+ * @bo: the userptr BO
+ * @seq: the value returned by amdgpu_mn_dirty_range()
+ *
+ * Resets the dirty range if there was no invalidation since @seq.
+ */
+void amdgpu_mn_clear_dirty(struct amdgpu_bo *bo, unsigned int seq)
+{
+	spin_lock(&bo->notifier_dirty_lock);
+	if (bo->notifier_dirty_seq == seq)
+		bo->notifier_dirty_start = bo->notifier_dirty_end = 0;
+	spin_unlock(&bo->notifier_dirty_lock);
+}
+
 /**
  * amdgpu_mn_invalidate_gfx - callback to notify about mm change
  *
@@ -74,6 +146,7 @@ static bool amdgpu_mn_invalidate_gfx(struct mmu_interval_notifier *mni,
 	mutex_lock(&adev->notifier_lock);
 
 	mmu_interval_set_seq(mni, cur_seq);
+	amdgpu_mn_mark_dirty(bo, range);
 
 	r = dma_resv_wait_timeout(bo->tbo.base.resv, true, false,
 				  MAX_SCHEDULE_TIMEOUT);
@@ -110,6 +183,7 @@ static bool amdgpu_mn_invalidate_hsa(struct mmu_interval_notifier *mni,
 	mutex_lock(&adev->notifier_lock);
 
 	mmu_interval_set_seq(mni, cur_seq);
+	amdgpu_mn_mark_dirty(bo, range);
 
 	amdgpu_amdkfd_evict_userptr(bo->kfd_bo, bo->notifier.mm);
 	mutex_unlock(&adev->notifier_lock);
@@ -132,6 +206,12 @@ static const struct mmu_interval_notifier_ops amdgpu_mn_hsa_ops = {
  */
 int amdgpu_mn_register(struct amdgpu_bo *bo, unsigned long addr)
 {
+	/* Nothing faulted in yet */
+	spin_lock_init(&bo->notifier_dirty_lock);
+	bo->notifier_dirty_start = 0;
+	bo->notifier_dirty_end = amdgpu_bo_size(bo) >> PAGE_SHIFT;
+	bo->notifier_dirty_seq = 0;
+
 	if (bo->kfd_bo)
 		return mmu_interval_notifier_insert(&bo->notifier, current->mm,
 						    addr, amdgpu_bo_size(bo),
@@ -194,6 +274,10 @@ int amdgpu_hmm_range_get_pages(struct mmu_interval_notifier *notifier,
 retry:
 	hmm_range->notifier_seq = mmu_interval_read_begin(notifier);
 
+	/* Nothing to fault in, only track invalidations */
+	if (!npages)
+		goto out_done;
+
 	if (likely(!mmap_locked))
 		mmap_read_lock(mm);
 
@@ -219,6 +303,7 @@ int amdgpu_hmm_range_get_pages(struct mmu_interval_notifier *notifier,
 	for (i = 0; pages && i < npages; i++)
 		pages[i] = hmm_pfn_to_page(pfns[i]);
 
+out_done:
 	*phmm_range = hmm_range;
 
 	return 0;
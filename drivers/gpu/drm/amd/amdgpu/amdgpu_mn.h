@@ -40,6 +40,9 @@ int amdgpu_hmm_range_get_pages_done(struct hmm_range *hmm_range);
 #if defined(CONFIG_HMM_MIRROR)
 int amdgpu_mn_register(struct amdgpu_bo *bo, unsigned long addr);
 void amdgpu_mn_unregister(struct amdgpu_bo *bo);
+unsigned int amdgpu_mn_dirty_range(struct amdgpu_bo *bo, unsigned long *first,
+				   unsigned long *end);
+void amdgpu_mn_clear_dirty(struct amdgpu_bo *bo, unsigned int seq);
 #else
 static inline int amdgpu_mn_register(struct amdgpu_bo *bo, unsigned long addr)
 {
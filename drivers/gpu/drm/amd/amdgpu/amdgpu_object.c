@@ -596,23 +596,26 @@ int amdgpu_bo_create(struct amdgpu_device *adev,
 	if (!amdgpu_gmc_vram_full_visible(&adev->gmc) &&
 	    bo->tbo.resource->mem_type == TTM_PL_VRAM &&
 	    bo->tbo.resource->start < adev->gmc.visible_vram_size >> PAGE_SHIFT)
-		amdgpu_cs_report_moved_bytes(adev, ctx.bytes_moved,
+		amdgpu_cs_report_moved_bytes(adev, NULL, ctx.bytes_moved,
 					     ctx.bytes_moved);
 	else
-		amdgpu_cs_report_moved_bytes(adev, ctx.bytes_moved, 0);
+		amdgpu_cs_report_moved_bytes(adev, NULL, ctx.bytes_moved, 0);
 
 	if (bp->flags & AMDGPU_GEM_CREATE_VRAM_CLEARED &&
 	    bo->tbo.resource->mem_type == TTM_PL_VRAM) {
 		struct dma_fence *fence;
 
-		r = amdgpu_fill_buffer(bo, 0, bo->tbo.base.resv, &fence);
+		r = amdgpu_ttm_clear_buffer(bo, bo->tbo.base.resv, &fence);
 		if (unlikely(r))
 			goto fail_unreserve;
 
-		amdgpu_bo_fence(bo, fence, false);
-		dma_fence_put(bo->tbo.moving);
-		bo->tbo.moving = dma_fence_get(fence);
-		dma_fence_put(fence);
+		/* Nothing to wait for if all of the VRAM was already zero */
+		if (fence) {
+			amdgpu_bo_fence(bo, fence, false);
+			dma_fence_put(bo->tbo.moving);
+			bo->tbo.moving = dma_fence_get(fence);
+			dma_fence_put(fence);
+		}
 	}
 	if (!bp->resv)
 		amdgpu_bo_unreserve(bo);
@@ -1232,13 +1235,22 @@ void amdgpu_bo_move_notify(struct ttm_buffer_object *bo,
 		return;
 
 	abo = ttm_to_amdgpu_bo(bo);
+	abo->move_gen++;
+	if (evict) {
+		struct amdgpu_vm_bo_base *bo_base;
+
+		for (bo_base = abo->vm_bo; bo_base; bo_base = bo_base->next)
+			atomic64_inc(&bo_base->vm->evictions);
+	}
 	amdgpu_vm_bo_invalidate(adev, abo, evict);
 
 	amdgpu_bo_kunmap(abo);
 
 	if (abo->tbo.base.dma_buf && !abo->tbo.base.import_attach &&
-	    bo->resource->mem_type != TTM_PL_SYSTEM)
+	    bo->resource->mem_type != TTM_PL_SYSTEM) {
+		amdgpu_dma_buf_invalidate_mappings(abo);
 		dma_buf_move_notify(abo->tbo.base.dma_buf);
+	}
 
 	/* remember the eviction */
 	if (evict)
@@ -95,6 +95,8 @@ struct amdgpu_bo {
 	/* Protected by tbo.reserved */
 	u32				preferred_domains;
 	u32				allowed_domains;
+	/* incremented on every move, see amdgpu_bo_move_notify() */
+	u64				move_gen;
 	struct ttm_place		placements[AMDGPU_BO_MAX_PLACEMENTS];
 	struct ttm_placement		placement;
 	struct ttm_buffer_object	tbo;
@@ -107,6 +109,11 @@ struct amdgpu_bo {
 
 #ifdef CONFIG_MMU_NOTIFIER
 	struct mmu_interval_notifier	notifier;
+	/* userptr pages invalidated since they were last faulted in */
+	spinlock_t			notifier_dirty_lock;
+	unsigned long			notifier_dirty_start;
+	unsigned long			notifier_dirty_end;
+	unsigned int			notifier_dirty_seq;
 #endif
 	struct kgd_mem                  *kfd_bo;
 };
@@ -36,6 +36,7 @@
 #define NUM_EVENT_TYPES_ARCTURUS	1
 #define NUM_EVENTS_ARCTURUS_XGMI	6
 #define NUM_EVENTS_ARCTURUS_MAX		NUM_EVENTS_ARCTURUS_XGMI
+#define NUM_FORMATS_SW			2
 
 struct amdgpu_pmu_event_attribute {
 	struct device_attribute attr;
@@ -205,6 +206,31 @@ static struct amdgpu_pmu_config arcturus_config = {
 	.num_types = ARRAY_SIZE(arcturus_types)
 };
 
+/* Software events */
+static struct amdgpu_pmu_attr sw_formats[NUM_FORMATS_SW] = {
+	{ .name = "event", .config = "config:0-7" },
+	{ .name = "pasid", .config = "config1:0-15" }
+};
+
+static struct amdgpu_pmu_attr sw_events[AMDGPU_PMU_SW_EVENT_COUNT] = {
+	{ .name = "submissions", .config = "event=0x0" },
+	{ .name = "fence_waits", .config = "event=0x1" },
+	{ .name = "vm_faults", .config = "event=0x2" },
+	{ .name = "bo_evictions", .config = "event=0x3" },
+	{ .name = "bytes_moved", .config = "event=0x4" },
+	{ .name = "ih_overflows", .config = "event=0x5" },
+	{ .name = "vram_cpu_page_faults", .config = "event=0x6" }
+};
+
+static struct amdgpu_pmu_config sw_config = {
+	.formats = sw_formats,
+	.num_formats = ARRAY_SIZE(sw_formats),
+	.events = sw_events,
+	.num_events = ARRAY_SIZE(sw_events),
+	.types = NULL,
+	.num_types = 0
+};
+
 /* initialize perf counter */
 static int amdgpu_perf_event_init(struct perf_event *event)
 {
@@ -406,6 +432,162 @@ static void amdgpu_perf_del(struct perf_event *event, int flags)
 	perf_event_update_userpage(event);
 }
 
+/* get the current value of a software event, false if the VM is gone */
+static bool amdgpu_perf_sw_get_count(struct amdgpu_device *adev, u64 config,
+				     u32 pasid, u64 *count)
+{
+	struct amdgpu_vm *vm;
+	unsigned long flags;
+
+	if (!pasid) {
+		switch (config) {
+		case AMDGPU_PMU_SW_EVENT_SUBMISSIONS:
+			*count = atomic64_read(&adev->num_submissions);
+			break;
+		case AMDGPU_PMU_SW_EVENT_FENCE_WAITS:
+			*count = atomic64_read(&adev->num_fence_waits);
+			break;
+		case AMDGPU_PMU_SW_EVENT_VM_FAULTS:
+			*count = atomic64_read(&adev->num_vm_faults);
+			break;
+		case AMDGPU_PMU_SW_EVENT_EVICTIONS:
+			*count = atomic64_read(&adev->num_evictions);
+			break;
+		case AMDGPU_PMU_SW_EVENT_BYTES_MOVED:
+			*count = atomic64_read(&adev->num_bytes_moved);
+			break;
+		case AMDGPU_PMU_SW_EVENT_IH_OVERFLOWS:
+			*count = atomic64_read(&adev->num_ih_overflows);
+			break;
+		case AMDGPU_PMU_SW_EVENT_VRAM_CPU_FAULTS:
+			*count = atomic64_read(&adev->num_vram_cpu_page_faults);
+			break;
+		default:
+			*count = 0;
+			break;
+		}
+		return true;
+	}
+
+	xa_lock_irqsave(&adev->vm_manager.pasids, flags);
+	vm = xa_load(&adev->vm_manager.pasids, pasid);
+	if (vm) {
+		switch (config) {
+		case AMDGPU_PMU_SW_EVENT_SUBMISSIONS:
+			*count = atomic64_read(&vm->submissions);
+			break;
+		case AMDGPU_PMU_SW_EVENT_VM_FAULTS:
+			*count = atomic64_read(&vm->faults);
+			break;
+		case AMDGPU_PMU_SW_EVENT_EVICTIONS:
+			*count = atomic64_read(&vm->evictions);
+			break;
+		default:
+			*count = 0;
+			break;
+		}
+	}
+	xa_unlock_irqrestore(&adev->vm_manager.pasids, flags);
+
+	return vm != NULL;
+}
+
+/* initialize software counter */
+static int amdgpu_perf_sw_event_init(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	u64 config = event->attr.config & 0xff;
+	u32 pasid = event->attr.config1 & AMDGPU_PMU_SW_PASID_MASK;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	if (config >= AMDGPU_PMU_SW_EVENT_COUNT)
+		return -EINVAL;
+
+	if (pasid && config != AMDGPU_PMU_SW_EVENT_SUBMISSIONS &&
+	    config != AMDGPU_PMU_SW_EVENT_VM_FAULTS &&
+	    config != AMDGPU_PMU_SW_EVENT_EVICTIONS)
+		return -EINVAL;
+
+	hwc->config = config;
+	/* software events have no config type, use it for the PASID */
+	hwc->config_base = pasid;
+
+	return 0;
+}
+
+/* start software counter */
+static void amdgpu_perf_sw_start(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	struct amdgpu_pmu_entry *pe = container_of(event->pmu,
+						  struct amdgpu_pmu_entry,
+						  pmu);
+	u64 count = 0;
+
+	if (WARN_ON_ONCE(!(hwc->state & PERF_HES_STOPPED)))
+		return;
+
+	amdgpu_perf_sw_get_count(pe->adev, hwc->config, hwc->config_base,
+				 &count);
+	local64_set(&hwc->prev_count, count);
+	hwc->state = 0;
+
+	perf_event_update_userpage(event);
+}
+
+/* read software counter */
+static void amdgpu_perf_sw_read(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	struct amdgpu_pmu_entry *pe = container_of(event->pmu,
+						  struct amdgpu_pmu_entry,
+						  pmu);
+	u64 count, prev;
+
+	do {
+		prev = local64_read(&hwc->prev_count);
+
+		/* keep the last value when the process is gone */
+		if (!amdgpu_perf_sw_get_count(pe->adev, hwc->config,
+					      hwc->config_base, &count))
+			return;
+	} while (local64_cmpxchg(&hwc->prev_count, prev, count) != prev);
+
+	local64_add(count - prev, &event->count);
+}
+
+/* stop software counter */
+static void amdgpu_perf_sw_stop(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	amdgpu_perf_sw_read(event);
+	hwc->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+/* add software counter */
+static int amdgpu_perf_sw_add(struct perf_event *event, int flags)
+{
+	event->hw.state = PERF_HES_UPTODATE | PERF_HES_STOPPED;
+
+	if (flags & PERF_EF_START)
+		amdgpu_perf_sw_start(event, PERF_EF_RELOAD);
+
+	return 0;
+}
+
+/* delete software counter */
+static void amdgpu_perf_sw_del(struct perf_event *event, int flags)
+{
+	amdgpu_perf_sw_stop(event, PERF_EF_UPDATE);
+	perf_event_update_userpage(event);
+}
+
 static void amdgpu_pmu_create_event_attrs_by_type(
 				struct attribute_group *attr_group,
 				struct amdgpu_pmu_event_attribute *pmu_attr,
@@ -502,6 +684,19 @@ static int init_pmu_entry_by_type_and_add(struct amdgpu_pmu_entry *pmu_entry,
 		.task_ctx_nr = perf_invalid_context,
 	};
 
+	/* Software counters can't raise an overflow interrupt */
+	if (pmu_entry->pmu_perf_type == AMDGPU_PMU_PERF_TYPE_SW)
+		pmu_entry->pmu = (struct pmu){
+			.event_init = amdgpu_perf_sw_event_init,
+			.add = amdgpu_perf_sw_add,
+			.del = amdgpu_perf_sw_del,
+			.start = amdgpu_perf_sw_start,
+			.stop = amdgpu_perf_sw_stop,
+			.read = amdgpu_perf_sw_read,
+			.task_ctx_nr = perf_invalid_context,
+			.capabilities = PERF_PMU_CAP_NO_INTERRUPT,
+		};
+
 	ret = amdgpu_pmu_alloc_pmu_attrs(&pmu_entry->fmt_attr_group,
 					&pmu_entry->fmt_attr,
 					&pmu_entry->evt_attr_group,
@@ -621,7 +816,18 @@ static struct amdgpu_pmu_entry *create_pmu_entry(struct amdgpu_device *adev,
 int amdgpu_pmu_init(struct amdgpu_device *adev)
 {
 	int ret = 0;
-	struct amdgpu_pmu_entry *pmu_entry, *pmu_entry_df;
+	struct amdgpu_pmu_entry *pmu_entry, *pmu_entry_df, *pmu_entry_sw;
+
+	pmu_entry_sw = create_pmu_entry(adev, AMDGPU_PMU_PERF_TYPE_SW,
+					"SW", "amdgpu_sw");
+	if (!pmu_entry_sw)
+		return -ENOMEM;
+
+	ret = init_pmu_entry_by_type_and_add(pmu_entry_sw, &sw_config);
+	if (ret) {
+		kfree(pmu_entry_sw);
+		return ret;
+	}
 
 	switch (adev->asic_type) {
 	case CHIP_VEGA20:
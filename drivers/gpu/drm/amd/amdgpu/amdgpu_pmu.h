@@ -28,7 +28,8 @@
 enum amdgpu_pmu_perf_type {
 	AMDGPU_PMU_PERF_TYPE_NONE = 0,
 	AMDGPU_PMU_PERF_TYPE_DF,
-	AMDGPU_PMU_PERF_TYPE_ALL
+	AMDGPU_PMU_PERF_TYPE_ALL,
+	AMDGPU_PMU_PERF_TYPE_SW
 };
 
 /*
@@ -51,6 +52,24 @@ enum amdgpu_pmu_event_config_type {
 #define AMDGPU_PMU_EVENT_CONFIG_TYPE_SHIFT	56
 #define AMDGPU_PMU_EVENT_CONFIG_TYPE_MASK	0xff
 
+/*
+ * Software events of PMU type AMDGPU_PMU_PERF_TYPE_SW, counted by the driver
+ * itself on all ASICs. Events marked as per VM can be restricted to a single
+ * process by the PASID in config1.
+ */
+enum amdgpu_pmu_sw_event {
+	AMDGPU_PMU_SW_EVENT_SUBMISSIONS = 0,	/* per VM */
+	AMDGPU_PMU_SW_EVENT_FENCE_WAITS,
+	AMDGPU_PMU_SW_EVENT_VM_FAULTS,		/* per VM */
+	AMDGPU_PMU_SW_EVENT_EVICTIONS,		/* per VM */
+	AMDGPU_PMU_SW_EVENT_BYTES_MOVED,
+	AMDGPU_PMU_SW_EVENT_IH_OVERFLOWS,
+	AMDGPU_PMU_SW_EVENT_VRAM_CPU_FAULTS,
+	AMDGPU_PMU_SW_EVENT_COUNT
+};
+
+#define AMDGPU_PMU_SW_PASID_MASK		0xffff
+
 int amdgpu_pmu_init(struct amdgpu_device *adev);
 void amdgpu_pmu_fini(struct amdgpu_device *adev);
 
@@ -111,6 +111,8 @@ static bool amdgpu_ras_check_bad_page_unlock(struct amdgpu_ras *con,
 				uint64_t addr);
 static bool amdgpu_ras_check_bad_page(struct amdgpu_device *adev,
 				uint64_t addr);
+static int amdgpu_ras_query_error_status_cached(struct amdgpu_device *adev,
+						struct ras_query_if *info);
 #ifdef CONFIG_X86_MCE_AMD
 static void amdgpu_register_bad_pages_mca_notifier(struct amdgpu_device *adev);
 struct mce_notifier_adev_list {
@@ -187,7 +189,7 @@ static ssize_t amdgpu_ras_debugfs_read(struct file *f, char __user *buf,
 	ssize_t s;
 	char val[128];
 
-	if (amdgpu_ras_query_error_status(obj->adev, &info))
+	if (amdgpu_ras_query_error_status_cached(obj->adev, &info))
 		return -EINVAL;
 
 	s = snprintf(val, sizeof(val), "%s: %lu\n%s: %lu\n",
@@ -528,6 +530,10 @@ static const struct file_operations amdgpu_ras_debugfs_eeprom_ops = {
  *	ue: 0
  *	ce: 1
  *
+ * The counts are cached and refreshed in the background at most once a second
+ * or when a RAS interrupt reported new errors, so reading them doesn't access
+ * the hardware.
+ *
  */
 static ssize_t amdgpu_ras_sysfs_read(struct device *dev,
 		struct device_attribute *attr, char *buf)
@@ -540,14 +546,9 @@ static ssize_t amdgpu_ras_sysfs_read(struct device *dev,
 	if (!amdgpu_ras_get_error_query_ready(obj->adev))
 		return sysfs_emit(buf, "Query currently inaccessible\n");
 
-	if (amdgpu_ras_query_error_status(obj->adev, &info))
+	if (amdgpu_ras_query_error_status_cached(obj->adev, &info))
 		return -EINVAL;
 
-	if (obj->adev->asic_type == CHIP_ALDEBARAN) {
-		if (amdgpu_ras_reset_error_status(obj->adev, info.head.block))
-			DRM_WARN("Failed to reset error counter and error status");
-	}
-
 	return sysfs_emit(buf, "%s: %lu\n%s: %lu\n", "ue", info.ue_count,
 			  "ce", info.ce_count);
 }
@@ -1034,9 +1035,91 @@ int amdgpu_ras_query_error_status(struct amdgpu_device *adev,
 	if (!amdgpu_persistent_edc_harvesting_supported(adev))
 		amdgpu_ras_reset_error_status(adev, info->head.block);
 
+	obj->query_stamp = jiffies ?: 1;
+	obj->query_stale = false;
+
+	return 0;
+}
+
+/* query the hardware and clear the counters on ASICs which don't on query */
+static int amdgpu_ras_query_block(struct amdgpu_device *adev,
+				  struct ras_query_if *info)
+{
+	int r;
+
+	r = amdgpu_ras_query_error_status(adev, info);
+	if (r)
+		return r;
+
+	if (adev->asic_type == CHIP_ALDEBARAN) {
+		if (amdgpu_ras_reset_error_status(adev, info->head.block))
+			DRM_WARN("Failed to reset error counter and error status");
+	}
+
+	return 0;
+}
+
+/*
+ * Return the error counters of the last hardware query. Stale counters are
+ * refreshed by the query work so frequent readers don't generate MMIO and SMU
+ * traffic, only the very first read of a block queries the hardware directly.
+ */
+static int amdgpu_ras_query_error_status_cached(struct amdgpu_device *adev,
+						struct ras_query_if *info)
+{
+	struct amdgpu_ras *con = amdgpu_ras_get_context(adev);
+	struct ras_manager *obj = amdgpu_ras_find_obj(adev, &info->head);
+
+	if (!obj)
+		return -EINVAL;
+
+	if (!obj->query_stamp)
+		return amdgpu_ras_query_block(adev, info);
+
+	if (obj->query_stale ||
+	    time_after(jiffies, obj->query_stamp + AMDGPU_RAS_QUERY_INTERVAL))
+		schedule_delayed_work(&con->ras_query_work, 0);
+
+	info->ue_count = obj->err_data.ue_count;
+	info->ce_count = obj->err_data.ce_count;
+
 	return 0;
 }
 
+static void amdgpu_ras_query_work(struct work_struct *work)
+{
+	struct amdgpu_ras *con = container_of(work, struct amdgpu_ras,
+					      ras_query_work.work);
+	struct amdgpu_device *adev = con->adev;
+	struct drm_device *dev = adev_to_drm(adev);
+	struct ras_manager *obj;
+	int res;
+
+	if (!amdgpu_ras_get_error_query_ready(adev))
+		return;
+
+	res = pm_runtime_get_sync(dev->dev);
+	if (res < 0)
+		goto out;
+
+	list_for_each_entry(obj, &con->head, node) {
+		struct ras_query_if info = {
+			.head = obj->head,
+		};
+
+		if (!obj->query_stale && obj->query_stamp &&
+		    time_before_eq(jiffies, obj->query_stamp +
+				   AMDGPU_RAS_QUERY_INTERVAL))
+			continue;
+
+		amdgpu_ras_query_block(adev, &info);
+	}
+
+	pm_runtime_mark_last_busy(dev->dev);
+out:
+	pm_runtime_put_autosuspend(dev->dev);
+}
+
 int amdgpu_ras_reset_error_status(struct amdgpu_device *adev,
 		enum amdgpu_ras_block block)
 {
@@ -1609,6 +1692,10 @@ static void amdgpu_ras_interrupt_handler(struct ras_manager *obj)
 			}
 		}
 	}
+
+	/* not every block counts errors from the interrupt, refresh them */
+	obj->query_stale = true;
+	schedule_delayed_work(&amdgpu_ras_get_context(obj->adev)->ras_query_work, 0);
 }
 
 static void amdgpu_ras_interrupt_process_handler(struct work_struct *work)
@@ -1940,6 +2027,11 @@ int amdgpu_ras_add_bad_pages(struct amdgpu_device *adev,
 			goto out;
 		}
 
+		ret = xa_err(xa_store(&data->bp_xa, bps[i].retired_page,
+				      xa_mk_value(data->count), GFP_KERNEL));
+		if (ret)
+			goto out;
+
 		amdgpu_vram_mgr_reserve_range(&adev->mman.vram_mgr,
 			bps[i].retired_page << AMDGPU_GPU_PAGE_SHIFT,
 			AMDGPU_GPU_PAGE_SIZE);
@@ -2021,14 +2113,8 @@ static bool amdgpu_ras_check_bad_page_unlock(struct amdgpu_ras *con,
 				uint64_t addr)
 {
 	struct ras_err_handler_data *data = con->eh_data;
-	int i;
 
-	addr >>= AMDGPU_GPU_PAGE_SHIFT;
-	for (i = 0; i < data->count; i++)
-		if (addr == data->bps[i].retired_page)
-			return true;
-
-	return false;
+	return xa_load(&data->bp_xa, addr >> AMDGPU_GPU_PAGE_SHIFT) != NULL;
 }
 
 /*
@@ -2114,6 +2200,7 @@ int amdgpu_ras_recovery_init(struct amdgpu_device *adev)
 		ret = -ENOMEM;
 		goto out;
 	}
+	xa_init(&(*data)->bp_xa);
 
 	mutex_init(&con->recovery_lock);
 	INIT_WORK(&con->recovery_work, amdgpu_ras_do_recovery);
@@ -2153,6 +2240,7 @@ int amdgpu_ras_recovery_init(struct amdgpu_device *adev)
 	return 0;
 
 free:
+	xa_destroy(&(*data)->bp_xa);
 	kfree((*data)->bps);
 	kfree(*data);
 	con->eh_data = NULL;
@@ -2184,6 +2272,7 @@ static int amdgpu_ras_recovery_fini(struct amdgpu_device *adev)
 
 	mutex_lock(&con->recovery_lock);
 	con->eh_data = NULL;
+	xa_destroy(&data->bp_xa);
 	kfree(data->bps);
 	kfree(data);
 	mutex_unlock(&con->recovery_lock);
@@ -2313,6 +2402,7 @@ int amdgpu_ras_init(struct amdgpu_device *adev)
 
 	con->adev = adev;
 	INIT_DELAYED_WORK(&con->ras_counte_delay_work, amdgpu_ras_counte_dw);
+	INIT_DELAYED_WORK(&con->ras_query_work, amdgpu_ras_query_work);
 	atomic_set(&con->ras_ce_count, 0);
 	atomic_set(&con->ras_ue_count, 0);
 
@@ -2599,6 +2689,7 @@ int amdgpu_ras_fini(struct amdgpu_device *adev)
 		amdgpu_ras_disable_all_features(adev, 1);
 
 	cancel_delayed_work_sync(&con->ras_counte_delay_work);
+	cancel_delayed_work_sync(&con->ras_query_work);
 
 	amdgpu_ras_set_context(adev, NULL);
 	kfree(con);
@@ -26,6 +26,7 @@
 
 #include <linux/debugfs.h>
 #include <linux/list.h>
+#include <linux/xarray.h>
 #include "amdgpu.h"
 #include "amdgpu_psp.h"
 #include "ta_ras_if.h"
@@ -33,6 +34,9 @@
 
 #define AMDGPU_RAS_FLAG_INIT_BY_VBIOS		(0x1 << 0)
 
+/* how long cached error counters are handed out before they are refreshed */
+#define AMDGPU_RAS_QUERY_INTERVAL		msecs_to_jiffies(1000)
+
 enum amdgpu_ras_block {
 	AMDGPU_RAS_BLOCK__UMC = 0,
 	AMDGPU_RAS_BLOCK__SDMA,
@@ -372,6 +376,9 @@ struct amdgpu_ras {
 	atomic_t ras_ue_count;
 	atomic_t ras_ce_count;
 
+	/* refreshes stale error counters of the cached readers */
+	struct delayed_work ras_query_work;
+
 	/* record umc error info queried from smu */
 	struct umc_ecc_info umc_ecc;
 };
@@ -395,6 +402,8 @@ struct ras_err_handler_data {
 	int count;
 	/* the space can place new entries */
 	int space_left;
+	/* index of the entries keyed by retired page */
+	struct xarray bp_xa;
 };
 
 typedef int (*ras_ih_cb)(struct amdgpu_device *adev,
@@ -435,6 +444,11 @@ struct ras_manager {
 	struct ras_ih_data ih_data;
 
 	struct ras_err_data err_data;
+
+	/* jiffies of the last hardware query, 0 if never queried */
+	unsigned long query_stamp;
+	/* counters need a refresh before the interval expires */
+	bool query_stale;
 };
 
 struct ras_badpage {
@@ -149,6 +149,365 @@ void amdgpu_ring_undo(struct amdgpu_ring *ring)
 		ring->funcs->end_use(ring);
 }
 
+/*
+ * Preemption
+ * Rings which implement preempt_ib can be asked to stop at the next
+ * preemption point of the executing IB. Jobs which didn't finish are
+ * resubmitted afterwards, a partially executed job resumes from the state the
+ * CP saved.
+ */
+
+static void amdgpu_ring_preempt_fences_swap(struct amdgpu_ring *ring,
+					    struct dma_fence **fences)
+{
+	struct amdgpu_fence_driver *drv = &ring->fence_drv;
+	uint32_t sync_seq, last_seq;
+
+	last_seq = atomic_read(&ring->fence_drv.last_seq);
+	sync_seq = ring->fence_drv.sync_seq;
+
+	last_seq &= drv->num_fences_mask;
+	sync_seq &= drv->num_fences_mask;
+
+	do {
+		struct dma_fence *fence, **ptr;
+
+		++last_seq;
+		last_seq &= drv->num_fences_mask;
+		ptr = &drv->fences[last_seq];
+
+		fence = rcu_dereference_protected(*ptr, 1);
+		RCU_INIT_POINTER(*ptr, NULL);
+
+		if (!fence)
+			continue;
+
+		fences[last_seq] = fence;
+
+	} while (last_seq != sync_seq);
+}
+
+static void amdgpu_ring_preempt_signal_fences(struct dma_fence **fences,
+					      int length)
+{
+	int i;
+	struct dma_fence *fence;
+
+	for (i = 0; i < length; i++) {
+		fence = fences[i];
+		if (!fence)
+			continue;
+		dma_fence_signal(fence);
+		dma_fence_put(fence);
+	}
+}
+
+static void amdgpu_ring_preempt_job_recovery(struct amdgpu_ring *ring,
+					     struct drm_sched_job *skip)
+{
+	struct drm_gpu_scheduler *sched = &ring->sched;
+	struct drm_sched_job *s_job;
+	struct dma_fence *fence;
+
+	spin_lock(&sched->job_list_lock);
+	list_for_each_entry(s_job, &sched->pending_list, list) {
+		if (s_job == skip)
+			continue;
+		fence = sched->ops->run_job(s_job);
+		dma_fence_put(fence);
+		atomic64_inc(&ring->preempt.resubmitted);
+	}
+	spin_unlock(&sched->job_list_lock);
+}
+
+static void amdgpu_ring_preempt_mark_partial_job(struct amdgpu_ring *ring)
+{
+	struct amdgpu_job *job;
+	struct drm_sched_job *s_job, *tmp;
+	uint32_t preempt_seq;
+	struct dma_fence *fence, **ptr;
+	struct amdgpu_fence_driver *drv = &ring->fence_drv;
+	struct drm_gpu_scheduler *sched = &ring->sched;
+	bool preempted = true;
+
+	if (ring->funcs->type != AMDGPU_RING_TYPE_GFX)
+		return;
+
+	preempt_seq = le32_to_cpu(*(drv->cpu_addr + 2));
+	if (preempt_seq <= atomic_read(&drv->last_seq)) {
+		preempted = false;
+		goto no_preempt;
+	}
+
+	preempt_seq &= drv->num_fences_mask;
+	ptr = &drv->fences[preempt_seq];
+	fence = rcu_dereference_protected(*ptr, 1);
+
+no_preempt:
+	spin_lock(&sched->job_list_lock);
+	list_for_each_entry_safe(s_job, tmp, &sched->pending_list, list) {
+		if (dma_fence_is_signaled(&s_job->s_fence->finished)) {
+			/* remove job from ring_mirror_list */
+			list_del_init(&s_job->list);
+			sched->ops->free_job(s_job);
+			continue;
+		}
+		job = to_amdgpu_job(s_job);
+		if (preempted && (&job->hw_fence) == fence)
+			/* mark the job as preempted */
+			job->preemption_status |= AMDGPU_IB_PREEMPTED;
+	}
+	spin_unlock(&sched->job_list_lock);
+}
+
+/**
+ * amdgpu_ring_preempt - preempt the IB executing on a ring
+ *
+ * @ring: ring to preempt
+ * @defer: leave the resubmission of the preempted jobs to the next job run
+ *
+ * Asks the CP to stop at the next preemption point and resubmits the jobs
+ * which didn't finish. With @defer the unfinished jobs are only resubmitted
+ * after the next job pushed by the scheduler if that job has a higher
+ * priority than all of them, or after AMDGPU_RING_PREEMPT_RESUBMIT_DELAY.
+ *
+ * Returns 0 on success, -EBUSY if the last preemption isn't retired yet and
+ * a negative error code otherwise.
+ */
+int amdgpu_ring_preempt(struct amdgpu_ring *ring, bool defer)
+{
+	struct amdgpu_device *adev = ring->adev;
+	struct dma_fence **fences;
+	int r, resched, length;
+	ktime_t start;
+	u64 latency;
+
+	if (!ring->funcs->preempt_ib || !drm_sched_wqueue_ready(&ring->sched))
+		return -EINVAL;
+
+	/* the last preemption failed */
+	if (ring->trail_seq != le32_to_cpu(*ring->trail_fence_cpu_addr))
+		return -EBUSY;
+
+	length = ring->fence_drv.num_fences_mask + 1;
+	fences = kcalloc(length, sizeof(void *), GFP_KERNEL);
+	if (!fences)
+		return -ENOMEM;
+
+	mutex_lock(&ring->preempt.lock);
+
+	/* the jobs of the last preemption are still in flight */
+	if (ring->preempt.fences) {
+		r = -EBUSY;
+		goto out_unlock;
+	}
+
+	/* Avoid accidently unparking the sched thread during GPU reset */
+	r = down_read_killable(&adev->reset_sem);
+	if (r)
+		goto out_unlock;
+
+	/* stop the scheduler */
+	drm_sched_wqueue_stop(&ring->sched);
+
+	resched = ttm_bo_lock_delayed_workqueue(&adev->mman.bdev);
+
+	/* preempt the IB */
+	start = ktime_get();
+	r = amdgpu_ring_preempt_ib(ring);
+	if (r) {
+		atomic64_inc(&ring->preempt.failed);
+		DRM_WARN("failed to preempt ring %d\n", ring->idx);
+		goto failure;
+	}
+
+	latency = ktime_to_ns(ktime_sub(ktime_get(), start));
+	atomic64_inc(&ring->preempt.count);
+	atomic64_add(latency, &ring->preempt.latency_ns);
+	if (latency > atomic64_read(&ring->preempt.max_latency_ns))
+		atomic64_set(&ring->preempt.max_latency_ns, latency);
+
+	amdgpu_fence_process(ring);
+
+	if (atomic_read(&ring->fence_drv.last_seq) !=
+	    ring->fence_drv.sync_seq) {
+		DRM_DEBUG("ring %d was preempted\n", ring->idx);
+
+		amdgpu_ring_preempt_mark_partial_job(ring);
+
+		/* swap out the old fences */
+		amdgpu_ring_preempt_fences_swap(ring, fences);
+
+		amdgpu_fence_driver_force_completion(ring);
+
+		if (defer) {
+			/* resubmitted by the next job or the resubmit work */
+			ring->preempt.fences = fences;
+			ring->preempt.resubmit = true;
+			fences = NULL;
+			schedule_delayed_work(&ring->preempt.resubmit_work,
+					      AMDGPU_RING_PREEMPT_RESUBMIT_DELAY);
+		} else {
+			/* resubmit unfinished jobs */
+			amdgpu_ring_preempt_job_recovery(ring, NULL);
+
+			/* wait for jobs finished */
+			amdgpu_fence_wait_empty(ring);
+
+			/* signal the old fences */
+			amdgpu_ring_preempt_signal_fences(fences, length);
+		}
+	}
+
+failure:
+	/* restart the scheduler */
+	drm_sched_wqueue_start(&ring->sched);
+
+	up_read(&adev->reset_sem);
+
+	ttm_bo_unlock_delayed_workqueue(&adev->mman.bdev, resched);
+
+out_unlock:
+	mutex_unlock(&ring->preempt.lock);
+	kfree(fences);
+
+	return r;
+}
+
+static void amdgpu_ring_preempt_work(struct work_struct *work)
+{
+	struct amdgpu_ring *ring =
+		container_of(work, struct amdgpu_ring, preempt.work);
+	int r;
+
+	r = amdgpu_ring_preempt(ring, true);
+	if (r && r != -EBUSY)
+		DRM_DEBUG("preempting ring %d failed (%d)\n", ring->idx, r);
+}
+
+static void amdgpu_ring_preempt_resubmit_work(struct work_struct *work)
+{
+	struct amdgpu_ring *ring =
+		container_of(work, struct amdgpu_ring,
+			     preempt.resubmit_work.work);
+	struct amdgpu_device *adev = ring->adev;
+	struct dma_fence **fences;
+
+	mutex_lock(&ring->preempt.lock);
+
+	/* nothing overtook the preempted jobs, resubmit them now */
+	down_read(&adev->reset_sem);
+	if (ring->preempt.resubmit) {
+		drm_sched_wqueue_stop(&ring->sched);
+		ring->preempt.resubmit = false;
+		amdgpu_ring_preempt_job_recovery(ring, NULL);
+		drm_sched_wqueue_start(&ring->sched);
+	}
+	up_read(&adev->reset_sem);
+
+	fences = ring->preempt.fences;
+	if (fences) {
+		amdgpu_fence_wait_empty(ring);
+		amdgpu_ring_preempt_signal_fences(fences,
+						  ring->fence_drv.num_fences_mask + 1);
+		kfree(fences);
+		ring->preempt.fences = NULL;
+	}
+
+	mutex_unlock(&ring->preempt.lock);
+}
+
+/**
+ * amdgpu_ring_preempt_schedule - preempt a ring for a new submission
+ *
+ * @ring: ring the submission was pushed to
+ * @priority: scheduler priority of the submission
+ *
+ * Kicks off a mid-IB preemption of @ring when MCBP is enabled and a high
+ * priority submission is queued up behind lower priority work.
+ */
+void amdgpu_ring_preempt_schedule(struct amdgpu_ring *ring,
+				  enum drm_sched_priority priority)
+{
+	if (!amdgpu_mcbp || amdgpu_sriov_vf(ring->adev) ||
+	    ring->funcs->type != AMDGPU_RING_TYPE_GFX ||
+	    !ring->funcs->preempt_ib)
+		return;
+
+	if (priority < DRM_SCHED_PRIORITY_HIGH ||
+	    READ_ONCE(ring->preempt.priority) >= priority)
+		return;
+
+	/* nothing executing which could be preempted */
+	if (atomic_read(&ring->fence_drv.last_seq) ==
+	    READ_ONCE(ring->fence_drv.sync_seq))
+		return;
+
+	queue_work(system_highpri_wq, &ring->preempt.work);
+}
+
+/**
+ * amdgpu_ring_preempt_job_run - order a job against preempted jobs
+ *
+ * @ring: ring the job runs on
+ * @s_job: job which is about to be or was just emitted
+ * @emitted: false before @s_job is emitted, true afterwards
+ *
+ * Called from the scheduler's run_job callback for a job which runs for the
+ * first time. Before the job is emitted the jobs of a deferred preemption are
+ * resubmitted unless @s_job has a higher priority than all of them. In that
+ * case @s_job overtakes them and they are resubmitted after it.
+ */
+void amdgpu_ring_preempt_job_run(struct amdgpu_ring *ring,
+				 struct drm_sched_job *s_job, bool emitted)
+{
+	struct drm_gpu_scheduler *sched = &ring->sched;
+	struct drm_sched_job *tmp;
+	bool overtake = true;
+
+	if (!emitted)
+		WRITE_ONCE(ring->preempt.priority, s_job->s_priority);
+
+	if (likely(!ring->preempt.resubmit))
+		return;
+
+	if (emitted)
+		goto resubmit;
+
+	spin_lock(&sched->job_list_lock);
+	list_for_each_entry(tmp, &sched->pending_list, list) {
+		if (tmp != s_job && tmp->s_priority >= s_job->s_priority) {
+			overtake = false;
+			break;
+		}
+	}
+	spin_unlock(&sched->job_list_lock);
+
+	if (overtake) {
+		atomic64_inc(&ring->preempt.overtaken);
+		return;
+	}
+
+resubmit:
+	ring->preempt.resubmit = false;
+	amdgpu_ring_preempt_job_recovery(ring, s_job);
+	mod_delayed_work(system_wq, &ring->preempt.resubmit_work, 0);
+}
+
+/**
+ * amdgpu_ring_preempt_reset - forget about jobs waiting for resubmission
+ *
+ * @ring: ring which is reset
+ *
+ * The GPU reset resubmits all pending jobs itself, so the jobs of a deferred
+ * preemption must not be resubmitted again. Called with the scheduler of
+ * @ring stopped and the reset semaphore held.
+ */
+void amdgpu_ring_preempt_reset(struct amdgpu_ring *ring)
+{
+	ring->preempt.resubmit = false;
+}
+
 /**
  * amdgpu_ring_init - init driver ring struct.
  *
@@ -195,6 +554,12 @@ int amdgpu_ring_init(struct amdgpu_device *adev, struct amdgpu_ring *ring,
 						  sched_score);
 		if (r)
 			return r;
+
+		INIT_WORK(&ring->preempt.work, amdgpu_ring_preempt_work);
+		INIT_DELAYED_WORK(&ring->preempt.resubmit_work,
+				  amdgpu_ring_preempt_resubmit_work);
+		mutex_init(&ring->preempt.lock);
+		ring->preempt.priority = DRM_SCHED_PRIORITY_MIN;
 	}
 
 	r = amdgpu_device_wb_get(adev, &ring->rptr_offs);
@@ -289,6 +654,16 @@ void amdgpu_ring_fini(struct amdgpu_ring *ring)
 
 	ring->sched.ready = false;
 
+	cancel_work_sync(&ring->preempt.work);
+	cancel_delayed_work_sync(&ring->preempt.resubmit_work);
+	if (ring->preempt.fences) {
+		amdgpu_ring_preempt_signal_fences(ring->preempt.fences,
+						  ring->fence_drv.num_fences_mask + 1);
+		kfree(ring->preempt.fences);
+		ring->preempt.fences = NULL;
+	}
+	ring->preempt.resubmit = false;
+
 	amdgpu_device_wb_free(ring->adev, ring->rptr_offs);
 	amdgpu_device_wb_free(ring->adev, ring->wptr_offs);
 
@@ -413,6 +788,28 @@ static const struct file_operations amdgpu_debugfs_ring_fops = {
 	.llseek = default_llseek
 };
 
+static int amdgpu_debugfs_ring_preempt_show(struct seq_file *m, void *unused)
+{
+	struct amdgpu_ring *ring = m->private;
+	struct amdgpu_ring_preempt *preempt = &ring->preempt;
+	u64 count = atomic64_read(&preempt->count);
+	u64 latency = atomic64_read(&preempt->latency_ns);
+
+	seq_printf(m, "preemptions: %llu\n", count);
+	seq_printf(m, "failed: %lld\n", atomic64_read(&preempt->failed));
+	seq_printf(m, "overtaken: %lld\n", atomic64_read(&preempt->overtaken));
+	seq_printf(m, "resubmitted jobs: %lld\n",
+		   atomic64_read(&preempt->resubmitted));
+	seq_printf(m, "avg latency: %llu ns\n",
+		   count ? div64_u64(latency, count) : 0);
+	seq_printf(m, "max latency: %lld ns\n",
+		   atomic64_read(&preempt->max_latency_ns));
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_ring_preempt);
+
 #endif
 
 void amdgpu_debugfs_ring_init(struct amdgpu_device *adev,
@@ -421,13 +818,26 @@ void amdgpu_debugfs_ring_init(struct amdgpu_device *adev,
 #if defined(CONFIG_DEBUG_FS)
 	struct drm_minor *minor = adev_to_drm(adev)->primary;
 	struct dentry *root = minor->debugfs_root;
-	char name[32];
+	char name[40];
 
 	sprintf(name, "amdgpu_ring_%s", ring->name);
 	debugfs_create_file_size(name, S_IFREG | S_IRUGO, root, ring,
 				 &amdgpu_debugfs_ring_fops,
 				 ring->ring_size + 12);
 
+	sprintf(name, "amdgpu_sched_%s", ring->name);
+	drm_sched_debugfs_init(&ring->sched, root, name);
+
+	sprintf(name, "amdgpu_sched_trace_%s", ring->name);
+	drm_sched_debugfs_trace_init(&ring->sched, root, name);
+
+	if (ring->funcs->preempt_ib) {
+		sprintf(name, "amdgpu_preempt_%s", ring->name);
+		debugfs_create_file(name, 0444, root, ring,
+				    &amdgpu_debugfs_ring_preempt_fops);
+	}
+
+	amdgpu_debugfs_fence_ring_init(ring, root);
 #endif
 }
 
@@ -57,6 +57,10 @@ enum amdgpu_ring_priority_level {
 
 #define AMDGPU_IB_POOL_SIZE	(1024 * 1024)
 
+/* IBs up to this size are allocated from separate, smaller pools */
+#define AMDGPU_IB_POOL_SMALL_MAX	(4 * 1024)
+#define AMDGPU_IB_POOL_SMALL_SIZE	(256 * 1024)
+
 enum amdgpu_ring_type {
 	AMDGPU_RING_TYPE_GFX		= AMDGPU_HW_IP_GFX,
 	AMDGPU_RING_TYPE_COMPUTE	= AMDGPU_HW_IP_COMPUTE,
@@ -82,11 +86,21 @@ enum amdgpu_ib_pool_type {
 	AMDGPU_IB_POOL_MAX
 };
 
+enum amdgpu_ib_pool_class {
+	/* IBs up to AMDGPU_IB_POOL_SMALL_MAX, e.g. VM updates and tests. */
+	AMDGPU_IB_POOL_CLASS_SMALL,
+	/* Everything else, e.g. buffer moves and clears. */
+	AMDGPU_IB_POOL_CLASS_LARGE,
+
+	AMDGPU_IB_POOL_CLASS_MAX
+};
+
 struct amdgpu_device;
 struct amdgpu_ring;
 struct amdgpu_ib;
 struct amdgpu_cs_parser;
 struct amdgpu_job;
+struct dentry;
 
 struct amdgpu_sched {
 	u32				num_scheds;
@@ -96,6 +110,33 @@ struct amdgpu_sched {
 /*
  * Fences.
  */
+
+/* Maximum number of times amdgpu_fence_process() re-reads a moving seqno */
+#define AMDGPU_FENCE_COALESCE_PASSES	4
+
+/**
+ * enum amdgpu_fence_mode - how completed fences of a ring are signaled
+ *
+ * @AMDGPU_FENCE_MODE_IRQ: signal each fence separately from the interrupt
+ * @AMDGPU_FENCE_MODE_COALESCE: signal fences in batches under a single lock
+ *	and keep signaling while the seqno moves
+ * @AMDGPU_FENCE_MODE_POLL: like @AMDGPU_FENCE_MODE_COALESCE, but the fence
+ *	poll thread additionally busy waits on the seqno while work is pending
+ */
+enum amdgpu_fence_mode {
+	AMDGPU_FENCE_MODE_IRQ,
+	AMDGPU_FENCE_MODE_COALESCE,
+	AMDGPU_FENCE_MODE_POLL,
+	AMDGPU_FENCE_MODE_MAX
+};
+
+struct amdgpu_fence_stats {
+	atomic64_t			passes;
+	atomic64_t			empty_passes;
+	atomic64_t			signaled;
+	atomic64_t			polled;
+};
+
 struct amdgpu_fence_driver {
 	uint64_t			gpu_addr;
 	volatile uint32_t		*cpu_addr;
@@ -109,6 +150,8 @@ struct amdgpu_fence_driver {
 	unsigned			num_fences_mask;
 	spinlock_t			lock;
 	struct dma_fence		**fences;
+	enum amdgpu_fence_mode		mode;
+	struct amdgpu_fence_stats	stats;
 };
 
 void amdgpu_fence_driver_clear_job_fences(struct amdgpu_ring *ring);
@@ -134,11 +177,49 @@ signed long amdgpu_fence_wait_polling(struct amdgpu_ring *ring,
 				      uint32_t wait_seq,
 				      signed long timeout);
 unsigned amdgpu_fence_count_emitted(struct amdgpu_ring *ring);
+void amdgpu_debugfs_fence_ring_init(struct amdgpu_ring *ring,
+				    struct dentry *root);
 
 /*
  * Rings.
  */
 
+/* delay before preempted jobs are resubmitted without a job overtaking them */
+#define AMDGPU_RING_PREEMPT_RESUBMIT_DELAY	msecs_to_jiffies(2)
+
+/**
+ * struct amdgpu_ring_preempt - priority driven mid-IB preemption state
+ *
+ * @work: preempts the ring on behalf of a high priority submission
+ * @resubmit_work: resubmits the preempted jobs if nothing overtook them and
+ *	retires the fences swapped out by the preemption
+ * @lock: serializes @work and @resubmit_work
+ * @fences: fences swapped out by the last preemption, NULL if none
+ * @resubmit: preempted jobs still wait to be resubmitted
+ * @priority: scheduler priority of the job last pushed to the ring
+ * @count: number of successful preemptions
+ * @failed: number of preemption requests the CP didn't acknowledge
+ * @overtaken: number of times a job was run ahead of preempted jobs
+ * @resubmitted: number of jobs resubmitted after a preemption
+ * @latency_ns: accumulated time until the CP acknowledged the preemption
+ * @max_latency_ns: longest time until the CP acknowledged a preemption
+ */
+struct amdgpu_ring_preempt {
+	struct work_struct	work;
+	struct delayed_work	resubmit_work;
+	struct mutex		lock;
+	struct dma_fence	**fences;
+	bool			resubmit;
+	enum drm_sched_priority	priority;
+
+	atomic64_t		count;
+	atomic64_t		failed;
+	atomic64_t		overtaken;
+	atomic64_t		resubmitted;
+	atomic64_t		latency_ns;
+	atomic64_t		max_latency_ns;
+};
+
 /* provided by hw blocks that expose a ring buffer for commands */
 struct amdgpu_ring_funcs {
 	enum amdgpu_ring_type	type;
@@ -251,6 +332,13 @@ struct amdgpu_ring {
 	bool			has_compute_vm_bug;
 	bool			no_scheduler;
 	int			hw_prio;
+	struct amdgpu_ring_preempt	preempt;
+
+	/* per job cost estimates of the ctx entities bound to this ring, in ns */
+	atomic64_t		sched_load;
+	atomic_t		sched_entities;
+	/* engine time of the jobs retired by ctx entities, in ns */
+	atomic64_t		busy_ns;
 };
 
 #define amdgpu_ring_parse_cs(r, p, ib) ((r)->funcs->parse_cs((p), (ib)))
@@ -291,6 +379,12 @@ void amdgpu_ring_fini(struct amdgpu_ring *ring);
 void amdgpu_ring_emit_reg_write_reg_wait_helper(struct amdgpu_ring *ring,
 						uint32_t reg0, uint32_t val0,
 						uint32_t reg1, uint32_t val1);
+int amdgpu_ring_preempt(struct amdgpu_ring *ring, bool defer);
+void amdgpu_ring_preempt_schedule(struct amdgpu_ring *ring,
+				  enum drm_sched_priority priority);
+void amdgpu_ring_preempt_job_run(struct amdgpu_ring *ring,
+				 struct drm_sched_job *s_job, bool emitted);
+void amdgpu_ring_preempt_reset(struct amdgpu_ring *ring);
 bool amdgpu_ring_soft_recovery(struct amdgpu_ring *ring, unsigned int vmid,
 			       struct dma_fence *fence);
 
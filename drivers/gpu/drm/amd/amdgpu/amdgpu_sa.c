@@ -59,6 +59,10 @@ int amdgpu_sa_bo_manager_init(struct amdgpu_device *adev,
 	sa_manager->domain = domain;
 	sa_manager->align = align;
 	sa_manager->hole = &sa_manager->olist;
+	sa_manager->num_allocs = 0;
+	sa_manager->num_contended = 0;
+	sa_manager->num_waits = 0;
+	sa_manager->wait_ns = 0;
 	INIT_LIST_HEAD(&sa_manager->olist);
 	for (i = 0; i < AMDGPU_SA_NUM_FENCE_LISTS; ++i)
 		INIT_LIST_HEAD(&sa_manager->flist[i]);
@@ -281,6 +285,7 @@ int amdgpu_sa_bo_new(struct amdgpu_sa_manager *sa_manager,
 	unsigned count;
 	int i, r;
 	signed long t;
+	ktime_t start;
 
 	if (WARN_ON_ONCE(align > sa_manager->align))
 		return -EINVAL;
@@ -296,7 +301,10 @@ int amdgpu_sa_bo_new(struct amdgpu_sa_manager *sa_manager,
 	INIT_LIST_HEAD(&(*sa_bo)->olist);
 	INIT_LIST_HEAD(&(*sa_bo)->flist);
 
-	spin_lock(&sa_manager->wq.lock);
+	if (!spin_trylock(&sa_manager->wq.lock)) {
+		spin_lock(&sa_manager->wq.lock);
+		++sa_manager->num_contended;
+	}
 	do {
 		for (i = 0; i < AMDGPU_SA_NUM_FENCE_LISTS; ++i)
 			tries[i] = 0;
@@ -306,6 +314,7 @@ int amdgpu_sa_bo_new(struct amdgpu_sa_manager *sa_manager,
 
 			if (amdgpu_sa_bo_try_alloc(sa_manager, *sa_bo,
 						   size, align)) {
+				++sa_manager->num_allocs;
 				spin_unlock(&sa_manager->wq.lock);
 				return 0;
 			}
@@ -317,6 +326,8 @@ int amdgpu_sa_bo_new(struct amdgpu_sa_manager *sa_manager,
 			if (fences[i])
 				fences[count++] = dma_fence_get(fences[i]);
 
+		++sa_manager->num_waits;
+		start = ktime_get();
 		if (count) {
 			spin_unlock(&sa_manager->wq.lock);
 			t = dma_fence_wait_any_timeout(fences, count, false,
@@ -334,6 +345,8 @@ int amdgpu_sa_bo_new(struct amdgpu_sa_manager *sa_manager,
 				amdgpu_sa_event(sa_manager, size, align)
 			);
 		}
+		sa_manager->wait_ns += ktime_to_ns(ktime_sub(ktime_get(),
+							     start));
 
 	} while (!r);
 
@@ -376,6 +389,9 @@ void amdgpu_sa_bo_dump_debug_info(struct amdgpu_sa_manager *sa_manager,
 	struct amdgpu_sa_bo *i;
 
 	spin_lock(&sa_manager->wq.lock);
+	seq_printf(m, "allocs %llu, contended %llu, waits %llu, wait time %llu us\n",
+		   sa_manager->num_allocs, sa_manager->num_contended,
+		   sa_manager->num_waits, div_u64(sa_manager->wait_ns, 1000));
 	list_for_each_entry(i, &sa_manager->olist, olist) {
 		uint64_t soffset = i->soffset + sa_manager->gpu_addr;
 		uint64_t eoffset = i->eoffset + sa_manager->gpu_addr;
@@ -366,6 +366,48 @@ int amdgpu_ttm_copy_mem_to_mem(struct amdgpu_device *adev,
  * This is a helper called by amdgpu_bo_move() and amdgpu_move_vram_ram() to
  * help move buffers to and from VRAM.
  */
+struct amdgpu_ttm_move_cb {
+	struct dma_fence_cb	cb;
+	struct amdgpu_device	*adev;
+	u64			num_bytes;
+};
+
+static void amdgpu_ttm_move_done(struct dma_fence *f, struct dma_fence_cb *cb)
+{
+	struct amdgpu_ttm_move_cb *move =
+		container_of(cb, struct amdgpu_ttm_move_cb, cb);
+	struct drm_sched_fence *s_fence = to_drm_sched_fence(f);
+
+	if (!f->error &&
+	    test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &s_fence->scheduled.flags))
+		amdgpu_cs_report_move_rate(move->adev, move->num_bytes,
+					   ktime_to_ns(ktime_sub(f->timestamp,
+						s_fence->scheduled.timestamp)));
+	kfree(move);
+}
+
+/*
+ * Measure how long the copy engine needs for a buffer move, this feeds the
+ * copy bandwidth estimate used for migration throttling.
+ */
+static void amdgpu_ttm_track_move(struct amdgpu_device *adev,
+				  struct dma_fence *fence, u64 num_bytes)
+{
+	struct amdgpu_ttm_move_cb *move;
+
+	if (!fence || !to_drm_sched_fence(fence))
+		return;
+
+	move = kmalloc(sizeof(*move), GFP_KERNEL);
+	if (!move)
+		return;
+
+	move->adev = adev;
+	move->num_bytes = num_bytes;
+	if (dma_fence_add_callback(fence, &move->cb, amdgpu_ttm_move_done))
+		kfree(move);
+}
+
 static int amdgpu_move_blit(struct ttm_buffer_object *bo,
 			    bool evict,
 			    struct ttm_resource *new_mem,
@@ -391,6 +433,8 @@ static int amdgpu_move_blit(struct ttm_buffer_object *bo,
 	if (r)
 		goto error;
 
+	amdgpu_ttm_track_move(adev, fence, new_mem->num_pages << PAGE_SHIFT);
+
 	/* clear the space being freed */
 	if (old_mem->mem_type == TTM_PL_VRAM &&
 	    (abo->flags & AMDGPU_GEM_CREATE_VRAM_WIPE_ON_RELEASE)) {
@@ -639,10 +683,34 @@ struct amdgpu_ttm_tt {
 	bool			bound;
 #if IS_ENABLED(CONFIG_DRM_AMDGPU_USERPTR)
 	struct hmm_range	*range;
+	unsigned int		dirty_seq;
 #endif
 };
 
 #ifdef CONFIG_DRM_AMDGPU_USERPTR
+/*
+ * Take the pages outside of [first, end) from the currently bound ones,
+ * returns false if those aren't available.
+ */
+static bool amdgpu_ttm_tt_reuse_user_pages(struct ttm_tt *ttm,
+					   struct page **pages,
+					   unsigned long first,
+					   unsigned long end)
+{
+	unsigned long i;
+
+	for (i = 0; i < ttm->num_pages; ++i) {
+		if (i == first)
+			i = end;
+		if (i >= ttm->num_pages)
+			break;
+		if (!ttm->pages[i])
+			return false;
+		pages[i] = ttm->pages[i];
+	}
+	return true;
+}
+
 /*
  * amdgpu_ttm_tt_get_user_pages - get device accessible pages that back user
  * memory and start HMM tracking CPU page table update
@@ -655,6 +723,7 @@ int amdgpu_ttm_tt_get_user_pages(struct amdgpu_bo *bo, struct page **pages)
 	struct ttm_tt *ttm = bo->tbo.ttm;
 	struct amdgpu_ttm_tt *gtt = (void *)ttm;
 	unsigned long start = gtt->userptr;
+	unsigned long first, end;
 	struct vm_area_struct *vma;
 	struct mm_struct *mm;
 	bool readonly;
@@ -685,10 +754,17 @@ int amdgpu_ttm_tt_get_user_pages(struct amdgpu_bo *bo, struct page **pages)
 		goto out_unlock;
 	}
 
+	/* Only fault in the pages invalidated since the last time */
+	gtt->dirty_seq = amdgpu_mn_dirty_range(bo, &first, &end);
+	if (!amdgpu_ttm_tt_reuse_user_pages(ttm, pages, first, end)) {
+		first = 0;
+		end = ttm->num_pages;
+	}
+
 	readonly = amdgpu_ttm_tt_is_readonly(ttm);
-	r = amdgpu_hmm_range_get_pages(&bo->notifier, mm, pages, start,
-				       ttm->num_pages, &gtt->range, readonly,
-				       true, NULL);
+	r = amdgpu_hmm_range_get_pages(&bo->notifier, mm, pages + first,
+				       start + first * PAGE_SIZE, end - first,
+				       &gtt->range, readonly, true, NULL);
 out_unlock:
 	mmap_read_unlock(mm);
 	if (r)
@@ -724,8 +800,13 @@ bool amdgpu_ttm_tt_get_user_pages_done(struct ttm_tt *ttm)
 		 * FIXME: Must always hold notifier_lock for this, and must
 		 * not ignore the return code.
 		 */
+		struct amdgpu_bo *bo = container_of(gtt->range->notifier,
+						    struct amdgpu_bo, notifier);
+
 		r = amdgpu_hmm_range_get_pages_done(gtt->range);
 		gtt->range = NULL;
+		if (!r)
+			amdgpu_mn_clear_dirty(bo, gtt->dirty_seq);
 	}
 
 	return !r;
@@ -1657,10 +1738,13 @@ static int amdgpu_ttm_reserve_tmr(struct amdgpu_device *adev)
 int amdgpu_ttm_init(struct amdgpu_device *adev)
 {
 	uint64_t gtt_size;
+	unsigned int i;
 	int r;
 	u64 vis_vram_limit;
 
 	mutex_init(&adev->mman.gtt_window_lock);
+	for (i = 0; i < AMDGPU_GTT_NUM_MIGRATE_WINDOWS; ++i)
+		mutex_init(&adev->mman.migrate[i].lock);
 
 	/* No others user of address space so set it to 0 */
 	r = ttm_device_init(&adev->mman.bdev, &amdgpu_bo_driver, adev->dev,
@@ -1840,6 +1924,56 @@ void amdgpu_ttm_fini(struct amdgpu_device *adev)
 	DRM_INFO("amdgpu: ttm finalized\n");
 }
 
+/*
+ * Set up the SVM migration lanes. Each lane owns one of the migration GART
+ * windows and submits through its own entity, spreading the lanes over all
+ * SDMA instances if the buffer functions are provided by SDMA.
+ */
+static void amdgpu_ttm_migrate_init(struct amdgpu_device *adev)
+{
+	struct amdgpu_ring *ring = adev->mman.buffer_funcs_ring;
+	unsigned int i, num_rings = 1;
+	int r;
+
+	if (ring->funcs->type == AMDGPU_RING_TYPE_SDMA &&
+	    adev->sdma.num_instances > 1)
+		num_rings = adev->sdma.num_instances;
+
+	adev->mman.num_migrate_lanes = 0;
+	for (i = 0; i < AMDGPU_GTT_NUM_MIGRATE_WINDOWS; ++i) {
+		struct amdgpu_migrate_lane *lane = &adev->mman.migrate[i];
+		struct drm_gpu_scheduler *sched;
+
+		if (num_rings > 1)
+			ring = &adev->sdma.instance[i % num_rings].ring;
+		if (!ring->sched.ready)
+			ring = adev->mman.buffer_funcs_ring;
+
+		sched = &ring->sched;
+		r = drm_sched_entity_init(&lane->entity,
+					  DRM_SCHED_PRIORITY_KERNEL, &sched,
+					  1, NULL);
+		if (r) {
+			DRM_ERROR("Failed setting up migration entity (%d)\n",
+				  r);
+			break;
+		}
+		lane->ring = ring;
+		lane->window = AMDGPU_GTT_NUM_TRANSFER_WINDOWS + i;
+		adev->mman.num_migrate_lanes++;
+	}
+	atomic_set(&adev->mman.migrate_next, 0);
+}
+
+static void amdgpu_ttm_migrate_fini(struct amdgpu_device *adev)
+{
+	unsigned int i;
+
+	for (i = 0; i < adev->mman.num_migrate_lanes; ++i)
+		drm_sched_entity_destroy(&adev->mman.migrate[i].entity);
+	adev->mman.num_migrate_lanes = 0;
+}
+
 /**
  * amdgpu_ttm_set_buffer_funcs_status - enable/disable use of buffer functions
  *
@@ -1873,7 +2007,9 @@ void amdgpu_ttm_set_buffer_funcs_status(struct amdgpu_device *adev, bool enable)
 				  r);
 			return;
 		}
+		amdgpu_ttm_migrate_init(adev);
 	} else {
+		amdgpu_ttm_migrate_fini(adev);
 		drm_sched_entity_destroy(&adev->mman.entity);
 		dma_fence_put(man->move);
 		man->move = NULL;
@@ -1888,11 +2024,12 @@ void amdgpu_ttm_set_buffer_funcs_status(struct amdgpu_device *adev, bool enable)
 	adev->mman.buffer_funcs_enabled = enable;
 }
 
-int amdgpu_copy_buffer(struct amdgpu_ring *ring, uint64_t src_offset,
-		       uint64_t dst_offset, uint32_t byte_count,
-		       struct dma_resv *resv,
-		       struct dma_fence **fence, bool direct_submit,
-		       bool vm_needs_flush, bool tmz)
+static int amdgpu_ttm_copy_buffer(struct amdgpu_ring *ring,
+				  struct drm_sched_entity *entity,
+				  uint64_t src_offset, uint64_t dst_offset,
+				  uint32_t byte_count, struct dma_resv *resv,
+				  struct dma_fence **fence, bool direct_submit,
+				  bool vm_needs_flush, bool tmz)
 {
 	enum amdgpu_ib_pool_type pool = direct_submit ? AMDGPU_IB_POOL_DIRECT :
 		AMDGPU_IB_POOL_DELAYED;
@@ -1948,7 +2085,7 @@ int amdgpu_copy_buffer(struct amdgpu_ring *ring, uint64_t src_offset,
 	if (direct_submit)
 		r = amdgpu_job_submit_direct(job, ring, fence);
 	else
-		r = amdgpu_job_submit(job, &adev->mman.entity,
+		r = amdgpu_job_submit(job, entity,
 				      AMDGPU_FENCE_OWNER_UNDEFINED, fence);
 	if (r)
 		goto error_free;
@@ -1961,12 +2098,74 @@ int amdgpu_copy_buffer(struct amdgpu_ring *ring, uint64_t src_offset,
 	return r;
 }
 
-int amdgpu_fill_buffer(struct amdgpu_bo *bo,
-		       uint32_t src_data,
+int amdgpu_copy_buffer(struct amdgpu_ring *ring, uint64_t src_offset,
+		       uint64_t dst_offset, uint32_t byte_count,
 		       struct dma_resv *resv,
-		       struct dma_fence **fence)
+		       struct dma_fence **fence, bool direct_submit,
+		       bool vm_needs_flush, bool tmz)
+{
+	return amdgpu_ttm_copy_buffer(ring, &ring->adev->mman.entity,
+				      src_offset, dst_offset, byte_count, resv,
+				      fence, direct_submit, vm_needs_flush,
+				      tmz);
+}
+
+/**
+ * amdgpu_copy_buffer_entity - copy through a specific scheduler entity
+ *
+ * @entity: entity to submit the copy job to
+ * @ring: ring @entity is scheduled on, used for IB padding
+ * @src_offset: GPU address to copy from
+ * @dst_offset: GPU address to copy to
+ * @byte_count: number of bytes to copy
+ * @fence: resulting fence of the copy
+ * @vm_needs_flush: flush the GART before the copy
+ *
+ * Like amdgpu_copy_buffer(), but for users which need their jobs ordered
+ * independent of the buffer move entity.
+ *
+ * Returns:
+ * 0 for success or a negative error code on failure.
+ */
+int amdgpu_copy_buffer_entity(struct drm_sched_entity *entity,
+			      struct amdgpu_ring *ring, uint64_t src_offset,
+			      uint64_t dst_offset, uint32_t byte_count,
+			      struct dma_fence **fence, bool vm_needs_flush)
+{
+	return amdgpu_ttm_copy_buffer(ring, entity, src_offset, dst_offset,
+				      byte_count, NULL, fence, false,
+				      vm_needs_flush, false);
+}
+
+/* Check if a part of a resource is known to be zero already */
+static bool amdgpu_ttm_fill_skip(struct ttm_resource *res,
+				 struct amdgpu_res_cursor *cursor,
+				 bool skip_cleared)
+{
+	return skip_cleared && res->mem_type == TTM_PL_VRAM &&
+	       cursor->node->color == AMDGPU_VRAM_NODE_CLEARED;
+}
+
+/**
+ * amdgpu_ttm_fill_mem - fill a memory resource
+ *
+ * @adev: amdgpu device object
+ * @res: the resource to fill
+ * @src_data: the value to fill with
+ * @resv: reservation object to sync to, can be NULL
+ * @skip_cleared: skip the VRAM handed out known to be zero
+ * @fence: resulting fence, NULL if the whole resource was skipped
+ *
+ * The caller must make sure that the resource stays allocated until the
+ * fence signals.
+ *
+ * Returns:
+ * 0 for success or a negative error code on failure.
+ */
+int amdgpu_ttm_fill_mem(struct amdgpu_device *adev, struct ttm_resource *res,
+			uint32_t src_data, struct dma_resv *resv,
+			bool skip_cleared, struct dma_fence **fence)
 {
-	struct amdgpu_device *adev = amdgpu_ttm_adev(bo->tbo.bdev);
 	uint32_t max_bytes = adev->mman.buffer_funcs->fill_max_bytes;
 	struct amdgpu_ring *ring = adev->mman.buffer_funcs_ring;
 
@@ -1977,30 +2176,19 @@ int amdgpu_fill_buffer(struct amdgpu_bo *bo,
 	struct amdgpu_job *job;
 	int r;
 
-	if (!adev->mman.buffer_funcs_enabled) {
-		DRM_ERROR("Trying to clear memory with ring turned off.\n");
-		return -EINVAL;
-	}
-
-	if (bo->tbo.resource->mem_type == AMDGPU_PL_PREEMPT) {
-		DRM_ERROR("Trying to clear preemptible memory.\n");
-		return -EINVAL;
-	}
-
-	if (bo->tbo.resource->mem_type == TTM_PL_TT) {
-		r = amdgpu_ttm_alloc_gart(&bo->tbo);
-		if (r)
-			return r;
-	}
-
-	num_bytes = bo->tbo.resource->num_pages << PAGE_SHIFT;
+	*fence = NULL;
+	num_bytes = res->num_pages << PAGE_SHIFT;
 	num_loops = 0;
 
-	amdgpu_res_first(bo->tbo.resource, 0, num_bytes, &cursor);
+	amdgpu_res_first(res, 0, num_bytes, &cursor);
 	while (cursor.remaining) {
-		num_loops += DIV_ROUND_UP_ULL(cursor.size, max_bytes);
+		if (!amdgpu_ttm_fill_skip(res, &cursor, skip_cleared))
+			num_loops += DIV_ROUND_UP_ULL(cursor.size, max_bytes);
 		amdgpu_res_next(&cursor, cursor.size);
 	}
+	if (!num_loops)
+		return 0;
+
 	num_dw = num_loops * adev->mman.buffer_funcs->fill_num_dw;
 
 	/* for IB padding */
@@ -2021,13 +2209,17 @@ int amdgpu_fill_buffer(struct amdgpu_bo *bo,
 		}
 	}
 
-	amdgpu_res_first(bo->tbo.resource, 0, num_bytes, &cursor);
+	amdgpu_res_first(res, 0, num_bytes, &cursor);
 	while (cursor.remaining) {
 		uint32_t cur_size = min_t(uint64_t, cursor.size, max_bytes);
 		uint64_t dst_addr = cursor.start;
 
-		dst_addr += amdgpu_ttm_domain_start(adev,
-						    bo->tbo.resource->mem_type);
+		if (amdgpu_ttm_fill_skip(res, &cursor, skip_cleared)) {
+			amdgpu_res_next(&cursor, cursor.size);
+			continue;
+		}
+
+		dst_addr += amdgpu_ttm_domain_start(adev, res->mem_type);
 		amdgpu_emit_fill_buffer(adev, &job->ibs[0], src_data, dst_addr,
 					cur_size);
 
@@ -2048,6 +2240,79 @@ int amdgpu_fill_buffer(struct amdgpu_bo *bo,
 	return r;
 }
 
+static int amdgpu_ttm_fill_bo(struct amdgpu_bo *bo, uint32_t src_data,
+			      struct dma_resv *resv, bool skip_cleared,
+			      struct dma_fence **fence)
+{
+	struct amdgpu_device *adev = amdgpu_ttm_adev(bo->tbo.bdev);
+	int r;
+
+	if (!adev->mman.buffer_funcs_enabled) {
+		DRM_ERROR("Trying to clear memory with ring turned off.\n");
+		return -EINVAL;
+	}
+
+	if (bo->tbo.resource->mem_type == AMDGPU_PL_PREEMPT) {
+		DRM_ERROR("Trying to clear preemptible memory.\n");
+		return -EINVAL;
+	}
+
+	if (bo->tbo.resource->mem_type == TTM_PL_TT) {
+		r = amdgpu_ttm_alloc_gart(&bo->tbo);
+		if (r)
+			return r;
+	}
+
+	return amdgpu_ttm_fill_mem(adev, bo->tbo.resource, src_data, resv,
+				   skip_cleared, fence);
+}
+
+int amdgpu_fill_buffer(struct amdgpu_bo *bo,
+		       uint32_t src_data,
+		       struct dma_resv *resv,
+		       struct dma_fence **fence)
+{
+	return amdgpu_ttm_fill_bo(bo, src_data, resv, false, fence);
+}
+
+/**
+ * amdgpu_ttm_clear_buffer - clear a newly allocated BO
+ *
+ * @bo: the BO to clear
+ * @resv: reservation object to sync to, can be NULL
+ * @fence: resulting fence, NULL if nothing needed to be cleared
+ *
+ * Like filling the BO with zeros, but skips the VRAM ranges the VRAM manager
+ * handed out as known to be zero. Only valid for the first clear after the
+ * allocation, the ranges are forgotten afterwards.
+ *
+ * Returns:
+ * 0 for success or a negative error code on failure.
+ */
+int amdgpu_ttm_clear_buffer(struct amdgpu_bo *bo, struct dma_resv *resv,
+			    struct dma_fence **fence)
+{
+	struct amdgpu_device *adev = amdgpu_ttm_adev(bo->tbo.bdev);
+	struct ttm_resource *res = bo->tbo.resource;
+	struct drm_mm_node *mm;
+	uint64_t pages, skipped = 0;
+	int r;
+
+	r = amdgpu_ttm_fill_bo(bo, 0, resv, true, fence);
+	if (r || res->mem_type != TTM_PL_VRAM)
+		return r;
+
+	for (mm = to_ttm_range_mgr_node(res)->mm_nodes,
+	     pages = res->num_pages; pages; pages -= mm->size, ++mm) {
+		if (mm->color == AMDGPU_VRAM_NODE_CLEARED)
+			skipped += mm->size << PAGE_SHIFT;
+		mm->color = 0;
+	}
+	atomic64_add(skipped, &adev->mman.vram_mgr.clear_skipped);
+
+	return 0;
+}
+
 /**
  * amdgpu_ttm_evict_resources - evict memory buffers
  * @adev: amdgpu device object
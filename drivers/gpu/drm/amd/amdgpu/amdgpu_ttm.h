@@ -35,9 +35,18 @@
 
 #define AMDGPU_GTT_MAX_TRANSFER_SIZE	512
 #define AMDGPU_GTT_NUM_TRANSFER_WINDOWS	2
+/* windows after the transfer windows used for SVM migration */
+#define AMDGPU_GTT_NUM_MIGRATE_WINDOWS	4
+#define AMDGPU_GTT_NUM_RESERVED_WINDOWS	(AMDGPU_GTT_NUM_TRANSFER_WINDOWS + \
+					 AMDGPU_GTT_NUM_MIGRATE_WINDOWS)
 
 #define AMDGPU_POISON	0xd0bed0be
 
+/* granularity of the cleared VRAM tracking, 2MB */
+#define AMDGPU_VRAM_CLEAR_PAGES	(SZ_2M >> PAGE_SHIFT)
+/* drm_mm_node color of VRAM handed out already cleared */
+#define AMDGPU_VRAM_NODE_CLEARED	1
+
 struct amdgpu_vram_mgr {
 	struct ttm_resource_manager manager;
 	struct drm_mm mm;
@@ -46,13 +55,40 @@ struct amdgpu_vram_mgr {
 	struct list_head reserved_pages;
 	atomic64_t usage;
 	atomic64_t vis_usage;
+
+	/* VRAM compaction, passes are serialized by compact_lock */
+	struct mutex compact_lock;
+	struct delayed_work compact_work;
+	unsigned long compact_jiffies;
+	atomic64_t compact_passes;
+	atomic64_t compact_bos;
+	atomic64_t compact_bytes;
+	atomic64_t compact_failed;
+
+	/* Free VRAM known to be zero, one bit per AMDGPU_VRAM_CLEAR_PAGES */
+	unsigned long *cleared;
+	unsigned int cleared_seq;
+	struct delayed_work scrub_work;
+	atomic64_t scrub_bytes;
+	atomic64_t clear_skipped;
+};
+
+struct amdgpu_gtt_chunk;
+
+struct amdgpu_gtt_mgr_pcpu {
+	struct amdgpu_gtt_chunk *chunk;
 };
 
 struct amdgpu_gtt_mgr {
 	struct ttm_resource_manager manager;
 	struct drm_mm mm;
-	spinlock_t lock;
+	rwlock_t lock;
 	atomic64_t used;
+
+	/* GART chunks small allocations are sub-allocated from */
+	struct amdgpu_gtt_mgr_pcpu __percpu *pcpu;
+	atomic_t num_chunks;
+	atomic64_t chunk_allocs;
 };
 
 struct amdgpu_preempt_mgr {
@@ -60,6 +96,21 @@ struct amdgpu_preempt_mgr {
 	atomic64_t used;
 };
 
+/**
+ * struct amdgpu_migrate_lane - GART window and engine used for SVM migration
+ *
+ * @lock: keeps the GART update and the copy using it together in the queue
+ * @entity: scheduler entity submitting to @ring
+ * @ring: SDMA ring executing the migration
+ * @window: index of the GART window owned by this lane
+ */
+struct amdgpu_migrate_lane {
+	struct mutex			lock;
+	struct drm_sched_entity		entity;
+	struct amdgpu_ring		*ring;
+	unsigned int			window;
+};
+
 struct amdgpu_mman {
 	struct ttm_device		bdev;
 	bool				initialized;
@@ -74,6 +125,11 @@ struct amdgpu_mman {
 	/* Scheduler entity for buffer moves */
 	struct drm_sched_entity			entity;
 
+	/* SVM migration, see svm_migrate_copy_memory_gart() */
+	struct amdgpu_migrate_lane		migrate[AMDGPU_GTT_NUM_MIGRATE_WINDOWS];
+	unsigned int				num_migrate_lanes;
+	atomic_t				migrate_next;
+
 	struct amdgpu_vram_mgr vram_mgr;
 	struct amdgpu_gtt_mgr gtt_mgr;
 	struct amdgpu_preempt_mgr preempt_mgr;
@@ -133,6 +189,8 @@ uint64_t amdgpu_vram_mgr_usage(struct amdgpu_vram_mgr *mgr);
 uint64_t amdgpu_vram_mgr_vis_usage(struct amdgpu_vram_mgr *mgr);
 int amdgpu_vram_mgr_reserve_range(struct amdgpu_vram_mgr *mgr,
 				  uint64_t start, uint64_t size);
+s64 amdgpu_vram_mgr_compact(struct amdgpu_vram_mgr *mgr, u64 budget);
+void amdgpu_vram_mgr_invalidate_cleared(struct amdgpu_vram_mgr *mgr);
 int amdgpu_vram_mgr_query_page_status(struct amdgpu_vram_mgr *mgr,
 				      uint64_t start);
 
@@ -146,16 +204,25 @@ int amdgpu_copy_buffer(struct amdgpu_ring *ring, uint64_t src_offset,
 		       struct dma_resv *resv,
 		       struct dma_fence **fence, bool direct_submit,
 		       bool vm_needs_flush, bool tmz);
+int amdgpu_copy_buffer_entity(struct drm_sched_entity *entity,
+			      struct amdgpu_ring *ring, uint64_t src_offset,
+			      uint64_t dst_offset, uint32_t byte_count,
+			      struct dma_fence **fence, bool vm_needs_flush);
 int amdgpu_ttm_copy_mem_to_mem(struct amdgpu_device *adev,
 			       const struct amdgpu_copy_mem *src,
 			       const struct amdgpu_copy_mem *dst,
 			       uint64_t size, bool tmz,
 			       struct dma_resv *resv,
 			       struct dma_fence **f);
+int amdgpu_ttm_fill_mem(struct amdgpu_device *adev, struct ttm_resource *res,
+			uint32_t src_data, struct dma_resv *resv,
+			bool skip_cleared, struct dma_fence **fence);
 int amdgpu_fill_buffer(struct amdgpu_bo *bo,
 			uint32_t src_data,
 			struct dma_resv *resv,
 			struct dma_fence **fence);
+int amdgpu_ttm_clear_buffer(struct amdgpu_bo *bo, struct dma_resv *resv,
+			    struct dma_fence **fence);
 
 int amdgpu_ttm_alloc_gart(struct ttm_buffer_object *bo);
 int amdgpu_ttm_recover_gart(struct ttm_buffer_object *tbo);
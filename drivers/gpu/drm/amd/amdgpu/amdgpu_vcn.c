@@ -24,6 +24,7 @@
  *
  */
 
+#include <linux/debugfs.h>
 #include <linux/firmware.h>
 #include <linux/module.h>
 #include <linux/pci.h>
@@ -371,6 +372,59 @@ int amdgpu_vcn_resume(struct amdgpu_device *adev)
 	return 0;
 }
 
+/*
+ * How long after the last submission VCN stays ungated: long enough to cover
+ * 90% of the recent idle gaps which outlasted VCN_IDLE_TIMEOUT. When that would
+ * take longer than amdgpu_vcn_idle_max_ms the gaps are mostly long ones and
+ * gating early saves more than the next ungate costs.
+ */
+static unsigned int amdgpu_vcn_idle_target_ms(struct amdgpu_device *adev)
+{
+	unsigned int i, target, sum = 0, total = 0;
+
+	for (i = 0; i < AMDGPU_VCN_IDLE_GAP_BUCKETS; i++)
+		total += adev->vcn.idle_gaps[i];
+
+	if (!amdgpu_vcn_idle_max_ms || total < 4)
+		return VCN_IDLE_TIMEOUT_MS;
+
+	for (i = 0; i < AMDGPU_VCN_IDLE_GAP_BUCKETS - 1; i++) {
+		sum += adev->vcn.idle_gaps[i];
+		if (sum * 10 >= total * 9)
+			break;
+	}
+
+	target = VCN_IDLE_TIMEOUT_MS + (i + 1) * AMDGPU_VCN_IDLE_GAP_MS;
+	if (i == AMDGPU_VCN_IDLE_GAP_BUCKETS - 1 ||
+	    target > amdgpu_vcn_idle_max_ms)
+		return VCN_IDLE_TIMEOUT_MS;
+
+	return target;
+}
+
+/* Called with vcn_pg_lock held once all submissions ended */
+static void amdgpu_vcn_record_idle_gap(struct amdgpu_device *adev)
+{
+	s64 gap_ms;
+	int i;
+
+	if (!adev->vcn.last_use)
+		return;
+
+	gap_ms = ktime_ms_delta(ktime_get(), adev->vcn.last_use);
+	if (gap_ms < VCN_IDLE_TIMEOUT_MS)
+		return;
+
+	i = min_t(s64, (gap_ms - VCN_IDLE_TIMEOUT_MS) / AMDGPU_VCN_IDLE_GAP_MS,
+		  AMDGPU_VCN_IDLE_GAP_BUCKETS - 1);
+
+	/* age the history, only the recent gaps tell where we are */
+	if (++adev->vcn.idle_gaps[i] >= 64) {
+		for (i = 0; i < AMDGPU_VCN_IDLE_GAP_BUCKETS; i++)
+			adev->vcn.idle_gaps[i] /= 2;
+	}
+}
+
 static void amdgpu_vcn_idle_work_handler(struct work_struct *work)
 {
 	struct amdgpu_device *adev =
@@ -404,8 +458,25 @@ static void amdgpu_vcn_idle_work_handler(struct work_struct *work)
 	}
 
 	if (!fences && !atomic_read(&adev->vcn.total_submission_cnt)) {
+		unsigned int target;
+		s64 idle;
+
+		mutex_lock(&adev->vcn.vcn_pg_lock);
+		target = amdgpu_vcn_idle_target_ms(adev);
+		idle = ktime_ms_delta(ktime_get(), adev->vcn.last_use);
+		if (idle < target) {
+			mutex_unlock(&adev->vcn.vcn_pg_lock);
+			schedule_delayed_work(&adev->vcn.idle_work,
+					      msecs_to_jiffies(target - idle));
+			return;
+		}
+
 		amdgpu_device_ip_set_powergating_state(adev, AMD_IP_BLOCK_TYPE_VCN,
 		       AMD_PG_STATE_GATE);
+		adev->vcn.gated = true;
+		adev->vcn.gate_count++;
+		mutex_unlock(&adev->vcn.vcn_pg_lock);
+
 		r = amdgpu_dpm_switch_power_profile(adev, PP_SMC_POWER_PROFILE_VIDEO,
 				false);
 		if (r)
@@ -418,10 +489,9 @@ static void amdgpu_vcn_idle_work_handler(struct work_struct *work)
 void amdgpu_vcn_ring_begin_use(struct amdgpu_ring *ring)
 {
 	struct amdgpu_device *adev = ring->adev;
+	bool first = atomic_inc_return(&adev->vcn.total_submission_cnt) == 1;
 	int r = 0;
 
-	atomic_inc(&adev->vcn.total_submission_cnt);
-
 	if (!cancel_delayed_work_sync(&adev->vcn.idle_work)) {
 		r = amdgpu_dpm_switch_power_profile(adev, PP_SMC_POWER_PROFILE_VIDEO,
 				true);
@@ -430,8 +500,24 @@ void amdgpu_vcn_ring_begin_use(struct amdgpu_ring *ring)
 	}
 
 	mutex_lock(&adev->vcn.vcn_pg_lock);
-	amdgpu_device_ip_set_powergating_state(adev, AMD_IP_BLOCK_TYPE_VCN,
-	       AMD_PG_STATE_UNGATE);
+	if (first)
+		amdgpu_vcn_record_idle_gap(adev);
+
+	if (adev->vcn.gated) {
+		ktime_t start = ktime_get();
+		u32 us;
+
+		amdgpu_device_ip_set_powergating_state(adev, AMD_IP_BLOCK_TYPE_VCN,
+		       AMD_PG_STATE_UNGATE);
+		us = ktime_us_delta(ktime_get(), start);
+		adev->vcn.gated = false;
+		adev->vcn.ungate_count++;
+		adev->vcn.ungate_total_us += us;
+		adev->vcn.ungate_max_us = max(adev->vcn.ungate_max_us, us);
+	} else {
+		amdgpu_device_ip_set_powergating_state(adev, AMD_IP_BLOCK_TYPE_VCN,
+		       AMD_PG_STATE_UNGATE);
+	}
 
 	if (adev->pg_flags & AMD_PG_SUPPORT_VCN_DPG)	{
 		struct dpg_pause_state new_state;
@@ -463,6 +549,10 @@ void amdgpu_vcn_ring_end_use(struct amdgpu_ring *ring)
 		ring->funcs->type == AMDGPU_RING_TYPE_VCN_ENC)
 		atomic_dec(&ring->adev->vcn.inst[ring->me].dpg_enc_submission_cnt);
 
+	mutex_lock(&ring->adev->vcn.vcn_pg_lock);
+	ring->adev->vcn.last_use = ktime_get();
+	mutex_unlock(&ring->adev->vcn.vcn_pg_lock);
+
 	atomic_dec(&ring->adev->vcn.total_submission_cnt);
 
 	schedule_delayed_work(&ring->adev->vcn.idle_work, VCN_IDLE_TIMEOUT);
@@ -971,3 +1061,49 @@ void amdgpu_vcn_setup_ucode(struct amdgpu_device *adev)
 		dev_info(adev->dev, "Will use PSP to load VCN firmware\n");
 	}
 }
+
+#if defined(CONFIG_DEBUG_FS)
+/* Power gating statistics and the idle gaps the gating delay is learned from */
+static int amdgpu_debugfs_vcn_pg_show(struct seq_file *m, void *unused)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)m->private;
+	unsigned int i;
+
+	mutex_lock(&adev->vcn.vcn_pg_lock);
+	seq_printf(m, "gated:           %d\n", adev->vcn.gated);
+	seq_printf(m, "gate_count:      %llu\n", adev->vcn.gate_count);
+	seq_printf(m, "ungate_count:    %llu\n", adev->vcn.ungate_count);
+	seq_printf(m, "ungate_avg_us:   %llu\n", adev->vcn.ungate_count ?
+		   div64_u64(adev->vcn.ungate_total_us,
+			     adev->vcn.ungate_count) : 0);
+	seq_printf(m, "ungate_max_us:   %u\n", adev->vcn.ungate_max_us);
+	seq_printf(m, "idle_target_ms:  %u\n", amdgpu_vcn_idle_target_ms(adev));
+	seq_puts(m, "idle_gaps_ms:\n");
+	for (i = 0; i < AMDGPU_VCN_IDLE_GAP_BUCKETS; i++) {
+		if (!adev->vcn.idle_gaps[i])
+			continue;
+		seq_printf(m, "  %5u%c %u\n",
+			   VCN_IDLE_TIMEOUT_MS + i * AMDGPU_VCN_IDLE_GAP_MS,
+			   i == AMDGPU_VCN_IDLE_GAP_BUCKETS - 1 ? '+' : ' ',
+			   adev->vcn.idle_gaps[i]);
+	}
+	mutex_unlock(&adev->vcn.vcn_pg_lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(amdgpu_debugfs_vcn_pg);
+#endif
+
+void amdgpu_vcn_debugfs_init(struct amdgpu_device *adev)
+{
+#if defined(CONFIG_DEBUG_FS)
+	struct drm_minor *minor = adev_to_drm(adev)->primary;
+
+	if (!adev->vcn.num_vcn_inst)
+		return;
+
+	debugfs_create_file("amdgpu_vcn_pg", 0444, minor->debugfs_root, adev,
+			    &amdgpu_debugfs_vcn_pg_fops);
+#endif
+}
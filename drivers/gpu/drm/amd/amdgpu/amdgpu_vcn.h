@@ -76,7 +76,12 @@
 #define mmUVD_REG_XX_MASK_BASE_IDX 					1
 
 /* 1 second timeout */
-#define VCN_IDLE_TIMEOUT	msecs_to_jiffies(1000)
+#define VCN_IDLE_TIMEOUT_MS	1000
+#define VCN_IDLE_TIMEOUT	msecs_to_jiffies(VCN_IDLE_TIMEOUT_MS)
+
+/* idle gaps longer than VCN_IDLE_TIMEOUT, in buckets of 250ms */
+#define AMDGPU_VCN_IDLE_GAP_BUCKETS	32
+#define AMDGPU_VCN_IDLE_GAP_MS		250
 
 #define RREG32_SOC15_DPG_MODE_1_0(ip, inst_idx, reg, mask, sram_sel) 			\
 	({	WREG32_SOC15(ip, inst_idx, mmUVD_DPG_LMA_MASK, mask); 			\
@@ -244,6 +249,15 @@ struct amdgpu_vcn {
 	unsigned	harvest_config;
 	int (*pause_dpg_mode)(struct amdgpu_device *adev,
 		int inst_idx, struct dpg_pause_state *new_state);
+
+	/* adaptive power gating, protected by vcn_pg_lock */
+	bool			gated;
+	ktime_t			last_use;
+	u32			idle_gaps[AMDGPU_VCN_IDLE_GAP_BUCKETS];
+	u64			gate_count;
+	u64			ungate_count;
+	u64			ungate_total_us;
+	u32			ungate_max_us;
 };
 
 struct amdgpu_fw_shared_rb_ptrs_struct {
@@ -297,6 +311,7 @@ int amdgpu_vcn_suspend(struct amdgpu_device *adev);
 int amdgpu_vcn_resume(struct amdgpu_device *adev);
 void amdgpu_vcn_ring_begin_use(struct amdgpu_ring *ring);
 void amdgpu_vcn_ring_end_use(struct amdgpu_ring *ring);
+void amdgpu_vcn_debugfs_init(struct amdgpu_device *adev);
 
 bool amdgpu_vcn_is_disabled_vcn(struct amdgpu_device *adev,
 				enum vcn_ring_type type, uint32_t vcn_instance);
@@ -1374,6 +1374,186 @@ static void amdgpu_vm_invalidate_pds(struct amdgpu_device *adev,
 			amdgpu_vm_bo_relocated(entry);
 }
 
+static void amdgpu_vm_free_mapping(struct amdgpu_device *adev,
+				   struct amdgpu_vm *vm,
+				   struct amdgpu_bo_va_mapping *mapping,
+				   struct dma_fence *fence);
+
+/**
+ * amdgpu_vm_update_flush - submit the updates collected by a transaction
+ *
+ * @params: the transaction to flush
+ * @last: true if the transaction ends, false to start a new job
+ *
+ * Commits the job of the transaction, points all recorded fences to the
+ * resulting fence and frees the mappings queued for freeing.
+ *
+ * Returns:
+ * 0 for success, error for failure.
+ */
+static int amdgpu_vm_update_flush(struct amdgpu_vm_update_params *params,
+				  bool last)
+{
+	struct amdgpu_vm *vm = params->vm;
+	struct amdgpu_bo_va_mapping *mapping, *tmp;
+	struct dma_fence *f = NULL;
+	unsigned int i;
+	int r = params->error;
+
+	if (!vm->use_cpu_for_update &&
+	    (r || !params->job || !params->job->ibs->length_dw)) {
+		/* Nothing to submit or updates incomplete after an error */
+		if (params->job)
+			amdgpu_job_free(params->job);
+	} else if (!r) {
+		r = vm->update_funcs->commit(params, &f);
+	}
+	params->job = NULL;
+
+	for (i = 0; f && i < params->num_fences; ++i) {
+		dma_fence_put(*params->fences[i]);
+		*params->fences[i] = dma_fence_get(f);
+	}
+	params->num_fences = 0;
+
+	list_for_each_entry_safe(mapping, tmp, &params->freed, list) {
+		list_del(&mapping->list);
+		amdgpu_vm_free_mapping(params->adev, vm, mapping, f);
+	}
+	dma_fence_put(f);
+
+	if (!r && !last)
+		r = vm->update_funcs->prepare(params, NULL,
+					      AMDGPU_SYNC_EXPLICIT);
+	if (r && !params->error)
+		params->error = r;
+	return r;
+}
+
+/**
+ * amdgpu_vm_update_add_fence - remember a fence to update on flush
+ *
+ * @params: the transaction
+ * @fence: fence pointer which should point to the transaction fence
+ *
+ * Flushes the transaction early if it already tracks too many fences.
+ *
+ * Returns:
+ * 0 for success, error for failure.
+ */
+static int amdgpu_vm_update_add_fence(struct amdgpu_vm_update_params *params,
+				      struct dma_fence **fence)
+{
+	unsigned int i;
+	int r;
+
+	if (!fence)
+		return 0;
+
+	for (i = 0; i < params->num_fences; ++i)
+		if (params->fences[i] == fence)
+			return 0;
+
+	if (params->num_fences == AMDGPU_VM_UPDATE_MAX_FENCES) {
+		r = amdgpu_vm_update_flush(params, false);
+		if (r)
+			return r;
+	}
+
+	params->fences[params->num_fences++] = fence;
+	return 0;
+}
+
+/**
+ * amdgpu_vm_update_begin - start a VM update transaction
+ *
+ * @adev: amdgpu_device pointer
+ * @vm: requested vm
+ * @params: storage for the transaction, must stay valid until
+ *	amdgpu_vm_update_end()
+ *
+ * While the transaction is open all delayed page table updates of @vm done
+ * by amdgpu_vm_bo_update_mapping(), amdgpu_vm_update_pdes() and
+ * amdgpu_vm_clear_freed() are collected into a single job with a single
+ * fence instead of committing a job for each call. Immediate and unlocked
+ * updates are not affected.
+ *
+ * The eviction lock of @vm is held until amdgpu_vm_update_end().
+ * PTs have to be reserved!
+ *
+ * Returns:
+ * 0 for success, error for failure.
+ */
+int amdgpu_vm_update_begin(struct amdgpu_device *adev, struct amdgpu_vm *vm,
+			   struct amdgpu_vm_update_params *params)
+{
+	int r;
+
+	if (WARN_ON(vm->batch))
+		return -EBUSY;
+
+	memset(params, 0, sizeof(*params));
+	params->adev = adev;
+	params->vm = vm;
+	params->batch = true;
+	INIT_LIST_HEAD(&params->freed);
+
+	amdgpu_vm_eviction_lock(vm);
+	if (vm->evicting) {
+		r = -EBUSY;
+		goto error_unlock;
+	}
+
+	if (!dma_fence_is_signaled(vm->last_unlocked)) {
+		struct dma_fence *tmp = dma_fence_get_stub();
+
+		amdgpu_bo_fence(vm->root.bo, vm->last_unlocked, true);
+		swap(vm->last_unlocked, tmp);
+		dma_fence_put(tmp);
+	}
+
+	r = vm->update_funcs->prepare(params, NULL, AMDGPU_SYNC_EXPLICIT);
+	if (r)
+		goto error_unlock;
+
+	vm->batch = params;
+	return 0;
+
+error_unlock:
+	amdgpu_vm_eviction_unlock(vm);
+	return r;
+}
+
+/**
+ * amdgpu_vm_update_end - finish a VM update transaction
+ *
+ * @adev: amdgpu_device pointer
+ * @vm: requested vm
+ * @fence: optional resulting fence
+ *
+ * Submits all updates collected since amdgpu_vm_update_begin() and drops
+ * the eviction lock again.
+ *
+ * Returns:
+ * 0 for success, the first error of the transaction otherwise.
+ */
+int amdgpu_vm_update_end(struct amdgpu_device *adev, struct amdgpu_vm *vm,
+			 struct dma_fence **fence)
+{
+	struct amdgpu_vm_update_params *params = vm->batch;
+	int r;
+
+	if (WARN_ON(!params))
+		return -EINVAL;
+
+	r = amdgpu_vm_update_add_fence(params, fence);
+	r = amdgpu_vm_update_flush(params, true) ?: r;
+	vm->batch = NULL;
+	amdgpu_vm_eviction_unlock(vm);
+
+	return r;
+}
+
 /**
  * amdgpu_vm_update_pdes - make sure that all directories are valid
  *
@@ -1389,7 +1569,8 @@ static void amdgpu_vm_invalidate_pds(struct amdgpu_device *adev,
 int amdgpu_vm_update_pdes(struct amdgpu_device *adev,
 			  struct amdgpu_vm *vm, bool immediate)
 {
-	struct amdgpu_vm_update_params params;
+	struct amdgpu_vm_update_params local, *params;
+	bool batched = vm->batch && !immediate;
 	int r, idx;
 
 	if (list_empty(&vm->relocated))
@@ -1398,14 +1579,23 @@ int amdgpu_vm_update_pdes(struct amdgpu_device *adev,
 	if (!drm_dev_enter(adev_to_drm(adev), &idx))
 		return -ENODEV;
 
-	memset(&params, 0, sizeof(params));
-	params.adev = adev;
-	params.vm = vm;
-	params.immediate = immediate;
-
-	r = vm->update_funcs->prepare(&params, NULL, AMDGPU_SYNC_EXPLICIT);
-	if (r)
-		goto exit;
+	if (batched) {
+		params = vm->batch;
+		r = params->error;
+		if (r)
+			goto exit;
+	} else {
+		params = &local;
+		memset(params, 0, sizeof(*params));
+		params->adev = adev;
+		params->vm = vm;
+		params->immediate = immediate;
+
+		r = vm->update_funcs->prepare(params, NULL,
+					      AMDGPU_SYNC_EXPLICIT);
+		if (r)
+			goto exit;
+	}
 
 	while (!list_empty(&vm->relocated)) {
 		struct amdgpu_vm_bo_base *entry;
@@ -1415,18 +1605,23 @@ int amdgpu_vm_update_pdes(struct amdgpu_device *adev,
 					 vm_status);
 		amdgpu_vm_bo_idle(entry);
 
-		r = amdgpu_vm_update_pde(&params, vm, entry);
+		r = amdgpu_vm_update_pde(params, vm, entry);
 		if (r)
 			goto error;
 	}
 
-	r = vm->update_funcs->commit(&params, &vm->last_update);
+	if (batched)
+		r = amdgpu_vm_update_add_fence(params, &vm->last_update);
+	else
+		r = vm->update_funcs->commit(params, &vm->last_update);
 	if (r)
 		goto error;
 	drm_dev_exit(idx);
 	return 0;
 
 error:
+	if (batched && !params->error)
+		params->error = r;
 	amdgpu_vm_invalidate_pds(adev, vm);
 exit:
 	drm_dev_exit(idx);
@@ -1467,15 +1662,18 @@ static void amdgpu_vm_update_flags(struct amdgpu_vm_update_params *params,
  * @params: see amdgpu_vm_update_params definition
  * @start: first PTE to handle
  * @end: last PTE to handle
+ * @dst: address the first PTE points to
  * @flags: hw mapping flags
  * @frag: resulting fragment size
  * @frag_end: end of this fragment
  *
- * Returns the first possible fragment for the start and end address.
+ * Returns the first possible fragment for the start and end address which
+ * is also aligned in the physical address space.
  */
 static void amdgpu_vm_fragment(struct amdgpu_vm_update_params *params,
-			       uint64_t start, uint64_t end, uint64_t flags,
-			       unsigned int *frag, uint64_t *frag_end)
+			       uint64_t start, uint64_t end, uint64_t dst,
+			       uint64_t flags, unsigned int *frag,
+			       uint64_t *frag_end)
 {
 	/**
 	 * The MC L1 TLB supports variable sized pages, based on a fragment
@@ -1514,6 +1712,15 @@ static void amdgpu_vm_fragment(struct amdgpu_vm_update_params *params,
 
 	/* This intentionally wraps around if no bit is set */
 	*frag = min((unsigned)ffs(start) - 1, (unsigned)fls64(end - start) - 1);
+
+	/* Huge pages and fragments need the same physical alignment, see
+	 * amdgpu_vm_bo_update_mapping() for how physically contiguous
+	 * nodes are merged to allow this.
+	 */
+	dst >>= AMDGPU_GPU_PAGE_SHIFT;
+	if (dst)
+		*frag = min(*frag, (unsigned)__ffs64(dst));
+
 	if (*frag >= max_frag) {
 		*frag = max_frag;
 		*frag_end = end & ~((1ULL << max_frag) - 1);
@@ -1547,7 +1754,8 @@ static int amdgpu_vm_update_ptes(struct amdgpu_vm_update_params *params,
 	int r;
 
 	/* figure out the initial fragment */
-	amdgpu_vm_fragment(params, frag_start, end, flags, &frag, &frag_end);
+	amdgpu_vm_fragment(params, frag_start, end, dst, flags, &frag,
+			   &frag_end);
 
 	/* walk over the address space and update the PTs */
 	amdgpu_vm_pt_start(adev, params->vm, start, &cursor);
@@ -1640,6 +1848,9 @@ static int amdgpu_vm_update_ptes(struct amdgpu_vm_update_params *params,
 			amdgpu_vm_update_flags(params, to_amdgpu_bo_vm(pt),
 					       cursor.level, pe_start, dst,
 					       nptes, incr, upd_flags);
+			if (cursor.level != AMDGPU_VM_PTB &&
+			    (flags & AMDGPU_PTE_VALID))
+				atomic64_add(nptes, &params->vm->huge_ptes);
 
 			pe_start += nptes * 8;
 			dst += nptes * incr;
@@ -1648,7 +1859,7 @@ static int amdgpu_vm_update_ptes(struct amdgpu_vm_update_params *params,
 			if (frag_start >= frag_end) {
 				/* figure out the next fragment */
 				amdgpu_vm_fragment(params, frag_start, end,
-						   flags, &frag, &frag_end);
+						   dst, flags, &frag, &frag_end);
 				if (frag < shift)
 					break;
 			}
@@ -1679,6 +1890,31 @@ static int amdgpu_vm_update_ptes(struct amdgpu_vm_update_params *params,
 	return 0;
 }
 
+/**
+ * amdgpu_vm_res_contiguous - size of the physically contiguous range
+ *
+ * @cursor: resource cursor to start at
+ *
+ * Returns the number of bytes starting at @cursor which are physically
+ * contiguous, which may span multiple nodes of the resource.
+ */
+static uint64_t amdgpu_vm_res_contiguous(struct amdgpu_res_cursor *cursor)
+{
+	struct amdgpu_res_cursor next = *cursor;
+	uint64_t size = cursor->size;
+
+	while (next.remaining > next.size) {
+		uint64_t end = next.start + next.size;
+
+		amdgpu_res_next(&next, next.size);
+		if (next.start != end)
+			break;
+		size += next.size;
+	}
+
+	return size;
+}
+
 /**
  * amdgpu_vm_bo_update_mapping - update a mapping in the vm page table
  *
@@ -1699,6 +1935,9 @@ static int amdgpu_vm_update_ptes(struct amdgpu_vm_update_params *params,
  *
  * Fill in the page table entries between @start and @last.
  *
+ * If a transaction is open on @vm, delayed updates are added to it instead
+ * of being committed right away, see amdgpu_vm_update_begin().
+ *
  * Returns:
  * 0 for success, -EINVAL for failure.
  */
@@ -1713,7 +1952,8 @@ int amdgpu_vm_bo_update_mapping(struct amdgpu_device *adev,
 				struct dma_fence **fence,
 				bool *table_freed)
 {
-	struct amdgpu_vm_update_params params;
+	struct amdgpu_vm_update_params local, *params;
+	bool batched = vm->batch && !immediate && !unlocked;
 	struct amdgpu_res_cursor cursor;
 	enum amdgpu_sync_mode sync_mode;
 	int r, idx;
@@ -1721,13 +1961,6 @@ int amdgpu_vm_bo_update_mapping(struct amdgpu_device *adev,
 	if (!drm_dev_enter(adev_to_drm(adev), &idx))
 		return -ENODEV;
 
-	memset(&params, 0, sizeof(params));
-	params.adev = adev;
-	params.vm = vm;
-	params.immediate = immediate;
-	params.pages_addr = pages_addr;
-	params.unlocked = unlocked;
-
 	/* Implicitly sync to command submissions in the same VM before
 	 * unmapping. Sync to moving fences before mapping.
 	 */
@@ -1736,6 +1969,26 @@ int amdgpu_vm_bo_update_mapping(struct amdgpu_device *adev,
 	else
 		sync_mode = AMDGPU_SYNC_EXPLICIT;
 
+	if (batched) {
+		/* Eviction lock is held by the transaction */
+		params = vm->batch;
+		params->pages_addr = pages_addr;
+		r = params->error;
+		if (!r && resv)
+			r = vm->update_funcs->sync(params, resv, sync_mode);
+		if (r)
+			goto error_unlock;
+		goto update;
+	}
+
+	params = &local;
+	memset(params, 0, sizeof(*params));
+	params->adev = adev;
+	params->vm = vm;
+	params->immediate = immediate;
+	params->pages_addr = pages_addr;
+	params->unlocked = unlocked;
+
 	amdgpu_vm_eviction_lock(vm);
 	if (vm->evicting) {
 		r = -EBUSY;
@@ -1750,10 +2003,11 @@ int amdgpu_vm_bo_update_mapping(struct amdgpu_device *adev,
 		dma_fence_put(tmp);
 	}
 
-	r = vm->update_funcs->prepare(&params, resv, sync_mode);
+	r = vm->update_funcs->prepare(params, resv, sync_mode);
 	if (r)
 		goto error_unlock;
 
+update:
 	amdgpu_res_first(pages_addr ? NULL : res, offset,
 			 (last - start + 1) * AMDGPU_GPU_PAGE_SIZE, &cursor);
 	while (cursor.remaining) {
@@ -1785,13 +2039,21 @@ int amdgpu_vm_bo_update_mapping(struct amdgpu_device *adev,
 
 			if (!contiguous) {
 				addr = cursor.start;
-				params.pages_addr = pages_addr;
+				params->pages_addr = pages_addr;
 			} else {
 				addr = pages_addr[cursor.start >> PAGE_SHIFT];
-				params.pages_addr = NULL;
+				params->pages_addr = NULL;
 			}
 
 		} else if (flags & (AMDGPU_PTE_VALID | AMDGPU_PTE_PRT)) {
+			uint64_t size = amdgpu_vm_res_contiguous(&cursor);
+
+			/* Write physically contiguous nodes in one go so that
+			 * the fragment can span them.
+			 */
+			if (size > cursor.size)
+				atomic64_inc(&vm->merged_ranges);
+			num_entries = size >> AMDGPU_GPU_PAGE_SHIFT;
 			addr = bo_adev->vm_manager.vram_base_offset +
 				cursor.start;
 		} else {
@@ -1799,21 +2061,34 @@ int amdgpu_vm_bo_update_mapping(struct amdgpu_device *adev,
 		}
 
 		tmp = start + num_entries;
-		r = amdgpu_vm_update_ptes(&params, start, tmp, addr, flags);
+		r = amdgpu_vm_update_ptes(params, start, tmp, addr, flags);
 		if (r)
 			goto error_unlock;
 
-		amdgpu_res_next(&cursor, num_entries * AMDGPU_GPU_PAGE_SIZE);
+		/* amdgpu_res_next() only walks a single node at a time */
+		num_entries *= AMDGPU_GPU_PAGE_SIZE;
+		while (num_entries) {
+			uint64_t step = min(num_entries, cursor.size);
+
+			amdgpu_res_next(&cursor, step);
+			num_entries -= step;
+		}
 		start = tmp;
 	}
 
-	r = vm->update_funcs->commit(&params, fence);
+	if (batched)
+		r = amdgpu_vm_update_add_fence(params, fence);
+	else
+		r = vm->update_funcs->commit(params, fence);
 
 	if (table_freed)
-		*table_freed = *table_freed || params.table_freed;
+		*table_freed = *table_freed || params->table_freed;
 
 error_unlock:
-	amdgpu_vm_eviction_unlock(vm);
+	if (!batched)
+		amdgpu_vm_eviction_unlock(vm);
+	else if (r && !params->error)
+		params->error = r;
 	drm_dev_exit(idx);
 	return r;
 }
@@ -2149,14 +2424,22 @@ int amdgpu_vm_clear_freed(struct amdgpu_device *adev,
 		r = amdgpu_vm_bo_update_mapping(adev, adev, vm, false, false,
 						resv, mapping->start,
 						mapping->last, init_pte_value,
-						0, NULL, NULL, &f, NULL);
-		amdgpu_vm_free_mapping(adev, vm, mapping, f);
+						0, NULL, NULL,
+						vm->batch ? NULL : &f, NULL);
+		/* The transaction frees the mapping once it is flushed */
+		if (vm->batch)
+			list_add_tail(&mapping->list, &vm->batch->freed);
+		else
+			amdgpu_vm_free_mapping(adev, vm, mapping, f);
 		if (r) {
 			dma_fence_put(f);
 			return r;
 		}
 	}
 
+	if (vm->batch)
+		return amdgpu_vm_update_add_fence(vm->batch, fence);
+
 	if (fence && f) {
 		dma_fence_put(*fence);
 		*fence = f;
@@ -2184,16 +2467,28 @@ int amdgpu_vm_clear_freed(struct amdgpu_device *adev,
 int amdgpu_vm_handle_moved(struct amdgpu_device *adev,
 			   struct amdgpu_vm *vm)
 {
+	struct amdgpu_vm_update_params params;
 	struct amdgpu_bo_va *bo_va, *tmp;
 	struct dma_resv *resv;
-	bool clear;
+	bool clear, empty;
 	int r;
 
+	spin_lock(&vm->invalidated_lock);
+	empty = list_empty(&vm->invalidated);
+	spin_unlock(&vm->invalidated_lock);
+	if (empty && list_empty(&vm->moved))
+		return 0;
+
+	/* Collect the updates of all moved BOs into a single job */
+	r = amdgpu_vm_update_begin(adev, vm, &params);
+	if (r)
+		return r;
+
 	list_for_each_entry_safe(bo_va, tmp, &vm->moved, base.vm_status) {
 		/* Per VM BOs never need to bo cleared in the page tables */
 		r = amdgpu_vm_bo_update(adev, bo_va, false, NULL);
 		if (r)
-			return r;
+			goto out;
 	}
 
 	spin_lock(&vm->invalidated_lock);
@@ -2211,16 +2506,17 @@ int amdgpu_vm_handle_moved(struct amdgpu_device *adev,
 			clear = true;
 
 		r = amdgpu_vm_bo_update(adev, bo_va, clear, NULL);
-		if (r)
-			return r;
-
 		if (!clear)
 			dma_resv_unlock(resv);
+		if (r)
+			goto out;
+
 		spin_lock(&vm->invalidated_lock);
 	}
 	spin_unlock(&vm->invalidated_lock);
 
-	return 0;
+out:
+	return amdgpu_vm_update_end(adev, vm, NULL) ?: r;
 }
 
 /**
@@ -2259,8 +2555,11 @@ struct amdgpu_bo_va *amdgpu_vm_bo_add(struct amdgpu_device *adev,
 
 	if (amdgpu_dmabuf_is_xgmi_accessible(adev, bo)) {
 		bo_va->is_xgmi = true;
-		/* Power up XGMI if it can be potentially used */
-		amdgpu_xgmi_set_pstate(adev, AMDGPU_XGMI_PSTATE_MAX_VEGA20);
+		/* Power up XGMI if it can be potentially used, unless the
+		 * pstate follows the measured link bandwidth
+		 */
+		if (!amdgpu_xgmi_bw_interval)
+			amdgpu_xgmi_set_pstate(adev, AMDGPU_XGMI_PSTATE_MAX_VEGA20);
 	}
 
 	return bo_va;
@@ -2685,7 +2984,7 @@ void amdgpu_vm_bo_rmv(struct amdgpu_device *adev,
 
 	dma_fence_put(bo_va->last_pt_update);
 
-	if (bo && bo_va->is_xgmi)
+	if (bo && bo_va->is_xgmi && !amdgpu_xgmi_bw_interval)
 		amdgpu_xgmi_set_pstate(adev, AMDGPU_XGMI_PSTATE_MIN);
 
 	kfree(bo_va);
@@ -2923,6 +3222,11 @@ int amdgpu_vm_init(struct amdgpu_device *adev, struct amdgpu_vm *vm)
 	spin_lock_init(&vm->invalidated_lock);
 	INIT_LIST_HEAD(&vm->freed);
 	INIT_LIST_HEAD(&vm->done);
+	atomic64_set(&vm->huge_ptes, 0);
+	atomic64_set(&vm->merged_ranges, 0);
+	atomic64_set(&vm->evictions, 0);
+	atomic64_set(&vm->submissions, 0);
+	atomic64_set(&vm->faults, 0);
 
 	/* create scheduler entities for page table updates */
 	r = drm_sched_entity_init(&vm->immediate, DRM_SCHED_PRIORITY_NORMAL,
@@ -3337,49 +3641,57 @@ void amdgpu_vm_set_task_info(struct amdgpu_vm *vm)
 }
 
 /**
- * amdgpu_vm_handle_fault - graceful handling of VM faults.
+ * amdgpu_vm_is_compute_pasid - check if a PASID belongs to a compute VM
  * @adev: amdgpu device pointer
  * @pasid: PASID of the VM
- * @addr: Address of the fault
- * @write_fault: true is write fault, false is read fault
  *
- * Try to gracefully handle a VM fault. Return true if the fault was handled and
- * shouldn't be reported any more.
+ * Returns true if the VM of @pasid exists and is a compute context, i.e.
+ * its retry faults are recovered by SVM.
  */
-bool amdgpu_vm_handle_fault(struct amdgpu_device *adev, u32 pasid,
-			    uint64_t addr, bool write_fault)
+bool amdgpu_vm_is_compute_pasid(struct amdgpu_device *adev, u32 pasid)
 {
 	bool is_compute_context = false;
-	struct amdgpu_bo *root;
 	unsigned long irqflags;
-	uint64_t value, flags;
 	struct amdgpu_vm *vm;
-	int r;
 
 	xa_lock_irqsave(&adev->vm_manager.pasids, irqflags);
 	vm = xa_load(&adev->vm_manager.pasids, pasid);
-	if (vm) {
-		root = amdgpu_bo_ref(vm->root.bo);
+	if (vm)
 		is_compute_context = vm->is_compute_context;
-	} else {
-		root = NULL;
-	}
 	xa_unlock_irqrestore(&adev->vm_manager.pasids, irqflags);
 
-	if (!root)
-		return false;
-
-	addr /= AMDGPU_GPU_PAGE_SIZE;
+	return is_compute_context;
+}
 
-	if (is_compute_context &&
-	    !svm_range_restore_pages(adev, pasid, addr, write_fault)) {
-		amdgpu_bo_unref(&root);
-		return true;
-	}
+/**
+ * amdgpu_vm_handle_unrecovered_faults - fill the PTEs of unrecoverable faults
+ * @adev: amdgpu device pointer
+ * @pasid: PASID of the VM
+ * @root: root PD of the VM
+ * @is_compute_context: true if the VM is a compute context
+ * @addrs: GPU page numbers of the faults
+ * @count: number of faults
+ *
+ * Depending on the VM fault policy either redirects the accesses to the
+ * dummy page or lets the hardware retry silently. Compute contexts get an
+ * invalid PTE flag combination to turn the retry faults into no-retry faults.
+ */
+static void amdgpu_vm_handle_unrecovered_faults(struct amdgpu_device *adev,
+						u32 pasid,
+						struct amdgpu_bo *root,
+						bool is_compute_context,
+						const uint64_t *addrs,
+						unsigned int count)
+{
+	unsigned long irqflags;
+	uint64_t value, flags;
+	struct amdgpu_vm *vm;
+	unsigned int i;
+	int r;
 
 	r = amdgpu_bo_reserve(root, true);
 	if (r)
-		goto error_unref;
+		return;
 
 	/* Double check that the VM still exists */
 	xa_lock_irqsave(&adev->vm_manager.pasids, irqflags);
@@ -3417,11 +3729,13 @@ bool amdgpu_vm_handle_fault(struct amdgpu_device *adev, u32 pasid,
 		goto error_unlock;
 	}
 
-	r = amdgpu_vm_bo_update_mapping(adev, adev, vm, true, false, NULL, addr,
-					addr, flags, value, NULL, NULL, NULL,
-					NULL);
-	if (r)
-		goto error_unlock;
+	for (i = 0; i < count; ++i) {
+		r = amdgpu_vm_bo_update_mapping(adev, adev, vm, true, false,
+						NULL, addrs[i], addrs[i], flags,
+						value, NULL, NULL, NULL, NULL);
+		if (r)
+			goto error_unlock;
+	}
 
 	r = amdgpu_vm_update_pdes(adev, vm, true);
 
@@ -3429,11 +3743,91 @@ bool amdgpu_vm_handle_fault(struct amdgpu_device *adev, u32 pasid,
 	amdgpu_bo_unreserve(root);
 	if (r < 0)
 		DRM_ERROR("Can't handle page fault (%d)\n", r);
+}
+
+/**
+ * amdgpu_vm_handle_faults - graceful handling of a batch of VM faults.
+ * @adev: amdgpu device pointer
+ * @pasid: PASID of the VM
+ * @addrs: GPU page numbers of the faults in ascending order
+ * @count: number of faults
+ * @write_fault: true if the faults are write faults, false for read faults
+ *
+ * Faults of compute contexts are recovered by SVM for the whole batch at
+ * once, the PTEs of faults which can't be recovered are filled as in
+ * amdgpu_vm_handle_fault(). Return true if all faults were handled and
+ * shouldn't be reported any more.
+ */
+bool amdgpu_vm_handle_faults(struct amdgpu_device *adev, u32 pasid,
+			     const uint64_t *addrs, unsigned int count,
+			     bool write_fault)
+{
+	bool is_compute_context = false;
+	struct amdgpu_bo *root;
+	unsigned long irqflags;
+	struct amdgpu_vm *vm;
+	bool handled = true;
+	unsigned int done;
+
+	atomic64_add(count, &adev->num_vm_faults);
+
+	xa_lock_irqsave(&adev->vm_manager.pasids, irqflags);
+	vm = xa_load(&adev->vm_manager.pasids, pasid);
+	if (vm) {
+		root = amdgpu_bo_ref(vm->root.bo);
+		is_compute_context = vm->is_compute_context;
+		atomic64_add(count, &vm->faults);
+	} else {
+		root = NULL;
+	}
+	xa_unlock_irqrestore(&adev->vm_manager.pasids, irqflags);
+
+	if (!root)
+		return false;
+
+	if (!is_compute_context) {
+		amdgpu_vm_handle_unrecovered_faults(adev, pasid, root, false,
+						    addrs, count);
+		handled = false;
+		goto out_unref;
+	}
+
+	while (count) {
+		done = count;
+		if (!svm_range_restore_pages(adev, pasid, addrs, &done,
+					     write_fault))
+			break;
+
+		/* Fault at index done can't be recovered, continue after it */
+		amdgpu_vm_handle_unrecovered_faults(adev, pasid, root, true,
+						    &addrs[done], 1);
+		handled = false;
+		addrs += done + 1;
+		count -= done + 1;
+	}
 
-error_unref:
+out_unref:
 	amdgpu_bo_unref(&root);
 
-	return false;
+	return handled;
+}
+
+/**
+ * amdgpu_vm_handle_fault - graceful handling of VM faults.
+ * @adev: amdgpu device pointer
+ * @pasid: PASID of the VM
+ * @addr: Address of the fault
+ * @write_fault: true is write fault, false is read fault
+ *
+ * Try to gracefully handle a VM fault. Return true if the fault was handled and
+ * shouldn't be reported any more.
+ */
+bool amdgpu_vm_handle_fault(struct amdgpu_device *adev, u32 pasid,
+			    uint64_t addr, bool write_fault)
+{
+	addr /= AMDGPU_GPU_PAGE_SIZE;
+
+	return amdgpu_vm_handle_faults(adev, pasid, &addr, 1, write_fault);
 }
 
 #if defined(CONFIG_DEBUG_FS)
@@ -3529,5 +3923,9 @@ void amdgpu_debugfs_vm_bo_info(struct amdgpu_vm *vm, struct seq_file *m)
 		   total_invalidated_objs);
 	seq_printf(m, "\tTotal done size:        %12lld\tobjs:\t%d\n", total_done,
 		   total_done_objs);
+	seq_printf(m, "\tHuge page entries written: %12lld\n",
+		   atomic64_read(&vm->huge_ptes));
+	seq_printf(m, "\tContiguous ranges merged:  %12lld\n",
+		   atomic64_read(&vm->merged_ranges));
 }
 #endif
@@ -187,6 +187,9 @@ struct amdgpu_task_info {
  * the number of function parameters
  *
  */
+/* Maximum number of fence pointers a VM update transaction tracks */
+#define AMDGPU_VM_UPDATE_MAX_FENCES	16
+
 struct amdgpu_vm_update_params {
 
 	/**
@@ -230,12 +233,40 @@ struct amdgpu_vm_update_params {
 	 * @table_freed: return true if page table is freed when updating
 	 */
 	bool table_freed;
+
+	/**
+	 * @batch: true if these params belong to a VM update transaction,
+	 * see amdgpu_vm_update_begin()
+	 */
+	bool batch;
+
+	/**
+	 * @error: first error hit by an update of the transaction
+	 */
+	int error;
+
+	/**
+	 * @fences: fences to replace when the transaction is flushed
+	 */
+	struct dma_fence **fences[AMDGPU_VM_UPDATE_MAX_FENCES];
+
+	/**
+	 * @num_fences: number of valid entries in @fences
+	 */
+	unsigned int num_fences;
+
+	/**
+	 * @freed: mappings to free when the transaction is flushed
+	 */
+	struct list_head freed;
 };
 
 struct amdgpu_vm_update_funcs {
 	int (*map_table)(struct amdgpu_bo_vm *bo);
 	int (*prepare)(struct amdgpu_vm_update_params *p, struct dma_resv *resv,
 		       enum amdgpu_sync_mode sync_mode);
+	int (*sync)(struct amdgpu_vm_update_params *p, struct dma_resv *resv,
+		    enum amdgpu_sync_mode sync_mode);
 	int (*update)(struct amdgpu_vm_update_params *p,
 		      struct amdgpu_bo_vm *bo, uint64_t pe, uint64_t addr,
 		      unsigned count, uint32_t incr, uint64_t flags);
@@ -297,6 +328,20 @@ struct amdgpu_vm {
 	/* Functions to use for VM table updates */
 	const struct amdgpu_vm_update_funcs	*update_funcs;
 
+	/* Open VM update transaction, protected by the root PD reservation */
+	struct amdgpu_vm_update_params		*batch;
+
+	/* PDE-as-PTE entries written and physically contiguous node ranges
+	 * merged into a single update, for debugfs
+	 */
+	atomic64_t		huge_ptes;
+	atomic64_t		merged_ranges;
+
+	/* Event counters for fdinfo and the software PMU */
+	atomic64_t		evictions;
+	atomic64_t		submissions;
+	atomic64_t		faults;
+
 	/* Flag to indicate ATS support from PTE for GFX9 */
 	bool			pte_support_ats;
 
@@ -390,6 +435,10 @@ int amdgpu_vm_validate_pt_bos(struct amdgpu_device *adev, struct amdgpu_vm *vm,
 			      int (*callback)(void *p, struct amdgpu_bo *bo),
 			      void *param);
 int amdgpu_vm_flush(struct amdgpu_ring *ring, struct amdgpu_job *job, bool need_pipe_sync);
+int amdgpu_vm_update_begin(struct amdgpu_device *adev, struct amdgpu_vm *vm,
+			   struct amdgpu_vm_update_params *params);
+int amdgpu_vm_update_end(struct amdgpu_device *adev, struct amdgpu_vm *vm,
+			 struct dma_fence **fence);
 int amdgpu_vm_update_pdes(struct amdgpu_device *adev,
 			  struct amdgpu_vm *vm, bool immediate);
 int amdgpu_vm_clear_freed(struct amdgpu_device *adev,
@@ -447,6 +496,10 @@ void amdgpu_vm_check_compute_bug(struct amdgpu_device *adev);
 
 void amdgpu_vm_get_task_info(struct amdgpu_device *adev, u32 pasid,
 			     struct amdgpu_task_info *task_info);
+bool amdgpu_vm_is_compute_pasid(struct amdgpu_device *adev, u32 pasid);
+bool amdgpu_vm_handle_faults(struct amdgpu_device *adev, u32 pasid,
+			     const uint64_t *addrs, unsigned int count,
+			     bool write_fault);
 bool amdgpu_vm_handle_fault(struct amdgpu_device *adev, u32 pasid,
 			    uint64_t addr, bool write_fault);
 
@@ -34,6 +34,23 @@ static int amdgpu_vm_cpu_map_table(struct amdgpu_bo_vm *table)
 	return amdgpu_bo_kmap(&table->bo, NULL);
 }
 
+/**
+ * amdgpu_vm_cpu_sync - wait for fences before updating with the CPU
+ *
+ * @p: see amdgpu_vm_update_params definition
+ * @resv: reservation object with embedded fence
+ * @sync_mode: synchronization mode
+ *
+ * Returns:
+ * Negativ errno, 0 for success.
+ */
+static int amdgpu_vm_cpu_sync(struct amdgpu_vm_update_params *p,
+			      struct dma_resv *resv,
+			      enum amdgpu_sync_mode sync_mode)
+{
+	return amdgpu_bo_sync_wait_resv(p->adev, resv, sync_mode, p->vm, true);
+}
+
 /**
  * amdgpu_vm_cpu_prepare - prepare page table update with the CPU
  *
@@ -51,7 +68,7 @@ static int amdgpu_vm_cpu_prepare(struct amdgpu_vm_update_params *p,
 	if (!resv)
 		return 0;
 
-	return amdgpu_bo_sync_wait_resv(p->adev, resv, sync_mode, p->vm, true);
+	return amdgpu_vm_cpu_sync(p, resv, sync_mode);
 }
 
 /**
@@ -117,6 +134,7 @@ static int amdgpu_vm_cpu_commit(struct amdgpu_vm_update_params *p,
 const struct amdgpu_vm_update_funcs amdgpu_vm_cpu_funcs = {
 	.map_table = amdgpu_vm_cpu_map_table,
 	.prepare = amdgpu_vm_cpu_prepare,
+	.sync = amdgpu_vm_cpu_sync,
 	.update = amdgpu_vm_cpu_update,
 	.commit = amdgpu_vm_cpu_commit
 };
@@ -47,6 +47,23 @@ static int amdgpu_vm_sdma_map_table(struct amdgpu_bo_vm *table)
 	return r;
 }
 
+/**
+ * amdgpu_vm_sdma_sync - sync the SDMA command submission to fences
+ *
+ * @p: see amdgpu_vm_update_params definition
+ * @resv: reservation object with embedded fence
+ * @sync_mode: synchronization mode
+ *
+ * Returns:
+ * Negativ errno, 0 for success.
+ */
+static int amdgpu_vm_sdma_sync(struct amdgpu_vm_update_params *p,
+			       struct dma_resv *resv,
+			       enum amdgpu_sync_mode sync_mode)
+{
+	return amdgpu_sync_resv(p->adev, &p->job->sync, resv, sync_mode, p->vm);
+}
+
 /**
  * amdgpu_vm_sdma_prepare - prepare SDMA command submission
  *
@@ -67,15 +84,17 @@ static int amdgpu_vm_sdma_prepare(struct amdgpu_vm_update_params *p,
 	int r;
 
 	r = amdgpu_job_alloc_with_ib(p->adev, ndw * 4, pool, &p->job);
-	if (r)
+	if (r) {
+		p->job = NULL;
 		return r;
+	}
 
 	p->num_dw_left = ndw;
 
 	if (!resv)
 		return 0;
 
-	return amdgpu_sync_resv(p->adev, &p->job->sync, resv, sync_mode, p->vm);
+	return amdgpu_vm_sdma_sync(p, resv, sync_mode);
 }
 
 /**
@@ -122,6 +141,7 @@ static int amdgpu_vm_sdma_commit(struct amdgpu_vm_update_params *p,
 
 error:
 	amdgpu_job_free(p->job);
+	p->job = NULL;
 	return r;
 }
 
@@ -231,8 +251,10 @@ static int amdgpu_vm_sdma_update(struct amdgpu_vm_update_params *p,
 
 			r = amdgpu_job_alloc_with_ib(p->adev, ndw * 4, pool,
 						     &p->job);
-			if (r)
+			if (r) {
+				p->job = NULL;
 				return r;
+			}
 
 			p->num_dw_left = ndw;
 		}
@@ -278,6 +300,7 @@ static int amdgpu_vm_sdma_update(struct amdgpu_vm_update_params *p,
 const struct amdgpu_vm_update_funcs amdgpu_vm_sdma_funcs = {
 	.map_table = amdgpu_vm_sdma_map_table,
 	.prepare = amdgpu_vm_sdma_prepare,
+	.sync = amdgpu_vm_sdma_sync,
 	.update = amdgpu_vm_sdma_update,
 	.commit = amdgpu_vm_sdma_commit
 };
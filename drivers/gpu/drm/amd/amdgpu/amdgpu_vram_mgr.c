@@ -22,6 +22,7 @@
  * Authors: Christian König
  */
 
+#include <linux/cgroup_gpumem.h>
 #include <linux/dma-mapping.h>
 #include <drm/ttm/ttm_range_manager.h>
 
@@ -36,6 +37,19 @@ struct amdgpu_vram_reservation {
 	struct drm_mm_node mm_node;
 };
 
+/* Maximum number of BOs looked at by a single compaction pass */
+#define AMDGPU_VRAM_COMPACT_MAX_CANDIDATES	256
+
+/* Minimum time between two background compaction passes */
+#define AMDGPU_VRAM_COMPACT_INTERVAL		HZ
+
+/* Delay of the background scrub after VRAM was freed */
+#define AMDGPU_VRAM_SCRUB_DELAY			(HZ / 10)
+
+/* Free block histogram of amdgpu_vram_mgr_debug(), from 4KB to >= 1GB */
+#define AMDGPU_VRAM_MGR_HIST_SHIFT		PAGE_SHIFT
+#define AMDGPU_VRAM_MGR_HIST_ORDERS		(31 - PAGE_SHIFT)
+
 static inline struct amdgpu_vram_mgr *
 to_vram_mgr(struct ttm_resource_manager *man)
 {
@@ -235,6 +249,34 @@ u64 amdgpu_vram_mgr_bo_visible_size(struct amdgpu_bo *bo)
 	return usage;
 }
 
+/**
+ * amdgpu_vram_mgr_take_cleared - take the cleared state of a new node
+ *
+ * @mgr: amdgpu_vram_mgr pointer
+ * @mm: the node just inserted
+ *
+ * Forgets the cleared state of all blocks overlapping @mm, must be called with
+ * the manager lock held.
+ *
+ * Returns:
+ * True if all of @mm was known to be zero.
+ */
+static bool amdgpu_vram_mgr_take_cleared(struct amdgpu_vram_mgr *mgr,
+					 struct drm_mm_node *mm)
+{
+	unsigned long first = (unsigned long)mm->start / AMDGPU_VRAM_CLEAR_PAGES;
+	unsigned long last = (unsigned long)(mm->start + mm->size - 1) /
+		AMDGPU_VRAM_CLEAR_PAGES;
+	bool cleared;
+
+	if (!mgr->cleared)
+		return false;
+
+	cleared = find_next_zero_bit(mgr->cleared, last + 1, first) > last;
+	bitmap_clear(mgr->cleared, first, last - first + 1);
+	return cleared;
+}
+
 /* Commit the reservation of VRAM pages */
 static void amdgpu_vram_mgr_do_reserve(struct ttm_resource_manager *man)
 {
@@ -251,6 +293,7 @@ static void amdgpu_vram_mgr_do_reserve(struct ttm_resource_manager *man)
 		dev_dbg(adev->dev, "Reservation 0x%llx - %lld, Succeeded\n",
 			rsv->mm_node.start, rsv->mm_node.size);
 
+		amdgpu_vram_mgr_take_cleared(mgr, &rsv->mm_node);
 		vis_usage = amdgpu_vram_mgr_vis_size(adev, &rsv->mm_node);
 		atomic64_add(vis_usage, &mgr->vis_usage);
 		atomic64_add(rsv->mm_node.size << PAGE_SHIFT, &mgr->usage);
@@ -351,6 +394,397 @@ static void amdgpu_vram_mgr_virt_start(struct ttm_resource *mem,
 	mem->start = max(mem->start, start);
 }
 
+/**
+ * amdgpu_vram_mgr_free_below - check the free space below a page
+ *
+ * @mgr: amdgpu_vram_mgr pointer
+ * @lpfn: first page which shouldn't be considered
+ * @largest: resulting size of the largest hole in pages
+ *
+ * Returns the number of free pages below @lpfn.
+ */
+static u64 amdgpu_vram_mgr_free_below(struct amdgpu_vram_mgr *mgr,
+				      u64 lpfn, u64 *largest)
+{
+	struct drm_mm_node *hole;
+	u64 hole_start, hole_end;
+	u64 total = 0;
+
+	*largest = 0;
+	spin_lock(&mgr->lock);
+	drm_mm_for_each_hole(hole, &mgr->mm, hole_start, hole_end) {
+		hole_end = min(hole_end, lpfn);
+		if (hole_end <= hole_start)
+			continue;
+
+		total += hole_end - hole_start;
+		*largest = max(*largest, hole_end - hole_start);
+	}
+	spin_unlock(&mgr->lock);
+
+	return total;
+}
+
+/**
+ * amdgpu_vram_mgr_compact_next - pick the next BO to compact
+ *
+ * @mgr: amdgpu_vram_mgr pointer
+ * @limit: only consider BOs ending below this page, updated to the end of
+ *	the returned BO
+ *
+ * Returns the movable BO which ends at the highest address below @limit with
+ * a reference taken, or NULL if there is none.
+ */
+static struct amdgpu_bo *
+amdgpu_vram_mgr_compact_next(struct amdgpu_vram_mgr *mgr, u64 *limit)
+{
+	struct ttm_resource_manager *man = &mgr->manager;
+	struct ttm_device *bdev = man->bdev;
+	struct ttm_buffer_object *bo, *best = NULL;
+	u64 best_end = 0;
+	unsigned i;
+
+	spin_lock(&bdev->lru_lock);
+	for (i = 0; i < TTM_MAX_BO_PRIORITY; ++i) {
+		list_for_each_entry(bo, &man->lru[i], lru) {
+			u64 end = bo->resource->start +
+				bo->resource->num_pages;
+
+			if (end >= *limit || end <= best_end)
+				continue;
+
+			/* Kernel and KFD BOs aren't moved behind their back */
+			if (bo->deleted || bo->pin_count ||
+			    bo->type == ttm_bo_type_kernel ||
+			    !amdgpu_bo_is_amdgpu_bo(bo) ||
+			    ttm_to_amdgpu_bo(bo)->kfd_bo)
+				continue;
+
+			best = bo;
+			best_end = end;
+		}
+	}
+
+	if (best && !ttm_bo_get_unless_zero(best))
+		best = NULL;
+	if (best)
+		*limit = best_end;
+	spin_unlock(&bdev->lru_lock);
+
+	return best ? ttm_to_amdgpu_bo(best) : NULL;
+}
+
+/**
+ * amdgpu_vram_mgr_compact_bo - move a BO down into a hole
+ *
+ * @mgr: amdgpu_vram_mgr pointer
+ * @abo: the BO to move, must be reserved
+ *
+ * Moves @abo into free space below its current lowest node using the
+ * normal TTM move path. The copy is done by SDMA and the VM mappings are
+ * invalidated through amdgpu_bo_move_notify() as for any other move.
+ *
+ * Returns:
+ * The number of bytes moved, 0 if there is no space below the BO or a
+ * negative error code.
+ */
+static s64 amdgpu_vram_mgr_compact_bo(struct amdgpu_vram_mgr *mgr,
+				      struct amdgpu_bo *abo)
+{
+	struct ttm_operation_ctx ctx = { false, true };
+	struct ttm_resource *res = abo->tbo.resource;
+	struct amdgpu_res_cursor cursor;
+	struct ttm_placement placement;
+	u64 lpfn = U64_MAX, free, largest;
+	unsigned i;
+	int r;
+
+	if (res->mem_type != TTM_PL_VRAM || abo->tbo.pin_count)
+		return 0;
+
+	amdgpu_res_first(res, 0, (u64)res->num_pages << PAGE_SHIFT, &cursor);
+	while (cursor.remaining) {
+		lpfn = min(lpfn, (u64)PFN_DOWN(cursor.start));
+		amdgpu_res_next(&cursor, cursor.size);
+	}
+
+	/* Don't bother if the holes below can't take the BO anyway */
+	free = amdgpu_vram_mgr_free_below(mgr, lpfn, &largest);
+	if (free < res->num_pages)
+		return 0;
+	if ((res->placement & TTM_PL_FLAG_CONTIGUOUS) &&
+	    largest < res->num_pages)
+		return 0;
+
+	amdgpu_bo_placement_from_domain(abo, AMDGPU_GEM_DOMAIN_VRAM);
+	for (i = 0; i < abo->placement.num_placement; ++i) {
+		struct ttm_place *place = &abo->placements[i];
+
+		if (place->mem_type != TTM_PL_VRAM)
+			continue;
+		if (!place->lpfn || place->lpfn > lpfn)
+			place->lpfn = lpfn;
+		if (res->placement & TTM_PL_FLAG_CONTIGUOUS)
+			place->flags |= TTM_PL_FLAG_CONTIGUOUS;
+	}
+
+	/* No busy placement, compaction should never evict anything */
+	placement = abo->placement;
+	placement.num_busy_placement = 0;
+	r = ttm_bo_validate(&abo->tbo, &placement, &ctx);
+	if (r == -ENOMEM)
+		return 0;
+	if (r)
+		return r;
+
+	/* May have been placed somewhere else after all */
+	if (abo->tbo.resource->mem_type != TTM_PL_VRAM)
+		return 0;
+	return abo->tbo.base.size;
+}
+
+/**
+ * amdgpu_vram_mgr_compact - compact VRAM
+ *
+ * @mgr: amdgpu_vram_mgr pointer
+ * @budget: maximum number of bytes to move
+ *
+ * Walks the movable BOs from the top of VRAM downwards and moves each of them
+ * into free space below it, so that the free space accumulates at the top of
+ * VRAM in fewer but larger blocks. Pinned, kernel and KFD BOs as well as BOs
+ * which can't be reserved without blocking are skipped.
+ *
+ * Returns:
+ * The number of bytes moved.
+ */
+s64 amdgpu_vram_mgr_compact(struct amdgpu_vram_mgr *mgr, u64 budget)
+{
+	unsigned int candidates = AMDGPU_VRAM_COMPACT_MAX_CANDIDATES;
+	u64 limit = U64_MAX, moved = 0;
+	struct amdgpu_bo *abo;
+	s64 r = 0;
+
+	mutex_lock(&mgr->compact_lock);
+	while (moved < budget && candidates--) {
+		abo = amdgpu_vram_mgr_compact_next(mgr, &limit);
+		if (!abo)
+			break;
+
+		if (dma_resv_trylock(abo->tbo.base.resv)) {
+			r = amdgpu_vram_mgr_compact_bo(mgr, abo);
+			dma_resv_unlock(abo->tbo.base.resv);
+		}
+		amdgpu_bo_unref(&abo);
+
+		if (r < 0) {
+			atomic64_inc(&mgr->compact_failed);
+		} else if (r) {
+			atomic64_inc(&mgr->compact_bos);
+			moved += r;
+		}
+		r = 0;
+	}
+	atomic64_inc(&mgr->compact_passes);
+	atomic64_add(moved, &mgr->compact_bytes);
+	WRITE_ONCE(mgr->compact_jiffies, jiffies);
+	mutex_unlock(&mgr->compact_lock);
+
+	return moved;
+}
+
+static void amdgpu_vram_mgr_compact_work(struct work_struct *work)
+{
+	struct amdgpu_vram_mgr *mgr =
+		container_of(work, struct amdgpu_vram_mgr, compact_work.work);
+	int budget = READ_ONCE(amdgpu_vram_compact);
+
+	if (budget > 0)
+		amdgpu_vram_mgr_compact(mgr, (u64)budget << 20);
+}
+
+/**
+ * amdgpu_vram_mgr_schedule_compact - start background compaction
+ *
+ * @mgr: amdgpu_vram_mgr pointer
+ *
+ * Queues a background compaction pass, at most once per
+ * AMDGPU_VRAM_COMPACT_INTERVAL.
+ */
+static void amdgpu_vram_mgr_schedule_compact(struct amdgpu_vram_mgr *mgr)
+{
+	unsigned long next = READ_ONCE(mgr->compact_jiffies) +
+		AMDGPU_VRAM_COMPACT_INTERVAL;
+
+	if (READ_ONCE(amdgpu_vram_compact) <= 0)
+		return;
+
+	queue_delayed_work(system_unbound_wq, &mgr->compact_work,
+			   time_after(next, jiffies) ? next - jiffies : 0);
+}
+
+/**
+ * amdgpu_vram_mgr_scrub_grab - grab free blocks to scrub
+ *
+ * @mgr: amdgpu_vram_mgr pointer
+ * @node: storage for the grabbed blocks
+ * @max_blocks: maximum number of blocks to grab
+ *
+ * Reserves up to @max_blocks free blocks not known to be zero in the drm_mm.
+ *
+ * Returns:
+ * The number of blocks grabbed.
+ */
+static unsigned int amdgpu_vram_mgr_scrub_grab(struct amdgpu_vram_mgr *mgr,
+					       struct ttm_range_mgr_node *node,
+					       unsigned int max_blocks)
+{
+	u64 hole_start, hole_end, start;
+	struct drm_mm_node *hole;
+	unsigned int i, num = 0;
+
+	spin_lock(&mgr->lock);
+	drm_mm_for_each_hole(hole, &mgr->mm, hole_start, hole_end) {
+		start = round_up(hole_start, AMDGPU_VRAM_CLEAR_PAGES);
+		for (; start + AMDGPU_VRAM_CLEAR_PAGES <= hole_end &&
+		     num < max_blocks; start += AMDGPU_VRAM_CLEAR_PAGES) {
+			if (test_bit((unsigned long)start / AMDGPU_VRAM_CLEAR_PAGES,
+				     mgr->cleared))
+				continue;
+
+			node->mm_nodes[num].start = start;
+			node->mm_nodes[num].size = AMDGPU_VRAM_CLEAR_PAGES;
+			++num;
+		}
+		if (num == max_blocks)
+			break;
+	}
+
+	/* Can't modify the hole list while walking it */
+	for (i = 0; i < num; ++i)
+		WARN_ON(drm_mm_reserve_node(&mgr->mm, &node->mm_nodes[i]));
+	spin_unlock(&mgr->lock);
+
+	return num;
+}
+
+/**
+ * amdgpu_vram_mgr_scrub - clear free VRAM in the background
+ *
+ * @mgr: amdgpu_vram_mgr pointer
+ * @budget: maximum number of bytes to clear
+ *
+ * Temporary allocates free blocks not known to be zero, clears them with the
+ * buffer functions and marks them as cleared afterwards.
+ *
+ * Returns:
+ * The number of bytes cleared or a negative error code.
+ */
+static s64 amdgpu_vram_mgr_scrub(struct amdgpu_vram_mgr *mgr, u64 budget)
+{
+	struct amdgpu_device *adev = to_amdgpu_device(mgr);
+	struct ttm_resource_manager *man = &mgr->manager;
+	struct ttm_range_mgr_node *node;
+	struct dma_fence *fence;
+	unsigned int i, num, max_blocks, seq;
+	long r;
+
+	max_blocks = max_t(u64, budget / SZ_2M, 1);
+	node = kvzalloc(struct_size(node, mm_nodes, max_blocks), GFP_KERNEL);
+	if (!node)
+		return -ENOMEM;
+
+	seq = READ_ONCE(mgr->cleared_seq);
+	num = amdgpu_vram_mgr_scrub_grab(mgr, node, max_blocks);
+	if (!num) {
+		kvfree(node);
+		return 0;
+	}
+
+	/* Freed VRAM can still be the source of a pipelined eviction */
+	spin_lock(&man->move_lock);
+	fence = dma_fence_get(man->move);
+	spin_unlock(&man->move_lock);
+	if (fence) {
+		r = dma_fence_wait(fence, false);
+		dma_fence_put(fence);
+		if (r)
+			goto out_free;
+	}
+
+	node->base.mem_type = TTM_PL_VRAM;
+	node->base.num_pages = num * AMDGPU_VRAM_CLEAR_PAGES;
+	r = amdgpu_ttm_fill_mem(adev, &node->base, 0, NULL, false, &fence);
+	if (!r) {
+		r = dma_fence_wait(fence, false);
+		dma_fence_put(fence);
+	}
+
+out_free:
+	spin_lock(&mgr->lock);
+	for (i = 0; i < num; ++i) {
+		struct drm_mm_node *mm = &node->mm_nodes[i];
+
+		/* VRAM content might have been lost in the meantime */
+		if (!r && seq == mgr->cleared_seq)
+			set_bit((unsigned long)mm->start /
+				AMDGPU_VRAM_CLEAR_PAGES, mgr->cleared);
+		drm_mm_remove_node(mm);
+	}
+	amdgpu_vram_mgr_do_reserve(man);
+	spin_unlock(&mgr->lock);
+	kvfree(node);
+
+	if (r)
+		return r;
+
+	atomic64_add((u64)num * SZ_2M, &mgr->scrub_bytes);
+	return (s64)num * SZ_2M;
+}
+
+static void amdgpu_vram_mgr_scrub_work(struct work_struct *work)
+{
+	struct amdgpu_vram_mgr *mgr =
+		container_of(work, struct amdgpu_vram_mgr, scrub_work.work);
+	struct amdgpu_device *adev = to_amdgpu_device(mgr);
+	u64 budget = (u64)max(READ_ONCE(amdgpu_vram_scrub), 0) << 20;
+	s64 cleared;
+
+	if (!budget || !adev->mman.buffer_funcs_enabled ||
+	    !ttm_resource_manager_used(&mgr->manager))
+		return;
+
+	/* Only use the engine while it is idle and keep some VRAM free */
+	if (amdgpu_fence_count_emitted(adev->mman.buffer_funcs_ring) ||
+	    amdgpu_vram_mgr_usage(mgr) + 2 * budget > adev->gmc.real_vram_size)
+		return;
+
+	cleared = amdgpu_vram_mgr_scrub(mgr, budget);
+
+	/* Continue with the next batch if this one was full */
+	if (cleared >= (s64)max_t(u64, budget / SZ_2M, 1) * SZ_2M)
+		queue_delayed_work(system_unbound_wq, &mgr->scrub_work, 0);
+}
+
+/**
+ * amdgpu_vram_mgr_invalidate_cleared - forget about cleared VRAM
+ *
+ * @mgr: amdgpu_vram_mgr pointer
+ *
+ * Must be called when the content of VRAM might have been lost, e.g. after a
+ * GPU reset or resume.
+ */
+void amdgpu_vram_mgr_invalidate_cleared(struct amdgpu_vram_mgr *mgr)
+{
+	if (!mgr->cleared)
+		return;
+
+	spin_lock(&mgr->lock);
+	bitmap_zero(mgr->cleared, DIV_ROUND_UP(mgr->manager.size,
+					       AMDGPU_VRAM_CLEAR_PAGES));
+	mgr->cleared_seq++;
+	spin_unlock(&mgr->lock);
+}
+
 /**
  * amdgpu_vram_mgr_new - allocate new ranges
  *
@@ -446,6 +880,9 @@ static int amdgpu_vram_mgr_new(struct ttm_resource_manager *man,
 			goto error_free;
 		}
 
+		if (amdgpu_vram_mgr_take_cleared(mgr, &node->mm_nodes[i]))
+			node->mm_nodes[i].color = AMDGPU_VRAM_NODE_CLEARED;
+
 		vis_usage += amdgpu_vram_mgr_vis_size(adev, &node->mm_nodes[i]);
 		amdgpu_vram_mgr_virt_start(&node->base, &node->mm_nodes[i]);
 		pages_left -= pages;
@@ -475,6 +912,10 @@ static int amdgpu_vram_mgr_new(struct ttm_resource_manager *man,
 	ttm_resource_fini(man, &node->base);
 	kvfree(node);
 
+	/* The usage check above passed, so VRAM is just too fragmented */
+	if (r == -ENOSPC && !place->fpfn && lpfn == man->size)
+		amdgpu_vram_mgr_schedule_compact(mgr);
+
 error_sub:
 	atomic64_sub(mem_bytes, &mgr->usage);
 	return r;
@@ -512,6 +953,11 @@ static void amdgpu_vram_mgr_del(struct ttm_resource_manager *man,
 	atomic64_sub(usage, &mgr->usage);
 	atomic64_sub(vis_usage, &mgr->vis_usage);
 
+	if (mgr->cleared && READ_ONCE(amdgpu_vram_scrub) > 0 &&
+	    ttm_resource_manager_used(man))
+		queue_delayed_work(system_unbound_wq, &mgr->scrub_work,
+				   AMDGPU_VRAM_SCRUB_DELAY);
+
 	ttm_resource_fini(man, res);
 	kvfree(node);
 }
@@ -662,15 +1108,43 @@ uint64_t amdgpu_vram_mgr_vis_usage(struct amdgpu_vram_mgr *mgr)
 static void amdgpu_vram_mgr_debug(struct ttm_resource_manager *man,
 				  struct drm_printer *printer)
 {
+	unsigned int hist[AMDGPU_VRAM_MGR_HIST_ORDERS] = { };
 	struct amdgpu_vram_mgr *mgr = to_vram_mgr(man);
+	u64 hole_start, hole_end, largest = 0;
+	struct drm_mm_node *hole;
+	unsigned int i;
 
 	spin_lock(&mgr->lock);
 	drm_mm_print(&mgr->mm, printer);
+	drm_mm_for_each_hole(hole, &mgr->mm, hole_start, hole_end) {
+		u64 size = (hole_end - hole_start) << PAGE_SHIFT;
+
+		largest = max(largest, size);
+		hist[min_t(unsigned int, ilog2(size) - AMDGPU_VRAM_MGR_HIST_SHIFT,
+			 AMDGPU_VRAM_MGR_HIST_ORDERS - 1)]++;
+	}
 	spin_unlock(&mgr->lock);
 
 	drm_printf(printer, "man size:%llu pages, ram usage:%lluMB, vis usage:%lluMB\n",
 		   man->size, amdgpu_vram_mgr_usage(mgr) >> 20,
 		   amdgpu_vram_mgr_vis_usage(mgr) >> 20);
+
+	drm_printf(printer, "largest free block:%lluKB, free blocks:", largest >> 10);
+	for (i = 0; i < AMDGPU_VRAM_MGR_HIST_ORDERS; ++i)
+		drm_printf(printer, " %s%uKB:%u",
+			   i == AMDGPU_VRAM_MGR_HIST_ORDERS - 1 ? ">=" : "",
+			   1U << (AMDGPU_VRAM_MGR_HIST_SHIFT + i - 10), hist[i]);
+	drm_printf(printer, "\n");
+
+	drm_printf(printer, "compaction passes:%lld, bos moved:%lld, moved:%lldMB, failed:%lld\n",
+		   atomic64_read(&mgr->compact_passes),
+		   atomic64_read(&mgr->compact_bos),
+		   atomic64_read(&mgr->compact_bytes) >> 20,
+		   atomic64_read(&mgr->compact_failed));
+
+	drm_printf(printer, "scrubbed:%lldMB, clears skipped:%lldMB\n",
+		   atomic64_read(&mgr->scrub_bytes) >> 20,
+		   atomic64_read(&mgr->clear_skipped) >> 20);
 }
 
 static const struct ttm_resource_manager_func amdgpu_vram_mgr_func = {
@@ -696,10 +1170,25 @@ int amdgpu_vram_mgr_init(struct amdgpu_device *adev)
 
 	man->func = &amdgpu_vram_mgr_func;
 
+	/* Charge VRAM to the gpumem cgroup of the allocating task */
+	man->cg = gpumem_cgroup_register_region(adev->gmc.real_vram_size,
+						"drm/%s/vram0",
+						dev_name(adev->dev));
+	if (IS_ERR(man->cg))
+		return PTR_ERR(man->cg);
+
 	drm_mm_init(&mgr->mm, 0, man->size);
 	spin_lock_init(&mgr->lock);
 	INIT_LIST_HEAD(&mgr->reservations_pending);
 	INIT_LIST_HEAD(&mgr->reserved_pages);
+	mutex_init(&mgr->compact_lock);
+	INIT_DELAYED_WORK(&mgr->compact_work, amdgpu_vram_mgr_compact_work);
+	INIT_DELAYED_WORK(&mgr->scrub_work, amdgpu_vram_mgr_scrub_work);
+
+	/* Not fatal, allocations are just always cleared without it */
+	mgr->cleared = bitmap_zalloc(DIV_ROUND_UP(man->size,
+						  AMDGPU_VRAM_CLEAR_PAGES),
+				     GFP_KERNEL);
 
 	ttm_set_driver_manager(&adev->mman.bdev, TTM_PL_VRAM, &mgr->manager);
 	ttm_resource_manager_set_used(man, true);
@@ -722,6 +1211,8 @@ void amdgpu_vram_mgr_fini(struct amdgpu_device *adev)
 	struct amdgpu_vram_reservation *rsv, *temp;
 
 	ttm_resource_manager_set_used(man, false);
+	cancel_delayed_work_sync(&mgr->compact_work);
+	cancel_delayed_work_sync(&mgr->scrub_work);
 
 	ret = ttm_resource_manager_evict_all(&adev->mman.bdev, man);
 	if (ret)
@@ -738,6 +1229,12 @@ void amdgpu_vram_mgr_fini(struct amdgpu_device *adev)
 	drm_mm_takedown(&mgr->mm);
 	spin_unlock(&mgr->lock);
 
+	bitmap_free(mgr->cleared);
+	mgr->cleared = NULL;
+
 	ttm_resource_manager_cleanup(man);
 	ttm_set_driver_manager(&adev->mman.bdev, TTM_PL_VRAM, NULL);
+
+	gpumem_cgroup_unregister_region(man->cg);
+	man->cg = NULL;
 }
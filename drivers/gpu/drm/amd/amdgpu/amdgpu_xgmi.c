@@ -94,6 +94,12 @@ static const int walf_pcs_err_status_reg_aldebaran[] = {
 	smnPCS_GOPX1_PCS_ERROR_STATUS + 0x100000
 };
 
+/* DF instances of the xgmi_link<n>_data_outbound events, see amdgpu_pmu.c */
+static const u8 xgmi_link_df_instance_vg20[] = { 0x46, 0x47 };
+static const u8 xgmi_link_df_instance_arct[] = {
+	0x4b, 0x4c, 0x4d, 0x4e, 0x4f, 0x50
+};
+
 static const struct amdgpu_pcs_ras_field xgmi_pcs_ras_fields[] = {
 	{"XGMI PCS DataLossErr",
 	 SOC15_REG_FIELD(XGMI0_PCS_GOPX16_PCS_ERROR_STATUS, DataLossErr)},
@@ -286,8 +292,41 @@ static ssize_t amdgpu_xgmi_show_error(struct device *dev,
 }
 
 
+/**
+ * DOC: xgmi_bandwidth
+ *
+ * With the xgmi_bw_interval module parameter set, the file xgmi_bandwidth in
+ * the device directory reports the outbound bandwidth of each XGMI link in
+ * bytes per second, as measured over the last sample the link was part of:
+ *
+ * .. code-block:: console
+ *
+ *	link0: 12884901888
+ *	link1: 0
+ */
+static ssize_t amdgpu_xgmi_show_bandwidth(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	struct drm_device *ddev = dev_get_drvdata(dev);
+	struct amdgpu_device *adev = drm_to_adev(ddev);
+	struct amdgpu_xgmi_bw *bw = adev->gmc.xgmi.bw;
+	unsigned int i;
+	int size = 0;
+
+	if (!bw)
+		return -ENODEV;
+
+	for (i = 0; i < bw->num_links; i++)
+		size += sysfs_emit_at(buf, size, "link%u: %llu\n", i,
+				      READ_ONCE(bw->bytes_per_sec[i]));
+
+	return size;
+}
+
 static DEVICE_ATTR(xgmi_device_id, S_IRUGO, amdgpu_xgmi_show_device_id, NULL);
 static DEVICE_ATTR(xgmi_error, S_IRUGO, amdgpu_xgmi_show_error, NULL);
+static DEVICE_ATTR(xgmi_bandwidth, S_IRUGO, amdgpu_xgmi_show_bandwidth, NULL);
 
 static int amdgpu_xgmi_sysfs_add_dev_info(struct amdgpu_device *adev,
 					 struct amdgpu_hive_info *hive)
@@ -487,6 +526,164 @@ int amdgpu_xgmi_set_pstate(struct amdgpu_device *adev, int pstate)
 	return ret;
 }
 
+/* bytes carried by one counted XGMI data beat */
+#define AMDGPU_XGMI_BEAT_BYTES		32
+/* outbound bandwidth above which a link asks for the high pstate */
+#define AMDGPU_XGMI_BW_HIGH		SZ_1G
+/* outbound bandwidth below which a link counts as idle */
+#define AMDGPU_XGMI_BW_LOW		SZ_256M
+/* idle samples before the high pstate request is dropped again */
+#define AMDGPU_XGMI_BW_IDLE_SAMPLES	4
+
+#define AMDGPU_XGMI_DF_DATA_OUT(instance)	(0x7 | ((instance) << 8) | (0x2 << 16))
+
+static const u8 *amdgpu_xgmi_link_df_instances(struct amdgpu_device *adev,
+					       unsigned int *num_links)
+{
+	switch (adev->asic_type) {
+	case CHIP_VEGA20:
+		*num_links = ARRAY_SIZE(xgmi_link_df_instance_vg20);
+		return xgmi_link_df_instance_vg20;
+	case CHIP_ARCTURUS:
+		*num_links = ARRAY_SIZE(xgmi_link_df_instance_arct);
+		return xgmi_link_df_instance_arct;
+	default:
+		*num_links = 0;
+		return NULL;
+	}
+}
+
+static void amdgpu_xgmi_bw_update_pstate(struct amdgpu_xgmi_bw *bw)
+{
+	u64 max_bw = 0;
+	unsigned int i;
+
+	for (i = 0; i < bw->num_links; i++)
+		max_bw = max(max_bw, bw->bytes_per_sec[i]);
+
+	if (max_bw >= AMDGPU_XGMI_BW_LOW)
+		bw->idle_samples = 0;
+	else if (bw->idle_samples < AMDGPU_XGMI_BW_IDLE_SAMPLES)
+		bw->idle_samples++;
+
+	if (!bw->hi_req && max_bw >= AMDGPU_XGMI_BW_HIGH) {
+		if (!amdgpu_xgmi_set_pstate(bw->adev,
+					    AMDGPU_XGMI_PSTATE_MAX_VEGA20))
+			bw->hi_req = true;
+	} else if (bw->hi_req &&
+		   bw->idle_samples >= AMDGPU_XGMI_BW_IDLE_SAMPLES) {
+		if (!amdgpu_xgmi_set_pstate(bw->adev, AMDGPU_XGMI_PSTATE_MIN))
+			bw->hi_req = false;
+	}
+}
+
+/* read and release the counters of the links sampled last */
+static void amdgpu_xgmi_bw_collect(struct amdgpu_xgmi_bw *bw)
+{
+	struct amdgpu_device *adev = bw->adev;
+	const u8 *instance;
+	unsigned int i, num_links;
+	u64 elapsed, count;
+
+	instance = amdgpu_xgmi_link_df_instances(adev, &num_links);
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), bw->armed_at));
+
+	for (i = 0; i < bw->num_armed; i++) {
+		u64 config = AMDGPU_XGMI_DF_DATA_OUT(instance[bw->link[i]]);
+
+		adev->df.funcs->pmc_get_count(adev, config, bw->cntr[i],
+					      &count);
+		adev->df.funcs->pmc_stop(adev, config, bw->cntr[i], 1);
+
+		if (elapsed)
+			WRITE_ONCE(bw->bytes_per_sec[bw->link[i]],
+				   mul_u64_u64_div_u64(count *
+						       AMDGPU_XGMI_BEAT_BYTES,
+						       NSEC_PER_SEC, elapsed));
+	}
+	bw->num_armed = 0;
+}
+
+static void amdgpu_xgmi_bw_sample(struct work_struct *work)
+{
+	struct amdgpu_xgmi_bw *bw =
+		container_of(work, struct amdgpu_xgmi_bw, work.work);
+	struct amdgpu_device *adev = bw->adev;
+	const u8 *instance;
+	unsigned int i, link, num_links;
+	int cntr;
+
+	amdgpu_xgmi_bw_collect(bw);
+
+	/* arm the next group of links, as many as there are free counters */
+	instance = amdgpu_xgmi_link_df_instances(adev, &num_links);
+	for (i = 0; i < min_t(unsigned int, num_links,
+			      AMDGPU_MAX_DF_PERFMONS); i++) {
+		u64 config;
+
+		link = (bw->next_link + i) % num_links;
+		config = AMDGPU_XGMI_DF_DATA_OUT(instance[link]);
+
+		cntr = adev->df.funcs->pmc_start(adev, config, 0, 1);
+		if (cntr < 0)
+			break;
+
+		adev->df.funcs->pmc_start(adev, config, cntr, 0);
+		bw->link[bw->num_armed] = link;
+		bw->cntr[bw->num_armed++] = cntr;
+	}
+	bw->next_link = (bw->next_link + bw->num_armed) % num_links;
+	bw->armed_at = ktime_get();
+
+	amdgpu_xgmi_bw_update_pstate(bw);
+
+	schedule_delayed_work(&bw->work,
+			      msecs_to_jiffies(amdgpu_xgmi_bw_interval));
+}
+
+static void amdgpu_xgmi_bw_init(struct amdgpu_device *adev)
+{
+	struct amdgpu_xgmi_bw *bw;
+	unsigned int num_links;
+
+	if (!amdgpu_xgmi_bw_interval || adev->gmc.xgmi.bw ||
+	    !adev->df.funcs || !adev->df.funcs->pmc_start ||
+	    !adev->df.funcs->pmc_stop || !adev->df.funcs->pmc_get_count ||
+	    !amdgpu_xgmi_link_df_instances(adev, &num_links))
+		return;
+
+	bw = kzalloc(sizeof(*bw), GFP_KERNEL);
+	if (!bw)
+		return;
+
+	bw->adev = adev;
+	bw->num_links = num_links;
+	INIT_DELAYED_WORK(&bw->work, amdgpu_xgmi_bw_sample);
+	adev->gmc.xgmi.bw = bw;
+
+	if (device_create_file(adev->dev, &dev_attr_xgmi_bandwidth))
+		dev_err(adev->dev, "XGMI: Failed to create device file xgmi_bandwidth\n");
+
+	schedule_delayed_work(&bw->work, 0);
+}
+
+static void amdgpu_xgmi_bw_fini(struct amdgpu_device *adev)
+{
+	struct amdgpu_xgmi_bw *bw = adev->gmc.xgmi.bw;
+
+	if (!bw)
+		return;
+
+	device_remove_file(adev->dev, &dev_attr_xgmi_bandwidth);
+	cancel_delayed_work_sync(&bw->work);
+	amdgpu_xgmi_bw_collect(bw);
+	if (bw->hi_req)
+		amdgpu_xgmi_set_pstate(adev, AMDGPU_XGMI_PSTATE_MIN);
+
+	adev->gmc.xgmi.bw = NULL;
+	kfree(bw);
+}
+
 int amdgpu_xgmi_update_topology(struct amdgpu_hive_info *hive, struct amdgpu_device *adev)
 {
 	int ret;
@@ -682,6 +879,9 @@ int amdgpu_xgmi_add_device(struct amdgpu_device *adev)
 	if (!ret && !adev->gmc.xgmi.pending_reset)
 		ret = amdgpu_xgmi_sysfs_add_dev_info(adev, hive);
 
+	if (!ret && !adev->gmc.xgmi.pending_reset)
+		amdgpu_xgmi_bw_init(adev);
+
 exit_unlock:
 	mutex_unlock(&hive->hive_lock);
 exit:
@@ -709,6 +909,8 @@ int amdgpu_xgmi_remove_device(struct amdgpu_device *adev)
 	if (!hive)
 		return -EINVAL;
 
+	amdgpu_xgmi_bw_fini(adev);
+
 	mutex_lock(&hive->hive_lock);
 	task_barrier_rem_task(&hive->tb);
 	amdgpu_xgmi_sysfs_rem_dev_info(adev, hive);
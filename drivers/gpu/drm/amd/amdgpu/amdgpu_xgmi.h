@@ -44,6 +44,37 @@ struct amdgpu_hive_info {
 	} pstate;
 };
 
+#define AMDGPU_XGMI_MAX_LINKS		6
+
+/**
+ * struct amdgpu_xgmi_bw - XGMI link bandwidth sampling state
+ *
+ * @adev: the device the links belong to
+ * @work: samples the armed links and arms the next group
+ * @num_links: number of XGMI links of the device
+ * @next_link: first link of the group armed next
+ * @num_armed: number of links currently counted
+ * @link: links currently counted
+ * @cntr: DF counters assigned to the links currently counted
+ * @armed_at: time the current group was armed
+ * @bytes_per_sec: last measured outbound bandwidth per link
+ * @hi_req: a high link pstate was requested for the measured load
+ * @idle_samples: consecutive samples below the low watermark
+ */
+struct amdgpu_xgmi_bw {
+	struct amdgpu_device	*adev;
+	struct delayed_work	work;
+	unsigned int		num_links;
+	unsigned int		next_link;
+	unsigned int		num_armed;
+	unsigned int		link[AMDGPU_MAX_DF_PERFMONS];
+	int			cntr[AMDGPU_MAX_DF_PERFMONS];
+	ktime_t			armed_at;
+	u64			bytes_per_sec[AMDGPU_XGMI_MAX_LINKS];
+	bool			hi_req;
+	unsigned int		idle_samples;
+};
+
 struct amdgpu_pcs_ras_field {
 	const char *err_name;
 	uint32_t pcs_err_mask;
@@ -198,6 +198,7 @@ static u32 cik_ih_get_wptr(struct amdgpu_device *adev,
 		 * from the last not overwritten vector (wptr + 16). Hopefully
 		 * this should allow us to catchup.
 		 */
+		atomic64_inc(&adev->num_ih_overflows);
 		dev_warn(adev->dev, "IH ring buffer overflow (0x%08X, 0x%08X, 0x%08X)\n",
 			 wptr, ih->rptr, (wptr + 16) & ih->ptr_mask);
 		ih->rptr = (wptr + 16) & ih->ptr_mask;
@@ -120,9 +120,12 @@ static int gmc_v10_0_process_interrupt(struct amdgpu_device *adev,
 		}
 
 		/* Try to handle the recoverable page faults by filling page
-		 * tables
+		 * tables, faults of compute VMs are collected and handled in
+		 * batches
 		 */
-		if (amdgpu_vm_handle_fault(adev, entry->pasid, addr, write_fault))
+		if (amdgpu_gmc_queue_fault(adev, entry->ih, entry->pasid, addr,
+					   write_fault) ||
+		    amdgpu_vm_handle_fault(adev, entry->pasid, addr, write_fault))
 			return 1;
 	}
 
@@ -178,6 +181,7 @@ static void gmc_v10_0_set_irq_funcs(struct amdgpu_device *adev)
 {
 	adev->gmc.vm_fault.num_types = 1;
 	adev->gmc.vm_fault.funcs = &gmc_v10_0_irq_funcs;
+	adev->gmc.vm_fault.coalesce = true;
 
 	if (!amdgpu_sriov_vf(adev)) {
 		adev->gmc.ecc_irq.num_types = 1;
@@ -1816,7 +1816,7 @@ static int vcn_v3_0_limit_sched(struct amdgpu_cs_parser *p)
 
 	scheds = p->adev->gpu_sched[AMDGPU_HW_IP_VCN_DEC]
 		[AMDGPU_RING_PRIO_DEFAULT].sched;
-	drm_sched_entity_modify_sched(p->entity, scheds, 1);
+	amdgpu_ctx_pin_entity(p->entity, scheds);
 	return 0;
 }
 
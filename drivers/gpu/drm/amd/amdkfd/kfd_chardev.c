@@ -1097,6 +1097,14 @@ static int kfd_ioctl_reset_event(struct file *filp, struct kfd_process *p,
 	return kfd_reset_event(p, args->event_id);
 }
 
+static int kfd_ioctl_set_event_eventfd(struct file *filp,
+				       struct kfd_process *p, void *data)
+{
+	struct kfd_ioctl_set_event_eventfd_args *args = data;
+
+	return kfd_event_set_eventfd(p, args->event_id, args->eventfd);
+}
+
 static int kfd_ioctl_wait_events(struct file *filp, struct kfd_process *p,
 				void *data)
 {
@@ -1856,6 +1864,26 @@ static int kfd_ioctl_svm(struct file *filep, struct kfd_process *p, void *data)
 }
 #endif
 
+#if IS_ENABLED(CONFIG_HSA_AMD_SVM)
+static int kfd_ioctl_svm_policy(struct file *filep, struct kfd_process *p,
+				void *data)
+{
+	struct kfd_ioctl_svm_policy_args *args = data;
+
+	pr_debug("flags 0x%x enable %u window %u threshold %u pin %u prefetch %u\n",
+		 args->flags, args->enable, args->window_ms,
+		 args->thrash_threshold, args->pin_ms, args->prefetch_granules);
+
+	return svm_range_set_policy(p, args);
+}
+#else
+static int kfd_ioctl_svm_policy(struct file *filep, struct kfd_process *p,
+				void *data)
+{
+	return -EPERM;
+}
+#endif
+
 #define AMDKFD_IOCTL_DEF(ioctl, _func, _flags) \
 	[_IOC_NR(ioctl)] = {.cmd = ioctl, .func = _func, .flags = _flags, \
 			    .cmd_drv = 0, .name = #ioctl}
@@ -1959,6 +1987,12 @@ static const struct amdkfd_ioctl_desc amdkfd_ioctls[] = {
 
 	AMDKFD_IOCTL_DEF(AMDKFD_IOC_SET_XNACK_MODE,
 			kfd_ioctl_set_xnack_mode, 0),
+
+	AMDKFD_IOCTL_DEF(AMDKFD_IOC_SVM_POLICY,
+			kfd_ioctl_svm_policy, 0),
+
+	AMDKFD_IOCTL_DEF(AMDKFD_IOC_SET_EVENT_EVENTFD,
+			kfd_ioctl_set_event_eventfd, 0),
 };
 
 #define AMDKFD_CORE_IOCTL_COUNT	ARRAY_SIZE(amdkfd_ioctls)
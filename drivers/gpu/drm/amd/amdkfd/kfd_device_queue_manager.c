@@ -28,6 +28,7 @@
 #include <linux/types.h>
 #include <linux/bitops.h>
 #include <linux/sched.h>
+#include <linux/ktime.h>
 #include "kfd_priv.h"
 #include "kfd_device_queue_manager.h"
 #include "kfd_mqd_manager.h"
@@ -45,6 +46,7 @@ static int set_pasid_vmid_mapping(struct device_queue_manager *dqm,
 static int execute_queues_cpsch(struct device_queue_manager *dqm,
 				enum kfd_unmap_queues_filter filter,
 				uint32_t filter_param);
+static int execute_queues_cpsch_deferred(struct device_queue_manager *dqm);
 static int unmap_queues_cpsch(struct device_queue_manager *dqm,
 				enum kfd_unmap_queues_filter filter,
 				uint32_t filter_param, bool reset);
@@ -60,6 +62,7 @@ static int allocate_hqd(struct device_queue_manager *dqm, struct queue *q);
 static int allocate_sdma_queue(struct device_queue_manager *dqm,
 				struct queue *q);
 static void kfd_process_hw_exception(struct work_struct *work);
+static void kfd_process_runlist_work(struct work_struct *work);
 
 static inline
 enum KFD_MQD_TYPE get_mqd_type_from_queue_type(enum kfd_queue_type type)
@@ -660,6 +663,7 @@ static int evict_process_queues_nocpsch(struct device_queue_manager *dqm,
 			    pdd->process->pasid);
 
 	pdd->last_evict_timestamp = get_jiffies_64();
+	atomic64_inc(&pdd->evict_count);
 	/* Mark all queues as evicted. Deactivate all active queues on
 	 * the qpd.
 	 */
@@ -724,6 +728,7 @@ static int evict_process_queues_cpsch(struct device_queue_manager *dqm,
 		decrement_queue_count(dqm, q->properties.type);
 	}
 	pdd->last_evict_timestamp = get_jiffies_64();
+	atomic64_inc(&pdd->evict_count);
 	retval = execute_queues_cpsch(dqm,
 				qpd->is_debug ?
 				KFD_UNMAP_QUEUES_FILTER_ALL_QUEUES :
@@ -856,8 +861,7 @@ static int restore_process_queues_cpsch(struct device_queue_manager *dqm,
 		q->properties.is_active = true;
 		increment_queue_count(dqm, q->properties.type);
 	}
-	retval = execute_queues_cpsch(dqm,
-				KFD_UNMAP_QUEUES_FILTER_DYNAMIC_QUEUES, 0);
+	retval = execute_queues_cpsch_deferred(dqm);
 	qpd->evicted = 0;
 	eviction_duration = get_jiffies_64() - pdd->last_evict_timestamp;
 	atomic64_add(eviction_duration, &pdd->evict_duration_counter);
@@ -1166,6 +1170,9 @@ static int initialize_cpsch(struct device_queue_manager *dqm)
 		dqm->xgmi_sdma_bitmap = (BIT_ULL(num_xgmi_sdma_queues) - 1);
 
 	INIT_WORK(&dqm->hw_exception_work, kfd_process_hw_exception);
+	INIT_DELAYED_WORK(&dqm->runlist_work, kfd_process_runlist_work);
+	dqm->runlist_pending = false;
+	memset(&dqm->runlist_stats, 0, sizeof(dqm->runlist_stats));
 
 	return 0;
 }
@@ -1219,7 +1226,10 @@ static int stop_cpsch(struct device_queue_manager *dqm)
 {
 	bool hanging;
 
+	cancel_delayed_work_sync(&dqm->runlist_work);
+
 	dqm_lock(dqm);
+	dqm->runlist_pending = false;
 	if (!dqm->sched_running) {
 		dqm_unlock(dqm);
 		return 0;
@@ -1343,8 +1353,7 @@ static int create_queue_cpsch(struct device_queue_manager *dqm, struct queue *q,
 	if (q->properties.is_active) {
 		increment_queue_count(dqm, q->properties.type);
 
-		execute_queues_cpsch(dqm,
-				KFD_UNMAP_QUEUES_FILTER_DYNAMIC_QUEUES, 0);
+		execute_queues_cpsch_deferred(dqm);
 	}
 
 	/*
@@ -1499,15 +1508,75 @@ static int execute_queues_cpsch(struct device_queue_manager *dqm,
 				enum kfd_unmap_queues_filter filter,
 				uint32_t filter_param)
 {
+	struct dqm_runlist_stats *stats = &dqm->runlist_stats;
+	uint64_t start, delta;
 	int retval;
 
 	if (dqm->is_hws_hang)
 		return -EIO;
+
+	/* The runlist is rebuilt from scratch, covering any pending update */
+	dqm->runlist_pending = false;
+
+	start = ktime_get_ns();
 	retval = unmap_queues_cpsch(dqm, filter, filter_param, false);
-	if (retval)
-		return retval;
+	if (!retval)
+		retval = map_queues_cpsch(dqm);
+	delta = ktime_get_ns() - start;
+
+	stats->rebuilds++;
+	stats->total_ns += delta;
+	stats->max_ns = max(stats->max_ns, delta);
 
-	return map_queues_cpsch(dqm);
+	return retval;
+}
+
+/*
+ * Queue a runlist update that only adds work to the HWS, e.g. mapping newly
+ * created or restored queues. Updates within hws_runlist_batch_us are
+ * coalesced into a single preemption and resubmission by the runlist worker.
+ * Anything that takes queues away from the HWS must use execute_queues_cpsch
+ * directly, callers rely on the queues being unmapped when it returns.
+ *
+ * dqm->lock mutex has to be locked before calling this function
+ */
+static int execute_queues_cpsch_deferred(struct device_queue_manager *dqm)
+{
+	int batch_us = READ_ONCE(hws_runlist_batch_us);
+
+	if (batch_us <= 0)
+		return execute_queues_cpsch(dqm,
+				KFD_UNMAP_QUEUES_FILTER_DYNAMIC_QUEUES, 0);
+	if (dqm->is_hws_hang)
+		return -EIO;
+
+	if (dqm->runlist_pending) {
+		dqm->runlist_stats.coalesced++;
+		return 0;
+	}
+
+	dqm->runlist_pending = true;
+	dqm->runlist_stats.deferred++;
+	queue_delayed_work(system_highpri_wq, &dqm->runlist_work,
+			   usecs_to_jiffies(batch_us));
+
+	return 0;
+}
+
+static void kfd_process_runlist_work(struct work_struct *work)
+{
+	struct device_queue_manager *dqm = container_of(to_delayed_work(work),
+					struct device_queue_manager, runlist_work);
+	int r;
+
+	dqm_lock(dqm);
+	if (dqm->runlist_pending && dqm->sched_running) {
+		r = execute_queues_cpsch(dqm,
+				KFD_UNMAP_QUEUES_FILTER_DYNAMIC_QUEUES, 0);
+		if (r)
+			pr_err("Failed to execute batched runlist update %d\n", r);
+	}
+	dqm_unlock(dqm);
 }
 
 static int destroy_queue_cpsch(struct device_queue_manager *dqm,
@@ -2119,6 +2188,26 @@ int dqm_debugfs_hqds(struct seq_file *m, void *data)
 	return r;
 }
 
+int dqm_debugfs_runlist_stats(struct seq_file *m,
+			      struct device_queue_manager *dqm)
+{
+	struct dqm_runlist_stats stats;
+
+	dqm_lock(dqm);
+	stats = dqm->runlist_stats;
+	dqm_unlock(dqm);
+
+	seq_printf(m, "  rebuilds:  %llu\n", stats.rebuilds);
+	seq_printf(m, "  deferred:  %llu\n", stats.deferred);
+	seq_printf(m, "  coalesced: %llu\n", stats.coalesced);
+	seq_printf(m, "  avg_us:    %llu\n", stats.rebuilds ?
+		   div64_u64(stats.total_ns, stats.rebuilds * NSEC_PER_USEC) : 0);
+	seq_printf(m, "  max_us:    %llu\n",
+		   div64_u64(stats.max_ns, NSEC_PER_USEC));
+
+	return 0;
+}
+
 int dqm_debugfs_hang_hws(struct device_queue_manager *dqm)
 {
 	int r = 0;
@@ -157,6 +157,25 @@ struct device_queue_manager_asic_ops {
 				 struct kfd_dev *dev);
 };
 
+/**
+ * struct dqm_runlist_stats
+ *
+ * @rebuilds: number of times the runlist was preempted and resubmitted
+ * @deferred: runlist updates that were postponed to the batch worker
+ * @coalesced: deferred updates that were merged into an already pending one
+ * @total_ns: accumulated time spent in preempting and resubmitting
+ * @max_ns: longest single preempt and resubmit
+ *
+ * All fields are protected by the dqm lock.
+ */
+struct dqm_runlist_stats {
+	uint64_t		rebuilds;
+	uint64_t		deferred;
+	uint64_t		coalesced;
+	uint64_t		total_ns;
+	uint64_t		max_ns;
+};
+
 /**
  * struct device_queue_manager
  *
@@ -203,6 +222,11 @@ struct device_queue_manager {
 	struct work_struct	hw_exception_work;
 	struct kfd_mem_obj	hiq_sdma_mqd;
 	bool			sched_running;
+
+	/* batched runlist updates */
+	bool			runlist_pending;
+	struct delayed_work	runlist_work;
+	struct dqm_runlist_stats runlist_stats;
 };
 
 void device_queue_manager_init_cik(
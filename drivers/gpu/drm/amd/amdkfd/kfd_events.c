@@ -28,6 +28,7 @@
 #include <linux/uaccess.h>
 #include <linux/mman.h>
 #include <linux/memory.h>
+#include <linux/eventfd.h>
 #include "kfd_priv.h"
 #include "kfd_events.h"
 #include "kfd_iommu.h"
@@ -116,6 +117,7 @@ static int allocate_event_notification_slot(struct kfd_process *p,
 		return id;
 
 	ev->event_id = id;
+	set_bit(id, p->signal_event_ids);
 	page_slots(p->signal_page)[id] = UNSIGNALED_EVENT_SLOT;
 
 	return 0;
@@ -245,8 +247,13 @@ static void destroy_event(struct kfd_process *p, struct kfd_event *ev)
 	wake_up_all(&ev->wq);
 
 	if (ev->type == KFD_EVENT_TYPE_SIGNAL ||
-	    ev->type == KFD_EVENT_TYPE_DEBUG)
+	    ev->type == KFD_EVENT_TYPE_DEBUG) {
 		p->signal_event_count--;
+		clear_bit(ev->event_id, p->signal_event_ids);
+	}
+
+	if (ev->eventfd)
+		eventfd_ctx_put(ev->eventfd);
 
 	idr_remove(&p->event_idr, ev->event_id);
 	kfree(ev);
@@ -392,14 +399,19 @@ static void set_event(struct kfd_event *ev)
 	/* Auto reset if the list is non-empty and we're waking
 	 * someone. waitqueue_active is safe here because we're
 	 * protected by the p->event_mutex, which is also held when
-	 * updating the wait queues in kfd_wait_on_events.
+	 * updating the wait queues in kfd_wait_on_events. The
+	 * eventfd notification consumes the event as well.
 	 */
-	ev->signaled = !ev->auto_reset || !waitqueue_active(&ev->wq);
+	ev->signaled = !ev->auto_reset ||
+		(!waitqueue_active(&ev->wq) && !ev->eventfd);
 
 	list_for_each_entry(waiter, &ev->wq.head, wait.entry)
 		waiter->activated = true;
 
 	wake_up_all(&ev->wq);
+
+	if (ev->eventfd)
+		eventfd_signal(ev->eventfd, 1);
 }
 
 /* Assumes that p is current. */
@@ -446,6 +458,51 @@ int kfd_reset_event(struct kfd_process *p, uint32_t event_id)
 
 }
 
+/**
+ * kfd_event_set_eventfd - attach an eventfd to an event
+ * @p: process owning the event, assumed to be current
+ * @event_id: ID of the event
+ * @eventfd: file descriptor of the eventfd, or -1 to detach it
+ *
+ * Lets user mode wait for the event in poll, epoll or io_uring loops along
+ * with other file descriptors instead of a dedicated thread blocking in
+ * kfd_wait_on_events(). An event which is already signaled is reported to
+ * the eventfd immediately.
+ */
+int kfd_event_set_eventfd(struct kfd_process *p, uint32_t event_id,
+			  int eventfd)
+{
+	struct eventfd_ctx *ctx = NULL;
+	struct kfd_event *ev;
+	int ret = 0;
+
+	if (eventfd >= 0) {
+		ctx = eventfd_ctx_fdget(eventfd);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	}
+
+	mutex_lock(&p->event_mutex);
+
+	ev = lookup_event_by_id(p, event_id);
+	if (ev) {
+		swap(ev->eventfd, ctx);
+		if (ev->eventfd && ev->signaled) {
+			if (ev->auto_reset)
+				ev->signaled = false;
+			eventfd_signal(ev->eventfd, 1);
+		}
+	} else {
+		ret = -EINVAL;
+	}
+
+	mutex_unlock(&p->event_mutex);
+
+	if (ctx)
+		eventfd_ctx_put(ctx);
+	return ret;
+}
+
 static void acknowledge_signal(struct kfd_process *p, struct kfd_event *ev)
 {
 	page_slots(p->signal_page)[ev->event_id] = UNSIGNALED_EVENT_SLOT;
@@ -495,28 +552,15 @@ void kfd_signal_event_interrupt(u32 pasid, uint32_t partial_id,
 			pr_debug_ratelimited("Partial ID invalid: %u (%u valid bits)\n",
 					     partial_id, valid_id_bits);
 
-		if (p->signal_event_count < KFD_SIGNAL_EVENT_LIMIT / 64) {
-			/* With relatively few events, it's faster to
-			 * iterate over the event IDR
-			 */
-			idr_for_each_entry(&p->event_idr, ev, id) {
-				if (id >= KFD_SIGNAL_EVENT_LIMIT)
-					break;
-
-				if (slots[id] != UNSIGNALED_EVENT_SLOT)
-					set_event_from_interrupt(p, ev);
+		/* Only look at the slots of existing events and lookup
+		 * only signaled events from the IDR.
+		 */
+		for_each_set_bit(id, p->signal_event_ids,
+				 KFD_SIGNAL_EVENT_LIMIT)
+			if (slots[id] != UNSIGNALED_EVENT_SLOT) {
+				ev = lookup_event_by_id(p, id);
+				set_event_from_interrupt(p, ev);
 			}
-		} else {
-			/* With relatively many events, it's faster to
-			 * iterate over the signal slots and lookup
-			 * only signaled events from the IDR.
-			 */
-			for (id = 0; id < KFD_SIGNAL_EVENT_LIMIT; id++)
-				if (slots[id] != UNSIGNALED_EVENT_SLOT) {
-					ev = lookup_event_by_id(p, id);
-					set_event_from_interrupt(p, ev);
-				}
-		}
 	}
 
 	mutex_unlock(&p->event_mutex);
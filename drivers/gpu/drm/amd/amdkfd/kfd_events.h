@@ -49,6 +49,7 @@
 
 struct kfd_event_waiter;
 struct signal_page;
+struct eventfd_ctx;
 
 struct kfd_event {
 	u32 event_id;
@@ -60,6 +61,9 @@ struct kfd_event {
 
 	wait_queue_head_t wq; /* List of event waiters. */
 
+	/* Optional eventfd signaled together with the event */
+	struct eventfd_ctx *eventfd;
+
 	/* Only for signal events. */
 	uint64_t __user *user_signal_address;
 
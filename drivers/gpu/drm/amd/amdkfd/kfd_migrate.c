@@ -32,6 +32,7 @@
 #include "kfd_priv.h"
 #include "kfd_svm.h"
 #include "kfd_migrate.h"
+#include "kfd_smi_events.h"
 
 #ifdef dev_fmt
 #undef dev_fmt
@@ -44,11 +45,23 @@ svm_migrate_direct_mapping_addr(struct amdgpu_device *adev, uint64_t addr)
 	return addr + amdgpu_ttm_domain_start(adev, TTM_PL_VRAM);
 }
 
+/* Pages collected and copied at once by svm_migrate_ram_to_vram() */
+#define SVM_MIGRATE_BATCH_PAGES	(AMDGPU_GTT_MAX_TRANSFER_SIZE * \
+				 AMDGPU_GTT_NUM_MIGRATE_WINDOWS * 4)
+
+/*
+ * The last fence of each migration lane a migration submitted to. The lanes
+ * execute in parallel, so the migration is only done when all of them are.
+ */
+struct svm_migrate_fences {
+	struct dma_fence	*lane[AMDGPU_GTT_NUM_MIGRATE_WINDOWS];
+};
+
 static int
-svm_migrate_gart_map(struct amdgpu_ring *ring, uint64_t npages,
+svm_migrate_gart_map(struct amdgpu_device *adev,
+		     struct amdgpu_migrate_lane *lane, uint64_t npages,
 		     dma_addr_t *addr, uint64_t *gart_addr, uint64_t flags)
 {
-	struct amdgpu_device *adev = ring->adev;
 	struct amdgpu_job *job;
 	unsigned int num_dw, num_bytes;
 	struct dma_fence *fence;
@@ -57,8 +70,10 @@ svm_migrate_gart_map(struct amdgpu_ring *ring, uint64_t npages,
 	void *cpu_addr;
 	int r;
 
-	/* use gart window 0 */
+	/* use the gart window of the lane */
 	*gart_addr = adev->gmc.gart_start;
+	*gart_addr += (u64)lane->window * AMDGPU_GTT_MAX_TRANSFER_SIZE *
+		AMDGPU_GPU_PAGE_SIZE;
 
 	num_dw = ALIGN(adev->mman.buffer_funcs->copy_num_dw, 8);
 	num_bytes = npages * 8;
@@ -72,10 +87,11 @@ svm_migrate_gart_map(struct amdgpu_ring *ring, uint64_t npages,
 	src_addr += job->ibs[0].gpu_addr;
 
 	dst_addr = amdgpu_bo_gpu_offset(adev->gart.bo);
+	dst_addr += lane->window * AMDGPU_GTT_MAX_TRANSFER_SIZE * 8;
 	amdgpu_emit_copy_buffer(adev, &job->ibs[0], src_addr,
 				dst_addr, num_bytes, false);
 
-	amdgpu_ring_pad_ib(ring, &job->ibs[0]);
+	amdgpu_ring_pad_ib(lane->ring, &job->ibs[0]);
 	WARN_ON(job->ibs[0].length_dw > num_dw);
 
 	pte_flags = AMDGPU_PTE_VALID | AMDGPU_PTE_READABLE;
@@ -90,7 +106,7 @@ svm_migrate_gart_map(struct amdgpu_ring *ring, uint64_t npages,
 	if (r)
 		goto error_free;
 
-	r = amdgpu_job_submit(job, &adev->mman.entity,
+	r = amdgpu_job_submit(job, &lane->entity,
 			      AMDGPU_FENCE_OWNER_UNDEFINED, &fence);
 	if (r)
 		goto error_free;
@@ -112,16 +128,20 @@ svm_migrate_gart_map(struct amdgpu_ring *ring, uint64_t npages,
  * @vram: vram destination DMA pointer
  * @npages: number of pages to copy
  * @direction: enum MIGRATION_COPY_DIR
- * @mfence: output, sdma fence to signal after sdma is done
+ * @mfences: in/out, last sdma fence of each migration lane
  *
  * ram address uses GART table continuous entries mapping to ram pages,
  * vram address uses direct mapping of vram pages, which must have npages
  * number of continuous pages.
- * GART update and sdma uses same buf copy function ring, sdma is splited to
- * multiple GTT_MAX_PAGES transfer, all sdma operations are serialized, wait for
- * the last sdma finish fence which is returned to check copy memory is done.
+ * The copy is split into GTT_MAX_PAGES transfers which are distributed
+ * round robin over the migration lanes of the device. Each lane has its own
+ * GART window and scheduler entity, usually on a different SDMA instance, so
+ * the transfers of one migration and concurrent migrations of other processes
+ * run in parallel. The GART update and the copy through the window are kept
+ * together in the lane's queue by the lane lock, which is only held while
+ * submitting.
  *
- * Context: Process context, takes and releases gtt_window_lock
+ * Context: Process context, takes and releases the migration lane locks
  *
  * Return:
  * 0 - OK, otherwise error code
@@ -131,43 +151,54 @@ static int
 svm_migrate_copy_memory_gart(struct amdgpu_device *adev, dma_addr_t *sys,
 			     uint64_t *vram, uint64_t npages,
 			     enum MIGRATION_COPY_DIR direction,
-			     struct dma_fence **mfence)
+			     struct svm_migrate_fences *mfences)
 {
 	const uint64_t GTT_MAX_PAGES = AMDGPU_GTT_MAX_TRANSFER_SIZE;
-	struct amdgpu_ring *ring = adev->mman.buffer_funcs_ring;
+	unsigned int num_lanes = adev->mman.num_migrate_lanes;
+	struct amdgpu_migrate_lane *lane;
 	uint64_t gart_s, gart_d;
 	struct dma_fence *next;
+	unsigned int idx;
 	uint64_t size;
-	int r;
+	int r = 0;
 
-	mutex_lock(&adev->mman.gtt_window_lock);
+	if (!num_lanes)
+		return npages ? -ENODEV : 0;
 
 	while (npages) {
 		size = min(GTT_MAX_PAGES, npages);
+		idx = (unsigned int)atomic_inc_return(&adev->mman.migrate_next) %
+			num_lanes;
+		lane = &adev->mman.migrate[idx];
 
+		mutex_lock(&lane->lock);
 		if (direction == FROM_VRAM_TO_RAM) {
 			gart_s = svm_migrate_direct_mapping_addr(adev, *vram);
-			r = svm_migrate_gart_map(ring, size, sys, &gart_d, 0);
+			r = svm_migrate_gart_map(adev, lane, size, sys, &gart_d,
+						 0);
 
 		} else if (direction == FROM_RAM_TO_VRAM) {
-			r = svm_migrate_gart_map(ring, size, sys, &gart_s,
+			r = svm_migrate_gart_map(adev, lane, size, sys, &gart_s,
 						 KFD_IOCTL_SVM_FLAG_GPU_RO);
 			gart_d = svm_migrate_direct_mapping_addr(adev, *vram);
 		}
 		if (r) {
+			mutex_unlock(&lane->lock);
 			dev_err(adev->dev, "fail %d create gart mapping\n", r);
-			goto out_unlock;
+			return r;
 		}
 
-		r = amdgpu_copy_buffer(ring, gart_s, gart_d, size * PAGE_SIZE,
-				       NULL, &next, false, true, false);
+		r = amdgpu_copy_buffer_entity(&lane->entity, lane->ring,
+					      gart_s, gart_d, size * PAGE_SIZE,
+					      &next, true);
+		mutex_unlock(&lane->lock);
 		if (r) {
 			dev_err(adev->dev, "fail %d to copy memory\n", r);
-			goto out_unlock;
+			return r;
 		}
 
-		dma_fence_put(*mfence);
-		*mfence = next;
+		dma_fence_put(mfences->lane[idx]);
+		mfences->lane[idx] = next;
 		npages -= size;
 		if (npages) {
 			sys += size;
@@ -175,9 +206,6 @@ svm_migrate_copy_memory_gart(struct amdgpu_device *adev, dma_addr_t *sys,
 		}
 	}
 
-out_unlock:
-	mutex_unlock(&adev->mman.gtt_window_lock);
-
 	return r;
 }
 
@@ -185,10 +213,10 @@ svm_migrate_copy_memory_gart(struct amdgpu_device *adev, dma_addr_t *sys,
  * svm_migrate_copy_done - wait for memory copy sdma is done
  *
  * @adev: amdgpu device the sdma memory copy is executing on
- * @mfence: migrate fence
+ * @mfences: migrate fences
  *
- * Wait for dma fence is signaled, if the copy ssplit into multiple sdma
- * operations, this is the last sdma operation fence.
+ * Wait for the last fence of every migration lane the copy was submitted to
+ * and drop them.
  *
  * Context: called after svm_migrate_copy_memory
  *
@@ -197,15 +225,26 @@ svm_migrate_copy_memory_gart(struct amdgpu_device *adev, dma_addr_t *sys,
  * otherwise	- error code from dma fence signal
  */
 static int
-svm_migrate_copy_done(struct amdgpu_device *adev, struct dma_fence *mfence)
+svm_migrate_copy_done(struct amdgpu_device *adev,
+		      struct svm_migrate_fences *mfences)
 {
+	unsigned int i;
 	int r = 0;
 
-	if (mfence) {
-		r = dma_fence_wait(mfence, false);
+	for (i = 0; i < ARRAY_SIZE(mfences->lane); ++i) {
+		struct dma_fence *mfence = mfences->lane[i];
+		long t;
+
+		if (!mfence)
+			continue;
+
+		t = dma_fence_wait(mfence, false);
 		dma_fence_put(mfence);
-		pr_debug("sdma copy memory fence done\n");
+		mfences->lane[i] = NULL;
+		if (t && !r)
+			r = t;
 	}
+	pr_debug("sdma copy memory fences done\n");
 
 	return r;
 }
@@ -296,8 +335,8 @@ static unsigned long svm_migrate_unsuccessful_pages(struct migrate_vma *migrate)
 
 static int
 svm_migrate_copy_to_vram(struct amdgpu_device *adev, struct svm_range *prange,
-			 struct migrate_vma *migrate, struct dma_fence **mfence,
-			 dma_addr_t *scratch)
+			 struct migrate_vma *migrate,
+			 struct svm_migrate_fences *mfence, dma_addr_t *scratch)
 {
 	uint64_t npages = migrate->cpages;
 	struct device *dev = adev->dev;
@@ -319,7 +358,9 @@ svm_migrate_copy_to_vram(struct amdgpu_device *adev, struct svm_range *prange,
 		goto out;
 	}
 
-	amdgpu_res_first(prange->ttm_res, prange->offset << PAGE_SHIFT,
+	amdgpu_res_first(prange->ttm_res,
+			 ((migrate->start >> PAGE_SHIFT) - prange->start +
+			  prange->offset) << PAGE_SHIFT,
 			 npages << PAGE_SHIFT, &cursor);
 	for (i = j = 0; i < npages; i++) {
 		struct page *spage;
@@ -401,46 +442,61 @@ svm_migrate_copy_to_vram(struct amdgpu_device *adev, struct svm_range *prange,
 	return r;
 }
 
-static long
-svm_migrate_vma_to_vram(struct amdgpu_device *adev, struct svm_range *prange,
-			struct vm_area_struct *vma, uint64_t start,
-			uint64_t end)
+/*
+ * State of a batch of pages migrated to VRAM, kept between submitting the
+ * copies and completing the migration so that collecting the next batch
+ * overlaps with the copies of the previous one.
+ */
+struct svm_migrate_batch {
+	struct migrate_vma		migrate;
+	struct svm_migrate_fences	mfences;
+	dma_addr_t			*scratch;
+	void				*buf;
+	uint64_t			npages;
+	unsigned long			cpages;
+	int				r;
+};
+
+static void
+svm_migrate_vma_to_vram_submit(struct amdgpu_device *adev,
+			       struct svm_range *prange,
+			       struct vm_area_struct *vma, uint64_t start,
+			       uint64_t end, struct svm_migrate_batch *batch)
 {
+	struct migrate_vma *migrate = &batch->migrate;
 	uint64_t npages = (end - start) >> PAGE_SHIFT;
-	struct kfd_process_device *pdd;
-	struct dma_fence *mfence = NULL;
-	struct migrate_vma migrate;
-	unsigned long cpages = 0;
-	dma_addr_t *scratch;
+	unsigned long cpages;
 	size_t size;
-	void *buf;
-	int r = -ENOMEM;
+	int r;
 
-	memset(&migrate, 0, sizeof(migrate));
-	migrate.vma = vma;
-	migrate.start = start;
-	migrate.end = end;
-	migrate.flags = MIGRATE_VMA_SELECT_SYSTEM;
-	migrate.pgmap_owner = SVM_ADEV_PGMAP_OWNER(adev);
+	memset(batch, 0, sizeof(*batch));
+	batch->npages = npages;
+	migrate->vma = vma;
+	migrate->start = start;
+	migrate->end = end;
+	migrate->flags = MIGRATE_VMA_SELECT_SYSTEM;
+	migrate->pgmap_owner = SVM_ADEV_PGMAP_OWNER(adev);
 
-	size = 2 * sizeof(*migrate.src) + sizeof(uint64_t) + sizeof(dma_addr_t);
+	size = 2 * sizeof(*migrate->src) + sizeof(uint64_t) + sizeof(dma_addr_t);
 	size *= npages;
-	buf = kvmalloc(size, GFP_KERNEL | __GFP_ZERO);
-	if (!buf)
-		goto out;
+	batch->buf = kvmalloc(size, GFP_KERNEL | __GFP_ZERO);
+	if (!batch->buf) {
+		batch->r = -ENOMEM;
+		return;
+	}
 
-	migrate.src = buf;
-	migrate.dst = migrate.src + npages;
-	scratch = (dma_addr_t *)(migrate.dst + npages);
+	migrate->src = batch->buf;
+	migrate->dst = migrate->src + npages;
+	batch->scratch = (dma_addr_t *)(migrate->dst + npages);
 
-	r = migrate_vma_setup(&migrate);
+	r = migrate_vma_setup(migrate);
 	if (r) {
 		dev_err(adev->dev, "vma setup fail %d range [0x%lx 0x%lx]\n", r,
 			prange->start, prange->last);
 		goto out_free;
 	}
 
-	cpages = migrate.cpages;
+	cpages = migrate->cpages;
 	if (!cpages) {
 		pr_debug("failed collect migrate sys pages [0x%lx 0x%lx]\n",
 			 prange->start, prange->last);
@@ -452,29 +508,47 @@ svm_migrate_vma_to_vram(struct amdgpu_device *adev, struct svm_range *prange,
 	else
 		pr_debug("0x%lx pages migrated\n", cpages);
 
-	r = svm_migrate_copy_to_vram(adev, prange, &migrate, &mfence, scratch);
-	migrate_vma_pages(&migrate);
+	batch->cpages = cpages;
+	batch->r = svm_migrate_copy_to_vram(adev, prange, migrate,
+					    &batch->mfences, batch->scratch);
+	migrate_vma_pages(migrate);
 
 	pr_debug("successful/cpages/npages 0x%lx/0x%lx/0x%lx\n",
-		svm_migrate_successful_pages(&migrate), cpages, migrate.npages);
+		svm_migrate_successful_pages(migrate), cpages, migrate->npages);
+	return;
 
-	svm_migrate_copy_done(adev, mfence);
-	migrate_vma_finalize(&migrate);
+out_free:
+	kvfree(batch->buf);
+	batch->buf = NULL;
+	batch->r = r;
+}
 
-	svm_range_dma_unmap(adev->dev, scratch, 0, npages);
-	svm_range_free_dma_mappings(prange);
+static long
+svm_migrate_vma_to_vram_complete(struct amdgpu_device *adev,
+				 struct svm_range *prange,
+				 struct svm_migrate_batch *batch)
+{
+	struct kfd_process_device *pdd;
 
-out_free:
-	kvfree(buf);
-out:
-	if (!r && cpages) {
+	if (batch->buf) {
+		svm_migrate_copy_done(adev, &batch->mfences);
+		migrate_vma_finalize(&batch->migrate);
+
+		svm_range_dma_unmap(adev->dev, batch->scratch, 0,
+				    batch->npages);
+		svm_range_free_dma_mappings(prange);
+		kvfree(batch->buf);
+		batch->buf = NULL;
+	}
+
+	if (!batch->r && batch->cpages) {
 		pdd = svm_range_get_pdd_by_adev(prange, adev);
 		if (pdd)
-			WRITE_ONCE(pdd->page_in, pdd->page_in + cpages);
+			WRITE_ONCE(pdd->page_in, pdd->page_in + batch->cpages);
 
-		return cpages;
+		return batch->cpages;
 	}
-	return r;
+	return batch->r;
 }
 
 /**
@@ -493,9 +567,14 @@ svm_migrate_ram_to_vram(struct svm_range *prange, uint32_t best_loc,
 			struct mm_struct *mm)
 {
 	unsigned long addr, start, end;
+	struct svm_migrate_batch batch[2];
 	struct vm_area_struct *vma;
 	struct amdgpu_device *adev;
 	unsigned long cpages = 0;
+	bool pending = false;
+	unsigned int cur = 0;
+	struct kfd_process *p;
+	uint64_t timestamp;
 	long r = 0;
 
 	if (prange->actual_loc == best_loc) {
@@ -513,30 +592,67 @@ svm_migrate_ram_to_vram(struct svm_range *prange, uint32_t best_loc,
 	pr_debug("svms 0x%p [0x%lx 0x%lx] to gpu 0x%x\n", prange->svms,
 		 prange->start, prange->last, best_loc);
 
+	p = container_of(prange->svms, struct kfd_process, svms);
+	timestamp = ktime_get_boottime_ns();
+	kfd_smi_event_migration_start(adev->kfd.dev, p->lead_thread->pid,
+				      prange->start, prange->last, 0,
+				      best_loc);
+
 	/* FIXME: workaround for page locking bug with invalid pages */
 	svm_range_prefault(prange, mm, SVM_ADEV_PGMAP_OWNER(adev));
 
 	start = prange->start << PAGE_SHIFT;
 	end = (prange->last + 1) << PAGE_SHIFT;
 
+	/*
+	 * Collect the pages of the next batch while the copies of the
+	 * previous one are still running.
+	 */
 	for (addr = start; addr < end;) {
 		unsigned long next;
+		long t;
 
 		vma = find_vma(mm, addr);
 		if (!vma || addr < vma->vm_start)
 			break;
 
-		next = min(vma->vm_end, end);
-		r = svm_migrate_vma_to_vram(adev, prange, vma, addr, next);
-		if (r < 0) {
-			pr_debug("failed %ld to migrate\n", r);
-			break;
-		} else {
-			cpages += r;
+		next = min3(vma->vm_end, end,
+			    addr + SVM_MIGRATE_BATCH_PAGES * PAGE_SIZE);
+		svm_migrate_vma_to_vram_submit(adev, prange, vma, addr, next,
+					       &batch[cur]);
+		if (pending) {
+			t = svm_migrate_vma_to_vram_complete(adev, prange,
+							     &batch[cur ^ 1]);
+			if (t < 0)
+				r = t;
+			else
+				cpages += t;
 		}
+		pending = true;
+		cur ^= 1;
+
+		if (r < 0 || batch[cur ^ 1].r < 0)
+			break;
 		addr = next;
 	}
 
+	if (pending) {
+		long t = svm_migrate_vma_to_vram_complete(adev, prange,
+							  &batch[cur ^ 1]);
+
+		if (t < 0 && r >= 0)
+			r = t;
+		else if (t > 0)
+			cpages += t;
+	}
+	if (r < 0)
+		pr_debug("failed %ld to migrate\n", r);
+
+	kfd_smi_event_migration_end(adev->kfd.dev, p->lead_thread->pid,
+				    prange->start, prange->last, 0, best_loc,
+				    (uint64_t)cpages << PAGE_SHIFT,
+				    ktime_get_boottime_ns() - timestamp);
+
 	if (cpages)
 		prange->actual_loc = best_loc;
 
@@ -555,7 +671,8 @@ static void svm_migrate_page_free(struct page *page)
 
 static int
 svm_migrate_copy_to_ram(struct amdgpu_device *adev, struct svm_range *prange,
-			struct migrate_vma *migrate, struct dma_fence **mfence,
+			struct migrate_vma *migrate,
+			struct svm_migrate_fences *mfence,
 			dma_addr_t *scratch, uint64_t npages)
 {
 	struct device *dev = adev->dev;
@@ -569,7 +686,7 @@ svm_migrate_copy_to_ram(struct amdgpu_device *adev, struct svm_range *prange,
 	pr_debug("svms 0x%p [0x%lx 0x%lx]\n", prange->svms, prange->start,
 		 prange->last);
 
-	addr = prange->start << PAGE_SHIFT;
+	addr = migrate->start;
 
 	src = (uint64_t *)(scratch + npages);
 	dst = scratch;
@@ -648,7 +765,7 @@ svm_migrate_vma_to_ram(struct amdgpu_device *adev, struct svm_range *prange,
 	unsigned long upages = npages;
 	unsigned long cpages = 0;
 	struct kfd_process_device *pdd;
-	struct dma_fence *mfence = NULL;
+	struct svm_migrate_fences mfences = {};
 	struct migrate_vma migrate;
 	dma_addr_t *scratch;
 	size_t size;
@@ -692,7 +809,7 @@ svm_migrate_vma_to_ram(struct amdgpu_device *adev, struct svm_range *prange,
 	else
 		pr_debug("0x%lx pages migrated\n", cpages);
 
-	r = svm_migrate_copy_to_ram(adev, prange, &migrate, &mfence,
+	r = svm_migrate_copy_to_ram(adev, prange, &migrate, &mfences,
 				    scratch, npages);
 	migrate_vma_pages(&migrate);
 
@@ -700,7 +817,7 @@ svm_migrate_vma_to_ram(struct amdgpu_device *adev, struct svm_range *prange,
 	pr_debug("unsuccessful/cpages/npages 0x%lx/0x%lx/0x%lx\n",
 		 upages, cpages, migrate.npages);
 
-	svm_migrate_copy_done(adev, mfence);
+	svm_migrate_copy_done(adev, &mfences);
 	migrate_vma_finalize(&migrate);
 	svm_range_dma_unmap(adev->dev, scratch, 0, npages);
 
@@ -735,6 +852,8 @@ int svm_migrate_vram_to_ram(struct svm_range *prange, struct mm_struct *mm)
 	unsigned long start;
 	unsigned long end;
 	unsigned long upages = 0;
+	struct kfd_process *p;
+	uint64_t timestamp;
 	long r = 0;
 
 	if (!prange->actual_loc) {
@@ -754,6 +873,12 @@ int svm_migrate_vram_to_ram(struct svm_range *prange, struct mm_struct *mm)
 		 prange->svms, prange, prange->start, prange->last,
 		 prange->actual_loc);
 
+	p = container_of(prange->svms, struct kfd_process, svms);
+	timestamp = ktime_get_boottime_ns();
+	kfd_smi_event_migration_start(adev->kfd.dev, p->lead_thread->pid,
+				      prange->start, prange->last,
+				      prange->actual_loc, 0);
+
 	start = prange->start << PAGE_SHIFT;
 	end = (prange->last + 1) << PAGE_SHIFT;
 
@@ -775,6 +900,13 @@ int svm_migrate_vram_to_ram(struct svm_range *prange, struct mm_struct *mm)
 		addr = next;
 	}
 
+	kfd_smi_event_migration_end(adev->kfd.dev, p->lead_thread->pid,
+				    prange->start, prange->last,
+				    prange->actual_loc, 0,
+				    (uint64_t)(prange->npages - upages) <<
+				    PAGE_SHIFT,
+				    ktime_get_boottime_ns() - timestamp);
+
 	if (!upages) {
 		svm_range_vram_node_free(prange);
 		prange->actual_loc = 0;
@@ -921,6 +1053,118 @@ static vm_fault_t svm_migrate_to_ram(struct vm_fault *vmf)
 	return r ? VM_FAULT_SIGBUS : 0;
 }
 
+/* Size of the copies used to measure the system memory link bandwidth */
+#define SVM_MIGRATE_CALIBRATE_PAGES	512
+
+static int
+svm_migrate_time_copy(struct amdgpu_device *adev, dma_addr_t *sys,
+		      uint64_t *vram, uint64_t npages,
+		      enum MIGRATION_COPY_DIR direction, uint64_t *ns)
+{
+	struct svm_migrate_fences mfences = {};
+	uint64_t start;
+	int r;
+
+	start = ktime_get_ns();
+	r = svm_migrate_copy_memory_gart(adev, sys, vram, npages, direction,
+					 &mfences);
+	r = svm_migrate_copy_done(adev, &mfences) ?: r;
+	*ns = max_t(uint64_t, ktime_get_ns() - start, 1);
+
+	return r;
+}
+
+/**
+ * svm_migrate_calibrate - measure the system memory link of a GPU
+ * @adev: amdgpu device to measure
+ * @perf: returns the bandwidth in MB/s and the latency in ns
+ *
+ * Copies SVM_MIGRATE_CALIBRATE_PAGES pages between system memory and VRAM in
+ * each direction with the SDMA migration lanes to measure the bandwidth,
+ * then a single page to measure the latency of a copy, including the
+ * submission overhead.
+ *
+ * Return: 0 on success, negative errno otherwise
+ */
+int svm_migrate_calibrate(struct amdgpu_device *adev,
+			  struct svm_migrate_link_perf *perf)
+{
+	const uint64_t npages = SVM_MIGRATE_CALIBRATE_PAGES;
+	const uint64_t bytes = npages << PAGE_SHIFT;
+	struct amdgpu_bo *bo = NULL;
+	struct page **pages;
+	dma_addr_t *sys;
+	uint64_t *vram;
+	uint64_t offset, ns;
+	void *buf;
+	uint64_t i;
+	int r;
+
+	if (!adev->mman.num_migrate_lanes)
+		return -ENODEV;
+
+	buf = kvcalloc(npages, sizeof(*pages) + sizeof(*sys) + sizeof(*vram),
+		       GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	pages = buf;
+	sys = (dma_addr_t *)(pages + npages);
+	vram = (uint64_t *)(sys + npages);
+
+	r = amdgpu_bo_create_kernel(adev, bytes, PAGE_SIZE,
+				    AMDGPU_GEM_DOMAIN_VRAM, &bo, NULL, NULL);
+	if (r)
+		goto out_free;
+	offset = amdgpu_bo_gpu_offset(bo) - adev->gmc.vram_start;
+
+	for (i = 0; i < npages; i++) {
+		pages[i] = alloc_page(GFP_KERNEL);
+		if (!pages[i]) {
+			r = -ENOMEM;
+			goto out_unmap;
+		}
+		sys[i] = dma_map_page(adev->dev, pages[i], 0, PAGE_SIZE,
+				      DMA_BIDIRECTIONAL);
+		if (dma_mapping_error(adev->dev, sys[i])) {
+			__free_page(pages[i]);
+			pages[i] = NULL;
+			r = -EFAULT;
+			goto out_unmap;
+		}
+		vram[i] = offset + (i << PAGE_SHIFT);
+	}
+
+	r = svm_migrate_time_copy(adev, sys, vram, npages, FROM_RAM_TO_VRAM,
+				  &ns);
+	if (r)
+		goto out_unmap;
+	perf->h2d_bandwidth = div64_u64(bytes * 1000, ns);
+
+	r = svm_migrate_time_copy(adev, sys, vram, npages, FROM_VRAM_TO_RAM,
+				  &ns);
+	if (r)
+		goto out_unmap;
+	perf->d2h_bandwidth = div64_u64(bytes * 1000, ns);
+
+	r = svm_migrate_time_copy(adev, sys, vram, 1, FROM_RAM_TO_VRAM, &ns);
+	if (r)
+		goto out_unmap;
+	perf->latency = min_t(uint64_t, ns, U32_MAX);
+
+	dev_dbg(adev->dev, "system memory link %u/%u MB/s, %u ns\n",
+		perf->h2d_bandwidth, perf->d2h_bandwidth, perf->latency);
+
+out_unmap:
+	for (i = 0; i < npages && pages[i]; i++) {
+		dma_unmap_page(adev->dev, sys[i], PAGE_SIZE, DMA_BIDIRECTIONAL);
+		__free_page(pages[i]);
+	}
+	amdgpu_bo_free_kernel(&bo, NULL, NULL);
+out_free:
+	kvfree(buf);
+	return r;
+}
+
 static const struct dev_pagemap_ops svm_migrate_pgmap_ops = {
 	.page_free		= svm_migrate_page_free,
 	.migrate_to_ram		= svm_migrate_to_ram,
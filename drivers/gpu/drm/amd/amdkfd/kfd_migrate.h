@@ -25,6 +25,15 @@
 #ifndef KFD_MIGRATE_H_
 #define KFD_MIGRATE_H_
 
+#include <linux/types.h>
+
+/* Measured performance of the link between a GPU and system memory */
+struct svm_migrate_link_perf {
+	uint32_t	h2d_bandwidth;	/* MB/s, system memory to VRAM */
+	uint32_t	d2h_bandwidth;	/* MB/s, VRAM to system memory */
+	uint32_t	latency;	/* ns */
+};
+
 #if IS_ENABLED(CONFIG_HSA_AMD_SVM)
 
 #include <linux/rwsem.h>
@@ -47,6 +56,8 @@ unsigned long
 svm_migrate_addr_to_pfn(struct amdgpu_device *adev, unsigned long addr);
 
 int svm_migrate_init(struct amdgpu_device *adev);
+int svm_migrate_calibrate(struct amdgpu_device *adev,
+			  struct svm_migrate_link_perf *perf);
 
 #else
 
@@ -55,6 +66,12 @@ static inline int svm_migrate_init(struct amdgpu_device *adev)
 	return 0;
 }
 
+static inline int svm_migrate_calibrate(struct amdgpu_device *adev,
+					struct svm_migrate_link_perf *perf)
+{
+	return -ENODEV;
+}
+
 #endif /* IS_ENABLED(CONFIG_HSA_AMD_SVM) */
 
 #endif /* KFD_MIGRATE_H_ */
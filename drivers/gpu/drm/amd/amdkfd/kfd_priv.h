@@ -178,6 +178,13 @@ extern int amdgpu_no_queue_eviction_on_vm_fault;
 /* Enable eviction debug messages */
 extern bool debug_evictions;
 
+/* XGMI link limits for mapping SVM ranges from peer VRAM */
+extern int svm_xgmi_max_hops;
+extern int svm_xgmi_min_links;
+
+/* Window in us for coalescing HWS runlist updates, 0 to disable */
+extern int hws_runlist_batch_us;
+
 enum cache_policy {
 	cache_policy_coherent,
 	cache_policy_noncoherent
@@ -636,8 +643,13 @@ struct qcm_process_device {
 
 /* KFD Memory Eviction */
 
-/* Approx. wait time before attempting to restore evicted BOs */
+/* Approx. wait time before attempting to restore evicted BOs. Restore
+ * starts after PROCESS_RESTORE_MIN_TIME_MS and backs off up to
+ * PROCESS_RESTORE_TIME_MS while the process keeps getting evicted again
+ * shortly after being restored.
+ */
 #define PROCESS_RESTORE_TIME_MS 100
+#define PROCESS_RESTORE_MIN_TIME_MS 1
 /* Approx. back off time if restore fails due to lack of memory */
 #define PROCESS_BACK_OFF_TIME_MS 100
 /* Approx. time before evicting the process again */
@@ -716,7 +728,9 @@ struct kfd_process_device {
 	/* Eviction activity tracking */
 	uint64_t last_evict_timestamp;
 	atomic64_t evict_duration_counter;
+	atomic64_t evict_count;
 	struct attribute attr_evict;
+	struct attribute attr_evict_count;
 
 	struct kobject *kobj_stats;
 	unsigned int doorbell_index;
@@ -758,9 +772,20 @@ struct kfd_process_device {
 
 #define qpd_to_pdd(x) container_of(x, struct kfd_process_device, qpd)
 
+/* Tunables of the SVM migration policy, see svm_range_policy_fault() */
+struct svm_range_policy {
+	bool				enable;
+	uint32_t			window_ms;
+	uint32_t			thrash_threshold;
+	uint32_t			pin_ms;
+	uint32_t			prefetch_granules;
+};
+
 struct svm_range_list {
 	struct mutex			lock;
 	struct rb_root_cached		objects;
+	/* lets the fault handler look up objects without the lock */
+	seqcount_t			objects_seq;
 	struct list_head		list;
 	struct work_struct		deferred_list_work;
 	struct list_head		deferred_range_list;
@@ -769,7 +794,14 @@ struct svm_range_list {
 	atomic_t			drain_pagefaults;
 	struct delayed_work		restore_work;
 	DECLARE_BITMAP(bitmap_supported, MAX_GPU_INSTANCE);
+	/* GPUs unmapped from by the notifier, waiting for a TLB flush */
+	DECLARE_BITMAP(tlb_flush_pending, MAX_GPU_INSTANCE);
+	struct mutex			tlb_flush_lock;
 	struct task_struct 		*faulting_task;
+	struct svm_range_policy		policy;
+	/* range of the previous GPU fault, used to detect fault streams */
+	unsigned long			last_fault_start;
+	unsigned long			last_fault_last;
 };
 
 /* Process data */
@@ -828,6 +860,8 @@ struct kfd_process {
 	size_t signal_mapped_size;
 	size_t signal_event_count;
 	bool signal_event_limit_reached;
+	/* IDs of the events owning a signal slot */
+	DECLARE_BITMAP(signal_event_ids, KFD_SIGNAL_EVENT_LIMIT);
 
 	/* Information used for memory eviction */
 	void *kgd_process_info;
@@ -846,6 +880,8 @@ struct kfd_process {
 	 * restored after an eviction
 	 */
 	unsigned long last_restore_timestamp;
+	/* Current delay before restoring after an eviction */
+	unsigned int restore_delay_ms;
 
 	/* Kobj for our procfs */
 	struct kobject *kobj;
@@ -988,6 +1024,8 @@ struct kfd_dev *kfd_device_by_id(uint32_t gpu_id);
 struct kfd_dev *kfd_device_by_pci_dev(const struct pci_dev *pdev);
 struct kfd_dev *kfd_device_by_adev(const struct amdgpu_device *adev);
 int kfd_topology_enum_kfd_devices(uint8_t idx, struct kfd_dev **kdev);
+int kfd_topology_link_perf(struct kfd_dev *from, struct kfd_dev *to,
+			   uint32_t *bandwidth, uint32_t *latency);
 int kfd_numa_node_to_apic_id(int numa_node_id);
 void kfd_double_confirm_iommu_support(struct kfd_dev *gpu);
 
@@ -1160,6 +1198,8 @@ void kfd_signal_iommu_event(struct kfd_dev *dev,
 void kfd_signal_hw_exception_event(u32 pasid);
 int kfd_set_event(struct kfd_process *p, uint32_t event_id);
 int kfd_reset_event(struct kfd_process *p, uint32_t event_id);
+int kfd_event_set_eventfd(struct kfd_process *p, uint32_t event_id,
+			  int eventfd);
 int kfd_event_page_set(struct kfd_process *p, void *kernel_address,
 		       uint64_t size);
 int kfd_event_create(struct file *devkfd, struct kfd_process *p,
@@ -1211,6 +1251,9 @@ int kfd_debugfs_hqds_by_device(struct seq_file *m, void *data);
 int dqm_debugfs_hqds(struct seq_file *m, void *data);
 int kfd_debugfs_rls_by_device(struct seq_file *m, void *data);
 int pm_debugfs_runlist(struct seq_file *m, void *data);
+int kfd_debugfs_runlist_stats_by_device(struct seq_file *m, void *data);
+int dqm_debugfs_runlist_stats(struct seq_file *m,
+			      struct device_queue_manager *dqm);
 
 int kfd_debugfs_hang_hws(struct kfd_dev *dev);
 int pm_debugfs_hang_hws(struct packet_manager *pm);
@@ -43,6 +43,7 @@ struct mm_struct;
 #include "kfd_dbgmgr.h"
 #include "kfd_iommu.h"
 #include "kfd_svm.h"
+#include "kfd_smi_events.h"
 
 /*
  * List of struct kfd_process (field kfd_process).
@@ -407,6 +408,14 @@ static ssize_t kfd_procfs_stats_show(struct kobject *kobj,
 				"%llu\n",
 				jiffies64_to_msecs(evict_jiffies));
 
+	} else if (strcmp(attr->name, "evictions") == 0) {
+		struct kfd_process_device *pdd = container_of(attr,
+				struct kfd_process_device,
+				attr_evict_count);
+
+		return sysfs_emit(buffer, "%llu\n",
+				  atomic64_read(&pdd->evict_count));
+
 	/* Sysfs handle that gets CU occupancy is per device */
 	} else if (strcmp(attr->name, "cu_occupancy") == 0) {
 		return kfd_get_cu_occupancy(attr, buffer);
@@ -544,6 +553,7 @@ static void kfd_procfs_add_sysfs_stats(struct kfd_process *p)
 	 * Create sysfs files for each GPU:
 	 * - proc/<pid>/stats_<gpuid>/
 	 * - proc/<pid>/stats_<gpuid>/evicted_ms
+	 * - proc/<pid>/stats_<gpuid>/evictions
 	 * - proc/<pid>/stats_<gpuid>/cu_occupancy
 	 */
 	for (i = 0; i < p->n_pdds; i++) {
@@ -570,6 +580,8 @@ static void kfd_procfs_add_sysfs_stats(struct kfd_process *p)
 
 		kfd_sysfs_create_file(pdd->kobj_stats, &pdd->attr_evict,
 				      "evicted_ms");
+		kfd_sysfs_create_file(pdd->kobj_stats, &pdd->attr_evict_count,
+				      "evictions");
 		/* Add sysfs file to report compute unit occupancy */
 		if (pdd->dev->kfd2kgd->get_cu_occupancy)
 			kfd_sysfs_create_file(pdd->kobj_stats,
@@ -1052,6 +1064,7 @@ static void kfd_process_remove_sysfs(struct kfd_process *p)
 		sysfs_remove_file(p->kobj, &pdd->attr_sdma);
 
 		sysfs_remove_file(pdd->kobj_stats, &pdd->attr_evict);
+		sysfs_remove_file(pdd->kobj_stats, &pdd->attr_evict_count);
 		if (pdd->dev->kfd2kgd->get_cu_occupancy)
 			sysfs_remove_file(pdd->kobj_stats,
 					  &pdd->attr_cu_occupancy);
@@ -1363,6 +1376,7 @@ static struct kfd_process *create_process(const struct task_struct *thread)
 	INIT_DELAYED_WORK(&process->eviction_work, evict_process_worker);
 	INIT_DELAYED_WORK(&process->restore_work, restore_process_worker);
 	process->last_restore_timestamp = get_jiffies_64();
+	process->restore_delay_ms = PROCESS_RESTORE_MIN_TIME_MS;
 	kfd_event_init_process(process);
 	process->is_32bit_user_mode = in_compat_syscall();
 
@@ -1502,6 +1516,7 @@ struct kfd_process_device *kfd_create_process_device_data(struct kfd_dev *dev,
 	pdd->vram_usage = 0;
 	pdd->sdma_past_activity_counter = 0;
 	atomic64_set(&pdd->evict_duration_counter, 0);
+	atomic64_set(&pdd->evict_count, 0);
 	p->pdds[p->n_pdds++] = pdd;
 
 	/* Init idr used for memory handle translation */
@@ -1722,6 +1737,9 @@ int kfd_process_evict_queues(struct kfd_process *p)
 			goto fail;
 		}
 		n_evicted++;
+
+		kfd_smi_event_queue_eviction(pdd->dev, p->lead_thread->pid,
+					     false);
 	}
 
 	return r;
@@ -1760,7 +1778,11 @@ int kfd_process_restore_queues(struct kfd_process *p)
 			pr_err("Failed to restore process queues\n");
 			if (!ret)
 				ret = r;
+			continue;
 		}
+
+		kfd_smi_event_queue_eviction(pdd->dev, p->lead_thread->pid,
+					     true);
 	}
 
 	return ret;
@@ -1791,6 +1813,25 @@ kfd_process_gpuid_from_adev(struct kfd_process *p, struct amdgpu_device *adev,
 	return -EINVAL;
 }
 
+/* Restore quickly after an isolated eviction, the restore worker waits for
+ * the evicted BOs to be moved when it reserves them anyway. Back off
+ * exponentially while the process is evicted again right after a restore to
+ * avoid thrashing with the memory user that caused the eviction.
+ */
+static unsigned long kfd_process_restore_delay(struct kfd_process *p)
+{
+	unsigned long since_restore = get_jiffies_64() - p->last_restore_timestamp;
+
+	if (since_restore < msecs_to_jiffies(PROCESS_RESTORE_TIME_MS))
+		p->restore_delay_ms = min_t(unsigned int,
+					    p->restore_delay_ms * 2,
+					    PROCESS_RESTORE_TIME_MS);
+	else
+		p->restore_delay_ms = PROCESS_RESTORE_MIN_TIME_MS;
+
+	return msecs_to_jiffies(p->restore_delay_ms);
+}
+
 static void evict_process_worker(struct work_struct *work)
 {
 	int ret;
@@ -1821,7 +1862,7 @@ static void evict_process_worker(struct work_struct *work)
 		dma_fence_put(p->ef);
 		p->ef = NULL;
 		queue_delayed_work(kfd_restore_wq, &p->restore_work,
-				msecs_to_jiffies(PROCESS_RESTORE_TIME_MS));
+				   kfd_process_restore_delay(p));
 
 		pr_debug("Finished evicting pasid 0x%x\n", p->pasid);
 	} else
@@ -23,6 +23,8 @@
 #include <linux/poll.h>
 #include <linux/wait.h>
 #include <linux/anon_inodes.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include <uapi/linux/kfd_ioctl.h>
 #include "amdgpu.h"
 #include "amdgpu_vm.h"
@@ -37,14 +39,20 @@ struct kfd_smi_client {
 	uint64_t events;
 	struct kfd_dev *dev;
 	spinlock_t lock;
+	/* optional ring buffer mapped by the client, protected by lock */
+	struct kfd_smi_ring_header *ring;
+	uint32_t ring_size;
+	uint64_t ring_head;
 };
 
 #define MAX_KFIFO_SIZE	1024
+#define MAX_RING_SIZE	(4 << 20)
 
 static __poll_t kfd_smi_ev_poll(struct file *, struct poll_table_struct *);
 static ssize_t kfd_smi_ev_read(struct file *, char __user *, size_t, loff_t *);
 static ssize_t kfd_smi_ev_write(struct file *, const char __user *, size_t,
 				loff_t *);
+static int kfd_smi_ev_mmap(struct file *, struct vm_area_struct *);
 static int kfd_smi_ev_release(struct inode *, struct file *);
 
 static const char kfd_smi_name[] = "kfd_smi_ev";
@@ -54,6 +62,7 @@ static const struct file_operations kfd_smi_ev_fops = {
 	.poll = kfd_smi_ev_poll,
 	.read = kfd_smi_ev_read,
 	.write = kfd_smi_ev_write,
+	.mmap = kfd_smi_ev_mmap,
 	.release = kfd_smi_ev_release
 };
 
@@ -66,8 +75,12 @@ static __poll_t kfd_smi_ev_poll(struct file *filep,
 	poll_wait(filep, &client->wait_queue, wait);
 
 	spin_lock(&client->lock);
-	if (!kfifo_is_empty(&client->fifo))
+	if (client->ring) {
+		if (client->ring_head != READ_ONCE(client->ring->tail))
+			mask = EPOLLIN | EPOLLRDNORM;
+	} else if (!kfifo_is_empty(&client->fifo)) {
 		mask = EPOLLIN | EPOLLRDNORM;
+	}
 	spin_unlock(&client->lock);
 
 	return mask;
@@ -95,7 +108,7 @@ static ssize_t kfd_smi_ev_read(struct file *filep, char __user *user,
 		ret = -EAGAIN;
 		goto ret_err;
 	}
-	to_copy = min3(size, sizeof(buf), to_copy);
+	to_copy = min3(size, (size_t)MAX_KFIFO_SIZE, to_copy);
 	ret = kfifo_out(&client->fifo, buf, to_copy);
 	spin_unlock(&client->lock);
 	if (ret <= 0) {
@@ -133,6 +146,53 @@ static ssize_t kfd_smi_ev_write(struct file *filep, const char __user *user,
 	return sizeof(events);
 }
 
+static int kfd_smi_ev_mmap(struct file *filep, struct vm_area_struct *vma)
+{
+	struct kfd_smi_client *client = filep->private_data;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	struct kfd_smi_ring_header *ring;
+	int ret;
+
+	if (vma->vm_pgoff || size <= PAGE_SIZE ||
+	    !is_power_of_2(size - PAGE_SIZE) || size - PAGE_SIZE > MAX_RING_SIZE)
+		return -EINVAL;
+
+	/* reserve the ring, it can only be mapped once */
+	spin_lock(&client->lock);
+	if (client->ring_size) {
+		spin_unlock(&client->lock);
+		return -EBUSY;
+	}
+	client->ring_size = size - PAGE_SIZE;
+	spin_unlock(&client->lock);
+
+	ring = vmalloc_user(size);
+	if (!ring) {
+		ret = -ENOMEM;
+		goto out_unreserve;
+	}
+	ring->data_size = size - PAGE_SIZE;
+
+	ret = remap_vmalloc_range(vma, ring, 0);
+	if (ret) {
+		vfree(ring);
+		goto out_unreserve;
+	}
+
+	spin_lock(&client->lock);
+	client->ring = ring;
+	client->ring_head = 0;
+	spin_unlock(&client->lock);
+
+	return 0;
+
+out_unreserve:
+	spin_lock(&client->lock);
+	client->ring_size = 0;
+	spin_unlock(&client->lock);
+	return ret;
+}
+
 static int kfd_smi_ev_release(struct inode *inode, struct file *filep)
 {
 	struct kfd_smi_client *client = filep->private_data;
@@ -144,13 +204,58 @@ static int kfd_smi_ev_release(struct inode *inode, struct file *filep)
 
 	synchronize_rcu();
 	kfifo_free(&client->fifo);
+	vfree(client->ring);
 	kfree(client);
 
 	return 0;
 }
 
+/*
+ * Write a record to the ring buffer of a client. The tail is controlled by
+ * user mode, so it is only used to calculate the free space and the head is
+ * tracked in the client. Returns true if the consumer may wait for the
+ * record.
+ */
+static bool kfd_smi_ring_write(struct kfd_smi_client *client,
+			       const struct kfd_smi_record *rec)
+{
+	struct kfd_smi_ring_header *ring = client->ring;
+	void *data = (void *)ring + PAGE_SIZE;
+	uint64_t head = client->ring_head;
+	uint64_t tail = smp_load_acquire(&ring->tail);
+	uint32_t offset = head & (client->ring_size - 1);
+	uint32_t pad = 0;
+
+	/* records never wrap around the end of the data area */
+	if (offset + rec->size > client->ring_size)
+		pad = client->ring_size - offset;
+
+	if (head - tail > client->ring_size ||
+	    client->ring_size - (head - tail) < pad + rec->size) {
+		WRITE_ONCE(ring->dropped, ring->dropped + 1);
+		return false;
+	}
+
+	if (pad) {
+		struct kfd_smi_record *filler = data + offset;
+
+		filler->size = pad;
+		filler->event = KFD_SMI_EVENT_NONE;
+		head += pad;
+		offset = 0;
+	}
+
+	memcpy(data + offset, rec, rec->size);
+	client->ring_head = head + rec->size;
+	smp_store_release(&ring->head, client->ring_head);
+
+	/* only wake up a consumer which already caught up */
+	return tail == client->ring_head - rec->size - pad;
+}
+
 static void add_event_to_kfifo(struct kfd_dev *dev, unsigned int smi_event,
-			      char *event_msg, int len)
+			      char *event_msg, int len,
+			      const struct kfd_smi_record *rec)
 {
 	struct kfd_smi_client *client;
 
@@ -161,7 +266,10 @@ static void add_event_to_kfifo(struct kfd_dev *dev, unsigned int smi_event,
 				KFD_SMI_EVENT_MASK_FROM_INDEX(smi_event)))
 			continue;
 		spin_lock(&client->lock);
-		if (kfifo_avail(&client->fifo) >= len) {
+		if (client->ring) {
+			if (kfd_smi_ring_write(client, rec))
+				wake_up_all(&client->wait_queue);
+		} else if (kfifo_avail(&client->fifo) >= len) {
 			kfifo_in(&client->fifo, event_msg, len);
 			wake_up_all(&client->wait_queue);
 		} else {
@@ -174,6 +282,16 @@ static void add_event_to_kfifo(struct kfd_dev *dev, unsigned int smi_event,
 	rcu_read_unlock();
 }
 
+static void kfd_smi_record_init(struct kfd_smi_record *rec,
+				unsigned int event, pid_t pid)
+{
+	memset(rec, 0, sizeof(*rec));
+	rec->size = sizeof(*rec);
+	rec->event = event;
+	rec->pid = pid;
+	rec->timestamp = ktime_get_boottime_ns();
+}
+
 void kfd_smi_event_update_gpu_reset(struct kfd_dev *dev, bool post_reset)
 {
 	/*
@@ -183,6 +301,7 @@ void kfd_smi_event_update_gpu_reset(struct kfd_dev *dev, bool post_reset)
 	 * 1 byte \n + 1 byte \0 = 12
 	 */
 	char fifo_in[12];
+	struct kfd_smi_record rec;
 	int len;
 	unsigned int event;
 
@@ -201,7 +320,10 @@ void kfd_smi_event_update_gpu_reset(struct kfd_dev *dev, bool post_reset)
 	len = snprintf(fifo_in, sizeof(fifo_in), "%x %x\n", event,
 						dev->reset_seq_num);
 
-	add_event_to_kfifo(dev, event, fifo_in, len);
+	kfd_smi_record_init(&rec, event, 0);
+	rec.gpu_reset.seq_num = dev->reset_seq_num;
+
+	add_event_to_kfifo(dev, event, fifo_in, len, &rec);
 }
 
 void kfd_smi_event_update_thermal_throttling(struct kfd_dev *dev,
@@ -215,6 +337,7 @@ void kfd_smi_event_update_thermal_throttling(struct kfd_dev *dev,
 	 * 1 byte \0 = 37
 	 */
 	char fifo_in[37];
+	struct kfd_smi_record rec;
 	int len;
 
 	if (list_empty(&dev->smi_clients))
@@ -224,7 +347,13 @@ void kfd_smi_event_update_thermal_throttling(struct kfd_dev *dev,
 		       KFD_SMI_EVENT_THERMAL_THROTTLE, throttle_bitmask,
 		       atomic64_read(&dev->adev->smu.throttle_int_counter));
 
-	add_event_to_kfifo(dev, KFD_SMI_EVENT_THERMAL_THROTTLE,	fifo_in, len);
+	kfd_smi_record_init(&rec, KFD_SMI_EVENT_THERMAL_THROTTLE, 0);
+	rec.thermal_throttle.throttle_bitmask = throttle_bitmask;
+	rec.thermal_throttle.interrupt_count =
+		atomic64_read(&dev->adev->smu.throttle_int_counter);
+
+	add_event_to_kfifo(dev, KFD_SMI_EVENT_THERMAL_THROTTLE,	fifo_in, len,
+			   &rec);
 }
 
 void kfd_smi_event_update_vmfault(struct kfd_dev *dev, uint16_t pasid)
@@ -235,6 +364,7 @@ void kfd_smi_event_update_vmfault(struct kfd_dev *dev, uint16_t pasid)
 	 * 1 byte \0 = 29
 	 */
 	char fifo_in[29];
+	struct kfd_smi_record rec;
 	int len;
 
 	if (list_empty(&dev->smi_clients))
@@ -249,7 +379,129 @@ void kfd_smi_event_update_vmfault(struct kfd_dev *dev, uint16_t pasid)
 	len = snprintf(fifo_in, sizeof(fifo_in), "%x %x:%s\n", KFD_SMI_EVENT_VMFAULT,
 		task_info.pid, task_info.task_name);
 
-	add_event_to_kfifo(dev, KFD_SMI_EVENT_VMFAULT, fifo_in, len);
+	kfd_smi_record_init(&rec, KFD_SMI_EVENT_VMFAULT, task_info.pid);
+	strscpy(rec.vmfault.task_name, task_info.task_name,
+		sizeof(rec.vmfault.task_name));
+
+	add_event_to_kfifo(dev, KFD_SMI_EVENT_VMFAULT, fifo_in, len, &rec);
+}
+
+void kfd_smi_event_svm_policy(struct kfd_dev *dev, pid_t pid,
+			      unsigned long start, unsigned long last,
+			      uint32_t decision, uint32_t loc)
+{
+	/*
+	 * SvmPolicy msg = pid(8):start(16):last(16):decision(8):location(8)
+	 * 1 byte event + 1 byte space + 56 bytes msg + 4 bytes : +
+	 * 1 byte \n + 1 byte \0 = 64
+	 */
+	char fifo_in[64];
+	struct kfd_smi_record rec;
+	int len;
+
+	if (list_empty(&dev->smi_clients))
+		return;
+
+	len = snprintf(fifo_in, sizeof(fifo_in), "%x %x:%lx:%lx:%x:%x\n",
+		       KFD_SMI_EVENT_SVM_POLICY, pid, start, last, decision,
+		       loc);
+
+	kfd_smi_record_init(&rec, KFD_SMI_EVENT_SVM_POLICY, pid);
+	rec.svm_policy.start = start;
+	rec.svm_policy.last = last;
+	rec.svm_policy.decision = decision;
+	rec.svm_policy.loc = loc;
+
+	add_event_to_kfifo(dev, KFD_SMI_EVENT_SVM_POLICY, fifo_in, len, &rec);
+}
+
+void kfd_smi_event_migration_start(struct kfd_dev *dev, pid_t pid,
+				   unsigned long start, unsigned long last,
+				   uint32_t from, uint32_t to)
+{
+	/*
+	 * MigrateStart msg = pid(8):start(16):last(16):from(8):to(8)
+	 * 1 byte event + 1 byte space + 56 bytes msg + 4 bytes : +
+	 * 1 byte \n + 1 byte \0 = 64
+	 */
+	char fifo_in[64];
+	struct kfd_smi_record rec;
+	int len;
+
+	if (list_empty(&dev->smi_clients))
+		return;
+
+	len = snprintf(fifo_in, sizeof(fifo_in), "%x %x:%lx:%lx:%x:%x\n",
+		       KFD_SMI_EVENT_MIGRATE_START, pid, start, last, from, to);
+
+	kfd_smi_record_init(&rec, KFD_SMI_EVENT_MIGRATE_START, pid);
+	rec.migrate.start = start;
+	rec.migrate.last = last;
+	rec.migrate.from = from;
+	rec.migrate.to = to;
+
+	add_event_to_kfifo(dev, KFD_SMI_EVENT_MIGRATE_START, fifo_in, len,
+			   &rec);
+}
+
+void kfd_smi_event_migration_end(struct kfd_dev *dev, pid_t pid,
+				 unsigned long start, unsigned long last,
+				 uint32_t from, uint32_t to, uint64_t bytes,
+				 uint64_t duration)
+{
+	/*
+	 * MigrateEnd msg = pid(8):start(16):last(16):from(8):to(8):
+	 *		    bytes(16):duration(16)
+	 * 1 byte event + 1 byte space + 88 bytes msg + 6 bytes : +
+	 * 1 byte \n + 1 byte \0 = 98
+	 */
+	char fifo_in[98];
+	struct kfd_smi_record rec;
+	int len;
+
+	if (list_empty(&dev->smi_clients))
+		return;
+
+	len = snprintf(fifo_in, sizeof(fifo_in),
+		       "%x %x:%lx:%lx:%x:%x:%llx:%llx\n",
+		       KFD_SMI_EVENT_MIGRATE_END, pid, start, last, from, to,
+		       bytes, duration);
+
+	kfd_smi_record_init(&rec, KFD_SMI_EVENT_MIGRATE_END, pid);
+	rec.migrate.start = start;
+	rec.migrate.last = last;
+	rec.migrate.from = from;
+	rec.migrate.to = to;
+	rec.migrate.bytes = bytes;
+	rec.migrate.duration = duration;
+
+	add_event_to_kfifo(dev, KFD_SMI_EVENT_MIGRATE_END, fifo_in, len, &rec);
+}
+
+void kfd_smi_event_queue_eviction(struct kfd_dev *dev, pid_t pid,
+				  bool restore)
+{
+	/*
+	 * QueueEviction/QueueRestore msg = pid(8):gpuid(8)
+	 * 1 byte event + 1 byte space + 16 bytes msg + 1 byte : +
+	 * 1 byte \n + 1 byte \0 = 21
+	 */
+	unsigned int event = restore ? KFD_SMI_EVENT_QUEUE_RESTORE :
+				       KFD_SMI_EVENT_QUEUE_EVICTION;
+	char fifo_in[21];
+	struct kfd_smi_record rec;
+	int len;
+
+	if (list_empty(&dev->smi_clients))
+		return;
+
+	len = snprintf(fifo_in, sizeof(fifo_in), "%x %x:%x\n", event, pid,
+		       dev->id);
+
+	kfd_smi_record_init(&rec, event, pid);
+	rec.queue.gpuid = dev->id;
+
+	add_event_to_kfifo(dev, event, fifo_in, len, &rec);
 }
 
 int kfd_smi_event_open(struct kfd_dev *dev, uint32_t *fd)
@@ -28,5 +28,17 @@ void kfd_smi_event_update_vmfault(struct kfd_dev *dev, uint16_t pasid);
 void kfd_smi_event_update_thermal_throttling(struct kfd_dev *dev,
 					     uint64_t throttle_bitmask);
 void kfd_smi_event_update_gpu_reset(struct kfd_dev *dev, bool post_reset);
+void kfd_smi_event_svm_policy(struct kfd_dev *dev, pid_t pid,
+			      unsigned long start, unsigned long last,
+			      uint32_t decision, uint32_t loc);
+void kfd_smi_event_migration_start(struct kfd_dev *dev, pid_t pid,
+				   unsigned long start, unsigned long last,
+				   uint32_t from, uint32_t to);
+void kfd_smi_event_migration_end(struct kfd_dev *dev, pid_t pid,
+				 unsigned long start, unsigned long last,
+				 uint32_t from, uint32_t to, uint64_t bytes,
+				 uint64_t duration);
+void kfd_smi_event_queue_eviction(struct kfd_dev *dev, pid_t pid,
+				  bool restore);
 
 #endif
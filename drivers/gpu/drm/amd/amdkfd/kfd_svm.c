@@ -32,6 +32,7 @@
 #include "kfd_priv.h"
 #include "kfd_svm.h"
 #include "kfd_migrate.h"
+#include "kfd_smi_events.h"
 
 #ifdef dev_fmt
 #undef dev_fmt
@@ -50,11 +51,15 @@ static bool
 svm_range_cpu_invalidate_pagetables(struct mmu_interval_notifier *mni,
 				    const struct mmu_notifier_range *range,
 				    unsigned long cur_seq);
+static void
+svm_range_cpu_invalidate_flush(struct mmu_interval_notifier *mni,
+			       const struct mmu_notifier_range *range);
 static int
 svm_range_check_vm(struct kfd_process *p, uint64_t start, uint64_t last,
 		   uint64_t *bo_s, uint64_t *bo_l);
 static const struct mmu_interval_notifier_ops svm_range_mn_ops = {
 	.invalidate = svm_range_cpu_invalidate_pagetables,
+	.invalidate_flush = svm_range_cpu_invalidate_flush,
 };
 
 /**
@@ -66,6 +71,33 @@ static const struct mmu_interval_notifier_ops svm_range_mn_ops = {
  *
  * Context: The caller must hold svms->lock
  */
+/*
+ * Changes of the interval tree are published through svms->objects_seq so
+ * svm_range_from_addr_rcu() can detect concurrent changes. Writers are
+ * serialized by the svms lock.
+ */
+static void svm_range_tree_insert(struct svm_range *prange)
+{
+	struct svm_range_list *svms = prange->svms;
+
+	preempt_disable();
+	write_seqcount_begin(&svms->objects_seq);
+	interval_tree_insert(&prange->it_node, &svms->objects);
+	write_seqcount_end(&svms->objects_seq);
+	preempt_enable();
+}
+
+static void svm_range_tree_remove(struct svm_range *prange)
+{
+	struct svm_range_list *svms = prange->svms;
+
+	preempt_disable();
+	write_seqcount_begin(&svms->objects_seq);
+	interval_tree_remove(&prange->it_node, &svms->objects);
+	write_seqcount_end(&svms->objects_seq);
+	preempt_enable();
+}
+
 static void svm_range_unlink(struct svm_range *prange)
 {
 	pr_debug("svms 0x%p prange 0x%p [0x%lx 0x%lx]\n", prange->svms,
@@ -79,7 +111,7 @@ static void svm_range_unlink(struct svm_range *prange)
 
 	list_del(&prange->list);
 	if (prange->it_node.start != 0 && prange->it_node.last != 0)
-		interval_tree_remove(&prange->it_node, &prange->svms->objects);
+		svm_range_tree_remove(prange);
 }
 
 static void
@@ -110,7 +142,7 @@ static void svm_range_add_to_svms(struct svm_range *prange)
 	list_move_tail(&prange->list, &prange->svms->list);
 	prange->it_node.start = prange->start;
 	prange->it_node.last = prange->last;
-	interval_tree_insert(&prange->it_node, &prange->svms->objects);
+	svm_range_tree_insert(prange);
 }
 
 static void svm_range_remove_notifier(struct svm_range *prange)
@@ -264,7 +296,8 @@ static void svm_range_free(struct svm_range *prange)
 	svm_range_free_dma_mappings(prange);
 	mutex_destroy(&prange->lock);
 	mutex_destroy(&prange->migrate_mutex);
-	kfree(prange);
+	/* lockless lookups may still look at the range */
+	kfree_rcu(prange, rcu);
 }
 
 static void
@@ -948,6 +981,9 @@ svm_range_split_adjust(struct svm_range *new, struct svm_range *old,
 	new->granularity = old->granularity;
 	bitmap_copy(new->bitmap_access, old->bitmap_access, MAX_GPU_INSTANCE);
 	bitmap_copy(new->bitmap_aip, old->bitmap_aip, MAX_GPU_INSTANCE);
+	new->pinned_until = old->pinned_until;
+	bitmap_copy(new->bitmap_xgmi, old->bitmap_xgmi, MAX_GPU_INSTANCE);
+	new->xgmi_loc = old->xgmi_loc;
 
 	return 0;
 }
@@ -1224,8 +1260,8 @@ svm_range_unmap_from_gpus(struct svm_range *prange, unsigned long start,
 			if (r)
 				break;
 		}
-		amdgpu_amdkfd_flush_gpu_tlb_pasid(pdd->dev->adev,
-					p->pasid, TLB_FLUSH_HEAVYWEIGHT);
+		/* flushed once per invalidation by svm_range_cpu_invalidate_flush */
+		set_bit(gpuidx, prange->svms->tlb_flush_pending);
 	}
 
 	return r;
@@ -1310,6 +1346,88 @@ svm_range_map_to_gpu(struct amdgpu_device *adev, struct amdgpu_vm *vm,
 	return r;
 }
 
+/**
+ * svm_range_xgmi_reachable - check if a GPU maps the VRAM of a peer GPU
+ * @adev: the GPU accessing the memory
+ * @bo_adev: the GPU owning the VRAM
+ *
+ * Peer VRAM is accessed over XGMI if both GPUs are in the same hive and the
+ * connection is within the svm_xgmi_max_hops and svm_xgmi_min_links limits.
+ * Migrating between GPUs goes through system memory, so the XGMI link also
+ * has to be at least as fast as the system memory link of @adev.
+ */
+static bool
+svm_range_xgmi_reachable(struct amdgpu_device *adev,
+			 struct amdgpu_device *bo_adev)
+{
+	uint32_t xgmi_bw, sys_bw, latency;
+	int r;
+
+	if (!bo_adev || !amdgpu_xgmi_same_hive(adev, bo_adev))
+		return false;
+
+	if (svm_xgmi_max_hops > 0) {
+		r = amdgpu_xgmi_get_hops_count(adev, bo_adev);
+		if (r < 0 || r > svm_xgmi_max_hops)
+			return false;
+	}
+
+	if (svm_xgmi_min_links > 1) {
+		r = amdgpu_xgmi_get_num_links(adev, bo_adev);
+		if (r < svm_xgmi_min_links)
+			return false;
+	}
+
+	if (!kfd_topology_link_perf(adev->kfd.dev, bo_adev->kfd.dev, &xgmi_bw,
+				    &latency) &&
+	    !kfd_topology_link_perf(adev->kfd.dev, NULL, &sys_bw, &latency) &&
+	    xgmi_bw && xgmi_bw < sys_bw)
+		return false;
+
+	return true;
+}
+
+/**
+ * svm_range_xgmi_peers - GPUs which map the VRAM of a location over XGMI
+ * @prange: the svm range
+ * @loc: gpuid of the VRAM location, 0 for system memory
+ *
+ * The hive topology is looked up once and cached in the range until it is
+ * asked for another location.
+ *
+ * Context: Caller holds the svms lock
+ *
+ * Return: bitmap of the GPU indices which can map @loc remotely
+ */
+static unsigned long *
+svm_range_xgmi_peers(struct svm_range *prange, uint32_t loc)
+{
+	struct amdgpu_device *bo_adev;
+	struct kfd_process *p;
+	uint32_t gpuidx;
+
+	if (prange->xgmi_loc == loc)
+		return prange->bitmap_xgmi;
+
+	bitmap_zero(prange->bitmap_xgmi, MAX_GPU_INSTANCE);
+	prange->xgmi_loc = loc;
+	if (!loc)
+		return prange->bitmap_xgmi;
+
+	bo_adev = svm_range_get_adev_by_id(prange, loc);
+	p = container_of(prange->svms, struct kfd_process, svms);
+	for (gpuidx = 0; bo_adev && gpuidx < p->n_pdds; gpuidx++) {
+		if (svm_range_xgmi_reachable(p->pdds[gpuidx]->dev->adev,
+					     bo_adev))
+			set_bit(gpuidx, prange->bitmap_xgmi);
+	}
+
+	pr_debug("svms 0x%p [0x%lx 0x%lx] loc 0x%x xgmi peers 0x%lx\n",
+		 prange->svms, prange->start, prange->last, loc,
+		 prange->bitmap_xgmi[0]);
+	return prange->bitmap_xgmi;
+}
+
 static int
 svm_range_map_to_gpus(struct svm_range *prange, unsigned long offset,
 		      unsigned long npages, bool readonly,
@@ -1341,7 +1459,8 @@ svm_range_map_to_gpus(struct svm_range *prange, unsigned long offset,
 			return -EINVAL;
 
 		if (bo_adev && pdd->dev->adev != bo_adev &&
-		    !amdgpu_xgmi_same_hive(pdd->dev->adev, bo_adev)) {
+		    !test_bit(gpuidx, svm_range_xgmi_peers(prange,
+							  prange->actual_loc))) {
 			pr_debug("cannot map to device idx %d\n", gpuidx);
 			continue;
 		}
@@ -1596,7 +1715,8 @@ static int svm_range_validate_and_map(struct mm_struct *mm,
 	svm_range_unreserve_bos(&ctx);
 
 	if (!r)
-		prange->validate_timestamp = ktime_to_us(ktime_get());
+		WRITE_ONCE(prange->validate_timestamp,
+			   ktime_to_us(ktime_get()));
 
 	return r;
 }
@@ -1817,6 +1937,9 @@ static struct svm_range *svm_range_clone(struct svm_range *old)
 	new->granularity = old->granularity;
 	bitmap_copy(new->bitmap_access, old->bitmap_access, MAX_GPU_INSTANCE);
 	bitmap_copy(new->bitmap_aip, old->bitmap_aip, MAX_GPU_INSTANCE);
+	new->pinned_until = old->pinned_until;
+	bitmap_copy(new->bitmap_xgmi, old->bitmap_xgmi, MAX_GPU_INSTANCE);
+	new->xgmi_loc = old->xgmi_loc;
 
 	return new;
 }
@@ -1974,13 +2097,13 @@ svm_range_update_notifier_and_interval_tree(struct mm_struct *mm,
 		  prange->last);
 
 	if (start != 0 && last != 0) {
-		interval_tree_remove(&prange->it_node, &prange->svms->objects);
+		svm_range_tree_remove(prange);
 		svm_range_remove_notifier(prange);
 	}
 	prange->it_node.start = prange->start;
 	prange->it_node.last = prange->last;
 
-	interval_tree_insert(&prange->it_node, &prange->svms->objects);
+	svm_range_tree_insert(prange);
 	svm_range_add_notifier_locked(mm, prange);
 }
 
@@ -2302,6 +2425,45 @@ svm_range_cpu_invalidate_pagetables(struct mmu_interval_notifier *mni,
 	return true;
 }
 
+/**
+ * svm_range_cpu_invalidate_flush - interval notifier flush callback
+ * @mni: mmu_interval_notifier struct
+ * @range: mmu_notifier_range struct
+ *
+ * Flush the TLB of the GPUs svm_range_cpu_invalidate_pagetables unmapped
+ * ranges from. Called after all svm ranges overlapping @range were
+ * invalidated, so unmapping many ranges at once flushes each GPU only once.
+ *
+ * Context: mmap lock, notifier_invalidate_start lock are held
+ */
+static void
+svm_range_cpu_invalidate_flush(struct mmu_interval_notifier *mni,
+			       const struct mmu_notifier_range *range)
+{
+	struct svm_range *prange = container_of(mni, struct svm_range, notifier);
+	struct svm_range_list *svms = prange->svms;
+	struct kfd_process_device *pdd;
+	struct kfd_process *p;
+	uint32_t gpuidx;
+
+	p = container_of(svms, struct kfd_process, svms);
+
+	/*
+	 * Serialize against concurrent invalidations, a flush which already
+	 * picked up our pending bits must be done before we return.
+	 */
+	mutex_lock(&svms->tlb_flush_lock);
+	for_each_set_bit(gpuidx, svms->tlb_flush_pending, MAX_GPU_INSTANCE) {
+		clear_bit(gpuidx, svms->tlb_flush_pending);
+		pdd = kfd_process_device_from_gpuidx(p, gpuidx);
+		if (!pdd)
+			continue;
+		amdgpu_amdkfd_flush_gpu_tlb_pasid(pdd->dev->adev,
+					p->pasid, TLB_FLUSH_HEAVYWEIGHT);
+	}
+	mutex_unlock(&svms->tlb_flush_lock);
+}
+
 /**
  * svm_range_from_addr - find svm range from fault address
  * @svms: svm range list header
@@ -2345,6 +2507,76 @@ svm_range_from_addr(struct svm_range_list *svms, unsigned long addr,
 	return NULL;
 }
 
+/**
+ * svm_range_from_addr_rcu - lockless lookup of the range containing an address
+ * @svms: svm range list header
+ * @addr: address to search range interval tree, in pages
+ *
+ * Only finds ranges in the interval tree, not child ranges waiting for the
+ * deferred list work. Returns NULL if the tree changed during the lookup, the
+ * caller then has to fall back to svm_range_from_addr() under the svms lock.
+ *
+ * Context: The caller must be in an RCU read side critical section, the
+ * range must not be used after leaving it.
+ *
+ * Return: the svm_range found or NULL
+ */
+static struct svm_range *
+svm_range_from_addr_rcu(struct svm_range_list *svms, unsigned long addr)
+{
+	struct interval_tree_node *node;
+	unsigned int seq;
+
+	seq = raw_read_seqcount(&svms->objects_seq);
+	if (seq & 1)
+		return NULL;
+
+	node = interval_tree_iter_first(&svms->objects, addr, addr);
+	if (read_seqcount_retry(&svms->objects_seq, seq) || !node)
+		return NULL;
+
+	return container_of(node, struct svm_range, it_node);
+}
+
+/**
+ * svm_range_fault_pending - lockless check for duplicate retry faults
+ * @svms: svm range list header
+ * @addr: the faulting page
+ * @last: returns the last page of the range if it was restored
+ *
+ * A wavefront faulting on many pages of a range creates a storm of retry
+ * faults which are all handled by restoring the range once. Detect them
+ * without waiting for the svms lock, which may be held by attribute updates
+ * or the deferred list work in the meantime.
+ *
+ * Return: true if the range of @addr was just restored
+ */
+static bool
+svm_range_fault_pending(struct svm_range_list *svms, unsigned long addr,
+			uint64_t *last)
+{
+	struct svm_range *prange;
+	bool pending = false;
+	uint64_t timestamp;
+	unsigned long end;
+
+	rcu_read_lock();
+	prange = svm_range_from_addr_rcu(svms, addr);
+	if (prange) {
+		timestamp = ktime_to_us(ktime_get()) -
+			    READ_ONCE(prange->validate_timestamp);
+		end = READ_ONCE(prange->last);
+		if (timestamp < AMDGPU_SVM_RANGE_RETRY_FAULT_PENDING &&
+		    addr <= end) {
+			*last = end;
+			pending = true;
+		}
+	}
+	rcu_read_unlock();
+
+	return pending;
+}
+
 /* svm_range_best_restore_location - decide the best fault restore location
  * @prange: svm range structure
  * @adev: the GPU on which vm fault happened
@@ -2371,7 +2603,8 @@ svm_range_best_restore_location(struct svm_range *prange,
 				struct amdgpu_device *adev,
 				int32_t *gpuidx)
 {
-	struct amdgpu_device *bo_adev, *preferred_adev;
+	DECLARE_BITMAP(bitmap, MAX_GPU_INSTANCE);
+	struct amdgpu_device *preferred_adev;
 	struct kfd_process *p;
 	uint32_t gpuid;
 	int r;
@@ -2390,20 +2623,32 @@ svm_range_best_restore_location(struct svm_range *prange,
 	} else if (prange->preferred_loc != KFD_IOCTL_SVM_LOCATION_UNDEFINED) {
 		preferred_adev = svm_range_get_adev_by_id(prange,
 							prange->preferred_loc);
-		if (amdgpu_xgmi_same_hive(adev, preferred_adev))
+		if (svm_range_xgmi_reachable(adev, preferred_adev))
 			return prange->preferred_loc;
 		/* fall through */
 	}
 
-	if (test_bit(*gpuidx, prange->bitmap_access))
+	if (test_bit(*gpuidx, prange->bitmap_access)) {
+		/* Keep a single VRAM copy of ranges shared by several GPUs
+		 * of a hive instead of migrating it to each faulting GPU
+		 */
+		bitmap_or(bitmap, prange->bitmap_access, prange->bitmap_aip,
+			  MAX_GPU_INSTANCE);
+		if (prange->actual_loc && prange->actual_loc != gpuid &&
+		    bitmap_weight(bitmap, MAX_GPU_INSTANCE) > 1 &&
+		    test_bit(*gpuidx, svm_range_xgmi_peers(prange,
+							  prange->actual_loc)))
+			return prange->actual_loc;
+
 		return gpuid;
+	}
 
 	if (test_bit(*gpuidx, prange->bitmap_aip)) {
 		if (!prange->actual_loc)
 			return 0;
 
-		bo_adev = svm_range_get_adev_by_id(prange, prange->actual_loc);
-		if (amdgpu_xgmi_same_hive(adev, bo_adev))
+		if (test_bit(*gpuidx, svm_range_xgmi_peers(prange,
+							  prange->actual_loc)))
 			return prange->actual_loc;
 		else
 			return 0;
@@ -2635,6 +2880,202 @@ svm_range_count_fault(struct amdgpu_device *adev, struct kfd_process *p,
 		WRITE_ONCE(pdd->faults, pdd->faults + 1);
 }
 
+/* Defaults of the SVM migration policy */
+#define SVM_RANGE_POLICY_WINDOW_MS		1000
+#define SVM_RANGE_POLICY_THRASH_THRESHOLD	4
+#define SVM_RANGE_POLICY_PIN_MS			5000
+#define SVM_RANGE_POLICY_PREFETCH_GRANULES	2
+#define SVM_RANGE_POLICY_MAX_PREFETCH		64
+
+static void svm_range_policy_init(struct svm_range_policy *policy)
+{
+	policy->enable = false;
+	policy->window_ms = SVM_RANGE_POLICY_WINDOW_MS;
+	policy->thrash_threshold = SVM_RANGE_POLICY_THRASH_THRESHOLD;
+	policy->pin_ms = SVM_RANGE_POLICY_PIN_MS;
+	policy->prefetch_granules = SVM_RANGE_POLICY_PREFETCH_GRANULES;
+}
+
+/**
+ * svm_range_set_policy - query and update the migration policy of a process
+ * @p: the kfd process
+ * @args: the new policy if KFD_IOCTL_SVM_POLICY_FLAG_SET is given, returns
+ *        the current policy
+ *
+ * Return:
+ * 0 - OK, -EINVAL if the new values are invalid
+ */
+int svm_range_set_policy(struct kfd_process *p,
+			 struct kfd_ioctl_svm_policy_args *args)
+{
+	struct svm_range_policy *policy = &p->svms.policy;
+	int r = 0;
+
+	mutex_lock(&p->svms.lock);
+	if (args->flags & KFD_IOCTL_SVM_POLICY_FLAG_SET) {
+		if (args->flags & ~KFD_IOCTL_SVM_POLICY_FLAG_SET ||
+		    !args->window_ms || !args->thrash_threshold ||
+		    args->prefetch_granules > SVM_RANGE_POLICY_MAX_PREFETCH) {
+			r = -EINVAL;
+			goto out_unlock;
+		}
+
+		policy->enable = !!args->enable;
+		policy->window_ms = args->window_ms;
+		policy->thrash_threshold = args->thrash_threshold;
+		policy->pin_ms = args->pin_ms;
+		policy->prefetch_granules = args->prefetch_granules;
+	}
+
+	args->enable = policy->enable;
+	args->window_ms = policy->window_ms;
+	args->thrash_threshold = policy->thrash_threshold;
+	args->pin_ms = policy->pin_ms;
+	args->prefetch_granules = policy->prefetch_granules;
+
+out_unlock:
+	mutex_unlock(&p->svms.lock);
+	return r;
+}
+
+static void
+svm_range_policy_report(struct kfd_process *p, struct amdgpu_device *adev,
+			struct svm_range *prange, uint32_t decision,
+			uint32_t loc)
+{
+	pr_debug("svms 0x%p [0x%lx 0x%lx] policy decision %u loc 0x%x\n",
+		 prange->svms, prange->start, prange->last, decision, loc);
+	kfd_smi_event_svm_policy(adev->kfd.dev, p->lead_thread->pid,
+				 prange->start, prange->last, decision, loc);
+}
+
+/**
+ * svm_range_policy_fault - apply the migration policy to a GPU fault
+ * @p: the kfd process
+ * @adev: the GPU on which the vm fault happened
+ * @prange: the faulting range, caller holds its migrate_mutex
+ * @best_loc: location from svm_range_best_restore_location()
+ *
+ * Counts the migrations to VRAM the faults on @prange cause within a window
+ * of policy.window_ms. A range migrated more than policy.thrash_threshold
+ * times in a window ping-pongs between CPU and GPU, so it is pinned to
+ * system memory for policy.pin_ms. While pinned, the GPU maps the system
+ * memory pages instead of migrating them, which both CPU and GPU can access
+ * without further faults.
+ *
+ * Return: the location to restore the range to
+ */
+static int32_t
+svm_range_policy_fault(struct kfd_process *p, struct amdgpu_device *adev,
+		       struct svm_range *prange, int32_t best_loc)
+{
+	struct svm_range_policy *policy = &p->svms.policy;
+	uint64_t now;
+
+	if (!policy->enable || best_loc <= 0)
+		return best_loc;
+
+	now = ktime_to_ms(ktime_get());
+	if (prange->pinned_until) {
+		if (now < prange->pinned_until && !prange->actual_loc)
+			return 0;
+
+		prange->pinned_until = 0;
+		prange->policy_window = now;
+		prange->policy_migrations = 0;
+		svm_range_policy_report(p, adev, prange,
+					KFD_SMI_SVM_POLICY_UNPIN,
+					prange->actual_loc);
+	}
+
+	if (now - prange->policy_window >= policy->window_ms) {
+		prange->policy_window = now;
+		prange->policy_migrations = 0;
+	}
+
+	if (prange->actual_loc == best_loc)
+		return best_loc;
+
+	if (++prange->policy_migrations < policy->thrash_threshold ||
+	    prange->actual_loc || !policy->pin_ms)
+		return best_loc;
+
+	prange->pinned_until = now + policy->pin_ms;
+	svm_range_policy_report(p, adev, prange, KFD_SMI_SVM_POLICY_PIN, 0);
+	return 0;
+}
+
+/**
+ * svm_range_policy_prefetch - migrate ranges ahead of a GPU fault stream
+ * @p: the kfd process
+ * @adev: the GPU on which the vm fault happened
+ * @mm: the mm structure, caller holds the mmap read lock
+ * @prange: the range just restored, caller holds its migrate_mutex
+ * @best_loc: the location @prange was restored to
+ * @gpuidx: GPU index of @adev in the process
+ *
+ * If the fault hit the range next to the one of the previous fault, the
+ * application streams through memory. Migrate and map the next
+ * policy.prefetch_granules ranges in the same direction so the GPU doesn't
+ * have to fault on them. Caller holds the svms lock.
+ */
+static void
+svm_range_policy_prefetch(struct kfd_process *p, struct amdgpu_device *adev,
+			  struct mm_struct *mm, struct svm_range *prange,
+			  int32_t best_loc, int32_t gpuidx)
+{
+	struct svm_range_list *svms = &p->svms;
+	struct svm_range_policy *policy = &svms->policy;
+	unsigned long addr;
+	unsigned int i;
+	int dir = 0;
+
+	if (prange->start == svms->last_fault_last + 1)
+		dir = 1;
+	else if (prange->last + 1 == svms->last_fault_start)
+		dir = -1;
+	svms->last_fault_start = prange->start;
+	svms->last_fault_last = prange->last;
+
+	if (!policy->enable || !policy->prefetch_granules || best_loc <= 0 ||
+	    !dir)
+		return;
+
+	addr = dir > 0 ? prange->last + 1 : prange->start - 1;
+	for (i = 0; i < policy->prefetch_granules; ++i) {
+		struct svm_range *next;
+		int r = 0;
+
+		next = svm_range_from_addr(svms, addr, NULL);
+		if (!next || next == prange)
+			break;
+
+		/* never block on a range another fault is working on */
+		if (!mutex_trylock(&next->migrate_mutex))
+			break;
+
+		if (svm_range_skip_recover(next) || next->pinned_until) {
+			mutex_unlock(&next->migrate_mutex);
+			break;
+		}
+
+		if (next->actual_loc != best_loc) {
+			r = svm_migrate_to_vram(next, best_loc, mm);
+			if (!r)
+				r = svm_range_validate_and_map(mm, next, gpuidx,
+							       false, false);
+			if (!r)
+				svm_range_policy_report(p, adev, next,
+							KFD_SMI_SVM_POLICY_PREFETCH,
+							best_loc);
+		}
+		addr = dir > 0 ? next->last + 1 : next->start - 1;
+		mutex_unlock(&next->migrate_mutex);
+		if (r)
+			break;
+	}
+}
+
 static bool
 svm_fault_allowed(struct vm_area_struct *vma, bool write_fault)
 {
@@ -2648,14 +3089,28 @@ svm_fault_allowed(struct vm_area_struct *vma, bool write_fault)
 	return (vma->vm_flags & requested) == requested;
 }
 
-int
-svm_range_restore_pages(struct amdgpu_device *adev, unsigned int pasid,
-			uint64_t addr, bool write_fault)
+/**
+ * svm_range_restore_addr - recover a single GPU retry fault
+ * @adev: the GPU on which the vm fault happened
+ * @p: the kfd process
+ * @mm: the mm structure, caller holds the mmap read lock
+ * @addr: the faulting page
+ * @write_fault: true if it was a write fault
+ * @last: returns the last page of the range the fault was recovered on
+ *
+ * The mmap lock may be upgraded temporarily to create an unregistered range,
+ * it is held in read mode again on return.
+ *
+ * Return: 0 on success or if the fault is stale, negative error code if the
+ * fault could not be recovered
+ */
+static int
+svm_range_restore_addr(struct amdgpu_device *adev, struct kfd_process *p,
+		       struct mm_struct *mm, uint64_t addr, bool write_fault,
+		       uint64_t *last)
 {
-	struct mm_struct *mm = NULL;
-	struct svm_range_list *svms;
+	struct svm_range_list *svms = &p->svms;
 	struct svm_range *prange;
-	struct kfd_process *p;
 	uint64_t timestamp;
 	int32_t best_loc;
 	int32_t gpuidx = MAX_GPU_INSTANCE;
@@ -2663,42 +3118,14 @@ svm_range_restore_pages(struct amdgpu_device *adev, unsigned int pasid,
 	struct vm_area_struct *vma;
 	int r = 0;
 
-	if (!KFD_IS_SVM_API_SUPPORTED(adev->kfd.dev)) {
-		pr_debug("device does not support SVM\n");
-		return -EFAULT;
-	}
+	*last = addr;
 
-	p = kfd_lookup_process_by_pasid(pasid);
-	if (!p) {
-		pr_debug("kfd process not founded pasid 0x%x\n", pasid);
+	if (svm_range_fault_pending(svms, addr, last)) {
+		pr_debug("svms 0x%p address 0x%llx already restored\n", svms,
+			 addr);
 		return 0;
 	}
-	if (!p->xnack_enabled) {
-		pr_debug("XNACK not enabled for pasid 0x%x\n", pasid);
-		r = -EFAULT;
-		goto out;
-	}
-	svms = &p->svms;
-
-	pr_debug("restoring svms 0x%p fault address 0x%llx\n", svms, addr);
-
-	if (atomic_read(&svms->drain_pagefaults)) {
-		pr_debug("draining retry fault, drop fault 0x%llx\n", addr);
-		r = 0;
-		goto out;
-	}
-
-	/* p->lead_thread is available as kfd_process_wq_release flush the work
-	 * before releasing task ref.
-	 */
-	mm = get_task_mm(p->lead_thread);
-	if (!mm) {
-		pr_debug("svms 0x%p failed to get mm\n", svms);
-		r = 0;
-		goto out;
-	}
 
-	mmap_read_lock(mm);
 retry_write_locked:
 	mutex_lock(&svms->lock);
 	prange = svm_range_from_addr(svms, addr, NULL);
@@ -2729,9 +3156,10 @@ svm_range_restore_pages(struct amdgpu_device *adev, unsigned int pasid,
 		mmap_write_downgrade(mm);
 
 	mutex_lock(&prange->migrate_mutex);
+	*last = prange->last;
 
 	if (svm_range_skip_recover(prange)) {
-		amdgpu_gmc_filter_faults_remove(adev, addr, pasid);
+		amdgpu_gmc_filter_faults_remove(adev, addr, p->pasid);
 		r = 0;
 		goto out_unlock_range;
 	}
@@ -2770,6 +3198,8 @@ svm_range_restore_pages(struct amdgpu_device *adev, unsigned int pasid,
 		goto out_unlock_range;
 	}
 
+	best_loc = svm_range_policy_fault(p, adev, prange, best_loc);
+
 	pr_debug("svms %p [0x%lx 0x%lx] best restore 0x%x, actual loc 0x%x\n",
 		 svms, prange->start, prange->last, best_loc,
 		 prange->actual_loc);
@@ -2802,27 +3232,113 @@ svm_range_restore_pages(struct amdgpu_device *adev, unsigned int pasid,
 	if (r)
 		pr_debug("failed %d to map svms 0x%p [0x%lx 0x%lx] to gpus\n",
 			 r, svms, prange->start, prange->last);
+	else
+		svm_range_policy_prefetch(p, adev, mm, prange, best_loc,
+					  gpuidx);
 
 out_unlock_range:
 	mutex_unlock(&prange->migrate_mutex);
 out_unlock_svms:
 	mutex_unlock(&svms->lock);
-	mmap_read_unlock(mm);
 
 	svm_range_count_fault(adev, p, gpuidx);
 
-	mmput(mm);
-out:
-	kfd_unref_process(p);
-
 	if (r == -EAGAIN) {
 		pr_debug("recover vm fault later\n");
-		amdgpu_gmc_filter_faults_remove(adev, addr, pasid);
+		amdgpu_gmc_filter_faults_remove(adev, addr, p->pasid);
 		r = 0;
 	}
 	return r;
 }
 
+/**
+ * svm_range_restore_pages - recover a batch of GPU retry faults
+ * @adev: the GPU on which the vm faults happened
+ * @pasid: PASID of the process
+ * @addrs: the faulting pages in ascending order
+ * @count: number of pages in @addrs, returns the number of faults handled
+ * @write_fault: true if the faults were write faults
+ *
+ * The process, its mm and the mmap lock are only looked up and taken once
+ * for the whole batch. Faults on pages of a range which was just recovered
+ * are handled by that restore, so every range is validated and mapped once
+ * no matter how many of its pages faulted.
+ *
+ * Return: 0 if all faults were handled, otherwise the error of the fault at
+ * index @count, which is not handled
+ */
+int
+svm_range_restore_pages(struct amdgpu_device *adev, unsigned int pasid,
+			const uint64_t *addrs, unsigned int *count,
+			bool write_fault)
+{
+	struct mm_struct *mm = NULL;
+	struct svm_range_list *svms;
+	struct kfd_process *p;
+	unsigned int i = 0;
+	uint64_t last;
+	int r = 0;
+
+	if (!KFD_IS_SVM_API_SUPPORTED(adev->kfd.dev)) {
+		pr_debug("device does not support SVM\n");
+		r = -EFAULT;
+		goto out_count;
+	}
+
+	p = kfd_lookup_process_by_pasid(pasid);
+	if (!p) {
+		pr_debug("kfd process not founded pasid 0x%x\n", pasid);
+		i = *count;
+		goto out_count;
+	}
+	if (!p->xnack_enabled) {
+		pr_debug("XNACK not enabled for pasid 0x%x\n", pasid);
+		r = -EFAULT;
+		goto out;
+	}
+	svms = &p->svms;
+
+	pr_debug("restoring svms 0x%p %u faults from address 0x%llx\n", svms,
+		 *count, addrs[0]);
+
+	if (atomic_read(&svms->drain_pagefaults)) {
+		pr_debug("draining retry fault, drop fault 0x%llx\n", addrs[0]);
+		i = *count;
+		goto out;
+	}
+
+	/* p->lead_thread is available as kfd_process_wq_release flush the work
+	 * before releasing task ref.
+	 */
+	mm = get_task_mm(p->lead_thread);
+	if (!mm) {
+		pr_debug("svms 0x%p failed to get mm\n", svms);
+		i = *count;
+		goto out;
+	}
+
+	mmap_read_lock(mm);
+	while (i < *count) {
+		r = svm_range_restore_addr(adev, p, mm, addrs[i], write_fault,
+					   &last);
+		if (r)
+			break;
+
+		/* skip the faults handled by restoring the range */
+		do {
+			++i;
+		} while (i < *count && addrs[i] <= last);
+	}
+	mmap_read_unlock(mm);
+
+	mmput(mm);
+out:
+	kfd_unref_process(p);
+out_count:
+	*count = i;
+	return r;
+}
+
 void svm_range_list_fini(struct kfd_process *p)
 {
 	struct svm_range *prange;
@@ -2847,6 +3363,7 @@ void svm_range_list_fini(struct kfd_process *p)
 		svm_range_free(prange);
 	}
 
+	mutex_destroy(&p->svms.tlb_flush_lock);
 	mutex_destroy(&p->svms.lock);
 
 	pr_debug("pasid 0x%x svms 0x%p done\n", p->pasid, &p->svms);
@@ -2858,7 +3375,9 @@ int svm_range_list_init(struct kfd_process *p)
 	int i;
 
 	svms->objects = RB_ROOT_CACHED;
+	seqcount_init(&svms->objects_seq);
 	mutex_init(&svms->lock);
+	mutex_init(&svms->tlb_flush_lock);
 	INIT_LIST_HEAD(&svms->list);
 	atomic_set(&svms->evicted_ranges, 0);
 	atomic_set(&svms->drain_pagefaults, 0);
@@ -2866,6 +3385,7 @@ int svm_range_list_init(struct kfd_process *p)
 	INIT_WORK(&svms->deferred_list_work, svm_range_deferred_list_work);
 	INIT_LIST_HEAD(&svms->deferred_range_list);
 	spin_lock_init(&svms->deferred_list_lock);
+	svm_range_policy_init(&svms->policy);
 
 	for (i = 0; i < p->n_pdds; i++)
 		if (KFD_IS_SVM_API_SUPPORTED(p->pdds[i]->dev))
@@ -3032,7 +3552,7 @@ svm_range_best_prefetch_location(struct svm_range *prange)
 		if (pdd->dev->adev == bo_adev)
 			continue;
 
-		if (!amdgpu_xgmi_same_hive(pdd->dev->adev, bo_adev)) {
+		if (!test_bit(gpuidx, svm_range_xgmi_peers(prange, best_loc))) {
 			best_loc = 0;
 			break;
 		}
@@ -105,6 +105,7 @@ struct svm_work_list_item {
  */
 struct svm_range {
 	struct svm_range_list		*svms;
+	struct rcu_head			rcu;
 	struct mutex			migrate_mutex;
 	unsigned long			start;
 	unsigned long			last;
@@ -133,6 +134,13 @@ struct svm_range {
 	DECLARE_BITMAP(bitmap_access, MAX_GPU_INSTANCE);
 	DECLARE_BITMAP(bitmap_aip, MAX_GPU_INSTANCE);
 	bool				validated_once;
+	/* migration policy state, protected by migrate_mutex */
+	uint64_t			policy_window;
+	uint32_t			policy_migrations;
+	uint64_t			pinned_until;
+	/* GPUs mapping VRAM of xgmi_loc over XGMI, protected by svms lock */
+	DECLARE_BITMAP(bitmap_xgmi, MAX_GPU_INSTANCE);
+	uint32_t			xgmi_loc;
 };
 
 static inline void svm_range_lock(struct svm_range *prange)
@@ -171,8 +179,11 @@ void svm_range_vram_node_free(struct svm_range *prange);
 int svm_range_split_by_granularity(struct kfd_process *p, struct mm_struct *mm,
 			       unsigned long addr, struct svm_range *parent,
 			       struct svm_range *prange);
-int svm_range_restore_pages(struct amdgpu_device *adev,
-			    unsigned int pasid, uint64_t addr, bool write_fault);
+int svm_range_set_policy(struct kfd_process *p,
+			 struct kfd_ioctl_svm_policy_args *args);
+int svm_range_restore_pages(struct amdgpu_device *adev, unsigned int pasid,
+			    const uint64_t *addrs, unsigned int *count,
+			    bool write_fault);
 int svm_range_schedule_evict_svm_bo(struct amdgpu_amdkfd_fence *fence);
 void svm_range_add_list_work(struct svm_range_list *svms,
 			     struct svm_range *prange, struct mm_struct *mm,
@@ -207,9 +218,12 @@ static inline void svm_range_list_fini(struct kfd_process *p)
 }
 
 static inline int svm_range_restore_pages(struct amdgpu_device *adev,
-					  unsigned int pasid, uint64_t addr,
+					  unsigned int pasid,
+					  const uint64_t *addrs,
+					  unsigned int *count,
 					  bool write_fault)
 {
+	*count = 0;
 	return -EFAULT;
 }
 
@@ -37,6 +37,7 @@
 #include "kfd_device_queue_manager.h"
 #include "kfd_iommu.h"
 #include "kfd_svm.h"
+#include "kfd_migrate.h"
 #include "amdgpu_amdkfd.h"
 #include "amdgpu_ras.h"
 
@@ -289,6 +290,10 @@ static ssize_t iolink_show(struct kobject *kobj, struct attribute *attr,
 	sysfs_show_32bit_prop(buffer, offs, "recommended_transfer_size",
 			      iolink->rec_transfer_size);
 	sysfs_show_32bit_prop(buffer, offs, "flags", iolink->flags);
+	sysfs_show_32bit_prop(buffer, offs, "measured_bandwidth",
+			      iolink->measured_bandwidth);
+	sysfs_show_32bit_prop(buffer, offs, "measured_latency",
+			      iolink->measured_latency);
 
 	return offs;
 }
@@ -1275,6 +1280,91 @@ static void kfd_fill_iolink_non_crat_info(struct kfd_topology_device *dev)
 	}
 }
 
+/* Measure the link between the GPU and system memory with SDMA copies.
+ * The GPU to CPU link gets the VRAM to system memory numbers, the inbound
+ * CPU to GPU link the numbers of the opposite direction. Links that can't
+ * be measured keep 0.
+ */
+static void kfd_fill_iolink_perf_info(struct kfd_topology_device *dev)
+{
+	struct kfd_iolink_properties *link, *inbound_link;
+	struct kfd_topology_device *cpu_dev;
+	struct svm_migrate_link_perf perf;
+
+	if (!dev || !dev->gpu)
+		return;
+
+	if (svm_migrate_calibrate(dev->gpu->adev, &perf))
+		return;
+
+	list_for_each_entry(link, &dev->io_link_props, list) {
+		cpu_dev = kfd_topology_device_by_proximity_domain(
+				link->node_to);
+		if (!cpu_dev || cpu_dev->gpu)
+			continue;
+
+		link->measured_bandwidth = perf.d2h_bandwidth;
+		link->measured_latency = perf.latency;
+
+		list_for_each_entry(inbound_link, &cpu_dev->io_link_props,
+				    list) {
+			if (inbound_link->node_to != link->node_from)
+				continue;
+
+			inbound_link->measured_bandwidth = perf.h2d_bandwidth;
+			inbound_link->measured_latency = perf.latency;
+		}
+	}
+}
+
+/**
+ * kfd_topology_link_perf - look up the performance of a link
+ * @from: the GPU accessing the memory
+ * @to: the GPU owning the memory, NULL for system memory
+ * @bandwidth: returns the bandwidth in MB/s
+ * @latency: returns the latency in ns
+ *
+ * Returns the measured numbers if the link was calibrated, the maximum
+ * bandwidth and minimum latency reported by the CRAT otherwise.
+ *
+ * Return: 0 on success, -ENOENT if there is no direct link
+ */
+int kfd_topology_link_perf(struct kfd_dev *from, struct kfd_dev *to,
+			   uint32_t *bandwidth, uint32_t *latency)
+{
+	struct kfd_topology_device *dev, *from_dev = NULL;
+	struct kfd_iolink_properties *link;
+	int r = -ENOENT;
+
+	down_read(&topology_lock);
+
+	list_for_each_entry(dev, &topology_device_list, list)
+		if (dev->gpu == from) {
+			from_dev = dev;
+			break;
+		}
+	if (!from_dev)
+		goto out;
+
+	list_for_each_entry(link, &from_dev->io_link_props, list) {
+		list_for_each_entry(dev, &topology_device_list, list)
+			if (dev->proximity_domain == link->node_to)
+				break;
+		if (list_entry_is_head(dev, &topology_device_list, list) ||
+		    dev->gpu != to)
+			continue;
+
+		*bandwidth = link->measured_bandwidth ?: link->max_bandwidth;
+		*latency = link->measured_latency ?: link->min_latency;
+		r = 0;
+		break;
+	}
+
+out:
+	up_read(&topology_lock);
+	return r;
+}
+
 int kfd_topology_add_device(struct kfd_dev *gpu)
 {
 	uint32_t gpu_id;
@@ -1410,6 +1500,7 @@ int kfd_topology_add_device(struct kfd_dev *gpu)
 
 	kfd_fill_mem_clk_max_info(dev);
 	kfd_fill_iolink_non_crat_info(dev);
+	kfd_fill_iolink_perf_info(dev);
 
 	switch (dev->gpu->adev->asic_type) {
 	case CHIP_KAVERI:
@@ -1647,4 +1738,29 @@ int kfd_debugfs_rls_by_device(struct seq_file *m, void *data)
 	return r;
 }
 
+int kfd_debugfs_runlist_stats_by_device(struct seq_file *m, void *data)
+{
+	struct kfd_topology_device *dev;
+	unsigned int i = 0;
+	int r = 0;
+
+	down_read(&topology_lock);
+
+	list_for_each_entry(dev, &topology_device_list, list) {
+		if (!dev->gpu) {
+			i++;
+			continue;
+		}
+
+		seq_printf(m, "Node %u, gpu_id %x:\n", i++, dev->gpu->id);
+		r = dqm_debugfs_runlist_stats(m, dev->gpu->dqm);
+		if (r)
+			break;
+	}
+
+	up_read(&topology_lock);
+
+	return r;
+}
+
 #endif
@@ -108,6 +108,8 @@ struct kfd_iolink_properties {
 	uint32_t		max_bandwidth;
 	uint32_t		rec_transfer_size;
 	uint32_t		flags;
+	uint32_t		measured_bandwidth;
+	uint32_t		measured_latency;
 	struct kfd_dev		*gpu;
 	struct kobject		*kobj;
 	struct attribute	attr;
@@ -1329,6 +1329,175 @@ static bool dcn21_fast_validate_bw(
 	return out;
 }
 
+static unsigned int dcn21_bw_cache_pipe_mask(struct dc *dc,
+		struct dc_state *context)
+{
+	unsigned int mask = 0;
+	int i;
+
+	for (i = 0; i < dc->res_pool->pipe_count; i++)
+		if (context->res_ctx.pipe_ctx[i].stream)
+			mask |= 1 << i;
+
+	return mask;
+}
+
+static bool dcn21_bw_cache_match(struct dcn21_bw_cache_entry *entry,
+		struct dc *dc,
+		display_e2e_pipe_params_st *pipes,
+		int pipe_cnt,
+		int *pipe_split_from,
+		int vlevel,
+		unsigned int pipe_mask)
+{
+	return entry->valid &&
+		entry->pipe_cnt == pipe_cnt &&
+		entry->vlevel == vlevel &&
+		entry->pipe_mask == pipe_mask &&
+		!memcmp(entry->pipe_split_from, pipe_split_from,
+			sizeof(entry->pipe_split_from)) &&
+		!memcmp(&entry->bb_overrides, &dc->bb_overrides,
+			sizeof(entry->bb_overrides)) &&
+		!memcmp(entry->pipes, pipes, pipe_cnt * sizeof(*pipes));
+}
+
+/*
+ * Look up the watermarks, clocks and DLG parameters for the DML pipe
+ * parameters produced by dcn21_fast_validate_bw() and apply them to
+ * @context. On a miss a cache slot is claimed for the key and returned
+ * through @slot and @gen, to be filled by dcn21_bw_cache_store().
+ */
+static bool dcn21_bw_cache_lookup(struct dc *dc,
+		struct dc_state *context,
+		display_e2e_pipe_params_st *pipes,
+		int pipe_cnt,
+		int *pipe_split_from,
+		int vlevel,
+		unsigned int *slot,
+		unsigned int *gen)
+{
+	struct dcn21_bw_cache *cache = &TO_DCN21_RES_POOL(dc->res_pool)->bw_cache;
+	unsigned int pipe_mask = dcn21_bw_cache_pipe_mask(dc, context);
+	struct dcn21_bw_cache_entry *entry;
+	unsigned long flags;
+	int i, j;
+
+	spin_lock_irqsave(&cache->lock, flags);
+
+	for (i = 0; i < DCN21_BW_CACHE_SIZE; i++) {
+		entry = &cache->entries[i];
+		if (!dcn21_bw_cache_match(entry, dc, pipes, pipe_cnt,
+				pipe_split_from, vlevel, pipe_mask))
+			continue;
+
+		context->bw_ctx.bw.dcn.clk = entry->clk;
+		context->bw_ctx.bw.dcn.watermarks = entry->watermarks;
+		for (j = 0; j < dc->res_pool->pipe_count; j++) {
+			struct pipe_ctx *pipe = &context->res_ctx.pipe_ctx[j];
+
+			if (!pipe->stream)
+				continue;
+
+			pipe->dlg_regs = entry->pipe[j].dlg_regs;
+			pipe->ttu_regs = entry->pipe[j].ttu_regs;
+			pipe->rq_regs = entry->pipe[j].rq_regs;
+			pipe->pipe_dlg_param = entry->pipe[j].pipe_dlg_param;
+			pipe->plane_res.bw.dppclk_khz = entry->pipe[j].dppclk_khz;
+		}
+		cache->hits++;
+		spin_unlock_irqrestore(&cache->lock, flags);
+		return true;
+	}
+
+	cache->misses++;
+
+	/* claim the next slot round robin and record the key */
+	*slot = cache->next;
+	cache->next = (cache->next + 1) % DCN21_BW_CACHE_SIZE;
+	*gen = ++cache->gen;
+
+	entry = &cache->entries[*slot];
+	entry->valid = false;
+	entry->gen = *gen;
+	entry->pipe_cnt = pipe_cnt;
+	entry->vlevel = vlevel;
+	entry->pipe_mask = pipe_mask;
+	memcpy(entry->pipe_split_from, pipe_split_from,
+	       sizeof(entry->pipe_split_from));
+	entry->bb_overrides = dc->bb_overrides;
+	memset(entry->pipes, 0, sizeof(entry->pipes));
+	memcpy(entry->pipes, pipes, pipe_cnt * sizeof(*pipes));
+
+	spin_unlock_irqrestore(&cache->lock, flags);
+	return false;
+}
+
+/*
+ * Fill the slot claimed by dcn21_bw_cache_lookup() with the results of
+ * the full validation, unless it has been claimed again in the meantime.
+ */
+static void dcn21_bw_cache_store(struct dc *dc,
+		struct dc_state *context,
+		unsigned int slot,
+		unsigned int gen)
+{
+	struct dcn21_bw_cache *cache = &TO_DCN21_RES_POOL(dc->res_pool)->bw_cache;
+	struct dcn21_bw_cache_entry *entry = &cache->entries[slot];
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&cache->lock, flags);
+
+	if (entry->gen != gen)
+		goto out_unlock;
+
+	entry->clk = context->bw_ctx.bw.dcn.clk;
+	entry->watermarks = context->bw_ctx.bw.dcn.watermarks;
+	for (i = 0; i < dc->res_pool->pipe_count; i++) {
+		struct pipe_ctx *pipe = &context->res_ctx.pipe_ctx[i];
+
+		if (!pipe->stream)
+			continue;
+
+		entry->pipe[i].dlg_regs = pipe->dlg_regs;
+		entry->pipe[i].ttu_regs = pipe->ttu_regs;
+		entry->pipe[i].rq_regs = pipe->rq_regs;
+		entry->pipe[i].pipe_dlg_param = pipe->pipe_dlg_param;
+		entry->pipe[i].dppclk_khz = pipe->plane_res.bw.dppclk_khz;
+	}
+	entry->valid = true;
+
+out_unlock:
+	spin_unlock_irqrestore(&cache->lock, flags);
+}
+
+static void dcn21_bw_cache_invalidate(struct dcn21_resource_pool *pool)
+{
+	struct dcn21_bw_cache *cache = &pool->bw_cache;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	for (i = 0; i < DCN21_BW_CACHE_SIZE; i++) {
+		cache->entries[i].valid = false;
+		/* results of validations still running are dropped as well */
+		cache->entries[i].gen = 0;
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+}
+
+void dcn21_get_bw_cache_stats(struct resource_pool *pool,
+		unsigned long *hits, unsigned long *misses)
+{
+	struct dcn21_bw_cache *cache = &TO_DCN21_RES_POOL(pool)->bw_cache;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	*hits = cache->hits;
+	*misses = cache->misses;
+	spin_unlock_irqrestore(&cache->lock, flags);
+}
+
 static noinline bool dcn21_validate_bandwidth_fp(struct dc *dc,
 		struct dc_state *context, bool fast_validate)
 {
@@ -1339,6 +1508,7 @@ static noinline bool dcn21_validate_bandwidth_fp(struct dc *dc,
 	int vlevel = 0;
 	int pipe_split_from[MAX_PIPES];
 	int pipe_cnt = 0;
+	unsigned int slot, gen;
 	display_e2e_pipe_params_st *pipes = kzalloc(dc->res_pool->pipe_count * sizeof(display_e2e_pipe_params_st), GFP_ATOMIC);
 	DC_LOGGER_INIT(dc->ctx->logger);
 
@@ -1362,9 +1532,22 @@ static noinline bool dcn21_validate_bandwidth_fp(struct dc *dc,
 		goto validate_out;
 	}
 
+	/*
+	 * Identical pipe parameters after the voltage level and pipe split
+	 * decisions lead to identical watermarks and DLG parameters, reuse
+	 * them instead of running DML again.
+	 */
+	if (dcn21_bw_cache_lookup(dc, context, pipes, pipe_cnt,
+			pipe_split_from, vlevel, &slot, &gen)) {
+		BW_VAL_TRACE_END_WATERMARKS();
+		goto validate_out;
+	}
+
 	dcn21_calculate_wm(dc, context, pipes, &pipe_cnt, pipe_split_from, vlevel, fast_validate);
 	dcn20_calculate_dlg_params(dc, context, pipes, pipe_cnt, vlevel);
 
+	dcn21_bw_cache_store(dc, context, slot, gen);
+
 	BW_VAL_TRACE_END_WATERMARKS();
 
 	goto validate_out;
@@ -1644,6 +1827,9 @@ static void update_bw_bounding_box(struct dc *dc, struct clk_bw_params *bw_param
 	}
 
 	dml_init_instance(&dc->dml, &dcn2_1_soc, &dcn2_1_ip, DML_PROJECT_DCN21);
+
+	/* validated results depend on the bounding box */
+	dcn21_bw_cache_invalidate(pool);
 }
 
 static struct pp_smu_funcs *dcn21_pp_smu_create(struct dc_context *ctx)
@@ -1965,6 +2151,7 @@ static bool dcn21_resource_construct(
 #endif
 
 	pool->base.funcs = &dcn21_res_pool_funcs;
+	spin_lock_init(&pool->bw_cache.lock);
 
 	/*************************************************
 	 *  Resource + asic cap harcoding                *
@@ -35,11 +35,54 @@ struct dc;
 struct resource_pool;
 struct _vcs_dpi_display_pipe_params_st;
 
+#define DCN21_BW_CACHE_SIZE 4
+
+/*
+ * Watermarks, clocks and per pipe DLG parameters of a validated
+ * configuration, keyed on the DML pipe parameters that produced them.
+ */
+struct dcn21_bw_cache_entry {
+	bool valid;
+	unsigned int gen;
+
+	/* key */
+	int pipe_cnt;
+	int vlevel;
+	unsigned int pipe_mask;
+	int pipe_split_from[MAX_PIPES];
+	struct dc_bb_overrides bb_overrides;
+	display_e2e_pipe_params_st pipes[MAX_PIPES];
+
+	/* result */
+	struct dc_clocks clk;
+	struct dcn_watermark_set watermarks;
+	struct {
+		display_dlg_regs_st dlg_regs;
+		display_ttu_regs_st ttu_regs;
+		display_rq_regs_st rq_regs;
+		display_pipe_dest_params_st pipe_dlg_param;
+		int dppclk_khz;
+	} pipe[MAX_PIPES];
+};
+
+struct dcn21_bw_cache {
+	spinlock_t lock;
+	unsigned int gen;
+	unsigned int next;
+	unsigned long hits;
+	unsigned long misses;
+	struct dcn21_bw_cache_entry entries[DCN21_BW_CACHE_SIZE];
+};
+
 struct dcn21_resource_pool {
 	struct resource_pool base;
+	struct dcn21_bw_cache bw_cache;
 };
 struct resource_pool *dcn21_create_resource_pool(
 		const struct dc_init_data *init_data,
 		struct dc *dc);
 
+void dcn21_get_bw_cache_stats(struct resource_pool *pool,
+		unsigned long *hits, unsigned long *misses);
+
 #endif /* _DCN21_RESOURCE_H_ */
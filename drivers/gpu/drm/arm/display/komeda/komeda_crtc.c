@@ -82,6 +82,10 @@ komeda_crtc_atomic_check(struct drm_crtc *crtc,
 	struct komeda_crtc_state *kcrtc_st = to_kcrtc_st(crtc_state);
 	int err;
 
+	/* validated already, see komeda_reuse_data_flow() */
+	if (kcrtc_st->reuse_dflow)
+		return 0;
+
 	if (drm_atomic_crtc_needs_modeset(crtc_state))
 		komeda_crtc_update_clock_ratio(kcrtc_st);
 
@@ -217,6 +217,12 @@ static int komeda_kms_check(struct drm_device *dev,
 		err = komeda_crtc_normalize_zpos(crtc, new_crtc_st);
 		if (err)
 			return err;
+
+		err = komeda_reuse_data_flow(to_kcrtc(crtc), to_kcrtc_st(new_crtc_st));
+		if (err < 0)
+			return err;
+
+		to_kcrtc_st(new_crtc_st)->reuse_dflow = err > 0;
 	}
 
 	err = drm_atomic_helper_check_planes(dev, state);
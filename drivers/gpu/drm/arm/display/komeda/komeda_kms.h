@@ -112,6 +112,13 @@ struct komeda_crtc_state {
 
 	/** @max_slave_zorder: the maximum of slave zorder */
 	u32 max_slave_zorder;
+
+	/**
+	 * @reuse_dflow:
+	 * the data flow of the current state has been taken over, see
+	 * komeda_reuse_data_flow()
+	 */
+	bool reuse_dflow;
 };
 
 /** struct komeda_kms_dev - for gather KMS related things */
@@ -547,6 +547,9 @@ int komeda_build_wb_split_data_flow(struct komeda_layer *wb_layer,
 				    struct komeda_crtc_state *kcrtc_st,
 				    struct komeda_data_flow_cfg *dflow);
 
+int komeda_reuse_data_flow(struct komeda_crtc *kcrtc,
+			   struct komeda_crtc_state *kcrtc_st);
+
 int komeda_release_unclaimed_resources(struct komeda_pipeline *pipe,
 				       struct komeda_crtc_state *kcrtc_st);
 
@@ -1223,6 +1223,187 @@ int komeda_build_display_data_flow(struct komeda_crtc *kcrtc,
 	return 0;
 }
 
+static bool
+komeda_plane_is_flip_only(struct drm_plane_state *old, struct drm_plane_state *new)
+{
+	struct drm_framebuffer *old_fb = old->fb, *new_fb = new->fb;
+	int i;
+
+	if (!old_fb || !new_fb || old->crtc != new->crtc)
+		return false;
+
+	if (old_fb->format != new_fb->format ||
+	    old_fb->modifier != new_fb->modifier ||
+	    old_fb->width != new_fb->width ||
+	    old_fb->height != new_fb->height ||
+	    to_kfb(old_fb)->is_va != to_kfb(new_fb)->is_va)
+		return false;
+
+	for (i = 0; i < old_fb->format->num_planes; i++)
+		if (old_fb->pitches[i] != new_fb->pitches[i] ||
+		    old_fb->offsets[i] != new_fb->offsets[i])
+			return false;
+
+	return old->src_x == new->src_x && old->src_y == new->src_y &&
+	       old->src_w == new->src_w && old->src_h == new->src_h &&
+	       old->crtc_x == new->crtc_x && old->crtc_y == new->crtc_y &&
+	       old->crtc_w == new->crtc_w && old->crtc_h == new->crtc_h &&
+	       old->rotation == new->rotation &&
+	       old->alpha == new->alpha &&
+	       old->pixel_blend_mode == new->pixel_blend_mode &&
+	       old->color_encoding == new->color_encoding &&
+	       old->color_range == new->color_range &&
+	       old->normalized_zpos == new->normalized_zpos &&
+	       to_kplane_st(old)->layer_split == to_kplane_st(new)->layer_split;
+}
+
+/* only components bound to the crtc or its planes can be taken over */
+static bool
+komeda_component_user_is_reusable(struct komeda_component_state *st,
+				  struct drm_crtc_state *crtc_st)
+{
+	struct drm_plane *plane;
+
+	if (st->binding_user == crtc_st->crtc)
+		return true;
+
+	drm_for_each_plane_mask(plane, crtc_st->crtc->dev, crtc_st->plane_mask)
+		if (st->binding_user == plane)
+			return true;
+
+	return false;
+}
+
+static void
+komeda_layer_flip_addr(struct komeda_layer_state *st,
+		       struct drm_atomic_state *state)
+{
+	struct drm_plane *plane = st->base.plane;
+	struct komeda_fb *old_kfb, *new_kfb;
+	int i;
+
+	old_kfb = to_kfb(drm_atomic_get_old_plane_state(state, plane)->fb);
+	new_kfb = to_kfb(drm_atomic_get_new_plane_state(state, plane)->fb);
+
+	/* same format, pitches and offsets, only the buffer moved */
+	for (i = 0; i < new_kfb->base.format->num_planes; i++)
+		st->addr[i] += komeda_fb_get_pixel_addr(new_kfb, 0, 0, i) -
+			       komeda_fb_get_pixel_addr(old_kfb, 0, 0, i);
+}
+
+/**
+ * komeda_reuse_data_flow - take over the validated data flow of a crtc
+ * @kcrtc: the crtc
+ * @kcrtc_st: the new crtc state
+ *
+ * A commit which only flips the framebuffers of the planes on @kcrtc, with
+ * the same format, geometry and blending, results in the very same component
+ * graph the current state has been validated with. For such a commit bring
+ * the current component states into the new state and move the layer
+ * addresses to the new framebuffers, instead of building and validating the
+ * whole data flow again.
+ *
+ * RETURNS:
+ * 1 if the data flow has been reused, 0 if it needs to be built, or -errno
+ */
+int komeda_reuse_data_flow(struct komeda_crtc *kcrtc,
+			   struct komeda_crtc_state *kcrtc_st)
+{
+	struct drm_crtc_state *crtc_st = &kcrtc_st->base;
+	struct drm_atomic_state *state = crtc_st->state;
+	struct komeda_pipeline *pipes[] = { kcrtc->master, kcrtc->slave };
+	struct drm_plane_state *old_plane_st, *new_plane_st;
+	struct komeda_component_state *c_st, *old_c_st;
+	struct komeda_pipeline_state *pipe_st;
+	struct drm_connector_state *conn_st;
+	struct komeda_crtc_state *old_st;
+	struct drm_connector *conn;
+	struct komeda_component *c;
+	struct drm_plane *plane;
+	unsigned long comps;
+	int i, p;
+	u32 id;
+
+	old_st = to_kcrtc_st(drm_atomic_get_old_crtc_state(state, &kcrtc->base));
+
+	if (!crtc_st->active || drm_atomic_crtc_needs_modeset(crtc_st) ||
+	    crtc_st->color_mgmt_changed || !old_st->active_pipes ||
+	    crtc_st->plane_mask != old_st->base.plane_mask)
+		return 0;
+
+	/* writeback needs its own data flow */
+	for_each_new_connector_in_state(state, conn, conn_st, i)
+		if (conn_st->crtc == crtc_st->crtc && conn_st->writeback_job)
+			return 0;
+
+	drm_for_each_plane_mask(plane, crtc_st->crtc->dev, crtc_st->plane_mask) {
+		old_plane_st = drm_atomic_get_old_plane_state(state, plane);
+		new_plane_st = drm_atomic_get_new_plane_state(state, plane);
+		if (!old_plane_st || !new_plane_st ||
+		    !komeda_plane_is_flip_only(old_plane_st, new_plane_st))
+			return 0;
+	}
+
+	/* check everything before touching any state, to be able to fall back */
+	for (p = 0; p < ARRAY_SIZE(pipes); p++) {
+		if (!pipes[p] || !has_bit(pipes[p]->id, old_st->active_pipes))
+			continue;
+
+		if (komeda_pipeline_get_new_state(pipes[p], state))
+			return 0;
+
+		/* takes the pipeline lock which also covers its components */
+		pipe_st = komeda_pipeline_get_state(pipes[p], state);
+		if (IS_ERR(pipe_st))
+			return PTR_ERR(pipe_st);
+
+		pipe_st = komeda_pipeline_get_old_state(pipes[p], state);
+		if (pipe_st->crtc != crtc_st->crtc)
+			return 0;
+
+		comps = pipe_st->active_comps;
+		for_each_set_bit(id, &comps, 32) {
+			c = komeda_pipeline_get_component(pipes[p], id);
+			if (!komeda_component_user_is_reusable(priv_to_comp_st(c->obj.state),
+							       crtc_st))
+				return 0;
+		}
+	}
+
+	for (p = 0; p < ARRAY_SIZE(pipes); p++) {
+		if (!pipes[p] || !has_bit(pipes[p]->id, old_st->active_pipes))
+			continue;
+
+		comps = komeda_pipeline_get_old_state(pipes[p], state)->active_comps;
+
+		pipe_st = komeda_pipeline_get_state_and_set_crtc(pipes[p], state,
+								 crtc_st->crtc);
+		if (IS_ERR(pipe_st))
+			return PTR_ERR(pipe_st);
+
+		for_each_set_bit(id, &comps, 32) {
+			c = komeda_pipeline_get_component(pipes[p], id);
+			old_c_st = priv_to_comp_st(c->obj.state);
+
+			c_st = komeda_component_get_state_and_set_user(c, state,
+					old_c_st->binding_user, crtc_st->crtc);
+			if (IS_ERR(c_st))
+				return PTR_ERR(c_st);
+
+			/* inputs are unchanged, affected_inputs is already set */
+			c_st->active_inputs = old_c_st->active_inputs;
+
+			if (has_bit(id, KOMEDA_PIPELINE_LAYERS))
+				komeda_layer_flip_addr(to_layer_st(c_st), state);
+		}
+	}
+
+	DRM_DEBUG_ATOMIC("CRTC%d reuses the data flow of pipes: 0x%x.\n",
+			 drm_crtc_index(crtc_st->crtc), old_st->active_pipes);
+
+	return 1;
+}
+
 static void
 komeda_pipeline_unbound_components(struct komeda_pipeline *pipe,
 				   struct komeda_pipeline_state *new)
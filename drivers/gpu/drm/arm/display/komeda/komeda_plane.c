@@ -97,6 +97,10 @@ komeda_plane_atomic_check(struct drm_plane *plane,
 
 	kcrtc_st = to_kcrtc_st(crtc_st);
 
+	/* the layer states have been taken over with the crtc data flow */
+	if (kcrtc_st->reuse_dflow)
+		return 0;
+
 	err = komeda_plane_init_data_flow(new_plane_state, kcrtc_st, &dflow);
 	if (err)
 		return err;
@@ -30,6 +30,16 @@
 
 #include "gud_internal.h"
 
+/*
+ * Large updates are split into chunks of at most this size and the next
+ * chunk is converted and compressed while the previous one is transferred.
+ */
+#define GUD_PIPE_SLOT_LEN	SZ_1M
+
+static bool gud_pipelined_flush = true;
+module_param_named(pipelined_flush, gud_pipelined_flush, bool, 0444);
+MODULE_PARM_DESC(pipelined_flush, "Overlap conversion with the USB transfer [default=true]");
+
 /* Only used internally */
 static const struct drm_format_info gud_drm_format_r1 = {
 	.format = GUD_DRM_FORMAT_R1,
@@ -331,6 +341,8 @@ static int gud_stats_debugfs(struct seq_file *m, void *data)
 	string_get_size(gdrm->bulk_len, 1, STRING_UNITS_2, buf, sizeof(buf));
 	seq_printf(m, "Max buffer size: %s\n", buf);
 	seq_printf(m, "Number of errors:  %u\n", gdrm->stats_num_errors);
+	seq_printf(m, "Transfer slots:    %u (%zu bytes)\n", gdrm->num_slots, gdrm->slot_len);
+	seq_printf(m, "Pipelined chunks:  %u\n", gdrm->stats_num_pipelined);
 
 	seq_puts(m, "Compression:      ");
 	if (gdrm->compression & GUD_COMPRESSION_LZ4)
@@ -346,6 +358,7 @@ static int gud_stats_debugfs(struct seq_file *m, void *data)
 		u64 ratio_frac = div64_u64(remainder * 10, gdrm->stats_actual_length);
 
 		seq_printf(m, "Compression ratio: %llu.%llu\n", ratio, ratio_frac);
+		seq_printf(m, "Uncompressed chunks: %u\n", gdrm->stats_num_uncompressed);
 	}
 
 	return 0;
@@ -393,36 +406,89 @@ static const struct drm_driver gud_drm_driver = {
 	.minor			= 0,
 };
 
-static int gud_alloc_bulk_buffer(struct gud_device *gdrm)
+static int gud_alloc_bulk_buffer(void **buf, struct sg_table *sgt, size_t len)
 {
 	unsigned int i, num_pages;
 	struct page **pages;
 	void *ptr;
 	int ret;
 
-	gdrm->bulk_buf = vmalloc_32(gdrm->bulk_len);
-	if (!gdrm->bulk_buf)
+	*buf = vmalloc_32(len);
+	if (!*buf)
 		return -ENOMEM;
 
-	num_pages = DIV_ROUND_UP(gdrm->bulk_len, PAGE_SIZE);
+	num_pages = DIV_ROUND_UP(len, PAGE_SIZE);
 	pages = kmalloc_array(num_pages, sizeof(struct page *), GFP_KERNEL);
 	if (!pages)
 		return -ENOMEM;
 
-	for (i = 0, ptr = gdrm->bulk_buf; i < num_pages; i++, ptr += PAGE_SIZE)
+	for (i = 0, ptr = *buf; i < num_pages; i++, ptr += PAGE_SIZE)
 		pages[i] = vmalloc_to_page(ptr);
 
-	ret = sg_alloc_table_from_pages(&gdrm->bulk_sgt, pages, num_pages,
-					0, gdrm->bulk_len, GFP_KERNEL);
+	ret = sg_alloc_table_from_pages(sgt, pages, num_pages, 0, len, GFP_KERNEL);
 	kfree(pages);
 
 	return ret;
 }
 
+static int gud_alloc_bulk_slots(struct gud_device *gdrm)
+{
+	unsigned int i;
+	int ret;
+
+	ret = gud_alloc_bulk_buffer(&gdrm->bulk_buf, &gdrm->bulk_sgt, gdrm->bulk_len);
+	if (ret)
+		return ret;
+
+	if (gdrm->compression & GUD_COMPRESSION_LZ4) {
+		gdrm->compress_buf = vmalloc(gdrm->bulk_len);
+		if (!gdrm->compress_buf)
+			return -ENOMEM;
+	}
+
+	gdrm->slots[0].buf = gdrm->bulk_buf;
+	gdrm->slots[0].sgt = &gdrm->bulk_sgt;
+	gdrm->slots[0].compress_buf = gdrm->compress_buf;
+	gdrm->num_slots = 1;
+	gdrm->slot_len = gdrm->bulk_len;
+
+	/* A full update has to go out in one transfer */
+	if (gud_pipelined_flush && !(gdrm->flags & GUD_DISPLAY_FLAG_FULL_UPDATE)) {
+		gdrm->slot_len = min_t(size_t, gdrm->bulk_len, GUD_PIPE_SLOT_LEN);
+
+		ret = gud_alloc_bulk_buffer(&gdrm->pipe_buf, &gdrm->pipe_sgt, gdrm->slot_len);
+		if (ret)
+			return ret;
+
+		if (gdrm->compression & GUD_COMPRESSION_LZ4) {
+			gdrm->pipe_compress_buf = vmalloc(gdrm->slot_len);
+			if (!gdrm->pipe_compress_buf)
+				return -ENOMEM;
+		}
+
+		gdrm->slots[1].buf = gdrm->pipe_buf;
+		gdrm->slots[1].sgt = &gdrm->pipe_sgt;
+		gdrm->slots[1].compress_buf = gdrm->pipe_compress_buf;
+		gdrm->num_slots = 2;
+	}
+
+	for (i = 0; i < gdrm->num_slots; i++) {
+		gdrm->slots[i].gdrm = gdrm;
+		INIT_WORK(&gdrm->slots[i].work, gud_bulk_work);
+	}
+
+	return 0;
+}
+
 static void gud_free_buffers_and_mutex(void *data)
 {
 	struct gud_device *gdrm = data;
 
+	vfree(gdrm->pipe_compress_buf);
+	gdrm->pipe_compress_buf = NULL;
+	sg_free_table(&gdrm->pipe_sgt);
+	vfree(gdrm->pipe_buf);
+	gdrm->pipe_buf = NULL;
 	vfree(gdrm->compress_buf);
 	gdrm->compress_buf = NULL;
 	sg_free_table(&gdrm->bulk_sgt);
@@ -576,7 +642,7 @@ static int gud_probe(struct usb_interface *intf, const struct usb_device_id *id)
 	gdrm->bulk_pipe = usb_sndbulkpipe(interface_to_usbdev(intf), usb_endpoint_num(bulk_out));
 	gdrm->bulk_len = max_buffer_size;
 
-	ret = gud_alloc_bulk_buffer(gdrm);
+	ret = gud_alloc_bulk_slots(gdrm);
 	if (ret)
 		return ret;
 
@@ -584,10 +650,6 @@ static int gud_probe(struct usb_interface *intf, const struct usb_device_id *id)
 		gdrm->lz4_comp_mem = devm_kmalloc(dev, LZ4_MEM_COMPRESS, GFP_KERNEL);
 		if (!gdrm->lz4_comp_mem)
 			return -ENOMEM;
-
-		gdrm->compress_buf = vmalloc(gdrm->bulk_len);
-		if (!gdrm->compress_buf)
-			return -ENOMEM;
 	}
 
 	ret = drm_simple_display_pipe_init(drm, &gdrm->pipe, &gud_pipe_funcs,
@@ -13,6 +13,24 @@
 #include <drm/drm_modes.h>
 #include <drm/drm_simple_kms_helper.h>
 
+/* a transfer is prepared in one slot while the other one is on the bus */
+#define GUD_NUM_BULK_SLOTS	2
+
+struct gud_device;
+
+struct gud_bulk_slot {
+	struct gud_device *gdrm;
+	void *buf;
+	struct sg_table *sgt;
+	void *compress_buf;
+
+	struct gud_set_buffer_req req;
+	size_t trlen;
+
+	struct work_struct work;
+	int ret;
+};
+
 struct gud_device {
 	struct drm_device drm;
 	struct drm_simple_display_pipe pipe;
@@ -32,10 +50,23 @@ struct gud_device {
 	u8 compression;
 	void *lz4_comp_mem;
 	void *compress_buf;
+	/* chunks left to send uncompressed after a poor compression ratio */
+	unsigned int compress_backoff;
+
+	/* buffers of the second bulk slot */
+	void *pipe_buf;
+	struct sg_table pipe_sgt;
+	void *pipe_compress_buf;
+
+	struct gud_bulk_slot slots[GUD_NUM_BULK_SLOTS];
+	unsigned int num_slots;
+	size_t slot_len;
 
 	u64 stats_length;
 	u64 stats_actual_length;
 	unsigned int stats_num_errors;
+	unsigned int stats_num_uncompressed;
+	unsigned int stats_num_pipelined;
 
 	struct mutex ctrl_lock; /* Serialize get/set and status transfers */
 
@@ -62,6 +93,7 @@ int gud_usb_set_u8(struct gud_device *gdrm, u8 request, u8 val);
 
 void gud_clear_damage(struct gud_device *gdrm);
 void gud_flush_work(struct work_struct *work);
+void gud_bulk_work(struct work_struct *work);
 int gud_pipe_check(struct drm_simple_display_pipe *pipe,
 		   struct drm_plane_state *new_plane_state,
 		   struct drm_crtc_state *new_crtc_state);
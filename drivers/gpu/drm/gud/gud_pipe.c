@@ -36,6 +36,12 @@ static bool gud_async_flush = true;
 module_param_named(async_flush, gud_async_flush, bool, 0644);
 MODULE_PARM_DESC(async_flush, "Enable asynchronous flushing [default=true]");
 
+/*
+ * When LZ4 doesn't save at least 1/8 of a chunk the content is likely a
+ * video or photo, don't spend time compressing the next chunks then.
+ */
+#define GUD_COMPRESS_BACKOFF	8
+
 /*
  * FIXME: The driver is probably broken on Big Endian machines.
  * See discussion:
@@ -146,10 +152,11 @@ static size_t gud_xrgb8888_to_color(u8 *dst, const struct drm_format_info *forma
 	return len;
 }
 
-static int gud_prep_flush(struct gud_device *gdrm, struct drm_framebuffer *fb,
-			  const struct drm_format_info *format, struct drm_rect *rect,
-			  struct gud_set_buffer_req *req)
+static int gud_prep_flush(struct gud_device *gdrm, struct gud_bulk_slot *slot,
+			  struct drm_framebuffer *fb, const struct drm_format_info *format,
+			  struct drm_rect *rect)
 {
+	struct gud_set_buffer_req *req = &slot->req;
 	struct dma_buf_attachment *import_attach = fb->obj[0]->import_attach;
 	u8 compression = gdrm->compression;
 	struct dma_buf_map map[DRM_FORMAT_MAX_PLANES];
@@ -160,9 +167,15 @@ static int gud_prep_flush(struct gud_device *gdrm, struct drm_framebuffer *fb,
 
 	pitch = drm_format_info_min_pitch(format, 0, drm_rect_width(rect));
 	len = pitch * drm_rect_height(rect);
-	if (len > gdrm->bulk_len)
+	if (len > gdrm->slot_len)
 		return -E2BIG;
 
+	if (compression && gdrm->compress_backoff) {
+		gdrm->compress_backoff--;
+		gdrm->stats_num_uncompressed++;
+		compression = 0;
+	}
+
 	ret = drm_gem_fb_vmap(fb, map, map_data);
 	if (ret)
 		return ret;
@@ -174,9 +187,9 @@ static int gud_prep_flush(struct gud_device *gdrm, struct drm_framebuffer *fb,
 		goto vunmap;
 retry:
 	if (compression)
-		buf = gdrm->compress_buf;
+		buf = slot->compress_buf;
 	else
-		buf = gdrm->bulk_buf;
+		buf = slot->buf;
 
 	/*
 	 * Imported buffers are assumed to be write-combined and thus uncached
@@ -219,8 +232,11 @@ static int gud_prep_flush(struct gud_device *gdrm, struct drm_framebuffer *fb,
 	if (compression & GUD_COMPRESSION_LZ4) {
 		int complen;
 
-		complen = LZ4_compress_default(buf, gdrm->bulk_buf, len, len, gdrm->lz4_comp_mem);
+		complen = LZ4_compress_default(buf, slot->buf, len, len, gdrm->lz4_comp_mem);
+		if (complen <= 0 || complen > len - len / 8)
+			gdrm->compress_backoff = GUD_COMPRESS_BACKOFF;
 		if (complen <= 0) {
+			gdrm->stats_num_uncompressed++;
 			compression = 0;
 			goto retry;
 		}
@@ -249,13 +265,13 @@ static void gud_usb_bulk_timeout(struct timer_list *t)
 	usb_sg_cancel(&ctx->sgr);
 }
 
-static int gud_usb_bulk(struct gud_device *gdrm, size_t len)
+static int gud_usb_bulk(struct gud_device *gdrm, struct sg_table *sgt, size_t len)
 {
 	struct gud_usb_bulk_context ctx;
 	int ret;
 
 	ret = usb_sg_init(&ctx.sgr, gud_to_usb_device(gdrm), gdrm->bulk_pipe, 0,
-			  gdrm->bulk_sgt.sgl, gdrm->bulk_sgt.nents, len, GFP_KERNEL);
+			  sgt->sgl, sgt->nents, len, GFP_KERNEL);
 	if (ret)
 		return ret;
 
@@ -276,25 +292,48 @@ static int gud_usb_bulk(struct gud_device *gdrm, size_t len)
 	return ret;
 }
 
-static int gud_flush_rect(struct gud_device *gdrm, struct drm_framebuffer *fb,
-			  const struct drm_format_info *format, struct drm_rect *rect)
+void gud_bulk_work(struct work_struct *work)
 {
-	struct gud_set_buffer_req req;
+	struct gud_bulk_slot *slot = container_of(work, struct gud_bulk_slot, work);
+	struct gud_device *gdrm = slot->gdrm;
+
+	slot->ret = gud_usb_bulk(gdrm, slot->sgt, slot->trlen);
+	if (slot->ret)
+		gdrm->stats_num_errors++;
+}
+
+/*
+ * The protocol has no way of telling which buffer a bulk transfer belongs to,
+ * so SET_BUFFER and its transfer can't be interleaved with the next chunk.
+ * What can be overlapped is preparing the next chunk with the transfer of the
+ * one in @prev.
+ */
+static int gud_flush_rect(struct gud_device *gdrm, struct gud_bulk_slot *slot,
+			  struct drm_framebuffer *fb, const struct drm_format_info *format,
+			  struct drm_rect *rect, struct gud_bulk_slot *prev)
+{
+	struct gud_set_buffer_req *req = &slot->req;
 	size_t len, trlen;
 	int ret;
 
 	drm_dbg(&gdrm->drm, "Flushing [FB:%d] " DRM_RECT_FMT "\n", fb->base.id, DRM_RECT_ARG(rect));
 
-	ret = gud_prep_flush(gdrm, fb, format, rect, &req);
+	ret = gud_prep_flush(gdrm, slot, fb, format, rect);
+
+	if (prev) {
+		flush_work(&prev->work);
+		ret = prev->ret ?: ret;
+	}
 	if (ret)
 		return ret;
 
-	len = le32_to_cpu(req.length);
+	len = le32_to_cpu(req->length);
 
-	if (req.compression)
-		trlen = le32_to_cpu(req.compressed_length);
+	if (req->compression)
+		trlen = le32_to_cpu(req->compressed_length);
 	else
 		trlen = len;
+	slot->trlen = trlen;
 
 	gdrm->stats_length += len;
 	/* Did it wrap around? */
@@ -305,16 +344,20 @@ static int gud_flush_rect(struct gud_device *gdrm, struct drm_framebuffer *fb,
 	gdrm->stats_actual_length += trlen;
 
 	if (!(gdrm->flags & GUD_DISPLAY_FLAG_FULL_UPDATE) || gdrm->prev_flush_failed) {
-		ret = gud_usb_set(gdrm, GUD_REQ_SET_BUFFER, 0, &req, sizeof(req));
+		ret = gud_usb_set(gdrm, GUD_REQ_SET_BUFFER, 0, req, sizeof(*req));
 		if (ret)
 			return ret;
 	}
 
-	ret = gud_usb_bulk(gdrm, trlen);
-	if (ret)
-		gdrm->stats_num_errors++;
+	if (gdrm->num_slots > 1) {
+		gdrm->stats_num_pipelined++;
+		queue_work(system_long_wq, &slot->work);
+		return 0;
+	}
 
-	return ret;
+	gud_bulk_work(&slot->work);
+
+	return slot->ret;
 }
 
 void gud_clear_damage(struct gud_device *gdrm)
@@ -356,10 +399,24 @@ static void gud_retry_failed_flush(struct gud_device *gdrm, struct drm_framebuff
 	gdrm->prev_flush_failed = true;
 }
 
+static void gud_flush_failed(struct gud_device *gdrm, struct drm_framebuffer *fb,
+			     struct drm_rect *damage, int ret)
+{
+	bool prev_flush_failed = gdrm->prev_flush_failed;
+
+	if (ret == -ENODEV || ret == -ECONNRESET || ret == -ESHUTDOWN || ret == -EPROTO)
+		return;
+
+	gud_retry_failed_flush(gdrm, fb, damage);
+	if (!prev_flush_failed)
+		dev_err_ratelimited(fb->dev->dev, "Failed to flush framebuffer: error=%d\n", ret);
+}
+
 void gud_flush_work(struct work_struct *work)
 {
 	struct gud_device *gdrm = container_of(work, struct gud_device, work);
 	const struct drm_format_info *format;
+	struct gud_bulk_slot *slot, *prev = NULL;
 	struct drm_framebuffer *fb;
 	struct drm_rect damage;
 	unsigned int i, lines;
@@ -387,8 +444,8 @@ void gud_flush_work(struct work_struct *work)
 	pitch = drm_format_info_min_pitch(format, 0, drm_rect_width(&damage));
 	lines = drm_rect_height(&damage);
 
-	if (gdrm->bulk_len < lines * pitch)
-		lines = gdrm->bulk_len / pitch;
+	if (gdrm->slot_len < lines * pitch)
+		lines = gdrm->slot_len / pitch;
 
 	for (i = 0; i < DIV_ROUND_UP(drm_rect_height(&damage), lines); i++) {
 		struct drm_rect rect = damage;
@@ -396,23 +453,25 @@ void gud_flush_work(struct work_struct *work)
 		rect.y1 += i * lines;
 		rect.y2 = min_t(u32, rect.y1 + lines, damage.y2);
 
-		ret = gud_flush_rect(gdrm, fb, format, &rect);
+		slot = &gdrm->slots[i % gdrm->num_slots];
+		ret = gud_flush_rect(gdrm, slot, fb, format, &rect, prev);
+		prev = NULL;
 		if (ret) {
-			if (ret != -ENODEV && ret != -ECONNRESET &&
-			    ret != -ESHUTDOWN && ret != -EPROTO) {
-				bool prev_flush_failed = gdrm->prev_flush_failed;
-
-				gud_retry_failed_flush(gdrm, fb, &damage);
-				if (!prev_flush_failed)
-					dev_err_ratelimited(fb->dev->dev,
-							    "Failed to flush framebuffer: error=%d\n", ret);
-			}
+			gud_flush_failed(gdrm, fb, &damage, ret);
 			break;
 		}
 
+		if (gdrm->num_slots > 1)
+			prev = slot;
 		gdrm->prev_flush_failed = false;
 	}
 
+	if (prev) {
+		flush_work(&prev->work);
+		if (prev->ret)
+			gud_flush_failed(gdrm, fb, &damage, prev->ret);
+	}
+
 	drm_framebuffer_put(fb);
 out:
 	drm_dev_exit(idx);
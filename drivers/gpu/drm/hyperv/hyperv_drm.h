@@ -8,6 +8,8 @@
 
 #define VMBUS_MAX_PACKET_SIZE 0x4000
 
+#define HYPERV_MAX_DIRT_RECTS 8
+
 struct hyperv_drm_device {
 	/* drm */
 	struct drm_device dev;
@@ -31,6 +33,15 @@ struct hyperv_drm_device {
 	u32 mmio_megabytes;
 	bool dirt_needed;
 
+	/* damage coalesced until dirt_work sends it */
+	spinlock_t dirt_lock;
+	struct delayed_work dirt_work;
+	struct drm_rect dirt_rects[HYPERV_MAX_DIRT_RECTS];
+	unsigned int dirt_count;
+	/* host ring full, send whole frames at a lower rate */
+	unsigned int dirt_backoff;
+	struct drm_rect screen_rect;
+
 	u8 init_buf[VMBUS_MAX_PACKET_SIZE];
 	u8 recv_buf[VMBUS_MAX_PACKET_SIZE];
 
@@ -48,6 +59,7 @@ int hyperv_update_situation(struct hv_device *hdev, u8 active, u32 bpp,
 			    u32 w, u32 h, u32 pitch);
 int hyperv_hide_hw_ptr(struct hv_device *hdev);
 int hyperv_update_dirt(struct hv_device *hdev, struct drm_rect *rect);
+void hyperv_dirt_work(struct work_struct *work);
 int hyperv_connect_vsp(struct hv_device *hdev);
 
 #endif
@@ -172,6 +172,8 @@ static int hyperv_vmbus_probe(struct hv_device *hdev,
 
 	dev = &hv->dev;
 	init_completion(&hv->wait);
+	spin_lock_init(&hv->dirt_lock);
+	INIT_DELAYED_WORK(&hv->dirt_work, hyperv_dirt_work);
 	hv_set_drvdata(hdev, hv);
 	hv->hdev = hdev;
 
@@ -229,6 +231,7 @@ static int hyperv_vmbus_remove(struct hv_device *hdev)
 
 	drm_dev_unplug(dev);
 	drm_atomic_helper_shutdown(dev);
+	cancel_delayed_work_sync(&hv->dirt_work);
 	vmbus_close(hdev->channel);
 	hv_set_drvdata(hdev, NULL);
 
@@ -261,6 +264,7 @@ static int hyperv_vmbus_suspend(struct hv_device *hdev)
 	if (ret)
 		return ret;
 
+	cancel_delayed_work_sync(&to_hv(dev)->dirt_work);
 	vmbus_close(hdev->channel);
 
 	return 0;
@@ -6,8 +6,10 @@
  */
 
 #include <linux/hyperv.h>
+#include <linux/module.h>
 
 #include <drm/drm_print.h>
+#include <drm/drm_rect.h>
 #include <drm/drm_simple_kms_helper.h>
 
 #include "hyperv_drm.h"
@@ -29,6 +31,13 @@
 #define SYNTHVID_WIDTH_MAX_WIN7 1600
 #define SYNTHVID_HEIGHT_MAX_WIN7 1200
 
+#define HYPERV_DIRT_MAX_BACKOFF 3
+
+static unsigned int dirt_interval_ms = 10;
+module_param(dirt_interval_ms, uint, 0644);
+MODULE_PARM_DESC(dirt_interval_ms,
+		 "Time in ms to coalesce damage over before notifying the host, 0 = no delay (default: 10)");
+
 enum pipe_msg_type {
 	PIPE_MSG_INVALID,
 	PIPE_MSG_DATA,
@@ -146,7 +155,7 @@ struct rect {
 struct synthvid_dirt {
 	u8 video_output;
 	u8 dirt_count;
-	struct rect rect[1];
+	struct rect rect[HYPERV_MAX_DIRT_RECTS];
 } __packed;
 
 #define SYNTHVID_EDID_BLOCK_SIZE	128
@@ -207,7 +216,8 @@ static inline int hyperv_sendpacket(struct hv_device *hdev, struct synthvid_msg
 			       atomic64_inc_return(&request_id),
 			       VM_PKT_DATA_INBAND, 0);
 
-	if (ret)
+	/* a full ring is handled by the callers that can retry */
+	if (ret && ret != -EAGAIN)
 		drm_err(&hv->dev, "Unable to send packet via vmbus\n");
 
 	return ret;
@@ -277,6 +287,7 @@ int hyperv_update_vram_location(struct hv_device *hdev, phys_addr_t vram_pp)
 int hyperv_update_situation(struct hv_device *hdev, u8 active, u32 bpp,
 			    u32 w, u32 h, u32 pitch)
 {
+	struct hyperv_drm_device *hv = hv_get_drvdata(hdev);
 	struct synthvid_msg msg;
 
 	memset(&msg, 0, sizeof(struct synthvid_msg));
@@ -296,6 +307,9 @@ int hyperv_update_situation(struct hv_device *hdev, u8 active, u32 bpp,
 
 	hyperv_sendpacket(hdev, &msg);
 
+	if (active)
+		drm_rect_init(&hv->screen_rect, 0, 0, w, h);
+
 	return 0;
 }
 
@@ -348,27 +362,137 @@ int hyperv_hide_hw_ptr(struct hv_device *hdev)
 	return 0;
 }
 
-int hyperv_update_dirt(struct hv_device *hdev, struct drm_rect *rect)
+static int hyperv_send_dirt(struct hv_device *hdev,
+			    const struct drm_rect *rects, unsigned int count)
 {
-	struct hyperv_drm_device *hv = hv_get_drvdata(hdev);
 	struct synthvid_msg msg;
-
-	if (!hv->dirt_needed)
-		return 0;
+	unsigned int i;
 
 	memset(&msg, 0, sizeof(struct synthvid_msg));
 
 	msg.vid_hdr.type = SYNTHVID_DIRT;
 	msg.vid_hdr.size = sizeof(struct synthvid_msg_hdr) +
-		sizeof(struct synthvid_dirt);
+		offsetof(struct synthvid_dirt, rect) +
+		count * sizeof(struct rect);
 	msg.dirt.video_output = 0;
-	msg.dirt.dirt_count = 1;
-	msg.dirt.rect[0].x1 = rect->x1;
-	msg.dirt.rect[0].y1 = rect->y1;
-	msg.dirt.rect[0].x2 = rect->x2;
-	msg.dirt.rect[0].y2 = rect->y2;
+	msg.dirt.dirt_count = count;
+	for (i = 0; i < count; i++) {
+		msg.dirt.rect[i].x1 = rects[i].x1;
+		msg.dirt.rect[i].y1 = rects[i].y1;
+		msg.dirt.rect[i].x2 = rects[i].x2;
+		msg.dirt.rect[i].y2 = rects[i].y2;
+	}
 
-	hyperv_sendpacket(hdev, &msg);
+	return hyperv_sendpacket(hdev, &msg);
+}
+
+static bool hyperv_rect_touches(const struct drm_rect *a,
+				const struct drm_rect *b)
+{
+	return a->x1 <= b->x2 && b->x1 <= a->x2 &&
+	       a->y1 <= b->y2 && b->y1 <= a->y2;
+}
+
+static void hyperv_rect_union(struct drm_rect *a, const struct drm_rect *b)
+{
+	a->x1 = min(a->x1, b->x1);
+	a->y1 = min(a->y1, b->y1);
+	a->x2 = max(a->x2, b->x2);
+	a->y2 = max(a->y2, b->y2);
+}
+
+/* Called with dirt_lock held */
+static void hyperv_dirt_add(struct hyperv_drm_device *hv,
+			    const struct drm_rect *rect)
+{
+	unsigned int i;
+
+	for (i = 0; i < hv->dirt_count; i++) {
+		if (hyperv_rect_touches(&hv->dirt_rects[i], rect)) {
+			hyperv_rect_union(&hv->dirt_rects[i], rect);
+			return;
+		}
+	}
+
+	if (hv->dirt_count < HYPERV_MAX_DIRT_RECTS) {
+		hv->dirt_rects[hv->dirt_count++] = *rect;
+		return;
+	}
+
+	/* list is full, collapse everything into the bounding box */
+	for (i = 1; i < hv->dirt_count; i++)
+		hyperv_rect_union(&hv->dirt_rects[0], &hv->dirt_rects[i]);
+	hyperv_rect_union(&hv->dirt_rects[0], rect);
+	hv->dirt_count = 1;
+}
+
+/* Called with dirt_lock held */
+static void hyperv_dirt_schedule(struct hyperv_drm_device *hv)
+{
+	unsigned int delay = dirt_interval_ms;
+
+	/* back off exponentially while the host does not keep up */
+	if (hv->dirt_backoff)
+		delay = max(delay, 1U) << hv->dirt_backoff;
+
+	schedule_delayed_work(&hv->dirt_work, msecs_to_jiffies(delay));
+}
+
+void hyperv_dirt_work(struct work_struct *work)
+{
+	struct hyperv_drm_device *hv = container_of(to_delayed_work(work),
+						    struct hyperv_drm_device,
+						    dirt_work);
+	struct drm_rect rects[HYPERV_MAX_DIRT_RECTS];
+	unsigned int count, i;
+	int ret;
+
+	spin_lock(&hv->dirt_lock);
+	count = hv->dirt_count;
+	memcpy(rects, hv->dirt_rects, count * sizeof(*rects));
+	hv->dirt_count = 0;
+	if (count && hv->dirt_backoff) {
+		rects[0] = hv->screen_rect;
+		count = 1;
+	}
+	spin_unlock(&hv->dirt_lock);
+
+	if (!count || !hv->dirt_needed)
+		return;
+
+	ret = hyperv_send_dirt(hv->hdev, rects, count);
+
+	spin_lock(&hv->dirt_lock);
+	if (ret == -EAGAIN) {
+		/* keep the damage and retry with whole frames, less often */
+		hv->dirt_backoff = min(hv->dirt_backoff + 1,
+				       HYPERV_DIRT_MAX_BACKOFF);
+		for (i = 0; i < count; i++)
+			hyperv_dirt_add(hv, &rects[i]);
+		hyperv_dirt_schedule(hv);
+	} else if (hv->dirt_backoff) {
+		hv->dirt_backoff--;
+	}
+	spin_unlock(&hv->dirt_lock);
+}
+
+/*
+ * Damage is collected for dirt_interval_ms and then sent to the host as
+ * a single message with up to HYPERV_MAX_DIRT_RECTS rectangles. While the
+ * VMBus ring is full, the whole screen is reported instead and the
+ * interval is doubled, up to HYPERV_DIRT_MAX_BACKOFF times.
+ */
+int hyperv_update_dirt(struct hv_device *hdev, struct drm_rect *rect)
+{
+	struct hyperv_drm_device *hv = hv_get_drvdata(hdev);
+
+	if (!hv->dirt_needed)
+		return 0;
+
+	spin_lock(&hv->dirt_lock);
+	hyperv_dirt_add(hv, rect);
+	hyperv_dirt_schedule(hv);
+	spin_unlock(&hv->dirt_lock);
 
 	return 0;
 }
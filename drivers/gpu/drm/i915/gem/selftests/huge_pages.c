@@ -5,6 +5,7 @@
  */
 
 #include <linux/prime_numbers.h>
+#include <linux/sort.h>
 
 #include "i915_selftest.h"
 
@@ -1733,6 +1734,130 @@ int i915_gem_huge_page_mock_selftests(void)
 	return err;
 }
 
+static int wrap_ktime_compare(const void *A, const void *B)
+{
+	const ktime_t *a = A, *b = B;
+
+	return ktime_compare(*a, *b);
+}
+
+static int __perf_huge_page_bind(struct i915_address_space *vm,
+				 unsigned int page_size, u64 size)
+{
+	struct drm_i915_private *i915 = vm->i915;
+	struct drm_i915_gem_object *obj;
+	ktime_t alloc[5], bind[5];
+	unsigned int gtt = 0;
+	struct i915_vma *vma;
+	int pass, err;
+
+	obj = huge_pages_object(i915, size, page_size);
+	if (IS_ERR(obj))
+		return PTR_ERR(obj);
+
+	vma = i915_vma_instance(obj, vm, NULL);
+	if (IS_ERR(vma)) {
+		err = PTR_ERR(vma);
+		goto out_put;
+	}
+
+	for (pass = 0; pass < ARRAY_SIZE(alloc); pass++) {
+		ktime_t t0;
+
+		t0 = ktime_get();
+		err = i915_gem_object_pin_pages_unlocked(obj);
+		if (err)
+			goto out_put;
+		alloc[pass] = ktime_sub(ktime_get(), t0);
+
+		t0 = ktime_get();
+		err = i915_vma_pin(vma, 0, 0, PIN_USER);
+		bind[pass] = ktime_sub(ktime_get(), t0);
+		if (!err) {
+			gtt = vma->page_sizes.gtt;
+			i915_vma_unpin(vma);
+			err = i915_vma_unbind(vma);
+		}
+		if (err) {
+			i915_gem_object_unpin_pages(obj);
+			goto out_put;
+		}
+
+		i915_gem_object_lock(obj, NULL);
+		i915_gem_object_unpin_pages(obj);
+		__i915_gem_object_put_pages(obj);
+		i915_gem_object_unlock(obj);
+	}
+
+	sort(alloc, ARRAY_SIZE(alloc), sizeof(*alloc), wrap_ktime_compare, NULL);
+	sort(bind, ARRAY_SIZE(bind), sizeof(*bind), wrap_ktime_compare, NULL);
+	pr_info("huge_pages: page_size=0x%x gtt_page_sizes=0x%x size_kib=%llu alloc_ns=%llu bind_ns=%llu\n",
+		page_size, gtt, size >> 10,
+		(u64)(alloc[1] + 2 * alloc[2] + alloc[3]) >> 2,
+		(u64)(bind[1] + 2 * bind[2] + bind[3]) >> 2);
+
+out_put:
+	i915_gem_object_put(obj);
+	return err;
+}
+
+static int perf_huge_page_bind(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct i915_address_space *vm;
+	struct i915_gem_context *ctx;
+	struct file *file;
+	int i, err = 0;
+
+	file = mock_file(i915);
+	if (IS_ERR(file))
+		return PTR_ERR(file);
+
+	ctx = hugepage_ctx(i915, file);
+	if (IS_ERR(ctx)) {
+		err = PTR_ERR(ctx);
+		goto out;
+	}
+	vm = i915_gem_context_get_eb_vm(ctx);
+
+	/*
+	 * Compare the cost of populating and binding the same amount of
+	 * memory using 4K pages against 64K and 2M pages.
+	 */
+	for (i = ARRAY_SIZE(page_sizes) - 1; i >= 0; i--) {
+		if (!HAS_PAGE_SIZES(i915, page_sizes[i]))
+			continue;
+
+		err = __perf_huge_page_bind(vm, page_sizes[i], SZ_16M);
+		if (err == -ENOMEM || err == -ENOSPC)
+			err = 0;
+		if (err)
+			break;
+	}
+
+	i915_vm_put(vm);
+out:
+	fput(file);
+	return err;
+}
+
+int i915_gem_huge_page_perf_selftests(struct drm_i915_private *i915)
+{
+	static const struct i915_subtest tests[] = {
+		SUBTEST(perf_huge_page_bind),
+	};
+
+	if (!HAS_PPGTT(i915)) {
+		pr_info("PPGTT not supported, skipping perf-selftests\n");
+		return 0;
+	}
+
+	if (intel_gt_is_wedged(to_gt(i915)))
+		return 0;
+
+	return i915_live_subtests(tests, i915);
+}
+
 int i915_gem_huge_page_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
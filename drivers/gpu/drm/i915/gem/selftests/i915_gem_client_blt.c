@@ -3,6 +3,8 @@
  * Copyright © 2019 Intel Corporation
  */
 
+#include <linux/sort.h>
+
 #include "i915_selftest.h"
 
 #include "gt/intel_context.h"
@@ -393,7 +395,9 @@ tiled_blit(struct tiled_blits *t,
 }
 
 static struct tiled_blits *
-tiled_blits_create(struct intel_engine_cs *engine, struct rnd_state *prng)
+tiled_blits_create(struct intel_engine_cs *engine,
+		   int width, int height,
+		   struct rnd_state *prng)
 {
 	struct drm_mm_node hole;
 	struct tiled_blits *t;
@@ -410,7 +414,7 @@ tiled_blits_create(struct intel_engine_cs *engine, struct rnd_state *prng)
 		goto err_free;
 	}
 
-	hole_size = 2 * PAGE_ALIGN(WIDTH * HEIGHT * 4);
+	hole_size = 2 * PAGE_ALIGN(width * height * 4);
 	hole_size *= 2; /* room to maneuver */
 	hole_size += 2 * I915_GTT_MIN_ALIGNMENT;
 
@@ -431,7 +435,7 @@ tiled_blits_create(struct intel_engine_cs *engine, struct rnd_state *prng)
 	t->hole = hole.start + I915_GTT_MIN_ALIGNMENT;
 	pr_info("Using hole at %llx\n", t->hole);
 
-	err = tiled_blits_create_buffers(t, WIDTH, HEIGHT, prng);
+	err = tiled_blits_create_buffers(t, width, height, prng);
 	if (err)
 		goto err_put;
 
@@ -518,7 +522,7 @@ static int __igt_client_tiled_blits(struct intel_engine_cs *engine,
 	struct tiled_blits *t;
 	int err;
 
-	t = tiled_blits_create(engine, prng);
+	t = tiled_blits_create(engine, WIDTH, HEIGHT, prng);
 	if (IS_ERR(t))
 		return PTR_ERR(t);
 
@@ -586,6 +590,123 @@ static int igt_client_tiled_blits(void *arg)
 	} while (1);
 }
 
+static int wrap_ktime_compare(const void *A, const void *B)
+{
+	const ktime_t *a = A, *b = B;
+
+	return ktime_compare(*a, *b);
+}
+
+static int __perf_tiled_blits(struct intel_engine_cs *engine,
+			      int width, int height,
+			      struct rnd_state *prng)
+{
+	struct tiled_blits *t;
+	int tiling, err = 0;
+	u64 offset;
+
+	t = tiled_blits_create(engine, width, height, prng);
+	if (IS_ERR(t))
+		return PTR_ERR(t);
+
+	offset = PAGE_ALIGN(t->width * t->height * 4);
+	for (tiling = CLIENT_TILING_LINEAR; tiling <= CLIENT_TILING_Y; tiling++) {
+		struct blit_buffer *src = &t->buffers[0];
+		struct blit_buffer *dst = &t->buffers[1];
+		ktime_t times[5];
+		int pass;
+
+		src->tiling = tiling;
+		dst->tiling = tiling;
+
+		/* Warm up, binding the buffers at their final addresses */
+		err = tiled_blit(t, dst, t->hole + offset, src, t->hole);
+		if (err)
+			break;
+
+		for (pass = 0; pass < ARRAY_SIZE(times); pass++) {
+			ktime_t t0;
+
+			t0 = ktime_get();
+			err = tiled_blit(t, dst, t->hole + offset, src, t->hole);
+			if (err)
+				break;
+			times[pass] = ktime_sub(ktime_get(), t0);
+		}
+		if (err)
+			break;
+
+		sort(times, ARRAY_SIZE(times), sizeof(times[0]),
+		     wrap_ktime_compare, NULL);
+		pr_info("client_blt: engine=%s tiling=%s width=%d height=%d size_kib=%d dst=%s bandwidth_mib_s=%lld\n",
+			engine->name, repr_tiling(tiling), width, height,
+			width * height * 4 >> 10,
+			i915_gem_object_is_lmem(dst->vma->obj) ? "lmem" : "smem",
+			div64_u64(mul_u32_u32(4 * width * height * 4,
+					      1000 * 1000 * 1000),
+				  times[1] + 2 * times[2] + times[3]) >> 20);
+	}
+
+	tiled_blits_destroy(t);
+	return err;
+}
+
+static int perf_client_tiled_blits(void *arg)
+{
+	static const struct {
+		int width, height;
+	} sizes[] = {
+		{ 512, 32 },
+		{ 1024, 256 },
+		{ 2048, 1024 },
+		{ 4096, 2048 },
+	};
+	struct drm_i915_private *i915 = arg;
+	I915_RND_STATE(prng);
+	int inst = 0;
+
+	/* Test requires explicit BLT tiling controls */
+	if (GRAPHICS_VER(i915) < 4)
+		return 0;
+
+	if (bad_swizzling(i915)) /* Requires sane (sub-page) swizzling */
+		return 0;
+
+	do {
+		struct intel_engine_cs *engine;
+		int i, err = 0;
+
+		engine = intel_engine_lookup_user(i915,
+						  I915_ENGINE_CLASS_COPY,
+						  inst++);
+		if (!engine)
+			return 0;
+
+		for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+			err = __perf_tiled_blits(engine,
+						 sizes[i].width,
+						 sizes[i].height,
+						 &prng);
+			if (err == -ENODEV || err == -ENOSPC || err == -ENOMEM)
+				err = 0;
+			if (err)
+				return err;
+		}
+	} while (1);
+}
+
+int i915_gem_client_blt_perf_selftests(struct drm_i915_private *i915)
+{
+	static const struct i915_subtest tests[] = {
+		SUBTEST(perf_client_tiled_blits),
+	};
+
+	if (intel_gt_is_wedged(to_gt(i915)))
+		return 0;
+
+	return i915_live_subtests(tests, i915);
+}
+
 int i915_gem_client_blt_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
@@ -3,6 +3,8 @@
  * Copyright © 2020-2021 Intel Corporation
  */
 
+#include <linux/sort.h>
+
 #include "gt/intel_migrate.h"
 #include "gem/i915_gem_ttm_move.h"
 
@@ -249,6 +251,119 @@ static int igt_lmem_pages_failsafe_migrate(void *arg)
 	return ret;
 }
 
+static int wrap_ktime_compare(const void *A, const void *B)
+{
+	const ktime_t *a = A, *b = B;
+
+	return ktime_compare(*a, *b);
+}
+
+static int __perf_migrate_one(struct drm_i915_gem_object *obj,
+			      enum intel_region_id dst, ktime_t *dt)
+{
+	struct i915_gem_ww_ctx ww;
+	ktime_t t0 = 0;
+	int err;
+
+	for_i915_gem_ww(&ww, err, true) {
+		err = i915_gem_object_lock(obj, &ww);
+		if (err)
+			continue;
+
+		t0 = ktime_get();
+		err = i915_gem_object_migrate(obj, &ww, dst);
+		if (err)
+			continue;
+
+		err = i915_gem_object_pin_pages(obj);
+		if (err)
+			continue;
+
+		i915_gem_object_unpin_pages(obj);
+		err = i915_gem_object_wait_migration(obj, true);
+	}
+
+	if (dt)
+		*dt = ktime_sub(ktime_get(), t0);
+	return err;
+}
+
+static int __perf_migrate(struct intel_gt *gt, enum intel_region_id src,
+			  enum intel_region_id dst, resource_size_t sz)
+{
+	struct drm_i915_private *i915 = gt->i915;
+	struct drm_i915_gem_object *obj;
+	ktime_t t[5];
+	int pass, err;
+
+	obj = i915_gem_object_create_region(i915->mm.regions[src], sz, 0, 0);
+	if (IS_ERR(obj))
+		return PTR_ERR(obj);
+
+	/* Populate the backing store before the first move */
+	err = i915_gem_object_pin_pages_unlocked(obj);
+	if (err)
+		goto out;
+	i915_gem_object_unpin_pages(obj);
+
+	for (pass = 0; pass < ARRAY_SIZE(t); pass++) {
+		err = __perf_migrate_one(obj, dst, &t[pass]);
+		if (!err)
+			err = __perf_migrate_one(obj, src, NULL);
+		if (err)
+			goto out;
+	}
+
+	sort(t, ARRAY_SIZE(t), sizeof(*t), wrap_ktime_compare, NULL);
+	pr_info("gem_migrate: src=%s dst=%s size_kib=%llu bandwidth_mib_s=%lld\n",
+		i915->mm.regions[src]->name, i915->mm.regions[dst]->name,
+		(u64)sz >> 10,
+		div64_u64(mul_u32_u32(4 * sz, 1000 * 1000 * 1000),
+			  t[1] + 2 * t[2] + t[3]) >> 20);
+
+out:
+	i915_gem_object_put(obj);
+	return err;
+}
+
+static int perf_migrate(void *arg)
+{
+	static const resource_size_t sizes[] = {
+		SZ_4K,
+		SZ_64K,
+		SZ_2M,
+		SZ_64M,
+	};
+	struct intel_gt *gt = arg;
+	int i, err;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		err = __perf_migrate(gt, INTEL_REGION_SMEM, INTEL_REGION_LMEM,
+				     sizes[i]);
+		if (!err)
+			err = __perf_migrate(gt, INTEL_REGION_LMEM,
+					     INTEL_REGION_SMEM, sizes[i]);
+		if (err == -ENOSPC || err == -ENXIO || err == -ENOMEM)
+			err = 0;
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+int i915_gem_migrate_perf_selftests(struct drm_i915_private *i915)
+{
+	static const struct i915_subtest tests[] = {
+		SUBTEST(perf_migrate),
+	};
+
+	if (!HAS_LMEM(i915))
+		return 0;
+
+	return intel_gt_live_subtests(tests, to_gt(i915));
+}
+
 int i915_gem_migrate_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
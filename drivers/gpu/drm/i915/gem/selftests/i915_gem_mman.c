@@ -5,6 +5,7 @@
  */
 
 #include <linux/prime_numbers.h>
+#include <linux/sort.h>
 
 #include "gt/intel_engine_pm.h"
 #include "gt/intel_gpu_commands.h"
@@ -1410,6 +1411,123 @@ static int igt_mmap_revoke(void *arg)
 	return 0;
 }
 
+static int wrap_ktime_compare(const void *A, const void *B)
+{
+	const ktime_t *a = A, *b = B;
+
+	return ktime_compare(*a, *b);
+}
+
+static int __perf_mmap_faults(struct drm_i915_private *i915,
+			      struct drm_i915_gem_object *obj,
+			      enum i915_mmap_type type)
+{
+	unsigned long npages = obj->base.size >> PAGE_SHIFT;
+	ktime_t t[5];
+	int pass, err;
+	u64 offset;
+
+	if (!can_mmap(obj, type))
+		return 0;
+
+	/* Only time the faults, not the allocation of the backing store */
+	err = i915_gem_object_pin_pages_unlocked(obj);
+	if (err)
+		return err;
+
+	err = __assign_mmap_offset(obj, type, &offset, NULL);
+	if (err)
+		goto out_unpin;
+
+	for (pass = 0; pass < ARRAY_SIZE(t); pass++) {
+		unsigned long addr, i;
+		ktime_t t0;
+
+		addr = igt_mmap_offset(i915, offset, obj->base.size,
+				       PROT_WRITE, MAP_SHARED);
+		if (IS_ERR_VALUE(addr)) {
+			err = addr;
+			goto out_unpin;
+		}
+
+		t0 = ktime_get();
+		for (i = 0; i < npages; i++) {
+			u32 __user *ux = u64_to_user_ptr((u64)(addr + i * PAGE_SIZE));
+			u32 x;
+
+			if (get_user(x, ux)) {
+				err = -EFAULT;
+				break;
+			}
+		}
+		t[pass] = ktime_sub(ktime_get(), t0);
+
+		vm_munmap(addr, obj->base.size);
+		if (err)
+			goto out_unpin;
+	}
+
+	sort(t, ARRAY_SIZE(t), sizeof(*t), wrap_ktime_compare, NULL);
+	pr_info("gem_mmap: region=%s type=%s size_kib=%zu phys_page_sizes=0x%x fault_ns_per_page=%llu\n",
+		obj->mm.region->name, repr_mmap_type(type),
+		obj->base.size >> 10, obj->mm.page_sizes.phys,
+		div64_u64(t[1] + 2 * t[2] + t[3], 4 * npages));
+
+out_unpin:
+	i915_gem_object_unpin_pages(obj);
+	return err;
+}
+
+static int perf_mmap_faults(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct intel_memory_region *mr;
+	enum intel_region_id id;
+
+	for_each_memory_region(mr, i915, id) {
+		unsigned long sizes[] = {
+			SZ_2M,
+			SZ_64M,
+		};
+		int i;
+
+		for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+			struct drm_i915_gem_object *obj;
+			int err;
+
+			obj = __i915_gem_object_create_user(i915, sizes[i], &mr, 1);
+			if (obj == ERR_PTR(-ENODEV))
+				continue;
+
+			if (IS_ERR(obj))
+				return PTR_ERR(obj);
+
+			err = __perf_mmap_faults(i915, obj, I915_MMAP_TYPE_GTT);
+			if (err == 0)
+				err = __perf_mmap_faults(i915, obj, I915_MMAP_TYPE_WC);
+			if (err == 0)
+				err = __perf_mmap_faults(i915, obj, I915_MMAP_TYPE_FIXED);
+
+			i915_gem_object_put(obj);
+			if (err == -ENOSPC)
+				err = 0;
+			if (err)
+				return err;
+		}
+	}
+
+	return 0;
+}
+
+int i915_gem_mman_perf_selftests(struct drm_i915_private *i915)
+{
+	static const struct i915_subtest tests[] = {
+		SUBTEST(perf_mmap_faults),
+	};
+
+	return i915_subtests(tests, i915);
+}
+
 int i915_gem_mman_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
@@ -506,6 +506,13 @@ struct parser_exec_state {
 	bool is_ctx_wa;
 	bool is_init_ctx;
 
+	/* shadow of the current first level batch buffer if it is cacheable */
+	struct intel_vgpu_shadow_bb *cache_bb;
+	unsigned long cache_bb_gma;
+	unsigned long cache_bb_size;
+	/* a command of the batch buffer has effects beyond being audited */
+	bool cache_bb_tainted;
+
 	const struct cmd_info *info;
 
 	struct intel_vgpu_workload *workload;
@@ -834,9 +841,20 @@ static inline int cmd_length(struct parser_exec_state *s)
 
 /* do not remove this, some platform may need clflush here */
 #define patch_value(s, addr, val) do { \
+	(s)->cache_bb_tainted = true; \
 	*addr = val; \
 } while (0)
 
+/*
+ * The result of scanning a batch buffer can only be reused if the scan
+ * did nothing else than auditing it, e.g. patching the shadow, updating
+ * vregs or raising virtual events all have to be done again.
+ */
+static inline void taint_bb_cache(struct parser_exec_state *s)
+{
+	s->cache_bb_tainted = true;
+}
+
 static inline bool is_mocs_mmio(unsigned int offset)
 {
 	return ((offset >= 0xc800) && (offset <= 0xcff8)) ||
@@ -858,6 +876,7 @@ static int cmd_pdp_mmio_update_handler(struct parser_exec_state *s,
 	struct intel_vgpu_mm *mm;
 	u64 pdps[GEN8_3LVL_PDPES];
 
+	taint_bb_cache(s);
 	if (shadow_mm->ppgtt_mm.root_entry_type ==
 	    GTT_TYPE_PPGTT_ROOT_L4_ENTRY) {
 		pdps[0] = (u64)cmd_val(s, 2) << 32;
@@ -901,6 +920,7 @@ static int cmd_reg_handler(struct parser_exec_state *s,
 	if (is_init_ctx(s)) {
 		struct intel_gvt_mmio_info *mmio_info;
 
+		taint_bb_cache(s);
 		intel_gvt_mmio_set_cmd_accessible(gvt, offset);
 		mmio_info = intel_gvt_find_mmio_info(gvt, offset);
 		if (mmio_info && mmio_info->write)
@@ -959,8 +979,10 @@ static int cmd_reg_handler(struct parser_exec_state *s,
 		patch_value(s, cmd_ptr(s, index), VGT_PVINFO_PAGE);
 	}
 
-	if (is_mocs_mmio(offset))
+	if (is_mocs_mmio(offset)) {
+		taint_bb_cache(s);
 		*vreg = cmd_val(s, index + 1);
+	}
 
 	vreg_old = *vreg;
 
@@ -968,6 +990,7 @@ static int cmd_reg_handler(struct parser_exec_state *s,
 		u32 cmdval_new, cmdval;
 		struct intel_gvt_mmio_info *mmio_info;
 
+		taint_bb_cache(s);
 		cmdval = cmd_val(s, index + 1);
 
 		mmio_info = intel_gvt_find_mmio_info(gvt, offset);
@@ -1009,6 +1032,7 @@ static int cmd_reg_handler(struct parser_exec_state *s,
 	if (GRAPHICS_VER(s->engine->i915) == 9 &&
 	    intel_gvt_mmio_is_sr_in_ctx(gvt, offset) &&
 	    !strncmp(cmd, "lri", 3)) {
+		taint_bb_cache(s);
 		intel_gvt_hypervisor_read_gpa(s->vgpu,
 			s->workload->ring_context_gpa + 12, &ctx_sr_ctl, 4);
 		/* check inhibit context */
@@ -1219,9 +1243,11 @@ static int cmd_handler_pipe_control(struct parser_exec_state *s)
 	if (ret)
 		return ret;
 
-	if (cmd_val(s, 1) & PIPE_CONTROL_NOTIFY)
+	if (cmd_val(s, 1) & PIPE_CONTROL_NOTIFY) {
+		taint_bb_cache(s);
 		set_bit(cmd_interrupt_events[s->engine->id].pipe_control_notify,
 			s->workload->pending_events);
+	}
 	return 0;
 }
 
@@ -1238,6 +1264,282 @@ static int cmd_advance_default(struct parser_exec_state *s)
 	return ip_gma_advance(s, cmd_length(s));
 }
 
+/*
+ * Shadow batch buffer cache
+ *
+ * Guests submit the same privileged batch buffers again and again. Once a
+ * first level GGTT batch buffer has been audited without any command that
+ * needs per-submission handling, its verified shadow is kept together with
+ * the guest pages it was copied from. Those pages are write-protected, so
+ * as long as the guest neither writes them nor remaps the GGTT range the
+ * shadow can be executed again without copying and scanning the batch.
+ */
+struct bb_cache_page {
+	struct intel_vgpu *vgpu;
+	unsigned long gfn;
+	unsigned int refs;
+};
+
+struct bb_cache_entry {
+	struct list_head link;
+	const struct intel_engine_cs *engine;
+	unsigned long gma;
+	unsigned long size;
+	unsigned int num_pages;
+	unsigned long gfns[GVT_BB_CACHE_MAX_PAGES];
+	struct drm_i915_gem_object *obj;
+};
+
+static void bb_cache_invalidate_gfn(struct intel_vgpu *vgpu,
+				    unsigned long gfn);
+
+static int bb_cache_write_handler(struct intel_vgpu_page_track *page_track,
+				  u64 gpa, void *data, int bytes)
+{
+	struct bb_cache_page *page = page_track->priv_data;
+
+	bb_cache_invalidate_gfn(page->vgpu, page->gfn);
+	return 0;
+}
+
+static int bb_cache_get_page(struct intel_vgpu *vgpu, unsigned long gfn)
+{
+	struct intel_vgpu_page_track *track;
+	struct bb_cache_page *page;
+	int ret;
+
+	track = intel_vgpu_find_page_track(vgpu, gfn);
+	if (track) {
+		/* the page is already tracked for something else */
+		if (track->handler != bb_cache_write_handler)
+			return -EBUSY;
+
+		page = track->priv_data;
+		page->refs++;
+		return 0;
+	}
+
+	page = kzalloc(sizeof(*page), GFP_KERNEL);
+	if (!page)
+		return -ENOMEM;
+
+	page->vgpu = vgpu;
+	page->gfn = gfn;
+	page->refs = 1;
+
+	ret = intel_vgpu_register_page_track(vgpu, gfn,
+					     bb_cache_write_handler, page);
+	if (ret)
+		goto err_free;
+
+	ret = intel_vgpu_enable_page_track(vgpu, gfn);
+	if (ret)
+		goto err_unregister;
+
+	return 0;
+
+err_unregister:
+	intel_vgpu_unregister_page_track(vgpu, gfn);
+err_free:
+	kfree(page);
+	return ret;
+}
+
+static void bb_cache_put_page(struct intel_vgpu *vgpu, unsigned long gfn)
+{
+	struct intel_vgpu_page_track *track;
+	struct bb_cache_page *page;
+
+	track = intel_vgpu_find_page_track(vgpu, gfn);
+	if (WARN_ON(!track || track->handler != bb_cache_write_handler))
+		return;
+
+	page = track->priv_data;
+	if (--page->refs)
+		return;
+
+	intel_vgpu_unregister_page_track(vgpu, gfn);
+	kfree(page);
+}
+
+static void bb_cache_free_entry(struct intel_vgpu *vgpu,
+				struct bb_cache_entry *entry)
+{
+	unsigned int i;
+
+	for (i = 0; i < entry->num_pages; i++)
+		bb_cache_put_page(vgpu, entry->gfns[i]);
+
+	list_del(&entry->link);
+	vgpu->submission.bb_cache.num_entries--;
+	i915_gem_object_put(entry->obj);
+	kfree(entry);
+}
+
+static void bb_cache_invalidate_gfn(struct intel_vgpu *vgpu,
+				    unsigned long gfn)
+{
+	struct intel_vgpu_bb_cache *cache = &vgpu->submission.bb_cache;
+	struct bb_cache_entry *entry, *n;
+	unsigned int i;
+
+	list_for_each_entry_safe(entry, n, &cache->lru, link) {
+		for (i = 0; i < entry->num_pages; i++) {
+			if (entry->gfns[i] == gfn) {
+				bb_cache_free_entry(vgpu, entry);
+				break;
+			}
+		}
+	}
+}
+
+/* translate the GGTT range of a batch buffer into the guest pages behind it */
+static int bb_cache_get_gfns(struct parser_exec_state *s, unsigned long gma,
+			     unsigned long size, unsigned long *gfns,
+			     unsigned int *num_pages)
+{
+	unsigned long start = gma & I915_GTT_PAGE_MASK;
+	unsigned long gpa;
+	unsigned int i, n;
+
+	n = DIV_ROUND_UP(gma + size - start, I915_GTT_PAGE_SIZE);
+	if (n > GVT_BB_CACHE_MAX_PAGES)
+		return -E2BIG;
+
+	for (i = 0; i < n; i++) {
+		gpa = intel_vgpu_gma_to_gpa(s->vgpu->gtt.ggtt_mm,
+					    start + i * I915_GTT_PAGE_SIZE);
+		if (gpa == INTEL_GVT_INVALID_ADDR)
+			return -EFAULT;
+		gfns[i] = gpa >> PAGE_SHIFT;
+	}
+
+	*num_pages = n;
+	return 0;
+}
+
+static struct bb_cache_entry *bb_cache_lookup(struct parser_exec_state *s,
+					      unsigned long gma)
+{
+	struct intel_vgpu_bb_cache *cache = &s->vgpu->submission.bb_cache;
+	unsigned long gfns[GVT_BB_CACHE_MAX_PAGES];
+	struct bb_cache_entry *entry;
+	unsigned int num_pages;
+
+	list_for_each_entry(entry, &cache->lru, link) {
+		if (entry->engine != s->engine || entry->gma != gma)
+			continue;
+
+		/* the guest may have remapped the batch buffer in the GGTT */
+		if (bb_cache_get_gfns(s, gma, entry->size, gfns, &num_pages) ||
+		    num_pages != entry->num_pages ||
+		    memcmp(gfns, entry->gfns, num_pages * sizeof(gfns[0]))) {
+			bb_cache_free_entry(s->vgpu, entry);
+			return NULL;
+		}
+
+		list_move(&entry->link, &cache->lru);
+		return entry;
+	}
+	return NULL;
+}
+
+static void bb_cache_store(struct parser_exec_state *s)
+{
+	struct intel_vgpu_bb_cache *cache = &s->vgpu->submission.bb_cache;
+	struct bb_cache_entry *entry;
+	unsigned int i;
+	int ret;
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return;
+
+	ret = bb_cache_get_gfns(s, s->cache_bb_gma, s->cache_bb_size,
+				entry->gfns, &entry->num_pages);
+	if (ret)
+		goto err_free;
+
+	for (i = 0; i < entry->num_pages; i++) {
+		ret = bb_cache_get_page(s->vgpu, entry->gfns[i]);
+		if (ret)
+			goto err_put_pages;
+	}
+
+	entry->engine = s->engine;
+	entry->gma = s->cache_bb_gma;
+	entry->size = s->cache_bb_size;
+	entry->obj = i915_gem_object_get(s->cache_bb->obj);
+
+	if (cache->num_entries == GVT_BB_CACHE_MAX_ENTRIES)
+		bb_cache_free_entry(s->vgpu,
+				    list_last_entry(&cache->lru,
+						    struct bb_cache_entry,
+						    link));
+
+	list_add(&entry->link, &cache->lru);
+	cache->num_entries++;
+	return;
+
+err_put_pages:
+	while (i--)
+		bb_cache_put_page(s->vgpu, entry->gfns[i]);
+err_free:
+	kfree(entry);
+}
+
+/**
+ * intel_vgpu_init_bb_cache - initialize the shadow batch buffer cache
+ * @vgpu: a vGPU
+ *
+ */
+void intel_vgpu_init_bb_cache(struct intel_vgpu *vgpu)
+{
+	struct intel_vgpu_bb_cache *cache = &vgpu->submission.bb_cache;
+
+	INIT_LIST_HEAD(&cache->lru);
+	cache->num_entries = 0;
+}
+
+/**
+ * intel_vgpu_clean_bb_cache - drop all cached shadow batch buffers
+ * @vgpu: a vGPU
+ *
+ * This function is called with vgpu_lock held when the vGPU is reset or
+ * destroyed, it releases the cached shadows and their page tracks.
+ */
+void intel_vgpu_clean_bb_cache(struct intel_vgpu *vgpu)
+{
+	struct intel_vgpu_bb_cache *cache = &vgpu->submission.bb_cache;
+	struct bb_cache_entry *entry, *n;
+
+	list_for_each_entry_safe(entry, n, &cache->lru, link)
+		bb_cache_free_entry(vgpu, entry);
+}
+
+/**
+ * intel_vgpu_bb_cache_release_page - give up a page tracked by the cache
+ * @vgpu: a vGPU
+ * @track: the page track of @gfn
+ * @gfn: the gfn of guest page
+ *
+ * Drop the cached shadow batch buffers copied from @gfn, so the page track
+ * of @gfn becomes available to another user.
+ *
+ * Returns:
+ * True if @track belonged to the cache and has been released.
+ */
+bool intel_vgpu_bb_cache_release_page(struct intel_vgpu *vgpu,
+				      struct intel_vgpu_page_track *track,
+				      unsigned long gfn)
+{
+	if (track->handler != bb_cache_write_handler)
+		return false;
+
+	bb_cache_invalidate_gfn(vgpu, gfn);
+	return true;
+}
+
 static int cmd_handler_mi_batch_buffer_end(struct parser_exec_state *s)
 {
 	int ret;
@@ -1249,6 +1551,10 @@ static int cmd_handler_mi_batch_buffer_end(struct parser_exec_state *s)
 	} else if (s->buf_type == RING_BUFFER_CTX) {
 		ret = ip_gma_set(s, s->ring_tail);
 	} else {
+		if (s->cache_bb && !s->cache_bb_tainted)
+			bb_cache_store(s);
+		s->cache_bb = NULL;
+
 		s->buf_type = RING_BUFFER_INSTRUCTION;
 		s->buf_addr_type = GTT_BUFFER;
 		if (s->ret_ip_gma_ring >= s->ring_start + s->ring_size)
@@ -1739,9 +2045,11 @@ static int cmd_handler_mi_flush_dw(struct parser_exec_state *s)
 		}
 	}
 	/* Check notify bit */
-	if ((cmd_val(s, 0) & (1 << 8)))
+	if ((cmd_val(s, 0) & (1 << 8))) {
+		taint_bb_cache(s);
 		set_bit(cmd_interrupt_events[s->engine->id].mi_flush_dw,
 			s->workload->pending_events);
+	}
 	return ret;
 }
 
@@ -1965,6 +2273,13 @@ static int perform_bb_shadow(struct parser_exec_state *s)
 	else
 		bb->bb_offset = 0;
 
+	if (s->buf_type == BATCH_BUFFER_INSTRUCTION && !s->is_ctx_wa &&
+	    !bb->ppgtt && !s->cache_bb_tainted) {
+		s->cache_bb = bb;
+		s->cache_bb_gma = gma;
+		s->cache_bb_size = bb_size;
+	}
+
 	/*
 	 * ip_va saves the virtual address of the shadow batch buffer, while
 	 * ip_gma saves the graphics address of the original batch buffer.
@@ -1985,6 +2300,37 @@ static int perform_bb_shadow(struct parser_exec_state *s)
 	return ret;
 }
 
+static int reuse_cached_bb(struct parser_exec_state *s,
+			   struct bb_cache_entry *entry)
+{
+	struct intel_vgpu_shadow_bb *bb;
+
+	bb = kzalloc(sizeof(*bb), GFP_KERNEL);
+	if (!bb)
+		return -ENOMEM;
+
+	bb->obj = i915_gem_object_get(entry->obj);
+	i915_gem_object_lock(bb->obj, NULL);
+	bb->va = i915_gem_object_pin_map(bb->obj, I915_MAP_WB);
+	i915_gem_object_unlock(bb->obj);
+	if (IS_ERR(bb->va)) {
+		int ret = PTR_ERR(bb->va);
+
+		i915_gem_object_put(bb->obj);
+		kfree(bb);
+		return ret;
+	}
+
+	INIT_LIST_HEAD(&bb->list);
+	list_add(&bb->list, &s->workload->shadow_bb);
+
+	bb->bb_start_cmd_va = s->ip_va;
+	bb->bb_offset = s->ip_va - s->rb_va;
+
+	/* the shadow is already audited, return to the ring right away */
+	return cmd_handler_mi_batch_buffer_end(s);
+}
+
 static int cmd_handler_mi_batch_buffer_start(struct parser_exec_state *s)
 {
 	bool second_level;
@@ -2007,10 +2353,27 @@ static int cmd_handler_mi_batch_buffer_start(struct parser_exec_state *s)
 	if (s->buf_type == RING_BUFFER_INSTRUCTION) {
 		s->ret_ip_gma_ring = s->ip_gma + cmd_length(s) * sizeof(u32);
 		s->buf_type = BATCH_BUFFER_INSTRUCTION;
-	} else if (second_level) {
-		s->buf_type = BATCH_BUFFER_2ND_LEVEL;
-		s->ret_ip_gma_bb = s->ip_gma + cmd_length(s) * sizeof(u32);
-		s->ret_bb_va = s->ip_va + cmd_length(s) * sizeof(u32);
+		s->cache_bb = NULL;
+		s->cache_bb_tainted = false;
+
+		if (!s->is_ctx_wa && s->buf_addr_type == GTT_BUFFER &&
+		    batch_buffer_needs_scan(s)) {
+			unsigned long gma = get_gma_bb_from_cmd(s, 1);
+			struct bb_cache_entry *entry;
+
+			entry = gma == INTEL_GVT_INVALID_ADDR ? NULL :
+				bb_cache_lookup(s, gma);
+			if (entry)
+				return reuse_cached_bb(s, entry);
+		}
+	} else {
+		/* chained and nested batch buffers are not cached */
+		taint_bb_cache(s);
+		if (second_level) {
+			s->buf_type = BATCH_BUFFER_2ND_LEVEL;
+			s->ret_ip_gma_bb = s->ip_gma + cmd_length(s) * sizeof(u32);
+			s->ret_bb_va = s->ip_va + cmd_length(s) * sizeof(u32);
+		}
 	}
 
 	if (batch_buffer_needs_scan(s)) {
@@ -2852,6 +3215,8 @@ static int scan_workload(struct intel_vgpu_workload *workload)
 	s.rb_va = workload->shadow_ring_buffer_va;
 	s.workload = workload;
 	s.is_ctx_wa = false;
+	s.cache_bb = NULL;
+	s.cache_bb_tainted = false;
 
 	if (bypass_scan_mask & workload->engine->mask || gma_head == gma_tail)
 		return 0;
@@ -2900,6 +3265,8 @@ static int scan_wa_ctx(struct intel_shadow_wa_ctx *wa_ctx)
 	s.rb_va = wa_ctx->indirect_ctx.shadow_va;
 	s.workload = workload;
 	s.is_ctx_wa = true;
+	s.cache_bb = NULL;
+	s.cache_bb_tainted = false;
 
 	ret = ip_gma_set(&s, gma_head);
 	if (ret)
@@ -2929,6 +3296,23 @@ static int shadow_workload_ring_buffer(struct intel_vgpu_workload *workload)
 	gma_tail = workload->rb_start + workload->rb_tail;
 	gma_top = workload->rb_start + guest_rb_size;
 
+	/*
+	 * The per-engine scan buffer is only free for the first workload in
+	 * the queue, a workload shadowed ahead of time gets its own.
+	 */
+	if (!list_empty(&workload->list) &&
+	    !list_is_first(&workload->list,
+			   workload_q_head(vgpu, workload->engine))) {
+		workload->ring_scan_buffer = kvmalloc(workload->rb_len,
+						      GFP_KERNEL);
+		if (!workload->ring_scan_buffer) {
+			gvt_vgpu_err("fail to alloc ring scan buffer\n");
+			return -ENOMEM;
+		}
+		shadow_ring_buffer_va = workload->ring_scan_buffer;
+		goto copy;
+	}
+
 	if (workload->rb_len > s->ring_scan_buffer_size[workload->engine->id]) {
 		void *p;
 
@@ -2945,6 +3329,7 @@ static int shadow_workload_ring_buffer(struct intel_vgpu_workload *workload)
 
 	shadow_ring_buffer_va = s->ring_scan_buffer[workload->engine->id];
 
+copy:
 	/* get shadow ring buffer va */
 	workload->shadow_ring_buffer_va = shadow_ring_buffer_va;
 
@@ -3133,6 +3518,8 @@ void intel_gvt_update_reg_whitelist(struct intel_vgpu *vgpu)
 		s.workload = NULL;
 		s.is_ctx_wa = false;
 		s.is_init_ctx = true;
+		s.cache_bb = NULL;
+		s.cache_bb_tainted = false;
 
 		/* skipping the first RING_CTX_SIZE(0x50) dwords */
 		ret = ip_gma_set(&s, RING_CTX_SIZE);
@@ -3185,6 +3572,8 @@ int intel_gvt_scan_engine_context(struct intel_vgpu_workload *workload)
 	s.workload = workload;
 	s.is_ctx_wa = false;
 	s.is_init_ctx = false;
+	s.cache_bb = NULL;
+	s.cache_bb_tainted = false;
 
 	/* don't scan the first RING_CTX_SIZE(0x50) dwords, as it's ring
 	 * context
@@ -36,13 +36,25 @@
 #ifndef _GVT_CMD_PARSER_H_
 #define _GVT_CMD_PARSER_H_
 
+#include <linux/types.h>
+
 #define GVT_CMD_HASH_BITS 7
 
+#define GVT_BB_CACHE_MAX_ENTRIES 32
+#define GVT_BB_CACHE_MAX_PAGES 16
+
 struct intel_gvt;
 struct intel_shadow_wa_ctx;
 struct intel_vgpu;
+struct intel_vgpu_page_track;
 struct intel_vgpu_workload;
 
+/* audited shadows of guest batch buffers, most recently used first */
+struct intel_vgpu_bb_cache {
+	struct list_head lru;
+	unsigned int num_entries;
+};
+
 void intel_gvt_clean_cmd_parser(struct intel_gvt *gvt);
 
 int intel_gvt_init_cmd_parser(struct intel_gvt *gvt);
@@ -55,4 +67,10 @@ void intel_gvt_update_reg_whitelist(struct intel_vgpu *vgpu);
 
 int intel_gvt_scan_engine_context(struct intel_vgpu_workload *workload);
 
+void intel_vgpu_init_bb_cache(struct intel_vgpu *vgpu);
+void intel_vgpu_clean_bb_cache(struct intel_vgpu *vgpu);
+bool intel_vgpu_bb_cache_release_page(struct intel_vgpu *vgpu,
+				      struct intel_vgpu_page_track *track,
+				      unsigned long gfn);
+
 #endif
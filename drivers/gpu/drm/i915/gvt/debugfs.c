@@ -151,6 +151,84 @@ DEFINE_SIMPLE_ATTRIBUTE(vgpu_scan_nonprivbb_fops,
 			vgpu_scan_nonprivbb_get, vgpu_scan_nonprivbb_set,
 			"0x%llx\n");
 
+static int vgpu_sched_stats_show(struct seq_file *s, void *unused)
+{
+	struct intel_vgpu *vgpu = s->private;
+	ktime_t run_time, wait_time;
+
+	intel_vgpu_get_sched_stats(vgpu, &run_time, &wait_time);
+	seq_printf(s, "weight: %d\n", vgpu->sched_ctl.weight);
+	seq_printf(s, "cap: %u%%\n", vgpu->sched_ctl.cap);
+	seq_printf(s, "latency target: %u us\n", vgpu->sched_ctl.latency_target);
+	seq_printf(s, "run time: %lld us\n", ktime_to_us(run_time));
+	seq_printf(s, "wait time: %lld us\n", ktime_to_us(wait_time));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vgpu_sched_stats);
+
+static int
+vgpu_sched_cap_get(void *data, u64 *val)
+{
+	struct intel_vgpu *vgpu = (struct intel_vgpu *)data;
+
+	*val = vgpu->sched_ctl.cap;
+	return 0;
+}
+
+/*
+ * limit the vGPU to a percentage of the GPU time, 0 removes the limit.
+ * Only used by the wfq scheduling policy.
+ */
+static int
+vgpu_sched_cap_set(void *data, u64 val)
+{
+	struct intel_vgpu *vgpu = (struct intel_vgpu *)data;
+
+	if (val > 100)
+		return -EINVAL;
+
+	mutex_lock(&vgpu->gvt->sched_lock);
+	vgpu->sched_ctl.cap = val;
+	mutex_unlock(&vgpu->gvt->sched_lock);
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(vgpu_sched_cap_fops,
+			vgpu_sched_cap_get, vgpu_sched_cap_set,
+			"%llu\n");
+
+static int
+vgpu_sched_latency_target_get(void *data, u64 *val)
+{
+	struct intel_vgpu *vgpu = (struct intel_vgpu *)data;
+
+	*val = vgpu->sched_ctl.latency_target;
+	return 0;
+}
+
+/*
+ * set the longest time in us the vGPU should wait for the GPU once it has
+ * workloads pending, 0 removes the target. Only used by the wfq scheduling
+ * policy.
+ */
+static int
+vgpu_sched_latency_target_set(void *data, u64 val)
+{
+	struct intel_vgpu *vgpu = (struct intel_vgpu *)data;
+
+	if (val > USEC_PER_SEC)
+		return -EINVAL;
+
+	mutex_lock(&vgpu->gvt->sched_lock);
+	vgpu->sched_ctl.latency_target = val;
+	mutex_unlock(&vgpu->gvt->sched_lock);
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(vgpu_sched_latency_target_fops,
+			vgpu_sched_latency_target_get,
+			vgpu_sched_latency_target_set, "%llu\n");
+
 /**
  * intel_gvt_debugfs_add_vgpu - register debugfs entries for a vGPU
  * @vgpu: a vGPU
@@ -167,6 +245,18 @@ void intel_gvt_debugfs_add_vgpu(struct intel_vgpu *vgpu)
 			    &vgpu_mmio_diff_fops);
 	debugfs_create_file("scan_nonprivbb", 0644, vgpu->debugfs, vgpu,
 			    &vgpu_scan_nonprivbb_fops);
+	debugfs_create_file("sched_stats", 0444, vgpu->debugfs, vgpu,
+			    &vgpu_sched_stats_fops);
+	debugfs_create_file("sched_cap", 0644, vgpu->debugfs, vgpu,
+			    &vgpu_sched_cap_fops);
+	debugfs_create_file("sched_latency_target", 0644, vgpu->debugfs, vgpu,
+			    &vgpu_sched_latency_target_fops);
+	debugfs_create_ulong("oos_pages", 0444, vgpu->debugfs,
+			     &vgpu->gtt.oos_pages);
+	debugfs_create_ulong("oos_syncs", 0444, vgpu->debugfs,
+			     &vgpu->gtt.oos_syncs);
+	debugfs_create_ulong("trapped_pt_writes", 0444, vgpu->debugfs,
+			     &vgpu->gtt.trapped_writes);
 }
 
 /**
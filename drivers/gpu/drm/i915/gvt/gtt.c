@@ -33,6 +33,8 @@
  *
  */
 
+#include <linux/moduleparam.h>
+
 #include "i915_drv.h"
 #include "gvt.h"
 #include "i915_pvinfo.h"
@@ -44,7 +46,10 @@
 #define gvt_vdbg_mm(fmt, args...)
 #endif
 
-static bool enable_out_of_sync = false;
+static bool enable_out_of_sync = true;
+module_param_named(gvt_enable_out_of_sync, enable_out_of_sync, bool, 0400);
+MODULE_PARM_DESC(gvt_enable_out_of_sync,
+		 "Let guest writes to GVT-g leaf page tables go untrapped until the next workload (default: true)");
 static int preallocated_oos_pages = 8192;
 
 /*
@@ -793,6 +798,7 @@ static int ppgtt_write_protection_handler(
 	if (bytes != 4 && bytes != 8)
 		return -EINVAL;
 
+	spt->vgpu->gtt.trapped_writes++;
 	ret = ppgtt_handle_guest_write_page_table_bytes(spt, gpa, data, bytes);
 	if (ret)
 		return ret;
@@ -1427,6 +1433,10 @@ static int ppgtt_handle_guest_entry_add(struct intel_vgpu_ppgtt_spt *spt,
 	return ret;
 }
 
+static int ppgtt_handle_guest_write_page_table(
+		struct intel_vgpu_ppgtt_spt *spt,
+		struct intel_gvt_gtt_entry *we, unsigned long index);
+
 static int sync_oos_page(struct intel_vgpu *vgpu,
 		struct intel_vgpu_oos_page *oos_page)
 {
@@ -1441,24 +1451,29 @@ static int sync_oos_page(struct intel_vgpu *vgpu,
 	trace_oos_change(vgpu->id, "sync", oos_page->id,
 			 spt, spt->guest_page.type);
 
-	old.type = new.type = get_entry_type(spt->guest_page.type);
-	old.val64 = new.val64 = 0;
+	old.type = get_entry_type(spt->guest_page.type);
+	old.val64 = 0;
 
 	for (index = 0; index < (I915_GTT_PAGE_SIZE >>
 				info->gtt_entry_size_shift); index++) {
 		ops->get_entry(oos_page->mem, &old, index, false, 0, vgpu);
-		ops->get_entry(NULL, &new, index, true,
-			       spt->guest_page.gfn << PAGE_SHIFT, vgpu);
+		ppgtt_get_guest_entry(spt, &new, index);
 
 		if (old.val64 == new.val64
 			&& !test_and_clear_bit(index, spt->post_shadow_bitmap))
 			continue;
 
+		/* only every 16th entry of a 64K page table is used */
+		if (new.type == GTT_TYPE_PPGTT_PTE_64K_ENTRY &&
+		    (index % GTT_64K_PTE_STRIDE))
+			continue;
+
 		trace_oos_sync(vgpu->id, oos_page->id,
 				spt, spt->guest_page.type,
 				new.val64, index);
 
-		ret = ppgtt_populate_shadow_entry(vgpu, spt, index, &new);
+		/* also drops the mapping of the replaced entry */
+		ret = ppgtt_handle_guest_write_page_table(spt, &new, index);
 		if (ret)
 			return ret;
 
@@ -1479,12 +1494,16 @@ static int detach_oos_page(struct intel_vgpu *vgpu,
 	trace_oos_change(vgpu->id, "detach", oos_page->id,
 			 spt, spt->guest_page.type);
 
+	if (!list_empty(&oos_page->vm_list))
+		vgpu->gtt.oos_pages--;
+	list_del_init(&oos_page->vm_list);
+
+	spin_lock(&gvt->gtt.oos_page_lock);
 	spt->guest_page.write_cnt = 0;
 	spt->guest_page.oos_page = NULL;
 	oos_page->spt = NULL;
-
-	list_del_init(&oos_page->vm_list);
 	list_move_tail(&oos_page->list, &gvt->gtt.oos_page_free_list_head);
+	spin_unlock(&gvt->gtt.oos_page_lock);
 
 	return 0;
 }
@@ -1492,19 +1511,15 @@ static int detach_oos_page(struct intel_vgpu *vgpu,
 static int attach_oos_page(struct intel_vgpu_oos_page *oos_page,
 		struct intel_vgpu_ppgtt_spt *spt)
 {
-	struct intel_gvt *gvt = spt->vgpu->gvt;
 	int ret;
 
 	ret = intel_gvt_hypervisor_read_gpa(spt->vgpu,
 			spt->guest_page.gfn << I915_GTT_PAGE_SHIFT,
 			oos_page->mem, I915_GTT_PAGE_SIZE);
-	if (ret)
+	if (ret) {
+		detach_oos_page(spt->vgpu, oos_page);
 		return ret;
-
-	oos_page->spt = spt;
-	spt->guest_page.oos_page = oos_page;
-
-	list_move_tail(&oos_page->list, &gvt->gtt.oos_page_use_list_head);
+	}
 
 	trace_oos_change(spt->vgpu->id, "attach", oos_page->id,
 			 spt, spt->guest_page.type);
@@ -1523,31 +1538,65 @@ static int ppgtt_set_guest_page_sync(struct intel_vgpu_ppgtt_spt *spt)
 	trace_oos_change(spt->vgpu->id, "set page sync", oos_page->id,
 			 spt, spt->guest_page.type);
 
+	if (!list_empty(&oos_page->vm_list))
+		spt->vgpu->gtt.oos_pages--;
 	list_del_init(&oos_page->vm_list);
+	spt->vgpu->gtt.oos_syncs++;
 	return sync_oos_page(spt->vgpu, oos_page);
 }
 
 static int ppgtt_allocate_oos_page(struct intel_vgpu_ppgtt_spt *spt)
 {
-	struct intel_gvt *gvt = spt->vgpu->gvt;
-	struct intel_gvt_gtt *gtt = &gvt->gtt;
-	struct intel_vgpu_oos_page *oos_page = spt->guest_page.oos_page;
+	struct intel_vgpu *vgpu = spt->vgpu;
+	struct intel_gvt_gtt *gtt = &vgpu->gvt->gtt;
+	struct intel_vgpu_oos_page *oos_page, *victim;
 	int ret;
 
-	WARN(oos_page, "shadow PPGTT page has already has a oos page\n");
+	WARN(spt->guest_page.oos_page,
+	     "shadow PPGTT page has already has a oos page\n");
+
+	for (;;) {
+		oos_page = NULL;
+		victim = NULL;
+
+		spin_lock(&gtt->oos_page_lock);
+		if (!list_empty(&gtt->oos_page_free_list_head)) {
+			oos_page = list_first_entry(&gtt->oos_page_free_list_head,
+						    struct intel_vgpu_oos_page,
+						    list);
+			oos_page->spt = spt;
+			spt->guest_page.oos_page = oos_page;
+			list_move_tail(&oos_page->list,
+				       &gtt->oos_page_use_list_head);
+		} else {
+			/*
+			 * Only pages of this vGPU can be taken back, the
+			 * others are protected by their own vgpu_lock.
+			 */
+			list_for_each_entry(victim,
+					    &gtt->oos_page_use_list_head, list)
+				if (victim->spt->vgpu == vgpu)
+					break;
+			if (list_entry_is_head(victim,
+					       &gtt->oos_page_use_list_head,
+					       list))
+				victim = NULL;
+		}
+		spin_unlock(&gtt->oos_page_lock);
+
+		if (oos_page)
+			break;
+		if (!victim)
+			return -ENOSPC;
+
+		if (!list_empty(&victim->vm_list)) {
+			ret = ppgtt_set_guest_page_sync(victim->spt);
+			if (ret)
+				return ret;
+		}
+		detach_oos_page(vgpu, victim);
+	}
 
-	if (list_empty(&gtt->oos_page_free_list_head)) {
-		oos_page = container_of(gtt->oos_page_use_list_head.next,
-			struct intel_vgpu_oos_page, list);
-		ret = ppgtt_set_guest_page_sync(oos_page->spt);
-		if (ret)
-			return ret;
-		ret = detach_oos_page(spt->vgpu, oos_page);
-		if (ret)
-			return ret;
-	} else
-		oos_page = container_of(gtt->oos_page_free_list_head.next,
-			struct intel_vgpu_oos_page, list);
 	return attach_oos_page(oos_page, spt);
 }
 
@@ -1558,10 +1607,14 @@ static int ppgtt_set_guest_page_oos(struct intel_vgpu_ppgtt_spt *spt)
 	if (WARN(!oos_page, "shadow PPGTT page should have a oos page\n"))
 		return -EINVAL;
 
+	if (!list_empty(&oos_page->vm_list))
+		return 0;
+
 	trace_oos_change(spt->vgpu->id, "set page out of sync", oos_page->id,
 			 spt, spt->guest_page.type);
 
 	list_add_tail(&oos_page->vm_list, &spt->vgpu->gtt.oos_page_list_head);
+	spt->vgpu->gtt.oos_pages++;
 	return intel_vgpu_disable_page_track(spt->vgpu, spt->guest_page.gfn);
 }
 
@@ -1770,8 +1823,12 @@ static int ppgtt_handle_guest_write_page_table_bytes(
 				false, 0, vgpu);
 
 	if (can_do_out_of_sync(spt)) {
-		if (!spt->guest_page.oos_page)
-			ppgtt_allocate_oos_page(spt);
+		/* without a snapshot page the page simply stays in sync */
+		if (!spt->guest_page.oos_page &&
+		    ppgtt_allocate_oos_page(spt)) {
+			spt->guest_page.write_cnt = 0;
+			return 0;
+		}
 
 		ret = ppgtt_set_guest_page_oos(spt);
 		if (ret < 0)
@@ -2597,6 +2654,7 @@ static int setup_spt_oos(struct intel_gvt *gvt)
 
 	INIT_LIST_HEAD(&gtt->oos_page_free_list_head);
 	INIT_LIST_HEAD(&gtt->oos_page_use_list_head);
+	spin_lock_init(&gtt->oos_page_lock);
 
 	for (i = 0; i < preallocated_oos_pages; i++) {
 		oos_page = kzalloc(sizeof(*oos_page), GFP_KERNEL);
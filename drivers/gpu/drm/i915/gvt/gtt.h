@@ -97,6 +97,8 @@ struct intel_gvt_gtt {
 	void (*mm_free_page_table)(struct intel_vgpu_mm *mm);
 	struct list_head oos_page_use_list_head;
 	struct list_head oos_page_free_list_head;
+	/* protects the oos page lists and the owner of an oos page */
+	spinlock_t oos_page_lock;
 	struct mutex ppgtt_mm_lock;
 	struct list_head ppgtt_mm_lru_list_head;
 
@@ -216,6 +218,13 @@ struct intel_vgpu_gtt {
 	struct list_head oos_page_list_head;
 	struct list_head post_shadow_list_head;
 	struct intel_vgpu_scratch_pt scratch_pt[GTT_TYPE_MAX];
+
+	/* page tables currently out of sync */
+	unsigned long oos_pages;
+	/* out of sync page tables written back to the shadow */
+	unsigned long oos_syncs;
+	/* guest page table writes trapped by write-protection */
+	unsigned long trapped_writes;
 };
 
 int intel_vgpu_init_gtt(struct intel_vgpu *vgpu);
@@ -138,6 +138,10 @@ struct intel_vgpu_display {
 
 struct vgpu_sched_ctl {
 	int weight;
+	/* percentage of GPU time the vGPU may use, 0 for no cap */
+	unsigned int cap;
+	/* longest wait in us before the vGPU should run, 0 for none */
+	unsigned int latency_target;
 };
 
 enum {
@@ -166,6 +170,8 @@ struct intel_vgpu_submission {
 	DECLARE_BITMAP(tlb_handle_pending, I915_NUM_ENGINES);
 	void *ring_scan_buffer[I915_NUM_ENGINES];
 	int ring_scan_buffer_size[I915_NUM_ENGINES];
+	struct intel_vgpu_bb_cache bb_cache;
+	struct work_struct shadow_work;
 	const struct intel_vgpu_submission_ops *ops;
 	int virtual_submission_interface;
 	bool active;
@@ -53,8 +53,9 @@ int intel_vgpu_register_page_track(struct intel_vgpu *vgpu, unsigned long gfn,
 	struct intel_vgpu_page_track *track;
 	int ret;
 
+	/* pages only write-protected for cached batch buffers are given up */
 	track = intel_vgpu_find_page_track(vgpu, gfn);
-	if (track)
+	if (track && !intel_vgpu_bb_cache_release_page(vgpu, track, gfn))
 		return -EEXIST;
 
 	track = kzalloc(sizeof(*track), GFP_KERNEL);
@@ -31,9 +31,16 @@
  *
  */
 
+#include <linux/moduleparam.h>
+
 #include "i915_drv.h"
 #include "gvt.h"
 
+static char *gvt_sched_policy = "tbs";
+module_param(gvt_sched_policy, charp, 0400);
+MODULE_PARM_DESC(gvt_sched_policy,
+		 "GVT-g vGPU scheduling policy, \"tbs\" for time based scheduling (default) or \"wfq\" for weighted fair queueing");
+
 static bool vgpu_has_pending_workload(struct intel_vgpu *vgpu)
 {
 	enum intel_engine_id i;
@@ -60,6 +67,11 @@ struct vgpu_sched_data {
 	ktime_t sched_time;
 	ktime_t left_ts;
 	ktime_t allocated_ts;
+	/* weighted GPU time, used by the WFQ policy */
+	u64 vtime;
+	/* time the vGPU has been waiting with pending workloads */
+	ktime_t wait_start;
+	ktime_t wait_time;
 
 	struct vgpu_sched_ctl sched_ctl;
 };
@@ -84,9 +96,27 @@ static void vgpu_update_timeslice(struct intel_vgpu *vgpu, ktime_t cur_time)
 	delta_ts = ktime_sub(cur_time, vgpu_data->sched_in_time);
 	vgpu_data->sched_time = ktime_add(vgpu_data->sched_time, delta_ts);
 	vgpu_data->left_ts = ktime_sub(vgpu_data->left_ts, delta_ts);
+	vgpu_data->vtime += div_u64(delta_ts * GVT_SCHED_MAX_WEIGHT,
+				    vgpu->sched_ctl.weight);
 	vgpu_data->sched_in_time = cur_time;
 }
 
+/* start the wait time accounting of vGPUs which have workloads queued */
+static void vgpu_update_wait_time(struct gvt_sched_data *sched_data,
+				  ktime_t cur_time)
+{
+	struct intel_vgpu *current_vgpu = sched_data->gvt->scheduler.current_vgpu;
+	struct vgpu_sched_data *vgpu_data;
+
+	list_for_each_entry(vgpu_data, &sched_data->lru_runq_head, lru_list) {
+		if (vgpu_data->vgpu == current_vgpu || vgpu_data->wait_start)
+			continue;
+
+		if (vgpu_has_pending_workload(vgpu_data->vgpu))
+			vgpu_data->wait_start = cur_time;
+	}
+}
+
 #define GVT_TS_BALANCE_PERIOD_MS 100
 #define GVT_TS_BALANCE_STAGE_NUM 10
 
@@ -161,6 +191,11 @@ static void try_to_schedule_next_vgpu(struct intel_gvt *gvt)
 	vgpu_update_timeslice(scheduler->current_vgpu, cur_time);
 	vgpu_data = scheduler->next_vgpu->sched_data;
 	vgpu_data->sched_in_time = cur_time;
+	if (vgpu_data->wait_start) {
+		vgpu_data->wait_time = ktime_add(vgpu_data->wait_time,
+				ktime_sub(cur_time, vgpu_data->wait_start));
+		vgpu_data->wait_start = 0;
+	}
 
 	/* switch current vgpu */
 	scheduler->current_vgpu = scheduler->next_vgpu;
@@ -237,12 +272,11 @@ static void tbs_sched_func(struct gvt_sched_data *sched_data)
 		try_to_schedule_next_vgpu(gvt);
 }
 
-void intel_gvt_schedule(struct intel_gvt *gvt)
+static void tbs_schedule(struct intel_gvt *gvt)
 {
 	struct gvt_sched_data *sched_data = gvt->scheduler.sched_data;
 	ktime_t cur_time;
 
-	mutex_lock(&gvt->sched_lock);
 	cur_time = ktime_get();
 
 	if (test_and_clear_bit(INTEL_GVT_REQUEST_SCHED,
@@ -256,9 +290,8 @@ void intel_gvt_schedule(struct intel_gvt *gvt)
 	clear_bit(INTEL_GVT_REQUEST_EVENT_SCHED, (void *)&gvt->service_request);
 
 	vgpu_update_timeslice(gvt->scheduler.current_vgpu, cur_time);
+	vgpu_update_wait_time(sched_data, cur_time);
 	tbs_sched_func(sched_data);
-
-	mutex_unlock(&gvt->sched_lock);
 }
 
 static enum hrtimer_restart tbs_timer_fn(struct hrtimer *timer_data)
@@ -366,6 +399,11 @@ static void tbs_sched_stop_schedule(struct intel_vgpu *vgpu)
 
 	list_del_init(&vgpu_data->lru_list);
 	vgpu_data->active = false;
+	if (vgpu_data->wait_start) {
+		vgpu_data->wait_time = ktime_add(vgpu_data->wait_time,
+				ktime_sub(ktime_get(), vgpu_data->wait_start));
+		vgpu_data->wait_start = 0;
+	}
 }
 
 static struct intel_gvt_sched_policy_ops tbs_schedule_ops = {
@@ -375,14 +413,175 @@ static struct intel_gvt_sched_policy_ops tbs_schedule_ops = {
 	.clean_vgpu = tbs_sched_clean_vgpu,
 	.start_schedule = tbs_sched_start_schedule,
 	.stop_schedule = tbs_sched_stop_schedule,
+	.schedule = tbs_schedule,
 };
 
+/*
+ * Weighted fair queueing
+ *
+ * Every vGPU accumulates GPU time scaled by the inverse of its weight and
+ * the busy vGPU with the least weighted time runs next. A vGPU with a
+ * latency target is picked first when it has been waiting for nearly as
+ * long as its target, and a vGPU with a cap is not picked anymore once it
+ * has used its share of the current balance period.
+ */
+static void wfq_balance_caps(struct gvt_sched_data *sched_data)
+{
+	struct vgpu_sched_data *vgpu_data;
+	unsigned int cap;
+
+	list_for_each_entry(vgpu_data, &sched_data->lru_runq_head, lru_list) {
+		cap = vgpu_data->vgpu->sched_ctl.cap;
+		if (!cap)
+			continue;
+
+		vgpu_data->allocated_ts = ktime_divns(
+			ms_to_ktime(GVT_TS_BALANCE_PERIOD_MS) * cap, 100);
+		/* an overrun of the previous period is paid back */
+		vgpu_data->left_ts = min_t(ktime_t, vgpu_data->left_ts, 0) +
+				     vgpu_data->allocated_ts;
+	}
+}
+
+static struct intel_vgpu *wfq_find_vgpu(struct gvt_sched_data *sched_data,
+					ktime_t cur_time)
+{
+	struct vgpu_sched_data *vgpu_data, *fair = NULL, *urgent = NULL;
+	ktime_t deadline, urgent_deadline = KTIME_MAX;
+	u64 min_vtime = U64_MAX;
+
+	list_for_each_entry(vgpu_data, &sched_data->lru_runq_head, lru_list) {
+		struct vgpu_sched_ctl *ctl = &vgpu_data->vgpu->sched_ctl;
+
+		if (!vgpu_has_pending_workload(vgpu_data->vgpu))
+			continue;
+
+		if (ctl->cap && vgpu_data->left_ts <= 0)
+			continue;
+
+		if (ctl->latency_target && vgpu_data->wait_start) {
+			deadline = ktime_add_us(vgpu_data->wait_start,
+						ctl->latency_target);
+			if (ktime_before(deadline,
+					 ktime_add_ns(cur_time, sched_data->period)) &&
+			    ktime_before(deadline, urgent_deadline)) {
+				urgent = vgpu_data;
+				urgent_deadline = deadline;
+			}
+		}
+
+		if (vgpu_data->vtime < min_vtime) {
+			fair = vgpu_data;
+			min_vtime = vgpu_data->vtime;
+		}
+	}
+
+	if (!fair)
+		return NULL;
+
+	/* idle vGPUs don't save up GPU time for later */
+	list_for_each_entry(vgpu_data, &sched_data->lru_runq_head, lru_list) {
+		if (vgpu_data->vtime < min_vtime &&
+		    !vgpu_has_pending_workload(vgpu_data->vgpu))
+			vgpu_data->vtime = min_vtime;
+	}
+
+	return urgent ? urgent->vgpu : fair->vgpu;
+}
+
+static void wfq_schedule(struct intel_gvt *gvt)
+{
+	struct gvt_sched_data *sched_data = gvt->scheduler.sched_data;
+	struct intel_gvt_workload_scheduler *scheduler = &gvt->scheduler;
+	struct intel_vgpu *vgpu;
+	ktime_t cur_time;
+
+	cur_time = ktime_get();
+
+	if (test_and_clear_bit(INTEL_GVT_REQUEST_SCHED,
+				(void *)&gvt->service_request)) {
+		if (cur_time >= sched_data->expire_time) {
+			wfq_balance_caps(sched_data);
+			sched_data->expire_time = ktime_add_ms(
+				cur_time, GVT_TS_BALANCE_PERIOD_MS);
+		}
+	}
+	clear_bit(INTEL_GVT_REQUEST_EVENT_SCHED, (void *)&gvt->service_request);
+
+	vgpu_update_timeslice(scheduler->current_vgpu, cur_time);
+	vgpu_update_wait_time(sched_data, cur_time);
+
+	/* no active vgpu or has already had a target */
+	if (list_empty(&sched_data->lru_runq_head) || scheduler->next_vgpu)
+		goto out;
+
+	vgpu = wfq_find_vgpu(sched_data, cur_time);
+	scheduler->next_vgpu = vgpu ? vgpu : gvt->idle_vgpu;
+out:
+	if (scheduler->next_vgpu)
+		try_to_schedule_next_vgpu(gvt);
+}
+
+static void wfq_sched_start_schedule(struct intel_vgpu *vgpu)
+{
+	struct gvt_sched_data *sched_data = vgpu->gvt->scheduler.sched_data;
+	struct vgpu_sched_data *vgpu_data = vgpu->sched_data;
+	struct vgpu_sched_data *pos;
+	u64 min_vtime = U64_MAX;
+
+	if (!list_empty(&vgpu_data->lru_list))
+		return;
+
+	/* start at the weighted time of the others instead of overtaking them */
+	list_for_each_entry(pos, &sched_data->lru_runq_head, lru_list)
+		min_vtime = min(min_vtime, pos->vtime);
+	vgpu_data->vtime = min_vtime == U64_MAX ? 0 : min_vtime;
+
+	if (vgpu->sched_ctl.cap) {
+		vgpu_data->allocated_ts = ktime_divns(
+			ms_to_ktime(GVT_TS_BALANCE_PERIOD_MS) *
+			vgpu->sched_ctl.cap, 100);
+		vgpu_data->left_ts = vgpu_data->allocated_ts;
+	}
+
+	list_add_tail(&vgpu_data->lru_list, &sched_data->lru_runq_head);
+
+	if (!hrtimer_active(&sched_data->timer))
+		hrtimer_start(&sched_data->timer, ktime_add_ns(ktime_get(),
+			sched_data->period), HRTIMER_MODE_ABS);
+	vgpu_data->active = true;
+}
+
+static struct intel_gvt_sched_policy_ops wfq_schedule_ops = {
+	.init = tbs_sched_init,
+	.clean = tbs_sched_clean,
+	.init_vgpu = tbs_sched_init_vgpu,
+	.clean_vgpu = tbs_sched_clean_vgpu,
+	.start_schedule = wfq_sched_start_schedule,
+	.stop_schedule = tbs_sched_stop_schedule,
+	.schedule = wfq_schedule,
+};
+
+void intel_gvt_schedule(struct intel_gvt *gvt)
+{
+	mutex_lock(&gvt->sched_lock);
+	gvt->scheduler.sched_ops->schedule(gvt);
+	mutex_unlock(&gvt->sched_lock);
+}
+
 int intel_gvt_init_sched_policy(struct intel_gvt *gvt)
 {
+	struct intel_gvt_sched_policy_ops *ops = &tbs_schedule_ops;
 	int ret;
 
+	if (!strcmp(gvt_sched_policy, "wfq"))
+		ops = &wfq_schedule_ops;
+	else if (strcmp(gvt_sched_policy, "tbs"))
+		gvt_err("unknown scheduling policy %s, using tbs\n",
+			gvt_sched_policy);
+
 	mutex_lock(&gvt->sched_lock);
-	gvt->scheduler.sched_ops = &tbs_schedule_ops;
+	gvt->scheduler.sched_ops = ops;
 	ret = gvt->scheduler.sched_ops->init(gvt);
 	mutex_unlock(&gvt->sched_lock);
 
@@ -433,6 +632,32 @@ void intel_vgpu_start_schedule(struct intel_vgpu *vgpu)
 	mutex_unlock(&vgpu->gvt->sched_lock);
 }
 
+/**
+ * intel_vgpu_get_sched_stats - get the scheduling statistics of a vGPU
+ * @vgpu: a vGPU
+ * @run_time: returns the time the vGPU owned the GPU
+ * @wait_time: returns the time the vGPU waited with pending workloads
+ *
+ */
+void intel_vgpu_get_sched_stats(struct intel_vgpu *vgpu,
+				ktime_t *run_time, ktime_t *wait_time)
+{
+	struct vgpu_sched_data *vgpu_data = vgpu->sched_data;
+	ktime_t cur_time;
+
+	mutex_lock(&vgpu->gvt->sched_lock);
+	cur_time = ktime_get();
+	*run_time = vgpu_data->sched_time;
+	if (vgpu->gvt->scheduler.current_vgpu == vgpu)
+		*run_time = ktime_add(*run_time,
+				      ktime_sub(cur_time, vgpu_data->sched_in_time));
+	*wait_time = vgpu_data->wait_time;
+	if (vgpu_data->wait_start)
+		*wait_time = ktime_add(*wait_time,
+				       ktime_sub(cur_time, vgpu_data->wait_start));
+	mutex_unlock(&vgpu->gvt->sched_lock);
+}
+
 void intel_gvt_kick_schedule(struct intel_gvt *gvt)
 {
 	mutex_lock(&gvt->sched_lock);
@@ -34,9 +34,14 @@
 #ifndef __GVT_SCHED_POLICY__
 #define __GVT_SCHED_POLICY__
 
+#include <linux/ktime.h>
+
 struct intel_gvt;
 struct intel_vgpu;
 
+/* highest weight of a vGPU */
+#define GVT_SCHED_MAX_WEIGHT 16
+
 struct intel_gvt_sched_policy_ops {
 	int (*init)(struct intel_gvt *gvt);
 	void (*clean)(struct intel_gvt *gvt);
@@ -44,6 +49,7 @@ struct intel_gvt_sched_policy_ops {
 	void (*clean_vgpu)(struct intel_vgpu *vgpu);
 	void (*start_schedule)(struct intel_vgpu *vgpu);
 	void (*stop_schedule)(struct intel_vgpu *vgpu);
+	void (*schedule)(struct intel_gvt *gvt);
 };
 
 void intel_gvt_schedule(struct intel_gvt *gvt);
@@ -62,4 +68,7 @@ void intel_vgpu_stop_schedule(struct intel_vgpu *vgpu);
 
 void intel_gvt_kick_schedule(struct intel_gvt *gvt);
 
+void intel_vgpu_get_sched_stats(struct intel_vgpu *vgpu,
+				ktime_t *run_time, ktime_t *wait_time);
+
 #endif
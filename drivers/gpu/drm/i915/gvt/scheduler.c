@@ -492,13 +492,17 @@ int intel_gvt_scan_and_shadow_workload(struct intel_vgpu_workload *workload)
 	if (workload->shadow)
 		return 0;
 
+	/* don't retry on top of the leftovers of a failed shadow */
+	if (workload->shadow_error)
+		return workload->shadow_error;
+
 	if (!test_and_set_bit(workload->engine->id, s->shadow_ctx_desc_updated))
 		shadow_context_descriptor_update(s->shadow[workload->engine->id],
 						 workload);
 
 	ret = intel_gvt_scan_and_shadow_ringbuffer(workload);
 	if (ret)
-		return ret;
+		goto err;
 
 	if (workload->engine->id == RCS0 &&
 	    workload->wa_ctx.indirect_ctx.size) {
@@ -512,9 +516,44 @@ int intel_gvt_scan_and_shadow_workload(struct intel_vgpu_workload *workload)
 
 err_shadow:
 	release_shadow_wa_ctx(&workload->wa_ctx);
+err:
+	workload->shadow_error = ret;
 	return ret;
 }
 
+/*
+ * Shadow the queued workloads of a vGPU while the GPU is busy with other
+ * workloads, so that dispatching them only pins and submits. Failures are
+ * left to be reported by the dispatch of the workload.
+ */
+static void shadow_queued_workloads(struct work_struct *work)
+{
+	struct intel_vgpu *vgpu = container_of(work, struct intel_vgpu,
+					       submission.shadow_work);
+	struct intel_vgpu_workload *workload;
+	struct intel_engine_cs *engine;
+	intel_wakeref_t wakeref;
+	enum intel_engine_id id;
+
+	mutex_lock(&vgpu->vgpu_lock);
+	if (!vgpu->active)
+		goto out;
+
+	wakeref = intel_runtime_pm_get(vgpu->gvt->gt->uncore->rpm);
+	for_each_engine(engine, vgpu->gvt->gt, id) {
+		list_for_each_entry(workload, workload_q_head(vgpu, engine),
+				    list) {
+			if (workload->shadow || workload->shadow_error)
+				continue;
+
+			intel_gvt_scan_and_shadow_workload(workload);
+		}
+	}
+	intel_runtime_pm_put(vgpu->gvt->gt->uncore->rpm, wakeref);
+out:
+	mutex_unlock(&vgpu->vgpu_lock);
+}
+
 static void release_shadow_batch_buffer(struct intel_vgpu_workload *workload);
 
 static int prepare_shadow_batch_buffer(struct intel_vgpu_workload *workload)
@@ -1251,6 +1290,11 @@ void intel_gvt_clean_workload_scheduler(struct intel_gvt *gvt)
 					&gvt->shadow_ctx_notifier_block[i]);
 		kthread_stop(scheduler->thread[i]);
 	}
+
+	if (scheduler->shadow_wq) {
+		destroy_workqueue(scheduler->shadow_wq);
+		scheduler->shadow_wq = NULL;
+	}
 }
 
 int intel_gvt_init_workload_scheduler(struct intel_gvt *gvt)
@@ -1264,6 +1308,10 @@ int intel_gvt_init_workload_scheduler(struct intel_gvt *gvt)
 
 	init_waitqueue_head(&scheduler->workload_complete_wq);
 
+	scheduler->shadow_wq = alloc_workqueue("gvt-shadow", WQ_UNBOUND, 0);
+	if (!scheduler->shadow_wq)
+		return -ENOMEM;
+
 	for_each_engine(engine, gvt->gt, i) {
 		init_waitqueue_head(&scheduler->waitq[i]);
 
@@ -1320,6 +1368,7 @@ void intel_vgpu_clean_submission(struct intel_vgpu *vgpu)
 	enum intel_engine_id id;
 
 	intel_vgpu_select_submission_ops(vgpu, ALL_ENGINES, 0);
+	intel_vgpu_clean_bb_cache(vgpu);
 
 	i915_context_ppgtt_root_restore(s, i915_vm_to_ppgtt(s->shadow[0]->vm));
 	for_each_engine(engine, vgpu->gvt->gt, id)
@@ -1346,6 +1395,7 @@ void intel_vgpu_reset_submission(struct intel_vgpu *vgpu,
 		return;
 
 	intel_vgpu_clean_workloads(vgpu, engine_mask);
+	intel_vgpu_clean_bb_cache(vgpu);
 	s->ops->reset(vgpu, engine_mask);
 }
 
@@ -1431,6 +1481,8 @@ int intel_vgpu_setup_submission(struct intel_vgpu *vgpu)
 
 	atomic_set(&s->running_workload_num, 0);
 	bitmap_zero(s->tlb_handle_pending, I915_NUM_ENGINES);
+	intel_vgpu_init_bb_cache(vgpu);
+	INIT_WORK(&s->shadow_work, shadow_queued_workloads);
 
 	memset(s->last_ctx, 0, sizeof(s->last_ctx));
 
@@ -1533,6 +1585,7 @@ void intel_vgpu_destroy_workload(struct intel_vgpu_workload *workload)
 	if (workload->shadow_mm)
 		intel_vgpu_mm_put(workload->shadow_mm);
 
+	kvfree(workload->ring_scan_buffer);
 	kmem_cache_free(s->workloads, workload);
 }
 
@@ -1745,8 +1798,8 @@ intel_vgpu_create_workload(struct intel_vgpu *vgpu,
 		return ERR_PTR(ret);
 	}
 
-	/* Only scan and shadow the first workload in the queue
-	 * as there is only one pre-allocated buf-obj for shadow.
+	/* Only scan and shadow the first workload in the queue right away,
+	 * the later ones are shadowed ahead of time by the shadow worker.
 	 */
 	if (list_empty(q)) {
 		intel_wakeref_t wakeref;
@@ -1777,8 +1830,13 @@ intel_vgpu_create_workload(struct intel_vgpu *vgpu,
  */
 void intel_vgpu_queue_workload(struct intel_vgpu_workload *workload)
 {
+	struct intel_gvt *gvt = workload->vgpu->gvt;
+
 	list_add_tail(&workload->list,
 		      workload_q_head(workload->vgpu, workload->engine));
-	intel_gvt_kick_schedule(workload->vgpu->gvt);
-	wake_up(&workload->vgpu->gvt->scheduler.waitq[workload->engine->id]);
+	if (!workload->shadow)
+		queue_work(gvt->scheduler.shadow_wq,
+			   &workload->vgpu->submission.shadow_work);
+	intel_gvt_kick_schedule(gvt);
+	wake_up(&gvt->scheduler.waitq[workload->engine->id]);
 }
@@ -55,6 +55,9 @@ struct intel_gvt_workload_scheduler {
 	struct task_struct *thread[I915_NUM_ENGINES];
 	wait_queue_head_t waitq[I915_NUM_ENGINES];
 
+	/* shadows queued workloads ahead of their dispatch */
+	struct workqueue_struct *shadow_wq;
+
 	void *sched_data;
 	struct intel_gvt_sched_policy_ops *sched_ops;
 };
@@ -89,6 +92,7 @@ struct intel_vgpu_workload {
 	/* if this workload has been dispatched to i915? */
 	bool dispatched;
 	bool shadow;      /* if workload has done shadow of guest request */
+	int shadow_error; /* if shadowing the guest request has failed */
 	int status;
 
 	struct intel_vgpu_mm *shadow_mm;
@@ -101,6 +105,8 @@ struct intel_vgpu_workload {
 
 	DECLARE_BITMAP(pending_events, INTEL_GVT_EVENT_MAX);
 	void *shadow_ring_buffer_va;
+	/* ring scan buffer of a workload shadowed ahead of time */
+	void *ring_scan_buffer;
 
 	/* execlist context information */
 	struct execlist_ctx_descriptor_format ctx_desc;
@@ -73,7 +73,7 @@ void populate_pvinfo_page(struct intel_vgpu *vgpu)
 	drm_WARN_ON(&i915->drm, sizeof(struct vgt_if) != VGT_PVINFO_SIZE);
 }
 
-#define VGPU_MAX_WEIGHT 16
+#define VGPU_MAX_WEIGHT GVT_SCHED_MAX_WEIGHT
 #define VGPU_WEIGHT(vgpu_num)	\
 	(VGPU_MAX_WEIGHT / (vgpu_num))
 
@@ -277,6 +277,9 @@ void intel_gvt_destroy_vgpu(struct intel_vgpu *vgpu)
 
 	drm_WARN(&i915->drm, vgpu->active, "vGPU is still active!\n");
 
+	/* nothing queues shadow work for an inactive vGPU */
+	cancel_work_sync(&vgpu->submission.shadow_work);
+
 	/*
 	 * remove idr first so later clean can judge if need to stop
 	 * service if no active vgpu.
@@ -14,6 +14,7 @@
 #include "lima_device.h"
 #include "lima_drv.h"
 #include "lima_gem.h"
+#include "lima_pp.h"
 #include "lima_vm.h"
 
 int lima_sched_timeout_ms;
@@ -68,6 +69,10 @@ static int lima_ioctl_get_param(struct drm_device *dev, void *data, struct drm_f
 		args->value = ldev->pp_version;
 		break;
 
+	case DRM_LIMA_PARAM_PP_MAX_SUBFRAMES:
+		args->value = lima_pp_max_subframes(&ldev->pipe[lima_pipe_pp]);
+		break;
+
 	default:
 		return -EINVAL;
 	}
@@ -272,7 +277,7 @@ static const struct drm_driver lima_drm_driver = {
 	.desc               = "lima DRM",
 	.date               = "20191231",
 	.major              = 1,
-	.minor              = 1,
+	.minor              = 2,
 	.patchlevel         = 0,
 
 	.gem_create_object  = lima_gem_create_object,
@@ -38,25 +38,6 @@ static void lima_pp_handle_irq(struct lima_ip *ip, u32 state)
 	pp_write(LIMA_PP_INT_CLEAR, state);
 }
 
-static irqreturn_t lima_pp_irq_handler(int irq, void *data)
-{
-	struct lima_ip *ip = data;
-	struct lima_device *dev = ip->dev;
-	struct lima_sched_pipe *pipe = dev->pipe + lima_pipe_pp;
-	u32 state = pp_read(LIMA_PP_INT_STATUS);
-
-	/* for shared irq case */
-	if (!state)
-		return IRQ_NONE;
-
-	lima_pp_handle_irq(ip, state);
-
-	if (atomic_dec_and_test(&pipe->task))
-		lima_sched_pipe_task_done(pipe);
-
-	return IRQ_HANDLED;
-}
-
 static irqreturn_t lima_pp_bcast_irq_handler(int irq, void *data)
 {
 	int i;
@@ -168,6 +149,90 @@ static void lima_pp_write_frame(struct lima_ip *ip, u32 *frame, u32 *wb)
 	}
 }
 
+static void lima_pp_start_subframe(struct lima_ip *ip,
+				   struct drm_lima_m400_pp_frame *frame,
+				   int index)
+{
+	lima_pp_soft_reset_async_wait(ip);
+
+	lima_pp_write_frame(ip, frame->frame, frame->wb);
+	pp_write(LIMA_PP_FRAME, frame->plbu_array_address[index]);
+	pp_write(LIMA_PP_STACK, frame->fragment_stack_address[index]);
+
+	pp_write(LIMA_PP_CTRL, LIMA_PP_CTRL_START_RENDERING);
+}
+
+/*
+ * mali400 frames can be split in more sub-frames than there are PP cores,
+ * give the next one to the core which just went idle so faster cores or
+ * cheaper sub-frames don't leave a core waiting for the slowest one.
+ */
+static bool lima_pp_start_next_subframe(struct lima_ip *ip)
+{
+	struct lima_sched_pipe *pipe = ip->dev->pipe + lima_pipe_pp;
+	struct drm_lima_m400_pp_frame *frame;
+	int next;
+
+	if (pipe->bcast_processor || pipe->error || !pipe->current_task)
+		return false;
+
+	frame = pipe->current_task->frame;
+	next = atomic_fetch_inc(&pipe->next_subframe);
+	if (next >= frame->num_pp)
+		return false;
+
+	lima_pp_soft_reset_async(ip);
+	lima_pp_start_subframe(ip, frame, next);
+	return true;
+}
+
+/*
+ * Sub-frames which will never be started once the task failed, they are
+ * retired along with the failing one.
+ */
+static int lima_pp_skip_subframes(struct lima_sched_pipe *pipe)
+{
+	struct drm_lima_m400_pp_frame *frame;
+	int next;
+
+	if (pipe->bcast_processor)
+		return 0;
+
+	frame = pipe->current_task->frame;
+	next = atomic_xchg(&pipe->next_subframe, frame->num_pp);
+	return next < frame->num_pp ? frame->num_pp - next : 0;
+}
+
+static void lima_pp_subframe_done(struct lima_sched_pipe *pipe)
+{
+	int count = 1;
+
+	if (pipe->error && pipe->current_task)
+		count += lima_pp_skip_subframes(pipe);
+
+	if (atomic_sub_and_test(count, &pipe->task))
+		lima_sched_pipe_task_done(pipe);
+}
+
+static irqreturn_t lima_pp_irq_handler(int irq, void *data)
+{
+	struct lima_ip *ip = data;
+	struct lima_device *dev = ip->dev;
+	struct lima_sched_pipe *pipe = dev->pipe + lima_pipe_pp;
+	u32 state = pp_read(LIMA_PP_INT_STATUS);
+
+	/* for shared irq case */
+	if (!state)
+		return IRQ_NONE;
+
+	lima_pp_handle_irq(ip, state);
+
+	lima_pp_start_next_subframe(ip);
+	lima_pp_subframe_done(pipe);
+
+	return IRQ_HANDLED;
+}
+
 static int lima_pp_hard_reset_poll(struct lima_ip *ip)
 {
 	pp_write(LIMA_PP_PERF_CNT_0_LIMIT, 0xC01A0000);
@@ -302,6 +367,24 @@ void lima_pp_bcast_fini(struct lima_ip *ip)
 
 }
 
+/**
+ * lima_pp_max_subframes - max num_pp of the frames of a PP pipe
+ * @pipe: the PP pipe
+ *
+ * The mali450 broadcast unit starts all cores at once, so one sub-frame
+ * per core. mali400 cores are started one by one and can take more
+ * sub-frames than there are cores.
+ */
+u32 lima_pp_max_subframes(struct lima_sched_pipe *pipe)
+{
+	struct drm_lima_m400_pp_frame *frame;
+
+	if (pipe->bcast_processor)
+		return pipe->num_processor;
+
+	return ARRAY_SIZE(frame->plbu_array_address);
+}
+
 static int lima_pp_task_validate(struct lima_sched_pipe *pipe,
 				 struct lima_sched_task *task)
 {
@@ -320,7 +403,7 @@ static int lima_pp_task_validate(struct lima_sched_pipe *pipe,
 		num_pp = f->num_pp;
 	}
 
-	if (num_pp == 0 || num_pp > pipe->num_processor)
+	if (num_pp == 0 || num_pp > lima_pp_max_subframes(pipe))
 		return -EINVAL;
 
 	return 0;
@@ -337,6 +420,7 @@ static void lima_pp_task_run(struct lima_sched_pipe *pipe,
 
 		pipe->done = 0;
 		atomic_set(&pipe->task, frame->num_pp);
+		atomic_set(&pipe->next_subframe, frame->num_pp);
 
 		if (frame->use_dlbu) {
 			lima_dlbu_enable(dev, frame->num_pp);
@@ -363,24 +447,14 @@ static void lima_pp_task_run(struct lima_sched_pipe *pipe,
 		pp_write(LIMA_PP_CTRL, LIMA_PP_CTRL_START_RENDERING);
 	} else {
 		struct drm_lima_m400_pp_frame *frame = task->frame;
-		int i;
+		int i, num_start = min_t(int, frame->num_pp, pipe->num_processor);
 
+		/* the rest is started by lima_pp_start_next_subframe() */
 		atomic_set(&pipe->task, frame->num_pp);
+		atomic_set(&pipe->next_subframe, num_start);
 
-		for (i = 0; i < frame->num_pp; i++) {
-			struct lima_ip *ip = pipe->processor[i];
-
-			frame->frame[LIMA_PP_FRAME >> 2] =
-				frame->plbu_array_address[i];
-			frame->frame[LIMA_PP_STACK >> 2] =
-				frame->fragment_stack_address[i];
-
-			lima_pp_soft_reset_async_wait(ip);
-
-			lima_pp_write_frame(ip, frame->frame, frame->wb);
-
-			pp_write(LIMA_PP_CTRL, LIMA_PP_CTRL_START_RENDERING);
-		}
+		for (i = 0; i < num_start; i++)
+			lima_pp_start_subframe(pipe->processor[i], frame, i);
 	}
 }
 
@@ -412,8 +486,7 @@ static void lima_pp_task_error(struct lima_sched_pipe *pipe)
 
 static void lima_pp_task_mmu_error(struct lima_sched_pipe *pipe)
 {
-	if (atomic_dec_and_test(&pipe->task))
-		lima_sched_pipe_task_done(pipe);
+	lima_pp_subframe_done(pipe);
 }
 
 static struct kmem_cache *lima_pp_task_slab;
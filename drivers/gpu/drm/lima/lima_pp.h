@@ -6,6 +6,7 @@
 
 struct lima_ip;
 struct lima_device;
+struct lima_sched_pipe;
 
 int lima_pp_resume(struct lima_ip *ip);
 void lima_pp_suspend(struct lima_ip *ip);
@@ -17,6 +18,8 @@ void lima_pp_bcast_suspend(struct lima_ip *ip);
 int lima_pp_bcast_init(struct lima_ip *ip);
 void lima_pp_bcast_fini(struct lima_ip *ip);
 
+u32 lima_pp_max_subframes(struct lima_sched_pipe *pipe);
+
 int lima_pp_pipe_init(struct lima_device *dev);
 void lima_pp_pipe_fini(struct lima_device *dev);
 
@@ -69,7 +69,10 @@ struct lima_sched_pipe {
 
 	u32 done;
 	bool error;
+	/* sub-frames of the current task not completed yet */
 	atomic_t task;
+	/* next sub-frame of the current task to give to an idle processor */
+	atomic_t next_subframe;
 
 	int frame_size;
 	struct kmem_cache *task_slab;
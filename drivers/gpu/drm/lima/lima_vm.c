@@ -11,11 +11,13 @@
 
 struct lima_bo_va {
 	struct list_head list;
+	struct hlist_node hash;
 	unsigned int ref_count;
 
 	struct drm_mm_node node;
 
 	struct lima_vm *vm;
+	struct lima_bo *bo;
 };
 
 #define LIMA_VM_PD_SHIFT 22
@@ -31,44 +33,121 @@ struct lima_bo_va {
 #define LIMA_PBE(va) (va >> LIMA_VM_PB_SHIFT)
 #define LIMA_BTE(va) ((va & LIMA_VM_BT_MASK) >> LIMA_VM_BT_SHIFT)
 
+/* number of freed VA ranges kept around for new BOs of the same size */
+#define LIMA_VM_VA_CACHE_SIZE 16
+
 
 static void lima_vm_unmap_range(struct lima_vm *vm, u32 start, u32 end)
 {
-	u32 addr;
+	u32 addr = start;
 
-	for (addr = start; addr <= end; addr += LIMA_PAGE_SIZE) {
+	/* clear a whole BT worth of entries at once */
+	while (addr <= end) {
 		u32 pbe = LIMA_PBE(addr);
 		u32 bte = LIMA_BTE(addr);
+		u32 n = min_t(u32, LIMA_VM_NUM_PTE_PER_BT - bte,
+			      ((end - addr) >> LIMA_VM_PT_SHIFT) + 1);
+		u32 *pte = vm->bts[pbe].cpu + bte;
+		u32 i;
+
+		for (i = 0; i < n; i++)
+			pte[i] = 0;
 
-		vm->bts[pbe].cpu[bte] = 0;
+		addr += n << LIMA_VM_PT_SHIFT;
 	}
 }
 
-static int lima_vm_map_page(struct lima_vm *vm, dma_addr_t pa, u32 va)
+static int lima_vm_alloc_bt(struct lima_vm *vm, u32 pbe)
 {
-	u32 pbe = LIMA_PBE(va);
-	u32 bte = LIMA_BTE(va);
-
-	if (!vm->bts[pbe].cpu) {
-		dma_addr_t pts;
-		u32 *pd;
-		int j;
-
-		vm->bts[pbe].cpu = dma_alloc_wc(
-			vm->dev->dev, LIMA_PAGE_SIZE << LIMA_VM_NUM_PT_PER_BT_SHIFT,
-			&vm->bts[pbe].dma, GFP_KERNEL | __GFP_NOWARN | __GFP_ZERO);
-		if (!vm->bts[pbe].cpu)
-			return -ENOMEM;
-
-		pts = vm->bts[pbe].dma;
-		pd = vm->pd.cpu + (pbe << LIMA_VM_NUM_PT_PER_BT_SHIFT);
-		for (j = 0; j < LIMA_VM_NUM_PT_PER_BT; j++) {
-			pd[j] = pts | LIMA_VM_FLAG_PRESENT;
-			pts += LIMA_PAGE_SIZE;
+	dma_addr_t pts;
+	u32 *pd;
+	int j;
+
+	vm->bts[pbe].cpu = dma_alloc_wc(
+		vm->dev->dev, LIMA_PAGE_SIZE << LIMA_VM_NUM_PT_PER_BT_SHIFT,
+		&vm->bts[pbe].dma, GFP_KERNEL | __GFP_NOWARN | __GFP_ZERO);
+	if (!vm->bts[pbe].cpu)
+		return -ENOMEM;
+
+	pts = vm->bts[pbe].dma;
+	pd = vm->pd.cpu + (pbe << LIMA_VM_NUM_PT_PER_BT_SHIFT);
+	for (j = 0; j < LIMA_VM_NUM_PT_PER_BT; j++) {
+		pd[j] = pts | LIMA_VM_FLAG_PRESENT;
+		pts += LIMA_PAGE_SIZE;
+	}
+
+	return 0;
+}
+
+/*
+ * Map the physically contiguous range [pa, pa + size) at va. All the page
+ * tables are allocated upfront so nothing is mapped on failure.
+ */
+static int lima_vm_map_range(struct lima_vm *vm, dma_addr_t pa, u32 va,
+			     u32 size)
+{
+	u32 pbe, last = LIMA_PBE(va + size - 1);
+	int err;
+
+	for (pbe = LIMA_PBE(va); pbe <= last; pbe++) {
+		if (vm->bts[pbe].cpu)
+			continue;
+
+		err = lima_vm_alloc_bt(vm, pbe);
+		if (err)
+			return err;
+	}
+
+	while (size) {
+		u32 bte = LIMA_BTE(va);
+		u32 n = min_t(u32, LIMA_VM_NUM_PTE_PER_BT - bte,
+			      size >> LIMA_VM_PT_SHIFT);
+		u32 *pte = vm->bts[LIMA_PBE(va)].cpu + bte;
+		u32 i;
+
+		for (i = 0; i < n; i++) {
+			pte[i] = pa | LIMA_VM_FLAGS_CACHE;
+			pa += LIMA_PAGE_SIZE;
 		}
+
+		va += n << LIMA_VM_PT_SHIFT;
+		size -= n << LIMA_VM_PT_SHIFT;
 	}
 
-	vm->bts[pbe].cpu[bte] = pa | LIMA_VM_FLAGS_CACHE;
+	return 0;
+}
+
+/* map the pages of sgt from pageoff on at va, one DMA segment at a time */
+static int lima_vm_map_sgt(struct lima_vm *vm, struct sg_table *sgt,
+			   u32 va, int pageoff)
+{
+	u64 skip = (u64)pageoff << PAGE_SHIFT;
+	struct scatterlist *sg;
+	u32 start = va;
+	int i, err;
+
+	for_each_sgtable_dma_sg(sgt, sg, i) {
+		dma_addr_t pa = sg_dma_address(sg);
+		u32 len = sg_dma_len(sg);
+
+		if (skip >= len) {
+			skip -= len;
+			continue;
+		}
+
+		pa += skip;
+		len -= skip;
+		skip = 0;
+
+		err = lima_vm_map_range(vm, pa, va, len);
+		if (err) {
+			if (va != start)
+				lima_vm_unmap_range(vm, start, va - 1);
+			return err;
+		}
+
+		va += len;
+	}
 
 	return 0;
 }
@@ -76,62 +155,120 @@ static int lima_vm_map_page(struct lima_vm *vm, dma_addr_t pa, u32 va)
 static struct lima_bo_va *
 lima_vm_bo_find(struct lima_vm *vm, struct lima_bo *bo)
 {
-	struct lima_bo_va *bo_va, *ret = NULL;
+	struct lima_bo_va *bo_va;
+
+	lockdep_assert_held(&vm->lock);
 
-	list_for_each_entry(bo_va, &bo->va, list) {
-		if (bo_va->vm == vm) {
-			ret = bo_va;
-			break;
+	hash_for_each_possible(vm->bo_va_hash, bo_va, hash, (unsigned long)bo) {
+		if (bo_va->bo == bo)
+			return bo_va;
+	}
+
+	return NULL;
+}
+
+/* reuse the most recently freed VA range of this size, if any */
+static struct lima_bo_va *lima_vm_va_cache_get(struct lima_vm *vm, u64 size)
+{
+	struct lima_bo_va *bo_va;
+
+	list_for_each_entry_reverse(bo_va, &vm->va_cache, list) {
+		if (bo_va->node.size == size) {
+			list_del(&bo_va->list);
+			vm->va_cache_count--;
+			return bo_va;
 		}
 	}
 
-	return ret;
+	return NULL;
+}
+
+static void lima_vm_va_cache_put(struct lima_vm *vm, struct lima_bo_va *bo_va)
+{
+	if (vm->va_cache_count == LIMA_VM_VA_CACHE_SIZE) {
+		struct lima_bo_va *oldest =
+			list_first_entry(&vm->va_cache, struct lima_bo_va, list);
+
+		list_del(&oldest->list);
+		drm_mm_remove_node(&oldest->node);
+		kfree(oldest);
+	} else {
+		vm->va_cache_count++;
+	}
+
+	list_add_tail(&bo_va->list, &vm->va_cache);
+}
+
+static void lima_vm_va_cache_flush(struct lima_vm *vm)
+{
+	struct lima_bo_va *bo_va, *tmp;
+
+	list_for_each_entry_safe(bo_va, tmp, &vm->va_cache, list) {
+		list_del(&bo_va->list);
+		drm_mm_remove_node(&bo_va->node);
+		kfree(bo_va);
+	}
+	vm->va_cache_count = 0;
+}
+
+static int lima_vm_alloc_va(struct lima_vm *vm, struct lima_bo_va *bo_va,
+			    u64 size)
+{
+	int err;
+
+	err = drm_mm_insert_node(&vm->mm, &bo_va->node, size);
+	if (err != -ENOSPC || list_empty(&vm->va_cache))
+		return err;
+
+	/* the cached ranges may be what is missing */
+	lima_vm_va_cache_flush(vm);
+	return drm_mm_insert_node(&vm->mm, &bo_va->node, size);
 }
 
 int lima_vm_bo_add(struct lima_vm *vm, struct lima_bo *bo, bool create)
 {
 	struct lima_bo_va *bo_va;
-	struct sg_dma_page_iter sg_iter;
-	int offset = 0, err;
+	int err;
 
 	mutex_lock(&bo->lock);
+	mutex_lock(&vm->lock);
 
 	bo_va = lima_vm_bo_find(vm, bo);
 	if (bo_va) {
 		bo_va->ref_count++;
+		mutex_unlock(&vm->lock);
 		mutex_unlock(&bo->lock);
 		return 0;
 	}
 
 	/* should not create new bo_va if not asked by caller */
 	if (!create) {
-		mutex_unlock(&bo->lock);
-		return -ENOENT;
+		err = -ENOENT;
+		goto err_out0;
 	}
 
-	bo_va = kzalloc(sizeof(*bo_va), GFP_KERNEL);
+	bo_va = lima_vm_va_cache_get(vm, lima_bo_size(bo));
 	if (!bo_va) {
-		err = -ENOMEM;
-		goto err_out0;
+		bo_va = kzalloc(sizeof(*bo_va), GFP_KERNEL);
+		if (!bo_va) {
+			err = -ENOMEM;
+			goto err_out0;
+		}
+
+		err = lima_vm_alloc_va(vm, bo_va, lima_bo_size(bo));
+		if (err)
+			goto err_out1;
 	}
 
 	bo_va->vm = vm;
+	bo_va->bo = bo;
 	bo_va->ref_count = 1;
 
-	mutex_lock(&vm->lock);
-
-	err = drm_mm_insert_node(&vm->mm, &bo_va->node, lima_bo_size(bo));
+	err = lima_vm_map_sgt(vm, bo->base.sgt, bo_va->node.start, 0);
 	if (err)
-		goto err_out1;
-
-	for_each_sgtable_dma_page(bo->base.sgt, &sg_iter, 0) {
-		err = lima_vm_map_page(vm, sg_page_iter_dma_address(&sg_iter),
-				       bo_va->node.start + offset);
-		if (err)
-			goto err_out2;
+		goto err_out2;
 
-		offset += PAGE_SIZE;
-	}
+	hash_add(vm->bo_va_hash, &bo_va->hash, (unsigned long)bo);
 
 	mutex_unlock(&vm->lock);
 
@@ -141,13 +278,11 @@ int lima_vm_bo_add(struct lima_vm *vm, struct lima_bo *bo, bool create)
 	return 0;
 
 err_out2:
-	if (offset)
-		lima_vm_unmap_range(vm, bo_va->node.start, bo_va->node.start + offset - 1);
 	drm_mm_remove_node(&bo_va->node);
 err_out1:
-	mutex_unlock(&vm->lock);
 	kfree(bo_va);
 err_out0:
+	mutex_unlock(&vm->lock);
 	mutex_unlock(&bo->lock);
 	return err;
 }
@@ -158,28 +293,31 @@ void lima_vm_bo_del(struct lima_vm *vm, struct lima_bo *bo)
 	u32 size;
 
 	mutex_lock(&bo->lock);
+	mutex_lock(&vm->lock);
 
 	bo_va = lima_vm_bo_find(vm, bo);
 	if (--bo_va->ref_count > 0) {
+		mutex_unlock(&vm->lock);
 		mutex_unlock(&bo->lock);
 		return;
 	}
 
-	mutex_lock(&vm->lock);
-
+	/*
+	 * The pages go away with the BO so the PTEs are cleared right away,
+	 * only the VA range is kept for reuse.
+	 */
 	size = bo->heap_size ? bo->heap_size : bo_va->node.size;
 	lima_vm_unmap_range(vm, bo_va->node.start,
 			    bo_va->node.start + size - 1);
 
-	drm_mm_remove_node(&bo_va->node);
+	hash_del(&bo_va->hash);
+	list_del(&bo_va->list);
+	bo_va->bo = NULL;
+	lima_vm_va_cache_put(vm, bo_va);
 
 	mutex_unlock(&vm->lock);
 
-	list_del(&bo_va->list);
-
 	mutex_unlock(&bo->lock);
-
-	kfree(bo_va);
 }
 
 u32 lima_vm_get_va(struct lima_vm *vm, struct lima_bo *bo)
@@ -187,12 +325,12 @@ u32 lima_vm_get_va(struct lima_vm *vm, struct lima_bo *bo)
 	struct lima_bo_va *bo_va;
 	u32 ret;
 
-	mutex_lock(&bo->lock);
+	mutex_lock(&vm->lock);
 
 	bo_va = lima_vm_bo_find(vm, bo);
 	ret = bo_va->node.start;
 
-	mutex_unlock(&bo->lock);
+	mutex_unlock(&vm->lock);
 
 	return ret;
 }
@@ -208,6 +346,8 @@ struct lima_vm *lima_vm_create(struct lima_device *dev)
 	vm->dev = dev;
 	mutex_init(&vm->lock);
 	kref_init(&vm->refcount);
+	hash_init(vm->bo_va_hash);
+	INIT_LIST_HEAD(&vm->va_cache);
 
 	vm->pd.cpu = dma_alloc_wc(dev->dev, LIMA_PAGE_SIZE, &vm->pd.dma,
 				  GFP_KERNEL | __GFP_NOWARN | __GFP_ZERO);
@@ -215,8 +355,8 @@ struct lima_vm *lima_vm_create(struct lima_device *dev)
 		goto err_out0;
 
 	if (dev->dlbu_cpu) {
-		int err = lima_vm_map_page(
-			vm, dev->dlbu_dma, LIMA_VA_RESERVE_DLBU);
+		int err = lima_vm_map_range(
+			vm, dev->dlbu_dma, LIMA_VA_RESERVE_DLBU, LIMA_PAGE_SIZE);
 		if (err)
 			goto err_out1;
 	}
@@ -237,6 +377,7 @@ void lima_vm_release(struct kref *kref)
 	struct lima_vm *vm = container_of(kref, struct lima_vm, refcount);
 	int i;
 
+	lima_vm_va_cache_flush(vm);
 	drm_mm_takedown(&vm->mm);
 
 	for (i = 0; i < LIMA_VM_NUM_BT; i++) {
@@ -283,40 +424,23 @@ void lima_vm_print(struct lima_vm *vm)
 int lima_vm_map_bo(struct lima_vm *vm, struct lima_bo *bo, int pageoff)
 {
 	struct lima_bo_va *bo_va;
-	struct sg_dma_page_iter sg_iter;
-	int offset = 0, err;
-	u32 base;
+	int err;
 
 	mutex_lock(&bo->lock);
+	mutex_lock(&vm->lock);
 
 	bo_va = lima_vm_bo_find(vm, bo);
 	if (!bo_va) {
 		err = -ENOENT;
-		goto err_out0;
+		goto out;
 	}
 
-	mutex_lock(&vm->lock);
+	err = lima_vm_map_sgt(vm, bo->base.sgt,
+			      bo_va->node.start + (pageoff << PAGE_SHIFT),
+			      pageoff);
 
-	base = bo_va->node.start + (pageoff << PAGE_SHIFT);
-	for_each_sgtable_dma_page(bo->base.sgt, &sg_iter, pageoff) {
-		err = lima_vm_map_page(vm, sg_page_iter_dma_address(&sg_iter),
-				       base + offset);
-		if (err)
-			goto err_out1;
-
-		offset += PAGE_SIZE;
-	}
-
-	mutex_unlock(&vm->lock);
-
-	mutex_unlock(&bo->lock);
-	return 0;
-
-err_out1:
-	if (offset)
-		lima_vm_unmap_range(vm, base, base + offset - 1);
+out:
 	mutex_unlock(&vm->lock);
-err_out0:
 	mutex_unlock(&bo->lock);
 	return err;
 }
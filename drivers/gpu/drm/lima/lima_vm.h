@@ -5,6 +5,7 @@
 #define __LIMA_VM_H__
 
 #include <drm/drm_mm.h>
+#include <linux/hashtable.h>
 #include <linux/kref.h>
 
 #define LIMA_PAGE_SIZE    4096
@@ -14,6 +15,9 @@
 #define LIMA_VM_NUM_PT_PER_BT_SHIFT 3
 #define LIMA_VM_NUM_PT_PER_BT (1 << LIMA_VM_NUM_PT_PER_BT_SHIFT)
 #define LIMA_VM_NUM_BT (LIMA_PAGE_ENT_NUM >> LIMA_VM_NUM_PT_PER_BT_SHIFT)
+#define LIMA_VM_NUM_PTE_PER_BT (LIMA_PAGE_ENT_NUM << LIMA_VM_NUM_PT_PER_BT_SHIFT)
+
+#define LIMA_VM_BO_VA_HASH_BITS 6
 
 #define LIMA_VA_RESERVE_START  0x0FFF00000ULL
 #define LIMA_VA_RESERVE_DLBU   LIMA_VA_RESERVE_START
@@ -36,6 +40,13 @@ struct lima_vm {
 
 	struct lima_vm_page pd;
 	struct lima_vm_page bts[LIMA_VM_NUM_BT];
+
+	/* lima_bo_va of the BOs mapped in this VM, protected by lock */
+	DECLARE_HASHTABLE(bo_va_hash, LIMA_VM_BO_VA_HASH_BITS);
+
+	/* VA ranges of recently freed BOs, oldest first, protected by lock */
+	struct list_head va_cache;
+	unsigned int va_cache_count;
 };
 
 int lima_vm_bo_add(struct lima_vm *vm, struct lima_bo *bo, bool create);
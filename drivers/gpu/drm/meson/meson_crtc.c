@@ -35,13 +35,16 @@ struct meson_crtc {
 	struct drm_crtc base;
 	struct drm_pending_vblank_event *event;
 	struct meson_drm *priv;
-	void (*enable_osd1)(struct meson_drm *priv);
-	void (*enable_vd1)(struct meson_drm *priv);
+	void (*enable_osd1)(struct meson_crtc *meson_crtc);
+	void (*enable_vd1)(struct meson_crtc *meson_crtc);
 	void (*enable_osd1_afbc)(struct meson_drm *priv);
 	void (*disable_osd1_afbc)(struct meson_drm *priv);
 	unsigned int viu_offset;
 	bool vsync_forced;
 	bool vsync_disabled;
+	bool rdma_batch;
+	bool rdma_armed;
+	unsigned int rdma_missed;
 };
 #define to_meson_crtc(x) container_of(x, struct meson_crtc, base)
 
@@ -155,6 +158,11 @@ static void meson_g12a_crtc_atomic_disable(struct drm_crtc *crtc,
 
 	drm_crtc_vblank_off(crtc);
 
+	if (meson_crtc->rdma_armed) {
+		meson_rdma_stop(priv);
+		meson_crtc->rdma_armed = false;
+	}
+
 	priv->viu.osd1_enabled = false;
 	priv->viu.osd1_commit = false;
 
@@ -180,6 +188,11 @@ static void meson_crtc_atomic_disable(struct drm_crtc *crtc,
 
 	drm_crtc_vblank_off(crtc);
 
+	if (meson_crtc->rdma_armed) {
+		meson_rdma_stop(priv);
+		meson_crtc->rdma_armed = false;
+	}
+
 	priv->viu.osd1_enabled = false;
 	priv->viu.osd1_commit = false;
 
@@ -200,50 +213,297 @@ static void meson_crtc_atomic_disable(struct drm_crtc *crtc,
 	}
 }
 
-static void meson_crtc_atomic_begin(struct drm_crtc *crtc,
-				    struct drm_atomic_state *state)
+/*
+ * The per frame registers are either written from the vsync irq, or queued
+ * to the RDMA in the commit tail which then writes them on the next vsync.
+ * The canvas and AFBC decoder setup is done from the irq in both cases.
+ */
+static void meson_crtc_writel(struct meson_crtc *meson_crtc, u32 val, u32 reg)
 {
-	struct meson_crtc *meson_crtc = to_meson_crtc(crtc);
-	unsigned long flags;
+	struct meson_drm *priv = meson_crtc->priv;
 
-	if (crtc->state->event) {
-		WARN_ON(drm_crtc_vblank_get(crtc) != 0);
+	if (meson_crtc->rdma_batch)
+		meson_rdma_writel(priv, val, reg);
+	else
+		writel_relaxed(val, priv->io_base + _REG(reg));
+}
 
-		spin_lock_irqsave(&crtc->dev->event_lock, flags);
-		meson_crtc->event = crtc->state->event;
-		spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
-		crtc->state->event = NULL;
-	}
+static void meson_crtc_viu_writel(struct meson_crtc *meson_crtc, u32 val,
+				  u32 reg)
+{
+	meson_crtc_writel(meson_crtc, val, reg + (meson_crtc->viu_offset >> 2));
 }
 
-static void meson_crtc_atomic_flush(struct drm_crtc *crtc,
-				    struct drm_atomic_state *state)
+static void meson_crtc_writel_bits(struct meson_crtc *meson_crtc, u32 mask,
+				   u32 val, u32 reg)
 {
-	struct meson_crtc *meson_crtc = to_meson_crtc(crtc);
 	struct meson_drm *priv = meson_crtc->priv;
 
-	priv->viu.osd1_commit = true;
-	priv->viu.vd1_commit = true;
+	if (meson_crtc->rdma_batch)
+		meson_rdma_writel_bits(priv, mask, val, reg);
+	else
+		writel_bits_relaxed(mask, val, priv->io_base + _REG(reg));
 }
 
-static const struct drm_crtc_helper_funcs meson_crtc_helper_funcs = {
-	.atomic_begin	= meson_crtc_atomic_begin,
-	.atomic_flush	= meson_crtc_atomic_flush,
-	.atomic_enable	= meson_crtc_atomic_enable,
-	.atomic_disable	= meson_crtc_atomic_disable,
-};
+static void meson_crtc_write_osd1_regs(struct meson_crtc *meson_crtc)
+{
+	struct meson_drm *priv = meson_crtc->priv;
 
-static const struct drm_crtc_helper_funcs meson_g12a_crtc_helper_funcs = {
-	.atomic_begin	= meson_crtc_atomic_begin,
-	.atomic_flush	= meson_crtc_atomic_flush,
-	.atomic_enable	= meson_g12a_crtc_atomic_enable,
-	.atomic_disable	= meson_g12a_crtc_atomic_disable,
-};
+	meson_crtc_writel(meson_crtc, priv->viu.osd1_ctrl_stat,
+			  VIU_OSD1_CTRL_STAT);
+	meson_crtc_writel(meson_crtc, priv->viu.osd1_ctrl_stat2,
+			  VIU_OSD1_CTRL_STAT2);
+	meson_crtc_writel(meson_crtc, priv->viu.osd1_blk0_cfg[0],
+			  VIU_OSD1_BLK0_CFG_W0);
+	meson_crtc_writel(meson_crtc, priv->viu.osd1_blk0_cfg[1],
+			  VIU_OSD1_BLK0_CFG_W1);
+	meson_crtc_writel(meson_crtc, priv->viu.osd1_blk0_cfg[2],
+			  VIU_OSD1_BLK0_CFG_W2);
+	meson_crtc_writel(meson_crtc, priv->viu.osd1_blk0_cfg[3],
+			  VIU_OSD1_BLK0_CFG_W3);
+	meson_crtc_writel(meson_crtc, priv->viu.osd1_blk0_cfg[4],
+			  VIU_OSD1_BLK0_CFG_W4);
+}
 
-static void meson_crtc_enable_osd1(struct meson_drm *priv)
+static void meson_crtc_write_osd1_scaler(struct meson_crtc *meson_crtc)
 {
-	writel_bits_relaxed(VPP_OSD1_POSTBLEND, VPP_OSD1_POSTBLEND,
-			    priv->io_base + _REG(VPP_MISC));
+	struct meson_drm *priv = meson_crtc->priv;
+
+	meson_crtc_writel(meson_crtc, priv->viu.osd_sc_ctrl0, VPP_OSD_SC_CTRL0);
+	meson_crtc_writel(meson_crtc, priv->viu.osd_sc_i_wh_m1,
+			  VPP_OSD_SCI_WH_M1);
+	meson_crtc_writel(meson_crtc, priv->viu.osd_sc_o_h_start_end,
+			  VPP_OSD_SCO_H_START_END);
+	meson_crtc_writel(meson_crtc, priv->viu.osd_sc_o_v_start_end,
+			  VPP_OSD_SCO_V_START_END);
+	meson_crtc_writel(meson_crtc, priv->viu.osd_sc_v_ini_phase,
+			  VPP_OSD_VSC_INI_PHASE);
+	meson_crtc_writel(meson_crtc, priv->viu.osd_sc_v_phase_step,
+			  VPP_OSD_VSC_PHASE_STEP);
+	meson_crtc_writel(meson_crtc, priv->viu.osd_sc_h_ini_phase,
+			  VPP_OSD_HSC_INI_PHASE);
+	meson_crtc_writel(meson_crtc, priv->viu.osd_sc_h_phase_step,
+			  VPP_OSD_HSC_PHASE_STEP);
+	meson_crtc_writel(meson_crtc, priv->viu.osd_sc_h_ctrl0,
+			  VPP_OSD_HSC_CTRL0);
+	meson_crtc_writel(meson_crtc, priv->viu.osd_sc_v_ctrl0,
+			  VPP_OSD_VSC_CTRL0);
+}
+
+static void meson_crtc_config_vd1_canvas(struct meson_drm *priv)
+{
+	switch (priv->viu.vd1_planes) {
+	case 3:
+		meson_canvas_config(priv->canvas,
+				    priv->canvas_id_vd1_2,
+				    priv->viu.vd1_addr2,
+				    priv->viu.vd1_stride2,
+				    priv->viu.vd1_height2,
+				    MESON_CANVAS_WRAP_NONE,
+				    MESON_CANVAS_BLKMODE_LINEAR,
+				    MESON_CANVAS_ENDIAN_SWAP64);
+		fallthrough;
+	case 2:
+		meson_canvas_config(priv->canvas,
+				    priv->canvas_id_vd1_1,
+				    priv->viu.vd1_addr1,
+				    priv->viu.vd1_stride1,
+				    priv->viu.vd1_height1,
+				    MESON_CANVAS_WRAP_NONE,
+				    MESON_CANVAS_BLKMODE_LINEAR,
+				    MESON_CANVAS_ENDIAN_SWAP64);
+		fallthrough;
+	case 1:
+		meson_canvas_config(priv->canvas,
+				    priv->canvas_id_vd1_0,
+				    priv->viu.vd1_addr0,
+				    priv->viu.vd1_stride0,
+				    priv->viu.vd1_height0,
+				    MESON_CANVAS_WRAP_NONE,
+				    MESON_CANVAS_BLKMODE_LINEAR,
+				    MESON_CANVAS_ENDIAN_SWAP64);
+	}
+}
+
+static void meson_crtc_write_vd1_regs(struct meson_crtc *meson_crtc)
+{
+	struct meson_drm *priv = meson_crtc->priv;
+
+	if (priv->viu.vd1_afbc) {
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_head_addr,
+				  AFBC_HEAD_BADDR);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_body_addr,
+				  AFBC_BODY_BADDR);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_en,
+				  AFBC_ENABLE);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_mode,
+				  AFBC_MODE);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_size_in,
+				  AFBC_SIZE_IN);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_dec_def_color,
+				  AFBC_DEC_DEF_COLOR);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_conv_ctrl,
+				  AFBC_CONV_CTRL);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_size_out,
+				  AFBC_SIZE_OUT);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_vd_cfmt_ctrl,
+				  AFBC_VD_CFMT_CTRL);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_vd_cfmt_w,
+				  AFBC_VD_CFMT_W);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_mif_hor_scope,
+				  AFBC_MIF_HOR_SCOPE);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_mif_ver_scope,
+				  AFBC_MIF_VER_SCOPE);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_pixel_hor_scope,
+				  AFBC_PIXEL_HOR_SCOPE);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_pixel_ver_scope,
+				  AFBC_PIXEL_VER_SCOPE);
+		meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc_vd_cfmt_h,
+				  AFBC_VD_CFMT_H);
+	} else {
+		meson_crtc_writel(meson_crtc, 0, AFBC_ENABLE);
+	}
+
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_gen_reg,
+			      VD1_IF0_GEN_REG);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_gen_reg,
+			      VD2_IF0_GEN_REG);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_gen_reg2,
+			      VD1_IF0_GEN_REG2);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.viu_vd1_fmt_ctrl,
+			      VIU_VD1_FMT_CTRL);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.viu_vd1_fmt_ctrl,
+			      VIU_VD2_FMT_CTRL);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.viu_vd1_fmt_w,
+			      VIU_VD1_FMT_W);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.viu_vd1_fmt_w,
+			      VIU_VD2_FMT_W);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_canvas0,
+			      VD1_IF0_CANVAS0);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_canvas0,
+			      VD1_IF0_CANVAS1);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_canvas0,
+			      VD2_IF0_CANVAS0);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_canvas0,
+			      VD2_IF0_CANVAS1);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma_x0,
+			      VD1_IF0_LUMA_X0);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma_x0,
+			      VD1_IF0_LUMA_X1);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma_x0,
+			      VD2_IF0_LUMA_X0);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma_x0,
+			      VD2_IF0_LUMA_X1);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma_y0,
+			      VD1_IF0_LUMA_Y0);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma_y0,
+			      VD1_IF0_LUMA_Y1);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma_y0,
+			      VD2_IF0_LUMA_Y0);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma_y0,
+			      VD2_IF0_LUMA_Y1);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma_x0,
+			      VD1_IF0_CHROMA_X0);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma_x0,
+			      VD1_IF0_CHROMA_X1);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma_x0,
+			      VD2_IF0_CHROMA_X0);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma_x0,
+			      VD2_IF0_CHROMA_X1);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma_y0,
+			      VD1_IF0_CHROMA_Y0);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma_y0,
+			      VD1_IF0_CHROMA_Y1);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma_y0,
+			      VD2_IF0_CHROMA_Y0);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma_y0,
+			      VD2_IF0_CHROMA_Y1);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_repeat_loop,
+			      VD1_IF0_RPT_LOOP);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_repeat_loop,
+			      VD2_IF0_RPT_LOOP);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma0_rpt_pat,
+			      VD1_IF0_LUMA0_RPT_PAT);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma0_rpt_pat,
+			      VD2_IF0_LUMA0_RPT_PAT);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma0_rpt_pat,
+			      VD1_IF0_LUMA1_RPT_PAT);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_luma0_rpt_pat,
+			      VD2_IF0_LUMA1_RPT_PAT);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma0_rpt_pat,
+			      VD1_IF0_CHROMA0_RPT_PAT);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma0_rpt_pat,
+			      VD2_IF0_CHROMA0_RPT_PAT);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma0_rpt_pat,
+			      VD1_IF0_CHROMA1_RPT_PAT);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_if0_chroma0_rpt_pat,
+			      VD2_IF0_CHROMA1_RPT_PAT);
+	meson_crtc_viu_writel(meson_crtc, 0, VD1_IF0_LUMA_PSEL);
+	meson_crtc_viu_writel(meson_crtc, 0, VD1_IF0_CHROMA_PSEL);
+	meson_crtc_viu_writel(meson_crtc, 0, VD2_IF0_LUMA_PSEL);
+	meson_crtc_viu_writel(meson_crtc, 0, VD2_IF0_CHROMA_PSEL);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_range_map_y,
+			      VD1_IF0_RANGE_MAP_Y);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_range_map_cb,
+			      VD1_IF0_RANGE_MAP_CB);
+	meson_crtc_viu_writel(meson_crtc, priv->viu.vd1_range_map_cr,
+			      VD1_IF0_RANGE_MAP_CR);
+	meson_crtc_writel(meson_crtc,
+			  VPP_VSC_BANK_LENGTH(4) | VPP_HSC_BANK_LENGTH(4) |
+			  VPP_SC_VD_EN_ENABLE | VPP_SC_TOP_EN_ENABLE |
+			  VPP_SC_HSC_EN_ENABLE | VPP_SC_VSC_EN_ENABLE,
+			  VPP_SC_MISC);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_pic_in_height,
+			  VPP_PIC_IN_HEIGHT);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_postblend_vd1_h_start_end,
+			  VPP_POSTBLEND_VD1_H_START_END);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_blend_vd2_h_start_end,
+			  VPP_BLEND_VD2_H_START_END);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_postblend_vd1_v_start_end,
+			  VPP_POSTBLEND_VD1_V_START_END);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_blend_vd2_v_start_end,
+			  VPP_BLEND_VD2_V_START_END);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_hsc_region12_startp,
+			  VPP_HSC_REGION12_STARTP);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_hsc_region34_startp,
+			  VPP_HSC_REGION34_STARTP);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_hsc_region4_endp,
+			  VPP_HSC_REGION4_ENDP);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_hsc_start_phase_step,
+			  VPP_HSC_START_PHASE_STEP);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_hsc_region1_phase_slope,
+			  VPP_HSC_REGION1_PHASE_SLOPE);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_hsc_region3_phase_slope,
+			  VPP_HSC_REGION3_PHASE_SLOPE);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_line_in_length,
+			  VPP_LINE_IN_LENGTH);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_preblend_h_size,
+			  VPP_PREBLEND_H_SIZE);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_vsc_region12_startp,
+			  VPP_VSC_REGION12_STARTP);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_vsc_region34_startp,
+			  VPP_VSC_REGION34_STARTP);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_vsc_region4_endp,
+			  VPP_VSC_REGION4_ENDP);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_vsc_start_phase_step,
+			  VPP_VSC_START_PHASE_STEP);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_vsc_ini_phase,
+			  VPP_VSC_INI_PHASE);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_vsc_phase_ctrl,
+			  VPP_VSC_PHASE_CTRL);
+	meson_crtc_writel(meson_crtc, priv->viu.vpp_hsc_phase_ctrl,
+			  VPP_HSC_PHASE_CTRL);
+	meson_crtc_writel(meson_crtc, 0x42, VPP_SCALE_COEF_IDX);
+
+	/* Enable VD1 */
+	if (meson_crtc->enable_vd1)
+		meson_crtc->enable_vd1(meson_crtc);
+}
+
+static void meson_crtc_enable_osd1(struct meson_crtc *meson_crtc)
+{
+	meson_crtc_writel_bits(meson_crtc, VPP_OSD1_POSTBLEND,
+			       VPP_OSD1_POSTBLEND, VPP_MISC);
 }
 
 static void meson_crtc_g12a_enable_osd1_afbc(struct meson_drm *priv)
@@ -266,71 +526,143 @@ static void meson_crtc_g12a_enable_osd1_afbc(struct meson_drm *priv)
 			    priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W0));
 }
 
-static void meson_g12a_crtc_enable_osd1(struct meson_drm *priv)
+static void meson_g12a_crtc_enable_osd1(struct meson_crtc *meson_crtc)
 {
-	writel_relaxed(priv->viu.osd_blend_din0_scope_h,
-		       priv->io_base +
-		       _REG(VIU_OSD_BLEND_DIN0_SCOPE_H));
-	writel_relaxed(priv->viu.osd_blend_din0_scope_v,
-		       priv->io_base +
-		       _REG(VIU_OSD_BLEND_DIN0_SCOPE_V));
-	writel_relaxed(priv->viu.osb_blend0_size,
-		       priv->io_base +
-		       _REG(VIU_OSD_BLEND_BLEND0_SIZE));
-	writel_relaxed(priv->viu.osb_blend1_size,
-		       priv->io_base +
-		       _REG(VIU_OSD_BLEND_BLEND1_SIZE));
-	writel_bits_relaxed(3 << 8, 3 << 8,
-			    priv->io_base + _REG(OSD1_BLEND_SRC_CTRL));
+	struct meson_drm *priv = meson_crtc->priv;
+
+	meson_crtc_writel(meson_crtc, priv->viu.osd_blend_din0_scope_h,
+			  VIU_OSD_BLEND_DIN0_SCOPE_H);
+	meson_crtc_writel(meson_crtc, priv->viu.osd_blend_din0_scope_v,
+			  VIU_OSD_BLEND_DIN0_SCOPE_V);
+	meson_crtc_writel(meson_crtc, priv->viu.osb_blend0_size,
+			  VIU_OSD_BLEND_BLEND0_SIZE);
+	meson_crtc_writel(meson_crtc, priv->viu.osb_blend1_size,
+			  VIU_OSD_BLEND_BLEND1_SIZE);
+	meson_crtc_writel_bits(meson_crtc, 3 << 8, 3 << 8, OSD1_BLEND_SRC_CTRL);
 }
 
-static void meson_crtc_enable_vd1(struct meson_drm *priv)
+static void meson_crtc_enable_vd1(struct meson_crtc *meson_crtc)
 {
-	writel_bits_relaxed(VPP_VD1_PREBLEND | VPP_VD1_POSTBLEND |
-			    VPP_COLOR_MNG_ENABLE,
-			    VPP_VD1_PREBLEND | VPP_VD1_POSTBLEND |
-			    VPP_COLOR_MNG_ENABLE,
-			    priv->io_base + _REG(VPP_MISC));
+	struct meson_drm *priv = meson_crtc->priv;
+
+	meson_crtc_writel_bits(meson_crtc, VPP_VD1_PREBLEND | VPP_VD1_POSTBLEND |
+			       VPP_COLOR_MNG_ENABLE,
+			       VPP_VD1_PREBLEND | VPP_VD1_POSTBLEND |
+			       VPP_COLOR_MNG_ENABLE,
+			       VPP_MISC);
 
-	writel_bits_relaxed(VIU_CTRL0_AFBC_TO_VD1,
-			    priv->viu.vd1_afbc ? VIU_CTRL0_AFBC_TO_VD1 : 0,
-			    priv->io_base + _REG(VIU_MISC_CTRL0));
+	meson_crtc_writel_bits(meson_crtc, VIU_CTRL0_AFBC_TO_VD1,
+			       priv->viu.vd1_afbc ? VIU_CTRL0_AFBC_TO_VD1 : 0,
+			       VIU_MISC_CTRL0);
 }
 
-static void meson_g12a_crtc_enable_vd1(struct meson_drm *priv)
+static void meson_g12a_crtc_enable_vd1(struct meson_crtc *meson_crtc)
 {
-	writel_relaxed(VD_BLEND_PREBLD_SRC_VD1 |
-		       VD_BLEND_PREBLD_PREMULT_EN |
-		       VD_BLEND_POSTBLD_SRC_VD1 |
-		       VD_BLEND_POSTBLD_PREMULT_EN,
-		       priv->io_base + _REG(VD1_BLEND_SRC_CTRL));
-
-	writel_relaxed(priv->viu.vd1_afbc ?
-		       (VD1_AXI_SEL_AFBC | AFBC_VD1_SEL) : 0,
-		       priv->io_base + _REG(VD1_AFBCD0_MISC_CTRL));
+	struct meson_drm *priv = meson_crtc->priv;
+
+	meson_crtc_writel(meson_crtc,
+			  VD_BLEND_PREBLD_SRC_VD1 |
+			  VD_BLEND_PREBLD_PREMULT_EN |
+			  VD_BLEND_POSTBLD_SRC_VD1 |
+			  VD_BLEND_POSTBLD_PREMULT_EN,
+			  VD1_BLEND_SRC_CTRL);
+
+	meson_crtc_writel(meson_crtc, priv->viu.vd1_afbc ?
+			  (VD1_AXI_SEL_AFBC | AFBC_VD1_SEL) : 0,
+			  VD1_AFBCD0_MISC_CTRL);
+}
+
+static void meson_crtc_atomic_begin(struct drm_crtc *crtc,
+				    struct drm_atomic_state *state)
+{
+	struct meson_crtc *meson_crtc = to_meson_crtc(crtc);
+	unsigned long flags;
+
+	if (crtc->state->event) {
+		WARN_ON(drm_crtc_vblank_get(crtc) != 0);
+
+		spin_lock_irqsave(&crtc->dev->event_lock, flags);
+		meson_crtc->event = crtc->state->event;
+		spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
+		crtc->state->event = NULL;
+	}
+}
+
+static void meson_crtc_atomic_flush(struct drm_crtc *crtc,
+				    struct drm_atomic_state *state)
+{
+	struct meson_crtc *meson_crtc = to_meson_crtc(crtc);
+	struct meson_drm *priv = meson_crtc->priv;
+
+	priv->viu.osd1_commit = true;
+	priv->viu.vd1_commit = true;
+
+	/*
+	 * The AFBC decoder uses the RDMA itself from the irq, so only queue
+	 * the commit when OSD1 doesn't go through it.
+	 */
+	if (!priv->rdma.addr || priv->viu.osd1_afbcd)
+		return;
+
+	meson_rdma_reset(priv);
+	meson_crtc->rdma_batch = true;
+
+	if (priv->viu.osd1_enabled) {
+		meson_crtc_write_osd1_regs(meson_crtc);
+		meson_crtc_write_osd1_scaler(meson_crtc);
+		if (meson_crtc->enable_osd1)
+			meson_crtc->enable_osd1(meson_crtc);
+	}
+
+	if (priv->viu.vd1_enabled)
+		meson_crtc_write_vd1_regs(meson_crtc);
+
+	meson_crtc->rdma_batch = false;
+	meson_crtc->rdma_missed = 0;
+	meson_crtc->rdma_armed = true;
+	meson_rdma_flush(priv);
 }
 
+static const struct drm_crtc_helper_funcs meson_crtc_helper_funcs = {
+	.atomic_begin	= meson_crtc_atomic_begin,
+	.atomic_flush	= meson_crtc_atomic_flush,
+	.atomic_enable	= meson_crtc_atomic_enable,
+	.atomic_disable	= meson_crtc_atomic_disable,
+};
+
+static const struct drm_crtc_helper_funcs meson_g12a_crtc_helper_funcs = {
+	.atomic_begin	= meson_crtc_atomic_begin,
+	.atomic_flush	= meson_crtc_atomic_flush,
+	.atomic_enable	= meson_g12a_crtc_atomic_enable,
+	.atomic_disable	= meson_g12a_crtc_atomic_disable,
+};
+
 void meson_crtc_irq(struct meson_drm *priv)
 {
 	struct meson_crtc *meson_crtc = to_meson_crtc(priv->crtc);
+	bool rdma = meson_crtc->rdma_armed;
 	unsigned long flags;
 
+	/*
+	 * The commit has been armed after this vsync, the RDMA writes it on
+	 * the next one, so keep the canvas and the event for then.
+	 */
+	if (rdma && !meson_rdma_done(priv) && !meson_crtc->rdma_missed++) {
+		if (!meson_crtc->vsync_disabled)
+			drm_crtc_handle_vblank(priv->crtc);
+		return;
+	}
+
+	if (rdma) {
+		/* one shot, don't replay the commit on the next vsyncs */
+		meson_rdma_stop(priv);
+		meson_crtc->rdma_armed = false;
+	}
+
 	/* Update the OSD registers */
 	if (priv->viu.osd1_enabled && priv->viu.osd1_commit) {
-		writel_relaxed(priv->viu.osd1_ctrl_stat,
-				priv->io_base + _REG(VIU_OSD1_CTRL_STAT));
-		writel_relaxed(priv->viu.osd1_ctrl_stat2,
-				priv->io_base + _REG(VIU_OSD1_CTRL_STAT2));
-		writel_relaxed(priv->viu.osd1_blk0_cfg[0],
-				priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W0));
-		writel_relaxed(priv->viu.osd1_blk0_cfg[1],
-				priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W1));
-		writel_relaxed(priv->viu.osd1_blk0_cfg[2],
-				priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W2));
-		writel_relaxed(priv->viu.osd1_blk0_cfg[3],
-				priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W3));
-		writel_relaxed(priv->viu.osd1_blk0_cfg[4],
-				priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W4));
+		if (!rdma)
+			meson_crtc_write_osd1_regs(meson_crtc);
 
 		if (priv->viu.osd1_afbcd) {
 			if (meson_crtc->enable_osd1_afbc)
@@ -345,26 +677,8 @@ void meson_crtc_irq(struct meson_drm *priv)
 			meson_crtc->vsync_forced = false;
 		}
 
-		writel_relaxed(priv->viu.osd_sc_ctrl0,
-				priv->io_base + _REG(VPP_OSD_SC_CTRL0));
-		writel_relaxed(priv->viu.osd_sc_i_wh_m1,
-				priv->io_base + _REG(VPP_OSD_SCI_WH_M1));
-		writel_relaxed(priv->viu.osd_sc_o_h_start_end,
-				priv->io_base + _REG(VPP_OSD_SCO_H_START_END));
-		writel_relaxed(priv->viu.osd_sc_o_v_start_end,
-				priv->io_base + _REG(VPP_OSD_SCO_V_START_END));
-		writel_relaxed(priv->viu.osd_sc_v_ini_phase,
-				priv->io_base + _REG(VPP_OSD_VSC_INI_PHASE));
-		writel_relaxed(priv->viu.osd_sc_v_phase_step,
-				priv->io_base + _REG(VPP_OSD_VSC_PHASE_STEP));
-		writel_relaxed(priv->viu.osd_sc_h_ini_phase,
-				priv->io_base + _REG(VPP_OSD_HSC_INI_PHASE));
-		writel_relaxed(priv->viu.osd_sc_h_phase_step,
-				priv->io_base + _REG(VPP_OSD_HSC_PHASE_STEP));
-		writel_relaxed(priv->viu.osd_sc_h_ctrl0,
-				priv->io_base + _REG(VPP_OSD_HSC_CTRL0));
-		writel_relaxed(priv->viu.osd_sc_v_ctrl0,
-				priv->io_base + _REG(VPP_OSD_VSC_CTRL0));
+		if (!rdma)
+			meson_crtc_write_osd1_scaler(meson_crtc);
 
 		if (!priv->viu.osd1_afbcd)
 			meson_canvas_config(priv->canvas, priv->canvas_id_osd1,
@@ -375,8 +689,8 @@ void meson_crtc_irq(struct meson_drm *priv)
 					    MESON_CANVAS_BLKMODE_LINEAR, 0);
 
 		/* Enable OSD1 */
-		if (meson_crtc->enable_osd1)
-			meson_crtc->enable_osd1(priv);
+		if (!rdma && meson_crtc->enable_osd1)
+			meson_crtc->enable_osd1(meson_crtc);
 
 		if (priv->viu.osd1_afbcd) {
 			priv->afbcd.ops->reset(priv);
@@ -390,269 +704,11 @@ void meson_crtc_irq(struct meson_drm *priv)
 
 	/* Update the VD1 registers */
 	if (priv->viu.vd1_enabled && priv->viu.vd1_commit) {
+		if (!priv->viu.vd1_afbc)
+			meson_crtc_config_vd1_canvas(priv);
 
-		if (priv->viu.vd1_afbc) {
-			writel_relaxed(priv->viu.vd1_afbc_head_addr,
-				       priv->io_base +
-				       _REG(AFBC_HEAD_BADDR));
-			writel_relaxed(priv->viu.vd1_afbc_body_addr,
-				       priv->io_base +
-				       _REG(AFBC_BODY_BADDR));
-			writel_relaxed(priv->viu.vd1_afbc_en,
-				       priv->io_base +
-				       _REG(AFBC_ENABLE));
-			writel_relaxed(priv->viu.vd1_afbc_mode,
-				       priv->io_base +
-				       _REG(AFBC_MODE));
-			writel_relaxed(priv->viu.vd1_afbc_size_in,
-				       priv->io_base +
-				       _REG(AFBC_SIZE_IN));
-			writel_relaxed(priv->viu.vd1_afbc_dec_def_color,
-				       priv->io_base +
-				       _REG(AFBC_DEC_DEF_COLOR));
-			writel_relaxed(priv->viu.vd1_afbc_conv_ctrl,
-				       priv->io_base +
-				       _REG(AFBC_CONV_CTRL));
-			writel_relaxed(priv->viu.vd1_afbc_size_out,
-				       priv->io_base +
-				       _REG(AFBC_SIZE_OUT));
-			writel_relaxed(priv->viu.vd1_afbc_vd_cfmt_ctrl,
-				       priv->io_base +
-				       _REG(AFBC_VD_CFMT_CTRL));
-			writel_relaxed(priv->viu.vd1_afbc_vd_cfmt_w,
-				       priv->io_base +
-				       _REG(AFBC_VD_CFMT_W));
-			writel_relaxed(priv->viu.vd1_afbc_mif_hor_scope,
-				       priv->io_base +
-				       _REG(AFBC_MIF_HOR_SCOPE));
-			writel_relaxed(priv->viu.vd1_afbc_mif_ver_scope,
-				       priv->io_base +
-				       _REG(AFBC_MIF_VER_SCOPE));
-			writel_relaxed(priv->viu.vd1_afbc_pixel_hor_scope,
-				       priv->io_base+
-				       _REG(AFBC_PIXEL_HOR_SCOPE));
-			writel_relaxed(priv->viu.vd1_afbc_pixel_ver_scope,
-				       priv->io_base +
-				       _REG(AFBC_PIXEL_VER_SCOPE));
-			writel_relaxed(priv->viu.vd1_afbc_vd_cfmt_h,
-				       priv->io_base +
-				       _REG(AFBC_VD_CFMT_H));
-		} else {
-			switch (priv->viu.vd1_planes) {
-			case 3:
-				meson_canvas_config(priv->canvas,
-						    priv->canvas_id_vd1_2,
-						    priv->viu.vd1_addr2,
-						    priv->viu.vd1_stride2,
-						    priv->viu.vd1_height2,
-						    MESON_CANVAS_WRAP_NONE,
-						    MESON_CANVAS_BLKMODE_LINEAR,
-						    MESON_CANVAS_ENDIAN_SWAP64);
-				fallthrough;
-			case 2:
-				meson_canvas_config(priv->canvas,
-						    priv->canvas_id_vd1_1,
-						    priv->viu.vd1_addr1,
-						    priv->viu.vd1_stride1,
-						    priv->viu.vd1_height1,
-						    MESON_CANVAS_WRAP_NONE,
-						    MESON_CANVAS_BLKMODE_LINEAR,
-						    MESON_CANVAS_ENDIAN_SWAP64);
-				fallthrough;
-			case 1:
-				meson_canvas_config(priv->canvas,
-						    priv->canvas_id_vd1_0,
-						    priv->viu.vd1_addr0,
-						    priv->viu.vd1_stride0,
-						    priv->viu.vd1_height0,
-						    MESON_CANVAS_WRAP_NONE,
-						    MESON_CANVAS_BLKMODE_LINEAR,
-						    MESON_CANVAS_ENDIAN_SWAP64);
-			}
-
-			writel_relaxed(0, priv->io_base + _REG(AFBC_ENABLE));
-		}
-
-		writel_relaxed(priv->viu.vd1_if0_gen_reg,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_GEN_REG));
-		writel_relaxed(priv->viu.vd1_if0_gen_reg,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_GEN_REG));
-		writel_relaxed(priv->viu.vd1_if0_gen_reg2,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_GEN_REG2));
-		writel_relaxed(priv->viu.viu_vd1_fmt_ctrl,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VIU_VD1_FMT_CTRL));
-		writel_relaxed(priv->viu.viu_vd1_fmt_ctrl,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VIU_VD2_FMT_CTRL));
-		writel_relaxed(priv->viu.viu_vd1_fmt_w,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VIU_VD1_FMT_W));
-		writel_relaxed(priv->viu.viu_vd1_fmt_w,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VIU_VD2_FMT_W));
-		writel_relaxed(priv->viu.vd1_if0_canvas0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CANVAS0));
-		writel_relaxed(priv->viu.vd1_if0_canvas0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CANVAS1));
-		writel_relaxed(priv->viu.vd1_if0_canvas0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CANVAS0));
-		writel_relaxed(priv->viu.vd1_if0_canvas0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CANVAS1));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_repeat_loop,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_RPT_LOOP));
-		writel_relaxed(priv->viu.vd1_if0_repeat_loop,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_RPT_LOOP));
-		writel_relaxed(priv->viu.vd1_if0_luma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA0_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_luma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA0_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_luma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA1_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_luma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA1_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_chroma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA0_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_chroma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA0_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_chroma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA1_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_chroma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA1_RPT_PAT));
-		writel_relaxed(0, priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA_PSEL));
-		writel_relaxed(0, priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA_PSEL));
-		writel_relaxed(0, priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA_PSEL));
-		writel_relaxed(0, priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA_PSEL));
-		writel_relaxed(priv->viu.vd1_range_map_y,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_RANGE_MAP_Y));
-		writel_relaxed(priv->viu.vd1_range_map_cb,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_RANGE_MAP_CB));
-		writel_relaxed(priv->viu.vd1_range_map_cr,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_RANGE_MAP_CR));
-		writel_relaxed(VPP_VSC_BANK_LENGTH(4) |
-			       VPP_HSC_BANK_LENGTH(4) |
-			       VPP_SC_VD_EN_ENABLE |
-			       VPP_SC_TOP_EN_ENABLE |
-			       VPP_SC_HSC_EN_ENABLE |
-			       VPP_SC_VSC_EN_ENABLE,
-				priv->io_base + _REG(VPP_SC_MISC));
-		writel_relaxed(priv->viu.vpp_pic_in_height,
-				priv->io_base + _REG(VPP_PIC_IN_HEIGHT));
-		writel_relaxed(priv->viu.vpp_postblend_vd1_h_start_end,
-			priv->io_base + _REG(VPP_POSTBLEND_VD1_H_START_END));
-		writel_relaxed(priv->viu.vpp_blend_vd2_h_start_end,
-			priv->io_base + _REG(VPP_BLEND_VD2_H_START_END));
-		writel_relaxed(priv->viu.vpp_postblend_vd1_v_start_end,
-			priv->io_base + _REG(VPP_POSTBLEND_VD1_V_START_END));
-		writel_relaxed(priv->viu.vpp_blend_vd2_v_start_end,
-			priv->io_base + _REG(VPP_BLEND_VD2_V_START_END));
-		writel_relaxed(priv->viu.vpp_hsc_region12_startp,
-				priv->io_base + _REG(VPP_HSC_REGION12_STARTP));
-		writel_relaxed(priv->viu.vpp_hsc_region34_startp,
-				priv->io_base + _REG(VPP_HSC_REGION34_STARTP));
-		writel_relaxed(priv->viu.vpp_hsc_region4_endp,
-				priv->io_base + _REG(VPP_HSC_REGION4_ENDP));
-		writel_relaxed(priv->viu.vpp_hsc_start_phase_step,
-				priv->io_base + _REG(VPP_HSC_START_PHASE_STEP));
-		writel_relaxed(priv->viu.vpp_hsc_region1_phase_slope,
-			priv->io_base + _REG(VPP_HSC_REGION1_PHASE_SLOPE));
-		writel_relaxed(priv->viu.vpp_hsc_region3_phase_slope,
-			priv->io_base + _REG(VPP_HSC_REGION3_PHASE_SLOPE));
-		writel_relaxed(priv->viu.vpp_line_in_length,
-				priv->io_base + _REG(VPP_LINE_IN_LENGTH));
-		writel_relaxed(priv->viu.vpp_preblend_h_size,
-				priv->io_base + _REG(VPP_PREBLEND_H_SIZE));
-		writel_relaxed(priv->viu.vpp_vsc_region12_startp,
-				priv->io_base + _REG(VPP_VSC_REGION12_STARTP));
-		writel_relaxed(priv->viu.vpp_vsc_region34_startp,
-				priv->io_base + _REG(VPP_VSC_REGION34_STARTP));
-		writel_relaxed(priv->viu.vpp_vsc_region4_endp,
-				priv->io_base + _REG(VPP_VSC_REGION4_ENDP));
-		writel_relaxed(priv->viu.vpp_vsc_start_phase_step,
-				priv->io_base + _REG(VPP_VSC_START_PHASE_STEP));
-		writel_relaxed(priv->viu.vpp_vsc_ini_phase,
-				priv->io_base + _REG(VPP_VSC_INI_PHASE));
-		writel_relaxed(priv->viu.vpp_vsc_phase_ctrl,
-				priv->io_base + _REG(VPP_VSC_PHASE_CTRL));
-		writel_relaxed(priv->viu.vpp_hsc_phase_ctrl,
-				priv->io_base + _REG(VPP_HSC_PHASE_CTRL));
-		writel_relaxed(0x42, priv->io_base + _REG(VPP_SCALE_COEF_IDX));
-
-		/* Enable VD1 */
-		if (meson_crtc->enable_vd1)
-			meson_crtc->enable_vd1(priv);
+		if (!rdma)
+			meson_crtc_write_vd1_regs(meson_crtc);
 
 		priv->viu.vd1_commit = false;
 	}
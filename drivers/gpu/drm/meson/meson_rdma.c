@@ -88,8 +88,11 @@ void meson_rdma_reset(struct meson_drm *priv)
 	priv->rdma.offset = 0;
 }
 
-static void meson_rdma_writel(struct meson_drm *priv, uint32_t val,
-			      uint32_t reg)
+/*
+ * This only adds the register to the RDMA buffer, the hardware is written
+ * by the RDMA on the first VSYNC after meson_rdma_flush.
+ */
+void meson_rdma_writel(struct meson_drm *priv, uint32_t val, uint32_t reg)
 {
 	if (priv->rdma.offset >= (SZ_4K / RDMA_DESC_SIZE)) {
 		dev_warn_once(priv->dev, "%s: overflow\n", __func__);
@@ -100,6 +103,28 @@ static void meson_rdma_writel(struct meson_drm *priv, uint32_t val,
 	priv->rdma.addr[priv->rdma.offset++] = val;
 }
 
+/*
+ * Same as meson_rdma_writel for a read-modify-write of a register, the
+ * value queued last for the register is used as base if there is one.
+ */
+void meson_rdma_writel_bits(struct meson_drm *priv, uint32_t mask,
+			    uint32_t val, uint32_t reg)
+{
+	uint32_t cur;
+	int i;
+
+	for (i = priv->rdma.offset - 2; i >= 0; i -= 2)
+		if (priv->rdma.addr[i] == reg)
+			break;
+
+	if (i >= 0)
+		cur = priv->rdma.addr[i + 1];
+	else
+		cur = readl_relaxed(priv->io_base + _REG(reg));
+
+	meson_rdma_writel(priv, (cur & ~mask) | (val & mask), reg);
+}
+
 /*
  * This will add the register to the RDMA buffer and write it to the
  * hardware at the same time.
@@ -117,6 +142,10 @@ void meson_rdma_flush(struct meson_drm *priv)
 {
 	meson_rdma_stop(priv);
 
+	/* Release the IRQ clear left by meson_rdma_stop for meson_rdma_done */
+	writel_bits_relaxed(RDMA_IRQ_CLEAR_CHAN1, 0,
+			    priv->io_base + _REG(RDMA_CTRL));
+
 	/* Start of Channel 1 register writes buffer */
 	writel(priv->rdma.addr_dma,
 	       priv->io_base + _REG(RDMA_AHB_START_ADDR_1));
@@ -133,3 +162,21 @@ void meson_rdma_flush(struct meson_drm *priv)
 
 	priv->rdma.offset = 0;
 }
+
+/*
+ * Returns true once the RDMA replayed the buffer armed by meson_rdma_flush,
+ * and acknowledges it.
+ */
+bool meson_rdma_done(struct meson_drm *priv)
+{
+	if (!(readl_relaxed(priv->io_base + _REG(RDMA_STATUS)) &
+	      RDMA_IRQ_STAT_CHAN1))
+		return false;
+
+	writel_bits_relaxed(RDMA_IRQ_CLEAR_CHAN1, RDMA_IRQ_CLEAR_CHAN1,
+			    priv->io_base + _REG(RDMA_CTRL));
+	writel_bits_relaxed(RDMA_IRQ_CLEAR_CHAN1, 0,
+			    priv->io_base + _REG(RDMA_CTRL));
+
+	return true;
+}
@@ -18,6 +18,7 @@
 #include <drm/drm_mipi_dsi.h>
 #include <drm/drm_modes.h>
 #include <drm/drm_panel.h>
+#include <drm/drm_rect.h>
 
 #include <video/mipi_display.h>
 
@@ -176,16 +177,24 @@ static int dsicm_get_id(struct panel_drv_data *ddata, u8 *id1, u8 *id2, u8 *id3)
 	return 0;
 }
 
-static int dsicm_set_update_window(struct panel_drv_data *ddata)
+static int dsicm_set_update_window(struct panel_drv_data *ddata,
+				   const struct drm_rect *rect)
 {
 	struct mipi_dsi_device *dsi = ddata->dsi;
+	struct drm_rect full;
 	int r;
 
-	r = mipi_dsi_dcs_set_column_address(dsi, 0, ddata->mode.hdisplay - 1);
+	if (!rect) {
+		drm_rect_init(&full, 0, 0, ddata->mode.hdisplay,
+			      ddata->mode.vdisplay);
+		rect = &full;
+	}
+
+	r = mipi_dsi_dcs_set_column_address(dsi, rect->x1, rect->x2 - 1);
 	if (r < 0)
 		return r;
 
-	r = mipi_dsi_dcs_set_page_address(dsi, 0, ddata->mode.vdisplay - 1);
+	r = mipi_dsi_dcs_set_page_address(dsi, rect->y1, rect->y2 - 1);
 	if (r < 0)
 		return r;
 
@@ -271,12 +280,24 @@ static ssize_t hw_revision_show(struct device *dev,
 	return sysfs_emit(buf, "%02x.%02x.%02x\n", id1, id2, id3);
 }
 
+static ssize_t partial_updates_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct panel_drv_data *ddata = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "partial %lu full %lu\n",
+			  ddata->panel.num_partial_updates,
+			  ddata->panel.num_full_updates);
+}
+
 static DEVICE_ATTR_RO(num_dsi_errors);
 static DEVICE_ATTR_RO(hw_revision);
+static DEVICE_ATTR_RO(partial_updates);
 
 static struct attribute *dsicm_attrs[] = {
 	&dev_attr_num_dsi_errors.attr,
 	&dev_attr_hw_revision.attr,
+	&dev_attr_partial_updates.attr,
 	NULL,
 };
 
@@ -327,7 +348,7 @@ static int dsicm_power_on(struct panel_drv_data *ddata)
 	if (r)
 		goto err;
 
-	r = dsicm_set_update_window(ddata);
+	r = dsicm_set_update_window(ddata, NULL);
 	if (r)
 		goto err;
 
@@ -466,12 +487,39 @@ static int dsicm_get_modes(struct drm_panel *panel,
 	return 1;
 }
 
+static int dsicm_panel_set_update_window(struct drm_panel *panel,
+					 struct drm_rect *rect)
+{
+	struct panel_drv_data *ddata = panel_to_ddata(panel);
+	struct drm_rect full;
+	int r;
+
+	if (rect) {
+		drm_rect_init(&full, 0, 0, ddata->mode.hdisplay,
+			      ddata->mode.vdisplay);
+		if (!drm_rect_intersect(rect, &full))
+			return -EINVAL;
+	}
+
+	mutex_lock(&ddata->lock);
+
+	if (ddata->enabled)
+		r = dsicm_set_update_window(ddata, rect);
+	else
+		r = -ENODEV;
+
+	mutex_unlock(&ddata->lock);
+
+	return r;
+}
+
 static const struct drm_panel_funcs dsicm_panel_funcs = {
 	.unprepare = dsicm_unprepare,
 	.disable = dsicm_disable,
 	.prepare = dsicm_prepare,
 	.enable = dsicm_enable,
 	.get_modes = dsicm_get_modes,
+	.set_update_window = dsicm_panel_set_update_window,
 };
 
 static int dsicm_probe_of(struct mipi_dsi_device *dsi)
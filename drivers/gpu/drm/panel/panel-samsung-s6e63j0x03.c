@@ -19,6 +19,7 @@
 #include <drm/drm_mipi_dsi.h>
 #include <drm/drm_modes.h>
 #include <drm/drm_panel.h>
+#include <drm/drm_rect.h>
 
 #define MCS_LEVEL2_KEY		0xf0
 #define MCS_MTP_KEY		0xf1
@@ -32,6 +33,9 @@
 
 #define FIRST_COLUMN 20
 
+/* the partial update window has to start and end on even pixels */
+#define UPDATE_WINDOW_ALIGN	2
+
 struct s6e63j0x03 {
 	struct device *dev;
 	struct drm_panel panel;
@@ -144,6 +148,27 @@ static inline int s6e63j0x03_apply_mtp_key(struct s6e63j0x03 *ctx, bool on)
 	return s6e63j0x03_dcs_write_seq_static(ctx, MCS_MTP_KEY, 0xa5, 0xa5);
 }
 
+static int s6e63j0x03_set_window(struct s6e63j0x03 *ctx,
+				 const struct drm_rect *rect)
+{
+	struct mipi_dsi_device *dsi = to_mipi_dsi_device(ctx->dev);
+	struct drm_rect full;
+	int ret;
+
+	if (!rect) {
+		drm_rect_init(&full, 0, 0, default_mode.hdisplay,
+			      default_mode.vdisplay);
+		rect = &full;
+	}
+
+	ret = mipi_dsi_dcs_set_column_address(dsi, rect->x1 + FIRST_COLUMN,
+		rect->x2 - 1 + FIRST_COLUMN);
+	if (ret < 0)
+		return ret;
+
+	return mipi_dsi_dcs_set_page_address(dsi, rect->y1, rect->y2 - 1);
+}
+
 static int s6e63j0x03_power_on(struct s6e63j0x03 *ctx)
 {
 	int ret;
@@ -274,12 +299,7 @@ static int s6e63j0x03_panel_init(struct s6e63j0x03 *ctx)
 		return ret;
 
 	/* set caset, paset */
-	ret = mipi_dsi_dcs_set_column_address(dsi, FIRST_COLUMN,
-		default_mode.hdisplay - 1 + FIRST_COLUMN);
-	if (ret < 0)
-		return ret;
-
-	ret = mipi_dsi_dcs_set_page_address(dsi, 0, default_mode.vdisplay - 1);
+	ret = s6e63j0x03_set_window(ctx, NULL);
 	if (ret < 0)
 		return ret;
 
@@ -422,12 +442,35 @@ static int s6e63j0x03_get_modes(struct drm_panel *panel,
 	return 1;
 }
 
+static int s6e63j0x03_set_update_window(struct drm_panel *panel,
+					struct drm_rect *rect)
+{
+	struct s6e63j0x03 *ctx = panel_to_s6e63j0x03(panel);
+
+	if (ctx->bl_dev->props.power != FB_BLANK_UNBLANK)
+		return -ENODEV;
+
+	if (rect) {
+		rect->x1 = round_down(max(rect->x1, 0), UPDATE_WINDOW_ALIGN);
+		rect->y1 = round_down(max(rect->y1, 0), UPDATE_WINDOW_ALIGN);
+		rect->x2 = round_up(min_t(int, rect->x2, default_mode.hdisplay),
+				    UPDATE_WINDOW_ALIGN);
+		rect->y2 = round_up(min_t(int, rect->y2, default_mode.vdisplay),
+				    UPDATE_WINDOW_ALIGN);
+		if (!drm_rect_visible(rect))
+			return -EINVAL;
+	}
+
+	return s6e63j0x03_set_window(ctx, rect);
+}
+
 static const struct drm_panel_funcs s6e63j0x03_funcs = {
 	.disable = s6e63j0x03_disable,
 	.unprepare = s6e63j0x03_unprepare,
 	.prepare = s6e63j0x03_prepare,
 	.enable = s6e63j0x03_enable,
 	.get_modes = s6e63j0x03_get_modes,
+	.set_update_window = s6e63j0x03_set_update_window,
 };
 
 static int s6e63j0x03_probe(struct mipi_dsi_device *dsi)
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <drm/drm_debugfs.h>
+#include <drm/drm_file.h>
+
+#include "panfrost_device.h"
+#include "panfrost_debugfs.h"
+
+static int panfrost_mmu_stats_show(struct seq_file *m, void *unused)
+{
+	struct panfrost_device *pfdev = m->private;
+
+	seq_printf(m, "maps: %lld\n", atomic64_read(&pfdev->mmu_stats.maps));
+	seq_printf(m, "map_ns: %lld\n", atomic64_read(&pfdev->mmu_stats.map_ns));
+	seq_printf(m, "mapped_bytes: %lld\n",
+		   atomic64_read(&pfdev->mmu_stats.mapped_bytes));
+	seq_printf(m, "unmaps: %lld\n", atomic64_read(&pfdev->mmu_stats.unmaps));
+	seq_printf(m, "unmap_ns: %lld\n",
+		   atomic64_read(&pfdev->mmu_stats.unmap_ns));
+	seq_printf(m, "flushes: %lld\n",
+		   atomic64_read(&pfdev->mmu_stats.flushes));
+	seq_printf(m, "deferred_flushes: %lld\n",
+		   atomic64_read(&pfdev->mmu_stats.deferred_flushes));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(panfrost_mmu_stats);
+
+static int panfrost_job_stats_show(struct seq_file *m, void *unused)
+{
+	struct panfrost_device *pfdev = m->private;
+	int i;
+
+	/*
+	 * queued_next counts the jobs written to the _NEXT registers while
+	 * the previous job of the slot was still running.
+	 */
+	for (i = 0; i < NUM_JOB_SLOTS; i++)
+		seq_printf(m, "js%d: submitted %llu queued_next %llu\n", i,
+			   READ_ONCE(pfdev->js_stats[i].submitted),
+			   READ_ONCE(pfdev->js_stats[i].queued_next));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(panfrost_job_stats);
+
+static int panfrost_shrinker_stats_show(struct seq_file *m, void *unused)
+{
+	struct panfrost_device *pfdev = m->private;
+
+	seq_printf(m, "purgeable_pages: %lu\n",
+		   READ_ONCE(pfdev->purgeable_lru.pages));
+	seq_printf(m, "evictable_pages: %lu\n",
+		   READ_ONCE(pfdev->evictable_lru.pages));
+	seq_printf(m, "purged_pages: %lld\n",
+		   atomic64_read(&pfdev->shrinker_stats.purged));
+	seq_printf(m, "evicted_pages: %lld\n",
+		   atomic64_read(&pfdev->shrinker_stats.evicted));
+	seq_printf(m, "swapins: %lld\n",
+		   atomic64_read(&pfdev->shrinker_stats.swapped_in));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(panfrost_shrinker_stats);
+
+void panfrost_debugfs_init(struct drm_minor *minor)
+{
+	struct panfrost_device *pfdev = to_panfrost_device(minor->dev);
+
+	debugfs_create_file("mmu_stats", 0444, minor->debugfs_root, pfdev,
+			    &panfrost_mmu_stats_fops);
+	debugfs_create_file("job_stats", 0444, minor->debugfs_root, pfdev,
+			    &panfrost_job_stats_fops);
+	debugfs_create_file("shrinker_stats", 0444, minor->debugfs_root, pfdev,
+			    &panfrost_shrinker_stats_fops);
+}
@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#ifndef __PANFROST_DEBUGFS_H__
+#define __PANFROST_DEBUGFS_H__
+
+struct drm_minor;
+
+#ifdef CONFIG_DEBUG_FS
+void panfrost_debugfs_init(struct drm_minor *minor);
+#endif
+
+#endif /* __PANFROST_DEBUGFS_H__ */
@@ -76,6 +76,15 @@ struct panfrost_compatible {
 	void (*vendor_quirk)(struct panfrost_device *pfdev);
 };
 
+/*
+ * BOs the shrinker can reclaim, least recently used by the GPU first.
+ * Protected by the shrinker_lock, @pages can be read locklessly.
+ */
+struct panfrost_gem_lru {
+	struct list_head list;
+	unsigned long pages;
+};
+
 struct panfrost_device {
 	struct device *dev;
 	struct drm_device *ddev;
@@ -102,7 +111,13 @@ struct panfrost_device {
 
 	struct panfrost_job_slot *js;
 
+	/* Running job and job queued in the _NEXT registers of each slot */
 	struct panfrost_job *jobs[NUM_JOB_SLOTS][2];
+	/* Protected by the job_lock */
+	struct {
+		u64 submitted;
+		u64 queued_next;
+	} js_stats[NUM_JOB_SLOTS];
 	struct list_head scheduled_jobs;
 
 	struct panfrost_perfcnt *perfcnt;
@@ -116,10 +131,29 @@ struct panfrost_device {
 	} reset;
 
 	struct mutex shrinker_lock;
-	struct list_head shrinker_list;
+	/* madvise(DONTNEED) BOs, purged */
+	struct panfrost_gem_lru purgeable_lru;
+	/* Idle WILLNEED BOs, swapped out */
+	struct panfrost_gem_lru evictable_lru;
 	struct shrinker shrinker;
+	struct {
+		atomic64_t purged;
+		atomic64_t evicted;
+		atomic64_t swapped_in;
+	} shrinker_stats;
 
 	struct panfrost_devfreq pfdevfreq;
+
+	/* GPU VA map/unmap statistics, exposed in debugfs */
+	struct {
+		atomic64_t maps;
+		atomic64_t unmaps;
+		atomic64_t map_ns;
+		atomic64_t unmap_ns;
+		atomic64_t mapped_bytes;
+		atomic64_t flushes;
+		atomic64_t deferred_flushes;
+	} mmu_stats;
 };
 
 struct panfrost_mmu {
@@ -132,6 +166,9 @@ struct panfrost_mmu {
 	int as;
 	atomic_t as_count;
 	struct list_head list;
+	/* PT flush deferred to the next panfrost_mmu_as_get(), as_lock */
+	u64 flush_start;
+	u64 flush_end;
 };
 
 struct panfrost_file_priv {
@@ -13,6 +13,7 @@
 #include <drm/drm_syncobj.h>
 #include <drm/drm_utils.h>
 
+#include "panfrost_debugfs.h"
 #include "panfrost_device.h"
 #include "panfrost_gem.h"
 #include "panfrost_mmu.h"
@@ -162,6 +163,10 @@ panfrost_lookup_bos(struct drm_device *dev,
 
 		atomic_inc(&bo->gpu_usecount);
 		job->mappings[i] = mapping;
+
+		ret = panfrost_gem_swapin(bo);
+		if (ret)
+			break;
 	}
 
 	return ret;
@@ -263,6 +268,7 @@ static int panfrost_ioctl_submit(struct drm_device *dev, void *data,
 	job->requirements = args->requirements;
 	job->flush_id = panfrost_gpu_get_latest_flush_id(pfdev);
 	job->file_priv = file->driver_priv;
+	job->pid = task_tgid_nr(current);
 
 	slot = panfrost_job_get_slot(job);
 
@@ -429,12 +435,16 @@ static int panfrost_ioctl_madvise(struct drm_device *dev, void *data,
 
 	args->retained = drm_gem_shmem_madvise(&bo->base, args->madv);
 
-	if (args->retained) {
+	/*
+	 * WILLNEED BOs go back on the evictable LRU the next time the GPU
+	 * uses them. Evicted BOs have nothing left to purge.
+	 */
+	if (args->retained && !bo->evicted) {
 		if (args->madv == PANFROST_MADV_DONTNEED)
-			list_add_tail(&bo->base.madv_list,
-				      &pfdev->shrinker_list);
+			panfrost_gem_lru_move_tail_locked(&pfdev->purgeable_lru,
+							  bo);
 		else if (args->madv == PANFROST_MADV_WILLNEED)
-			list_del_init(&bo->base.madv_list);
+			panfrost_gem_lru_remove_locked(bo);
 	}
 
 out_unlock_mappings:
@@ -511,6 +521,7 @@ static const struct drm_ioctl_desc panfrost_drm_driver_ioctls[] = {
 	PANFROST_IOCTL(PERFCNT_ENABLE,	perfcnt_enable,	DRM_RENDER_ALLOW),
 	PANFROST_IOCTL(PERFCNT_DUMP,	perfcnt_dump,	DRM_RENDER_ALLOW),
 	PANFROST_IOCTL(MADVISE,		madvise,	DRM_RENDER_ALLOW),
+	PANFROST_IOCTL(PERFCNT_RING,	perfcnt_ring,	DRM_RENDER_ALLOW),
 };
 
 DEFINE_DRM_GEM_FOPS(panfrost_drm_driver_fops);
@@ -539,6 +550,10 @@ static const struct drm_driver panfrost_drm_driver = {
 	.prime_fd_to_handle	= drm_gem_prime_fd_to_handle,
 	.gem_prime_import_sg_table = panfrost_gem_prime_import_sg_table,
 	.gem_prime_mmap		= drm_gem_prime_mmap,
+
+#ifdef CONFIG_DEBUG_FS
+	.debugfs_init		= panfrost_debugfs_init,
+#endif
 };
 
 static int panfrost_probe(struct platform_device *pdev)
@@ -571,7 +586,8 @@ static int panfrost_probe(struct platform_device *pdev)
 	pfdev->ddev = ddev;
 
 	mutex_init(&pfdev->shrinker_lock);
-	INIT_LIST_HEAD(&pfdev->shrinker_list);
+	INIT_LIST_HEAD(&pfdev->purgeable_lru.list);
+	INIT_LIST_HEAD(&pfdev->evictable_lru.list);
 
 	err = panfrost_device_init(pfdev);
 	if (err) {
@@ -5,6 +5,7 @@
 #include <linux/slab.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
+#include <linux/shmem_fs.h>
 
 #include <drm/panfrost_drm.h>
 #include "panfrost_device.h"
@@ -26,7 +27,7 @@ static void panfrost_gem_free_object(struct drm_gem_object *obj)
 	 * panfrost_gem_shrinker_scan().
 	 */
 	mutex_lock(&pfdev->shrinker_lock);
-	list_del_init(&bo->base.madv_list);
+	panfrost_gem_lru_remove_locked(bo);
 	mutex_unlock(&pfdev->shrinker_lock);
 
 	/*
@@ -208,6 +209,63 @@ static const struct drm_gem_object_funcs panfrost_gem_funcs = {
 	.mmap = drm_gem_shmem_object_mmap,
 };
 
+static void panfrost_gem_heap_prefetch_work(struct work_struct *work)
+{
+	struct panfrost_gem_object *bo =
+		container_of(work, struct panfrost_gem_object, heap_prefetch_work);
+	struct address_space *mapping = bo->base.base.filp->f_mapping;
+	pgoff_t i, start, end;
+	int madv;
+
+	mutex_lock(&bo->base.pages_lock);
+	start = bo->heap_prefetch_start;
+	end = start + bo->heap_prefetch_pages;
+	madv = bo->base.madv;
+	mutex_unlock(&bo->base.pages_lock);
+
+	/*
+	 * Only pull the pages into the shmem page cache, the fault handler
+	 * picks them up from there without having to allocate and clear
+	 * them while the GPU waits.
+	 */
+	for (i = start; i < end && madv == PANFROST_MADV_WILLNEED; i++) {
+		struct page *page = shmem_read_mapping_page(mapping, i);
+
+		if (IS_ERR(page))
+			break;
+		put_page(page);
+	}
+
+	drm_gem_object_put(&bo->base.base);
+}
+
+/**
+ * panfrost_gem_heap_prefetch - Populate heap BO pages ahead of the GPU
+ * @bo: Heap BO
+ * @start: First page to populate
+ * @count: Number of pages to populate
+ *
+ * Queue a work item reading the shmem pages of the next heap growth step,
+ * so that the next fault on @bo doesn't have to allocate them.
+ */
+void panfrost_gem_heap_prefetch(struct panfrost_gem_object *bo,
+				pgoff_t start, unsigned long count)
+{
+	pgoff_t npages = bo->base.base.size >> PAGE_SHIFT;
+
+	if (start >= npages)
+		return;
+
+	mutex_lock(&bo->base.pages_lock);
+	bo->heap_prefetch_start = start;
+	bo->heap_prefetch_pages = min_t(unsigned long, count, npages - start);
+	mutex_unlock(&bo->base.pages_lock);
+
+	drm_gem_object_get(&bo->base.base);
+	if (!queue_work(system_unbound_wq, &bo->heap_prefetch_work))
+		drm_gem_object_put(&bo->base.base);
+}
+
 /**
  * panfrost_gem_create_object - Implementation of driver->gem_create_object.
  * @dev: DRM device
@@ -227,8 +285,12 @@ struct drm_gem_object *panfrost_gem_create_object(struct drm_device *dev, size_t
 
 	INIT_LIST_HEAD(&obj->mappings.list);
 	mutex_init(&obj->mappings.lock);
+	INIT_WORK(&obj->heap_prefetch_work, panfrost_gem_heap_prefetch_work);
 	obj->base.base.funcs = &panfrost_gem_funcs;
 	obj->base.map_wc = !pfdev->coherent;
+	/* The GPU writes behind the back of the mm, keep its data on swap-out */
+	obj->base.pages_mark_dirty_on_put = true;
+	obj->base.pages_mark_accessed_on_put = true;
 
 	return &obj->base.base;
 }
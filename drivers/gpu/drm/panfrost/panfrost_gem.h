@@ -4,9 +4,13 @@
 #ifndef __PANFROST_GEM_H__
 #define __PANFROST_GEM_H__
 
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
+
 #include <drm/drm_gem_shmem_helper.h>
 #include <drm/drm_mm.h>
 
+struct panfrost_gem_lru;
 struct panfrost_mmu;
 
 struct panfrost_gem_object {
@@ -36,8 +40,20 @@ struct panfrost_gem_object {
 	 */
 	atomic_t gpu_usecount;
 
+	/* LRU the BO is on (through base.madv_list), protected by the shrinker_lock */
+	struct panfrost_gem_lru *lru;
+
 	bool noexec		:1;
 	bool is_heap		:1;
+	/* Pages swapped out by the shrinker, protected by mappings.lock */
+	bool evicted		:1;
+
+	/* Heap growth state, see panfrost_mmu_map_fault_addr() */
+	ktime_t heap_last_fault;
+	unsigned int heap_fault_chunks;
+	struct work_struct heap_prefetch_work;
+	pgoff_t heap_prefetch_start;
+	unsigned long heap_prefetch_pages;
 };
 
 struct panfrost_gem_mapping {
@@ -74,6 +90,9 @@ panfrost_gem_create_with_handle(struct drm_file *file_priv,
 				u32 flags,
 				uint32_t *handle);
 
+void panfrost_gem_heap_prefetch(struct panfrost_gem_object *bo,
+				pgoff_t start, unsigned long count);
+
 int panfrost_gem_open(struct drm_gem_object *obj, struct drm_file *file_priv);
 void panfrost_gem_close(struct drm_gem_object *obj,
 			struct drm_file *file_priv);
@@ -84,6 +103,14 @@ panfrost_gem_mapping_get(struct panfrost_gem_object *bo,
 void panfrost_gem_mapping_put(struct panfrost_gem_mapping *mapping);
 void panfrost_gem_teardown_mappings_locked(struct panfrost_gem_object *bo);
 
+int panfrost_gem_swapin(struct panfrost_gem_object *bo);
+
+void panfrost_gem_lru_move_tail_locked(struct panfrost_gem_lru *lru,
+				       struct panfrost_gem_object *bo);
+void panfrost_gem_lru_remove_locked(struct panfrost_gem_object *bo);
+void panfrost_gem_shrinker_mark_used(struct panfrost_device *pfdev,
+				     struct panfrost_gem_mapping **mappings,
+				     unsigned int count);
 void panfrost_gem_shrinker_init(struct drm_device *dev);
 void panfrost_gem_shrinker_cleanup(struct drm_device *dev);
 
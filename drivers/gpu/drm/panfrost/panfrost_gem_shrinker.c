@@ -6,43 +6,146 @@
  * Author: Rob Clark <robdclark@gmail.com>
  */
 
+#include <linux/dma-mapping.h>
 #include <linux/list.h>
+#include <linux/sched.h>
+#include <linux/swap.h>
 
 #include <drm/drm_device.h>
 #include <drm/drm_gem_shmem_helper.h>
+#include <drm/panfrost_drm.h>
 
 #include "panfrost_device.h"
 #include "panfrost_gem.h"
 #include "panfrost_mmu.h"
 
-static unsigned long
-panfrost_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
+/* Number of BOs looked at per shrinker_lock section */
+#define SHRINK_BATCH_SIZE	32
+
+/**
+ * panfrost_gem_lru_move_tail_locked - Mark a BO as most recently used
+ * @lru: LRU to put the BO on
+ * @bo: BO to move, possibly from another LRU
+ *
+ * Must be called with the shrinker_lock held.
+ */
+void panfrost_gem_lru_move_tail_locked(struct panfrost_gem_lru *lru,
+				       struct panfrost_gem_object *bo)
 {
-	struct panfrost_device *pfdev =
-		container_of(shrinker, struct panfrost_device, shrinker);
-	struct drm_gem_shmem_object *shmem;
-	unsigned long count = 0;
+	unsigned long npages = bo->base.base.size >> PAGE_SHIFT;
 
-	if (!mutex_trylock(&pfdev->shrinker_lock))
-		return 0;
+	if (bo->lru)
+		WRITE_ONCE(bo->lru->pages, bo->lru->pages - npages);
 
-	list_for_each_entry(shmem, &pfdev->shrinker_list, madv_list) {
-		if (drm_gem_shmem_is_purgeable(shmem))
-			count += shmem->base.size >> PAGE_SHIFT;
-	}
+	list_move_tail(&bo->base.madv_list, &lru->list);
+	WRITE_ONCE(lru->pages, lru->pages + npages);
+	bo->lru = lru;
+}
+
+/**
+ * panfrost_gem_lru_remove_locked - Hide a BO from the shrinker
+ * @bo: BO to remove from its LRU, if any
+ *
+ * Must be called with the shrinker_lock held.
+ */
+void panfrost_gem_lru_remove_locked(struct panfrost_gem_object *bo)
+{
+	if (!bo->lru)
+		return;
+
+	WRITE_ONCE(bo->lru->pages,
+		   bo->lru->pages - (bo->base.base.size >> PAGE_SHIFT));
+	list_del_init(&bo->base.madv_list);
+	bo->lru = NULL;
+}
+
+static bool panfrost_gem_can_evict(struct panfrost_gem_object *bo)
+{
+	/* Heap pages are allocated on fault, imported pages aren't ours */
+	return !bo->is_heap && !bo->base.base.import_attach;
+}
+
+/**
+ * panfrost_gem_shrinker_mark_used - Bump the BOs of a job in the LRUs
+ * @pfdev: Panfrost device
+ * @mappings: Mappings used by the job, the array ends early on NULL
+ * @count: Number of entries in @mappings
+ *
+ * Called when the job is done with its BOs, so the LRUs are ordered by last
+ * GPU use.
+ */
+void panfrost_gem_shrinker_mark_used(struct panfrost_device *pfdev,
+				     struct panfrost_gem_mapping **mappings,
+				     unsigned int count)
+{
+	unsigned int i;
 
+	mutex_lock(&pfdev->shrinker_lock);
+	for (i = 0; i < count && mappings[i]; i++) {
+		struct panfrost_gem_object *bo = mappings[i]->obj;
+
+		if (bo->base.madv == PANFROST_MADV_DONTNEED)
+			panfrost_gem_lru_move_tail_locked(&pfdev->purgeable_lru,
+							  bo);
+		else if (bo->base.madv == PANFROST_MADV_WILLNEED &&
+			 panfrost_gem_can_evict(bo))
+			panfrost_gem_lru_move_tail_locked(&pfdev->evictable_lru,
+							  bo);
+	}
 	mutex_unlock(&pfdev->shrinker_lock);
+}
+
+/**
+ * panfrost_gem_swapin - Restore the pages of an evicted BO
+ * @bo: BO about to be used by a job
+ *
+ * Must be called after the job has raised the BO's gpu_usecount, so the
+ * shrinker can't evict it again before the job is done.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int panfrost_gem_swapin(struct panfrost_gem_object *bo)
+{
+	struct panfrost_device *pfdev = bo->base.base.dev->dev_private;
+	struct panfrost_gem_mapping *mapping;
+	struct sg_table *sgt;
+	int ret = 0;
+
+	mutex_lock(&bo->mappings.lock);
+	if (!bo->evicted)
+		goto out_unlock;
+
+	sgt = drm_gem_shmem_get_pages_sgt(&bo->base);
+	if (IS_ERR(sgt)) {
+		ret = PTR_ERR(sgt);
+		goto out_unlock;
+	}
 
-	return count;
+	/* GPU VAs were kept, only the page tables have to be filled again */
+	list_for_each_entry(mapping, &bo->mappings.list, node) {
+		if (mapping->active)
+			continue;
+
+		ret = panfrost_mmu_map(mapping);
+		if (ret)
+			goto out_unlock;
+	}
+
+	bo->evicted = false;
+	atomic64_inc(&pfdev->shrinker_stats.swapped_in);
+
+out_unlock:
+	mutex_unlock(&bo->mappings.lock);
+	return ret;
 }
 
-static bool panfrost_gem_purge(struct drm_gem_object *obj)
+static bool panfrost_gem_purge(struct panfrost_gem_object *bo)
 {
-	struct drm_gem_shmem_object *shmem = to_drm_gem_shmem_obj(obj);
-	struct panfrost_gem_object *bo = to_panfrost_bo(obj);
+	struct drm_gem_shmem_object *shmem = &bo->base;
 	bool ret = false;
 
-	if (atomic_read(&bo->gpu_usecount))
+	if (atomic_read(&bo->gpu_usecount) ||
+	    !drm_gem_shmem_is_purgeable(shmem))
 		return false;
 
 	if (!mutex_trylock(&bo->mappings.lock))
@@ -62,35 +165,160 @@ static bool panfrost_gem_purge(struct drm_gem_object *obj)
 	return ret;
 }
 
+static bool panfrost_gem_evict(struct panfrost_gem_object *bo)
+{
+	struct drm_gem_shmem_object *shmem = &bo->base;
+	struct drm_gem_object *obj = &shmem->base;
+	struct panfrost_gem_mapping *mapping;
+	struct sg_table *sgt;
+
+	if (atomic_read(&bo->gpu_usecount))
+		return false;
+
+	if (!mutex_trylock(&bo->mappings.lock))
+		return false;
+
+	if (!mutex_trylock(&shmem->pages_lock))
+		goto err_unlock_mappings;
+
+	/*
+	 * The submit path raises gpu_usecount before taking mappings.lock to
+	 * swap the BO in, check again now that we hold it. The pages must
+	 * only be referenced by our sgt: no CPU mapping, vmap, pin or export.
+	 */
+	if (atomic_read(&bo->gpu_usecount) || bo->evicted || !shmem->sgt ||
+	    shmem->pages_use_count != 1 || shmem->vmap_use_count ||
+	    obj->dma_buf)
+		goto err_unlock_pages;
+
+	/* Keep the GPU VAs, userspace still refers to the BO by them */
+	list_for_each_entry(mapping, &bo->mappings.list, node) {
+		if (mapping->active)
+			panfrost_mmu_unmap(mapping);
+	}
+
+	sgt = shmem->sgt;
+	shmem->sgt = NULL;
+	dma_unmap_sgtable(obj->dev->dev, sgt, DMA_BIDIRECTIONAL, 0);
+	sg_free_table(sgt);
+	kfree(sgt);
+	bo->evicted = true;
+
+	mutex_unlock(&shmem->pages_lock);
+
+	/*
+	 * Drop the pages reference of the sgt, the now unpinned pages are
+	 * written to swap by the regular shmem reclaim.
+	 */
+	drm_gem_shmem_put_pages(shmem);
+	mutex_unlock(&bo->mappings.lock);
+
+	return true;
+
+err_unlock_pages:
+	mutex_unlock(&shmem->pages_lock);
+err_unlock_mappings:
+	mutex_unlock(&bo->mappings.lock);
+	return false;
+}
+
+static bool panfrost_gem_shrinker_can_swap(void)
+{
+	return get_nr_swap_pages() > 0;
+}
+
 static unsigned long
-panfrost_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
+panfrost_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
 {
 	struct panfrost_device *pfdev =
 		container_of(shrinker, struct panfrost_device, shrinker);
-	struct drm_gem_shmem_object *shmem, *tmp;
-	unsigned long freed = 0;
+	unsigned long count;
+
+	count = READ_ONCE(pfdev->purgeable_lru.pages);
+	if (panfrost_gem_shrinker_can_swap())
+		count += READ_ONCE(pfdev->evictable_lru.pages);
 
-	if (!mutex_trylock(&pfdev->shrinker_lock))
-		return SHRINK_STOP;
+	return count ?: SHRINK_EMPTY;
+}
+
+/*
+ * Walk @lru from its least recently used end. The shrinker_lock is only
+ * held for SHRINK_BATCH_SIZE BOs at a time, and only trylocked, so the
+ * madvise and job cleanup paths aren't stalled behind a long scan.
+ */
+static unsigned long
+panfrost_gem_shrinker_scan_lru(struct panfrost_device *pfdev,
+			       struct panfrost_gem_lru *lru,
+			       unsigned long nr_to_scan,
+			       bool (*shrink)(struct panfrost_gem_object *bo))
+{
+	unsigned long total = READ_ONCE(lru->pages);
+	unsigned long freed = 0, scanned = 0;
+	struct panfrost_gem_object *bo;
+	unsigned long npages;
+	unsigned int i;
+	bool empty;
 
-	list_for_each_entry_safe(shmem, tmp, &pfdev->shrinker_list, madv_list) {
-		if (freed >= sc->nr_to_scan)
+	while (freed < nr_to_scan && scanned < total) {
+		if (!mutex_trylock(&pfdev->shrinker_lock))
 			break;
-		if (drm_gem_shmem_is_purgeable(shmem) &&
-		    panfrost_gem_purge(&shmem->base)) {
-			freed += shmem->base.size >> PAGE_SHIFT;
-			list_del_init(&shmem->madv_list);
+
+		for (i = 0; i < SHRINK_BATCH_SIZE && !list_empty(&lru->list); i++) {
+			if (freed >= nr_to_scan || scanned >= total)
+				break;
+
+			bo = list_first_entry(&lru->list,
+					      struct panfrost_gem_object,
+					      base.madv_list);
+			npages = bo->base.base.size >> PAGE_SHIFT;
+			scanned += npages;
+
+			if (shrink(bo)) {
+				panfrost_gem_lru_remove_locked(bo);
+				freed += npages;
+			} else {
+				/* Busy, retry it after the other BOs */
+				list_move_tail(&bo->base.madv_list, &lru->list);
+			}
 		}
-	}
 
-	mutex_unlock(&pfdev->shrinker_lock);
+		empty = list_empty(&lru->list);
+		mutex_unlock(&pfdev->shrinker_lock);
 
-	if (freed > 0)
-		pr_info_ratelimited("Purging %lu bytes\n", freed << PAGE_SHIFT);
+		if (empty)
+			break;
+		cond_resched();
+	}
 
 	return freed;
 }
 
+static unsigned long
+panfrost_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct panfrost_device *pfdev =
+		container_of(shrinker, struct panfrost_device, shrinker);
+	unsigned long purged, evicted = 0;
+
+	purged = panfrost_gem_shrinker_scan_lru(pfdev, &pfdev->purgeable_lru,
+						sc->nr_to_scan,
+						panfrost_gem_purge);
+
+	if (purged < sc->nr_to_scan && panfrost_gem_shrinker_can_swap())
+		evicted = panfrost_gem_shrinker_scan_lru(pfdev,
+							 &pfdev->evictable_lru,
+							 sc->nr_to_scan - purged,
+							 panfrost_gem_evict);
+
+	atomic64_add(purged, &pfdev->shrinker_stats.purged);
+	atomic64_add(evicted, &pfdev->shrinker_stats.evicted);
+
+	if (purged > 0)
+		pr_info_ratelimited("Purging %lu bytes\n", purged << PAGE_SHIFT);
+
+	return purged + evicted;
+}
+
 /**
  * panfrost_gem_shrinker_init - Initialize panfrost shrinker
  * @dev: DRM device
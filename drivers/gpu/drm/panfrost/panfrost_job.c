@@ -20,6 +20,7 @@
 #include "panfrost_regs.h"
 #include "panfrost_gpu.h"
 #include "panfrost_mmu.h"
+#include "panfrost_perfcnt.h"
 
 #define JOB_TIMEOUT_MS 500
 
@@ -195,11 +196,11 @@ static void panfrost_job_hw_submit(struct panfrost_job *job, int js)
 
 	ret = pm_runtime_get_sync(pfdev->dev);
 	if (ret < 0)
-		return;
+		goto err_idle;
 
-	if (WARN_ON(job_read(pfdev, JS_COMMAND_NEXT(js)))) {
-		return;
-	}
+	/* The _NEXT registers still hold a job the hardware didn't pick up */
+	if (WARN_ON(job_read(pfdev, JS_COMMAND_NEXT(js))))
+		goto err_idle;
 
 	cfg = panfrost_mmu_as_get(pfdev, job->file_priv->mmu);
 
@@ -237,7 +238,19 @@ static void panfrost_job_hw_submit(struct panfrost_job *job, int js)
 			"JS: Submitting atom %p to js[%d][%d] with head=0x%llx AS %d",
 			job, js, subslot, jc_head, cfg & 0xf);
 	}
+	pfdev->js_stats[js].submitted++;
+	if (subslot)
+		pfdev->js_stats[js].queued_next++;
 	spin_unlock(&pfdev->js->job_lock);
+	return;
+
+err_idle:
+	/*
+	 * The job never reaches the hardware and will time out, keep the
+	 * PM and devfreq accounting balanced in the meantime.
+	 */
+	pm_runtime_put_noidle(pfdev->dev);
+	panfrost_devfreq_record_idle(&pfdev->pfdevfreq);
 }
 
 static int panfrost_acquire_object_fences(struct drm_gem_object **bos,
@@ -315,6 +328,9 @@ static void panfrost_job_cleanup(struct kref *ref)
 	dma_fence_put(job->render_done_fence);
 
 	if (job->mappings) {
+		panfrost_gem_shrinker_mark_used(job->pfdev, job->mappings,
+						job->bo_count);
+
 		for (i = 0; i < job->bo_count; i++) {
 			if (!job->mappings[i])
 				break;
@@ -391,6 +407,14 @@ void panfrost_job_enable_interrupts(struct panfrost_device *pfdev)
 	job_write(pfdev, JOB_INT_MASK, irq_mask);
 }
 
+static void panfrost_job_sample_perfcnt(struct panfrost_device *pfdev,
+					struct panfrost_job *job)
+{
+	struct panfrost_fence *f = to_panfrost_fence(job->done_fence);
+
+	panfrost_perfcnt_job_done(pfdev, job->pid, f->queue, f->seqno);
+}
+
 static void panfrost_job_handle_err(struct panfrost_device *pfdev,
 				    struct panfrost_job *job,
 				    unsigned int js)
@@ -434,8 +458,10 @@ static void panfrost_job_handle_err(struct panfrost_device *pfdev,
 	panfrost_mmu_as_put(pfdev, job->file_priv->mmu);
 	panfrost_devfreq_record_idle(&pfdev->pfdevfreq);
 
-	if (signal_fence)
+	if (signal_fence) {
+		panfrost_job_sample_perfcnt(pfdev, job);
 		dma_fence_signal_locked(job->done_fence);
+	}
 
 	pm_runtime_put_autosuspend(pfdev->dev);
 
@@ -455,6 +481,7 @@ static void panfrost_job_handle_done(struct panfrost_device *pfdev,
 	panfrost_mmu_as_put(pfdev, job->file_priv->mmu);
 	panfrost_devfreq_record_idle(&pfdev->pfdevfreq);
 
+	panfrost_job_sample_perfcnt(pfdev, job);
 	dma_fence_signal_locked(job->done_fence);
 	pm_runtime_put_autosuspend(pfdev->dev);
 }
@@ -808,11 +835,11 @@ int panfrost_job_init(struct panfrost_device *pfdev)
 		js->queue[j].fence_context = dma_fence_context_alloc(1);
 
 		ret = drm_sched_init(&js->queue[j].sched,
-				     &panfrost_sched_ops,
+				     &panfrost_sched_ops, NULL,
 				     nentries, 0,
 				     msecs_to_jiffies(JOB_TIMEOUT_MS),
 				     pfdev->reset.wq,
-				     NULL, "pan_js");
+				     NULL, "pan_js", DRM_SCHED_POLICY_DEFAULT);
 		if (ret) {
 			dev_err(pfdev->dev, "Failed to create scheduler: %d.", ret);
 			goto err_sched;
@@ -26,6 +26,9 @@ struct panfrost_job {
 	__u32 requirements;
 	__u32 flush_id;
 
+	/* Submitting thread group, reported with per-job perfcnt samples */
+	pid_t pid;
+
 	struct panfrost_gem_mapping **mappings;
 	struct drm_gem_object **bos;
 	u32 bo_count;
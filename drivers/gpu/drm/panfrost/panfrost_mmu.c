@@ -12,6 +12,7 @@
 #include <linux/iopoll.h>
 #include <linux/io-pgtable.h>
 #include <linux/iommu.h>
+#include <linux/ktime.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/shmem_fs.h>
@@ -183,7 +184,14 @@ u32 panfrost_mmu_as_get(struct panfrost_device *pfdev, struct panfrost_mmu *mmu)
 			mmu_write(pfdev, MMU_INT_MASK, ~pfdev->as_faulty_mask);
 			pfdev->as_faulty_mask &= ~mask;
 			panfrost_mmu_enable(pfdev, mmu);
+		} else if (mmu->flush_end > mmu->flush_start) {
+			/* Flush the PTs of the BOs mapped since the last use */
+			mmu_hw_do_operation_locked(pfdev, as, mmu->flush_start,
+						   mmu->flush_end - mmu->flush_start,
+						   AS_COMMAND_FLUSH_PT);
+			atomic64_inc(&pfdev->mmu_stats.flushes);
 		}
+		mmu->flush_start = mmu->flush_end = 0;
 
 		goto out;
 	}
@@ -214,6 +222,8 @@ u32 panfrost_mmu_as_get(struct panfrost_device *pfdev, struct panfrost_mmu *mmu)
 
 	dev_dbg(pfdev->dev, "Assigned AS%d to mmu %p, alloc_mask=%lx", as, mmu, pfdev->as_alloc_mask);
 
+	/* Enabling the AS flushes everything, drop any deferred flush */
+	mmu->flush_start = mmu->flush_end = 0;
 	panfrost_mmu_enable(pfdev, mmu);
 
 out:
@@ -248,11 +258,24 @@ void panfrost_mmu_reset(struct panfrost_device *pfdev)
 	mmu_write(pfdev, MMU_INT_MASK, ~0);
 }
 
-static size_t get_pgsize(u64 addr, size_t size)
+static size_t get_pgsize(u64 addr, size_t size, size_t *count)
 {
-	if (addr & (SZ_2M - 1) || size < SZ_2M)
-		return SZ_4K;
+	/*
+	 * io-pgtable only operates on multiple pages within a single table
+	 * entry, so we need to split at boundaries of the table size, i.e.
+	 * the next block size up. The distance from address A to the next
+	 * boundary of block size B is logically B - A % B, but in unsigned
+	 * two's complement where B is a power of two we get the equivalence
+	 * B - A % B == (B - A) % B == (n * B - A) % B, and choose n = 0 :)
+	 */
+	size_t blk_offset = -addr % SZ_2M;
 
+	if (blk_offset || size < SZ_2M) {
+		*count = min_not_zero(blk_offset, size) / SZ_4K;
+		return SZ_4K;
+	}
+	blk_offset = -addr % SZ_1G ?: SZ_1G;
+	*count = min(blk_offset, size) / SZ_2M;
 	return SZ_2M;
 }
 
@@ -270,6 +293,31 @@ static void panfrost_mmu_flush_range(struct panfrost_device *pfdev,
 		mmu_hw_do_operation(pfdev, mmu, iova, size, AS_COMMAND_FLUSH_PT);
 
 	pm_runtime_put_sync_autosuspend(pfdev->dev);
+	atomic64_inc(&pfdev->mmu_stats.flushes);
+}
+
+/*
+ * New mappings can't be in use by any job yet, so instead of flushing the
+ * PTs for each BO, remember the range and flush it the next time the AS is
+ * handed to a job (see panfrost_mmu_as_get()). This merges the flushes of
+ * all BOs mapped ahead of a submit into a single one.
+ */
+static void panfrost_mmu_defer_flush(struct panfrost_device *pfdev,
+				     struct panfrost_mmu *mmu,
+				     u64 iova, u64 size)
+{
+	spin_lock(&pfdev->as_lock);
+	if (mmu->as >= 0) {
+		if (mmu->flush_end > mmu->flush_start) {
+			mmu->flush_start = min(mmu->flush_start, iova);
+			mmu->flush_end = max(mmu->flush_end, iova + size);
+		} else {
+			mmu->flush_start = iova;
+			mmu->flush_end = iova + size;
+		}
+		atomic64_inc(&pfdev->mmu_stats.deferred_flushes);
+	}
+	spin_unlock(&pfdev->as_lock);
 }
 
 static int mmu_map_sg(struct panfrost_device *pfdev, struct panfrost_mmu *mmu,
@@ -278,6 +326,7 @@ static int mmu_map_sg(struct panfrost_device *pfdev, struct panfrost_mmu *mmu,
 	unsigned int count;
 	struct scatterlist *sgl;
 	struct io_pgtable_ops *ops = mmu->pgtbl_ops;
+	ktime_t start = ktime_get();
 	u64 start_iova = iova;
 
 	for_each_sgtable_dma_sg(sgt, sgl, count) {
@@ -287,16 +336,23 @@ static int mmu_map_sg(struct panfrost_device *pfdev, struct panfrost_mmu *mmu,
 		dev_dbg(pfdev->dev, "map: as=%d, iova=%llx, paddr=%lx, len=%zx", mmu->as, iova, paddr, len);
 
 		while (len) {
-			size_t pgsize = get_pgsize(iova | paddr, len);
-
-			ops->map(ops, iova, paddr, pgsize, prot, GFP_KERNEL);
-			iova += pgsize;
-			paddr += pgsize;
-			len -= pgsize;
+			size_t pgcount, mapped = 0;
+			size_t pgsize = get_pgsize(iova | paddr, len, &pgcount);
+
+			ops->map_pages(ops, iova, paddr, pgsize, pgcount, prot,
+				       GFP_KERNEL, &mapped);
+			/* Don't get stuck if things have gone wrong */
+			mapped = max(mapped, pgsize);
+			iova += mapped;
+			paddr += mapped;
+			len -= mapped;
 		}
 	}
 
-	panfrost_mmu_flush_range(pfdev, mmu, start_iova, iova - start_iova);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &pfdev->mmu_stats.map_ns);
+	atomic64_add(iova - start_iova, &pfdev->mmu_stats.mapped_bytes);
+	atomic64_inc(&pfdev->mmu_stats.maps);
 
 	return 0;
 }
@@ -322,6 +378,9 @@ int panfrost_mmu_map(struct panfrost_gem_mapping *mapping)
 
 	mmu_map_sg(pfdev, mapping->mmu, mapping->mmnode.start << PAGE_SHIFT,
 		   prot, sgt);
+	panfrost_mmu_defer_flush(pfdev, mapping->mmu,
+				 mapping->mmnode.start << PAGE_SHIFT,
+				 obj->size);
 	mapping->active = true;
 
 	return 0;
@@ -336,6 +395,7 @@ void panfrost_mmu_unmap(struct panfrost_gem_mapping *mapping)
 	u64 iova = mapping->mmnode.start << PAGE_SHIFT;
 	size_t len = mapping->mmnode.size << PAGE_SHIFT;
 	size_t unmapped_len = 0;
+	ktime_t start;
 
 	if (WARN_ON(!mapping->active))
 		return;
@@ -343,17 +403,24 @@ void panfrost_mmu_unmap(struct panfrost_gem_mapping *mapping)
 	dev_dbg(pfdev->dev, "unmap: as=%d, iova=%llx, len=%zx",
 		mapping->mmu->as, iova, len);
 
+	start = ktime_get();
 	while (unmapped_len < len) {
-		size_t unmapped_page;
-		size_t pgsize = get_pgsize(iova, len - unmapped_len);
-
-		if (ops->iova_to_phys(ops, iova)) {
-			unmapped_page = ops->unmap(ops, iova, pgsize, NULL);
-			WARN_ON(unmapped_page != pgsize);
+		size_t unmapped_page, pgcount;
+		size_t pgsize = get_pgsize(iova, len - unmapped_len, &pgcount);
+
+		/* Heap BOs are only partially backed, unmap page by page */
+		if (bo->is_heap)
+			pgcount = 1;
+		if (!bo->is_heap || ops->iova_to_phys(ops, iova)) {
+			unmapped_page = ops->unmap_pages(ops, iova, pgsize, pgcount, NULL);
+			WARN_ON(unmapped_page != pgsize * pgcount);
 		}
-		iova += pgsize;
-		unmapped_len += pgsize;
+		iova += pgsize * pgcount;
+		unmapped_len += pgsize * pgcount;
 	}
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &pfdev->mmu_stats.unmap_ns);
+	atomic64_inc(&pfdev->mmu_stats.unmaps);
 
 	panfrost_mmu_flush_range(pfdev, mapping->mmu,
 				 mapping->mmnode.start << PAGE_SHIFT, len);
@@ -416,6 +483,87 @@ addr_to_mapping(struct panfrost_device *pfdev, int as, u64 addr)
 }
 
 #define NUM_FAULT_PAGES (SZ_2M / PAGE_SIZE)
+#define HEAP_FAULT_MAX_CHUNKS 8
+#define HEAP_FAULT_BURST_MS 20
+
+/*
+ * Heap BOs grow on GPU faults. Faults following each other quickly mean
+ * the tiler is eating through the heap, so double the number of 2MB
+ * chunks mapped per fault each time, up to HEAP_FAULT_MAX_CHUNKS, and go
+ * back to a single chunk once the faults calm down.
+ */
+static unsigned int heap_fault_chunks(struct panfrost_gem_object *bo)
+{
+	ktime_t now = ktime_get();
+
+	if (bo->heap_fault_chunks &&
+	    ktime_ms_delta(now, bo->heap_last_fault) < HEAP_FAULT_BURST_MS)
+		bo->heap_fault_chunks = min(2 * bo->heap_fault_chunks,
+					    HEAP_FAULT_MAX_CHUNKS);
+	else
+		bo->heap_fault_chunks = 1;
+	bo->heap_last_fault = now;
+
+	return bo->heap_fault_chunks;
+}
+
+static int panfrost_heap_map_chunk(struct panfrost_device *pfdev,
+				   struct panfrost_gem_mapping *bomapping,
+				   pgoff_t page_offset)
+{
+	struct panfrost_gem_object *bo = bomapping->obj;
+	struct address_space *mapping = bo->base.base.filp->f_mapping;
+	struct page **pages = bo->base.pages;
+	struct sg_table *sgt;
+	int ret, i;
+
+	mutex_lock(&bo->base.pages_lock);
+
+	if (pages[page_offset]) {
+		/* Pages are already mapped, nothing to do. */
+		mutex_unlock(&bo->base.pages_lock);
+		return 0;
+	}
+
+	for (i = page_offset; i < page_offset + NUM_FAULT_PAGES; i++) {
+		pages[i] = shmem_read_mapping_page(mapping, i);
+		if (IS_ERR(pages[i])) {
+			ret = PTR_ERR(pages[i]);
+			pages[i] = NULL;
+			mutex_unlock(&bo->base.pages_lock);
+			goto err_pages;
+		}
+	}
+
+	mutex_unlock(&bo->base.pages_lock);
+
+	sgt = &bo->sgts[page_offset / NUM_FAULT_PAGES];
+	ret = sg_alloc_table_from_pages(sgt, pages + page_offset,
+					NUM_FAULT_PAGES, 0, SZ_2M, GFP_KERNEL);
+	if (ret)
+		goto err_pages;
+
+	ret = dma_map_sgtable(pfdev->dev, sgt, DMA_BIDIRECTIONAL, 0);
+	if (ret)
+		goto err_map;
+
+	mmu_map_sg(pfdev, bomapping->mmu,
+		   (bomapping->mmnode.start + page_offset) << PAGE_SHIFT,
+		   IOMMU_WRITE | IOMMU_READ | IOMMU_NOEXEC, sgt);
+
+	return 0;
+
+err_map:
+	sg_free_table(sgt);
+err_pages:
+	mutex_lock(&bo->base.pages_lock);
+	for (i = page_offset; i < page_offset + NUM_FAULT_PAGES && pages[i]; i++) {
+		put_page(pages[i]);
+		pages[i] = NULL;
+	}
+	mutex_unlock(&bo->base.pages_lock);
+	return ret;
+}
 
 static int panfrost_mmu_map_fault_addr(struct panfrost_device *pfdev, int as,
 				       u64 addr)
@@ -423,9 +571,8 @@ static int panfrost_mmu_map_fault_addr(struct panfrost_device *pfdev, int as,
 	int ret, i;
 	struct panfrost_gem_mapping *bomapping;
 	struct panfrost_gem_object *bo;
-	struct address_space *mapping;
+	unsigned int nr_chunks;
 	pgoff_t page_offset;
-	struct sg_table *sgt;
 	struct page **pages;
 
 	bomapping = addr_to_mapping(pfdev, as, addr);
@@ -477,46 +624,43 @@ static int panfrost_mmu_map_fault_addr(struct panfrost_device *pfdev, int as,
 		}
 	}
 
-	mapping = bo->base.base.filp->f_mapping;
-	mapping_set_unevictable(mapping);
-
-	for (i = page_offset; i < page_offset + NUM_FAULT_PAGES; i++) {
-		pages[i] = shmem_read_mapping_page(mapping, i);
-		if (IS_ERR(pages[i])) {
-			mutex_unlock(&bo->base.pages_lock);
-			ret = PTR_ERR(pages[i]);
-			goto err_pages;
-		}
-	}
+	nr_chunks = min_t(unsigned int, heap_fault_chunks(bo),
+			  ((bo->base.base.size >> PAGE_SHIFT) - page_offset) /
+			  NUM_FAULT_PAGES);
 
 	mutex_unlock(&bo->base.pages_lock);
 
-	sgt = &bo->sgts[page_offset / (SZ_2M / PAGE_SIZE)];
-	ret = sg_alloc_table_from_pages(sgt, pages + page_offset,
-					NUM_FAULT_PAGES, 0, SZ_2M, GFP_KERNEL);
-	if (ret)
-		goto err_pages;
+	mapping_set_unevictable(bo->base.base.filp->f_mapping);
 
-	ret = dma_map_sgtable(pfdev->dev, sgt, DMA_BIDIRECTIONAL, 0);
-	if (ret)
-		goto err_map;
+	for (i = 0; i < nr_chunks; i++) {
+		ret = panfrost_heap_map_chunk(pfdev, bomapping,
+					      page_offset + i * NUM_FAULT_PAGES);
+		if (ret)
+			break;
+	}
 
-	mmu_map_sg(pfdev, bomapping->mmu, addr,
-		   IOMMU_WRITE | IOMMU_READ | IOMMU_NOEXEC, sgt);
+	/* Only the faulting chunk is required, the others are best effort */
+	if (!i)
+		goto err_bo;
+
+	/* The faulting job is waiting for this, flush right away */
+	panfrost_mmu_flush_range(pfdev, bomapping->mmu, addr, i * SZ_2M);
 
 	bomapping->active = true;
 
-	dev_dbg(pfdev->dev, "mapped page fault @ AS%d %llx", as, addr);
+	dev_dbg(pfdev->dev, "mapped page fault @ AS%d %llx, %d chunks",
+		as, addr, i);
+
+	/* Populate the shmem pages of the next growth step in the background */
+	panfrost_gem_heap_prefetch(bo, page_offset + i * NUM_FAULT_PAGES,
+				   min(2 * nr_chunks, HEAP_FAULT_MAX_CHUNKS) *
+				   NUM_FAULT_PAGES);
 
 out:
 	panfrost_gem_mapping_put(bomapping);
 
 	return 0;
 
-err_map:
-	sg_free_table(sgt);
-err_pages:
-	drm_gem_shmem_put_pages(&bo->base);
 err_bo:
 	drm_gem_object_put(&bo->base.base);
 	return ret;
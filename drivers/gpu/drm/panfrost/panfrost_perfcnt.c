@@ -7,9 +7,13 @@
 #include <linux/completion.h>
 #include <linux/dma-buf-map.h>
 #include <linux/iopoll.h>
+#include <linux/kfifo.h>
+#include <linux/ktime.h>
 #include <linux/pm_runtime.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/workqueue.h>
 
 #include "panfrost_device.h"
 #include "panfrost_features.h"
@@ -25,13 +29,41 @@
 #define BLOCKS_PER_COREGROUP		8
 #define V4_SHADERS_PER_COREGROUP	4
 
+#define RING_MAX_SAMPLES		4096
+#define RING_MAX_EVENTS			64
+
+/* A job completion waiting to be sampled */
+struct panfrost_perfcnt_event {
+	u64 timestamp;
+	u64 seqno;
+	u32 pid;
+	u32 js;
+};
+
 struct panfrost_perfcnt {
+	struct panfrost_device *pfdev;
 	struct panfrost_gem_mapping *mapping;
 	size_t bosize;
 	void *buf;
 	struct panfrost_file_priv *user;
 	struct mutex lock;
 	struct completion dump_comp;
+
+	/* Per-job sampling, see struct drm_panfrost_perfcnt_ring */
+	struct {
+		struct panfrost_gem_mapping *mapping;
+		void *vaddr;
+		struct drm_panfrost_perfcnt_ring_header *header;
+		u32 num_samples;
+		u32 sample_size;
+		u32 head;
+		bool active;
+		atomic_t dropped;
+		struct work_struct work;
+		spinlock_t events_lock;
+		DECLARE_KFIFO(events, struct panfrost_perfcnt_event,
+			      RING_MAX_EVENTS);
+	} ring;
 };
 
 void panfrost_perfcnt_clean_cache_done(struct panfrost_device *pfdev)
@@ -44,13 +76,12 @@ void panfrost_perfcnt_sample_done(struct panfrost_device *pfdev)
 	gpu_write(pfdev, GPU_CMD, GPU_CMD_CLEAN_CACHES);
 }
 
-static int panfrost_perfcnt_dump_locked(struct panfrost_device *pfdev)
+static int panfrost_perfcnt_dump_locked(struct panfrost_device *pfdev,
+					u64 gpuva)
 {
-	u64 gpuva;
 	int ret;
 
 	reinit_completion(&pfdev->perfcnt->dump_comp);
-	gpuva = pfdev->perfcnt->mapping->mmnode.start << PAGE_SHIFT;
 	gpu_write(pfdev, GPU_PERFCNT_BASE_LO, lower_32_bits(gpuva));
 	gpu_write(pfdev, GPU_PERFCNT_BASE_HI, upper_32_bits(gpuva));
 	gpu_write(pfdev, GPU_INT_CLEAR,
@@ -176,6 +207,189 @@ static int panfrost_perfcnt_enable_locked(struct panfrost_device *pfdev,
 	return ret;
 }
 
+static void panfrost_perfcnt_ring_sample_locked(struct panfrost_device *pfdev,
+						const struct panfrost_perfcnt_event *ev)
+{
+	struct panfrost_perfcnt *perfcnt = pfdev->perfcnt;
+	struct drm_panfrost_perfcnt_ring_header *header = perfcnt->ring.header;
+	struct drm_panfrost_perfcnt_sample *sample;
+	u32 tail = READ_ONCE(header->tail);
+	u64 offset;
+
+	/* Don't overwrite samples userspace didn't consume yet */
+	if (perfcnt->ring.head - tail >= perfcnt->ring.num_samples) {
+		header->dropped++;
+		return;
+	}
+
+	offset = SZ_4K + (u64)(perfcnt->ring.head % perfcnt->ring.num_samples) *
+		 perfcnt->ring.sample_size;
+	if (panfrost_perfcnt_dump_locked(pfdev,
+					 (perfcnt->ring.mapping->mmnode.start << PAGE_SHIFT) +
+					 offset)) {
+		header->dropped++;
+		return;
+	}
+
+	/* Each sample covers the activity since the previous one */
+	gpu_write(pfdev, GPU_CMD, GPU_CMD_PERFCNT_CLEAR);
+
+	sample = perfcnt->ring.vaddr + offset + perfcnt->bosize;
+	sample->timestamp = ev->timestamp;
+	sample->seqno = ev->seqno;
+	sample->pid = ev->pid;
+	sample->js = ev->js;
+
+	/* Publish the sample only once it has been written */
+	wmb();
+	WRITE_ONCE(header->head, ++perfcnt->ring.head);
+}
+
+static void panfrost_perfcnt_ring_work(struct work_struct *work)
+{
+	struct panfrost_perfcnt *perfcnt =
+		container_of(work, struct panfrost_perfcnt, ring.work);
+	struct panfrost_device *pfdev = perfcnt->pfdev;
+	struct panfrost_perfcnt_event ev;
+
+	mutex_lock(&perfcnt->lock);
+	while (perfcnt->ring.active &&
+	       kfifo_out_spinlocked(&perfcnt->ring.events, &ev, 1,
+				    &perfcnt->ring.events_lock))
+		panfrost_perfcnt_ring_sample_locked(pfdev, &ev);
+
+	if (perfcnt->ring.active)
+		perfcnt->ring.header->dropped +=
+			atomic_xchg(&perfcnt->ring.dropped, 0);
+	mutex_unlock(&perfcnt->lock);
+}
+
+/**
+ * panfrost_perfcnt_job_done - sample the counters for a completed job
+ * @pfdev: Panfrost device
+ * @pid: Thread group the job was submitted from
+ * @js: Job slot the job ran on
+ * @seqno: Seqno of the job on @js
+ *
+ * Called from the job interrupt handler. The sample itself has to wait for
+ * the GPU, so it is taken from a worker.
+ */
+void panfrost_perfcnt_job_done(struct panfrost_device *pfdev, u32 pid,
+			       u32 js, u64 seqno)
+{
+	struct panfrost_perfcnt *perfcnt = pfdev->perfcnt;
+	struct panfrost_perfcnt_event ev = {
+		.timestamp = ktime_get_ns(),
+		.seqno = seqno,
+		.pid = pid,
+		.js = js,
+	};
+
+	if (!READ_ONCE(perfcnt->ring.active))
+		return;
+
+	if (!kfifo_in_spinlocked(&perfcnt->ring.events, &ev, 1,
+				 &perfcnt->ring.events_lock))
+		atomic_inc(&perfcnt->ring.dropped);
+
+	queue_work(system_highpri_wq, &perfcnt->ring.work);
+}
+
+static int panfrost_perfcnt_ring_enable_locked(struct panfrost_device *pfdev,
+					       struct drm_file *file_priv,
+					       struct drm_panfrost_perfcnt_ring *req)
+{
+	struct panfrost_file_priv *user = file_priv->driver_priv;
+	struct panfrost_perfcnt *perfcnt = pfdev->perfcnt;
+	struct drm_gem_shmem_object *bo;
+	struct dma_buf_map map;
+	u32 sample_size;
+	int ret;
+
+	if (user != perfcnt->user)
+		return -EINVAL;
+	if (perfcnt->ring.active)
+		return -EBUSY;
+	if (!req->num_samples || req->num_samples > RING_MAX_SAMPLES)
+		return -EINVAL;
+
+	sample_size = PAGE_ALIGN(perfcnt->bosize +
+				 sizeof(struct drm_panfrost_perfcnt_sample));
+
+	bo = drm_gem_shmem_create(pfdev->ddev,
+				  SZ_4K + (size_t)req->num_samples * sample_size);
+	if (IS_ERR(bo))
+		return PTR_ERR(bo);
+
+	/* Also maps the ring in the address space attached to file_priv. */
+	ret = drm_gem_handle_create(file_priv, &bo->base, &req->handle);
+	if (ret)
+		goto err_put_bo;
+
+	perfcnt->ring.mapping = panfrost_gem_mapping_get(to_panfrost_bo(&bo->base),
+							 user);
+	if (!perfcnt->ring.mapping) {
+		ret = -EINVAL;
+		goto err_delete_handle;
+	}
+
+	ret = drm_gem_shmem_vmap(bo, &map);
+	if (ret)
+		goto err_put_mapping;
+
+	perfcnt->ring.vaddr = map.vaddr;
+	perfcnt->ring.header = map.vaddr;
+	perfcnt->ring.header->num_samples = req->num_samples;
+	perfcnt->ring.header->sample_size = sample_size;
+	perfcnt->ring.num_samples = req->num_samples;
+	perfcnt->ring.sample_size = sample_size;
+	perfcnt->ring.head = 0;
+	atomic_set(&perfcnt->ring.dropped, 0);
+	kfifo_reset(&perfcnt->ring.events);
+
+	/* Start the first sample from zero */
+	gpu_write(pfdev, GPU_CMD, GPU_CMD_PERFCNT_CLEAR);
+	WRITE_ONCE(perfcnt->ring.active, true);
+
+	req->sample_size = sample_size;
+	req->dump_size = perfcnt->bosize;
+
+	/* The BO ref is retained by the mapping and the handle. */
+	drm_gem_object_put(&bo->base);
+
+	return 0;
+
+err_put_mapping:
+	panfrost_gem_mapping_put(perfcnt->ring.mapping);
+	perfcnt->ring.mapping = NULL;
+err_delete_handle:
+	drm_gem_handle_delete(file_priv, req->handle);
+err_put_bo:
+	drm_gem_object_put(&bo->base);
+	return ret;
+}
+
+static void panfrost_perfcnt_ring_disable_locked(struct panfrost_device *pfdev)
+{
+	struct panfrost_perfcnt *perfcnt = pfdev->perfcnt;
+	struct dma_buf_map map = DMA_BUF_MAP_INIT_VADDR(perfcnt->ring.vaddr);
+
+	if (!perfcnt->ring.active)
+		return;
+
+	/*
+	 * The worker bails out once active is cleared, it can't be flushed
+	 * here since it takes perfcnt->lock.
+	 */
+	WRITE_ONCE(perfcnt->ring.active, false);
+
+	drm_gem_shmem_vunmap(&perfcnt->ring.mapping->obj->base, &map);
+	perfcnt->ring.vaddr = NULL;
+	perfcnt->ring.header = NULL;
+	panfrost_gem_mapping_put(perfcnt->ring.mapping);
+	perfcnt->ring.mapping = NULL;
+}
+
 static int panfrost_perfcnt_disable_locked(struct panfrost_device *pfdev,
 					   struct drm_file *file_priv)
 {
@@ -186,6 +400,8 @@ static int panfrost_perfcnt_disable_locked(struct panfrost_device *pfdev,
 	if (user != perfcnt->user)
 		return -EINVAL;
 
+	panfrost_perfcnt_ring_disable_locked(pfdev);
+
 	gpu_write(pfdev, GPU_PRFCNT_JM_EN, 0x0);
 	gpu_write(pfdev, GPU_PRFCNT_SHADER_EN, 0x0);
 	gpu_write(pfdev, GPU_PRFCNT_MMU_L2_EN, 0x0);
@@ -252,7 +468,8 @@ int panfrost_ioctl_perfcnt_dump(struct drm_device *dev, void *data,
 		goto out;
 	}
 
-	ret = panfrost_perfcnt_dump_locked(pfdev);
+	ret = panfrost_perfcnt_dump_locked(pfdev,
+					   perfcnt->mapping->mmnode.start << PAGE_SHIFT);
 	if (ret)
 		goto out;
 
@@ -265,6 +482,34 @@ int panfrost_ioctl_perfcnt_dump(struct drm_device *dev, void *data,
 	return ret;
 }
 
+int panfrost_ioctl_perfcnt_ring(struct drm_device *dev, void *data,
+				struct drm_file *file_priv)
+{
+	struct panfrost_device *pfdev = dev->dev_private;
+	struct panfrost_perfcnt *perfcnt = pfdev->perfcnt;
+	struct drm_panfrost_perfcnt_ring *req = data;
+	int ret;
+
+	ret = panfrost_unstable_ioctl_check();
+	if (ret)
+		return ret;
+
+	if (req->pad)
+		return -EINVAL;
+
+	mutex_lock(&perfcnt->lock);
+	if (req->enable) {
+		ret = panfrost_perfcnt_ring_enable_locked(pfdev, file_priv, req);
+	} else if (perfcnt->user == file_priv->driver_priv) {
+		panfrost_perfcnt_ring_disable_locked(pfdev);
+	} else {
+		ret = -EINVAL;
+	}
+	mutex_unlock(&perfcnt->lock);
+
+	return ret;
+}
+
 void panfrost_perfcnt_close(struct drm_file *file_priv)
 {
 	struct panfrost_file_priv *pfile = file_priv->driver_priv;
@@ -319,6 +564,7 @@ int panfrost_perfcnt_init(struct panfrost_device *pfdev)
 	if (!perfcnt)
 		return -ENOMEM;
 
+	perfcnt->pfdev = pfdev;
 	perfcnt->bosize = size;
 
 	/* Start with everything disabled. */
@@ -331,6 +577,9 @@ int panfrost_perfcnt_init(struct panfrost_device *pfdev)
 
 	init_completion(&perfcnt->dump_comp);
 	mutex_init(&perfcnt->lock);
+	INIT_WORK(&perfcnt->ring.work, panfrost_perfcnt_ring_work);
+	spin_lock_init(&perfcnt->ring.events_lock);
+	INIT_KFIFO(perfcnt->ring.events);
 	pfdev->perfcnt = perfcnt;
 
 	return 0;
@@ -338,6 +587,8 @@ int panfrost_perfcnt_init(struct panfrost_device *pfdev)
 
 void panfrost_perfcnt_fini(struct panfrost_device *pfdev)
 {
+	cancel_work_sync(&pfdev->perfcnt->ring.work);
+
 	/* Disable everything before leaving. */
 	gpu_write(pfdev, GPU_PERFCNT_CFG,
 		  GPU_PERFCNT_CFG_MODE(GPU_PERFCNT_CFG_MODE_OFF));
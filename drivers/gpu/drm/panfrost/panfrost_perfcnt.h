@@ -14,5 +14,9 @@ int panfrost_ioctl_perfcnt_enable(struct drm_device *dev, void *data,
 				  struct drm_file *file_priv);
 int panfrost_ioctl_perfcnt_dump(struct drm_device *dev, void *data,
 				struct drm_file *file_priv);
+int panfrost_ioctl_perfcnt_ring(struct drm_device *dev, void *data,
+				struct drm_file *file_priv);
+void panfrost_perfcnt_job_done(struct panfrost_device *pfdev, u32 pid,
+			       u32 js, u64 seqno);
 
 #endif
@@ -46,6 +46,7 @@ struct qxl_ring {
 	int			prod_notify;
 	wait_queue_head_t      *push_event;
 	spinlock_t             lock;
+	atomic_t		full_waits;
 };
 
 void qxl_ring_free(struct qxl_ring *ring)
@@ -77,6 +78,7 @@ qxl_ring_create(struct qxl_ring_header *header,
 	ring->n_elements = n_elements;
 	ring->prod_notify = prod_notify;
 	ring->push_event = push_event;
+	atomic_set(&ring->full_waits, 0);
 	if (set_prod_notify)
 		qxl_ring_init_hdr(ring);
 	spin_lock_init(&ring->lock);
@@ -109,6 +111,15 @@ int qxl_check_idle(struct qxl_ring *ring)
 	return ret;
 }
 
+/**
+ * qxl_ring_full_waits - number of pushes that found the ring full
+ * @ring: ring to query
+ */
+int qxl_ring_full_waits(struct qxl_ring *ring)
+{
+	return atomic_read(&ring->full_waits);
+}
+
 int qxl_ring_push(struct qxl_ring *ring,
 		  const void *new_elt, bool interruptible)
 {
@@ -122,6 +133,7 @@ int qxl_ring_push(struct qxl_ring *ring,
 		header->notify_on_cons = header->cons + 1;
 		mb();
 		spin_unlock_irqrestore(&ring->lock, flags);
+		atomic_inc(&ring->full_waits);
 		if (!drm_can_sleep()) {
 			while (!qxl_check_header(ring))
 				udelay(1);
@@ -156,30 +168,35 @@ int qxl_ring_push(struct qxl_ring *ring,
 	return 0;
 }
 
-static bool qxl_ring_pop(struct qxl_ring *ring,
-			 void *element)
+/*
+ * Pop up to @max elements with a single lock round trip. Only when the
+ * ring is found empty the device is asked to notify us on the next
+ * produced element.
+ */
+static int qxl_ring_pop_batch(struct qxl_ring *ring,
+			      void *elements, int max)
 {
 	volatile struct qxl_ring_header *header = &(ring->ring->header);
 	volatile uint8_t *ring_elt;
-	int idx;
+	uint8_t *elt = elements;
 	unsigned long flags;
+	int idx, n = 0;
 
 	spin_lock_irqsave(&ring->lock, flags);
-	if (header->cons == header->prod) {
-		header->notify_on_prod = header->cons + 1;
-		spin_unlock_irqrestore(&ring->lock, flags);
-		return false;
-	}
-
-	idx = header->cons & (ring->n_elements - 1);
-	ring_elt = ring->ring->elements + idx * ring->element_size;
+	while (n < max && header->cons != header->prod) {
+		idx = header->cons & (ring->n_elements - 1);
+		ring_elt = ring->ring->elements + idx * ring->element_size;
 
-	memcpy(element, (void *)ring_elt, ring->element_size);
-
-	header->cons++;
+		memcpy(elt, (void *)ring_elt, ring->element_size);
+		elt += ring->element_size;
 
+		header->cons++;
+		n++;
+	}
+	if (header->cons == header->prod)
+		header->notify_on_prod = header->cons + 1;
 	spin_unlock_irqrestore(&ring->lock, flags);
-	return true;
+	return n;
 }
 
 int
@@ -217,44 +234,56 @@ bool qxl_queue_garbage_collect(struct qxl_device *qdev, bool flush)
 	return false;
 }
 
+/* release ids popped per release ring lock round trip */
+#define QXL_GC_BATCH 32
+
 int qxl_garbage_collect(struct qxl_device *qdev)
 {
 	struct qxl_release *release;
+	uint64_t ids[QXL_GC_BATCH];
 	uint64_t id, next_id;
-	int i = 0;
+	int i = 0, j, n;
 	union qxl_release_info *info;
 
-	while (qxl_ring_pop(qdev->release_ring, &id)) {
-		DRM_DEBUG_DRIVER("popped %lld\n", id);
-		while (id) {
-			release = qxl_release_from_id_locked(qdev, id);
-			if (release == NULL)
-				break;
-
-			info = qxl_release_map(qdev, release);
-			next_id = info->next;
-			qxl_release_unmap(qdev, release, info);
-
-			DRM_DEBUG_DRIVER("popped %lld, next %lld\n", id,
-					 next_id);
-
-			switch (release->type) {
-			case QXL_RELEASE_DRAWABLE:
-			case QXL_RELEASE_SURFACE_CMD:
-			case QXL_RELEASE_CURSOR_CMD:
-				break;
-			default:
-				DRM_ERROR("unexpected release type\n");
-				break;
+	while ((n = qxl_ring_pop_batch(qdev->release_ring, ids,
+				       QXL_GC_BATCH)) > 0) {
+		for (j = 0; j < n; j++) {
+			id = ids[j];
+			DRM_DEBUG_DRIVER("popped %lld\n", id);
+			while (id) {
+				release = qxl_release_from_id_locked(qdev, id);
+				if (release == NULL)
+					break;
+
+				info = qxl_release_map(qdev, release);
+				next_id = info->next;
+				qxl_release_unmap(qdev, release, info);
+
+				DRM_DEBUG_DRIVER("popped %lld, next %lld\n", id,
+						 next_id);
+
+				switch (release->type) {
+				case QXL_RELEASE_DRAWABLE:
+				case QXL_RELEASE_SURFACE_CMD:
+				case QXL_RELEASE_CURSOR_CMD:
+					break;
+				default:
+					DRM_ERROR("unexpected release type\n");
+					break;
+				}
+				id = next_id;
+
+				qxl_release_free(qdev, release);
+				++i;
 			}
-			id = next_id;
-
-			qxl_release_free(qdev, release);
-			++i;
 		}
+		/* let waiters in as soon as the first batch is back */
+		wake_up_all(&qdev->release_event);
 	}
 
 	wake_up_all(&qdev->release_event);
+	atomic_inc(&qdev->gc_runs);
+	atomic_add(i, &qdev->gc_released);
 	DRM_DEBUG_DRIVER("%d\n", i);
 
 	return i;
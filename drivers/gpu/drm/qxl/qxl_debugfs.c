@@ -75,9 +75,29 @@ qxl_debugfs_buffers_info(struct seq_file *m, void *data)
 	return 0;
 }
 
+static int
+qxl_debugfs_ring_stats(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = (struct drm_info_node *) m->private;
+	struct qxl_device *qdev = to_qxl(node->minor->dev);
+
+	seq_printf(m, "command ring full waits %d\n",
+		   qxl_ring_full_waits(qdev->command_ring));
+	seq_printf(m, "cursor ring full waits %d\n",
+		   qxl_ring_full_waits(qdev->cursor_ring));
+	seq_printf(m, "gc runs %d\n", atomic_read(&qdev->gc_runs));
+	seq_printf(m, "gc releases freed %d\n", atomic_read(&qdev->gc_released));
+	seq_printf(m, "releases outstanding %d\n", atomic_read(&qdev->release_count));
+	seq_printf(m, "release bo allocs %d\n", atomic_read(&qdev->release_bo_allocs));
+	seq_printf(m, "release bo spare hits %d\n",
+		   atomic_read(&qdev->release_bo_spare_hits));
+	return 0;
+}
+
 static struct drm_info_list qxl_debugfs_list[] = {
 	{ "irq_received", qxl_debugfs_irq_received, 0, NULL },
 	{ "qxl_buffers", qxl_debugfs_buffers_info, 0, NULL },
+	{ "qxl_ring_stats", qxl_debugfs_ring_stats, 0, NULL },
 };
 #define QXL_DEBUGFS_ENTRIES ARRAY_SIZE(qxl_debugfs_list)
 #endif
@@ -249,8 +249,14 @@ struct qxl_device {
 	struct mutex release_mutex;
 	struct qxl_bo *current_release_bo[3];
 	int current_release_bo_offset[3];
+	struct qxl_bo *spare_release_bo[3];
+	atomic_t release_bo_allocs;
+	atomic_t release_bo_spare_hits;
+	struct work_struct release_bo_work;
 
 	struct work_struct gc_work;
+	atomic_t gc_runs;
+	atomic_t gc_released;
 
 	struct drm_property *hotplug_mode_update_property;
 	int monitors_config_width;
@@ -286,6 +292,7 @@ struct qxl_ring *qxl_ring_create(struct qxl_ring_header *header,
 void qxl_ring_free(struct qxl_ring *ring);
 void qxl_ring_init_hdr(struct qxl_ring *ring);
 int qxl_check_idle(struct qxl_ring *ring);
+int qxl_ring_full_waits(struct qxl_ring *ring);
 
 static inline uint64_t
 qxl_bo_physical_address(struct qxl_device *qdev, struct qxl_bo *bo,
@@ -418,6 +425,7 @@ struct qxl_release *qxl_release_from_id_locked(struct qxl_device *qdev,
 
 bool qxl_queue_garbage_collect(struct qxl_device *qdev, bool flush);
 int qxl_garbage_collect(struct qxl_device *qdev);
+void qxl_release_prealloc(struct qxl_device *qdev);
 
 /* debugfs */
 
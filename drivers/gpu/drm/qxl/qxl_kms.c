@@ -106,6 +106,13 @@ static void qxl_gc_work(struct work_struct *work)
 	qxl_garbage_collect(qdev);
 }
 
+static void qxl_release_bo_work(struct work_struct *work)
+{
+	struct qxl_device *qdev = container_of(work, struct qxl_device, release_bo_work);
+
+	qxl_release_prealloc(qdev);
+}
+
 int qxl_device_init(struct qxl_device *qdev,
 		    struct pci_dev *pdev)
 {
@@ -261,6 +268,7 @@ int qxl_device_init(struct qxl_device *qdev,
 		   (unsigned long)qdev->surfaceram_base,
 		   (unsigned long)qdev->surfaceram_size);
 
+	INIT_WORK(&qdev->release_bo_work, qxl_release_bo_work);
 	INIT_WORK(&qdev->gc_work, qxl_gc_work);
 
 	return 0;
@@ -292,7 +300,12 @@ void qxl_device_fini(struct qxl_device *qdev)
 	if (!qdev->gc_work.func)
 		return;
 
+	flush_work(&qdev->release_bo_work);
 	for (cur_idx = 0; cur_idx < 3; cur_idx++) {
+		if (qdev->spare_release_bo[cur_idx]) {
+			qxl_bo_unpin(qdev->spare_release_bo[cur_idx]);
+			qxl_bo_unref(&qdev->spare_release_bo[cur_idx]);
+		}
 		if (!qdev->current_release_bo[cur_idx])
 			continue;
 		qxl_bo_unpin(qdev->current_release_bo[cur_idx]);
@@ -34,12 +34,18 @@
  * use an ida to index into the chunks?
  */
 /* manage releaseables */
-/* stack them 16 high for now -drawable object is 191 */
+/*
+ * release bo's are pinned arenas of several pages, allocating and
+ * pinning a new one for each page worth of commands costs more than it
+ * wastes.
+ */
+#define RELEASE_BO_SIZE (16 * PAGE_SIZE)
+/* 256 bytes per release -drawable object is 191 */
 #define RELEASE_SIZE 256
-#define RELEASES_PER_BO (PAGE_SIZE / RELEASE_SIZE)
+#define RELEASES_PER_BO (RELEASE_BO_SIZE / RELEASE_SIZE)
 /* put an alloc/dealloc surface cmd into one bo and round up to 128 */
 #define SURFACE_RELEASE_SIZE 128
-#define SURFACE_RELEASES_PER_BO (PAGE_SIZE / SURFACE_RELEASE_SIZE)
+#define SURFACE_RELEASES_PER_BO (RELEASE_BO_SIZE / SURFACE_RELEASE_SIZE)
 
 static const int release_size_per_bo[] = { RELEASE_SIZE, SURFACE_RELEASE_SIZE, RELEASE_SIZE };
 static const int releases_per_bo[] = { RELEASES_PER_BO, SURFACE_RELEASES_PER_BO, RELEASES_PER_BO };
@@ -164,10 +170,41 @@ static int qxl_release_bo_alloc(struct qxl_device *qdev,
 				u32 priority)
 {
 	/* pin releases bo's they are too messy to evict */
-	return qxl_bo_create(qdev, PAGE_SIZE, false, true,
+	return qxl_bo_create(qdev, RELEASE_BO_SIZE, false, true,
 			     QXL_GEM_DOMAIN_VRAM, priority, NULL, bo);
 }
 
+static const u32 release_bo_priority[] = { 0, 1, 1 };
+
+/**
+ * qxl_release_prealloc - allocate the next release arenas ahead of time
+ * @qdev: qxl device
+ *
+ * Runs from its own worker, not the garbage collector, as the allocation
+ * may have to wait for releases the collector frees. Once the current
+ * arena of a release type is half used a spare one is allocated, so
+ * switching arenas in qxl_alloc_release_reserved() normally doesn't have
+ * to wait for a bo allocation. Failure is not an error, the allocation
+ * is then simply retried from the submission path.
+ */
+void qxl_release_prealloc(struct qxl_device *qdev)
+{
+	int cur_idx;
+
+	mutex_lock(&qdev->release_mutex);
+	for (cur_idx = 0; cur_idx < 3; cur_idx++) {
+		if (qdev->spare_release_bo[cur_idx] ||
+		    !qdev->current_release_bo[cur_idx] ||
+		    qdev->current_release_bo_offset[cur_idx] <
+		    releases_per_bo[cur_idx] / 2)
+			continue;
+
+		qxl_release_bo_alloc(qdev, &qdev->spare_release_bo[cur_idx],
+				     release_bo_priority[cur_idx]);
+	}
+	mutex_unlock(&qdev->release_mutex);
+}
+
 int qxl_release_list_add(struct qxl_release *release, struct qxl_bo *bo)
 {
 	struct qxl_bo_list *entry;
@@ -317,9 +354,15 @@ int qxl_alloc_release_reserved(struct qxl_device *qdev, unsigned long size,
 	if (qdev->current_release_bo_offset[cur_idx] + 1 >= releases_per_bo[cur_idx]) {
 		free_bo = qdev->current_release_bo[cur_idx];
 		qdev->current_release_bo_offset[cur_idx] = 0;
-		qdev->current_release_bo[cur_idx] = NULL;
+		qdev->current_release_bo[cur_idx] = qdev->spare_release_bo[cur_idx];
+		qdev->spare_release_bo[cur_idx] = NULL;
+		if (qdev->current_release_bo[cur_idx])
+			atomic_inc(&qdev->release_bo_spare_hits);
+		/* free up what the device already handed back */
+		qxl_queue_garbage_collect(qdev, false);
 	}
 	if (!qdev->current_release_bo[cur_idx]) {
+		atomic_inc(&qdev->release_bo_allocs);
 		ret = qxl_release_bo_alloc(qdev, &qdev->current_release_bo[cur_idx], priority);
 		if (ret) {
 			mutex_unlock(&qdev->release_mutex);
@@ -337,6 +380,9 @@ int qxl_alloc_release_reserved(struct qxl_device *qdev, unsigned long size,
 	(*release)->release_bo = bo;
 	(*release)->release_offset = qdev->current_release_bo_offset[cur_idx] * release_size_per_bo[cur_idx];
 	qdev->current_release_bo_offset[cur_idx]++;
+	if (qdev->current_release_bo_offset[cur_idx] == releases_per_bo[cur_idx] / 2 &&
+	    !qdev->spare_release_bo[cur_idx])
+		schedule_work(&qdev->release_bo_work);
 
 	if (rbo)
 		*rbo = bo;
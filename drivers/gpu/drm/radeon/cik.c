@@ -8088,7 +8088,7 @@ int cik_irq_process(struct radeon_device *rdev)
 		schedule_delayed_work(&rdev->hotplug_work, 0);
 	if (queue_reset) {
 		rdev->needs_reset = true;
-		wake_up_all(&rdev->fence_queue);
+		radeon_fence_wake_all(rdev);
 	}
 	if (queue_thermal)
 		schedule_work(&rdev->pm.dpm.thermal.work);
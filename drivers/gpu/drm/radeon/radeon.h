@@ -79,6 +79,7 @@
 #include <drm/ttm/ttm_execbuf_util.h>
 
 #include <drm/drm_gem.h>
+#include <drm/gpu_scheduler.h>
 
 #include "radeon_family.h"
 #include "radeon_mode.h"
@@ -121,6 +122,7 @@ extern int radeon_uvd;
 extern int radeon_vce;
 extern int radeon_si_support;
 extern int radeon_cik_support;
+extern int radeon_sched;
 
 /*
  * Copy from radeon_drv.h so we don't have to include both and have conflicting
@@ -370,6 +372,12 @@ struct radeon_fence_driver {
 	atomic64_t			last_seq;
 	bool				initialized, delayed_irq;
 	struct delayed_work		lockup_work;
+	/* waiters and fence callbacks of this ring only */
+	wait_queue_head_t		fence_queue;
+	/* emit to signal latency of the fences noticed signaled */
+	atomic64_t			latency_count;
+	atomic64_t			latency_ns;
+	atomic64_t			latency_max_ns;
 };
 
 struct radeon_fence {
@@ -380,6 +388,7 @@ struct radeon_fence {
 	/* RB, DMA, etc. */
 	unsigned		ring;
 	bool			is_vm_update;
+	ktime_t			emitted;
 
 	wait_queue_entry_t		fence_wake;
 };
@@ -390,6 +399,7 @@ void radeon_fence_driver_fini(struct radeon_device *rdev);
 void radeon_fence_driver_force_completion(struct radeon_device *rdev, int ring);
 int radeon_fence_emit(struct radeon_device *rdev, struct radeon_fence **fence, int ring);
 void radeon_fence_process(struct radeon_device *rdev, int ring);
+void radeon_fence_wake_all(struct radeon_device *rdev);
 bool radeon_fence_signaled(struct radeon_fence *fence);
 long radeon_fence_wait_timeout(struct radeon_fence *fence, bool interruptible, long timeout);
 int radeon_fence_wait(struct radeon_fence *fence, bool interruptible);
@@ -858,6 +868,9 @@ struct radeon_ring {
 	struct radeon_bo	*mqd_obj;
 	u32 doorbell_index;
 	unsigned		wptr_offs;
+	/* GPU scheduler feeding this ring, see radeon_job.c */
+	struct drm_gpu_scheduler	sched;
+	bool			sched_ready;
 };
 
 struct radeon_mec {
@@ -958,8 +971,28 @@ struct radeon_vm_manager {
 /*
  * file private structure
  */
+/*
+ * Last relocation list of a client, lets a resubmission of the same
+ * list skip the handle lookups and the priority sort.
+ */
+struct radeon_cs_reloc_cache {
+	struct mutex		lock;
+	u32			hash;
+	u32			ring;
+	unsigned		nrelocs;
+	uint32_t		*kdata;
+	/* no references held, invalidated when a handle is closed */
+	struct radeon_bo	**robjs;
+	/* reloc indices in validation order */
+	unsigned		*order;
+};
+
 struct radeon_fpriv {
 	struct radeon_vm		vm;
+	struct radeon_cs_reloc_cache	reloc_cache;
+	/* scheduler entities, only valid for rings in entity_mask */
+	struct drm_sched_entity		entities[RADEON_NUM_RINGS];
+	u32				entity_mask;
 };
 
 /*
@@ -1010,6 +1043,33 @@ int radeon_ib_schedule(struct radeon_device *rdev, struct radeon_ib *ib,
 int radeon_ib_pool_init(struct radeon_device *rdev);
 void radeon_ib_pool_fini(struct radeon_device *rdev);
 int radeon_ib_ring_tests(struct radeon_device *rdev);
+
+/*
+ * GPU scheduler jobs
+ */
+#define RADEON_SCHED_HW_SUBMISSION		4
+
+struct radeon_job {
+	struct drm_sched_job	base;
+	struct radeon_device	*rdev;
+	struct radeon_ib	ib;
+};
+
+#define to_radeon_job(job)	container_of((job), struct radeon_job, base)
+
+int radeon_sched_init(struct radeon_device *rdev);
+void radeon_sched_fini(struct radeon_device *rdev);
+void radeon_sched_stop(struct radeon_device *rdev);
+void radeon_sched_start(struct radeon_device *rdev);
+bool radeon_sched_ring_enabled(struct radeon_device *rdev,
+			       struct radeon_fpriv *fpriv, int ring);
+int radeon_sched_entities_init(struct radeon_device *rdev,
+			       struct radeon_fpriv *fpriv);
+void radeon_sched_entities_fini(struct radeon_device *rdev,
+				struct radeon_fpriv *fpriv);
+int radeon_job_submit(struct radeon_device *rdev, struct drm_sched_entity *entity,
+		      struct radeon_ib *ib, struct list_head *validated,
+		      void *owner, struct dma_fence **fence);
 /* Ring access between begin & end cannot sleep */
 bool radeon_ring_supports_scratch_reg(struct radeon_device *rdev,
 				      struct radeon_ring *ring);
@@ -1083,6 +1143,8 @@ struct radeon_cs_parser {
 	u32			ring;
 	s32			priority;
 	struct ww_acquire_ctx	ticket;
+	/* finished fence of the scheduler job, NULL for direct submission */
+	struct dma_fence	*fence;
 };
 
 static inline u32 radeon_get_ib_value(struct radeon_cs_parser *p, int idx)
@@ -2406,7 +2468,6 @@ struct radeon_device {
 	struct radeon_doorbell		doorbell;
 	struct radeon_mman		mman;
 	struct radeon_fence_driver	fence_drv[RADEON_NUM_RINGS];
-	wait_queue_head_t		fence_queue;
 	u64				fence_context;
 	struct mutex			ring_lock;
 	struct radeon_ring		ring[RADEON_NUM_RINGS];
@@ -2984,6 +3045,9 @@ int radeon_cs_packet_parse(struct radeon_cs_parser *p,
 			   struct radeon_cs_packet *pkt,
 			   unsigned idx);
 bool radeon_cs_packet_next_is_pkt3_nop(struct radeon_cs_parser *p);
+void radeon_cs_reloc_cache_invalidate(struct radeon_cs_reloc_cache *cache,
+				      struct radeon_bo *robj);
+void radeon_cs_reloc_cache_fini(struct radeon_cs_reloc_cache *cache);
 void radeon_cs_dump_packet(struct radeon_cs_parser *p,
 			   struct radeon_cs_packet *pkt);
 int radeon_cs_packet_next_reloc(struct radeon_cs_parser *p,
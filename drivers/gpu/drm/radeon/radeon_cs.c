@@ -25,6 +25,7 @@
  *    Jerome Glisse <glisse@freedesktop.org>
  */
 
+#include <linux/jhash.h>
 #include <linux/list_sort.h>
 #include <linux/pci.h>
 #include <linux/uaccess.h>
@@ -78,13 +79,97 @@ static void radeon_cs_buckets_get_list(struct radeon_cs_buckets *b,
 	}
 }
 
+/**
+ * radeon_cs_reloc_cache_invalidate - drop the cached relocation list
+ *
+ * @cache: reloc cache of the client
+ * @robj: buffer object whose handle goes away
+ *
+ * Called when a GEM handle is closed, the cache doesn't hold references
+ * so it must not outlive any handle it resolved.
+ */
+void radeon_cs_reloc_cache_invalidate(struct radeon_cs_reloc_cache *cache,
+				      struct radeon_bo *robj)
+{
+	unsigned i;
+
+	mutex_lock(&cache->lock);
+	for (i = 0; i < cache->nrelocs; i++) {
+		if (cache->robjs[i] == robj) {
+			cache->nrelocs = 0;
+			break;
+		}
+	}
+	mutex_unlock(&cache->lock);
+}
+
+/**
+ * radeon_cs_reloc_cache_fini - free the cached relocation list
+ *
+ * @cache: reloc cache of the client
+ */
+void radeon_cs_reloc_cache_fini(struct radeon_cs_reloc_cache *cache)
+{
+	kvfree(cache->kdata);
+	kvfree(cache->robjs);
+	kvfree(cache->order);
+	cache->kdata = NULL;
+	cache->robjs = NULL;
+	cache->order = NULL;
+	cache->nrelocs = 0;
+	mutex_destroy(&cache->lock);
+}
+
+static bool radeon_cs_reloc_cache_hit(struct radeon_cs_reloc_cache *cache,
+				      struct radeon_cs_parser *p, u32 hash)
+{
+	return cache->nrelocs == p->nrelocs && cache->hash == hash &&
+		cache->ring == p->ring &&
+		!memcmp(cache->kdata, p->chunk_relocs->kdata, p->nrelocs * 16);
+}
+
+/* remember the resolved handles and the validation order of @p */
+static void radeon_cs_reloc_cache_store(struct radeon_cs_reloc_cache *cache,
+					struct radeon_cs_parser *p, u32 hash)
+{
+	struct radeon_bo_list *reloc;
+	unsigned i = 0;
+
+	cache->nrelocs = 0;
+	kvfree(cache->kdata);
+	kvfree(cache->robjs);
+	kvfree(cache->order);
+	cache->kdata = kvmalloc(p->nrelocs * 16, GFP_KERNEL);
+	cache->robjs = kvmalloc_array(p->nrelocs, sizeof(*cache->robjs),
+				      GFP_KERNEL);
+	cache->order = kvmalloc_array(p->nrelocs, sizeof(*cache->order),
+				      GFP_KERNEL);
+	if (!cache->kdata || !cache->robjs || !cache->order)
+		return;
+
+	memcpy(cache->kdata, p->chunk_relocs->kdata, p->nrelocs * 16);
+	for (i = 0; i < p->nrelocs; i++)
+		cache->robjs[i] = p->relocs[i].robj;
+	i = 0;
+	list_for_each_entry(reloc, &p->validated, tv.head)
+		cache->order[i++] = reloc - p->relocs;
+
+	cache->hash = hash;
+	cache->ring = p->ring;
+	cache->nrelocs = p->nrelocs;
+}
+
 static int radeon_cs_parser_relocs(struct radeon_cs_parser *p)
 {
+	struct radeon_fpriv *fpriv = p->filp->driver_priv;
+	struct radeon_cs_reloc_cache *cache = NULL;
 	struct radeon_cs_chunk *chunk;
 	struct radeon_cs_buckets buckets;
 	unsigned i;
 	bool need_mmap_lock = false;
-	int r;
+	bool cached = false;
+	u32 hash = 0;
+	int r, ret = 0;
 
 	if (p->chunk_relocs == NULL) {
 		return 0;
@@ -101,17 +186,34 @@ static int radeon_cs_parser_relocs(struct radeon_cs_parser *p)
 
 	radeon_cs_buckets_init(&buckets);
 
+	/* The same relocation list is usually submitted over and over
+	 * again, reuse the handles and the order resolved last time.
+	 */
+	if (fpriv && p->nrelocs) {
+		cache = &fpriv->reloc_cache;
+		hash = jhash2(chunk->kdata, p->nrelocs * 4, p->ring);
+		mutex_lock(&cache->lock);
+		cached = radeon_cs_reloc_cache_hit(cache, p, hash);
+	}
+
 	for (i = 0; i < p->nrelocs; i++) {
 		struct drm_radeon_cs_reloc *r;
 		struct drm_gem_object *gobj;
 		unsigned priority;
 
 		r = (struct drm_radeon_cs_reloc *)&chunk->kdata[i*4];
-		gobj = drm_gem_object_lookup(p->filp, r->handle);
+		if (cached) {
+			/* the handle is still open, see the invalidation */
+			gobj = &cache->robjs[i]->tbo.base;
+			drm_gem_object_get(gobj);
+		} else {
+			gobj = drm_gem_object_lookup(p->filp, r->handle);
+		}
 		if (gobj == NULL) {
 			DRM_ERROR("gem object lookup failed 0x%x\n",
 				  r->handle);
-			return -ENOENT;
+			ret = -ENOENT;
+			goto out_unlock;
 		}
 		p->relocs[i].robj = gem_to_radeon_bo(gobj);
 
@@ -150,7 +252,8 @@ static int radeon_cs_parser_relocs(struct radeon_cs_parser *p)
 			if (domain & RADEON_GEM_DOMAIN_CPU) {
 				DRM_ERROR("RADEON_GEM_DOMAIN_CPU is not valid "
 					  "for command submission\n");
-				return -EINVAL;
+				ret = -EINVAL;
+				goto out_unlock;
 			}
 
 			p->relocs[i].preferred_domains = domain;
@@ -164,7 +267,8 @@ static int radeon_cs_parser_relocs(struct radeon_cs_parser *p)
 			if (!(domain & RADEON_GEM_DOMAIN_GTT)) {
 				DRM_ERROR("Only RADEON_GEM_DOMAIN_GTT is "
 					  "allowed for userptr BOs\n");
-				return -EINVAL;
+				ret = -EINVAL;
+				goto out_unlock;
 			}
 			need_mmap_lock = true;
 			domain = RADEON_GEM_DOMAIN_GTT;
@@ -178,18 +282,30 @@ static int radeon_cs_parser_relocs(struct radeon_cs_parser *p)
 			if (!p->relocs[i].allowed_domains) {
 				DRM_ERROR("BO associated with dma-buf cannot "
 					  "be moved to VRAM\n");
-				return -EINVAL;
+				ret = -EINVAL;
+				goto out_unlock;
 			}
 		}
 
 		p->relocs[i].tv.bo = &p->relocs[i].robj->tbo;
 		p->relocs[i].tv.num_shared = !r->write_domain;
 
-		radeon_cs_buckets_add(&buckets, &p->relocs[i].tv.head,
-				      priority);
+		if (!cached)
+			radeon_cs_buckets_add(&buckets, &p->relocs[i].tv.head,
+					      priority);
 	}
 
-	radeon_cs_buckets_get_list(&buckets, &p->validated);
+	if (cached) {
+		for (i = 0; i < p->nrelocs; i++)
+			list_add_tail(&p->relocs[cache->order[i]].tv.head,
+				      &p->validated);
+	} else {
+		radeon_cs_buckets_get_list(&buckets, &p->validated);
+		if (cache)
+			radeon_cs_reloc_cache_store(cache, p, hash);
+	}
+	if (cache)
+		mutex_unlock(&cache->lock);
 
 	if (p->cs_flags & RADEON_CS_USE_VM)
 		p->vm_bos = radeon_vm_get_bos(p->rdev, p->ib.vm,
@@ -203,6 +319,11 @@ static int radeon_cs_parser_relocs(struct radeon_cs_parser *p)
 		mmap_read_unlock(current->mm);
 
 	return r;
+
+out_unlock:
+	if (cache)
+		mutex_unlock(&cache->lock);
+	return ret;
 }
 
 static int radeon_cs_get_ring(struct radeon_cs_parser *p, u32 ring, s32 priority)
@@ -432,7 +553,7 @@ static void radeon_cs_parser_fini(struct radeon_cs_parser *parser, int error, bo
 
 		ttm_eu_fence_buffer_objects(&parser->ticket,
 					    &parser->validated,
-					    &parser->ib.fence->base);
+					    parser->fence ?: &parser->ib.fence->base);
 	} else if (backoff) {
 		ttm_eu_backoff_reservation(&parser->ticket,
 					   &parser->validated);
@@ -456,11 +577,13 @@ static void radeon_cs_parser_fini(struct radeon_cs_parser *parser, int error, bo
 	kvfree(parser->chunks_array);
 	radeon_ib_free(parser->rdev, &parser->ib);
 	radeon_ib_free(parser->rdev, &parser->const_ib);
+	dma_fence_put(parser->fence);
 }
 
 static int radeon_cs_ib_chunk(struct radeon_device *rdev,
 			      struct radeon_cs_parser *parser)
 {
+	struct radeon_fpriv *fpriv = parser->filp->driver_priv;
 	int r;
 
 	if (parser->chunk_ib == NULL)
@@ -475,6 +598,22 @@ static int radeon_cs_ib_chunk(struct radeon_device *rdev,
 		return r;
 	}
 
+	if (parser->ring == R600_RING_TYPE_UVD_INDEX)
+		radeon_uvd_note_usage(rdev);
+	else if ((parser->ring == TN_RING_TYPE_VCE1_INDEX) ||
+		 (parser->ring == TN_RING_TYPE_VCE2_INDEX))
+		radeon_vce_note_usage(rdev);
+
+	/* let the scheduler resolve the dependencies */
+	if (radeon_sched_ring_enabled(rdev, fpriv, parser->ring)) {
+		r = radeon_job_submit(rdev, &fpriv->entities[parser->ring],
+				      &parser->ib, &parser->validated,
+				      parser->filp, &parser->fence);
+		if (r && r != -ERESTARTSYS)
+			DRM_ERROR("Failed to submit job: %i\n", r);
+		return r;
+	}
+
 	r = radeon_cs_sync_rings(parser);
 	if (r) {
 		if (r != -ERESTARTSYS)
@@ -482,12 +621,6 @@ static int radeon_cs_ib_chunk(struct radeon_device *rdev,
 		return r;
 	}
 
-	if (parser->ring == R600_RING_TYPE_UVD_INDEX)
-		radeon_uvd_note_usage(rdev);
-	else if ((parser->ring == TN_RING_TYPE_VCE1_INDEX) ||
-		 (parser->ring == TN_RING_TYPE_VCE2_INDEX))
-		radeon_vce_note_usage(rdev);
-
 	r = radeon_ib_schedule(rdev, &parser->ib, NULL, true);
 	if (r) {
 		DRM_ERROR("Failed to schedule IB !\n");
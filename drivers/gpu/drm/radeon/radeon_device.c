@@ -1622,6 +1622,7 @@ int radeon_suspend_kms(struct drm_device *dev, bool suspend,
 
 	radeon_save_bios_scratch_regs(rdev);
 
+	radeon_sched_stop(rdev);
 	radeon_suspend(rdev);
 	radeon_hpd_fini(rdev);
 	/* evict remaining vram memory
@@ -1687,6 +1688,7 @@ int radeon_resume_kms(struct drm_device *dev, bool resume, bool fbcon)
 	r = radeon_ib_ring_tests(rdev);
 	if (r)
 		DRM_ERROR("ib ring test failed (%d).\n", r);
+	radeon_sched_start(rdev);
 
 	if ((rdev->pm.pm_method == PM_METHOD_DPM) && rdev->pm.dpm_enabled) {
 		/* do dpm late init */
@@ -1789,6 +1791,9 @@ int radeon_gpu_reset(struct radeon_device *rdev)
 
 	atomic_inc(&rdev->gpu_reset_counter);
 
+	/* keep the schedulers away from the rings during the reset */
+	radeon_sched_stop(rdev);
+
 	radeon_save_bios_scratch_regs(rdev);
 	/* block TTM */
 	resched = ttm_bo_lock_delayed_workqueue(&rdev->mman.bdev);
@@ -1875,6 +1880,7 @@ int radeon_gpu_reset(struct radeon_device *rdev)
 	rdev->needs_reset = r == -EAGAIN;
 	rdev->in_reset = false;
 
+	radeon_sched_start(rdev);
 	up_read(&rdev->exclusive_lock);
 	return r;
 }
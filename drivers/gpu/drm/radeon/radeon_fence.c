@@ -146,8 +146,9 @@ int radeon_fence_emit(struct radeon_device *rdev,
 	(*fence)->seq = seq = ++rdev->fence_drv[ring].sync_seq[ring];
 	(*fence)->ring = ring;
 	(*fence)->is_vm_update = false;
+	(*fence)->emitted = ktime_get();
 	dma_fence_init(&(*fence)->base, &radeon_fence_ops,
-		       &rdev->fence_queue.lock,
+		       &rdev->fence_drv[ring].fence_queue.lock,
 		       rdev->fence_context + ring,
 		       seq);
 	radeon_fence_ring_emit(rdev, ring, *fence);
@@ -156,6 +157,31 @@ int radeon_fence_emit(struct radeon_device *rdev,
 	return 0;
 }
 
+/**
+ * radeon_fence_note_latency - account the latency of a signaled fence
+ *
+ * @fence: radeon fence object which was just signaled
+ *
+ * Adds the time between emitting and noticing the signal of @fence
+ * to the statistics of its ring.
+ */
+static void radeon_fence_note_latency(struct radeon_fence *fence)
+{
+	struct radeon_fence_driver *drv = &fence->rdev->fence_drv[fence->ring];
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), fence->emitted));
+	s64 max = atomic64_read(&drv->latency_max_ns);
+
+	atomic64_inc(&drv->latency_count);
+	atomic64_add(ns, &drv->latency_ns);
+	while (ns > max) {
+		s64 old = atomic64_cmpxchg(&drv->latency_max_ns, max, ns);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
 /*
  * radeon_fence_check_signaled - callback from fence_queue
  *
@@ -176,9 +202,11 @@ static int radeon_fence_check_signaled(wait_queue_entry_t *wait, unsigned mode,
 	 */
 	seq = atomic64_read(&fence->rdev->fence_drv[fence->ring].last_seq);
 	if (seq >= fence->seq) {
-		dma_fence_signal_locked(&fence->base);
+		if (!dma_fence_signal_locked(&fence->base))
+			radeon_fence_note_latency(fence);
 		radeon_irq_kms_sw_irq_put(fence->rdev, fence->ring);
-		__remove_wait_queue(&fence->rdev->fence_queue, &fence->fence_wake);
+		__remove_wait_queue(&fence->rdev->fence_drv[fence->ring].fence_queue,
+				    &fence->fence_wake);
 		dma_fence_put(&fence->base);
 	}
 	return 0;
@@ -291,7 +319,7 @@ static void radeon_fence_check_lockup(struct work_struct *work)
 	}
 
 	if (radeon_fence_activity(rdev, ring))
-		wake_up_all(&rdev->fence_queue);
+		wake_up_all(&fence_drv->fence_queue);
 
 	else if (radeon_ring_is_lockup(rdev, ring, &rdev->ring[ring])) {
 
@@ -303,7 +331,7 @@ static void radeon_fence_check_lockup(struct work_struct *work)
 
 		/* remember that we need an reset */
 		rdev->needs_reset = true;
-		wake_up_all(&rdev->fence_queue);
+		radeon_fence_wake_all(rdev);
 	}
 	up_read(&rdev->exclusive_lock);
 }
@@ -314,13 +342,29 @@ static void radeon_fence_check_lockup(struct work_struct *work)
  * @rdev: radeon_device pointer
  * @ring: ring index the fence is associated with
  *
- * Checks the current fence value and wakes the fence queue
- * if the sequence number has increased (all asics).
+ * Checks the current fence value and wakes the fence queue of
+ * the ring if the sequence number has increased (all asics).
  */
 void radeon_fence_process(struct radeon_device *rdev, int ring)
 {
 	if (radeon_fence_activity(rdev, ring))
-		wake_up_all(&rdev->fence_queue);
+		wake_up_all(&rdev->fence_drv[ring].fence_queue);
+}
+
+/**
+ * radeon_fence_wake_all - wake up the waiters of all rings
+ *
+ * @rdev: radeon_device pointer
+ *
+ * Used when a GPU reset is needed, so that every waiter notices
+ * it and bails out (all asics).
+ */
+void radeon_fence_wake_all(struct radeon_device *rdev)
+{
+	int ring;
+
+	for (ring = 0; ring < RADEON_NUM_RINGS; ring++)
+		wake_up_all(&rdev->fence_drv[ring].fence_queue);
 }
 
 /**
@@ -393,7 +437,7 @@ static bool radeon_fence_enable_signaling(struct dma_fence *f)
 		radeon_irq_kms_sw_irq_get(rdev, fence->ring);
 
 		if (radeon_fence_activity(rdev, fence->ring))
-			wake_up_all_locked(&rdev->fence_queue);
+			wake_up_all_locked(&rdev->fence_drv[fence->ring].fence_queue);
 
 		/* did fence get signaled after we enabled the sw irq? */
 		if (atomic64_read(&rdev->fence_drv[fence->ring].last_seq) >= fence->seq) {
@@ -413,7 +457,8 @@ static bool radeon_fence_enable_signaling(struct dma_fence *f)
 	fence->fence_wake.flags = 0;
 	fence->fence_wake.private = NULL;
 	fence->fence_wake.func = radeon_fence_check_signaled;
-	__add_wait_queue(&rdev->fence_queue, &fence->fence_wake);
+	__add_wait_queue(&rdev->fence_drv[fence->ring].fence_queue,
+			 &fence->fence_wake);
 	dma_fence_get(f);
 	return true;
 }
@@ -432,7 +477,8 @@ bool radeon_fence_signaled(struct radeon_fence *fence)
 		return true;
 
 	if (radeon_fence_seq_signaled(fence->rdev, fence->seq, fence->ring)) {
-		dma_fence_signal(&fence->base);
+		if (!dma_fence_signal(&fence->base))
+			radeon_fence_note_latency(fence);
 		return true;
 	}
 	return false;
@@ -481,30 +527,42 @@ static long radeon_fence_wait_seq_timeout(struct radeon_device *rdev,
 					  u64 *target_seq, bool intr,
 					  long timeout)
 {
-	long r;
+	wait_queue_entry_t waits[RADEON_NUM_RINGS];
+	long r = timeout;
 	int i;
 
 	if (radeon_fence_any_seq_signaled(rdev, target_seq))
 		return timeout;
 
-	/* enable IRQs and tracing */
+	/* enable IRQs and tracing, only the rings we wait for can wake us */
 	for (i = 0; i < RADEON_NUM_RINGS; ++i) {
 		if (!target_seq[i])
 			continue;
 
 		trace_radeon_fence_wait_begin(rdev->ddev, i, target_seq[i]);
 		radeon_irq_kms_sw_irq_get(rdev, i);
+		init_waitqueue_entry(&waits[i], current);
+		add_wait_queue(&rdev->fence_drv[i].fence_queue, &waits[i]);
 	}
 
-	if (intr) {
-		r = wait_event_interruptible_timeout(rdev->fence_queue, (
-			radeon_fence_any_seq_signaled(rdev, target_seq)
-			 || rdev->needs_reset), timeout);
-	} else {
-		r = wait_event_timeout(rdev->fence_queue, (
-			radeon_fence_any_seq_signaled(rdev, target_seq)
-			 || rdev->needs_reset), timeout);
+	for (;;) {
+		set_current_state(intr ? TASK_INTERRUPTIBLE :
+				  TASK_UNINTERRUPTIBLE);
+		if (radeon_fence_any_seq_signaled(rdev, target_seq) ||
+		    rdev->needs_reset) {
+			if (!r)
+				r = 1;
+			break;
+		}
+		if (intr && signal_pending(current)) {
+			r = -ERESTARTSYS;
+			break;
+		}
+		if (!r)
+			break;
+		r = schedule_timeout(r);
 	}
+	__set_current_state(TASK_RUNNING);
 
 	if (rdev->needs_reset)
 		r = -EDEADLK;
@@ -513,6 +571,7 @@ static long radeon_fence_wait_seq_timeout(struct radeon_device *rdev,
 		if (!target_seq[i])
 			continue;
 
+		remove_wait_queue(&rdev->fence_drv[i].fence_queue, &waits[i]);
 		radeon_irq_kms_sw_irq_put(rdev, i);
 		trace_radeon_fence_wait_end(rdev->ddev, i, target_seq[i]);
 	}
@@ -553,7 +612,8 @@ long radeon_fence_wait_timeout(struct radeon_fence *fence, bool intr, long timeo
 		return r;
 	}
 
-	dma_fence_signal(&fence->base);
+	if (!dma_fence_signal(&fence->base))
+		radeon_fence_note_latency(fence);
 	return r;
 }
 
@@ -876,6 +936,10 @@ static void radeon_fence_driver_init_ring(struct radeon_device *rdev, int ring)
 	rdev->fence_drv[ring].initialized = false;
 	INIT_DELAYED_WORK(&rdev->fence_drv[ring].lockup_work,
 			  radeon_fence_check_lockup);
+	init_waitqueue_head(&rdev->fence_drv[ring].fence_queue);
+	atomic64_set(&rdev->fence_drv[ring].latency_count, 0);
+	atomic64_set(&rdev->fence_drv[ring].latency_ns, 0);
+	atomic64_set(&rdev->fence_drv[ring].latency_max_ns, 0);
 	rdev->fence_drv[ring].rdev = rdev;
 }
 
@@ -894,7 +958,6 @@ void radeon_fence_driver_init(struct radeon_device *rdev)
 {
 	int ring;
 
-	init_waitqueue_head(&rdev->fence_queue);
 	for (ring = 0; ring < RADEON_NUM_RINGS; ring++) {
 		radeon_fence_driver_init_ring(rdev, ring);
 	}
@@ -924,7 +987,7 @@ void radeon_fence_driver_fini(struct radeon_device *rdev)
 			radeon_fence_driver_force_completion(rdev, ring);
 		}
 		cancel_delayed_work_sync(&rdev->fence_drv[ring].lockup_work);
-		wake_up_all(&rdev->fence_queue);
+		wake_up_all(&rdev->fence_drv[ring].fence_queue);
 		radeon_scratch_free(rdev, rdev->fence_drv[ring].scratch_reg);
 		rdev->fence_drv[ring].initialized = false;
 	}
@@ -991,7 +1054,7 @@ static int radeon_debugfs_gpu_reset(void *data, u64 *val)
 	down_read(&rdev->exclusive_lock);
 	*val = rdev->needs_reset;
 	rdev->needs_reset = true;
-	wake_up_all(&rdev->fence_queue);
+	radeon_fence_wake_all(rdev);
 	up_read(&rdev->exclusive_lock);
 
 	return 0;
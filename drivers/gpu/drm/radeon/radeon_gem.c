@@ -232,6 +232,9 @@ static void radeon_gem_object_close(struct drm_gem_object *obj,
 	struct radeon_bo_va *bo_va;
 	int r;
 
+	if (fpriv)
+		radeon_cs_reloc_cache_invalidate(&fpriv->reloc_cache, rbo);
+
 	if ((rdev->family < CHIP_CAYMAN) ||
 	    (!rdev->accel_working)) {
 		return;
@@ -223,6 +223,13 @@ int radeon_ib_pool_init(struct radeon_device *rdev)
 		return r;
 	}
 
+	r = radeon_sched_init(rdev);
+	if (r) {
+		radeon_sa_bo_manager_suspend(rdev, &rdev->ring_tmp_bo);
+		radeon_sa_bo_manager_fini(rdev, &rdev->ring_tmp_bo);
+		return r;
+	}
+
 	rdev->ib_pool_ready = true;
 	radeon_debugfs_sa_init(rdev);
 	return 0;
@@ -239,6 +246,7 @@ int radeon_ib_pool_init(struct radeon_device *rdev)
 void radeon_ib_pool_fini(struct radeon_device *rdev)
 {
 	if (rdev->ib_pool_ready) {
+		radeon_sched_fini(rdev);
 		radeon_sa_bo_manager_suspend(rdev, &rdev->ring_tmp_bo);
 		radeon_sa_bo_manager_fini(rdev, &rdev->ring_tmp_bo);
 		rdev->ib_pool_ready = false;
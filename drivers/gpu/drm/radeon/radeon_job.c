@@ -0,0 +1,330 @@
+/*
+ * Copyright 2023 Advanced Micro Devices, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ */
+
+#include <linux/dma-resv.h>
+#include <linux/slab.h>
+
+#include "radeon.h"
+
+/*
+ * GPU scheduler
+ * The non VM command submission path can hand its IB over to a per ring
+ * drm_gpu_scheduler instead of writing it to the ring from the ioctl.
+ * Dependencies on other rings and devices are then resolved by the
+ * scheduler and the ioctl returns as soon as the job is queued.
+ *
+ * Hang detection and GPU reset stay with the fence lockup handling, the
+ * scheduler timeout is disabled and the schedulers are only paused while
+ * the hardware is reset or suspended.
+ */
+
+static const char * const radeon_sched_names[RADEON_NUM_RINGS] = {
+	[RADEON_RING_TYPE_GFX_INDEX] = "radeon_gfx",
+	[CAYMAN_RING_TYPE_CP1_INDEX] = "radeon_cp1",
+	[CAYMAN_RING_TYPE_CP2_INDEX] = "radeon_cp2",
+	[R600_RING_TYPE_DMA_INDEX] = "radeon_dma1",
+	[CAYMAN_RING_TYPE_DMA1_INDEX] = "radeon_dma2",
+	[R600_RING_TYPE_UVD_INDEX] = "radeon_uvd",
+	[TN_RING_TYPE_VCE1_INDEX] = "radeon_vce1",
+	[TN_RING_TYPE_VCE2_INDEX] = "radeon_vce2",
+};
+
+static struct dma_fence *radeon_job_run(struct drm_sched_job *sched_job)
+{
+	struct radeon_job *job = to_radeon_job(sched_job);
+	int r;
+
+	/* skip jobs whose dependencies failed */
+	if (sched_job->s_fence->finished.error)
+		return NULL;
+
+	r = radeon_ib_schedule(job->rdev, &job->ib, NULL, true);
+	if (r) {
+		DRM_ERROR("Failed to schedule IB !\n");
+		return ERR_PTR(r);
+	}
+
+	return dma_fence_get(&job->ib.fence->base);
+}
+
+static enum drm_gpu_sched_stat radeon_job_timedout(struct drm_sched_job *sched_job)
+{
+	/* the timeout is disabled, lockups are handled by the fence code */
+	return DRM_GPU_SCHED_STAT_NOMINAL;
+}
+
+static void radeon_job_free(struct drm_sched_job *sched_job)
+{
+	struct radeon_job *job = to_radeon_job(sched_job);
+
+	radeon_ib_free(job->rdev, &job->ib);
+	drm_sched_job_cleanup(sched_job);
+	kfree(job);
+}
+
+static const struct drm_sched_backend_ops radeon_sched_ops = {
+	.run_job = radeon_job_run,
+	.timedout_job = radeon_job_timedout,
+	.free_job = radeon_job_free,
+};
+
+/**
+ * radeon_sched_init - create the ring schedulers
+ *
+ * @rdev: radeon_device pointer
+ *
+ * Create a GPU scheduler for each ring of the asic if
+ * scheduled submission is enabled (all asics).
+ * Returns 0 on success, error on failure.
+ */
+int radeon_sched_init(struct radeon_device *rdev)
+{
+	int i, r;
+
+	if (!radeon_sched)
+		return 0;
+
+	for (i = 0; i < RADEON_NUM_RINGS; ++i) {
+		struct radeon_ring *ring = &rdev->ring[i];
+
+		if (ring->sched_ready || !ring->ring_size)
+			continue;
+
+		r = drm_sched_init(&ring->sched, &radeon_sched_ops, NULL,
+				   RADEON_SCHED_HW_SUBMISSION, 0,
+				   MAX_SCHEDULE_TIMEOUT, NULL, NULL,
+				   radeon_sched_names[i],
+				   DRM_SCHED_POLICY_DEFAULT);
+		if (r) {
+			dev_err(rdev->dev, "(%d) failed to create scheduler for ring %d\n",
+				r, i);
+			radeon_sched_fini(rdev);
+			return r;
+		}
+		ring->sched_ready = true;
+	}
+	return 0;
+}
+
+/**
+ * radeon_sched_fini - tear down the ring schedulers
+ *
+ * @rdev: radeon_device pointer
+ *
+ * Tear down the GPU schedulers created by radeon_sched_init (all asics).
+ */
+void radeon_sched_fini(struct radeon_device *rdev)
+{
+	int i;
+
+	for (i = 0; i < RADEON_NUM_RINGS; ++i) {
+		struct radeon_ring *ring = &rdev->ring[i];
+
+		if (!ring->sched_ready)
+			continue;
+
+		drm_sched_fini(&ring->sched);
+		ring->sched_ready = false;
+	}
+}
+
+/**
+ * radeon_sched_stop - pause job submission to the hardware
+ *
+ * @rdev: radeon_device pointer
+ *
+ * Stop the schedulers from pushing new jobs to the rings while
+ * the asic is reset or suspended. Queued jobs are kept.
+ */
+void radeon_sched_stop(struct radeon_device *rdev)
+{
+	int i;
+
+	for (i = 0; i < RADEON_NUM_RINGS; ++i)
+		if (rdev->ring[i].sched_ready)
+			drm_sched_wqueue_stop(&rdev->ring[i].sched);
+}
+
+/**
+ * radeon_sched_start - resume job submission to the hardware
+ *
+ * @rdev: radeon_device pointer
+ *
+ * Counterpart of radeon_sched_stop.
+ */
+void radeon_sched_start(struct radeon_device *rdev)
+{
+	int i;
+
+	for (i = 0; i < RADEON_NUM_RINGS; ++i)
+		if (rdev->ring[i].sched_ready)
+			drm_sched_wqueue_start(&rdev->ring[i].sched);
+}
+
+/**
+ * radeon_sched_ring_enabled - check for scheduled submission
+ *
+ * @rdev: radeon_device pointer
+ * @fpriv: file private, may be NULL
+ * @ring: ring index
+ *
+ * Returns true if command streams of @fpriv for @ring should go
+ * through the GPU scheduler.
+ */
+bool radeon_sched_ring_enabled(struct radeon_device *rdev,
+			       struct radeon_fpriv *fpriv, int ring)
+{
+	return fpriv && rdev->ring[ring].sched_ready &&
+		(fpriv->entity_mask & BIT(ring));
+}
+
+/**
+ * radeon_sched_entities_init - create the scheduler entities of a client
+ *
+ * @rdev: radeon_device pointer
+ * @fpriv: file private of the client
+ *
+ * Create an entity for each ring with a scheduler (all asics).
+ * Returns 0 on success, error on failure.
+ */
+int radeon_sched_entities_init(struct radeon_device *rdev,
+			       struct radeon_fpriv *fpriv)
+{
+	int i, r;
+
+	for (i = 0; i < RADEON_NUM_RINGS; ++i) {
+		struct drm_gpu_scheduler *sched = &rdev->ring[i].sched;
+
+		if (!rdev->ring[i].sched_ready)
+			continue;
+
+		r = drm_sched_entity_init(&fpriv->entities[i],
+					  DRM_SCHED_PRIORITY_NORMAL,
+					  &sched, 1, NULL);
+		if (r) {
+			radeon_sched_entities_fini(rdev, fpriv);
+			return r;
+		}
+		fpriv->entity_mask |= BIT(i);
+	}
+	return 0;
+}
+
+/**
+ * radeon_sched_entities_fini - destroy the scheduler entities of a client
+ *
+ * @rdev: radeon_device pointer
+ * @fpriv: file private of the client
+ *
+ * Flush the jobs still queued and destroy the entities (all asics).
+ */
+void radeon_sched_entities_fini(struct radeon_device *rdev,
+				struct radeon_fpriv *fpriv)
+{
+	int i;
+
+	for (i = 0; i < RADEON_NUM_RINGS; ++i) {
+		if (!(fpriv->entity_mask & BIT(i)))
+			continue;
+
+		drm_sched_entity_destroy(&fpriv->entities[i]);
+	}
+	fpriv->entity_mask = 0;
+}
+
+static int radeon_job_add_resv(struct radeon_job *job, int ring,
+			       struct dma_resv *resv, bool write)
+{
+	struct dma_resv_iter cursor;
+	struct radeon_fence *fence;
+	struct dma_fence *f;
+	int r;
+
+	dma_resv_for_each_fence(&cursor, resv, write, f) {
+		fence = to_radeon_fence(f);
+		/* the ring itself keeps its own submissions in order */
+		if (fence && fence->rdev == job->rdev && fence->ring == ring)
+			continue;
+
+		r = drm_sched_job_add_dependency(&job->base, dma_fence_get(f));
+		if (r)
+			return r;
+	}
+	return 0;
+}
+
+/**
+ * radeon_job_submit - queue an IB to a ring scheduler
+ *
+ * @rdev: radeon_device pointer
+ * @entity: scheduler entity to queue to
+ * @ib: IB to submit, ownership moves to the job on success
+ * @validated: reserved buffers the IB depends on
+ * @owner: job owner
+ * @fence: resulting finished fence of the job
+ *
+ * Wrap @ib into a scheduler job which waits for the fences of the
+ * @validated buffers and push it to @entity (all asics).
+ * Returns 0 on success, error on failure.
+ */
+int radeon_job_submit(struct radeon_device *rdev, struct drm_sched_entity *entity,
+		      struct radeon_ib *ib, struct list_head *validated,
+		      void *owner, struct dma_fence **fence)
+{
+	struct radeon_bo_list *reloc;
+	struct radeon_job *job;
+	int r;
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job)
+		return -ENOMEM;
+
+	job->rdev = rdev;
+	r = drm_sched_job_init(&job->base, entity, owner);
+	if (r) {
+		kfree(job);
+		return r;
+	}
+
+	list_for_each_entry(reloc, validated, tv.head) {
+		r = radeon_job_add_resv(job, ib->ring,
+					reloc->robj->tbo.base.resv,
+					!reloc->tv.num_shared);
+		if (r) {
+			drm_sched_job_cleanup(&job->base);
+			kfree(job);
+			return r;
+		}
+	}
+
+	job->ib = *ib;
+	memset(ib, 0, sizeof(*ib));
+
+	drm_sched_job_arm(&job->base);
+	*fence = dma_fence_get(&job->base.s_fence->finished);
+	drm_sched_entity_push_job(&job->base);
+	return 0;
+}
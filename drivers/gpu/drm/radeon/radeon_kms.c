@@ -660,43 +660,47 @@ int radeon_driver_open_kms(struct drm_device *dev, struct drm_file *file_priv)
 		return r;
 	}
 
-	/* new gpu have virtual address space support */
-	if (rdev->family >= CHIP_CAYMAN) {
+	fpriv = kzalloc(sizeof(*fpriv), GFP_KERNEL);
+	if (unlikely(!fpriv)) {
+		r = -ENOMEM;
+		goto err_suspend;
+	}
+	mutex_init(&fpriv->reloc_cache.lock);
+
+	if (rdev->accel_working) {
+		r = radeon_sched_entities_init(rdev, fpriv);
+		if (r)
+			goto err_fpriv;
+	}
 
-		fpriv = kzalloc(sizeof(*fpriv), GFP_KERNEL);
-		if (unlikely(!fpriv)) {
+	/* new gpu have virtual address space support */
+	if (rdev->family >= CHIP_CAYMAN && rdev->accel_working) {
+		vm = &fpriv->vm;
+		r = radeon_vm_init(rdev, vm);
+		if (r)
+			goto err_entities;
+
+		r = radeon_bo_reserve(rdev->ring_tmp_bo.bo, false);
+		if (r)
+			goto err_vm_fini;
+
+		/* map the ib pool buffer read only into
+		 * virtual address space */
+		vm->ib_bo_va = radeon_vm_bo_add(rdev, vm,
+						rdev->ring_tmp_bo.bo);
+		if (!vm->ib_bo_va) {
 			r = -ENOMEM;
-			goto err_suspend;
+			goto err_vm_fini;
 		}
 
-		if (rdev->accel_working) {
-			vm = &fpriv->vm;
-			r = radeon_vm_init(rdev, vm);
-			if (r)
-				goto err_fpriv;
-
-			r = radeon_bo_reserve(rdev->ring_tmp_bo.bo, false);
-			if (r)
-				goto err_vm_fini;
-
-			/* map the ib pool buffer read only into
-			 * virtual address space */
-			vm->ib_bo_va = radeon_vm_bo_add(rdev, vm,
-							rdev->ring_tmp_bo.bo);
-			if (!vm->ib_bo_va) {
-				r = -ENOMEM;
-				goto err_vm_fini;
-			}
-
-			r = radeon_vm_bo_set_addr(rdev, vm->ib_bo_va,
-						  RADEON_VA_IB_OFFSET,
-						  RADEON_VM_PAGE_READABLE |
-						  RADEON_VM_PAGE_SNOOPED);
-			if (r)
-				goto err_vm_fini;
-		}
-		file_priv->driver_priv = fpriv;
+		r = radeon_vm_bo_set_addr(rdev, vm->ib_bo_va,
+					  RADEON_VA_IB_OFFSET,
+					  RADEON_VM_PAGE_READABLE |
+					  RADEON_VM_PAGE_SNOOPED);
+		if (r)
+			goto err_vm_fini;
 	}
+	file_priv->driver_priv = fpriv;
 
 	pm_runtime_mark_last_busy(dev->dev);
 	pm_runtime_put_autosuspend(dev->dev);
@@ -704,6 +708,8 @@ int radeon_driver_open_kms(struct drm_device *dev, struct drm_file *file_priv)
 
 err_vm_fini:
 	radeon_vm_fini(rdev, vm);
+err_entities:
+	radeon_sched_entities_fini(rdev, fpriv);
 err_fpriv:
 	kfree(fpriv);
 
@@ -739,13 +745,15 @@ void radeon_driver_postclose_kms(struct drm_device *dev,
 	radeon_uvd_free_handles(rdev, file_priv);
 	radeon_vce_free_handles(rdev, file_priv);
 
-	/* new gpu have virtual address space support */
-	if (rdev->family >= CHIP_CAYMAN && file_priv->driver_priv) {
+	if (file_priv->driver_priv) {
 		struct radeon_fpriv *fpriv = file_priv->driver_priv;
 		struct radeon_vm *vm = &fpriv->vm;
 		int r;
 
-		if (rdev->accel_working) {
+		radeon_sched_entities_fini(rdev, fpriv);
+
+		/* new gpu have virtual address space support */
+		if (rdev->family >= CHIP_CAYMAN && rdev->accel_working) {
 			r = radeon_bo_reserve(rdev->ring_tmp_bo.bo, false);
 			if (!r) {
 				if (vm->ib_bo_va)
@@ -755,6 +763,7 @@ void radeon_driver_postclose_kms(struct drm_device *dev,
 			radeon_vm_fini(rdev, vm);
 		}
 
+		radeon_cs_reloc_cache_fini(&fpriv->reloc_cache);
 		kfree(fpriv);
 		file_priv->driver_priv = NULL;
 	}
@@ -466,9 +466,11 @@ static int radeon_debugfs_ring_info_show(struct seq_file *m, void *unused)
 {
 	struct radeon_ring *ring = (struct radeon_ring *) m->private;
 	struct radeon_device *rdev = ring->rdev;
+	struct radeon_fence_driver *fence_drv = &rdev->fence_drv[ring->idx];
 
 	uint32_t rptr, wptr, rptr_next;
 	unsigned count, i, j;
+	u64 fences;
 
 	radeon_ring_free_size(rdev, ring);
 	count = (ring->ring_size / 4) - ring->ring_free_dw;
@@ -497,6 +499,13 @@ static int radeon_debugfs_ring_info_show(struct seq_file *m, void *unused)
 	seq_printf(m, "%u free dwords in ring\n", ring->ring_free_dw);
 	seq_printf(m, "%u dwords in ring\n", count);
 
+	fences = atomic64_read(&fence_drv->latency_count);
+	seq_printf(m, "%llu fences signaled, latency avg %llu ns, max %llu ns\n",
+		   fences,
+		   fences ? div64_u64(atomic64_read(&fence_drv->latency_ns),
+				      fences) : 0,
+		   (u64)atomic64_read(&fence_drv->latency_max_ns));
+
 	if (!ring->ring)
 		return 0;
 
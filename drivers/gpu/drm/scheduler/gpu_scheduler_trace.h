@@ -40,6 +40,7 @@ TRACE_EVENT(drm_sched_job,
 			     __field(struct dma_fence *, fence)
 			     __field(const char *, name)
 			     __field(uint64_t, id)
+			     __field(uint64_t, trace_id)
 			     __field(u32, job_count)
 			     __field(int, hw_job_count)
 			     ),
@@ -47,18 +48,43 @@ TRACE_EVENT(drm_sched_job,
 	    TP_fast_assign(
 			   __entry->entity = entity;
 			   __entry->id = sched_job->id;
+			   __entry->trace_id = sched_job->trace_id;
 			   __entry->fence = &sched_job->s_fence->finished;
 			   __entry->name = sched_job->sched->name;
 			   __entry->job_count = spsc_queue_count(&entity->job_queue);
 			   __entry->hw_job_count = atomic_read(
 				   &sched_job->sched->hw_rq_count);
 			   ),
-	    TP_printk("entity=%p, id=%llu, fence=%p, ring=%s, job count:%u, hw job count:%d",
-		      __entry->entity, __entry->id,
+	    TP_printk("entity=%p, id=%llu, trace_id=%llu, fence=%p, ring=%s, job count:%u, hw job count:%d",
+		      __entry->entity, __entry->id, __entry->trace_id,
 		      __entry->fence, __entry->name,
 		      __entry->job_count, __entry->hw_job_count)
 );
 
+TRACE_EVENT(drm_sched_job_batch,
+	    TP_PROTO(struct drm_sched_entity *entity, unsigned int count,
+		     ktime_t latency),
+	    TP_ARGS(entity, count, latency),
+	    TP_STRUCT__entry(
+			     __field(struct drm_sched_entity *, entity)
+			     __field(const char *, name)
+			     __field(u32, count)
+			     __field(u32, job_count)
+			     __field(s64, latency)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->entity = entity;
+			   __entry->name = entity->rq->sched->name;
+			   __entry->count = count;
+			   __entry->job_count = spsc_queue_count(&entity->job_queue);
+			   __entry->latency = ktime_to_ns(latency);
+			   ),
+	    TP_printk("entity=%p, ring=%s, batch:%u, job count:%u, latency:%lldns",
+		      __entry->entity, __entry->name, __entry->count,
+		      __entry->job_count, __entry->latency)
+);
+
 TRACE_EVENT(drm_run_job,
 	    TP_PROTO(struct drm_sched_job *sched_job, struct drm_sched_entity *entity),
 	    TP_ARGS(sched_job, entity),
@@ -67,6 +93,7 @@ TRACE_EVENT(drm_run_job,
 			     __field(struct dma_fence *, fence)
 			     __field(const char *, name)
 			     __field(uint64_t, id)
+			     __field(uint64_t, trace_id)
 			     __field(u32, job_count)
 			     __field(int, hw_job_count)
 			     ),
@@ -74,29 +101,58 @@ TRACE_EVENT(drm_run_job,
 	    TP_fast_assign(
 			   __entry->entity = entity;
 			   __entry->id = sched_job->id;
+			   __entry->trace_id = sched_job->trace_id;
 			   __entry->fence = &sched_job->s_fence->finished;
 			   __entry->name = sched_job->sched->name;
 			   __entry->job_count = spsc_queue_count(&entity->job_queue);
 			   __entry->hw_job_count = atomic_read(
 				   &sched_job->sched->hw_rq_count);
 			   ),
-	    TP_printk("entity=%p, id=%llu, fence=%p, ring=%s, job count:%u, hw job count:%d",
-		      __entry->entity, __entry->id,
+	    TP_printk("entity=%p, id=%llu, trace_id=%llu, fence=%p, ring=%s, job count:%u, hw job count:%d",
+		      __entry->entity, __entry->id, __entry->trace_id,
 		      __entry->fence, __entry->name,
 		      __entry->job_count, __entry->hw_job_count)
 );
 
+TRACE_EVENT(drm_sched_job_hw_fence,
+	    TP_PROTO(struct drm_sched_job *sched_job, struct dma_fence *fence),
+	    TP_ARGS(sched_job, fence),
+	    TP_STRUCT__entry(
+			     __field(const char *, name)
+			     __field(uint64_t, trace_id)
+			     __field(uint64_t, ctx)
+			     __field(unsigned, seqno)
+			     __field(uint64_t, hw_ctx)
+			     __field(unsigned, hw_seqno)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->name = sched_job->sched->name;
+			   __entry->trace_id = sched_job->trace_id;
+			   __entry->ctx = sched_job->s_fence->finished.context;
+			   __entry->seqno = sched_job->s_fence->finished.seqno;
+			   __entry->hw_ctx = fence->context;
+			   __entry->hw_seqno = fence->seqno;
+			   ),
+	    TP_printk("ring=%s, trace_id=%llu, finished context=%llu, seq=%u, hw fence context=%llu, seq=%u",
+		      __entry->name, __entry->trace_id, __entry->ctx,
+		      __entry->seqno, __entry->hw_ctx, __entry->hw_seqno)
+);
+
 TRACE_EVENT(drm_sched_process_job,
-	    TP_PROTO(struct drm_sched_fence *fence),
-	    TP_ARGS(fence),
+	    TP_PROTO(struct drm_sched_job *sched_job),
+	    TP_ARGS(sched_job),
 	    TP_STRUCT__entry(
 		    __field(struct dma_fence *, fence)
+		    __field(uint64_t, trace_id)
 		    ),
 
 	    TP_fast_assign(
-		    __entry->fence = &fence->finished;
+		    __entry->fence = &sched_job->s_fence->finished;
+		    __entry->trace_id = sched_job->trace_id;
 		    ),
-	    TP_printk("fence=%p signaled", __entry->fence)
+	    TP_printk("fence=%p, trace_id=%llu signaled", __entry->fence,
+		      __entry->trace_id)
 );
 
 TRACE_EVENT(drm_sched_job_wait_dep,
@@ -123,6 +179,57 @@ TRACE_EVENT(drm_sched_job_wait_dep,
 		      __entry->seqno)
 );
 
+TRACE_EVENT(drm_sched_job_dep_elided,
+	    TP_PROTO(struct drm_sched_job *sched_job,
+		     struct drm_gpu_scheduler *sched, struct dma_fence *fence,
+		     enum drm_sched_dep_elided reason),
+	    TP_ARGS(sched_job, sched, fence, reason),
+	    TP_STRUCT__entry(
+			     __field(const char *, name)
+			     __field(struct drm_sched_job *, job)
+			     __field(uint64_t, ctx)
+			     __field(unsigned, seqno)
+			     __field(int, reason)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->name = sched->name;
+			   __entry->job = sched_job;
+			   __entry->ctx = fence->context;
+			   __entry->seqno = fence->seqno;
+			   __entry->reason = reason;
+			   ),
+	    TP_printk("job ring=%s, job=%p, elided fence context=%llu, seq=%u, reason=%s",
+		      __entry->name, __entry->job, __entry->ctx, __entry->seqno,
+		      __print_symbolic(__entry->reason,
+				       { DRM_SCHED_DEP_SIGNALED, "signaled" },
+				       { DRM_SCHED_DEP_SAME_ENTITY, "same entity" },
+				       { DRM_SCHED_DEP_SAME_SCHED, "same scheduler" },
+				       { DRM_SCHED_DEP_MERGED, "merged" }))
+);
+
+TRACE_EVENT(drm_sched_job_deps_done,
+	    TP_PROTO(struct drm_sched_job *sched_job,
+		     struct drm_sched_entity *entity, ktime_t wait),
+	    TP_ARGS(sched_job, entity, wait),
+	    TP_STRUCT__entry(
+			     __field(struct drm_sched_entity *, entity)
+			     __field(const char *, name)
+			     __field(uint64_t, id)
+			     __field(s64, wait)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->entity = entity;
+			   __entry->name = sched_job->sched->name;
+			   __entry->id = sched_job->id;
+			   __entry->wait = ktime_to_ns(wait);
+			   ),
+	    TP_printk("entity=%p, id=%llu, ring=%s, dependency wait:%lldns",
+		      __entry->entity, __entry->id, __entry->name,
+		      __entry->wait)
+);
+
 #endif
 
 /* This part must be outside protection */
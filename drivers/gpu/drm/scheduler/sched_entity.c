@@ -33,6 +33,14 @@
 #define to_drm_sched_job(sched_job)		\
 		container_of((sched_job), struct drm_sched_job, queue_node)
 
+/* Default weight of an entity for each priority level */
+static const unsigned int drm_sched_prio_weight[DRM_SCHED_PRIORITY_COUNT] = {
+	[DRM_SCHED_PRIORITY_MIN]	= DRM_SCHED_WEIGHT_NORMAL / 2,
+	[DRM_SCHED_PRIORITY_NORMAL]	= DRM_SCHED_WEIGHT_NORMAL,
+	[DRM_SCHED_PRIORITY_HIGH]	= DRM_SCHED_WEIGHT_NORMAL * 2,
+	[DRM_SCHED_PRIORITY_KERNEL]	= DRM_SCHED_WEIGHT_NORMAL * 4,
+};
+
 /**
  * drm_sched_entity_init - Init a context entity used by scheduler when
  * submit to HW ring.
@@ -66,7 +74,17 @@ int drm_sched_entity_init(struct drm_sched_entity *entity,
 		return -EINVAL;
 
 	memset(entity, 0, sizeof(struct drm_sched_entity));
+
+	entity->stats = kzalloc(sizeof(*entity->stats), GFP_KERNEL);
+	if (!entity->stats)
+		return -ENOMEM;
+
+	kref_init(&entity->stats->kref);
+	spin_lock_init(&entity->stats->lock);
+	entity->stats->weight = drm_sched_prio_weight[priority];
+
 	INIT_LIST_HEAD(&entity->list);
+	RB_CLEAR_NODE(&entity->rb_tree_node);
 	entity->rq = NULL;
 	entity->guilty = guilty;
 	entity->num_sched_list = num_sched_list;
@@ -304,6 +322,9 @@ void drm_sched_entity_fini(struct drm_sched_entity *entity)
 
 	dma_fence_put(entity->last_scheduled);
 	entity->last_scheduled = NULL;
+
+	drm_sched_entity_stats_put(entity->stats);
+	entity->stats = NULL;
 }
 EXPORT_SYMBOL(drm_sched_entity_fini);
 
@@ -328,6 +349,9 @@ static void drm_sched_entity_clear_dep(struct dma_fence *f,
 	struct drm_sched_entity *entity =
 		container_of(cb, struct drm_sched_entity, cb);
 
+	entity->dep_wait = ktime_add(entity->dep_wait,
+				     ktime_sub(ktime_get(),
+					       entity->dep_wait_start));
 	entity->dependency = NULL;
 	dma_fence_put(f);
 }
@@ -360,9 +384,36 @@ void drm_sched_entity_set_priority(struct drm_sched_entity *entity,
 	spin_lock(&entity->rq_lock);
 	entity->priority = priority;
 	spin_unlock(&entity->rq_lock);
+
+	drm_sched_entity_set_weight(entity, drm_sched_prio_weight[priority]);
 }
 EXPORT_SYMBOL(drm_sched_entity_set_priority);
 
+/**
+ * drm_sched_entity_set_weight - Sets the fair share weight of the entity
+ *
+ * @entity: scheduler entity
+ * @weight: share of the GPU time relative to DRM_SCHED_WEIGHT_NORMAL
+ *
+ * Only used by schedulers with DRM_SCHED_POLICY_FAIR. An entity with twice
+ * the weight of another one in the same run queue gets twice the GPU time.
+ * The weight is reset to the priority default by
+ * drm_sched_entity_set_priority().
+ */
+void drm_sched_entity_set_weight(struct drm_sched_entity *entity,
+				 unsigned int weight)
+{
+	struct drm_sched_entity_stats *stats = entity->stats;
+
+	if (WARN_ON(!weight))
+		return;
+
+	spin_lock(&stats->lock);
+	stats->weight = weight;
+	spin_unlock(&stats->lock);
+}
+EXPORT_SYMBOL(drm_sched_entity_set_weight);
+
 /*
  * Add a callback to the current dependency of the entity to wake up the
  * scheduler when the entity becomes available.
@@ -373,6 +424,8 @@ static bool drm_sched_entity_add_dependency_cb(struct drm_sched_entity *entity)
 	struct dma_fence *fence = entity->dependency;
 	struct drm_sched_fence *s_fence;
 
+	entity->dep_wait_start = ktime_get();
+
 	if (fence->context == entity->fence_context ||
 	    fence->context == entity->fence_context + 1) {
 		/*
@@ -427,6 +480,13 @@ struct drm_sched_job *drm_sched_entity_pop_job(struct drm_sched_entity *entity)
 			return NULL;
 	}
 
+	trace_drm_sched_job_deps_done(sched_job, entity,
+				      ktime_sub(ktime_get(), sched_job->submit_ts));
+	sched_job->dep_wait = entity->dep_wait;
+	entity->dep_wait = 0;
+	if (sched_job->trace_sampled)
+		sched_job->deps_ts = ktime_get();
+
 	/* skip jobs from entity that marked guilty */
 	if (entity->guilty && atomic_read(entity->guilty))
 		dma_fence_set_error(&sched_job->s_fence->finished, -ECANCELED);
@@ -487,6 +547,25 @@ void drm_sched_entity_select_rq(struct drm_sched_entity *entity)
 		entity->sched_list = NULL;
 }
 
+/*
+ * Add the entity to its run queue and wake up the scheduler after the first
+ * job was pushed to an empty job queue.
+ */
+static void drm_sched_entity_push_first(struct drm_sched_entity *entity)
+{
+	/* Add the entity to the run queue */
+	spin_lock(&entity->rq_lock);
+	if (entity->stopped) {
+		spin_unlock(&entity->rq_lock);
+
+		DRM_ERROR("Trying to push to a killed entity\n");
+		return;
+	}
+	drm_sched_rq_add_entity(entity->rq, entity);
+	spin_unlock(&entity->rq_lock);
+	drm_sched_wakeup(entity->rq->sched);
+}
+
 /**
  * drm_sched_entity_push_job - Submit a job to the entity's job queue
  * @sched_job: job to submit
@@ -504,23 +583,72 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job)
 	bool first;
 
 	trace_drm_sched_job(sched_job, entity);
+	sched_job->submit_ts = ktime_get();
 	atomic_inc(entity->rq->sched->score);
 	WRITE_ONCE(entity->last_user, current->group_leader);
 	first = spsc_queue_push(&entity->job_queue, &sched_job->queue_node);
 
 	/* first job wakes up scheduler */
-	if (first) {
-		/* Add the entity to the run queue */
-		spin_lock(&entity->rq_lock);
-		if (entity->stopped) {
-			spin_unlock(&entity->rq_lock);
+	if (first)
+		drm_sched_entity_push_first(entity);
+}
+EXPORT_SYMBOL(drm_sched_entity_push_job);
+
+/**
+ * drm_sched_entity_push_jobs - Submit several jobs to the entity's job queue
+ * @jobs: array of jobs to submit
+ * @count: number of jobs in @jobs
+ *
+ * Same as calling drm_sched_entity_push_job() on every job in @jobs, but the
+ * jobs are added to the job queue with a single atomic operation and the
+ * scheduler is woken up at most once for the whole batch.
+ *
+ * All jobs must have been initialized for the same entity and armed with
+ * drm_sched_job_arm() in array order. Like for drm_sched_entity_push_job()
+ * arming and pushing must happen under a common lock for the entity, so that
+ * the order of the job queue matches the fence sequence numbers.
+ */
+void drm_sched_entity_push_jobs(struct drm_sched_job **jobs,
+				unsigned int count)
+{
+	struct drm_sched_entity *entity;
+	ktime_t start = 0;
+	unsigned int i;
+	bool first;
+
+	if (!count)
+		return;
 
-			DRM_ERROR("Trying to push to a killed entity\n");
+	entity = jobs[0]->entity;
+	for (i = 1; i < count; i++) {
+		if (WARN_ON(jobs[i]->entity != entity)) {
+			for (i = 0; i < count; i++)
+				drm_sched_entity_push_job(jobs[i]);
 			return;
 		}
-		drm_sched_rq_add_entity(entity->rq, entity);
-		spin_unlock(&entity->rq_lock);
-		drm_sched_wakeup(entity->rq->sched);
 	}
+
+	start = ktime_get();
+
+	for (i = 0; i < count; i++) {
+		trace_drm_sched_job(jobs[i], entity);
+		jobs[i]->submit_ts = start;
+		if (i + 1 < count)
+			jobs[i]->queue_node.next = &jobs[i + 1]->queue_node;
+	}
+
+	atomic_add(count, entity->rq->sched->score);
+	WRITE_ONCE(entity->last_user, current->group_leader);
+	first = spsc_queue_push_many(&entity->job_queue,
+				     &jobs[0]->queue_node,
+				     &jobs[count - 1]->queue_node, count);
+
+	/* first job wakes up scheduler */
+	if (first)
+		drm_sched_entity_push_first(entity);
+
+	if (trace_drm_sched_job_batch_enabled())
+		trace_drm_sched_job_batch(entity, count,
+					  ktime_sub(ktime_get(), start));
 }
-EXPORT_SYMBOL(drm_sched_entity_push_job);
+EXPORT_SYMBOL(drm_sched_entity_push_jobs);
@@ -42,13 +42,31 @@
  *    the hardware.
  *
  * The jobs in a entity are always scheduled in the order that they were pushed.
+ *
+ * Jobs are run and freed either by a kernel thread dedicated to the scheduler,
+ * or, when the driver passes a submit workqueue to drm_sched_init(), by a work
+ * item on that workqueue. The latter avoids one thread per ring and lets
+ * several rings share an ordered workqueue; every invocation of the work item
+ * frees all completed jobs and runs a batch of ready ones.
+ *
+ * By default the entities of a run queue are served round robin. A driver can
+ * instead ask for DRM_SCHED_POLICY_FAIR at drm_sched_init() time, in which case
+ * every run queue keeps its entities in a rbtree sorted by their virtual
+ * runtime: the GPU time used by the entity's jobs, measured from the scheduled
+ * and finished fence timestamps and scaled by the weight of the entity. The
+ * ready entity with the lowest virtual runtime is picked next.
  */
 
 #include <linux/kthread.h>
 #include <linux/wait.h>
 #include <linux/sched.h>
 #include <linux/completion.h>
+#include <linux/debugfs.h>
 #include <linux/dma-resv.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 #include <uapi/linux/sched/types.h>
 
 #include <drm/drm_print.h>
@@ -62,6 +80,211 @@
 #define to_drm_sched_job(sched_job)		\
 		container_of((sched_job), struct drm_sched_job, queue_node)
 
+/* Maximum number of jobs run by one invocation of the submit work item */
+#define DRM_SCHED_SUBMIT_BATCH	16
+
+static int drm_sched_policy = DRM_SCHED_POLICY_RR;
+
+MODULE_PARM_DESC(sched_policy, "Default entity selection policy (1 = round robin (default), 2 = fair)");
+module_param_named(sched_policy, drm_sched_policy, int, 0444);
+
+static unsigned int drm_sched_trace_sample;
+
+MODULE_PARM_DESC(trace_sample, "Record the stage timestamps of one in N jobs in the trace ring of their scheduler (0 = off (default))");
+module_param_named(trace_sample, drm_sched_trace_sample, uint, 0644);
+
+/* Source of &drm_sched_job.trace_id, shared by all schedulers */
+static atomic64_t drm_sched_trace_id_count = ATOMIC64_INIT(0);
+
+#define to_drm_sched_entity(node)		\
+		rb_entry((node), struct drm_sched_entity, rb_tree_node)
+
+static bool drm_sched_entity_less(struct rb_node *a, const struct rb_node *b)
+{
+	return to_drm_sched_entity(a)->vruntime <
+	       to_drm_sched_entity(b)->vruntime;
+}
+
+/*
+ * Scale @delta nanoseconds of GPU time by the weight of the entity owning
+ * @stats. Must be called with &drm_sched_entity_stats.lock held.
+ */
+static s64 drm_sched_stats_scale(struct drm_sched_entity_stats *stats,
+				 s64 delta)
+{
+	return div_s64(delta * DRM_SCHED_WEIGHT_NORMAL, stats->weight);
+}
+
+static void drm_sched_rq_insert_fair(struct drm_sched_rq *rq,
+				     struct drm_sched_entity *entity)
+{
+	struct drm_sched_entity_stats *stats = entity->stats;
+
+	/*
+	 * Don't let entities which were idle for a while catch up on the time
+	 * they didn't use, start them at the front of the queue instead.
+	 */
+	spin_lock(&stats->lock);
+	if ((s64)(stats->vruntime - rq->min_vruntime) < 0)
+		stats->vruntime = rq->min_vruntime;
+	entity->vruntime = stats->vruntime;
+	spin_unlock(&stats->lock);
+
+	rb_add_cached(&entity->rb_tree_node, &rq->rb_tree_root,
+		      drm_sched_entity_less);
+}
+
+static void drm_sched_rq_erase_fair(struct drm_sched_rq *rq,
+				    struct drm_sched_entity *entity)
+{
+	if (RB_EMPTY_NODE(&entity->rb_tree_node))
+		return;
+
+	rb_erase_cached(&entity->rb_tree_node, &rq->rb_tree_root);
+	RB_CLEAR_NODE(&entity->rb_tree_node);
+}
+
+/**
+ * drm_sched_rq_update_fair - charge a job to its entity
+ *
+ * @entity: scheduler entity the job was popped from
+ * @job: the job which is about to be run
+ *
+ * With DRM_SCHED_POLICY_FAIR this charges the expected runtime of @job to
+ * @entity and moves the entity to its new position in the run queue. The
+ * estimate is replaced with the real runtime once the job has completed.
+ */
+static void drm_sched_rq_update_fair(struct drm_sched_entity *entity,
+				     struct drm_sched_job *job)
+{
+	struct drm_sched_entity_stats *stats = job->entity_stats;
+	struct drm_sched_rq *rq = entity->rq;
+	struct rb_node *first;
+
+	if (!rq || rq->sched->policy != DRM_SCHED_POLICY_FAIR || !stats)
+		return;
+
+	spin_lock(&stats->lock);
+	job->fair_charge = stats->avg_runtime;
+	stats->vruntime += drm_sched_stats_scale(stats, job->fair_charge);
+	spin_unlock(&stats->lock);
+
+	spin_lock(&rq->lock);
+	if (!RB_EMPTY_NODE(&entity->rb_tree_node)) {
+		drm_sched_rq_erase_fair(rq, entity);
+		drm_sched_rq_insert_fair(rq, entity);
+	}
+
+	first = rb_first_cached(&rq->rb_tree_root);
+	if (first)
+		rq->min_vruntime = to_drm_sched_entity(first)->vruntime;
+	spin_unlock(&rq->lock);
+}
+
+static unsigned int drm_sched_hist_bucket(ktime_t delta)
+{
+	s64 us = ktime_to_us(delta);
+
+	if (us <= 0)
+		return 0;
+
+	return min_t(unsigned int, fls64(us), DRM_SCHED_HIST_BUCKETS - 1);
+}
+
+/*
+ * Add a job latency to the per-cpu histogram of the scheduler and to the
+ * histogram of the entity owning @stats.
+ */
+static void drm_sched_hist_add(struct drm_gpu_scheduler *sched,
+			       struct drm_sched_entity_stats *stats,
+			       enum drm_sched_hist_type type, ktime_t delta)
+{
+	unsigned int bucket = drm_sched_hist_bucket(delta);
+
+	if (sched->hist)
+		this_cpu_inc(sched->hist->buckets[type][bucket]);
+
+	if (stats) {
+		spin_lock(&stats->lock);
+		stats->hist.buckets[type][bucket]++;
+		spin_unlock(&stats->lock);
+	}
+}
+
+/*
+ * Account the runtime of a completed job to the statistics of its entity.
+ * The job must have been removed from the pending list already.
+ */
+static void drm_sched_job_account(struct drm_sched_job *job)
+{
+	struct drm_sched_entity_stats *stats = job->entity_stats;
+	struct drm_sched_fence *s_fence = job->s_fence;
+	s64 runtime;
+
+	if (!stats)
+		return;
+
+	runtime = ktime_to_ns(ktime_sub(s_fence->finished.timestamp,
+					s_fence->scheduled.timestamp));
+	if (runtime < 0)
+		runtime = 0;
+
+	drm_sched_hist_add(job->sched, NULL, DRM_SCHED_HIST_EXEC,
+			   ns_to_ktime(runtime));
+
+	spin_lock(&stats->lock);
+	stats->runtime += runtime;
+	stats->hist.buckets[DRM_SCHED_HIST_EXEC]
+			   [drm_sched_hist_bucket(ns_to_ktime(runtime))]++;
+	stats->vruntime += drm_sched_stats_scale(stats,
+						 runtime - (s64)job->fair_charge);
+	/* Moving average over the last 8 jobs */
+	if (stats->avg_runtime)
+		stats->avg_runtime = stats->avg_runtime -
+				     (stats->avg_runtime >> 3) + (runtime >> 3);
+	else
+		stats->avg_runtime = runtime;
+	job->fair_charge = 0;
+	spin_unlock(&stats->lock);
+}
+
+static void drm_sched_entity_stats_release(struct kref *kref)
+{
+	struct drm_sched_entity_stats *stats =
+		container_of(kref, typeof(*stats), kref);
+
+	kfree(stats);
+}
+
+/**
+ * drm_sched_entity_stats_put - drop a reference to entity statistics
+ *
+ * @stats: the statistics to release, may be NULL
+ */
+void drm_sched_entity_stats_put(struct drm_sched_entity_stats *stats)
+{
+	if (stats)
+		kref_put(&stats->kref, drm_sched_entity_stats_release);
+}
+
+/**
+ * drm_sched_kick - wake up the worker of a scheduler
+ *
+ * @sched: scheduler instance
+ *
+ * Queue the submit work or wake up the scheduler thread, depending on which
+ * one the scheduler is using.
+ */
+static void drm_sched_kick(struct drm_gpu_scheduler *sched)
+{
+	if (sched->submit_wq) {
+		if (!READ_ONCE(sched->pause_submit))
+			queue_work(sched->submit_wq, &sched->work_submit);
+	} else {
+		wake_up_interruptible(&sched->wake_up_worker);
+	}
+}
+
 /**
  * drm_sched_rq_init - initialize a given run queue struct
  *
@@ -75,6 +298,8 @@ static void drm_sched_rq_init(struct drm_gpu_scheduler *sched,
 {
 	spin_lock_init(&rq->lock);
 	INIT_LIST_HEAD(&rq->entities);
+	rq->rb_tree_root = RB_ROOT_CACHED;
+	rq->min_vruntime = 0;
 	rq->current_entity = NULL;
 	rq->sched = sched;
 }
@@ -95,6 +320,8 @@ void drm_sched_rq_add_entity(struct drm_sched_rq *rq,
 	spin_lock(&rq->lock);
 	atomic_inc(rq->sched->score);
 	list_add_tail(&entity->list, &rq->entities);
+	if (rq->sched->policy == DRM_SCHED_POLICY_FAIR)
+		drm_sched_rq_insert_fair(rq, entity);
 	spin_unlock(&rq->lock);
 }
 
@@ -114,6 +341,7 @@ void drm_sched_rq_remove_entity(struct drm_sched_rq *rq,
 	spin_lock(&rq->lock);
 	atomic_dec(rq->sched->score);
 	list_del_init(&entity->list);
+	drm_sched_rq_erase_fair(rq, entity);
 	if (rq->current_entity == entity)
 		rq->current_entity = NULL;
 	spin_unlock(&rq->lock);
@@ -163,6 +391,76 @@ drm_sched_rq_select_entity(struct drm_sched_rq *rq)
 	return NULL;
 }
 
+/**
+ * drm_sched_rq_select_entity_fair - Select the ready entity with the lowest
+ * virtual runtime
+ *
+ * @rq: scheduler run queue to check.
+ *
+ * Try to find a ready entity, returns NULL if none found.
+ */
+static struct drm_sched_entity *
+drm_sched_rq_select_entity_fair(struct drm_sched_rq *rq)
+{
+	struct drm_sched_entity *entity;
+	struct rb_node *rb;
+
+	spin_lock(&rq->lock);
+	for (rb = rb_first_cached(&rq->rb_tree_root); rb; rb = rb_next(rb)) {
+		entity = to_drm_sched_entity(rb);
+
+		if (drm_sched_entity_is_ready(entity)) {
+			rq->current_entity = entity;
+			reinit_completion(&entity->entity_idle);
+			spin_unlock(&rq->lock);
+			return entity;
+		}
+	}
+	spin_unlock(&rq->lock);
+
+	return NULL;
+}
+
+static ktime_t drm_sched_fence_timestamp(struct dma_fence *fence)
+{
+	if (!fence || !test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &fence->flags))
+		return 0;
+
+	return fence->timestamp;
+}
+
+/*
+ * Copy the stage timestamps of a completed sampled job into the trace ring of
+ * the scheduler, overwriting the oldest record once the ring is full.
+ */
+static void drm_sched_trace_record(struct drm_gpu_scheduler *sched,
+				   struct drm_sched_job *job)
+{
+	struct drm_sched_fence *s_fence = job->s_fence;
+	struct dma_fence *parent = s_fence->parent;
+	struct drm_sched_trace_record *rec;
+
+	if (!sched->trace_ring)
+		return;
+
+	spin_lock(&sched->trace_lock);
+	rec = &sched->trace_ring[sched->trace_head++ % DRM_SCHED_TRACE_RING_SIZE];
+	rec->trace_id = job->trace_id;
+	rec->id = job->id;
+	rec->context = s_fence->finished.context;
+	rec->seqno = s_fence->finished.seqno;
+	rec->hw_context = parent ? parent->context : 0;
+	rec->hw_seqno = parent ? parent->seqno : 0;
+	rec->init = job->init_ts;
+	rec->push = job->submit_ts;
+	rec->deps_done = job->deps_ts;
+	rec->run = drm_sched_fence_timestamp(&s_fence->scheduled);
+	rec->hw_done = drm_sched_fence_timestamp(parent);
+	rec->finished = drm_sched_fence_timestamp(&s_fence->finished);
+	rec->error = s_fence->finished.error;
+	spin_unlock(&sched->trace_lock);
+}
+
 /**
  * drm_sched_job_done - complete a job
  * @s_job: pointer to the job which is done
@@ -177,12 +475,12 @@ static void drm_sched_job_done(struct drm_sched_job *s_job)
 	atomic_dec(&sched->hw_rq_count);
 	atomic_dec(sched->score);
 
-	trace_drm_sched_process_job(s_fence);
+	trace_drm_sched_process_job(s_job);
 
 	dma_fence_get(&s_fence->finished);
 	drm_sched_fence_finished(s_fence);
 	dma_fence_put(&s_fence->finished);
-	wake_up_interruptible(&sched->wake_up_worker);
+	drm_sched_kick(sched);
 }
 
 /**
@@ -328,8 +626,8 @@ static void drm_sched_job_timedout(struct work_struct *work)
 	if (job) {
 		/*
 		 * Remove the bad job so it cannot be freed by concurrent
-		 * drm_sched_cleanup_jobs. It will be reinserted back after sched->thread
-		 * is parked at which point it's safe.
+		 * drm_sched_cleanup_jobs. It will be reinserted back after the
+		 * scheduler worker is stopped at which point it's safe.
 		 */
 		list_del_init(&job->list);
 		spin_unlock(&sched->job_list_lock);
@@ -392,7 +690,7 @@ void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad)
 {
 	struct drm_sched_job *s_job, *tmp;
 
-	kthread_park(sched->thread);
+	drm_sched_wqueue_stop(sched);
 
 	/*
 	 * Reinsert back the bad job here - now it's safe as
@@ -460,6 +758,66 @@ void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad)
 
 EXPORT_SYMBOL(drm_sched_stop);
 
+/**
+ * drm_sched_entity_recover - recover from the hang of a single entity
+ *
+ * @bad: job which caused the time out
+ * @error: error for the fences of the entity's jobs, e.g. -ETIME
+ *
+ * For hardware which can reset a single queue, or kill the work of a single
+ * context while the rest of the ring keeps executing. Drivers call this from
+ * their &drm_sched_backend_ops.timedout_job callback once the hardware dropped
+ * the work of @bad, instead of drm_sched_stop(), drm_sched_resubmit_jobs() and
+ * drm_sched_start().
+ *
+ * The entity of @bad is marked guilty, so its jobs still queued are cancelled
+ * as they are dequeued, and its jobs already handed to the hardware get @error
+ * set on their finished fences. Jobs of other entities keep their hardware
+ * fence callbacks and are neither stopped nor resubmitted.
+ *
+ * @bad is put back on the pending list and freed as usual once its hardware
+ * fence signals.
+ *
+ * Returns the number of pending jobs which got @error.
+ */
+int drm_sched_entity_recover(struct drm_sched_job *bad, int error)
+{
+	struct drm_gpu_scheduler *sched = bad->sched;
+	u64 context = bad->s_fence->scheduled.context;
+	struct drm_sched_job *s_job;
+	int count = 0;
+
+	drm_sched_increase_karma(bad);
+
+	spin_lock(&sched->job_list_lock);
+	/* drm_sched_job_timedout() took it off the list */
+	if (list_empty(&bad->list))
+		list_add(&bad->list, &sched->pending_list);
+
+	list_for_each_entry(s_job, &sched->pending_list, list) {
+		struct dma_fence *finished = &s_job->s_fence->finished;
+		unsigned long flags;
+
+		if (s_job->s_fence->scheduled.context != context)
+			continue;
+
+		/* the hardware fence callback may signal it concurrently */
+		spin_lock_irqsave(finished->lock, flags);
+		if (!test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &finished->flags)) {
+			dma_fence_set_error(finished, error);
+			count++;
+		}
+		spin_unlock_irqrestore(finished->lock, flags);
+	}
+	spin_unlock(&sched->job_list_lock);
+
+	/* @bad may have signaled while it was off the list, clean it up */
+	drm_sched_kick(sched);
+
+	return count;
+}
+EXPORT_SYMBOL(drm_sched_entity_recover);
+
 /**
  * drm_sched_start - recover jobs after a reset
  *
@@ -503,7 +861,7 @@ void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery)
 		spin_unlock(&sched->job_list_lock);
 	}
 
-	kthread_unpark(sched->thread);
+	drm_sched_wqueue_start(sched);
 }
 EXPORT_SYMBOL(drm_sched_start);
 
@@ -576,6 +934,10 @@ EXPORT_SYMBOL(drm_sched_resubmit_jobs_ext);
  * Drivers must make sure drm_sched_job_cleanup() if this function returns
  * successfully, even when @job is aborted before drm_sched_job_arm() is called.
  *
+ * This also assigns &drm_sched_job.trace_id, which the scheduler tracepoints
+ * carry from here until the job signals. Drivers should include it in the
+ * tracepoints of their submit ioctl so that a job can be followed end to end.
+ *
  * WARNING: amdgpu abuses &drm_sched.ready to signal when the hardware
  * has died, which can mean that there's no valid runqueue for a @entity.
  * This function returns -ENOENT in this case (which probably should be -EIO as
@@ -587,6 +949,8 @@ int drm_sched_job_init(struct drm_sched_job *job,
 		       struct drm_sched_entity *entity,
 		       void *owner)
 {
+	unsigned int sample;
+
 	drm_sched_entity_select_rq(entity);
 	if (!entity->rq)
 		return -ENOENT;
@@ -597,6 +961,14 @@ int drm_sched_job_init(struct drm_sched_job *job,
 		return -ENOMEM;
 
 	INIT_LIST_HEAD(&job->list);
+	job->entity_stats = NULL;
+	job->fair_charge = 0;
+
+	job->trace_id = atomic64_inc_return(&drm_sched_trace_id_count);
+	sample = READ_ONCE(drm_sched_trace_sample);
+	job->trace_sampled = sample && !((u32)job->trace_id % sample);
+	job->init_ts = job->trace_sampled ? ktime_get() : 0;
+	job->deps_ts = 0;
 
 	xa_init_flags(&job->dependencies, XA_FLAGS_ALLOC);
 
@@ -629,16 +1001,86 @@ void drm_sched_job_arm(struct drm_sched_job *job)
 	job->sched = sched;
 	job->s_priority = entity->rq - sched->sched_rq;
 	job->id = atomic64_inc_return(&sched->job_id_count);
+	job->entity_stats = entity->stats;
+	kref_get(&job->entity_stats->kref);
 
 	drm_sched_fence_init(job->s_fence, job->entity);
 }
 EXPORT_SYMBOL(drm_sched_job_arm);
 
+static void drm_sched_job_elide_dependency(struct drm_sched_job *job,
+					   struct dma_fence *fence,
+					   enum drm_sched_dep_elided reason)
+{
+	struct drm_gpu_scheduler *sched = job->entity->rq->sched;
+
+	trace_drm_sched_job_dep_elided(job, sched, fence, reason);
+	atomic64_inc(&sched->deps_elided[reason]);
+	dma_fence_put(fence);
+}
+
+/*
+ * Drop dependencies which are already guaranteed by the execution order. This
+ * does the same checks as drm_sched_entity_add_dependency_cb() does when the
+ * job is about to run, but before the fence ever ends up in the dependency
+ * array. Returns the fence to wait for, or NULL if there is none.
+ */
+static struct dma_fence *
+drm_sched_job_prune_dependency(struct drm_sched_job *job,
+			       struct dma_fence *fence)
+{
+	struct drm_sched_entity *entity = job->entity;
+	struct drm_sched_fence *s_fence;
+
+	if (dma_fence_is_signaled(fence)) {
+		drm_sched_job_elide_dependency(job, fence,
+					       DRM_SCHED_DEP_SIGNALED);
+		return NULL;
+	}
+
+	/* Jobs of an entity always run in submission order */
+	if (fence->context == entity->fence_context ||
+	    fence->context == entity->fence_context + 1) {
+		drm_sched_job_elide_dependency(job, fence,
+					       DRM_SCHED_DEP_SAME_ENTITY);
+		return NULL;
+	}
+
+	/*
+	 * The hardware queue executes jobs in order as well, so waiting for a
+	 * job of the same scheduler to be scheduled is enough. This is only
+	 * known for entities which can't move to another scheduler anymore.
+	 */
+	s_fence = to_drm_sched_fence(fence);
+	if (entity->sched_list || !s_fence ||
+	    s_fence->sched != entity->rq->sched)
+		return fence;
+
+	if (fence != &s_fence->scheduled) {
+		struct dma_fence *scheduled = dma_fence_get(&s_fence->scheduled);
+
+		dma_fence_put(fence);
+		fence = scheduled;
+	}
+
+	if (dma_fence_is_signaled(fence)) {
+		drm_sched_job_elide_dependency(job, fence,
+					       DRM_SCHED_DEP_SAME_SCHED);
+		return NULL;
+	}
+
+	return fence;
+}
+
 /**
  * drm_sched_job_add_dependency - adds the fence as a job dependency
  * @job: scheduler job to add the dependencies to
  * @fence: the dma_fence to add to the list of dependencies.
  *
+ * Fences which are already signaled or whose ordering is guaranteed by the
+ * scheduler, like fences of earlier jobs of the same entity, are dropped right
+ * away. At most one fence per fence context is kept.
+ *
  * Note that @fence is consumed in both the success and error cases.
  *
  * Returns:
@@ -652,6 +1094,10 @@ int drm_sched_job_add_dependency(struct drm_sched_job *job,
 	u32 id = 0;
 	int ret;
 
+	if (!fence)
+		return 0;
+
+	fence = drm_sched_job_prune_dependency(job, fence);
 	if (!fence)
 		return 0;
 
@@ -664,10 +1110,12 @@ int drm_sched_job_add_dependency(struct drm_sched_job *job,
 			continue;
 
 		if (dma_fence_is_later(fence, entry)) {
-			dma_fence_put(entry);
 			xa_store(&job->dependencies, index, fence, GFP_KERNEL);
+			drm_sched_job_elide_dependency(job, entry,
+						       DRM_SCHED_DEP_MERGED);
 		} else {
-			dma_fence_put(fence);
+			drm_sched_job_elide_dependency(job, fence,
+						       DRM_SCHED_DEP_MERGED);
 		}
 		return 0;
 	}
@@ -745,6 +1193,9 @@ void drm_sched_job_cleanup(struct drm_sched_job *job)
 
 	job->s_fence = NULL;
 
+	drm_sched_entity_stats_put(job->entity_stats);
+	job->entity_stats = NULL;
+
 	xa_for_each(&job->dependencies, index, fence) {
 		dma_fence_put(fence);
 	}
@@ -775,9 +1226,61 @@ static bool drm_sched_ready(struct drm_gpu_scheduler *sched)
 void drm_sched_wakeup(struct drm_gpu_scheduler *sched)
 {
 	if (drm_sched_ready(sched))
-		wake_up_interruptible(&sched->wake_up_worker);
+		drm_sched_kick(sched);
 }
 
+/**
+ * drm_sched_wqueue_ready - is the scheduler worker set up
+ *
+ * @sched: scheduler instance
+ *
+ * Returns true if either the scheduler thread or the submit work of @sched has
+ * been set up by drm_sched_init().
+ */
+bool drm_sched_wqueue_ready(struct drm_gpu_scheduler *sched)
+{
+	return sched->submit_wq || sched->thread;
+}
+EXPORT_SYMBOL(drm_sched_wqueue_ready);
+
+/**
+ * drm_sched_wqueue_stop - stop running new jobs
+ *
+ * @sched: scheduler instance
+ *
+ * Park the scheduler thread, or wait for the submit work to finish and
+ * prevent it from being queued again. When this returns no job of @sched is
+ * being run or freed until drm_sched_wqueue_start() is called.
+ */
+void drm_sched_wqueue_stop(struct drm_gpu_scheduler *sched)
+{
+	if (sched->submit_wq) {
+		WRITE_ONCE(sched->pause_submit, true);
+		cancel_work_sync(&sched->work_submit);
+	} else {
+		kthread_park(sched->thread);
+	}
+}
+EXPORT_SYMBOL(drm_sched_wqueue_stop);
+
+/**
+ * drm_sched_wqueue_start - resume running jobs
+ *
+ * @sched: scheduler instance
+ *
+ * Counterpart of drm_sched_wqueue_stop().
+ */
+void drm_sched_wqueue_start(struct drm_gpu_scheduler *sched)
+{
+	if (sched->submit_wq) {
+		WRITE_ONCE(sched->pause_submit, false);
+		queue_work(sched->submit_wq, &sched->work_submit);
+	} else {
+		kthread_unpark(sched->thread);
+	}
+}
+EXPORT_SYMBOL(drm_sched_wqueue_start);
+
 /**
  * drm_sched_select_entity - Select next entity to process
  *
@@ -796,7 +1299,10 @@ drm_sched_select_entity(struct drm_gpu_scheduler *sched)
 
 	/* Kernel run queue has higher priority than normal run queue*/
 	for (i = DRM_SCHED_PRIORITY_COUNT - 1; i >= DRM_SCHED_PRIORITY_MIN; i--) {
-		entity = drm_sched_rq_select_entity(&sched->sched_rq[i]);
+		if (sched->policy == DRM_SCHED_POLICY_FAIR)
+			entity = drm_sched_rq_select_entity_fair(&sched->sched_rq[i]);
+		else
+			entity = drm_sched_rq_select_entity(&sched->sched_rq[i]);
 		if (entity)
 			break;
 	}
@@ -900,6 +1406,116 @@ static bool drm_sched_blocked(struct drm_gpu_scheduler *sched)
 	return false;
 }
 
+/**
+ * drm_sched_run_entity - run the next job of an entity
+ *
+ * @sched: scheduler instance
+ * @entity: entity returned by drm_sched_select_entity()
+ *
+ * Returns true if a job was handed to the hardware, false if @entity had no
+ * job ready after all.
+ */
+static bool drm_sched_run_entity(struct drm_gpu_scheduler *sched,
+				 struct drm_sched_entity *entity)
+{
+	struct drm_sched_fence *s_fence;
+	struct drm_sched_job *sched_job;
+	struct dma_fence *fence;
+	int r;
+
+	sched_job = drm_sched_entity_pop_job(entity);
+
+	if (!sched_job) {
+		complete(&entity->entity_idle);
+		return false;
+	}
+
+	s_fence = sched_job->s_fence;
+
+	drm_sched_rq_update_fair(entity, sched_job);
+	drm_sched_hist_add(sched, sched_job->entity_stats, DRM_SCHED_HIST_QUEUE,
+			   ktime_sub(ktime_get(), sched_job->submit_ts));
+	drm_sched_hist_add(sched, sched_job->entity_stats,
+			   DRM_SCHED_HIST_DEPENDENCY, sched_job->dep_wait);
+
+	atomic_inc(&sched->hw_rq_count);
+	drm_sched_job_begin(sched_job);
+
+	trace_drm_run_job(sched_job, entity);
+	fence = sched->ops->run_job(sched_job);
+	complete(&entity->entity_idle);
+	drm_sched_fence_scheduled(s_fence);
+
+	if (!IS_ERR_OR_NULL(fence)) {
+		s_fence->parent = dma_fence_get(fence);
+		trace_drm_sched_job_hw_fence(sched_job, fence);
+		r = dma_fence_add_callback(fence, &sched_job->cb,
+					   drm_sched_job_done_cb);
+		if (r == -ENOENT)
+			drm_sched_job_done(sched_job);
+		else if (r)
+			DRM_ERROR("fence add callback failed (%d)\n",
+				  r);
+		dma_fence_put(fence);
+	} else {
+		if (IS_ERR(fence))
+			dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
+
+		drm_sched_job_done(sched_job);
+	}
+
+	wake_up(&sched->job_scheduled);
+	return true;
+}
+
+/**
+ * drm_sched_free_job - account and free a completed job
+ *
+ * @sched: scheduler instance
+ * @job: job returned by drm_sched_get_cleanup_job()
+ */
+static void drm_sched_free_job(struct drm_gpu_scheduler *sched,
+			       struct drm_sched_job *job)
+{
+	drm_sched_job_account(job);
+	if (job->trace_sampled)
+		drm_sched_trace_record(sched, job);
+	sched->ops->free_job(job);
+}
+
+/**
+ * drm_sched_submit_work - submit work item
+ *
+ * @w: submit work item
+ *
+ * Frees all completed jobs and runs up to DRM_SCHED_SUBMIT_BATCH ready jobs,
+ * requeueing itself if more could be ready.
+ */
+static void drm_sched_submit_work(struct work_struct *w)
+{
+	struct drm_gpu_scheduler *sched =
+		container_of(w, struct drm_gpu_scheduler, work_submit);
+	struct drm_sched_entity *entity;
+	struct drm_sched_job *cleanup_job;
+	unsigned int batch = 0;
+
+	if (READ_ONCE(sched->pause_submit))
+		return;
+
+	while ((cleanup_job = drm_sched_get_cleanup_job(sched)))
+		drm_sched_free_job(sched, cleanup_job);
+
+	while (batch < DRM_SCHED_SUBMIT_BATCH &&
+	       !READ_ONCE(sched->pause_submit) &&
+	       (entity = drm_sched_select_entity(sched))) {
+		drm_sched_run_entity(sched, entity);
+		batch++;
+	}
+
+	if (batch == DRM_SCHED_SUBMIT_BATCH)
+		drm_sched_kick(sched);
+}
+
 /**
  * drm_sched_main - main scheduler thread
  *
@@ -910,15 +1526,11 @@ static bool drm_sched_blocked(struct drm_gpu_scheduler *sched)
 static int drm_sched_main(void *param)
 {
 	struct drm_gpu_scheduler *sched = (struct drm_gpu_scheduler *)param;
-	int r;
 
 	sched_set_fifo_low(current);
 
 	while (!kthread_should_stop()) {
 		struct drm_sched_entity *entity = NULL;
-		struct drm_sched_fence *s_fence;
-		struct drm_sched_job *sched_job;
-		struct dma_fence *fence;
 		struct drm_sched_job *cleanup_job = NULL;
 
 		wait_event_interruptible(sched->wake_up_worker,
@@ -928,46 +1540,12 @@ static int drm_sched_main(void *param)
 					 kthread_should_stop());
 
 		if (cleanup_job)
-			sched->ops->free_job(cleanup_job);
+			drm_sched_free_job(sched, cleanup_job);
 
 		if (!entity)
 			continue;
 
-		sched_job = drm_sched_entity_pop_job(entity);
-
-		if (!sched_job) {
-			complete(&entity->entity_idle);
-			continue;
-		}
-
-		s_fence = sched_job->s_fence;
-
-		atomic_inc(&sched->hw_rq_count);
-		drm_sched_job_begin(sched_job);
-
-		trace_drm_run_job(sched_job, entity);
-		fence = sched->ops->run_job(sched_job);
-		complete(&entity->entity_idle);
-		drm_sched_fence_scheduled(s_fence);
-
-		if (!IS_ERR_OR_NULL(fence)) {
-			s_fence->parent = dma_fence_get(fence);
-			r = dma_fence_add_callback(fence, &sched_job->cb,
-						   drm_sched_job_done_cb);
-			if (r == -ENOENT)
-				drm_sched_job_done(sched_job);
-			else if (r)
-				DRM_ERROR("fence add callback failed (%d)\n",
-					  r);
-			dma_fence_put(fence);
-		} else {
-			if (IS_ERR(fence))
-				dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
-
-			drm_sched_job_done(sched_job);
-		}
-
-		wake_up(&sched->job_scheduled);
+		drm_sched_run_entity(sched, entity);
 	}
 	return 0;
 }
@@ -977,6 +1555,9 @@ static int drm_sched_main(void *param)
  *
  * @sched: scheduler instance
  * @ops: backend operations for this scheduler
+ * @submit_wq: workqueue to run and free jobs on. If NULL, the scheduler gets its
+ *	       own kernel thread instead. Must be ordered if it is shared with
+ *	       other schedulers which have to run jobs in submission order.
  * @hw_submission: number of hw submissions that can be in flight
  * @hang_limit: number of times to allow a job to hang before dropping it
  * @timeout: timeout value in jiffies for the scheduler
@@ -984,17 +1565,30 @@ static int drm_sched_main(void *param)
  *		used
  * @score: optional score atomic shared with other schedulers
  * @name: name used for debugging
+ * @policy: entity selection policy, DRM_SCHED_POLICY_DEFAULT to use the one
+ *	    selected by the sched_policy module parameter
  *
  * Return 0 on success, otherwise error code.
  */
 int drm_sched_init(struct drm_gpu_scheduler *sched,
 		   const struct drm_sched_backend_ops *ops,
+		   struct workqueue_struct *submit_wq,
 		   unsigned hw_submission, unsigned hang_limit,
 		   long timeout, struct workqueue_struct *timeout_wq,
-		   atomic_t *score, const char *name)
+		   atomic_t *score, const char *name,
+		   enum drm_sched_policy policy)
 {
 	int i, ret;
+
+	if (policy >= DRM_SCHED_POLICY_COUNT)
+		return -EINVAL;
+
+	if (policy == DRM_SCHED_POLICY_DEFAULT)
+		policy = drm_sched_policy == DRM_SCHED_POLICY_FAIR ?
+			 DRM_SCHED_POLICY_FAIR : DRM_SCHED_POLICY_RR;
+
 	sched->ops = ops;
+	sched->policy = policy;
 	sched->hw_submission_limit = hw_submission;
 	sched->name = name;
 	sched->timeout = timeout;
@@ -1012,12 +1606,35 @@ int drm_sched_init(struct drm_gpu_scheduler *sched,
 	INIT_DELAYED_WORK(&sched->work_tdr, drm_sched_job_timedout);
 	atomic_set(&sched->_score, 0);
 	atomic64_set(&sched->job_id_count, 0);
+	for (i = 0; i < DRM_SCHED_DEP_ELIDED_COUNT; i++)
+		atomic64_set(&sched->deps_elided[i], 0);
+
+	/* The histograms are only statistics, work without them if needed */
+	sched->hist = alloc_percpu(struct drm_sched_hist);
+	sched->trace_ring = kcalloc(DRM_SCHED_TRACE_RING_SIZE,
+				    sizeof(*sched->trace_ring), GFP_KERNEL);
+	sched->trace_head = 0;
+	spin_lock_init(&sched->trace_lock);
+
+	if (submit_wq) {
+		sched->submit_wq = submit_wq;
+		sched->thread = NULL;
+		sched->pause_submit = false;
+		INIT_WORK(&sched->work_submit, drm_sched_submit_work);
+		sched->ready = true;
+		return 0;
+	}
 
-	/* Each scheduler will run on a seperate kernel thread */
+	/* Otherwise each scheduler will run on a seperate kernel thread */
+	sched->submit_wq = NULL;
 	sched->thread = kthread_run(drm_sched_main, sched, sched->name);
 	if (IS_ERR(sched->thread)) {
 		ret = PTR_ERR(sched->thread);
 		sched->thread = NULL;
+		free_percpu(sched->hist);
+		sched->hist = NULL;
+		kfree(sched->trace_ring);
+		sched->trace_ring = NULL;
 		DRM_ERROR("Failed to create scheduler for %s.\n", name);
 		return ret;
 	}
@@ -1039,8 +1656,12 @@ void drm_sched_fini(struct drm_gpu_scheduler *sched)
 	struct drm_sched_entity *s_entity;
 	int i;
 
-	if (sched->thread)
+	if (sched->submit_wq) {
+		WRITE_ONCE(sched->pause_submit, true);
+		cancel_work_sync(&sched->work_submit);
+	} else if (sched->thread) {
 		kthread_stop(sched->thread);
+	}
 
 	for (i = DRM_SCHED_PRIORITY_COUNT - 1; i >= DRM_SCHED_PRIORITY_MIN; i--) {
 		struct drm_sched_rq *rq = &sched->sched_rq[i];
@@ -1067,9 +1688,198 @@ void drm_sched_fini(struct drm_gpu_scheduler *sched)
 	cancel_delayed_work_sync(&sched->work_tdr);
 
 	sched->ready = false;
+
+	free_percpu(sched->hist);
+	sched->hist = NULL;
+	kfree(sched->trace_ring);
+	sched->trace_ring = NULL;
 }
 EXPORT_SYMBOL(drm_sched_fini);
 
+#if defined(CONFIG_DEBUG_FS)
+
+static const char * const drm_sched_hist_names[DRM_SCHED_HIST_COUNT] = {
+	[DRM_SCHED_HIST_QUEUE]		= "queue",
+	[DRM_SCHED_HIST_DEPENDENCY]	= "dependency",
+	[DRM_SCHED_HIST_EXEC]		= "execution",
+};
+
+static void drm_sched_hist_print(struct seq_file *m,
+				 const struct drm_sched_hist *hist)
+{
+	unsigned int i, t;
+	char label[24];
+
+	seq_printf(m, "%16s", "latency(us)");
+	for (t = 0; t < DRM_SCHED_HIST_COUNT; t++)
+		seq_printf(m, " %12s", drm_sched_hist_names[t]);
+	seq_putc(m, '\n');
+
+	for (i = 0; i < DRM_SCHED_HIST_BUCKETS; i++) {
+		if (i == 0)
+			snprintf(label, sizeof(label), "<1");
+		else if (i == DRM_SCHED_HIST_BUCKETS - 1)
+			snprintf(label, sizeof(label), ">=%llu", 1ULL << (i - 1));
+		else
+			snprintf(label, sizeof(label), "%llu-%llu",
+				 1ULL << (i - 1), 1ULL << i);
+
+		seq_printf(m, "%16s", label);
+
+		for (t = 0; t < DRM_SCHED_HIST_COUNT; t++)
+			seq_printf(m, " %12llu", hist->buckets[t][i]);
+		seq_putc(m, '\n');
+	}
+}
+
+static int drm_sched_latency_show(struct seq_file *m, void *unused)
+{
+	struct drm_gpu_scheduler *sched = m->private;
+	struct drm_sched_entity *entity;
+	struct drm_sched_hist *hist;
+	int cpu, i, t, b;
+
+	if (!sched->hist)
+		return -ENODEV;
+
+	hist = kzalloc(sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct drm_sched_hist *pcpu = per_cpu_ptr(sched->hist, cpu);
+
+		for (t = 0; t < DRM_SCHED_HIST_COUNT; t++)
+			for (b = 0; b < DRM_SCHED_HIST_BUCKETS; b++)
+				hist->buckets[t][b] += READ_ONCE(pcpu->buckets[t][b]);
+	}
+
+	seq_printf(m, "scheduler %s:\n", sched->name);
+	drm_sched_hist_print(m, hist);
+
+	for (i = DRM_SCHED_PRIORITY_COUNT - 1; i >= DRM_SCHED_PRIORITY_MIN; i--) {
+		struct drm_sched_rq *rq = &sched->sched_rq[i];
+
+		spin_lock(&rq->lock);
+		list_for_each_entry(entity, &rq->entities, list) {
+			struct drm_sched_entity_stats *stats = entity->stats;
+
+			spin_lock(&stats->lock);
+			*hist = stats->hist;
+			spin_unlock(&stats->lock);
+
+			seq_printf(m, "\nentity %llu, priority %d:\n",
+				   entity->fence_context, i);
+			drm_sched_hist_print(m, hist);
+		}
+		spin_unlock(&rq->lock);
+	}
+
+	kfree(hist);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(drm_sched_latency);
+
+/**
+ * drm_sched_debugfs_init - expose the latency histograms of a scheduler
+ *
+ * @sched: scheduler instance
+ * @root: debugfs directory to create the file in
+ * @name: name of the file
+ *
+ * Creates a debugfs file showing the log2 histograms of the time the jobs of
+ * @sched spent queued, waiting for dependencies and executing, both for the
+ * whole scheduler and for each entity currently in one of its run queues.
+ */
+void drm_sched_debugfs_init(struct drm_gpu_scheduler *sched,
+			    struct dentry *root, const char *name)
+{
+	debugfs_create_file(name, 0444, root, sched, &drm_sched_latency_fops);
+}
+EXPORT_SYMBOL(drm_sched_debugfs_init);
+
+static s64 drm_sched_trace_delta(ktime_t start, ktime_t end)
+{
+	if (!start || !end)
+		return -1;
+
+	return ktime_to_us(ktime_sub(end, start));
+}
+
+static int drm_sched_trace_show(struct seq_file *m, void *unused)
+{
+	struct drm_gpu_scheduler *sched = m->private;
+	struct drm_sched_trace_record *recs;
+	unsigned long head, first, i;
+	unsigned int n = 0;
+
+	if (!sched->trace_ring)
+		return -ENODEV;
+
+	recs = kmalloc_array(DRM_SCHED_TRACE_RING_SIZE, sizeof(*recs),
+			     GFP_KERNEL);
+	if (!recs)
+		return -ENOMEM;
+
+	/* Snapshot the ring, oldest record first */
+	spin_lock(&sched->trace_lock);
+	head = sched->trace_head;
+	first = head > DRM_SCHED_TRACE_RING_SIZE ?
+		head - DRM_SCHED_TRACE_RING_SIZE : 0;
+	for (i = first; i < head; i++)
+		recs[n++] = sched->trace_ring[i % DRM_SCHED_TRACE_RING_SIZE];
+	spin_unlock(&sched->trace_lock);
+
+	seq_printf(m, "scheduler %s, sampling 1 in %u jobs, %lu sampled\n",
+		   sched->name, READ_ONCE(drm_sched_trace_sample), head);
+	seq_printf(m, "%10s %10s %18s %18s %9s %9s %9s %9s %9s %6s\n",
+		   "trace_id", "id", "fence", "hw fence", "push(us)", "deps(us)",
+		   "queue(us)", "exec(us)", "done(us)", "error");
+
+	/*
+	 * Stages are relative to the previous one, -1 means the stage wasn't
+	 * recorded, e.g. a hardware fence without timestamp.
+	 */
+	for (i = 0; i < n; i++) {
+		struct drm_sched_trace_record *rec = &recs[i];
+
+		seq_printf(m, "%10llu %10llu %8llu:%-9llu %8llu:%-9llu %9lld %9lld %9lld %9lld %9lld %6d\n",
+			   rec->trace_id, rec->id, rec->context, rec->seqno,
+			   rec->hw_context, rec->hw_seqno,
+			   drm_sched_trace_delta(rec->init, rec->push),
+			   drm_sched_trace_delta(rec->push, rec->deps_done),
+			   drm_sched_trace_delta(rec->deps_done, rec->run),
+			   drm_sched_trace_delta(rec->run, rec->hw_done),
+			   drm_sched_trace_delta(rec->hw_done, rec->finished),
+			   rec->error);
+	}
+
+	kfree(recs);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(drm_sched_trace);
+
+/**
+ * drm_sched_debugfs_trace_init - expose the sampled jobs of a scheduler
+ *
+ * @sched: scheduler instance
+ * @root: debugfs directory to create the file in
+ * @name: name of the file
+ *
+ * Creates a debugfs file listing the last %DRM_SCHED_TRACE_RING_SIZE jobs of
+ * @sched picked by the trace_sample module parameter, with the time each of
+ * them spent between submission, dependency resolution, execution on the
+ * hardware and the signaling of its finished fence.
+ */
+void drm_sched_debugfs_trace_init(struct drm_gpu_scheduler *sched,
+				  struct dentry *root, const char *name)
+{
+	debugfs_create_file(name, 0444, root, sched, &drm_sched_trace_fops);
+}
+EXPORT_SYMBOL(drm_sched_debugfs_trace_init);
+
+#endif
+
 /**
  * drm_sched_increase_karma_ext - Update sched_entity guilty flag
  *
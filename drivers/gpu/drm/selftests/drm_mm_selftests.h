@@ -26,3 +26,6 @@ selftest(highest, igt_highest)
 selftest(color, igt_color)
 selftest(color_evict, igt_color_evict)
 selftest(color_evict_range, igt_color_evict_range)
+selftest(bench_insert_remove, igt_bench_insert_remove)
+selftest(bench_frag, igt_bench_frag)
+selftest(bench_evict, igt_bench_evict)
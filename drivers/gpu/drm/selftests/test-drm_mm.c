@@ -22,6 +22,7 @@
 static unsigned int random_seed;
 static unsigned int max_iterations = 8192;
 static unsigned int max_prime = 128;
+static unsigned int bench_nodes;
 
 enum {
 	BEST,
@@ -2456,6 +2457,360 @@ static int igt_color_evict_range(void *ignored)
 	return ret;
 }
 
+/*
+ * Benchmarks: only run when bench_nodes is set, reporting one
+ * "bench: key=value ..." line per measurement so that results can be
+ * collected from the kernel log.
+ */
+
+struct bench_stats {
+	u64 total;
+	u64 worst;
+	unsigned long count;
+};
+
+static void bench_start(struct bench_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+static void bench_add(struct bench_stats *stats, ktime_t start)
+{
+	u64 dt = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	stats->total += dt;
+	stats->worst = max(stats->worst, dt);
+	stats->count++;
+}
+
+static void bench_report(const char *test, const char *mode,
+			 const char *constraint, const char *op,
+			 const struct bench_stats *stats)
+{
+	u64 avg = div64_u64(stats->total, max(stats->count, 1ul));
+
+	pr_info("bench: test=%s mode=%s constraint=%s op=%s nodes=%u count=%lu total_ns=%llu avg_ns=%llu worst_ns=%llu ops_per_sec=%llu\n",
+		test, mode, constraint, op, bench_nodes, stats->count,
+		stats->total, avg, stats->worst,
+		div64_u64((u64)stats->count * NSEC_PER_SEC,
+			  max_t(u64, stats->total, 1)));
+}
+
+static struct drm_mm_node *bench_alloc_nodes(unsigned int count)
+{
+	return vmalloc(array_size(count, sizeof(struct drm_mm_node)));
+}
+
+static unsigned int *bench_random_order(unsigned int count,
+					struct rnd_state *prng)
+{
+	unsigned int *order, i;
+
+	/* drm_random_order() uses kmalloc, too small for a million nodes */
+	order = vmalloc(array_size(count, sizeof(*order)));
+	if (!order)
+		return NULL;
+
+	for (i = 0; i < count; i++)
+		order[i] = i;
+	drm_random_reorder(order, count, prng);
+
+	return order;
+}
+
+static const struct bench_constraint {
+	const char *name;
+	u64 alignment;
+	bool color;
+} bench_constraints[] = {
+	{ "none", 0, false },
+	{ "align64k", SZ_64K, false },
+	{ "color", 0, true },
+	{}
+};
+
+static int igt_bench_insert_remove(void *ignored)
+{
+	DRM_RND_STATE(prng, random_seed);
+	const unsigned int count = bench_nodes;
+	const struct bench_constraint *c;
+	const struct insert_mode *mode;
+	struct drm_mm_node *nodes;
+	unsigned int *order, n;
+	int ret = 0;
+
+	if (!count)
+		return 0;
+
+	/*
+	 * Insert randomly sized nodes into an empty range, then remove them
+	 * again in random order, for every insertion mode and placement
+	 * constraint.
+	 */
+
+	nodes = bench_alloc_nodes(count);
+	if (!nodes)
+		return -ENOMEM;
+
+	order = bench_random_order(count, &prng);
+	if (!order) {
+		ret = -ENOMEM;
+		goto err_nodes;
+	}
+
+	for (c = bench_constraints; c->name; c++) {
+		for (mode = insert_modes; mode->name; mode++) {
+			struct bench_stats insert, remove;
+			struct drm_mm mm;
+
+			if (mode->mode == DRM_MM_INSERT_EVICT)
+				continue;
+
+			drm_mm_init(&mm, 1, U64_MAX - 2);
+			if (c->color)
+				mm.color_adjust = separate_adjacent_colors;
+			memset(nodes, 0, array_size(count, sizeof(*nodes)));
+
+			bench_start(&insert);
+			for (n = 0; n < count; n++) {
+				u64 size = (1 + prandom_u32_state(&prng) % 16) * SZ_4K;
+				ktime_t t0 = ktime_get();
+
+				ret = drm_mm_insert_node_generic(&mm, &nodes[n],
+								 size, c->alignment,
+								 c->color ? n & 1 : 0,
+								 mode->mode);
+				bench_add(&insert, t0);
+				if (ret) {
+					pr_err("%s insert failed, step %d\n",
+					       mode->name, n);
+					goto err_mm;
+				}
+
+				if (!(n % 1024))
+					cond_resched();
+			}
+
+			bench_start(&remove);
+			for (n = 0; n < count; n++) {
+				ktime_t t0 = ktime_get();
+
+				drm_mm_remove_node(&nodes[order[n]]);
+				bench_add(&remove, t0);
+
+				if (!(n % 1024))
+					cond_resched();
+			}
+
+			bench_report("insert_remove", mode->name, c->name,
+				     "insert", &insert);
+			bench_report("insert_remove", mode->name, c->name,
+				     "remove", &remove);
+
+err_mm:
+			if (ret) {
+				struct drm_mm_node *node, *next;
+
+				drm_mm_for_each_node_safe(node, next, &mm)
+					drm_mm_remove_node(node);
+			}
+			drm_mm_takedown(&mm);
+			if (ret)
+				goto err_order;
+		}
+	}
+
+err_order:
+	vfree(order);
+err_nodes:
+	vfree(nodes);
+	return ret;
+}
+
+static int igt_bench_frag(void *ignored)
+{
+	const unsigned int count = bench_nodes;
+	const unsigned int num_insert = count / 4;
+	const struct insert_mode *mode;
+	struct drm_mm_node *nodes;
+	int ret = 0;
+
+	if (!count)
+		return 0;
+
+	/*
+	 * Fragment the range into count / 2 holes none of which are large
+	 * enough for the following insertions, so that every insertion has
+	 * to skip over the holes. This is the worst case for insertion
+	 * latency.
+	 */
+
+	nodes = bench_alloc_nodes(count + num_insert);
+	if (!nodes)
+		return -ENOMEM;
+
+	for (mode = insert_modes; mode->name; mode++) {
+		struct drm_mm_node *node, *next;
+		struct bench_stats insert;
+		struct drm_mm mm;
+		unsigned int n;
+
+		if (mode->mode == DRM_MM_INSERT_EVICT)
+			continue;
+
+		drm_mm_init(&mm, 1, U64_MAX - 2);
+		memset(nodes, 0, array_size(count + num_insert, sizeof(*nodes)));
+
+		for (n = 0; n < count; n++) {
+			ret = drm_mm_insert_node_generic(&mm, &nodes[n], SZ_4K,
+							 0, 0,
+							 DRM_MM_INSERT_LOW);
+			if (ret) {
+				pr_err("fragmentation fill failed, step %d\n", n);
+				goto err_mm;
+			}
+		}
+
+		for (n = 0; n < count; n += 2)
+			drm_mm_remove_node(&nodes[n]);
+
+		bench_start(&insert);
+		for (n = 0; n < num_insert; n++) {
+			ktime_t t0 = ktime_get();
+
+			ret = drm_mm_insert_node_generic(&mm, &nodes[count + n],
+							 SZ_8K, 0, 0,
+							 mode->mode);
+			bench_add(&insert, t0);
+			if (ret) {
+				pr_err("%s fragmented insert failed, step %d\n",
+				       mode->name, n);
+				goto err_mm;
+			}
+
+			if (!(n % 1024))
+				cond_resched();
+		}
+
+		bench_report("frag", mode->name, "none", "insert", &insert);
+
+err_mm:
+		drm_mm_for_each_node_safe(node, next, &mm)
+			drm_mm_remove_node(node);
+		drm_mm_takedown(&mm);
+		if (ret)
+			break;
+	}
+
+	vfree(nodes);
+	return ret;
+}
+
+static int igt_bench_evict(void *ignored)
+{
+	DRM_RND_STATE(prng, random_seed);
+	const unsigned int count = bench_nodes;
+	const unsigned int iterations = min(max_iterations, count);
+	const unsigned int max_size = clamp(count / 2, 1u, 64u);
+	const struct bench_constraint *c;
+	const struct insert_mode *mode;
+	struct evict_node *nodes;
+	struct drm_mm mm;
+	unsigned int *order, n;
+	int ret = 0;
+
+	if (!count)
+		return 0;
+
+	/*
+	 * Fill the range completely and time how long eviction scans take
+	 * to find a hole, adding the nodes in a random LRU order. The
+	 * victims are released from the scan again, nothing is evicted.
+	 */
+
+	nodes = vzalloc(array_size(count, sizeof(*nodes)));
+	if (!nodes)
+		return -ENOMEM;
+
+	order = bench_random_order(count, &prng);
+	if (!order) {
+		ret = -ENOMEM;
+		goto err_nodes;
+	}
+
+	drm_mm_init(&mm, 0, (u64)count * SZ_4K);
+	mm.color_adjust = separate_adjacent_colors;
+	for (n = 0; n < count; n++) {
+		ret = drm_mm_insert_node_generic(&mm, &nodes[n].node, SZ_4K,
+						 0, 0, DRM_MM_INSERT_LOW);
+		if (ret) {
+			pr_err("evict fill failed, step %d\n", n);
+			goto err_mm;
+		}
+	}
+
+	for (c = bench_constraints; c->name; c++) {
+		for (mode = evict_modes; mode->name; mode++) {
+			struct bench_stats scan_stats;
+			unsigned long scanned = 0;
+			unsigned int i;
+
+			bench_start(&scan_stats);
+			for (i = 0; i < iterations; i++) {
+				u64 size = (1 + prandom_u32_state(&prng) % max_size) * SZ_4K;
+				unsigned int first = prandom_u32_state(&prng) % count;
+				struct evict_node *e, *en;
+				struct drm_mm_scan scan;
+				LIST_HEAD(evict_list);
+				unsigned int k;
+				ktime_t t0;
+				bool found = false;
+
+				t0 = ktime_get();
+				drm_mm_scan_init(&scan, &mm, size, c->alignment,
+						 c->color ? 1 : 0, mode->mode);
+				for (k = 0; k < count; k++) {
+					e = &nodes[order[(first + k) % count]];
+					list_add(&e->link, &evict_list);
+					scanned++;
+					if (drm_mm_scan_add_block(&scan, &e->node)) {
+						found = true;
+						break;
+					}
+				}
+				list_for_each_entry_safe(e, en, &evict_list, link)
+					drm_mm_scan_remove_block(&scan, &e->node);
+				bench_add(&scan_stats, t0);
+
+				if (!found) {
+					pr_err("%s evict scan failed, size=%llu, constraint=%s\n",
+					       mode->name, size, c->name);
+					ret = -EINVAL;
+					goto err_mm;
+				}
+
+				cond_resched();
+			}
+
+			bench_report("evict", mode->name, c->name, "scan",
+				     &scan_stats);
+			pr_info("bench: test=evict mode=%s constraint=%s op=scan avg_blocks=%lu\n",
+				mode->name, c->name,
+				scanned / max(scan_stats.count, 1ul));
+		}
+	}
+
+err_mm:
+	for (n = 0; n < count; n++)
+		if (drm_mm_node_allocated(&nodes[n].node))
+			drm_mm_remove_node(&nodes[n].node);
+	drm_mm_takedown(&mm);
+	vfree(order);
+err_nodes:
+	vfree(nodes);
+	return ret;
+}
+
 #include "drm_selftest.c"
 
 static int __init test_drm_mm_init(void)
@@ -2465,8 +2820,8 @@ static int __init test_drm_mm_init(void)
 	while (!random_seed)
 		random_seed = get_random_int();
 
-	pr_info("Testing DRM range manager (struct drm_mm), with random_seed=0x%x max_iterations=%u max_prime=%u\n",
-		random_seed, max_iterations, max_prime);
+	pr_info("Testing DRM range manager (struct drm_mm), with random_seed=0x%x max_iterations=%u max_prime=%u bench_nodes=%u\n",
+		random_seed, max_iterations, max_prime, bench_nodes);
 	err = run_selftests(selftests, ARRAY_SIZE(selftests), NULL);
 
 	return err > 0 ? 0 : err;
@@ -2482,6 +2837,8 @@ module_exit(test_drm_mm_exit);
 module_param(random_seed, uint, 0400);
 module_param(max_iterations, uint, 0400);
 module_param(max_prime, uint, 0400);
+module_param(bench_nodes, uint, 0400);
+MODULE_PARM_DESC(bench_nodes, "Number of nodes used by the benchmarks, 0 skips them (default: 0)");
 
 MODULE_AUTHOR("Intel Corporation");
 MODULE_LICENSE("GPL");
@@ -6,6 +6,8 @@
 #include <linux/module.h>
 #include <linux/usb.h>
 
+#include <asm/unaligned.h>
+
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_atomic_state_helper.h>
 #include <drm/drm_connector.h>
@@ -28,6 +30,10 @@ static bool eco_mode;
 module_param(eco_mode, bool, 0644);
 MODULE_PARM_DESC(eco_mode, "Turn on Eco mode (less bright, more silent)");
 
+static bool partial_update = true;
+module_param(partial_update, bool, 0644);
+MODULE_PARM_DESC(partial_update, "Only send data blocks which changed [default=true]");
+
 #define DRIVER_NAME		"gm12u320"
 #define DRIVER_DESC		"Grain Media GM12U320 USB projector display"
 #define DRIVER_DATE		"2019"
@@ -43,6 +49,7 @@ MODULE_PARM_DESC(eco_mode, "Turn on Eco mode (less bright, more silent)");
 #define GM12U320_HEIGHT			480
 
 #define GM12U320_BLOCK_COUNT		20
+#define GM12U320_ALL_BLOCKS		GENMASK(GM12U320_BLOCK_COUNT - 1, 0)
 
 #define GM12U320_ERR(fmt, ...) \
 	DRM_DEV_ERROR(gm12u320->dev.dev, fmt, ##__VA_ARGS__)
@@ -95,6 +102,11 @@ struct gm12u320_device {
 		struct drm_rect          rect;
 		int frame;
 		int draw_status_timeout;
+		/*
+		 * The device alternates between two frame buffers, a block
+		 * has to be sent once for each of them after it changed.
+		 */
+		u32 dirty_blocks[2];
 		struct dma_buf_map src_map;
 	} fb_update;
 };
@@ -240,6 +252,20 @@ static int gm12u320_misc_request(struct gm12u320_device *gm12u320,
 
 static void gm12u320_32bpp_to_24bpp_packed(u8 *dst, u8 *src, int len)
 {
+	/* Pack 4 pixels into 3 words at a time */
+	for (; len >= 4; len -= 4) {
+		u32 p0 = get_unaligned_le32(src);
+		u32 p1 = get_unaligned_le32(src + 4);
+		u32 p2 = get_unaligned_le32(src + 8);
+		u32 p3 = get_unaligned_le32(src + 12);
+
+		put_unaligned_le32((p0 & 0xffffff) | (p1 << 24), dst);
+		put_unaligned_le32(((p1 >> 8) & 0xffff) | (p2 << 16), dst + 4);
+		put_unaligned_le32(((p2 >> 16) & 0xff) | (p3 << 8), dst + 8);
+		src += 16;
+		dst += 12;
+	}
+
 	while (len--) {
 		*dst++ = *src++;
 		*dst++ = *src++;
@@ -252,6 +278,7 @@ static void gm12u320_copy_fb_to_blocks(struct gm12u320_device *gm12u320)
 {
 	int block, dst_offset, len, remain, ret, x1, x2, y1, y2;
 	struct drm_framebuffer *fb;
+	u32 dirty = 0;
 	void *vaddr;
 	u8 *src;
 
@@ -296,9 +323,11 @@ static void gm12u320_copy_fb_to_blocks(struct gm12u320_device *gm12u320)
 		gm12u320_32bpp_to_24bpp_packed(
 			gm12u320->data_buf[block] + dst_offset,
 			src, len);
+		dirty |= BIT(block);
 
 		if (remain) {
 			block++;
+			dirty |= BIT(block);
 			dst_offset = DATA_BLOCK_HEADER_SIZE;
 			gm12u320_32bpp_to_24bpp_packed(
 				gm12u320->data_buf[block] + dst_offset,
@@ -308,6 +337,9 @@ static void gm12u320_copy_fb_to_blocks(struct gm12u320_device *gm12u320)
 	}
 
 	drm_gem_fb_end_cpu_access(fb, DMA_FROM_DEVICE);
+
+	gm12u320->fb_update.dirty_blocks[0] |= dirty;
+	gm12u320->fb_update.dirty_blocks[1] |= dirty;
 put_fb:
 	drm_framebuffer_put(fb);
 	gm12u320->fb_update.fb = NULL;
@@ -322,11 +354,19 @@ static void gm12u320_fb_update_work(struct work_struct *work)
 			     fb_update.work);
 	struct usb_device *udev = gm12u320_to_usb_device(gm12u320);
 	int block, block_size, len;
+	u32 *dirty_blocks;
 	int ret = 0;
 
 	gm12u320_copy_fb_to_blocks(gm12u320);
 
+	dirty_blocks = &gm12u320->fb_update.dirty_blocks[gm12u320->fb_update.frame];
+	if (!partial_update)
+		*dirty_blocks = GM12U320_ALL_BLOCKS;
+
 	for (block = 0; block < GM12U320_BLOCK_COUNT; block++) {
+		if (!(*dirty_blocks & BIT(block)))
+			continue;
+
 		if (block == GM12U320_BLOCK_COUNT - 1)
 			block_size = DATA_LAST_BLOCK_SIZE;
 		else
@@ -362,6 +402,8 @@ static void gm12u320_fb_update_work(struct work_struct *work)
 				   CMD_TIMEOUT);
 		if (ret || len != READ_STATUS_SIZE)
 			goto err;
+
+		*dirty_blocks &= ~BIT(block);
 	}
 
 	/* Send draw command to device */
@@ -390,6 +432,8 @@ static void gm12u320_fb_update_work(struct work_struct *work)
 
 	return;
 err:
+	*dirty_blocks = GM12U320_ALL_BLOCKS;
+
 	/* Do not log errors caused by module unload or device unplug */
 	if (ret != -ENODEV && ret != -ECONNRESET && ret != -ESHUTDOWN)
 		GM12U320_ERR("Frame update error: %d\n", ret);
@@ -554,6 +598,8 @@ static void gm12u320_pipe_enable(struct drm_simple_display_pipe *pipe,
 	struct drm_shadow_plane_state *shadow_plane_state = to_drm_shadow_plane_state(plane_state);
 
 	gm12u320->fb_update.draw_status_timeout = FIRST_FRAME_TIMEOUT;
+	gm12u320->fb_update.dirty_blocks[0] = GM12U320_ALL_BLOCKS;
+	gm12u320->fb_update.dirty_blocks[1] = GM12U320_ALL_BLOCKS;
 	gm12u320_fb_mark_dirty(plane_state->fb, &shadow_plane_state->data[0], &rect);
 }
 
@@ -33,6 +33,7 @@
 
 #include <drm/ttm/ttm_bo_driver.h>
 #include <drm/ttm/ttm_placement.h>
+#include <linux/cgroup_gpumem.h>
 #include <linux/jiffies.h>
 #include <linux/slab.h>
 #include <linux/sched.h>
@@ -212,6 +213,7 @@ static int ttm_bo_handle_move_mem(struct ttm_buffer_object *bo,
 	}
 
 	ctx->bytes_moved += bo->base.size;
+	gpumem_cgroup_count_move(bo->resource->css, bo->base.size);
 	return 0;
 
 out_err:
@@ -666,43 +668,132 @@ static int ttm_mem_evict_wait_busy(struct ttm_buffer_object *busy_bo,
 	return r == -EDEADLK ? -EBUSY : r;
 }
 
+/*
+ * Number of evictable BOs per priority level ttm_mem_evict_first() compares
+ * before picking the cheapest one. A value of 1 gives back pure LRU order.
+ */
+static unsigned int ttm_evict_scan = 8;
+MODULE_PARM_DESC(evict_scan, "Number of eviction candidates compared by cost (1 = pure LRU)");
+module_param_named(evict_scan, ttm_evict_scan, uint, 0644);
+
+#define TTM_EVICT_SCAN_MAX	64
+
+static void ttm_mem_evict_account(struct ttm_resource_manager *man,
+				  struct ttm_buffer_object *bo,
+				  unsigned int scanned)
+{
+	struct ttm_resource_manager_evict_stats *stats = &man->evict_stats;
+
+	lockdep_assert_held(&man->bdev->lru_lock);
+
+	stats->evictions++;
+	stats->bytes += bo->base.size;
+	stats->scanned += scanned;
+	if (!dma_resv_test_signaled(bo->base.resv, true))
+		stats->busy++;
+	if (ttm_bo_recently_evicted(bo))
+		stats->refaults++;
+	gpumem_cgroup_count_evict(bo->resource->css, bo->base.size);
+
+	bo->evict_jiffies = jiffies ?: 1;
+}
+
+/**
+ * ttm_mem_evict_first - evict the cheapest BO from a resource manager
+ *
+ * @bdev: The device the manager belongs to.
+ * @man: The resource manager to evict from.
+ * @place: The placement we want to make room for, NULL for any.
+ * @size: Number of bytes the caller tries to make room for, 0 if unknown.
+ * @ctx: Operation context.
+ * @ticket: Acquire ticket of the caller, if any.
+ * @limit_pool: gpumem cgroup pool state whose limit the caller hit, NULL if
+ * @man itself is out of space.
+ *
+ * Walks the LRUs of @man in priority order and compares up to evict_scan
+ * evictable BOs of the first non empty priority level using
+ * ttm_resource_manager_evict_cost(), evicting the cheapest one.
+ *
+ * Only BOs charged below @limit_pool are considered, and BOs of cgroups within
+ * their gpumem.min never. BOs of cgroups within their gpumem.low are only
+ * considered when nothing else is left.
+ *
+ * Returns:
+ * 0 on success or if the selected BO went away, negative error code on
+ * failure.
+ */
 int ttm_mem_evict_first(struct ttm_device *bdev,
 			struct ttm_resource_manager *man,
 			const struct ttm_place *place,
+			uint64_t size,
 			struct ttm_operation_ctx *ctx,
-			struct ww_acquire_ctx *ticket)
+			struct ww_acquire_ctx *ticket,
+			struct gpumem_cgroup_pool_state *limit_pool)
 {
-	struct ttm_buffer_object *bo = NULL, *busy_bo = NULL;
-	bool locked = false;
-	unsigned i;
+	struct ttm_buffer_object *bo = NULL, *busy_bo = NULL, *cur;
+	unsigned int scan = clamp(READ_ONCE(ttm_evict_scan), 1U,
+				  (unsigned int)TTM_EVICT_SCAN_MAX);
+	unsigned int i, n, scanned = 0;
+	uint64_t best_cost = U64_MAX;
+	bool locked = false, try_low = false, hit_low = false;
 	int ret;
 
 	spin_lock(&bdev->lru_lock);
-	for (i = 0; i < TTM_MAX_BO_PRIORITY; ++i) {
-		list_for_each_entry(bo, &man->lru[i], lru) {
-			bool busy;
+retry:
+	for (i = 0; i < TTM_MAX_BO_PRIORITY && !bo; ++i) {
+		n = 0;
+		list_for_each_entry(cur, &man->lru[i], lru) {
+			bool cur_locked, busy;
+			uint64_t cost;
+
+			if (!gpumem_cgroup_state_evict_valuable(limit_pool,
+								cur->resource->css,
+								try_low,
+								&hit_low))
+				continue;
 
-			if (!ttm_bo_evict_swapout_allowable(bo, ctx, place,
-							    &locked, &busy)) {
+			if (!ttm_bo_evict_swapout_allowable(cur, ctx, place,
+							    &cur_locked, &busy)) {
 				if (busy && !busy_bo && ticket !=
-				    dma_resv_locking_ctx(bo->base.resv))
-					busy_bo = bo;
+				    dma_resv_locking_ctx(cur->base.resv))
+					busy_bo = cur;
 				continue;
 			}
 
-			if (!ttm_bo_get_unless_zero(bo)) {
-				if (locked)
-					dma_resv_unlock(bo->base.resv);
+			/*
+			 * We don't take a reference on every candidate, the
+			 * lru_lock keeps the BO around until we decided.
+			 */
+			if (!kref_read(&cur->kref)) {
+				if (cur_locked)
+					dma_resv_unlock(cur->base.resv);
 				continue;
 			}
-			break;
-		}
 
-		/* If the inner loop terminated early, we have our candidate */
-		if (&bo->lru != &man->lru[i])
-			break;
+			++scanned;
+			/* Deleted BOs only need their memory released */
+			cost = cur->deleted ? 0 :
+				ttm_resource_manager_evict_cost(man, cur, place,
+								size, n);
+			if (cost < best_cost) {
+				if (bo && locked)
+					dma_resv_unlock(bo->base.resv);
+				bo = cur;
+				locked = cur_locked;
+				best_cost = cost;
+			} else if (cur_locked) {
+				dma_resv_unlock(cur->base.resv);
+			}
 
-		bo = NULL;
+			if (!best_cost || ++n >= scan)
+				break;
+		}
+	}
+
+	/* Only BOs protected by gpumem.low are left, take those as well */
+	if (!bo && hit_low && !try_low) {
+		try_low = true;
+		goto retry;
 	}
 
 	if (!bo) {
@@ -715,6 +806,14 @@ int ttm_mem_evict_first(struct ttm_device *bdev,
 		return ret;
 	}
 
+	if (!ttm_bo_get_unless_zero(bo)) {
+		/* Raced with the last reference going away, just retry */
+		if (locked)
+			dma_resv_unlock(bo->base.resv);
+		spin_unlock(&bdev->lru_lock);
+		return 0;
+	}
+
 	if (bo->deleted) {
 		ret = ttm_bo_cleanup_refs(bo, ctx->interruptible,
 					  ctx->no_wait_gpu, locked);
@@ -722,6 +821,7 @@ int ttm_mem_evict_first(struct ttm_device *bdev,
 		return ret;
 	}
 
+	ttm_mem_evict_account(man, bo, scanned);
 	spin_unlock(&bdev->lru_lock);
 
 	ret = ttm_bo_evict(bo, ctx);
@@ -782,6 +882,7 @@ static int ttm_bo_mem_force_space(struct ttm_buffer_object *bo,
 				  struct ttm_resource **mem,
 				  struct ttm_operation_ctx *ctx)
 {
+	struct gpumem_cgroup_pool_state *limit_pool;
 	struct ttm_device *bdev = bo->bdev;
 	struct ttm_resource_manager *man;
 	struct ww_acquire_ctx *ticket;
@@ -790,13 +891,15 @@ static int ttm_bo_mem_force_space(struct ttm_buffer_object *bo,
 	man = ttm_manager_type(bdev, place->mem_type);
 	ticket = dma_resv_locking_ctx(bo->base.resv);
 	do {
-		ret = ttm_resource_alloc(bo, place, mem);
+		ret = ttm_resource_alloc(bo, place, mem, &limit_pool);
 		if (likely(!ret))
 			break;
-		if (unlikely(ret != -ENOSPC))
+		if (unlikely(ret != -ENOSPC && ret != -EAGAIN))
 			return ret;
-		ret = ttm_mem_evict_first(bdev, man, place, ctx,
-					  ticket);
+		/* Over a gpumem cgroup limit only evicting below it helps */
+		ret = ttm_mem_evict_first(bdev, man, place, bo->base.size,
+					  ctx, ticket, limit_pool);
+		gpumem_cgroup_pool_state_put(limit_pool);
 		if (unlikely(ret != 0))
 			return ret;
 	} while (1);
@@ -834,8 +937,8 @@ int ttm_bo_mem_space(struct ttm_buffer_object *bo,
 			continue;
 
 		type_found = true;
-		ret = ttm_resource_alloc(bo, place, mem);
-		if (ret == -ENOSPC)
+		ret = ttm_resource_alloc(bo, place, mem, NULL);
+		if (ret == -ENOSPC || ret == -EAGAIN)
 			continue;
 		if (unlikely(ret))
 			goto error;
@@ -987,7 +1090,7 @@ int ttm_bo_init_reserved(struct ttm_device *bdev,
 	}
 	atomic_inc(&ttm_glob.bo_count);
 
-	ret = ttm_resource_alloc(bo, &sys_mem, &bo->resource);
+	ret = ttm_resource_alloc(bo, &sys_mem, &bo->resource, NULL);
 	if (unlikely(ret)) {
 		ttm_bo_put(bo);
 		return ret;
@@ -1137,7 +1240,7 @@ int ttm_bo_swapout(struct ttm_buffer_object *bo, struct ttm_operation_ctx *ctx,
 
 		memset(&hop, 0, sizeof(hop));
 		place.mem_type = TTM_PL_SYSTEM;
-		ret = ttm_resource_alloc(bo, &place, &evict_mem);
+		ret = ttm_resource_alloc(bo, &place, &evict_mem, NULL);
 		if (unlikely(ret))
 			goto out;
 
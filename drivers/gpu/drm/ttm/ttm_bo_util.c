@@ -592,7 +592,7 @@ int ttm_bo_pipeline_gutting(struct ttm_buffer_object *bo)
 	struct ttm_tt *ttm;
 	int ret;
 
-	ret = ttm_resource_alloc(bo, &sys_mem, &sys_res);
+	ret = ttm_resource_alloc(bo, &sys_mem, &sys_res, NULL);
 	if (ret)
 		return ret;
 
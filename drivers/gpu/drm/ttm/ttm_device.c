@@ -27,7 +27,12 @@
 
 #define pr_fmt(fmt) "[TTM DEVICE] " fmt
 
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
 #include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include <drm/ttm/ttm_device.h>
 #include <drm/ttm/ttm_tt.h>
@@ -46,6 +51,35 @@ EXPORT_SYMBOL(ttm_glob);
 
 struct dentry *ttm_debugfs_root;
 
+/*
+ * Maximum number of buffer objects collected from the LRU and swapped out in
+ * parallel by a single ttm_device_swapout() pass.
+ */
+static unsigned int ttm_swapout_batch = 8;
+MODULE_PARM_DESC(swapout_batch, "Number of BOs swapped out in parallel per pass (1 = serial)");
+module_param_named(swapout_batch, ttm_swapout_batch, uint, 0644);
+
+#define TTM_SWAPOUT_BATCH_MAX	64
+
+/**
+ * struct ttm_swapout_item - a single BO swapped out by a batched pass
+ *
+ * @work: Work item running the copy out on ttm_global::swapout_wq.
+ * @bo: The buffer object, a reference is held until the item completes.
+ * @ctx: Operation context of the caller, only read by the worker.
+ * @gfp_flags: Allocation flags for the swap storage.
+ * @num_pages: Size of @bo in pages, sampled at collection time.
+ * @ret: Result of ttm_bo_swapout().
+ */
+struct ttm_swapout_item {
+	struct work_struct work;
+	struct ttm_buffer_object *bo;
+	struct ttm_operation_ctx *ctx;
+	gfp_t gfp_flags;
+	uint32_t num_pages;
+	int ret;
+};
+
 static void ttm_global_release(void)
 {
 	struct ttm_global *glob = &ttm_glob;
@@ -56,6 +90,7 @@ static void ttm_global_release(void)
 
 	ttm_pool_mgr_fini();
 	debugfs_remove(ttm_debugfs_root);
+	destroy_workqueue(glob->swapout_wq);
 
 	__free_page(glob->dummy_read_page);
 	memset(glob, 0, sizeof(*glob));
@@ -63,6 +98,25 @@ static void ttm_global_release(void)
 	mutex_unlock(&ttm_global_mutex);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int ttm_swapout_stats_show(struct seq_file *m, void *data)
+{
+	struct ttm_global *glob = &ttm_glob;
+	u64 pages = atomic64_read(&glob->swapout_pages);
+	u64 ns = atomic64_read(&glob->swapout_ns);
+
+	seq_printf(m, "passes:    %llu\n", atomic64_read(&glob->swapout_passes));
+	seq_printf(m, "bos:       %llu\n", atomic64_read(&glob->swapout_bos));
+	seq_printf(m, "pages:     %llu\n", pages);
+	seq_printf(m, "busy:      %llu\n", atomic64_read(&glob->swapout_busy));
+	seq_printf(m, "time_us:   %llu\n", div_u64(ns, NSEC_PER_USEC));
+	seq_printf(m, "pages/s:   %llu\n",
+		   ns ? div64_u64(pages * NSEC_PER_SEC, ns) : 0);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ttm_swapout_stats);
+#endif
+
 static int ttm_global_init(void)
 {
 	struct ttm_global *glob = &ttm_glob;
@@ -102,11 +156,28 @@ static int ttm_global_init(void)
 		goto out;
 	}
 
+	glob->swapout_wq = alloc_workqueue("ttm_swapout",
+					   WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (unlikely(!glob->swapout_wq)) {
+		__free_page(glob->dummy_read_page);
+		ret = -ENOMEM;
+		goto out;
+	}
+
 	INIT_LIST_HEAD(&glob->device_list);
 	atomic_set(&glob->bo_count, 0);
+	atomic64_set(&glob->swapout_passes, 0);
+	atomic64_set(&glob->swapout_bos, 0);
+	atomic64_set(&glob->swapout_pages, 0);
+	atomic64_set(&glob->swapout_busy, 0);
+	atomic64_set(&glob->swapout_ns, 0);
 
 	debugfs_create_atomic_t("buffer_objects", 0444, ttm_debugfs_root,
 				&glob->bo_count);
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("swapout_stats", 0444, ttm_debugfs_root, NULL,
+			    &ttm_swapout_stats_fops);
+#endif
 out:
 	if (ret && ttm_debugfs_root)
 		debugfs_remove(ttm_debugfs_root);
@@ -139,8 +210,9 @@ int ttm_global_swapout(struct ttm_operation_ctx *ctx, gfp_t gfp_flags)
 }
 EXPORT_SYMBOL(ttm_global_swapout);
 
-int ttm_device_swapout(struct ttm_device *bdev, struct ttm_operation_ctx *ctx,
-		       gfp_t gfp_flags)
+static int ttm_device_swapout_one(struct ttm_device *bdev,
+				  struct ttm_operation_ctx *ctx,
+				  gfp_t gfp_flags)
 {
 	struct ttm_resource_manager *man;
 	struct ttm_buffer_object *bo;
@@ -163,12 +235,144 @@ int ttm_device_swapout(struct ttm_device *bdev, struct ttm_operation_ctx *ctx,
 					return num_pages;
 				if (ret != -EBUSY)
 					return ret;
+				atomic64_inc(&ttm_glob.swapout_busy);
 			}
 		}
 	}
 	spin_unlock(&bdev->lru_lock);
 	return 0;
 }
+
+static void ttm_device_swapout_work(struct work_struct *work)
+{
+	struct ttm_swapout_item *item =
+		container_of(work, struct ttm_swapout_item, work);
+	struct ttm_buffer_object *bo = item->bo;
+	struct ttm_device *bdev = bo->bdev;
+
+	/*
+	 * The BO might have been reserved, pinned or swapped by somebody else
+	 * since it was collected, ttm_bo_swapout() re-checks all of that.
+	 */
+	spin_lock(&bdev->lru_lock);
+	item->ret = ttm_bo_swapout(bo, item->ctx, item->gfp_flags);
+	if (item->ret == -EBUSY)
+		spin_unlock(&bdev->lru_lock);
+
+	ttm_bo_put(bo);
+}
+
+/*
+ * Collect up to @max swap out candidates from the LRUs of @bdev. Only cheap
+ * checks are done here, the BOs are not reserved since the reservation would
+ * have to be dropped by a different task. Each collected BO holds a reference.
+ */
+static unsigned int ttm_device_swapout_collect(struct ttm_device *bdev,
+					       struct ttm_swapout_item *items,
+					       unsigned int max)
+{
+	struct ttm_resource_manager *man;
+	struct ttm_buffer_object *bo;
+	unsigned int i, j, count = 0;
+
+	spin_lock(&bdev->lru_lock);
+	for (i = TTM_PL_SYSTEM; i < TTM_NUM_MEM_TYPES; ++i) {
+		man = ttm_manager_type(bdev, i);
+		if (!man || !man->use_tt)
+			continue;
+
+		for (j = 0; j < TTM_MAX_BO_PRIORITY; ++j) {
+			list_for_each_entry(bo, &man->lru[j], lru) {
+				if (!bo->ttm || !ttm_tt_is_populated(bo->ttm) ||
+				    bo->ttm->page_flags & (TTM_TT_FLAG_EXTERNAL |
+							   TTM_TT_FLAG_SWAPPED) ||
+				    !ttm_bo_get_unless_zero(bo)) {
+					atomic64_inc(&ttm_glob.swapout_busy);
+					continue;
+				}
+
+				items[count].bo = bo;
+				items[count].num_pages = PFN_UP(bo->base.size);
+				if (++count == max)
+					goto out;
+			}
+		}
+	}
+out:
+	spin_unlock(&bdev->lru_lock);
+	return count;
+}
+
+/**
+ * ttm_device_swapout - swap out buffer objects of a device
+ *
+ * @bdev: The device to swap out BOs from.
+ * @ctx: Operation context.
+ * @gfp_flags: Allocation flags for the swap storage.
+ *
+ * Collects up to swapout_batch candidates from the LRUs under the lru_lock,
+ * drops the lock and copies them out concurrently on the swapout workqueue.
+ *
+ * Returns:
+ * The number of pages swapped out, 0 if nothing could be swapped out or a
+ * negative error code if the first failure wasn't just a busy BO.
+ */
+int ttm_device_swapout(struct ttm_device *bdev, struct ttm_operation_ctx *ctx,
+		       gfp_t gfp_flags)
+{
+	unsigned int batch = clamp(READ_ONCE(ttm_swapout_batch), 1U,
+				   (unsigned int)TTM_SWAPOUT_BATCH_MAX);
+	struct ttm_global *glob = &ttm_glob;
+	struct ttm_swapout_item *items = NULL;
+	unsigned int i, count;
+	int ret = 0, err = 0;
+	ktime_t start;
+
+	start = ktime_get();
+	atomic64_inc(&glob->swapout_passes);
+
+	if (batch > 1)
+		items = kcalloc(batch, sizeof(*items),
+				GFP_KERNEL | __GFP_NOWARN | __GFP_NORETRY);
+	if (!items) {
+		ret = ttm_device_swapout_one(bdev, ctx, gfp_flags);
+		if (ret > 0) {
+			atomic64_inc(&glob->swapout_bos);
+			atomic64_add(ret, &glob->swapout_pages);
+		}
+		goto out;
+	}
+
+	count = ttm_device_swapout_collect(bdev, items, batch);
+	for (i = 0; i < count; ++i) {
+		INIT_WORK(&items[i].work, ttm_device_swapout_work);
+		items[i].ctx = ctx;
+		items[i].gfp_flags = gfp_flags;
+		queue_work(glob->swapout_wq, &items[i].work);
+	}
+
+	for (i = 0; i < count; ++i) {
+		flush_work(&items[i].work);
+
+		if (!items[i].ret) {
+			atomic64_inc(&glob->swapout_bos);
+			atomic64_add(items[i].num_pages, &glob->swapout_pages);
+			ret += items[i].num_pages;
+		} else if (items[i].ret == -EBUSY) {
+			atomic64_inc(&glob->swapout_busy);
+		} else if (!err) {
+			err = items[i].ret;
+		}
+	}
+	kfree(items);
+
+	if (!ret)
+		ret = err;
+out:
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &glob->swapout_ns);
+	return ret;
+}
 EXPORT_SYMBOL(ttm_device_swapout);
 
 static void ttm_device_delayed_workqueue(struct work_struct *work)
@@ -214,7 +418,8 @@ int ttm_device_init(struct ttm_device *bdev, struct ttm_device_funcs *funcs,
 	bdev->funcs = funcs;
 
 	ttm_sys_man_init(bdev);
-	ttm_pool_init(&bdev->pool, dev, use_dma_alloc, use_dma32);
+	ttm_pool_init(&bdev->pool, dev, dev ? dev_to_node(dev) : NUMA_NO_NODE,
+		      use_dma_alloc, use_dma32);
 
 	bdev->vma_manager = vma_manager;
 	INIT_DELAYED_WORK(&bdev->wq, ttm_device_delayed_workqueue);
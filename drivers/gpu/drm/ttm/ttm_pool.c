@@ -29,11 +29,24 @@
  *
  * Additional to that allocations from the DMA coherent API are pooled as well
  * cause they are rather slow compared to alloc_pages+map.
+ *
+ * Each pool type for the lower orders has a small per CPU cache of pages, a
+ * magazine, in front of its page list. Allocating and freeing only goes to the
+ * shared list, and so takes its lock, when the magazine runs empty or full and
+ * then moves half a magazine at once.
+ *
+ * Pages are cleared before they can be handed out again. Unless disabled with
+ * the page_pool_async_clear parameter this happens in a background worker:
+ * freed pages are kept on a dirty list of their pool type and only become
+ * available for allocation again once the worker cleared them. Allocations
+ * prefer clean pages and only clear dirty ones inline when nothing else is
+ * left in the pool.
  */
 
 #include <linux/module.h>
 #include <linux/dma-mapping.h>
 #include <linux/highmem.h>
+#include <linux/percpu.h>
 #include <linux/sched/mm.h>
 
 #ifdef CONFIG_X86
@@ -57,23 +70,67 @@ struct ttm_pool_dma {
 	unsigned long vaddr;
 };
 
+/* Up to this many pages are cached per CPU and pool type */
+#define TTM_POOL_MAG_PAGES	128
+
+/**
+ * struct ttm_pool_magazine - Per CPU cache of pages for a pool type
+ *
+ * @lock: protects the magazine, only contended while the shrinker drains it
+ * @count: number of allocations in @pages
+ * @pages: the cached allocations, the most recently freed one last
+ */
+struct ttm_pool_magazine {
+	spinlock_t lock;
+	unsigned int count;
+	struct page *pages[];
+};
+
 static unsigned long page_pool_size;
 
 MODULE_PARM_DESC(page_pool_size, "Number of pages in the WC/UC/DMA pool");
 module_param(page_pool_size, ulong, 0644);
 
+static bool page_pool_async_clear = true;
+
+MODULE_PARM_DESC(page_pool_async_clear, "Clear pages returned to the pool in the background (default: true)");
+module_param(page_pool_async_clear, bool, 0644);
+
 static atomic_long_t allocated_pages;
 
-static struct ttm_pool_type global_write_combined[MAX_ORDER];
-static struct ttm_pool_type global_uncached[MAX_ORDER];
+/**
+ * struct ttm_pool_global - Global pool types of a NUMA node
+ *
+ * @write_combined: write combined pages
+ * @uncached: uncached pages
+ * @dma32_write_combined: write combined pages below 4GiB
+ * @dma32_uncached: uncached pages below 4GiB
+ * @alloc_local: allocations which got pages from the preferred node
+ * @alloc_remote: allocations which had to fall back to another node
+ */
+struct ttm_pool_global {
+	struct ttm_pool_type write_combined[MAX_ORDER];
+	struct ttm_pool_type uncached[MAX_ORDER];
+
+	struct ttm_pool_type dma32_write_combined[MAX_ORDER];
+	struct ttm_pool_type dma32_uncached[MAX_ORDER];
 
-static struct ttm_pool_type global_dma32_write_combined[MAX_ORDER];
-static struct ttm_pool_type global_dma32_uncached[MAX_ORDER];
+	atomic_long_t alloc_local;
+	atomic_long_t alloc_remote;
+};
+
+/* One set of global pool types per node, indexed by node id */
+static struct ttm_pool_global *global_pools;
 
 static spinlock_t shrinker_lock;
 static struct list_head shrinker_list;
 static struct shrinker mm_shrinker;
 
+/* Pool types with pages on their dirty list */
+static DEFINE_SPINLOCK(dirty_lock);
+static LIST_HEAD(dirty_list);
+static struct work_struct ttm_pool_clear_work;
+
 /* Allocate pages of size 1 << order with the given gfp_flags */
 static struct page *ttm_pool_alloc_page(struct ttm_pool *pool, gfp_t gfp_flags,
 					unsigned int order)
@@ -92,7 +149,7 @@ static struct page *ttm_pool_alloc_page(struct ttm_pool *pool, gfp_t gfp_flags,
 			__GFP_KSWAPD_RECLAIM;
 
 	if (!pool->use_dma_alloc) {
-		p = alloc_pages(gfp_flags, order);
+		p = alloc_pages_node(pool->nid, gfp_flags, order);
 		if (p)
 			p->private = order;
 		return p;
@@ -219,10 +276,92 @@ static void ttm_pool_unmap(struct ttm_pool *pool, dma_addr_t dma_addr,
 		       DMA_BIDIRECTIONAL);
 }
 
-/* Give pages into a specific pool_type */
-static void ttm_pool_type_give(struct ttm_pool_type *pt, struct page *p)
+/* Put an allocation into the magazine of the current CPU */
+static void ttm_pool_mag_give(struct ttm_pool_type *pt, struct page *p)
 {
-	unsigned int i, num_pages = 1 << pt->order;
+	/*
+	 * Preemption doesn't matter, worst case we use the magazine of another
+	 * CPU under its lock.
+	 */
+	struct ttm_pool_magazine *mag = raw_cpu_ptr(pt->mags);
+	unsigned int i, num;
+
+	spin_lock(&mag->lock);
+	if (mag->count == pt->mag_size) {
+		/* Full, move the older half over to the shared list */
+		num = max(pt->mag_size / 2, 1U);
+
+		spin_lock(&pt->lock);
+		for (i = 0; i < num; ++i)
+			list_add(&mag->pages[i]->lru, &pt->pages);
+		spin_unlock(&pt->lock);
+
+		mag->count -= num;
+		memmove(mag->pages, mag->pages + num,
+			mag->count * sizeof(*mag->pages));
+	}
+	mag->pages[mag->count++] = p;
+	spin_unlock(&mag->lock);
+}
+
+/* Take an allocation from the magazine of the current CPU */
+static struct page *ttm_pool_mag_take(struct ttm_pool_type *pt)
+{
+	struct ttm_pool_magazine *mag = raw_cpu_ptr(pt->mags);
+	struct page *p = NULL;
+
+	spin_lock(&mag->lock);
+	if (!mag->count) {
+		/* Empty, refill half of it from the shared list */
+		unsigned int num = max(pt->mag_size / 2, 1U);
+
+		spin_lock(&pt->lock);
+		while (mag->count < num) {
+			p = list_first_entry_or_null(&pt->pages, typeof(*p),
+						     lru);
+			if (!p)
+				break;
+
+			list_del(&p->lru);
+			mag->pages[mag->count++] = p;
+		}
+		spin_unlock(&pt->lock);
+	}
+	if (mag->count)
+		p = mag->pages[--mag->count];
+	spin_unlock(&mag->lock);
+
+	return p;
+}
+
+/* Move all pages cached in the magazines of a pool type to its list */
+static void ttm_pool_type_drain(struct ttm_pool_type *pt)
+{
+	unsigned int i;
+	int cpu;
+
+	if (!pt->mags)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct ttm_pool_magazine *mag = per_cpu_ptr(pt->mags, cpu);
+
+		spin_lock(&mag->lock);
+		if (mag->count) {
+			spin_lock(&pt->lock);
+			for (i = 0; i < mag->count; ++i)
+				list_add_tail(&mag->pages[i]->lru, &pt->pages);
+			spin_unlock(&pt->lock);
+			mag->count = 0;
+		}
+		spin_unlock(&mag->lock);
+	}
+}
+
+/* Clear pages of size 1 << order */
+static void ttm_pool_clear_page(struct page *p, unsigned int order)
+{
+	unsigned int i, num_pages = 1 << order;
 
 	for (i = 0; i < num_pages; ++i) {
 		if (PageHighMem(p))
@@ -230,15 +369,98 @@ static void ttm_pool_type_give(struct ttm_pool_type *pt, struct page *p)
 		else
 			clear_page(page_address(p + i));
 	}
+}
+
+/* Put the pool type on the list for the clear worker */
+static void ttm_pool_type_queue_clear(struct ttm_pool_type *pt)
+{
+	if (test_and_set_bit(0, &pt->dirty_queued))
+		return;
+
+	spin_lock(&dirty_lock);
+	list_add_tail(&pt->dirty_link, &dirty_list);
+	spin_unlock(&dirty_lock);
+
+	queue_work(system_unbound_wq, &ttm_pool_clear_work);
+}
+
+/* Take one page from the dirty list of a pool type */
+static struct page *ttm_pool_type_take_dirty(struct ttm_pool_type *pt)
+{
+	struct page *p;
 
 	spin_lock(&pt->lock);
-	list_add(&p->lru, &pt->pages);
+	p = list_first_entry_or_null(&pt->dirty, typeof(*p), lru);
+	if (p)
+		list_del(&p->lru);
 	spin_unlock(&pt->lock);
+
+	return p;
+}
+
+/* Background worker clearing the dirty pages of all pool types */
+static void ttm_pool_clear_worker(struct work_struct *work)
+{
+	struct ttm_pool_type *pt;
+	struct page *p;
+
+	for (;;) {
+		spin_lock(&dirty_lock);
+		pt = list_first_entry_or_null(&dirty_list, typeof(*pt),
+					      dirty_link);
+		if (pt)
+			list_del_init(&pt->dirty_link);
+		spin_unlock(&dirty_lock);
+
+		if (!pt)
+			break;
+
+		while ((p = ttm_pool_type_take_dirty(pt))) {
+			ttm_pool_clear_page(p, pt->order);
+
+			spin_lock(&pt->lock);
+			list_add(&p->lru, &pt->pages);
+			spin_unlock(&pt->lock);
+
+			cond_resched();
+		}
+
+		/* Pages freed after we looked at the list need another pass */
+		clear_bit(0, &pt->dirty_queued);
+		smp_mb__after_atomic();
+		if (!list_empty_careful(&pt->dirty))
+			ttm_pool_type_queue_clear(pt);
+	}
+}
+
+/* Give pages into a specific pool_type */
+static void ttm_pool_type_give(struct ttm_pool_type *pt, struct page *p)
+{
 	atomic_long_add(1 << pt->order, &allocated_pages);
+
+	if (READ_ONCE(page_pool_async_clear)) {
+		spin_lock(&pt->lock);
+		list_add_tail(&p->lru, &pt->dirty);
+		spin_unlock(&pt->lock);
+
+		ttm_pool_type_queue_clear(pt);
+		return;
+	}
+
+	ttm_pool_clear_page(p, pt->order);
+
+	if (pt->mags) {
+		ttm_pool_mag_give(pt, p);
+		return;
+	}
+
+	spin_lock(&pt->lock);
+	list_add(&p->lru, &pt->pages);
+	spin_unlock(&pt->lock);
 }
 
-/* Take pages from a specific pool_type, return NULL when nothing available */
-static struct page *ttm_pool_type_take(struct ttm_pool_type *pt)
+/* Take pages from the shared list of a pool_type */
+static struct page *ttm_pool_type_take_list(struct ttm_pool_type *pt)
 {
 	struct page *p;
 
@@ -253,15 +475,81 @@ static struct page *ttm_pool_type_take(struct ttm_pool_type *pt)
 	return p;
 }
 
+/* Take pages from a specific pool_type, return NULL when nothing available */
+static struct page *ttm_pool_type_take(struct ttm_pool_type *pt)
+{
+	struct page *p;
+
+	if (pt->mags)
+		p = ttm_pool_mag_take(pt);
+	else
+		p = ttm_pool_type_take_list(pt);
+
+	/* Nothing clean left, clear a dirty page ourself */
+	if (!p) {
+		p = ttm_pool_type_take_dirty(pt);
+		if (!p)
+			return NULL;
+
+		ttm_pool_clear_page(p, pt->order);
+		atomic_long_sub(1 << pt->order, &allocated_pages);
+	} else if (pt->mags) {
+		atomic_long_sub(1 << pt->order, &allocated_pages);
+	}
+
+	return p;
+}
+
+/* Take pages for freeing them, draining the magazines when necessary */
+static struct page *ttm_pool_type_reclaim(struct ttm_pool_type *pt)
+{
+	struct page *p;
+
+	/* Dirty pages first, that saves clearing them */
+	p = ttm_pool_type_take_dirty(pt);
+	if (p) {
+		atomic_long_sub(1 << pt->order, &allocated_pages);
+		return p;
+	}
+
+	p = ttm_pool_type_take_list(pt);
+	if (!p && pt->mags) {
+		ttm_pool_type_drain(pt);
+		p = ttm_pool_type_take_list(pt);
+	}
+
+	return p;
+}
+
 /* Initialize and add a pool type to the global shrinker list */
 static void ttm_pool_type_init(struct ttm_pool_type *pt, struct ttm_pool *pool,
 			       enum ttm_caching caching, unsigned int order)
 {
+	struct ttm_pool_magazine *mag;
+	int cpu;
+
 	pt->pool = pool;
 	pt->caching = caching;
 	pt->order = order;
 	spin_lock_init(&pt->lock);
 	INIT_LIST_HEAD(&pt->pages);
+	INIT_LIST_HEAD(&pt->dirty);
+	INIT_LIST_HEAD(&pt->dirty_link);
+	pt->dirty_queued = 0;
+
+	/* The magazines are only an optimization, work without them */
+	pt->mag_size = TTM_POOL_MAG_PAGES >> order;
+	pt->mags = NULL;
+	if (pt->mag_size)
+		pt->mags = __alloc_percpu(struct_size(mag, pages, pt->mag_size),
+					  __alignof__(*mag));
+	if (pt->mags) {
+		for_each_possible_cpu(cpu) {
+			mag = per_cpu_ptr(pt->mags, cpu);
+			spin_lock_init(&mag->lock);
+			mag->count = 0;
+		}
+	}
 
 	spin_lock(&shrinker_lock);
 	list_add_tail(&pt->shrinker_list, &shrinker_list);
@@ -277,14 +565,47 @@ static void ttm_pool_type_fini(struct ttm_pool_type *pt)
 	list_del(&pt->shrinker_list);
 	spin_unlock(&shrinker_lock);
 
-	while ((p = ttm_pool_type_take(pt)))
+	/*
+	 * Free the dirty pages right away and make sure the clear worker is
+	 * done with us, it might still put a page back onto the list.
+	 */
+	while ((p = ttm_pool_type_take_dirty(pt))) {
+		atomic_long_sub(1 << pt->order, &allocated_pages);
+		ttm_pool_free_page(pt->pool, pt->caching, pt->order, p);
+	}
+
+	spin_lock(&dirty_lock);
+	list_del_init(&pt->dirty_link);
+	spin_unlock(&dirty_lock);
+	flush_work(&ttm_pool_clear_work);
+
+	while ((p = ttm_pool_type_reclaim(pt)))
 		ttm_pool_free_page(pt->pool, pt->caching, pt->order, p);
 }
 
-/* Return the pool_type to use for the given caching and order */
+/*
+ * Free the magazines of a pool_type after ttm_pool_type_fini(), only allowed
+ * when the shrinker can't look at the pool type any more.
+ */
+static void ttm_pool_type_free_mags(struct ttm_pool_type *pt)
+{
+	free_percpu(pt->mags);
+	pt->mags = NULL;
+}
+
+/* Return the node whose global pool types the pool allocates from */
+static int ttm_pool_nid(struct ttm_pool *pool)
+{
+	return pool->nid == NUMA_NO_NODE ? numa_node_id() : pool->nid;
+}
+
+/*
+ * Return the pool_type to use for the given caching and order, @nid selects
+ * the node of the global pool types.
+ */
 static struct ttm_pool_type *ttm_pool_select_type(struct ttm_pool *pool,
 						  enum ttm_caching caching,
-						  unsigned int order)
+						  unsigned int order, int nid)
 {
 	if (pool->use_dma_alloc)
 		return &pool->caching[caching].orders[order];
@@ -293,14 +614,14 @@ static struct ttm_pool_type *ttm_pool_select_type(struct ttm_pool *pool,
 	switch (caching) {
 	case ttm_write_combined:
 		if (pool->use_dma32)
-			return &global_dma32_write_combined[order];
+			return &global_pools[nid].dma32_write_combined[order];
 
-		return &global_write_combined[order];
+		return &global_pools[nid].write_combined[order];
 	case ttm_uncached:
 		if (pool->use_dma32)
-			return &global_dma32_uncached[order];
+			return &global_pools[nid].dma32_uncached[order];
 
-		return &global_uncached[order];
+		return &global_pools[nid].uncached[order];
 	default:
 		break;
 	}
@@ -321,7 +642,7 @@ static unsigned int ttm_pool_shrink(void)
 	list_move_tail(&pt->shrinker_list, &shrinker_list);
 	spin_unlock(&shrinker_lock);
 
-	p = ttm_pool_type_take(pt);
+	p = ttm_pool_type_reclaim(pt);
 	if (p) {
 		ttm_pool_free_page(pt->pool, pt->caching, pt->order, p);
 		num_pages = 1 << pt->order;
@@ -364,6 +685,7 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 	struct page **caching = tt->pages;
 	struct page **pages = tt->pages;
 	gfp_t gfp_flags = GFP_USER;
+	int nid = ttm_pool_nid(pool);
 	unsigned int i, order;
 	struct page *p;
 	int r;
@@ -388,7 +710,7 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 		bool apply_caching = false;
 		struct ttm_pool_type *pt;
 
-		pt = ttm_pool_select_type(pool, tt->caching, order);
+		pt = ttm_pool_select_type(pool, tt->caching, order, nid);
 		p = pt ? ttm_pool_type_take(pt) : NULL;
 		if (p) {
 			apply_caching = true;
@@ -396,6 +718,12 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 			p = ttm_pool_alloc_page(pool, gfp_flags, order);
 			if (p && PageHighMem(p))
 				apply_caching = true;
+			if (p && !pool->use_dma_alloc) {
+				if (page_to_nid(p) == nid)
+					atomic_long_inc(&global_pools[nid].alloc_local);
+				else
+					atomic_long_inc(&global_pools[nid].alloc_remote);
+			}
 		}
 
 		if (!p) {
@@ -469,7 +797,9 @@ void ttm_pool_free(struct ttm_pool *pool, struct ttm_tt *tt)
 		if (tt->dma_address)
 			ttm_pool_unmap(pool, tt->dma_address[i], num_pages);
 
-		pt = ttm_pool_select_type(pool, tt->caching, order);
+		/* Pages always go back to the pool of the node they are on */
+		pt = ttm_pool_select_type(pool, tt->caching, order,
+					  page_to_nid(p));
 		if (pt)
 			ttm_pool_type_give(pt, tt->pages[i]);
 		else
@@ -489,19 +819,24 @@ EXPORT_SYMBOL(ttm_pool_free);
  *
  * @pool: the pool to initialize
  * @dev: device for DMA allocations and mappings
+ * @nid: NUMA node to allocate pages from, NUMA_NO_NODE for the local node
  * @use_dma_alloc: true if coherent DMA alloc should be used
  * @use_dma32: true if GFP_DMA32 should be used
  *
  * Initialize the pool and its pool types.
  */
 void ttm_pool_init(struct ttm_pool *pool, struct device *dev,
-		   bool use_dma_alloc, bool use_dma32)
+		   int nid, bool use_dma_alloc, bool use_dma32)
 {
 	unsigned int i, j;
 
 	WARN_ON(!dev && use_dma_alloc);
 
+	if (nid != NUMA_NO_NODE && (nid < 0 || nid >= nr_node_ids))
+		nid = NUMA_NO_NODE;
+
 	pool->dev = dev;
+	pool->nid = nid;
 	pool->use_dma_alloc = use_dma_alloc;
 	pool->use_dma32 = use_dma32;
 
@@ -535,6 +870,12 @@ void ttm_pool_fini(struct ttm_pool *pool)
 	 * that no shrinker is concurrently freeing pages from the pool.
 	 */
 	synchronize_shrinkers();
+
+	if (pool->use_dma_alloc) {
+		for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i)
+			for (j = 0; j < MAX_ORDER; ++j)
+				ttm_pool_type_free_mags(&pool->caching[i].orders[j]);
+	}
 }
 
 /* As long as pages are available make sure to release at least one */
@@ -565,13 +906,21 @@ static unsigned int ttm_pool_type_count(struct ttm_pool_type *pt)
 {
 	unsigned int count = 0;
 	struct page *p;
+	int cpu;
 
 	spin_lock(&pt->lock);
 	/* Only used for debugfs, the overhead doesn't matter */
 	list_for_each_entry(p, &pt->pages, lru)
 		++count;
+	list_for_each_entry(p, &pt->dirty, lru)
+		++count;
 	spin_unlock(&pt->lock);
 
+	if (pt->mags) {
+		for_each_possible_cpu(cpu)
+			count += READ_ONCE(per_cpu_ptr(pt->mags, cpu)->count);
+	}
+
 	return count;
 }
 
@@ -604,20 +953,47 @@ static void ttm_pool_debugfs_footer(struct seq_file *m)
 		   atomic_long_read(&allocated_pages), page_pool_size);
 }
 
+/* Dump the number of pages in the global pools of a node */
+static void ttm_pool_debugfs_node_total(struct ttm_pool_global *global,
+					struct seq_file *m)
+{
+	unsigned long count = 0;
+	unsigned int i;
+
+	for (i = 0; i < MAX_ORDER; ++i) {
+		count += (unsigned long)ttm_pool_type_count(&global->write_combined[i]) << i;
+		count += (unsigned long)ttm_pool_type_count(&global->uncached[i]) << i;
+		count += (unsigned long)ttm_pool_type_count(&global->dma32_write_combined[i]) << i;
+		count += (unsigned long)ttm_pool_type_count(&global->dma32_uncached[i]) << i;
+	}
+
+	seq_printf(m, "pages\t: %8lu, allocations local: %lu, remote: %lu\n",
+		   count, atomic_long_read(&global->alloc_local),
+		   atomic_long_read(&global->alloc_remote));
+}
+
 /* Dump the information for the global pools */
 static int ttm_pool_debugfs_globals_show(struct seq_file *m, void *data)
 {
-	ttm_pool_debugfs_header(m);
+	int nid;
 
 	spin_lock(&shrinker_lock);
-	seq_puts(m, "wc\t:");
-	ttm_pool_debugfs_orders(global_write_combined, m);
-	seq_puts(m, "uc\t:");
-	ttm_pool_debugfs_orders(global_uncached, m);
-	seq_puts(m, "wc 32\t:");
-	ttm_pool_debugfs_orders(global_dma32_write_combined, m);
-	seq_puts(m, "uc 32\t:");
-	ttm_pool_debugfs_orders(global_dma32_uncached, m);
+	for_each_node(nid) {
+		struct ttm_pool_global *global = &global_pools[nid];
+
+		seq_printf(m, "node %d\n", nid);
+		ttm_pool_debugfs_header(m);
+		seq_puts(m, "wc\t:");
+		ttm_pool_debugfs_orders(global->write_combined, m);
+		seq_puts(m, "uc\t:");
+		ttm_pool_debugfs_orders(global->uncached, m);
+		seq_puts(m, "wc 32\t:");
+		ttm_pool_debugfs_orders(global->dma32_write_combined, m);
+		seq_puts(m, "uc 32\t:");
+		ttm_pool_debugfs_orders(global->dma32_uncached, m);
+		ttm_pool_debugfs_node_total(global, m);
+		seq_puts(m, "\n");
+	}
 	spin_unlock(&shrinker_lock);
 
 	ttm_pool_debugfs_footer(m);
@@ -639,7 +1015,11 @@ int ttm_pool_debugfs(struct ttm_pool *pool, struct seq_file *m)
 	unsigned int i;
 
 	if (!pool->use_dma_alloc) {
-		seq_puts(m, "unused\n");
+		if (pool->nid == NUMA_NO_NODE)
+			seq_puts(m, "unused, using the global pools of the local node\n");
+		else
+			seq_printf(m, "unused, using the global pools of node %d\n",
+				   pool->nid);
 		return 0;
 	}
 
@@ -694,22 +1074,33 @@ DEFINE_SHOW_ATTRIBUTE(ttm_pool_debugfs_shrink);
 int ttm_pool_mgr_init(unsigned long num_pages)
 {
 	unsigned int i;
+	int nid;
 
 	if (!page_pool_size)
 		page_pool_size = num_pages;
 
+	global_pools = kcalloc(nr_node_ids, sizeof(*global_pools), GFP_KERNEL);
+	if (!global_pools)
+		return -ENOMEM;
+
 	spin_lock_init(&shrinker_lock);
 	INIT_LIST_HEAD(&shrinker_list);
+	INIT_WORK(&ttm_pool_clear_work, ttm_pool_clear_worker);
 
-	for (i = 0; i < MAX_ORDER; ++i) {
-		ttm_pool_type_init(&global_write_combined[i], NULL,
-				   ttm_write_combined, i);
-		ttm_pool_type_init(&global_uncached[i], NULL, ttm_uncached, i);
+	for_each_node(nid) {
+		struct ttm_pool_global *global = &global_pools[nid];
+
+		for (i = 0; i < MAX_ORDER; ++i) {
+			ttm_pool_type_init(&global->write_combined[i], NULL,
+					   ttm_write_combined, i);
+			ttm_pool_type_init(&global->uncached[i], NULL,
+					   ttm_uncached, i);
 
-		ttm_pool_type_init(&global_dma32_write_combined[i], NULL,
-				   ttm_write_combined, i);
-		ttm_pool_type_init(&global_dma32_uncached[i], NULL,
-				   ttm_uncached, i);
+			ttm_pool_type_init(&global->dma32_write_combined[i],
+					   NULL, ttm_write_combined, i);
+			ttm_pool_type_init(&global->dma32_uncached[i], NULL,
+					   ttm_uncached, i);
+		}
 	}
 
 #ifdef CONFIG_DEBUG_FS
@@ -733,15 +1124,35 @@ int ttm_pool_mgr_init(unsigned long num_pages)
 void ttm_pool_mgr_fini(void)
 {
 	unsigned int i;
+	int nid;
 
-	for (i = 0; i < MAX_ORDER; ++i) {
-		ttm_pool_type_fini(&global_write_combined[i]);
-		ttm_pool_type_fini(&global_uncached[i]);
+	for_each_node(nid) {
+		struct ttm_pool_global *global = &global_pools[nid];
+
+		for (i = 0; i < MAX_ORDER; ++i) {
+			ttm_pool_type_fini(&global->write_combined[i]);
+			ttm_pool_type_fini(&global->uncached[i]);
 
-		ttm_pool_type_fini(&global_dma32_write_combined[i]);
-		ttm_pool_type_fini(&global_dma32_uncached[i]);
+			ttm_pool_type_fini(&global->dma32_write_combined[i]);
+			ttm_pool_type_fini(&global->dma32_uncached[i]);
+		}
 	}
 
 	unregister_shrinker(&mm_shrinker);
 	WARN_ON(!list_empty(&shrinker_list));
+
+	for_each_node(nid) {
+		struct ttm_pool_global *global = &global_pools[nid];
+
+		for (i = 0; i < MAX_ORDER; ++i) {
+			ttm_pool_type_free_mags(&global->write_combined[i]);
+			ttm_pool_type_free_mags(&global->uncached[i]);
+
+			ttm_pool_type_free_mags(&global->dma32_write_combined[i]);
+			ttm_pool_type_free_mags(&global->dma32_uncached[i]);
+		}
+	}
+
+	kfree(global_pools);
+	global_pools = NULL;
 }
@@ -22,7 +22,9 @@
  * Authors: Christian König
  */
 
+#include <linux/cgroup_gpumem.h>
 #include <linux/dma-buf-map.h>
+#include <linux/dma-resv.h>
 #include <linux/io-mapping.h>
 #include <linux/scatterlist.h>
 
@@ -50,6 +52,7 @@ void ttm_resource_init(struct ttm_buffer_object *bo,
 	res->bus.is_iomem = false;
 	res->bus.caching = ttm_cached;
 	res->bo = bo;
+	res->css = NULL;
 }
 EXPORT_SYMBOL(ttm_resource_init);
 
@@ -68,26 +71,57 @@ void ttm_resource_fini(struct ttm_resource_manager *man,
 }
 EXPORT_SYMBOL(ttm_resource_fini);
 
+/**
+ * ttm_resource_alloc - allocate a resource and charge it to the cgroup
+ * @bo: the BO the resource is for
+ * @place: where to allocate
+ * @res_ptr: returns the resource
+ * @ret_limit_pool: optional, returns the gpumem cgroup pool state whose limit
+ * the allocation hit. Only evicting BOs charged below it makes room; it must
+ * be released with gpumem_cgroup_pool_state_put().
+ *
+ * Returns:
+ * 0 on success, -ENOSPC if the manager is out of space, -EAGAIN if a gpumem
+ * cgroup limit was hit or another negative error code.
+ */
 int ttm_resource_alloc(struct ttm_buffer_object *bo,
 		       const struct ttm_place *place,
-		       struct ttm_resource **res_ptr)
+		       struct ttm_resource **res_ptr,
+		       struct gpumem_cgroup_pool_state **ret_limit_pool)
 {
 	struct ttm_resource_manager *man =
 		ttm_manager_type(bo->bdev, place->mem_type);
+	struct gpumem_cgroup_pool_state *pool;
+	int ret;
 
-	return man->func->alloc(man, bo, place, res_ptr);
+	ret = gpumem_cgroup_try_charge(man->cg, bo->base.size, &pool,
+				       ret_limit_pool);
+	if (ret)
+		return ret;
+
+	ret = man->func->alloc(man, bo, place, res_ptr);
+	if (ret) {
+		gpumem_cgroup_uncharge(pool, bo->base.size);
+		return ret;
+	}
+
+	(*res_ptr)->css = pool;
+	return 0;
 }
 
 void ttm_resource_free(struct ttm_buffer_object *bo, struct ttm_resource **res)
 {
+	struct gpumem_cgroup_pool_state *pool;
 	struct ttm_resource_manager *man;
 
 	if (!*res)
 		return;
 
 	man = ttm_manager_type(bo->bdev, (*res)->mem_type);
+	pool = (*res)->css;
 	man->func->free(man, *res);
 	*res = NULL;
+	gpumem_cgroup_uncharge(pool, bo->base.size);
 }
 EXPORT_SYMBOL(ttm_resource_free);
 
@@ -170,9 +204,86 @@ void ttm_resource_manager_init(struct ttm_resource_manager *man,
 	for (i = 0; i < TTM_MAX_BO_PRIORITY; ++i)
 		INIT_LIST_HEAD(&man->lru[i]);
 	man->move = NULL;
+	memset(&man->evict_stats, 0, sizeof(man->evict_stats));
 }
 EXPORT_SYMBOL(ttm_resource_manager_init);
 
+/* Costs of the default eviction policy, in pages */
+#define TTM_EVICT_COST_BUSY	256ULL
+#define TTM_EVICT_COST_REFAULT	1024ULL
+#define TTM_EVICT_COST_AGE	16ULL
+
+/**
+ * ttm_resource_manager_evict_cost_default - default eviction cost
+ *
+ * @man: The resource manager to evict from.
+ * @bo: The eviction candidate, reserved by the caller.
+ * @place: The placement we want to make room for, may be NULL.
+ * @size: Number of bytes the caller tries to make room for, 0 if unknown.
+ * @age: Position of @bo among the evictable BOs of its LRU, 0 is the oldest.
+ *
+ * Weighs how far the size of @bo is off from @size, whether @bo still has
+ * unsignaled fences, whether it was evicted recently and came back, and its
+ * position in the LRU. The result is in units of pages, so a busy BO is
+ * still preferred over an idle one which would waste more than a MiB.
+ *
+ * Returns:
+ * The cost of evicting @bo, lower is better.
+ */
+uint64_t
+ttm_resource_manager_evict_cost_default(struct ttm_resource_manager *man,
+					struct ttm_buffer_object *bo,
+					const struct ttm_place *place,
+					uint64_t size, unsigned int age)
+{
+	uint64_t pages = bo->base.size >> PAGE_SHIFT;
+	uint64_t need = size >> PAGE_SHIFT;
+	uint64_t cost = age * TTM_EVICT_COST_AGE;
+
+	/*
+	 * Freeing too much is wasted work, freeing too little means another
+	 * eviction round which is only half as bad.
+	 */
+	if (need && pages > need)
+		cost += pages - need;
+	else if (need)
+		cost += (need - pages) / 2;
+
+	if (!dma_resv_test_signaled(bo->base.resv, true))
+		cost += TTM_EVICT_COST_BUSY;
+
+	if (ttm_bo_recently_evicted(bo))
+		cost += TTM_EVICT_COST_REFAULT;
+
+	return cost;
+}
+EXPORT_SYMBOL(ttm_resource_manager_evict_cost_default);
+
+/**
+ * ttm_resource_manager_evict_cost - cost of evicting a BO
+ *
+ * @man: The resource manager to evict from.
+ * @bo: The eviction candidate, reserved by the caller.
+ * @place: The placement we want to make room for, may be NULL.
+ * @size: Number of bytes the caller tries to make room for, 0 if unknown.
+ * @age: Position of @bo among the evictable BOs of its LRU, 0 is the oldest.
+ *
+ * Calls the evict_cost callback of @man if there is one, the default
+ * policy otherwise. Called with the lru_lock held.
+ */
+uint64_t ttm_resource_manager_evict_cost(struct ttm_resource_manager *man,
+					 struct ttm_buffer_object *bo,
+					 const struct ttm_place *place,
+					 uint64_t size, unsigned int age)
+{
+	if (man->func && man->func->evict_cost)
+		return man->func->evict_cost(man, bo, place, size, age);
+
+	return ttm_resource_manager_evict_cost_default(man, bo, place, size,
+						       age);
+}
+EXPORT_SYMBOL(ttm_resource_manager_evict_cost);
+
 /*
  * ttm_resource_manager_evict_all
  *
@@ -202,8 +313,8 @@ int ttm_resource_manager_evict_all(struct ttm_device *bdev,
 	for (i = 0; i < TTM_MAX_BO_PRIORITY; ++i) {
 		while (!list_empty(&man->lru[i])) {
 			spin_unlock(&bdev->lru_lock);
-			ret = ttm_mem_evict_first(bdev, man, NULL, &ctx,
-						  NULL);
+			ret = ttm_mem_evict_first(bdev, man, NULL, 0, &ctx,
+						  NULL, NULL);
 			if (ret)
 				return ret;
 			spin_lock(&bdev->lru_lock);
@@ -238,6 +349,15 @@ void ttm_resource_manager_debug(struct ttm_resource_manager *man,
 	drm_printf(p, "  use_type: %d\n", man->use_type);
 	drm_printf(p, "  use_tt: %d\n", man->use_tt);
 	drm_printf(p, "  size: %llu\n", man->size);
+
+	spin_lock(&man->bdev->lru_lock);
+	drm_printf(p, "  evictions: %llu\n", man->evict_stats.evictions);
+	drm_printf(p, "  evicted bytes: %llu\n", man->evict_stats.bytes);
+	drm_printf(p, "  evicted busy: %llu\n", man->evict_stats.busy);
+	drm_printf(p, "  evicted refaults: %llu\n", man->evict_stats.refaults);
+	drm_printf(p, "  candidates scanned: %llu\n", man->evict_stats.scanned);
+	spin_unlock(&man->bdev->lru_lock);
+
 	if (man->func->debug)
 		man->func->debug(man, p);
 }
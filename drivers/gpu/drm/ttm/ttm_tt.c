@@ -35,6 +35,8 @@
 #include <linux/shmem_fs.h>
 #include <linux/file.h>
 #include <linux/module.h>
+#include <linux/swap.h>
+#include <linux/writeback.h>
 #include <drm/drm_cache.h>
 #include <drm/ttm/ttm_bo_driver.h>
 
@@ -236,6 +238,37 @@ int ttm_tt_swapin(struct ttm_tt *ttm)
 	return ret;
 }
 
+/*
+ * Start writing a freshly copied shmem page to swap right away, the same way
+ * reclaim would, so the copy doesn't sit in memory next to the TT page until
+ * ttm_tt_unpopulate() and then wait for reclaim to find it. Without swap the
+ * page is simply redirtied and stays in the page cache.
+ */
+static void ttm_tt_swapout_page(struct address_space *mapping,
+				struct page *page)
+{
+	struct writeback_control wbc = {
+		.sync_mode = WB_SYNC_NONE,
+		.nr_to_write = SWAP_CLUSTER_MAX,
+		.range_start = 0,
+		.range_end = LLONG_MAX,
+		.for_reclaim = 1,
+	};
+
+	lock_page(page);
+	if (!page_mapped(page) && clear_page_dirty_for_io(page)) {
+		int ret;
+
+		SetPageReclaim(page);
+		ret = mapping->a_ops->writepage(page, &wbc);
+		if (!PageWriteback(page))
+			ClearPageReclaim(page);
+		if (!ret)
+			return;
+	}
+	unlock_page(page);
+}
+
 /**
  * ttm_tt_swapout - swap out tt object
  *
@@ -277,7 +310,7 @@ int ttm_tt_swapout(struct ttm_device *bdev, struct ttm_tt *ttm,
 		}
 		copy_highpage(to_page, from_page);
 		set_page_dirty(to_page);
-		mark_page_accessed(to_page);
+		ttm_tt_swapout_page(swap_space, to_page);
 		put_page(to_page);
 	}
 
@@ -62,6 +62,15 @@ struct udl_device {
 
 	char mode_buf[1024];
 	uint32_t mode_buf_len;
+
+	/*
+	 * last transmitted frame in the device format, lines are only sent
+	 * as far as they differ from it
+	 */
+	u16 *shadow;
+	u16 *line_buf;
+	int shadow_width, shadow_height;
+	bool shadow_valid;
 };
 
 #define to_udl(x) container_of(x, struct udl_device, drm)
@@ -86,6 +95,9 @@ int udl_render_hline(struct drm_device *dev, int log_bpp, struct urb **urb_ptr,
 		     const char *front, char **urb_buf_ptr,
 		     u32 byte_offset, u32 device_byte_offset, u32 byte_width);
 
+int udl_shadow_line(struct udl_device *udl, const u8 *front, int log_bpp,
+		    u32 dev_pixel, int width, int *first);
+
 int udl_drop_usb(struct drm_device *dev);
 
 #define CMD_WRITE_RAW8   "\xAF\x60" /**< 8 bit raw write command. */
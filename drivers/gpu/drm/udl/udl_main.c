@@ -8,6 +8,8 @@
  * Copyright (C) 2009 Bernie Thompson <bernie@plugable.com>
  */
 
+#include <linux/mm.h>
+
 #include <drm/drm.h>
 #include <drm/drm_print.h>
 #include <drm/drm_probe_helper.h>
@@ -20,7 +22,7 @@
 #define NR_USB_REQUEST_CHANNEL 0x12
 
 #define MAX_TRANSFER (PAGE_SIZE*16 - BULK_SIZE)
-#define WRITES_IN_FLIGHT (4)
+#define WRITES_IN_FLIGHT (8)
 #define MAX_VENDOR_DESCRIPTOR_SIZE 256
 
 #define GET_URB_TIMEOUT	HZ
@@ -360,5 +362,10 @@ int udl_drop_usb(struct drm_device *dev)
 	put_device(udl->dmadev);
 	udl->dmadev = NULL;
 
+	kvfree(udl->shadow);
+	kfree(udl->line_buf);
+	udl->shadow = NULL;
+	udl->line_buf = NULL;
+
 	return 0;
 }
@@ -8,6 +8,8 @@
  * Copyright (C) 2009 Bernie Thompson <bernie@plugable.com>
  */
 
+#include <linux/mm.h>
+
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_crtc_helper.h>
 #include <drm/drm_damage_helper.h>
@@ -264,10 +266,40 @@ static int udl_aligned_damage_clip(struct drm_rect *clip, int x, int y,
 	return 0;
 }
 
+static void udl_shadow_free(struct udl_device *udl)
+{
+	kvfree(udl->shadow);
+	kfree(udl->line_buf);
+	udl->shadow = NULL;
+	udl->line_buf = NULL;
+	udl->shadow_valid = false;
+}
+
+/*
+ * The shadow only saves bandwidth, updates are sent in full if it can't
+ * be allocated.
+ */
+static void udl_shadow_alloc(struct udl_device *udl, struct drm_framebuffer *fb)
+{
+	udl_shadow_free(udl);
+
+	udl->shadow = kvmalloc_array(fb->width * fb->height,
+				     sizeof(*udl->shadow), GFP_KERNEL);
+	udl->line_buf = kmalloc_array(fb->width, sizeof(*udl->line_buf),
+				      GFP_KERNEL);
+	if (!udl->shadow || !udl->line_buf) {
+		udl_shadow_free(udl);
+		return;
+	}
+	udl->shadow_width = fb->width;
+	udl->shadow_height = fb->height;
+}
+
 static int udl_handle_damage(struct drm_framebuffer *fb, const struct dma_buf_map *map,
 			     int x, int y, int width, int height)
 {
 	struct drm_device *dev = fb->dev;
+	struct udl_device *udl = to_udl(dev);
 	void *vaddr = map->vaddr; /* TODO: Use mapping abstraction properly */
 	int i, ret;
 	char *cmd;
@@ -286,6 +318,10 @@ static int udl_handle_damage(struct drm_framebuffer *fb, const struct dma_buf_ma
 	else if ((clip.x2 > fb->width) || (clip.y2 > fb->height))
 		return -EINVAL;
 
+	if (udl->shadow && (udl->shadow_width != fb->width ||
+			    udl->shadow_height != fb->height))
+		udl_shadow_alloc(udl, fb);
+
 	ret = drm_gem_fb_begin_cpu_access(fb, DMA_FROM_DEVICE);
 	if (ret)
 		return ret;
@@ -302,11 +338,33 @@ static int udl_handle_damage(struct drm_framebuffer *fb, const struct dma_buf_ma
 		const int byte_offset = line_offset + (clip.x1 << log_bpp);
 		const int dev_byte_offset = (fb->width * i + clip.x1) << log_bpp;
 		const int byte_width = (clip.x2 - clip.x1) << log_bpp;
-		ret = udl_render_hline(dev, log_bpp, &urb, (char *)vaddr,
-				       &cmd, byte_offset, dev_byte_offset,
-				       byte_width);
-		if (ret)
+
+		if (udl->shadow) {
+			const u32 dev_pixel = fb->width * i + clip.x1;
+			int first, count;
+
+			count = udl_shadow_line(udl, (u8 *)vaddr + byte_offset,
+						log_bpp, dev_pixel,
+						clip.x2 - clip.x1, &first);
+			if (!count)
+				continue;
+
+			/* the line buffer holds the device's 16 bit pixels */
+			ret = udl_render_hline(dev, 1, &urb,
+					       (char *)udl->line_buf, &cmd,
+					       first * 2,
+					       (dev_pixel + first) * 2,
+					       count * 2);
+		} else {
+			ret = udl_render_hline(dev, log_bpp, &urb, (char *)vaddr,
+					       &cmd, byte_offset, dev_byte_offset,
+					       byte_width);
+		}
+		if (ret) {
+			/* the shadow was updated for lines we didn't send */
+			udl->shadow_valid = false;
 			goto out_drm_gem_fb_end_cpu_access;
+		}
 	}
 
 	if (cmd > (char *)urb->transfer_buffer) {
@@ -320,6 +378,11 @@ static int udl_handle_damage(struct drm_framebuffer *fb, const struct dma_buf_ma
 		udl_urb_completion(urb);
 	}
 
+	/* a full update brings the shadow in sync with the device */
+	if (udl->shadow && clip.x1 == 0 && clip.y1 == 0 &&
+	    clip.x2 >= fb->width && clip.y2 >= fb->height)
+		udl->shadow_valid = true;
+
 	ret = 0;
 
 out_drm_gem_fb_end_cpu_access:
@@ -379,6 +442,9 @@ udl_simple_display_pipe_enable(struct drm_simple_display_pipe *pipe,
 
 	udl->mode_buf_len = wrptr - buf;
 
+	/* the device content is unknown, the first update is sent in full */
+	udl_shadow_alloc(udl, fb);
+
 	udl_handle_damage(fb, &shadow_plane_state->data[0], 0, 0, fb->width, fb->height);
 
 	if (!crtc_state->mode_changed)
@@ -396,6 +462,8 @@ udl_simple_display_pipe_disable(struct drm_simple_display_pipe *pipe)
 	struct urb *urb;
 	char *buf;
 
+	udl_shadow_free(to_udl(dev));
+
 	urb = udl_get_urb(dev);
 	if (!urb)
 		return;
@@ -82,6 +82,47 @@ static inline u16 get_pixel_val16(const uint8_t *pixel, int log_bpp)
 	return pixel_val16;
 }
 
+/**
+ * udl_shadow_line - convert a line and trim it against the shadow
+ * @udl: udl device
+ * @front: start of the line segment in the framebuffer
+ * @log_bpp: log2 of the framebuffer's bytes per pixel
+ * @dev_pixel: index of the first pixel in the device framebuffer
+ * @width: number of pixels
+ * @first: returns the offset of the first pixel which changed
+ *
+ * Converts the line segment into the 16 bit pixels the device stores into
+ * udl->line_buf. Pixels at the front and the back of the segment that match
+ * the last transmitted frame are trimmed, the others become the new shadow
+ * content. If the shadow isn't valid nothing is trimmed.
+ *
+ * Returns the number of pixels that have to be sent starting at @first,
+ * the converted pixels start at udl->line_buf + @first.
+ */
+int udl_shadow_line(struct udl_device *udl, const u8 *front, int log_bpp,
+		    u32 dev_pixel, int width, int *first)
+{
+	u16 *shadow = udl->shadow + dev_pixel;
+	u16 *line = udl->line_buf;
+	int start, end, i;
+
+	for (i = 0; i < width; i++, front += 1 << log_bpp)
+		line[i] = get_pixel_val16(front, log_bpp);
+
+	start = 0;
+	end = width;
+	if (udl->shadow_valid) {
+		while (start < end && line[start] == shadow[start])
+			start++;
+		while (end > start && line[end - 1] == shadow[end - 1])
+			end--;
+	}
+	memcpy(shadow + start, line + start, (end - start) * sizeof(*line));
+
+	*first = start;
+	return end - start;
+}
+
 /*
  * Render a command stream for an encoded horizontal line segment of pixels.
  *
@@ -100,6 +100,18 @@ struct v3d_dev {
 	struct drm_mm mm;
 	spinlock_t mm_lock;
 
+	/* Lock serializing MMU flushes, protecting the batching state
+	 * below.
+	 */
+	struct mutex mmu_lock;
+	/* Nesting count of v3d_mmu_batch_begin() callers.  While
+	 * non-zero, TLB invalidation of removed PTEs is deferred to
+	 * v3d_mmu_batch_end().
+	 */
+	unsigned int mmu_batch;
+	/* Set when PTEs were cleared but the TLB not flushed yet. */
+	bool mmu_flush_pending;
+
 	struct work_struct overflow_mem_work;
 
 	struct v3d_bin_job *bin_job;
@@ -265,6 +277,12 @@ struct v3d_render_job {
 
 	u32 timedout_ctca, timedout_ctra;
 
+	/* Done fence of the bin job when the RCL synchronizes with it
+	 * through the CLE semaphore (DRM_V3D_SUBMIT_CL_BIN_SEMAPHORE),
+	 * the render job is then started along with the bin job.
+	 */
+	struct dma_fence *bin_done_fence;
+
 	/* List of overflow BOs used in the job that need to be
 	 * released once the job is complete.
 	 */
@@ -398,6 +416,8 @@ int v3d_mmu_get_offset(struct drm_file *file_priv, struct v3d_bo *bo,
 int v3d_mmu_set_page_table(struct v3d_dev *v3d);
 void v3d_mmu_insert_ptes(struct v3d_bo *bo);
 void v3d_mmu_remove_ptes(struct v3d_bo *bo);
+void v3d_mmu_batch_begin(struct v3d_dev *v3d);
+void v3d_mmu_batch_end(struct v3d_dev *v3d);
 
 /* v3d_sched.c */
 int v3d_sched_init(struct v3d_dev *v3d);
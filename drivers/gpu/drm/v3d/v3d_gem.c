@@ -358,10 +358,15 @@ v3d_job_free(struct kref *ref)
 	struct v3d_job *job = container_of(ref, struct v3d_job, refcount);
 	int i;
 
+	/* Retiring a job commonly drops the last reference on a whole
+	 * batch of BOs, so only invalidate the TLB once for all of them.
+	 */
+	v3d_mmu_batch_begin(job->v3d);
 	for (i = 0; i < job->bo_count; i++) {
 		if (job->bo[i])
 			drm_gem_object_put(job->bo[i]);
 	}
+	v3d_mmu_batch_end(job->v3d);
 	kvfree(job->bo);
 
 	dma_fence_put(job->irq_fence);
@@ -387,6 +392,8 @@ v3d_render_job_free(struct kref *ref)
 		drm_gem_object_put(&bo->base.base);
 	}
 
+	dma_fence_put(job->bin_done_fence);
+
 	v3d_job_free(ref);
 }
 
@@ -736,7 +743,8 @@ v3d_submit_cl_ioctl(struct drm_device *dev, void *data,
 
 	if (args->flags &&
 	    args->flags & ~(DRM_V3D_SUBMIT_CL_FLUSH_CACHE |
-			    DRM_V3D_SUBMIT_EXTENSION)) {
+			    DRM_V3D_SUBMIT_EXTENSION |
+			    DRM_V3D_SUBMIT_CL_BIN_SEMAPHORE)) {
 		DRM_INFO("invalid flags: %d\n", args->flags);
 		return -EINVAL;
 	}
@@ -808,8 +816,18 @@ v3d_submit_cl_ioctl(struct drm_device *dev, void *data,
 		v3d_perfmon_get(bin->base.perfmon);
 		v3d_push_job(&bin->base);
 
-		ret = drm_sched_job_add_dependency(&render->base.base,
-						   dma_fence_get(bin->base.done_fence));
+		/* With the semaphore the CLE holds the RCL back until the
+		 * BCL is done, only wait for the bin job to be started so
+		 * the render job gets queued to CT1 meanwhile.
+		 */
+		if (args->flags & DRM_V3D_SUBMIT_CL_BIN_SEMAPHORE) {
+			render->bin_done_fence = dma_fence_get(bin->base.done_fence);
+			ret = drm_sched_job_add_dependency(&render->base.base,
+							   dma_fence_get(&bin->base.base.s_fence->scheduled));
+		} else {
+			ret = drm_sched_job_add_dependency(&render->base.base,
+							   dma_fence_get(bin->base.done_fence));
+		}
 		if (ret)
 			goto fail_unreserve;
 	}
@@ -1077,6 +1095,7 @@ v3d_gem_init(struct drm_device *dev)
 		v3d->queue[i].fence_context = dma_fence_context_alloc(1);
 
 	spin_lock_init(&v3d->mm_lock);
+	mutex_init(&v3d->mmu_lock);
 	spin_lock_init(&v3d->job_lock);
 	mutex_init(&v3d->bo_lock);
 	mutex_init(&v3d->reset_lock);
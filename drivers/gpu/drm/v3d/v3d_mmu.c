@@ -16,8 +16,21 @@
  * To protect clients from each other, we should use the GMP to
  * quickly mask out (at 128kb granularity) what pages are available to
  * each client.  This is not yet implemented.
+ *
+ * When the DMA mapping of a BO has 64KB or 1MB chunks that are
+ * contiguous and suitably aligned both in bus and V3D address space,
+ * they get mapped as big pages or superpages so that a single TLB
+ * entry covers the whole chunk.
+ *
+ * Freshly inserted PTEs replace invalid entries, which the TLB never
+ * holds, so inserting only needs the MMU cache flushed.  Removing a
+ * small BO shoots down just the TLB entries it used, and removals
+ * inside v3d_mmu_batch_begin()/v3d_mmu_batch_end() share a single
+ * TLB clear.
  */
 
+#include <linux/sizes.h>
+
 #include "v3d_drv.h"
 #include "v3d_regs.h"
 
@@ -27,9 +40,15 @@
  * superpage bit set.
  */
 #define V3D_PTE_SUPERPAGE BIT(31)
+#define V3D_PTE_BIGPAGE BIT(30)
 #define V3D_PTE_WRITEABLE BIT(29)
 #define V3D_PTE_VALID BIT(28)
 
+/* Removing a BO that used more TLB entries than this clears the
+ * whole TLB instead of shooting down each entry.
+ */
+#define V3D_MMU_MAX_SHOOT_DOWNS 16
+
 static int v3d_mmu_flush_all(struct v3d_dev *v3d)
 {
 	int ret;
@@ -64,6 +83,70 @@ static int v3d_mmu_flush_all(struct v3d_dev *v3d)
 	return ret;
 }
 
+static int v3d_mmu_flush_mmuc(struct v3d_dev *v3d)
+{
+	int ret;
+
+	V3D_WRITE(V3D_MMUC_CONTROL,
+		  V3D_MMUC_CONTROL_FLUSH |
+		  V3D_MMUC_CONTROL_ENABLE);
+
+	ret = wait_for(!(V3D_READ(V3D_MMUC_CONTROL) &
+			 V3D_MMUC_CONTROL_FLUSHING), 100);
+	if (ret)
+		dev_err(v3d->drm.dev, "MMUC flush wait idle failed\n");
+
+	return ret;
+}
+
+static int v3d_mmu_shoot_down(struct v3d_dev *v3d, u32 page)
+{
+	int ret;
+
+	ret = wait_for(!(V3D_READ(V3D_MMU_SHOOT_DOWN) &
+			 V3D_MMU_SHOOT_DOWN_SHOOTING), 100);
+	if (ret) {
+		dev_err(v3d->drm.dev, "TLB shoot down wait idle failed\n");
+		return ret;
+	}
+
+	V3D_WRITE(V3D_MMU_SHOOT_DOWN,
+		  V3D_MMU_SHOOT_DOWN_SHOOT |
+		  V3D_SET_FIELD(page, V3D_MMU_SHOOT_DOWN_PAGE));
+
+	return 0;
+}
+
+/* Invalidates the TLB entries for the removed PTEs of a BO, given the
+ * first page of each TLB entry it used.
+ */
+static int v3d_mmu_flush_range(struct v3d_dev *v3d, const u32 *entries,
+			       u32 count)
+{
+	int ret;
+	u32 i;
+
+	/* The PTE lines must leave the MMU cache before shooting down,
+	 * or a TLB refill could pick the stale PTEs up again.
+	 */
+	ret = v3d_mmu_flush_mmuc(v3d);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < count; i++) {
+		ret = v3d_mmu_shoot_down(v3d, entries[i]);
+		if (ret)
+			return ret;
+	}
+
+	ret = wait_for(!(V3D_READ(V3D_MMU_SHOOT_DOWN) &
+			 V3D_MMU_SHOOT_DOWN_SHOOTING), 100);
+	if (ret)
+		dev_err(v3d->drm.dev, "TLB shoot down wait idle failed\n");
+
+	return ret;
+}
+
 int v3d_mmu_set_page_table(struct v3d_dev *v3d)
 {
 	V3D_WRITE(V3D_MMU_PT_PA_BASE, v3d->pt_paddr >> V3D_MMU_PAGE_SHIFT);
@@ -84,30 +167,74 @@ int v3d_mmu_set_page_table(struct v3d_dev *v3d)
 	return v3d_mmu_flush_all(v3d);
 }
 
+static bool v3d_mmu_is_aligned(u32 page, u32 page_address, size_t alignment)
+{
+	return IS_ALIGNED(page, alignment >> V3D_MMU_PAGE_SHIFT) &&
+		IS_ALIGNED(page_address, alignment >> V3D_MMU_PAGE_SHIFT);
+}
+
 void v3d_mmu_insert_ptes(struct v3d_bo *bo)
 {
 	struct drm_gem_shmem_object *shmem_obj = &bo->base;
 	struct v3d_dev *v3d = to_v3d_dev(shmem_obj->base.dev);
 	u32 page = bo->node.start;
-	u32 page_prot = V3D_PTE_WRITEABLE | V3D_PTE_VALID;
-	struct sg_dma_page_iter dma_iter;
-
-	for_each_sgtable_dma_page(shmem_obj->sgt, &dma_iter, 0) {
-		dma_addr_t dma_addr = sg_page_iter_dma_address(&dma_iter);
-		u32 page_address = dma_addr >> V3D_MMU_PAGE_SHIFT;
-		u32 pte = page_prot | page_address;
-		u32 i;
-
-		BUG_ON(page_address + (PAGE_SIZE >> V3D_MMU_PAGE_SHIFT) >=
-		       BIT(24));
-		for (i = 0; i < PAGE_SIZE >> V3D_MMU_PAGE_SHIFT; i++)
-			v3d->pt[page++] = pte + i;
+	struct scatterlist *sgl;
+	unsigned int count;
+	int ret;
+
+	for_each_sgtable_dma_sg(shmem_obj->sgt, sgl, count) {
+		dma_addr_t dma_addr = sg_dma_address(sgl);
+		u32 pfn = dma_addr >> V3D_MMU_PAGE_SHIFT;
+		unsigned int len = sg_dma_len(sgl);
+
+		while (len > 0) {
+			u32 page_address = V3D_PTE_WRITEABLE | V3D_PTE_VALID |
+					   pfn;
+			unsigned int i, page_size;
+
+			if (len >= SZ_1M &&
+			    v3d_mmu_is_aligned(page, pfn, SZ_1M)) {
+				page_size = SZ_1M;
+				page_address |= V3D_PTE_SUPERPAGE;
+			} else if (len >= SZ_64K &&
+				   v3d_mmu_is_aligned(page, pfn, SZ_64K)) {
+				page_size = SZ_64K;
+				page_address |= V3D_PTE_BIGPAGE;
+			} else {
+				page_size = PAGE_SIZE;
+			}
+
+			BUG_ON(pfn + (page_size >> V3D_MMU_PAGE_SHIFT) >=
+			       BIT(24));
+
+			/* Every PTE of a big page or superpage carries
+			 * the size bit.
+			 */
+			for (i = 0; i < page_size >> V3D_MMU_PAGE_SHIFT; i++) {
+				v3d->pt[page++] = page_address++;
+				pfn++;
+			}
+
+			len -= page_size;
+		}
 	}
 
 	WARN_ON_ONCE(page - bo->node.start !=
 		     shmem_obj->base.size >> V3D_MMU_PAGE_SHIFT);
 
-	if (v3d_mmu_flush_all(v3d))
+	mutex_lock(&v3d->mmu_lock);
+	/* Our range may be reusing PTEs whose TLB invalidation was
+	 * deferred by a batch, in which case the TLB must go now.
+	 */
+	if (v3d->mmu_flush_pending) {
+		ret = v3d_mmu_flush_all(v3d);
+		v3d->mmu_flush_pending = false;
+	} else {
+		ret = v3d_mmu_flush_mmuc(v3d);
+	}
+	mutex_unlock(&v3d->mmu_lock);
+
+	if (ret)
 		dev_err(v3d->drm.dev, "MMU flush timeout\n");
 }
 
@@ -115,11 +242,74 @@ void v3d_mmu_remove_ptes(struct v3d_bo *bo)
 {
 	struct v3d_dev *v3d = to_v3d_dev(bo->base.base.dev);
 	u32 npages = bo->base.base.size >> V3D_MMU_PAGE_SHIFT;
-	u32 page;
+	u32 entries[V3D_MMU_MAX_SHOOT_DOWNS];
+	u32 page = bo->node.start;
+	u32 end = page + npages;
+	u32 count = 0;
+	int ret;
+
+	while (page < end) {
+		u32 pte = v3d->pt[page];
+		u32 step = 1;
+
+		if (pte & V3D_PTE_SUPERPAGE)
+			step = SZ_1M >> V3D_MMU_PAGE_SHIFT;
+		else if (pte & V3D_PTE_BIGPAGE)
+			step = SZ_64K >> V3D_MMU_PAGE_SHIFT;
+		step = min(step, end - page);
 
-	for (page = bo->node.start; page < bo->node.start + npages; page++)
-		v3d->pt[page] = 0;
+		if (count < ARRAY_SIZE(entries))
+			entries[count] = page;
+		count++;
 
-	if (v3d_mmu_flush_all(v3d))
+		for (; step; step--)
+			v3d->pt[page++] = 0;
+	}
+
+	mutex_lock(&v3d->mmu_lock);
+	if (v3d->mmu_batch) {
+		v3d->mmu_flush_pending = true;
+		ret = 0;
+	} else if (count <= ARRAY_SIZE(entries)) {
+		ret = v3d_mmu_flush_range(v3d, entries, count);
+	} else {
+		ret = v3d_mmu_flush_all(v3d);
+	}
+	mutex_unlock(&v3d->mmu_lock);
+
+	if (ret)
+		dev_err(v3d->drm.dev, "MMU flush timeout\n");
+}
+
+/**
+ * v3d_mmu_batch_begin() - Start deferring TLB invalidation of removed PTEs
+ * @v3d: V3D device
+ *
+ * Until the matching v3d_mmu_batch_end(), v3d_mmu_remove_ptes() only
+ * clears the PTEs, and the TLB gets cleared once at the end.
+ */
+void v3d_mmu_batch_begin(struct v3d_dev *v3d)
+{
+	mutex_lock(&v3d->mmu_lock);
+	v3d->mmu_batch++;
+	mutex_unlock(&v3d->mmu_lock);
+}
+
+/**
+ * v3d_mmu_batch_end() - Flush the TLB invalidations deferred by a batch
+ * @v3d: V3D device
+ */
+void v3d_mmu_batch_end(struct v3d_dev *v3d)
+{
+	int ret = 0;
+
+	mutex_lock(&v3d->mmu_lock);
+	if (!--v3d->mmu_batch && v3d->mmu_flush_pending) {
+		ret = v3d_mmu_flush_all(v3d);
+		v3d->mmu_flush_pending = false;
+	}
+	mutex_unlock(&v3d->mmu_lock);
+
+	if (ret)
 		dev_err(v3d->drm.dev, "MMU flush timeout\n");
 }
@@ -51,10 +51,7 @@
 #define DRIVER_MAJOR	1
 #define DRIVER_MINOR	0
 
-static struct vgem_device {
-	struct drm_device drm;
-	struct platform_device *platform;
-} *vgem_device;
+static struct vgem_device *vgem_device;
 
 static int vgem_open(struct drm_device *dev, struct drm_file *file)
 {
@@ -73,6 +70,13 @@ static int vgem_open(struct drm_device *dev, struct drm_file *file)
 		return ret;
 	}
 
+	ret = vgem_engine_open(to_vgem_device(dev), vfile);
+	if (ret) {
+		vgem_fence_close(vfile);
+		kfree(vfile);
+		return ret;
+	}
+
 	return 0;
 }
 
@@ -80,6 +84,7 @@ static void vgem_postclose(struct drm_device *dev, struct drm_file *file)
 {
 	struct vgem_file *vfile = file->driver_priv;
 
+	vgem_engine_close(to_vgem_device(dev), vfile);
 	vgem_fence_close(vfile);
 	kfree(vfile);
 }
@@ -87,6 +92,7 @@ static void vgem_postclose(struct drm_device *dev, struct drm_file *file)
 static struct drm_ioctl_desc vgem_ioctls[] = {
 	DRM_IOCTL_DEF_DRV(VGEM_FENCE_ATTACH, vgem_fence_attach_ioctl, DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(VGEM_FENCE_SIGNAL, vgem_fence_signal_ioctl, DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(VGEM_SUBMIT, vgem_submit_ioctl, DRM_RENDER_ALLOW),
 };
 
 DEFINE_DRM_GEM_FOPS(vgem_driver_fops);
@@ -109,7 +115,7 @@ static struct drm_gem_object *vgem_gem_create_object(struct drm_device *dev, siz
 }
 
 static const struct drm_driver vgem_driver = {
-	.driver_features		= DRIVER_GEM | DRIVER_RENDER,
+	.driver_features		= DRIVER_GEM | DRIVER_RENDER | DRIVER_SYNCOBJ,
 	.open				= vgem_open,
 	.postclose			= vgem_postclose,
 	.ioctls				= vgem_ioctls,
@@ -151,13 +157,19 @@ static int __init vgem_init(void)
 	}
 	vgem_device->platform = pdev;
 
+	ret = vgem_engine_init(vgem_device);
+	if (ret)
+		goto out_devres;
+
 	/* Final step: expose the device/driver to userspace */
 	ret = drm_dev_register(&vgem_device->drm, 0);
 	if (ret)
-		goto out_devres;
+		goto out_engine;
 
 	return 0;
 
+out_engine:
+	vgem_engine_fini(vgem_device);
 out_devres:
 	devres_release_group(&pdev->dev, NULL);
 out_unregister:
@@ -170,6 +182,7 @@ static void __exit vgem_exit(void)
 	struct platform_device *pdev = vgem_device->platform;
 
 	drm_dev_unregister(&vgem_device->drm);
+	vgem_engine_fini(vgem_device);
 	devres_release_group(&pdev->dev, NULL);
 	platform_device_unregister(pdev);
 }
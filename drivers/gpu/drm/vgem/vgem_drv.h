@@ -29,14 +29,33 @@
 #ifndef _VGEM_DRV_H_
 #define _VGEM_DRV_H_
 
+#include <drm/drm_device.h>
 #include <drm/drm_gem.h>
 #include <drm/drm_cache.h>
+#include <drm/gpu_scheduler.h>
 
 #include <uapi/drm/vgem_drm.h>
 
+struct vgem_engine;
+
+struct vgem_device {
+	struct drm_device drm;
+	struct platform_device *platform;
+
+	struct vgem_engine *engines;
+	unsigned int num_engines;
+};
+
+#define to_vgem_device(x) container_of(x, struct vgem_device, drm)
+
 struct vgem_file {
 	struct idr fence_idr;
 	struct mutex fence_mutex;
+
+	/* one scheduler entity per virtual engine */
+	struct drm_sched_entity *entities;
+	/* keeps arming and pushing jobs to the entities in order */
+	struct mutex sched_lock;
 };
 
 #define to_vgem_bo(x) container_of(x, struct drm_vgem_gem_object, base)
@@ -59,4 +78,12 @@ int vgem_fence_signal_ioctl(struct drm_device *dev,
 			    struct drm_file *file);
 void vgem_fence_close(struct vgem_file *file);
 
+int vgem_engine_init(struct vgem_device *vdev);
+void vgem_engine_fini(struct vgem_device *vdev);
+int vgem_engine_open(struct vgem_device *vdev, struct vgem_file *file);
+void vgem_engine_close(struct vgem_device *vdev, struct vgem_file *file);
+int vgem_submit_ioctl(struct drm_device *dev,
+		      void *data,
+		      struct drm_file *file);
+
 #endif
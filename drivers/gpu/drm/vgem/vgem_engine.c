@@ -0,0 +1,474 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Virtual engines for vGEM.
+ *
+ * When vgem is loaded with engines > 0, DRM_IOCTL_VGEM_SUBMIT runs emulated
+ * jobs through a real drm_gpu_scheduler per engine. A job takes part in
+ * implicit (dma_resv) and explicit (syncobj) synchronisation just like one on
+ * real hardware, and its "execution" is a hrtimer expiring after a duration
+ * chosen by userspace. Each engine executes its jobs back to back, so queueing
+ * behaves as on a real ring. This allows benchmarking and regression testing
+ * the scheduler, fence and reservation object paths without a GPU.
+ */
+
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+
+#include <drm/drm_drv.h>
+#include <drm/drm_file.h>
+#include <drm/drm_managed.h>
+#include <drm/drm_syncobj.h>
+
+#include "vgem_drv.h"
+
+#define VGEM_MAX_ENGINES	8
+/* Jobs handed to an engine ahead of the one it is executing */
+#define VGEM_ENGINE_DEPTH	8
+/* Like the vgem fences, no job may keep an engine busy for more than 10s */
+#define VGEM_SUBMIT_MAX_NS	(10 * NSEC_PER_SEC)
+
+static unsigned int engines;
+module_param(engines, uint, 0444);
+MODULE_PARM_DESC(engines, "Number of virtual engines for DRM_IOCTL_VGEM_SUBMIT (0 = disabled, max 8)");
+
+struct vgem_engine {
+	struct drm_gpu_scheduler sched;
+	char name[16];
+
+	u64 fence_context;
+
+	/* protects the fields below and is the lock of the engine's fences */
+	spinlock_t lock;
+	u64 seqno;
+	/* when the last job handed to the engine completes */
+	ktime_t busy_until;
+	struct dma_fence *last;
+};
+
+struct vgem_hw_fence {
+	struct dma_fence base;
+	struct hrtimer timer;
+};
+
+struct vgem_job {
+	struct drm_sched_job base;
+	struct vgem_engine *engine;
+
+	struct drm_gem_object **bos;
+	u32 bo_count;
+
+	u64 exec_ns;
+};
+
+static inline struct vgem_job *to_vgem_job(struct drm_sched_job *sched_job)
+{
+	return container_of(sched_job, struct vgem_job, base);
+}
+
+static inline struct vgem_hw_fence *to_vgem_hw_fence(struct dma_fence *fence)
+{
+	return container_of(fence, struct vgem_hw_fence, base);
+}
+
+static const char *vgem_hw_fence_get_driver_name(struct dma_fence *fence)
+{
+	return "vgem";
+}
+
+static const char *vgem_hw_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return container_of(fence->lock, struct vgem_engine, lock)->name;
+}
+
+static const struct dma_fence_ops vgem_hw_fence_ops = {
+	.get_driver_name = vgem_hw_fence_get_driver_name,
+	.get_timeline_name = vgem_hw_fence_get_timeline_name,
+};
+
+static enum hrtimer_restart vgem_hw_fence_expire(struct hrtimer *timer)
+{
+	struct vgem_hw_fence *fence = container_of(timer, typeof(*fence), timer);
+
+	dma_fence_signal(&fence->base);
+	/* the fence is freed after a grace period, so this may drop the last ref */
+	dma_fence_put(&fence->base);
+
+	return HRTIMER_NORESTART;
+}
+
+static struct dma_fence *vgem_job_run(struct drm_sched_job *sched_job)
+{
+	struct vgem_job *job = to_vgem_job(sched_job);
+	struct vgem_engine *engine = job->engine;
+	struct vgem_hw_fence *fence;
+	struct dma_fence *last;
+	unsigned long flags;
+	ktime_t start;
+
+	if (unlikely(sched_job->s_fence->finished.error))
+		return NULL;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence)
+		return ERR_PTR(-ENOMEM);
+
+	hrtimer_init(&fence->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	fence->timer.function = vgem_hw_fence_expire;
+
+	spin_lock_irqsave(&engine->lock, flags);
+	dma_fence_init(&fence->base, &vgem_hw_fence_ops, &engine->lock,
+		       engine->fence_context, ++engine->seqno);
+
+	/* the engine executes its jobs one after the other */
+	start = ktime_get();
+	if (ktime_before(start, engine->busy_until))
+		start = engine->busy_until;
+	engine->busy_until = ktime_add_ns(start, job->exec_ns);
+
+	last = engine->last;
+	engine->last = dma_fence_get(&fence->base);
+
+	/* the timer holds a reference until it signals the fence */
+	dma_fence_get(&fence->base);
+	hrtimer_start(&fence->timer, engine->busy_until, HRTIMER_MODE_ABS);
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+	dma_fence_put(last);
+
+	return &fence->base;
+}
+
+static enum drm_gpu_sched_stat vgem_job_timedout(struct drm_sched_job *sched_job)
+{
+	/* jobs always complete, the schedulers run without a timeout */
+	return DRM_GPU_SCHED_STAT_NOMINAL;
+}
+
+static void vgem_job_put_bos(struct vgem_job *job)
+{
+	unsigned int i;
+
+	if (!job->bos)
+		return;
+
+	for (i = 0; i < job->bo_count; i++)
+		if (job->bos[i])
+			drm_gem_object_put(job->bos[i]);
+
+	kvfree(job->bos);
+}
+
+static void vgem_job_free(struct drm_sched_job *sched_job)
+{
+	struct vgem_job *job = to_vgem_job(sched_job);
+
+	drm_sched_job_cleanup(sched_job);
+	vgem_job_put_bos(job);
+	kfree(job);
+}
+
+static const struct drm_sched_backend_ops vgem_sched_ops = {
+	.run_job = vgem_job_run,
+	.timedout_job = vgem_job_timedout,
+	.free_job = vgem_job_free,
+};
+
+/*
+ * Sample an exponential distribution with the given mean: -ln(u) * mean for a
+ * uniform u in (0, 1], with log2 interpolated linearly between powers of two.
+ */
+static u64 vgem_exp_ns(u64 mean)
+{
+	u32 x = prandom_u32() | 1;
+	unsigned int k = ilog2(x);
+	u64 nlog2, nln;
+
+	/* -log2(x / 2^32) in 16.16 fixed point */
+	nlog2 = ((u64)(32 - k) << 16) - (((u64)(x - BIT(k)) << 16) >> k);
+	/* ln(2) = 45426 / 2^16 */
+	nln = (nlog2 * 45426) >> 16;
+
+	return mul_u64_u32_shr(mean, min_t(u64, nln, 16 << 16), 16);
+}
+
+static u64 vgem_submit_exec_ns(const struct drm_vgem_submit *args)
+{
+	u64 ns = args->exec_ns;
+	u64 r;
+
+	switch (args->distribution) {
+	case VGEM_SUBMIT_UNIFORM:
+		div64_u64_rem(get_random_u64(), 2 * args->jitter_ns + 1, &r);
+		ns = ns - args->jitter_ns + r;
+		break;
+	case VGEM_SUBMIT_EXPONENTIAL:
+		ns = vgem_exp_ns(ns);
+		break;
+	}
+
+	return min_t(u64, ns, VGEM_SUBMIT_MAX_NS);
+}
+
+static int vgem_job_lock_bos(struct vgem_job *job, bool write,
+			     struct ww_acquire_ctx *acquire_ctx)
+{
+	unsigned int i;
+	int ret;
+
+	ret = drm_gem_lock_reservations(job->bos, job->bo_count, acquire_ctx);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < job->bo_count; i++) {
+		if (!write) {
+			ret = dma_resv_reserve_shared(job->bos[i]->resv, 1);
+			if (ret)
+				goto err;
+		}
+
+		ret = drm_sched_job_add_implicit_dependencies(&job->base,
+							      job->bos[i],
+							      write);
+		if (ret)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	drm_gem_unlock_reservations(job->bos, job->bo_count, acquire_ctx);
+	return ret;
+}
+
+/*
+ * vgem_submit_ioctl (DRM_IOCTL_VGEM_SUBMIT):
+ *
+ * Queue an emulated job for one of the virtual engines. The job depends on the
+ * in_sync syncobj and on the fences in the reservation objects of its BOs, as
+ * a writer if the flags contain VGEM_SUBMIT_WRITE and as a reader otherwise.
+ * Its scheduler fence is added to the BOs and installed in the out_sync
+ * syncobj. Once the job reaches the engine, it completes after a duration
+ * drawn from the requested distribution, at most 10 seconds.
+ *
+ * Returns -ENODEV if vgem has no virtual engines.
+ */
+int vgem_submit_ioctl(struct drm_device *dev,
+		      void *data,
+		      struct drm_file *file)
+{
+	struct vgem_device *vdev = to_vgem_device(dev);
+	struct vgem_file *vfile = file->driver_priv;
+	struct drm_vgem_submit *args = data;
+	bool write = args->flags & VGEM_SUBMIT_WRITE;
+	struct drm_syncobj *sync_out = NULL;
+	struct ww_acquire_ctx acquire_ctx;
+	struct dma_fence *fence;
+	struct vgem_job *job;
+	unsigned int i;
+	int ret;
+
+	if (!vdev->num_engines)
+		return -ENODEV;
+
+	if (args->flags & ~VGEM_SUBMIT_WRITE)
+		return -EINVAL;
+
+	if (args->engine >= vdev->num_engines)
+		return -EINVAL;
+
+	if (args->distribution > VGEM_SUBMIT_EXPONENTIAL ||
+	    args->exec_ns > VGEM_SUBMIT_MAX_NS)
+		return -EINVAL;
+
+	if (args->distribution == VGEM_SUBMIT_UNIFORM ?
+	    args->jitter_ns > args->exec_ns : args->jitter_ns)
+		return -EINVAL;
+
+	if (args->out_sync) {
+		sync_out = drm_syncobj_find(file, args->out_sync);
+		if (!sync_out)
+			return -ENOENT;
+	}
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job) {
+		ret = -ENOMEM;
+		goto out_put_syncout;
+	}
+
+	job->engine = &vdev->engines[args->engine];
+	job->exec_ns = vgem_submit_exec_ns(args);
+
+	ret = drm_sched_job_init(&job->base, &vfile->entities[args->engine],
+				 vfile);
+	if (ret) {
+		kfree(job);
+		goto out_put_syncout;
+	}
+
+	if (args->in_sync) {
+		ret = drm_syncobj_find_fence(file, args->in_sync, 0, 0, &fence);
+		if (ret)
+			goto out_cleanup_job;
+
+		ret = drm_sched_job_add_dependency(&job->base, fence);
+		if (ret)
+			goto out_cleanup_job;
+	}
+
+	if (args->bo_handle_count) {
+		job->bo_count = args->bo_handle_count;
+		ret = drm_gem_objects_lookup(file,
+					     u64_to_user_ptr(args->bo_handles),
+					     job->bo_count, &job->bos);
+		if (ret)
+			goto out_cleanup_job;
+	}
+
+	ret = vgem_job_lock_bos(job, write, &acquire_ctx);
+	if (ret)
+		goto out_cleanup_job;
+
+	mutex_lock(&vfile->sched_lock);
+	drm_sched_job_arm(&job->base);
+	fence = dma_fence_get(&job->base.s_fence->finished);
+
+	for (i = 0; i < job->bo_count; i++) {
+		if (write)
+			dma_resv_add_excl_fence(job->bos[i]->resv, fence);
+		else
+			dma_resv_add_shared_fence(job->bos[i]->resv, fence);
+	}
+
+	drm_sched_entity_push_job(&job->base);
+	mutex_unlock(&vfile->sched_lock);
+
+	drm_gem_unlock_reservations(job->bos, job->bo_count, &acquire_ctx);
+
+	if (sync_out)
+		drm_syncobj_replace_fence(sync_out, fence);
+	dma_fence_put(fence);
+
+	goto out_put_syncout;
+
+out_cleanup_job:
+	drm_sched_job_cleanup(&job->base);
+	vgem_job_put_bos(job);
+	kfree(job);
+out_put_syncout:
+	if (sync_out)
+		drm_syncobj_put(sync_out);
+
+	return ret;
+}
+
+int vgem_engine_open(struct vgem_device *vdev, struct vgem_file *vfile)
+{
+	struct drm_gpu_scheduler *sched;
+	unsigned int i;
+	int ret;
+
+	mutex_init(&vfile->sched_lock);
+
+	if (!vdev->num_engines)
+		return 0;
+
+	vfile->entities = kcalloc(vdev->num_engines, sizeof(*vfile->entities),
+				  GFP_KERNEL);
+	if (!vfile->entities)
+		return -ENOMEM;
+
+	for (i = 0; i < vdev->num_engines; i++) {
+		sched = &vdev->engines[i].sched;
+		ret = drm_sched_entity_init(&vfile->entities[i],
+					    DRM_SCHED_PRIORITY_NORMAL,
+					    &sched, 1, NULL);
+		if (ret)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	while (i--)
+		drm_sched_entity_destroy(&vfile->entities[i]);
+	kfree(vfile->entities);
+	vfile->entities = NULL;
+	return ret;
+}
+
+void vgem_engine_close(struct vgem_device *vdev, struct vgem_file *vfile)
+{
+	unsigned int i;
+
+	if (!vfile->entities)
+		return;
+
+	for (i = 0; i < vdev->num_engines; i++)
+		drm_sched_entity_destroy(&vfile->entities[i]);
+
+	kfree(vfile->entities);
+}
+
+int vgem_engine_init(struct vgem_device *vdev)
+{
+	unsigned int i, count = min_t(unsigned int, engines, VGEM_MAX_ENGINES);
+	int ret;
+
+	if (!count) {
+		/* syncobjs are only useful together with the virtual engines */
+		vdev->drm.driver_features &= ~DRIVER_SYNCOBJ;
+		return 0;
+	}
+
+	vdev->engines = drmm_kcalloc(&vdev->drm, count, sizeof(*vdev->engines),
+				     GFP_KERNEL);
+	if (!vdev->engines)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		struct vgem_engine *engine = &vdev->engines[i];
+
+		spin_lock_init(&engine->lock);
+		engine->fence_context = dma_fence_context_alloc(1);
+		snprintf(engine->name, sizeof(engine->name), "vgem-engine%u", i);
+
+		ret = drm_sched_init(&engine->sched, &vgem_sched_ops, NULL,
+				     VGEM_ENGINE_DEPTH, 0, MAX_SCHEDULE_TIMEOUT,
+				     NULL, NULL, engine->name,
+				     DRM_SCHED_POLICY_DEFAULT);
+		if (ret) {
+			vdev->num_engines = i;
+			vgem_engine_fini(vdev);
+			return ret;
+		}
+	}
+
+	vdev->num_engines = count;
+
+	return 0;
+}
+
+void vgem_engine_fini(struct vgem_device *vdev)
+{
+	unsigned int i;
+
+	for (i = 0; i < vdev->num_engines; i++) {
+		struct vgem_engine *engine = &vdev->engines[i];
+
+		/* all files are closed, let the last job run off the engine */
+		if (engine->last) {
+			dma_fence_wait(engine->last, false);
+			hrtimer_cancel(&to_vgem_hw_fence(engine->last)->timer);
+			dma_fence_put(engine->last);
+			engine->last = NULL;
+		}
+
+		drm_sched_fini(&engine->sched);
+	}
+
+	vdev->num_engines = 0;
+}
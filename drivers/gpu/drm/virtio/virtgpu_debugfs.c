@@ -75,6 +75,21 @@ virtio_gpu_debugfs_irq_info(struct seq_file *m, void *data)
 	return 0;
 }
 
+static int
+virtio_gpu_debugfs_kicks(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = (struct drm_info_node *)m->private;
+	struct virtio_gpu_device *vgdev = node->minor->dev->dev_private;
+
+	seq_printf(m, "%-16s : %lld\n", "ctrlq kicks",
+		   (s64)atomic64_read(&vgdev->ctrlq_kicks));
+	seq_printf(m, "%-16s : %lld\n", "cursorq kicks",
+		   (s64)atomic64_read(&vgdev->cursorq_kicks));
+	seq_printf(m, "%-16s : %lld\n", "batched notifies",
+		   (s64)atomic64_read(&vgdev->notifies_batched));
+	return 0;
+}
+
 static int
 virtio_gpu_debugfs_host_visible_mm(struct seq_file *m, void *data)
 {
@@ -96,6 +111,7 @@ static struct drm_info_list virtio_gpu_debugfs_list[] = {
 	{ "virtio-gpu-features", virtio_gpu_features },
 	{ "virtio-gpu-irq-fence", virtio_gpu_debugfs_irq_info, 0, NULL },
 	{ "virtio-gpu-host-visible-mm", virtio_gpu_debugfs_host_visible_mm },
+	{ "virtio-gpu-kicks", virtio_gpu_debugfs_kicks },
 };
 
 #define VIRTIO_GPU_DEBUGFS_ENTRIES ARRAY_SIZE(virtio_gpu_debugfs_list)
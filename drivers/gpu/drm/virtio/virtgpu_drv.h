@@ -27,6 +27,7 @@
 #define VIRTIO_DRV_H
 
 #include <linux/dma-direction.h>
+#include <linux/scatterlist.h>
 #include <linux/virtio.h>
 #include <linux/virtio_ids.h>
 #include <linux/virtio_config.h>
@@ -79,6 +80,7 @@ struct virtio_gpu_object_params {
 
 	/* blob resources only */
 	uint32_t ctx_id;
+	uint64_t ctx_seqno;
 	uint32_t blob_mem;
 	uint32_t blob_flags;
 	uint64_t blob_id;
@@ -109,6 +111,11 @@ struct virtio_gpu_object_vram {
 	uint32_t map_state;
 	uint32_t map_info;
 	struct drm_mm_node vram_node;
+
+	/* the host resource may be reused once the BO is freed */
+	bool reusable;
+	uint64_t ctx_seqno;
+	struct list_head cache_head;
 };
 
 #define to_virtio_gpu_shmem(virtio_gpu_object) \
@@ -226,8 +233,31 @@ struct virtio_gpu_device {
 	struct virtio_gpu_queue cursorq;
 	struct kmem_cache *vbufs;
 
+	/* free vbufs kept for reuse, see virtio_gpu_get_vbuf() */
+	spinlock_t vbuf_pool_lock;
+	struct list_head vbuf_pool;
+	unsigned int vbuf_pool_count;
+	unsigned int vbuf_pool_target;
+	unsigned int vbufs_in_flight;
+
+	/* sg table reused for vmalloc'ed command data */
+	struct mutex data_sgt_lock;
+	struct sg_table data_sgt;
+	struct scatterlist *data_sgt_end;
+
 	atomic_t pending_commands;
 
+	/* task batching ctrlq notifies, see virtio_gpu_batch_begin() */
+	struct mutex batch_lock;
+	struct task_struct *batch_owner;
+	unsigned int batch_depth;
+
+	/* kicks that reached the host, each one is a VM exit */
+	atomic64_t ctrlq_kicks;
+	atomic64_t cursorq_kicks;
+	/* notifies folded into a later kick by a batch */
+	atomic64_t notifies_batched;
+
 	struct ida	resource_ida;
 
 	wait_queue_head_t resp_wq;
@@ -262,12 +292,20 @@ struct virtio_gpu_device {
 
 	/* protects uuid state when exporting */
 	spinlock_t resource_export_lock;
-	/* protects map state and host_visible_mm */
+	/* protects map state, host_visible_mm and the vram cache */
 	spinlock_t host_visible_lock;
+
+	/* freed mapped blobs kept for reuse, least recently freed first */
+	struct list_head vram_cache;
+	unsigned int vram_cache_count;
+
+	atomic64_t ctx_seqno;
 };
 
 struct virtio_gpu_fpriv {
 	uint32_t ctx_id;
+	/* unlike ctx_id never recycled for another file */
+	uint64_t ctx_seqno;
 	uint32_t context_init;
 	bool context_created;
 	uint32_t num_rings;
@@ -400,6 +438,9 @@ void virtio_gpu_dequeue_cursor_func(struct work_struct *work);
 void virtio_gpu_dequeue_fence_func(struct work_struct *work);
 
 void virtio_gpu_notify(struct virtio_gpu_device *vgdev);
+void virtio_gpu_kick(struct virtio_gpu_device *vgdev);
+void virtio_gpu_batch_begin(struct virtio_gpu_device *vgdev);
+void virtio_gpu_batch_end(struct virtio_gpu_device *vgdev);
 
 int
 virtio_gpu_cmd_resource_assign_uuid(struct virtio_gpu_device *vgdev,
@@ -482,6 +523,9 @@ int virtio_gpu_vram_create(struct virtio_gpu_device *vgdev,
 struct sg_table *virtio_gpu_vram_map_dma_buf(struct virtio_gpu_object *bo,
 					     struct device *dev,
 					     enum dma_data_direction dir);
+void virtio_gpu_vram_cache_evict(struct virtio_gpu_device *vgdev,
+				 uint64_t ctx_seqno);
+void virtio_gpu_vram_cache_fini(struct virtio_gpu_device *vgdev);
 void virtio_gpu_vram_unmap_dma_buf(struct device *dev,
 				   struct sg_table *sgt,
 				   enum dma_data_direction dir);
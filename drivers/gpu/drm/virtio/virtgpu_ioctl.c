@@ -641,6 +641,7 @@ static int verify_blob(struct virtio_gpu_device *vgdev,
 			return -EINVAL;
 
 		params->ctx_id = vfpriv->ctx_id;
+		params->ctx_seqno = vfpriv->ctx_seqno;
 		params->blob_id = rc_blob->blob_id;
 	} else {
 		if (rc_blob->blob_id != 0)
@@ -136,8 +136,10 @@ int virtio_gpu_init(struct drm_device *dev)
 	vgdev->dev = dev->dev;
 
 	spin_lock_init(&vgdev->display_info_lock);
+	mutex_init(&vgdev->batch_lock);
 	spin_lock_init(&vgdev->resource_export_lock);
 	spin_lock_init(&vgdev->host_visible_lock);
+	INIT_LIST_HEAD(&vgdev->vram_cache);
 	ida_init(&vgdev->ctx_id_ida);
 	ida_init(&vgdev->resource_ida);
 	init_waitqueue_head(&vgdev->resp_wq);
@@ -293,6 +295,7 @@ void virtio_gpu_release(struct drm_device *dev)
 	virtio_gpu_modeset_fini(vgdev);
 	virtio_gpu_free_vbufs(vgdev);
 	virtio_gpu_cleanup_cap_cache(vgdev);
+	virtio_gpu_vram_cache_fini(vgdev);
 
 	if (vgdev->has_host_visible)
 		drm_mm_takedown(&vgdev->host_visible_mm);
@@ -325,6 +328,7 @@ int virtio_gpu_driver_open(struct drm_device *dev, struct drm_file *file)
 	}
 
 	vfpriv->ctx_id = handle + 1;
+	vfpriv->ctx_seqno = atomic64_inc_return(&vgdev->ctx_seqno);
 	file->driver_priv = vfpriv;
 	return 0;
 }
@@ -337,6 +341,8 @@ void virtio_gpu_driver_postclose(struct drm_device *dev, struct drm_file *file)
 	if (!vgdev->has_virgl_3d)
 		return;
 
+	virtio_gpu_vram_cache_evict(vgdev, vfpriv->ctx_seqno);
+
 	if (vfpriv->context_created) {
 		virtio_gpu_cmd_context_destroy(vgdev, vfpriv->ctx_id);
 		virtio_gpu_notify(vgdev);
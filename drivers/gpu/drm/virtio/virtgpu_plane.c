@@ -30,6 +30,12 @@
 
 #include "virtgpu_drv.h"
 
+/*
+ * Plane updates with up to this many damage clips transfer and flush each
+ * clip on its own, more clips are merged into their bounding box.
+ */
+#define VIRTIO_GPU_MAX_DAMAGE_CLIPS 8
+
 static const uint32_t virtio_gpu_formats[] = {
 	DRM_FORMAT_HOST_XRGB8888,
 };
@@ -150,7 +156,7 @@ static void virtio_gpu_resource_flush(struct drm_plane *plane,
 		virtio_gpu_array_lock_resv(objs);
 		virtio_gpu_cmd_resource_flush(vgdev, bo->hw_res_handle, x, y,
 					      width, height, objs, vgfb->fence);
-		virtio_gpu_notify(vgdev);
+		virtio_gpu_kick(vgdev);
 
 		dma_fence_wait_timeout(&vgfb->fence->f, true,
 				       msecs_to_jiffies(50));
@@ -163,6 +169,41 @@ static void virtio_gpu_resource_flush(struct drm_plane *plane,
 	}
 }
 
+/*
+ * Collect the damage clips of a plane update into @clips.  Returns the
+ * number of clips to update one by one, or 0 if the bounding box @bbox
+ * should be used instead because there are too many clips, or because
+ * they cover most of the bounding box anyway.
+ */
+static unsigned int virtio_gpu_damage_clips(struct drm_plane_state *old_state,
+					    struct drm_plane_state *state,
+					    const struct drm_rect *bbox,
+					    struct drm_rect *clips)
+{
+	struct drm_atomic_helper_damage_iter iter;
+	struct drm_rect clip;
+	unsigned int num = 0;
+	u64 area = 0;
+
+	drm_atomic_helper_damage_iter_init(&iter, old_state, state);
+	drm_atomic_for_each_plane_damage(&iter, &clip) {
+		if (num == VIRTIO_GPU_MAX_DAMAGE_CLIPS)
+			return 0;
+
+		clips[num++] = clip;
+		area += (u64)drm_rect_width(&clip) * drm_rect_height(&clip);
+	}
+
+	if (num < 2)
+		return 0;
+
+	/* overlapping clips would transfer the overlap more than once */
+	if (area * 4 >= (u64)drm_rect_width(bbox) * drm_rect_height(bbox) * 3)
+		return 0;
+
+	return num;
+}
+
 static void virtio_gpu_primary_plane_update(struct drm_plane *plane,
 					    struct drm_atomic_state *state)
 {
@@ -170,9 +211,11 @@ static void virtio_gpu_primary_plane_update(struct drm_plane *plane,
 									   plane);
 	struct drm_device *dev = plane->dev;
 	struct virtio_gpu_device *vgdev = dev->dev_private;
+	struct drm_rect clips[VIRTIO_GPU_MAX_DAMAGE_CLIPS];
 	struct virtio_gpu_output *output = NULL;
 	struct virtio_gpu_object *bo;
 	struct drm_rect rect;
+	unsigned int i, num_clips;
 
 	if (plane->state->crtc)
 		output = drm_crtc_to_virtio_gpu_output(plane->state->crtc);
@@ -194,9 +237,19 @@ static void virtio_gpu_primary_plane_update(struct drm_plane *plane,
 	if (!drm_atomic_helper_damage_merged(old_state, plane->state, &rect))
 		return;
 
+	num_clips = virtio_gpu_damage_clips(old_state, plane->state, &rect,
+					    clips);
+	if (!num_clips) {
+		clips[0] = rect;
+		num_clips = 1;
+	}
+
 	bo = gem_to_virtio_gpu_obj(plane->state->fb->obj[0]);
-	if (bo->dumb)
-		virtio_gpu_update_dumb_bo(vgdev, plane->state, &rect);
+	if (bo->dumb) {
+		for (i = 0; i < num_clips; i++)
+			virtio_gpu_update_dumb_bo(vgdev, plane->state,
+						  &clips[i]);
+	}
 
 	if (plane->state->fb != old_state->fb ||
 	    plane->state->src_w != old_state->src_w ||
@@ -232,11 +285,19 @@ static void virtio_gpu_primary_plane_update(struct drm_plane *plane,
 		}
 	}
 
+	/* only the last flush waits for the host, if at all */
+	for (i = 0; i < num_clips - 1; i++)
+		virtio_gpu_cmd_resource_flush(vgdev, bo->hw_res_handle,
+					      clips[i].x1, clips[i].y1,
+					      drm_rect_width(&clips[i]),
+					      drm_rect_height(&clips[i]),
+					      NULL, NULL);
+
 	virtio_gpu_resource_flush(plane,
-				  rect.x1,
-				  rect.y1,
-				  rect.x2 - rect.x1,
-				  rect.y2 - rect.y1);
+				  clips[i].x1,
+				  clips[i].y1,
+				  clips[i].x2 - clips[i].x1,
+				  clips[i].y2 - clips[i].y1);
 }
 
 static int virtio_gpu_plane_prepare_fb(struct drm_plane *plane,
@@ -321,7 +382,7 @@ static void virtio_gpu_cursor_plane_update(struct drm_plane *plane,
 			 plane->state->crtc_w,
 			 plane->state->crtc_h,
 			 0, 0, objs, vgfb->fence);
-		virtio_gpu_notify(vgdev);
+		virtio_gpu_kick(vgdev);
 		dma_fence_wait(&vgfb->fence->f, true);
 		dma_fence_put(&vgfb->fence->f);
 		vgfb->fence = NULL;
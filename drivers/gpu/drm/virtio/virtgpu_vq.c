@@ -27,6 +27,7 @@
  */
 
 #include <linux/dma-mapping.h>
+#include <linux/log2.h>
 #include <linux/virtio.h>
 #include <linux/virtio_config.h>
 #include <linux/virtio_ring.h>
@@ -35,11 +36,20 @@
 #include "virtgpu_trace.h"
 
 #define MAX_INLINE_CMD_SIZE   96
-#define MAX_INLINE_RESP_SIZE  24
+/* large enough for the frequent uuid and map_info responses */
+#define MAX_INLINE_RESP_SIZE  40
 #define VBUFFER_SIZE          (sizeof(struct virtio_gpu_vbuffer) \
 			       + MAX_INLINE_CMD_SIZE		 \
 			       + MAX_INLINE_RESP_SIZE)
 
+/*
+ * Free vbufs are kept in a per device pool instead of going back to the
+ * slab.  The pool starts with VBUF_POOL_MIN entries and grows with the
+ * peak number of vbufs in flight, up to VBUF_POOL_MAX.
+ */
+#define VBUF_POOL_MIN         64
+#define VBUF_POOL_MAX         1024
+
 static void convert_to_hw_box(struct virtio_gpu_box *dst,
 			      const struct drm_virtgpu_3d_box *src)
 {
@@ -69,17 +79,43 @@ void virtio_gpu_cursor_ack(struct virtqueue *vq)
 
 int virtio_gpu_alloc_vbufs(struct virtio_gpu_device *vgdev)
 {
+	struct virtio_gpu_vbuffer *vbuf;
+	unsigned int i;
+
 	vgdev->vbufs = kmem_cache_create("virtio-gpu-vbufs",
 					 VBUFFER_SIZE,
 					 __alignof__(struct virtio_gpu_vbuffer),
 					 0, NULL);
 	if (!vgdev->vbufs)
 		return -ENOMEM;
+
+	spin_lock_init(&vgdev->vbuf_pool_lock);
+	INIT_LIST_HEAD(&vgdev->vbuf_pool);
+	vgdev->vbuf_pool_target = VBUF_POOL_MIN;
+	mutex_init(&vgdev->data_sgt_lock);
+
+	for (i = 0; i < VBUF_POOL_MIN; i++) {
+		vbuf = kmem_cache_alloc(vgdev->vbufs, GFP_KERNEL);
+		if (!vbuf)
+			break;
+		list_add(&vbuf->list, &vgdev->vbuf_pool);
+		vgdev->vbuf_pool_count++;
+	}
 	return 0;
 }
 
 void virtio_gpu_free_vbufs(struct virtio_gpu_device *vgdev)
 {
+	struct virtio_gpu_vbuffer *vbuf, *tmp;
+
+	list_for_each_entry_safe(vbuf, tmp, &vgdev->vbuf_pool, list)
+		kmem_cache_free(vgdev->vbufs, vbuf);
+	INIT_LIST_HEAD(&vgdev->vbuf_pool);
+	vgdev->vbuf_pool_count = 0;
+
+	if (vgdev->data_sgt.sgl)
+		sg_free_table(&vgdev->data_sgt);
+
 	kmem_cache_destroy(vgdev->vbufs);
 	vgdev->vbufs = NULL;
 }
@@ -90,8 +126,27 @@ virtio_gpu_get_vbuf(struct virtio_gpu_device *vgdev,
 		    virtio_gpu_resp_cb resp_cb)
 {
 	struct virtio_gpu_vbuffer *vbuf;
+	unsigned int in_flight;
+
+	spin_lock(&vgdev->vbuf_pool_lock);
+	vbuf = list_first_entry_or_null(&vgdev->vbuf_pool,
+					struct virtio_gpu_vbuffer, list);
+	if (vbuf) {
+		list_del(&vbuf->list);
+		vgdev->vbuf_pool_count--;
+	}
 
-	vbuf = kmem_cache_zalloc(vgdev->vbufs, GFP_KERNEL | __GFP_NOFAIL);
+	/* keep as many vbufs around as were ever needed at once */
+	in_flight = ++vgdev->vbufs_in_flight;
+	if (in_flight > vgdev->vbuf_pool_target)
+		vgdev->vbuf_pool_target = min(in_flight, VBUF_POOL_MAX);
+	spin_unlock(&vgdev->vbuf_pool_lock);
+
+	if (vbuf)
+		memset(vbuf, 0, VBUFFER_SIZE);
+	else
+		vbuf = kmem_cache_zalloc(vgdev->vbufs,
+					 GFP_KERNEL | __GFP_NOFAIL);
 
 	BUG_ON(size > MAX_INLINE_CMD_SIZE ||
 	       size < sizeof(struct virtio_gpu_ctrl_hdr));
@@ -174,7 +229,18 @@ static void free_vbuf(struct virtio_gpu_device *vgdev,
 	if (vbuf->resp_size > MAX_INLINE_RESP_SIZE)
 		kfree(vbuf->resp_buf);
 	kvfree(vbuf->data_buf);
-	kmem_cache_free(vgdev->vbufs, vbuf);
+
+	spin_lock(&vgdev->vbuf_pool_lock);
+	vgdev->vbufs_in_flight--;
+	if (vgdev->vbuf_pool_count < vgdev->vbuf_pool_target) {
+		list_add(&vbuf->list, &vgdev->vbuf_pool);
+		vgdev->vbuf_pool_count++;
+		vbuf = NULL;
+	}
+	spin_unlock(&vgdev->vbuf_pool_lock);
+
+	if (vbuf)
+		kmem_cache_free(vgdev->vbufs, vbuf);
 }
 
 static void reclaim_vbufs(struct virtqueue *vq, struct list_head *reclaim_list)
@@ -265,44 +331,61 @@ void virtio_gpu_dequeue_cursor_func(struct work_struct *work)
 	wake_up(&vgdev->cursorq.ack_queue);
 }
 
-/* Create sg_table from a vmalloc'd buffer. */
-static struct sg_table *vmalloc_to_sgt(char *data, uint32_t size, int *sg_ents)
+/*
+ * Point the device's reusable sg table at a vmalloc'd buffer.  The table
+ * only gets reallocated when a buffer needs more entries than it has.
+ */
+static struct scatterlist *vmalloc_to_sgl(struct virtio_gpu_device *vgdev,
+					  char *data, uint32_t size,
+					  int *sg_ents)
 {
-	int ret, s, i;
-	struct sg_table *sgt;
-	struct scatterlist *sg;
+	struct sg_table *sgt = &vgdev->data_sgt;
+	struct scatterlist *sg, *last = NULL;
 	struct page *pg;
+	int s, i;
+
+	lockdep_assert_held(&vgdev->data_sgt_lock);
 
 	if (WARN_ON(!PAGE_ALIGNED(data)))
 		return NULL;
 
-	sgt = kmalloc(sizeof(*sgt), GFP_KERNEL);
-	if (!sgt)
-		return NULL;
+	/* drop the end marker of the previous, shorter user */
+	if (vgdev->data_sgt_end) {
+		sg_unmark_end(vgdev->data_sgt_end);
+		vgdev->data_sgt_end = NULL;
+	}
 
 	*sg_ents = DIV_ROUND_UP(size, PAGE_SIZE);
-	ret = sg_alloc_table(sgt, *sg_ents, GFP_KERNEL);
-	if (ret) {
-		kfree(sgt);
-		return NULL;
+	if (*sg_ents > sgt->orig_nents) {
+		if (sgt->sgl)
+			sg_free_table(sgt);
+
+		if (sg_alloc_table(sgt, roundup_pow_of_two(*sg_ents),
+				   GFP_KERNEL)) {
+			memset(sgt, 0, sizeof(*sgt));
+			return NULL;
+		}
 	}
 
-	for_each_sgtable_sg(sgt, sg, i) {
+	for_each_sg(sgt->sgl, sg, *sg_ents, i) {
 		pg = vmalloc_to_page(data);
-		if (!pg) {
-			sg_free_table(sgt);
-			kfree(sgt);
+		if (!pg)
 			return NULL;
-		}
 
 		s = min_t(int, PAGE_SIZE, size);
 		sg_set_page(sg, pg, s, 0);
 
 		size -= s;
 		data += s;
+		last = sg;
+	}
+
+	if (*sg_ents < sgt->orig_nents) {
+		sg_mark_end(last);
+		vgdev->data_sgt_end = last;
 	}
 
-	return sgt;
+	return sgt->sgl;
 }
 
 static int virtio_gpu_queue_ctrl_sgs(struct virtio_gpu_device *vgdev,
@@ -331,7 +414,7 @@ static int virtio_gpu_queue_ctrl_sgs(struct virtio_gpu_device *vgdev,
 
 	if (vq->num_free < elemcnt) {
 		spin_unlock(&vgdev->ctrlq.qlock);
-		virtio_gpu_notify(vgdev);
+		virtio_gpu_kick(vgdev);
 		wait_event(vgdev->ctrlq.ack_queue, vq->num_free >= elemcnt);
 		goto again;
 	}
@@ -366,7 +449,7 @@ static int virtio_gpu_queue_fenced_ctrl_buffer(struct virtio_gpu_device *vgdev,
 					       struct virtio_gpu_fence *fence)
 {
 	struct scatterlist *sgs[3], vcmd, vout, vresp;
-	struct sg_table *sgt = NULL;
+	bool data_sgt_locked = false;
 	int elemcnt = 0, outcnt = 0, incnt = 0, ret;
 
 	/* set up vcmd */
@@ -378,17 +461,22 @@ static int virtio_gpu_queue_fenced_ctrl_buffer(struct virtio_gpu_device *vgdev,
 	/* set up vout */
 	if (vbuf->data_size) {
 		if (is_vmalloc_addr(vbuf->data_buf)) {
+			struct scatterlist *sgl;
 			int sg_ents;
-			sgt = vmalloc_to_sgt(vbuf->data_buf, vbuf->data_size,
-					     &sg_ents);
-			if (!sgt) {
+
+			mutex_lock(&vgdev->data_sgt_lock);
+			sgl = vmalloc_to_sgl(vgdev, vbuf->data_buf,
+					     vbuf->data_size, &sg_ents);
+			if (!sgl) {
+				mutex_unlock(&vgdev->data_sgt_lock);
 				if (fence && vbuf->objs)
 					virtio_gpu_array_unlock_resv(vbuf->objs);
 				return -1;
 			}
+			data_sgt_locked = true;
 
 			elemcnt += sg_ents;
-			sgs[outcnt] = sgt->sgl;
+			sgs[outcnt] = sgl;
 		} else {
 			sg_init_one(&vout, vbuf->data_buf, vbuf->data_size);
 			elemcnt++;
@@ -408,14 +496,19 @@ static int virtio_gpu_queue_fenced_ctrl_buffer(struct virtio_gpu_device *vgdev,
 	ret = virtio_gpu_queue_ctrl_sgs(vgdev, vbuf, fence, elemcnt, sgs, outcnt,
 					incnt);
 
-	if (sgt) {
-		sg_free_table(sgt);
-		kfree(sgt);
-	}
+	if (data_sgt_locked)
+		mutex_unlock(&vgdev->data_sgt_lock);
 	return ret;
 }
 
-void virtio_gpu_notify(struct virtio_gpu_device *vgdev)
+/**
+ * virtio_gpu_kick - tell the host about the queued ctrlq commands
+ * @vgdev: virtio gpu device
+ *
+ * Unlike virtio_gpu_notify() this kicks right away even inside a batch,
+ * and must be used before waiting for the host to process a command.
+ */
+void virtio_gpu_kick(struct virtio_gpu_device *vgdev)
 {
 	bool notify;
 
@@ -427,8 +520,67 @@ void virtio_gpu_notify(struct virtio_gpu_device *vgdev)
 	notify = virtqueue_kick_prepare(vgdev->ctrlq.vq);
 	spin_unlock(&vgdev->ctrlq.qlock);
 
-	if (notify)
+	if (notify) {
+		atomic64_inc(&vgdev->ctrlq_kicks);
 		virtqueue_notify(vgdev->ctrlq.vq);
+	}
+}
+
+/**
+ * virtio_gpu_notify - tell the host about the queued ctrlq commands
+ * @vgdev: virtio gpu device
+ *
+ * Inside a batch of the current task the kick is deferred to
+ * virtio_gpu_batch_end().
+ */
+void virtio_gpu_notify(struct virtio_gpu_device *vgdev)
+{
+	if (READ_ONCE(vgdev->batch_owner) == current) {
+		if (atomic_read(&vgdev->pending_commands))
+			atomic64_inc(&vgdev->notifies_batched);
+		return;
+	}
+
+	virtio_gpu_kick(vgdev);
+}
+
+/**
+ * virtio_gpu_batch_begin - start batching ctrlq notifies
+ * @vgdev: virtio gpu device
+ *
+ * All virtio_gpu_notify() calls of the current task until the matching
+ * virtio_gpu_batch_end() are merged into a single kick, so that e.g. the
+ * transfer, set_scanout and flush commands of an atomic commit cost one
+ * VM exit. Batches nest, and only one task batches at a time.
+ */
+void virtio_gpu_batch_begin(struct virtio_gpu_device *vgdev)
+{
+	if (vgdev->batch_owner == current) {
+		vgdev->batch_depth++;
+		return;
+	}
+
+	mutex_lock(&vgdev->batch_lock);
+	WRITE_ONCE(vgdev->batch_owner, current);
+	vgdev->batch_depth = 1;
+}
+
+/**
+ * virtio_gpu_batch_end - end batching and kick the deferred commands
+ * @vgdev: virtio gpu device
+ */
+void virtio_gpu_batch_end(struct virtio_gpu_device *vgdev)
+{
+	if (WARN_ON(vgdev->batch_owner != current))
+		return;
+
+	if (--vgdev->batch_depth)
+		return;
+
+	WRITE_ONCE(vgdev->batch_owner, NULL);
+	mutex_unlock(&vgdev->batch_lock);
+
+	virtio_gpu_kick(vgdev);
 }
 
 static int virtio_gpu_queue_ctrl_buffer(struct virtio_gpu_device *vgdev,
@@ -471,8 +623,10 @@ static void virtio_gpu_queue_cursor(struct virtio_gpu_device *vgdev,
 
 	spin_unlock(&vgdev->cursorq.qlock);
 
-	if (notify)
+	if (notify) {
+		atomic64_inc(&vgdev->cursorq_kicks);
 		virtqueue_notify(vq);
+	}
 
 	drm_dev_exit(idx);
 }
@@ -1145,20 +1299,11 @@ virtio_gpu_cmd_resource_assign_uuid(struct virtio_gpu_device *vgdev,
 	struct virtio_gpu_object *bo = gem_to_virtio_gpu_obj(objs->objs[0]);
 	struct virtio_gpu_resource_assign_uuid *cmd_p;
 	struct virtio_gpu_vbuffer *vbuf;
-	struct virtio_gpu_resp_resource_uuid *resp_buf;
-
-	resp_buf = kzalloc(sizeof(*resp_buf), GFP_KERNEL);
-	if (!resp_buf) {
-		spin_lock(&vgdev->resource_export_lock);
-		bo->uuid_state = STATE_ERR;
-		spin_unlock(&vgdev->resource_export_lock);
-		virtio_gpu_array_put_free(objs);
-		return -ENOMEM;
-	}
 
+	/* the response fits into the vbuf */
 	cmd_p = virtio_gpu_alloc_cmd_resp
 		(vgdev, virtio_gpu_cmd_resource_uuid_cb, &vbuf, sizeof(*cmd_p),
-		 sizeof(struct virtio_gpu_resp_resource_uuid), resp_buf);
+		 sizeof(struct virtio_gpu_resp_resource_uuid), NULL);
 	memset(cmd_p, 0, sizeof(*cmd_p));
 
 	cmd_p->hdr.type = cpu_to_le32(VIRTIO_GPU_CMD_RESOURCE_ASSIGN_UUID);
@@ -1198,15 +1343,11 @@ int virtio_gpu_cmd_map(struct virtio_gpu_device *vgdev,
 	struct virtio_gpu_resource_map_blob *cmd_p;
 	struct virtio_gpu_object *bo = gem_to_virtio_gpu_obj(objs->objs[0]);
 	struct virtio_gpu_vbuffer *vbuf;
-	struct virtio_gpu_resp_map_info *resp_buf;
-
-	resp_buf = kzalloc(sizeof(*resp_buf), GFP_KERNEL);
-	if (!resp_buf)
-		return -ENOMEM;
 
+	/* the response fits into the vbuf */
 	cmd_p = virtio_gpu_alloc_cmd_resp
 		(vgdev, virtio_gpu_cmd_resource_map_cb, &vbuf, sizeof(*cmd_p),
-		 sizeof(struct virtio_gpu_resp_map_info), resp_buf);
+		 sizeof(struct virtio_gpu_resp_map_info), NULL);
 	memset(cmd_p, 0, sizeof(*cmd_p));
 
 	cmd_p->hdr.type = cpu_to_le32(VIRTIO_GPU_CMD_RESOURCE_MAP_BLOB);
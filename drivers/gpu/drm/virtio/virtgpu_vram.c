@@ -3,22 +3,153 @@
 
 #include <linux/dma-mapping.h>
 
+/*
+ * Mapped blobs without a blob id are interchangeable within the file that
+ * created them.  When such a BO is freed, its host resource and its
+ * mapping in the host visible region are kept in a cache, and a later
+ * blob allocation of the same file, memory type, flags and size takes
+ * them over. This skips the CREATE_BLOB and MAP_BLOB commands and the
+ * wait for the map response.  Cached blobs are released when the cache
+ * is full, when the host visible region runs out of space and when the
+ * file is closed.
+ */
+#define VIRTIO_GPU_VRAM_CACHE_MAX 32
+
+static void virtio_gpu_vram_release(struct virtio_gpu_device *vgdev,
+				    struct virtio_gpu_object_vram *vram)
+{
+	struct virtio_gpu_object *bo = &vram->base;
+	bool unmap;
+
+	spin_lock(&vgdev->host_visible_lock);
+	unmap = drm_mm_node_allocated(&vram->vram_node);
+	spin_unlock(&vgdev->host_visible_lock);
+
+	if (unmap) {
+		virtio_gpu_cmd_unmap(vgdev, bo);
+
+		/*
+		 * The host handles commands in order, so a later MAP_BLOB
+		 * into this range only happens after the UNMAP_BLOB.
+		 */
+		spin_lock(&vgdev->host_visible_lock);
+		drm_mm_remove_node(&vram->vram_node);
+		spin_unlock(&vgdev->host_visible_lock);
+	}
+
+	virtio_gpu_cmd_unref_resource(vgdev, bo);
+}
+
+static void virtio_gpu_vram_release_list(struct virtio_gpu_device *vgdev,
+					 struct list_head *list)
+{
+	struct virtio_gpu_object_vram *vram, *tmp;
+
+	if (list_empty(list))
+		return;
+
+	list_for_each_entry_safe(vram, tmp, list, cache_head) {
+		list_del(&vram->cache_head);
+		virtio_gpu_vram_release(vgdev, vram);
+	}
+	virtio_gpu_notify(vgdev);
+}
+
+static bool virtio_gpu_vram_cache_put(struct virtio_gpu_device *vgdev,
+				      struct virtio_gpu_object_vram *vram)
+{
+	LIST_HEAD(evict);
+
+	if (!vram->reusable)
+		return false;
+
+	spin_lock(&vgdev->host_visible_lock);
+	if (vram->map_state != STATE_OK) {
+		spin_unlock(&vgdev->host_visible_lock);
+		return false;
+	}
+
+	if (vgdev->vram_cache_count == VIRTIO_GPU_VRAM_CACHE_MAX)
+		list_move(vgdev->vram_cache.next, &evict);
+	else
+		vgdev->vram_cache_count++;
+	list_add_tail(&vram->cache_head, &vgdev->vram_cache);
+	spin_unlock(&vgdev->host_visible_lock);
+
+	virtio_gpu_vram_release_list(vgdev, &evict);
+	return true;
+}
+
+static struct virtio_gpu_object_vram *
+virtio_gpu_vram_cache_get(struct virtio_gpu_device *vgdev,
+			  struct virtio_gpu_object_params *params)
+{
+	struct virtio_gpu_object_vram *vram;
+
+	spin_lock(&vgdev->host_visible_lock);
+	list_for_each_entry_reverse(vram, &vgdev->vram_cache, cache_head) {
+		if (vram->ctx_seqno == params->ctx_seqno &&
+		    vram->base.blob_mem == params->blob_mem &&
+		    vram->base.blob_flags == params->blob_flags &&
+		    vram->vram_node.size == params->size) {
+			list_del(&vram->cache_head);
+			vgdev->vram_cache_count--;
+			spin_unlock(&vgdev->host_visible_lock);
+			return vram;
+		}
+	}
+	spin_unlock(&vgdev->host_visible_lock);
+
+	return NULL;
+}
+
+/**
+ * virtio_gpu_vram_cache_evict - release cached blobs
+ * @vgdev: virtio gpu device
+ * @ctx_seqno: release the blobs of this file only, or all if 0
+ */
+void virtio_gpu_vram_cache_evict(struct virtio_gpu_device *vgdev,
+				 uint64_t ctx_seqno)
+{
+	struct virtio_gpu_object_vram *vram, *tmp;
+	LIST_HEAD(evict);
+
+	spin_lock(&vgdev->host_visible_lock);
+	list_for_each_entry_safe(vram, tmp, &vgdev->vram_cache, cache_head) {
+		if (ctx_seqno && vram->ctx_seqno != ctx_seqno)
+			continue;
+
+		list_move_tail(&vram->cache_head, &evict);
+		vgdev->vram_cache_count--;
+	}
+	spin_unlock(&vgdev->host_visible_lock);
+
+	virtio_gpu_vram_release_list(vgdev, &evict);
+}
+
+/* The device is gone, only free the guest side of the cached blobs. */
+void virtio_gpu_vram_cache_fini(struct virtio_gpu_device *vgdev)
+{
+	struct virtio_gpu_object_vram *vram, *tmp;
+
+	list_for_each_entry_safe(vram, tmp, &vgdev->vram_cache, cache_head) {
+		list_del(&vram->cache_head);
+		virtio_gpu_cleanup_object(&vram->base);
+	}
+	vgdev->vram_cache_count = 0;
+}
+
 static void virtio_gpu_vram_free(struct drm_gem_object *obj)
 {
 	struct virtio_gpu_object *bo = gem_to_virtio_gpu_obj(obj);
 	struct virtio_gpu_device *vgdev = obj->dev->dev_private;
 	struct virtio_gpu_object_vram *vram = to_virtio_gpu_vram(bo);
-	bool unmap;
 
 	if (bo->created) {
-		spin_lock(&vgdev->host_visible_lock);
-		unmap = drm_mm_node_allocated(&vram->vram_node);
-		spin_unlock(&vgdev->host_visible_lock);
+		if (virtio_gpu_vram_cache_put(vgdev, vram))
+			return;
 
-		if (unmap)
-			virtio_gpu_cmd_unmap(vgdev, bo);
-
-		virtio_gpu_cmd_unref_resource(vgdev, bo);
+		virtio_gpu_vram_release(vgdev, vram);
 		virtio_gpu_notify(vgdev);
 		return;
 	}
@@ -154,6 +285,16 @@ static int virtio_gpu_vram_map(struct virtio_gpu_object *bo)
 				 bo->base.base.size);
 	spin_unlock(&vgdev->host_visible_lock);
 
+	/* make room by releasing the cached blobs */
+	if (ret == -ENOSPC && vgdev->vram_cache_count) {
+		virtio_gpu_vram_cache_evict(vgdev, 0);
+
+		spin_lock(&vgdev->host_visible_lock);
+		ret = drm_mm_insert_node(&vgdev->host_visible_mm,
+					 &vram->vram_node, bo->base.base.size);
+		spin_unlock(&vgdev->host_visible_lock);
+	}
+
 	if (ret)
 		return ret;
 
@@ -187,7 +328,7 @@ int virtio_gpu_vram_create(struct virtio_gpu_device *vgdev,
 			   struct virtio_gpu_object **bo_ptr)
 {
 	struct drm_gem_object *obj;
-	struct virtio_gpu_object_vram *vram;
+	struct virtio_gpu_object_vram *vram, *cached = NULL;
 	int ret;
 
 	vram = kzalloc(sizeof(*vram), GFP_KERNEL);
@@ -207,6 +348,32 @@ int virtio_gpu_vram_create(struct virtio_gpu_device *vgdev,
 		return ret;
 	}
 
+	vram->ctx_seqno = params->ctx_seqno;
+	vram->reusable = !params->blob_id &&
+		(params->blob_flags & VIRTGPU_BLOB_FLAG_USE_MAPPABLE) &&
+		!(params->blob_flags & VIRTGPU_BLOB_FLAG_USE_CROSS_DEVICE);
+
+	if (vram->reusable)
+		cached = virtio_gpu_vram_cache_get(vgdev, params);
+	if (cached) {
+		/* take over the host resource and mapping of the cached blob */
+		vram->base.hw_res_handle = cached->base.hw_res_handle;
+		vram->base.created = true;
+		vram->map_info = cached->map_info;
+		vram->map_state = STATE_OK;
+
+		spin_lock(&vgdev->host_visible_lock);
+		drm_mm_replace_node(&cached->vram_node, &vram->vram_node);
+		spin_unlock(&vgdev->host_visible_lock);
+
+		drm_gem_free_mmap_offset(&cached->base.base.base);
+		drm_gem_object_release(&cached->base.base.base);
+		kfree(cached);
+
+		*bo_ptr = &vram->base;
+		return 0;
+	}
+
 	ret = virtio_gpu_resource_id_get(vgdev, &vram->base.hw_res_handle);
 	if (ret) {
 		kfree(vram);
@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: GPL-2.0+
 
 #include <linux/crc32.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/workqueue.h>
 
 #include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
@@ -10,200 +13,386 @@
 
 #include "vkms_drv.h"
 
-static u32 get_pixel_from_buffer(int x, int y, const u8 *buffer,
-				 const struct vkms_composer *composer)
+/*
+ * The composer works on one output line at a time: every plane covering
+ * the line is converted into a common ARGB16161616 line buffer, blended
+ * into the output line and the result is written back as XRGB8888, which
+ * is what the CRC is computed over and what writeback stores.
+ */
+struct pixel_argb_u16 {
+	u16 a, r, g, b;
+};
+
+static inline u16 expand_u8(u8 c)
 {
-	u32 pixel;
-	int src_offset = composer->offset + (y * composer->pitch)
-				      + (x * composer->cpp);
+	return c * 257;
+}
 
-	pixel = *(u32 *)&buffer[src_offset];
+static void fetch_argb8888(struct pixel_argb_u16 *out, const u8 *src,
+			   int step, int n)
+{
+	for (; n > 0; n--, out++, src += step) {
+		out->a = expand_u8(src[3]);
+		out->r = expand_u8(src[2]);
+		out->g = expand_u8(src[1]);
+		out->b = expand_u8(src[0]);
+	}
+}
 
-	return pixel;
+static void fetch_xrgb8888(struct pixel_argb_u16 *out, const u8 *src,
+			   int step, int n)
+{
+	for (; n > 0; n--, out++, src += step) {
+		out->a = 0xffff;
+		out->r = expand_u8(src[2]);
+		out->g = expand_u8(src[1]);
+		out->b = expand_u8(src[0]);
+	}
+}
+
+static void fetch_argb16161616(struct pixel_argb_u16 *out, const u8 *src,
+			       int step, int n)
+{
+	for (; n > 0; n--, out++, src += step) {
+		const __le16 *px = (const __le16 *)src;
+
+		out->a = le16_to_cpu(px[3]);
+		out->r = le16_to_cpu(px[2]);
+		out->g = le16_to_cpu(px[1]);
+		out->b = le16_to_cpu(px[0]);
+	}
+}
+
+static void fetch_xrgb16161616(struct pixel_argb_u16 *out, const u8 *src,
+			       int step, int n)
+{
+	for (; n > 0; n--, out++, src += step) {
+		const __le16 *px = (const __le16 *)src;
+
+		out->a = 0xffff;
+		out->r = le16_to_cpu(px[2]);
+		out->g = le16_to_cpu(px[1]);
+		out->b = le16_to_cpu(px[0]);
+	}
+}
+
+static void fetch_rgb565(struct pixel_argb_u16 *out, const u8 *src,
+			 int step, int n)
+{
+	for (; n > 0; n--, out++, src += step) {
+		u16 px = le16_to_cpu(*(const __le16 *)src);
+		u16 r = px >> 11, g = (px >> 5) & 0x3f, b = px & 0x1f;
+
+		/* replicate the high bits to cover the full range */
+		out->a = 0xffff;
+		out->r = (r << 11) | (r << 6) | (r << 1) | (r >> 4);
+		out->g = (g << 10) | (g << 4) | (g >> 2);
+		out->b = (b << 11) | (b << 6) | (b << 1) | (b >> 4);
+	}
 }
 
 /**
- * compute_crc - Compute CRC value on output frame
- *
- * @vaddr: address to final framebuffer
- * @composer: framebuffer's metadata
+ * vkms_get_fetch_line - get the line conversion function of a format
+ * @format: DRM fourcc of the plane
  *
- * returns CRC value computed using crc32 on the visible portion of
- * the final framebuffer at vaddr_out
+ * Returns NULL if @format isn't supported by the composer.
  */
-static uint32_t compute_crc(const u8 *vaddr,
-			    const struct vkms_composer *composer)
+vkms_fetch_line_t vkms_get_fetch_line(u32 format)
 {
-	int x, y;
-	u32 crc = 0, pixel = 0;
-	int x_src = composer->src.x1 >> 16;
-	int y_src = composer->src.y1 >> 16;
-	int h_src = drm_rect_height(&composer->src) >> 16;
-	int w_src = drm_rect_width(&composer->src) >> 16;
-
-	for (y = y_src; y < y_src + h_src; ++y) {
-		for (x = x_src; x < x_src + w_src; ++x) {
-			pixel = get_pixel_from_buffer(x, y, vaddr, composer);
-			crc = crc32_le(crc, (void *)&pixel, sizeof(u32));
-		}
+	switch (format) {
+	case DRM_FORMAT_ARGB8888:
+		return fetch_argb8888;
+	case DRM_FORMAT_XRGB8888:
+		return fetch_xrgb8888;
+	case DRM_FORMAT_ARGB16161616:
+		return fetch_argb16161616;
+	case DRM_FORMAT_XRGB16161616:
+		return fetch_xrgb16161616;
+	case DRM_FORMAT_RGB565:
+		return fetch_rgb565;
+	default:
+		return NULL;
 	}
-
-	return crc;
 }
 
-static u8 blend_channel(u8 src, u8 dst, u8 alpha)
+/*
+ * Map the pixel (u, v) of the plane's destination rectangle, relative to
+ * its top left corner, back to the framebuffer: undo the rotation first,
+ * then the reflection, the inverse of drm_rect_rotate().
+ */
+static void get_src_pos(const struct vkms_composer *composer, int u, int v,
+			int *x, int *y)
 {
-	u32 pre_blend;
-	u8 new_color;
+	int w = drm_rect_width(&composer->src) >> 16;
+	int h = drm_rect_height(&composer->src) >> 16;
+	int xr, yr;
+
+	switch (composer->rotation & DRM_MODE_ROTATE_MASK) {
+	case DRM_MODE_ROTATE_90:
+		xr = w - 1 - v;
+		yr = u;
+		break;
+	case DRM_MODE_ROTATE_180:
+		xr = w - 1 - u;
+		yr = h - 1 - v;
+		break;
+	case DRM_MODE_ROTATE_270:
+		xr = v;
+		yr = h - 1 - u;
+		break;
+	default:
+		xr = u;
+		yr = v;
+		break;
+	}
+
+	if (composer->rotation & DRM_MODE_REFLECT_X)
+		xr = w - 1 - xr;
+	if (composer->rotation & DRM_MODE_REFLECT_Y)
+		yr = h - 1 - yr;
+
+	*x = (composer->src.x1 >> 16) + xr;
+	*y = (composer->src.y1 >> 16) + yr;
+}
 
-	pre_blend = (src * 255 + dst * (255 - alpha));
+static const u8 *get_src_addr(const struct vkms_composer *composer,
+			      int u, int v)
+{
+	int x, y;
 
-	/* Faster div by 255 */
-	new_color = ((pre_blend + ((pre_blend + 257) >> 8)) >> 8);
+	get_src_pos(composer, u, v, &x, &y);
 
-	return new_color;
+	return (const u8 *)composer->map[0].vaddr + y * composer->pitch +
+	       x * composer->cpp;
 }
 
-/**
- * alpha_blend - alpha blending equation
- * @argb_src: src pixel on premultiplied alpha mode
- * @argb_dst: dst pixel completely opaque
- *
- * blend pixels using premultiplied blend formula. The current DRM assumption
- * is that pixel color values have been already pre-multiplied with the alpha
- * channel values. See more drm_plane_create_blend_mode_property(). Also, this
- * formula assumes a completely opaque background.
+/*
+ * Convert the part of output line @y covered by the plane of @composer
+ * into @line. Returns the number of pixels written, starting at output
+ * column dst.x1, or 0 if the plane doesn't cover the line.
  */
-static void alpha_blend(const u8 *argb_src, u8 *argb_dst)
+static int fetch_plane_line(const struct vkms_composer *composer, int y,
+			    struct pixel_argb_u16 *line)
 {
-	u8 alpha;
+	int w = drm_rect_width(&composer->dst);
+	int v = y - composer->dst.y1;
+	const u8 *src;
+	int step;
+
+	if (y < composer->dst.y1 || y >= composer->dst.y2 || w <= 0)
+		return 0;
 
-	alpha = argb_src[3];
-	argb_dst[0] = blend_channel(argb_src[0], argb_dst[0], alpha);
-	argb_dst[1] = blend_channel(argb_src[1], argb_dst[1], alpha);
-	argb_dst[2] = blend_channel(argb_src[2], argb_dst[2], alpha);
+	src = get_src_addr(composer, 0, v);
+	step = w > 1 ? get_src_addr(composer, 1, v) - src : 0;
+
+	composer->fetch_line(line, src, step, w);
+
+	return w;
 }
 
 /**
- * x_blend - blending equation that ignores the pixel alpha
+ * blend_line - blend a plane line into the output line
+ * @dst: output line, completely opaque
+ * @src: plane line on premultiplied alpha mode
+ * @n: number of pixels
  *
- * overwrites RGB color value from src pixel to dst pixel.
+ * The current DRM assumption is that pixel color values have been already
+ * pre-multiplied with the alpha channel values. See more
+ * drm_plane_create_blend_mode_property(). Also, this formula assumes a
+ * completely opaque background.
  */
-static void x_blend(const u8 *xrgb_src, u8 *xrgb_dst)
+static void blend_line(struct pixel_argb_u16 *dst,
+		       const struct pixel_argb_u16 *src, int n)
 {
-	memcpy(xrgb_dst, xrgb_src, sizeof(u8) * 3);
+	for (; n > 0; n--, dst++, src++) {
+		u32 inv = 0xffff - src->a;
+
+		dst->r = min_t(u32, src->r + (dst->r * inv + 0x8000) / 0xffff, 0xffff);
+		dst->g = min_t(u32, src->g + (dst->g * inv + 0x8000) / 0xffff, 0xffff);
+		dst->b = min_t(u32, src->b + (dst->b * inv + 0x8000) / 0xffff, 0xffff);
+	}
 }
 
-/**
- * blend - blend value at vaddr_src with value at vaddr_dst
- * @vaddr_dst: destination address
- * @vaddr_src: source address
- * @dst_composer: destination framebuffer's metadata
- * @src_composer: source framebuffer's metadata
- * @pixel_blend: blending equation based on plane format
- *
- * Blend the vaddr_src value with the vaddr_dst value using a pixel blend
- * equation according to the supported plane formats DRM_FORMAT_(A/XRGB8888)
- * and clearing alpha channel to an completely opaque background. This function
- * uses buffer's metadata to locate the new composite values at vaddr_dst.
- *
- * TODO: completely clear the primary plane (a = 0xff) before starting to blend
- * pixel color values
- */
-static void blend(void *vaddr_dst, void *vaddr_src,
-		  struct vkms_composer *dst_composer,
-		  struct vkms_composer *src_composer,
-		  void (*pixel_blend)(const u8 *, u8 *))
+static inline u8 reduce_u16(u16 c)
 {
-	int i, j, j_dst, i_dst;
-	int offset_src, offset_dst;
-	u8 *pixel_dst, *pixel_src;
-
-	int x_src = src_composer->src.x1 >> 16;
-	int y_src = src_composer->src.y1 >> 16;
-
-	int x_dst = src_composer->dst.x1;
-	int y_dst = src_composer->dst.y1;
-	int h_dst = drm_rect_height(&src_composer->dst);
-	int w_dst = drm_rect_width(&src_composer->dst);
-
-	int y_limit = y_src + h_dst;
-	int x_limit = x_src + w_dst;
-
-	for (i = y_src, i_dst = y_dst; i < y_limit; ++i) {
-		for (j = x_src, j_dst = x_dst; j < x_limit; ++j) {
-			offset_dst = dst_composer->offset
-				     + (i_dst * dst_composer->pitch)
-				     + (j_dst++ * dst_composer->cpp);
-			offset_src = src_composer->offset
-				     + (i * src_composer->pitch)
-				     + (j * src_composer->cpp);
-
-			pixel_src = (u8 *)(vaddr_src + offset_src);
-			pixel_dst = (u8 *)(vaddr_dst + offset_dst);
-			pixel_blend(pixel_src, pixel_dst);
-			/* clearing alpha channel (0xff)*/
-			pixel_dst[3] = 0xff;
-		}
-		i_dst++;
+	return (c + 128) / 257;
+}
+
+static void store_xrgb8888(u8 *dst, const struct pixel_argb_u16 *src, int n)
+{
+	for (; n > 0; n--, dst += 4, src++) {
+		dst[0] = reduce_u16(src->b);
+		dst[1] = reduce_u16(src->g);
+		dst[2] = reduce_u16(src->r);
+		/* output is completely opaque */
+		dst[3] = 0xff;
 	}
 }
 
-static void compose_plane(struct vkms_composer *primary_composer,
-			  struct vkms_composer *plane_composer,
-			  void *vaddr_out)
+/*
+ * Compose the output lines [@y_start, @y_end) of the primary plane with the
+ * other active planes on top of it in z-order: ((primary <- overlay) <-
+ * cursor). @crc is computed using crc32 on the XRGB8888 output lines of the
+ * band, which are stored to @vaddr_out if given.
+ */
+static int compose_band(struct vkms_crtc_state *crtc_state,
+			void *vaddr_out, unsigned int pitch_out,
+			int y_start, int y_end, u32 *crc)
 {
-	struct drm_framebuffer *fb = &plane_composer->fb;
-	void *vaddr;
-	void (*pixel_blend)(const u8 *p_src, u8 *p_dst);
+	struct vkms_composer *primary_composer =
+		crtc_state->active_planes[0]->composer;
+	int w = drm_rect_width(&primary_composer->dst);
+	struct pixel_argb_u16 *out, *stage;
+	struct vkms_composer *composer;
+	u8 *row = NULL;
+	int i, y, n;
+
+	out = kvmalloc_array(w, sizeof(*out), GFP_KERNEL);
+	stage = kvmalloc_array(w, sizeof(*stage), GFP_KERNEL);
+	if (!vaddr_out)
+		row = kvmalloc(w * 4, GFP_KERNEL);
+	if (!out || !stage || (!vaddr_out && !row)) {
+		DRM_ERROR("Cannot allocate memory for output lines.");
+		kvfree(out);
+		kvfree(stage);
+		kvfree(row);
+		return -ENOMEM;
+	}
 
-	if (WARN_ON(dma_buf_map_is_null(&primary_composer->map[0])))
-		return;
+	*crc = 0;
+	for (y = y_start; y < y_end; y++) {
+		fetch_plane_line(primary_composer, primary_composer->dst.y1 + y,
+				 out);
+
+		for (i = 1; i < crtc_state->num_active_planes; i++) {
+			composer = crtc_state->active_planes[i]->composer;
+			n = fetch_plane_line(composer,
+					     primary_composer->dst.y1 + y, stage);
+			if (!n)
+				continue;
+
+			if (composer->fb.format->has_alpha)
+				blend_line(out + composer->dst.x1, stage, n);
+			else
+				memcpy(out + composer->dst.x1, stage,
+				       n * sizeof(*out));
+		}
+
+		if (vaddr_out)
+			row = (u8 *)vaddr_out + y * pitch_out;
+		store_xrgb8888(row, out, w);
+		*crc = crc32_le(*crc, row, w * 4);
+	}
+
+	if (!vaddr_out)
+		kvfree(row);
+	kvfree(stage);
+	kvfree(out);
+	return 0;
+}
 
-	vaddr = plane_composer->map[0].vaddr;
+/* don't bother other CPUs for less lines than this */
+#define VKMS_MIN_BAND_LINES 64
 
-	if (fb->format->format == DRM_FORMAT_ARGB8888)
-		pixel_blend = &alpha_blend;
-	else
-		pixel_blend = &x_blend;
+struct vkms_compose_band {
+	struct work_struct work;
+	struct vkms_crtc_state *crtc_state;
+	void *vaddr_out;
+	unsigned int pitch_out;
+	int y_start, y_end;
+	u32 crc;
+	int ret;
+};
 
-	blend(vaddr_out, vaddr, primary_composer, plane_composer, pixel_blend);
+static void compose_band_work(struct work_struct *work)
+{
+	struct vkms_compose_band *band =
+		container_of(work, struct vkms_compose_band, work);
+
+	band->ret = compose_band(band->crtc_state, band->vaddr_out,
+				 band->pitch_out, band->y_start, band->y_end,
+				 &band->crc);
 }
 
-static int compose_active_planes(void **vaddr_out,
-				 struct vkms_composer *primary_composer,
-				 struct vkms_crtc_state *crtc_state)
+/**
+ * compose_active_planes - compose the frame and compute its CRC
+ *
+ * @crtc_state: crtc state holding the planes in z order
+ * @vaddr_out: optional writeback buffer, XRGB8888
+ * @pitch_out: pitch of @vaddr_out
+ * @num_bands: number of horizontal bands to compose in parallel
+ * @crc: resulting CRC value
+ *
+ * With more than one band all but the first band are composed on the
+ * unbound workqueue while the first one is composed by the caller. The
+ * per band CRCs are seeded with 0 and combined into the CRC of the whole
+ * frame, which is the same as composing it in one go.
+ */
+static int compose_active_planes(struct vkms_crtc_state *crtc_state,
+				 void *vaddr_out, unsigned int pitch_out,
+				 unsigned int num_bands, u32 *crc)
 {
-	struct drm_framebuffer *fb = &primary_composer->fb;
-	struct drm_gem_object *gem_obj = drm_gem_fb_get_obj(fb, 0);
-	const void *vaddr;
-	int i;
-
-	if (!*vaddr_out) {
-		*vaddr_out = kzalloc(gem_obj->size, GFP_KERNEL);
-		if (!*vaddr_out) {
-			DRM_ERROR("Cannot allocate memory for output frame.");
-			return -ENOMEM;
-		}
+	struct vkms_composer *primary_composer =
+		crtc_state->active_planes[0]->composer;
+	int w = drm_rect_width(&primary_composer->dst);
+	int h = drm_rect_height(&primary_composer->dst);
+	struct vkms_compose_band *bands;
+	struct vkms_composer *composer;
+	int i, ret;
+
+	for (i = 0; i < crtc_state->num_active_planes; i++) {
+		composer = crtc_state->active_planes[i]->composer;
+		if (WARN_ON(dma_buf_map_is_null(&composer->map[0])) ||
+		    WARN_ON(!composer->fetch_line))
+			return -EINVAL;
 	}
 
-	if (WARN_ON(dma_buf_map_is_null(&primary_composer->map[0])))
-		return -EINVAL;
+	num_bands = min_t(unsigned int, num_bands, h / VKMS_MIN_BAND_LINES);
+	if (num_bands <= 1)
+		return compose_band(crtc_state, vaddr_out, pitch_out, 0, h, crc);
+
+	bands = kcalloc(num_bands, sizeof(*bands), GFP_KERNEL);
+	if (!bands)
+		return compose_band(crtc_state, vaddr_out, pitch_out, 0, h, crc);
+
+	for (i = 0; i < num_bands; i++) {
+		bands[i].crtc_state = crtc_state;
+		bands[i].vaddr_out = vaddr_out;
+		bands[i].pitch_out = pitch_out;
+		bands[i].y_start = h * i / num_bands;
+		bands[i].y_end = h * (i + 1) / num_bands;
+		INIT_WORK(&bands[i].work, compose_band_work);
+		if (i)
+			queue_work(system_unbound_wq, &bands[i].work);
+	}
 
-	vaddr = primary_composer->map[0].vaddr;
+	compose_band_work(&bands[0].work);
 
-	memcpy(*vaddr_out, vaddr, gem_obj->size);
+	ret = bands[0].ret;
+	*crc = bands[0].crc;
+	for (i = 1; i < num_bands; i++) {
+		flush_work(&bands[i].work);
+		ret = ret ?: bands[i].ret;
+		*crc = crc32_le_combine(*crc, bands[i].crc,
+					(size_t)(bands[i].y_end - bands[i].y_start) *
+					w * 4);
+	}
 
-	/* If there are other planes besides primary, we consider the active
-	 * planes should be in z-order and compose them associatively:
-	 * ((primary <- overlay) <- cursor)
-	 */
-	for (i = 1; i < crtc_state->num_active_planes; i++)
-		compose_plane(primary_composer,
-			      crtc_state->active_planes[i]->composer,
-			      *vaddr_out);
+	kfree(bands);
+	return ret;
+}
 
-	return 0;
+static void vkms_account_compose_time(struct vkms_output *out, ktime_t t)
+{
+	u64 ns = ktime_to_ns(t);
+
+	spin_lock_irq(&out->composer_lock);
+	out->stats.frames++;
+	out->stats.last_ns = ns;
+	out->stats.total_ns += ns;
+	if (ns > out->stats.max_ns)
+		out->stats.max_ns = ns;
+	spin_unlock_irq(&out->composer_lock);
 }
 
 /**
@@ -222,12 +411,15 @@ void vkms_composer_worker(struct work_struct *work)
 						composer_work);
 	struct drm_crtc *crtc = crtc_state->base.crtc;
 	struct vkms_output *out = drm_crtc_to_vkms_output(crtc);
+	struct vkms_device *vkmsdev = drm_device_to_vkms_device(crtc->dev);
 	struct vkms_composer *primary_composer = NULL;
 	struct vkms_plane_state *act_plane = NULL;
 	bool crc_pending, wb_pending;
 	void *vaddr_out = NULL;
+	unsigned int pitch_out = 0;
 	u32 crc32 = 0;
 	u64 frame_start, frame_end;
+	ktime_t start;
 	int ret;
 
 	spin_lock_irq(&out->composer_lock);
@@ -256,26 +448,23 @@ void vkms_composer_worker(struct work_struct *work)
 	if (!primary_composer)
 		return;
 
-	if (wb_pending)
+	if (wb_pending) {
 		vaddr_out = crtc_state->active_writeback->data[0].vaddr;
-
-	ret = compose_active_planes(&vaddr_out, primary_composer,
-				    crtc_state);
-	if (ret) {
-		if (ret == -EINVAL && !wb_pending)
-			kfree(vaddr_out);
-		return;
+		pitch_out = crtc_state->active_writeback->pitch;
 	}
 
-	crc32 = compute_crc(vaddr_out, primary_composer);
+	start = ktime_get();
+	ret = compose_active_planes(crtc_state, vaddr_out, pitch_out,
+				    vkmsdev->config->composer_bands, &crc32);
+	if (ret)
+		return;
+	vkms_account_compose_time(out, ktime_sub(ktime_get(), start));
 
 	if (wb_pending) {
 		drm_writeback_signal_completion(&out->wb_connector, 0);
 		spin_lock_irq(&out->composer_lock);
 		crtc_state->wb_pending = false;
 		spin_unlock_irq(&out->composer_lock);
-	} else {
-		kfree(vaddr_out);
 	}
 
 	/*
@@ -22,8 +22,12 @@ static enum hrtimer_restart vkms_vblank_simulate(struct hrtimer *timer)
 
 	ret_overrun = hrtimer_forward_now(&output->vblank_hrtimer,
 					  output->period_ns);
-	if (ret_overrun != 1)
+	if (ret_overrun != 1) {
 		pr_warn("%s: vblank timer overrun\n", __func__);
+		spin_lock(&output->composer_lock);
+		output->stats.missed_vblanks += ret_overrun - 1;
+		spin_unlock(&output->composer_lock);
+	}
 
 	spin_lock(&output->lock);
 	ret = drm_crtc_handle_vblank(crtc);
@@ -40,11 +44,13 @@ static enum hrtimer_restart vkms_vblank_simulate(struct hrtimer *timer)
 		 * has read the data
 		 */
 		spin_lock(&output->composer_lock);
-		if (!state->crc_pending)
+		if (!state->crc_pending) {
 			state->frame_start = frame;
-		else
+		} else {
+			output->stats.missed_vblanks++;
 			DRM_DEBUG_DRIVER("crc worker falling behind, frame_start: %llu, frame_end: %llu\n",
 					 state->frame_start, frame);
+		}
 		state->frame_end = frame;
 		state->crc_pending = true;
 		spin_unlock(&output->composer_lock);
@@ -89,8 +95,7 @@ static bool vkms_get_vblank_timestamp(struct drm_crtc *crtc,
 {
 	struct drm_device *dev = crtc->dev;
 	unsigned int pipe = crtc->index;
-	struct vkms_device *vkmsdev = drm_device_to_vkms_device(dev);
-	struct vkms_output *output = &vkmsdev->output;
+	struct vkms_output *output = drm_crtc_to_vkms_output(crtc);
 	struct drm_vblank_crtc *vblank = &dev->vblank[pipe];
 
 	if (!READ_ONCE(vblank->enabled)) {
@@ -294,7 +299,8 @@ int vkms_crtc_init(struct drm_device *dev, struct drm_crtc *crtc,
 	spin_lock_init(&vkms_out->lock);
 	spin_lock_init(&vkms_out->composer_lock);
 
-	vkms_out->composer_workq = alloc_ordered_workqueue("vkms_composer", 0);
+	vkms_out->composer_workq = alloc_ordered_workqueue("vkms_composer%u", 0,
+							   drm_crtc_index(crtc));
 	if (!vkms_out->composer_workq)
 		return -ENOMEM;
 
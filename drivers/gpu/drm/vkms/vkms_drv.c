@@ -9,6 +9,7 @@
  * the GPU in DRM API tests.
  */
 
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/dma-mapping.h>
@@ -51,13 +52,24 @@ static bool enable_overlay;
 module_param_named(enable_overlay, enable_overlay, bool, 0444);
 MODULE_PARM_DESC(enable_overlay, "Enable/Disable overlay support");
 
+static unsigned int num_outputs = 1;
+module_param_named(num_outputs, num_outputs, uint, 0444);
+MODULE_PARM_DESC(num_outputs, "Number of CRTC/connector pairs (1-4)");
+
+static unsigned int composer_bands = 1;
+module_param_named(composer_bands, composer_bands, uint, 0444);
+MODULE_PARM_DESC(composer_bands, "Number of horizontal bands each frame is composed in parallel, 1 composes on the output's worker only (1-16)");
+
 DEFINE_DRM_GEM_FOPS(vkms_driver_fops);
 
 static void vkms_release(struct drm_device *dev)
 {
 	struct vkms_device *vkms = drm_device_to_vkms_device(dev);
+	int i;
 
-	destroy_workqueue(vkms->output.composer_workq);
+	for (i = 0; i < vkms->config->num_outputs; i++)
+		if (vkms->output[i].composer_workq)
+			destroy_workqueue(vkms->output[i].composer_workq);
 }
 
 static void vkms_atomic_commit_tail(struct drm_atomic_state *old_state)
@@ -98,12 +110,39 @@ static int vkms_config_show(struct seq_file *m, void *data)
 	seq_printf(m, "writeback=%d\n", vkmsdev->config->writeback);
 	seq_printf(m, "cursor=%d\n", vkmsdev->config->cursor);
 	seq_printf(m, "overlay=%d\n", vkmsdev->config->overlay);
+	seq_printf(m, "num_outputs=%u\n", vkmsdev->config->num_outputs);
+	seq_printf(m, "composer_bands=%u\n", vkmsdev->config->composer_bands);
+
+	return 0;
+}
+
+static int vkms_composer_stats_show(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = (struct drm_info_node *)m->private;
+	struct drm_device *dev = node->minor->dev;
+	struct vkms_device *vkmsdev = drm_device_to_vkms_device(dev);
+	struct vkms_composer_stats stats;
+	int i;
+
+	for (i = 0; i < vkmsdev->config->num_outputs; i++) {
+		struct vkms_output *output = &vkmsdev->output[i];
+
+		spin_lock_irq(&output->composer_lock);
+		stats = output->stats;
+		spin_unlock_irq(&output->composer_lock);
+
+		seq_printf(m, "crtc %d: frames=%llu last_ns=%llu max_ns=%llu avg_ns=%llu missed_vblanks=%llu\n",
+			   i, stats.frames, stats.last_ns, stats.max_ns,
+			   stats.frames ? div64_u64(stats.total_ns, stats.frames) : 0,
+			   stats.missed_vblanks);
+	}
 
 	return 0;
 }
 
 static const struct drm_info_list vkms_config_debugfs_list[] = {
 	{ "vkms_config", vkms_config_show, 0 },
+	{ "vkms_composer_stats", vkms_composer_stats_show, 0 },
 };
 
 static void vkms_config_debugfs_init(struct drm_minor *minor)
@@ -140,6 +179,7 @@ static const struct drm_mode_config_helper_funcs vkms_mode_config_helpers = {
 static int vkms_modeset_init(struct vkms_device *vkmsdev)
 {
 	struct drm_device *dev = &vkmsdev->drm;
+	int i, ret;
 
 	drm_mode_config_init(dev);
 	dev->mode_config.funcs = &vkms_mode_funcs;
@@ -155,7 +195,15 @@ static int vkms_modeset_init(struct vkms_device *vkmsdev)
 	dev->mode_config.preferred_depth = 0;
 	dev->mode_config.helper_private = &vkms_mode_config_helpers;
 
-	return vkms_output_init(vkmsdev, 0);
+	for (i = 0; i < vkmsdev->config->num_outputs; i++) {
+		ret = vkms_output_init(vkmsdev, i);
+		if (ret)
+			return ret;
+	}
+
+	drm_mode_config_reset(dev);
+
+	return 0;
 }
 
 static int vkms_create(struct vkms_config *config)
@@ -191,7 +239,7 @@ static int vkms_create(struct vkms_config *config)
 		goto out_devres;
 	}
 
-	ret = drm_vblank_init(&vkms_device->drm, 1);
+	ret = drm_vblank_init(&vkms_device->drm, config->num_outputs);
 	if (ret) {
 		DRM_ERROR("Failed to vblank\n");
 		goto out_devres;
@@ -229,6 +277,10 @@ static int __init vkms_init(void)
 	config->cursor = enable_cursor;
 	config->writeback = enable_writeback;
 	config->overlay = enable_overlay;
+	config->num_outputs = clamp_t(unsigned int, num_outputs, 1,
+				      VKMS_MAX_OUTPUTS);
+	config->composer_bands = clamp_t(unsigned int, composer_bands, 1,
+					 VKMS_MAX_COMPOSER_BANDS);
 
 	return vkms_create(config);
 }
@@ -22,18 +22,29 @@
 
 #define NUM_OVERLAY_PLANES 8
 
+#define VKMS_MAX_OUTPUTS 4
+#define VKMS_MAX_COMPOSER_BANDS 16
+
 struct vkms_writeback_job {
 	struct dma_buf_map map[DRM_FORMAT_MAX_PLANES];
 	struct dma_buf_map data[DRM_FORMAT_MAX_PLANES];
+	unsigned int pitch;
 };
 
+struct pixel_argb_u16;
+
+/* converts @n pixels, @step bytes apart, to the composer's line format */
+typedef void (*vkms_fetch_line_t)(struct pixel_argb_u16 *out, const u8 *src,
+				  int step, int n);
+
 struct vkms_composer {
 	struct drm_framebuffer fb;
 	struct drm_rect src, dst;
 	struct dma_buf_map map[4];
-	unsigned int offset;
 	unsigned int pitch;
 	unsigned int cpp;
+	unsigned int rotation;
+	vkms_fetch_line_t fetch_line;
 };
 
 /**
@@ -73,6 +84,22 @@ struct vkms_crtc_state {
 	u64 frame_end;
 };
 
+/**
+ * struct vkms_composer_stats - composition statistics of an output
+ * @frames: number of composed frames
+ * @last_ns: composition time of the last frame
+ * @max_ns: longest composition time
+ * @total_ns: sum of all composition times
+ * @missed_vblanks: vblanks which found the previous frame still pending
+ */
+struct vkms_composer_stats {
+	u64 frames;
+	u64 last_ns;
+	u64 max_ns;
+	u64 total_ns;
+	u64 missed_vblanks;
+};
+
 struct vkms_output {
 	struct drm_crtc crtc;
 	struct drm_encoder encoder;
@@ -91,6 +118,8 @@ struct vkms_output {
 	struct vkms_crtc_state *composer_state;
 
 	spinlock_t composer_lock;
+	/* protected by @composer_lock */
+	struct vkms_composer_stats stats;
 };
 
 struct vkms_device;
@@ -99,6 +128,8 @@ struct vkms_config {
 	bool writeback;
 	bool cursor;
 	bool overlay;
+	unsigned int num_outputs;
+	unsigned int composer_bands;
 	/* only set when instantiated */
 	struct vkms_device *dev;
 };
@@ -106,7 +137,7 @@ struct vkms_config {
 struct vkms_device {
 	struct drm_device drm;
 	struct platform_device *platform;
-	struct vkms_output output;
+	struct vkms_output output[VKMS_MAX_OUTPUTS];
 	const struct vkms_config *config;
 };
 
@@ -141,6 +172,7 @@ int vkms_verify_crc_source(struct drm_crtc *crtc, const char *source_name,
 /* Composer Support */
 void vkms_composer_worker(struct work_struct *work);
 void vkms_set_composer(struct vkms_output *out, bool enabled);
+vkms_fetch_line_t vkms_get_fetch_line(u32 format);
 
 /* Writeback */
 int vkms_enable_writeback_connector(struct vkms_device *vkmsdev);
@@ -81,6 +81,7 @@ static int vkms_wb_prepare_job(struct drm_writeback_connector *wb_connector,
 		goto err_kfree;
 	}
 
+	vkmsjob->pitch = job->fb->pitches[0];
 	job->priv = vkmsjob;
 
 	return 0;
@@ -102,7 +103,7 @@ static void vkms_wb_cleanup_job(struct drm_writeback_connector *connector,
 	drm_gem_fb_vunmap(job->fb, vkmsjob->map);
 
 	vkmsdev = drm_device_to_vkms_device(job->fb->dev);
-	vkms_set_composer(&vkmsdev->output, false);
+	vkms_set_composer(&vkmsdev->output[0], false);
 	kfree(vkmsjob);
 }
 
@@ -112,7 +113,7 @@ static void vkms_wb_atomic_commit(struct drm_connector *conn,
 	struct drm_connector_state *connector_state = drm_atomic_get_new_connector_state(state,
 											 conn);
 	struct vkms_device *vkmsdev = drm_device_to_vkms_device(conn->dev);
-	struct vkms_output *output = &vkmsdev->output;
+	struct vkms_output *output = &vkmsdev->output[0];
 	struct drm_writeback_connector *wb_conn = &output->wb_connector;
 	struct drm_connector_state *conn_state = wb_conn->base.state;
 	struct vkms_crtc_state *crtc_state = output->composer_state;
@@ -120,7 +121,7 @@ static void vkms_wb_atomic_commit(struct drm_connector *conn,
 	if (!conn_state)
 		return;
 
-	vkms_set_composer(&vkmsdev->output, true);
+	vkms_set_composer(&vkmsdev->output[0], true);
 
 	spin_lock_irq(&output->composer_lock);
 	crtc_state->active_writeback = conn_state->writeback_job->priv;
@@ -138,9 +139,9 @@ static const struct drm_connector_helper_funcs vkms_wb_conn_helper_funcs = {
 
 int vkms_enable_writeback_connector(struct vkms_device *vkmsdev)
 {
-	struct drm_writeback_connector *wb = &vkmsdev->output.wb_connector;
+	struct drm_writeback_connector *wb = &vkmsdev->output[0].wb_connector;
 
-	vkmsdev->output.wb_connector.encoder.possible_crtcs = 1;
+	vkmsdev->output[0].wb_connector.encoder.possible_crtcs = 1;
 	drm_connector_helper_add(&wb->base, &vkms_wb_conn_helper_funcs);
 
 	return drm_writeback_connector_init(&vkmsdev->drm, wb,
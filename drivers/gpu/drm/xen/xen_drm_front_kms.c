@@ -10,6 +10,7 @@
 
 #include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_drv.h>
 #include <drm/drm_fourcc.h>
 #include <drm/drm_gem.h>
@@ -49,6 +50,7 @@ static void fb_destroy(struct drm_framebuffer *fb)
 
 static const struct drm_framebuffer_funcs fb_funcs = {
 	.destroy = fb_destroy,
+	.dirty = drm_atomic_helper_dirtyfb,
 };
 
 static struct drm_framebuffer *
@@ -193,8 +195,20 @@ static bool display_send_page_flip(struct drm_simple_display_pipe *pipe,
 		struct xen_drm_front_drm_pipeline *pipeline =
 				to_xen_drm_pipeline(pipe);
 		struct xen_drm_front_drm_info *drm_info = pipeline->drm_info;
+		struct drm_rect damage;
 		int ret;
 
+		/*
+		 * The buffer is shared with the backend and its grants stay
+		 * valid as long as the buffer exists, so there is nothing to
+		 * hand over if the same framebuffer is flipped again without
+		 * any damage: don't make the backend recompose it.
+		 */
+		if (old_plane_state->fb == plane_state->fb &&
+		    !drm_atomic_helper_damage_merged(old_plane_state,
+						     plane_state, &damage))
+			return false;
+
 		schedule_delayed_work(&pipeline->pflip_to_worker,
 				      msecs_to_jiffies(FRAME_DONE_TO_MS));
 
@@ -328,10 +342,15 @@ static int display_pipe_init(struct xen_drm_front_drm_info *drm_info,
 
 	formats = xen_drm_front_conn_get_formats(&format_count);
 
-	return drm_simple_display_pipe_init(dev, &pipeline->pipe,
-					    &display_funcs, formats,
-					    format_count, NULL,
-					    &pipeline->conn);
+	ret = drm_simple_display_pipe_init(dev, &pipeline->pipe,
+					   &display_funcs, formats,
+					   format_count, NULL,
+					   &pipeline->conn);
+	if (ret)
+		return ret;
+
+	drm_plane_enable_fb_damage_clips(&pipeline->pipe.plane);
+	return 0;
 }
 
 int xen_drm_front_kms_init(struct xen_drm_front_drm_info *drm_info)
@@ -920,6 +920,7 @@ struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo
 		list_for_each_entry(mapping, &cache->mappings, entry) {
 			if (mapping->bo == bo && mapping->direction == dir) {
 				kref_get(&mapping->ref);
+				list_move_tail(&mapping->entry, &cache->mappings);
 				goto unlock;
 			}
 		}
@@ -959,9 +960,13 @@ static void __host1x_bo_unpin(struct kref *ref)
 	 * When the last reference of the mapping goes away, make sure to remove the mapping from
 	 * the cache.
 	 */
-	if (mapping->cache)
+	if (mapping->cache) {
 		list_del(&mapping->entry);
 
+		if (mapping->cache->release)
+			mapping->cache->release(mapping);
+	}
+
 	spin_lock(&mapping->bo->lock);
 	list_del(&mapping->list);
 	spin_unlock(&mapping->bo->lock);
@@ -982,3 +987,40 @@ void host1x_bo_unpin(struct host1x_bo_mapping *mapping)
 		mutex_unlock(&cache->lock);
 }
 EXPORT_SYMBOL(host1x_bo_unpin);
+
+/**
+ * host1x_bo_cache_trim() - drop idle mappings from a buffer object cache
+ * @cache: cache to trim
+ * @nr_to_scan: maximum number of mappings to drop
+ *
+ * Unpins up to @nr_to_scan mappings, least recently used first, that are
+ * only kept alive by the cache itself. Mappings in use by a job are left
+ * untouched.
+ *
+ * Returns the number of mappings that were dropped.
+ */
+unsigned long host1x_bo_cache_trim(struct host1x_bo_cache *cache,
+				   unsigned long nr_to_scan)
+{
+	struct host1x_bo_mapping *mapping, *tmp;
+	unsigned long freed = 0;
+
+	mutex_lock(&cache->lock);
+
+	list_for_each_entry_safe(mapping, tmp, &cache->mappings, entry) {
+		if (freed >= nr_to_scan)
+			break;
+
+		/* references are only taken and dropped under the cache lock */
+		if (kref_read(&mapping->ref) != 1)
+			continue;
+
+		kref_put(&mapping->ref, __host1x_bo_unpin);
+		freed++;
+	}
+
+	mutex_unlock(&cache->lock);
+
+	return freed;
+}
+EXPORT_SYMBOL(host1x_bo_cache_trim);
@@ -185,6 +185,35 @@ static const struct file_operations host1x_debug_fops = {
 	.release = single_release,
 };
 
+static int host1x_debug_wait_latency_show(struct seq_file *s, void *unused)
+{
+	static const char * const kinds[HOST1X_WAIT_COUNT] = {
+		[HOST1X_WAIT_SPIN] = "spin",
+		[HOST1X_WAIT_SLEEP] = "sleep",
+	};
+	struct host1x *m = s->private;
+	unsigned int i, j;
+
+	seq_puts(s, "usecs");
+	for (i = 0; i < HOST1X_WAIT_COUNT; i++)
+		seq_printf(s, "\t%s", kinds[i]);
+	seq_putc(s, '\n');
+
+	for (j = 0; j < HOST1X_WAIT_HIST_BUCKETS; j++) {
+		if (j == HOST1X_WAIT_HIST_BUCKETS - 1)
+			seq_printf(s, ">=%u", 1U << (j - 1));
+		else
+			seq_printf(s, "<%u", 1U << j);
+
+		for (i = 0; i < HOST1X_WAIT_COUNT; i++)
+			seq_printf(s, "\t%d", atomic_read(&m->wait_hist[i][j]));
+		seq_putc(s, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(host1x_debug_wait_latency);
+
 static void host1x_debugfs_init(struct host1x *host1x)
 {
 	struct dentry *de = debugfs_create_dir("tegra-host1x", NULL);
@@ -196,6 +225,9 @@ static void host1x_debugfs_init(struct host1x *host1x)
 	debugfs_create_file("status_all", S_IRUGO, de, host1x,
 			    &host1x_debug_all_fops);
 
+	debugfs_create_file("wait_latency", S_IRUGO, de, host1x,
+			    &host1x_debug_wait_latency_fops);
+
 	debugfs_create_u32("trace_cmdbuf", S_IRUGO|S_IWUSR, de,
 			   &host1x_debug_trace_cmdbuf);
 
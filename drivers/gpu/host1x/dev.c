@@ -31,6 +31,7 @@
 #include "debug.h"
 #include "dev.h"
 #include "intr.h"
+#include "job.h"
 
 #include "hw/host1x01.h"
 #include "hw/host1x02.h"
@@ -448,6 +449,8 @@ static int host1x_probe(struct platform_device *pdev)
 		return syncpt_irq;
 
 	host1x_bo_cache_init(&host->cache);
+	host->cache.release = host1x_job_release_gather;
+	mutex_init(&host->gather_lock);
 	mutex_init(&host->devices_lock);
 	INIT_LIST_HEAD(&host->devices);
 	INIT_LIST_HEAD(&host->list);
@@ -73,8 +73,7 @@ struct host1x_syncpt_ops {
 };
 
 struct host1x_intr_ops {
-	int (*init_host_sync)(struct host1x *host, u32 cpm,
-		void (*syncpt_thresh_work)(struct work_struct *work));
+	int (*init_host_sync)(struct host1x *host, u32 cpm);
 	void (*set_syncpt_threshold)(
 		struct host1x *host, unsigned int id, u32 thresh);
 	void (*enable_syncpt_intr)(struct host1x *host, unsigned int id);
@@ -128,6 +127,11 @@ struct host1x {
 
 	struct mutex intr_mutex;
 	int intr_syncpt_irq;
+	/* sync points whose threshold fired, processed by the IRQ thread */
+	unsigned long *intr_pending;
+
+	/* log2 histograms of host1x_syncpt_wait() latencies, in usecs */
+	atomic_t wait_hist[HOST1X_WAIT_COUNT][HOST1X_WAIT_HIST_BUCKETS];
 
 	const struct host1x_syncpt_ops *syncpt_op;
 	const struct host1x_intr_ops *intr_op;
@@ -152,6 +156,8 @@ struct host1x {
 	struct device_dma_parameters dma_parms;
 
 	struct host1x_bo_cache cache;
+	/* serializes mapping cached gathers into the IOMMU domain */
+	struct mutex gather_lock;
 };
 
 void host1x_hypervisor_writel(struct host1x *host1x, u32 r, u32 v);
@@ -203,10 +209,9 @@ static inline void host1x_hw_syncpt_enable_protection(struct host1x *host)
 	return host->syncpt_op->enable_protection(host);
 }
 
-static inline int host1x_hw_intr_init_host_sync(struct host1x *host, u32 cpm,
-			void (*syncpt_thresh_work)(struct work_struct *))
+static inline int host1x_hw_intr_init_host_sync(struct host1x *host, u32 cpm)
 {
-	return host->intr_op->init_host_sync(host, cpm, syncpt_thresh_work);
+	return host->intr_op->init_host_sync(host, cpm);
 }
 
 static inline void host1x_hw_intr_set_syncpt_threshold(struct host1x *host,
@@ -15,7 +15,8 @@
 
 /*
  * Sync point threshold interrupt service function
- * Handles sync point threshold triggers, in interrupt context
+ * Quiesces sync point threshold triggers, in interrupt context, the waiters
+ * are then processed by syncpt_thresh_thread()
  */
 static void host1x_intr_syncpt_handle(struct host1x_syncpt *syncpt)
 {
@@ -27,12 +28,13 @@ static void host1x_intr_syncpt_handle(struct host1x_syncpt *syncpt)
 	host1x_sync_writel(host, BIT(id % 32),
 		HOST1X_SYNC_SYNCPT_THRESH_CPU0_INT_STATUS(id / 32));
 
-	schedule_work(&syncpt->intr.work);
+	set_bit(id, host->intr_pending);
 }
 
 static irqreturn_t syncpt_thresh_isr(int irq, void *dev_id)
 {
 	struct host1x *host = dev_id;
+	irqreturn_t ret = IRQ_HANDLED;
 	unsigned long reg;
 	unsigned int i, id;
 
@@ -43,9 +45,22 @@ static irqreturn_t syncpt_thresh_isr(int irq, void *dev_id)
 			struct host1x_syncpt *syncpt =
 				host->syncpt + (i * 32 + id);
 			host1x_intr_syncpt_handle(syncpt);
+			ret = IRQ_WAKE_THREAD;
 		}
 	}
 
+	return ret;
+}
+
+static irqreturn_t syncpt_thresh_thread(int irq, void *dev_id)
+{
+	struct host1x *host = dev_id;
+	unsigned int id;
+
+	for_each_set_bit(id, host->intr_pending, host->info->nb_pts)
+		if (test_and_clear_bit(id, host->intr_pending))
+			host1x_intr_handle_syncpt(host->syncpt + id);
+
 	return IRQ_HANDLED;
 }
 
@@ -79,20 +94,15 @@ static void intr_hw_init(struct host1x *host, u32 cpm)
 }
 
 static int
-_host1x_intr_init_host_sync(struct host1x *host, u32 cpm,
-			    void (*syncpt_thresh_work)(struct work_struct *))
+_host1x_intr_init_host_sync(struct host1x *host, u32 cpm)
 {
-	unsigned int i;
 	int err;
 
 	host1x_hw_intr_disable_all_syncpt_intrs(host);
 
-	for (i = 0; i < host->info->nb_pts; i++)
-		INIT_WORK(&host->syncpt[i].intr.work, syncpt_thresh_work);
-
-	err = devm_request_irq(host->dev, host->intr_syncpt_irq,
-			       syncpt_thresh_isr, IRQF_SHARED,
-			       "host1x_syncpt", host);
+	err = devm_request_threaded_irq(host->dev, host->intr_syncpt_irq,
+					syncpt_thresh_isr, syncpt_thresh_thread,
+					IRQF_SHARED, "host1x_syncpt", host);
 	if (err < 0) {
 		WARN_ON(1);
 		return err;
@@ -128,13 +138,9 @@ static void _host1x_intr_disable_syncpt_intr(struct host1x *host,
 
 static int _host1x_free_syncpt_irq(struct host1x *host)
 {
-	unsigned int i;
-
+	/* waits for a running syncpt_thresh_thread() to finish */
 	devm_free_irq(host->dev, host->intr_syncpt_irq, host);
 
-	for (i = 0; i < host->info->nb_pts; i++)
-		cancel_work_sync(&host->syncpt[i].intr.work);
-
 	return 0;
 }
 
@@ -194,18 +194,12 @@ static int process_wait_list(struct host1x *host,
  * Sync point threshold interrupt service thread function
  * Handles sync point threshold triggers, in thread context
  */
-
-static void syncpt_thresh_work(struct work_struct *work)
+void host1x_intr_handle_syncpt(struct host1x_syncpt *syncpt)
 {
-	struct host1x_syncpt_intr *syncpt_intr =
-		container_of(work, struct host1x_syncpt_intr, work);
-	struct host1x_syncpt *syncpt =
-		container_of(syncpt_intr, struct host1x_syncpt, intr);
-	unsigned int id = syncpt->id;
 	struct host1x *host = syncpt->host;
 
 	(void)process_wait_list(host, syncpt,
-				host1x_syncpt_load(host->syncpt + id));
+				host1x_syncpt_load(host->syncpt + syncpt->id));
 }
 
 int host1x_intr_add_action(struct host1x *host, struct host1x_syncpt *syncpt,
@@ -287,6 +281,10 @@ int host1x_intr_init(struct host1x *host, unsigned int irq_sync)
 	mutex_init(&host->intr_mutex);
 	host->intr_syncpt_irq = irq_sync;
 
+	host->intr_pending = devm_bitmap_zalloc(host->dev, nb_pts, GFP_KERNEL);
+	if (!host->intr_pending)
+		return -ENOMEM;
+
 	for (id = 0; id < nb_pts; ++id) {
 		struct host1x_syncpt *syncpt = host->syncpt + id;
 
@@ -310,8 +308,7 @@ void host1x_intr_start(struct host1x *host)
 	int err;
 
 	mutex_lock(&host->intr_mutex);
-	err = host1x_hw_intr_init_host_sync(host, DIV_ROUND_UP(hz, 1000000),
-					    syncpt_thresh_work);
+	err = host1x_hw_intr_init_host_sync(host, DIV_ROUND_UP(hz, 1000000));
 	if (err) {
 		mutex_unlock(&host->intr_mutex);
 		return;
@@ -42,7 +42,6 @@ struct host1x_syncpt_intr {
 	spinlock_t lock;
 	struct list_head wait_head;
 	char thresh_irq_name[12];
-	struct work_struct work;
 };
 
 struct host1x_waitlist {
@@ -81,6 +80,12 @@ int host1x_intr_add_action(struct host1x *host, struct host1x_syncpt *syncpt,
 void host1x_intr_put_ref(struct host1x *host, unsigned int id, void *ref,
 			 bool flush);
 
+/*
+ * Run the actions of all waiters that have been satisfied by the current
+ * value of the sync point, called from the threaded interrupt handler.
+ */
+void host1x_intr_handle_syncpt(struct host1x_syncpt *syncpt);
+
 /* Initialize host1x sync point interrupt */
 int host1x_intr_init(struct host1x *host, unsigned int irq_sync);
 
@@ -9,6 +9,7 @@
 #include <linux/err.h>
 #include <linux/host1x.h>
 #include <linux/iommu.h>
+#include <linux/jhash.h>
 #include <linux/kref.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
@@ -132,6 +133,79 @@ void host1x_job_add_wait(struct host1x_job *job, u32 id, u32 thresh,
 }
 EXPORT_SYMBOL(host1x_job_add_wait);
 
+/*
+ * Gathers stay mapped into the host1x domain for as long as the host1x
+ * cache keeps their mapping, so resubmitting a gather reuses its IOVA.
+ */
+static int host1x_job_map_gather(struct host1x *host,
+				 struct host1x_bo_mapping *map)
+{
+	size_t gather_size = 0;
+	struct scatterlist *sg;
+	unsigned long shift;
+	struct iova *alloc;
+	unsigned int i;
+	int err = 0;
+
+	mutex_lock(&host->gather_lock);
+
+	if (map->domain_mapped)
+		goto unlock;
+
+	for_each_sgtable_sg(map->sgt, sg, i)
+		gather_size += sg->length;
+
+	gather_size = iova_align(&host->iova, gather_size);
+
+	shift = iova_shift(&host->iova);
+	alloc = alloc_iova(&host->iova, gather_size >> shift,
+			   host->iova_end >> shift, true);
+	if (!alloc) {
+		/* make room by dropping gathers that no job uses anymore */
+		host1x_bo_cache_trim(&host->cache, ULONG_MAX);
+
+		alloc = alloc_iova(&host->iova, gather_size >> shift,
+				   host->iova_end >> shift, true);
+		if (!alloc) {
+			err = -ENOMEM;
+			goto unlock;
+		}
+	}
+
+	err = iommu_map_sgtable(host->domain, iova_dma_addr(&host->iova, alloc),
+				map->sgt, IOMMU_READ);
+	if (err == 0) {
+		__free_iova(&host->iova, alloc);
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	map->phys = iova_dma_addr(&host->iova, alloc);
+	map->size = gather_size;
+	map->domain_mapped = true;
+	err = 0;
+
+unlock:
+	mutex_unlock(&host->gather_lock);
+	return err;
+}
+
+/*
+ * Called by the host1x cache when it unpins a gather mapping, because the
+ * gather buffer is destroyed or the cache is trimmed.
+ */
+void host1x_job_release_gather(struct host1x_bo_mapping *map)
+{
+	struct host1x *host = dev_get_drvdata(map->dev);
+
+	if (!map->domain_mapped)
+		return;
+
+	iommu_unmap(host->domain, map->phys, map->size);
+	free_iova(&host->iova, iova_pfn(&host->iova, map->phys));
+	map->domain_mapped = false;
+}
+
 static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 {
 	unsigned long mask = HOST1X_RELOC_READ | HOST1X_RELOC_WRITE;
@@ -205,11 +279,6 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 
 	for (i = 0; i < job->num_cmds; i++) {
 		struct host1x_bo_mapping *map;
-		size_t gather_size = 0;
-		struct scatterlist *sg;
-		unsigned long shift;
-		struct iova *alloc;
-		unsigned int j;
 
 		if (job->cmds[i].is_wait)
 			continue;
@@ -225,33 +294,15 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 		map = host1x_bo_pin(host->dev, g->bo, DMA_TO_DEVICE, &host->cache);
 		if (IS_ERR(map)) {
 			err = PTR_ERR(map);
-			goto unpin;
+			goto put;
 		}
 
 		if (host->domain) {
-			for_each_sgtable_sg(map->sgt, sg, j)
-				gather_size += sg->length;
-
-			gather_size = iova_align(&host->iova, gather_size);
-
-			shift = iova_shift(&host->iova);
-			alloc = alloc_iova(&host->iova, gather_size >> shift,
-					   host->iova_end >> shift, true);
-			if (!alloc) {
-				err = -ENOMEM;
-				goto put;
-			}
-
-			err = iommu_map_sgtable(host->domain, iova_dma_addr(&host->iova, alloc),
-						map->sgt, IOMMU_READ);
-			if (err == 0) {
-				__free_iova(&host->iova, alloc);
-				err = -EINVAL;
+			err = host1x_job_map_gather(host, map);
+			if (err) {
+				host1x_bo_unpin(map);
 				goto put;
 			}
-
-			map->phys = iova_dma_addr(&host->iova, alloc);
-			map->size = gather_size;
 		}
 
 		job->addr_phys[job->num_unpins] = map->phys;
@@ -259,6 +310,7 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 		job->num_unpins++;
 
 		job->gather_addr_phys[i] = map->phys;
+		g->map = map;
 	}
 
 	return 0;
@@ -274,8 +326,31 @@ static int do_relocs(struct host1x_job *job, struct host1x_job_gather *g)
 {
 	void *cmdbuf_addr = NULL;
 	struct host1x_bo *cmdbuf = g->bo;
+	u32 hash = 0;
 	unsigned int i;
 
+	/*
+	 * Skip mapping and patching the command buffer if the relocations
+	 * resolve to the same addresses as when it was last patched.
+	 */
+	if (!job->enable_firewall && g->map) {
+		for (i = 0; i < job->num_relocs; i++) {
+			struct host1x_reloc *reloc = &job->relocs[i];
+			u32 reloc_addr = (job->reloc_addr_phys[i] +
+					  reloc->target.offset) >> reloc->shift;
+
+			if (cmdbuf == reloc->cmdbuf.bo)
+				hash = jhash_2words(reloc->cmdbuf.offset,
+						    reloc_addr, hash);
+		}
+
+		/* 0 means that nothing has been recorded */
+		hash = hash ?: 1;
+
+		if (job->reuse_relocs && g->map->reloc_hash == hash)
+			return 0;
+	}
+
 	/* pin & patch the relocs for one gather */
 	for (i = 0; i < job->num_relocs; i++) {
 		struct host1x_reloc *reloc = &job->relocs[i];
@@ -311,6 +386,9 @@ static int do_relocs(struct host1x_job *job, struct host1x_job_gather *g)
 	if (cmdbuf_addr)
 		host1x_bo_munmap(cmdbuf, cmdbuf_addr);
 
+	if (!job->enable_firewall && g->map)
+		g->map->reloc_hash = hash;
+
 	return 0;
 }
 
@@ -653,11 +731,6 @@ void host1x_job_unpin(struct host1x_job *job)
 		struct host1x_bo_mapping *map = job->unpins[i].map;
 		struct host1x_bo *bo = map->bo;
 
-		if (!job->enable_firewall && map->size && host->domain) {
-			iommu_unmap(host->domain, job->addr_phys[i], map->size);
-			free_iova(&host->iova, iova_pfn(&host->iova, job->addr_phys[i]));
-		}
-
 		host1x_bo_unpin(map);
 		host1x_bo_put(bo);
 	}
@@ -16,6 +16,7 @@ struct host1x_job_gather {
 	struct host1x_bo *bo;
 	unsigned int offset;
 	bool handled;
+	struct host1x_bo_mapping *map;
 };
 
 struct host1x_job_wait {
@@ -38,6 +39,8 @@ struct host1x_job_unpin_data {
 	struct host1x_bo_mapping *map;
 };
 
+void host1x_job_release_gather(struct host1x_bo_mapping *map);
+
 /*
  * Dump contents of job to debug output.
  */
@@ -19,6 +19,10 @@
 #define SYNCPT_CHECK_PERIOD (2 * HZ)
 #define MAX_STUCK_CHECK_COUNT 15
 
+static unsigned int wait_spin_us = 20;
+module_param(wait_spin_us, uint, 0644);
+MODULE_PARM_DESC(wait_spin_us, "Maximum time to poll a sync point before sleeping on its interrupt, in usecs (0 = never poll)");
+
 static struct host1x_syncpt_base *
 host1x_syncpt_base_request(struct host1x *host)
 {
@@ -213,6 +217,52 @@ static bool syncpt_load_min_is_expired(struct host1x_syncpt *sp, u32 thresh)
 	return host1x_syncpt_is_expired(sp, thresh);
 }
 
+/*
+ * Poll the sync point for a short while before falling back to the threshold
+ * interrupt, which costs a waiter allocation, an interrupt and a wakeup. The
+ * budget follows the recent wait times of this sync point: twice the average
+ * if that is below the wait_spin_us limit, the full limit otherwise so that a
+ * sync point whose waits got shorter is noticed again.
+ */
+static bool syncpt_spin_is_expired(struct host1x_syncpt *sp, u32 thresh)
+{
+	u64 limit = (u64)READ_ONCE(wait_spin_us) * NSEC_PER_USEC;
+	u64 avg = READ_ONCE(sp->wait_avg_ns);
+	ktime_t end;
+
+	if (!limit)
+		return false;
+
+	end = ktime_add_ns(ktime_get(), avg && 2 * avg < limit ?
+					2 * avg : limit);
+	do {
+		if (syncpt_load_min_is_expired(sp, thresh))
+			return true;
+
+		if (need_resched())
+			break;
+
+		cpu_relax();
+	} while (ktime_before(ktime_get(), end));
+
+	return false;
+}
+
+static void syncpt_wait_account(struct host1x_syncpt *sp,
+				enum host1x_wait_kind kind, ktime_t start)
+{
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	u32 avg = READ_ONCE(sp->wait_avg_ns);
+	unsigned int bucket;
+
+	ns = clamp_t(s64, ns, 0, U32_MAX);
+	WRITE_ONCE(sp->wait_avg_ns, avg - avg / 8 + (u32)ns / 8);
+
+	bucket = min_t(unsigned int, fls64(div_u64(ns, NSEC_PER_USEC)),
+		       HOST1X_WAIT_HIST_BUCKETS - 1);
+	atomic_inc(&sp->host->wait_hist[kind][bucket]);
+}
+
 /**
  * host1x_syncpt_wait() - wait for a syncpoint to reach a given value
  * @sp: host1x syncpoint
@@ -227,6 +277,7 @@ int host1x_syncpt_wait(struct host1x_syncpt *sp, u32 thresh, long timeout,
 	void *ref;
 	struct host1x_waitlist *waiter;
 	int err = 0, check_count = 0;
+	ktime_t start;
 	u32 val;
 
 	if (value)
@@ -254,6 +305,16 @@ int host1x_syncpt_wait(struct host1x_syncpt *sp, u32 thresh, long timeout,
 		goto done;
 	}
 
+	/* poll briefly if this sync point's waits tend to be short */
+	start = ktime_get();
+	if (syncpt_spin_is_expired(sp, thresh)) {
+		if (value)
+			*value = host1x_syncpt_load(sp);
+
+		syncpt_wait_account(sp, HOST1X_WAIT_SPIN, start);
+		goto done;
+	}
+
 	/* allocate a waiter */
 	waiter = kzalloc(sizeof(*waiter), GFP_KERNEL);
 	if (!waiter) {
@@ -285,6 +346,7 @@ int host1x_syncpt_wait(struct host1x_syncpt *sp, u32 thresh, long timeout,
 			if (value)
 				*value = host1x_syncpt_load(sp);
 
+			syncpt_wait_account(sp, HOST1X_WAIT_SLEEP, start);
 			err = 0;
 
 			break;
@@ -21,6 +21,15 @@ struct host1x;
 /* Reserved for replacing an expired wait with a NOP */
 #define HOST1X_SYNCPT_RESERVED			0
 
+/* How a host1x_syncpt_wait() that had to wait was satisfied */
+enum host1x_wait_kind {
+	HOST1X_WAIT_SPIN,
+	HOST1X_WAIT_SLEEP,
+	HOST1X_WAIT_COUNT
+};
+
+#define HOST1X_WAIT_HIST_BUCKETS		16
+
 struct host1x_syncpt_base {
 	unsigned int id;
 	bool requested;
@@ -41,6 +50,9 @@ struct host1x_syncpt {
 	/* interrupt data */
 	struct host1x_syncpt_intr intr;
 
+	/* running average of the time host1x_syncpt_wait() had to wait */
+	u32 wait_avg_ns;
+
 	/*
 	 * If a submission incrementing this syncpoint fails, lock it so that
 	 * further submission cannot be made until application has handled the
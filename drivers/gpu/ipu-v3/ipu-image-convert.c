@@ -7,6 +7,8 @@
 
 #include <linux/interrupt.h>
 #include <linux/dma-mapping.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
 #include <video/imx-ipu-image-convert.h>
 #include "ipu-prv.h"
 
@@ -221,9 +223,39 @@ struct ipu_image_convert_chan {
 	struct ipu_image_convert_run *current_run;
 };
 
+/* number of tiling layouts remembered by each IPU */
+#define LAYOUT_CACHE_SIZE 8
+
+/*
+ * The tiling layout only depends on the formats, sizes and rotation mode,
+ * and is reused by later conversion contexts for the same parameters.
+ */
+struct ipu_image_convert_layout {
+	struct list_head list;
+
+	enum ipu_rotate_mode rot_mode;
+	/* in.base and out.base without buffer addresses are the lookup key */
+	struct ipu_image_convert_image in;
+	struct ipu_image_convert_image out;
+	struct ipu_ic_csc csc;
+	u32 downsize_coeff_h;
+	u32 downsize_coeff_v;
+	u32 image_resize_coeff_h;
+	u32 image_resize_coeff_v;
+	u32 resize_coeffs_h[MAX_STRIPES_W];
+	u32 resize_coeffs_v[MAX_STRIPES_H];
+	unsigned int num_tiles;
+	unsigned int out_tile_map[MAX_TILES];
+};
+
 struct ipu_image_convert_priv {
 	struct ipu_image_convert_chan chan[IC_NUM_TASKS];
 	struct ipu_soc *ipu;
+
+	/* most recently used tiling layouts first */
+	struct mutex layout_lock;
+	struct list_head layout_cache;
+	unsigned int num_layouts;
 };
 
 static const struct ipu_image_convert_dma_chan
@@ -1947,6 +1979,184 @@ static int fill_image(struct ipu_image_convert_ctx *ctx,
 	return 0;
 }
 
+/*
+ * Calculate the tiling layout, the per tile resizing coefficients and the
+ * color space conversion for the given images and ctx->rot_mode.
+ */
+static int calc_layout(struct ipu_image_convert_ctx *ctx,
+		       struct ipu_image *in, struct ipu_image *out)
+{
+	struct ipu_image_convert_image *s_image = &ctx->in;
+	struct ipu_image_convert_image *d_image = &ctx->out;
+	int ret;
+
+	/* Sets ctx->in.num_rows/cols as well */
+	ret = calc_image_resize_coefficients(ctx, in, out);
+	if (ret)
+		return ret;
+
+	/* set tiling and rotation */
+	if (ipu_rot_mode_is_irt(ctx->rot_mode)) {
+		d_image->num_rows = s_image->num_cols;
+		d_image->num_cols = s_image->num_rows;
+	} else {
+		d_image->num_rows = s_image->num_rows;
+		d_image->num_cols = s_image->num_cols;
+	}
+
+	ctx->num_tiles = d_image->num_cols * d_image->num_rows;
+
+	ret = fill_image(ctx, s_image, in, IMAGE_CONVERT_IN);
+	if (ret)
+		return ret;
+	ret = fill_image(ctx, d_image, out, IMAGE_CONVERT_OUT);
+	if (ret)
+		return ret;
+
+	calc_out_tile_map(ctx);
+
+	find_seams(ctx, s_image, d_image);
+
+	ret = calc_tile_dimensions(ctx, s_image);
+	if (ret)
+		return ret;
+
+	ret = calc_tile_offsets(ctx, s_image);
+	if (ret)
+		return ret;
+
+	calc_tile_dimensions(ctx, d_image);
+	ret = calc_tile_offsets(ctx, d_image);
+	if (ret)
+		return ret;
+
+	calc_tile_resize_coefficients(ctx);
+
+	return ipu_ic_calc_csc(&ctx->csc,
+			s_image->base.pix.ycbcr_enc,
+			s_image->base.pix.quantization,
+			ipu_pixelformat_to_colorspace(s_image->fmt->fourcc),
+			d_image->base.pix.ycbcr_enc,
+			d_image->base.pix.quantization,
+			ipu_pixelformat_to_colorspace(d_image->fmt->fourcc));
+}
+
+static bool layout_matches(struct ipu_image_convert_layout *layout,
+			   struct ipu_image *in, struct ipu_image *out,
+			   enum ipu_rotate_mode rot_mode)
+{
+	return layout->rot_mode == rot_mode &&
+		!memcmp(&layout->in.base.pix, &in->pix, sizeof(in->pix)) &&
+		!memcmp(&layout->in.base.rect, &in->rect, sizeof(in->rect)) &&
+		!memcmp(&layout->out.base.pix, &out->pix, sizeof(out->pix)) &&
+		!memcmp(&layout->out.base.rect, &out->rect, sizeof(out->rect));
+}
+
+/*
+ * Look up the layout of an earlier conversion context with the same
+ * formats, sizes and rotation mode, and copy it to ctx.
+ */
+static bool get_cached_layout(struct ipu_image_convert_ctx *ctx,
+			      struct ipu_image *in, struct ipu_image *out)
+{
+	struct ipu_image_convert_priv *priv = ctx->chan->priv;
+	struct ipu_image_convert_layout *layout;
+	bool found = false;
+
+	mutex_lock(&priv->layout_lock);
+
+	list_for_each_entry(layout, &priv->layout_cache, list) {
+		if (!layout_matches(layout, in, out, ctx->rot_mode))
+			continue;
+
+		ctx->in = layout->in;
+		ctx->out = layout->out;
+		ctx->csc = layout->csc;
+		ctx->downsize_coeff_h = layout->downsize_coeff_h;
+		ctx->downsize_coeff_v = layout->downsize_coeff_v;
+		ctx->image_resize_coeff_h = layout->image_resize_coeff_h;
+		ctx->image_resize_coeff_v = layout->image_resize_coeff_v;
+		memcpy(ctx->resize_coeffs_h, layout->resize_coeffs_h,
+		       sizeof(ctx->resize_coeffs_h));
+		memcpy(ctx->resize_coeffs_v, layout->resize_coeffs_v,
+		       sizeof(ctx->resize_coeffs_v));
+		ctx->num_tiles = layout->num_tiles;
+		memcpy(ctx->out_tile_map, layout->out_tile_map,
+		       sizeof(ctx->out_tile_map));
+
+		/* keep the most recently used layout at the head */
+		list_move(&layout->list, &priv->layout_cache);
+		found = true;
+		break;
+	}
+
+	mutex_unlock(&priv->layout_lock);
+
+	if (found) {
+		ctx->in.base = *in;
+		ctx->out.base = *out;
+		dev_dbg(priv->ipu->dev, "%s: task %u: ctx %p: cached layout\n",
+			__func__, ctx->chan->ic_task, ctx);
+	}
+
+	return found;
+}
+
+/*
+ * Remember the layout calculated for ctx, replacing the least recently
+ * used one if the cache is full. Failing to allocate is not an error,
+ * the layout is just calculated again next time.
+ */
+static void put_cached_layout(struct ipu_image_convert_ctx *ctx,
+			      struct ipu_image *in, struct ipu_image *out)
+{
+	struct ipu_image_convert_priv *priv = ctx->chan->priv;
+	struct ipu_image_convert_layout *layout;
+
+	mutex_lock(&priv->layout_lock);
+
+	list_for_each_entry(layout, &priv->layout_cache, list) {
+		/* added by a concurrent prepare */
+		if (layout_matches(layout, in, out, ctx->rot_mode))
+			goto out_unlock;
+	}
+
+	if (priv->num_layouts < LAYOUT_CACHE_SIZE) {
+		layout = kzalloc(sizeof(*layout), GFP_KERNEL);
+		if (!layout)
+			goto out_unlock;
+		priv->num_layouts++;
+	} else {
+		layout = list_last_entry(&priv->layout_cache,
+					 struct ipu_image_convert_layout, list);
+		list_del(&layout->list);
+	}
+
+	layout->rot_mode = ctx->rot_mode;
+	layout->in = ctx->in;
+	layout->out = ctx->out;
+	/* the buffer addresses are set per run */
+	layout->in.base.phys0 = layout->in.base.phys1 = 0;
+	layout->out.base.phys0 = layout->out.base.phys1 = 0;
+	layout->csc = ctx->csc;
+	layout->downsize_coeff_h = ctx->downsize_coeff_h;
+	layout->downsize_coeff_v = ctx->downsize_coeff_v;
+	layout->image_resize_coeff_h = ctx->image_resize_coeff_h;
+	layout->image_resize_coeff_v = ctx->image_resize_coeff_v;
+	memcpy(layout->resize_coeffs_h, ctx->resize_coeffs_h,
+	       sizeof(layout->resize_coeffs_h));
+	memcpy(layout->resize_coeffs_v, ctx->resize_coeffs_v,
+	       sizeof(layout->resize_coeffs_v));
+	layout->num_tiles = ctx->num_tiles;
+	memcpy(layout->out_tile_map, ctx->out_tile_map,
+	       sizeof(layout->out_tile_map));
+
+	list_add(&layout->list, &priv->layout_cache);
+
+out_unlock:
+	mutex_unlock(&priv->layout_lock);
+}
+
 /* borrowed from drivers/media/v4l2-core/v4l2-common.c */
 static unsigned int clamp_align(unsigned int x, unsigned int min,
 				unsigned int max, unsigned int align)
@@ -2112,61 +2322,16 @@ ipu_image_convert_prepare(struct ipu_soc *ipu, enum ipu_ic_task ic_task,
 
 	ctx->rot_mode = rot_mode;
 
-	/* Sets ctx->in.num_rows/cols as well */
-	ret = calc_image_resize_coefficients(ctx, in, out);
-	if (ret)
-		goto out_free;
-
 	s_image = &ctx->in;
 	d_image = &ctx->out;
 
-	/* set tiling and rotation */
-	if (ipu_rot_mode_is_irt(rot_mode)) {
-		d_image->num_rows = s_image->num_cols;
-		d_image->num_cols = s_image->num_rows;
-	} else {
-		d_image->num_rows = s_image->num_rows;
-		d_image->num_cols = s_image->num_cols;
+	if (!get_cached_layout(ctx, in, out)) {
+		ret = calc_layout(ctx, in, out);
+		if (ret)
+			goto out_free;
+		put_cached_layout(ctx, in, out);
 	}
 
-	ctx->num_tiles = d_image->num_cols * d_image->num_rows;
-
-	ret = fill_image(ctx, s_image, in, IMAGE_CONVERT_IN);
-	if (ret)
-		goto out_free;
-	ret = fill_image(ctx, d_image, out, IMAGE_CONVERT_OUT);
-	if (ret)
-		goto out_free;
-
-	calc_out_tile_map(ctx);
-
-	find_seams(ctx, s_image, d_image);
-
-	ret = calc_tile_dimensions(ctx, s_image);
-	if (ret)
-		goto out_free;
-
-	ret = calc_tile_offsets(ctx, s_image);
-	if (ret)
-		goto out_free;
-
-	calc_tile_dimensions(ctx, d_image);
-	ret = calc_tile_offsets(ctx, d_image);
-	if (ret)
-		goto out_free;
-
-	calc_tile_resize_coefficients(ctx);
-
-	ret = ipu_ic_calc_csc(&ctx->csc,
-			s_image->base.pix.ycbcr_enc,
-			s_image->base.pix.quantization,
-			ipu_pixelformat_to_colorspace(s_image->fmt->fourcc),
-			d_image->base.pix.ycbcr_enc,
-			d_image->base.pix.quantization,
-			ipu_pixelformat_to_colorspace(d_image->fmt->fourcc));
-	if (ret)
-		goto out_free;
-
 	dump_format(ctx, s_image);
 	dump_format(ctx, d_image);
 
@@ -2487,6 +2652,9 @@ int ipu_image_convert_init(struct ipu_soc *ipu, struct device *dev)
 	ipu->image_convert_priv = priv;
 	priv->ipu = ipu;
 
+	mutex_init(&priv->layout_lock);
+	INIT_LIST_HEAD(&priv->layout_cache);
+
 	for (i = 0; i < IC_NUM_TASKS; i++) {
 		struct ipu_image_convert_chan *chan = &priv->chan[i];
 
@@ -2509,4 +2677,12 @@ int ipu_image_convert_init(struct ipu_soc *ipu, struct device *dev)
 
 void ipu_image_convert_exit(struct ipu_soc *ipu)
 {
+	struct ipu_image_convert_priv *priv = ipu->image_convert_priv;
+	struct ipu_image_convert_layout *layout, *tmp;
+
+	list_for_each_entry_safe(layout, tmp, &priv->layout_cache, list) {
+		list_del(&layout->list);
+		kfree(layout);
+	}
+	priv->num_layouts = 0;
 }
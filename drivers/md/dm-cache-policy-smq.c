@@ -13,6 +13,7 @@
 #include <linux/jiffies.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/vmalloc.h>
 #include <linux/math64.h>
 
@@ -570,10 +571,19 @@ static enum performance stats_assess(struct stats *s)
 
 /*----------------------------------------------------------------*/
 
+/*
+ * The buckets are covered by a set of locks, nested inside the policy lock,
+ * so that hits can be looked up without taking the policy lock.  Only the
+ * hash_next links are protected by them: lookups under a bucket lock alone
+ * must not modify the entries they find.
+ */
+#define NR_HASH_LOCKS 64u
+
 struct smq_hash_table {
 	struct entry_space *es;
 	unsigned long long hash_bits;
 	unsigned *buckets;
+	spinlock_t locks[NR_HASH_LOCKS];
 };
 
 /*
@@ -595,6 +605,9 @@ static int h_init(struct smq_hash_table *ht, struct entry_space *es, unsigned nr
 	for (i = 0; i < nr_buckets; i++)
 		ht->buckets[i] = INDEXER_NULL;
 
+	for (i = 0; i < NR_HASH_LOCKS; i++)
+		spin_lock_init(&ht->locks[i]);
+
 	return 0;
 }
 
@@ -603,6 +616,11 @@ static void h_exit(struct smq_hash_table *ht)
 	vfree(ht->buckets);
 }
 
+static spinlock_t *h_lock(struct smq_hash_table *ht, unsigned bucket)
+{
+	return &ht->locks[bucket & (NR_HASH_LOCKS - 1u)];
+}
+
 static struct entry *h_head(struct smq_hash_table *ht, unsigned bucket)
 {
 	return to_entry(ht->es, ht->buckets[bucket]);
@@ -622,7 +640,10 @@ static void __h_insert(struct smq_hash_table *ht, unsigned bucket, struct entry
 static void h_insert(struct smq_hash_table *ht, struct entry *e)
 {
 	unsigned h = hash_64(from_oblock(e->oblock), ht->hash_bits);
+
+	spin_lock(h_lock(ht, h));
 	__h_insert(ht, h, e);
+	spin_unlock(h_lock(ht, h));
 }
 
 static struct entry *__h_lookup(struct smq_hash_table *ht, unsigned h, dm_oblock_t oblock,
@@ -658,6 +679,7 @@ static struct entry *h_lookup(struct smq_hash_table *ht, dm_oblock_t oblock)
 	struct entry *e, *prev;
 	unsigned h = hash_64(from_oblock(oblock), ht->hash_bits);
 
+	spin_lock(h_lock(ht, h));
 	e = __h_lookup(ht, h, oblock, &prev);
 	if (e && prev) {
 		/*
@@ -667,6 +689,7 @@ static struct entry *h_lookup(struct smq_hash_table *ht, dm_oblock_t oblock)
 		__h_unlink(ht, h, e, prev);
 		__h_insert(ht, h, e);
 	}
+	spin_unlock(h_lock(ht, h));
 
 	return e;
 }
@@ -680,9 +703,11 @@ static void h_remove(struct smq_hash_table *ht, struct entry *e)
 	 * The down side of using a singly linked list is we have to
 	 * iterate the bucket to remove an item.
 	 */
+	spin_lock(h_lock(ht, h));
 	e = __h_lookup(ht, h, e->oblock, &prev);
 	if (e)
 		__h_unlink(ht, h, e, prev);
+	spin_unlock(h_lock(ht, h));
 }
 
 /*----------------------------------------------------------------*/
@@ -827,6 +852,14 @@ struct smq_policy {
 	struct stats hotspot_stats;
 	struct stats cache_stats;
 
+	/*
+	 * Cache hits taken by smq_lookup_fast(), counted per cpu and folded
+	 * into cache_stats on each tick.
+	 */
+	struct stats __percpu *fast_stats;
+	unsigned fast_hits_folded;
+	unsigned fast_misses_folded;
+
 	/*
 	 * Keeps track of time, incremented by the core.  We use this to
 	 * avoid attributing multiple hits within the same tick.
@@ -1352,6 +1385,7 @@ static void smq_destroy(struct dm_cache_policy *p)
 	struct smq_policy *mq = to_smq_policy(p);
 
 	btracker_destroy(mq->bg_work);
+	free_percpu(mq->fast_stats);
 	h_exit(&mq->hotspot_table);
 	h_exit(&mq->table);
 	free_bitset(mq->hotspot_hit_bits);
@@ -1397,6 +1431,56 @@ static int __lookup(struct smq_policy *mq, dm_oblock_t oblock, dm_cblock_t *cblo
 	}
 }
 
+/*
+ * Most lookups are hits on blocks which have been requeued already in the
+ * current cache period, and so have nothing to update but the stats.  Those
+ * only need the bucket lock, the rest falls back to __lookup() under the
+ * policy lock.
+ */
+static bool smq_lookup_fast(struct smq_policy *mq, dm_oblock_t oblock,
+			    dm_cblock_t *cblock)
+{
+	struct smq_hash_table *ht = &mq->table;
+	unsigned h = hash_64(from_oblock(oblock), ht->hash_bits);
+	struct entry *e, *prev;
+	unsigned long flags;
+	bool hit = false;
+
+	spin_lock_irqsave(h_lock(ht, h), flags);
+	e = __h_lookup(ht, h, oblock, &prev);
+	if (e && (e->pending_work ||
+		  test_bit(from_cblock(infer_cblock(mq, e)), mq->cache_hit_bits))) {
+		if (e->level >= mq->cache_stats.hit_threshold)
+			this_cpu_inc(mq->fast_stats->hits);
+		else
+			this_cpu_inc(mq->fast_stats->misses);
+		*cblock = infer_cblock(mq, e);
+		hit = true;
+	}
+	spin_unlock_irqrestore(h_lock(ht, h), flags);
+
+	return hit;
+}
+
+static void fold_fast_stats(struct smq_policy *mq)
+{
+	unsigned hits = 0, misses = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct stats *s = per_cpu_ptr(mq->fast_stats, cpu);
+
+		hits += READ_ONCE(s->hits);
+		misses += READ_ONCE(s->misses);
+	}
+
+	/* the per cpu counters never get reset, only add what's new */
+	mq->cache_stats.hits += hits - mq->fast_hits_folded;
+	mq->cache_stats.misses += misses - mq->fast_misses_folded;
+	mq->fast_hits_folded = hits;
+	mq->fast_misses_folded = misses;
+}
+
 static int smq_lookup(struct dm_cache_policy *p, dm_oblock_t oblock, dm_cblock_t *cblock,
 		      int data_dir, bool fast_copy,
 		      bool *background_work)
@@ -1405,6 +1489,11 @@ static int smq_lookup(struct dm_cache_policy *p, dm_oblock_t oblock, dm_cblock_t
 	unsigned long flags;
 	struct smq_policy *mq = to_smq_policy(p);
 
+	if (smq_lookup_fast(mq, oblock, cblock)) {
+		*background_work = false;
+		return 0;
+	}
+
 	spin_lock_irqsave(&mq->lock, flags);
 	r = __lookup(mq, oblock, cblock,
 		     data_dir, fast_copy,
@@ -1424,6 +1513,9 @@ static int smq_lookup_with_work(struct dm_cache_policy *p,
 	unsigned long flags;
 	struct smq_policy *mq = to_smq_policy(p);
 
+	if (smq_lookup_fast(mq, oblock, cblock))
+		return 0;
+
 	spin_lock_irqsave(&mq->lock, flags);
 	r = __lookup(mq, oblock, cblock, data_dir, fast_copy, work, &background_queued);
 	spin_unlock_irqrestore(&mq->lock, flags);
@@ -1620,6 +1712,7 @@ static void smq_tick(struct dm_cache_policy *p, bool can_block)
 
 	spin_lock_irqsave(&mq->lock, flags);
 	mq->tick++;
+	fold_fast_stats(mq);
 	update_sentinels(mq);
 	end_hotspot_period(mq);
 	end_cache_period(mq);
@@ -1802,6 +1895,10 @@ static struct dm_cache_policy *__smq_create(dm_cblock_t cache_size,
 	mq->next_hotspot_period = jiffies;
 	mq->next_cache_period = jiffies;
 
+	mq->fast_stats = alloc_percpu(struct stats);
+	if (!mq->fast_stats)
+		goto bad_fast_stats;
+
 	mq->bg_work = btracker_create(4096); /* FIXME: hard coded value */
 	if (!mq->bg_work)
 		goto bad_btracker;
@@ -1811,6 +1908,8 @@ static struct dm_cache_policy *__smq_create(dm_cblock_t cache_size,
 	return &mq->policy;
 
 bad_btracker:
+	free_percpu(mq->fast_stats);
+bad_fast_stats:
 	h_exit(&mq->hotspot_table);
 bad_alloc_hotspot_table:
 	h_exit(&mq->table);
@@ -291,6 +291,8 @@ struct cache_stats {
 	atomic_t cache_cell_clash;
 	atomic_t commit_count;
 	atomic_t discard_count;
+	atomic64_t migrated_sectors;
+	atomic64_t migration_us;	/* summed over all migrations */
 };
 
 struct cache {
@@ -425,6 +427,8 @@ struct dm_cache_migration {
 
 	dm_cblock_t invalidate_cblock;
 	dm_oblock_t invalidate_oblock;
+
+	ktime_t start;
 };
 
 /*----------------------------------------------------------------*/
@@ -1168,8 +1172,13 @@ static void mg_complete(struct dm_cache_migration *mg, bool success)
 	struct policy_work *op = mg->op;
 	dm_cblock_t cblock = op->cblock;
 
-	if (success)
+	if (success) {
 		update_stats(&cache->stats, op->op);
+		atomic64_add(cache->sectors_per_block,
+			     &cache->stats.migrated_sectors);
+		atomic64_add(ktime_us_delta(ktime_get(), mg->start),
+			     &cache->stats.migration_us);
+	}
 
 	switch (op->op) {
 	case POLICY_PROMOTE:
@@ -1431,6 +1440,7 @@ static int mg_start(struct cache *cache, struct policy_work *op, struct bio *bio
 
 	mg->op = op;
 	mg->overwrite_bio = bio;
+	mg->start = ktime_get();
 
 	if (!bio)
 		inc_io_migrations(cache);
@@ -3041,6 +3051,7 @@ static void cache_status(struct dm_target *ti, status_type_t type,
 	struct cache *cache = ti->private;
 	dm_cblock_t residency;
 	bool needs_check;
+	u64 nr_migrations;
 
 	switch (type) {
 	case STATUSTYPE_INFO:
@@ -3108,6 +3119,19 @@ static void cache_status(struct dm_target *ti, status_type_t type,
 		else
 			DMEMIT("- ");
 
+		/*
+		 * Sectors migrated so far and the average latency of a
+		 * migration in microseconds, the bandwidth follows from
+		 * sampling the former.
+		 */
+		nr_migrations = atomic_read(&cache->stats.promotion) +
+			atomic_read(&cache->stats.demotion) +
+			atomic_read(&cache->stats.writeback);
+		DMEMIT("%llu %llu ",
+		       (unsigned long long) atomic64_read(&cache->stats.migrated_sectors),
+		       nr_migrations ?
+		       div64_u64(atomic64_read(&cache->stats.migration_us), nr_migrations) : 0ULL);
+
 		break;
 
 	case STATUSTYPE_TABLE:
@@ -3418,7 +3442,7 @@ static void cache_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type cache_target = {
 	.name = "cache",
-	.version = {2, 2, 0},
+	.version = {2, 3, 0},
 	.module = THIS_MODULE,
 	.ctr = cache_ctr,
 	.dtr = cache_dtr,
@@ -7,12 +7,14 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/ethtool.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/etherdevice.h>
 #include <linux/hash.h>
 #include <net/dst_metadata.h>
 #include <net/gro_cells.h>
+#include <net/gro.h>
 #include <net/rtnetlink.h>
 #include <net/protocol.h>
 #include <net/ip6_tunnel.h>
@@ -56,6 +58,7 @@ struct bareudp_dev {
 	struct socket      __rcu *sock;
 	struct list_head   next;        /* bareudp node  on namespace list */
 	struct gro_cells   gro_cells;
+	struct udp_tunnel_gro_stats __percpu *gro_stats;
 };
 
 static int bareudp_udp_encap_recv(struct sock *sk, struct sk_buff *skb)
@@ -171,6 +174,8 @@ static int bareudp_udp_encap_recv(struct sock *sk, struct sk_buff *skb)
 		}
 	}
 
+	udp_tunnel_gro_stats_add(bareudp->gro_stats, skb);
+
 	len = skb->len;
 	err = gro_cells_receive(&bareudp->gro_cells, skb);
 	if (likely(err == NET_RX_SUCCESS))
@@ -203,6 +208,13 @@ static int bareudp_init(struct net_device *dev)
 		free_percpu(dev->tstats);
 		return err;
 	}
+
+	bareudp->gro_stats = udp_tunnel_gro_stats_alloc();
+	if (!bareudp->gro_stats) {
+		gro_cells_destroy(&bareudp->gro_cells);
+		free_percpu(dev->tstats);
+		return -ENOMEM;
+	}
 	return 0;
 }
 
@@ -210,10 +222,88 @@ static void bareudp_uninit(struct net_device *dev)
 {
 	struct bareudp_dev *bareudp = netdev_priv(dev);
 
+	free_percpu(bareudp->gro_stats);
 	gro_cells_destroy(&bareudp->gro_cells);
 	free_percpu(dev->tstats);
 }
 
+/* Only IP payloads have GRO handlers, and bareudp adds no header of its
+ * own, so the inner packet starts right after the UDP header.
+ */
+static __be16 bareudp_gro_type(struct bareudp_dev *bareudp, const void *hdr)
+{
+	u8 ipversion = *(const u8 *)hdr >> 4;
+
+	if (bareudp->ethertype == htons(ETH_P_IP)) {
+		if (ipversion == 4)
+			return htons(ETH_P_IP);
+		if (ipversion == 6 && bareudp->multi_proto_mode)
+			return htons(ETH_P_IPV6);
+	} else if (bareudp->ethertype == htons(ETH_P_IPV6)) {
+		if (ipversion == 6)
+			return htons(ETH_P_IPV6);
+	}
+	return 0;
+}
+
+static struct sk_buff *bareudp_gro_receive(struct sock *sk,
+					   struct list_head *head,
+					   struct sk_buff *skb)
+{
+	const struct packet_offload *ptype;
+	struct bareudp_dev *bareudp;
+	struct sk_buff *pp = NULL;
+	unsigned int off, hlen;
+	int flush = 1;
+	void *hdr;
+
+	bareudp = rcu_dereference_sk_user_data(sk);
+	if (!bareudp)
+		goto out;
+
+	off = skb_gro_offset(skb);
+	hlen = off + 1;
+	hdr = skb_gro_header_fast(skb, off);
+	if (skb_gro_header_hard(skb, hlen)) {
+		hdr = skb_gro_header_slow(skb, hlen, off);
+		if (unlikely(!hdr))
+			goto out;
+	}
+
+	ptype = gro_find_receive_by_type(bareudp_gro_type(bareudp, hdr));
+	if (!ptype)
+		goto out;
+
+	pp = call_gro_receive(ptype->callbacks.gro_receive, head, skb);
+	flush = 0;
+
+out:
+	skb_gro_flush_final(skb, pp, flush);
+
+	return pp;
+}
+
+static int bareudp_gro_complete(struct sock *sk, struct sk_buff *skb,
+				int nhoff)
+{
+	struct packet_offload *ptype;
+	struct bareudp_dev *bareudp;
+	int err = -ENOSYS;
+
+	bareudp = rcu_dereference_sk_user_data(sk);
+	if (!bareudp)
+		return err;
+
+	ptype = gro_find_complete_by_type(bareudp_gro_type(bareudp,
+							   skb->data + nhoff));
+	if (ptype)
+		err = ptype->callbacks.gro_complete(skb, nhoff);
+
+	skb_set_inner_mac_header(skb, nhoff);
+
+	return err;
+}
+
 static struct socket *bareudp_create_sock(struct net *net, __be16 port)
 {
 	struct udp_port_cfg udp_conf;
@@ -250,6 +340,8 @@ static int bareudp_socket_create(struct bareudp_dev *bareudp, __be16 port)
 	memset(&tunnel_cfg, 0, sizeof(tunnel_cfg));
 	tunnel_cfg.sk_user_data = bareudp;
 	tunnel_cfg.encap_type = 1;
+	tunnel_cfg.gro_receive = bareudp_gro_receive;
+	tunnel_cfg.gro_complete = bareudp_gro_complete;
 	tunnel_cfg.encap_rcv = bareudp_udp_encap_recv;
 	tunnel_cfg.encap_err_lookup = bareudp_err_lookup;
 	tunnel_cfg.encap_destroy = NULL;
@@ -535,10 +627,42 @@ static const struct device_type bareudp_type = {
 	.name = "bareudp",
 };
 
+static int bareudp_get_sset_count(struct net_device *dev, int sset)
+{
+	switch (sset) {
+	case ETH_SS_STATS:
+		return UDP_TUNNEL_GRO_STATS_LEN;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static void bareudp_get_strings(struct net_device *dev, u32 sset, u8 *data)
+{
+	if (sset == ETH_SS_STATS)
+		udp_tunnel_gro_stats_strings(data);
+}
+
+static void bareudp_get_ethtool_stats(struct net_device *dev,
+				      struct ethtool_stats *stats, u64 *data)
+{
+	struct bareudp_dev *bareudp = netdev_priv(dev);
+
+	udp_tunnel_gro_stats_fetch(bareudp->gro_stats, data);
+}
+
+static const struct ethtool_ops bareudp_ethtool_ops = {
+	.get_link		= ethtool_op_get_link,
+	.get_sset_count		= bareudp_get_sset_count,
+	.get_strings		= bareudp_get_strings,
+	.get_ethtool_stats	= bareudp_get_ethtool_stats,
+};
+
 /* Initialize the device structure. */
 static void bareudp_setup(struct net_device *dev)
 {
 	dev->netdev_ops = &bareudp_netdev_ops;
+	dev->ethtool_ops = &bareudp_ethtool_ops;
 	dev->needs_free_netdev = true;
 	SET_NETDEV_DEVTYPE(dev, &bareudp_type);
 	dev->features    |= NETIF_F_SG | NETIF_F_HW_CSUM | NETIF_F_FRAGLIST;
@@ -2248,6 +2248,7 @@ static int dpaa_a050385_wa_xdpf(struct dpaa_priv *priv,
 	new_xdpf->headroom = priv->tx_headroom;
 	new_xdpf->frame_sz = DPAA_BP_RAW_SIZE;
 	new_xdpf->mem.type = MEM_TYPE_PAGE_ORDER0;
+	new_xdpf->flags = 0;
 
 	/* Release the initial buffer */
 	xdp_return_frame_rx_napi(xdpf);
@@ -2676,6 +2676,7 @@ static bool igc_clean_tx_irq(struct igc_q_vector *q_vector, int napi_budget)
 	unsigned int i = tx_ring->next_to_clean;
 	struct igc_tx_buffer *tx_buffer;
 	union igc_adv_tx_desc *tx_desc;
+	struct xdp_frame_bulk bq;
 	u32 xsk_frames = 0;
 
 	if (test_bit(__IGC_DOWN, &adapter->state))
@@ -2685,6 +2686,9 @@ static bool igc_clean_tx_irq(struct igc_q_vector *q_vector, int napi_budget)
 	tx_desc = IGC_TX_DESC(tx_ring, i);
 	i -= tx_ring->count;
 
+	xdp_frame_bulk_init(&bq);
+	rcu_read_lock(); /* need for xdp_return_frame_bulk */
+
 	do {
 		union igc_adv_tx_desc *eop_desc = tx_buffer->next_to_watch;
 
@@ -2711,7 +2715,7 @@ static bool igc_clean_tx_irq(struct igc_q_vector *q_vector, int napi_budget)
 			xsk_frames++;
 			break;
 		case IGC_TX_BUFFER_TYPE_XDP:
-			xdp_return_frame(tx_buffer->xdpf);
+			xdp_return_frame_bulk(tx_buffer->xdpf, &bq);
 			igc_unmap_tx_buffer(tx_ring->dev, tx_buffer);
 			break;
 		case IGC_TX_BUFFER_TYPE_SKB:
@@ -2756,6 +2760,9 @@ static bool igc_clean_tx_irq(struct igc_q_vector *q_vector, int napi_budget)
 		budget--;
 	} while (likely(budget));
 
+	xdp_flush_frame_bulk(&bq);
+	rcu_read_unlock();
+
 	netdev_tx_completed_queue(txring_txq(tx_ring),
 				  total_packets, total_bytes);
 
@@ -72,6 +72,7 @@ struct geneve_dev {
 #endif
 	struct list_head   next;	/* geneve's per namespace list */
 	struct gro_cells   gro_cells;
+	struct udp_tunnel_gro_stats __percpu *gro_stats;
 	struct geneve_config cfg;
 };
 
@@ -294,6 +295,8 @@ static void geneve_rx(struct geneve_dev *geneve, struct geneve_sock *gs,
 		}
 	}
 
+	udp_tunnel_gro_stats_add(geneve->gro_stats, skb);
+
 	len = skb->len;
 	err = gro_cells_receive(&geneve->gro_cells, skb);
 	if (likely(err == NET_RX_SUCCESS))
@@ -327,6 +330,14 @@ static int geneve_init(struct net_device *dev)
 		gro_cells_destroy(&geneve->gro_cells);
 		return err;
 	}
+
+	geneve->gro_stats = udp_tunnel_gro_stats_alloc();
+	if (!geneve->gro_stats) {
+		dst_cache_destroy(&geneve->cfg.info.dst_cache);
+		gro_cells_destroy(&geneve->gro_cells);
+		free_percpu(dev->tstats);
+		return -ENOMEM;
+	}
 	return 0;
 }
 
@@ -334,6 +345,7 @@ static void geneve_uninit(struct net_device *dev)
 {
 	struct geneve_dev *geneve = netdev_priv(dev);
 
+	free_percpu(geneve->gro_stats);
 	dst_cache_destroy(&geneve->cfg.info.dst_cache);
 	gro_cells_destroy(&geneve->gro_cells);
 	free_percpu(dev->tstats);
@@ -1170,9 +1182,36 @@ static void geneve_get_drvinfo(struct net_device *dev,
 	strlcpy(drvinfo->driver, "geneve", sizeof(drvinfo->driver));
 }
 
+static int geneve_get_sset_count(struct net_device *dev, int sset)
+{
+	switch (sset) {
+	case ETH_SS_STATS:
+		return UDP_TUNNEL_GRO_STATS_LEN;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static void geneve_get_strings(struct net_device *dev, u32 sset, u8 *data)
+{
+	if (sset == ETH_SS_STATS)
+		udp_tunnel_gro_stats_strings(data);
+}
+
+static void geneve_get_ethtool_stats(struct net_device *dev,
+				     struct ethtool_stats *stats, u64 *data)
+{
+	struct geneve_dev *geneve = netdev_priv(dev);
+
+	udp_tunnel_gro_stats_fetch(geneve->gro_stats, data);
+}
+
 static const struct ethtool_ops geneve_ethtool_ops = {
-	.get_drvinfo	= geneve_get_drvinfo,
-	.get_link	= ethtool_op_get_link,
+	.get_drvinfo		= geneve_get_drvinfo,
+	.get_link		= ethtool_op_get_link,
+	.get_sset_count		= geneve_get_sset_count,
+	.get_strings		= geneve_get_strings,
+	.get_ethtool_stats	= geneve_get_ethtool_stats,
 };
 
 /* Info for udev, that this is a virtual tunnel endpoint */
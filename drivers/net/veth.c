@@ -26,6 +26,7 @@
 #include <linux/ptr_ring.h>
 #include <linux/bpf_trace.h>
 #include <linux/net_tstamp.h>
+#include <net/page_pool.h>
 
 #define DRV_NAME	"veth"
 #define DRV_VERSION	"1.0"
@@ -37,6 +38,10 @@
 #define VETH_XDP_TX_BULK_SIZE	16
 #define VETH_XDP_BATCH		16
 
+static bool gro = true;
+module_param(gro, bool, 0644);
+MODULE_PARM_DESC(gro, "Enable GRO, and with it the NAPI receive path, on new veth pairs");
+
 struct veth_stats {
 	u64	rx_drops;
 	/* xdp */
@@ -65,6 +70,7 @@ struct veth_rq {
 	bool			rx_notify_masked;
 	struct ptr_ring		xdp_ring;
 	struct xdp_rxq_info	xdp_rxq;
+	struct page_pool	*page_pool;
 };
 
 struct veth_priv {
@@ -730,25 +736,26 @@ static struct sk_buff *veth_xdp_rcv_skb(struct veth_rq *rq,
 		if (size > PAGE_SIZE)
 			goto drop;
 
-		page = alloc_page(GFP_ATOMIC | __GFP_NOWARN);
+		page = page_pool_dev_alloc_pages(rq->page_pool);
 		if (!page)
 			goto drop;
 
 		head = page_address(page);
 		start = head + VETH_XDP_HEADROOM;
 		if (skb_copy_bits(skb, -mac_len, start, pktlen)) {
-			page_frag_free(head);
+			page_pool_recycle_direct(rq->page_pool, page);
 			goto drop;
 		}
 
 		nskb = veth_build_skb(head, VETH_XDP_HEADROOM + mac_len,
 				      skb->len, PAGE_SIZE);
 		if (!nskb) {
-			page_frag_free(head);
+			page_pool_recycle_direct(rq->page_pool, page);
 			goto drop;
 		}
 
 		skb_copy_header(nskb, skb);
+		skb_mark_for_recycle(nskb);
 		head_off = skb_headroom(nskb) - skb_headroom(skb);
 		skb_headers_offset_update(nskb, head_off);
 		consume_skb(skb);
@@ -926,11 +933,37 @@ static int veth_poll(struct napi_struct *napi, int budget)
 	return done;
 }
 
+static int veth_create_page_pool(struct veth_rq *rq)
+{
+	struct page_pool_params pp_params = {
+		.order = 0,
+		.pool_size = VETH_RING_SIZE,
+		.nid = NUMA_NO_NODE,
+		.dev = &rq->dev->dev,
+	};
+
+	rq->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(rq->page_pool)) {
+		int err = PTR_ERR(rq->page_pool);
+
+		rq->page_pool = NULL;
+		return err;
+	}
+
+	return 0;
+}
+
 static int __veth_napi_enable_range(struct net_device *dev, int start, int end)
 {
 	struct veth_priv *priv = netdev_priv(dev);
 	int err, i;
 
+	for (i = start; i < end; i++) {
+		err = veth_create_page_pool(&priv->rq[i]);
+		if (err)
+			goto err_page_pool;
+	}
+
 	for (i = start; i < end; i++) {
 		struct veth_rq *rq = &priv->rq[i];
 
@@ -951,6 +984,12 @@ static int __veth_napi_enable_range(struct net_device *dev, int start, int end)
 err_xdp_ring:
 	for (i--; i >= start; i--)
 		ptr_ring_cleanup(&priv->rq[i].xdp_ring, veth_ptr_free);
+	i = end;
+err_page_pool:
+	for (i--; i >= start; i--) {
+		page_pool_destroy(priv->rq[i].page_pool);
+		priv->rq[i].page_pool = NULL;
+	}
 
 	return err;
 }
@@ -980,6 +1019,12 @@ static void veth_napi_del_range(struct net_device *dev, int start, int end)
 		rq->rx_notify_masked = false;
 		ptr_ring_cleanup(&rq->xdp_ring, veth_ptr_free);
 	}
+
+	/* in-flight skbs keep the pools alive until their pages come back */
+	for (i = start; i < end; i++) {
+		page_pool_destroy(priv->rq[i].page_pool);
+		priv->rq[i].page_pool = NULL;
+	}
 }
 
 static void veth_napi_del(struct net_device *dev)
@@ -1600,6 +1645,9 @@ static struct rtnl_link_ops veth_link_ops;
 
 static void veth_disable_gro(struct net_device *dev)
 {
+	if (READ_ONCE(gro))
+		return;
+
 	dev->features &= ~NETIF_F_GRO;
 	dev->wanted_features &= ~NETIF_F_GRO;
 	netdev_update_features(dev);
@@ -1694,8 +1742,8 @@ static int veth_newlink(struct net *src_net, struct net_device *dev,
 	if (err < 0)
 		goto err_register_peer;
 
-	/* keep GRO disabled by default to be consistent with the established
-	 * veth behavior
+	/* unless the gro parameter is cleared, new pairs receive through NAPI
+	 * with GRO instead of the per-CPU backlog
 	 */
 	veth_disable_gro(peer);
 	netif_carrier_off(peer);
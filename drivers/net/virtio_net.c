@@ -22,6 +22,7 @@
 #include <net/route.h>
 #include <net/xdp.h>
 #include <net/net_failover.h>
+#include <net/page_pool.h>
 
 static int napi_weight = NAPI_POLL_WEIGHT;
 module_param(napi_weight, int, 0444);
@@ -157,6 +158,9 @@ struct receive_queue {
 	/* Page frag for packet buffer allocation. */
 	struct page_frag alloc_frag;
 
+	/* Page pool backing the mergeable buffers, NULL if not used. */
+	struct page_pool *page_pool;
+
 	/* RX: fragments + linear part + virtio header */
 	struct scatterlist sg[MAX_SKB_FRAGS + 2];
 
@@ -308,6 +312,31 @@ static void give_pages(struct receive_queue *rq, struct page *page)
 	rq->pages = page;
 }
 
+/*
+ * Mergeable buffers come from rq->page_pool when there is one.  Their pages
+ * are split in several buffers and have to go back through the pool they
+ * came from, so every mergeable buffer is released here.
+ */
+static void virtnet_put_page(struct page *page, bool napi)
+{
+	page = compound_head(page);
+	if ((page->pp_magic & ~0x3UL) == PP_SIGNATURE)
+		page_pool_put_full_page(page->pp, page, napi);
+	else
+		put_page(page);
+}
+
+/* A page for a linearized XDP buffer, from the same memory model as the rq */
+static struct page *virtnet_alloc_xdp_page(struct receive_queue *rq)
+{
+	unsigned int offset;
+
+	if (rq->page_pool)
+		return page_pool_dev_alloc_frag(rq->page_pool, &offset,
+						PAGE_SIZE);
+	return alloc_page(GFP_ATOMIC);
+}
+
 static struct page *get_a_page(struct receive_queue *rq, gfp_t gfp_mask)
 {
 	struct page *p = rq->pages;
@@ -488,8 +517,10 @@ static struct sk_buff *page_to_skb(struct virtnet_info *vi,
 		hdr = skb_vnet_hdr(skb);
 		memcpy(hdr, hdr_p, hdr_len);
 	}
+	if (rq->page_pool)
+		skb_mark_for_recycle(skb);
 	if (page_to_free)
-		put_page(page_to_free);
+		virtnet_put_page(page_to_free, true);
 
 	if (metasize) {
 		__skb_pull(skb, metasize);
@@ -504,11 +535,18 @@ static int __virtnet_xdp_xmit_one(struct virtnet_info *vi,
 				   struct xdp_frame *xdpf)
 {
 	struct virtio_net_hdr_mrg_rxbuf *hdr;
-	int err;
+	struct skb_shared_info *shinfo;
+	u8 nr_frags = 0;
+	int err, i;
 
 	if (unlikely(xdpf->headroom < vi->hdr_len))
 		return -EOVERFLOW;
 
+	if (unlikely(xdp_frame_has_frags(xdpf))) {
+		shinfo = xdp_get_shared_info_from_frame(xdpf);
+		nr_frags = shinfo->nr_frags;
+	}
+
 	/* Make room for virtqueue hdr (also change xdpf->headroom?) */
 	xdpf->data -= vi->hdr_len;
 	/* Zero header and leave csum up to XDP layers */
@@ -516,10 +554,17 @@ static int __virtnet_xdp_xmit_one(struct virtnet_info *vi,
 	memset(hdr, 0, vi->hdr_len);
 	xdpf->len   += vi->hdr_len;
 
-	sg_init_one(sq->sg, xdpf->data, xdpf->len);
+	sg_init_table(sq->sg, nr_frags + 1);
+	sg_set_buf(sq->sg, xdpf->data, xdpf->len);
+	for (i = 0; i < nr_frags; i++) {
+		skb_frag_t *frag = &shinfo->frags[i];
+
+		sg_set_page(&sq->sg[i + 1], skb_frag_page(frag),
+			    skb_frag_size(frag), skb_frag_off(frag));
+	}
 
-	err = virtqueue_add_outbuf(sq->vq, sq->sg, 1, xdp_to_ptr(xdpf),
-				   GFP_ATOMIC);
+	err = virtqueue_add_outbuf(sq->vq, sq->sg, nr_frags + 1,
+				   xdp_to_ptr(xdpf), GFP_ATOMIC);
 	if (unlikely(err))
 		return -ENOSPC; /* Caller handle free/refcnt */
 
@@ -599,7 +644,7 @@ static int virtnet_xdp_xmit(struct net_device *dev,
 		if (likely(is_xdp_frame(ptr))) {
 			struct xdp_frame *frame = ptr_to_xdp(ptr);
 
-			bytes += frame->len;
+			bytes += xdp_get_frame_len(frame);
 			xdp_return_frame(frame);
 		} else {
 			struct sk_buff *skb = ptr;
@@ -662,7 +707,7 @@ static struct page *xdp_linearize_page(struct receive_queue *rq,
 				       int page_off,
 				       unsigned int *len)
 {
-	struct page *page = alloc_page(GFP_ATOMIC);
+	struct page *page = virtnet_alloc_xdp_page(rq);
 
 	if (!page)
 		return NULL;
@@ -687,21 +732,21 @@ static struct page *xdp_linearize_page(struct receive_queue *rq,
 		 * is sending packet larger than the MTU.
 		 */
 		if ((page_off + buflen + tailroom) > PAGE_SIZE) {
-			put_page(p);
+			virtnet_put_page(p, true);
 			goto err_buf;
 		}
 
 		memcpy(page_address(page) + page_off,
 		       page_address(p) + off, buflen);
 		page_off += buflen;
-		put_page(p);
+		virtnet_put_page(p, true);
 	}
 
 	/* Headroom does not contribute to packet length */
 	*len = page_off - VIRTIO_XDP_HEADROOM;
 	return page;
 err_buf:
-	__free_pages(page, 0);
+	virtnet_put_page(page, true);
 	return NULL;
 }
 
@@ -872,6 +917,110 @@ static struct sk_buff *receive_big(struct net_device *dev,
 	return NULL;
 }
 
+static void virtnet_put_xdp_frags(struct xdp_buff *xdp)
+{
+	struct skb_shared_info *shinfo;
+	int i;
+
+	if (likely(!xdp_buff_has_frags(xdp)))
+		return;
+
+	shinfo = xdp_get_shared_info_from_buff(xdp);
+	for (i = 0; i < shinfo->nr_frags; i++)
+		virtnet_put_page(skb_frag_page(&shinfo->frags[i]), true);
+}
+
+/*
+ * Attach the remaining buffers of a packet to @xdp as fragments, for programs
+ * that handle multi-buffer packets.  On error every buffer taken so far has
+ * been released except the head, and *@num_buf is left for the caller to
+ * drain the rest of the packet.
+ */
+static int virtnet_build_xdp_frags(struct net_device *dev,
+				   struct receive_queue *rq,
+				   struct xdp_buff *xdp, u16 *num_buf,
+				   unsigned int *frags_truesize,
+				   struct virtnet_rq_stats *stats)
+{
+	struct skb_shared_info *shinfo = xdp_get_shared_info_from_buff(xdp);
+	unsigned int len, truesize;
+	struct page *page;
+	skb_frag_t *frag;
+	void *buf, *ctx;
+
+	shinfo->nr_frags = 0;
+	*frags_truesize = 0;
+	xdp_buff_set_frags_flag(xdp);
+
+	while (--*num_buf) {
+		buf = virtqueue_get_buf_ctx(rq->vq, &len, &ctx);
+		if (unlikely(!buf)) {
+			pr_debug("%s: rx error: %d buffers missing\n",
+				 dev->name, *num_buf);
+			dev->stats.rx_length_errors++;
+			goto err;
+		}
+
+		stats->bytes += len;
+		page = virt_to_head_page(buf);
+		truesize = mergeable_ctx_to_truesize(ctx);
+		if (unlikely(len > truesize ||
+			     shinfo->nr_frags == MAX_SKB_FRAGS)) {
+			pr_debug("%s: rx error: len %u exceeds truesize %u or too many frags\n",
+				 dev->name, len, truesize);
+			dev->stats.rx_length_errors++;
+			virtnet_put_page(page, true);
+			goto err;
+		}
+
+		frag = &shinfo->frags[shinfo->nr_frags++];
+		__skb_frag_set_page(frag, page);
+		skb_frag_off_set(frag, buf - page_address(page));
+		skb_frag_size_set(frag, len);
+		*frags_truesize += truesize;
+	}
+
+	return 0;
+
+err:
+	virtnet_put_xdp_frags(xdp);
+	return -EINVAL;
+}
+
+/* Build the skb for XDP_PASS around a multi-buffer xdp_buff */
+static struct sk_buff *build_skb_from_xdp_buff(struct xdp_buff *xdp,
+					       unsigned int frags_truesize)
+{
+	struct skb_shared_info *shinfo = xdp_get_shared_info_from_buff(xdp);
+	unsigned int metasize = xdp->data - xdp->data_meta;
+	unsigned int frags_len = 0;
+	struct sk_buff *skb;
+	u8 nr_frags;
+	int i;
+
+	/* build_skb() clears nr_frags, the frags[] stay in place */
+	nr_frags = shinfo->nr_frags;
+	for (i = 0; i < nr_frags; i++)
+		frags_len += skb_frag_size(&shinfo->frags[i]);
+
+	skb = build_skb(xdp->data_hard_start, xdp->frame_sz);
+	if (unlikely(!skb))
+		return NULL;
+
+	skb_reserve(skb, xdp->data - xdp->data_hard_start);
+	__skb_put(skb, xdp->data_end - xdp->data);
+	if (metasize)
+		skb_metadata_set(skb, metasize);
+
+	skb_shinfo(skb)->nr_frags = nr_frags;
+	skb->len += frags_len;
+	skb->data_len += frags_len;
+	skb->truesize += frags_truesize;
+	skb_mark_for_recycle(skb);
+
+	return skb;
+}
+
 static struct sk_buff *receive_mergeable(struct net_device *dev,
 					 struct virtnet_info *vi,
 					 struct receive_queue *rq,
@@ -911,9 +1060,11 @@ static struct sk_buff *receive_mergeable(struct net_device *dev,
 	rcu_read_lock();
 	xdp_prog = rcu_dereference(rq->xdp_prog);
 	if (xdp_prog) {
+		unsigned int frags_truesize = 0;
 		struct xdp_frame *xdpf;
 		struct page *xdp_page;
 		struct xdp_buff xdp;
+		bool frags;
 		void *data;
 		u32 act;
 
@@ -929,14 +1080,21 @@ static struct sk_buff *receive_mergeable(struct net_device *dev,
 		 */
 		frame_sz = headroom ? PAGE_SIZE : truesize;
 
+		/* Programs that handle fragments get the rest of the packet
+		 * attached as frags, that needs the skb_shared_info tailroom
+		 * XDP buffers are allocated with.
+		 */
+		frags = num_buf > 1 && xdp_prog->aux->xdp_has_frags &&
+			headroom >= virtnet_get_headroom(vi);
+
 		/* This happens when rx buffer size is underestimated
 		 * or headroom is not enough because of the buffer
 		 * was refilled before XDP is set. This should only
 		 * happen for the first several packets, so we don't
 		 * care much about its performance.
 		 */
-		if (unlikely(num_buf > 1 ||
-			     headroom < virtnet_get_headroom(vi))) {
+		if (unlikely(!frags && (num_buf > 1 ||
+				       headroom < virtnet_get_headroom(vi)))) {
 			/* linearize data for XDP */
 			xdp_page = xdp_linearize_page(rq, &num_buf,
 						      page, offset,
@@ -958,12 +1116,25 @@ static struct sk_buff *receive_mergeable(struct net_device *dev,
 		xdp_init_buff(&xdp, frame_sz - vi->hdr_len, &rq->xdp_rxq);
 		xdp_prepare_buff(&xdp, data - VIRTIO_XDP_HEADROOM + vi->hdr_len,
 				 VIRTIO_XDP_HEADROOM, len - vi->hdr_len, true);
+		if (frags && virtnet_build_xdp_frags(dev, rq, &xdp, &num_buf,
+						     &frags_truesize, stats))
+			goto err_xdp;
 
 		act = bpf_prog_run_xdp(xdp_prog, &xdp);
 		stats->xdp_packets++;
 
 		switch (act) {
 		case XDP_PASS:
+			if (unlikely(frags)) {
+				head_skb = build_skb_from_xdp_buff(&xdp,
+								   frags_truesize);
+				if (unlikely(!head_skb)) {
+					virtnet_put_xdp_frags(&xdp);
+					goto err_xdp;
+				}
+				rcu_read_unlock();
+				return head_skb;
+			}
 			metasize = xdp.data - xdp.data_meta;
 
 			/* recalculate offset to account for any header
@@ -981,7 +1152,7 @@ static struct sk_buff *receive_mergeable(struct net_device *dev,
 			/* We can only create skb based on xdp_page. */
 			if (unlikely(xdp_page != page)) {
 				rcu_read_unlock();
-				put_page(page);
+				virtnet_put_page(page, true);
 				head_skb = page_to_skb(vi, rq, xdp_page, offset,
 						       len, PAGE_SIZE, false,
 						       metasize,
@@ -992,33 +1163,37 @@ static struct sk_buff *receive_mergeable(struct net_device *dev,
 		case XDP_TX:
 			stats->xdp_tx++;
 			xdpf = xdp_convert_buff_to_frame(&xdp);
-			if (unlikely(!xdpf))
+			if (unlikely(!xdpf)) {
+				virtnet_put_xdp_frags(&xdp);
 				goto err_xdp;
+			}
 			err = virtnet_xdp_xmit(dev, 1, &xdpf, 0);
 			if (unlikely(!err)) {
 				xdp_return_frame_rx_napi(xdpf);
 			} else if (unlikely(err < 0)) {
 				trace_xdp_exception(vi->dev, xdp_prog, act);
+				virtnet_put_xdp_frags(&xdp);
 				if (unlikely(xdp_page != page))
-					put_page(xdp_page);
+					virtnet_put_page(xdp_page, true);
 				goto err_xdp;
 			}
 			*xdp_xmit |= VIRTIO_XDP_TX;
 			if (unlikely(xdp_page != page))
-				put_page(page);
+				virtnet_put_page(page, true);
 			rcu_read_unlock();
 			goto xdp_xmit;
 		case XDP_REDIRECT:
 			stats->xdp_redirects++;
 			err = xdp_do_redirect(dev, &xdp, xdp_prog);
 			if (err) {
+				virtnet_put_xdp_frags(&xdp);
 				if (unlikely(xdp_page != page))
-					put_page(xdp_page);
+					virtnet_put_page(xdp_page, true);
 				goto err_xdp;
 			}
 			*xdp_xmit |= VIRTIO_XDP_REDIR;
 			if (unlikely(xdp_page != page))
-				put_page(page);
+				virtnet_put_page(page, true);
 			rcu_read_unlock();
 			goto xdp_xmit;
 		default:
@@ -1028,8 +1203,9 @@ static struct sk_buff *receive_mergeable(struct net_device *dev,
 			trace_xdp_exception(vi->dev, xdp_prog, act);
 			fallthrough;
 		case XDP_DROP:
+			virtnet_put_xdp_frags(&xdp);
 			if (unlikely(xdp_page != page))
-				__free_pages(xdp_page, 0);
+				virtnet_put_page(xdp_page, true);
 			goto err_xdp;
 		}
 	}
@@ -1072,6 +1248,8 @@ static struct sk_buff *receive_mergeable(struct net_device *dev,
 
 			if (unlikely(!nskb))
 				goto err_skb;
+			if (rq->page_pool)
+				skb_mark_for_recycle(nskb);
 			if (curr_skb == head_skb)
 				skb_shinfo(curr_skb)->frag_list = nskb;
 			else
@@ -1087,7 +1265,7 @@ static struct sk_buff *receive_mergeable(struct net_device *dev,
 		}
 		offset = buf - page_address(page);
 		if (skb_can_coalesce(curr_skb, num_skb_frags, page, offset)) {
-			put_page(page);
+			virtnet_put_page(page, true);
 			skb_coalesce_rx_frag(curr_skb, num_skb_frags - 1,
 					     len, truesize);
 		} else {
@@ -1103,7 +1281,7 @@ static struct sk_buff *receive_mergeable(struct net_device *dev,
 	rcu_read_unlock();
 	stats->xdp_drops++;
 err_skb:
-	put_page(page);
+	virtnet_put_page(page, true);
 	while (num_buf-- > 1) {
 		buf = virtqueue_get_buf(rq->vq, &len);
 		if (unlikely(!buf)) {
@@ -1114,7 +1292,7 @@ static struct sk_buff *receive_mergeable(struct net_device *dev,
 		}
 		stats->bytes += len;
 		page = virt_to_head_page(buf);
-		put_page(page);
+		virtnet_put_page(page, true);
 	}
 err_buf:
 	stats->drops++;
@@ -1136,7 +1314,7 @@ static void receive_buf(struct virtnet_info *vi, struct receive_queue *rq,
 		pr_debug("%s: short packet %i\n", dev->name, len);
 		dev->stats.rx_length_errors++;
 		if (vi->mergeable_rx_bufs) {
-			put_page(virt_to_head_page(buf));
+			virtnet_put_page(virt_to_head_page(buf), true);
 		} else if (vi->big_packets) {
 			give_pages(rq, buf);
 		} else {
@@ -1295,6 +1473,19 @@ static int add_recvbuf_mergeable(struct virtnet_info *vi,
 	 * disabled GSO for XDP, it won't be a big issue.
 	 */
 	len = get_mergeable_buf_len(rq, &rq->mrg_avg_pkt_len, room);
+	if (rq->page_pool) {
+		struct page *page;
+		unsigned int offset;
+
+		page = page_pool_alloc_frag(rq->page_pool, &offset, len + room,
+					    gfp);
+		if (unlikely(!page))
+			return -ENOMEM;
+
+		buf = (char *)page_address(page) + offset + headroom;
+		goto add;
+	}
+
 	if (unlikely(!skb_page_frag_refill(len + room, alloc_frag, gfp)))
 		return -ENOMEM;
 
@@ -1312,11 +1503,12 @@ static int add_recvbuf_mergeable(struct virtnet_info *vi,
 		alloc_frag->offset += hole;
 	}
 
+add:
 	sg_init_one(rq->sg, buf, len);
 	ctx = mergeable_len_to_ctx(len, headroom);
 	err = virtqueue_add_inbuf_ctx(rq->vq, rq->sg, 1, buf, ctx, gfp);
 	if (err < 0)
-		put_page(virt_to_head_page(buf));
+		virtnet_put_page(virt_to_head_page(buf), false);
 
 	return err;
 }
@@ -1485,7 +1677,7 @@ static void free_old_xmit_skbs(struct send_queue *sq, bool in_napi)
 		} else {
 			struct xdp_frame *frame = ptr_to_xdp(ptr);
 
-			bytes += frame->len;
+			bytes += xdp_get_frame_len(frame);
 			xdp_return_frame(frame);
 		}
 		packets++;
@@ -1569,6 +1761,28 @@ static int virtnet_poll(struct napi_struct *napi, int budget)
 	return received;
 }
 
+static int virtnet_xdp_rxq_reg(struct virtnet_info *vi, int qp)
+{
+	struct receive_queue *rq = &vi->rq[qp];
+	int err;
+
+	err = xdp_rxq_info_reg(&rq->xdp_rxq, vi->dev, qp, rq->napi.napi_id);
+	if (err < 0)
+		return err;
+
+	if (rq->page_pool)
+		err = xdp_rxq_info_reg_mem_model(&rq->xdp_rxq,
+						 MEM_TYPE_PAGE_POOL,
+						 rq->page_pool);
+	else
+		err = xdp_rxq_info_reg_mem_model(&rq->xdp_rxq,
+						 MEM_TYPE_PAGE_SHARED, NULL);
+	if (err < 0)
+		xdp_rxq_info_unreg(&rq->xdp_rxq);
+
+	return err;
+}
+
 static int virtnet_open(struct net_device *dev)
 {
 	struct virtnet_info *vi = netdev_priv(dev);
@@ -1580,17 +1794,10 @@ static int virtnet_open(struct net_device *dev)
 			if (!try_fill_recv(vi, &vi->rq[i], GFP_KERNEL))
 				schedule_delayed_work(&vi->refill, 0);
 
-		err = xdp_rxq_info_reg(&vi->rq[i].xdp_rxq, dev, i, vi->rq[i].napi.napi_id);
+		err = virtnet_xdp_rxq_reg(vi, i);
 		if (err < 0)
 			return err;
 
-		err = xdp_rxq_info_reg_mem_model(&vi->rq[i].xdp_rxq,
-						 MEM_TYPE_PAGE_SHARED, NULL);
-		if (err < 0) {
-			xdp_rxq_info_unreg(&vi->rq[i].xdp_rxq);
-			return err;
-		}
-
 		virtnet_napi_enable(vi->rq[i].vq, &vi->rq[i].napi);
 		virtnet_napi_tx_enable(vi, vi->sq[i].vq, &vi->sq[i].napi);
 	}
@@ -2443,6 +2650,8 @@ static void virtnet_freeze_down(struct virtio_device *vdev)
 
 	if (netif_running(vi->dev)) {
 		for (i = 0; i < vi->max_queue_pairs; i++) {
+			/* the page pools go away with the virtqueues */
+			xdp_rxq_info_unreg(&vi->rq[i].xdp_rxq);
 			napi_disable(&vi->rq[i].napi);
 			virtnet_napi_tx_disable(&vi->sq[i].napi);
 		}
@@ -2468,6 +2677,9 @@ static int virtnet_restore_up(struct virtio_device *vdev)
 				schedule_delayed_work(&vi->refill, 0);
 
 		for (i = 0; i < vi->max_queue_pairs; i++) {
+			err = virtnet_xdp_rxq_reg(vi, i);
+			if (err < 0)
+				return err;
 			virtnet_napi_enable(vi->rq[i].vq, &vi->rq[i].napi);
 			virtnet_napi_tx_enable(vi, vi->sq[i].vq,
 					       &vi->sq[i].napi);
@@ -2540,6 +2752,10 @@ static int virtnet_xdp_set(struct net_device *dev, struct bpf_prog *prog,
 		return -EINVAL;
 	}
 
+	/* programs handling frags get the packet across several buffers */
+	if (prog && prog->aux->xdp_has_frags && vi->mergeable_rx_bufs)
+		max_sz *= MAX_SKB_FRAGS + 1;
+
 	if (dev->mtu > max_sz) {
 		NL_SET_ERR_MSG_MOD(extack, "MTU too large to enable XDP");
 		netdev_warn(dev, "XDP requires MTU less than %lu\n", max_sz);
@@ -2761,6 +2977,9 @@ static void virtnet_free_queues(struct virtnet_info *vi)
 	for (i = 0; i < vi->max_queue_pairs; i++) {
 		__netif_napi_del(&vi->rq[i].napi);
 		__netif_napi_del(&vi->sq[i].napi);
+		/* pages still held by skbs keep the pool around */
+		page_pool_destroy(vi->rq[i].page_pool);
+		vi->rq[i].page_pool = NULL;
 	}
 
 	/* We called __netif_napi_del(),
@@ -2824,7 +3043,7 @@ static void free_unused_bufs(struct virtnet_info *vi)
 
 		while ((buf = virtqueue_detach_unused_buf(vq)) != NULL) {
 			if (vi->mergeable_rx_bufs) {
-				put_page(virt_to_head_page(buf));
+				virtnet_put_page(virt_to_head_page(buf), false);
 			} else if (vi->big_packets) {
 				give_pages(&vi->rq[i], buf);
 			} else {
@@ -2989,6 +3208,39 @@ static int virtnet_alloc_queues(struct virtnet_info *vi)
 	return -ENOMEM;
 }
 
+/*
+ * Back the mergeable buffers with a page pool per receive queue, so pages
+ * freed by the stack or returned by XDP_TX and XDP_REDIRECT are recycled
+ * instead of going back to the page allocator.  A queue whose pool can't be
+ * created falls back to the page frag allocator.
+ */
+static void virtnet_create_page_pools(struct virtnet_info *vi)
+{
+	int i;
+
+	if (!vi->mergeable_rx_bufs)
+		return;
+
+	for (i = 0; i < vi->max_queue_pairs; i++) {
+		struct receive_queue *rq = &vi->rq[i];
+		struct page_pool_params pp_params = {
+			.order		= 0,
+			.flags		= PP_FLAG_PAGE_FRAG,
+			.pool_size	= virtqueue_get_vring_size(rq->vq),
+			.nid		= NUMA_NO_NODE,
+		};
+		struct page_pool *pp;
+
+		pp = page_pool_create(&pp_params);
+		if (IS_ERR(pp)) {
+			netdev_warn(vi->dev, "rx queue %d: no page pool (%ld)\n",
+				    i, PTR_ERR(pp));
+			continue;
+		}
+		rq->page_pool = pp;
+	}
+}
+
 static int init_vqs(struct virtnet_info *vi)
 {
 	int ret;
@@ -3002,6 +3254,8 @@ static int init_vqs(struct virtnet_info *vi)
 	if (ret)
 		goto err_free;
 
+	virtnet_create_page_pools(vi);
+
 	cpus_read_lock();
 	virtnet_set_affinity(vi);
 	cpus_read_unlock();
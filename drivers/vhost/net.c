@@ -35,11 +35,16 @@
 
 #include "vhost.h"
 
-static int experimental_zcopytx = 0;
+static int experimental_zcopytx = 1;
 module_param(experimental_zcopytx, int, 0444);
 MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 		                       " 1 -Enable; 0 - Disable");
 
+/* Packets below this size are cheaper to copy than to pin. */
+static unsigned int zcopytx_min_len = 1024;
+module_param(zcopytx_min_len, uint, 0644);
+MODULE_PARM_DESC(zcopytx_min_len, "Minimum packet length for Zero Copy TX");
+
 /* Max number of bytes transferred before requeueing the job.
  * Using this limit prevents one virtqueue from starving others. */
 #define VHOST_NET_WEIGHT 0x80000
@@ -52,7 +57,14 @@ MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 
 /* MAX number of TX used buffers for outstanding zerocopy */
 #define VHOST_MAX_PEND 128
-#define VHOST_GOODCOPY_LEN 256
+
+/*
+ * Zerocopy buffers are returned to the guest in order, so one skb stuck in a
+ * slow receiver's queue holds back every later one.  Stop starting new
+ * zerocopy transmits once the oldest outstanding one has made no progress
+ * for this long, they are copied until the window drains.
+ */
+#define VHOST_NET_ZCOPY_STALL msecs_to_jiffies(1)
 
 /*
  * For transmit, used buffer len is unused; we override it to track buffer
@@ -97,7 +109,13 @@ struct vhost_net_ubuf_ref {
 	struct vhost_virtqueue *vq;
 };
 
+/*
+ * The copy TX path batches between VHOST_NET_BATCH and VHOST_NET_BATCH_MAX
+ * packets per sendmsg, growing while the guest keeps the ring full and
+ * shrinking back once it drains.
+ */
 #define VHOST_NET_BATCH 64
+#define VHOST_NET_BATCH_MAX VHOST_NET_PKT_WEIGHT
 struct vhost_net_buf {
 	void **queue;
 	int tail;
@@ -117,6 +135,10 @@ struct vhost_net_virtqueue {
 	int done_idx;
 	/* Number of XDP frames batched */
 	int batched_xdp;
+	/* TX: current batch size, VHOST_NET_BATCH to VHOST_NET_BATCH_MAX */
+	int batch;
+	/* TX: last time the zerocopy completion window moved */
+	unsigned long zcopy_progress;
 	/* an array of userspace buffers info */
 	struct ubuf_info *ubuf_info;
 	/* Reference counting for outstanding ubufs.
@@ -330,13 +352,20 @@ static void vhost_net_tx_err(struct vhost_net *net)
 	++net->tx_zcopy_err;
 }
 
+static bool vhost_net_tx_zcopy_stalled(struct vhost_net_virtqueue *nvq)
+{
+	return nvq->upend_idx != nvq->done_idx &&
+	       time_after(jiffies, nvq->zcopy_progress + VHOST_NET_ZCOPY_STALL);
+}
+
 static bool vhost_net_tx_select_zcopy(struct vhost_net *net)
 {
 	/* TX flush waits for outstanding DMAs to be done.
 	 * Don't start new DMAs.
 	 */
 	return !net->tx_flush &&
-		net->tx_packets / 64 >= net->tx_zcopy_err;
+		net->tx_packets / 64 >= net->tx_zcopy_err &&
+		!vhost_net_tx_zcopy_stalled(&net->vqs[VHOST_NET_VQ_TX]);
 }
 
 static bool vhost_sock_zcopy(struct socket *sock)
@@ -372,6 +401,8 @@ static void vhost_zerocopy_signal_used(struct vhost_net *net,
 		} else
 			break;
 	}
+	if (j)
+		nvq->zcopy_progress = jiffies;
 	while (j) {
 		add = min(UIO_MAXIOV - nvq->done_idx, j);
 		vhost_add_used_and_signal_n(vq->dev, vq,
@@ -784,8 +815,11 @@ static void handle_tx_copy(struct vhost_net *net, struct socket *sock)
 	do {
 		bool busyloop_intr = false;
 
-		if (nvq->done_idx == VHOST_NET_BATCH)
+		if (nvq->done_idx >= nvq->batch) {
+			/* the guest is keeping up with us, batch more */
 			vhost_tx_batch(net, nvq, sock, &msg);
+			nvq->batch = min(nvq->batch * 2, VHOST_NET_BATCH_MAX);
+		}
 
 		head = get_tx_bufs(net, nvq, &msg, &out, &in, &len,
 				   &busyloop_intr);
@@ -794,6 +828,9 @@ static void handle_tx_copy(struct vhost_net *net, struct socket *sock)
 			break;
 		/* Nothing new?  Wait for eventfd to tell us they refilled. */
 		if (head == vq->num) {
+			if (nvq->done_idx < nvq->batch / 4)
+				nvq->batch = max(nvq->batch / 2,
+						 VHOST_NET_BATCH);
 			if (unlikely(busyloop_intr)) {
 				vhost_poll_queue(&vq->poll);
 			} else if (unlikely(vhost_enable_notify(&net->dev,
@@ -897,7 +934,7 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 			break;
 		}
 
-		zcopy_used = len >= VHOST_GOODCOPY_LEN
+		zcopy_used = len >= zcopytx_min_len
 			     && !vhost_exceeds_maxpend(net)
 			     && vhost_net_tx_select_zcopy(net);
 
@@ -917,6 +954,8 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 			msg.msg_controllen = sizeof(ctl);
 			ubufs = nvq->ubufs;
 			atomic_inc(&ubufs->refcount);
+			if (nvq->upend_idx == nvq->done_idx)
+				nvq->zcopy_progress = jiffies;
 			nvq->upend_idx = (nvq->upend_idx + 1) % UIO_MAXIOV;
 		} else {
 			msg.msg_control = NULL;
@@ -1309,7 +1348,7 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 	}
 	n->vqs[VHOST_NET_VQ_RX].rxq.queue = queue;
 
-	xdp = kmalloc_array(VHOST_NET_BATCH, sizeof(*xdp), GFP_KERNEL);
+	xdp = kmalloc_array(VHOST_NET_BATCH_MAX, sizeof(*xdp), GFP_KERNEL);
 	if (!xdp) {
 		kfree(vqs);
 		kvfree(n);
@@ -1329,13 +1368,14 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 		n->vqs[i].upend_idx = 0;
 		n->vqs[i].done_idx = 0;
 		n->vqs[i].batched_xdp = 0;
+		n->vqs[i].batch = VHOST_NET_BATCH;
 		n->vqs[i].vhost_hlen = 0;
 		n->vqs[i].sock_hlen = 0;
 		n->vqs[i].rx_ring = NULL;
 		vhost_net_buf_init(&n->vqs[i].rxq);
 	}
 	vhost_dev_init(dev, vqs, VHOST_NET_VQ_MAX,
-		       UIO_MAXIOV + VHOST_NET_BATCH,
+		       UIO_MAXIOV + VHOST_NET_BATCH_MAX,
 		       VHOST_NET_PKT_WEIGHT, VHOST_NET_WEIGHT, true,
 		       NULL);
 
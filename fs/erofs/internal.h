@@ -72,6 +72,9 @@ struct erofs_mount_opts {
 
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+
+	/* min pclusters per worker to decompress a batch in parallel, 0 - off */
+	unsigned int parallel_decompress_batch;
 #endif
 	unsigned int mount_opt;
 };
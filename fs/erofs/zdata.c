@@ -117,9 +117,12 @@ typedef tagptr1_t compressed_page_t;
 	tagptr_fold(compressed_page_t, page, 1)
 
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
+/* workers of parallel decompression, which never wait on anything queued */
+static struct workqueue_struct *z_erofs_decompd_workqueue __read_mostly;
 
 void z_erofs_exit_zip_subsystem(void)
 {
+	destroy_workqueue(z_erofs_decompd_workqueue);
 	destroy_workqueue(z_erofs_workqueue);
 	z_erofs_destroy_pcluster_pool();
 }
@@ -135,7 +138,21 @@ static inline int z_erofs_init_workqueue(void)
 	z_erofs_workqueue = alloc_workqueue("erofs_unzipd",
 					    WQ_UNBOUND | WQ_HIGHPRI,
 					    onlinecpus + onlinecpus / 4);
-	return z_erofs_workqueue ? 0 : -ENOMEM;
+	if (!z_erofs_workqueue)
+		return -ENOMEM;
+
+	/*
+	 * a separate workqueue, the unzipd works wait for these and could
+	 * otherwise use up all active slots of a single one.
+	 */
+	z_erofs_decompd_workqueue = alloc_workqueue("erofs_decompd",
+						    WQ_UNBOUND | WQ_HIGHPRI,
+						    onlinecpus);
+	if (!z_erofs_decompd_workqueue) {
+		destroy_workqueue(z_erofs_workqueue);
+		return -ENOMEM;
+	}
+	return 0;
 }
 
 int __init z_erofs_init_zip_subsystem(void)
@@ -1089,25 +1106,122 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	return err;
 }
 
-static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
-				     struct page **pagepool)
+static inline z_erofs_next_pcluster_t
+z_erofs_next_pcluster(z_erofs_next_pcluster_t owned)
 {
-	z_erofs_next_pcluster_t owned = io->head;
+	/* no possible that 'owned' equals Z_EROFS_WORK_TPTR_TAIL */
+	DBG_BUGON(owned == Z_EROFS_PCLUSTER_TAIL);
 
-	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
-		struct z_erofs_pcluster *pcl;
+	/* no possible that 'owned' equals NULL */
+	DBG_BUGON(owned == Z_EROFS_PCLUSTER_NIL);
 
-		/* no possible that 'owned' equals Z_EROFS_WORK_TPTR_TAIL */
-		DBG_BUGON(owned == Z_EROFS_PCLUSTER_TAIL);
+	return READ_ONCE(container_of(owned, struct z_erofs_pcluster,
+				      next)->next);
+}
 
-		/* no possible that 'owned' equals NULL */
-		DBG_BUGON(owned == Z_EROFS_PCLUSTER_NIL);
+/* decompress up to @nr pclusters of the chain starting at @owned */
+static void z_erofs_decompress_chain(struct super_block *sb,
+				     z_erofs_next_pcluster_t owned,
+				     unsigned int nr, struct page **pagepool)
+{
+	while (nr-- && owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
+		struct z_erofs_pcluster *pcl;
 
 		pcl = container_of(owned, struct z_erofs_pcluster, next);
-		owned = READ_ONCE(pcl->next);
+		owned = z_erofs_next_pcluster(owned);
+
+		z_erofs_decompress_pcluster(sb, pcl, pagepool);
+	}
+}
+
+struct z_erofs_decompress_chunk {
+	struct work_struct work;
+	struct super_block *sb;
+	z_erofs_next_pcluster_t head;
+	unsigned int nr;
+	atomic_t *pending;
+	struct completion *done;
+};
+
+static void z_erofs_decompress_chunk_work(struct work_struct *work)
+{
+	struct z_erofs_decompress_chunk *chunk =
+		container_of(work, struct z_erofs_decompress_chunk, work);
+	struct page *pagepool = NULL;
 
-		z_erofs_decompress_pcluster(io->sb, pcl, pagepool);
+	z_erofs_decompress_chain(chunk->sb, chunk->head, chunk->nr, &pagepool);
+	erofs_release_pages(&pagepool);
+
+	if (atomic_dec_and_test(chunk->pending))
+		complete(chunk->done);
+}
+
+/*
+ * Split a chain of @nr pclusters into @nr_chunks and decompress the first
+ * one here while the others run on other CPUs.  The heads of all chunks
+ * have to be found first, decompressing a pcluster resets its next pointer.
+ */
+static bool z_erofs_decompress_parallel(const struct z_erofs_decompressqueue *io,
+					unsigned int nr, unsigned int nr_chunks,
+					struct page **pagepool)
+{
+	const unsigned int per_chunk = nr / nr_chunks;
+	z_erofs_next_pcluster_t owned = io->head;
+	struct z_erofs_decompress_chunk *chunks;
+	DECLARE_COMPLETION_ONSTACK(done);
+	atomic_t pending;
+	unsigned int i, j;
+
+	chunks = kcalloc(nr_chunks - 1, sizeof(*chunks),
+			 GFP_NOIO | __GFP_NOWARN);
+	if (!chunks)
+		return false;
+
+	atomic_set(&pending, nr_chunks - 1);
+	for (i = 0; i < nr_chunks - 1; i++) {
+		for (j = 0; j < per_chunk; j++)
+			owned = z_erofs_next_pcluster(owned);
+
+		INIT_WORK(&chunks[i].work, z_erofs_decompress_chunk_work);
+		chunks[i].sb = io->sb;
+		chunks[i].head = owned;
+		/* the last chunk takes the remainder */
+		chunks[i].nr = i < nr_chunks - 2 ? per_chunk : UINT_MAX;
+		chunks[i].pending = &pending;
+		chunks[i].done = &done;
+	}
+
+	for (i = 0; i < nr_chunks - 1; i++)
+		queue_work(z_erofs_decompd_workqueue, &chunks[i].work);
+
+	z_erofs_decompress_chain(io->sb, io->head, per_chunk, pagepool);
+
+	wait_for_completion(&done);
+	kfree(chunks);
+	return true;
+}
+
+static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
+				     struct page **pagepool)
+{
+	const unsigned int batch =
+		READ_ONCE(EROFS_SB(io->sb)->opt.parallel_decompress_batch);
+	z_erofs_next_pcluster_t owned;
+	unsigned int nr = 0, nr_chunks;
+
+	/* fan large batches out, small ones aren't worth the wakeups */
+	if (batch && num_online_cpus() > 1) {
+		for (owned = io->head; owned != Z_EROFS_PCLUSTER_TAIL_CLOSED;
+		     owned = z_erofs_next_pcluster(owned))
+			++nr;
+
+		nr_chunks = min(nr / batch, num_online_cpus());
+		if (nr_chunks > 1 &&
+		    z_erofs_decompress_parallel(io, nr, nr_chunks, pagepool))
+			return;
 	}
+
+	z_erofs_decompress_chain(io->sb, io->head, UINT_MAX, pagepool);
 }
 
 static void z_erofs_decompressqueue_work(struct work_struct *work)
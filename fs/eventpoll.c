@@ -37,6 +37,8 @@
 #include <linux/seq_file.h>
 #include <linux/compat.h>
 #include <linux/rculist.h>
+#include <linux/llist.h>
+#include <linux/percpu.h>
 #include <net/busy_poll.h>
 
 /*
@@ -104,6 +106,9 @@
 
 #define EP_ITEM_COST (sizeof(struct epitem) + sizeof(struct eppoll_entry))
 
+/* Number of items from which an instance uses per-CPU ready lists */
+#define EP_PCP_MIN_ITEMS 1024
+
 struct epoll_filefd {
 	struct file *file;
 	int fd;
@@ -141,8 +146,15 @@ struct epitem {
 		struct rcu_head rcu;
 	};
 
-	/* List header used to link this structure to the eventpoll ready list */
-	struct list_head rdllink;
+	/*
+	 * List header used to link this structure to the eventpoll ready list,
+	 * or to one of its per-CPU ready lists until they are merged into it.
+	 * Either way the item counts as linked, see ep_is_linked().
+	 */
+	union {
+		struct list_head rdllink;
+		struct llist_node pcp_llink;
+	};
 
 	/*
 	 * Works together "struct eventpoll"->ovflist in keeping the
@@ -195,6 +207,17 @@ struct eventpoll {
 	/* Lock which protects rdllist and ovflist */
 	rwlock_t lock;
 
+	/*
+	 * Per-CPU ready lists the poll callback queues to on instances with
+	 * many items, and the CPUs which have something queued.  Items are
+	 * moved to rdllist with the write lock held.
+	 */
+	struct llist_head __percpu *pcp_rdllist;
+	unsigned long *pcp_pending;
+
+	/* Number of items, protected by mtx */
+	unsigned int nitems;
+
 	/* RB tree root used to store monitored fd structs */
 	struct rb_root_cached rbr;
 
@@ -378,8 +401,84 @@ static inline struct epitem *ep_item_from_wait(wait_queue_entry_t *p)
  */
 static inline int ep_events_available(struct eventpoll *ep)
 {
+	unsigned long *pending = READ_ONCE(ep->pcp_pending);
+
 	return !list_empty_careful(&ep->rdllist) ||
-		READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR;
+		READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR ||
+		(pending && !bitmap_empty(pending, nr_cpu_ids));
+}
+
+/*
+ * Move whatever the poll callbacks queued to the per-CPU ready lists to the
+ * tail of the ready list, in the order the events came in on each CPU.  Must
+ * be called with the write lock held before the ready list links of items
+ * are looked at or modified.
+ */
+static void ep_pcp_merge(struct eventpoll *ep)
+{
+	struct epitem *epi, *tmp;
+	struct llist_node *first;
+	int cpu;
+
+	lockdep_assert_held_write(&ep->lock);
+
+	if (!ep->pcp_rdllist)
+		return;
+
+	for_each_set_bit(cpu, ep->pcp_pending, nr_cpu_ids) {
+		__clear_bit(cpu, ep->pcp_pending);
+		first = llist_del_all(per_cpu_ptr(ep->pcp_rdllist, cpu));
+		first = llist_reverse_order(first);
+		llist_for_each_entry_safe(epi, tmp, first, pcp_llink)
+			list_add_tail(&epi->rdllink, &ep->rdllist);
+	}
+}
+
+/*
+ * Queue an item which just became ready to the ready list of this CPU, so
+ * that callbacks on different CPUs don't all contend on the tail of rdllist.
+ * Called with the read lock held.
+ *
+ * Return: %false if the item has been already queued, %true otherwise.
+ */
+static bool ep_pcp_add(struct eventpoll *ep, struct epitem *epi)
+{
+	int cpu = smp_processor_id();
+
+	/* claim the item, the same way list_add_tail_lockless() does */
+	if (cmpxchg(&epi->rdllink.next, &epi->rdllink, NULL) != &epi->rdllink)
+		return false;
+
+	llist_add(&epi->pcp_llink, per_cpu_ptr(ep->pcp_rdllist, cpu));
+	if (!test_bit(cpu, ep->pcp_pending))
+		set_bit(cpu, ep->pcp_pending);
+	return true;
+}
+
+/*
+ * Switch a big instance to per-CPU ready lists.  Called with "mtx" held, if
+ * the allocations fail we just keep using the shared list.
+ */
+static void ep_pcp_enable(struct eventpoll *ep)
+{
+	struct llist_head __percpu *lists;
+	unsigned long *pending;
+	int cpu;
+
+	lists = alloc_percpu(struct llist_head);
+	pending = bitmap_zalloc(nr_cpu_ids, GFP_KERNEL);
+	if (!lists || !pending) {
+		free_percpu(lists);
+		bitmap_free(pending);
+		return;
+	}
+	for_each_possible_cpu(cpu)
+		init_llist_head(per_cpu_ptr(lists, cpu));
+
+	write_lock_irq(&ep->lock);
+	WRITE_ONCE(ep->pcp_pending, pending);
+	WRITE_ONCE(ep->pcp_rdllist, lists);
+	write_unlock_irq(&ep->lock);
 }
 
 #ifdef CONFIG_NET_RX_BUSY_POLL
@@ -619,6 +718,7 @@ static void ep_start_scan(struct eventpoll *ep, struct list_head *txlist)
 	 */
 	lockdep_assert_irqs_enabled();
 	write_lock_irq(&ep->lock);
+	ep_pcp_merge(ep);
 	list_splice_init(&ep->rdllist, txlist);
 	WRITE_ONCE(ep->ovflist, NULL);
 	write_unlock_irq(&ep->lock);
@@ -716,9 +816,12 @@ static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 	rb_erase_cached(&epi->rbn, &ep->rbr);
 
 	write_lock_irq(&ep->lock);
-	if (ep_is_linked(epi))
+	if (ep_is_linked(epi)) {
+		ep_pcp_merge(ep);
 		list_del_init(&epi->rdllink);
+	}
 	write_unlock_irq(&ep->lock);
+	ep->nitems--;
 
 	wakeup_source_unregister(ep_wakeup_source(epi));
 	/*
@@ -784,6 +887,8 @@ static void ep_free(struct eventpoll *ep)
 	mutex_destroy(&ep->mtx);
 	free_uid(ep->user);
 	wakeup_source_unregister(ep->ws);
+	free_percpu(ep->pcp_rdllist);
+	bitmap_free(ep->pcp_pending);
 	kfree(ep);
 }
 
@@ -1173,7 +1278,8 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 			ep_pm_stay_awake_rcu(epi);
 	} else if (!ep_is_linked(epi)) {
 		/* In the usual case, add event to ready list. */
-		if (list_add_tail_lockless(&epi->rdllink, &ep->rdllist))
+		if (ep->pcp_rdllist ? ep_pcp_add(ep, epi) :
+		    list_add_tail_lockless(&epi->rdllink, &ep->rdllist))
 			ep_pm_stay_awake_rcu(epi);
 	}
 
@@ -1494,6 +1600,9 @@ static int ep_insert(struct eventpoll *ep, const struct epoll_event *event,
 	if (tep)
 		mutex_unlock(&tep->mtx);
 
+	if (++ep->nitems == EP_PCP_MIN_ITEMS && !ep->pcp_rdllist)
+		ep_pcp_enable(ep);
+
 	/* now check if we've created too many backpaths */
 	if (unlikely(full_check && reverse_path_check())) {
 		ep_remove(ep, epi);
@@ -1098,6 +1098,39 @@ static void ext4_fc_update_stats(struct super_block *sb, int status,
 	trace_ext4_fc_commit_stop(sb, nblks, status);
 }
 
+/*
+ * Like jbd2 does for full commits, give other fsync callers a chance to
+ * get their updates into this fast commit when they are interleaving with
+ * us.  We wait for up to the average fast commit time bounded by the
+ * min_batch_time and max_batch_time mount options, minus the time the
+ * current batch has been open already.  Those who show up meanwhile block
+ * in jbd2_fc_begin_commit() and return as soon as our commit is done.
+ */
+static void ext4_fc_batch_wait(struct super_block *sb)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	u64 commit_time, batch_time;
+	pid_t pid = current->pid;
+	ktime_t expires;
+
+	if (!sbi->s_max_batch_time || sbi->s_fc_last_sync_writer == pid)
+		return;
+	sbi->s_fc_last_sync_writer = pid;
+
+	commit_time = max_t(u64, sbi->s_fc_stats.s_fc_avg_commit_time,
+			    1000ULL * sbi->s_min_batch_time);
+	commit_time = min_t(u64, commit_time, 1000ULL * sbi->s_max_batch_time);
+
+	batch_time = ktime_to_ns(ktime_sub(ktime_get(),
+					   READ_ONCE(sbi->s_fc_batch_start)));
+	if (batch_time >= commit_time)
+		return;
+
+	expires = ktime_add_ns(ktime_get(), commit_time - batch_time);
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
+}
+
 /*
  * The main commit entry point. Performs a fast commit for transaction
  * commit_tid if needed. If it's not possible to perform a fast commit
@@ -1147,6 +1180,8 @@ int ext4_fc_commit(journal_t *journal, tid_t commit_tid)
 		goto fallback;
 	}
 
+	ext4_fc_batch_wait(sb);
+
 	fc_bufs_before = (sbi->s_fc_bytes + bsize - 1) / bsize;
 	ret = ext4_fc_perform_commit(journal);
 	if (ret < 0) {
@@ -1231,6 +1266,7 @@ static void ext4_fc_cleanup(journal_t *journal, int full)
 
 	if (full)
 		sbi->s_fc_bytes = 0;
+	WRITE_ONCE(sbi->s_fc_batch_start, ktime_get());
 	spin_unlock(&sbi->s_fc_lock);
 	trace_ext4_fc_stats(sb);
 }
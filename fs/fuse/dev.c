@@ -222,17 +222,137 @@ const struct fuse_iqueue_ops fuse_dev_fiq_ops = {
 };
 EXPORT_SYMBOL_GPL(fuse_dev_fiq_ops);
 
-static void queue_request_and_unlock(struct fuse_iqueue *fiq,
-				     struct fuse_req *req)
-__releases(fiq->lock)
+static void fuse_req_set_len(struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		fuse_len_args(req->args->in_numargs,
 			      (struct fuse_arg *) req->args->in_args);
+}
+
+static void queue_request_and_unlock(struct fuse_iqueue *fiq,
+				     struct fuse_req *req)
+__releases(fiq->lock)
+{
+	fuse_req_set_len(req);
 	list_add_tail(&req->list, &fiq->pending);
 	fiq->ops->wake_pending_and_unlock(fiq);
 }
 
+/*
+ * The IDs of a CPU queue are congruent to its CPU modulo nr_cpu_ids steps,
+ * and have the top bit set to stay clear of fuse_get_unique().
+ */
+static void fuse_cpu_queue_init(struct fuse_cpu_queue *cq, int cpu)
+{
+	spin_lock_init(&cq->lock);
+	init_waitqueue_head(&cq->waitq);
+	INIT_LIST_HEAD(&cq->pending);
+	cq->reqctr = (1ULL << 63) | (cpu * FUSE_REQ_ID_STEP);
+}
+
+static u64 fuse_cpu_queue_unique(struct fuse_cpu_queue *cq)
+{
+	cq->reqctr += nr_cpu_ids * FUSE_REQ_ID_STEP;
+	return cq->reqctr;
+}
+
+/* Lock the queue of the current CPU, if a device is bound to it */
+static struct fuse_cpu_queue *fuse_cpu_queue_lock(struct fuse_conn *fc)
+{
+	struct fuse_cpu_queue __percpu *queues;
+	struct fuse_cpu_queue *cq;
+
+	queues = smp_load_acquire(&fc->cpu_queues);
+	if (!queues)
+		return NULL;
+
+	cq = per_cpu_ptr(queues, raw_smp_processor_id());
+	if (!READ_ONCE(cq->connected))
+		return NULL;
+
+	spin_lock(&cq->lock);
+	if (cq->connected)
+		return cq;
+	spin_unlock(&cq->lock);
+
+	return NULL;
+}
+
+static void queue_cpu_request_and_unlock(struct fuse_cpu_queue *cq,
+					 struct fuse_req *req)
+__releases(cq->lock)
+{
+	fuse_req_set_len(req);
+	req->cq = cq;
+	list_add_tail(&req->list, &cq->pending);
+	wake_up(&cq->waitq);
+	spin_unlock(&cq->lock);
+}
+
+/* Called with fc->lock held */
+static void fuse_cpu_queue_bind(struct fuse_cpu_queue *cq)
+{
+	spin_lock(&cq->lock);
+	if (!cq->nr_devs++)
+		cq->connected = 1;
+	spin_unlock(&cq->lock);
+}
+
+/*
+ * Called with fc->lock held.  The requests of a CPU without devices left
+ * go to the connection's queue.
+ */
+static void fuse_cpu_queue_unbind(struct fuse_conn *fc,
+				  struct fuse_cpu_queue *cq)
+{
+	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_req *req;
+
+	spin_lock(&cq->lock);
+	if (--cq->nr_devs) {
+		spin_unlock(&cq->lock);
+		return;
+	}
+
+	cq->connected = 0;
+	wake_up_all(&cq->waitq);
+
+	spin_lock(&fiq->lock);
+	list_for_each_entry(req, &cq->pending, list)
+		WRITE_ONCE(req->cq, NULL);
+	if (WARN_ON(!list_empty(&cq->pending) && !fiq->connected)) {
+		spin_unlock(&fiq->lock);
+	} else {
+		list_splice_tail_init(&cq->pending, &fiq->pending);
+		fiq->ops->wake_pending_and_unlock(fiq);
+	}
+	spin_unlock(&cq->lock);
+}
+
+/* Take a request which is not in userspace yet off its input queue */
+static bool fuse_remove_pending(struct fuse_iqueue *fiq, struct fuse_req *req)
+{
+	struct fuse_cpu_queue *cq;
+	spinlock_t *lock;
+	bool pending;
+
+	for (;;) {
+		cq = READ_ONCE(req->cq);
+		lock = cq ? &cq->lock : &fiq->lock;
+		spin_lock(lock);
+		if (READ_ONCE(req->cq) == cq)
+			break;
+		spin_unlock(lock);
+	}
+
+	pending = test_bit(FR_PENDING, &req->flags);
+	if (pending)
+		list_del(&req->list);
+	spin_unlock(lock);
+
+	return pending;
+}
+
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
@@ -392,16 +512,12 @@ static void request_wait_answer(struct fuse_req *req)
 		if (!err)
 			return;
 
-		spin_lock(&fiq->lock);
 		/* Request is not yet in userspace, bail out */
-		if (test_bit(FR_PENDING, &req->flags)) {
-			list_del(&req->list);
-			spin_unlock(&fiq->lock);
+		if (fuse_remove_pending(fiq, req)) {
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
 			return;
 		}
-		spin_unlock(&fiq->lock);
 	}
 
 	/*
@@ -414,23 +530,31 @@ static void request_wait_answer(struct fuse_req *req)
 static void __fuse_request_send(struct fuse_req *req)
 {
 	struct fuse_iqueue *fiq = &req->fm->fc->iq;
+	struct fuse_cpu_queue *cq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->lock);
-	if (!fiq->connected) {
-		spin_unlock(&fiq->lock);
-		req->out.h.error = -ENOTCONN;
+	cq = fuse_cpu_queue_lock(req->fm->fc);
+	if (cq) {
+		req->in.h.unique = fuse_cpu_queue_unique(cq);
+		__fuse_get_request(req);
+		queue_cpu_request_and_unlock(cq, req);
 	} else {
+		spin_lock(&fiq->lock);
+		if (!fiq->connected) {
+			spin_unlock(&fiq->lock);
+			req->out.h.error = -ENOTCONN;
+			return;
+		}
 		req->in.h.unique = fuse_get_unique(fiq);
 		/* acquire extra reference, since request is still needed
 		   after fuse_request_end() */
 		__fuse_get_request(req);
 		queue_request_and_unlock(fiq, req);
-
-		request_wait_answer(req);
-		/* Pairs with smp_wmb() in fuse_request_end() */
-		smp_rmb();
 	}
+
+	request_wait_answer(req);
+	/* Pairs with smp_wmb() in fuse_request_end() */
+	smp_rmb();
 }
 
 static void fuse_adjust_compat(struct fuse_conn *fc, struct fuse_args *args)
@@ -1187,6 +1311,41 @@ __releases(fiq->lock)
 		return fuse_read_batch_forget(fiq, cs, nbytes);
 }
 
+/*
+ * Wait for a request on the CPU queue of a bound device.  Returns NULL if
+ * the queue lost its last device in the meantime, the caller then reads
+ * the connection's queue instead.
+ */
+static struct fuse_req *fuse_cpu_queue_get(struct fuse_cpu_queue *cq,
+					   struct file *file)
+{
+	struct fuse_req *req;
+	int err;
+
+	for (;;) {
+		spin_lock(&cq->lock);
+		if (!cq->connected || !list_empty(&cq->pending))
+			break;
+		spin_unlock(&cq->lock);
+
+		if (file->f_flags & O_NONBLOCK)
+			return ERR_PTR(-EAGAIN);
+		err = wait_event_interruptible_exclusive(cq->waitq,
+				!cq->connected || !list_empty(&cq->pending));
+		if (err)
+			return ERR_PTR(err);
+	}
+
+	req = list_first_entry_or_null(&cq->pending, struct fuse_req, list);
+	if (req) {
+		clear_bit(FR_PENDING, &req->flags);
+		list_del_init(&req->list);
+	}
+	spin_unlock(&cq->lock);
+
+	return req;
+}
+
 /*
  * Read a single request into the userspace filesystem's buffer.  This
  * function waits until a request is available, then removes it from
@@ -1203,6 +1362,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	struct fuse_conn *fc = fud->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
 	struct fuse_pqueue *fpq = &fud->pq;
+	struct fuse_cpu_queue *cq;
 	struct fuse_req *req;
 	struct fuse_args *args;
 	unsigned reqsize;
@@ -1227,6 +1387,15 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 		return -EINVAL;
 
  restart:
+	cq = READ_ONCE(fud->cq);
+	if (cq) {
+		req = fuse_cpu_queue_get(cq, file);
+		if (IS_ERR(req))
+			return PTR_ERR(req);
+		if (req)
+			goto found;
+	}
+
 	for (;;) {
 		spin_lock(&fiq->lock);
 		if (!fiq->connected || request_pending(fiq))
@@ -1265,6 +1434,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	list_del_init(&req->list);
 	spin_unlock(&fiq->lock);
 
+ found:
 	args = req->args;
 	reqsize = req->in.h.len;
 
@@ -2053,12 +2223,25 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
 	struct fuse_iqueue *fiq;
+	struct fuse_cpu_queue *cq;
 	struct fuse_dev *fud = fuse_get_dev(file);
 
 	if (!fud)
 		return EPOLLERR;
 
 	fiq = &fud->fc->iq;
+	cq = READ_ONCE(fud->cq);
+	if (cq) {
+		poll_wait(file, &cq->waitq, wait);
+
+		spin_lock(&cq->lock);
+		if (!list_empty(&cq->pending))
+			mask |= EPOLLIN | EPOLLRDNORM;
+		spin_unlock(&cq->lock);
+		if (mask & EPOLLIN)
+			return mask;
+	}
+
 	poll_wait(file, &fiq->waitq, wait);
 
 	spin_lock(&fiq->lock);
@@ -2127,6 +2310,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		struct fuse_req *req, *next;
 		LIST_HEAD(to_end);
 		unsigned int i;
+		int cpu;
 
 		/* Background queuing checks fc->connected under bg_lock */
 		spin_lock(&fc->bg_lock);
@@ -2171,6 +2355,21 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		wake_up_all(&fiq->waitq);
 		spin_unlock(&fiq->lock);
 		kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+
+		if (fc->cpu_queues) {
+			for_each_possible_cpu(cpu) {
+				struct fuse_cpu_queue *cq;
+
+				cq = per_cpu_ptr(fc->cpu_queues, cpu);
+				spin_lock(&cq->lock);
+				cq->connected = 0;
+				list_for_each_entry(req, &cq->pending, list)
+					clear_bit(FR_PENDING, &req->flags);
+				list_splice_tail_init(&cq->pending, &to_end);
+				wake_up_all(&cq->waitq);
+				spin_unlock(&cq->lock);
+			}
+		}
 		end_polls(fc);
 		wake_up_all(&fc->blocked_waitq);
 		spin_unlock(&fc->lock);
@@ -2207,6 +2406,13 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 
 		end_requests(&to_end);
 
+		if (fud->cq) {
+			spin_lock(&fc->lock);
+			fuse_cpu_queue_unbind(fc, fud->cq);
+			fud->cq = NULL;
+			spin_unlock(&fc->lock);
+		}
+
 		/* Are we the last open device? */
 		if (atomic_dec_and_test(&fc->dev_count)) {
 			WARN_ON(fc->iq.fasync != NULL);
@@ -2246,6 +2452,51 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	return 0;
 }
 
+static int fuse_dev_bind_cpu(struct fuse_dev *fud, u32 cpu)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_cpu_queue __percpu *queues;
+	struct fuse_cpu_queue *cq = NULL;
+	int i, res = 0;
+
+	if (cpu != FUSE_DEV_CPU_NONE &&
+	    (cpu >= nr_cpu_ids || !cpu_possible(cpu)))
+		return -EINVAL;
+
+	mutex_lock(&fuse_mutex);
+	if (cpu != FUSE_DEV_CPU_NONE) {
+		queues = fc->cpu_queues;
+		if (!queues) {
+			queues = alloc_percpu(struct fuse_cpu_queue);
+			if (!queues) {
+				res = -ENOMEM;
+				goto out;
+			}
+			for_each_possible_cpu(i)
+				fuse_cpu_queue_init(per_cpu_ptr(queues, i), i);
+			/* pairs with fuse_cpu_queue_lock() */
+			smp_store_release(&fc->cpu_queues, queues);
+		}
+		cq = per_cpu_ptr(queues, cpu);
+	}
+
+	spin_lock(&fc->lock);
+	if (!fc->connected) {
+		res = -ENOTCONN;
+	} else if (cq != fud->cq) {
+		if (fud->cq)
+			fuse_cpu_queue_unbind(fc, fud->cq);
+		WRITE_ONCE(fud->cq, cq);
+		if (cq)
+			fuse_cpu_queue_bind(cq);
+	}
+	spin_unlock(&fc->lock);
+ out:
+	mutex_unlock(&fuse_mutex);
+
+	return res;
+}
+
 static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
@@ -2278,6 +2529,21 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			}
 		}
 		break;
+	case FUSE_DEV_IOC_BIND_CPU: {
+		u32 cpu;
+
+		res = -EFAULT;
+		if (get_user(cpu, (__u32 __user *)arg))
+			break;
+
+		/* CUSE shares the ioctl handler, but has no use for this */
+		res = -EINVAL;
+		if (file->f_op == &fuse_dev_operations)
+			fud = fuse_get_dev(file);
+		if (fud)
+			res = fuse_dev_bind_cpu(fud, cpu);
+		break;
+	}
 	default:
 		res = -ENOTTY;
 		break;
@@ -373,6 +373,9 @@ struct fuse_req {
 
 	/** fuse_mount this request belongs to */
 	struct fuse_mount *fm;
+
+	/** Per-CPU queue the request is pending on, NULL for fc->iq */
+	struct fuse_cpu_queue *cq;
 };
 
 struct fuse_iqueue;
@@ -449,6 +452,34 @@ struct fuse_iqueue {
 	void *priv;
 };
 
+/**
+ * Per-CPU input queue
+ *
+ * Synchronous requests sent on a CPU with a device bound to it go here
+ * rather than to the connection's fuse_iqueue, so the daemon threads reading
+ * different CPUs don't contend on one lock and wait queue.  Requests only
+ * ever move from here to the fuse_iqueue, with both locks held.
+ */
+struct fuse_cpu_queue {
+	/** Lock protecting accesses to members of this structure */
+	spinlock_t lock;
+
+	/** Bound devices and the CPU is taking requests */
+	unsigned connected;
+
+	/** Number of devices bound to the CPU */
+	unsigned int nr_devs;
+
+	/** Readers of the bound devices are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** The next unique request id, see fuse_cpu_queue_unique() */
+	u64 reqctr;
+
+	/** The list of pending requests */
+	struct list_head pending;
+};
+
 #define FUSE_PQ_HASH_BITS 8
 #define FUSE_PQ_HASH_SIZE (1 << FUSE_PQ_HASH_BITS)
 
@@ -476,6 +507,9 @@ struct fuse_dev {
 	/** Processing queue */
 	struct fuse_pqueue pq;
 
+	/** Per-CPU queue the device reads, if bound to a CPU */
+	struct fuse_cpu_queue *cq;
+
 	/** list entry on fc->devices */
 	struct list_head entry;
 };
@@ -574,6 +608,9 @@ struct fuse_conn {
 	/** Input queue */
 	struct fuse_iqueue iq;
 
+	/** Per-CPU input queues, allocated on the first FUSE_DEV_IOC_BIND_CPU */
+	struct fuse_cpu_queue __percpu *cpu_queues;
+
 	/** The next unique kernel file handle */
 	atomic64_t khctr;
 
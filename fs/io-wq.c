@@ -15,11 +15,14 @@
 #include <linux/cpu.h>
 #include <linux/tracehook.h>
 #include <linux/audit.h>
+#include <linux/seq_file.h>
 #include <uapi/linux/io_uring.h>
 
 #include "io-wq.h"
 
 #define WORKER_IDLE_TIMEOUT	(5 * HZ)
+/* unhashed work of the last owner passed over before giving up */
+#define IO_WQ_FAIR_SCAN		8
 
 enum {
 	IO_WORKER_F_UP		= 1,	/* up and active */
@@ -78,6 +81,16 @@ struct io_wqe_acct {
 	atomic_t nr_running;
 	struct io_wq_work_list work_list;
 	unsigned long flags;
+	/* owner of the last dequeued work */
+	unsigned last_owner;
+	/* jiffies of the last idle exit, rate limits pool shrinking */
+	unsigned long last_exit;
+
+	unsigned long nr_created;
+	unsigned long nr_exited;
+	unsigned long nr_dequeued;
+	unsigned long wait_total;
+	unsigned long wait_max;
 };
 
 enum {
@@ -224,6 +237,7 @@ static void io_worker_exit(struct io_worker *worker)
 	if (worker->flags & IO_WORKER_F_FREE)
 		hlist_nulls_del_rcu(&worker->nulls_node);
 	list_del_rcu(&worker->all_list);
+	io_wqe_get_acct(worker)->nr_exited++;
 	preempt_disable();
 	io_wqe_dec_running(worker);
 	worker->flags = 0;
@@ -454,13 +468,26 @@ static bool io_wait_on_hash(struct io_wqe *wqe, unsigned int hash)
 	return ret;
 }
 
+static void io_acct_dequeued(struct io_wqe_acct *acct, struct io_wq_work *work)
+	__must_hold(wqe->lock)
+{
+	unsigned long wait = (unsigned)jiffies - work->queued;
+
+	acct->last_owner = work->owner;
+	acct->nr_dequeued++;
+	acct->wait_total += wait;
+	if (wait > acct->wait_max)
+		acct->wait_max = wait;
+}
+
 static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
 					   struct io_worker *worker)
 	__must_hold(wqe->lock)
 {
-	struct io_wq_work_node *node, *prev;
+	struct io_wq_work_node *node, *prev, *skip = NULL, *skip_prev = NULL;
 	struct io_wq_work *work, *tail;
 	unsigned int stall_hash = -1U;
+	unsigned int nr_skipped = 0;
 	struct io_wqe *wqe = worker->wqe;
 
 	wq_list_for_each(node, prev, &acct->work_list) {
@@ -470,7 +497,21 @@ static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
 
 		/* not hashed, can run anytime */
 		if (!io_wq_is_hashed(work)) {
+			/*
+			 * Give other owners a turn, so that a ring flooding
+			 * the queue can't starve everybody sharing the wq.
+			 */
+			if (work->owner && work->owner == acct->last_owner) {
+				if (!skip) {
+					skip = node;
+					skip_prev = prev;
+				}
+				if (++nr_skipped >= IO_WQ_FAIR_SCAN)
+					break;
+				continue;
+			}
 			wq_list_del(&acct->work_list, node, prev);
+			io_acct_dequeued(acct, work);
 			return work;
 		}
 
@@ -482,6 +523,7 @@ static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
 		if (!test_and_set_bit(hash, &wqe->wq->hash->map)) {
 			wqe->hash_tail[hash] = NULL;
 			wq_list_cut(&acct->work_list, &tail->list, prev);
+			io_acct_dequeued(acct, work);
 			return work;
 		}
 		if (stall_hash == -1U)
@@ -490,6 +532,14 @@ static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
 		node = &tail->list;
 	}
 
+	/* nobody else had work queued, run the oldest one we passed over */
+	if (skip) {
+		work = container_of(skip, struct io_wq_work, list);
+		wq_list_del(&acct->work_list, skip, skip_prev);
+		io_acct_dequeued(acct, work);
+		return work;
+	}
+
 	if (stall_hash != -1U) {
 		bool unstalled;
 
@@ -639,8 +689,14 @@ static int io_wqe_worker(void *data)
 			io_worker_handle_work(worker);
 			goto loop;
 		}
-		/* timed out, exit unless we're the last worker */
-		if (last_timeout && acct->nr_workers > 1) {
+		/*
+		 * Timed out, exit unless we're the last worker. Only one
+		 * worker per timeout period goes away, so a pool grown by a
+		 * burst shrinks gradually instead of all at once.
+		 */
+		if (last_timeout && acct->nr_workers > 1 &&
+		    time_after_eq(jiffies, acct->last_exit + WORKER_IDLE_TIMEOUT)) {
+			acct->last_exit = jiffies;
 			acct->nr_workers--;
 			raw_spin_unlock(&wqe->lock);
 			__set_current_state(TASK_RUNNING);
@@ -723,6 +779,7 @@ static void io_init_new_worker(struct io_wqe *wqe, struct io_worker *worker,
 	hlist_nulls_add_head_rcu(&worker->nulls_node, &wqe->free_list);
 	list_add_tail_rcu(&worker->all_list, &wqe->all_list);
 	worker->flags |= IO_WORKER_F_FREE;
+	io_wqe_get_acct(worker)->nr_created++;
 	raw_spin_unlock(&wqe->lock);
 	wake_up_new_task(tsk);
 }
@@ -891,6 +948,7 @@ static void io_wqe_insert_work(struct io_wqe *wqe, struct io_wq_work *work)
 	unsigned int hash;
 	struct io_wq_work *tail;
 
+	work->queued = jiffies;
 	if (!io_wq_is_hashed(work)) {
 append:
 		wq_list_add_tail(&work->list, &acct->work_list);
@@ -1190,6 +1248,7 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 			acct->index = i;
 			atomic_set(&acct->nr_running, 0);
 			INIT_WQ_LIST(&acct->work_list);
+			acct->last_exit = jiffies - WORKER_IDLE_TIMEOUT;
 		}
 		wqe->wq = wq;
 		raw_spin_lock_init(&wqe->lock);
@@ -1408,6 +1467,40 @@ int io_wq_max_workers(struct io_wq *wq, int *new_count)
 	return 0;
 }
 
+/*
+ * Dump the worker pool and queueing statistics of @wq, used for the io_uring
+ * fdinfo.
+ */
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m)
+{
+	static const char * const names[IO_WQ_ACCT_NR] = { "bound", "unbound" };
+	int i, node;
+
+	for_each_node(node) {
+		struct io_wqe *wqe = wq->wqes[node];
+		struct io_wqe_acct stats[IO_WQ_ACCT_NR];
+
+		raw_spin_lock(&wqe->lock);
+		memcpy(stats, wqe->acct, sizeof(stats));
+		raw_spin_unlock(&wqe->lock);
+
+		for (i = 0; i < IO_WQ_ACCT_NR; i++) {
+			struct io_wqe_acct *acct = &stats[i];
+
+			if (!acct->nr_created)
+				continue;
+			seq_printf(m, "  node %d %s: workers %u/%u running %d created %lu exited %lu dequeued %lu wait avg %ums max %ums\n",
+				   node, names[i], acct->nr_workers, acct->max_workers,
+				   atomic_read(&acct->nr_running),
+				   acct->nr_created, acct->nr_exited,
+				   acct->nr_dequeued,
+				   acct->nr_dequeued ?
+				   jiffies_to_msecs(acct->wait_total / acct->nr_dequeued) : 0,
+				   jiffies_to_msecs(acct->wait_max));
+		}
+	}
+}
+
 static __init int io_wq_init(void)
 {
 	int ret;
@@ -4,6 +4,7 @@
 #include <linux/refcount.h>
 
 struct io_wq;
+struct seq_file;
 
 enum {
 	IO_WQ_WORK_CANCEL	= 1,
@@ -155,6 +156,10 @@ struct io_wq_work_node *wq_stack_extract(struct io_wq_work_node *stack)
 struct io_wq_work {
 	struct io_wq_work_node list;
 	unsigned flags;
+	/* submitter cookie, unhashed work is balanced between owners */
+	unsigned owner;
+	/* jiffies at the time the work was queued */
+	unsigned queued;
 };
 
 static inline struct io_wq_work *wq_next_work(struct io_wq_work *work)
@@ -196,6 +201,7 @@ void io_wq_hash_work(struct io_wq_work *work, void *val);
 
 int io_wq_cpu_affinity(struct io_wq *wq, cpumask_var_t mask);
 int io_wq_max_workers(struct io_wq *wq, int *new_count);
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m);
 
 static inline bool io_wq_is_hashed(struct io_wq_work *work)
 {
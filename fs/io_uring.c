@@ -81,6 +81,11 @@
 #include <linux/tracehook.h>
 #include <linux/audit.h>
 #include <linux/security.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
+#include <linux/sync_file.h>
+#include <linux/sched/clock.h>
+#include <linux/hash.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/io_uring.h>
@@ -203,10 +208,15 @@ struct io_rings {
 enum io_uring_cmd_flags {
 	IO_URING_F_COMPLETE_DEFER	= 1,
 	IO_URING_F_UNLOCKED		= 2,
+	/* multishot retry from poll task_work, see io_poll_check_events() */
+	IO_URING_F_MULTISHOT		= 4,
 	/* int's last bit, sign checks are usually faster than a bit test */
 	IO_URING_F_NONBLOCK		= INT_MIN,
 };
 
+/* returned by an IO_URING_F_MULTISHOT issue which is done with the request */
+#define IO_MULTISHOT_STOP	1
+
 struct io_mapped_ubuf {
 	u64		ubuf;
 	u64		ubuf_end;
@@ -270,6 +280,15 @@ struct io_buffer {
 	__u16 bid;
 };
 
+/* a buffer group registered with IORING_REGISTER_PBUF_RING */
+struct io_buf_ring {
+	struct io_uring_buf_ring	*br;
+	struct page			**pages;
+	int				nr_pages;
+	__u16				head;
+	__u16				mask;
+};
+
 struct io_restriction {
 	DECLARE_BITMAP(register_op, IORING_REGISTER_LAST);
 	DECLARE_BITMAP(sqe_op, IORING_OP_LAST);
@@ -295,6 +314,9 @@ struct io_sq_data {
 	struct wait_queue_head	wait;
 
 	unsigned		sq_thread_idle;
+	/* average gap between bursts of work, in jiffies << 3 */
+	unsigned long		sq_idle_gap;
+	unsigned long		sq_last_active;
 	int			sq_cpu;
 	pid_t			task_pid;
 	pid_t			task_tgid;
@@ -377,11 +399,16 @@ struct io_ring_ctx {
 		struct io_submit_state	submit_state;
 		struct list_head	timeout_list;
 		struct list_head	ltimeout_list;
+		struct list_head	fence_list;
 		struct list_head	cq_overflow_list;
 		struct xarray		io_buffers;
+		struct xarray		io_buf_rings;
 		struct xarray		personalities;
 		u32			pers_next;
 		unsigned		sq_thread_idle;
+		/* time the SQPOLL thread spent on this ring, under sqd->lock */
+		u64			sq_time;
+		unsigned long		sq_submitted;
 	} ____cacheline_aligned_in_smp;
 
 	/* IRQ completion list, under ->completion_lock */
@@ -453,6 +480,9 @@ struct io_ring_ctx {
 		/* ctx exit and cancelation */
 		struct llist_head		fallback_llist;
 		struct delayed_work		fallback_work;
+		/* zero-copy send notifications */
+		struct llist_head		notif_llist;
+		struct work_struct		notif_work;
 		struct work_struct		exit_work;
 		struct list_head		tctx_list;
 		struct completion		ref_comp;
@@ -579,6 +609,18 @@ struct io_sr_msg {
 	int				msg_flags;
 	int				bgid;
 	size_t				len;
+	struct io_notif			*notif;
+};
+
+/*
+ * Zero-copy send notification, posted as an IORING_CQE_F_NOTIF CQE once the
+ * network stack dropped the last reference to the sent pages.
+ */
+struct io_notif {
+	struct ubuf_info		uarg;
+	struct io_ring_ctx		*ctx;
+	u64				user_data;
+	struct llist_node		node;
 };
 
 struct io_open {
@@ -619,6 +661,14 @@ struct io_epoll {
 	struct epoll_event		event;
 };
 
+struct io_fence_wait {
+	struct file			*file;
+	struct dma_fence		*fence;
+	struct dma_fence_cb		cb;
+	/* in ctx->fence_list while the callback is armed */
+	struct list_head		list;
+};
+
 struct io_splice {
 	struct file			*file_out;
 	struct file			*file_in;
@@ -741,6 +791,7 @@ enum {
 	REQ_F_ARM_LTIMEOUT_BIT,
 	REQ_F_ASYNC_DATA_BIT,
 	REQ_F_SKIP_LINK_CQES_BIT,
+	REQ_F_APOLL_MULTISHOT_BIT,
 	/* keep async read/write and isreg together and in order */
 	REQ_F_SUPPORT_NOWAIT_BIT,
 	REQ_F_ISREG_BIT,
@@ -799,6 +850,8 @@ enum {
 	REQ_F_ASYNC_DATA	= BIT(REQ_F_ASYNC_DATA_BIT),
 	/* don't post CQEs while failing linked requests */
 	REQ_F_SKIP_LINK_CQES	= BIT(REQ_F_SKIP_LINK_CQES_BIT),
+	/* keeps the async poll armed and retries after every wakeup */
+	REQ_F_APOLL_MULTISHOT	= BIT(REQ_F_APOLL_MULTISHOT_BIT),
 };
 
 struct async_poll {
@@ -855,6 +908,7 @@ struct io_kiocb {
 		struct io_mkdir		mkdir;
 		struct io_symlink	symlink;
 		struct io_hardlink	hardlink;
+		struct io_fence_wait	fence;
 	};
 
 	u8				opcode;
@@ -1105,6 +1159,16 @@ static const struct io_op_def io_op_defs[] = {
 	[IORING_OP_MKDIRAT] = {},
 	[IORING_OP_SYMLINKAT] = {},
 	[IORING_OP_LINKAT] = {},
+	[IORING_OP_SEND_ZC] = {
+		.needs_file		= 1,
+		.unbound_nonreg_file	= 1,
+		.pollout		= 1,
+		.audit_skip		= 1,
+	},
+	[IORING_OP_FENCE_WAIT] = {
+		.needs_file		= 1,
+		.audit_skip		= 1,
+	},
 };
 
 /* requests with any of those set should undergo io_disarm_next() */
@@ -1130,6 +1194,8 @@ static void io_clean_op(struct io_kiocb *req);
 static struct file *io_file_get(struct io_ring_ctx *ctx,
 				struct io_kiocb *req, int fd, bool fixed);
 static void __io_queue_sqe(struct io_kiocb *req);
+static void io_notif_work(struct work_struct *work);
+static int io_issue_sqe(struct io_kiocb *req, unsigned int issue_flags);
 static void io_rsrc_put_work(struct work_struct *work);
 
 static void io_req_task_queue(struct io_kiocb *req);
@@ -1446,6 +1512,7 @@ static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_LIST_HEAD(&ctx->cq_overflow_list);
 	init_completion(&ctx->ref_comp);
 	xa_init_flags(&ctx->io_buffers, XA_FLAGS_ALLOC1);
+	xa_init(&ctx->io_buf_rings);
 	xa_init_flags(&ctx->personalities, XA_FLAGS_ALLOC1);
 	mutex_init(&ctx->uring_lock);
 	init_waitqueue_head(&ctx->cq_wait);
@@ -1454,6 +1521,7 @@ static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_WQ_LIST(&ctx->iopoll_list);
 	INIT_LIST_HEAD(&ctx->defer_list);
 	INIT_LIST_HEAD(&ctx->timeout_list);
+	INIT_LIST_HEAD(&ctx->fence_list);
 	INIT_LIST_HEAD(&ctx->ltimeout_list);
 	spin_lock_init(&ctx->rsrc_ref_lock);
 	INIT_LIST_HEAD(&ctx->rsrc_ref_list);
@@ -1463,6 +1531,8 @@ static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	ctx->submit_state.free_list.next = NULL;
 	INIT_WQ_LIST(&ctx->locked_free_list);
 	INIT_DELAYED_WORK(&ctx->fallback_work, io_fallback_req_func);
+	init_llist_head(&ctx->notif_llist);
+	INIT_WORK(&ctx->notif_work, io_notif_work);
 	INIT_WQ_LIST(&ctx->submit_state.compl_reqs);
 	return ctx;
 err:
@@ -1541,6 +1611,7 @@ static void io_prep_async_work(struct io_kiocb *req)
 
 	req->work.list.next = NULL;
 	req->work.flags = 0;
+	req->work.owner = hash_ptr(ctx, 32) ?: 1;
 	if (req->flags & REQ_F_FORCE_ASYNC)
 		req->work.flags |= IO_WQ_WORK_CONCURRENT;
 
@@ -1935,6 +2006,35 @@ static noinline bool io_fill_cqe_aux(struct io_ring_ctx *ctx, u64 user_data,
 	return __io_fill_cqe(ctx, user_data, res, cflags);
 }
 
+/*
+ * Post an extra CQE on behalf of a multishot request, returns false if it
+ * couldn't even be queued as an overflow.
+ */
+static bool io_post_aux_cqe(struct io_kiocb *req, s32 res, u32 cflags)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	bool filled;
+
+	spin_lock(&ctx->completion_lock);
+	filled = io_fill_cqe_aux(ctx, req->user_data, res, cflags);
+	io_commit_cqring(ctx);
+	spin_unlock(&ctx->completion_lock);
+	if (filled)
+		io_cqring_ev_posted(ctx);
+	return filled;
+}
+
+/*
+ * Ends a multishot request issued with IO_URING_F_MULTISHOT, the final CQE
+ * is posted by the poll task_work once the request is off the waitqueue.
+ */
+static int io_multishot_stop(struct io_kiocb *req, s32 res, u32 cflags)
+{
+	req->result = res;
+	req->cflags = cflags;
+	return IO_MULTISHOT_STOP;
+}
+
 static void __io_req_complete_post(struct io_kiocb *req, s32 res,
 				   u32 cflags)
 {
@@ -3107,11 +3207,11 @@ static void kiocb_done(struct io_kiocb *req, ssize_t ret,
 	}
 }
 
-static int __io_import_fixed(struct io_kiocb *req, int rw, struct iov_iter *iter,
-			     struct io_mapped_ubuf *imu)
+static int __io_import_fixed(int rw, struct iov_iter *iter,
+			     struct io_mapped_ubuf *imu, u64 buf_addr,
+			     size_t len)
 {
-	size_t len = req->rw.len;
-	u64 buf_end, buf_addr = req->rw.addr;
+	u64 buf_end;
 	size_t offset;
 
 	if (unlikely(check_add_overflow(buf_addr, (u64)len, &buf_end)))
@@ -3165,7 +3265,8 @@ static int __io_import_fixed(struct io_kiocb *req, int rw, struct iov_iter *iter
 	return 0;
 }
 
-static int io_import_fixed(struct io_kiocb *req, int rw, struct iov_iter *iter)
+static int io_import_fixed(struct io_kiocb *req, int rw, struct iov_iter *iter,
+			   u64 buf_addr, size_t len)
 {
 	struct io_mapped_ubuf *imu = req->imu;
 	u16 index, buf_index = req->buf_index;
@@ -3180,7 +3281,7 @@ static int io_import_fixed(struct io_kiocb *req, int rw, struct iov_iter *iter)
 		imu = READ_ONCE(ctx->user_bufs[index]);
 		req->imu = imu;
 	}
-	return __io_import_fixed(req, rw, iter, imu);
+	return __io_import_fixed(rw, iter, imu, buf_addr, len);
 }
 
 static void io_ring_submit_unlock(struct io_ring_ctx *ctx, bool needs_lock)
@@ -3201,11 +3302,40 @@ static void io_ring_submit_lock(struct io_ring_ctx *ctx, bool needs_lock)
 		mutex_lock(&ctx->uring_lock);
 }
 
+/*
+ * Take the next buffer the application added to a buffer ring. The head is
+ * private to the kernel and protected by the uring_lock, the tail is only
+ * ever written by the application.
+ */
+static struct io_buffer *io_ring_buffer_select(struct io_buf_ring *bl)
+{
+	struct io_uring_buf_ring *br = bl->br;
+	struct io_uring_buf *buf;
+	struct io_buffer *kbuf;
+	__u16 head = bl->head;
+
+	/* pairs with the application's store of the new tail */
+	if (head == smp_load_acquire(&br->tail))
+		return ERR_PTR(-ENOBUFS);
+
+	kbuf = kmalloc(sizeof(*kbuf), GFP_KERNEL_ACCOUNT);
+	if (!kbuf)
+		return ERR_PTR(-ENOMEM);
+
+	buf = &br->bufs[head & bl->mask];
+	kbuf->addr = READ_ONCE(buf->addr);
+	kbuf->len = min_t(__u32, READ_ONCE(buf->len), MAX_RW_COUNT);
+	kbuf->bid = READ_ONCE(buf->bid);
+	bl->head = head + 1;
+	return kbuf;
+}
+
 static struct io_buffer *io_buffer_select(struct io_kiocb *req, size_t *len,
 					  int bgid, unsigned int issue_flags)
 {
 	struct io_buffer *kbuf = req->kbuf;
 	struct io_buffer *head;
+	struct io_buf_ring *bl;
 	bool needs_lock = issue_flags & IO_URING_F_UNLOCKED;
 
 	if (req->flags & REQ_F_BUFFER_SELECTED)
@@ -3215,6 +3345,18 @@ static struct io_buffer *io_buffer_select(struct io_kiocb *req, size_t *len,
 
 	lockdep_assert_held(&req->ctx->uring_lock);
 
+	bl = xa_load(&req->ctx->io_buf_rings, bgid);
+	if (bl) {
+		kbuf = io_ring_buffer_select(bl);
+		if (!IS_ERR(kbuf)) {
+			if (*len > kbuf->len)
+				*len = kbuf->len;
+			req->flags |= REQ_F_BUFFER_SELECTED;
+			req->kbuf = kbuf;
+		}
+		goto out_unlock;
+	}
+
 	head = xa_load(&req->ctx->io_buffers, bgid);
 	if (head) {
 		if (!list_empty(&head->list)) {
@@ -3233,6 +3375,7 @@ static struct io_buffer *io_buffer_select(struct io_kiocb *req, size_t *len,
 		kbuf = ERR_PTR(-ENOBUFS);
 	}
 
+out_unlock:
 	io_ring_submit_unlock(req->ctx, needs_lock);
 	return kbuf;
 }
@@ -3331,7 +3474,7 @@ static struct iovec *__io_import_iovec(int rw, struct io_kiocb *req,
 	ssize_t ret;
 
 	if (opcode == IORING_OP_READ_FIXED || opcode == IORING_OP_WRITE_FIXED) {
-		ret = io_import_fixed(req, rw, iter);
+		ret = io_import_fixed(req, rw, iter, req->rw.addr, req->rw.len);
 		if (ret)
 			return ERR_PTR(ret);
 		return NULL;
@@ -4584,6 +4727,12 @@ static int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags)
 
 	lockdep_assert_held(&ctx->uring_lock);
 
+	/* buffer rings are refilled by the application directly */
+	if (xa_load(&ctx->io_buf_rings, p->bgid)) {
+		ret = -EEXIST;
+		goto out;
+	}
+
 	list = head = xa_load(&ctx->io_buffers, p->bgid);
 
 	ret = io_add_buffers(p, &head);
@@ -4592,6 +4741,7 @@ static int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags)
 		if (ret < 0)
 			__io_remove_buffers(ctx, head, p->bgid, -1U);
 	}
+out:
 	if (ret < 0)
 		req_set_fail(req);
 	/* complete before unlock, IOPOLL may need the lock */
@@ -4647,6 +4797,151 @@ static int io_epoll_ctl(struct io_kiocb *req, unsigned int issue_flags)
 #endif
 }
 
+/*
+ * IORING_OP_FENCE_WAIT completes once the dma_fence of the sync_file passed
+ * in sqe->fd signals, with the fence error as result. Unlike polling the
+ * sync_file it doesn't go through the poll machinery and costs a single
+ * fence callback, so it links cleanly in front of requests consuming the
+ * result of the GPU work.
+ */
+static int io_fence_wait_prep(struct io_kiocb *req,
+			      const struct io_uring_sqe *sqe)
+{
+#if defined(CONFIG_SYNC_FILE)
+	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->addr || sqe->off || sqe->len ||
+	    sqe->rw_flags || sqe->buf_index || sqe->splice_fd_in)
+		return -EINVAL;
+
+	req->fence.fence = NULL;
+	INIT_LIST_HEAD(&req->fence.list);
+	INIT_LIST_HEAD(&req->fence.cb.node);
+	return 0;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
+#if defined(CONFIG_SYNC_FILE)
+static void io_fence_wait_done(struct io_kiocb *req, bool *locked)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+
+	spin_lock(&ctx->completion_lock);
+	list_del_init(&req->fence.list);
+	spin_unlock(&ctx->completion_lock);
+
+	dma_fence_put(req->fence.fence);
+	if (req->result < 0)
+		req_set_fail(req);
+	io_req_task_complete(req, locked);
+}
+
+static void io_fence_wait_cb(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct io_kiocb *req = container_of(cb, struct io_kiocb, fence.cb);
+
+	req->result = fence->error;
+	req->io_task_work.func = io_fence_wait_done;
+	io_req_task_work_add(req, false);
+}
+
+/* Returns true if the callback was disarmed and the request got queued */
+static bool io_fence_cancel_req(struct io_kiocb *req)
+	__must_hold(&req->ctx->completion_lock)
+{
+	/* the callback already fired, completion is on its way */
+	if (!dma_fence_remove_callback(req->fence.fence, &req->fence.cb))
+		return false;
+
+	list_del_init(&req->fence.list);
+	req->result = -ECANCELED;
+	req->io_task_work.func = io_fence_wait_done;
+	io_req_task_work_add(req, false);
+	return true;
+}
+
+static int io_fence_cancel(struct io_ring_ctx *ctx, __u64 sqe_addr)
+	__must_hold(&ctx->completion_lock)
+{
+	struct io_kiocb *req;
+
+	list_for_each_entry(req, &ctx->fence_list, fence.list) {
+		if (req->user_data != sqe_addr)
+			continue;
+		return io_fence_cancel_req(req) ? 0 : -EALREADY;
+	}
+	return -ENOENT;
+}
+
+static __cold bool io_fence_remove_all(struct io_ring_ctx *ctx,
+				       struct task_struct *tsk, bool cancel_all)
+{
+	struct io_kiocb *req, *tmp;
+	bool found = false;
+
+	spin_lock(&ctx->completion_lock);
+	list_for_each_entry_safe(req, tmp, &ctx->fence_list, fence.list) {
+		if (io_match_task_safe(req, tsk, cancel_all))
+			found |= io_fence_cancel_req(req);
+	}
+	spin_unlock(&ctx->completion_lock);
+	return found;
+}
+#else
+static int io_fence_cancel(struct io_ring_ctx *ctx, __u64 sqe_addr)
+{
+	return -ENOENT;
+}
+
+static bool io_fence_remove_all(struct io_ring_ctx *ctx,
+				struct task_struct *tsk, bool cancel_all)
+{
+	return false;
+}
+#endif
+
+static int io_fence_wait(struct io_kiocb *req, unsigned int issue_flags)
+{
+#if defined(CONFIG_SYNC_FILE)
+	struct io_fence_wait *fw = &req->fence;
+	struct io_ring_ctx *ctx = req->ctx;
+	struct dma_fence *fence;
+	int ret;
+
+	fence = sync_file_file_get_fence(req->file);
+	if (!fence) {
+		req_set_fail(req);
+		__io_req_complete(req, issue_flags, -EINVAL, 0);
+		return 0;
+	}
+
+	/*
+	 * Arm the callback under ->completion_lock, so cancellation never
+	 * sees the request listed with the callback not yet added.
+	 */
+	fw->fence = fence;
+	spin_lock(&ctx->completion_lock);
+	ret = dma_fence_add_callback(fence, &fw->cb, io_fence_wait_cb);
+	if (!ret)
+		list_add_tail(&fw->list, &ctx->fence_list);
+	spin_unlock(&ctx->completion_lock);
+	if (!ret)
+		return 0;
+
+	/* already signaled */
+	ret = fence->error;
+	dma_fence_put(fence);
+	if (ret < 0)
+		req_set_fail(req);
+	__io_req_complete(req, issue_flags, ret, 0);
+	return 0;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
 static int io_madvise_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 #if defined(CONFIG_ADVISE_SYSCALLS) && defined(CONFIG_MMU)
@@ -4855,6 +5150,73 @@ static int io_sync_file_range(struct io_kiocb *req, unsigned int issue_flags)
 	return 0;
 }
 
+static void io_notif_work(struct work_struct *work)
+{
+	struct io_ring_ctx *ctx = container_of(work, struct io_ring_ctx,
+						notif_work);
+	struct llist_node *node = llist_del_all(&ctx->notif_llist);
+	struct io_notif *notif, *tmp;
+	unsigned int nr = 0;
+
+	if (!node)
+		return;
+
+	spin_lock(&ctx->completion_lock);
+	llist_for_each_entry_safe(notif, tmp, node, node) {
+		io_fill_cqe_aux(ctx, notif->user_data, 0, IORING_CQE_F_NOTIF);
+		kfree(notif);
+		nr++;
+	}
+	io_commit_cqring(ctx);
+	spin_unlock(&ctx->completion_lock);
+	io_cqring_ev_posted(ctx);
+	percpu_ref_put_many(&ctx->refs, nr);
+}
+
+/* called by the network stack for each dropped reference, in any context */
+static void io_notif_callback(struct sk_buff *skb, struct ubuf_info *uarg,
+			      bool success)
+{
+	struct io_notif *notif = container_of(uarg, struct io_notif, uarg);
+	struct io_ring_ctx *ctx = notif->ctx;
+
+	if (!refcount_dec_and_test(&uarg->refcnt))
+		return;
+	if (llist_add(&notif->node, &ctx->notif_llist))
+		schedule_work(&ctx->notif_work);
+}
+
+static struct io_notif *io_alloc_notif(struct io_kiocb *req)
+{
+	struct io_notif *notif;
+
+	notif = kzalloc(sizeof(*notif), GFP_KERNEL);
+	if (!notif)
+		return NULL;
+
+	notif->ctx = req->ctx;
+	notif->user_data = req->user_data;
+	notif->uarg.callback = io_notif_callback;
+	notif->uarg.flags = SKBFL_ZEROCOPY_FRAG | SKBFL_DONT_ORPHAN;
+	refcount_set(&notif->uarg.refcnt, 1);
+	/* the ctx has to stay around until the notification is posted */
+	percpu_ref_get(&req->ctx->refs);
+	return notif;
+}
+
+/* drop the submission reference, the CQE follows once the stack is done */
+static void io_notif_flush(struct io_notif *notif)
+{
+	io_notif_callback(NULL, &notif->uarg, true);
+}
+
+/* for notifications never handed to the network stack */
+static void io_notif_free(struct io_notif *notif)
+{
+	percpu_ref_put(&notif->ctx->refs);
+	kfree(notif);
+}
+
 #if defined(CONFIG_NET)
 static int io_setup_async_msg(struct io_kiocb *req,
 			      struct io_async_msghdr *kmsg)
@@ -4983,6 +5345,7 @@ static int io_send(struct io_kiocb *req, unsigned int issue_flags)
 	msg.msg_control = NULL;
 	msg.msg_controllen = 0;
 	msg.msg_namelen = 0;
+	msg.msg_ubuf = NULL;
 
 	flags = req->sr_msg.msg_flags;
 	if (issue_flags & IO_URING_F_NONBLOCK)
@@ -5003,6 +5366,86 @@ static int io_send(struct io_kiocb *req, unsigned int issue_flags)
 	return 0;
 }
 
+static int io_send_zc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_sr_msg *sr = &req->sr_msg;
+
+	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->addr2 || sqe->file_index)
+		return -EINVAL;
+
+	sr->buf = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	sr->len = READ_ONCE(sqe->len);
+	sr->msg_flags = READ_ONCE(sqe->msg_flags) | MSG_NOSIGNAL;
+	if (sr->msg_flags & MSG_DONTWAIT)
+		req->flags |= REQ_F_NOWAIT;
+	/* the data has to be in a registered buffer */
+	req->buf_index = READ_ONCE(sqe->buf_index);
+
+	sr->notif = io_alloc_notif(req);
+	if (!sr->notif)
+		return -ENOMEM;
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return 0;
+}
+
+/*
+ * Send straight from the pages of a registered buffer. The result CQE has
+ * IORING_CQE_F_MORE set and is followed by an IORING_CQE_F_NOTIF CQE with the
+ * same user_data once the network stack released the pages, only then the
+ * buffer may be reused.
+ */
+static int io_send_zc(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_sr_msg *sr = &req->sr_msg;
+	struct io_notif *notif = sr->notif;
+	struct msghdr msg;
+	struct socket *sock;
+	unsigned flags;
+	int min_ret = 0;
+	int ret;
+
+	sock = sock_from_file(req->file);
+	if (unlikely(!sock))
+		return -ENOTSOCK;
+
+	ret = io_import_fixed(req, WRITE, &msg.msg_iter,
+			      (u64)(unsigned long)sr->buf, sr->len);
+	if (unlikely(ret))
+		return ret;
+
+	msg.msg_name = NULL;
+	msg.msg_control = NULL;
+	msg.msg_controllen = 0;
+	msg.msg_namelen = 0;
+	msg.msg_ubuf = &notif->uarg;
+
+	flags = sr->msg_flags | MSG_ZEROCOPY;
+	if (issue_flags & IO_URING_F_NONBLOCK)
+		flags |= MSG_DONTWAIT;
+	if (flags & MSG_WAITALL)
+		min_ret = iov_iter_count(&msg.msg_iter);
+
+	msg.msg_flags = flags;
+	ret = sock_sendmsg(sock, &msg);
+	if (ret < min_ret) {
+		if (ret == -EAGAIN && (issue_flags & IO_URING_F_NONBLOCK))
+			return -EAGAIN;
+		if (ret == -ERESTARTSYS)
+			ret = -EINTR;
+		req_set_fail(req);
+	}
+
+	sr->notif = NULL;
+	req->flags &= ~REQ_F_NEED_CLEANUP;
+	/* don't defer, the notification must not overtake the result */
+	__io_req_complete(req, issue_flags & ~IO_URING_F_COMPLETE_DEFER, ret,
+			  IORING_CQE_F_MORE);
+	io_notif_flush(notif);
+	return 0;
+}
+
 static int __io_recvmsg_copy_hdr(struct io_kiocb *req,
 				 struct io_async_msghdr *iomsg)
 {
@@ -5111,6 +5554,7 @@ static int io_recvmsg_prep_async(struct io_kiocb *req)
 static int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_sr_msg *sr = &req->sr_msg;
+	unsigned int flags;
 
 	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
 		return -EINVAL;
@@ -5122,6 +5566,17 @@ static int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	if (sr->msg_flags & MSG_DONTWAIT)
 		req->flags |= REQ_F_NOWAIT;
 
+	flags = READ_ONCE(sqe->ioprio);
+	if (flags & ~IORING_RECV_MULTISHOT)
+		return -EINVAL;
+	if (flags & IORING_RECV_MULTISHOT) {
+		if (req->opcode != IORING_OP_RECV ||
+		    !(req->flags & REQ_F_BUFFER_SELECT) ||
+		    (sr->msg_flags & MSG_WAITALL))
+			return -EINVAL;
+		req->flags |= REQ_F_APOLL_MULTISHOT;
+	}
+
 #ifdef CONFIG_COMPAT
 	if (req->ctx->compat)
 		sr->msg_flags |= MSG_CMSG_COMPAT;
@@ -5195,6 +5650,7 @@ static int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	void __user *buf = sr->buf;
 	struct socket *sock;
 	struct iovec iov;
+	unsigned int cflags;
 	unsigned flags;
 	int ret, min_ret = 0;
 	bool force_nonblock = issue_flags & IO_URING_F_NONBLOCK;
@@ -5203,6 +5659,7 @@ static int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	if (unlikely(!sock))
 		return -ENOTSOCK;
 
+retry:
 	if (req->flags & REQ_F_BUFFER_SELECT) {
 		kbuf = io_recv_buffer_select(req, issue_flags);
 		if (IS_ERR(kbuf))
@@ -5230,8 +5687,12 @@ static int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	ret = sock_recvmsg(sock, &msg, flags);
 out_free:
 	if (ret < min_ret) {
-		if (ret == -EAGAIN && force_nonblock)
+		if (ret == -EAGAIN && force_nonblock) {
+			/* multishot retries stay armed for the next wakeup */
+			if (issue_flags & IO_URING_F_MULTISHOT)
+				return 0;
 			return -EAGAIN;
+		}
 		if (ret == -ERESTARTSYS)
 			ret = -EINTR;
 		req_set_fail(req);
@@ -5239,17 +5700,26 @@ static int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 		req_set_fail(req);
 	}
 
-	__io_req_complete(req, issue_flags, ret, io_put_kbuf(req));
+	cflags = io_put_kbuf(req);
+	/* a zero sized read is EOF and ends multishot as well */
+	if ((req->flags & REQ_F_APOLL_MULTISHOT) && ret > 0 &&
+	    io_post_aux_cqe(req, ret, cflags | IORING_CQE_F_MORE))
+		goto retry;
+
+	if (issue_flags & IO_URING_F_MULTISHOT)
+		return io_multishot_stop(req, ret, cflags);
+	__io_req_complete(req, issue_flags, ret, cflags);
 	return 0;
 }
 
 static int io_accept_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_accept *accept = &req->accept;
+	unsigned int flags;
 
 	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
 		return -EINVAL;
-	if (sqe->ioprio || sqe->len || sqe->buf_index)
+	if (sqe->len || sqe->buf_index)
 		return -EINVAL;
 
 	accept->addr = u64_to_user_ptr(READ_ONCE(sqe->addr));
@@ -5265,6 +5735,16 @@ static int io_accept_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		return -EINVAL;
 	if (SOCK_NONBLOCK != O_NONBLOCK && (accept->flags & SOCK_NONBLOCK))
 		accept->flags = (accept->flags & ~SOCK_NONBLOCK) | O_NONBLOCK;
+
+	flags = READ_ONCE(sqe->ioprio);
+	if (flags & ~IORING_ACCEPT_MULTISHOT)
+		return -EINVAL;
+	if (flags & IORING_ACCEPT_MULTISHOT) {
+		/* every connection would replace the previous one in the slot */
+		if (accept->file_slot)
+			return -EINVAL;
+		req->flags |= REQ_F_APOLL_MULTISHOT;
+	}
 	return 0;
 }
 
@@ -5280,6 +5760,7 @@ static int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 	if (req->file->f_flags & O_NONBLOCK)
 		req->flags |= REQ_F_NOWAIT;
 
+retry:
 	if (!fixed) {
 		fd = __get_unused_fd_flags(accept->flags, accept->nofile);
 		if (unlikely(fd < 0))
@@ -5291,8 +5772,12 @@ static int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 		if (!fixed)
 			put_unused_fd(fd);
 		ret = PTR_ERR(file);
-		if (ret == -EAGAIN && force_nonblock)
+		if (ret == -EAGAIN && force_nonblock) {
+			/* multishot retries stay armed for the next wakeup */
+			if (issue_flags & IO_URING_F_MULTISHOT)
+				return 0;
 			return -EAGAIN;
+		}
 		if (ret == -ERESTARTSYS)
 			ret = -EINTR;
 		req_set_fail(req);
@@ -5303,6 +5788,13 @@ static int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 		ret = io_install_fixed_file(req, file, issue_flags,
 					    accept->file_slot - 1);
 	}
+
+	if ((req->flags & REQ_F_APOLL_MULTISHOT) && ret >= 0 &&
+	    io_post_aux_cqe(req, ret, IORING_CQE_F_MORE))
+		goto retry;
+
+	if (issue_flags & IO_URING_F_MULTISHOT)
+		return io_multishot_stop(req, ret, 0);
 	__io_req_complete(req, issue_flags, ret, 0);
 	return 0;
 }
@@ -5396,6 +5888,7 @@ IO_NETOP_PREP_ASYNC(recvmsg);
 IO_NETOP_PREP_ASYNC(connect);
 IO_NETOP_PREP(accept);
 IO_NETOP_FN(send);
+IO_NETOP_PREP(send_zc);
 IO_NETOP_FN(recv);
 #endif /* CONFIG_NET */
 
@@ -5505,9 +5998,12 @@ static void io_poll_remove_entries(struct io_kiocb *req)
  *
  * Returns a negative error on failure. >0 when no action require, which is
  * either spurious wakeup or multishot CQE is served. 0 when it's done with
- * the request, then the mask is stored in req->result.
+ * the request, then the mask is stored in req->result. Multishot async poll
+ * requests are retried from here until they would block again, when one
+ * finishes 0 is returned with its final result in req->result and
+ * req->cflags.
  */
-static int io_poll_check_events(struct io_kiocb *req)
+static int io_poll_check_events(struct io_kiocb *req, bool *locked)
 {
 	struct io_ring_ctx *ctx = req->ctx;
 	struct io_poll_iocb *poll = io_poll_get_single(req);
@@ -5533,7 +6029,8 @@ static int io_poll_check_events(struct io_kiocb *req)
 		}
 
 		/* multishot, just fill an CQE and proceed */
-		if (req->result && !(poll->events & EPOLLONESHOT)) {
+		if (req->result && !(poll->events & EPOLLONESHOT) &&
+		    req->opcode == IORING_OP_POLL_ADD) {
 			__poll_t mask = mangle_poll(req->result & poll->events);
 			bool filled;
 
@@ -5545,7 +6042,22 @@ static int io_poll_check_events(struct io_kiocb *req)
 			if (unlikely(!filled))
 				return -ECANCELED;
 			io_cqring_ev_posted(ctx);
+		} else if (req->result && !(poll->events & EPOLLONESHOT)) {
+			int ret;
+
+			/* multishot async poll, issue until it would block */
+			io_tw_lock(ctx, locked);
+			ret = io_issue_sqe(req, IO_URING_F_NONBLOCK |
+						IO_URING_F_MULTISHOT);
+			if (ret == IO_MULTISHOT_STOP)
+				return 0;
+			if (ret)
+				return ret;
+			/* poll again if we get restarted */
+			req->result = 0;
 		} else if (req->result) {
+			/* armed as oneshot after all, issue it only once */
+			req->flags &= ~REQ_F_APOLL_MULTISHOT;
 			return 0;
 		}
 
@@ -5563,7 +6075,7 @@ static void io_poll_task_func(struct io_kiocb *req, bool *locked)
 	struct io_ring_ctx *ctx = req->ctx;
 	int ret;
 
-	ret = io_poll_check_events(req);
+	ret = io_poll_check_events(req, locked);
 	if (ret > 0)
 		return;
 
@@ -5588,7 +6100,7 @@ static void io_apoll_task_func(struct io_kiocb *req, bool *locked)
 	struct io_ring_ctx *ctx = req->ctx;
 	int ret;
 
-	ret = io_poll_check_events(req);
+	ret = io_poll_check_events(req, locked);
 	if (ret > 0)
 		return;
 
@@ -5597,10 +6109,12 @@ static void io_apoll_task_func(struct io_kiocb *req, bool *locked)
 	hash_del(&req->hash_node);
 	spin_unlock(&ctx->completion_lock);
 
-	if (!ret)
-		io_req_task_submit(req, locked);
-	else
+	if (ret)
 		io_req_complete_failed(req, ret);
+	else if (req->flags & REQ_F_APOLL_MULTISHOT)
+		io_req_complete_post(req, req->result, req->cflags);
+	else
+		io_req_task_submit(req, locked);
 }
 
 static void __io_poll_execute(struct io_kiocb *req, int mask)
@@ -5809,13 +6323,15 @@ static int io_arm_poll_handler(struct io_kiocb *req)
 	struct io_ring_ctx *ctx = req->ctx;
 	struct async_poll *apoll;
 	struct io_poll_table ipt;
-	__poll_t mask = EPOLLONESHOT | POLLERR | POLLPRI;
+	__poll_t mask = POLLERR | POLLPRI;
 	int ret;
 
 	if (!def->pollin && !def->pollout)
 		return IO_APOLL_ABORTED;
 	if (!file_can_poll(req->file) || (req->flags & REQ_F_POLLED))
 		return IO_APOLL_ABORTED;
+	if (!(req->flags & REQ_F_APOLL_MULTISHOT))
+		mask |= EPOLLONESHOT;
 
 	if (def->pollin) {
 		mask |= POLLIN | POLLRDNORM;
@@ -6395,6 +6911,9 @@ static int io_try_cancel_userdata(struct io_kiocb *req, u64 sqe_addr)
 
 	spin_lock(&ctx->completion_lock);
 	ret = io_poll_cancel(ctx, sqe_addr, false);
+	if (ret != -ENOENT)
+		goto out;
+	ret = io_fence_cancel(ctx, sqe_addr);
 	if (ret != -ENOENT)
 		goto out;
 
@@ -6568,6 +7087,10 @@ static int io_req_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		return io_symlinkat_prep(req, sqe);
 	case IORING_OP_LINKAT:
 		return io_linkat_prep(req, sqe);
+	case IORING_OP_SEND_ZC:
+		return io_send_zc_prep(req, sqe);
+	case IORING_OP_FENCE_WAIT:
+		return io_fence_wait_prep(req, sqe);
 	}
 
 	printk_once(KERN_WARNING "io_uring: unhandled opcode %d\n",
@@ -6709,6 +7232,9 @@ static void io_clean_op(struct io_kiocb *req)
 			putname(req->hardlink.oldpath);
 			putname(req->hardlink.newpath);
 			break;
+		case IORING_OP_SEND_ZC:
+			io_notif_free(req->sr_msg.notif);
+			break;
 		}
 	}
 	if ((req->flags & REQ_F_POLLED) && req->apoll) {
@@ -6851,6 +7377,12 @@ static int io_issue_sqe(struct io_kiocb *req, unsigned int issue_flags)
 	case IORING_OP_LINKAT:
 		ret = io_linkat(req, issue_flags);
 		break;
+	case IORING_OP_SEND_ZC:
+		ret = io_send_zc(req, issue_flags);
+		break;
+	case IORING_OP_FENCE_WAIT:
+		ret = io_fence_wait(req, issue_flags);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -6912,6 +7444,16 @@ static void io_wq_submit_work(struct io_wq_work *work)
 		}
 	}
 
+	/* multishot is driven by poll, a blocking issue would never return */
+	if (req->flags & REQ_F_APOLL_MULTISHOT) {
+		if (file_can_poll(req->file)) {
+			needs_poll = true;
+			issue_flags |= IO_URING_F_NONBLOCK;
+		} else {
+			req->flags &= ~REQ_F_APOLL_MULTISHOT;
+		}
+	}
+
 	do {
 		ret = io_issue_sqe(req, issue_flags);
 		if (ret != -EAGAIN)
@@ -6931,6 +7473,7 @@ static void io_wq_submit_work(struct io_wq_work *work)
 		/* aborted or ready, in either case retry blocking */
 		needs_poll = false;
 		issue_flags &= ~IO_URING_F_NONBLOCK;
+		req->flags &= ~REQ_F_APOLL_MULTISHOT;
 	} while (1);
 
 	/* avoid locking problems by failing it from a clean context */
@@ -7494,6 +8037,7 @@ static inline void io_ring_clear_wakeup_flag(struct io_ring_ctx *ctx)
 static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 {
 	unsigned int to_submit;
+	u64 start;
 	int ret = 0;
 
 	to_submit = io_sqring_entries(ctx);
@@ -7504,6 +8048,7 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
 
+		start = local_clock();
 		if (ctx->sq_creds != current_cred())
 			creds = override_creds(ctx->sq_creds);
 
@@ -7524,11 +8069,45 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 			wake_up(&ctx->sqo_sq_wait);
 		if (creds)
 			revert_creds(creds);
+		if (ret > 0)
+			ctx->sq_submitted += ret;
+		ctx->sq_time += local_clock() - start;
 	}
 
 	return ret;
 }
 
+/*
+ * Spin for a few times the usual gap between bursts of work before going to
+ * sleep, bounded by the sq_thread_idle the rings asked for. Steady streams
+ * keep the thread spinning, while a ring that went quiet doesn't hold the CPU
+ * for the full idle period.
+ */
+static unsigned long io_sqd_idle_timeout(struct io_sq_data *sqd)
+{
+	unsigned long idle = sqd->sq_thread_idle;
+
+	if (sqd->sq_idle_gap)
+		idle = clamp((sqd->sq_idle_gap >> 3) * 4,
+			     max(idle / 8, 1UL), idle);
+	return jiffies + idle;
+}
+
+static void io_sqd_note_active(struct io_sq_data *sqd)
+{
+	unsigned long gap = jiffies - sqd->sq_last_active;
+
+	/* only idle periods count, not back to back iterations */
+	if (gap) {
+		gap = min_t(unsigned long, gap, sqd->sq_thread_idle);
+		if (!sqd->sq_idle_gap)
+			sqd->sq_idle_gap = gap << 3;
+		else
+			sqd->sq_idle_gap += gap - (sqd->sq_idle_gap >> 3);
+	}
+	sqd->sq_last_active = jiffies;
+}
+
 static __cold void io_sqd_update_thread_idle(struct io_sq_data *sqd)
 {
 	struct io_ring_ctx *ctx;
@@ -7581,7 +8160,7 @@ static int io_sq_thread(void *data)
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
 				break;
-			timeout = jiffies + sqd->sq_thread_idle;
+			timeout = io_sqd_idle_timeout(sqd);
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
@@ -7591,13 +8170,18 @@ static int io_sq_thread(void *data)
 			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
 		}
+		/* start with the next ring next time around, for fairness */
+		if (cap_entries)
+			list_rotate_left(&sqd->ctx_list);
 		if (io_run_task_work())
 			sqt_spin = true;
 
 		if (sqt_spin || !time_after(jiffies, timeout)) {
 			cond_resched();
-			if (sqt_spin)
-				timeout = jiffies + sqd->sq_thread_idle;
+			if (sqt_spin) {
+				io_sqd_note_active(sqd);
+				timeout = io_sqd_idle_timeout(sqd);
+			}
 			continue;
 		}
 
@@ -7629,7 +8213,7 @@ static int io_sq_thread(void *data)
 		}
 
 		finish_wait(&sqd->wait, &wait);
-		timeout = jiffies + sqd->sq_thread_idle;
+		timeout = io_sqd_idle_timeout(sqd);
 	}
 
 	io_uring_cancel_generic(true, sqd);
@@ -9384,13 +9968,27 @@ static int io_eventfd_unregister(struct io_ring_ctx *ctx)
 	return -ENXIO;
 }
 
+static void io_free_buf_ring(struct io_buf_ring *bl)
+{
+	vunmap(bl->br);
+	unpin_user_pages(bl->pages, bl->nr_pages);
+	kvfree(bl->pages);
+	kfree(bl);
+}
+
 static void io_destroy_buffers(struct io_ring_ctx *ctx)
 {
+	struct io_buf_ring *bl;
 	struct io_buffer *buf;
 	unsigned long index;
 
 	xa_for_each(&ctx->io_buffers, index, buf)
 		__io_remove_buffers(ctx, buf, index, -1U);
+
+	xa_for_each(&ctx->io_buf_rings, index, bl) {
+		xa_erase(&ctx->io_buf_rings, index);
+		io_free_buf_ring(bl);
+	}
 }
 
 static void io_req_caches_free(struct io_ring_ctx *ctx)
@@ -9455,6 +10053,7 @@ static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 		io_rsrc_node_destroy(ctx->rsrc_backup_node);
 	flush_delayed_work(&ctx->rsrc_put_work);
 	flush_delayed_work(&ctx->fallback_work);
+	flush_work(&ctx->notif_work);
 
 	WARN_ON_ONCE(!list_empty(&ctx->rsrc_ref_list));
 	WARN_ON_ONCE(!llist_empty(&ctx->rsrc_put_llist));
@@ -9662,6 +10261,7 @@ static __cold void io_ring_ctx_wait_and_kill(struct io_ring_ctx *ctx)
 
 	io_kill_timeouts(ctx, NULL, true);
 	io_poll_remove_all(ctx, NULL, true);
+	io_fence_remove_all(ctx, NULL, true);
 
 	/* if we failed setting up the ctx, we might not have any rings */
 	io_iopoll_try_reap_events(ctx);
@@ -9783,6 +10383,7 @@ static __cold void io_uring_try_cancel_requests(struct io_ring_ctx *ctx,
 
 		ret |= io_cancel_defer_files(ctx, task, cancel_all);
 		ret |= io_poll_remove_all(ctx, task, cancel_all);
+		ret |= io_fence_remove_all(ctx, task, cancel_all);
 		ret |= io_kill_timeouts(ctx, task, cancel_all);
 		if (task)
 			ret |= io_run_task_work();
@@ -10291,6 +10892,14 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 	seq_printf(m, "SqThread:\t%d\n", sq ? task_pid_nr(sq->thread) : -1);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq ? task_cpu(sq->thread) : -1);
+	if (sq) {
+		seq_printf(m, "SqThreadTime:\t%llu\n",
+			   div_u64(READ_ONCE(ctx->sq_time), NSEC_PER_USEC));
+		seq_printf(m, "SqThreadSubmitted:\t%lu\n",
+			   READ_ONCE(ctx->sq_submitted));
+		seq_printf(m, "SqThreadIdle:\t%u\n",
+			   jiffies_to_msecs(io_sqd_idle_timeout(sq) - jiffies));
+	}
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(ctx, i);
@@ -10315,6 +10924,19 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 		xa_for_each(&ctx->personalities, index, cred)
 			io_uring_show_cred(m, index, cred);
 	}
+	if (has_lock && !list_empty(&ctx->tctx_list)) {
+		struct io_tctx_node *node;
+
+		seq_puts(m, "IoWq:\n");
+		list_for_each_entry(node, &ctx->tctx_list, ctx_node) {
+			struct io_uring_task *tctx = node->task->io_uring;
+
+			if (!tctx || !tctx->io_wq)
+				continue;
+			seq_printf(m, "  pid %d:\n", task_pid_nr(node->task));
+			io_wq_show_fdinfo(tctx->io_wq, m);
+		}
+	}
 	if (has_lock)
 		mutex_unlock(&ctx->uring_lock);
 
@@ -10869,6 +11491,92 @@ static __cold int io_unregister_iowq_aff(struct io_ring_ctx *ctx)
 	return io_wq_cpu_affinity(tctx->io_wq, NULL);
 }
 
+static __cold int io_register_pbuf_ring(struct io_ring_ctx *ctx,
+					void __user *arg)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_uring_buf_reg reg;
+	struct io_buf_ring *bl;
+	struct page **pages;
+	int nr_pages, pret, ret;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+		return -EINVAL;
+	if (!reg.ring_addr)
+		return -EFAULT;
+	if (reg.ring_addr & ~PAGE_MASK)
+		return -EINVAL;
+	if (!is_power_of_2(reg.ring_entries) || reg.ring_entries > 32768)
+		return -EINVAL;
+	if (xa_load(&ctx->io_buffers, reg.bgid) ||
+	    xa_load(&ctx->io_buf_rings, reg.bgid))
+		return -EEXIST;
+
+	bl = kzalloc(sizeof(*bl), GFP_KERNEL_ACCOUNT);
+	if (!bl)
+		return -ENOMEM;
+
+	nr_pages = DIV_ROUND_UP(reg.ring_entries * sizeof(struct io_uring_buf),
+				PAGE_SIZE);
+	ret = -ENOMEM;
+	pages = kvmalloc_array(nr_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		goto err_free;
+
+	pret = pin_user_pages_fast(reg.ring_addr, nr_pages,
+				   FOLL_WRITE | FOLL_LONGTERM, pages);
+	if (pret != nr_pages) {
+		if (pret > 0)
+			unpin_user_pages(pages, pret);
+		ret = pret < 0 ? pret : -EFAULT;
+		goto err_pages;
+	}
+
+	bl->br = vmap(pages, nr_pages, VM_MAP, PAGE_KERNEL);
+	if (!bl->br) {
+		unpin_user_pages(pages, nr_pages);
+		goto err_pages;
+	}
+	bl->pages = pages;
+	bl->nr_pages = nr_pages;
+	bl->mask = reg.ring_entries - 1;
+
+	ret = xa_insert(&ctx->io_buf_rings, reg.bgid, bl, GFP_KERNEL_ACCOUNT);
+	if (ret)
+		io_free_buf_ring(bl);
+	return ret;
+
+err_pages:
+	kvfree(pages);
+err_free:
+	kfree(bl);
+	return ret;
+}
+
+static __cold int io_unregister_pbuf_ring(struct io_ring_ctx *ctx,
+					  void __user *arg)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_uring_buf_reg reg;
+	struct io_buf_ring *bl;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.ring_addr || reg.ring_entries || reg.pad || reg.resv[0] ||
+	    reg.resv[1] || reg.resv[2])
+		return -EINVAL;
+
+	bl = xa_erase(&ctx->io_buf_rings, reg.bgid);
+	if (!bl)
+		return -ENOENT;
+
+	/* selected buffers were copied out, nobody references the ring */
+	io_free_buf_ring(bl);
+	return 0;
+}
+
 static __cold int io_register_iowq_max_workers(struct io_ring_ctx *ctx,
 					       void __user *arg)
 	__must_hold(&ctx->uring_lock)
@@ -10970,6 +11678,8 @@ static bool io_register_op_must_quiesce(int op)
 	case IORING_REGISTER_IOWQ_AFF:
 	case IORING_UNREGISTER_IOWQ_AFF:
 	case IORING_REGISTER_IOWQ_MAX_WORKERS:
+	case IORING_REGISTER_PBUF_RING:
+	case IORING_UNREGISTER_PBUF_RING:
 		return false;
 	default:
 		return true;
@@ -11136,6 +11846,18 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_register_iowq_max_workers(ctx, arg);
 		break;
+	case IORING_REGISTER_PBUF_RING:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_pbuf_ring(ctx, arg);
+		break;
+	case IORING_UNREGISTER_PBUF_RING:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_unregister_pbuf_ring(ctx, arg);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
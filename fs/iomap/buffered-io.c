@@ -23,13 +23,16 @@
 
 /*
  * Structure allocated for each folio when block size < folio size
- * to track sub-folio uptodate status and I/O completions.
+ * to track sub-folio uptodate and dirty status and I/O completions.
+ *
+ * The state bitmap holds the uptodate bits of all blocks first, followed by
+ * their dirty bits.
  */
 struct iomap_page {
 	atomic_t		read_bytes_pending;
 	atomic_t		write_bytes_pending;
-	spinlock_t		uptodate_lock;
-	unsigned long		uptodate[];
+	spinlock_t		state_lock;
+	unsigned long		state[];
 };
 
 static inline struct iomap_page *to_iomap_page(struct folio *folio)
@@ -41,6 +44,51 @@ static inline struct iomap_page *to_iomap_page(struct folio *folio)
 
 static struct bio_set iomap_ioend_bioset;
 
+static inline bool iomap_block_is_uptodate(struct iomap_page *iop,
+		unsigned int block)
+{
+	return test_bit(block, iop->state);
+}
+
+static inline bool iomap_block_is_dirty(struct folio *folio,
+		struct iomap_page *iop, unsigned int block)
+{
+	struct inode *inode = folio->mapping->host;
+
+	return test_bit(block + i_blocks_per_folio(inode, folio), iop->state);
+}
+
+static void iomap_iop_set_range_dirty(struct folio *folio,
+		struct iomap_page *iop, size_t off, size_t len, bool dirty)
+{
+	struct inode *inode = folio->mapping->host;
+	unsigned int nr_blocks = i_blocks_per_folio(inode, folio);
+	unsigned int first = off >> inode->i_blkbits;
+	unsigned int last = (off + len - 1) >> inode->i_blkbits;
+	unsigned long flags;
+
+	spin_lock_irqsave(&iop->state_lock, flags);
+	if (dirty)
+		bitmap_set(iop->state, nr_blocks + first, last - first + 1);
+	else
+		bitmap_clear(iop->state, nr_blocks + first, last - first + 1);
+	spin_unlock_irqrestore(&iop->state_lock, flags);
+}
+
+static void iomap_set_range_dirty(struct folio *folio, struct iomap_page *iop,
+		size_t off, size_t len)
+{
+	if (iop && len)
+		iomap_iop_set_range_dirty(folio, iop, off, len, true);
+}
+
+static void iomap_clear_range_dirty(struct folio *folio,
+		struct iomap_page *iop, size_t off, size_t len)
+{
+	if (iop && len)
+		iomap_iop_set_range_dirty(folio, iop, off, len, false);
+}
+
 static struct iomap_page *
 iomap_page_create(struct inode *inode, struct folio *folio)
 {
@@ -50,11 +98,14 @@ iomap_page_create(struct inode *inode, struct folio *folio)
 	if (iop || nr_blocks <= 1)
 		return iop;
 
-	iop = kzalloc(struct_size(iop, uptodate, BITS_TO_LONGS(nr_blocks)),
+	iop = kzalloc(struct_size(iop, state, BITS_TO_LONGS(2 * nr_blocks)),
 			GFP_NOFS | __GFP_NOFAIL);
-	spin_lock_init(&iop->uptodate_lock);
+	spin_lock_init(&iop->state_lock);
 	if (folio_test_uptodate(folio))
-		bitmap_fill(iop->uptodate, nr_blocks);
+		bitmap_set(iop->state, 0, nr_blocks);
+	/* without any per-block state all of a dirty folio is dirty */
+	if (folio_test_dirty(folio))
+		bitmap_set(iop->state, nr_blocks, nr_blocks);
 	folio_attach_private(folio, iop);
 	return iop;
 }
@@ -69,7 +120,7 @@ static void iomap_page_release(struct folio *folio)
 		return;
 	WARN_ON_ONCE(atomic_read(&iop->read_bytes_pending));
 	WARN_ON_ONCE(atomic_read(&iop->write_bytes_pending));
-	WARN_ON_ONCE(bitmap_full(iop->uptodate, nr_blocks) !=
+	WARN_ON_ONCE(bitmap_full(iop->state, nr_blocks) !=
 			folio_test_uptodate(folio));
 	kfree(iop);
 }
@@ -100,7 +151,7 @@ static void iomap_adjust_read_range(struct inode *inode, struct folio *folio,
 
 		/* move forward for each leading block marked uptodate */
 		for (i = first; i <= last; i++) {
-			if (!test_bit(i, iop->uptodate))
+			if (!iomap_block_is_uptodate(iop, i))
 				break;
 			*pos += block_size;
 			poff += block_size;
@@ -110,7 +161,7 @@ static void iomap_adjust_read_range(struct inode *inode, struct folio *folio,
 
 		/* truncate len if we find any trailing uptodate block(s) */
 		for ( ; i <= last; i++) {
-			if (test_bit(i, iop->uptodate)) {
+			if (iomap_block_is_uptodate(iop, i)) {
 				plen -= (last - i + 1) * block_size;
 				last = i - 1;
 				break;
@@ -142,11 +193,11 @@ static void iomap_iop_set_range_uptodate(struct folio *folio,
 	unsigned last = (off + len - 1) >> inode->i_blkbits;
 	unsigned long flags;
 
-	spin_lock_irqsave(&iop->uptodate_lock, flags);
-	bitmap_set(iop->uptodate, first, last - first + 1);
-	if (bitmap_full(iop->uptodate, i_blocks_per_folio(inode, folio)))
+	spin_lock_irqsave(&iop->state_lock, flags);
+	bitmap_set(iop->state, first, last - first + 1);
+	if (bitmap_full(iop->state, i_blocks_per_folio(inode, folio)))
 		folio_mark_uptodate(folio);
-	spin_unlock_irqrestore(&iop->uptodate_lock, flags);
+	spin_unlock_irqrestore(&iop->state_lock, flags);
 }
 
 static void iomap_set_range_uptodate(struct folio *folio,
@@ -447,7 +498,7 @@ iomap_is_partially_uptodate(struct page *page, unsigned long from,
 
 	if (iop) {
 		for (i = first; i <= last; i++)
-			if (!test_bit(i, iop->uptodate))
+			if (!iomap_block_is_uptodate(iop, i))
 				return 0;
 		return 1;
 	}
@@ -456,6 +507,20 @@ iomap_is_partially_uptodate(struct page *page, unsigned long from,
 }
 EXPORT_SYMBOL_GPL(iomap_is_partially_uptodate);
 
+/*
+ * Dirtying through anything but a buffered write (e.g. a shared mapping)
+ * doesn't say which blocks changed, so all of them have to be written back.
+ */
+int iomap_set_page_dirty(struct page *page)
+{
+	struct folio *folio = page_folio(page);
+
+	iomap_set_range_dirty(folio, to_iomap_page(folio), 0,
+			folio_size(folio));
+	return __set_page_dirty_nobuffers(page);
+}
+EXPORT_SYMBOL_GPL(iomap_set_page_dirty);
+
 int
 iomap_releasepage(struct page *page, gfp_t gfp_mask)
 {
@@ -625,6 +690,7 @@ static int iomap_write_begin(const struct iomap_iter *iter, loff_t pos,
 
 	if (!mapping_large_folio_support(iter->inode->i_mapping))
 		len = min_t(size_t, len, PAGE_SIZE - offset_in_page(pos));
+	fgp |= fgp_set_order(len);
 
 	if (page_ops && page_ops->page_prepare) {
 		status = page_ops->page_prepare(iter->inode, pos, len);
@@ -685,6 +751,7 @@ static size_t __iomap_write_end(struct inode *inode, loff_t pos, size_t len,
 	if (unlikely(copied < len && !folio_test_uptodate(folio)))
 		return 0;
 	iomap_set_range_uptodate(folio, iop, offset_in_folio(folio, pos), len);
+	iomap_set_range_dirty(folio, iop, offset_in_folio(folio, pos), copied);
 	filemap_dirty_folio(inode->i_mapping, folio);
 	return copied;
 }
@@ -747,23 +814,51 @@ static size_t iomap_write_end(struct iomap_iter *iter, loff_t pos, size_t len,
 	return ret;
 }
 
+/*
+ * Copy from a user buffer into a folio of any size a page at a time, the
+ * pages of a large folio aren't necessarily mapped contiguously.
+ */
+static size_t iomap_copy_from_iter(struct folio *folio, size_t offset,
+		size_t bytes, struct iov_iter *i)
+{
+	size_t copied = 0;
+
+	do {
+		struct page *page = folio_page(folio, offset >> PAGE_SHIFT);
+		size_t poff = offset_in_page(offset);
+		size_t n = min_t(size_t, bytes - copied, PAGE_SIZE - poff);
+		size_t ret;
+
+		ret = copy_page_from_iter_atomic(page, poff, n, i);
+		copied += ret;
+		offset += ret;
+		if (ret < n)
+			break;
+	} while (copied < bytes);
+
+	return copied;
+}
+
 static loff_t iomap_write_iter(struct iomap_iter *iter, struct iov_iter *i)
 {
 	loff_t length = iomap_length(iter);
+	size_t chunk = PAGE_SIZE << MAX_PAGECACHE_ORDER;
 	loff_t pos = iter->pos;
 	ssize_t written = 0;
 	long status = 0;
 
+	/* try for the largest folio that fits the write */
+	if (!mapping_large_folio_support(iter->inode->i_mapping))
+		chunk = PAGE_SIZE;
+
 	do {
 		struct folio *folio;
-		struct page *page;
-		unsigned long offset;	/* Offset into pagecache page */
-		unsigned long bytes;	/* Bytes to write to page */
+		size_t offset;		/* Offset into folio */
+		size_t bytes;		/* Bytes to write to folio */
 		size_t copied;		/* Bytes copied from user */
 
-		offset = offset_in_page(pos);
-		bytes = min_t(unsigned long, PAGE_SIZE - offset,
-						iov_iter_count(i));
+		offset = pos & (chunk - 1);
+		bytes = min(chunk - offset, iov_iter_count(i));
 again:
 		if (bytes > length)
 			bytes = length;
@@ -783,11 +878,14 @@ static loff_t iomap_write_iter(struct iomap_iter *iter, struct iov_iter *i)
 		if (unlikely(status))
 			break;
 
-		page = folio_file_page(folio, pos >> PAGE_SHIFT);
+		offset = offset_in_folio(folio, pos);
+		if (bytes > folio_size(folio) - offset)
+			bytes = folio_size(folio) - offset;
+
 		if (mapping_writably_mapped(iter->inode->i_mapping))
-			flush_dcache_page(page);
+			flush_dcache_folio(folio);
 
-		copied = copy_page_from_iter_atomic(page, offset, bytes, i);
+		copied = iomap_copy_from_iter(folio, offset, bytes, i);
 
 		status = iomap_write_end(iter, pos, bytes, copied, folio);
 
@@ -1305,7 +1403,7 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 		struct writeback_control *wbc, struct inode *inode,
 		struct folio *folio, u64 end_pos)
 {
-	struct iomap_page *iop = iomap_page_create(inode, folio);
+	struct iomap_page *iop = to_iomap_page(folio);
 	struct iomap_ioend *ioend, *next;
 	unsigned len = i_blocksize(inode);
 	unsigned nblocks = i_blocks_per_folio(inode, folio);
@@ -1313,15 +1411,25 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	int error = 0, count = 0, i;
 	LIST_HEAD(submit_list);
 
+	/*
+	 * The dirty flag of the folio has been cleared for I/O already, so a
+	 * new iop doesn't know which blocks are dirty.  Write all of them.
+	 */
+	if (!iop && nblocks > 1) {
+		iop = iomap_page_create(inode, folio);
+		iomap_set_range_dirty(folio, iop, 0, end_pos - pos);
+	}
+
 	WARN_ON_ONCE(iop && atomic_read(&iop->write_bytes_pending) != 0);
 
 	/*
 	 * Walk through the folio to find areas to write back. If we
 	 * run off the end of the current map or find the current map
-	 * invalid, grab a new one.
+	 * invalid, grab a new one.  Only dirty blocks are written, so
+	 * overwriting part of a large folio doesn't rewrite all of it.
 	 */
 	for (i = 0; i < nblocks && pos < end_pos; i++, pos += len) {
-		if (iop && !test_bit(i, iop->uptodate))
+		if (iop && !iomap_block_is_dirty(folio, iop, i))
 			continue;
 
 		error = wpc->ops->map_blocks(wpc, inode, pos);
@@ -1341,6 +1449,13 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	WARN_ON_ONCE(folio_test_writeback(folio));
 	WARN_ON_ONCE(folio_test_dirty(folio));
 
+	/*
+	 * Everything up to end_pos has been handed to the ioends above, or
+	 * failed and is being dealt with by ->discard_folio.  Either way it
+	 * is not dirty anymore, blocks beyond EOF stay as they are.
+	 */
+	iomap_clear_range_dirty(folio, iop, 0, end_pos - folio_pos(folio));
+
 	/*
 	 * We cannot cancel the ioend directly here on error.  We may have
 	 * already set other pages under writeback and hence we have to run I/O
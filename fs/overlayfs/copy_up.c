@@ -18,10 +18,19 @@
 #include <linux/namei.h>
 #include <linux/fdtable.h>
 #include <linux/ratelimit.h>
+#include <linux/seq_file.h>
 #include <linux/exportfs.h>
+#include <linux/workqueue.h>
 #include "overlayfs.h"
 
 #define OVL_COPY_UP_CHUNK_SIZE (1 << 20)
+/* minimum amount of data for each thread of a parallel data copy up */
+#define OVL_COPY_UP_PARALLEL_MIN (16 * OVL_COPY_UP_CHUNK_SIZE)
+
+static unsigned int ovl_copy_up_threads = 4;
+module_param_named(copy_up_threads, ovl_copy_up_threads, uint, 0644);
+MODULE_PARM_DESC(copy_up_threads,
+		 "Maximum number of threads copying up the data of a large file that can't be cloned");
 
 static int ovl_ccup_set(const char *buf, const struct kernel_param *param)
 {
@@ -183,43 +192,29 @@ static int ovl_copy_fileattr(struct inode *inode, struct path *old,
 	return ovl_real_fileattr_set(new, &newfa);
 }
 
-static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
-			    struct path *new, loff_t len)
-{
+struct ovl_copy_up_range {
+	struct work_struct work;
 	struct file *old_file;
 	struct file *new_file;
-	loff_t old_pos = 0;
-	loff_t new_pos = 0;
-	loff_t cloned;
+	loff_t pos;
+	loff_t len;
+	bool skip_hole;
+	/* set when any of the ranges failed, the others give up then */
+	bool *stop;
+	int error;
+	struct completion done;
+};
+
+static int ovl_copy_up_data_range(struct ovl_copy_up_range *r)
+{
+	loff_t old_pos = r->pos;
+	loff_t new_pos = r->pos;
+	loff_t len = r->len;
 	loff_t data_pos = -1;
 	loff_t hole_len;
-	bool skip_hole = false;
+	bool skip_hole = r->skip_hole;
 	int error = 0;
 
-	if (len == 0)
-		return 0;
-
-	old_file = ovl_path_open(old, O_LARGEFILE | O_RDONLY);
-	if (IS_ERR(old_file))
-		return PTR_ERR(old_file);
-
-	new_file = ovl_path_open(new, O_LARGEFILE | O_WRONLY);
-	if (IS_ERR(new_file)) {
-		error = PTR_ERR(new_file);
-		goto out_fput;
-	}
-
-	/* Try to use clone_file_range to clone up within the same fs */
-	cloned = do_clone_file_range(old_file, 0, new_file, 0, len, 0);
-	if (cloned == len)
-		goto out;
-	/* Couldn't clone, so now we try to copy the data */
-
-	/* Check if lower fs supports seek operation */
-	if (old_file->f_mode & FMODE_LSEEK &&
-	    old_file->f_op->llseek)
-		skip_hole = true;
-
 	while (len) {
 		size_t this_len = OVL_COPY_UP_CHUNK_SIZE;
 		long bytes;
@@ -227,7 +222,8 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 		if (len < this_len)
 			this_len = len;
 
-		if (signal_pending_state(TASK_KILLABLE, current)) {
+		if (READ_ONCE(*r->stop) ||
+		    signal_pending_state(TASK_KILLABLE, current)) {
 			error = -EINTR;
 			break;
 		}
@@ -249,9 +245,12 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 		 */
 
 		if (skip_hole && data_pos < old_pos) {
-			data_pos = vfs_llseek(old_file, old_pos, SEEK_DATA);
+			data_pos = vfs_llseek(r->old_file, old_pos, SEEK_DATA);
 			if (data_pos > old_pos) {
 				hole_len = data_pos - old_pos;
+				/* the hole may extend into the next range */
+				if (hole_len >= len)
+					break;
 				len -= hole_len;
 				old_pos = new_pos = data_pos;
 				continue;
@@ -262,8 +261,8 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 			}
 		}
 
-		bytes = do_splice_direct(old_file, &old_pos,
-					 new_file, &new_pos,
+		bytes = do_splice_direct(r->old_file, &old_pos,
+					 r->new_file, &new_pos,
 					 this_len, SPLICE_F_MOVE);
 		if (bytes <= 0) {
 			error = bytes;
@@ -273,9 +272,124 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 
 		len -= bytes;
 	}
+
+	if (error)
+		WRITE_ONCE(*r->stop, true);
+	return error;
+}
+
+static void ovl_copy_up_range_work(struct work_struct *work)
+{
+	struct ovl_copy_up_range *r =
+		container_of(work, struct ovl_copy_up_range, work);
+	const struct cred *old_cred;
+
+	/* both files were opened with the copy up creds */
+	old_cred = override_creds(r->new_file->f_cred);
+	r->error = ovl_copy_up_data_range(r);
+	revert_creds(old_cred);
+	complete(&r->done);
+}
+
+/*
+ * Splice the data of a large file in several ranges at once, one in the
+ * caller and the others in workqueue context.  Fall back to a single range
+ * if that's not worth it or we can't allocate the ranges.
+ */
+static int ovl_copy_up_data_ranges(struct file *old_file,
+				   struct file *new_file, loff_t len,
+				   bool skip_hole)
+{
+	unsigned int nr = min_t(loff_t, READ_ONCE(ovl_copy_up_threads),
+				div64_s64(len, OVL_COPY_UP_PARALLEL_MIN));
+	struct ovl_copy_up_range one, *r = &one;
+	loff_t per_range, pos = 0;
+	bool stop = false;
+	unsigned int i;
+	int error;
+
+	if (nr > 1)
+		r = kcalloc(nr, sizeof(*r), GFP_KERNEL);
+	if (!r || nr <= 1) {
+		r = &one;
+		nr = 1;
+	}
+
+	per_range = round_up(div_u64(len, nr), OVL_COPY_UP_CHUNK_SIZE);
+	for (i = 0; i < nr; i++) {
+		r[i].old_file = old_file;
+		r[i].new_file = new_file;
+		r[i].pos = pos;
+		r[i].len = i == nr - 1 ? len - pos : per_range;
+		r[i].skip_hole = skip_hole;
+		r[i].stop = &stop;
+		pos += r[i].len;
+	}
+
+	for (i = 1; i < nr; i++) {
+		INIT_WORK(&r[i].work, ovl_copy_up_range_work);
+		init_completion(&r[i].done);
+		queue_work(system_unbound_wq, &r[i].work);
+	}
+
+	error = ovl_copy_up_data_range(&r[0]);
+
+	for (i = 1; i < nr; i++) {
+		wait_for_completion(&r[i].done);
+		if (r[i].error && !error)
+			error = r[i].error;
+	}
+
+	if (r != &one)
+		kfree(r);
+	return error;
+}
+
+static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
+			    struct path *new, loff_t len)
+{
+	struct ovl_copy_up_stats *stats = &ofs->copy_up_stats;
+	struct file *old_file;
+	struct file *new_file;
+	ktime_t start = ktime_get();
+	loff_t cloned;
+	bool skip_hole = false;
+	int error = 0;
+
+	if (len == 0)
+		return 0;
+
+	old_file = ovl_path_open(old, O_LARGEFILE | O_RDONLY);
+	if (IS_ERR(old_file))
+		return PTR_ERR(old_file);
+
+	new_file = ovl_path_open(new, O_LARGEFILE | O_WRONLY);
+	if (IS_ERR(new_file)) {
+		error = PTR_ERR(new_file);
+		goto out_fput;
+	}
+
+	/* Try to use clone_file_range to clone up within the same fs */
+	cloned = do_clone_file_range(old_file, 0, new_file, 0, len, 0);
+	if (cloned == len)
+		goto out;
+	/* Couldn't clone, so now we try to copy the data */
+
+	/* Check if lower fs supports seek operation */
+	if (old_file->f_mode & FMODE_LSEEK &&
+	    old_file->f_op->llseek)
+		skip_hole = true;
+
+	error = ovl_copy_up_data_ranges(old_file, new_file, len, skip_hole);
 out:
 	if (!error && ovl_should_sync(ofs))
 		error = vfs_fsync(new_file, 0);
+	if (!error) {
+		atomic64_inc(&stats->data_count);
+		atomic64_add(len, &stats->data_bytes);
+		atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+			     &stats->data_time_ns);
+	}
 	fput(new_file);
 out_fput:
 	fput(old_file);
@@ -929,10 +1043,50 @@ static int ovl_copy_up_meta_inode_data(struct ovl_copy_up_ctx *c)
 	return err;
 }
 
+static void ovl_copy_up_account(struct ovl_fs *ofs, ktime_t start)
+{
+	struct ovl_copy_up_stats *stats = &ofs->copy_up_stats;
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	s64 max = atomic64_read(&stats->max_ns);
+
+	atomic64_inc(&stats->count);
+	atomic64_add(ns, &stats->time_ns);
+	while (ns > max) {
+		s64 old = atomic64_cmpxchg(&stats->max_ns, max, ns);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+/*
+ * Shown after the mount in /proc/<pid>/mountstats: how many copy ups there
+ * were and how long they took, and how much of that went into copying data.
+ */
+int ovl_show_stats(struct seq_file *m, struct dentry *dentry)
+{
+	struct ovl_copy_up_stats *stats = &OVL_FS(dentry->d_sb)->copy_up_stats;
+	u64 count = atomic64_read(&stats->count);
+	u64 data_count = atomic64_read(&stats->data_count);
+
+	seq_printf(m, "copy_ups=%llu copy_up_avg_us=%llu copy_up_max_us=%llu",
+		   count,
+		   count ? div64_u64(atomic64_read(&stats->time_ns),
+				     count * NSEC_PER_USEC) : 0,
+		   div_u64(atomic64_read(&stats->max_ns), NSEC_PER_USEC));
+	seq_printf(m, " data_copy_ups=%llu data_copy_up_bytes=%llu data_copy_up_avg_us=%llu",
+		   data_count, (u64)atomic64_read(&stats->data_bytes),
+		   data_count ? div64_u64(atomic64_read(&stats->data_time_ns),
+					  data_count * NSEC_PER_USEC) : 0);
+	return 0;
+}
+
 static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 			   int flags)
 {
 	int err;
+	ktime_t start;
 	DEFINE_DELAYED_CALL(done);
 	struct path parentpath;
 	struct ovl_copy_up_ctx ctx = {
@@ -980,12 +1134,15 @@ static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 		if (err > 0)
 			err = 0;
 	} else {
+		start = ktime_get();
 		if (!ovl_dentry_upper(dentry))
 			err = ovl_do_copy_up(&ctx);
 		if (!err && parent && !ovl_dentry_has_upper_alias(dentry))
 			err = ovl_link_up(&ctx);
 		if (!err && ovl_dentry_needs_data_copy_up_locked(dentry, flags))
 			err = ovl_copy_up_meta_inode_data(&ctx);
+		if (!err)
+			ovl_copy_up_account(OVL_FS(dentry->d_sb), start);
 		ovl_copy_up_end(dentry);
 	}
 	do_delayed_call(&done);
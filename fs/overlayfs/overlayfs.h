@@ -598,6 +598,7 @@ struct ovl_fh *ovl_encode_real_fh(struct ovl_fs *ofs, struct dentry *real,
 				  bool is_upper);
 int ovl_set_origin(struct ovl_fs *ofs, struct dentry *lower,
 		   struct dentry *upper);
+int ovl_show_stats(struct seq_file *m, struct dentry *dentry);
 
 /* export.c */
 extern const struct export_operations ovl_export_operations;
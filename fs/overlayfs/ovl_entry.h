@@ -48,6 +48,15 @@ struct ovl_path {
 };
 
 /* private information held for overlayfs's superblock */
+struct ovl_copy_up_stats {
+	atomic64_t count;
+	atomic64_t time_ns;
+	atomic64_t max_ns;
+	atomic64_t data_count;
+	atomic64_t data_bytes;
+	atomic64_t data_time_ns;
+};
+
 struct ovl_fs {
 	unsigned int numlayer;
 	/* Number of unique fs among layers including upper fs */
@@ -83,6 +92,8 @@ struct ovl_fs {
 	struct dentry *whiteout;
 	/* r/o snapshot of upperdir sb's only taken on volatile mounts */
 	errseq_t errseq;
+	/* copy-up latencies, shown in /proc/<pid>/mountstats */
+	struct ovl_copy_up_stats copy_up_stats;
 };
 
 static inline struct vfsmount *ovl_upper_mnt(struct ovl_fs *ofs)
@@ -415,6 +415,7 @@ static const struct super_operations ovl_super_operations = {
 	.sync_fs	= ovl_sync_fs,
 	.statfs		= ovl_statfs,
 	.show_options	= ovl_show_options,
+	.show_stats	= ovl_show_stats,
 	.remount_fs	= ovl_remount,
 };
 
@@ -429,6 +429,9 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 
 	__pipe_lock(pipe);
 
+	/* only pipes fed by splice alone get to grow on their own */
+	pipe->autogrow = false;
+
 	if (!pipe->readers) {
 		send_sig(SIGPIPE, current, 0);
 		ret = -EPIPE;
@@ -813,6 +816,7 @@ struct pipe_inode_info *alloc_pipe_info(void)
 		pipe->max_usage = pipe_bufs;
 		pipe->ring_size = pipe_bufs;
 		pipe->nr_accounted = pipe_bufs;
+		pipe->autogrow = true;
 		pipe->user = user;
 		mutex_init(&pipe->mutex);
 		return pipe;
@@ -1302,6 +1306,45 @@ int pipe_resize_ring(struct pipe_inode_info *pipe, unsigned int nr_slots)
 	return 0;
 }
 
+/*
+ * Double the ring of a full pipe which so far has only been fed by splice,
+ * up to pipe_max_size and as long as the owner stays below its pipe buffer
+ * limits.  Called with the pipe locked.  Returns true if there's room now.
+ */
+bool pipe_grow_ring(struct pipe_inode_info *pipe)
+{
+	unsigned int nr_slots = pipe->max_usage * 2;
+	unsigned long user_bufs;
+
+	if (!pipe->autogrow || pipe->max_usage != pipe->ring_size)
+		return false;
+#ifdef CONFIG_WATCH_QUEUE
+	if (pipe->watch_queue)
+		return false;
+#endif
+
+	if (nr_slots > (pipe_max_size >> PAGE_SHIFT))
+		goto no_grow;
+
+	user_bufs = account_pipe_buffers(pipe->user, pipe->nr_accounted, nr_slots);
+	if (too_many_pipe_buffers_soft(user_bufs) ||
+	    too_many_pipe_buffers_hard(user_bufs) ||
+	    pipe_resize_ring(pipe, nr_slots) < 0) {
+		(void) account_pipe_buffers(pipe->user, nr_slots,
+					    pipe->nr_accounted);
+		goto no_grow;
+	}
+
+	pipe->max_usage = nr_slots;
+	pipe->nr_accounted = nr_slots;
+	return true;
+
+no_grow:
+	/* don't retry on every splice once we have hit a limit */
+	pipe->autogrow = false;
+	return false;
+}
+
 /*
  * Allocate a new array of pipe buffers and copy the info over. Returns the
  * pipe size if successful, or return -ERROR on error.
@@ -1317,6 +1360,9 @@ static long pipe_set_size(struct pipe_inode_info *pipe, unsigned long arg)
 		return -EBUSY;
 #endif
 
+	/* the user picked a size, stick to it */
+	pipe->autogrow = false;
+
 	size = round_pipe_size(arg);
 	nr_slots = size >> PAGE_SHIFT;
 
@@ -424,6 +424,12 @@ static inline void task_thp_status(struct seq_file *m, struct mm_struct *mm)
 	if (thp_enabled)
 		thp_enabled = !test_bit(MMF_DISABLE_THP, &mm->flags);
 	seq_printf(m, "THP_enabled:\t%d\n", thp_enabled);
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	seq_put_decimal_ull(m, "THP_collapsed:\t", READ_ONCE(mm->thp_collapsed));
+	seq_put_decimal_ull(m, "\nTHP_collapsed_hot:\t",
+			    READ_ONCE(mm->thp_collapsed_hot));
+	seq_putc(m, '\n');
+#endif
 }
 
 int proc_pid_status(struct seq_file *m, struct pid_namespace *ns,
@@ -49,6 +49,10 @@ static bool page_cache_pipe_buf_try_steal(struct pipe_inode_info *pipe,
 	struct page *page = buf->page;
 	struct address_space *mapping;
 
+	/* only single pages can be moved to another mapping */
+	if (PageCompound(page))
+		return false;
+
 	lock_page(page);
 
 	mapping = page_mapping(page);
@@ -993,6 +997,8 @@ static int wait_for_space(struct pipe_inode_info *pipe, unsigned flags)
 		}
 		if (!pipe_full(pipe->head, pipe->tail, pipe->max_usage))
 			return 0;
+		if (pipe_grow_ring(pipe))
+			return 0;
 		if (flags & SPLICE_F_NONBLOCK)
 			return -EAGAIN;
 		if (signal_pending(current))
@@ -1161,6 +1167,7 @@ static int iter_to_pipe(struct iov_iter *from,
 		.ops = &user_page_pipe_buf_ops,
 		.flags = flags
 	};
+	struct pipe_buffer *last = NULL;
 	size_t total = 0;
 	int ret = 0;
 	bool failed = false;
@@ -1180,13 +1187,39 @@ static int iter_to_pipe(struct iov_iter *from,
 		for (n = 0; copied; n++, start = 0) {
 			int size = min_t(int, copied, PAGE_SIZE - start);
 			if (!failed) {
+				struct page *head = compound_head(pages[n]);
+				unsigned int off = start +
+					(pages[n] - head) * PAGE_SIZE;
+
+				/*
+				 * Contiguous pieces of a compound page share
+				 * one buffer.  Gifted pages are left alone so
+				 * that the consumer can still steal them.
+				 */
+				if (last && last->page == head &&
+				    last->offset + last->len == off &&
+				    !(flags & SPLICE_F_GIFT)) {
+					last->len += size;
+					put_page(pages[n]);
+					iov_iter_advance(from, size);
+					total += size;
+					copied -= size;
+					continue;
+				}
+
 				buf.page = pages[n];
 				buf.offset = start;
+				if (head != pages[n] && !PageHighMem(head)) {
+					buf.page = head;
+					buf.offset = off;
+				}
 				buf.len = size;
 				ret = add_to_pipe(pipe, &buf);
 				if (unlikely(ret < 0)) {
 					failed = true;
 				} else {
+					last = &pipe->bufs[(pipe->head - 1) &
+							   (pipe->ring_size - 1)];
 					iov_iter_advance(from, ret);
 					total += ret;
 				}
@@ -33,6 +33,7 @@ struct device_node;
 struct drm_connector;
 struct drm_device;
 struct drm_panel;
+struct drm_rect;
 struct display_timing;
 
 enum drm_panel_orientation;
@@ -125,6 +126,23 @@ struct drm_panel_funcs {
 	 */
 	int (*get_timings)(struct drm_panel *panel, unsigned int num_timings,
 			   struct display_timing *timings);
+
+	/**
+	 * @set_update_window:
+	 *
+	 * Select the area of the panel frame memory written by the following
+	 * frames of a command mode panel, in mode coordinates. The panel may
+	 * grow @rect to meet its alignment constraints, the host then has to
+	 * send exactly the adjusted area. A NULL @rect selects the full frame.
+	 *
+	 * Command mode panels refresh themselves from their frame memory, so
+	 * hosts may skip transfers altogether while nothing is damaged.
+	 *
+	 * This function is optional and only valid between enable and
+	 * disable.
+	 */
+	int (*set_update_window)(struct drm_panel *panel,
+				 struct drm_rect *rect);
 };
 
 /**
@@ -171,6 +189,22 @@ struct drm_panel {
 	 * Panel entry in registry.
 	 */
 	struct list_head list;
+
+	/**
+	 * @num_partial_updates:
+	 *
+	 * Number of partial update windows selected through
+	 * drm_panel_set_update_window().
+	 */
+	unsigned long num_partial_updates;
+
+	/**
+	 * @num_full_updates:
+	 *
+	 * Number of times the full frame was selected through
+	 * drm_panel_set_update_window().
+	 */
+	unsigned long num_full_updates;
 };
 
 void drm_panel_init(struct drm_panel *panel, struct device *dev,
@@ -188,6 +222,50 @@ int drm_panel_disable(struct drm_panel *panel);
 
 int drm_panel_get_modes(struct drm_panel *panel, struct drm_connector *connector);
 
+/**
+ * drm_panel_has_update_window - check for partial update support
+ * @panel: DRM panel
+ *
+ * Returns true if @panel supports drm_panel_set_update_window().
+ */
+static inline bool drm_panel_has_update_window(struct drm_panel *panel)
+{
+	return panel && panel->funcs && panel->funcs->set_update_window;
+}
+
+/**
+ * drm_panel_set_update_window - select the area updated by the next frames
+ * @panel: DRM panel
+ * @rect: damaged area in mode coordinates, adjusted to the panel alignment
+ *	  on return, or NULL for the full frame
+ *
+ * Damage aware hosts of command mode panels call this before transferring
+ * a frame, to only send the damaged area. See
+ * &drm_panel_funcs.set_update_window.
+ *
+ * Return: 0 on success, -EOPNOTSUPP if the panel doesn't support partial
+ * updates or another negative error code on failure.
+ */
+static inline int drm_panel_set_update_window(struct drm_panel *panel,
+					      struct drm_rect *rect)
+{
+	int ret;
+
+	if (!drm_panel_has_update_window(panel))
+		return -EOPNOTSUPP;
+
+	ret = panel->funcs->set_update_window(panel, rect);
+	if (ret)
+		return ret;
+
+	if (rect)
+		panel->num_partial_updates++;
+	else
+		panel->num_full_updates++;
+
+	return 0;
+}
+
 #if defined(CONFIG_OF) && defined(CONFIG_DRM_PANEL)
 struct drm_panel *of_drm_find_panel(const struct device_node *np);
 int of_drm_get_panel_orientation(const struct device_node *np,
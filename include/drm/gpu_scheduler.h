@@ -29,9 +29,12 @@
 #include <linux/completion.h>
 #include <linux/xarray.h>
 #include <linux/irq_work.h>
+#include <linux/kref.h>
+#include <linux/rbtree.h>
 
 #define MAX_WAIT_SCHED_ENTITY_Q_EMPTY msecs_to_jiffies(1000)
 
+struct dentry;
 struct drm_gem_object;
 
 struct drm_gpu_scheduler;
@@ -50,6 +53,87 @@ enum drm_sched_priority {
 	DRM_SCHED_PRIORITY_UNSET = -2
 };
 
+/**
+ * enum drm_sched_policy - entity selection policy of a run queue
+ *
+ * @DRM_SCHED_POLICY_DEFAULT: use the policy selected by the sched_policy
+ *			      module parameter.
+ * @DRM_SCHED_POLICY_RR: round robin between the ready entities.
+ * @DRM_SCHED_POLICY_FAIR: pick the ready entity with the lowest weighted
+ *			   GPU runtime.
+ */
+enum drm_sched_policy {
+	DRM_SCHED_POLICY_DEFAULT,
+	DRM_SCHED_POLICY_RR,
+	DRM_SCHED_POLICY_FAIR,
+	DRM_SCHED_POLICY_COUNT,
+};
+
+/**
+ * enum drm_sched_hist_type - latency histograms kept by the scheduler
+ *
+ * @DRM_SCHED_HIST_QUEUE: time from drm_sched_entity_push_job() until the job
+ *			  is handed to &drm_sched_backend_ops.run_job.
+ * @DRM_SCHED_HIST_DEPENDENCY: part of the above spent waiting for dependency
+ *			       fences to signal.
+ * @DRM_SCHED_HIST_EXEC: time from run_job until the finished fence signaled.
+ */
+enum drm_sched_hist_type {
+	DRM_SCHED_HIST_QUEUE,
+	DRM_SCHED_HIST_DEPENDENCY,
+	DRM_SCHED_HIST_EXEC,
+	DRM_SCHED_HIST_COUNT,
+};
+
+/*
+ * Bucket 0 counts latencies below 1us, bucket n latencies in [2^(n-1), 2^n)us,
+ * the last bucket everything above.
+ */
+#define DRM_SCHED_HIST_BUCKETS		24
+
+/**
+ * struct drm_sched_hist - log2 latency histograms
+ */
+struct drm_sched_hist {
+	/** @buckets: number of jobs per &enum drm_sched_hist_type and bucket */
+	u64	buckets[DRM_SCHED_HIST_COUNT][DRM_SCHED_HIST_BUCKETS];
+};
+
+/* Weight of an entity, relative to the weight of normal priority */
+#define DRM_SCHED_WEIGHT_NORMAL		1024
+
+/**
+ * struct drm_sched_entity_stats - execution statistics of an entity
+ *
+ * Jobs keep a reference to the statistics of the entity they were pushed
+ * to, so their runtime can still be accounted after the entity is gone.
+ */
+struct drm_sched_entity_stats {
+	/** @kref: reference count, one for the entity and one per armed job */
+	struct kref			kref;
+
+	/** @lock: protects all the fields below */
+	spinlock_t			lock;
+
+	/** @runtime: total execution time of the completed jobs, in ns */
+	u64				runtime;
+
+	/**
+	 * @vruntime: execution time of the entity scaled by its @weight,
+	 * including an estimate for the jobs which are still executing.
+	 */
+	u64				vruntime;
+
+	/** @avg_runtime: moving average of the job execution time, in ns */
+	u64				avg_runtime;
+
+	/** @weight: share of the GPU time relative to DRM_SCHED_WEIGHT_NORMAL */
+	unsigned int			weight;
+
+	/** @hist: latency histograms of the jobs of the entity */
+	struct drm_sched_hist		hist;
+};
+
 /**
  * struct drm_sched_entity - A wrapper around a job queue (typically
  * attached to the DRM file_priv).
@@ -69,6 +153,32 @@ struct drm_sched_entity {
 	 */
 	struct list_head		list;
 
+	/**
+	 * @rb_tree_node:
+	 *
+	 * Used to insert this entity into the &drm_sched_rq.rb_tree_root of
+	 * @rq, sorted by @vruntime, when the scheduler is using
+	 * DRM_SCHED_POLICY_FAIR.
+	 *
+	 * Protected by &drm_sched_rq.lock of @rq.
+	 */
+	struct rb_node			rb_tree_node;
+
+	/**
+	 * @vruntime:
+	 *
+	 * Sort key of @rb_tree_node, a snapshot of &drm_sched_entity_stats.vruntime
+	 * taken when the entity was (re)inserted into @rq.
+	 */
+	u64				vruntime;
+
+	/**
+	 * @stats:
+	 *
+	 * Execution statistics of this entity, used by DRM_SCHED_POLICY_FAIR.
+	 */
+	struct drm_sched_entity_stats	*stats;
+
 	/**
 	 * @rq:
 	 *
@@ -196,6 +306,21 @@ struct drm_sched_entity {
 	 * drm_sched_entity_fini().
 	 */
 	struct completion		entity_idle;
+
+	/**
+	 * @dep_wait_start:
+	 *
+	 * Time at which the scheduler started waiting for @dependency.
+	 */
+	ktime_t				dep_wait_start;
+
+	/**
+	 * @dep_wait:
+	 *
+	 * Time the job at the top of the job queue waited for its
+	 * dependencies so far. Updated from the dependency fence callback.
+	 */
+	ktime_t				dep_wait;
 };
 
 /**
@@ -205,6 +330,10 @@ struct drm_sched_entity {
  * @sched: the scheduler to which this rq belongs to.
  * @entities: list of the entities to be scheduled.
  * @current_entity: the entity which is to be scheduled.
+ * @rb_tree_root: entities sorted by virtual runtime, only used with
+ *                DRM_SCHED_POLICY_FAIR.
+ * @min_vruntime: virtual runtime of the leftmost entity in @rb_tree_root,
+ *                entities joining the run queue start from here.
  *
  * Run queue is a set of entities scheduling command submissions for
  * one specific ring. It implements the scheduling policy that selects
@@ -215,6 +344,8 @@ struct drm_sched_rq {
 	struct drm_gpu_scheduler	*sched;
 	struct list_head		entities;
 	struct drm_sched_entity		*current_entity;
+	struct rb_root_cached		rb_tree_root;
+	u64				min_vruntime;
 };
 
 /**
@@ -277,6 +408,20 @@ struct drm_sched_fence *to_drm_sched_fence(struct dma_fence *f);
  * @s_priority: the priority of the job.
  * @entity: the entity to which this job belongs.
  * @cb: the callback for the parent fence in s_fence.
+ * @entity_stats: statistics of @entity, valid after drm_sched_job_arm().
+ * @fair_charge: runtime estimate charged to @entity_stats when the job was
+ *               picked to run, corrected once the job completes.
+ * @submit_ts: time when the job was pushed to its entity.
+ * @dep_wait: time the job waited for its dependencies to signal.
+ * @trace_id: id assigned by drm_sched_job_init(), unique across all
+ *            schedulers, to follow the job through the tracepoints of the
+ *            scheduler and of the drivers.
+ * @trace_sampled: the job was picked by the trace_sample module parameter,
+ *                 its stage timestamps are recorded in the trace ring of
+ *                 its scheduler once it completes.
+ * @init_ts: time of drm_sched_job_init(), only set for sampled jobs.
+ * @deps_ts: time at which the dependencies of the job were all signaled,
+ *           only set for sampled jobs.
  *
  * A job is created by the driver using drm_sched_job_init(), and
  * should call drm_sched_entity_push_job() once it wants the scheduler
@@ -302,6 +447,14 @@ struct drm_sched_job {
 	enum drm_sched_priority		s_priority;
 	struct drm_sched_entity         *entity;
 	struct dma_fence_cb		cb;
+	struct drm_sched_entity_stats	*entity_stats;
+	u64				fair_charge;
+	ktime_t				submit_ts;
+	ktime_t				dep_wait;
+	u64				trace_id;
+	bool				trace_sampled;
+	ktime_t				init_ts;
+	ktime_t				deps_ts;
 	/**
 	 * @dependencies:
 	 *
@@ -321,6 +474,25 @@ static inline bool drm_sched_invalidate_job(struct drm_sched_job *s_job,
 	return s_job && atomic_inc_return(&s_job->karma) > threshold;
 }
 
+/**
+ * enum drm_sched_dep_elided - reasons for dropping a job dependency
+ *
+ * @DRM_SCHED_DEP_SIGNALED: the fence was already signaled.
+ * @DRM_SCHED_DEP_SAME_ENTITY: the fence belongs to an earlier job of the same
+ *			       entity, which is always run first.
+ * @DRM_SCHED_DEP_SAME_SCHED: the fence belongs to a job on the same scheduler
+ *			      which has already been handed to the hardware.
+ * @DRM_SCHED_DEP_MERGED: a later fence of the same context was already a
+ *			  dependency of the job.
+ */
+enum drm_sched_dep_elided {
+	DRM_SCHED_DEP_SIGNALED,
+	DRM_SCHED_DEP_SAME_ENTITY,
+	DRM_SCHED_DEP_SAME_SCHED,
+	DRM_SCHED_DEP_MERGED,
+	DRM_SCHED_DEP_ELIDED_COUNT,
+};
+
 enum drm_gpu_sched_stat {
 	DRM_GPU_SCHED_STAT_NONE, /* Reserve 0 */
 	DRM_GPU_SCHED_STAT_NOMINAL,
@@ -366,8 +538,9 @@ struct drm_sched_backend_ops {
 	 * procedure usually follows the following workflow:
 	 *
 	 * 1. Stop the scheduler using drm_sched_stop(). This will park the
-	 *    scheduler thread and cancel the timeout work, guaranteeing that
-	 *    nothing is queued while we reset the hardware queue
+	 *    scheduler thread (or stop the submission work) and cancel the
+	 *    timeout work, guaranteeing that nothing is queued while we reset
+	 *    the hardware queue
 	 * 2. Try to gracefully stop non-faulty jobs (optional)
 	 * 3. Issue a GPU reset (driver-specific)
 	 * 4. Re-submit jobs using drm_sched_resubmit_jobs()
@@ -392,6 +565,12 @@ struct drm_sched_backend_ops {
 	 * 5. Restart all schedulers that were stopped in step #1 using
 	 *    drm_sched_start()
 	 *
+	 * Hardware which can reset a single queue, or kill the work of a
+	 * single context while the rest of the ring keeps executing, can skip
+	 * all of the above: drop the work of the guilty job in hardware and
+	 * call drm_sched_entity_recover(). Only the entity of the guilty job
+	 * is affected, the jobs of all other entities continue as they are.
+	 *
 	 * Return DRM_GPU_SCHED_STAT_NOMINAL, when all is normal,
 	 * and the underlying driver has started or completed recovery.
 	 *
@@ -407,6 +586,41 @@ struct drm_sched_backend_ops {
 	void (*free_job)(struct drm_sched_job *sched_job);
 };
 
+#define DRM_SCHED_TRACE_RING_SIZE	64
+
+/**
+ * struct drm_sched_trace_record - stage timestamps of a sampled job
+ *
+ * @trace_id: &drm_sched_job.trace_id of the job.
+ * @id: &drm_sched_job.id of the job.
+ * @context: context of the finished fence of the job.
+ * @seqno: seqno of the finished fence of the job.
+ * @hw_context: context of the fence returned by run_job, 0 if there was none.
+ * @hw_seqno: seqno of the fence returned by run_job.
+ * @init: time of drm_sched_job_init().
+ * @push: time the job was pushed to its entity.
+ * @deps_done: time the dependencies of the job were all signaled.
+ * @run: time the job was handed to the driver.
+ * @hw_done: time the hardware fence signaled, 0 if unknown.
+ * @finished: time the finished fence signaled.
+ * @error: error of the finished fence.
+ */
+struct drm_sched_trace_record {
+	u64				trace_id;
+	u64				id;
+	u64				context;
+	u64				seqno;
+	u64				hw_context;
+	u64				hw_seqno;
+	ktime_t				init;
+	ktime_t				push;
+	ktime_t				deps_done;
+	ktime_t				run;
+	ktime_t				hw_done;
+	ktime_t				finished;
+	int				error;
+};
+
 /**
  * struct drm_gpu_scheduler
  *
@@ -425,7 +639,13 @@ struct drm_sched_backend_ops {
  * @timeout_wq: workqueue used to queue @work_tdr
  * @work_tdr: schedules a delayed call to @drm_sched_job_timedout after the
  *            timeout interval is over.
- * @thread: the kthread on which the scheduler which run.
+ * @thread: the kthread on which the scheduler which run, NULL if the
+ *          scheduler uses @submit_wq.
+ * @submit_wq: workqueue on which @work_submit runs jobs and frees completed
+ *             ones, NULL if the scheduler uses its own @thread.
+ * @work_submit: runs ready jobs and frees completed ones on @submit_wq.
+ * @pause_submit: set while @work_submit must not be queued, see
+ *                drm_sched_wqueue_stop().
  * @pending_list: the list of jobs which are currently in the job queue.
  * @job_list_lock: lock to protect the pending_list.
  * @hang_limit: once the hangs by a job crosses this limit then it is marked
@@ -434,6 +654,13 @@ struct drm_sched_backend_ops {
  * @_score: score used when the driver doesn't provide one
  * @ready: marks if the underlying HW is ready to work
  * @free_guilty: A hit to time out handler to free the guilty job.
+ * @policy: entity selection policy of the run queues
+ * @deps_elided: number of dependencies dropped by
+ *               drm_sched_job_add_dependency(), per &enum drm_sched_dep_elided
+ * @hist: per-cpu latency histograms of the jobs run by the scheduler
+ * @trace_ring: the last %DRM_SCHED_TRACE_RING_SIZE sampled jobs
+ * @trace_head: number of records ever written to @trace_ring
+ * @trace_lock: protects @trace_ring and @trace_head
  *
  * One scheduler is implemented for each hardware ring.
  */
@@ -450,6 +677,9 @@ struct drm_gpu_scheduler {
 	struct workqueue_struct		*timeout_wq;
 	struct delayed_work		work_tdr;
 	struct task_struct		*thread;
+	struct workqueue_struct		*submit_wq;
+	struct work_struct		work_submit;
+	bool				pause_submit;
 	struct list_head		pending_list;
 	spinlock_t			job_list_lock;
 	int				hang_limit;
@@ -457,13 +687,21 @@ struct drm_gpu_scheduler {
 	atomic_t                        _score;
 	bool				ready;
 	bool				free_guilty;
+	enum drm_sched_policy		policy;
+	atomic64_t			deps_elided[DRM_SCHED_DEP_ELIDED_COUNT];
+	struct drm_sched_hist __percpu	*hist;
+	struct drm_sched_trace_record	*trace_ring;
+	unsigned long			trace_head;
+	spinlock_t			trace_lock;
 };
 
 int drm_sched_init(struct drm_gpu_scheduler *sched,
 		   const struct drm_sched_backend_ops *ops,
+		   struct workqueue_struct *submit_wq,
 		   uint32_t hw_submission, unsigned hang_limit,
 		   long timeout, struct workqueue_struct *timeout_wq,
-		   atomic_t *score, const char *name);
+		   atomic_t *score, const char *name,
+		   enum drm_sched_policy policy);
 
 void drm_sched_fini(struct drm_gpu_scheduler *sched);
 int drm_sched_job_init(struct drm_sched_job *job,
@@ -483,7 +721,11 @@ void drm_sched_entity_modify_sched(struct drm_sched_entity *entity,
 
 void drm_sched_job_cleanup(struct drm_sched_job *job);
 void drm_sched_wakeup(struct drm_gpu_scheduler *sched);
+bool drm_sched_wqueue_ready(struct drm_gpu_scheduler *sched);
+void drm_sched_wqueue_stop(struct drm_gpu_scheduler *sched);
+void drm_sched_wqueue_start(struct drm_gpu_scheduler *sched);
 void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad);
+int drm_sched_entity_recover(struct drm_sched_job *bad, int error);
 void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery);
 void drm_sched_resubmit_jobs(struct drm_gpu_scheduler *sched);
 void drm_sched_resubmit_jobs_ext(struct drm_gpu_scheduler *sched, int max);
@@ -499,6 +741,7 @@ void drm_sched_rq_add_entity(struct drm_sched_rq *rq,
 			     struct drm_sched_entity *entity);
 void drm_sched_rq_remove_entity(struct drm_sched_rq *rq,
 				struct drm_sched_entity *entity);
+void drm_sched_entity_stats_put(struct drm_sched_entity_stats *stats);
 
 int drm_sched_entity_init(struct drm_sched_entity *entity,
 			  enum drm_sched_priority priority,
@@ -511,8 +754,12 @@ void drm_sched_entity_destroy(struct drm_sched_entity *entity);
 void drm_sched_entity_select_rq(struct drm_sched_entity *entity);
 struct drm_sched_job *drm_sched_entity_pop_job(struct drm_sched_entity *entity);
 void drm_sched_entity_push_job(struct drm_sched_job *sched_job);
+void drm_sched_entity_push_jobs(struct drm_sched_job **jobs,
+				unsigned int count);
 void drm_sched_entity_set_priority(struct drm_sched_entity *entity,
 				   enum drm_sched_priority priority);
+void drm_sched_entity_set_weight(struct drm_sched_entity *entity,
+				 unsigned int weight);
 bool drm_sched_entity_is_ready(struct drm_sched_entity *entity);
 
 struct drm_sched_fence *drm_sched_fence_alloc(
@@ -531,4 +778,23 @@ struct drm_gpu_scheduler *
 drm_sched_pick_best(struct drm_gpu_scheduler **sched_list,
 		     unsigned int num_sched_list);
 
+#if defined(CONFIG_DEBUG_FS)
+void drm_sched_debugfs_init(struct drm_gpu_scheduler *sched,
+			    struct dentry *root, const char *name);
+void drm_sched_debugfs_trace_init(struct drm_gpu_scheduler *sched,
+				  struct dentry *root, const char *name);
+#else
+static inline void drm_sched_debugfs_init(struct drm_gpu_scheduler *sched,
+					  struct dentry *root,
+					  const char *name)
+{
+}
+
+static inline void drm_sched_debugfs_trace_init(struct drm_gpu_scheduler *sched,
+						struct dentry *root,
+						const char *name)
+{
+}
+#endif
+
 #endif
@@ -85,6 +85,33 @@ static inline bool spsc_queue_push(struct spsc_queue *queue, struct spsc_node *n
 	return tail == &queue->head;
 }
 
+/*
+ * Push the chain of @count nodes from @first to @last, already linked through
+ * their next pointers, with a single atomic exchange.
+ */
+static inline bool spsc_queue_push_many(struct spsc_queue *queue,
+					struct spsc_node *first,
+					struct spsc_node *last,
+					unsigned int count)
+{
+	struct spsc_node **tail;
+
+	last->next = NULL;
+
+	preempt_disable();
+
+	tail = (struct spsc_node **)atomic_long_xchg(&queue->tail, (long)&last->next);
+	WRITE_ONCE(*tail, first);
+	atomic_add(count, &queue->job_count);
+
+	/* Same as for spsc_queue_push() */
+	smp_wmb();
+
+	preempt_enable();
+
+	return tail == &queue->head;
+}
+
 
 static inline struct spsc_node *spsc_queue_pop(struct spsc_queue *queue)
 {
@@ -98,6 +98,7 @@ struct ttm_tt;
  * @ddestroy: List head for the delayed destroy list.
  * @swap: List head for swap LRU list.
  * @moving: Fence set when BO is moving
+ * @evict_jiffies: When the BO was last evicted, 0 if never.
  * @offset: The current GPU offset, which can have different meanings
  * depending on the memory type. For SYSTEM type memory, it should be 0.
  * @cur_placement: Hint of current placement.
@@ -153,6 +154,7 @@ struct ttm_buffer_object {
 	struct dma_fence *moving;
 	unsigned priority;
 	unsigned pin_count;
+	unsigned long evict_jiffies;
 
 	/**
 	 * Special members that are protected by the reserve lock
@@ -242,6 +244,24 @@ ttm_bo_get_unless_zero(struct ttm_buffer_object *bo)
 	return bo;
 }
 
+/* Window in which a BO coming back after an eviction is considered hot */
+#define TTM_BO_REFAULT_WINDOW	HZ
+
+/**
+ * ttm_bo_recently_evicted - check if a BO was evicted a short time ago
+ * @bo: The buffer object.
+ *
+ * A BO which is found on a LRU again shortly after being evicted from it is
+ * actively used, evicting it again would just thrash.
+ *
+ * Returns: true if @bo was evicted within the last TTM_BO_REFAULT_WINDOW.
+ */
+static inline bool ttm_bo_recently_evicted(struct ttm_buffer_object *bo)
+{
+	return bo->evict_jiffies &&
+		time_before(jiffies, bo->evict_jiffies + TTM_BO_REFAULT_WINDOW);
+}
+
 /**
  * ttm_bo_wait - wait for buffer idle.
  *
@@ -572,8 +592,10 @@ static inline void ttm_bo_unpin(struct ttm_buffer_object *bo)
 int ttm_mem_evict_first(struct ttm_device *bdev,
 			struct ttm_resource_manager *man,
 			const struct ttm_place *place,
+			uint64_t size,
 			struct ttm_operation_ctx *ctx,
-			struct ww_acquire_ctx *ticket);
+			struct ww_acquire_ctx *ticket,
+			struct gpumem_cgroup_pool_state *limit_pool);
 
 /* Default number of pre-faulted pages in the TTM fault handler */
 #define TTM_BO_VM_NUM_PREFAULT 16
@@ -58,6 +58,24 @@ extern struct ttm_global {
 	 * @bo_count: Number of buffer objects allocated by devices.
 	 */
 	atomic_t bo_count;
+
+	/**
+	 * @swapout_wq: Workqueue used to swap out batches of BOs in parallel.
+	 */
+	struct workqueue_struct *swapout_wq;
+
+	/**
+	 * @swapout_passes: Number of ttm_device_swapout() passes.
+	 * @swapout_bos: Number of BOs successfully swapped out.
+	 * @swapout_pages: Number of pages successfully swapped out.
+	 * @swapout_busy: Number of candidates skipped because they were busy.
+	 * @swapout_ns: Total time spent in ttm_device_swapout().
+	 */
+	atomic64_t swapout_passes;
+	atomic64_t swapout_bos;
+	atomic64_t swapout_pages;
+	atomic64_t swapout_busy;
+	atomic64_t swapout_ns;
 } ttm_glob;
 
 struct ttm_device_funcs {
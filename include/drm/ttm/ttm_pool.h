@@ -34,6 +34,7 @@
 struct device;
 struct ttm_tt;
 struct ttm_pool;
+struct ttm_pool_magazine;
 struct ttm_operation_ctx;
 
 /**
@@ -45,6 +46,11 @@ struct ttm_operation_ctx;
  * @shrinker_list: our place on the global shrinker list
  * @lock: protection of the page list
  * @pages: the list of pages in the pool
+ * @mags: per CPU caches of pages in front of @pages, might be NULL
+ * @mag_size: number of allocations each of the @mags can hold
+ * @dirty: freed pages which still need to be cleared, protected by @lock
+ * @dirty_link: our place on the global list of pool types to clear
+ * @dirty_queued: set while we are on the list of pool types to clear
  */
 struct ttm_pool_type {
 	struct ttm_pool *pool;
@@ -55,18 +61,27 @@ struct ttm_pool_type {
 
 	spinlock_t lock;
 	struct list_head pages;
+
+	struct ttm_pool_magazine __percpu *mags;
+	unsigned int mag_size;
+
+	struct list_head dirty;
+	struct list_head dirty_link;
+	unsigned long dirty_queued;
 };
 
 /**
  * struct ttm_pool - Pool for all caching and orders
  *
  * @dev: the device we allocate pages for
+ * @nid: the NUMA node we allocate pages from, NUMA_NO_NODE for the local one
  * @use_dma_alloc: if coherent DMA allocations should be used
  * @use_dma32: if GFP_DMA32 should be used
  * @caching: pools for each caching/order
  */
 struct ttm_pool {
 	struct device *dev;
+	int nid;
 
 	bool use_dma_alloc;
 	bool use_dma32;
@@ -81,7 +96,7 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 void ttm_pool_free(struct ttm_pool *pool, struct ttm_tt *tt);
 
 void ttm_pool_init(struct ttm_pool *pool, struct device *dev,
-		   bool use_dma_alloc, bool use_dma32);
+		   int nid, bool use_dma_alloc, bool use_dma32);
 void ttm_pool_fini(struct ttm_pool *pool);
 
 int ttm_pool_debugfs(struct ttm_pool *pool, struct seq_file *m);
@@ -45,6 +45,8 @@ struct dma_buf_map;
 struct io_mapping;
 struct sg_table;
 struct scatterlist;
+struct gpumem_cgroup_region;
+struct gpumem_cgroup_pool_state;
 
 struct ttm_resource_manager_func {
 	/**
@@ -97,6 +99,44 @@ struct ttm_resource_manager_func {
 	 */
 	void (*debug)(struct ttm_resource_manager *man,
 		      struct drm_printer *printer);
+
+	/**
+	 * struct ttm_resource_manager_func member evict_cost
+	 *
+	 * @man: Pointer to a memory type manager.
+	 * @bo: The eviction candidate, reserved.
+	 * @place: Placement we want to make room for, may be NULL.
+	 * @size: Number of bytes needed, 0 if unknown.
+	 * @age: Position of @bo among the evictable BOs of its LRU.
+	 *
+	 * Optional. Returns the cost of evicting @bo, ttm_mem_evict_first()
+	 * evicts the candidate with the lowest cost. Called with the
+	 * lru_lock held, so it may not sleep. If not set
+	 * ttm_resource_manager_evict_cost_default() is used.
+	 */
+	uint64_t (*evict_cost)(struct ttm_resource_manager *man,
+			       struct ttm_buffer_object *bo,
+			       const struct ttm_place *place,
+			       uint64_t size, unsigned int age);
+};
+
+/**
+ * struct ttm_resource_manager_evict_stats
+ *
+ * @evictions: Number of BOs evicted by ttm_mem_evict_first().
+ * @bytes: Number of bytes evicted.
+ * @busy: Number of evicted BOs which still had unsignaled fences.
+ * @refaults: Number of evicted BOs which were evicted recently before.
+ * @scanned: Number of candidates compared.
+ *
+ * Eviction statistics of a resource manager, protected by the lru_lock.
+ */
+struct ttm_resource_manager_evict_stats {
+	uint64_t evictions;
+	uint64_t bytes;
+	uint64_t busy;
+	uint64_t refaults;
+	uint64_t scanned;
 };
 
 /**
@@ -110,6 +150,9 @@ struct ttm_resource_manager_func {
  * @move_lock: lock for move fence
  * @move: The fence of the last pipelined move operation.
  * @lru: The lru list for this memory type.
+ * @evict_stats: Eviction statistics for this memory type.
+ * @cg: gpumem cgroup region the resources are charged to, or NULL. Set by the
+ * driver after ttm_resource_manager_init().
  *
  * This structure is used to identify and manage memory types for a device.
  */
@@ -134,6 +177,9 @@ struct ttm_resource_manager {
 	 */
 
 	struct list_head lru[TTM_MAX_BO_PRIORITY];
+	struct ttm_resource_manager_evict_stats evict_stats;
+
+	struct gpumem_cgroup_region *cg;
 };
 
 /**
@@ -162,6 +208,7 @@ struct ttm_bus_placement {
  * @placement: Placement flags.
  * @bus: Placement on io bus accessible to the CPU
  * @bo: weak reference to the BO, protected by ttm_device::lru_lock
+ * @css: gpumem cgroup pool state the resource is charged to, or NULL.
  *
  * Structure indicating the placement and space resources used by a
  * buffer object.
@@ -173,6 +220,7 @@ struct ttm_resource {
 	uint32_t placement;
 	struct ttm_bus_placement bus;
 	struct ttm_buffer_object *bo;
+	struct gpumem_cgroup_pool_state *css;
 };
 
 /**
@@ -269,13 +317,24 @@ void ttm_resource_fini(struct ttm_resource_manager *man,
 
 int ttm_resource_alloc(struct ttm_buffer_object *bo,
 		       const struct ttm_place *place,
-		       struct ttm_resource **res);
+		       struct ttm_resource **res,
+		       struct gpumem_cgroup_pool_state **ret_limit_pool);
 void ttm_resource_free(struct ttm_buffer_object *bo, struct ttm_resource **res);
 bool ttm_resource_compat(struct ttm_resource *res,
 			 struct ttm_placement *placement);
 void ttm_resource_set_bo(struct ttm_resource *res,
 			 struct ttm_buffer_object *bo);
 
+uint64_t
+ttm_resource_manager_evict_cost_default(struct ttm_resource_manager *man,
+					struct ttm_buffer_object *bo,
+					const struct ttm_place *place,
+					uint64_t size, unsigned int age);
+uint64_t ttm_resource_manager_evict_cost(struct ttm_resource_manager *man,
+					 struct ttm_buffer_object *bo,
+					 const struct ttm_place *place,
+					 uint64_t size, unsigned int age);
+
 void ttm_resource_manager_init(struct ttm_resource_manager *man,
 			       struct ttm_device *bdev,
 			       unsigned long p_size);
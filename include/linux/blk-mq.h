@@ -738,6 +738,9 @@ struct blk_mq_tags {
 	 * request pool
 	 */
 	spinlock_t lock;
+
+	/* per-CPU cache of free bitmap_tags, see blk-mq-tag.c */
+	struct blk_mq_tag_cache __percpu *cache;
 };
 
 static inline struct request *blk_mq_tag_to_rq(struct blk_mq_tags *tags,
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * GPU memory cgroup controller.
+ */
+#ifndef _CGROUP_GPUMEM_H
+#define _CGROUP_GPUMEM_H
+
+#include <linux/types.h>
+
+struct gpumem_cgroup_region;
+struct gpumem_cgroup_pool_state;
+
+#ifdef CONFIG_CGROUP_GPUMEM
+
+struct gpumem_cgroup_region *
+gpumem_cgroup_register_region(u64 size, const char *fmt, ...) __printf(2, 3);
+void gpumem_cgroup_unregister_region(struct gpumem_cgroup_region *region);
+
+int gpumem_cgroup_try_charge(struct gpumem_cgroup_region *region, u64 size,
+			     struct gpumem_cgroup_pool_state **ret_pool,
+			     struct gpumem_cgroup_pool_state **ret_limit_pool);
+void gpumem_cgroup_uncharge(struct gpumem_cgroup_pool_state *pool, u64 size);
+void gpumem_cgroup_pool_state_put(struct gpumem_cgroup_pool_state *pool);
+
+bool gpumem_cgroup_state_evict_valuable(struct gpumem_cgroup_pool_state *limit_pool,
+					struct gpumem_cgroup_pool_state *test_pool,
+					bool ignore_low, bool *ret_hit_low);
+
+void gpumem_cgroup_count_evict(struct gpumem_cgroup_pool_state *pool,
+			       u64 size);
+void gpumem_cgroup_count_move(struct gpumem_cgroup_pool_state *pool,
+			      u64 size);
+
+#else
+
+static inline __printf(2, 3) struct gpumem_cgroup_region *
+gpumem_cgroup_register_region(u64 size, const char *fmt, ...)
+{
+	return NULL;
+}
+
+static inline void
+gpumem_cgroup_unregister_region(struct gpumem_cgroup_region *region)
+{
+}
+
+static inline int
+gpumem_cgroup_try_charge(struct gpumem_cgroup_region *region, u64 size,
+			 struct gpumem_cgroup_pool_state **ret_pool,
+			 struct gpumem_cgroup_pool_state **ret_limit_pool)
+{
+	*ret_pool = NULL;
+	if (ret_limit_pool)
+		*ret_limit_pool = NULL;
+
+	return 0;
+}
+
+static inline void gpumem_cgroup_uncharge(struct gpumem_cgroup_pool_state *pool,
+					  u64 size)
+{
+}
+
+static inline void
+gpumem_cgroup_pool_state_put(struct gpumem_cgroup_pool_state *pool)
+{
+}
+
+static inline bool
+gpumem_cgroup_state_evict_valuable(struct gpumem_cgroup_pool_state *limit_pool,
+				   struct gpumem_cgroup_pool_state *test_pool,
+				   bool ignore_low, bool *ret_hit_low)
+{
+	return true;
+}
+
+static inline void
+gpumem_cgroup_count_evict(struct gpumem_cgroup_pool_state *pool, u64 size)
+{
+}
+
+static inline void
+gpumem_cgroup_count_move(struct gpumem_cgroup_pool_state *pool, u64 size)
+{
+}
+
+#endif /* CONFIG_CGROUP_GPUMEM */
+
+#endif /* _CGROUP_GPUMEM_H */
@@ -65,6 +65,10 @@ SUBSYS(rdma)
 SUBSYS(misc)
 #endif
 
+#if IS_ENABLED(CONFIG_CGROUP_GPUMEM)
+SUBSYS(gpumem)
+#endif
+
 /*
  * The following subsystems are not supported on the default hierarchy.
  */
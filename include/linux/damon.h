@@ -88,6 +88,13 @@ struct damon_target {
  * @DAMOS_HUGEPAGE:	Call ``madvise()`` for the region with MADV_HUGEPAGE.
  * @DAMOS_NOHUGEPAGE:	Call ``madvise()`` for the region with MADV_NOHUGEPAGE.
  * @DAMOS_STAT:		Do nothing but count the stat.
+ * @DAMOS_PROMOTE:	Migrate the region to the nearest node with CPUs.
+ * @DAMOS_DEMOTE:	Migrate the region to its node's demotion target.
+ *
+ * &DAMOS_PROMOTE and &DAMOS_DEMOTE move pages between memory tiers, e.g. DRAM
+ * and CXL attached or persistent memory used as memory nodes.  The demotion
+ * targets are the ones reclaim uses, see next_demotion_node().  Both are only
+ * supported by the physical address space primitives.
  */
 enum damos_action {
 	DAMOS_WILLNEED,
@@ -96,6 +103,8 @@ enum damos_action {
 	DAMOS_HUGEPAGE,
 	DAMOS_NOHUGEPAGE,
 	DAMOS_STAT,		/* Do nothing but only record the stat */
+	DAMOS_PROMOTE,
+	DAMOS_DEMOTE,
 };
 
 /**
@@ -199,6 +208,12 @@ struct damos_watermarks {
  * @nr_applied:	Total number of regions that the scheme is applied.
  * @sz_applied:	Total size of regions that the scheme is applied.
  * @qt_exceeds: Total number of times the quota of the scheme has exceeded.
+ * @access_applied:	Sum of the ``nr_accesses`` of the pages that the scheme
+ *			is applied, weighted by their number.
+ *
+ * @access_applied divided by the number of pages in @sz_applied is the average
+ * access frequency of the memory the action was applied to, e.g. how hot the
+ * memory moved to a faster tier was.
  */
 struct damos_stat {
 	unsigned long nr_tried;
@@ -206,6 +221,7 @@ struct damos_stat {
 	unsigned long nr_applied;
 	unsigned long sz_applied;
 	unsigned long qt_exceeds;
+	unsigned long access_applied;
 };
 
 /**
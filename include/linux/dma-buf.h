@@ -441,6 +441,22 @@ struct dma_buf {
 
 		__poll_t active;
 	} cb_in, cb_out;
+
+	/**
+	 * @map_cache_hits:
+	 *
+	 * Number of dma_buf_map_attachment() calls served from the mapping
+	 * cache of an attachment, see CONFIG_DMABUF_MAP_CACHE.
+	 */
+	atomic_long_t map_cache_hits;
+
+	/**
+	 * @map_cache_misses:
+	 *
+	 * Number of dma_buf_map_attachment() calls which had to ask the
+	 * exporter for a new mapping while the mapping cache was used.
+	 */
+	atomic_long_t map_cache_misses;
 #ifdef CONFIG_DMABUF_SYSFS_STATS
 	/**
 	 * @sysfs_entry:
@@ -502,6 +518,9 @@ struct dma_buf_attach_ops {
  * @importer_ops: importer operations for this attachment, if provided
  * dma_buf_map/unmap_attachment() must be called with the dma_resv lock held.
  * @importer_priv: importer specific attachment data.
+ * @map_lock: protects @map_cache.
+ * @map_cache: mappings kept by the core per direction, see
+ * CONFIG_DMABUF_MAP_CACHE.
  *
  * This structure holds the attachment information between the dma_buf buffer
  * and its user device(s). The list contains one attachment struct per device
@@ -522,6 +541,8 @@ struct dma_buf_attachment {
 	const struct dma_buf_attach_ops *importer_ops;
 	void *importer_priv;
 	void *priv;
+	struct mutex map_lock;
+	struct list_head map_cache;
 };
 
 /**
@@ -32,7 +32,7 @@ struct dma_fence_array_cb {
  * @num_fences: number of fences in the array
  * @num_pending: fences in the array still pending
  * @fences: array of the fences
- * @work: internal irq_work function
+ * @work: internal deferred signalling work
  */
 struct dma_fence_array {
 	struct dma_fence base;
@@ -42,7 +42,7 @@ struct dma_fence_array {
 	atomic_t num_pending;
 	struct dma_fence **fences;
 
-	struct irq_work work;
+	struct dma_fence_deferred work;
 };
 
 extern const struct dma_fence_ops dma_fence_array_ops;
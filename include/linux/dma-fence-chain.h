@@ -14,11 +14,15 @@
 #include <linux/irq_work.h>
 #include <linux/slab.h>
 
+struct seq_file;
+
 /**
  * struct dma_fence_chain - fence to represent an node of a fence chain
  * @base: fence base class
  * @prev: previous fence of the chain
  * @prev_seqno: original previous seqno before garbage collection
+ * @skip: older node of the same chain to speed up seqno lookups
+ * @depth: number of nodes before this one when the chain was built
  * @fence: encapsulated fence
  * @lock: spinlock for fence handling
  */
@@ -26,6 +30,8 @@ struct dma_fence_chain {
 	struct dma_fence base;
 	struct dma_fence __rcu *prev;
 	u64 prev_seqno;
+	struct dma_fence __rcu *skip;
+	u64 depth;
 	struct dma_fence *fence;
 	union {
 		/**
@@ -38,13 +44,13 @@ struct dma_fence_chain {
 		struct dma_fence_cb cb;
 
 		/**
-		 * @work: irq work item for signaling
+		 * @work: deferred work item for signaling
 		 *
-		 * Irq work structure to allow us to add the callback without
-		 * running into lock inversion. Never used at the same time as
-		 * the callback.
+		 * Deferred work structure to allow us to add the callback
+		 * without running into lock inversion. Never used at the same
+		 * time as the callback.
 		 */
-		struct irq_work work;
+		struct dma_fence_deferred work;
 	};
 	spinlock_t lock;
 };
@@ -105,6 +111,7 @@ static inline void dma_fence_chain_free(struct dma_fence_chain *chain)
 
 struct dma_fence *dma_fence_chain_walk(struct dma_fence *fence);
 int dma_fence_chain_find_seqno(struct dma_fence **pfence, uint64_t seqno);
+void dma_fence_chain_describe_stats(struct seq_file *seq);
 void dma_fence_chain_init(struct dma_fence_chain *chain,
 			  struct dma_fence *prev,
 			  struct dma_fence *fence,
@@ -18,6 +18,7 @@
 #include <linux/list.h>
 #include <linux/bitops.h>
 #include <linux/kref.h>
+#include <linux/llist.h>
 #include <linux/sched.h>
 #include <linux/printk.h>
 #include <linux/rcupdate.h>
@@ -93,6 +94,10 @@ struct dma_fence {
 	unsigned long flags;
 	struct kref refcount;
 	int error;
+#ifdef CONFIG_DMA_FENCE_STATS
+	/* creation time for the signalling statistics */
+	ktime_t created;
+#endif
 };
 
 enum dma_fence_flag_bits {
@@ -118,6 +123,21 @@ struct dma_fence_cb {
 	dma_fence_func_t func;
 };
 
+/**
+ * struct dma_fence_deferred - deferred processing of a container fence
+ * @node: used internally to queue the work
+ * @func: the function to call
+ *
+ * Container fences like &dma_fence_array and &dma_fence_chain can't signal
+ * from inside the callbacks of their components because of lock inversion.
+ * Work queued with dma_fence_defer() is collected per CPU and run in a single
+ * irq_work pass once the driver is done signalling.
+ */
+struct dma_fence_deferred {
+	struct llist_node node;
+	void (*func)(struct dma_fence_deferred *work);
+};
+
 /**
  * struct dma_fence_ops - operations implemented for fence
  *
@@ -583,6 +603,8 @@ static inline signed long dma_fence_wait(struct dma_fence *fence, bool intr)
 	return ret < 0 ? ret : 0;
 }
 
+void dma_fence_defer(struct dma_fence_deferred *work);
+
 struct dma_fence *dma_fence_get_stub(void);
 struct dma_fence *dma_fence_allocate_private_stub(void);
 u64 dma_fence_context_alloc(unsigned num);
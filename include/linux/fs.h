@@ -934,6 +934,9 @@ struct fown_struct {
  * @ra_pages: Maximum size of a readahead request.
  * @mmap_miss: How many mmap accesses missed in the page cache.
  * @prev_pos: The last byte in the most recent read request.
+ * @stride_start: Where the most recent non-sequential read started.
+ * @stride: Distance between the starts of the last two such reads.
+ * @stride_len: Pages read ahead per run once a stride is detected.
  */
 struct file_ra_state {
 	pgoff_t start;
@@ -942,6 +945,9 @@ struct file_ra_state {
 	unsigned int ra_pages;
 	unsigned int mmap_miss;
 	loff_t prev_pos;
+	pgoff_t stride_start;
+	unsigned int stride;
+	unsigned int stride_len;
 };
 
 /*
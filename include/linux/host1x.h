@@ -27,20 +27,25 @@ struct iommu_group;
 
 u64 host1x_get_dma_mask(struct host1x *host1x);
 
+struct host1x_bo_mapping;
+
 /**
  * struct host1x_bo_cache - host1x buffer object cache
- * @mappings: list of mappings
+ * @mappings: list of mappings, least recently used first
  * @lock: synchronizes accesses to the list of mappings
+ * @release: optional callback invoked before a cached mapping is unpinned
  */
 struct host1x_bo_cache {
 	struct list_head mappings;
 	struct mutex lock;
+	void (*release)(struct host1x_bo_mapping *mapping);
 };
 
 static inline void host1x_bo_cache_init(struct host1x_bo_cache *cache)
 {
 	INIT_LIST_HEAD(&cache->mappings);
 	mutex_init(&cache->lock);
+	cache->release = NULL;
 }
 
 static inline void host1x_bo_cache_destroy(struct host1x_bo_cache *cache)
@@ -124,6 +129,11 @@ struct host1x_bo_mapping {
 
 	struct host1x_bo_cache *cache;
 	struct list_head entry;
+
+	/* mapped into the host1x IOMMU domain at @phys, cached gathers only */
+	bool domain_mapped;
+	/* hash of the relocations last patched into the buffer, 0 if none */
+	u32 reloc_hash;
 };
 
 static inline struct host1x_bo_mapping *to_host1x_bo_mapping(struct kref *ref)
@@ -169,6 +179,8 @@ struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo
 					enum dma_data_direction dir,
 					struct host1x_bo_cache *cache);
 void host1x_bo_unpin(struct host1x_bo_mapping *map);
+unsigned long host1x_bo_cache_trim(struct host1x_bo_cache *cache,
+				   unsigned long nr_to_scan);
 
 static inline void *host1x_bo_mmap(struct host1x_bo *bo)
 {
@@ -321,6 +333,13 @@ struct host1x_job {
 
 	/* Whether host1x-side firewall should be ran for this job or not */
 	bool enable_firewall;
+
+	/*
+	 * The submitter guarantees that the CPU has not modified the gathers
+	 * since they were last submitted, so relocations whose addresses did
+	 * not change need not be patched again.
+	 */
+	bool reuse_relocs;
 };
 
 struct host1x_job *host1x_job_alloc(struct host1x_channel *ch,
@@ -13,6 +13,7 @@
 #include <linux/shrinker.h>
 
 struct mem_cgroup;
+struct list_lru_pcp;
 
 /* list_lru_walk_cb has to always return one of those */
 enum lru_status {
@@ -51,6 +52,8 @@ struct list_lru_node {
 
 struct list_lru {
 	struct list_lru_node	*node;
+	/* per cpu batches of added items, NULL unless batched */
+	struct list_lru_pcp	__percpu *pcp;
 #ifdef CONFIG_MEMCG_KMEM
 	struct list_head	list;
 	int			shrinker_id;
@@ -59,15 +62,22 @@ struct list_lru {
 };
 
 void list_lru_destroy(struct list_lru *lru);
-int __list_lru_init(struct list_lru *lru, bool memcg_aware,
+int __list_lru_init(struct list_lru *lru, bool memcg_aware, bool batched,
 		    struct lock_class_key *key, struct shrinker *shrinker);
 
 #define list_lru_init(lru)				\
-	__list_lru_init((lru), false, NULL, NULL)
+	__list_lru_init((lru), false, false, NULL, NULL)
 #define list_lru_init_key(lru, key)			\
-	__list_lru_init((lru), false, (key), NULL)
+	__list_lru_init((lru), false, false, (key), NULL)
 #define list_lru_init_memcg(lru, shrinker)		\
-	__list_lru_init((lru), true, NULL, shrinker)
+	__list_lru_init((lru), true, false, NULL, shrinker)
+/*
+ * Batched lrus queue added items per cpu and move them to the node lists in
+ * batches, or when the lru is walked. Callers have to serialize adding and
+ * deleting an item themselves and must not use the lru under IRQ-safe locks.
+ */
+#define list_lru_init_memcg_batched(lru, shrinker)	\
+	__list_lru_init((lru), true, true, NULL, shrinker)
 
 int memcg_update_all_list_lrus(int num_memcgs);
 void memcg_drain_all_list_lrus(int src_idx, struct mem_cgroup *dst_memcg);
@@ -112,6 +122,9 @@ bool list_lru_del(struct list_lru *lru, struct list_head *item);
  * Always return a non-negative number, 0 for empty lists. There is no
  * guarantee that the list is not updated while the count is being computed.
  * Callers that want such a guarantee need to provide an outer lock.
+ *
+ * Items of a batched lru still queued on a cpu are only counted by
+ * list_lru_count_node().
  */
 unsigned long list_lru_count_one(struct list_lru *lru,
 				 int nid, struct mem_cgroup *memcg);
@@ -10,6 +10,7 @@
 #include <linux/spinlock.h>
 #include <linux/rbtree.h>
 #include <linux/rwsem.h>
+#include <linux/mutex.h>
 #include <linux/completion.h>
 #include <linux/cpumask.h>
 #include <linux/uprobes.h>
@@ -550,6 +551,18 @@ struct mm_struct {
 		 */
 		seqcount_t write_protect_seq;
 
+#ifdef CONFIG_MEMBARRIER
+		/**
+		 * @membarrier_lock: Serializes the private expedited IPI
+		 * rounds of this mm.
+		 * @membarrier_seq: Incremented at the start and at the end of
+		 * each round, odd while a round is in flight. Lets concurrent
+		 * callers share a round which started after their entry.
+		 */
+		struct mutex membarrier_lock;
+		unsigned long membarrier_seq;
+#endif
+
 		spinlock_t arg_lock; /* protect the below fields */
 
 		unsigned long start_code, end_code, start_data, end_data;
@@ -598,6 +611,11 @@ struct mm_struct {
 #if defined(CONFIG_TRANSPARENT_HUGEPAGE) && !USE_SPLIT_PMD_PTLOCKS
 		pgtable_t pmd_huge_pte; /* protected by page_table_lock */
 #endif
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+		/* huge pages collapsed by khugepaged, in total and hinted */
+		unsigned long thp_collapsed;
+		unsigned long thp_collapsed_hot;
+#endif
 #ifdef CONFIG_NUMA_BALANCING
 		/*
 		 * numa_next_scan is the next time that the PTEs will be marked
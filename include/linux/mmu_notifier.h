@@ -247,11 +247,19 @@ struct mmu_notifier {
  * @invalidate: Upon return the caller must stop using any SPTEs within this
  *              range. This function can sleep. Return false only if sleeping
  *              was required but mmu_notifier_range_blockable(range) is false.
+ * @invalidate_flush: Optional. Called for every subscription @invalidate was
+ *              called for, once @invalidate ran for all subscriptions
+ *              overlapping @range. A driver implementing it may defer the
+ *              device TLB flush from @invalidate to here, so a single mm
+ *              operation covering many subscriptions of one device costs a
+ *              single flush. The flush must be complete on return.
  */
 struct mmu_interval_notifier_ops {
 	bool (*invalidate)(struct mmu_interval_notifier *interval_sub,
 			   const struct mmu_notifier_range *range,
 			   unsigned long cur_seq);
+	void (*invalidate_flush)(struct mmu_interval_notifier *interval_sub,
+				 const struct mmu_notifier_range *range);
 };
 
 struct mmu_interval_notifier {
@@ -307,9 +307,27 @@ struct gro_list {
 
 /*
  * size of gro hash buckets, must less than bit number of
- * napi_struct::gro_bitmask
+ * napi_struct::gro_bitmask. Only the first 1 << napi_struct::gro_hash_bits
+ * of them are in use, the hash grows and shrinks with the number of flows
+ * seen by the NAPI instance.
  */
-#define GRO_HASH_BUCKETS	8
+#define GRO_HASH_MIN_BITS	3
+#define GRO_HASH_MAX_BITS	5
+#define GRO_HASH_BUCKETS	(1 << GRO_HASH_MAX_BITS)
+
+/**
+ * struct napi_gro_stats - GRO counters of a NAPI instance
+ * @merged: packets merged into a held skb
+ * @held: packets held as the start of a new aggregate
+ * @flushed: aggregates completed by a protocol, a later packet or napi_gro_flush()
+ * @evicted: aggregates completed early because their bucket was full
+ */
+struct napi_gro_stats {
+	u64	merged;
+	u64	held;
+	u64	flushed;
+	u64	evicted;
+};
 
 /*
  * Structure for NAPI scheduling similar to tasklet but with weighting
@@ -333,6 +351,11 @@ struct napi_struct {
 #endif
 	struct net_device	*dev;
 	struct gro_list		gro_hash[GRO_HASH_BUCKETS];
+	u8			gro_hash_bits;
+	u8			gro_quiet_rounds;
+	u16			gro_round_held;
+	u16			gro_round_evicted;
+	struct napi_gro_stats	gro_stats;
 	struct sk_buff		*skb;
 	struct list_head	rx_list; /* Pending GRO_NORMAL skbs */
 	int			rx_count; /* length of rx_list */
@@ -16,8 +16,10 @@
 
 /**
  *	struct pipe_buffer - a linux kernel pipe buffer
- *	@page: the page containing the data for the pipe buffer
- *	@offset: offset of data inside the @page
+ *	@page: the page containing the data for the pipe buffer, may be the
+ *	       head of a compound page
+ *	@offset: offset of data inside the @page, may be past PAGE_SIZE for
+ *	         compound pages
  *	@len: length of data inside the @page
  *	@ops: operations associated with this buffer. See @pipe_buf_operations.
  *	@flags: pipe buffer flags. See above.
@@ -49,6 +51,7 @@ struct pipe_buffer {
  *	@r_counter: reader counter
  *	@w_counter: writer counter
  *	@poll_usage: is this pipe used for epoll, which has crazy wakeups?
+ *	@autogrow: only fed by splice so far, the ring may grow when full
  *	@fasync_readers: reader side fasync
  *	@fasync_writers: writer side fasync
  *	@bufs: the circular array of pipe buffers
@@ -72,6 +75,7 @@ struct pipe_inode_info {
 	unsigned int r_counter;
 	unsigned int w_counter;
 	unsigned int poll_usage;
+	bool autogrow;
 	struct page *tmp_page;
 	struct fasync_struct *fasync_readers;
 	struct fasync_struct *fasync_writers;
@@ -263,6 +267,7 @@ bool pipe_is_unprivileged_user(void);
 /* for F_SETPIPE_SZ and F_GETPIPE_SZ */
 #ifdef CONFIG_WATCH_QUEUE
 int pipe_resize_ring(struct pipe_inode_info *pipe, unsigned int nr_slots);
+bool pipe_grow_ring(struct pipe_inode_info *pipe);
 #endif
 long pipe_fcntl(struct file *, unsigned int, unsigned long arg);
 struct pipe_inode_info *get_pipe_info(struct file *file, bool for_splice);
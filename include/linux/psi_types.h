@@ -144,6 +144,9 @@ struct psi_trigger {
 };
 
 struct psi_group {
+	/* Stall times are only tracked while enabled */
+	bool enabled;
+
 	/* Protects data used by the aggregator */
 	struct mutex avgs_lock;
 
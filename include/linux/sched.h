@@ -908,6 +908,8 @@ struct task_struct {
 	/* Bit to tell LSMs we're in execve(): */
 	unsigned			in_execve:1;
 	unsigned			in_iowait:1;
+	/* Boost like in_iowait on wakeup, without iowait accounting: */
+	unsigned			in_iowait_boost:1;
 #ifndef TIF_RESTORE_SIGMASK
 	unsigned			restore_sigmask:1;
 #endif
@@ -81,6 +81,12 @@ struct sched_domain_shared {
 	atomic_t	ref;
 	atomic_t	nr_busy_cpus;
 	int		has_idle_cores;
+
+	/*
+	 * CPUs of the LLC running their idle task, see sds_idle_cpus().
+	 * Must be last, it is sized for nr_cpu_ids.
+	 */
+	unsigned long	idle_cpus[];
 };
 
 struct sched_domain {
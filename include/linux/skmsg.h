@@ -77,6 +77,17 @@ struct sk_psock_work_state {
 	u32				off;
 };
 
+/* Updated from the receive path of the psock socket, which the socket
+ * lock serializes. Readable from the sockmap and sockhash iterators.
+ */
+struct sk_psock_stats {
+	u64				verdict_bursts;
+	u64				pass_direct;
+	u64				pass_backlog;
+	u64				redir_direct;
+	u64				redir_backlog;
+};
+
 struct sk_psock {
 	struct sock			*sk;
 	struct sock			*sk_redir;
@@ -106,6 +117,7 @@ struct sk_psock {
 	struct sk_psock_work_state	work_state;
 	struct work_struct		work;
 	struct rcu_work			rwork;
+	struct sk_psock_stats		stats;
 };
 
 int sk_msg_alloc(struct sock *sk, struct sk_msg *msg, int len,
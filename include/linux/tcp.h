@@ -309,6 +309,8 @@ struct tcp_sock {
 	u32	sacked_out;	/* SACK'd packets			*/
 
 	struct hrtimer	pacing_timer;
+	struct list_head pace_node; /* anchor in a per cpu pacing wheel slot */
+	struct tcp_pace_wheel *pace_wheel; /* wheel pace_node is queued on */
 	struct hrtimer	compressed_ack_timer;
 
 	/* from STCP, retrans queue hinting */
@@ -128,9 +128,14 @@ struct neigh_statistics {
 
 	unsigned long unres_discards;	/* number of unresolved drops */
 	unsigned long table_fulls;      /* times even gc couldn't help */
+
+	unsigned long periodic_gc_usecs; /* time spent in periodic GC */
+	unsigned long forced_gc_usecs;	/* time spent in forced GC */
 };
 
 #define NEIGH_CACHE_STAT_INC(tbl, field) this_cpu_inc((tbl)->stats->field)
+#define NEIGH_CACHE_STAT_ADD(tbl, field, val) \
+	this_cpu_add((tbl)->stats->field, val)
 
 struct neighbour {
 	struct neighbour __rcu	*next;
@@ -219,6 +224,7 @@ struct neigh_table {
 	int			gc_thresh2;
 	int			gc_thresh3;
 	unsigned long		last_flush;
+	unsigned int		gc_bucket;
 	struct delayed_work	gc_work;
 	struct delayed_work	managed_work;
 	struct timer_list 	proxy_timer;
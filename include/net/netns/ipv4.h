@@ -164,6 +164,7 @@ struct netns_ipv4 {
 	int sysctl_tcp_min_rtt_wlen;
 	u8 sysctl_tcp_min_tso_segs;
 	u8 sysctl_tcp_autocorking;
+	u8 sysctl_tcp_pace_wheel;
 	u8 sysctl_tcp_reflect_tos;
 	u8 sysctl_tcp_comp_sack_nr;
 	int sysctl_tcp_invalid_ratelimit;
@@ -161,6 +161,36 @@ struct metadata_dst *udp_tun_rx_dst(struct sk_buff *skb, unsigned short family,
 				    __be16 flags, __be64 tunnel_id,
 				    int md_size);
 
+/* Aggregated packets a tunnel device received after decapsulation */
+struct udp_tunnel_gro_stats {
+	u64_stats_t		packets;
+	u64_stats_t		segs;
+	struct u64_stats_sync	syncp;
+};
+
+#define UDP_TUNNEL_GRO_STATS_LEN	2
+
+static inline void
+udp_tunnel_gro_stats_add(struct udp_tunnel_gro_stats __percpu *stats,
+			 const struct sk_buff *skb)
+{
+	struct udp_tunnel_gro_stats *s;
+
+	if (!skb_is_gso(skb))
+		return;
+
+	s = this_cpu_ptr(stats);
+	u64_stats_update_begin(&s->syncp);
+	u64_stats_inc(&s->packets);
+	u64_stats_add(&s->segs, skb_shinfo(skb)->gso_segs);
+	u64_stats_update_end(&s->syncp);
+}
+
+struct udp_tunnel_gro_stats __percpu *udp_tunnel_gro_stats_alloc(void);
+void udp_tunnel_gro_stats_strings(u8 *data);
+void udp_tunnel_gro_stats_fetch(struct udp_tunnel_gro_stats __percpu *stats,
+				u64 *data);
+
 #ifdef CONFIG_INET
 static inline int udp_tunnel_handle_offloads(struct sk_buff *skb, bool udp_csum)
 {
@@ -112,6 +112,48 @@ TRACE_EVENT(file_check_and_advance_wb_err,
 			MINOR(__entry->s_dev), __entry->i_ino, __entry->old,
 			__entry->new)
 );
+
+#define FILEMAP_STRIDE_MISS	0
+#define FILEMAP_STRIDE_HIT	1
+#define FILEMAP_STRIDE_START	2
+
+TRACE_EVENT(mm_filemap_stride_readahead,
+		TP_PROTO(struct address_space *mapping, pgoff_t index,
+			 unsigned int stride, unsigned int nr, int state),
+
+		TP_ARGS(mapping, index, stride, nr, state),
+
+		TP_STRUCT__entry(
+			__field(unsigned long, i_ino)
+			__field(dev_t, s_dev)
+			__field(pgoff_t, index)
+			__field(unsigned int, stride)
+			__field(unsigned int, nr)
+			__field(int, state)
+		),
+
+		TP_fast_assign(
+			__entry->i_ino = mapping->host->i_ino;
+			if (mapping->host->i_sb)
+				__entry->s_dev = mapping->host->i_sb->s_dev;
+			else
+				__entry->s_dev = mapping->host->i_rdev;
+			__entry->index = index;
+			__entry->stride = stride;
+			__entry->nr = nr;
+			__entry->state = state;
+		),
+
+		TP_printk("dev=%d:%d ino=0x%lx ofs=%lu stride=%u nr=%u %s",
+			MAJOR(__entry->s_dev), MINOR(__entry->s_dev),
+			__entry->i_ino, __entry->index << PAGE_SHIFT,
+			__entry->stride, __entry->nr,
+			__print_symbolic(__entry->state,
+				{ FILEMAP_STRIDE_MISS,	"miss" },
+				{ FILEMAP_STRIDE_HIT,	"hit" },
+				{ FILEMAP_STRIDE_START,	"start" }))
+);
+
 #endif /* _TRACE_FILEMAP_H */
 
 /* This part must be outside protection */
@@ -36,6 +36,41 @@ TRACE_EVENT(napi_poll,
 		  __entry->work, __entry->budget)
 );
 
+TRACE_EVENT(napi_gro_resize,
+
+	TP_PROTO(struct napi_struct *napi, unsigned int bits),
+
+	TP_ARGS(napi, bits),
+
+	TP_STRUCT__entry(
+		__field(	struct napi_struct *,	napi)
+		__string(	dev_name, napi->dev ? napi->dev->name : NO_DEV)
+		__field(	unsigned int,		old_buckets)
+		__field(	unsigned int,		new_buckets)
+		__field(	u64,			merged)
+		__field(	u64,			held)
+		__field(	u64,			flushed)
+		__field(	u64,			evicted)
+	),
+
+	TP_fast_assign(
+		__entry->napi = napi;
+		__assign_str(dev_name, napi->dev ? napi->dev->name : NO_DEV);
+		__entry->old_buckets = 1U << napi->gro_hash_bits;
+		__entry->new_buckets = 1U << bits;
+		__entry->merged = napi->gro_stats.merged;
+		__entry->held = napi->gro_stats.held;
+		__entry->flushed = napi->gro_stats.flushed;
+		__entry->evicted = napi->gro_stats.evicted;
+	),
+
+	TP_printk("napi struct %p for device %s gro buckets %u -> %u merged %llu held %llu flushed %llu evicted %llu",
+		  __entry->napi, __get_str(dev_name),
+		  __entry->old_buckets, __entry->new_buckets,
+		  __entry->merged, __entry->held,
+		  __entry->flushed, __entry->evicted)
+);
+
 #undef NO_DEV
 
 #endif /* _TRACE_NAPI_H */
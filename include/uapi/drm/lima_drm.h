@@ -21,6 +21,11 @@ enum drm_lima_param {
 	DRM_LIMA_PARAM_NUM_PP,
 	DRM_LIMA_PARAM_GP_VERSION,
 	DRM_LIMA_PARAM_PP_VERSION,
+	/*
+	 * Max num_pp of a PP frame. On mali400 it can exceed NUM_PP, the
+	 * sub-frames are then dispatched to the PP cores as they go idle.
+	 */
+	DRM_LIMA_PARAM_PP_MAX_SUBFRAMES,
 };
 
 /**
@@ -21,6 +21,7 @@ extern "C" {
 #define DRM_PANFROST_PERFCNT_ENABLE		0x06
 #define DRM_PANFROST_PERFCNT_DUMP		0x07
 #define DRM_PANFROST_MADVISE			0x08
+#define DRM_PANFROST_PERFCNT_RING		0x09
 
 #define DRM_IOCTL_PANFROST_SUBMIT		DRM_IOW(DRM_COMMAND_BASE + DRM_PANFROST_SUBMIT, struct drm_panfrost_submit)
 #define DRM_IOCTL_PANFROST_WAIT_BO		DRM_IOW(DRM_COMMAND_BASE + DRM_PANFROST_WAIT_BO, struct drm_panfrost_wait_bo)
@@ -38,6 +39,7 @@ extern "C" {
  */
 #define DRM_IOCTL_PANFROST_PERFCNT_ENABLE	DRM_IOW(DRM_COMMAND_BASE + DRM_PANFROST_PERFCNT_ENABLE, struct drm_panfrost_perfcnt_enable)
 #define DRM_IOCTL_PANFROST_PERFCNT_DUMP		DRM_IOW(DRM_COMMAND_BASE + DRM_PANFROST_PERFCNT_DUMP, struct drm_panfrost_perfcnt_dump)
+#define DRM_IOCTL_PANFROST_PERFCNT_RING		DRM_IOWR(DRM_COMMAND_BASE + DRM_PANFROST_PERFCNT_RING, struct drm_panfrost_perfcnt_ring)
 
 #define PANFROST_JD_REQ_FS (1 << 0)
 /**
@@ -204,6 +206,69 @@ struct drm_panfrost_perfcnt_dump {
 	__u64 buf_ptr;
 };
 
+/**
+ * struct drm_panfrost_perfcnt_ring - switch perfcnt to per-job sampling
+ *
+ * Once enabled, the counters are sampled each time a job completes and
+ * the samples are appended to a ring buffer BO, which userspace maps with
+ * DRM_IOCTL_PANFROST_MMAP_BO. The counters are cleared after each sample,
+ * so a sample covers the GPU activity since the previous one, including
+ * jobs of other clients running concurrently.
+ *
+ * The BO starts with a struct drm_panfrost_perfcnt_ring_header, samples
+ * start at offset 4096 and are @sample_size bytes apart. Each sample holds
+ * the counter dump, in the same layout as DRM_IOCTL_PANFROST_PERFCNT_DUMP,
+ * followed by a struct drm_panfrost_perfcnt_sample at offset @dump_size.
+ *
+ * Counters must have been enabled with DRM_IOCTL_PANFROST_PERFCNT_ENABLE
+ * on the same fd first.
+ */
+struct drm_panfrost_perfcnt_ring {
+	/** @enable: 1 to start per-job sampling, 0 to stop it. */
+	__u32 enable;
+	/** @num_samples: Number of samples the ring can hold, in. */
+	__u32 num_samples;
+	/** @handle: GEM handle of the ring BO, out. */
+	__u32 handle;
+	/** @sample_size: Distance between two samples in bytes, out. */
+	__u32 sample_size;
+	/** @dump_size: Size of the counter dump of a sample in bytes, out. */
+	__u32 dump_size;
+	/** @pad: MBZ. */
+	__u32 pad;
+};
+
+/**
+ * struct drm_panfrost_perfcnt_ring_header - ring buffer state
+ *
+ * Samples [@tail, @head) are valid, indices wrap at @num_samples. When the
+ * ring is full, new samples are dropped rather than overwriting unread
+ * ones.
+ */
+struct drm_panfrost_perfcnt_ring_header {
+	/** @head: Number of samples written, updated by the kernel. */
+	__u32 head;
+	/** @tail: Number of samples consumed, updated by userspace. */
+	__u32 tail;
+	/** @num_samples: Number of samples the ring holds. */
+	__u32 num_samples;
+	/** @sample_size: Distance between two samples in bytes. */
+	__u32 sample_size;
+	/** @dropped: Number of samples lost because the ring was full. */
+	__u64 dropped;
+};
+
+struct drm_panfrost_perfcnt_sample {
+	/** @timestamp: CLOCK_MONOTONIC time of the job completion in ns. */
+	__u64 timestamp;
+	/** @seqno: Seqno of the job on its job slot. */
+	__u64 seqno;
+	/** @pid: Thread group the job was submitted from. */
+	__u32 pid;
+	/** @js: Job slot the job ran on. */
+	__u32 js;
+};
+
 /* madvise provides a way to tell the kernel in case a buffers contents
  * can be discarded under memory pressure, which is useful for userspace
  * bo cache where we want to optimistically hold on to buffer allocate
@@ -59,6 +59,11 @@ extern "C" {
 
 #define DRM_V3D_SUBMIT_CL_FLUSH_CACHE             0x01
 #define DRM_V3D_SUBMIT_EXTENSION		  0x02
+/* The RCL waits on the semaphore incremented at the end of the BCL, so the
+ * kernel can queue it to the hardware as soon as the bin job started,
+ * instead of waiting for the bin job to complete.
+ */
+#define DRM_V3D_SUBMIT_CL_BIN_SEMAPHORE           0x04
 
 /* struct drm_v3d_extension - ioctl extensions
  *
@@ -276,6 +281,7 @@ enum drm_v3d_param {
 	DRM_V3D_PARAM_SUPPORTS_CACHE_FLUSH,
 	DRM_V3D_PARAM_SUPPORTS_PERFMON,
 	DRM_V3D_PARAM_SUPPORTS_MULTISYNC_EXT,
+	DRM_V3D_PARAM_SUPPORTS_BIN_SEMAPHORE,
 };
 
 struct drm_v3d_get_param {
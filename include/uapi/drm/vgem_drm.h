@@ -38,9 +38,11 @@ extern "C" {
  */
 #define DRM_VGEM_FENCE_ATTACH	0x1
 #define DRM_VGEM_FENCE_SIGNAL	0x2
+#define DRM_VGEM_SUBMIT		0x3
 
 #define DRM_IOCTL_VGEM_FENCE_ATTACH	DRM_IOWR( DRM_COMMAND_BASE + DRM_VGEM_FENCE_ATTACH, struct drm_vgem_fence_attach)
 #define DRM_IOCTL_VGEM_FENCE_SIGNAL	DRM_IOW( DRM_COMMAND_BASE + DRM_VGEM_FENCE_SIGNAL, struct drm_vgem_fence_signal)
+#define DRM_IOCTL_VGEM_SUBMIT		DRM_IOW( DRM_COMMAND_BASE + DRM_VGEM_SUBMIT, struct drm_vgem_submit)
 
 struct drm_vgem_fence_attach {
 	__u32 handle;
@@ -55,6 +57,39 @@ struct drm_vgem_fence_signal {
 	__u32 flags;
 };
 
+/*
+ * Run an emulated job on one of the virtual engines, only available when vgem
+ * is loaded with engines > 0. The job waits for in_sync and the implicit
+ * fences of the BOs, executes for a time drawn from the given distribution
+ * and then signals out_sync and its fences in the BOs' reservation objects.
+ */
+struct drm_vgem_submit {
+	/* Pointer to an array of u32 GEM handles the job accesses */
+	__u64 bo_handles;
+	__u32 bo_handle_count;
+
+	__u32 flags;
+#define VGEM_SUBMIT_WRITE	0x1
+
+	/* Virtual engine to run on, 0 to engines - 1 */
+	__u32 engine;
+
+	__u32 distribution;
+/* Every job executes for exactly exec_ns */
+#define VGEM_SUBMIT_FIXED	0
+/* Uniformly distributed in [exec_ns - jitter_ns, exec_ns + jitter_ns] */
+#define VGEM_SUBMIT_UNIFORM	1
+/* Exponentially distributed with mean exec_ns, capped at 16 * exec_ns */
+#define VGEM_SUBMIT_EXPONENTIAL	2
+
+	__u64 exec_ns;
+	__u64 jitter_ns;
+
+	/* Optional syncobj handles to wait on and to signal, 0 for none */
+	__u32 in_sync;
+	__u32 out_sync;
+};
+
 #if defined(__cplusplus)
 }
 #endif
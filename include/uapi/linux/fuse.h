@@ -194,6 +194,7 @@
  *  - add FUSE_SECURITY_CTX init flag
  *  - add security context to create, mkdir, symlink, and mknod requests
  *  - add FUSE_HAS_INODE_DAX, FUSE_ATTR_DAX
+ *  - add FUSE_DEV_IOC_BIND_CPU
  */
 
 #ifndef _LINUX_FUSE_H
@@ -953,6 +954,14 @@ struct fuse_notify_retrieve_in {
 /* Device ioctls: */
 #define FUSE_DEV_IOC_MAGIC		229
 #define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, uint32_t)
+/*
+ * Read the synchronous requests sent on a CPU through this (cloned) device.
+ * Takes the CPU number, FUSE_DEV_CPU_NONE undoes the binding. At least one
+ * unbound device is still needed for forgets, interrupts, background
+ * requests and CPUs without a bound device.
+ */
+#define FUSE_DEV_IOC_BIND_CPU		_IOW(FUSE_DEV_IOC_MAGIC, 1, uint32_t)
+#define FUSE_DEV_CPU_NONE		((uint32_t)-1)
 
 struct fuse_lseek_in {
 	uint64_t	fh;
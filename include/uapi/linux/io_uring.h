@@ -143,6 +143,8 @@ enum {
 	IORING_OP_MKDIRAT,
 	IORING_OP_SYMLINKAT,
 	IORING_OP_LINKAT,
+	IORING_OP_SEND_ZC,
+	IORING_OP_FENCE_WAIT,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -185,6 +187,26 @@ enum {
 #define IORING_POLL_UPDATE_EVENTS	(1U << 1)
 #define IORING_POLL_UPDATE_USER_DATA	(1U << 2)
 
+/*
+ * RECV flags, stored in sqe->ioprio.
+ *
+ * IORING_RECV_MULTISHOT	Multishot recv. Keeps receiving into provided
+ *				buffers and sets IORING_CQE_F_MORE on each CQE
+ *				as long as the request stays armed. Requires
+ *				IOSQE_BUFFER_SELECT, MSG_WAITALL isn't allowed.
+ */
+#define IORING_RECV_MULTISHOT	(1U << 0)
+
+/*
+ * ACCEPT flags, stored in sqe->ioprio.
+ *
+ * IORING_ACCEPT_MULTISHOT	Multishot accept. Posts a CQE with
+ *				IORING_CQE_F_MORE for every accepted connection
+ *				as long as the request stays armed. Can't be
+ *				used with a fixed file slot.
+ */
+#define IORING_ACCEPT_MULTISHOT	(1U << 0)
+
 /*
  * IO completion data structure (Completion Queue Entry)
  */
@@ -199,9 +221,12 @@ struct io_uring_cqe {
  *
  * IORING_CQE_F_BUFFER	If set, the upper 16 bits are the buffer ID
  * IORING_CQE_F_MORE	If set, parent SQE will generate more CQE entries
+ * IORING_CQE_F_NOTIF	Notification CQE of IORING_OP_SEND_ZC, the kernel
+ *			no longer references the sent buffer
  */
 #define IORING_CQE_F_BUFFER		(1U << 0)
 #define IORING_CQE_F_MORE		(1U << 1)
+#define IORING_CQE_F_NOTIF		(1U << 2)
 
 enum {
 	IORING_CQE_BUFFER_SHIFT		= 16,
@@ -325,6 +350,10 @@ enum {
 	/* set/get max number of io-wq workers */
 	IORING_REGISTER_IOWQ_MAX_WORKERS	= 19,
 
+	/* register/unregister a ring of provided buffers */
+	IORING_REGISTER_PBUF_RING		= 20,
+	IORING_UNREGISTER_PBUF_RING		= 21,
+
 	/* this goes last */
 	IORING_REGISTER_LAST
 };
@@ -385,6 +414,40 @@ struct io_uring_probe {
 	struct io_uring_probe_op ops[0];
 };
 
+struct io_uring_buf {
+	__u64	addr;
+	__u32	len;
+	__u16	bid;
+	__u16	resv;
+};
+
+struct io_uring_buf_ring {
+	union {
+		/*
+		 * The tail overlays the resv field of bufs[0], such that a ring
+		 * of n entries fits exactly into n * sizeof(struct io_uring_buf)
+		 * bytes. The application adds buffers and then bumps the tail,
+		 * the kernel consumes them from its private head.
+		 */
+		struct {
+			__u64	resv1;
+			__u32	resv2;
+			__u16	resv3;
+			__u16	tail;
+		};
+		struct io_uring_buf bufs[0];
+	};
+};
+
+/* argument for IORING_(UN)REGISTER_PBUF_RING */
+struct io_uring_buf_reg {
+	__u64	ring_addr;
+	__u32	ring_entries;
+	__u16	bgid;
+	__u16	pad;
+	__u64	resv[3];
+};
+
 struct io_uring_restriction {
 	__u16 opcode;
 	union {
@@ -32,9 +32,12 @@
  * - 1.4 - Indicate new SRAM EDC bit in device properties
  * - 1.5 - Add SVM API
  * - 1.6 - Query clear flags in SVM get_attr API
+ * - 1.7 - Add SVM migration policy API and SMI event
+ * - 1.8 - Add SMI event ring buffer, migration and queue SMI events
+ * - 1.9 - Add event eventfd API
  */
 #define KFD_IOCTL_MAJOR_VERSION 1
-#define KFD_IOCTL_MINOR_VERSION 6
+#define KFD_IOCTL_MINOR_VERSION 9
 
 struct kfd_ioctl_get_version_args {
 	__u32 major_version;	/* from KFD */
@@ -251,6 +254,17 @@ struct kfd_ioctl_reset_event_args {
 	__u32 pad;
 };
 
+/*
+ * Attach an eventfd to an event, it is signaled whenever the event is set.
+ * An auto reset event is consumed by the eventfd notification when no
+ * thread waits for it in AMDKFD_IOC_WAIT_EVENTS. Use -1 to detach the
+ * eventfd again.
+ */
+struct kfd_ioctl_set_event_eventfd_args {
+	__u32 event_id;		/* to KFD */
+	__s32 eventfd;		/* to KFD */
+};
+
 struct kfd_memory_exception_failure {
 	__u32 NotPresent;	/* Page not present or supervisor privilege */
 	__u32 ReadOnly;	/* Write access to a read-only page */
@@ -459,6 +473,21 @@ enum kfd_smi_event {
 	KFD_SMI_EVENT_THERMAL_THROTTLE = 2,
 	KFD_SMI_EVENT_GPU_PRE_RESET = 3,
 	KFD_SMI_EVENT_GPU_POST_RESET = 4,
+	KFD_SMI_EVENT_SVM_POLICY = 5,
+	KFD_SMI_EVENT_MIGRATE_START = 6,
+	KFD_SMI_EVENT_MIGRATE_END = 7,
+	KFD_SMI_EVENT_QUEUE_EVICTION = 8,
+	KFD_SMI_EVENT_QUEUE_RESTORE = 9,
+};
+
+/*
+ * Decisions of the SVM migration policy reported with
+ * KFD_SMI_EVENT_SVM_POLICY
+ */
+enum kfd_smi_svm_policy_decision {
+	KFD_SMI_SVM_POLICY_PIN = 1,	/* range thrashes, keep it in place */
+	KFD_SMI_SVM_POLICY_UNPIN = 2,	/* pin expired */
+	KFD_SMI_SVM_POLICY_PREFETCH = 3, /* range migrated ahead of faults */
 };
 
 #define KFD_SMI_EVENT_MASK_FROM_INDEX(i) (1ULL << ((i) - 1))
@@ -468,6 +497,67 @@ struct kfd_ioctl_smi_events_args {
 	__u32 anon_fd;	/* from KFD */
 };
 
+/*
+ * SMI event ring buffer
+ *
+ * Instead of reading text messages from the SMI event file descriptor, the
+ * events can be received as binary records through a ring buffer shared
+ * with KFD. It is created by mmap()ing the file descriptor at offset 0. The
+ * first page holds struct kfd_smi_ring_header, the remaining pages hold the
+ * data, their number must be a power of two.
+ *
+ * KFD writes records at head and user mode consumes them from tail, both
+ * are byte offsets which only grow and are used modulo data_size. Records
+ * never wrap around the end of the data area, KFD fills the rest of the
+ * area with a record of KFD_SMI_EVENT_NONE instead. Events are dropped and
+ * counted in dropped while the ring is full, they are not delivered through
+ * read() once the ring is mapped.
+ */
+struct kfd_smi_ring_header {
+	__u64 head;		/* from KFD, load with acquire semantic */
+	__u64 tail;		/* to KFD, store with release semantic */
+	__u64 dropped;		/* from KFD */
+	__u32 data_size;	/* from KFD */
+	__u32 pad;
+};
+
+struct kfd_smi_record {
+	__u16 size;		/* size of the record in bytes, 8 byte aligned */
+	__u16 event;		/* KFD_SMI_EVENT_* */
+	__u32 pid;		/* process the event belongs to, 0 if none */
+	__u64 timestamp;	/* CLOCK_BOOTTIME in ns */
+	union {
+		struct {
+			char task_name[16];
+		} vmfault;
+		struct {
+			__u64 throttle_bitmask;
+			__u64 interrupt_count;
+		} thermal_throttle;
+		struct {
+			__u64 seq_num;
+		} gpu_reset;
+		struct {
+			__u64 start;	/* first page of the range */
+			__u64 last;	/* last page of the range */
+			__u32 decision;	/* enum kfd_smi_svm_policy_decision */
+			__u32 loc;
+		} svm_policy;
+		struct {
+			__u64 start;	/* first page of the range */
+			__u64 last;	/* last page of the range */
+			__u32 from;	/* gpuid, 0 for system memory */
+			__u32 to;	/* gpuid, 0 for system memory */
+			__u64 bytes;	/* MIGRATE_END only, bytes migrated */
+			__u64 duration;	/* MIGRATE_END only, in ns */
+		} migrate;
+		struct {
+			__u32 gpuid;
+			__u32 pad;
+		} queue;
+	};
+};
+
 /* Register offset inside the remapped mmio page
  */
 enum kfd_mmio_remap {
@@ -599,6 +689,38 @@ struct kfd_ioctl_svm_args {
 	struct kfd_ioctl_svm_attribute attrs[0];
 };
 
+/**
+ * kfd_ioctl_svm_policy_args - Arguments for the SVM migration policy
+ *
+ * @flags:              [in] KFD_IOCTL_SVM_POLICY_FLAG_SET to apply the
+ *                      values below, otherwise they are only returned
+ * @enable:             [in/out] 0 to disable the policy for the process
+ * @window_ms:          [in/out] length of the window faults and migrations
+ *                      of a range are counted in
+ * @thrash_threshold:   [in/out] migrations of a range within a window after
+ *                      which the range is pinned to system memory
+ * @pin_ms:             [in/out] how long a thrashing range stays pinned
+ * @prefetch_granules:  [in/out] number of neighbouring ranges migrated ahead
+ *                      once GPU faults hit adjacent ranges, 0 disables
+ *                      prefetching
+ *
+ * The policy only affects GPU page fault handling, so it requires XNACK
+ * mode. On output all fields contain the (new) current values. Decisions
+ * are reported as KFD_SMI_EVENT_SVM_POLICY events.
+ *
+ * Return: 0 on success, -errno on failure
+ */
+#define KFD_IOCTL_SVM_POLICY_FLAG_SET	(1 << 0)
+
+struct kfd_ioctl_svm_policy_args {
+	__u32 flags;
+	__u32 enable;
+	__u32 window_ms;
+	__u32 thrash_threshold;
+	__u32 pin_ms;
+	__u32 prefetch_granules;
+};
+
 /**
  * kfd_ioctl_set_xnack_mode_args - Arguments for set_xnack_mode
  *
@@ -742,7 +864,13 @@ struct kfd_ioctl_set_xnack_mode_args {
 #define AMDKFD_IOC_SET_XNACK_MODE		\
 		AMDKFD_IOWR(0x21, struct kfd_ioctl_set_xnack_mode_args)
 
+#define AMDKFD_IOC_SVM_POLICY			\
+		AMDKFD_IOWR(0x22, struct kfd_ioctl_svm_policy_args)
+
+#define AMDKFD_IOC_SET_EVENT_EVENTFD		\
+		AMDKFD_IOW(0x23, struct kfd_ioctl_set_event_eventfd_args)
+
 #define AMDKFD_COMMAND_START		0x01
-#define AMDKFD_COMMAND_END		0x22
+#define AMDKFD_COMMAND_END		0x24
 
 #endif
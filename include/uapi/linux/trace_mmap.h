@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_TRACE_MMAP_H_
+#define _UAPI_TRACE_MMAP_H_
+
+#include <linux/types.h>
+
+/**
+ * struct trace_buffer_meta - Ring-buffer meta-page description
+ * @meta_page_size:	Size of this meta-page.
+ * @meta_struct_len:	Size of this structure.
+ * @subbuf_size:	Size of each sub-buffer.
+ * @nr_subbufs:		Number of subbfs in the ring-buffer, including the reader.
+ * @reader.lost_events:	Number of events lost before the reader sub-buffer.
+ * @reader.id:		ID of the sub-buffer handed out to the reader.
+ * @reader.read:	First unread byte of the reader sub-buffer data.
+ * @reader.commit:	End of the reader sub-buffer data handed out.
+ * @entries:		Number of entries in the ring-buffer.
+ * @overrun:		Number of entries lost in the ring-buffer.
+ * @read:		Number of entries that have been read.
+ *
+ * The meta-page is mapped at offset 0 of a trace_pipe_raw file, sub-buffer
+ * with ID n follows at page n + 1. Each sub-buffer starts with the header
+ * described in events/header_page, @reader.read and @reader.commit are
+ * offsets into the data following that header.
+ */
+struct trace_buffer_meta {
+	__u32		meta_page_size;
+	__u32		meta_struct_len;
+
+	__u32		subbuf_size;
+	__u32		nr_subbufs;
+
+	struct {
+		__u64	lost_events;
+		__u32	id;
+		__u32	read;
+		__u32	commit;
+		__u32	__reserved;
+	} reader;
+
+	__u64		entries;
+	__u64		overrun;
+	__u64		read;
+};
+
+/*
+ * Consume the events handed out by the previous call, or by the mmap() for
+ * the first call, and hand out the sub-buffer with the next unread events,
+ * see struct trace_buffer_meta.
+ * Blocks until there is something to read unless the file is O_NONBLOCK.
+ */
+#define TRACE_MMAP_IOCTL_GET_READER		_IO('R', 0x20)
+
+#endif /* _UAPI_TRACE_MMAP_H_ */
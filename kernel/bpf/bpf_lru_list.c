@@ -2,6 +2,8 @@
 /* Copyright (c) 2016 Facebook
  */
 #include <linux/cpumask.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/percpu.h>
 
@@ -13,6 +15,9 @@
 #define PERCPU_FREE_TARGET		(4)
 #define PERCPU_NR_SCANS			PERCPU_FREE_TARGET
 
+#define SHARDED_FREE_TARGET		(16)
+#define SHARDED_NR_SCANS		SHARDED_FREE_TARGET
+
 /* Helpers to get the local list index */
 #define LOCAL_LIST_IDX(t)	((t) - BPF_LOCAL_LIST_T_OFFSET)
 #define LOCAL_FREE_LIST_IDX	LOCAL_LIST_IDX(BPF_LRU_LOCAL_LIST_T_FREE)
@@ -428,6 +433,74 @@ static struct bpf_lru_node *bpf_percpu_lru_pop_free(struct bpf_lru *lru,
 	return node;
 }
 
+/* Move up to SHARDED_FREE_TARGET free nodes from another shard to the
+ * free list of the locked shard @shard.  The other shards are only
+ * trylocked, two shards stealing from each other must not deadlock.
+ */
+static void __bpf_sharded_lru_steal(struct bpf_lru *lru, unsigned int shard,
+				    struct list_head *free_list)
+{
+	struct bpf_lru_node *node, *tmp_node;
+	unsigned int i, victim, nsteal = 0;
+	struct bpf_lru_list *l;
+
+	for (i = 1; i < lru->nr_shards && !nsteal; i++) {
+		victim = (shard + i) % lru->nr_shards;
+		l = &lru->shards[victim];
+
+		if (list_empty(&l->lists[BPF_LRU_LIST_T_FREE]) ||
+		    !raw_spin_trylock(&l->lock))
+			continue;
+
+		list_for_each_entry_safe(node, tmp_node,
+					 &l->lists[BPF_LRU_LIST_T_FREE], list) {
+			node->cpu = shard;
+			list_move(&node->list, free_list);
+			if (++nsteal == SHARDED_FREE_TARGET)
+				break;
+		}
+
+		raw_spin_unlock(&l->lock);
+	}
+}
+
+/* Like the percpu LRU, but the list is picked by the hash.  A shard whose
+ * free list ran dry first takes free nodes from the other shards and only
+ * evicts its own elements once no shard has any free node left.
+ */
+static struct bpf_lru_node *bpf_sharded_lru_pop_free(struct bpf_lru *lru,
+						     u32 hash)
+{
+	unsigned int shard = reciprocal_scale(hash, lru->nr_shards);
+	struct bpf_lru_list *l = &lru->shards[shard];
+	struct bpf_lru_node *node = NULL;
+	struct list_head *free_list;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&l->lock, flags);
+
+	__bpf_lru_list_rotate(lru, l);
+
+	free_list = &l->lists[BPF_LRU_LIST_T_FREE];
+	if (list_empty(free_list))
+		__bpf_sharded_lru_steal(lru, shard, free_list);
+
+	if (list_empty(free_list))
+		__bpf_lru_list_shrink(lru, l, SHARDED_FREE_TARGET, free_list,
+				      BPF_LRU_LIST_T_FREE);
+
+	if (!list_empty(free_list)) {
+		node = list_first_entry(free_list, struct bpf_lru_node, list);
+		*(u32 *)((void *)node + lru->hash_offset) = hash;
+		node->ref = 0;
+		__bpf_lru_node_move(l, node, BPF_LRU_LIST_T_INACTIVE);
+	}
+
+	raw_spin_unlock_irqrestore(&l->lock, flags);
+
+	return node;
+}
+
 static struct bpf_lru_node *bpf_common_lru_pop_free(struct bpf_lru *lru,
 						    u32 hash)
 {
@@ -495,6 +568,8 @@ struct bpf_lru_node *bpf_lru_pop_free(struct bpf_lru *lru, u32 hash)
 {
 	if (lru->percpu)
 		return bpf_percpu_lru_pop_free(lru, hash);
+	else if (lru->nr_shards)
+		return bpf_sharded_lru_pop_free(lru, hash);
 	else
 		return bpf_common_lru_pop_free(lru, hash);
 }
@@ -539,7 +614,10 @@ static void bpf_percpu_lru_push_free(struct bpf_lru *lru,
 	struct bpf_lru_list *l;
 	unsigned long flags;
 
-	l = per_cpu_ptr(lru->percpu_lru, node->cpu);
+	if (lru->nr_shards)
+		l = &lru->shards[node->cpu];
+	else
+		l = per_cpu_ptr(lru->percpu_lru, node->cpu);
 
 	raw_spin_lock_irqsave(&l->lock, flags);
 
@@ -550,7 +628,7 @@ static void bpf_percpu_lru_push_free(struct bpf_lru *lru,
 
 void bpf_lru_push_free(struct bpf_lru *lru, struct bpf_lru_node *node)
 {
-	if (lru->percpu)
+	if (lru->percpu || lru->nr_shards)
 		bpf_percpu_lru_push_free(lru, node);
 	else
 		bpf_common_lru_push_free(lru, node);
@@ -605,12 +683,35 @@ static void bpf_percpu_lru_populate(struct bpf_lru *lru, void *buf,
 	}
 }
 
+static void bpf_sharded_lru_populate(struct bpf_lru *lru, void *buf,
+				     u32 node_offset, u32 elem_size,
+				     u32 nr_elems)
+{
+	struct bpf_lru_list *l;
+	u32 i;
+
+	for (i = 0; i < nr_elems; i++) {
+		struct bpf_lru_node *node;
+
+		l = &lru->shards[i % lru->nr_shards];
+		node = (struct bpf_lru_node *)(buf + node_offset);
+		node->cpu = i % lru->nr_shards;
+		node->type = BPF_LRU_LIST_T_FREE;
+		node->ref = 0;
+		list_add(&node->list, &l->lists[BPF_LRU_LIST_T_FREE]);
+		buf += elem_size;
+	}
+}
+
 void bpf_lru_populate(struct bpf_lru *lru, void *buf, u32 node_offset,
 		      u32 elem_size, u32 nr_elems)
 {
 	if (lru->percpu)
 		bpf_percpu_lru_populate(lru, buf, node_offset, elem_size,
 					nr_elems);
+	else if (lru->nr_shards)
+		bpf_sharded_lru_populate(lru, buf, node_offset, elem_size,
+					 nr_elems);
 	else
 		bpf_common_lru_populate(lru, buf, node_offset, elem_size,
 					nr_elems);
@@ -643,12 +744,27 @@ static void bpf_lru_list_init(struct bpf_lru_list *l)
 	raw_spin_lock_init(&l->lock);
 }
 
-int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
-		 del_from_htab_func del_from_htab, void *del_arg)
+int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 nr_shards,
+		 u32 hash_offset, del_from_htab_func del_from_htab,
+		 void *del_arg)
 {
 	int cpu;
 
-	if (percpu) {
+	if (WARN_ON_ONCE(percpu && nr_shards) || nr_shards > U16_MAX)
+		return -EINVAL;
+
+	if (nr_shards) {
+		u32 i;
+
+		lru->shards = kcalloc(nr_shards, sizeof(*lru->shards),
+				      GFP_KERNEL | __GFP_ACCOUNT);
+		if (!lru->shards)
+			return -ENOMEM;
+
+		for (i = 0; i < nr_shards; i++)
+			bpf_lru_list_init(&lru->shards[i]);
+		lru->nr_scans = SHARDED_NR_SCANS;
+	} else if (percpu) {
 		lru->percpu_lru = alloc_percpu(struct bpf_lru_list);
 		if (!lru->percpu_lru)
 			return -ENOMEM;
@@ -679,6 +795,7 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 	}
 
 	lru->percpu = percpu;
+	lru->nr_shards = nr_shards;
 	lru->del_from_htab = del_from_htab;
 	lru->del_arg = del_arg;
 	lru->hash_offset = hash_offset;
@@ -690,6 +807,8 @@ void bpf_lru_destroy(struct bpf_lru *lru)
 {
 	if (lru->percpu)
 		free_percpu(lru->percpu_lru);
+	else if (lru->nr_shards)
+		kfree(lru->shards);
 	else
 		free_percpu(lru->common_lru.local_list);
 }
@@ -12,6 +12,9 @@
 #define NR_BPF_LRU_LOCAL_LIST_T (2)
 #define BPF_LOCAL_LIST_T_OFFSET NR_BPF_LRU_LIST_T
 
+/* A sharded LRU gets at most one shard per this many elements */
+#define BPF_LRU_SHARD_MIN_ELEMS	(64)
+
 enum bpf_lru_list_type {
 	BPF_LRU_LIST_T_ACTIVE,
 	BPF_LRU_LIST_T_INACTIVE,
@@ -22,6 +25,7 @@ enum bpf_lru_list_type {
 
 struct bpf_lru_node {
 	struct list_head list;
+	/* the owning cpu, or the owning shard of a sharded LRU */
 	u16 cpu;
 	u8 type;
 	u8 ref;
@@ -53,11 +57,13 @@ struct bpf_lru {
 	union {
 		struct bpf_common_lru common_lru;
 		struct bpf_lru_list __percpu *percpu_lru;
+		struct bpf_lru_list *shards;
 	};
 	del_from_htab_func del_from_htab;
 	void *del_arg;
 	unsigned int hash_offset;
 	unsigned int nr_scans;
+	unsigned int nr_shards;
 	bool percpu;
 };
 
@@ -70,7 +76,8 @@ static inline void bpf_lru_node_set_ref(struct bpf_lru_node *node)
 		node->ref = 1;
 }
 
-int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
+int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 nr_shards,
+		 u32 hash_offset,
 		 del_from_htab_func del_from_htab, void *delete_arg);
 void bpf_lru_populate(struct bpf_lru *lru, void *buf, u32 node_offset,
 		      u32 elem_size, u32 nr_elems);
@@ -1845,10 +1845,12 @@ bool bpf_prog_array_compatible(struct bpf_array *array,
 		 */
 		array->aux->owner.type  = fp->type;
 		array->aux->owner.jited = fp->jited;
+		array->aux->owner.xdp_has_frags = fp->aux->xdp_has_frags;
 		ret = true;
 	} else {
 		ret = array->aux->owner.type  == fp->type &&
-		      array->aux->owner.jited == fp->jited;
+		      array->aux->owner.jited == fp->jited &&
+		      array->aux->owner.xdp_has_frags == fp->aux->xdp_has_frags;
 	}
 	spin_unlock(&array->aux->owner.lock);
 	return ret;
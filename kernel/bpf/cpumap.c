@@ -213,10 +213,13 @@ static int cpu_map_bpf_prog_run_xdp(struct bpf_cpu_map_entry *rcpu,
 				    void **frames, int n,
 				    struct xdp_cpumap_stats *stats)
 {
+	struct xdp_frame_bulk bq;
 	struct xdp_rxq_info rxq;
 	struct xdp_buff xdp;
 	int i, nframes = 0;
 
+	xdp_frame_bulk_init(&bq);
+	rcu_read_lock(); /* need for xdp_return_frame_bulk */
 	xdp_set_return_frame_no_direct();
 	xdp.rxq = &rxq;
 
@@ -236,7 +239,7 @@ static int cpu_map_bpf_prog_run_xdp(struct bpf_cpu_map_entry *rcpu,
 		case XDP_PASS:
 			err = xdp_update_frame_from_buff(&xdp, xdpf);
 			if (err < 0) {
-				xdp_return_frame(xdpf);
+				xdp_return_frame_bulk(xdpf, &bq);
 				stats->drop++;
 			} else {
 				frames[nframes++] = xdpf;
@@ -247,7 +250,7 @@ static int cpu_map_bpf_prog_run_xdp(struct bpf_cpu_map_entry *rcpu,
 			err = xdp_do_redirect(xdpf->dev_rx, &xdp,
 					      rcpu->prog);
 			if (unlikely(err)) {
-				xdp_return_frame(xdpf);
+				xdp_return_frame_bulk(xdpf, &bq);
 				stats->drop++;
 			} else {
 				stats->redirect++;
@@ -257,13 +260,15 @@ static int cpu_map_bpf_prog_run_xdp(struct bpf_cpu_map_entry *rcpu,
 			bpf_warn_invalid_xdp_action(NULL, rcpu->prog, act);
 			fallthrough;
 		case XDP_DROP:
-			xdp_return_frame(xdpf);
+			xdp_return_frame_bulk(xdpf, &bq);
 			stats->drop++;
 			break;
 		}
 	}
 
 	xdp_clear_return_frame_no_direct();
+	xdp_flush_frame_bulk(&bq);
+	rcu_read_unlock();
 
 	return nframes;
 }
@@ -16,7 +16,8 @@
 
 #define HTAB_CREATE_FLAG_MASK						\
 	(BPF_F_NO_PREALLOC | BPF_F_NO_COMMON_LRU | BPF_F_NUMA_NODE |	\
-	 BPF_F_ACCESS_MASK | BPF_F_ZERO_SEED)
+	 BPF_F_ACCESS_MASK | BPF_F_ZERO_SEED | BPF_F_RESIZABLE |	\
+	 BPF_F_SHARDED_LRU)
 
 #define BATCH_OPS(_name)			\
 	.map_lookup_batch =			\
@@ -89,9 +90,36 @@ struct bucket {
 #define HASHTAB_MAP_LOCK_COUNT 8
 #define HASHTAB_MAP_LOCK_MASK (HASHTAB_MAP_LOCK_COUNT - 1)
 
+/* BPF_F_RESIZABLE maps start with this many buckets and never shrink below.
+ * It has to be at least HASHTAB_MAP_LOCK_COUNT, so that an element keeps its
+ * map_locked slot when it is moved to the new table.
+ */
+#define HTAB_RESIZE_MIN_BUCKETS 64
+
+/*
+ * The buckets of a hash map and their number. BPF_F_RESIZABLE maps replace
+ * it when the number of elements crosses 3/4 or drops below 3/10 of the
+ * number of buckets, all other maps keep the table they were created with.
+ *
+ * A resize links the new table as @future_tbl and then moves the elements
+ * over bucket by bucket, under the lock of the old bucket. Buckets below
+ * @rehash are empty and updates for them go to @future_tbl, lookups which
+ * don't find an element in a table continue with its @future_tbl. Each
+ * element is moved by making the tail of the old chain the head of the new
+ * one before unlinking it, so it never becomes unreachable. Each table uses
+ * its own range of nulls values (n_buckets + index) and a lookup which ends
+ * up in another chain starts over.
+ */
+struct bucket_table {
+	u32 n_buckets;	/* number of hash buckets */
+	u32 rehash;	/* buckets below this moved to @future_tbl */
+	struct bucket_table __rcu *future_tbl;
+	struct bucket buckets[];
+};
+
 struct bpf_htab {
 	struct bpf_map map;
-	struct bucket *buckets;
+	struct bucket_table __rcu *tbl;
 	void *elems;
 	union {
 		struct pcpu_freelist freelist;
@@ -99,11 +127,15 @@ struct bpf_htab {
 	};
 	struct htab_elem *__percpu *extra_elems;
 	atomic_t count;	/* number of elements in this hashtable */
-	u32 n_buckets;	/* number of hash buckets */
 	u32 elem_size;	/* size of each element in bytes */
 	u32 hashrnd;
 	struct lock_class_key lockdep_key;
 	int __percpu *map_locked[HASHTAB_MAP_LOCK_COUNT];
+	/* BPF_F_RESIZABLE only */
+	struct work_struct resize_work;
+	u32 min_buckets;
+	u32 max_buckets;
+	u64 nr_resizes;
 };
 
 /* each htab element is struct htab_elem + key + value */
@@ -137,25 +169,77 @@ static inline bool htab_use_raw_lock(const struct bpf_htab *htab)
 	return (!IS_ENABLED(CONFIG_PREEMPT_RT) || htab_is_prealloc(htab));
 }
 
-static void htab_init_buckets(struct bpf_htab *htab)
+static inline bool htab_is_resizable(const struct bpf_htab *htab)
+{
+	return htab->map.map_flags & BPF_F_RESIZABLE;
+}
+
+/* The table only changes for BPF_F_RESIZABLE maps, which free the old one
+ * after a grace period. Callers are either under RCU, hold a bucket lock
+ * or own the map.
+ */
+static inline struct bucket_table *htab_tbl(const struct bpf_htab *htab)
+{
+	return rcu_dereference_raw(htab->tbl);
+}
+
+static u32 htab_n_buckets(const struct bpf_htab *htab)
+{
+	u32 n_buckets;
+
+	rcu_read_lock();
+	n_buckets = htab_tbl(htab)->n_buckets;
+	rcu_read_unlock();
+
+	return n_buckets;
+}
+
+static inline struct bucket *__select_bucket(struct bucket_table *tbl, u32 hash)
+{
+	return &tbl->buckets[hash & (tbl->n_buckets - 1)];
+}
+
+static inline struct hlist_nulls_head *select_bucket(struct bucket_table *tbl, u32 hash)
 {
+	return &__select_bucket(tbl, hash)->head;
+}
+
+static void htab_init_buckets(struct bpf_htab *htab, struct bucket_table *tbl)
+{
+	struct bucket *b;
 	unsigned i;
 
-	for (i = 0; i < htab->n_buckets; i++) {
-		INIT_HLIST_NULLS_HEAD(&htab->buckets[i].head, i);
+	for (i = 0; i < tbl->n_buckets; i++) {
+		b = &tbl->buckets[i];
+		INIT_HLIST_NULLS_HEAD(&b->head, tbl->n_buckets + i);
 		if (htab_use_raw_lock(htab)) {
-			raw_spin_lock_init(&htab->buckets[i].raw_lock);
-			lockdep_set_class(&htab->buckets[i].raw_lock,
-					  &htab->lockdep_key);
+			raw_spin_lock_init(&b->raw_lock);
+			lockdep_set_class(&b->raw_lock, &htab->lockdep_key);
 		} else {
-			spin_lock_init(&htab->buckets[i].lock);
-			lockdep_set_class(&htab->buckets[i].lock,
-					  &htab->lockdep_key);
+			spin_lock_init(&b->lock);
+			lockdep_set_class(&b->lock, &htab->lockdep_key);
 		}
 		cond_resched();
 	}
 }
 
+static struct bucket_table *htab_alloc_table(struct bpf_htab *htab,
+					     u32 n_buckets)
+{
+	struct bucket_table *tbl;
+
+	tbl = bpf_map_area_alloc(struct_size(tbl, buckets, n_buckets),
+				 htab->map.numa_node);
+	if (!tbl)
+		return NULL;
+
+	tbl->n_buckets = n_buckets;
+	tbl->rehash = 0;
+	RCU_INIT_POINTER(tbl->future_tbl, NULL);
+	htab_init_buckets(htab, tbl);
+	return tbl;
+}
+
 static inline int htab_lock_bucket(const struct bpf_htab *htab,
 				   struct bucket *b, u32 hash,
 				   unsigned long *pflags)
@@ -193,6 +277,47 @@ static inline void htab_unlock_bucket(const struct bpf_htab *htab,
 	migrate_enable();
 }
 
+/* Lock the bucket which holds @hash, following a resize in progress. */
+static int htab_lock_hash(const struct bpf_htab *htab, u32 hash,
+			  struct bucket **pb, unsigned long *pflags)
+{
+	struct bucket_table *tbl = htab_tbl(htab);
+	struct bucket *b;
+	int ret;
+
+	for (;;) {
+		b = __select_bucket(tbl, hash);
+		ret = htab_lock_bucket(htab, b, hash, pflags);
+		if (ret)
+			return ret;
+		if (likely((hash & (tbl->n_buckets - 1)) >= READ_ONCE(tbl->rehash)))
+			break;
+		htab_unlock_bucket(htab, b, hash, *pflags);
+		tbl = rcu_dereference_raw(tbl->future_tbl);
+	}
+
+	*pb = b;
+	return 0;
+}
+
+static void htab_bucket_lock_nested(const struct bpf_htab *htab,
+				    struct bucket *b)
+{
+	if (htab_use_raw_lock(htab))
+		raw_spin_lock_nested(&b->raw_lock, SINGLE_DEPTH_NESTING);
+	else
+		spin_lock_nested(&b->lock, SINGLE_DEPTH_NESTING);
+}
+
+static void htab_bucket_unlock_nested(const struct bpf_htab *htab,
+				      struct bucket *b)
+{
+	if (htab_use_raw_lock(htab))
+		raw_spin_unlock(&b->raw_lock);
+	else
+		spin_unlock(&b->lock);
+}
+
 static bool htab_lru_map_delete_node(void *arg, struct bpf_lru_node *node);
 
 static bool htab_is_lru(const struct bpf_htab *htab)
@@ -303,6 +428,16 @@ static struct htab_elem *prealloc_lru_pop(struct bpf_htab *htab, void *key,
 	return NULL;
 }
 
+/* one LRU shard per possible cpu, as long as each gets a useful share */
+static u32 htab_lru_nr_shards(const struct bpf_htab *htab)
+{
+	if (!(htab->map.map_flags & BPF_F_SHARDED_LRU))
+		return 0;
+
+	return clamp_t(u32, htab->map.max_entries / BPF_LRU_SHARD_MIN_ELEMS,
+		       1, num_possible_cpus());
+}
+
 static int prealloc_init(struct bpf_htab *htab)
 {
 	u32 num_entries = htab->map.max_entries;
@@ -336,6 +471,7 @@ static int prealloc_init(struct bpf_htab *htab)
 	if (htab_is_lru(htab))
 		err = bpf_lru_init(&htab->lru,
 				   htab->map.map_flags & BPF_F_NO_COMMON_LRU,
+				   htab_lru_nr_shards(htab),
 				   offsetof(struct htab_elem, hash) -
 				   offsetof(struct htab_elem, lru_node),
 				   htab_lru_map_delete_node,
@@ -395,6 +531,109 @@ static int alloc_extra_elems(struct bpf_htab *htab)
 	return 0;
 }
 
+static u32 htab_resize_target(struct bpf_htab *htab, u32 n_buckets)
+{
+	u32 count = atomic_read(&htab->count);
+
+	while (n_buckets < htab->max_buckets && count > n_buckets / 4 * 3)
+		n_buckets <<= 1;
+	while (n_buckets > htab->min_buckets && count < n_buckets / 10 * 3)
+		n_buckets >>= 1;
+
+	return n_buckets;
+}
+
+/* Called after the number of elements of a resizable map changed. */
+static void htab_resize_check(struct bpf_htab *htab)
+{
+	struct bucket_table *tbl;
+
+	if (!htab_is_resizable(htab) || work_pending(&htab->resize_work) ||
+	    in_nmi())
+		return;
+
+	tbl = htab_tbl(htab);
+	if (htab_resize_target(htab, tbl->n_buckets) != tbl->n_buckets)
+		queue_work(system_unbound_wq, &htab->resize_work);
+}
+
+/* Move the elements of bucket @i of @old to @new, see struct bucket_table. */
+static int htab_rehash_bucket(struct bpf_htab *htab, struct bucket_table *old,
+			      struct bucket_table *new, u32 i)
+{
+	struct hlist_nulls_node *n, *first, **pprev;
+	struct bucket *ob = &old->buckets[i], *nb;
+	struct htab_elem *l, *tail;
+	unsigned long flags;
+	int ret;
+
+	ret = htab_lock_bucket(htab, ob, i, &flags);
+	if (ret)
+		return ret;
+
+	while (!hlist_nulls_empty(&ob->head)) {
+		tail = NULL;
+		hlist_nulls_for_each_entry(l, n, &ob->head, hash_node)
+			tail = l;
+
+		/* the lock slot doesn't change, n_buckets >= HASHTAB_MAP_LOCK_COUNT */
+		nb = __select_bucket(new, tail->hash);
+		htab_bucket_lock_nested(htab, nb);
+
+		pprev = tail->hash_node.pprev;
+		first = nb->head.first;
+		WRITE_ONCE(tail->hash_node.next, first);
+		if (!is_a_nulls(first))
+			WRITE_ONCE(first->pprev, &tail->hash_node.next);
+		WRITE_ONCE(tail->hash_node.pprev, &nb->head.first);
+		rcu_assign_pointer(hlist_nulls_first_rcu(&nb->head),
+				   &tail->hash_node);
+		/* only unlink it once it can be found in @new */
+		smp_store_release(pprev, (struct hlist_nulls_node *)
+				  NULLS_MARKER(old->n_buckets + i));
+
+		htab_bucket_unlock_nested(htab, nb);
+	}
+
+	WRITE_ONCE(old->rehash, i + 1);
+	htab_unlock_bucket(htab, ob, i, flags);
+	return 0;
+}
+
+static void htab_resize_work(struct work_struct *work)
+{
+	struct bpf_htab *htab = container_of(work, struct bpf_htab, resize_work);
+	struct bucket_table *old = rcu_dereference_protected(htab->tbl, true);
+	struct bucket_table *new;
+	u32 n_buckets, i;
+
+	n_buckets = htab_resize_target(htab, old->n_buckets);
+	if (n_buckets == old->n_buckets)
+		return;
+
+	new = htab_alloc_table(htab, n_buckets);
+	if (!new)
+		return;
+
+	rcu_assign_pointer(old->future_tbl, new);
+	for (i = 0; i < old->n_buckets; i++) {
+		/* -EBUSY if a program interrupted an update on this cpu */
+		while (htab_rehash_bucket(htab, old, new, i))
+			cond_resched();
+		cond_resched();
+	}
+
+	rcu_assign_pointer(htab->tbl, new);
+	WRITE_ONCE(htab->nr_resizes, htab->nr_resizes + 1);
+
+	/* lookups and updates may still walk from @old into @new */
+	synchronize_rcu();
+	bpf_map_area_free(old);
+
+	/* the map may have kept growing or shrinking meanwhile */
+	htab_resize_check(htab);
+}
+
 /* Called from syscall */
 static int htab_map_alloc_check(union bpf_attr *attr)
 {
@@ -410,6 +649,8 @@ static int htab_map_alloc_check(union bpf_attr *attr)
 	bool percpu_lru = (attr->map_flags & BPF_F_NO_COMMON_LRU);
 	bool prealloc = !(attr->map_flags & BPF_F_NO_PREALLOC);
 	bool zero_seed = (attr->map_flags & BPF_F_ZERO_SEED);
+	bool resizable = (attr->map_flags & BPF_F_RESIZABLE);
+	bool sharded_lru = (attr->map_flags & BPF_F_SHARDED_LRU);
 	int numa_node = bpf_map_attr_numa_node(attr);
 
 	BUILD_BUG_ON(offsetof(struct htab_elem, htab) !=
@@ -434,9 +675,18 @@ static int htab_map_alloc_check(union bpf_attr *attr)
 	if (!lru && percpu_lru)
 		return -EINVAL;
 
+	if (sharded_lru && (!lru || percpu_lru))
+		return -EINVAL;
+
 	if (lru && !prealloc)
 		return -ENOTSUPP;
 
+	/* only elements allocated on demand can be moved to another table */
+	if (resizable && (prealloc ||
+			  (attr->map_type != BPF_MAP_TYPE_HASH &&
+			   attr->map_type != BPF_MAP_TYPE_PERCPU_HASH)))
+		return -EINVAL;
+
 	if (numa_node != NUMA_NO_NODE && (percpu || percpu_lru))
 		return -EINVAL;
 
@@ -472,7 +722,9 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 	 */
 	bool percpu_lru = (attr->map_flags & BPF_F_NO_COMMON_LRU);
 	bool prealloc = !(attr->map_flags & BPF_F_NO_PREALLOC);
+	struct bucket_table *tbl;
 	struct bpf_htab *htab;
+	u32 n_buckets;
 	int err, i;
 
 	htab = kzalloc(sizeof(*htab), GFP_USER | __GFP_ACCOUNT);
@@ -496,7 +748,7 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 	}
 
 	/* hash table size must be power of 2 */
-	htab->n_buckets = roundup_pow_of_two(htab->map.max_entries);
+	n_buckets = roundup_pow_of_two(htab->map.max_entries);
 
 	htab->elem_size = sizeof(struct htab_elem) +
 			  round_up(htab->map.key_size, 8);
@@ -507,17 +759,20 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 
 	err = -E2BIG;
 	/* prevent zero size kmalloc and check for u32 overflow */
-	if (htab->n_buckets == 0 ||
-	    htab->n_buckets > U32_MAX / sizeof(struct bucket))
+	if (n_buckets == 0 ||
+	    n_buckets > (U32_MAX - sizeof(*tbl)) / sizeof(struct bucket))
 		goto free_htab;
 
-	err = -ENOMEM;
-	htab->buckets = bpf_map_area_alloc(htab->n_buckets *
-					   sizeof(struct bucket),
-					   htab->map.numa_node);
-	if (!htab->buckets)
-		goto free_htab;
+	htab->max_buckets = n_buckets;
+	htab->min_buckets = n_buckets;
+	if (htab_is_resizable(htab)) {
+		htab->min_buckets = min_t(u32, n_buckets,
+					  HTAB_RESIZE_MIN_BUCKETS);
+		n_buckets = htab->min_buckets;
+	}
+	INIT_WORK(&htab->resize_work, htab_resize_work);
 
+	err = -ENOMEM;
 	for (i = 0; i < HASHTAB_MAP_LOCK_COUNT; i++) {
 		htab->map_locked[i] = bpf_map_alloc_percpu(&htab->map,
 							   sizeof(int),
@@ -532,7 +787,10 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 	else
 		htab->hashrnd = get_random_int();
 
-	htab_init_buckets(htab);
+	tbl = htab_alloc_table(htab, n_buckets);
+	if (!tbl)
+		goto free_map_locked;
+	RCU_INIT_POINTER(htab->tbl, tbl);
 
 	if (prealloc) {
 		err = prealloc_init(htab);
@@ -556,7 +814,7 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 free_map_locked:
 	for (i = 0; i < HASHTAB_MAP_LOCK_COUNT; i++)
 		free_percpu(htab->map_locked[i]);
-	bpf_map_area_free(htab->buckets);
+	bpf_map_area_free(rcu_dereference_raw(htab->tbl));
 free_htab:
 	lockdep_unregister_key(&htab->lockdep_key);
 	kfree(htab);
@@ -568,16 +826,6 @@ static inline u32 htab_map_hash(const void *key, u32 key_len, u32 hashrnd)
 	return jhash(key, key_len, hashrnd);
 }
 
-static inline struct bucket *__select_bucket(struct bpf_htab *htab, u32 hash)
-{
-	return &htab->buckets[hash & (htab->n_buckets - 1)];
-}
-
-static inline struct hlist_nulls_head *select_bucket(struct bpf_htab *htab, u32 hash)
-{
-	return &__select_bucket(htab, hash)->head;
-}
-
 /* this lookup function can only be called with bucket lock taken */
 static struct htab_elem *lookup_elem_raw(struct hlist_nulls_head *head, u32 hash,
 					 void *key, u32 key_size)
@@ -608,12 +856,35 @@ static struct htab_elem *lookup_nulls_elem_raw(struct hlist_nulls_head *head,
 		if (l->hash == hash && !memcmp(&l->key, key, key_size))
 			return l;
 
-	if (unlikely(get_nulls_value(n) != (hash & (n_buckets - 1))))
+	if (unlikely(get_nulls_value(n) != n_buckets + (hash & (n_buckets - 1))))
 		goto again;
 
 	return NULL;
 }
 
+/* can be called without bucket lock, looks into the table a resize in
+ * progress moves the elements to when they are not found in the current one
+ */
+static struct htab_elem *htab_lookup_nulls_elem(struct bpf_htab *htab,
+						u32 hash, void *key,
+						u32 key_size)
+{
+	struct bucket_table *tbl = htab_tbl(htab);
+	struct htab_elem *l;
+
+	do {
+		l = lookup_nulls_elem_raw(select_bucket(tbl, hash), hash, key,
+					  key_size, tbl->n_buckets);
+		if (l)
+			return l;
+		/* pairs with smp_store_release() in htab_rehash_bucket() */
+		smp_rmb();
+		tbl = rcu_dereference_raw(tbl->future_tbl);
+	} while (unlikely(tbl));
+
+	return NULL;
+}
+
 /* Called from syscall or from eBPF program directly, so
  * arguments have to match bpf_map_lookup_elem() exactly.
  * The return value is adjusted by BPF instructions
@@ -622,7 +893,6 @@ static struct htab_elem *lookup_nulls_elem_raw(struct hlist_nulls_head *head,
 static void *__htab_map_lookup_elem(struct bpf_map *map, void *key)
 {
 	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
-	struct hlist_nulls_head *head;
 	struct htab_elem *l;
 	u32 hash, key_size;
 
@@ -633,9 +903,7 @@ static void *__htab_map_lookup_elem(struct bpf_map *map, void *key)
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
 
-	head = select_bucket(htab, hash);
-
-	l = lookup_nulls_elem_raw(head, hash, key, key_size, htab->n_buckets);
+	l = htab_lookup_nulls_elem(htab, hash, key, key_size);
 
 	return l;
 }
@@ -747,12 +1015,11 @@ static bool htab_lru_map_delete_node(void *arg, struct bpf_lru_node *node)
 	int ret;
 
 	tgt_l = container_of(node, struct htab_elem, lru_node);
-	b = __select_bucket(htab, tgt_l->hash);
-	head = &b->head;
 
-	ret = htab_lock_bucket(htab, b, tgt_l->hash, &flags);
+	ret = htab_lock_hash(htab, tgt_l->hash, &b, &flags);
 	if (ret)
 		return false;
+	head = &b->head;
 
 	hlist_nulls_for_each_entry_rcu(l, n, head, hash_node)
 		if (l == tgt_l) {
@@ -770,6 +1037,7 @@ static bool htab_lru_map_delete_node(void *arg, struct bpf_lru_node *node)
 static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 {
 	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
+	struct bucket_table *tbl = htab_tbl(htab);
 	struct hlist_nulls_head *head;
 	struct htab_elem *l, *next_l;
 	u32 hash, key_size;
@@ -784,13 +1052,21 @@ static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
 
-	head = select_bucket(htab, hash);
-
-	/* lookup the key */
-	l = lookup_nulls_elem_raw(head, hash, key, key_size, htab->n_buckets);
+	/* lookup the key, continue in the table of a resize if it was moved */
+	for (;;) {
+		head = select_bucket(tbl, hash);
+		l = lookup_nulls_elem_raw(head, hash, key, key_size,
+					  tbl->n_buckets);
+		if (l || !rcu_access_pointer(tbl->future_tbl))
+			break;
+		smp_rmb();
+		tbl = rcu_dereference_raw(tbl->future_tbl);
+	}
 
-	if (!l)
+	if (!l) {
+		tbl = htab_tbl(htab);
 		goto find_first_elem;
+	}
 
 	/* key was found, get next key in the same bucket */
 	next_l = hlist_nulls_entry_safe(rcu_dereference_raw(hlist_nulls_next_rcu(&l->hash_node)),
@@ -803,13 +1079,13 @@ static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 	}
 
 	/* no more elements in this hash list, go to the next bucket */
-	i = hash & (htab->n_buckets - 1);
+	i = hash & (tbl->n_buckets - 1);
 	i++;
 
 find_first_elem:
 	/* iterate over buckets */
-	for (; i < htab->n_buckets; i++) {
-		head = select_bucket(htab, i);
+	for (; i < tbl->n_buckets; i++) {
+		head = select_bucket(tbl, i);
 
 		/* pick first element in the bucket */
 		next_l = hlist_nulls_entry_safe(rcu_dereference_raw(hlist_nulls_first_rcu(head)),
@@ -863,6 +1139,7 @@ static void free_htab_elem(struct bpf_htab *htab, struct htab_elem *l)
 		atomic_dec(&htab->count);
 		l->htab = htab;
 		call_rcu(&l->rcu, htab_elem_free_rcu);
+		htab_resize_check(htab);
 	}
 }
 
@@ -963,6 +1240,7 @@ static struct htab_elem *alloc_htab_elem(struct bpf_htab *htab, void *key,
 		}
 		check_and_init_map_value(&htab->map,
 					 l_new->key + round_up(key_size, 8));
+		htab_resize_check(htab);
 	}
 
 	memcpy(l_new->key, key, key_size);
@@ -1038,15 +1316,11 @@ static int htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
 
-	b = __select_bucket(htab, hash);
-	head = &b->head;
-
 	if (unlikely(map_flags & BPF_F_LOCK)) {
 		if (unlikely(!map_value_has_spin_lock(map)))
 			return -EINVAL;
 		/* find an element without taking the bucket lock */
-		l_old = lookup_nulls_elem_raw(head, hash, key, key_size,
-					      htab->n_buckets);
+		l_old = htab_lookup_nulls_elem(htab, hash, key, key_size);
 		ret = check_flags(htab, l_old, map_flags);
 		if (ret)
 			return ret;
@@ -1063,9 +1337,10 @@ static int htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 		 */
 	}
 
-	ret = htab_lock_bucket(htab, b, hash, &flags);
+	ret = htab_lock_hash(htab, hash, &b, &flags);
 	if (ret)
 		return ret;
+	head = &b->head;
 
 	l_old = lookup_elem_raw(head, hash, key, key_size);
 
@@ -1140,9 +1415,6 @@ static int htab_lru_map_update_elem(struct bpf_map *map, void *key, void *value,
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
 
-	b = __select_bucket(htab, hash);
-	head = &b->head;
-
 	/* For LRU, we need to alloc before taking bucket's
 	 * spinlock because getting free nodes from LRU may need
 	 * to remove older elements from htab and this removal
@@ -1154,9 +1426,10 @@ static int htab_lru_map_update_elem(struct bpf_map *map, void *key, void *value,
 	copy_map_value(&htab->map,
 		       l_new->key + round_up(map->key_size, 8), value);
 
-	ret = htab_lock_bucket(htab, b, hash, &flags);
+	ret = htab_lock_hash(htab, hash, &b, &flags);
 	if (ret)
 		return ret;
+	head = &b->head;
 
 	l_old = lookup_elem_raw(head, hash, key, key_size);
 
@@ -1208,12 +1481,10 @@ static int __htab_percpu_map_update_elem(struct bpf_map *map, void *key,
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
 
-	b = __select_bucket(htab, hash);
-	head = &b->head;
-
-	ret = htab_lock_bucket(htab, b, hash, &flags);
+	ret = htab_lock_hash(htab, hash, &b, &flags);
 	if (ret)
 		return ret;
+	head = &b->head;
 
 	l_old = lookup_elem_raw(head, hash, key, key_size);
 
@@ -1263,9 +1534,6 @@ static int __htab_lru_percpu_map_update_elem(struct bpf_map *map, void *key,
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
 
-	b = __select_bucket(htab, hash);
-	head = &b->head;
-
 	/* For LRU, we need to alloc before taking bucket's
 	 * spinlock because LRU's elem alloc may need
 	 * to remove older elem from htab and this removal
@@ -1277,9 +1545,10 @@ static int __htab_lru_percpu_map_update_elem(struct bpf_map *map, void *key,
 			return -ENOMEM;
 	}
 
-	ret = htab_lock_bucket(htab, b, hash, &flags);
+	ret = htab_lock_hash(htab, hash, &b, &flags);
 	if (ret)
 		return ret;
+	head = &b->head;
 
 	l_old = lookup_elem_raw(head, hash, key, key_size);
 
@@ -1337,12 +1606,11 @@ static int htab_map_delete_elem(struct bpf_map *map, void *key)
 	key_size = map->key_size;
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
-	b = __select_bucket(htab, hash);
-	head = &b->head;
 
-	ret = htab_lock_bucket(htab, b, hash, &flags);
+	ret = htab_lock_hash(htab, hash, &b, &flags);
 	if (ret)
 		return ret;
+	head = &b->head;
 
 	l = lookup_elem_raw(head, hash, key, key_size);
 
@@ -1373,12 +1641,11 @@ static int htab_lru_map_delete_elem(struct bpf_map *map, void *key)
 	key_size = map->key_size;
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
-	b = __select_bucket(htab, hash);
-	head = &b->head;
 
-	ret = htab_lock_bucket(htab, b, hash, &flags);
+	ret = htab_lock_hash(htab, hash, &b, &flags);
 	if (ret)
 		return ret;
+	head = &b->head;
 
 	l = lookup_elem_raw(head, hash, key, key_size);
 
@@ -1395,10 +1662,11 @@ static int htab_lru_map_delete_elem(struct bpf_map *map, void *key)
 
 static void delete_all_elements(struct bpf_htab *htab)
 {
+	struct bucket_table *tbl = htab_tbl(htab);
 	int i;
 
-	for (i = 0; i < htab->n_buckets; i++) {
-		struct hlist_nulls_head *head = select_bucket(htab, i);
+	for (i = 0; i < tbl->n_buckets; i++) {
+		struct hlist_nulls_head *head = select_bucket(tbl, i);
 		struct hlist_nulls_node *n;
 		struct htab_elem *l;
 
@@ -1414,8 +1682,9 @@ static void htab_free_malloced_timers(struct bpf_htab *htab)
 	int i;
 
 	rcu_read_lock();
-	for (i = 0; i < htab->n_buckets; i++) {
-		struct hlist_nulls_head *head = select_bucket(htab, i);
+	/* the table may be replaced by a resize while we reschedule */
+	for (i = 0; i < htab_tbl(htab)->n_buckets; i++) {
+		struct hlist_nulls_head *head = select_bucket(htab_tbl(htab), i);
 		struct hlist_nulls_node *n;
 		struct htab_elem *l;
 
@@ -1449,6 +1718,11 @@ static void htab_map_free(struct bpf_map *map)
 	 * There is no need to synchronize_rcu() here to protect map elements.
 	 */
 
+	/* a resize may still be moving elements or waiting to free the old
+	 * table
+	 */
+	cancel_work_sync(&htab->resize_work);
+
 	/* some of free_htab_elem() callbacks for elements of this map may
 	 * not have executed. Wait for them.
 	 */
@@ -1459,7 +1733,7 @@ static void htab_map_free(struct bpf_map *map)
 		prealloc_destroy(htab);
 
 	free_percpu(htab->extra_elems);
-	bpf_map_area_free(htab->buckets);
+	bpf_map_area_free(htab_tbl(htab));
 	for (i = 0; i < HASHTAB_MAP_LOCK_COUNT; i++)
 		free_percpu(htab->map_locked[i]);
 	lockdep_unregister_key(&htab->lockdep_key);
@@ -1502,12 +1776,11 @@ static int __htab_map_lookup_and_delete_elem(struct bpf_map *map, void *key,
 	key_size = map->key_size;
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
-	b = __select_bucket(htab, hash);
-	head = &b->head;
 
-	ret = htab_lock_bucket(htab, b, hash, &bflags);
+	ret = htab_lock_hash(htab, hash, &b, &bflags);
 	if (ret)
 		return ret;
+	head = &b->head;
 
 	l = lookup_elem_raw(head, hash, key, key_size);
 	if (!l) {
@@ -1597,6 +1870,7 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 	u32 batch, max_count, size, bucket_size;
 	struct htab_elem *node_to_free = NULL;
 	u64 elem_map_flags, map_flags;
+	struct bucket_table *tbl;
 	struct hlist_nulls_head *head;
 	struct hlist_nulls_node *n;
 	unsigned long flags = 0;
@@ -1625,7 +1899,7 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 	if (ubatch && copy_from_user(&batch, ubatch, sizeof(batch)))
 		return -EFAULT;
 
-	if (batch >= htab->n_buckets)
+	if (batch >= htab_n_buckets(htab))
 		return -ENOENT;
 
 	key_size = htab->map.key_size;
@@ -1657,7 +1931,15 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 again_nocopy:
 	dst_key = keys;
 	dst_val = values;
-	b = &htab->buckets[batch];
+	tbl = htab_tbl(htab);
+	if (batch >= tbl->n_buckets) {
+		/* a resize shrank the table since the last call */
+		rcu_read_unlock();
+		bpf_enable_instrumentation();
+		ret = -ENOENT;
+		goto after_loop;
+	}
+	b = &tbl->buckets[batch];
 	head = &b->head;
 	/* do not grab the lock unless need it (bucket_cnt > 0). */
 	if (locked) {
@@ -1758,7 +2040,7 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 	/* If we are not copying data, we can go to next bucket and avoid
 	 * unlocking the rcu.
 	 */
-	if (!bucket_cnt && (batch + 1 < htab->n_buckets)) {
+	if (!bucket_cnt && (batch + 1 < tbl->n_buckets)) {
 		batch++;
 		goto again_nocopy;
 	}
@@ -1775,7 +2057,7 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 
 	total += bucket_cnt;
 	batch++;
-	if (batch >= htab->n_buckets) {
+	if (batch >= htab_n_buckets(htab)) {
 		ret = -ENOENT;
 		goto after_loop;
 	}
@@ -1878,16 +2160,16 @@ static struct htab_elem *
 bpf_hash_map_seq_find_next(struct bpf_iter_seq_hash_map_info *info,
 			   struct htab_elem *prev_elem)
 {
-	const struct bpf_htab *htab = info->htab;
+	struct bpf_htab *htab = info->htab;
 	u32 skip_elems = info->skip_elems;
 	u32 bucket_id = info->bucket_id;
 	struct hlist_nulls_head *head;
 	struct hlist_nulls_node *n;
+	struct bucket_table *tbl;
 	struct htab_elem *elem;
-	struct bucket *b;
 	u32 i, count;
 
-	if (bucket_id >= htab->n_buckets)
+	if (bucket_id >= htab_n_buckets(htab))
 		return NULL;
 
 	/* try to find next elem in the same bucket */
@@ -1901,17 +2183,21 @@ bpf_hash_map_seq_find_next(struct bpf_iter_seq_hash_map_info *info,
 			return elem;
 
 		/* not found, unlock and go to the next bucket */
-		b = &htab->buckets[bucket_id++];
+		bucket_id++;
 		rcu_read_unlock();
 		skip_elems = 0;
 	}
 
-	for (i = bucket_id; i < htab->n_buckets; i++) {
-		b = &htab->buckets[i];
+	for (i = bucket_id; ; i++) {
 		rcu_read_lock();
+		tbl = htab_tbl(htab);
+		if (i >= tbl->n_buckets) {
+			rcu_read_unlock();
+			break;
+		}
 
 		count = 0;
-		head = &b->head;
+		head = select_bucket(tbl, i);
 		hlist_nulls_for_each_entry_rcu(elem, n, head, hash_node) {
 			if (count >= skip_elems) {
 				info->bucket_id = i;
@@ -2053,6 +2339,8 @@ static int bpf_for_each_hash_elem(struct bpf_map *map, bpf_callback_t callback_f
 				  void *callback_ctx, u64 flags)
 {
 	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
+	/* called from a program, the table is kept alive by its RCU section */
+	struct bucket_table *tbl = htab_tbl(htab);
 	struct hlist_nulls_head *head;
 	struct hlist_nulls_node *n;
 	struct htab_elem *elem;
@@ -2075,8 +2363,8 @@ static int bpf_for_each_hash_elem(struct bpf_map *map, bpf_callback_t callback_f
 	 */
 	if (is_percpu)
 		migrate_disable();
-	for (i = 0; i < htab->n_buckets; i++) {
-		b = &htab->buckets[i];
+	for (i = 0; i < tbl->n_buckets; i++) {
+		b = &tbl->buckets[i];
 		rcu_read_lock();
 		head = &b->head;
 		hlist_nulls_for_each_entry_rcu(elem, n, head, hash_node) {
@@ -2105,6 +2393,18 @@ static int bpf_for_each_hash_elem(struct bpf_map *map, bpf_callback_t callback_f
 	return num_elems;
 }
 
+static void htab_map_fill_info(const struct bpf_map *map,
+			       struct bpf_map_info *info)
+{
+	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
+
+	info->nr_buckets = htab_n_buckets(htab);
+	/* preallocated maps don't count their elements */
+	if (!htab_is_prealloc(htab))
+		info->nr_elems = atomic_read(&htab->count);
+	info->nr_resizes = READ_ONCE(htab->nr_resizes);
+}
+
 static int htab_map_btf_id;
 const struct bpf_map_ops htab_map_ops = {
 	.map_meta_equal = bpf_map_meta_equal,
@@ -2121,6 +2421,7 @@ const struct bpf_map_ops htab_map_ops = {
 	.map_seq_show_elem = htab_map_seq_show_elem,
 	.map_set_for_each_callback_args = map_set_for_each_callback_args,
 	.map_for_each_callback = bpf_for_each_hash_elem,
+	.map_fill_info = htab_map_fill_info,
 	BATCH_OPS(htab),
 	.map_btf_name = "bpf_htab",
 	.map_btf_id = &htab_map_btf_id,
@@ -2144,6 +2445,7 @@ const struct bpf_map_ops htab_lru_map_ops = {
 	.map_seq_show_elem = htab_map_seq_show_elem,
 	.map_set_for_each_callback_args = map_set_for_each_callback_args,
 	.map_for_each_callback = bpf_for_each_hash_elem,
+	.map_fill_info = htab_map_fill_info,
 	BATCH_OPS(htab_lru),
 	.map_btf_name = "bpf_htab",
 	.map_btf_id = &htab_lru_map_btf_id,
@@ -2266,6 +2568,7 @@ const struct bpf_map_ops htab_percpu_map_ops = {
 	.map_seq_show_elem = htab_percpu_map_seq_show_elem,
 	.map_set_for_each_callback_args = map_set_for_each_callback_args,
 	.map_for_each_callback = bpf_for_each_hash_elem,
+	.map_fill_info = htab_map_fill_info,
 	BATCH_OPS(htab_percpu),
 	.map_btf_name = "bpf_htab",
 	.map_btf_id = &htab_percpu_map_btf_id,
@@ -2286,6 +2589,7 @@ const struct bpf_map_ops htab_lru_percpu_map_ops = {
 	.map_seq_show_elem = htab_percpu_map_seq_show_elem,
 	.map_set_for_each_callback_args = map_set_for_each_callback_args,
 	.map_for_each_callback = bpf_for_each_hash_elem,
+	.map_fill_info = htab_map_fill_info,
 	BATCH_OPS(htab_lru_percpu),
 	.map_btf_name = "bpf_htab",
 	.map_btf_id = &htab_lru_percpu_map_btf_id,
@@ -2307,8 +2611,8 @@ static void fd_htab_map_free(struct bpf_map *map)
 	struct htab_elem *l;
 	int i;
 
-	for (i = 0; i < htab->n_buckets; i++) {
-		head = select_bucket(htab, i);
+	for (i = 0; i < htab_tbl(htab)->n_buckets; i++) {
+		head = select_bucket(htab_tbl(htab), i);
 
 		hlist_nulls_for_each_entry_safe(l, n, head, hash_node) {
 			void *ptr = fd_htab_map_get_ptr(map, l);
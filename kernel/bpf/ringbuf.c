@@ -36,6 +36,12 @@ struct bpf_ringbuf {
 	u64 mask;
 	struct page **pages;
 	int nr_pages;
+	/* map_extra, if non-zero only wake up the consumer once this many
+	 * bytes are pending, see bpf_ringbuf_wakeup_wmark()
+	 */
+	unsigned long wakeup_wmark;
+	/* consumer position of the last watermark wakeup */
+	unsigned long wakeup_cons_pos;
 	spinlock_t spinlock ____cacheline_aligned_in_smp;
 	/* Consumer and producer counters are put into separate pages to allow
 	 * mapping consumer page as r/w, but restrict producer page to r/o.
@@ -126,7 +132,8 @@ static void bpf_ringbuf_notify(struct irq_work *work)
 	wake_up_all(&rb->waitq);
 }
 
-static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
+static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, u64 wakeup_wmark,
+					     int numa_node)
 {
 	struct bpf_ringbuf *rb;
 
@@ -141,6 +148,9 @@ static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
 	rb->mask = data_sz - 1;
 	rb->consumer_pos = 0;
 	rb->producer_pos = 0;
+	/* a watermark of the ring size or more never wakes up */
+	rb->wakeup_wmark = min_t(u64, wakeup_wmark, data_sz);
+	rb->wakeup_cons_pos = ULONG_MAX;
 
 	return rb;
 }
@@ -169,7 +179,8 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 
 	bpf_map_init_from_attr(&rb_map->map, attr);
 
-	rb_map->rb = bpf_ringbuf_alloc(attr->max_entries, rb_map->map.numa_node);
+	rb_map->rb = bpf_ringbuf_alloc(attr->max_entries, attr->map_extra,
+				       rb_map->map.numa_node);
 	if (!rb_map->rb) {
 		kfree(rb_map);
 		return ERR_PTR(-ENOMEM);
@@ -367,6 +378,27 @@ const struct bpf_func_proto bpf_ringbuf_reserve_proto = {
 	.arg3_type	= ARG_ANYTHING,
 };
 
+/* Instead of waking up the consumer as soon as it caught up, wait until it
+ * has at least wakeup_wmark bytes to read. Only wake it up once for each
+ * position it stopped at, it either still processes the earlier records or
+ * is about to go to sleep at a new position.
+ */
+static void bpf_ringbuf_wakeup_wmark(struct bpf_ringbuf *rb)
+{
+	unsigned long cons_pos, prod_pos;
+
+	cons_pos = smp_load_acquire(&rb->consumer_pos);
+	prod_pos = READ_ONCE(rb->producer_pos);
+	if (prod_pos - cons_pos < rb->wakeup_wmark)
+		return;
+
+	if (READ_ONCE(rb->wakeup_cons_pos) == cons_pos ||
+	    xchg(&rb->wakeup_cons_pos, cons_pos) == cons_pos)
+		return;
+
+	irq_work_queue(&rb->work);
+}
+
 static void bpf_ringbuf_commit(void *sample, u64 flags, bool discard)
 {
 	unsigned long rec_pos, cons_pos;
@@ -383,15 +415,24 @@ static void bpf_ringbuf_commit(void *sample, u64 flags, bool discard)
 	/* update record header with correct final size prefix */
 	xchg(&hdr->len, new_len);
 
+	if (flags & BPF_RB_FORCE_WAKEUP) {
+		irq_work_queue(&rb->work);
+		return;
+	}
+	if (flags & BPF_RB_NO_WAKEUP)
+		return;
+	if (rb->wakeup_wmark) {
+		bpf_ringbuf_wakeup_wmark(rb);
+		return;
+	}
+
 	/* if consumer caught up and is waiting for our record, notify about
 	 * new data availability
 	 */
 	rec_pos = (void *)hdr - (void *)rb->data;
 	cons_pos = smp_load_acquire(&rb->consumer_pos) & rb->mask;
 
-	if (flags & BPF_RB_FORCE_WAKEUP)
-		irq_work_queue(&rb->work);
-	else if (cons_pos == rec_pos && !(flags & BPF_RB_NO_WAKEUP))
+	if (cons_pos == rec_pos)
 		irq_work_queue(&rb->work);
 }
 
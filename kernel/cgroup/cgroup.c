@@ -3683,6 +3683,44 @@ static ssize_t cgroup_cpu_pressure_write(struct kernfs_open_file *of,
 	return cgroup_pressure_write(of, buf, nbytes, PSI_CPU);
 }
 
+static int cgroup_pressure_show(struct seq_file *seq, void *v)
+{
+	struct cgroup *cgrp = seq_css(seq)->cgroup;
+
+	seq_printf(seq, "%d\n", cgrp->psi.enabled);
+
+	return 0;
+}
+
+static ssize_t cgroup_pressure_enable_write(struct kernfs_open_file *of,
+					    char *buf, size_t nbytes,
+					    loff_t off)
+{
+	struct cgroup *cgrp;
+	ssize_t ret;
+	int enable;
+
+	ret = kstrtoint(strstrip(buf), 0, &enable);
+	if (ret)
+		return ret;
+
+	if (enable < 0 || enable > 1)
+		return -ERANGE;
+
+	cgrp = cgroup_kn_lock_live(of->kn, false);
+	if (!cgrp)
+		return -ENOENT;
+
+	if (cgrp->psi.enabled != enable) {
+		cgrp->psi.enabled = enable;
+		psi_cgroup_restart(&cgrp->psi);
+	}
+
+	cgroup_kn_unlock(of->kn);
+
+	return nbytes;
+}
+
 static __poll_t cgroup_pressure_poll(struct kernfs_open_file *of,
 					  poll_table *pt)
 {
@@ -5052,6 +5090,12 @@ static struct cftype cgroup_base_files[] = {
 		.seq_show = cpu_stat_show,
 	},
 #ifdef CONFIG_PSI
+	{
+		.name = "cgroup.pressure",
+		.flags = CFTYPE_PRESSURE | CFTYPE_NOT_ON_ROOT,
+		.seq_show = cgroup_pressure_show,
+		.write = cgroup_pressure_enable_write,
+	},
 	{
 		.name = "io.pressure",
 		.flags = CFTYPE_PRESSURE,
@@ -0,0 +1,724 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * GPU memory cgroup controller
+ *
+ * Charges the device memory regions registered by GPU drivers, VRAM for
+ * example, to the cgroup of the task allocating from them. Every region is
+ * limited with gpumem.max and protected from eviction with gpumem.min and
+ * gpumem.low, using the semantics of memory.max, memory.min and memory.low.
+ * The drivers, or TTM on their behalf, consult the protection when picking
+ * buffers to evict.
+ */
+
+#include <linux/cgroup.h>
+#include <linux/cgroup_gpumem.h>
+#include <linux/mutex.h>
+#include <linux/page_counter.h>
+#include <linux/rculist.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+struct gpumem_cgroup {
+	struct cgroup_subsys_state css;
+
+	/* pool states of this cgroup, one per region it used */
+	struct list_head pools;
+};
+
+struct gpumem_cgroup_region {
+	struct list_head region_node;
+	struct rcu_head rcu;
+
+	/* pool states of all cgroups in this region */
+	struct list_head pools;
+
+	u64 size;
+	char *name;
+};
+
+/**
+ * struct gpumem_cgroup_pool_state: Usage of one region by one cgroup
+ * @region: The region.
+ * @cg: The cgroup, each charge holds a reference to it.
+ * @css_node: Entry in the pools list of @cg.
+ * @region_node: Entry in the pools list of @region.
+ * @rcu: Frees the pool state.
+ * @cnt: Hierarchical usage, limit and protection, in pages.
+ * @evictions: Number of buffers of this cgroup evicted from the region.
+ * @evicted_bytes: Size of those buffers.
+ * @moves: Number of buffers this cgroup moved into the region.
+ * @moved_bytes: Size of those buffers.
+ */
+struct gpumem_cgroup_pool_state {
+	struct gpumem_cgroup_region *region;
+	struct gpumem_cgroup *cg;
+
+	struct list_head css_node;
+	struct list_head region_node;
+	struct rcu_head rcu;
+
+	struct page_counter cnt;
+
+	atomic64_t evictions;
+	atomic64_t evicted_bytes;
+	atomic64_t moves;
+	atomic64_t moved_bytes;
+};
+
+/* Protects the region list and all pool lists, readers may use RCU instead */
+static DEFINE_MUTEX(gpumem_cgroup_mutex);
+static LIST_HEAD(gpumem_cgroup_regions);
+
+/* Root gpumem cgroup */
+static struct gpumem_cgroup root_gpumem_cg;
+
+static inline struct gpumem_cgroup *css_gpumem(struct cgroup_subsys_state *css)
+{
+	return container_of(css, struct gpumem_cgroup, css);
+}
+
+static struct gpumem_cgroup *parent_gpumem(struct gpumem_cgroup *cg)
+{
+	return cg->css.parent ? css_gpumem(cg->css.parent) : NULL;
+}
+
+static unsigned long gpumem_pages(u64 size)
+{
+	return DIV_ROUND_UP_ULL(size, PAGE_SIZE);
+}
+
+static struct gpumem_cgroup_pool_state *
+find_cg_pool(struct gpumem_cgroup *cg, struct gpumem_cgroup_region *region)
+{
+	struct gpumem_cgroup_pool_state *pool;
+
+	list_for_each_entry_rcu(pool, &cg->pools, css_node,
+				lockdep_is_held(&gpumem_cgroup_mutex))
+		if (pool->region == region)
+			return pool;
+
+	return NULL;
+}
+
+static struct gpumem_cgroup_region *find_region_locked(const char *name)
+{
+	struct gpumem_cgroup_region *region;
+
+	lockdep_assert_held(&gpumem_cgroup_mutex);
+
+	list_for_each_entry(region, &gpumem_cgroup_regions, region_node)
+		if (!strcmp(region->name, name))
+			return region;
+
+	return NULL;
+}
+
+static struct gpumem_cgroup_pool_state *
+alloc_cg_pool(struct gpumem_cgroup *cg, struct gpumem_cgroup_region *region,
+	      struct gpumem_cgroup_pool_state *parent)
+{
+	struct gpumem_cgroup_pool_state *pool;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return ERR_PTR(-ENOMEM);
+
+	pool->region = region;
+	pool->cg = cg;
+	page_counter_init(&pool->cnt, parent ? &parent->cnt : NULL);
+
+	list_add_tail(&pool->region_node, &region->pools);
+	list_add_tail_rcu(&pool->css_node, &cg->pools);
+
+	return pool;
+}
+
+static struct gpumem_cgroup_pool_state *
+get_cg_pool_locked(struct gpumem_cgroup *cg, struct gpumem_cgroup_region *region)
+{
+	struct gpumem_cgroup_pool_state *pool, *parent;
+	struct gpumem_cgroup *p, *missing;
+
+	lockdep_assert_held(&gpumem_cgroup_mutex);
+
+	/* Create the missing pools top down, so each can link to its parent */
+	for (;;) {
+		parent = NULL;
+		missing = NULL;
+		for (p = cg; p; p = parent_gpumem(p)) {
+			parent = find_cg_pool(p, region);
+			if (parent)
+				break;
+			missing = p;
+		}
+
+		if (!missing)
+			return parent;
+
+		pool = alloc_cg_pool(missing, region, parent);
+		if (IS_ERR(pool))
+			return pool;
+	}
+}
+
+static struct gpumem_cgroup_pool_state *
+get_cg_pool(struct gpumem_cgroup *cg, struct gpumem_cgroup_region *region)
+{
+	struct gpumem_cgroup_pool_state *pool;
+
+	rcu_read_lock();
+	pool = find_cg_pool(cg, region);
+	rcu_read_unlock();
+	if (pool)
+		return pool;
+
+	mutex_lock(&gpumem_cgroup_mutex);
+	pool = get_cg_pool_locked(cg, region);
+	mutex_unlock(&gpumem_cgroup_mutex);
+
+	return pool;
+}
+
+/**
+ * gpumem_cgroup_register_region() - Make a memory region known to the cgroup.
+ * @size: Size of the region in bytes.
+ * @fmt: Name of the region, unique and without white space, in printf format.
+ *
+ * Context: Process context.
+ * Return: The region to charge allocations to, or an ERR_PTR().
+ */
+struct gpumem_cgroup_region *
+gpumem_cgroup_register_region(u64 size, const char *fmt, ...)
+{
+	struct gpumem_cgroup_region *region;
+	va_list args;
+	char *name;
+
+	va_start(args, fmt);
+	name = kvasprintf(GFP_KERNEL, fmt, args);
+	va_end(args);
+	if (!name)
+		return ERR_PTR(-ENOMEM);
+
+	/* The name is the key in the interface files */
+	if (!*name || strpbrk(name, " \t\n")) {
+		kfree(name);
+		return ERR_PTR(-EINVAL);
+	}
+
+	region = kzalloc(sizeof(*region), GFP_KERNEL);
+	if (!region) {
+		kfree(name);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	INIT_LIST_HEAD(&region->pools);
+	region->size = size;
+	region->name = name;
+
+	mutex_lock(&gpumem_cgroup_mutex);
+	if (find_region_locked(name)) {
+		mutex_unlock(&gpumem_cgroup_mutex);
+		kfree(name);
+		kfree(region);
+		return ERR_PTR(-EEXIST);
+	}
+	list_add_tail_rcu(&region->region_node, &gpumem_cgroup_regions);
+	mutex_unlock(&gpumem_cgroup_mutex);
+
+	return region;
+}
+EXPORT_SYMBOL_GPL(gpumem_cgroup_register_region);
+
+static void gpumem_cgroup_free_region(struct rcu_head *rcu)
+{
+	struct gpumem_cgroup_region *region =
+		container_of(rcu, struct gpumem_cgroup_region, rcu);
+
+	kfree(region->name);
+	kfree(region);
+}
+
+/**
+ * gpumem_cgroup_unregister_region() - Remove a region from the cgroup.
+ * @region: The region, everything charged to it must have been uncharged.
+ *
+ * Context: Process context.
+ */
+void gpumem_cgroup_unregister_region(struct gpumem_cgroup_region *region)
+{
+	struct gpumem_cgroup_pool_state *pool, *next;
+
+	if (IS_ERR_OR_NULL(region))
+		return;
+
+	mutex_lock(&gpumem_cgroup_mutex);
+	list_del_rcu(&region->region_node);
+	list_for_each_entry_safe(pool, next, &region->pools, region_node) {
+		WARN_ON_ONCE(page_counter_read(&pool->cnt));
+		list_del_rcu(&pool->css_node);
+		list_del(&pool->region_node);
+		kfree_rcu(pool, rcu);
+	}
+	mutex_unlock(&gpumem_cgroup_mutex);
+
+	call_rcu(&region->rcu, gpumem_cgroup_free_region);
+}
+EXPORT_SYMBOL_GPL(gpumem_cgroup_unregister_region);
+
+/**
+ * gpumem_cgroup_try_charge() - Charge an allocation to the current cgroup.
+ * @region: Region to allocate from, NULL to charge nothing.
+ * @size: Size of the allocation in bytes.
+ * @ret_pool: Returns the pool state to pass to gpumem_cgroup_uncharge().
+ * @ret_limit_pool: Optional, returns the pool state whose limit was hit on
+ *		    failure. Evicting from below it makes room for the charge,
+ *		    use gpumem_cgroup_pool_state_put() to release it.
+ *
+ * Context: Process context.
+ * Return:
+ * * %0 - Successfully charged, or nothing to charge.
+ * * -EAGAIN - The charge would exceed the gpumem.max of a cgroup.
+ * * -ENOMEM - Out of memory for the pool state.
+ */
+int gpumem_cgroup_try_charge(struct gpumem_cgroup_region *region, u64 size,
+			     struct gpumem_cgroup_pool_state **ret_pool,
+			     struct gpumem_cgroup_pool_state **ret_limit_pool)
+{
+	struct gpumem_cgroup_pool_state *pool;
+	struct page_counter *fail;
+	struct gpumem_cgroup *cg;
+
+	*ret_pool = NULL;
+	if (ret_limit_pool)
+		*ret_limit_pool = NULL;
+
+	if (!region)
+		return 0;
+
+	cg = css_gpumem(task_get_css(current, gpumem_cgrp_id));
+	pool = get_cg_pool(cg, region);
+	if (IS_ERR(pool)) {
+		css_put(&cg->css);
+		return PTR_ERR(pool);
+	}
+
+	if (!page_counter_try_charge(&pool->cnt, gpumem_pages(size), &fail)) {
+		if (ret_limit_pool) {
+			*ret_limit_pool = container_of(fail,
+					struct gpumem_cgroup_pool_state, cnt);
+			css_get(&(*ret_limit_pool)->cg->css);
+		}
+		css_put(&cg->css);
+		return -EAGAIN;
+	}
+
+	/* The charge keeps the cgroup reference until it is uncharged */
+	*ret_pool = pool;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(gpumem_cgroup_try_charge);
+
+/**
+ * gpumem_cgroup_uncharge() - Uncharge an allocation.
+ * @pool: Pool state returned by gpumem_cgroup_try_charge(), may be NULL.
+ * @size: Size the allocation was charged with.
+ *
+ * Context: Any context.
+ */
+void gpumem_cgroup_uncharge(struct gpumem_cgroup_pool_state *pool, u64 size)
+{
+	if (!pool)
+		return;
+
+	page_counter_uncharge(&pool->cnt, gpumem_pages(size));
+	css_put(&pool->cg->css);
+}
+EXPORT_SYMBOL_GPL(gpumem_cgroup_uncharge);
+
+/**
+ * gpumem_cgroup_pool_state_put() - Release a limit pool state.
+ * @pool: Limit pool state returned by gpumem_cgroup_try_charge(), may be NULL.
+ *
+ * Context: Any context.
+ */
+void gpumem_cgroup_pool_state_put(struct gpumem_cgroup_pool_state *pool)
+{
+	if (pool)
+		css_put(&pool->cg->css);
+}
+EXPORT_SYMBOL_GPL(gpumem_cgroup_pool_state_put);
+
+/*
+ * Effective protection as computed for memory.min and memory.low: a child
+ * gets what it asked for and uses, unless its siblings claim more than the
+ * parent gets itself, then the parent's share is split in proportion.
+ */
+static unsigned long effective_protection(unsigned long usage,
+					  unsigned long setting,
+					  unsigned long parent_effective,
+					  unsigned long siblings_protected)
+{
+	unsigned long protected = min(usage, setting);
+
+	if (siblings_protected > parent_effective)
+		return protected * parent_effective / siblings_protected;
+
+	return protected;
+}
+
+/* Update emin and elow from @climit down to @ctest, a descendant of it */
+static void calculate_protection(struct page_counter *climit,
+				 struct page_counter *ctest)
+{
+	struct page_counter *c, *top = climit;
+	unsigned long usage;
+
+	while (top != ctest) {
+		for (c = ctest; c->parent != top; c = c->parent)
+			;
+
+		if (top == climit) {
+			WRITE_ONCE(c->emin, READ_ONCE(c->min));
+			WRITE_ONCE(c->elow, READ_ONCE(c->low));
+		} else {
+			usage = page_counter_read(c);
+			WRITE_ONCE(c->emin, effective_protection(usage,
+				   READ_ONCE(c->min), READ_ONCE(top->emin),
+				   atomic_long_read(&top->children_min_usage)));
+			WRITE_ONCE(c->elow, effective_protection(usage,
+				   READ_ONCE(c->low), READ_ONCE(top->elow),
+				   atomic_long_read(&top->children_low_usage)));
+		}
+
+		top = c;
+	}
+}
+
+/**
+ * gpumem_cgroup_state_evict_valuable() - Check if evicting makes sense.
+ * @limit_pool: Pool state whose limit was hit, or NULL when the region itself
+ *		is full.
+ * @test_pool: Pool state the eviction candidate is charged to, may be NULL.
+ * @ignore_low: Also evict from cgroups within their gpumem.low.
+ * @ret_hit_low: Set to true if a candidate was skipped only because of its
+ *		 gpumem.low, the caller should retry with @ignore_low then.
+ *
+ * Candidates must be charged below @limit_pool for their eviction to make
+ * room. Memory within the effective gpumem.min is never evicted.
+ *
+ * Context: Any context.
+ * Return: True if the candidate should be evicted.
+ */
+bool gpumem_cgroup_state_evict_valuable(struct gpumem_cgroup_pool_state *limit_pool,
+					struct gpumem_cgroup_pool_state *test_pool,
+					bool ignore_low, bool *ret_hit_low)
+{
+	struct page_counter *climit, *ctest, *c;
+	unsigned long usage;
+
+	/* Memory not charged to any cgroup can always go */
+	if (!test_pool)
+		return true;
+
+	ctest = &test_pool->cnt;
+	if (limit_pool) {
+		climit = &limit_pool->cnt;
+		for (c = ctest; c && c != climit; c = c->parent)
+			;
+		if (!c)
+			return false;
+	} else {
+		for (climit = ctest; climit->parent; climit = climit->parent)
+			;
+	}
+
+	if (ctest == climit)
+		return true;
+
+	calculate_protection(climit, ctest);
+	usage = page_counter_read(ctest);
+
+	if (usage <= READ_ONCE(ctest->emin))
+		return false;
+
+	if (usage <= READ_ONCE(ctest->elow) && !ignore_low) {
+		if (ret_hit_low)
+			*ret_hit_low = true;
+		return false;
+	}
+
+	return true;
+}
+EXPORT_SYMBOL_GPL(gpumem_cgroup_state_evict_valuable);
+
+/**
+ * gpumem_cgroup_count_evict() - Account an eviction in gpumem.stat.
+ * @pool: Pool state the evicted memory is charged to, may be NULL.
+ * @size: Size of the evicted memory in bytes.
+ *
+ * Context: Any context.
+ */
+void gpumem_cgroup_count_evict(struct gpumem_cgroup_pool_state *pool, u64 size)
+{
+	if (!pool)
+		return;
+
+	atomic64_inc(&pool->evictions);
+	atomic64_add(size, &pool->evicted_bytes);
+}
+EXPORT_SYMBOL_GPL(gpumem_cgroup_count_evict);
+
+/**
+ * gpumem_cgroup_count_move() - Account a move into a region in gpumem.stat.
+ * @pool: Pool state the moved memory is now charged to, may be NULL.
+ * @size: Size of the moved memory in bytes.
+ *
+ * Context: Any context.
+ */
+void gpumem_cgroup_count_move(struct gpumem_cgroup_pool_state *pool, u64 size)
+{
+	if (!pool)
+		return;
+
+	atomic64_inc(&pool->moves);
+	atomic64_add(size, &pool->moved_bytes);
+}
+EXPORT_SYMBOL_GPL(gpumem_cgroup_count_move);
+
+static unsigned long gpumem_get_current(struct page_counter *cnt)
+{
+	return page_counter_read(cnt);
+}
+
+static unsigned long gpumem_get_min(struct page_counter *cnt)
+{
+	return READ_ONCE(cnt->min);
+}
+
+static unsigned long gpumem_get_low(struct page_counter *cnt)
+{
+	return READ_ONCE(cnt->low);
+}
+
+static unsigned long gpumem_get_max(struct page_counter *cnt)
+{
+	return READ_ONCE(cnt->max);
+}
+
+static void gpumem_set_max(struct page_counter *cnt, unsigned long nr_pages)
+{
+	/* Like memory.max, usage above the new limit is evicted as it's hit */
+	xchg(&cnt->max, nr_pages);
+}
+
+static int gpumem_cgroup_region_show(struct seq_file *sf,
+				     unsigned long (*get)(struct page_counter *),
+				     unsigned long dflt)
+{
+	struct gpumem_cgroup *cg = css_gpumem(seq_css(sf));
+	struct gpumem_cgroup_pool_state *pool;
+	struct gpumem_cgroup_region *region;
+	unsigned long val;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(region, &gpumem_cgroup_regions, region_node) {
+		pool = find_cg_pool(cg, region);
+		val = pool ? get(&pool->cnt) : dflt;
+
+		if (val == PAGE_COUNTER_MAX)
+			seq_printf(sf, "%s max\n", region->name);
+		else
+			seq_printf(sf, "%s %llu\n", region->name,
+				   (u64)val * PAGE_SIZE);
+	}
+	rcu_read_unlock();
+
+	return 0;
+}
+
+static ssize_t gpumem_cgroup_region_write(struct kernfs_open_file *of,
+					  char *buf, size_t nbytes,
+					  void (*set)(struct page_counter *,
+						      unsigned long))
+{
+	struct gpumem_cgroup *cg = css_gpumem(of_css(of));
+	struct gpumem_cgroup_pool_state *pool;
+	struct gpumem_cgroup_region *region;
+	unsigned long nr_pages;
+	char *line, *name;
+	int err = 0;
+
+	/* One "<region> <bytes|max>" pair per line */
+	while (buf && !err) {
+		line = strstrip(strsep(&buf, "\n"));
+		if (!*line)
+			continue;
+
+		name = strsep(&line, " \t");
+		if (!line)
+			return -EINVAL;
+
+		err = page_counter_memparse(skip_spaces(line), "max", &nr_pages);
+		if (err)
+			break;
+
+		mutex_lock(&gpumem_cgroup_mutex);
+		region = find_region_locked(name);
+		pool = region ? get_cg_pool_locked(cg, region) : ERR_PTR(-EINVAL);
+		if (IS_ERR(pool))
+			err = PTR_ERR(pool);
+		else
+			set(&pool->cnt, nr_pages);
+		mutex_unlock(&gpumem_cgroup_mutex);
+	}
+
+	return err ?: nbytes;
+}
+
+static int gpumem_cgroup_capacity_show(struct seq_file *sf, void *v)
+{
+	struct gpumem_cgroup_region *region;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(region, &gpumem_cgroup_regions, region_node)
+		seq_printf(sf, "%s %llu\n", region->name, region->size);
+	rcu_read_unlock();
+
+	return 0;
+}
+
+static int gpumem_cgroup_current_show(struct seq_file *sf, void *v)
+{
+	return gpumem_cgroup_region_show(sf, gpumem_get_current, 0);
+}
+
+static int gpumem_cgroup_min_show(struct seq_file *sf, void *v)
+{
+	return gpumem_cgroup_region_show(sf, gpumem_get_min, 0);
+}
+
+static ssize_t gpumem_cgroup_min_write(struct kernfs_open_file *of, char *buf,
+				       size_t nbytes, loff_t off)
+{
+	return gpumem_cgroup_region_write(of, buf, nbytes,
+					  page_counter_set_min);
+}
+
+static int gpumem_cgroup_low_show(struct seq_file *sf, void *v)
+{
+	return gpumem_cgroup_region_show(sf, gpumem_get_low, 0);
+}
+
+static ssize_t gpumem_cgroup_low_write(struct kernfs_open_file *of, char *buf,
+				       size_t nbytes, loff_t off)
+{
+	return gpumem_cgroup_region_write(of, buf, nbytes,
+					  page_counter_set_low);
+}
+
+static int gpumem_cgroup_max_show(struct seq_file *sf, void *v)
+{
+	return gpumem_cgroup_region_show(sf, gpumem_get_max, PAGE_COUNTER_MAX);
+}
+
+static ssize_t gpumem_cgroup_max_write(struct kernfs_open_file *of, char *buf,
+				       size_t nbytes, loff_t off)
+{
+	return gpumem_cgroup_region_write(of, buf, nbytes, gpumem_set_max);
+}
+
+static int gpumem_cgroup_stat_show(struct seq_file *sf, void *v)
+{
+	struct gpumem_cgroup *cg = css_gpumem(seq_css(sf));
+	struct gpumem_cgroup_pool_state *pool;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(pool, &cg->pools, css_node)
+		seq_printf(sf, "%s evictions=%lld evicted_bytes=%lld moves=%lld moved_bytes=%lld\n",
+			   pool->region->name,
+			   atomic64_read(&pool->evictions),
+			   atomic64_read(&pool->evicted_bytes),
+			   atomic64_read(&pool->moves),
+			   atomic64_read(&pool->moved_bytes));
+	rcu_read_unlock();
+
+	return 0;
+}
+
+/* gpumem cgroup interface files */
+static struct cftype gpumem_cgroup_files[] = {
+	{
+		.name = "capacity",
+		.seq_show = gpumem_cgroup_capacity_show,
+		.flags = CFTYPE_ONLY_ON_ROOT,
+	},
+	{
+		.name = "current",
+		.seq_show = gpumem_cgroup_current_show,
+	},
+	{
+		.name = "min",
+		.write = gpumem_cgroup_min_write,
+		.seq_show = gpumem_cgroup_min_show,
+		.flags = CFTYPE_NOT_ON_ROOT,
+	},
+	{
+		.name = "low",
+		.write = gpumem_cgroup_low_write,
+		.seq_show = gpumem_cgroup_low_show,
+		.flags = CFTYPE_NOT_ON_ROOT,
+	},
+	{
+		.name = "max",
+		.write = gpumem_cgroup_max_write,
+		.seq_show = gpumem_cgroup_max_show,
+		.flags = CFTYPE_NOT_ON_ROOT,
+	},
+	{
+		.name = "stat",
+		.seq_show = gpumem_cgroup_stat_show,
+	},
+	{}
+};
+
+static struct cgroup_subsys_state *
+gpumem_cgroup_css_alloc(struct cgroup_subsys_state *parent_css)
+{
+	struct gpumem_cgroup *cg;
+
+	if (!parent_css) {
+		cg = &root_gpumem_cg;
+	} else {
+		cg = kzalloc(sizeof(*cg), GFP_KERNEL);
+		if (!cg)
+			return ERR_PTR(-ENOMEM);
+	}
+
+	INIT_LIST_HEAD(&cg->pools);
+
+	return &cg->css;
+}
+
+static void gpumem_cgroup_css_free(struct cgroup_subsys_state *css)
+{
+	struct gpumem_cgroup *cg = css_gpumem(css);
+	struct gpumem_cgroup_pool_state *pool, *next;
+
+	mutex_lock(&gpumem_cgroup_mutex);
+	list_for_each_entry_safe(pool, next, &cg->pools, css_node) {
+		list_del_rcu(&pool->css_node);
+		list_del(&pool->region_node);
+		kfree_rcu(pool, rcu);
+	}
+	mutex_unlock(&gpumem_cgroup_mutex);
+
+	kfree(cg);
+}
+
+struct cgroup_subsys gpumem_cgrp_subsys = {
+	.css_alloc = gpumem_cgroup_css_alloc,
+	.css_free = gpumem_cgroup_css_free,
+	.dfl_cftypes = gpumem_cgroup_files,
+};
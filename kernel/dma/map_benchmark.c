@@ -8,6 +8,7 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
+#include <linux/dma-direct.h>
 #include <linux/dma-mapping.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
@@ -16,6 +17,7 @@
 #include <linux/pci.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
+#include <linux/swiotlb.h>
 #include <linux/timekeeping.h>
 
 #define DMA_MAP_BENCHMARK	_IOWR('d', 1, struct map_benchmark)
@@ -27,6 +29,10 @@
 #define DMA_MAP_TO_DEVICE	1
 #define DMA_MAP_FROM_DEVICE	2
 
+/* bounce every mapping through the device's swiotlb pool */
+#define DMA_MAP_SWIOTLB		(1 << 0)
+#define DMA_MAP_FLAGS		DMA_MAP_SWIOTLB
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -39,7 +45,8 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;	/* how many PAGE_SIZE will do map/unmap once a time */
-	__u8 expansion[76];	/* For future use */
+	__u32 flags;	/* DMA_MAP_* benchmark flags */
+	__u8 expansion[72];	/* For future use */
 };
 
 struct map_benchmark_data {
@@ -54,6 +61,30 @@ struct map_benchmark_data {
 	atomic64_t loops;
 };
 
+static dma_addr_t map_benchmark_map(struct map_benchmark_data *map,
+				    void *buf, size_t size)
+{
+#ifdef CONFIG_SWIOTLB
+	if (map->bparam.flags & DMA_MAP_SWIOTLB)
+		return swiotlb_map(map->dev, virt_to_phys(buf), size, map->dir,
+				   0);
+#endif
+	return dma_map_single(map->dev, buf, size, map->dir);
+}
+
+static void map_benchmark_unmap(struct map_benchmark_data *map,
+				dma_addr_t dma_addr, size_t size)
+{
+#ifdef CONFIG_SWIOTLB
+	if (map->bparam.flags & DMA_MAP_SWIOTLB) {
+		swiotlb_tbl_unmap_single(map->dev, dma_to_phys(map->dev, dma_addr),
+					 size, map->dir, 0);
+		return;
+	}
+#endif
+	dma_unmap_single(map->dev, dma_addr, size, map->dir);
+}
+
 static int map_benchmark_thread(void *data)
 {
 	void *buf;
@@ -82,7 +113,7 @@ static int map_benchmark_thread(void *data)
 			memset(buf, 0x66, size);
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, size, map->dir);
+		dma_addr = map_benchmark_map(map, buf, size);
 		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
 			pr_err("dma_map_single failed on %s\n",
 				dev_name(map->dev));
@@ -96,7 +127,7 @@ static int map_benchmark_thread(void *data)
 		ndelay(map->bparam.dma_trans_ns);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		map_benchmark_unmap(map, dma_addr, size);
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
@@ -241,6 +272,25 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		if (map->bparam.flags & ~DMA_MAP_FLAGS) {
+			pr_err("invalid flags\n");
+			return -EINVAL;
+		}
+
+		if (map->bparam.flags & DMA_MAP_SWIOTLB) {
+			if (!is_swiotlb_active(map->dev)) {
+				pr_err("no swiotlb pool for %s\n",
+					dev_name(map->dev));
+				return -EINVAL;
+			}
+
+			if (map->bparam.granule * PAGE_SIZE >
+			    swiotlb_max_mapping_size(map->dev)) {
+				pr_err("granule too large for swiotlb\n");
+				return -EINVAL;
+			}
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
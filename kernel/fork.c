@@ -1043,6 +1043,10 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 	atomic_set(&mm->mm_count, 1);
 	seqcount_init(&mm->write_protect_seq);
 	mmap_init_lock(mm);
+#ifdef CONFIG_MEMBARRIER
+	mutex_init(&mm->membarrier_lock);
+	mm->membarrier_seq = 0;
+#endif
 	INIT_LIST_HEAD(&mm->mmlist);
 	mm_pgtables_bytes_init(mm);
 	mm->map_count = 0;
@@ -1060,6 +1064,10 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 	init_tlb_flush_pending(mm);
 #if defined(CONFIG_TRANSPARENT_HUGEPAGE) && !USE_SPLIT_PMD_PTLOCKS
 	mm->pmd_huge_pte = NULL;
+#endif
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	mm->thp_collapsed = 0;
+	mm->thp_collapsed_hot = 0;
 #endif
 	mm_init_uprobes_state(mm);
 	hugetlb_count_init(mm);
@@ -5608,9 +5608,10 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	/*
 	 * If in_iowait is set, the code below may not trigger any cpufreq
 	 * utilization updates, so do it here explicitly with the IOWAIT flag
-	 * passed.
+	 * passed. in_iowait_boost asks for the same boost for waits which
+	 * are not accounted as iowait.
 	 */
-	if (p->in_iowait)
+	if (p->in_iowait || p->in_iowait_boost)
 		cpufreq_update_util(rq, SCHED_CPUFREQ_IOWAIT);
 
 	for_each_sched_entity(se) {
@@ -6123,6 +6124,27 @@ static inline int find_idlest_cpu(struct sched_domain *sd, struct task_struct *p
 	return new_cpu;
 }
 
+/*
+ * Track which CPUs of the LLC run their idle task, so select_idle_cpu() can
+ * skip the busy ones. Called on every switch to and from the idle task, only
+ * write the shared mask if the state actually changes.
+ */
+void __update_idle_cpus(struct rq *rq, bool idle)
+{
+	struct sched_domain_shared *sds;
+	int cpu = cpu_of(rq);
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (sds && cpumask_test_cpu(cpu, sds_idle_cpus(sds)) != idle) {
+		if (idle)
+			cpumask_set_cpu(cpu, sds_idle_cpus(sds));
+		else
+			cpumask_clear_cpu(cpu, sds_idle_cpus(sds));
+	}
+	rcu_read_unlock();
+}
+
 static inline int __select_idle_cpu(int cpu, struct task_struct *p)
 {
 	if ((available_idle_cpu(cpu) || sched_idle_cpu(cpu)) &&
@@ -6280,8 +6302,20 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 	if (!this_sd)
 		return -1;
 
+	schedstat_inc(this_rq->sis_search);
+
 	cpumask_and(cpus, sched_domain_span(sd), p->cpus_ptr);
 
+	if (sched_feat(SIS_FILTER) && sd->shared) {
+		cpumask_and(cpus, cpus, sds_idle_cpus(sd->shared));
+		if (cpumask_empty(cpus)) {
+			if (has_idle_core)
+				set_idle_cores(target, false);
+			schedstat_inc(this_rq->sis_failed);
+			return -1;
+		}
+	}
+
 	if (sched_feat(SIS_PROP) && !has_idle_core) {
 		u64 avg_cost, avg_idle, span_avg;
 		unsigned long now = jiffies;
@@ -6311,20 +6345,26 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 	}
 
 	for_each_cpu_wrap(cpu, cpus, target + 1) {
+		schedstat_inc(this_rq->sis_scanned);
 		if (has_idle_core) {
 			i = select_idle_core(p, cpu, cpus, &idle_cpu);
 			if ((unsigned int)i < nr_cpumask_bits)
 				return i;
 
 		} else {
-			if (!--nr)
+			if (!--nr) {
+				schedstat_inc(this_rq->sis_failed);
 				return -1;
+			}
 			idle_cpu = __select_idle_cpu(cpu, p);
 			if ((unsigned int)idle_cpu < nr_cpumask_bits)
 				break;
 		}
 	}
 
+	if ((unsigned int)idle_cpu >= nr_cpumask_bits)
+		schedstat_inc(this_rq->sis_failed);
+
 	if (has_idle_core)
 		set_idle_cores(target, false);
 
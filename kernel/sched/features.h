@@ -62,6 +62,12 @@ SCHED_FEAT(TTWU_QUEUE, true)
  */
 SCHED_FEAT(SIS_PROP, true)
 
+/*
+ * When doing wakeups, only scan the CPUs of the LLC domain which are
+ * tracked as idle in sd_llc_shared->idle_cpus.
+ */
+SCHED_FEAT(SIS_FILTER, true)
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
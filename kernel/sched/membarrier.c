@@ -307,11 +307,41 @@ static int membarrier_global_expedited(void)
 	return 0;
 }
 
+/*
+ * Concurrent MEMBARRIER_CMD_PRIVATE_EXPEDITED callers of the same mm are
+ * serialized on mm->membarrier_lock. A caller which finds that a whole
+ * round was started and completed after its entry barrier while it was
+ * waiting for the lock does not need to send its own IPIs: every thread
+ * of the mm went through a full barrier after the caller's prior
+ * accesses. This follows the rcu_seq_snap() scheme, the sequence is odd
+ * while a round is in flight.
+ */
+static unsigned long membarrier_seq_snap(struct mm_struct *mm)
+{
+	return (READ_ONCE(mm->membarrier_seq) + 3) & ~0x1UL;
+}
+
+static void membarrier_seq_start(struct mm_struct *mm)
+{
+	WRITE_ONCE(mm->membarrier_seq, mm->membarrier_seq + 1);
+	/* Order the sequence update before reading rq->curr. */
+	smp_mb();
+}
+
+static void membarrier_seq_end(struct mm_struct *mm)
+{
+	/* Order the IPIs before the sequence update. */
+	smp_mb();
+	WRITE_ONCE(mm->membarrier_seq, mm->membarrier_seq + 1);
+}
+
 static int membarrier_private_expedited(int flags, int cpu_id)
 {
 	cpumask_var_t tmpmask;
 	struct mm_struct *mm = current->mm;
 	smp_call_func_t ipi_func = ipi_mb;
+	bool coalesce = !flags && cpu_id < 0;
+	unsigned long snap;
 
 	if (flags == MEMBARRIER_FLAG_SYNC_CORE) {
 		if (!IS_ENABLED(CONFIG_ARCH_HAS_MEMBARRIER_SYNC_CORE))
@@ -344,8 +374,23 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 	 */
 	smp_mb();	/* system call entry is not a mb. */
 
-	if (cpu_id < 0 && !zalloc_cpumask_var(&tmpmask, GFP_KERNEL))
+	if (coalesce) {
+		snap = membarrier_seq_snap(mm);
+		mutex_lock(&mm->membarrier_lock);
+		if (ULONG_CMP_GE(mm->membarrier_seq, snap)) {
+			mutex_unlock(&mm->membarrier_lock);
+			goto done;
+		}
+	}
+
+	if (cpu_id < 0 && !zalloc_cpumask_var(&tmpmask, GFP_KERNEL)) {
+		if (coalesce)
+			mutex_unlock(&mm->membarrier_lock);
 		return -ENOMEM;
+	}
+
+	if (coalesce)
+		membarrier_seq_start(mm);
 
 	cpus_read_lock();
 
@@ -413,6 +458,12 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 		free_cpumask_var(tmpmask);
 	cpus_read_unlock();
 
+	if (coalesce) {
+		membarrier_seq_end(mm);
+		mutex_unlock(&mm->membarrier_lock);
+	}
+
+done:
 	/*
 	 * Memory barrier on the caller thread _after_ we finished
 	 * waiting for the last IPI. Matches memory barriers around
@@ -544,14 +595,15 @@ static int membarrier_register_private_expedited(int flags)
 /**
  * sys_membarrier - issue memory barriers on a set of threads
  * @cmd:    Takes command values defined in enum membarrier_cmd.
- * @flags:  Currently needs to be 0 for all commands other than
- *          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ: in the latter
- *          case it can be MEMBARRIER_CMD_FLAG_CPU, indicating that @cpu_id
- *          contains the CPU on which to interrupt (= restart)
- *          the RSEQ critical section.
+ * @flags:  Currently needs to be 0 for all commands other than the
+ *          MEMBARRIER_CMD_PRIVATE_EXPEDITED* ones: for those it can be
+ *          MEMBARRIER_CMD_FLAG_CPU, indicating that @cpu_id contains the
+ *          only CPU to interrupt (for RSEQ, to restart the critical
+ *          section on).
  * @cpu_id: if @flags == MEMBARRIER_CMD_FLAG_CPU, indicates the cpu on which
- *          RSEQ CS should be interrupted (@cmd must be
- *          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ).
+ *          the barrier is issued, e.g. the rseq cpu_id of a thread the
+ *          caller wants to synchronize with (@cmd must be one of the
+ *          MEMBARRIER_CMD_PRIVATE_EXPEDITED* commands).
  *
  * If this system call is not implemented, -ENOSYS is returned. If the
  * command specified does not exist, not available on the running
@@ -580,6 +632,8 @@ static int membarrier_register_private_expedited(int flags)
 SYSCALL_DEFINE3(membarrier, int, cmd, unsigned int, flags, int, cpu_id)
 {
 	switch (cmd) {
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE:
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ:
 		if (unlikely(flags && flags != MEMBARRIER_CMD_FLAG_CPU))
 			return -EINVAL;
@@ -176,6 +176,7 @@ __setup("psi=", setup_psi);
 
 /* PSI trigger definitions */
 #define WINDOW_MIN_US 500000	/* Min window size is 500ms */
+#define WINDOW_MIN_PRIV_US 10000 /* 10ms with CAP_SYS_RESOURCE */
 #define WINDOW_MAX_US 10000000	/* Max window size is 10s */
 #define UPDATES_PER_WINDOW 10	/* 10 updates per window */
 
@@ -196,6 +197,7 @@ static void group_init(struct psi_group *group)
 {
 	int cpu;
 
+	group->enabled = true;
 	for_each_possible_cpu(cpu)
 		seqcount_init(&per_cpu_ptr(group->pcpu, cpu)->seq);
 	group->avg_last_update = sched_clock();
@@ -710,7 +712,14 @@ static void psi_group_change(struct psi_group *group, int cpu,
 	 */
 	write_seqcount_begin(&groupc->seq);
 
-	record_times(groupc, now);
+	/*
+	 * With PSI disabled for the group only the task counts are kept
+	 * up to date. The first change after disabling concludes the time
+	 * of the last state, then the group stays in the empty state so
+	 * psi_cgroup_restart() starts from a clean slate.
+	 */
+	if (group->enabled || (groupc->state_mask & (1 << PSI_NONIDLE)))
+		record_times(groupc, now);
 
 	for (t = 0, m = clear; m; m &= ~(1 << t), t++) {
 		if (!(m & (1 << t)))
@@ -731,6 +740,12 @@ static void psi_group_change(struct psi_group *group, int cpu,
 		if (set & (1 << t))
 			groupc->tasks[t]++;
 
+	if (!group->enabled) {
+		groupc->state_mask = 0;
+		write_seqcount_end(&groupc->seq);
+		return;
+	}
+
 	/* Calculate state mask representing active states */
 	for (s = 0; s < NR_PSI_STATES; s++) {
 		if (test_state(groupc->tasks, s))
@@ -977,6 +992,31 @@ void psi_cgroup_free(struct cgroup *cgroup)
 	WARN_ONCE(cgroup->psi.poll_states, "psi: trigger leak\n");
 }
 
+/**
+ * psi_cgroup_restart - restart PSI state tracking of a cgroup
+ * @group: the psi_group of the cgroup, after setting @group->enabled
+ *
+ * While PSI is disabled for a group only its task counts are updated.
+ * Once it is enabled again, rebuild the state of each cpu from those
+ * counts, so stall times are accounted from now on.
+ */
+void psi_cgroup_restart(struct psi_group *group)
+{
+	int cpu;
+
+	if (static_branch_likely(&psi_disabled) || !group->enabled)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+		struct rq_flags rf;
+
+		rq_lock_irq(rq, &rf);
+		psi_group_change(group, cpu, 0, 0, cpu_clock(cpu), true);
+		rq_unlock_irq(rq, &rf);
+	}
+}
+
 /**
  * cgroup_move_task - move task to a different cgroup
  * @task: the task
@@ -1050,7 +1090,7 @@ int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
 	int full;
 	u64 now;
 
-	if (static_branch_likely(&psi_disabled))
+	if (static_branch_likely(&psi_disabled) || !group->enabled)
 		return -EOPNOTSUPP;
 
 	/* Update averages before reporting them */
@@ -1090,7 +1130,7 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group,
 	u32 threshold_us;
 	u32 window_us;
 
-	if (static_branch_likely(&psi_disabled))
+	if (static_branch_likely(&psi_disabled) || !group->enabled)
 		return ERR_PTR(-EOPNOTSUPP);
 
 	if (sscanf(buf, "some %u %u", &threshold_us, &window_us) == 2)
@@ -1103,8 +1143,12 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group,
 	if (state >= PSI_NONIDLE)
 		return ERR_PTR(-EINVAL);
 
-	if (window_us < WINDOW_MIN_US ||
-		window_us > WINDOW_MAX_US)
+	if (window_us > WINDOW_MAX_US)
+		return ERR_PTR(-EINVAL);
+
+	/* Short windows poll often, keep them to privileged monitors */
+	if (window_us < WINDOW_MIN_US &&
+	    (window_us < WINDOW_MIN_PRIV_US || !capable(CAP_SYS_RESOURCE)))
 		return ERR_PTR(-EINVAL);
 
 	/* Check threshold */
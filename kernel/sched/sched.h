@@ -1086,6 +1086,11 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int		ttwu_count;
 	unsigned int		ttwu_local;
+
+	/* select_idle_cpu() stats */
+	unsigned int		sis_search;
+	unsigned int		sis_scanned;
+	unsigned int		sis_failed;
 #endif
 
 #ifdef CONFIG_CPU_IDLE
@@ -1362,6 +1367,15 @@ static inline void update_idle_core(struct rq *rq)
 static inline void update_idle_core(struct rq *rq) { }
 #endif
 
+#ifdef CONFIG_SMP
+static inline struct cpumask *sds_idle_cpus(struct sched_domain_shared *sds)
+{
+	return to_cpumask(sds->idle_cpus);
+}
+
+extern void __update_idle_cpus(struct rq *rq, bool idle);
+#endif
+
 DECLARE_PER_CPU_SHARED_ALIGNED(struct rq, runqueues);
 
 #define cpu_rq(cpu)		(&per_cpu(runqueues, (cpu)))
@@ -2011,6 +2025,16 @@ static const_debug __maybe_unused unsigned int sysctl_sched_features =
 
 #endif /* SCHED_DEBUG */
 
+#ifdef CONFIG_SMP
+static inline void update_idle_cpus(struct rq *rq, bool idle)
+{
+	if (sched_feat(SIS_FILTER))
+		__update_idle_cpus(rq, idle);
+}
+#else
+static inline void update_idle_cpus(struct rq *rq, bool idle) { }
+#endif
+
 extern struct static_key_false sched_numa_balancing;
 extern struct static_key_false sched_schedstats;
 
@@ -27,6 +27,8 @@
 #include <linux/cpu.h>
 #include <linux/oom.h>
 
+#include <uapi/linux/trace_mmap.h>
+
 #include <asm/local.h>
 
 static void update_pages_handler(struct work_struct *work);
@@ -323,6 +325,7 @@ struct buffer_page {
 	unsigned	 read;		/* index for next read */
 	local_t		 entries;	/* entries on this page */
 	unsigned long	 real_end;	/* real end of data */
+	unsigned	 id;		/* ID in the mapping, if mapped */
 	struct buffer_data_page *page;	/* Actual data page */
 };
 
@@ -525,6 +528,12 @@ struct ring_buffer_per_cpu {
 	struct completion		update_done;
 
 	struct rb_irq_work		irq_work;
+
+	/* user space mapping, see ring_buffer_map() */
+	struct mutex			mapping_lock;
+	unsigned int			mapped;
+	unsigned long			*subbuf_ids;	/* ID to data page */
+	struct trace_buffer_meta	*meta_page;
 };
 
 struct trace_buffer {
@@ -1564,7 +1573,8 @@ static int __rb_allocate_pages(struct ring_buffer_per_cpu *cpu_buffer,
 
 		list_add(&bpage->list, pages);
 
-		page = alloc_pages_node(cpu_to_node(cpu_buffer->cpu), mflags, 0);
+		page = alloc_pages_node(cpu_to_node(cpu_buffer->cpu),
+					mflags | __GFP_ZERO, 0);
 		if (!page)
 			goto free_pages;
 		bpage->page = page_address(page);
@@ -1637,6 +1647,7 @@ rb_allocate_cpu_buffer(struct trace_buffer *buffer, long nr_pages, int cpu)
 	init_irq_work(&cpu_buffer->irq_work.work, rb_wake_up_waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.full_waiters);
+	mutex_init(&cpu_buffer->mapping_lock);
 
 	bpage = kzalloc_node(ALIGN(sizeof(*bpage), cache_line_size()),
 			    GFP_KERNEL, cpu_to_node(cpu));
@@ -1646,7 +1657,7 @@ rb_allocate_cpu_buffer(struct trace_buffer *buffer, long nr_pages, int cpu)
 	rb_check_bpage(cpu_buffer, bpage);
 
 	cpu_buffer->reader_page = bpage;
-	page = alloc_pages_node(cpu_to_node(cpu), GFP_KERNEL, 0);
+	page = alloc_pages_node(cpu_to_node(cpu), GFP_KERNEL | __GFP_ZERO, 0);
 	if (!page)
 		goto fail_free_reader;
 	bpage->page = page_address(page);
@@ -5339,6 +5350,11 @@ int ring_buffer_swap_cpu(struct trace_buffer *buffer_a,
 	if (cpu_buffer_a->nr_pages != cpu_buffer_b->nr_pages)
 		goto out;
 
+	/* The pages of a mapped buffer stay where user space expects them */
+	ret = -EBUSY;
+	if (READ_ONCE(cpu_buffer_a->mapped) || READ_ONCE(cpu_buffer_b->mapped))
+		goto out;
+
 	ret = -EAGAIN;
 
 	if (atomic_read(&buffer_a->record_disabled))
@@ -5412,6 +5428,11 @@ void *ring_buffer_alloc_read_page(struct trace_buffer *buffer, int cpu)
 		return ERR_PTR(-ENODEV);
 
 	cpu_buffer = buffer->buffers[cpu];
+
+	/* Mapped buffers are read in place, see ring_buffer_map() */
+	if (READ_ONCE(cpu_buffer->mapped))
+		return ERR_PTR(-EBUSY);
+
 	local_irq_save(flags);
 	arch_spin_lock(&cpu_buffer->lock);
 
@@ -5543,6 +5564,10 @@ int ring_buffer_read_page(struct trace_buffer *buffer,
 
 	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
 
+	/* Swapping out the reader page would break the mapping */
+	if (cpu_buffer->mapped)
+		goto out_unlock;
+
 	reader = rb_get_reader_page(cpu_buffer);
 	if (!reader)
 		goto out_unlock;
@@ -5672,6 +5697,276 @@ int ring_buffer_read_page(struct trace_buffer *buffer,
 }
 EXPORT_SYMBOL_GPL(ring_buffer_read_page);
 
+static void rb_update_meta_page(struct ring_buffer_per_cpu *cpu_buffer)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+	struct buffer_page *reader = cpu_buffer->reader_page;
+
+	WRITE_ONCE(meta->reader.lost_events, cpu_buffer->lost_events);
+	WRITE_ONCE(meta->reader.id, reader->id);
+	WRITE_ONCE(meta->reader.read, reader->read);
+	WRITE_ONCE(meta->reader.commit, rb_page_size(reader));
+
+	WRITE_ONCE(meta->entries, local_read(&cpu_buffer->entries));
+	WRITE_ONCE(meta->overrun, local_read(&cpu_buffer->overrun));
+	WRITE_ONCE(meta->read, cpu_buffer->read);
+
+	/* Some archs have no data cache coherency with user space */
+	flush_dcache_page(virt_to_page(reader->page));
+	flush_dcache_page(virt_to_page(meta));
+}
+
+/*
+ * Number the reader page 0 and the pages of the ring after it.  The IDs
+ * stick to the buffer pages while the reader swaps them in and out of the
+ * ring, which is what lets user space find the reader page in the mapping.
+ */
+static void rb_setup_ids_meta_page(struct ring_buffer_per_cpu *cpu_buffer,
+				   unsigned long *subbuf_ids)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+	unsigned int nr_subbufs = cpu_buffer->nr_pages + 1;
+	struct buffer_page *first_subbuf, *subbuf;
+	unsigned int id = 0;
+
+	subbuf_ids[id] = (unsigned long)cpu_buffer->reader_page->page;
+	cpu_buffer->reader_page->id = id++;
+
+	first_subbuf = subbuf = cpu_buffer->head_page;
+	do {
+		if (RB_WARN_ON(cpu_buffer, id >= nr_subbufs))
+			break;
+
+		subbuf_ids[id] = (unsigned long)subbuf->page;
+		subbuf->id = id++;
+
+		rb_inc_page(&subbuf);
+	} while (subbuf != first_subbuf);
+
+	cpu_buffer->subbuf_ids = subbuf_ids;
+
+	meta->meta_page_size = PAGE_SIZE;
+	meta->meta_struct_len = sizeof(*meta);
+	meta->subbuf_size = PAGE_SIZE;
+	meta->nr_subbufs = nr_subbufs;
+
+	rb_update_meta_page(cpu_buffer);
+}
+
+static int __rb_map_vma(struct ring_buffer_per_cpu *cpu_buffer,
+			struct vm_area_struct *vma)
+{
+	unsigned long nr_pages = vma_pages(vma);
+	struct page **pages;
+	unsigned long i;
+	int err;
+
+	/* The meta page and the sub-buffers, read-only and from the start */
+	if (vma->vm_flags & (VM_WRITE | VM_EXEC))
+		return -EPERM;
+
+	if (!nr_pages || vma->vm_pgoff ||
+	    nr_pages > cpu_buffer->nr_pages + 2)
+		return -EINVAL;
+
+	pages = kcalloc(nr_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	pages[0] = virt_to_page(cpu_buffer->meta_page);
+	for (i = 1; i < nr_pages; i++)
+		pages[i] = virt_to_page((void *)cpu_buffer->subbuf_ids[i - 1]);
+
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	err = vm_insert_pages(vma, vma->vm_start, pages, &nr_pages);
+	kfree(pages);
+
+	return err;
+}
+
+/**
+ * ring_buffer_map - map a per CPU buffer into user space
+ * @buffer: the buffer the CPU buffer belongs to
+ * @cpu: the CPU buffer to map
+ * @vma: the vma to map the buffer into
+ *
+ * Maps the meta page followed by the pages of the CPU buffer read-only
+ * into @vma.  While mapped the pages are read in place through
+ * ring_buffer_map_get_reader() and the buffer can neither be resized nor
+ * swapped, and ring_buffer_read_page() refuses to copy pages out of it.
+ *
+ * Returns 0 on success, negative errno otherwise.
+ */
+int ring_buffer_map(struct trace_buffer *buffer, int cpu,
+		    struct vm_area_struct *vma)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long flags, *subbuf_ids;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (cpu_buffer->mapped) {
+		err = __rb_map_vma(cpu_buffer, vma);
+		if (!err)
+			cpu_buffer->mapped++;
+		goto unlock;
+	}
+
+	/* prevent another thread from changing buffer sizes */
+	mutex_lock(&buffer->mutex);
+
+	cpu_buffer->meta_page = (void *)get_zeroed_page(GFP_KERNEL);
+	subbuf_ids = kcalloc(cpu_buffer->nr_pages + 1, sizeof(*subbuf_ids),
+			     GFP_KERNEL);
+	if (!cpu_buffer->meta_page || !subbuf_ids) {
+		err = -ENOMEM;
+		kfree(subbuf_ids);
+		goto free_meta;
+	}
+
+	atomic_inc(&cpu_buffer->resize_disabled);
+
+	/* ring_buffer_read_page() can't swap pages past this point */
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	rb_setup_ids_meta_page(cpu_buffer, subbuf_ids);
+	cpu_buffer->mapped = 1;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	err = __rb_map_vma(cpu_buffer, vma);
+	if (!err)
+		goto unlock_buffer;
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	cpu_buffer->mapped = 0;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	atomic_dec(&cpu_buffer->resize_disabled);
+	kfree(cpu_buffer->subbuf_ids);
+	cpu_buffer->subbuf_ids = NULL;
+ free_meta:
+	free_page((unsigned long)cpu_buffer->meta_page);
+	cpu_buffer->meta_page = NULL;
+ unlock_buffer:
+	mutex_unlock(&buffer->mutex);
+ unlock:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+
+/**
+ * ring_buffer_unmap - drop a user space mapping of a per CPU buffer
+ * @buffer: the buffer the CPU buffer belongs to
+ * @cpu: the CPU buffer to unmap
+ *
+ * Called once the pages have been unmapped from the vma passed to
+ * ring_buffer_map(), the last unmap frees the meta page.
+ */
+int ring_buffer_unmap(struct trace_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long flags;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		err = -ENODEV;
+		goto unlock;
+	} else if (cpu_buffer->mapped > 1) {
+		cpu_buffer->mapped--;
+		goto unlock;
+	}
+
+	mutex_lock(&buffer->mutex);
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	cpu_buffer->mapped = 0;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	atomic_dec(&cpu_buffer->resize_disabled);
+	kfree(cpu_buffer->subbuf_ids);
+	cpu_buffer->subbuf_ids = NULL;
+	free_page((unsigned long)cpu_buffer->meta_page);
+	cpu_buffer->meta_page = NULL;
+
+	mutex_unlock(&buffer->mutex);
+ unlock:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+
+/**
+ * ring_buffer_map_get_reader - hand out the next events of a mapped buffer
+ * @buffer: the buffer the CPU buffer belongs to
+ * @cpu: the mapped CPU buffer
+ *
+ * Consumes the events handed out by the previous call, from reader.read
+ * up to reader.commit of the meta page, and then points the meta page at
+ * the unread events of the reader page, swapping in the next page of the
+ * ring first if the reader page is done.  No data is copied.
+ *
+ * Returns 0 on success, negative errno otherwise.
+ */
+int ring_buffer_map_get_reader(struct trace_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct buffer_page *reader;
+	unsigned long flags;
+	unsigned int commit;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+
+	if (!cpu_buffer->mapped) {
+		err = -ENODEV;
+		goto out;
+	}
+
+	/*
+	 * Events committed after the last call may not have been seen yet,
+	 * only consume up to what was handed out.  A reset of the buffer
+	 * in between leaves nothing to consume.
+	 */
+	reader = cpu_buffer->reader_page;
+	if (reader->id == cpu_buffer->meta_page->reader.id) {
+		commit = min(cpu_buffer->meta_page->reader.commit,
+			     rb_page_size(reader));
+		while (reader->read < commit)
+			rb_advance_reader(cpu_buffer);
+	}
+
+	/* The meta page already reported these */
+	cpu_buffer->lost_events = 0;
+
+	rb_get_reader_page(cpu_buffer);
+
+	rb_update_meta_page(cpu_buffer);
+ out:
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	return err;
+}
+
 /*
  * We only allocate new buffers, never free them if the CPU goes down.
  * If we were to free the buffer, then the user would lose any trace that was in
@@ -50,6 +50,8 @@
 #include <linux/irq_work.h>
 #include <linux/workqueue.h>
 
+#include <uapi/linux/trace_mmap.h>
+
 #include "trace.h"
 #include "trace_output.h"
 
@@ -1204,7 +1206,20 @@ int tracing_alloc_snapshot_instance(struct trace_array *tr)
 		if (ret < 0)
 			return ret;
 
-		tr->allocated_snapshot = true;
+		/* The buffers of a mapped instance can't be swapped */
+		local_irq_disable();
+		arch_spin_lock(&tr->max_lock);
+		if (!tr->mapped)
+			tr->allocated_snapshot = true;
+		arch_spin_unlock(&tr->max_lock);
+		local_irq_enable();
+
+		if (!tr->allocated_snapshot) {
+			ring_buffer_resize(tr->max_buffer.buffer, 1,
+					   RING_BUFFER_ALL_CPUS);
+			set_buffer_entries(&tr->max_buffer, 1);
+			return -EBUSY;
+		}
 	}
 
 	return 0;
@@ -5636,7 +5651,7 @@ static const char readme_msg[] =
 	"\t            [:values=<field1[,field2,...]>]\n"
 	"\t            [:sort=<field1[,field2,...]>]\n"
 	"\t            [:size=#entries]\n"
-	"\t            [:pause][:continue][:clear]\n"
+	"\t            [:pause][:continue][:clear][:percpu]\n"
 	"\t            [:name=histname1]\n"
 	"\t            [:<handler>.<action>]\n"
 	"\t            [if <filter>]\n\n"
@@ -5692,6 +5707,10 @@ static const char readme_msg[] =
 	"\t    The 'clear' parameter will clear the contents of a running\n"
 	"\t    hist trigger and leave its current paused/active state\n"
 	"\t    unchanged.\n\n"
+	"\t    The 'percpu' parameter gives each CPU its own table of\n"
+	"\t    'size' entries, merged when the hist file is read, so that\n"
+	"\t    CPUs don't contend when logging events.  It can't be\n"
+	"\t    combined with variables or actions.\n\n"
 	"\t    The enable_hist and disable_hist triggers can be used to\n"
 	"\t    have one event conditionally start and stop another event's\n"
 	"\t    already-attached hist trigger.  The syntax is analogous to\n"
@@ -8264,12 +8283,115 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 	return ret;
 }
 
+static long tracing_buffers_ioctl(struct file *file, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct ftrace_buffer_info *info = file->private_data;
+	struct trace_iterator *iter = &info->iter;
+	int err;
+
+	if (cmd != TRACE_MMAP_IOCTL_GET_READER)
+		return -ENOTTY;
+
+	if (!(file->f_flags & O_NONBLOCK)) {
+		err = wait_on_pipe(iter, iter->tr->buffer_percent);
+		if (err)
+			return err;
+	}
+
+	trace_access_lock(iter->cpu_file);
+	err = ring_buffer_map_get_reader(iter->array_buffer->buffer,
+					 iter->cpu_file);
+	trace_access_unlock(iter->cpu_file);
+
+	return err;
+}
+
+#ifdef CONFIG_TRACER_MAX_TRACE
+/*
+ * Called with the mmap_lock held, which rules out trace_types_lock.
+ * update_max_tr() swaps the buffers under max_lock, so use that.
+ */
+static int get_snapshot_map(struct trace_array *tr)
+{
+	int err = 0;
+
+	local_irq_disable();
+	arch_spin_lock(&tr->max_lock);
+	if (tr->allocated_snapshot)
+		err = -EBUSY;
+	else
+		tr->mapped++;
+	arch_spin_unlock(&tr->max_lock);
+	local_irq_enable();
+
+	return err;
+}
+
+static void put_snapshot_map(struct trace_array *tr)
+{
+	local_irq_disable();
+	arch_spin_lock(&tr->max_lock);
+	if (!WARN_ON(!tr->mapped))
+		tr->mapped--;
+	arch_spin_unlock(&tr->max_lock);
+	local_irq_enable();
+}
+#else
+static inline int get_snapshot_map(struct trace_array *tr) { return 0; }
+static inline void put_snapshot_map(struct trace_array *tr) { }
+#endif
+
+static void tracing_buffers_mmap_close(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	WARN_ON(ring_buffer_unmap(iter->array_buffer->buffer, iter->cpu_file));
+	put_snapshot_map(iter->tr);
+}
+
+static int tracing_buffers_may_split(struct vm_area_struct *vma,
+				     unsigned long addr)
+{
+	/* every mapping is unmapped exactly once, keep it in one piece */
+	return -EINVAL;
+}
+
+static const struct vm_operations_struct tracing_buffers_vmops = {
+	.close		= tracing_buffers_mmap_close,
+	.may_split	= tracing_buffers_may_split,
+};
+
+static int tracing_buffers_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	struct trace_iterator *iter = &info->iter;
+	int ret;
+
+	ret = get_snapshot_map(iter->tr);
+	if (ret)
+		return ret;
+
+	ret = ring_buffer_map(iter->array_buffer->buffer, iter->cpu_file, vma);
+	if (ret) {
+		put_snapshot_map(iter->tr);
+		return ret;
+	}
+
+	vma->vm_ops = &tracing_buffers_vmops;
+
+	return 0;
+}
+
 static const struct file_operations tracing_buffers_fops = {
 	.open		= tracing_buffers_open,
 	.read		= tracing_buffers_read,
 	.poll		= tracing_buffers_poll,
 	.release	= tracing_buffers_release,
 	.splice_read	= tracing_buffers_splice_read,
+	.unlocked_ioctl	= tracing_buffers_ioctl,
+	.mmap		= tracing_buffers_mmap,
 	.llseek		= no_llseek,
 };
 
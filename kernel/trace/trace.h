@@ -308,6 +308,8 @@ struct trace_array {
 	 */
 	struct array_buffer	max_buffer;
 	bool			allocated_snapshot;
+	/* mmapped per CPU buffers, protected by max_lock */
+	unsigned int		mapped;
 #endif
 #if defined(CONFIG_TRACER_MAX_TRACE) || defined(CONFIG_HWLAT_TRACER) \
 	|| defined(CONFIG_OSNOISE_TRACER)
@@ -13,6 +13,7 @@
 
 #include <linux/vmalloc.h>
 #include <linux/jhash.h>
+#include <linux/percpu.h>
 #include <linux/slab.h>
 #include <linux/sort.h>
 #include <linux/kmemleak.h>
@@ -502,6 +503,11 @@ static int tracing_map_alloc_elts(struct tracing_map *map)
 	return 0;
 }
 
+static inline struct tracing_map *cpu_map(struct tracing_map *map, int cpu)
+{
+	return *per_cpu_ptr(map->cpu_maps, cpu);
+}
+
 static inline bool keys_match(void *key, void *test_key, unsigned key_size)
 {
 	bool match = true;
@@ -630,9 +636,15 @@ __tracing_map_insert(struct tracing_map *map, void *key, bool lookup_only)
  * and associated tracing_map_elt pointer val.  If the key wasn't
  * found and the pool of tracing_map_elts has been exhausted, NULL is
  * returned and no further insertions will succeed.
+ *
+ * For a per-CPU map the key is inserted into the map of the current
+ * CPU, so the caller must not be preemptible.
  */
 struct tracing_map_elt *tracing_map_insert(struct tracing_map *map, void *key)
 {
+	if (map->cpu_maps)
+		map = *this_cpu_ptr(map->cpu_maps);
+
 	return __tracing_map_insert(map, key, false);
 }
 
@@ -655,6 +667,9 @@ struct tracing_map_elt *tracing_map_insert(struct tracing_map *map, void *key)
  */
 struct tracing_map_elt *tracing_map_lookup(struct tracing_map *map, void *key)
 {
+	if (map->cpu_maps)
+		map = *this_cpu_ptr(map->cpu_maps);
+
 	return __tracing_map_insert(map, key, true);
 }
 
@@ -670,9 +685,17 @@ struct tracing_map_elt *tracing_map_lookup(struct tracing_map *map, void *key)
  */
 void tracing_map_destroy(struct tracing_map *map)
 {
+	int cpu;
+
 	if (!map)
 		return;
 
+	if (map->cpu_maps) {
+		for_each_possible_cpu(cpu)
+			tracing_map_destroy(cpu_map(map, cpu));
+		free_percpu(map->cpu_maps);
+	}
+
 	tracing_map_free_elts(map);
 
 	tracing_map_array_free(map->map);
@@ -693,6 +716,13 @@ void tracing_map_destroy(struct tracing_map *map)
 void tracing_map_clear(struct tracing_map *map)
 {
 	unsigned int i;
+	int cpu;
+
+	if (map->cpu_maps) {
+		for_each_possible_cpu(cpu)
+			tracing_map_clear(cpu_map(map, cpu));
+		return;
+	}
 
 	atomic_set(&map->next_elt, -1);
 	atomic64_set(&map->hits, 0);
@@ -704,6 +734,48 @@ void tracing_map_clear(struct tracing_map *map)
 		tracing_map_elt_clear(*(TRACING_MAP_ELT(map->elts, i)));
 }
 
+/**
+ * tracing_map_read_hits - Return the number of hits of a tracing_map
+ * @map: The tracing_map
+ *
+ * Return: the 'hits' value of the map, summed over all CPUs for a
+ * per-CPU map.
+ */
+u64 tracing_map_read_hits(struct tracing_map *map)
+{
+	u64 hits = 0;
+	int cpu;
+
+	if (!map->cpu_maps)
+		return atomic64_read(&map->hits);
+
+	for_each_possible_cpu(cpu)
+		hits += atomic64_read(&cpu_map(map, cpu)->hits);
+
+	return hits;
+}
+
+/**
+ * tracing_map_read_drops - Return the number of drops of a tracing_map
+ * @map: The tracing_map
+ *
+ * Return: the 'drops' value of the map, summed over all CPUs for a
+ * per-CPU map.
+ */
+u64 tracing_map_read_drops(struct tracing_map *map)
+{
+	u64 drops = 0;
+	int cpu;
+
+	if (!map->cpu_maps)
+		return atomic64_read(&map->drops);
+
+	for_each_possible_cpu(cpu)
+		drops += atomic64_read(&cpu_map(map, cpu)->drops);
+
+	return drops;
+}
+
 static void set_sort_key(struct tracing_map *map,
 			 struct tracing_map_sort_key *sort_key)
 {
@@ -821,6 +893,50 @@ struct tracing_map *tracing_map_create(unsigned int map_bits,
  *
  * Return: the tracing_map pointer if successful, ERR_PTR if not.
  */
+/**
+ * tracing_map_set_percpu - Make a tracing_map per-CPU
+ * @map: The tracing_map
+ *
+ * Makes tracing_map_init() create a separate map for each possible
+ * CPU, see the overview in tracing_map.h.  Must be called before
+ * tracing_map_init().
+ */
+void tracing_map_set_percpu(struct tracing_map *map)
+{
+	map->percpu = true;
+}
+
+static int tracing_map_alloc_cpu_maps(struct tracing_map *map)
+{
+	struct tracing_map *cpu_map;
+	int cpu, err;
+
+	map->cpu_maps = alloc_percpu(struct tracing_map *);
+	if (!map->cpu_maps)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		cpu_map = tracing_map_create(map->map_bits, map->key_size,
+					     map->ops, map->private_data);
+		if (IS_ERR(cpu_map))
+			return PTR_ERR(cpu_map);
+
+		*per_cpu_ptr(map->cpu_maps, cpu) = cpu_map;
+
+		memcpy(cpu_map->fields, map->fields, sizeof(map->fields));
+		cpu_map->n_fields = map->n_fields;
+		memcpy(cpu_map->key_idx, map->key_idx, sizeof(map->key_idx));
+		cpu_map->n_keys = map->n_keys;
+		cpu_map->n_vars = map->n_vars;
+
+		err = tracing_map_alloc_elts(cpu_map);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
 int tracing_map_init(struct tracing_map *map)
 {
 	int err;
@@ -828,7 +944,10 @@ int tracing_map_init(struct tracing_map *map)
 	if (map->n_fields < 2)
 		return -EINVAL; /* need at least 1 key and 1 val */
 
-	err = tracing_map_alloc_elts(map);
+	if (map->percpu)
+		err = tracing_map_alloc_cpu_maps(map);
+	else
+		err = tracing_map_alloc_elts(map);
 	if (err)
 		return err;
 
@@ -851,6 +970,16 @@ static int cmp_entries_dup(const void *A, const void *B)
 	return ret;
 }
 
+static int cmp_elts_key(const void *A, const void *B)
+{
+	const struct tracing_map_elt *a, *b;
+
+	a = *(const struct tracing_map_elt **)A;
+	b = *(const struct tracing_map_elt **)B;
+
+	return memcmp(a->key, b->key, a->map->key_size);
+}
+
 static int cmp_entries_sum(const void *A, const void *B)
 {
 	const struct tracing_map_elt *elt_a, *elt_b;
@@ -985,6 +1114,79 @@ static void detect_dups(struct tracing_map_sort_entry **sort_entries,
 		  "Duplicates detected: %d\n", total_dups);
 }
 
+static void merge_elt(struct tracing_map_elt *to, struct tracing_map_elt *from)
+{
+	unsigned int i;
+
+	for (i = 0; i < to->map->n_fields; i++)
+		if (to->fields[i].cmp_fn == tracing_map_cmp_atomic64)
+			atomic64_add(atomic64_read(&from->fields[i].sum),
+				     &to->fields[i].sum);
+}
+
+/*
+ * Gather the elts of all the per-CPU maps, sort them by key and fold
+ * each run of equal keys into a single elt allocated from the parent
+ * map, which the sort entry owns.  Duplicate keys within one CPU's map
+ * get folded the same way.
+ */
+static int merge_cpu_maps(struct tracing_map *map,
+			  struct tracing_map_sort_entry **entries,
+			  int *n_entries)
+{
+	unsigned int max_elts = map->max_elts * num_possible_cpus();
+	struct tracing_map_elt **elts, *elt;
+	unsigned int i, j, n_elts = 0;
+	int cpu, ret = 0;
+
+	elts = vmalloc(array_size(sizeof(*elts), max_elts));
+	if (!elts)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct tracing_map *cmap = cpu_map(map, cpu);
+
+		for (i = 0; i < cmap->map_size && n_elts < max_elts; i++) {
+			struct tracing_map_entry *entry;
+
+			entry = TRACING_MAP_ENTRY(cmap->map, i);
+			elt = READ_ONCE(entry->val);
+			if (!entry->key || !elt)
+				continue;
+
+			elts[n_elts++] = elt;
+		}
+	}
+
+	sort(elts, n_elts, sizeof(*elts), cmp_elts_key, NULL);
+
+	for (i = 0; i < n_elts; i = j) {
+		elt = tracing_map_elt_alloc(map);
+		if (IS_ERR(elt)) {
+			ret = PTR_ERR(elt);
+			break;
+		}
+
+		memcpy(elt->key, elts[i]->key, map->key_size);
+		if (map->ops && map->ops->elt_copy)
+			map->ops->elt_copy(elt, elts[i]);
+
+		for (j = i; j < n_elts && !cmp_elts_key(&elts[i], &elts[j]); j++)
+			merge_elt(elt, elts[j]);
+
+		entries[*n_entries] = create_sort_entry(elt->key, elt);
+		if (!entries[*n_entries]) {
+			tracing_map_elt_free(elt);
+			ret = -ENOMEM;
+			break;
+		}
+		entries[(*n_entries)++]->elt_copied = true;
+	}
+
+	vfree(elts);
+	return ret;
+}
+
 static bool is_key(struct tracing_map *map, unsigned int field_idx)
 {
 	unsigned int i;
@@ -1063,6 +1265,9 @@ static void sort_secondary(struct tracing_map *map,
  * The client should not hold on to the returned array but should use
  * it and call tracing_map_destroy_sort_entries() when done.
  *
+ * For a per-CPU map, the elts of all CPUs are merged by key first and
+ * the returned entries point to the merged copies.
+ *
  * Return: the number of sort_entries in the struct tracing_map_sort_entry
  * array, negative on error
  */
@@ -1073,13 +1278,23 @@ int tracing_map_sort_entries(struct tracing_map *map,
 {
 	int (*cmp_entries_fn)(const void *, const void *);
 	struct tracing_map_sort_entry *sort_entry, **entries;
-	int i, n_entries, ret;
+	unsigned int max_elts = map->max_elts;
+	int i, n_entries = 0, ret;
+
+	if (map->cpu_maps)
+		max_elts *= num_possible_cpus();
 
-	entries = vmalloc(array_size(sizeof(sort_entry), map->max_elts));
+	entries = vmalloc(array_size(sizeof(sort_entry), max_elts));
 	if (!entries)
 		return -ENOMEM;
 
-	for (i = 0, n_entries = 0; i < map->map_size; i++) {
+	if (map->cpu_maps) {
+		ret = merge_cpu_maps(map, entries, &n_entries);
+		if (ret)
+			goto free;
+	}
+
+	for (i = 0; !map->cpu_maps && i < map->map_size; i++) {
 		struct tracing_map_entry *entry;
 
 		entry = TRACING_MAP_ENTRY(map->map, i);
@@ -1105,7 +1320,8 @@ int tracing_map_sort_entries(struct tracing_map *map,
 		return 1;
 	}
 
-	detect_dups(entries, n_entries, map->key_size);
+	if (!map->cpu_maps)
+		detect_dups(entries, n_entries, map->key_size);
 
 	if (is_key(map, sort_keys[0].field_idx))
 		cmp_entries_fn = cmp_entries_key;
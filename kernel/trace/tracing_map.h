@@ -125,6 +125,18 @@ typedef int (*tracing_map_cmp_fn_t) (void *val_a, void *val_b);
  * user, tracing_map_sort_entry objects contain a number of additional
  * fields which are used for caching and internal purposes and can
  * safely be ignored.
+ *
+ * A map can also be made per-CPU by calling tracing_map_set_percpu()
+ * before tracing_map_init().  tracing_map_init() then creates one
+ * complete map, with its own tracing_map_entry array and pool of
+ * max_elts tracing_map_elts, for every possible CPU and stores them in
+ * the cpu_maps field.  tracing_map_insert() only ever touches the map
+ * of the CPU it runs on, so CPUs don't contend on the table slots, the
+ * element pool or the hits and drops counters.  The price is memory
+ * and a more expensive read: tracing_map_sort_entries() folds the
+ * tracing_map_elts of all CPUs that share a key into one copy owned
+ * by the returned tracing_map_sort_entry.  Variables aren't merged,
+ * so per-CPU maps are only meant for maps without them.
 */
 
 struct tracing_map_field {
@@ -198,6 +210,8 @@ struct tracing_map {
 	unsigned int			n_vars;
 	atomic64_t			hits;
 	atomic64_t			drops;
+	bool				percpu;
+	struct tracing_map * __percpu	*cpu_maps;
 };
 
 /**
@@ -229,12 +243,18 @@ struct tracing_map {
  *	be initialized when used i.e. when the element is actually
  *	claimed by tracing_map_insert() in the context of the map
  *	insertion.
+ *
+ * @elt_copy: For per-CPU maps, this callback allows per-element
+ *	client-defined data to be copied from a per-CPU element into the
+ *	element that tracing_map_sort_entries() merges it into.
  */
 struct tracing_map_ops {
 	int			(*elt_alloc)(struct tracing_map_elt *elt);
 	void			(*elt_free)(struct tracing_map_elt *elt);
 	void			(*elt_clear)(struct tracing_map_elt *elt);
 	void			(*elt_init)(struct tracing_map_elt *elt);
+	void			(*elt_copy)(struct tracing_map_elt *to,
+					    struct tracing_map_elt *from);
 };
 
 extern struct tracing_map *
@@ -243,6 +263,7 @@ tracing_map_create(unsigned int map_bits,
 		   const struct tracing_map_ops *ops,
 		   void *private_data);
 extern int tracing_map_init(struct tracing_map *map);
+extern void tracing_map_set_percpu(struct tracing_map *map);
 
 extern int tracing_map_add_sum_field(struct tracing_map *map);
 extern int tracing_map_add_var(struct tracing_map *map);
@@ -252,6 +273,8 @@ extern int tracing_map_add_key_field(struct tracing_map *map,
 
 extern void tracing_map_destroy(struct tracing_map *map);
 extern void tracing_map_clear(struct tracing_map *map);
+extern u64 tracing_map_read_hits(struct tracing_map *map);
+extern u64 tracing_map_read_drops(struct tracing_map *map);
 
 extern struct tracing_map_elt *
 tracing_map_insert(struct tracing_map *map, void *key);
@@ -872,6 +872,13 @@ size_t copy_page_to_iter(struct page *page, size_t offset, size_t bytes,
 	size_t res = 0;
 	if (unlikely(!page_copy_sane(page, offset, bytes)))
 		return 0;
+	if (iov_iter_is_pipe(i) && !PageHighMem(page)) {
+		/* one pipe buffer can refer to the whole compound page */
+		struct page *head = compound_head(page);
+
+		offset += (page - head) * PAGE_SIZE;
+		return copy_page_to_iter_pipe(head, offset, bytes, i);
+	}
 	page += offset / PAGE_SIZE; // first subpage
 	offset %= PAGE_SIZE;
 	while (1) {
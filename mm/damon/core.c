@@ -637,6 +637,8 @@ static void damon_do_apply_schemes(struct damon_ctx *c,
 		if (sz_applied)
 			s->stat.nr_applied++;
 		s->stat.sz_applied += sz_applied;
+		s->stat.access_applied += (sz_applied >> PAGE_SHIFT) *
+			r->nr_accesses;
 	}
 }
 
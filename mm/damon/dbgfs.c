@@ -105,7 +105,7 @@ static ssize_t sprint_schemes(struct damon_ctx *c, char *buf, ssize_t len)
 
 	damon_for_each_scheme(s, c) {
 		rc = scnprintf(&buf[written], len - written,
-				"%lu %lu %u %u %u %u %d %lu %lu %lu %u %u %u %d %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+				"%lu %lu %u %u %u %u %d %lu %lu %lu %u %u %u %d %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
 				s->min_sz_region, s->max_sz_region,
 				s->min_nr_accesses, s->max_nr_accesses,
 				s->min_age_region, s->max_age_region,
@@ -119,7 +119,7 @@ static ssize_t sprint_schemes(struct damon_ctx *c, char *buf, ssize_t len)
 				s->wmarks.high, s->wmarks.mid, s->wmarks.low,
 				s->stat.nr_tried, s->stat.sz_tried,
 				s->stat.nr_applied, s->stat.sz_applied,
-				s->stat.qt_exceeds);
+				s->stat.qt_exceeds, s->stat.access_applied);
 		if (!rc)
 			return -ENOMEM;
 
@@ -169,6 +169,8 @@ static bool damos_action_valid(int action)
 	case DAMOS_HUGEPAGE:
 	case DAMOS_NOHUGEPAGE:
 	case DAMOS_STAT:
+	case DAMOS_PROMOTE:
+	case DAMOS_DEMOTE:
 		return true;
 	default:
 		return false;
@@ -7,6 +7,7 @@
 
 #define pr_fmt(fmt) "damon-pa: " fmt
 
+#include <linux/migrate.h>
 #include <linux/mmu_notifier.h>
 #include <linux/page_idle.h>
 #include <linux/pagemap.h>
@@ -213,16 +214,11 @@ bool damon_pa_target_valid(void *t)
 	return true;
 }
 
-static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
-		struct damon_target *t, struct damon_region *r,
-		struct damos *scheme)
+static unsigned long damon_pa_pageout(struct damon_region *r)
 {
 	unsigned long addr, applied;
 	LIST_HEAD(page_list);
 
-	if (scheme->action != DAMOS_PAGEOUT)
-		return 0;
-
 	for (addr = r->ar.start; addr < r->ar.end; addr += PAGE_SIZE) {
 		struct page *page = damon_get_page(PHYS_PFN(addr));
 
@@ -247,13 +243,127 @@ static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 	return applied * PAGE_SIZE;
 }
 
+/* The nearest node with CPUs, or NUMA_NO_NODE if @nid already has some */
+static int damon_pa_promotion_node(int nid)
+{
+	int node, target = NUMA_NO_NODE;
+
+	if (node_state(nid, N_CPU))
+		return NUMA_NO_NODE;
+
+	for_each_node_state(node, N_CPU) {
+		if (!node_state(node, N_MEMORY))
+			continue;
+		if (target == NUMA_NO_NODE ||
+		    node_distance(nid, node) < node_distance(nid, target))
+			target = node;
+	}
+	return target;
+}
+
+static struct page *damon_pa_alloc_migrate_page(struct page *page,
+		unsigned long node)
+{
+	struct migration_target_control mtc = {
+		/*
+		 * Allocate from 'node' or fail quickly, moving pages between
+		 * tiers must not cause reclaim on the target.
+		 */
+		.gfp_mask = (GFP_HIGHUSER_MOVABLE & ~__GFP_RECLAIM) |
+			    __GFP_THISNODE | __GFP_NOWARN |
+			    __GFP_NOMEMALLOC | GFP_NOWAIT,
+		.nid = node
+	};
+
+	return alloc_migration_target(page, (unsigned long)&mtc);
+}
+
+static unsigned int damon_pa_migrate_list(struct list_head *page_list,
+		int target_nid, bool promote)
+{
+	unsigned int nr_succeeded = 0;
+
+	if (list_empty(page_list))
+		return 0;
+
+	migrate_pages(page_list, damon_pa_alloc_migrate_page, NULL,
+			target_nid, MIGRATE_ASYNC,
+			promote ? MR_NUMA_MISPLACED : MR_DEMOTION,
+			&nr_succeeded);
+	putback_movable_pages(page_list);
+	return nr_succeeded;
+}
+
+/*
+ * Migrate the pages of @r to the next faster or slower tier.  Pages are
+ * batched per target node, as pages of one region may be spread over nodes.
+ */
+static unsigned long damon_pa_migrate(struct damon_region *r, bool promote)
+{
+	unsigned long addr, applied = 0;
+	int target_nid = NUMA_NO_NODE;
+	LIST_HEAD(page_list);
+
+	for (addr = r->ar.start; addr < r->ar.end; addr += PAGE_SIZE) {
+		struct page *page = damon_get_page(PHYS_PFN(addr));
+		int nid;
+
+		if (!page)
+			continue;
+
+		nid = page_to_nid(page);
+		nid = promote ? damon_pa_promotion_node(nid) :
+			next_demotion_node(nid);
+		if (nid == NUMA_NO_NODE) {
+			put_page(page);
+			continue;
+		}
+		if (nid != target_nid) {
+			applied += damon_pa_migrate_list(&page_list,
+					target_nid, promote);
+			target_nid = nid;
+		}
+
+		if (isolate_lru_page(page)) {
+			put_page(page);
+			continue;
+		}
+		list_add(&page->lru, &page_list);
+		put_page(page);
+	}
+	applied += damon_pa_migrate_list(&page_list, target_nid, promote);
+	cond_resched();
+	return applied * PAGE_SIZE;
+}
+
+static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
+		struct damon_target *t, struct damon_region *r,
+		struct damos *scheme)
+{
+	switch (scheme->action) {
+	case DAMOS_PAGEOUT:
+		return damon_pa_pageout(r);
+	case DAMOS_PROMOTE:
+		return damon_pa_migrate(r, true);
+	case DAMOS_DEMOTE:
+		return damon_pa_migrate(r, false);
+	default:
+		break;
+	}
+
+	return 0;
+}
+
 static int damon_pa_scheme_score(struct damon_ctx *context,
 		struct damon_target *t, struct damon_region *r,
 		struct damos *scheme)
 {
 	switch (scheme->action) {
 	case DAMOS_PAGEOUT:
+	case DAMOS_DEMOTE:
 		return damon_pageout_score(context, r, scheme);
+	case DAMOS_PROMOTE:
+		return damon_hot_score(context, r, scheme);
 	default:
 		break;
 	}
@@ -131,3 +131,10 @@ int damon_pageout_score(struct damon_ctx *c, struct damon_region *r,
 	/* Return coldness of the region */
 	return DAMOS_MAX_SCORE - hotness;
 }
+
+int damon_hot_score(struct damon_ctx *c, struct damon_region *r,
+			struct damos *s)
+{
+	/* Return hotness of the region */
+	return DAMOS_MAX_SCORE - damon_pageout_score(c, r, s);
+}
@@ -49,6 +49,32 @@ static int hmm_pfns_fill(unsigned long addr, unsigned long end,
 	return 0;
 }
 
+/*
+ * Check if @addr ended up mapped by a huge pmd or pud, e.g. because faulting
+ * it allocated a THP or it is a hugetlb page. Called with the mmap lock held.
+ */
+static bool hmm_addr_is_huge_mapped(struct mm_struct *mm, unsigned long addr)
+{
+	pgd_t *pgdp = pgd_offset(mm, addr);
+	p4d_t *p4dp;
+	pud_t *pudp, pud;
+	pmd_t pmd;
+
+	if (!pgd_present(READ_ONCE(*pgdp)))
+		return false;
+	p4dp = p4d_offset(pgdp, addr);
+	if (!p4d_present(READ_ONCE(*p4dp)))
+		return false;
+	pudp = pud_offset(p4dp, addr);
+	pud = READ_ONCE(*pudp);
+	if (!pud_present(pud))
+		return false;
+	if (pud_huge(pud) || pud_trans_huge(pud) || pud_devmap(pud))
+		return true;
+	pmd = READ_ONCE(*pmd_offset(pudp, addr));
+	return pmd_huge(pmd) || pmd_trans_huge(pmd) || pmd_devmap(pmd);
+}
+
 /*
  * hmm_vma_fault() - fault in a range lacking valid pmd or pte(s)
  * @addr: range virtual start address (inclusive)
@@ -76,10 +102,21 @@ static int hmm_vma_fault(unsigned long addr, unsigned long end,
 		fault_flags |= FAULT_FLAG_WRITE;
 	}
 
-	for (; addr < end; addr += PAGE_SIZE)
+	for (; addr < end; addr += PAGE_SIZE) {
 		if (handle_mm_fault(vma, addr, fault_flags, NULL) &
 		    VM_FAULT_ERROR)
 			return -EFAULT;
+
+		/*
+		 * The first fault in a PMD sized area may have installed a huge
+		 * page, don't fault the rest of it in one page at a time. The
+		 * walk restarted by -EBUSY reports it as a single high order
+		 * entry.
+		 */
+		if ((addr == hmm_vma_walk->last || IS_ALIGNED(addr, PMD_SIZE)) &&
+		    hmm_addr_is_huge_mapped(walk->mm, addr))
+			addr = min(end, ALIGN(addr + 1, PMD_SIZE)) - PAGE_SIZE;
+	}
 	return -EBUSY;
 }
 
@@ -84,6 +84,12 @@ static __read_mostly DEFINE_HASHTABLE(mm_slots_hash, MM_SLOTS_HASH_BITS);
 static struct kmem_cache *mm_slot_cache __read_mostly;
 
 #define MAX_PTE_MAPPED_THP 8
+#define MAX_HOT_RANGES 8
+
+struct khugepaged_range {
+	unsigned long start;
+	unsigned long end;
+};
 
 /**
  * struct mm_slot - hash lookup from mm to mm_slot
@@ -92,6 +98,8 @@ static struct kmem_cache *mm_slot_cache __read_mostly;
  * @mm: the mm that this information is valid for
  * @nr_pte_mapped_thp: number of pte mapped THP
  * @pte_mapped_thp: address array corresponding pte mapped THP
+ * @nr_hot: number of ranges hinted hot
+ * @hot: ranges hinted hot, scanned before the rest of the mm
  */
 struct mm_slot {
 	struct hlist_node hash;
@@ -101,6 +109,10 @@ struct mm_slot {
 	/* pte-mapped THP in this mm */
 	int nr_pte_mapped_thp;
 	unsigned long pte_mapped_thp[MAX_PTE_MAPPED_THP];
+
+	/* protected by khugepaged_mm_lock */
+	int nr_hot;
+	struct khugepaged_range hot[MAX_HOT_RANGES];
 };
 
 /**
@@ -439,6 +451,74 @@ static inline int khugepaged_test_exit(struct mm_struct *mm)
 	return atomic_read(&mm->mm_users) == 0;
 }
 
+static bool khugepaged_add_hot(struct mm_slot *mm_slot, unsigned long start,
+			       unsigned long end)
+{
+	int i;
+
+	lockdep_assert_held(&khugepaged_mm_lock);
+
+	for (i = 0; i < mm_slot->nr_hot; i++) {
+		struct khugepaged_range *r = &mm_slot->hot[i];
+
+		if (start <= r->end && end >= r->start) {
+			r->start = min(r->start, start);
+			r->end = max(r->end, end);
+			return true;
+		}
+	}
+
+	if (mm_slot->nr_hot == MAX_HOT_RANGES)
+		return false;
+
+	mm_slot->hot[mm_slot->nr_hot].start = start;
+	mm_slot->hot[mm_slot->nr_hot].end = end;
+	mm_slot->nr_hot++;
+	return true;
+}
+
+/**
+ * khugepaged_hint_hot - ask khugepaged to collapse a range soon
+ * @mm: the mm the range belongs to
+ * @start: start of the range
+ * @end: end of the range
+ *
+ * Queue the huge page aligned part of [@start, @end) to be scanned ahead of
+ * the remaining address space of @mm, and scan @mm next. Used for ranges
+ * madvised MADV_HUGEPAGE, which includes DAMOS_HUGEPAGE schemes that DAMON
+ * applies to the hot regions it found. Ignored unless @mm is registered
+ * with khugepaged.
+ */
+void khugepaged_hint_hot(struct mm_struct *mm, unsigned long start,
+			 unsigned long end)
+{
+	struct mm_slot *mm_slot;
+
+	start = ALIGN(start, HPAGE_PMD_SIZE);
+	end &= HPAGE_PMD_MASK;
+	if (start >= end || !khugepaged_enabled())
+		return;
+
+	spin_lock(&khugepaged_mm_lock);
+	mm_slot = get_mm_slot(mm);
+	if (!mm_slot || !khugepaged_add_hot(mm_slot, start, end)) {
+		spin_unlock(&khugepaged_mm_lock);
+		return;
+	}
+
+	if (khugepaged_scan.mm_slot != mm_slot) {
+		if (khugepaged_scan.mm_slot)
+			list_move(&mm_slot->mm_node,
+				  &khugepaged_scan.mm_slot->mm_node);
+		else
+			list_move(&mm_slot->mm_node, &khugepaged_scan.mm_head);
+	}
+	spin_unlock(&khugepaged_mm_lock);
+
+	khugepaged_sleep_expire = 0;
+	wake_up_interruptible(&khugepaged_wait);
+}
+
 static bool hugepage_vma_check(struct vm_area_struct *vma,
 			       unsigned long vm_flags)
 {
@@ -1203,6 +1283,7 @@ static void collapse_huge_page(struct mm_struct *mm,
 	*hpage = NULL;
 
 	khugepaged_pages_collapsed++;
+	WRITE_ONCE(mm->thp_collapsed, mm->thp_collapsed + 1);
 	result = SCAN_SUCCEED;
 out_up_write:
 	mmap_write_unlock(mm);
@@ -1941,6 +2022,7 @@ static void collapse_file(struct mm_struct *mm,
 		*hpage = NULL;
 
 		khugepaged_pages_collapsed++;
+		WRITE_ONCE(mm->thp_collapsed, mm->thp_collapsed + 1);
 	} else {
 		struct page *page;
 
@@ -2083,6 +2165,80 @@ static void khugepaged_collapse_pte_mapped_thps(struct mm_slot *mm_slot)
 }
 #endif
 
+static bool khugepaged_next_hot(struct mm_slot *mm_slot,
+			       struct khugepaged_range *range)
+{
+	bool ret = false;
+
+	spin_lock(&khugepaged_mm_lock);
+	if (mm_slot->nr_hot) {
+		*range = mm_slot->hot[--mm_slot->nr_hot];
+		ret = true;
+	}
+	spin_unlock(&khugepaged_mm_lock);
+	return ret;
+}
+
+/*
+ * Scan the anonymous memory in the ranges hinted hot, advancing @progress.
+ * Called and returns with mmap_lock held for read, unless it returns true
+ * after khugepaged_scan_pmd() released it. What isn't scanned because of
+ * that or because @pages ran out is queued again.
+ */
+static bool khugepaged_scan_hot(struct mm_struct *mm, struct mm_slot *mm_slot,
+				unsigned int pages, int *progress,
+				struct page **hpage)
+{
+	struct khugepaged_range range;
+
+	while (*progress < pages && khugepaged_next_hot(mm_slot, &range)) {
+		unsigned long addr = range.start;
+
+		while (addr < range.end) {
+			struct vm_area_struct *vma;
+			unsigned long collapsed;
+			int ret;
+
+			cond_resched();
+			if (unlikely(khugepaged_test_exit(mm)))
+				return false;
+
+			vma = find_vma(mm, addr);
+			if (!vma)
+				break;
+			if (addr < vma->vm_start ||
+			    addr + HPAGE_PMD_SIZE > vma->vm_end ||
+			    !vma_is_anonymous(vma) ||
+			    !hugepage_vma_check(vma, vma->vm_flags)) {
+				addr = max(addr + HPAGE_PMD_SIZE,
+					   ALIGN(vma->vm_start, HPAGE_PMD_SIZE));
+				continue;
+			}
+
+			collapsed = mm->thp_collapsed;
+			ret = khugepaged_scan_pmd(mm, vma, addr, hpage);
+			if (mm->thp_collapsed != collapsed)
+				WRITE_ONCE(mm->thp_collapsed_hot,
+					   mm->thp_collapsed_hot + 1);
+			addr += HPAGE_PMD_SIZE;
+			*progress += HPAGE_PMD_NR;
+
+			if (ret || *progress >= pages) {
+				if (addr < range.end) {
+					spin_lock(&khugepaged_mm_lock);
+					khugepaged_add_hot(mm_slot, addr,
+							   range.end);
+					spin_unlock(&khugepaged_mm_lock);
+				}
+				if (ret)
+					return true;
+				break;
+			}
+		}
+	}
+	return false;
+}
+
 static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 					    struct page **hpage)
 	__releases(&khugepaged_mm_lock)
@@ -2115,8 +2271,13 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 	vma = NULL;
 	if (unlikely(!mmap_read_trylock(mm)))
 		goto breakouterloop_mmap_lock;
-	if (likely(!khugepaged_test_exit(mm)))
+	if (likely(!khugepaged_test_exit(mm))) {
 		vma = find_vma(mm, khugepaged_scan.address);
+		if (khugepaged_scan_hot(mm, mm_slot, pages, &progress, hpage))
+			goto breakouterloop_mmap_lock;
+		if (progress >= pages)
+			goto breakouterloop;
+	}
 
 	progress++;
 	for (; vma; vma = vma->vm_next) {
@@ -151,6 +151,7 @@ struct ksm_scan {
  * @kpfn: page frame number of this ksm page (perhaps temporarily on wrong nid)
  * @chain_prune_time: time of the last full garbage collection
  * @rmap_hlist_len: number of rmap_item entries in hlist or STABLE_NODE_CHAIN
+ * @checksum: checksum of the ksm page content, orders the stable tree
  * @nid: NUMA node id of stable tree in which linked (may not match kpfn)
  */
 struct stable_node {
@@ -176,6 +177,7 @@ struct stable_node {
 	 */
 #define STABLE_NODE_CHAIN -1024
 	int rmap_hlist_len;
+	u32 checksum;
 #ifdef CONFIG_NUMA
 	int nid;
 #endif
@@ -594,6 +596,7 @@ static struct stable_node *alloc_stable_node_chain(struct stable_node *dup,
 		INIT_HLIST_HEAD(&chain->hlist);
 		chain->chain_prune_time = jiffies;
 		chain->rmap_hlist_len = STABLE_NODE_CHAIN;
+		chain->checksum = dup->checksum;
 #if defined (CONFIG_DEBUG_VM) && defined(CONFIG_NUMA)
 		chain->nid = NUMA_NO_NODE; /* debug */
 #endif
@@ -1030,6 +1033,18 @@ static u32 calc_checksum(struct page *page)
 	return checksum;
 }
 
+/*
+ * The stable and unstable trees are ordered by checksum first and by content
+ * second, so most steps of a tree walk get by without reading the tree page.
+ */
+static int cmp_pages(struct page *page, u32 checksum,
+		     struct page *tree_page, u32 tree_checksum)
+{
+	if (checksum != tree_checksum)
+		return checksum < tree_checksum ? -1 : 1;
+	return memcmp_pages(page, tree_page);
+}
+
 static int write_protect_page(struct vm_area_struct *vma, struct page *page,
 			      pte_t *orig_pte)
 {
@@ -1545,11 +1560,12 @@ static __always_inline struct page *chain(struct stable_node **s_n_d,
  *
  * This function checks if there is a page inside the stable tree
  * with identical content to the page that we are scanning right now.
+ * The checksum of the page is stored in *@checksump.
  *
  * This function returns the stable tree node of identical content if found,
  * NULL otherwise.
  */
-static struct page *stable_tree_search(struct page *page)
+static struct page *stable_tree_search(struct page *page, u32 *checksump)
 {
 	int nid;
 	struct rb_root *root;
@@ -1559,6 +1575,8 @@ static struct page *stable_tree_search(struct page *page)
 	struct stable_node *page_node;
 
 	page_node = page_stable_node(page);
+	/* a ksm page is write protected, its checksum still holds */
+	*checksump = page_node ? page_node->checksum : calc_checksum(page);
 	if (page_node && page_node->head != &migrate_nodes) {
 		/* ksm page forked */
 		get_page(page);
@@ -1629,7 +1647,8 @@ static struct page *stable_tree_search(struct page *page)
 			goto again;
 		}
 
-		ret = memcmp_pages(page, tree_page);
+		ret = cmp_pages(page, *checksump, tree_page,
+				stable_node->checksum);
 		put_page(tree_page);
 
 		parent = *new;
@@ -1808,7 +1827,10 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 	struct rb_node *parent;
 	struct stable_node *stable_node, *stable_node_dup, *stable_node_any;
 	bool need_chain = false;
+	u32 checksum;
 
+	/* kpage is write protected by now, unlike when it was last scanned */
+	checksum = calc_checksum(kpage);
 	kpfn = page_to_pfn(kpage);
 	nid = get_kpfn_nid(kpfn);
 	root = root_stable_tree + nid;
@@ -1862,7 +1884,7 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 			goto again;
 		}
 
-		ret = memcmp_pages(kpage, tree_page);
+		ret = cmp_pages(kpage, checksum, tree_page, stable_node->checksum);
 		put_page(tree_page);
 
 		parent = *new;
@@ -1884,6 +1906,7 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 	stable_node_dup->kpfn = kpfn;
 	set_page_stable_node(kpage, stable_node_dup);
 	stable_node_dup->rmap_hlist_len = 0;
+	stable_node_dup->checksum = checksum;
 	DO_NUMA(stable_node_dup->nid = nid);
 	if (!need_chain) {
 		rb_link_node(&stable_node_dup->node, parent, new);
@@ -1951,7 +1974,8 @@ struct rmap_item *unstable_tree_search_insert(struct rmap_item *rmap_item,
 			return NULL;
 		}
 
-		ret = memcmp_pages(page, tree_page);
+		ret = cmp_pages(page, rmap_item->oldchecksum, tree_page,
+				tree_rmap_item->oldchecksum);
 
 		parent = *new;
 		if (ret < 0) {
@@ -2038,7 +2062,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	struct page *tree_page = NULL;
 	struct stable_node *stable_node;
 	struct page *kpage;
-	unsigned int checksum;
+	u32 checksum;
 	int err;
 	bool max_page_sharing_bypass = false;
 
@@ -2063,7 +2087,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	}
 
 	/* We first start with searching the page inside the stable tree */
-	kpage = stable_tree_search(page);
+	kpage = stable_tree_search(page, &checksum);
 	if (kpage == page && rmap_item->head == stable_node) {
 		put_page(kpage);
 		return;
@@ -2095,8 +2119,8 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * we calculated it, this page is changing frequently: therefore we
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
+	 * The checksum was taken by stable_tree_search().
 	 */
-	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
@@ -12,6 +12,7 @@
 #include <linux/slab.h>
 #include <linux/mutex.h>
 #include <linux/memcontrol.h>
+#include <linux/percpu.h>
 #include "slab.h"
 
 #ifdef CONFIG_MEMCG_KMEM
@@ -118,6 +119,145 @@ list_lru_from_kmem(struct list_lru_node *nlru, void *ptr,
 }
 #endif /* CONFIG_MEMCG_KMEM */
 
+/*
+ * Batched lrus stage added items on a per cpu list and only take the node lock
+ * once the batch is full or the lru is walked. Staged items are singly linked
+ * through item->next, item->prev points to the owning batch tagged with
+ * LIST_LRU_STAGED, which also keeps list_empty() false for them. Walks move
+ * the batches of their node to the tail of the lists first, so the items
+ * added last are still the last ones isolated.
+ */
+#define LIST_LRU_BATCH		32
+#define LIST_LRU_STAGED		1UL
+
+struct list_lru_pcp {
+	spinlock_t		lock;
+	struct list_head	*head;
+	unsigned int		nr;
+	int			nid;
+};
+
+static inline struct list_head *list_lru_pcp_tag(struct list_lru_pcp *pcp)
+{
+	return (struct list_head *)((unsigned long)pcp | LIST_LRU_STAGED);
+}
+
+/* The caller holds pcp->lock */
+static void list_lru_flush_pcp(struct list_lru *lru, struct list_lru_pcp *pcp)
+{
+	struct list_lru_node *nlru = &lru->node[pcp->nid];
+	struct list_head *item, *next;
+	struct mem_cgroup *memcg;
+	struct list_lru_one *l;
+
+	if (!pcp->nr)
+		return;
+
+	spin_lock(&nlru->lock);
+	for (item = pcp->head; item; item = next) {
+		next = item->next;
+		l = list_lru_from_kmem(nlru, item, &memcg);
+		list_add_tail(item, &l->list);
+		if (!l->nr_items++)
+			set_shrinker_bit(memcg, pcp->nid,
+					 lru_shrinker_id(lru));
+		nlru->nr_items++;
+	}
+	spin_unlock(&nlru->lock);
+
+	pcp->head = NULL;
+	WRITE_ONCE(pcp->nr, 0);
+}
+
+static void list_lru_drain_pcp(struct list_lru *lru, int nid)
+{
+	int cpu;
+
+	if (!lru->pcp)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct list_lru_pcp *pcp = per_cpu_ptr(lru->pcp, cpu);
+
+		if (!READ_ONCE(pcp->nr) || READ_ONCE(pcp->nid) != nid)
+			continue;
+
+		spin_lock(&pcp->lock);
+		if (pcp->nid == nid)
+			list_lru_flush_pcp(lru, pcp);
+		spin_unlock(&pcp->lock);
+	}
+}
+
+static long list_lru_count_pcp(struct list_lru *lru, int nid)
+{
+	long count = 0;
+	int cpu;
+
+	if (!lru->pcp)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		struct list_lru_pcp *pcp = per_cpu_ptr(lru->pcp, cpu);
+
+		if (READ_ONCE(pcp->nid) == nid)
+			count += READ_ONCE(pcp->nr);
+	}
+	return count;
+}
+
+static bool list_lru_add_pcp(struct list_lru *lru, struct list_head *item,
+			     int nid)
+{
+	struct list_lru_pcp *pcp = raw_cpu_ptr(lru->pcp);
+
+	spin_lock(&pcp->lock);
+	if (!list_empty(item)) {
+		spin_unlock(&pcp->lock);
+		return false;
+	}
+
+	/* a batch only holds items of one node */
+	if (pcp->nid != nid) {
+		list_lru_flush_pcp(lru, pcp);
+		WRITE_ONCE(pcp->nid, nid);
+	}
+
+	item->next = pcp->head;
+	WRITE_ONCE(item->prev, list_lru_pcp_tag(pcp));
+	pcp->head = item;
+	WRITE_ONCE(pcp->nr, pcp->nr + 1);
+	if (pcp->nr >= LIST_LRU_BATCH)
+		list_lru_flush_pcp(lru, pcp);
+	spin_unlock(&pcp->lock);
+	return true;
+}
+
+static bool list_lru_del_pcp(struct list_head *item)
+{
+	struct list_head *tag = READ_ONCE(item->prev);
+	struct list_lru_pcp *pcp;
+	struct list_head **pos;
+	bool ret = false;
+
+	if (!((unsigned long)tag & LIST_LRU_STAGED))
+		return false;
+
+	pcp = (struct list_lru_pcp *)((unsigned long)tag & ~LIST_LRU_STAGED);
+	spin_lock(&pcp->lock);
+	/* otherwise it was flushed to the node meanwhile */
+	if (item->prev == tag) {
+		for (pos = &pcp->head; *pos != item; pos = &(*pos)->next)
+			;
+		*pos = item->next;
+		WRITE_ONCE(pcp->nr, pcp->nr - 1);
+		INIT_LIST_HEAD(item);
+		ret = true;
+	}
+	spin_unlock(&pcp->lock);
+	return ret;
+}
+
 bool list_lru_add(struct list_lru *lru, struct list_head *item)
 {
 	int nid = page_to_nid(virt_to_page(item));
@@ -125,6 +265,9 @@ bool list_lru_add(struct list_lru *lru, struct list_head *item)
 	struct mem_cgroup *memcg;
 	struct list_lru_one *l;
 
+	if (lru->pcp)
+		return list_lru_add_pcp(lru, item, nid);
+
 	spin_lock(&nlru->lock);
 	if (list_empty(item)) {
 		l = list_lru_from_kmem(nlru, item, &memcg);
@@ -148,6 +291,9 @@ bool list_lru_del(struct list_lru *lru, struct list_head *item)
 	struct list_lru_node *nlru = &lru->node[nid];
 	struct list_lru_one *l;
 
+	if (lru->pcp && list_lru_del_pcp(item))
+		return true;
+
 	spin_lock(&nlru->lock);
 	if (!list_empty(item)) {
 		l = list_lru_from_kmem(nlru, item, NULL);
@@ -201,7 +347,7 @@ unsigned long list_lru_count_node(struct list_lru *lru, int nid)
 	struct list_lru_node *nlru;
 
 	nlru = &lru->node[nid];
-	return nlru->nr_items;
+	return nlru->nr_items + list_lru_count_pcp(lru, nid);
 }
 EXPORT_SYMBOL_GPL(list_lru_count_node);
 
@@ -271,6 +417,7 @@ list_lru_walk_one(struct list_lru *lru, int nid, struct mem_cgroup *memcg,
 	struct list_lru_node *nlru = &lru->node[nid];
 	unsigned long ret;
 
+	list_lru_drain_pcp(lru, nid);
 	spin_lock(&nlru->lock);
 	ret = __list_lru_walk_one(nlru, memcg_cache_id(memcg), isolate, cb_arg,
 				  nr_to_walk);
@@ -287,6 +434,7 @@ list_lru_walk_one_irq(struct list_lru *lru, int nid, struct mem_cgroup *memcg,
 	struct list_lru_node *nlru = &lru->node[nid];
 	unsigned long ret;
 
+	list_lru_drain_pcp(lru, nid);
 	spin_lock_irq(&nlru->lock);
 	ret = __list_lru_walk_one(nlru, memcg_cache_id(memcg), isolate, cb_arg,
 				  nr_to_walk);
@@ -518,6 +666,8 @@ static void memcg_drain_list_lru_node(struct list_lru *lru, int nid,
 	int dst_idx = dst_memcg->kmemcg_id;
 	struct list_lru_one *src, *dst;
 
+	list_lru_drain_pcp(lru, nid);
+
 	/*
 	 * Since list_lru_{add,del} may be called under an IRQ-safe lock,
 	 * we have to use IRQ-safe primitives here to avoid deadlock.
@@ -567,7 +717,7 @@ static void memcg_destroy_list_lru(struct list_lru *lru)
 }
 #endif /* CONFIG_MEMCG_KMEM */
 
-int __list_lru_init(struct list_lru *lru, bool memcg_aware,
+int __list_lru_init(struct list_lru *lru, bool memcg_aware, bool batched,
 		    struct lock_class_key *key, struct shrinker *shrinker)
 {
 	int i;
@@ -581,9 +731,18 @@ int __list_lru_init(struct list_lru *lru, bool memcg_aware,
 #endif
 	memcg_get_cache_ids();
 
+	lru->pcp = NULL;
+	if (batched) {
+		lru->pcp = alloc_percpu(struct list_lru_pcp);
+		if (!lru->pcp)
+			goto out;
+		for_each_possible_cpu(i)
+			spin_lock_init(&per_cpu_ptr(lru->pcp, i)->lock);
+	}
+
 	lru->node = kcalloc(nr_node_ids, sizeof(*lru->node), GFP_KERNEL);
 	if (!lru->node)
-		goto out;
+		goto out_pcp;
 
 	for_each_node(i) {
 		spin_lock_init(&lru->node[i].lock);
@@ -597,10 +756,14 @@ int __list_lru_init(struct list_lru *lru, bool memcg_aware,
 		kfree(lru->node);
 		/* Do this so a list_lru_destroy() doesn't crash: */
 		lru->node = NULL;
-		goto out;
+		goto out_pcp;
 	}
 
 	list_lru_register(lru);
+	goto out;
+out_pcp:
+	free_percpu(lru->pcp);
+	lru->pcp = NULL;
 out:
 	memcg_put_cache_ids();
 	return err;
@@ -620,6 +783,8 @@ void list_lru_destroy(struct list_lru *lru)
 	memcg_destroy_list_lru(lru);
 	kfree(lru->node);
 	lru->node = NULL;
+	free_percpu(lru->pcp);
+	lru->pcp = NULL;
 
 #ifdef CONFIG_MEMCG_KMEM
 	lru->shrinker_id = -1;
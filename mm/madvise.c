@@ -1042,6 +1042,8 @@ static int madvise_vma_behavior(struct vm_area_struct *vma,
 
 	error = madvise_update_vma(vma, prev, start, end, new_flags,
 				   vma_anon_name(vma));
+	if (!error && behavior == MADV_HUGEPAGE)
+		khugepaged_hint_hot(vma->vm_mm, start, end);
 
 out:
 	/*
@@ -441,15 +441,33 @@ void __mmu_notifier_change_pte(struct mm_struct *mm, unsigned long address,
 	srcu_read_unlock(&srcu, id);
 }
 
+/*
+ * Call invalidate_flush() for the subscriptions in [first, last) of @range.
+ * The itree can't change while invalidating, so walking it again finds the
+ * same subscriptions invalidate() was called for.
+ */
+static void mn_itree_inv_flush(const struct mmu_notifier_range *range,
+			       struct mmu_interval_notifier *first,
+			       struct mmu_interval_notifier *last)
+{
+	struct mmu_interval_notifier *interval_sub;
+
+	for (interval_sub = first; interval_sub != last;
+	     interval_sub = mn_itree_inv_next(interval_sub, range)) {
+		if (interval_sub->ops->invalidate_flush)
+			interval_sub->ops->invalidate_flush(interval_sub, range);
+	}
+}
+
 static int mn_itree_invalidate(struct mmu_notifier_subscriptions *subscriptions,
 			       const struct mmu_notifier_range *range)
 {
-	struct mmu_interval_notifier *interval_sub;
+	struct mmu_interval_notifier *interval_sub, *first;
+	bool need_flush = false;
 	unsigned long cur_seq;
 
-	for (interval_sub =
-		     mn_itree_inv_start_range(subscriptions, range, &cur_seq);
-	     interval_sub;
+	first = mn_itree_inv_start_range(subscriptions, range, &cur_seq);
+	for (interval_sub = first; interval_sub;
 	     interval_sub = mn_itree_inv_next(interval_sub, range)) {
 		bool ret;
 
@@ -460,10 +478,15 @@ static int mn_itree_invalidate(struct mmu_notifier_subscriptions *subscriptions,
 				continue;
 			goto out_would_block;
 		}
+		need_flush |= !!interval_sub->ops->invalidate_flush;
 	}
+	if (need_flush)
+		mn_itree_inv_flush(range, first, NULL);
 	return 0;
 
 out_would_block:
+	if (need_flush)
+		mn_itree_inv_flush(range, first, interval_sub);
 	/*
 	 * On -EAGAIN the non-blocking caller is not allowed to call
 	 * invalidate_range_end()
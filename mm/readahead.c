@@ -22,6 +22,7 @@
 #include <linux/blk-cgroup.h>
 #include <linux/fadvise.h>
 #include <linux/sched/mm.h>
+#include <trace/events/filemap.h>
 
 #include "internal.h"
 
@@ -431,6 +432,59 @@ static int try_context_readahead(struct address_space *mapping,
 	return 1;
 }
 
+/*
+ * Strided reads, e.g. reading every Nth megabyte of a file, look random to
+ * the detection above. Track the distance between the starts of the last
+ * non-sequential runs, and once two in a row match, read the next run ahead.
+ * Its first page gets PG_readahead, the reader arriving there continues the
+ * stream through ra_stride_hit().
+ *
+ * Returns the number of pages to read at @index + ra->stride.
+ */
+static unsigned long ra_stride_update(struct address_space *mapping,
+		struct file_ra_state *ra, pgoff_t index, pgoff_t prev_index,
+		unsigned long max_pages)
+{
+	pgoff_t last = ra->stride_start;
+	unsigned long len;
+
+	ra->stride_start = index;
+	if (index <= last || prev_index < last) {
+		ra->stride = 0;
+		return 0;
+	}
+
+	len = prev_index - last + 1;
+	if (ra->stride && index - last == ra->stride && len < ra->stride) {
+		ra->stride_len = min(len, max_pages);
+		trace_mm_filemap_stride_readahead(mapping, index, ra->stride,
+				ra->stride_len, FILEMAP_STRIDE_START);
+		return ra->stride_len;
+	}
+
+	if (ra->stride && ra->stride_len)
+		trace_mm_filemap_stride_readahead(mapping, index, ra->stride,
+				0, FILEMAP_STRIDE_MISS);
+	ra->stride = index - last;
+	ra->stride_len = 0;
+	return 0;
+}
+
+static bool ra_stride_hit(struct readahead_control *ractl, pgoff_t index)
+{
+	struct file_ra_state *ra = ractl->ra;
+
+	if (!ra->stride_len || index != ra->stride_start + ra->stride)
+		return false;
+
+	ra->stride_start = index;
+	trace_mm_filemap_stride_readahead(ractl->mapping, index, ra->stride,
+			ra->stride_len, FILEMAP_STRIDE_HIT);
+	ractl->_index = index + ra->stride;
+	do_page_cache_ra(ractl, ra->stride_len, ra->stride_len);
+	return true;
+}
+
 /*
  * A minimal readahead algorithm for trivial sequential/random reads.
  */
@@ -440,7 +494,7 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	struct backing_dev_info *bdi = inode_to_bdi(ractl->mapping->host);
 	struct file_ra_state *ra = ractl->ra;
 	unsigned long max_pages = ra->ra_pages;
-	unsigned long add_pages;
+	unsigned long add_pages, stride_pages = 0;
 	unsigned long index = readahead_index(ractl);
 	pgoff_t prev_index;
 
@@ -478,6 +532,10 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	if (hit_readahead_marker) {
 		pgoff_t start;
 
+		/* the start of a strided run read ahead by us */
+		if (ra_stride_hit(ractl, index))
+			return;
+
 		rcu_read_lock();
 		start = page_cache_next_miss(ractl->mapping, index + 1,
 				max_pages);
@@ -494,12 +552,6 @@ static void ondemand_readahead(struct readahead_control *ractl,
 		goto readit;
 	}
 
-	/*
-	 * oversize read
-	 */
-	if (req_size > max_pages)
-		goto initial_readahead;
-
 	/*
 	 * sequential cache miss
 	 * trivial case: (index - prev_index) == 1
@@ -509,6 +561,16 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	if (index - prev_index <= 1UL)
 		goto initial_readahead;
 
+	if (ra->prev_pos >= 0)
+		stride_pages = ra_stride_update(ractl->mapping, ra, index,
+						prev_index, max_pages);
+
+	/*
+	 * oversize read
+	 */
+	if (req_size > max_pages)
+		goto initial_readahead;
+
 	/*
 	 * Query the page cache and look for the traces(cached history pages)
 	 * that a sequential stream would leave behind.
@@ -522,7 +584,7 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	 * Read as is, and do not pollute the readahead state.
 	 */
 	do_page_cache_ra(ractl, req_size, 0);
-	return;
+	goto stride;
 
 initial_readahead:
 	ra->start = index;
@@ -549,6 +611,12 @@ static void ondemand_readahead(struct readahead_control *ractl,
 
 	ractl->_index = ra->start;
 	do_page_cache_ra(ractl, ra->size, ra->async_size);
+
+stride:
+	if (stride_pages) {
+		ractl->_index = index + ra->stride;
+		do_page_cache_ra(ractl, stride_pages, stride_pages);
+	}
 }
 
 void page_cache_sync_ra(struct readahead_control *ractl,
@@ -724,9 +724,17 @@ LIST_HEAD(vmap_area_list);
 static struct rb_root vmap_area_root = RB_ROOT;
 static bool vmap_initialized __read_mostly;
 
-static struct rb_root purge_vmap_area_root = RB_ROOT;
-static LIST_HEAD(purge_vmap_area_list);
-static DEFINE_SPINLOCK(purge_vmap_area_lock);
+/*
+ * Lazily freed areas are queued per CPU, so that unmap heavy workloads do
+ * not all serialize on one lock. The purge collects them from every CPU
+ * and frees them after a single TLB flush.
+ */
+struct vmap_purge_queue {
+	spinlock_t lock;
+	struct list_head list;
+};
+
+static DEFINE_PER_CPU(struct vmap_purge_queue, vmap_purge_queue);
 
 /*
  * This kmem_cache is used for vmap_area objects. Instead of
@@ -1665,26 +1673,30 @@ void set_iounmap_nonlazy(void)
 static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 {
 	unsigned long resched_threshold;
-	struct list_head local_pure_list;
+	LIST_HEAD(local_pure_list);
 	struct vmap_area *va, *n_va;
+	int cpu;
 
 	lockdep_assert_held(&vmap_purge_lock);
 
-	spin_lock(&purge_vmap_area_lock);
-	purge_vmap_area_root = RB_ROOT;
-	list_replace_init(&purge_vmap_area_list, &local_pure_list);
-	spin_unlock(&purge_vmap_area_lock);
+	for_each_possible_cpu(cpu) {
+		struct vmap_purge_queue *pq = &per_cpu(vmap_purge_queue, cpu);
+
+		if (list_empty(&pq->list))
+			continue;
+
+		spin_lock(&pq->lock);
+		list_splice_init(&pq->list, &local_pure_list);
+		spin_unlock(&pq->lock);
+	}
 
 	if (unlikely(list_empty(&local_pure_list)))
 		return false;
 
-	start = min(start,
-		list_first_entry(&local_pure_list,
-			struct vmap_area, list)->va_start);
-
-	end = max(end,
-		list_last_entry(&local_pure_list,
-			struct vmap_area, list)->va_end);
+	list_for_each_entry(va, &local_pure_list, list) {
+		start = min(start, va->va_start);
+		end = max(end, va->va_end);
+	}
 
 	flush_tlb_kernel_range(start, end);
 	resched_threshold = lazy_max_pages() << 1;
@@ -1749,6 +1761,7 @@ static void purge_vmap_area_lazy(void)
  */
 static void free_vmap_area_noflush(struct vmap_area *va)
 {
+	struct vmap_purge_queue *pq;
 	unsigned long nr_lazy;
 
 	spin_lock(&vmap_area_lock);
@@ -1759,12 +1772,12 @@ static void free_vmap_area_noflush(struct vmap_area *va)
 				PAGE_SHIFT, &vmap_lazy_nr);
 
 	/*
-	 * Merge or place it to the purge tree/list.
+	 * Queue it for the purge, merging happens once it is flushed.
 	 */
-	spin_lock(&purge_vmap_area_lock);
-	merge_or_add_vmap_area(va,
-		&purge_vmap_area_root, &purge_vmap_area_list);
-	spin_unlock(&purge_vmap_area_lock);
+	pq = raw_cpu_ptr(&vmap_purge_queue);
+	spin_lock(&pq->lock);
+	list_add_tail(&va->list, &pq->list);
+	spin_unlock(&pq->lock);
 
 	/* After this point, we may free va at any time */
 	if (unlikely(nr_lazy > lazy_max_pages()))
@@ -2351,10 +2364,14 @@ void __init vmalloc_init(void)
 	for_each_possible_cpu(i) {
 		struct vmap_block_queue *vbq;
 		struct vfree_deferred *p;
+		struct vmap_purge_queue *pq;
 
 		vbq = &per_cpu(vmap_block_queue, i);
 		spin_lock_init(&vbq->lock);
 		INIT_LIST_HEAD(&vbq->free);
+		pq = &per_cpu(vmap_purge_queue, i);
+		spin_lock_init(&pq->lock);
+		INIT_LIST_HEAD(&pq->list);
 		p = &per_cpu(vfree_deferred, i);
 		init_llist_head(&p->list);
 		INIT_WORK(&p->wq, free_work);
@@ -3964,14 +3981,19 @@ static void show_numa_info(struct seq_file *m, struct vm_struct *v)
 static void show_purge_info(struct seq_file *m)
 {
 	struct vmap_area *va;
+	int cpu;
 
-	spin_lock(&purge_vmap_area_lock);
-	list_for_each_entry(va, &purge_vmap_area_list, list) {
-		seq_printf(m, "0x%pK-0x%pK %7ld unpurged vm_area\n",
-			(void *)va->va_start, (void *)va->va_end,
-			va->va_end - va->va_start);
+	for_each_possible_cpu(cpu) {
+		struct vmap_purge_queue *pq = &per_cpu(vmap_purge_queue, cpu);
+
+		spin_lock(&pq->lock);
+		list_for_each_entry(va, &pq->list, list) {
+			seq_printf(m, "0x%pK-0x%pK %7ld unpurged vm_area\n",
+				(void *)va->va_start, (void *)va->va_end,
+				va->va_end - va->va_start);
+		}
+		spin_unlock(&pq->lock);
 	}
-	spin_unlock(&purge_vmap_area_lock);
 }
 
 static int s_show(struct seq_file *m, void *p)
@@ -624,7 +624,7 @@ static int __init workingset_init(void)
 	ret = prealloc_shrinker(&workingset_shadow_shrinker);
 	if (ret)
 		goto err;
-	ret = __list_lru_init(&shadow_nodes, true, &shadow_nodes_key,
+	ret = __list_lru_init(&shadow_nodes, true, false, &shadow_nodes_key,
 			      &workingset_shadow_shrinker);
 	if (ret)
 		goto err_list_lru;
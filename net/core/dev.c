@@ -6184,6 +6184,11 @@ static void init_gro_hash(struct napi_struct *napi)
 		napi->gro_hash[i].count = 0;
 	}
 	napi->gro_bitmask = 0;
+	napi->gro_hash_bits = GRO_HASH_MIN_BITS;
+	napi->gro_quiet_rounds = 0;
+	napi->gro_round_held = 0;
+	napi->gro_round_evicted = 0;
+	memset(&napi->gro_stats, 0, sizeof(napi->gro_stats));
 }
 
 int dev_set_threaded(struct net_device *dev, bool threaded)
@@ -2,10 +2,15 @@
 #include <net/gro.h>
 #include <net/dst_metadata.h>
 #include <net/busy_poll.h>
+#include <linux/hash.h>
 #include <trace/events/net.h>
+#include <trace/events/napi.h>
 
 #define MAX_GRO_SKBS 8
 
+/* Flush rounds with few flows before the hash shrinks again */
+#define GRO_HASH_QUIET_ROUNDS 64
+
 /* This should be increased if a protocol with a bigger head is added. */
 #define GRO_MAX_HEAD (MAX_HEADER + 128)
 
@@ -294,12 +299,45 @@ static void __napi_gro_flush_chain(struct napi_struct *napi, u32 index,
 		skb_list_del_init(skb);
 		napi_gro_complete(napi, skb);
 		napi->gro_hash[index].count--;
+		napi->gro_stats.flushed++;
 	}
 
 	if (!napi->gro_hash[index].count)
 		__clear_bit(index, &napi->gro_bitmask);
 }
 
+/* Size the hash for the flows of the last round, a round being everything
+ * held between two flushes which left the hash empty. Grow as soon as a
+ * bucket overflowed or the chains got long, shrink only after a series of
+ * quiet rounds so a bursty flow mix doesn't make the size flap. Called with
+ * an empty hash, so no skb has to move to its new bucket.
+ */
+static void napi_gro_resize(struct napi_struct *napi)
+{
+	unsigned int bits = napi->gro_hash_bits;
+	unsigned int held = napi->gro_round_held;
+
+	if (napi->gro_round_evicted || held > (MAX_GRO_SKBS / 2) << bits) {
+		napi->gro_quiet_rounds = 0;
+		if (bits < GRO_HASH_MAX_BITS)
+			bits++;
+	} else if (bits > GRO_HASH_MIN_BITS && held < (1U << bits) / 2) {
+		if (++napi->gro_quiet_rounds >= GRO_HASH_QUIET_ROUNDS) {
+			napi->gro_quiet_rounds = 0;
+			bits--;
+		}
+	} else {
+		napi->gro_quiet_rounds = 0;
+	}
+
+	if (bits != napi->gro_hash_bits) {
+		trace_napi_gro_resize(napi, bits);
+		napi->gro_hash_bits = bits;
+	}
+	napi->gro_round_held = 0;
+	napi->gro_round_evicted = 0;
+}
+
 /* napi->gro_hash[].list contains packets ordered by age.
  * youngest packets at the head of it.
  * Complete skbs in reverse order to reduce latencies.
@@ -314,6 +352,9 @@ void napi_gro_flush(struct napi_struct *napi, bool flush_old)
 		base += i;
 		__napi_gro_flush_chain(napi, base, flush_old);
 	}
+
+	if (!napi->gro_bitmask)
+		napi_gro_resize(napi);
 }
 EXPORT_SYMBOL(napi_gro_flush);
 
@@ -433,11 +474,24 @@ static void gro_flush_oldest(struct napi_struct *napi, struct list_head *head)
 	 */
 	skb_list_del_init(oldest);
 	napi_gro_complete(napi, oldest);
+	napi->gro_stats.evicted++;
+	if (napi->gro_round_evicted < U16_MAX)
+		napi->gro_round_evicted++;
+}
+
+/* Drivers fill skb->hash from the RSS hash of the NIC, whose low bits also
+ * picked the rx queue. All flows of this NAPI thus tend to share them, so
+ * mix in the high bits rather than masking.
+ */
+static u32 gro_hash_bucket(const struct napi_struct *napi,
+			   const struct sk_buff *skb)
+{
+	return hash_32(skb_get_hash_raw(skb), napi->gro_hash_bits);
 }
 
 static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff *skb)
 {
-	u32 bucket = skb_get_hash_raw(skb) & (GRO_HASH_BUCKETS - 1);
+	u32 bucket = gro_hash_bucket(napi, skb);
 	struct gro_list *gro_list = &napi->gro_hash[bucket];
 	struct list_head *head = &offload_base;
 	struct packet_offload *ptype;
@@ -506,10 +560,13 @@ static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff
 		skb_list_del_init(pp);
 		napi_gro_complete(napi, pp);
 		gro_list->count--;
+		napi->gro_stats.flushed++;
 	}
 
-	if (same_flow)
+	if (same_flow) {
+		napi->gro_stats.merged++;
 		goto ok;
+	}
 
 	if (NAPI_GRO_CB(skb)->flush)
 		goto normal;
@@ -524,6 +581,9 @@ static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff
 	NAPI_GRO_CB(skb)->last = skb;
 	skb_shinfo(skb)->gso_size = skb_gro_len(skb);
 	list_add(&skb->list, &gro_list->list);
+	napi->gro_stats.held++;
+	if (napi->gro_round_held < U16_MAX)
+		napi->gro_round_held++;
 	ret = GRO_HELD;
 
 pull:
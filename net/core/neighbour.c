@@ -249,11 +249,17 @@ bool neigh_remove_one(struct neighbour *ndel, struct neigh_table *tbl)
 	return false;
 }
 
+/* Number of gc_list entries neigh_forced_gc() looks at before giving up */
+#define NEIGH_FORCED_GC_SCAN	1024
+
 static int neigh_forced_gc(struct neigh_table *tbl)
 {
 	int max_clean = atomic_read(&tbl->gc_entries) - tbl->gc_thresh2;
+	int max_scan = min(atomic_read(&tbl->gc_entries), NEIGH_FORCED_GC_SCAN);
 	unsigned long tref = jiffies - 5 * HZ;
+	u64 start = ktime_get_ns();
 	struct neighbour *n, *tmp;
+	int scanned = 0;
 	int shrunk = 0;
 
 	NEIGH_CACHE_STAT_INC(tbl, forced_gc_runs);
@@ -261,6 +267,9 @@ static int neigh_forced_gc(struct neigh_table *tbl)
 	write_lock_bh(&tbl->lock);
 
 	list_for_each_entry_safe(n, tmp, &tbl->gc_list, gc_list) {
+		if (++scanned > max_scan)
+			break;
+
 		if (refcount_read(&n->refcnt) == 1) {
 			bool remove = false;
 
@@ -273,17 +282,25 @@ static int neigh_forced_gc(struct neigh_table *tbl)
 				remove = true;
 			write_unlock(&n->lock);
 
-			if (remove && neigh_remove_one(n, tbl))
+			if (remove && neigh_remove_one(n, tbl)) {
 				shrunk++;
-			if (shrunk >= max_clean)
-				break;
+				if (shrunk >= max_clean)
+					break;
+				continue;
+			}
 		}
+
+		/* let the next run start with entries not looked at yet */
+		list_move_tail(&n->gc_list, &tbl->gc_list);
 	}
 
 	tbl->last_flush = jiffies;
 
 	write_unlock_bh(&tbl->lock);
 
+	NEIGH_CACHE_STAT_ADD(tbl, forced_gc_usecs,
+			     div_u64(ktime_get_ns() - start, NSEC_PER_USEC));
+
 	return shrunk;
 }
 
@@ -913,12 +930,18 @@ static void neigh_connect(struct neighbour *neigh)
 	neigh->output = neigh->ops->connected_output;
 }
 
+/* Buckets scanned per periodic GC run, and between dropping tbl->lock */
+#define NEIGH_GC_BUCKETS	1024
+#define NEIGH_GC_LOCK_BUCKETS	64
+
 static void neigh_periodic_work(struct work_struct *work)
 {
 	struct neigh_table *tbl = container_of(work, struct neigh_table, gc_work.work);
+	unsigned long delay = NEIGH_VAR(&tbl->parms, BASE_REACHABLE_TIME) >> 1;
+	u64 start = ktime_get_ns();
 	struct neighbour *n;
 	struct neighbour __rcu **np;
-	unsigned int i;
+	unsigned int i, nbuckets;
 	struct neigh_hash_table *nht;
 
 	NEIGH_CACHE_STAT_INC(tbl, periodic_gc_runs);
@@ -939,11 +962,24 @@ static void neigh_periodic_work(struct work_struct *work)
 				neigh_rand_reach_time(NEIGH_VAR(p, BASE_REACHABLE_TIME));
 	}
 
-	if (atomic_read(&tbl->entries) < tbl->gc_thresh1)
+	if (atomic_read(&tbl->entries) < tbl->gc_thresh1) {
+		tbl->gc_bucket = 0;
 		goto out;
+	}
 
-	for (i = 0 ; i < (1 << nht->hash_shift); i++) {
-		np = &nht->hash_buckets[i];
+	/* Only look at a slice of the hash table per run, but run often
+	 * enough to still cover all of it every BASE_REACHABLE_TIME/2.
+	 */
+	nbuckets = 1 << nht->hash_shift;
+	if (nbuckets > NEIGH_GC_BUCKETS)
+		delay = max(delay / DIV_ROUND_UP(nbuckets, NEIGH_GC_BUCKETS), 1UL);
+
+	for (i = 0; i < NEIGH_GC_BUCKETS; i++) {
+		if (tbl->gc_bucket >= (1 << nht->hash_shift)) {
+			tbl->gc_bucket = 0;
+			break;
+		}
+		np = &nht->hash_buckets[tbl->gc_bucket++];
 
 		while ((n = rcu_dereference_protected(*np,
 				lockdep_is_held(&tbl->lock))) != NULL) {
@@ -979,20 +1015,24 @@ static void neigh_periodic_work(struct work_struct *work)
 		 * It's fine to release lock here, even if hash table
 		 * grows while we are preempted.
 		 */
-		write_unlock_bh(&tbl->lock);
-		cond_resched();
-		write_lock_bh(&tbl->lock);
-		nht = rcu_dereference_protected(tbl->nht,
-						lockdep_is_held(&tbl->lock));
+		if ((i + 1) % NEIGH_GC_LOCK_BUCKETS == 0 || need_resched()) {
+			write_unlock_bh(&tbl->lock);
+			cond_resched();
+			write_lock_bh(&tbl->lock);
+			nht = rcu_dereference_protected(tbl->nht,
+							lockdep_is_held(&tbl->lock));
+		}
 	}
 out:
 	/* Cycle through all hash buckets every BASE_REACHABLE_TIME/2 ticks.
 	 * ARP entry timeouts range from 1/2 BASE_REACHABLE_TIME to 3/2
 	 * BASE_REACHABLE_TIME.
 	 */
-	queue_delayed_work(system_power_efficient_wq, &tbl->gc_work,
-			      NEIGH_VAR(&tbl->parms, BASE_REACHABLE_TIME) >> 1);
+	queue_delayed_work(system_power_efficient_wq, &tbl->gc_work, delay);
 	write_unlock_bh(&tbl->lock);
+
+	NEIGH_CACHE_STAT_ADD(tbl, periodic_gc_usecs,
+			     div_u64(ktime_get_ns() - start, NSEC_PER_USEC));
 }
 
 static __inline__ int neigh_max_probes(struct neighbour *n)
@@ -3405,13 +3445,14 @@ static int neigh_stat_seq_show(struct seq_file *seq, void *v)
 	struct neigh_statistics *st = v;
 
 	if (v == SEQ_START_TOKEN) {
-		seq_puts(seq, "entries  allocs   destroys hash_grows lookups  hits     res_failed rcv_probes_mcast rcv_probes_ucast periodic_gc_runs forced_gc_runs unresolved_discards table_fulls\n");
+		seq_puts(seq, "entries  allocs   destroys hash_grows lookups  hits     res_failed rcv_probes_mcast rcv_probes_ucast periodic_gc_runs forced_gc_runs unresolved_discards table_fulls periodic_gc_usecs forced_gc_usecs\n");
 		return 0;
 	}
 
 	seq_printf(seq, "%08x %08lx %08lx %08lx   %08lx %08lx %08lx   "
 			"%08lx         %08lx         %08lx         "
-			"%08lx       %08lx            %08lx\n",
+			"%08lx       %08lx            %08lx    "
+			"%08lx          %08lx\n",
 		   atomic_read(&tbl->entries),
 
 		   st->allocs,
@@ -3429,7 +3470,9 @@ static int neigh_stat_seq_show(struct seq_file *seq, void *v)
 		   st->periodic_gc_runs,
 		   st->forced_gc_runs,
 		   st->unres_discards,
-		   st->table_fulls
+		   st->table_fulls,
+		   st->periodic_gc_usecs,
+		   st->forced_gc_usecs
 		   );
 
 	return 0;
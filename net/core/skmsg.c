@@ -489,7 +489,8 @@ bool sk_msg_is_readable(struct sock *sk)
 EXPORT_SYMBOL_GPL(sk_msg_is_readable);
 
 static struct sk_msg *sk_psock_create_ingress_msg(struct sock *sk,
-						  struct sk_buff *skb)
+						  struct sk_buff *skb,
+						  gfp_t gfp)
 {
 	struct sk_msg *msg;
 
@@ -499,7 +500,7 @@ static struct sk_msg *sk_psock_create_ingress_msg(struct sock *sk,
 	if (!sk_rmem_schedule(sk, skb, skb->truesize))
 		return NULL;
 
-	msg = kzalloc(sizeof(*msg), __GFP_NOWARN | GFP_KERNEL);
+	msg = kzalloc(sizeof(*msg), __GFP_NOWARN | gfp);
 	if (unlikely(!msg))
 		return NULL;
 
@@ -541,7 +542,7 @@ static int sk_psock_skb_ingress_self(struct sk_psock *psock, struct sk_buff *skb
 				     u32 off, u32 len);
 
 static int sk_psock_skb_ingress(struct sk_psock *psock, struct sk_buff *skb,
-				u32 off, u32 len)
+				u32 off, u32 len, gfp_t gfp)
 {
 	struct sock *sk = psock->sk;
 	struct sk_msg *msg;
@@ -553,7 +554,7 @@ static int sk_psock_skb_ingress(struct sk_psock *psock, struct sk_buff *skb,
 	 */
 	if (unlikely(skb->sk == sk))
 		return sk_psock_skb_ingress_self(psock, skb, off, len);
-	msg = sk_psock_create_ingress_msg(sk, skb);
+	msg = sk_psock_create_ingress_msg(sk, skb, gfp);
 	if (!msg)
 		return -EAGAIN;
 
@@ -599,7 +600,7 @@ static int sk_psock_handle_skb(struct sk_psock *psock, struct sk_buff *skb,
 			return -EAGAIN;
 		return skb_send_sock(psock->sk, skb, off, len);
 	}
-	return sk_psock_skb_ingress(psock, skb, off, len);
+	return sk_psock_skb_ingress(psock, skb, off, len, GFP_KERNEL);
 }
 
 static void sk_psock_skb_state(struct sk_psock *psock,
@@ -640,14 +641,7 @@ static void sk_psock_backlog(struct work_struct *work)
 		goto start;
 
 	while ((skb = skb_dequeue(&psock->ingress_skb))) {
-		len = skb->len;
-		off = 0;
-		if (skb_bpf_strparser(skb)) {
-			struct strp_msg *stm = strp_msg(skb);
-
-			off = stm->offset;
-			len = stm->full_len;
-		}
+		sk_psock_skb_offsets(skb, &off, &len);
 start:
 		ingress = skb_bpf_ingress(skb);
 		skb_bpf_redirect_clear(skb);
@@ -877,6 +871,46 @@ int sk_psock_msg_verdict(struct sock *sk, struct sk_psock *psock,
 }
 EXPORT_SYMBOL_GPL(sk_psock_msg_verdict);
 
+static void sk_psock_skb_offsets(struct sk_buff *skb, u32 *off, u32 *len)
+{
+	*len = skb->len;
+	*off = 0;
+	if (skb_bpf_strparser(skb)) {
+		struct strp_msg *stm = strp_msg(skb);
+
+		*off = stm->offset;
+		*len = stm->full_len;
+	}
+}
+
+/* Deliver an ingress redirect straight to the receive queue of the peer
+ * instead of bouncing it through its backlog work. Only done while the
+ * peer has nothing queued, so data can't be reordered, and while it has
+ * receive buffer space, everything else is left to the backlog.
+ */
+static bool sk_psock_skb_redirect_direct(struct sk_psock *psock,
+					 struct sk_buff *skb)
+{
+	unsigned long sk_redir = skb->_sk_redir;
+	struct sock *sk = psock->sk;
+	u32 off, len;
+
+	if (!skb_bpf_ingress(skb) ||
+	    !skb_queue_empty(&psock->ingress_skb) ||
+	    READ_ONCE(psock->work_state.skb) ||
+	    sk_under_memory_pressure(sk) ||
+	    atomic_read(&sk->sk_rmem_alloc) > sk->sk_rcvbuf)
+		return false;
+
+	sk_psock_skb_offsets(skb, &off, &len);
+	skb_bpf_redirect_clear(skb);
+	if (sk_psock_skb_ingress(psock, skb, off, len, GFP_ATOMIC) == len)
+		return true;
+
+	skb->_sk_redir = sk_redir;
+	return false;
+}
+
 static int sk_psock_skb_redirect(struct sk_psock *from, struct sk_buff *skb)
 {
 	struct sk_psock *psock_other;
@@ -901,6 +935,11 @@ static int sk_psock_skb_redirect(struct sk_psock *from, struct sk_buff *skb)
 		sock_drop(from->sk, skb);
 		return -EIO;
 	}
+	if (sk_psock_test_state(psock_other, SK_PSOCK_TX_ENABLED) &&
+	    sk_psock_skb_redirect_direct(psock_other, skb)) {
+		from->stats.redir_direct++;
+		return 0;
+	}
 	spin_lock_bh(&psock_other->ingress_lock);
 	if (!sk_psock_test_state(psock_other, SK_PSOCK_TX_ENABLED)) {
 		spin_unlock_bh(&psock_other->ingress_lock);
@@ -912,6 +951,7 @@ static int sk_psock_skb_redirect(struct sk_psock *from, struct sk_buff *skb)
 	skb_queue_tail(&psock_other->ingress_skb, skb);
 	schedule_work(&psock_other->work);
 	spin_unlock_bh(&psock_other->ingress_lock);
+	from->stats.redir_backlog++;
 	return 0;
 }
 
@@ -976,21 +1016,17 @@ static int sk_psock_verdict_apply(struct sk_psock *psock, struct sk_buff *skb,
 		 * retrying later from workqueue.
 		 */
 		if (skb_queue_empty(&psock->ingress_skb)) {
-			len = skb->len;
-			off = 0;
-			if (skb_bpf_strparser(skb)) {
-				struct strp_msg *stm = strp_msg(skb);
-
-				off = stm->offset;
-				len = stm->full_len;
-			}
+			sk_psock_skb_offsets(skb, &off, &len);
 			err = sk_psock_skb_ingress_self(psock, skb, off, len);
+			if (err >= 0)
+				psock->stats.pass_direct++;
 		}
 		if (err < 0) {
 			spin_lock_bh(&psock->ingress_lock);
 			if (sk_psock_test_state(psock, SK_PSOCK_TX_ENABLED)) {
 				skb_queue_tail(&psock->ingress_skb, skb);
 				schedule_work(&psock->work);
+				psock->stats.pass_backlog++;
 				err = 0;
 			}
 			spin_unlock_bh(&psock->ingress_lock);
@@ -1146,11 +1182,14 @@ static void sk_psock_done_strp(struct sk_psock *psock)
 }
 #endif /* CONFIG_BPF_STREAM_PARSER */
 
+/* Called for each skb of a receive burst, under the RCU read lock and with
+ * migration disabled by sk_psock_verdict_data_ready().
+ */
 static int sk_psock_verdict_recv(read_descriptor_t *desc, struct sk_buff *skb,
 				 unsigned int offset, size_t orig_len)
 {
-	struct sock *sk = (struct sock *)desc->arg.data;
-	struct sk_psock *psock;
+	struct sk_psock *psock = desc->arg.data;
+	struct sock *sk = psock->sk;
 	struct bpf_prog *prog;
 	int ret = __SK_DROP;
 	int len = skb->len;
@@ -1162,13 +1201,6 @@ static int sk_psock_verdict_recv(read_descriptor_t *desc, struct sk_buff *skb,
 		return 0;
 	}
 
-	rcu_read_lock();
-	psock = sk_psock(sk);
-	if (unlikely(!psock)) {
-		len = 0;
-		sock_drop(sk, skb);
-		goto out;
-	}
 	prog = READ_ONCE(psock->progs.stream_verdict);
 	if (!prog)
 		prog = READ_ONCE(psock->progs.skb_verdict);
@@ -1176,30 +1208,40 @@ static int sk_psock_verdict_recv(read_descriptor_t *desc, struct sk_buff *skb,
 		skb->sk = sk;
 		skb_dst_drop(skb);
 		skb_bpf_redirect_clear(skb);
-		ret = bpf_prog_run_pin_on_cpu(prog, skb);
+		ret = bpf_prog_run(prog, skb);
 		ret = sk_psock_map_verd(ret, skb_bpf_redirect_fetch(skb));
 		skb->sk = NULL;
 	}
 	if (sk_psock_verdict_apply(psock, skb, ret) < 0)
 		len = 0;
-out:
-	rcu_read_unlock();
 	return len;
 }
 
 static void sk_psock_verdict_data_ready(struct sock *sk)
 {
 	struct socket *sock = sk->sk_socket;
+	struct sk_psock *psock;
 	read_descriptor_t desc;
 
 	if (unlikely(!sock || !sock->ops || !sock->ops->read_sock))
 		return;
 
-	desc.arg.data = sk;
-	desc.error = 0;
-	desc.count = 1;
-
-	sock->ops->read_sock(sk, &desc, sk_psock_verdict_recv);
+	/* Look the psock up and pin the cpu once for the whole burst of
+	 * skbs read_sock() hands us, rather than once per skb.
+	 */
+	rcu_read_lock();
+	psock = sk_psock(sk);
+	if (likely(psock)) {
+		desc.arg.data = psock;
+		desc.error = 0;
+		desc.count = 1;
+
+		psock->stats.verdict_bursts++;
+		migrate_disable();
+		sock->ops->read_sock(sk, &desc, sk_psock_verdict_recv);
+		migrate_enable();
+	}
+	rcu_read_unlock();
 }
 
 void sk_psock_start_verdict(struct sock *sk, struct sk_psock *psock)
@@ -404,14 +404,32 @@ static void __xdp_return(void *data, struct xdp_mem_info *mem, bool napi_direct,
 	}
 }
 
+static void xdp_return_frags(struct skb_shared_info *sinfo,
+			     struct xdp_mem_info *mem, bool napi_direct)
+{
+	int i;
+
+	for (i = 0; i < sinfo->nr_frags; i++)
+		__xdp_return(skb_frag_address(&sinfo->frags[i]), mem,
+			     napi_direct, NULL);
+}
+
 void xdp_return_frame(struct xdp_frame *xdpf)
 {
+	if (unlikely(xdp_frame_has_frags(xdpf)))
+		xdp_return_frags(xdp_get_shared_info_from_frame(xdpf),
+				 &xdpf->mem, false);
+
 	__xdp_return(xdpf->data, &xdpf->mem, false, NULL);
 }
 EXPORT_SYMBOL_GPL(xdp_return_frame);
 
 void xdp_return_frame_rx_napi(struct xdp_frame *xdpf)
 {
+	if (unlikely(xdp_frame_has_frags(xdpf)))
+		xdp_return_frags(xdp_get_shared_info_from_frame(xdpf),
+				 &xdpf->mem, true);
+
 	__xdp_return(xdpf->data, &xdpf->mem, true, NULL);
 }
 EXPORT_SYMBOL_GPL(xdp_return_frame_rx_napi);
@@ -422,7 +440,8 @@ EXPORT_SYMBOL_GPL(xdp_return_frame_rx_napi);
  * I-cache and D-cache.
  * The bulk queue size is set to 16 to be aligned to how
  * XDP_REDIRECT bulking works. The bulk is flushed when
- * it is full or when mem.id changes.
+ * it is full or when mem.id changes. Fragments of multi-buffer
+ * frames go into the same bulk as their linear part.
  * xdp_frame_bulk is usually stored/allocated on the function
  * call-stack to avoid locking penalties.
  */
@@ -447,7 +466,7 @@ void xdp_return_frame_bulk(struct xdp_frame *xdpf,
 	struct xdp_mem_allocator *xa;
 
 	if (mem->type != MEM_TYPE_PAGE_POOL) {
-		__xdp_return(xdpf->data, &xdpf->mem, false, NULL);
+		xdp_return_frame(xdpf);
 		return;
 	}
 
@@ -466,12 +485,28 @@ void xdp_return_frame_bulk(struct xdp_frame *xdpf,
 		bq->xa = rhashtable_lookup(mem_id_ht, &mem->id, mem_id_rht_params);
 	}
 
+	if (unlikely(xdp_frame_has_frags(xdpf))) {
+		struct skb_shared_info *sinfo;
+		int i;
+
+		sinfo = xdp_get_shared_info_from_frame(xdpf);
+		for (i = 0; i < sinfo->nr_frags; i++) {
+			bq->q[bq->count++] = skb_frag_address(&sinfo->frags[i]);
+			if (bq->count == XDP_BULK_QUEUE_SIZE)
+				xdp_flush_frame_bulk(bq);
+		}
+	}
+
 	bq->q[bq->count++] = xdpf->data;
 }
 EXPORT_SYMBOL_GPL(xdp_return_frame_bulk);
 
 void xdp_return_buff(struct xdp_buff *xdp)
 {
+	if (unlikely(xdp_buff_has_frags(xdp)))
+		xdp_return_frags(xdp_get_shared_info_from_buff(xdp),
+				 &xdp->rxq->mem, true);
+
 	__xdp_return(xdp->data, &xdp->rxq->mem, true, xdp);
 }
 
@@ -561,8 +596,15 @@ struct sk_buff *__xdp_build_skb_from_frame(struct xdp_frame *xdpf,
 					   struct sk_buff *skb,
 					   struct net_device *dev)
 {
-	unsigned int headroom, frame_size;
+	unsigned int headroom, frame_size, frags_size = 0;
 	void *hard_start;
+	u8 nr_frags = 0;
+
+	/* build_skb_around() clears nr_frags, the frags[] stay in place */
+	if (unlikely(xdp_frame_has_frags(xdpf))) {
+		nr_frags = xdp_get_shared_info_from_frame(xdpf)->nr_frags;
+		frags_size = xdp_get_frame_len(xdpf) - xdpf->len;
+	}
 
 	/* Part of headroom was reserved to xdpf */
 	headroom = sizeof(*xdpf) + xdpf->headroom;
@@ -582,6 +624,13 @@ struct sk_buff *__xdp_build_skb_from_frame(struct xdp_frame *xdpf,
 	if (xdpf->metasize)
 		skb_metadata_set(skb, xdpf->metasize);
 
+	if (unlikely(nr_frags)) {
+		skb_shinfo(skb)->nr_frags = nr_frags;
+		skb->len += frags_size;
+		skb->data_len += frags_size;
+		skb->truesize += nr_frags * xdpf->frame_sz;
+	}
+
 	/* Essential SKB info: protocol and skb->dev */
 	skb->protocol = eth_type_trans(skb, dev);
 
@@ -591,8 +640,11 @@ struct sk_buff *__xdp_build_skb_from_frame(struct xdp_frame *xdpf,
 	 * - RX ring dev queue index	(skb_record_rx_queue)
 	 */
 
-	/* Until page_pool get SKB return path, release DMA here */
-	xdp_release_frame(xdpf);
+	/* Let the skb free path hand page_pool pages back to their pool */
+#ifdef CONFIG_PAGE_POOL
+	if (xdpf->mem.type == MEM_TYPE_PAGE_POOL)
+		skb_mark_for_recycle(skb);
+#endif
 
 	/* Allow SKB to reuse area used by xdp_frame */
 	xdp_scrub_frame(xdpf);
@@ -623,6 +675,10 @@ struct xdp_frame *xdpf_clone(struct xdp_frame *xdpf)
 	struct page *page;
 	void *addr;
 
+	/* only the linear part is copied */
+	if (unlikely(xdp_frame_has_frags(xdpf)))
+		return NULL;
+
 	headroom = xdpf->headroom + sizeof(*xdpf);
 	totalsize = headroom + xdpf->len;
 
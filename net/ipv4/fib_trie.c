@@ -60,6 +60,7 @@
 #include <linux/export.h>
 #include <linux/vmalloc.h>
 #include <linux/notifier.h>
+#include <linux/hash.h>
 #include <net/net_namespace.h>
 #include <net/ip.h>
 #include <net/protocol.h>
@@ -162,11 +163,48 @@ struct trie_stat {
 	unsigned int nodesizes[MAX_STAT_DEPTH];
 };
 
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+#define TRIE_CACHE_SHIFT	8
+
+/* The first leaf a lookup for @key reaches, before any of the alias
+ * checks. That only depends on the trie, not on tos, scope or oif, so
+ * the entry is valid for any lookup of @key until the trie changes.
+ */
+struct trie_cache_entry {
+	t_key key;
+	unsigned int genid;
+	struct key_vector *leaf;
+};
+
+struct trie_cache {
+	struct trie_cache_entry entries[1 << TRIE_CACHE_SHIFT];
+};
+
+/* Bumped after every change which may move the first leaf reached for
+ * a key, and before a node is handed to RCU so that no cache entry can
+ * hand out a pointer to it after the grace period started.
+ */
+static atomic_t trie_cache_genid;
+
+static inline void trie_cache_flush(void)
+{
+	smp_mb__before_atomic();
+	atomic_inc(&trie_cache_genid);
+}
+#else
+static inline void trie_cache_flush(void)
+{
+}
+#endif
+
 struct trie {
 	struct key_vector kv[1];
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 	struct trie_use_stats __percpu *stats;
 #endif
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	struct trie_cache __percpu *cache;
+#endif
 };
 
 static struct key_vector *resize(struct trie *t, struct key_vector *tn);
@@ -314,7 +352,11 @@ static void __node_free_rcu(struct rcu_head *head)
 		kvfree(n);
 }
 
-#define node_free(n) call_rcu(&tn_info(n)->rcu, __node_free_rcu)
+#define node_free(n)						\
+	do {							\
+		trie_cache_flush();				\
+		call_rcu(&tn_info(n)->rcu, __node_free_rcu);	\
+	} while (0)
 
 static struct tnode *tnode_alloc(int bits)
 {
@@ -1148,8 +1190,13 @@ static int fib_insert_alias(struct trie *t, struct key_vector *tp,
 			    struct key_vector *l, struct fib_alias *new,
 			    struct fib_alias *fa, t_key key)
 {
-	if (!l)
-		return fib_insert_node(t, tp, new, key);
+	if (!l) {
+		int err = fib_insert_node(t, tp, new, key);
+
+		/* a new leaf may now be the first match for some keys */
+		trie_cache_flush();
+		return err;
+	}
 
 	if (fa) {
 		hlist_add_before_rcu(&new->fa_list, &fa->fa_list);
@@ -1175,6 +1222,7 @@ static int fib_insert_alias(struct trie *t, struct key_vector *tp,
 	if (l->slen < new->fa_slen) {
 		l->slen = new->fa_slen;
 		node_push_suffix(tp, new->fa_slen);
+		trie_cache_flush();
 	}
 
 	return 0;
@@ -1437,6 +1485,11 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 	struct trie_use_stats __percpu *stats = t->stats;
 #endif
 	const t_key key = ntohl(flp->daddr);
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	struct trie_cache_entry *ce = NULL;
+	unsigned int genid = 0;
+	bool cached = false;
+#endif
 	struct key_vector *n, *pn;
 	struct fib_alias *fa;
 	unsigned long index;
@@ -1455,6 +1508,24 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 	this_cpu_inc(stats->gets);
 #endif
 
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	/* Only the forwarding path in softirq context uses the cache, then
+	 * nothing else on this cpu can touch the entry while we look at it.
+	 */
+	if (in_softirq()) {
+		genid = atomic_read_acquire(&trie_cache_genid);
+		ce = &this_cpu_ptr(t->cache)->entries[hash_32(key,
+							      TRIE_CACHE_SHIFT)];
+		if (ce->leaf && ce->key == key && ce->genid == genid) {
+			n = ce->leaf;
+			ce = NULL;
+			cached = true;
+			goto found;
+		}
+	}
+walk:
+#endif
+
 	/* Step 1: Travel to the longest prefix match in the trie */
 	for (;;) {
 		index = get_cindex(key, n);
@@ -1554,6 +1625,15 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 	}
 
 found:
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	/* only the first leaf reached is independent of the alias checks */
+	if (ce) {
+		ce->key = key;
+		ce->genid = genid;
+		ce->leaf = n;
+		ce = NULL;
+	}
+#endif
 	/* this line carries forward the xor from earlier in the function */
 	index = key ^ n->key;
 
@@ -1628,6 +1708,18 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 miss:
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 	this_cpu_inc(stats->semantic_match_miss);
+#endif
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	/* no state to backtrace from, walk the trie from the top */
+	if (cached) {
+		cached = false;
+		n = get_child_rcu(pn, cindex);
+		if (!n) {
+			trace_fib_table_lookup(tb->tb_id, flp, NULL, -EAGAIN);
+			return -EAGAIN;
+		}
+		goto walk;
+	}
 #endif
 	goto backtrace;
 }
@@ -1662,6 +1754,7 @@ static void fib_remove_alias(struct trie *t, struct key_vector *tp,
 	/* update the trie with the latest suffix length */
 	l->slen = fa->fa_slen;
 	node_pull_suffix(tp, fa->fa_slen);
+	trie_cache_flush();
 }
 
 static void fib_notify_alias_delete(struct net *net, u32 key,
@@ -1876,6 +1969,9 @@ static void fib_trie_free(struct fib_table *tb)
 
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 	free_percpu(t->stats);
+#endif
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	free_percpu(t->cache);
 #endif
 	kfree(tb);
 }
@@ -2005,6 +2101,7 @@ void fib_table_flush_external(struct fib_table *tb)
 			node_free(n);
 		}
 	}
+	trie_cache_flush();
 }
 
 /* Caller must hold RTNL. */
@@ -2088,6 +2185,7 @@ int fib_table_flush(struct net *net, struct fib_table *tb, bool flush_all)
 		}
 	}
 
+	trie_cache_flush();
 	pr_debug("trie_flush found=%d\n", found);
 	return found;
 }
@@ -2231,12 +2329,18 @@ int fib_notify(struct net *net, struct notifier_block *nb,
 static void __trie_free_rcu(struct rcu_head *head)
 {
 	struct fib_table *tb = container_of(head, struct fib_table, rcu);
-#ifdef CONFIG_IP_FIB_TRIE_STATS
+#if defined(CONFIG_IP_FIB_TRIE_STATS) || defined(CONFIG_IP_FIB_TRIE_CACHE)
 	struct trie *t = (struct trie *)tb->tb_data;
 
-	if (tb->tb_data == tb->__data)
+	if (tb->tb_data == tb->__data) {
+#ifdef CONFIG_IP_FIB_TRIE_STATS
 		free_percpu(t->stats);
-#endif /* CONFIG_IP_FIB_TRIE_STATS */
+#endif
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+		free_percpu(t->cache);
+#endif
+	}
+#endif
 	kfree(tb);
 }
 
@@ -2414,7 +2518,17 @@ struct fib_table *fib_trie_table(u32 id, struct fib_table *alias)
 	t->stats = alloc_percpu(struct trie_use_stats);
 	if (!t->stats) {
 		kfree(tb);
-		tb = NULL;
+		return NULL;
+	}
+#endif
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	t->cache = alloc_percpu(struct trie_cache);
+	if (!t->cache) {
+#ifdef CONFIG_IP_FIB_TRIE_STATS
+		free_percpu(t->stats);
+#endif
+		kfree(tb);
+		return NULL;
 	}
 #endif
 
@@ -718,9 +718,17 @@ EXPORT_SYMBOL_GPL(inet_unhash);
  * RFC claims using TABLE_LENGTH=10 buckets gives an improvement,
  * we use 256 instead to really give more isolation and
  * privacy, this only consumes 1 KB of kernel memory.
+ *
+ * The table only holds the random seeds. The per bucket counters the
+ * RFC increments are kept per cpu (another 1 KB each), so busy connect()
+ * paths on many cpus don't bounce the table around, and each cpu starts
+ * its scan in its own share of the range. Concurrent connects to one destination then
+ * probe different ports and bind bucket locks instead of racing for the
+ * same ones.
  */
 #define INET_TABLE_PERTURB_SHIFT 8
 static u32 table_perturb[1 << INET_TABLE_PERTURB_SHIFT];
+static DEFINE_PER_CPU(u32 [1 << INET_TABLE_PERTURB_SHIFT], port_cursor);
 
 int __inet_hash_connect(struct inet_timewait_death_row *death_row,
 		struct sock *sk, u32 port_offset,
@@ -736,7 +744,7 @@ int __inet_hash_connect(struct inet_timewait_death_row *death_row,
 	u32 remaining, offset;
 	int ret, i, low, high;
 	int l3mdev;
-	u32 index;
+	u32 index, share;
 
 	if (port) {
 		head = &hinfo->bhash[inet_bhashfn(net, port,
@@ -766,7 +774,10 @@ int __inet_hash_connect(struct inet_timewait_death_row *death_row,
 	net_get_random_once(table_perturb, sizeof(table_perturb));
 	index = hash_32(port_offset, INET_TABLE_PERTURB_SHIFT);
 
-	offset = (READ_ONCE(table_perturb[index]) + port_offset) % remaining;
+	share = div_u64((u64)remaining * raw_smp_processor_id(), nr_cpu_ids);
+
+	offset = table_perturb[index] + this_cpu_read(port_cursor[index]);
+	offset = (offset + port_offset + share) % remaining;
 	/* In first pass we try ports of @low parity.
 	 * inet_csk_get_port() does the opposite choice.
 	 */
@@ -825,9 +836,9 @@ int __inet_hash_connect(struct inet_timewait_death_row *death_row,
 	 */
 	if (!i && !(prandom_u32() % 16))
 		i = 2;
-	WRITE_ONCE(table_perturb[index], READ_ONCE(table_perturb[index]) + i + 2);
-
 	/* Head lock still held and bh's disabled */
+	__this_cpu_add(port_cursor[index], i + 2);
+
 	inet_bind_hash(sk, tb, port);
 	if (sk_unhashed(sk)) {
 		inet_sk(sk)->inet_sport = htons(port);
@@ -1288,6 +1288,15 @@ static struct ctl_table ipv4_net_table[] = {
 		.extra1		= SYSCTL_ZERO,
 		.extra2		= SYSCTL_ONE,
 	},
+	{
+		.procname	= "tcp_pace_wheel",
+		.data		= &init_net.ipv4.sysctl_tcp_pace_wheel,
+		.maxlen		= sizeof(u8),
+		.mode		= 0644,
+		.proc_handler	= proc_dou8vec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 	{
 		.procname	= "tcp_invalid_ratelimit",
 		.data		= &init_net.ipv4.sysctl_tcp_invalid_ratelimit,
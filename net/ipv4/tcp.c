@@ -1187,17 +1187,24 @@ int tcp_sendmsg_locked(struct sock *sk, struct msghdr *msg, size_t size)
 
 	flags = msg->msg_flags;
 
-	if (flags & MSG_ZEROCOPY && size && sock_flag(sk, SOCK_ZEROCOPY)) {
-		skb = tcp_write_queue_tail(sk);
-		uarg = msg_zerocopy_realloc(sk, size, skb_zcopy(skb));
-		if (!uarg) {
-			err = -ENOBUFS;
-			goto out_err;
-		}
+	if ((flags & MSG_ZEROCOPY) && size) {
+		if (msg->msg_ubuf) {
+			/* the caller owns the uarg and gets its own notification */
+			uarg = msg->msg_ubuf;
+			net_zcopy_get(uarg);
+			zc = sk->sk_route_caps & NETIF_F_SG;
+		} else if (sock_flag(sk, SOCK_ZEROCOPY)) {
+			skb = tcp_write_queue_tail(sk);
+			uarg = msg_zerocopy_realloc(sk, size, skb_zcopy(skb));
+			if (!uarg) {
+				err = -ENOBUFS;
+				goto out_err;
+			}
 
-		zc = sk->sk_route_caps & NETIF_F_SG;
-		if (!zc)
-			uarg->zerocopy = 0;
+			zc = sk->sk_route_caps & NETIF_F_SG;
+			if (!zc)
+				uarg->zerocopy = 0;
+		}
 	}
 
 	if (unlikely(flags & MSG_FASTOPEN || inet_sk(sk)->defer_connect) &&
@@ -2082,6 +2089,7 @@ static int tcp_zerocopy_receive(struct sock *sk,
 	struct sk_buff *skb = NULL;
 	u32 seq = tp->copied_seq;
 	u32 total_bytes_to_map;
+	bool batch_spans_skbs = false;
 	int inq = tcp_inq(sk);
 	int ret;
 
@@ -2138,7 +2146,10 @@ static int tcp_zerocopy_receive(struct sock *sk,
 				if (zc->recv_skip_hint > 0)
 					break;
 				skb = skb->next;
-				offset = seq - TCP_SKB_CB(skb)->seq;
+				offset = seq + PAGE_SIZE * pages_to_map -
+					 TCP_SKB_CB(skb)->seq;
+				if (pages_to_map)
+					batch_spans_skbs = true;
 			} else {
 				skb = tcp_recv_skb(sk, seq, &offset);
 			}
@@ -2165,11 +2176,11 @@ static int tcp_zerocopy_receive(struct sock *sk,
 		length += PAGE_SIZE;
 		zc->recv_skip_hint -= PAGE_SIZE;
 		frags++;
-		if (pages_to_map == TCP_ZEROCOPY_PAGE_BATCH_SIZE ||
-		    zc->recv_skip_hint < PAGE_SIZE) {
-			/* Either full batch, or we're about to go to next skb
-			 * (and we cannot unroll failed ops across skbs).
-			 */
+		/* Keep filling the batch across skbs, header split nics hand
+		 * us a few pages per skb only and each vm_insert_pages() call
+		 * takes the page table lock again.
+		 */
+		if (pages_to_map == TCP_ZEROCOPY_PAGE_BATCH_SIZE) {
 			ret = tcp_zerocopy_vm_insert_batch(vma, pages,
 							   pages_to_map,
 							   &address, &length,
@@ -2178,6 +2189,7 @@ static int tcp_zerocopy_receive(struct sock *sk,
 			if (ret)
 				goto out;
 			pages_to_map = 0;
+			batch_spans_skbs = false;
 		}
 	}
 	if (pages_to_map) {
@@ -2187,6 +2199,14 @@ static int tcp_zerocopy_receive(struct sock *sk,
 	}
 out:
 	mmap_read_unlock(current->mm);
+	/* A failed insert rolled recv_skip_hint back relative to the last skb,
+	 * but the unmapped pages may start in an earlier one. Point the hint
+	 * at the rest of the skb holding the first unmapped byte instead.
+	 */
+	if (unlikely(ret) && batch_spans_skbs) {
+		skb = tcp_recv_skb(sk, seq, &offset);
+		zc->recv_skip_hint = skb ? skb->len - offset : 0;
+	}
 	/* Try to copy straggler data. */
 	if (!ret)
 		copylen = tcp_zc_handle_leftover(zc, sk, skb, &seq, copybuf_len, tss);
@@ -1117,15 +1117,187 @@ void tcp_release_cb(struct sock *sk)
 }
 EXPORT_SYMBOL(tcp_release_cb);
 
+/*
+ * Pacing wheel.
+ *
+ * With many paced flows and no fq qdisc, one pacing hrtimer per socket
+ * means one timer interrupt and one rbtree operation per paced packet
+ * gap. When sysctl_tcp_pace_wheel is set, pacing delays shorter than the
+ * wheel horizon instead put the socket into a per cpu calendar queue of
+ * TCP_PACE_SLOTS slots, TCP_PACE_SLOT_NS wide each. A single hrtimer per
+ * cpu fires at the end of the earliest busy slot and releases every
+ * socket of all slots which became due, so the cost per flow stays
+ * constant. Sockets leave at the end of their slot, at most
+ * TCP_PACE_SLOT_NS after their tcp_wstamp_ns. Longer delays keep using
+ * the socket pacing hrtimer.
+ */
+#define TCP_PACE_SLOT_SHIFT	14	/* ~16 usec per slot */
+#define TCP_PACE_SLOT_NS	(1ULL << TCP_PACE_SLOT_SHIFT)
+#define TCP_PACE_SLOTS		512	/* ~8 msec horizon */
+
+struct tcp_pace_wheel {
+	spinlock_t		lock;
+	struct hrtimer		timer;
+	u64			clock;	 /* first slot not yet released */
+	u64			expires; /* armed expiry, U64_MAX if idle */
+	struct list_head	expired; /* sockets being released */
+	DECLARE_BITMAP(busy, TCP_PACE_SLOTS);
+	struct list_head	slots[TCP_PACE_SLOTS];
+};
+static DEFINE_PER_CPU(struct tcp_pace_wheel, tcp_pace_wheel);
+
+/* Called with w->lock held */
+static void tcp_pace_wheel_arm(struct tcp_pace_wheel *w)
+{
+	unsigned int first = w->clock % TCP_PACE_SLOTS;
+	unsigned int bit;
+	u64 slot;
+
+	bit = find_next_bit(w->busy, TCP_PACE_SLOTS, first);
+	if (bit < TCP_PACE_SLOTS) {
+		slot = w->clock + bit - first;
+	} else {
+		bit = find_first_bit(w->busy, first);
+		if (bit >= first)
+			return;
+		slot = w->clock + TCP_PACE_SLOTS - first + bit;
+	}
+
+	w->expires = (slot + 1) << TCP_PACE_SLOT_SHIFT;
+	hrtimer_start(&w->timer, ns_to_ktime(w->expires),
+		      HRTIMER_MODE_ABS_PINNED_SOFT);
+}
+
+static enum hrtimer_restart tcp_pace_wheel_kick(struct hrtimer *timer)
+{
+	struct tcp_pace_wheel *w = container_of(timer, struct tcp_pace_wheel,
+						timer);
+	u64 now = ktime_get_ns() >> TCP_PACE_SLOT_SHIFT;
+	struct tcp_sock *tp;
+	u64 n;
+
+	spin_lock(&w->lock);
+	w->expires = U64_MAX;
+	n = now > w->clock ? now - w->clock : 0;
+	/* a whole lap late, every slot is due */
+	for (n = min_t(u64, n, TCP_PACE_SLOTS); n; n--, w->clock++) {
+		unsigned int i = w->clock % TCP_PACE_SLOTS;
+
+		if (!__test_and_clear_bit(i, w->busy))
+			continue;
+		list_splice_tail_init(&w->slots[i], &w->expired);
+	}
+	w->clock = max(w->clock, now);
+
+	/* tcp_pace_wheel_cancel() may take sockets off w->expired meanwhile */
+	while ((tp = list_first_entry_or_null(&w->expired, struct tcp_sock,
+					      pace_node))) {
+		struct sock *sk = (struct sock *)tp;
+
+		list_del_init(&tp->pace_node);
+		WRITE_ONCE(tp->pace_wheel, NULL);
+		spin_unlock(&w->lock);
+
+		tcp_tsq_handler(sk);
+		sock_put(sk);
+
+		spin_lock(&w->lock);
+	}
+
+	if (w->expires == U64_MAX)
+		tcp_pace_wheel_arm(w);
+	spin_unlock(&w->lock);
+
+	return HRTIMER_NORESTART;
+}
+
+/* Queue sk until tcp_wstamp_ns, false if that is beyond the wheel horizon */
+static bool tcp_pace_wheel_add(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct tcp_pace_wheel *w;
+	u64 slot, now;
+	bool ret = false;
+
+	now = tp->tcp_clock_cache >> TCP_PACE_SLOT_SHIFT;
+	slot = tp->tcp_wstamp_ns >> TCP_PACE_SLOT_SHIFT;
+
+	local_bh_disable();
+	w = this_cpu_ptr(&tcp_pace_wheel);
+	spin_lock(&w->lock);
+	/* an idle wheel stopped turning, catch up with the time */
+	if (w->expires == U64_MAX && bitmap_empty(w->busy, TCP_PACE_SLOTS))
+		w->clock = max(w->clock, now);
+	if (slot >= w->clock + TCP_PACE_SLOTS)
+		goto out;
+
+	if (slot < w->clock)
+		slot = w->clock;
+	list_add_tail(&tp->pace_node, &w->slots[slot % TCP_PACE_SLOTS]);
+	__set_bit(slot % TCP_PACE_SLOTS, w->busy);
+	WRITE_ONCE(tp->pace_wheel, w);
+	if (((slot + 1) << TCP_PACE_SLOT_SHIFT) < w->expires) {
+		w->expires = (slot + 1) << TCP_PACE_SLOT_SHIFT;
+		hrtimer_start(&w->timer, ns_to_ktime(w->expires),
+			      HRTIMER_MODE_ABS_PINNED_SOFT);
+	}
+	ret = true;
+out:
+	spin_unlock(&w->lock);
+	local_bh_enable();
+	return ret;
+}
+
+/**
+ * tcp_pace_wheel_cancel - take a socket off its pacing wheel
+ * @sk: socket
+ *
+ * Returns true if @sk was queued, the caller then owns the socket
+ * reference taken when it was added.
+ */
+bool tcp_pace_wheel_cancel(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct tcp_pace_wheel *w;
+	bool ret = false;
+
+	w = READ_ONCE(tp->pace_wheel);
+	if (!w)
+		return false;
+
+	spin_lock_bh(&w->lock);
+	if (tp->pace_wheel == w) {
+		/* a slot left empty is skipped by tcp_pace_wheel_kick() */
+		list_del_init(&tp->pace_node);
+		WRITE_ONCE(tp->pace_wheel, NULL);
+		ret = true;
+	}
+	spin_unlock_bh(&w->lock);
+
+	return ret;
+}
+
 void __init tcp_tasklet_init(void)
 {
-	int i;
+	u64 now = ktime_get_ns() >> TCP_PACE_SLOT_SHIFT;
+	int i, j;
 
 	for_each_possible_cpu(i) {
 		struct tsq_tasklet *tsq = &per_cpu(tsq_tasklet, i);
+		struct tcp_pace_wheel *w = &per_cpu(tcp_pace_wheel, i);
 
 		INIT_LIST_HEAD(&tsq->head);
 		tasklet_setup(&tsq->tasklet, tcp_tasklet_func);
+
+		spin_lock_init(&w->lock);
+		hrtimer_init(&w->timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_ABS_PINNED_SOFT);
+		w->timer.function = tcp_pace_wheel_kick;
+		w->clock = now;
+		w->expires = U64_MAX;
+		INIT_LIST_HEAD(&w->expired);
+		for (j = 0; j < TCP_PACE_SLOTS; j++)
+			INIT_LIST_HEAD(&w->slots[j]);
 	}
 }
 
@@ -2464,10 +2636,13 @@ static bool tcp_pacing_check(struct sock *sk)
 	if (tp->tcp_wstamp_ns <= tp->tcp_clock_cache)
 		return false;
 
-	if (!hrtimer_is_queued(&tp->pacing_timer)) {
-		hrtimer_start(&tp->pacing_timer,
-			      ns_to_ktime(tp->tcp_wstamp_ns),
-			      HRTIMER_MODE_ABS_PINNED_SOFT);
+	if (!hrtimer_is_queued(&tp->pacing_timer) &&
+	    !READ_ONCE(tp->pace_wheel)) {
+		if (!READ_ONCE(sock_net(sk)->ipv4.sysctl_tcp_pace_wheel) ||
+		    !tcp_pace_wheel_add(sk))
+			hrtimer_start(&tp->pacing_timer,
+				      ns_to_ktime(tp->tcp_wstamp_ns),
+				      HRTIMER_MODE_ABS_PINNED_SOFT);
 		sock_hold(sk);
 	}
 	return true;
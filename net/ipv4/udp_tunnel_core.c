@@ -3,6 +3,7 @@
 #include <linux/errno.h>
 #include <linux/socket.h>
 #include <linux/kernel.h>
+#include <linux/ethtool.h>
 #include <net/dst_metadata.h>
 #include <net/udp.h>
 #include <net/udp_tunnel.h>
@@ -202,4 +203,56 @@ struct metadata_dst *udp_tun_rx_dst(struct sk_buff *skb,  unsigned short family,
 }
 EXPORT_SYMBOL_GPL(udp_tun_rx_dst);
 
+struct udp_tunnel_gro_stats __percpu *udp_tunnel_gro_stats_alloc(void)
+{
+	struct udp_tunnel_gro_stats __percpu *stats;
+	int cpu;
+
+	stats = alloc_percpu(struct udp_tunnel_gro_stats);
+	if (!stats)
+		return NULL;
+
+	for_each_possible_cpu(cpu)
+		u64_stats_init(&per_cpu_ptr(stats, cpu)->syncp);
+	return stats;
+}
+EXPORT_SYMBOL_GPL(udp_tunnel_gro_stats_alloc);
+
+static const char udp_tunnel_gro_stats_names[][ETH_GSTRING_LEN] = {
+	"rx_gro_packets",
+	"rx_gro_segs",
+};
+
+/* ethtool helpers, fill UDP_TUNNEL_GRO_STATS_LEN strings and values */
+void udp_tunnel_gro_stats_strings(u8 *data)
+{
+	memcpy(data, udp_tunnel_gro_stats_names,
+	       sizeof(udp_tunnel_gro_stats_names));
+}
+EXPORT_SYMBOL_GPL(udp_tunnel_gro_stats_strings);
+
+void udp_tunnel_gro_stats_fetch(struct udp_tunnel_gro_stats __percpu *stats,
+				u64 *data)
+{
+	int cpu;
+
+	data[0] = 0;
+	data[1] = 0;
+	for_each_possible_cpu(cpu) {
+		const struct udp_tunnel_gro_stats *s = per_cpu_ptr(stats, cpu);
+		unsigned int start;
+		u64 packets, segs;
+
+		do {
+			start = u64_stats_fetch_begin_irq(&s->syncp);
+			packets = u64_stats_read(&s->packets);
+			segs = u64_stats_read(&s->segs);
+		} while (u64_stats_fetch_retry_irq(&s->syncp, start));
+
+		data[0] += packets;
+		data[1] += segs;
+	}
+}
+EXPORT_SYMBOL_GPL(udp_tunnel_gro_stats_fetch);
+
 MODULE_LICENSE("GPL");
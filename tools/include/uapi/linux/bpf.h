@@ -1111,6 +1111,11 @@ enum bpf_link_type {
  */
 #define BPF_F_SLEEPABLE		(1U << 4)
 
+/* If BPF_F_XDP_HAS_FRAGS is used in BPF_PROG_LOAD command, the loaded program
+ * fully support xdp frags.
+ */
+#define BPF_F_XDP_HAS_FRAGS	(1U << 5)
+
 /* When BPF ldimm64's insn[0].src_reg != 0 then this can have
  * the following extensions:
  *
@@ -1211,6 +1216,15 @@ enum {
 
 /* Create a map that is suitable to be an inner map with dynamic max entries */
 	BPF_F_INNER_MAP		= (1U << 12),
+
+/* Grow and shrink the buckets of a BPF_F_NO_PREALLOC hash map with its size */
+	BPF_F_RESIZABLE		= (1U << 13),
+
+/* Split the common LRU list of a BPF_MAP_TYPE_LRU_[PERCPU_]HASH map into
+ * shards selected by the key's hash. Free nodes are stolen from the other
+ * shards before a shard evicts one of its own elements.
+ */
+	BPF_F_SHARDED_LRU	= (1U << 14),
 };
 
 /* Flags for BPF_PROG_QUERY. */
@@ -1280,6 +1294,12 @@ union bpf_attr {
 		 * BPF_MAP_TYPE_BLOOM_FILTER - the lowest 4 bits indicate the
 		 * number of hash functions (if 0, the bloom filter will default
 		 * to using 5 hash functions).
+		 *
+		 * BPF_MAP_TYPE_RINGBUF - wakeup watermark in bytes, if non-zero
+		 * the consumer is only woken up once that much data is
+		 * pending instead of for each record it waits for. A watermark
+		 * of the ring size or more disables wakeups for consumers
+		 * which busy-poll, unless BPF_RB_FORCE_WAKEUP is given.
 		 */
 		__u64	map_extra;
 	};
@@ -5750,6 +5770,10 @@ struct bpf_map_info {
 	__u32 btf_value_type_id;
 	__u32 :32;	/* alignment pad */
 	__u64 map_extra;
+	/* hash maps only */
+	__u32 nr_buckets;	/* current number of hash buckets */
+	__u32 nr_elems;		/* elements, not counted if preallocated */
+	__u64 nr_resizes;	/* BPF_F_RESIZABLE bucket table replacements */
 } __attribute__((aligned(8)));
 
 struct bpf_btf_info {
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+#include <bpf_util.h>
+#include <test_maps.h>
+
+#define RESIZE_MAX_ENTRIES	(1 << 16)
+#define RESIZE_NR_ELEMS		10000
+#define RESIZE_MIN_BUCKETS	64
+
+static void map_info(int map_fd, struct bpf_map_info *info)
+{
+	__u32 len = sizeof(*info);
+	int err;
+
+	memset(info, 0, len);
+	err = bpf_obj_get_info_by_fd(map_fd, info, &len);
+	CHECK(err, "bpf_obj_get_info_by_fd()", "error:%s\n", strerror(errno));
+}
+
+/* resizes run from a workqueue, give them a second to settle */
+static void wait_buckets(int map_fd, bool grow, __u32 nr_buckets)
+{
+	struct bpf_map_info info;
+	int i;
+
+	for (i = 0; i < 100; i++) {
+		map_info(map_fd, &info);
+		if (grow ? info.nr_buckets >= nr_buckets :
+			   info.nr_buckets <= nr_buckets)
+			return;
+		usleep(10000);
+	}
+
+	CHECK(1, "nr_buckets", "got %u, expected %s %u\n", info.nr_buckets,
+	      grow ? ">=" : "<=", nr_buckets);
+}
+
+static void test_htab_resize_elems(void)
+{
+	LIBBPF_OPTS(bpf_map_create_opts, opts,
+		.map_flags = BPF_F_NO_PREALLOC | BPF_F_RESIZABLE,
+	);
+	struct bpf_map_info info;
+	int map_fd, key, value, i, err;
+
+	map_fd = bpf_map_create(BPF_MAP_TYPE_HASH, "resize_map", sizeof(int),
+				sizeof(int), RESIZE_MAX_ENTRIES, &opts);
+	CHECK(map_fd < 0, "bpf_map_create()", "error:%s\n", strerror(errno));
+
+	map_info(map_fd, &info);
+	CHECK(info.nr_buckets != RESIZE_MIN_BUCKETS, "initial nr_buckets",
+	      "got %u\n", info.nr_buckets);
+
+	/* lookups and updates have to keep working while the map grows */
+	for (i = 0; i < RESIZE_NR_ELEMS; i++) {
+		key = i;
+		value = i + 1;
+		err = bpf_map_update_elem(map_fd, &key, &value, BPF_NOEXIST);
+		CHECK(err, "bpf_map_update_elem()", "key %d error:%s\n", i,
+		      strerror(errno));
+		key = i / 2;
+		err = bpf_map_lookup_elem(map_fd, &key, &value);
+		CHECK(err || value != key + 1, "bpf_map_lookup_elem()",
+		      "key %d value %d error:%s\n", key, value, strerror(errno));
+	}
+
+	wait_buckets(map_fd, true, RESIZE_NR_ELEMS * 4 / 3);
+	map_info(map_fd, &info);
+	CHECK(info.nr_elems != RESIZE_NR_ELEMS, "nr_elems", "got %u\n",
+	      info.nr_elems);
+	CHECK(!info.nr_resizes, "nr_resizes", "no resize\n");
+
+	for (i = 0; i < RESIZE_NR_ELEMS; i++) {
+		key = i;
+		err = bpf_map_lookup_elem(map_fd, &key, &value);
+		CHECK(err || value != i + 1, "bpf_map_lookup_elem()",
+		      "key %d value %d error:%s\n", i, value, strerror(errno));
+	}
+
+	for (i = 0; i < RESIZE_NR_ELEMS; i++) {
+		key = i;
+		err = bpf_map_delete_elem(map_fd, &key);
+		CHECK(err, "bpf_map_delete_elem()", "key %d error:%s\n", i,
+		      strerror(errno));
+	}
+
+	wait_buckets(map_fd, false, RESIZE_MIN_BUCKETS);
+	err = bpf_map_get_next_key(map_fd, NULL, &key);
+	CHECK(!err || errno != ENOENT, "bpf_map_get_next_key()",
+	      "map not empty\n");
+
+	close(map_fd);
+}
+
+static void test_htab_resize_flags(void)
+{
+	LIBBPF_OPTS(bpf_map_create_opts, opts,
+		.map_flags = BPF_F_RESIZABLE,
+	);
+	int map_fd;
+
+	/* preallocated elements can't be resized */
+	map_fd = bpf_map_create(BPF_MAP_TYPE_HASH, "resize_map", sizeof(int),
+				sizeof(int), RESIZE_MAX_ENTRIES, &opts);
+	CHECK(map_fd >= 0 || errno != EINVAL, "prealloc BPF_F_RESIZABLE",
+	      "map_fd %d error:%s\n", map_fd, strerror(errno));
+	if (map_fd >= 0)
+		close(map_fd);
+
+	/* neither can LRU maps */
+	opts.map_flags = BPF_F_NO_PREALLOC | BPF_F_RESIZABLE;
+	map_fd = bpf_map_create(BPF_MAP_TYPE_LRU_HASH, "resize_map",
+				sizeof(int), sizeof(int), RESIZE_MAX_ENTRIES,
+				&opts);
+	CHECK(map_fd >= 0, "LRU BPF_F_RESIZABLE", "map_fd %d\n", map_fd);
+	if (map_fd >= 0)
+		close(map_fd);
+}
+
+void test_htab_map_resize(void)
+{
+	test_htab_resize_flags();
+	test_htab_resize_elems();
+	printf("%s:PASS\n", __func__);
+}
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+#include <bpf_util.h>
+#include <test_maps.h>
+
+#define SHARDED_MAX_ENTRIES	4096
+
+static int count_elems(int map_fd)
+{
+	int key, next_key, *prev = NULL, n = 0;
+
+	while (!bpf_map_get_next_key(map_fd, prev, &next_key)) {
+		key = next_key;
+		prev = &key;
+		n++;
+	}
+
+	return n;
+}
+
+static void test_lru_sharded_fill(int map_type)
+{
+	LIBBPF_OPTS(bpf_map_create_opts, opts,
+		.map_flags = BPF_F_SHARDED_LRU,
+	);
+	int nr_cpus = bpf_num_possible_cpus();
+	int map_fd, key, i, err, n;
+	__u64 *value;
+
+	value = calloc(nr_cpus, sizeof(*value));
+	CHECK(!value, "calloc", "error:%s\n", strerror(errno));
+
+	map_fd = bpf_map_create(map_type, "lru_sharded", sizeof(int),
+				sizeof(__u64), SHARDED_MAX_ENTRIES, &opts);
+	CHECK(map_fd < 0, "bpf_map_create()", "error:%s\n", strerror(errno));
+
+	/* free nodes are stolen across shards, nothing is evicted early */
+	for (i = 0; i < SHARDED_MAX_ENTRIES; i++) {
+		key = i;
+		err = bpf_map_update_elem(map_fd, &key, value, BPF_NOEXIST);
+		CHECK(err, "bpf_map_update_elem()", "key %d error:%s\n", i,
+		      strerror(errno));
+	}
+
+	n = count_elems(map_fd);
+	CHECK(n != SHARDED_MAX_ENTRIES, "full map", "got %d elems\n", n);
+
+	/* and a full map keeps taking new keys by evicting old ones */
+	for (i = SHARDED_MAX_ENTRIES; i < 4 * SHARDED_MAX_ENTRIES; i++) {
+		key = i;
+		err = bpf_map_update_elem(map_fd, &key, value, BPF_NOEXIST);
+		CHECK(err, "bpf_map_update_elem()", "key %d error:%s\n", i,
+		      strerror(errno));
+		err = bpf_map_lookup_elem(map_fd, &key, value);
+		CHECK(err, "bpf_map_lookup_elem()", "key %d error:%s\n", i,
+		      strerror(errno));
+	}
+
+	n = count_elems(map_fd);
+	CHECK(n > SHARDED_MAX_ENTRIES, "evicted map", "got %d elems\n", n);
+
+	close(map_fd);
+	free(value);
+}
+
+static void test_lru_sharded_flags(void)
+{
+	LIBBPF_OPTS(bpf_map_create_opts, opts,
+		.map_flags = BPF_F_SHARDED_LRU | BPF_F_NO_COMMON_LRU,
+	);
+	int map_fd;
+
+	/* the percpu LRU lists can't be sharded */
+	map_fd = bpf_map_create(BPF_MAP_TYPE_LRU_HASH, "lru_sharded",
+				sizeof(int), sizeof(int), SHARDED_MAX_ENTRIES,
+				&opts);
+	CHECK(map_fd >= 0 || errno != EINVAL, "BPF_F_NO_COMMON_LRU",
+	      "map_fd %d error:%s\n", map_fd, strerror(errno));
+	if (map_fd >= 0)
+		close(map_fd);
+
+	/* neither can a map without LRU */
+	opts.map_flags = BPF_F_SHARDED_LRU;
+	map_fd = bpf_map_create(BPF_MAP_TYPE_HASH, "lru_sharded", sizeof(int),
+				sizeof(int), SHARDED_MAX_ENTRIES, &opts);
+	CHECK(map_fd >= 0 || errno != EINVAL, "BPF_MAP_TYPE_HASH",
+	      "map_fd %d error:%s\n", map_fd, strerror(errno));
+	if (map_fd >= 0)
+		close(map_fd);
+}
+
+void test_lru_map_sharded(void)
+{
+	test_lru_sharded_flags();
+	test_lru_sharded_fill(BPF_MAP_TYPE_LRU_HASH);
+	test_lru_sharded_fill(BPF_MAP_TYPE_LRU_PERCPU_HASH);
+	printf("%s:PASS\n", __func__);
+}
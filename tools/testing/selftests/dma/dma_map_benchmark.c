@@ -23,6 +23,8 @@
 #define DMA_MAP_TO_DEVICE	1
 #define DMA_MAP_FROM_DEVICE	2
 
+#define DMA_MAP_SWIOTLB		(1 << 0)
+
 static char *directions[] = {
 	"BIDIRECTIONAL",
 	"TO_DEVICE",
@@ -41,7 +43,8 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule; /* how many PAGE_SIZE will do map/unmap once a time */
-	__u8 expansion[76];	/* For future use */
+	__u32 flags; /* DMA_MAP_* benchmark flags */
+	__u8 expansion[72];	/* For future use */
 };
 
 int main(int argc, char **argv)
@@ -54,11 +57,13 @@ int main(int argc, char **argv)
 	int bits = 32, xdelay = 0, dir = DMA_MAP_BIDIRECTIONAL;
 	/* default granule 1 PAGESIZE */
 	int granule = 1;
+	/* default to whatever the DMA ops of the device do */
+	int swiotlb = 0;
 
 	int cmd = DMA_MAP_BENCHMARK;
 	char *p;
 
-	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:S")) != -1) {
 		switch (opt) {
 		case 't':
 			threads = atoi(optarg);
@@ -81,6 +86,9 @@ int main(int argc, char **argv)
 		case 'g':
 			granule = atoi(optarg);
 			break;
+		case 'S':
+			swiotlb = 1;
+			break;
 		default:
 			return -1;
 		}
@@ -135,14 +143,17 @@ int main(int argc, char **argv)
 	map.dma_dir = dir;
 	map.dma_trans_ns = xdelay;
 	map.granule = granule;
+	if (swiotlb)
+		map.flags |= DMA_MAP_SWIOTLB;
 
 	if (ioctl(fd, cmd, &map)) {
 		perror("ioctl");
 		exit(1);
 	}
 
-	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d\n",
-			threads, seconds, node, dir[directions], granule);
+	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d%s\n",
+			threads, seconds, node, dir[directions], granule,
+			swiotlb ? " swiotlb" : "");
 	printf("average map latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_map_100ns/10.0, map.map_stddev/10.0);
 	printf("average unmap latency(us):%.1f standard deviation:%.1f\n",